@@ -36,6 +36,7 @@
 #define AcceleratorBuffer_h
 
 #include "AlignedAllocator.h"
+#include "NumaTopology.h"
 #include "QueueManager.h"
 
 #ifdef _WIN32
@@ -48,16 +49,22 @@
 #endif
 
 #include <type_traits>
+#include <algorithm>
+
+#include "DeviceMemoryArena.h"
+#include "GpuMemoryBudget.h"
+#include "AcceleratorBufferRegistry.h"
+#include "DeviceLength.h"
+#include "ReadbackFuture.h"
 
-extern uint32_t g_vkPinnedMemoryType;
-extern uint32_t g_vkLocalMemoryType;
 extern std::shared_ptr<vk::raii::Device> g_vkComputeDevice;
-extern std::unique_ptr<vk::raii::CommandBuffer> g_vkTransferCommandBuffer;
-extern std::shared_ptr<QueueHandle> g_vkTransferQueue;
-extern std::mutex g_vkTransferMutex;
+extern std::unique_ptr<vk::raii::CommandBuffer> g_vkDmaCommandBuffer;
+extern std::shared_ptr<QueueHandle> g_vkDmaQueue;
+extern std::mutex g_vkDmaMutex;
 
 extern bool g_hasDebugUtils;
 extern bool g_vulkanDeviceHasUnifiedMemory;
+extern size_t g_vkStorageBufferOffsetAlignment;
 
 template<class T>
 class AcceleratorBuffer;
@@ -161,7 +168,8 @@ protected:
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Allocator for CPU-only memory
 
-	AlignedAllocator<T, 32> m_cpuAllocator;
+	//64 byte alignment so AVX-512 loads of a whole vector never straddle a cache line
+	AlignedAllocator<T, 64> m_cpuAllocator;
 
 public:
 
@@ -257,11 +265,11 @@ protected:
 	///@brief CPU-side mapped pointer
 	T* m_cpuPtr;
 
-	///@brief CPU-side physical memory
-	std::unique_ptr<vk::raii::DeviceMemory> m_cpuPhysMem;
+	///@brief CPU-side physical memory (sub-allocated from g_vkPinnedMemoryArena)
+	std::unique_ptr<DeviceMemoryAllocation> m_cpuPhysMem;
 
-	///@brief GPU-side physical memory
-	std::unique_ptr<vk::raii::DeviceMemory> m_gpuPhysMem;
+	///@brief GPU-side physical memory (sub-allocated from g_vkLocalMemoryArena)
+	std::unique_ptr<DeviceMemoryAllocation> m_gpuPhysMem;
 
 	///@brief Buffer object for CPU-side memory
 	std::unique_ptr<vk::raii::Buffer> m_cpuBuffer;
@@ -269,6 +277,9 @@ protected:
 	///@brief Buffer object for GPU-side memory
 	std::unique_ptr<vk::raii::Buffer> m_gpuBuffer;
 
+	///@brief Registration of m_gpuPhysMem with g_gpuMemoryBudget (null if not registered)
+	GpuMemoryBudget::Entry* m_budgetEntry;
+
 	///@brief True if we have only one piece of physical memory accessible from both sides
 	bool m_buffersAreSame;
 
@@ -278,6 +289,9 @@ protected:
 	///@brief True if m_gpuPhysMem contains stale data (m_cpuPtr has been modified and they point to different memory)
 	bool m_gpuPhysMemIsStale;
 
+	///@brief Copy to m_cpuPtr started by PrepareForCpuAccessAsync() which may still be in flight
+	mutable ReadbackFuture m_pendingReadback;
+
 	///@brief File handle used for MEM_TYPE_CPU_PAGED
 #ifndef _WIN32
 	int m_tempFileHandle;
@@ -292,8 +306,23 @@ protected:
 	///@brief Size of the allocated memory space (may be larger than m_size)
 	size_t m_capacity;
 
-	///@brief Size of the memory actually being used
-	size_t m_size;
+	///@brief Size of the memory actually being used (an upper bound while m_deviceLength is set)
+	mutable size_t m_size;
+
+	///@brief Length written by a GPU kernel which has not yet been read back, if any
+	mutable std::shared_ptr<DeviceLength> m_deviceLength;
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Copy-on-write sharing
+
+	///@brief Buffer whose storage we alias if we are a copy-on-write snapshot (see ShareFrom()), otherwise null
+	AcceleratorBuffer<T>* m_cowSource;
+
+	///@brief Index of our first element within m_cowSource's storage (nonzero for views, see ShareRangeFrom())
+	size_t m_cowOffset;
+
+	///@brief Snapshots currently aliasing our storage
+	std::vector<AcceleratorBuffer<T>*> m_cowSnapshots;
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Hint configuration
@@ -312,6 +341,21 @@ protected:
 	///@brief Hint about how likely future GPU access is
 	UsageHint m_gpuAccessHint;
 
+	///@brief NUMA node host-only memory should be placed on, or -1 to leave it to the kernel (first touch)
+	int m_cpuNode;
+
+public:
+	enum HugePagePolicy
+	{
+		HUGE_PAGES_AUTO,	//use huge pages for allocations above AlignedAllocator::HUGE_PAGE_THRESHOLD
+		HUGE_PAGES_NEVER,
+		HUGE_PAGES_ALWAYS
+	};
+
+protected:
+	///@brief Whether host-only memory should be backed by huge pages
+	HugePagePolicy m_hugePagePolicy;
+
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Construction / destruction
 public:
@@ -324,6 +368,7 @@ public:
 		, m_gpuMemoryType(MEM_TYPE_NULL)
 		, m_cpuPtr(nullptr)
 		, m_gpuPhysMem(nullptr)
+		, m_budgetEntry(nullptr)
 		, m_buffersAreSame(false)
 		, m_cpuPhysMemIsStale(false)
 		, m_gpuPhysMemIsStale(false)
@@ -332,17 +377,29 @@ public:
 		#endif
 		, m_capacity(0)
 		, m_size(0)
+		, m_cowSource(nullptr)
+		, m_cowOffset(0)
 		, m_cpuAccessHint(HINT_LIKELY)	//default access hint: CPU-side pinned memory
 		, m_gpuAccessHint(HINT_UNLIKELY)
+		, m_cpuNode(-1)
+		, m_hugePagePolicy(HUGE_PAGES_AUTO)
 		, m_name(name)
 	{
 		//non-trivially-copyable types can't be copied to GPU except on unified memory platforms
 		if(!std::is_trivially_copyable<T>::value && !g_vulkanDeviceHasUnifiedMemory)
 			m_gpuAccessHint = HINT_NEVER;
+
+		AcceleratorBufferRegistry::GetInstance().Register(this, m_name);
 	}
 
 	~AcceleratorBuffer()
 	{
+		//A snapshot owns nothing, and our own snapshots inherit our storage rather than copying it
+		Unshare(false);
+		if(!m_cowSnapshots.empty())
+			HandOffToSnapshots();
+
+		AcceleratorBufferRegistry::GetInstance().Unregister(this);
 		FreeCpuBuffer();
 		FreeGpuBuffer(true);
 	}
@@ -353,9 +410,14 @@ public:
 
 	/**
 		@brief Returns the actual size of the container (may be smaller than what was allocated)
+
+		If the size was determined by a GPU kernel (see SetDeviceLength()), this waits for the kernel to complete.
 	 */
 	size_t size() const
-	{ return m_size; }
+	{
+		ResolveDeviceLength();
+		return m_size;
+	}
 
 	/**
 		@brief Returns the allocated size of the container
@@ -389,37 +451,43 @@ public:
 		@brief Returns true if the container is empty
 	 */
 	bool empty() const
-	{ return (m_size == 0); }
+	{ return (size() == 0); }
 
 	/**
 		@brief Returns true if the CPU-side buffer is stale
 	 */
 	bool IsCpuBufferStale() const
-	{ return m_cpuPhysMemIsStale; }
+	{ return m_cowSource ? m_cowSource->m_cpuPhysMemIsStale : m_cpuPhysMemIsStale; }
 
 	/**
 		@brief Returns true if the GPU-side buffer is stale
 	 */
 	bool IsGpuBufferStale() const
-	{ return m_gpuPhysMemIsStale; }
+	{ return m_cowSource ? m_cowSource->m_gpuPhysMemIsStale : m_gpuPhysMemIsStale; }
 
 	/**
 		@brief Returns true if there is currently a CPU-side buffer
 	 */
 	bool HasCpuBuffer() const
-	{ return (m_cpuPtr != nullptr); }
+	{ return m_cowSource ? m_cowSource->HasCpuBuffer() : (m_cpuPtr != nullptr); }
 
 	/**
 		@brief Returns true if there is currently a GPU-side buffer
 	 */
 	bool HasGpuBuffer() const
-	{ return (m_gpuPhysMem != nullptr); }
+	{ return m_cowSource ? m_cowSource->HasGpuBuffer() : (m_gpuPhysMem != nullptr); }
+
+	/**
+		@brief Returns true if the only up-to-date copy of the data is on the GPU, so CPU access would need a download
+	 */
+	bool IsCurrentOnlyOnGpu() const
+	{ return !empty() && HasGpuBuffer() && !IsGpuBufferStale() && (!HasCpuBuffer() || IsCpuBufferStale()); }
 
 	/**
 		@brief Returns true if the object contains only a single buffer
 	 */
 	bool IsSingleSharedBuffer() const
-	{ return m_buffersAreSame; }
+	{ return m_cowSource ? m_cowSource->m_buffersAreSame : m_buffersAreSame; }
 
 	/**
 		@brief Returns the preferred buffer for GPU-side access.
@@ -428,6 +496,11 @@ public:
 	 */
 	vk::Buffer GetBuffer()
 	{
+		//Callers using the buffer directly don't know about view offsets, so views need a copy of their own
+		if(m_cowSource && m_cowOffset)
+			Unshare();
+		if(m_cowSource)
+			return m_cowSource->GetBuffer();
 		if(m_gpuBuffer != nullptr)
 			return **m_gpuBuffer;
 		else
@@ -442,9 +515,20 @@ public:
 
 	/**
 		@brief Returns a vk::DescriptorBufferInfo suitable for binding this object to
+
+		A view into part of another buffer (see ShareRangeFrom()) is bound at an offset into that buffer's storage,
+		as long as the offset meets the device's alignment requirement. Otherwise it gets a copy of its own first.
 	 */
 	vk::DescriptorBufferInfo GetBufferInfo()
 	{
+		if(m_cowSource && m_cowOffset)
+		{
+			size_t offset = m_cowOffset * sizeof(T);
+			if( (g_vkStorageBufferOffsetAlignment != 0) && ((offset % g_vkStorageBufferOffsetAlignment) == 0) )
+				return vk::DescriptorBufferInfo(m_cowSource->GetBuffer(), offset, m_size * sizeof(T));
+			Unshare();
+		}
+
 		return vk::DescriptorBufferInfo(
 			GetBuffer(),
 			0,
@@ -456,6 +540,9 @@ public:
 	 */
 	void resize(size_t size)
 	{
+		//Resizing either side of a copy-on-write share ends it
+		BreakSharing(size != 0);
+
 		//Need to grow?
 		if(size > m_capacity)
 		{
@@ -468,8 +555,50 @@ public:
 				reserve(m_capacity * 2);
 		}
 
-		//Update our size
+		//Update our size. This overrides any length coming from the GPU
 		m_size = size;
+		m_deviceLength = nullptr;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Device-side length
+
+	/**
+		@brief Makes the number of valid elements in the buffer the count most recently written by a GPU kernel
+
+		The buffer must already be sized to an upper bound on the count. Until the count is read back, the buffer
+		is bound to shaders at that size, so kernels consuming it should take the real count from the DeviceLength
+		(and are best launched with ComputePipeline::DispatchIndirect()). The count is read back, after waiting
+		for the kernel, on the first call to size(), empty() or PrepareForCpuAccess(). Any resize() detaches
+		the length again.
+
+		@param length	The count (DeviceLength::MarkWritten() must already have been called)
+	 */
+	void SetDeviceLength(std::shared_ptr<DeviceLength> length)
+	{ m_deviceLength = length; }
+
+	///@brief Gets the length attached to the buffer, or null if its size is known on the CPU
+	std::shared_ptr<DeviceLength> GetDeviceLength() const
+	{ return m_deviceLength; }
+
+	///@brief Reads back the length written by a GPU kernel if there is one, and updates the size to match
+	void ResolveDeviceLength() const
+	{
+		if(!m_deviceLength)
+			return;
+
+		m_size = std::min(static_cast<size_t>(m_deviceLength->Resolve()), m_capacity);
+		m_deviceLength = nullptr;
+	}
+
+	///@brief Blocks until a copy started by PrepareForCpuAccessAsync(), if any, has completed
+	void WaitForReadback() const
+	{
+		if(!m_pendingReadback.IsPending())
+			return;
+
+		m_pendingReadback.Wait();
+		m_pendingReadback = ReadbackFuture();
 	}
 
 	/**
@@ -489,10 +618,22 @@ public:
 
 	/**
 		@brief Frees unused memory so that m_size == m_capacity
+
+		An empty container frees all of its memory.
 	 */
 	void shrink_to_fit()
 	{
-		if(m_size != m_capacity)
+		//Snapshots don't own any memory
+		if(m_cowSource)
+			return;
+
+		if(m_size == 0)
+		{
+			FreeGpuBuffer(true);
+			FreeCpuBuffer();
+			m_capacity = 0;
+		}
+		else if(m_size != m_capacity)
 			Reallocate(m_size);
 	}
 
@@ -502,6 +643,7 @@ public:
 	 __attribute__((noinline))
 	 void CopyFrom(const std::vector<T>& rhs)
 	 {
+		 BreakSharing(false);
 		 PrepareForCpuAccess();
 		 resize(rhs.size());
 		 memcpy(m_cpuPtr, &rhs[0], m_size * sizeof(T));
@@ -511,89 +653,352 @@ public:
 	/**
 		@brief Copies our content from another AcceleratorBuffer
 	 */
-	 __attribute__((noinline))
 	void CopyFrom(const AcceleratorBuffer<T>& rhs, bool reallocateToMatch = true)
 	{
+		//Our old content is about to be overwritten, and a snapshot is copied from the storage it aliases
+		BreakSharing(false);
+		rhs.ResolveDeviceLength();
+		if(rhs.m_cowSource)
+			CopyRangeFrom(*rhs.m_cowSource, rhs.m_cowOffset, rhs.m_size, reallocateToMatch);
+		else
+			CopyRangeFrom(rhs, 0, rhs.m_size, reallocateToMatch);
+	}
+
+	/**
+		@brief Copies our content from another AcceleratorBuffer
+	 */
+	 __attribute__((noinline))
+	void CopyFromNonblocking(
+		vk::raii::CommandBuffer& cmdBuf,
+		const AcceleratorBuffer<T>& rhs,
+		bool reallocateToMatch = true)
+	{
+		//Our old content is about to be overwritten, and a snapshot is copied from the storage it aliases
+		BreakSharing(false);
+		rhs.ResolveDeviceLength();
+		const AcceleratorBuffer<T>& src = rhs.m_cowSource ? *rhs.m_cowSource : rhs;
+		size_t offset = rhs.m_cowSource ? rhs.m_cowOffset : 0;
+
+		src.WaitForReadback();
+
 		//Copy placement hints from the other instance, then resize to match
-		SetCpuAccessHint(rhs.m_cpuAccessHint);
-		SetGpuAccessHint(rhs.m_gpuAccessHint, reallocateToMatch);
+		SetCpuAccessHint(src.m_cpuAccessHint);
+		SetCpuNode(src.m_cpuNode);
+		SetHugePagePolicy(src.m_hugePagePolicy);
+		SetGpuAccessHint(src.m_gpuAccessHint, reallocateToMatch);
 		resize(rhs.m_size);
 
 		//Valid data CPU side? Copy it to here
-		if(rhs.HasCpuBuffer() && !rhs.m_cpuPhysMemIsStale)
+		if(src.HasCpuBuffer() && !src.m_cpuPhysMemIsStale)
 		{
 			//non-trivially-copyable types have to be copied one at a time
 			if(!std::is_trivially_copyable<T>::value)
 			{
 				for(size_t i=0; i<m_size; i++)
-					m_cpuPtr[i] = rhs.m_cpuPtr[i];
+					m_cpuPtr[i] = src.m_cpuPtr[offset + i];
 			}
 
 			//Trivially copyable types can be done more efficiently in a block
 			else
-				memcpy(m_cpuPtr, rhs.m_cpuPtr, m_size * sizeof(T));
+				memcpy(m_cpuPtr, src.m_cpuPtr + offset, m_size * sizeof(T));
 		}
-		m_cpuPhysMemIsStale = rhs.m_cpuPhysMemIsStale;
+		m_cpuPhysMemIsStale = src.m_cpuPhysMemIsStale;
 
 		//Valid data GPU side? Copy it to here
-		if(rhs.HasGpuBuffer() && !rhs.m_gpuPhysMemIsStale)
+		if(src.HasGpuBuffer() && !src.m_gpuPhysMemIsStale)
 		{
-			std::lock_guard<std::mutex> lock(g_vkTransferMutex);
-
 			//Make the transfer request
-			g_vkTransferCommandBuffer->begin({});
-			vk::BufferCopy region(0, 0, m_size * sizeof(T));
-			g_vkTransferCommandBuffer->copyBuffer(**rhs.m_gpuBuffer, **m_gpuBuffer, {region});
-			g_vkTransferCommandBuffer->end();
-
-			//Submit the request and block until it completes
-			g_vkTransferQueue->SubmitAndBlock(*g_vkTransferCommandBuffer);
+			vk::BufferCopy region(offset * sizeof(T), 0, m_size * sizeof(T));
+			cmdBuf.copyBuffer(**src.m_gpuBuffer, **m_gpuBuffer, {region});
 		}
-		m_gpuPhysMemIsStale = rhs.m_gpuPhysMemIsStale;
+		m_gpuPhysMemIsStale = src.m_gpuPhysMemIsStale;
 	}
 
+protected:
+
 	/**
-		@brief Copies our content from another AcceleratorBuffer
+		@brief Copies count elements starting at offset from another (non-snapshot) AcceleratorBuffer
+
+		The copy is blocking, and replaces all of our content.
 	 */
 	 __attribute__((noinline))
-	void CopyFromNonblocking(
-		vk::raii::CommandBuffer& cmdBuf,
-		const AcceleratorBuffer<T>& rhs,
-		bool reallocateToMatch = true)
+	void CopyRangeFrom(const AcceleratorBuffer<T>& src, size_t offset, size_t count, bool reallocateToMatch)
 	{
+		src.WaitForReadback();
+
 		//Copy placement hints from the other instance, then resize to match
-		SetCpuAccessHint(rhs.m_cpuAccessHint);
-		SetGpuAccessHint(rhs.m_gpuAccessHint, reallocateToMatch);
-		resize(rhs.m_size);
+		SetCpuAccessHint(src.m_cpuAccessHint);
+		SetCpuNode(src.m_cpuNode);
+		SetHugePagePolicy(src.m_hugePagePolicy);
+		SetGpuAccessHint(src.m_gpuAccessHint, reallocateToMatch);
+		resize(count);
 
 		//Valid data CPU side? Copy it to here
-		if(rhs.HasCpuBuffer() && !rhs.m_cpuPhysMemIsStale)
+		if(src.HasCpuBuffer() && !src.m_cpuPhysMemIsStale)
 		{
 			//non-trivially-copyable types have to be copied one at a time
 			if(!std::is_trivially_copyable<T>::value)
 			{
 				for(size_t i=0; i<m_size; i++)
-					m_cpuPtr[i] = rhs.m_cpuPtr[i];
+					m_cpuPtr[i] = src.m_cpuPtr[offset + i];
 			}
 
 			//Trivially copyable types can be done more efficiently in a block
 			else
-				memcpy(m_cpuPtr, rhs.m_cpuPtr, m_size * sizeof(T));
+				memcpy(m_cpuPtr, src.m_cpuPtr + offset, m_size * sizeof(T));
 		}
-		m_cpuPhysMemIsStale = rhs.m_cpuPhysMemIsStale;
+		m_cpuPhysMemIsStale = src.m_cpuPhysMemIsStale;
 
 		//Valid data GPU side? Copy it to here
-		if(rhs.HasGpuBuffer() && !rhs.m_gpuPhysMemIsStale)
+		if(src.HasGpuBuffer() && !src.m_gpuPhysMemIsStale)
 		{
+			std::lock_guard<std::mutex> lock(g_vkDmaMutex);
+
 			//Make the transfer request
-			vk::BufferCopy region(0, 0, m_size * sizeof(T));
-			cmdBuf.copyBuffer(**rhs.m_gpuBuffer, **m_gpuBuffer, {region});
+			g_vkDmaCommandBuffer->begin({});
+			vk::BufferCopy region(offset * sizeof(T), 0, m_size * sizeof(T));
+			g_vkDmaCommandBuffer->copyBuffer(**src.m_gpuBuffer, **m_gpuBuffer, {region});
+			g_vkDmaCommandBuffer->end();
+
+			//Submit the request and block until it completes
+			g_vkDmaQueue->SubmitAndBlock(*g_vkDmaCommandBuffer);
 		}
-		m_gpuPhysMemIsStale = rhs.m_gpuPhysMemIsStale;
+		m_gpuPhysMemIsStale = src.m_gpuPhysMemIsStale;
 	}
 
+public:
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Copy-on-write sharing
+
+	/**
+		@brief Makes this buffer a copy-on-write snapshot of another buffer, in constant time
+
+		Has the same effect as CopyFrom(), except that the content is not copied: the snapshot aliases the CPU and
+		GPU storage of rhs until one side is about to change it. At that point the snapshot gets a private copy, made
+		from the storage before the change. Changes are detected by resize() (and everything built on it, such as
+		clear() and push_back()), reallocation, CopyFrom(), ShareFrom(), PrepareForCpuAccessIgnoringGpuData() and
+		output-only PrepareForGpuAccess(). Anything else writing the content in place, after a plain
+		PrepareForCpuAccess() / PrepareForGpuAccess(), must call BreakSharing() first; MarkModifiedFromCpu() and
+		MarkModifiedFromGpu() end sharing too, but only after the write has already been seen by the other side.
+		Reads need no special handling on either side.
+
+		If rhs is destroyed while it still has snapshots, one of them takes over its storage rather than copying it,
+		so a snapshot of a waveform which is simply replaced by a new one never costs a copy at all.
+
+		Both buffers must be used from the same thread (or with the same external locking), as with any other pair of
+		buffers where one is an input to the code filling the other.
+
+		@param rhs	Buffer to share content with. If rhs is itself a snapshot, we share its source's storage
+	 */
+	void ShareFrom(AcceleratorBuffer<T>& rhs)
+	{ ShareRangeFrom(rhs, 0, rhs.size()); }
+
+	/**
+		@brief Makes this buffer a copy-on-write view of part of another buffer, in constant time
+
+		Works like ShareFrom(), but we see only count elements starting at index start of rhs. On the CPU the
+		view's m_cpuPtr points into rhs's storage, and on the GPU GetBufferInfo() binds rhs's buffer at an offset
+		when the device allows it. GetBuffer() has no way to express an offset, so calling it on a view with a
+		nonzero start makes a private copy.
+
+		@param rhs		Buffer to share content with
+		@param start	Index of the first element of rhs to include
+		@param count	Number of elements to include
+	 */
+	void ShareRangeFrom(AcceleratorBuffer<T>& rhs, size_t start, size_t count)
+	{
+		//Snapshots of snapshots share the original storage
+		AcceleratorBuffer<T>* src = &rhs;
+		if(rhs.m_cowSource)
+		{
+			src = rhs.m_cowSource;
+			start += rhs.m_cowOffset;
+		}
+		src->ResolveDeviceLength();
+		start = std::min(start, src->m_size);
+		count = std::min(count, src->m_size - start);
+		if( (src == this) || ( (m_cowSource == src) && (m_cowOffset == start) && (m_size == count) ) )
+			return;
+
+		//Drop our own content. Marking it empty first avoids pointless copies between the old CPU and GPU buffers
+		BreakSharing(false);
+		WaitForReadback();
+		m_size = 0;
+		m_deviceLength = nullptr;
+		FreeGpuBuffer(true);
+		FreeCpuBuffer();
+		m_capacity = 0;
+
+		src->WaitForReadback();
+		m_cpuAccessHint = src->m_cpuAccessHint;
+		m_gpuAccessHint = src->m_gpuAccessHint;
+		m_cpuNode = src->m_cpuNode;
+		m_hugePagePolicy = src->m_hugePagePolicy;
+
+		m_cowSource = src;
+		m_cowOffset = start;
+		src->m_cowSnapshots.push_back(this);
+		m_size = count;
+		SyncWithSource();
+	}
+
+	/**
+		@brief Ends any copy-on-write sharing this buffer takes part in (see ShareFrom())
+
+		A snapshot gets storage of its own, and snapshots of this buffer get copies of the current content. Call this
+		before modifying the content in place through m_cpuPtr or a shader without going through resize() or
+		one of the other calls ShareFrom() lists.
+
+		@param keepContent	If false and we are a snapshot, the shared content is not copied and we are left empty
+	 */
+	void BreakSharing(bool keepContent = true)
+	{
+		Unshare(keepContent);
+		DetachSnapshots();
+	}
+
+	///@brief Returns true if we are a copy-on-write snapshot aliasing the storage of another buffer
+	bool IsSnapshot() const
+	{ return (m_cowSource != nullptr); }
+
+	///@brief Returns true if copy-on-write snapshots are aliasing our storage
+	bool HasSnapshots() const
+	{ return !m_cowSnapshots.empty(); }
+
 protected:
 
+	/**
+		@brief Stops aliasing the storage of our source, if we are a snapshot
+
+		@param keepContent	True to copy the shared content into storage of our own, false to be left empty
+	 */
+	void Unshare(bool keepContent = true)
+	{
+		if(!m_cowSource)
+			return;
+
+		auto src = m_cowSource;
+		auto& snaps = src->m_cowSnapshots;
+		snaps.erase(std::remove(snaps.begin(), snaps.end(), this), snaps.end());
+
+		size_t offset = m_cowOffset;
+		size_t count = m_size;
+		m_cowSource = nullptr;
+		m_cowOffset = 0;
+		m_cpuPtr = nullptr;
+		m_buffersAreSame = false;
+		m_cpuPhysMemIsStale = false;
+		m_gpuPhysMemIsStale = false;
+		m_size = 0;
+		m_capacity = 0;
+
+		if(keepContent)
+			CopyRangeFrom(*src, offset, count, true);
+	}
+
+	/**
+		@brief Ends sharing on behalf of a caller which will overwrite the whole content, but keeps the size
+	 */
+	void BreakSharingForOverwrite()
+	{
+		if(m_cowSource)
+		{
+			size_t size = m_size;
+			Unshare(false);
+			resize(size);
+		}
+		DetachSnapshots();
+	}
+
+	///@brief Gives each snapshot of us a private copy of the current content
+	void DetachSnapshots()
+	{
+		while(!m_cowSnapshots.empty())
+			m_cowSnapshots.back()->Unshare();
+	}
+
+	///@brief Refreshes a snapshot's view of its source's storage after the source was prepared for access
+	void SyncWithSource()
+	{
+		m_cpuPtr = m_cowSource->m_cpuPtr ? (m_cowSource->m_cpuPtr + m_cowOffset) : nullptr;
+		m_buffersAreSame = m_cowSource->m_buffersAreSame;
+		m_cpuPhysMemIsStale = m_cowSource->m_cpuPhysMemIsStale;
+		m_gpuPhysMemIsStale = m_cowSource->m_gpuPhysMemIsStale;
+	}
+
+	/**
+		@brief Moves our storage to a snapshot and makes it the source of the others
+
+		Called on destruction, so the content lives on without being copied. Only a snapshot starting at our first
+		element can own the storage; if all of them are views further in, they get copies instead.
+	 */
+	void HandOffToSnapshots()
+	{
+		WaitForReadback();
+
+		auto it = std::find_if(m_cowSnapshots.begin(), m_cowSnapshots.end(),
+			[](AcceleratorBuffer<T>* snap) { return snap->m_cowOffset == 0; });
+		if(it == m_cowSnapshots.end())
+		{
+			DetachSnapshots();
+			return;
+		}
+
+		auto heir = *it;
+		m_cowSnapshots.erase(it);
+		std::vector<AcceleratorBuffer<T>*> others;
+		others.swap(m_cowSnapshots);
+
+		//The budget manager knows us by address, so the registration has to be redone for the heir
+		bool budgeted = (m_budgetEntry != nullptr);
+		UnregisterFromBudget();
+
+		heir->m_cowSource = nullptr;
+		heir->m_cpuMemoryType = m_cpuMemoryType;
+		heir->m_gpuMemoryType = m_gpuMemoryType;
+		heir->m_cpuPtr = m_cpuPtr;
+		heir->m_cpuPhysMem = std::move(m_cpuPhysMem);
+		heir->m_gpuPhysMem = std::move(m_gpuPhysMem);
+		heir->m_cpuBuffer = std::move(m_cpuBuffer);
+		heir->m_gpuBuffer = std::move(m_gpuBuffer);
+		heir->m_buffersAreSame = m_buffersAreSame;
+		heir->m_cpuPhysMemIsStale = m_cpuPhysMemIsStale;
+		heir->m_gpuPhysMemIsStale = m_gpuPhysMemIsStale;
+		#ifndef _WIN32
+			heir->m_tempFileHandle = m_tempFileHandle;
+			m_tempFileHandle = 0;
+		#endif
+		heir->m_capacity = m_capacity;
+
+		m_cpuMemoryType = MEM_TYPE_NULL;
+		m_gpuMemoryType = MEM_TYPE_NULL;
+		m_cpuPtr = nullptr;
+		m_buffersAreSame = false;
+		m_capacity = 0;
+		m_size = 0;
+
+		if(budgeted && g_gpuMemoryBudget && heir->m_gpuPhysMem)
+		{
+			heir->m_budgetEntry = g_gpuMemoryBudget->Register(
+				heir, &AcceleratorBuffer<T>::EvictFromBudget, heir->m_gpuPhysMem->GetSize());
+		}
+		if(g_hasDebugUtils)
+		{
+			if(heir->m_gpuBuffer != nullptr)
+				heir->UpdateGpuNames();
+			if(heir->m_cpuBuffer != nullptr)
+				heir->UpdateCpuNames();
+		}
+		heir->UpdateRegistry(true);
+
+		for(auto snap : others)
+		{
+			snap->m_cowSource = heir;
+			heir->m_cowSnapshots.push_back(snap);
+		}
+	}
+
 	/**
 		@brief Reallocates the buffer so that it contains exactly size elements
 	 */
@@ -603,6 +1008,12 @@ protected:
 		if(size == 0)
 			return;
 
+		//Don't move buffers out from under snapshots
+		BreakSharing();
+
+		//Don't move buffers out from under a readback
+		WaitForReadback();
+
 		/*
 			If we are a bool[] or similar one-byte type, we are likely going to be accessed from the GPU via a uint32
 			descriptor for at least some shaders (such as rendering).
@@ -707,16 +1118,16 @@ protected:
 					//Allocation successful!
 					if(AllocateGpuBuffer(size))
 					{
-						std::lock_guard<std::mutex> lock(g_vkTransferMutex);
+						std::lock_guard<std::mutex> lock(g_vkDmaMutex);
 
 						//Make the transfer request
-						g_vkTransferCommandBuffer->begin({});
+						g_vkDmaCommandBuffer->begin({});
 						vk::BufferCopy region(0, 0, m_size * sizeof(T));
-						g_vkTransferCommandBuffer->copyBuffer(**bOld, **m_gpuBuffer, {region});
-						g_vkTransferCommandBuffer->end();
+						g_vkDmaCommandBuffer->copyBuffer(**bOld, **m_gpuBuffer, {region});
+						g_vkDmaCommandBuffer->end();
 
 						//Submit the request and block until it completes
-						g_vkTransferQueue->SubmitAndBlock(*g_vkTransferCommandBuffer);
+						g_vkDmaQueue->SubmitAndBlock(*g_vkDmaCommandBuffer);
 
 						//make sure buffer is freed before underlying physical memory (pOld) goes out of scope
 						bOld = nullptr;
@@ -784,6 +1195,19 @@ protected:
 		m_buffersAreSame =
 			( (m_cpuMemoryType == MEM_TYPE_CPU_DMA_CAPABLE) && (m_gpuMemoryType == MEM_TYPE_NULL) ) ||
 			( (m_cpuMemoryType == MEM_TYPE_NULL) && (m_gpuMemoryType == MEM_TYPE_GPU_DMA_CAPABLE) );
+
+		UpdateRegistry(true);
+	}
+
+	/**
+		@brief Reports our current allocations to the AcceleratorBufferRegistry
+
+		@param reallocated	True if called because the buffer was resized
+	 */
+	void UpdateRegistry(bool reallocated = false)
+	{
+		AcceleratorBufferRegistry::GetInstance().Update(
+			this, GetCpuMemoryBytes(), GetGpuMemoryBytes(), m_cpuMemoryType, m_gpuMemoryType, reallocated);
 	}
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -872,6 +1296,8 @@ public:
 			return;
 		}
 
+		BreakSharing();
+
 		//Don't touch GPU side buffer
 
 		PrepareForCpuAccess();
@@ -892,6 +1318,41 @@ public:
 		MarkModifiedFromCpu();
 	}
 
+	/**
+		@brief Removes the first several items in the container
+
+		Costs the same single move as removing one item, so trimming in batches is much cheaper than calling
+		pop_front() repeatedly.
+
+		@param count	Number of items to remove
+	 */
+	void pop_front(size_t count)
+	{
+		if(count >= m_size)
+		{
+			clear();
+			return;
+		}
+		if(count == 0)
+			return;
+
+		BreakSharing();
+		PrepareForCpuAccess();
+
+		size_t nkeep = m_size - count;
+		if(!std::is_trivially_copyable<T>::value)
+		{
+			for(size_t i=0; i<nkeep; i++)
+				m_cpuPtr[i] = std::move(m_cpuPtr[i+count]);
+		}
+		else
+			memmove(m_cpuPtr, m_cpuPtr+count, sizeof(T) * nkeep);
+
+		resize(nkeep);
+
+		MarkModifiedFromCpu();
+	}
+
 	AcceleratorBufferIterator<T> begin()
 	{ return AcceleratorBufferIterator<T>(*this, 0); }
 
@@ -911,6 +1372,9 @@ public:
 	 */
 	void SetCpuAccessHint(UsageHint hint, bool reallocateImmediately = false)
 	{
+		//A snapshot keeps the settings it was shared with until it gets storage of its own
+		if(m_cowSource && (m_cpuAccessHint != hint))
+			Unshare();
 		m_cpuAccessHint = hint;
 
 		if(reallocateImmediately && (m_size != 0))
@@ -929,12 +1393,75 @@ public:
 		if(!std::is_trivially_copyable<T>::value)
 			hint = HINT_NEVER;
 
+		//A snapshot keeps the settings it was shared with until it gets storage of its own
+		if(m_cowSource && (m_gpuAccessHint != hint))
+			Unshare();
 		m_gpuAccessHint = hint;
 
 		if(reallocateImmediately && (m_size != 0))
 			Reallocate(m_size);
 	}
 
+	/**
+		@brief Sets the NUMA node that host-only memory for this buffer should be placed on
+
+		By default pages land on whichever node first touches them, which is the right thing when the thread that
+		fills a buffer is also the one that processes it. Drivers whose download thread runs on a different node
+		than the filters consuming the data can use this to place the samples next to the consumers instead.
+
+		This only affects MEM_TYPE_CPU_ONLY allocations; pinned memory comes from a shared arena and is left alone.
+		Has no effect on hosts with a single node.
+
+		If reallocateImmediately is set, the buffer is reallocated with the specified settings to fit the current
+		buffer size (shrinking to fit if needed)
+
+		@param node	Node number, or -1 to go back to first-touch placement
+	 */
+	void SetCpuNode(int node, bool reallocateImmediately = false)
+	{
+		//A snapshot keeps the settings it was shared with until it gets storage of its own
+		if(m_cowSource && (m_cpuNode != node))
+			Unshare();
+		m_cpuNode = node;
+
+		if(reallocateImmediately && (m_size != 0))
+			Reallocate(m_size);
+	}
+
+	/**
+		@brief Sets whether host-only memory for this buffer should be backed by huge pages
+
+		Huge pages cut TLB misses when streaming through large buffers, at the cost of rounding the allocation up to
+		a whole number of 2 MB pages. The default only uses them above AlignedAllocator::HUGE_PAGE_THRESHOLD. This
+		only affects MEM_TYPE_CPU_ONLY allocations.
+
+		If reallocateImmediately is set, the buffer is reallocated with the specified settings to fit the current
+		buffer size (shrinking to fit if needed)
+	 */
+	void SetHugePagePolicy(HugePagePolicy policy, bool reallocateImmediately = false)
+	{
+		//A snapshot keeps the settings it was shared with until it gets storage of its own
+		if(m_cowSource && (m_hugePagePolicy != policy))
+			Unshare();
+		m_hugePagePolicy = policy;
+
+		if(reallocateImmediately && (m_size != 0))
+			Reallocate(m_size);
+	}
+
+	/**
+		@brief Gets the NUMA node the CPU-side buffer currently lives on, or -1 if unknown or not a NUMA host
+
+		Looks at the first page of the buffer, so this is a system call: cache the result rather than calling it
+		per sample.
+	 */
+	int GetCpuNode() const
+	{
+		if(m_cpuPtr == nullptr)
+			return -1;
+		return NumaTopology::GetNodeOfAddress(m_cpuPtr);
+	}
+
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Cache invalidation
 
@@ -945,6 +1472,7 @@ public:
 	 */
 	void MarkModifiedFromCpu()
 	{
+		BreakSharing();
 		if(!m_buffersAreSame)
 			m_gpuPhysMemIsStale = true;
 	}
@@ -956,6 +1484,7 @@ public:
 	 */
 	void MarkModifiedFromGpu()
 	{
+		BreakSharing();
 		if(!m_buffersAreSame)
 			m_cpuPhysMemIsStale = true;
 	}
@@ -970,6 +1499,16 @@ public:
 	 */
 	void PrepareForCpuAccess()
 	{
+		if(m_cowSource)
+		{
+			m_cowSource->PrepareForCpuAccess();
+			SyncWithSource();
+			return;
+		}
+
+		ResolveDeviceLength();
+		WaitForReadback();
+
 		//Early out if no content
 		if(m_size == 0)
 			return;
@@ -990,6 +1529,11 @@ public:
 	 */
 	void PrepareForCpuAccessIgnoringGpuData()
 	{
+		ResolveDeviceLength();
+		BreakSharingForOverwrite();
+
+		WaitForReadback();
+
 		//Early out if no content
 		if(m_size == 0)
 			return;
@@ -1011,6 +1555,15 @@ public:
 	 */
 	void PrepareForCpuAccessNonblocking(vk::raii::CommandBuffer& cmdBuf, bool skipBarrier = false)
 	{
+		if(m_cowSource)
+		{
+			m_cowSource->PrepareForCpuAccessNonblocking(cmdBuf, skipBarrier);
+			SyncWithSource();
+			return;
+		}
+
+		WaitForReadback();
+
 		//Early out if no content
 		if(m_size == 0)
 			return;
@@ -1023,6 +1576,43 @@ public:
 			CopyToCpuNonblocking(cmdBuf, skipBarrier);
 	}
 
+	/**
+		@brief Starts bringing the CPU-side buffer up to date, without waiting for the copy to complete
+
+		Unlike PrepareForCpuAccessNonblocking(), the copy is recorded on a command buffer of its own and submitted
+		right away, so the caller can get on with something else until the returned future is ready. m_cpuPtr must
+		not be read until then, or until PrepareForCpuAccess() has been called (which waits for the copy).
+
+		If a QueueSubmitScope is active, the copy waits on the GPU for everything the scope depends on, so the
+		kernels producing the data need not have completed yet. If the size is still to be read back from a
+		DeviceLength, the whole capacity is copied rather than waiting for the count.
+
+		@return Future which becomes ready once the CPU-side buffer is up to date
+	 */
+	ReadbackFuture PrepareForCpuAccessAsync()
+	{
+		if(m_cowSource)
+		{
+			auto ret = m_cowSource->PrepareForCpuAccessAsync();
+			SyncWithSource();
+			return ret;
+		}
+
+		size_t count = m_deviceLength ? m_capacity : m_size;
+
+		//Early out if no content
+		if(count == 0)
+			return ReadbackFuture();
+
+		//If there's no buffer at all on the CPU, allocate one
+		if(!HasCpuBuffer() && (m_gpuMemoryType != MEM_TYPE_GPU_DMA_CAPABLE))
+			AllocateCpuBuffer(m_capacity);
+
+		if(m_cpuPhysMemIsStale)
+			CopyToCpuAsync(count);
+		return m_pendingReadback;
+	}
+
 	/**
 		@brief Prepares the buffer to be accessed from the GPU
 
@@ -1033,10 +1623,34 @@ public:
 	 */
 	void PrepareForGpuAccess(bool outputOnly = false)
 	{
-		//Early out if no content or if unified memory
-		if(m_size == 0 || g_vulkanDeviceHasUnifiedMemory)
+		if(outputOnly)
+			BreakSharingForOverwrite();
+		else if(m_cowSource)
+		{
+			m_cowSource->PrepareForGpuAccess();
+
+			//On unified memory the source may reallocate, handing us a copy of our own in the process
+			if(m_cowSource)
+			{
+				SyncWithSource();
+				return;
+			}
+		}
+
+		//Early out if no content
+		if(m_size == 0)
 			return;
 
+		//With unified memory the pinned buffer is the GPU buffer, so there's never anything to copy.
+		//Buffers not expected to be used on the GPU live in ordinary host memory, though, so move them into
+		//the shared arena the first time the GPU does touch them
+		if(g_vulkanDeviceHasUnifiedMemory)
+		{
+			if(std::is_trivially_copyable<T>::value && (m_cpuMemoryType != MEM_TYPE_CPU_DMA_CAPABLE))
+				SetGpuAccessHint(HINT_UNLIKELY, true);
+			return;
+		}
+
 		//If our current hint has no GPU access at all, update to say "unlikely" and reallocate
 		if(m_gpuAccessHint == HINT_NEVER)
 			SetGpuAccessHint(HINT_UNLIKELY, true);
@@ -1048,6 +1662,10 @@ public:
 				return;
 		}
 
+		//Keep the budget manager from evicting buffers which are still in use
+		if(m_budgetEntry && g_gpuMemoryBudget)
+			g_gpuMemoryBudget->Touch(m_budgetEntry);
+
 		//Make sure the GPU-side buffer is up to date
 		if(m_gpuPhysMemIsStale && !outputOnly)
 			CopyToGpu();
@@ -1063,10 +1681,34 @@ public:
 	 */
 	void PrepareForGpuAccessNonblocking(bool outputOnly, vk::raii::CommandBuffer& cmdBuf)
 	{
-		//Early out if no content or if unified memory
-		if(m_size == 0 || g_vulkanDeviceHasUnifiedMemory)
+		if(outputOnly)
+			BreakSharingForOverwrite();
+		else if(m_cowSource)
+		{
+			m_cowSource->PrepareForGpuAccessNonblocking(false, cmdBuf);
+
+			//On unified memory the source may reallocate, handing us a copy of our own in the process
+			if(m_cowSource)
+			{
+				SyncWithSource();
+				return;
+			}
+		}
+
+		//Early out if no content
+		if(m_size == 0)
 			return;
 
+		//With unified memory the pinned buffer is the GPU buffer, so there's never anything to copy.
+		//Buffers not expected to be used on the GPU live in ordinary host memory, though, so move them into
+		//the shared arena the first time the GPU does touch them
+		if(g_vulkanDeviceHasUnifiedMemory)
+		{
+			if(std::is_trivially_copyable<T>::value && (m_cpuMemoryType != MEM_TYPE_CPU_DMA_CAPABLE))
+				SetGpuAccessHint(HINT_UNLIKELY, true);
+			return;
+		}
+
 		//If our current hint has no GPU access at all, update to say "unlikely" and reallocate
 		if(m_gpuAccessHint == HINT_NEVER)
 			SetGpuAccessHint(HINT_UNLIKELY, true);
@@ -1078,6 +1720,10 @@ public:
 				return;
 		}
 
+		//Keep the budget manager from evicting buffers which are still in use
+		if(m_budgetEntry && g_gpuMemoryBudget)
+			g_gpuMemoryBudget->Touch(m_budgetEntry);
+
 		//Make sure the GPU-side buffer is up to date
 		if(m_gpuPhysMemIsStale && !outputOnly)
 			CopyToGpuNonblocking(cmdBuf);
@@ -1095,18 +1741,19 @@ protected:
 	{
 		assert(std::is_trivially_copyable<T>::value);
 
-		std::lock_guard<std::mutex> lock(g_vkTransferMutex);
+		std::lock_guard<std::mutex> lock(g_vkDmaMutex);
 
 		//Make the transfer request
-		g_vkTransferCommandBuffer->begin({});
+		g_vkDmaCommandBuffer->begin({});
 		vk::BufferCopy region(0, 0, m_size * sizeof(T));
-		g_vkTransferCommandBuffer->copyBuffer(**m_gpuBuffer, **m_cpuBuffer, {region});
-		g_vkTransferCommandBuffer->end();
+		g_vkDmaCommandBuffer->copyBuffer(**m_gpuBuffer, **m_cpuBuffer, {region});
+		g_vkDmaCommandBuffer->end();
 
 		//Submit the request and block until it completes
-		g_vkTransferQueue->SubmitAndBlock(*g_vkTransferCommandBuffer);
+		g_vkDmaQueue->SubmitAndBlock(*g_vkDmaCommandBuffer);
 
 		m_cpuPhysMemIsStale = false;
+		PerformanceCounters::GetThreadCounters().m_readbackBytes += m_size * sizeof(T);
 	}
 
 	/**
@@ -1136,6 +1783,26 @@ protected:
 		cmdBuf.copyBuffer(**m_gpuBuffer, **m_cpuBuffer, {region});
 
 		m_cpuPhysMemIsStale = false;
+		PerformanceCounters::GetThreadCounters().m_readbackBytes += m_size * sizeof(T);
+	}
+
+	/**
+		@brief Copy the first count elements of the buffer from GPU to CPU, without waiting for the transfer
+
+		@param count	Number of elements to copy
+	 */
+	void CopyToCpuAsync(size_t count)
+	{
+		assert(std::is_trivially_copyable<T>::value);
+
+		m_pendingReadback = ReadbackFuture::Submit([&](vk::raii::CommandBuffer& cmdBuf)
+			{
+				vk::BufferCopy region(0, 0, count * sizeof(T));
+				cmdBuf.copyBuffer(**m_gpuBuffer, **m_cpuBuffer, {region});
+			});
+
+		m_cpuPhysMemIsStale = false;
+		PerformanceCounters::GetThreadCounters().m_readbackBytes += count * sizeof(T);
 	}
 
 	/**
@@ -1145,18 +1812,19 @@ protected:
 	{
 		assert(std::is_trivially_copyable<T>::value);
 
-		std::lock_guard<std::mutex> lock(g_vkTransferMutex);
+		std::lock_guard<std::mutex> lock(g_vkDmaMutex);
 
 		//Make the transfer request
-		g_vkTransferCommandBuffer->begin({});
+		g_vkDmaCommandBuffer->begin({});
 		vk::BufferCopy region(0, 0, m_size * sizeof(T));
-		g_vkTransferCommandBuffer->copyBuffer(**m_cpuBuffer, **m_gpuBuffer, {region});
-		g_vkTransferCommandBuffer->end();
+		g_vkDmaCommandBuffer->copyBuffer(**m_cpuBuffer, **m_gpuBuffer, {region});
+		g_vkDmaCommandBuffer->end();
 
 		//Submit the request and block until it completes
-		g_vkTransferQueue->SubmitAndBlock(*g_vkTransferCommandBuffer);
+		g_vkDmaQueue->SubmitAndBlock(*g_vkDmaCommandBuffer);
 
 		m_gpuPhysMemIsStale = false;
+		PerformanceCounters::GetThreadCounters().m_uploadBytes += m_size * sizeof(T);
 	}
 
 
@@ -1185,6 +1853,7 @@ protected:
 			{});
 
 		m_gpuPhysMemIsStale = false;
+		PerformanceCounters::GetThreadCounters().m_uploadBytes += m_size * sizeof(T);
 	}
 public:
 	/**
@@ -1214,10 +1883,16 @@ protected:
 	 */
 	void FreeCpuBuffer()
 	{
+		//m_cpuPtr of a snapshot is not ours to free, and snapshots of us need it
+		BreakSharing();
+
 		//Early out if buffer is already null
 		if(m_cpuPtr == nullptr)
 			return;
 
+		//Can't free memory a readback is still writing to
+		WaitForReadback();
+
 		//We have a buffer on the GPU.
 		//If it's stale, need to push our updated content there before freeing the CPU-side copy
 		if( (m_gpuMemoryType != MEM_TYPE_NULL) && m_gpuPhysMemIsStale && !empty())
@@ -1240,7 +1915,10 @@ protected:
 		{
 			m_size = 0;
 			m_capacity = 0;
+			m_deviceLength = nullptr;
 		}
+
+		UpdateRegistry();
 	}
 
 public:
@@ -1252,10 +1930,18 @@ public:
 	 */
 	void FreeGpuBuffer(bool dataLossOK = false)
 	{
+		DetachSnapshots();
+
+		//Unregister first, so the budget manager can't evict us while we're freeing
+		UnregisterFromBudget();
+
 		//Early out if buffer is already null
 		if(m_gpuPhysMem == nullptr)
 			return;
 
+		//Can't free memory a readback is still reading from
+		WaitForReadback();
+
 		//If we do NOT have a CPU-side buffer, we're deleting all of our data! Warn for now
 		if( (m_cpuMemoryType == MEM_TYPE_NULL) && m_gpuPhysMemIsStale && !empty() && !dataLossOK)
 		{
@@ -1269,13 +1955,81 @@ public:
 		m_gpuBuffer = nullptr;
 		m_gpuPhysMem = nullptr;
 		m_gpuMemoryType = MEM_TYPE_NULL;
+
+		UpdateRegistry();
+	}
+
+	/**
+		@brief Frees the GPU-side buffer on behalf of g_gpuMemoryBudget, if the data can be recovered from the CPU
+
+		Called with the budget manager's lock held, after it has already removed our registration.
+
+		@return True if the buffer was freed
+	 */
+	__attribute__((noinline))
+	bool EvictGpuBuffer()
+	{
+		if( (m_gpuMemoryType != MEM_TYPE_GPU_ONLY) || m_buffersAreSame )
+			return false;
+
+		//Never discard the only copy of our data. If the CPU copy is out of date, bring it up to date first
+		if(!empty())
+		{
+			if(m_cpuPtr == nullptr)
+				return false;
+			if(m_cpuPhysMemIsStale)
+				CopyToCpu();
+			m_gpuPhysMemIsStale = true;
+		}
+
+		m_budgetEntry = nullptr;
+		m_gpuBuffer = nullptr;
+		m_gpuPhysMem = nullptr;
+		m_gpuMemoryType = MEM_TYPE_NULL;
+
+		UpdateRegistry();
+		return true;
+	}
+
+	///@brief Removes our registration with g_gpuMemoryBudget, if any
+	void UnregisterFromBudget()
+	{
+		if(m_budgetEntry)
+		{
+			if(g_gpuMemoryBudget)
+				g_gpuMemoryBudget->Unregister(this);
+			m_budgetEntry = nullptr;
+		}
 	}
 
+	///@brief GpuMemoryBudget::EvictFunction for this buffer type
+	static bool EvictFromBudget(void* buffer)
+	{ return static_cast<AcceleratorBuffer<T>*>(buffer)->EvictGpuBuffer(); }
+
 protected:
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Allocation
 
+	/**
+		@brief Allocates normal (not pinned) host memory according to the huge page policy
+	 */
+	T* AllocateHostMemory(size_t size)
+	{
+		switch(m_hugePagePolicy)
+		{
+			case HUGE_PAGES_NEVER:
+				return m_cpuAllocator.allocate(size, false);
+
+			case HUGE_PAGES_ALWAYS:
+				return m_cpuAllocator.allocate(size, true);
+
+			case HUGE_PAGES_AUTO:
+			default:
+				return m_cpuAllocator.allocate(size);
+		}
+	}
+
 	/**
 		@brief Allocates a buffer for CPU access
 	 */
@@ -1294,20 +2048,20 @@ protected:
 				size * sizeof(T),
 				vk::BufferUsageFlagBits::eTransferSrc |
 					vk::BufferUsageFlagBits::eTransferDst |
-					vk::BufferUsageFlagBits::eStorageBuffer);
+					vk::BufferUsageFlagBits::eStorageBuffer |
+					vk::BufferUsageFlagBits::eIndirectBuffer);
 			m_cpuBuffer = std::make_unique<vk::raii::Buffer>(*g_vkComputeDevice, bufinfo);
 
 			//Figure out actual memory requirements of the buffer
 			//(may be rounded up from what we asked for)
 			auto req = m_cpuBuffer->getMemoryRequirements();
 
-			//Allocate the physical memory to back the buffer
-			vk::MemoryAllocateInfo info(req.size, g_vkPinnedMemoryType);
-			m_cpuPhysMem = std::make_unique<vk::raii::DeviceMemory>(*g_vkComputeDevice, info);
+			//Allocate the physical memory to back the buffer (the arena keeps it persistently mapped)
+			m_cpuPhysMem = g_vkPinnedMemoryArena->Allocate(req);
 
-			//Map it and bind to the buffer
-			m_cpuPtr = reinterpret_cast<T*>(m_cpuPhysMem->mapMemory(0, req.size));
-			m_cpuBuffer->bindMemory(**m_cpuPhysMem, 0);
+			//Bind to the buffer
+			m_cpuPtr = reinterpret_cast<T*>(m_cpuPhysMem->GetMappedPointer());
+			m_cpuBuffer->bindMemory(m_cpuPhysMem->GetMemory(), m_cpuPhysMem->GetOffset());
 
 			//We now have pinned memory
 			m_cpuMemoryType = MEM_TYPE_CPU_DMA_CAPABLE;
@@ -1321,7 +2075,11 @@ protected:
 		{
 			m_cpuBuffer = nullptr;
 			m_cpuMemoryType = MEM_TYPE_CPU_ONLY;
-			m_cpuPtr = m_cpuAllocator.allocate(size);
+			m_cpuPtr = AllocateHostMemory(size);
+
+			//Fresh pages get faulted in on that node, recycled heap pages are migrated there
+			if(m_cpuNode >= 0)
+				NumaTopology::BindMemory(m_cpuPtr, size * sizeof(T), m_cpuNode);
 		}
 
 		//If infrequent CPU access is expected, use a memory mapped temporary file so it can be paged out to disk
@@ -1387,6 +2145,8 @@ protected:
 			for(size_t i=0; i<size; i++)
 				new(m_cpuPtr +i) T;
 		}
+
+		UpdateRegistry();
 	}
 
 	/**
@@ -1413,7 +2173,7 @@ protected:
 				break;
 
 			case MEM_TYPE_CPU_DMA_CAPABLE:
-				LogFatal("FreeCpuPointer for MEM_TYPE_CPU_DMA_CAPABLE requires the vk::raii::DeviceMemory\n");
+				LogFatal("FreeCpuPointer for MEM_TYPE_CPU_DMA_CAPABLE requires the DeviceMemoryAllocation\n");
 				break;
 
 			case MEM_TYPE_CPU_PAGED:
@@ -1441,12 +2201,13 @@ protected:
 		not the one we're getting rid of.
 	 */
 	__attribute__((noinline))
-	void FreeCpuPointer(T* ptr, std::unique_ptr<vk::raii::DeviceMemory>& buf, MemoryType type, size_t size)
+	void FreeCpuPointer(T* ptr, std::unique_ptr<DeviceMemoryAllocation>& buf, MemoryType type, size_t size)
 	{
 		switch(type)
 		{
+			//Arena blocks stay mapped, the range is returned to the arena when buf is destroyed
 			case MEM_TYPE_CPU_DMA_CAPABLE:
-				buf->unmapMemory();
+				buf = nullptr;
 				break;
 
 			default:
@@ -1470,7 +2231,8 @@ protected:
 			size * sizeof(T),
 			vk::BufferUsageFlagBits::eTransferSrc |
 				vk::BufferUsageFlagBits::eTransferDst |
-				vk::BufferUsageFlagBits::eStorageBuffer);
+				vk::BufferUsageFlagBits::eStorageBuffer |
+				vk::BufferUsageFlagBits::eIndirectBuffer);
 		m_gpuBuffer = std::make_unique<vk::raii::Buffer>(*g_vkComputeDevice, bufinfo);
 
 		//Figure out actual memory requirements of the buffer
@@ -1478,11 +2240,10 @@ protected:
 		auto req = m_gpuBuffer->getMemoryRequirements();
 
 		//Try to allocate the memory
-		vk::MemoryAllocateInfo info(req.size, g_vkLocalMemoryType);
 		try
 		{
 			//For now, always use local memory
-			m_gpuPhysMem = std::make_unique<vk::raii::DeviceMemory>(*g_vkComputeDevice, info);
+			m_gpuPhysMem = g_vkLocalMemoryArena->Allocate(req);
 		}
 
 		//Fallback path in case of low memory
@@ -1498,7 +2259,7 @@ protected:
 				///Retry the allocation
 				try
 				{
-					m_gpuPhysMem = std::make_unique<vk::raii::DeviceMemory>(*g_vkComputeDevice, info);
+					m_gpuPhysMem = g_vkLocalMemoryArena->Allocate(req);
 					ok = true;
 				}
 				catch(vk::OutOfDeviceMemoryError& ex2)
@@ -1515,7 +2276,7 @@ protected:
 				LogDebug("Final retry\n");
 				try
 				{
-					m_gpuPhysMem = std::make_unique<vk::raii::DeviceMemory>(*g_vkComputeDevice, info);
+					m_gpuPhysMem = g_vkLocalMemoryArena->Allocate(req);
 					ok = true;
 				}
 				catch(vk::OutOfDeviceMemoryError& ex2)
@@ -1531,6 +2292,7 @@ protected:
 				LogError(
 					"Failed to allocate %s of GPU memory despite our best efforts to reclaim space, falling back to CPU-side pinned allocation\n",
 					Unit(Unit::UNIT_BYTES).PrettyPrint(req.size, 4).c_str());
+				UnregisterFromBudget();
 				m_gpuMemoryType = MEM_TYPE_NULL;
 				m_gpuPhysMem = nullptr;
 				m_gpuBuffer = nullptr;
@@ -1539,11 +2301,16 @@ protected:
 		}
 		m_gpuMemoryType = MEM_TYPE_GPU_ONLY;
 
-		m_gpuBuffer->bindMemory(**m_gpuPhysMem, 0);
+		m_gpuBuffer->bindMemory(m_gpuPhysMem->GetMemory(), m_gpuPhysMem->GetOffset());
+
+		//Let the budget manager evict us if we go unused while VRAM is tight
+		if(g_gpuMemoryBudget)
+			m_budgetEntry = g_gpuMemoryBudget->Register(this, &AcceleratorBuffer<T>::EvictFromBudget, req.size);
 
 		if(g_hasDebugUtils)
 			UpdateGpuNames();
 
+		UpdateRegistry();
 		return true;
 	}
 
@@ -1572,11 +2339,15 @@ protected:
 				reinterpret_cast<uint64_t>(static_cast<VkBuffer>(**m_gpuBuffer)),
 				gpuBufName.c_str()));
 
-		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
-			vk::DebugUtilsObjectNameInfoEXT(
-				vk::ObjectType::eDeviceMemory,
-				reinterpret_cast<uint64_t>(static_cast<VkDeviceMemory>(**m_gpuPhysMem)),
-				gpuPhysName.c_str()));
+		//Shared arena blocks are named by the arena, only dedicated ones are ours to name
+		if(m_gpuPhysMem->IsDedicated())
+		{
+			g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+				vk::DebugUtilsObjectNameInfoEXT(
+					vk::ObjectType::eDeviceMemory,
+					reinterpret_cast<uint64_t>(static_cast<VkDeviceMemory>(m_gpuPhysMem->GetMemory())),
+					gpuPhysName.c_str()));
+		}
 	}
 
 	/**
@@ -1599,11 +2370,15 @@ protected:
 				reinterpret_cast<uint64_t>(static_cast<VkBuffer>(**m_cpuBuffer)),
 				cpuBufName.c_str()));
 
-		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
-			vk::DebugUtilsObjectNameInfoEXT(
-				vk::ObjectType::eDeviceMemory,
-				reinterpret_cast<uint64_t>(static_cast<VkDeviceMemory>(**m_cpuPhysMem)),
-				cpuPhysName.c_str()));
+		//Shared arena blocks are named by the arena, only dedicated ones are ours to name
+		if(m_cpuPhysMem->IsDedicated())
+		{
+			g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+				vk::DebugUtilsObjectNameInfoEXT(
+					vk::ObjectType::eDeviceMemory,
+					reinterpret_cast<uint64_t>(static_cast<VkDeviceMemory>(m_cpuPhysMem->GetMemory())),
+					cpuPhysName.c_str()));
+		}
 	}
 
 public:
@@ -1619,6 +2394,7 @@ public:
 	void SetName(std::string name)
 	{
 		m_name = name;
+		AcceleratorBufferRegistry::GetInstance().Rename(this, m_name);
 		if(g_hasDebugUtils)
 		{
 			if(m_gpuBuffer != nullptr)
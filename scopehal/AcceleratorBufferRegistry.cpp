@@ -0,0 +1,350 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of AcceleratorBufferRegistry
+	@ingroup vksupport
+ */
+
+#include "scopehal.h"
+#include <algorithm>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+AcceleratorBufferRegistry::AcceleratorBufferRegistry()
+	: m_stormThreshold(8)
+{
+}
+
+/**
+	@brief Gets the process-wide registry
+
+	Created on first use, since buffers may be constructed during static initialization.
+ */
+AcceleratorBufferRegistry& AcceleratorBufferRegistry::GetInstance()
+{
+	static AcceleratorBufferRegistry registry;
+	return registry;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Registration
+
+/**
+	@brief Adds a newly constructed buffer, attributed to the owner active on the calling thread
+ */
+void AcceleratorBufferRegistry::Register(void* buffer, const string& name)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	auto& entry = m_entries[buffer];
+	entry = Entry();
+	entry.m_name = name;
+	entry.m_owner = GpuMemoryBudget::OwnerScope::GetCurrentOwner();
+	Charge(entry, true);
+}
+
+/**
+	@brief Removes a buffer which is being destroyed
+ */
+void AcceleratorBufferRegistry::Unregister(void* buffer)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	auto it = m_entries.find(buffer);
+	if(it == m_entries.end())
+		return;
+	Charge(it->second, false);
+	m_entries.erase(it);
+}
+
+/**
+	@brief Updates the name of a buffer
+ */
+void AcceleratorBufferRegistry::Rename(void* buffer, const string& name)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	auto it = m_entries.find(buffer);
+	if(it != m_entries.end())
+		it->second.m_name = name;
+}
+
+/**
+	@brief Records a change to a buffer's allocations
+
+	@param buffer			The buffer
+	@param cpuBytes			CPU memory now allocated
+	@param gpuBytes			GPU memory now allocated
+	@param cpuMemoryType	AcceleratorBuffer::MemoryType of the CPU side
+	@param gpuMemoryType	AcceleratorBuffer::MemoryType of the GPU side
+	@param reallocated		True if the buffer was resized, rather than just gaining or losing one side
+ */
+void AcceleratorBufferRegistry::Update(
+	void* buffer,
+	size_t cpuBytes,
+	size_t gpuBytes,
+	int cpuMemoryType,
+	int gpuMemoryType,
+	bool reallocated)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	auto it = m_entries.find(buffer);
+	if(it == m_entries.end())
+		return;
+	auto& entry = it->second;
+
+	Charge(entry, false);
+	entry.m_cpuBytes = cpuBytes;
+	entry.m_gpuBytes = gpuBytes;
+	entry.m_cpuMemoryType = cpuMemoryType;
+	entry.m_gpuMemoryType = gpuMemoryType;
+	if(reallocated)
+	{
+		//Whoever resized the buffer is now responsible for it
+		auto& owner = GpuMemoryBudget::OwnerScope::GetCurrentOwner();
+		if(!owner.empty())
+			entry.m_owner = owner;
+
+		entry.m_reallocations ++;
+		m_usage[entry.m_owner].m_reallocations ++;
+		PerformanceCounters::GetThreadCounters().m_reallocations ++;
+	}
+	Charge(entry, true);
+}
+
+/**
+	@brief Adds or removes a buffer's contribution to its owner's usage
+ */
+void AcceleratorBufferRegistry::Charge(const Entry& entry, bool add)
+{
+	auto& usage = m_usage[entry.m_owner];
+	if(add)
+	{
+		usage.m_bufferCount ++;
+		usage.m_cpuBytes += entry.m_cpuBytes;
+		usage.m_gpuBytes += entry.m_gpuBytes;
+	}
+	else
+	{
+		usage.m_bufferCount --;
+		usage.m_cpuBytes -= entry.m_cpuBytes;
+		usage.m_gpuBytes -= entry.m_gpuBytes;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reallocation storm detection
+
+/**
+	@brief Records one refresh of a filter, and how many buffer reallocations it caused
+
+	@param owner			Name of the filter
+	@param reallocations	Number of reallocations made during the refresh
+ */
+void AcceleratorBufferRegistry::RecordRefresh(const string& owner, uint64_t reallocations)
+{
+	if(owner.empty())
+		return;
+
+	lock_guard<mutex> lock(m_mutex);
+
+	auto& usage = m_usage[owner];
+	usage.m_refreshes ++;
+	if(reallocations == 0)
+	{
+		usage.m_consecutiveReallocatingRefreshes = 0;
+		usage.m_storm = false;
+		return;
+	}
+
+	usage.m_reallocatingRefreshes ++;
+	usage.m_consecutiveReallocatingRefreshes ++;
+	if(!usage.m_storm && (usage.m_consecutiveReallocatingRefreshes >= m_stormThreshold))
+	{
+		usage.m_storm = true;
+		LogWarning("%s reallocated buffers in each of its last %" PRIu64 " refreshes\n",
+			owner.c_str(), usage.m_consecutiveReallocatingRefreshes);
+	}
+}
+
+/**
+	@brief Gets the names of every owner currently in a reallocation storm
+ */
+vector<string> AcceleratorBufferRegistry::GetReallocationStorms()
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	vector<string> ret;
+	for(auto& it : m_usage)
+	{
+		if(it.second.m_storm)
+			ret.push_back(it.first);
+	}
+	return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Queries
+
+/**
+	@brief Gets a snapshot of every live buffer
+ */
+vector<AcceleratorBufferRegistry::Entry> AcceleratorBufferRegistry::GetBuffers()
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	vector<Entry> ret;
+	ret.reserve(m_entries.size());
+	for(auto& it : m_entries)
+		ret.push_back(it.second);
+	return ret;
+}
+
+/**
+	@brief Gets a snapshot of usage by owner
+
+	Buffers which have never been attributed to an owner are listed under an empty name.
+ */
+map<string, AcceleratorBufferRegistry::OwnerUsage> AcceleratorBufferRegistry::GetUsage()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_usage;
+}
+
+/**
+	@brief Gets a printable name for an AcceleratorBuffer::MemoryType
+ */
+const char* AcceleratorBufferRegistry::GetMemoryTypeName(int type)
+{
+	typedef AcceleratorBuffer<uint8_t> Buf;
+	switch(type)
+	{
+		case Buf::MEM_TYPE_NULL:
+			return "none";
+		case Buf::MEM_TYPE_CPU_PAGED:
+			return "cpu-paged";
+		case Buf::MEM_TYPE_CPU_ONLY:
+			return "cpu";
+		case Buf::MEM_TYPE_CPU_DMA_CAPABLE:
+			return "cpu-pinned";
+		case Buf::MEM_TYPE_GPU_ONLY:
+			return "gpu";
+		case Buf::MEM_TYPE_GPU_DMA_CAPABLE:
+			return "gpu-mappable";
+		default:
+			return "unknown";
+	}
+}
+
+/**
+	@brief Formats a human readable report of memory use by owner, followed by every live buffer, largest first
+ */
+string AcceleratorBufferRegistry::GetReport()
+{
+	auto usage = GetUsage();
+	auto buffers = GetBuffers();
+
+	Unit bytes(Unit::UNIT_BYTES);
+	string ret = "Memory use by owner:\n";
+	char tmp[512];
+
+	vector<pair<string, OwnerUsage>> owners(usage.begin(), usage.end());
+	sort(owners.begin(), owners.end(),
+		[](const pair<string, OwnerUsage>& a, const pair<string, OwnerUsage>& b)
+		{ return (a.second.m_cpuBytes + a.second.m_gpuBytes) > (b.second.m_cpuBytes + b.second.m_gpuBytes); });
+	for(auto& it : owners)
+	{
+		auto& u = it.second;
+		if( (u.m_bufferCount == 0) && (u.m_reallocations == 0) )
+			continue;
+
+		snprintf(tmp, sizeof(tmp),
+			"    %-40s %6zu buffers, CPU %10s, GPU %10s, %8" PRIu64 " reallocs, %" PRIu64 "/%" PRIu64
+			" refreshes reallocated%s\n",
+			it.first.empty() ? "(unowned)" : it.first.c_str(),
+			u.m_bufferCount,
+			bytes.PrettyPrint(u.m_cpuBytes, 4).c_str(),
+			bytes.PrettyPrint(u.m_gpuBytes, 4).c_str(),
+			u.m_reallocations,
+			u.m_reallocatingRefreshes,
+			u.m_refreshes,
+			u.m_storm ? " [REALLOCATION STORM]" : "");
+		ret += tmp;
+	}
+
+	sort(buffers.begin(), buffers.end(),
+		[](const Entry& a, const Entry& b)
+		{ return (a.m_cpuBytes + a.m_gpuBytes) > (b.m_cpuBytes + b.m_gpuBytes); });
+	ret += "\nLive buffers:\n";
+	for(auto& b : buffers)
+	{
+		if( (b.m_cpuBytes == 0) && (b.m_gpuBytes == 0) )
+			continue;
+
+		snprintf(tmp, sizeof(tmp), "    %-40s %-30s CPU %10s (%-10s) GPU %10s (%-12s) %" PRIu64 " reallocs\n",
+			b.m_name.empty() ? "(unnamed)" : b.m_name.c_str(),
+			b.m_owner.empty() ? "(unowned)" : b.m_owner.c_str(),
+			bytes.PrettyPrint(b.m_cpuBytes, 4).c_str(),
+			GetMemoryTypeName(b.m_cpuMemoryType),
+			bytes.PrettyPrint(b.m_gpuBytes, 4).c_str(),
+			GetMemoryTypeName(b.m_gpuMemoryType),
+			b.m_reallocations);
+		ret += tmp;
+	}
+
+	return ret;
+}
+
+/**
+	@brief Writes GetReport() to a file
+
+	@return True on success
+ */
+bool AcceleratorBufferRegistry::WriteReport(const string& path)
+{
+	FILE* fp = fopen(path.c_str(), "w");
+	if(!fp)
+	{
+		LogError("Failed to open memory report file %s\n", path.c_str());
+		return false;
+	}
+
+	auto report = GetReport();
+	fwrite(report.c_str(), 1, report.length(), fp);
+
+	bool ok = !ferror(fp);
+	fclose(fp);
+	return ok;
+}
@@ -0,0 +1,187 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of AcceleratorBufferRegistry
+	@ingroup vksupport
+ */
+
+#ifndef AcceleratorBufferRegistry_h
+#define AcceleratorBufferRegistry_h
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+	@brief Tracks every live AcceleratorBuffer, for attributing memory use to filters and instruments
+	@ingroup vksupport
+
+	Each buffer registers on construction and reports its CPU and GPU allocations whenever they change. Buffers are
+	attributed to the owner active on the calling thread (see GpuMemoryBudget::OwnerScope) when they are created or
+	reallocated, so a pooled waveform handed to a filter is charged to the filter which last resized it.
+
+	The FilterGraphExecutor reports how many reallocations each filter refresh caused. A filter which reallocates in
+	GetStormThreshold() or more consecutive refreshes is flagged as having a reallocation storm, usually meaning it
+	resizes its outputs from scratch every time instead of reusing them.
+ */
+class AcceleratorBufferRegistry
+{
+public:
+	AcceleratorBufferRegistry();
+
+	static AcceleratorBufferRegistry& GetInstance();
+
+	/**
+		@brief One live buffer
+	 */
+	class Entry
+	{
+	public:
+		Entry()
+		: m_cpuBytes(0)
+		, m_gpuBytes(0)
+		, m_cpuMemoryType(0)
+		, m_gpuMemoryType(0)
+		, m_reallocations(0)
+		{}
+
+		///@brief Debug name of the buffer
+		std::string m_name;
+
+		///@brief Owner the buffer is attributed to (empty if none)
+		std::string m_owner;
+
+		///@brief CPU memory currently allocated
+		size_t m_cpuBytes;
+
+		///@brief GPU memory currently allocated
+		size_t m_gpuBytes;
+
+		///@brief AcceleratorBuffer::MemoryType of the CPU side buffer
+		int m_cpuMemoryType;
+
+		///@brief AcceleratorBuffer::MemoryType of the GPU side buffer
+		int m_gpuMemoryType;
+
+		///@brief Number of times the buffer was reallocated
+		uint64_t m_reallocations;
+	};
+
+	/**
+		@brief Memory use and reallocation behavior of all buffers belonging to one owner
+	 */
+	class OwnerUsage
+	{
+	public:
+		OwnerUsage()
+		: m_bufferCount(0)
+		, m_cpuBytes(0)
+		, m_gpuBytes(0)
+		, m_reallocations(0)
+		, m_refreshes(0)
+		, m_reallocatingRefreshes(0)
+		, m_consecutiveReallocatingRefreshes(0)
+		, m_storm(false)
+		{}
+
+		///@brief Number of live buffers
+		size_t m_bufferCount;
+
+		///@brief Total CPU memory of live buffers
+		size_t m_cpuBytes;
+
+		///@brief Total GPU memory of live buffers
+		size_t m_gpuBytes;
+
+		///@brief Reallocations since startup (including of buffers since freed)
+		uint64_t m_reallocations;
+
+		///@brief Number of refreshes reported
+		uint64_t m_refreshes;
+
+		///@brief Number of refreshes which reallocated at least one buffer
+		uint64_t m_reallocatingRefreshes;
+
+		///@brief Length of the current run of refreshes which reallocated
+		uint64_t m_consecutiveReallocatingRefreshes;
+
+		///@brief True if the owner is currently in a reallocation storm
+		bool m_storm;
+	};
+
+	void Register(void* buffer, const std::string& name);
+	void Unregister(void* buffer);
+	void Rename(void* buffer, const std::string& name);
+	void Update(void* buffer, size_t cpuBytes, size_t gpuBytes, int cpuMemoryType, int gpuMemoryType, bool reallocated);
+
+	void RecordRefresh(const std::string& owner, uint64_t reallocations);
+
+	/**
+		@brief Sets how many consecutive reallocating refreshes make a reallocation storm
+
+		@param refreshes	Threshold, in refreshes
+	 */
+	void SetStormThreshold(uint64_t refreshes)
+	{ m_stormThreshold = refreshes; }
+
+	///@brief Gets how many consecutive reallocating refreshes make a reallocation storm
+	uint64_t GetStormThreshold()
+	{ return m_stormThreshold; }
+
+	std::vector<Entry> GetBuffers();
+	std::map<std::string, OwnerUsage> GetUsage();
+	std::vector<std::string> GetReallocationStorms();
+
+	std::string GetReport();
+	bool WriteReport(const std::string& path);
+
+	static const char* GetMemoryTypeName(int type);
+
+protected:
+	void Charge(const Entry& entry, bool add);
+
+	///@brief Mutex protecting everything below
+	std::mutex m_mutex;
+
+	///@brief Every live buffer
+	std::unordered_map<void*, Entry> m_entries;
+
+	///@brief Usage by owner
+	std::map<std::string, OwnerUsage> m_usage;
+
+	///@brief Consecutive reallocating refreshes which make a storm
+	uint64_t m_stormThreshold;
+};
+
+#endif
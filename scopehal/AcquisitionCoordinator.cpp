@@ -0,0 +1,262 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of AcquisitionCoordinator
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "AcquisitionCoordinator.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates a coordinator with no instruments
+
+	@param tolerance	Maximum trigger timestamp skew between instruments, in femtoseconds. Most drivers timestamp
+						waveforms with the host clock when they're downloaded, so this needs to cover the spread in
+						download latency between instruments, not just the trigger skew.
+ */
+AcquisitionCoordinator::AcquisitionCoordinator(int64_t tolerance)
+	: m_tolerance(tolerance)
+	, m_droppedCount(0)
+	, m_terminating(false)
+{
+}
+
+AcquisitionCoordinator::~AcquisitionCoordinator()
+{
+	Stop();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Thread management
+
+/**
+	@brief Adds an instrument to the group
+
+	Must be called while the acquisition threads are stopped.
+ */
+void AcquisitionCoordinator::AddInstrument(shared_ptr<Oscilloscope> scope)
+{
+	if(IsRunning())
+	{
+		LogError("AcquisitionCoordinator: can't add instruments while running\n");
+		return;
+	}
+
+	lock_guard<mutex> lock(m_mutex);
+	m_scopes.push_back(scope);
+}
+
+/**
+	@brief Starts one acquisition thread per instrument
+ */
+void AcquisitionCoordinator::Start()
+{
+	if(IsRunning())
+		return;
+
+	m_terminating = false;
+	for(auto& scope : m_scopes)
+		m_threads.push_back(thread(&AcquisitionCoordinator::AcquisitionThread, this, scope));
+}
+
+/**
+	@brief Stops the acquisition threads
+
+	Any download in progress is finished first. Waveforms already pending are left in place.
+ */
+void AcquisitionCoordinator::Stop()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_terminating = true;
+	}
+	m_dataReady.notify_all();
+	m_spaceAvailable.notify_all();
+	for(auto& scope : m_scopes)
+		scope->CancelTriggerWait();
+
+	for(auto& t : m_threads)
+		t.join();
+	m_threads.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Matching
+
+/**
+	@brief Gets the difference between two trigger timestamps, in femtoseconds
+ */
+static int64_t TimestampDelta(time_t asec, int64_t afs, time_t bsec, int64_t bfs)
+{
+	return (int64_t)(asec - bsec) * (int64_t)FS_PER_SECOND + (afs - bfs);
+}
+
+/**
+	@brief Discards stale waveforms until the oldest pending waveform of every instrument came from the same trigger
+
+	A waveform is stale if some other instrument's oldest waveform is newer by more than the tolerance: since
+	timestamps only go forward, nothing that instrument captures later can match it either.
+
+	Must be called with m_mutex held.
+
+	@return True if every instrument has a pending waveform and they all match
+ */
+bool AcquisitionCoordinator::MatchHeads()
+{
+	if(m_scopes.empty())
+		return false;
+
+	size_t n = m_scopes.size();
+	vector<time_t> secs(n);
+	vector<int64_t> fs(n);
+
+	while(true)
+	{
+		//Find the newest head
+		size_t newest = 0;
+		for(size_t i=0; i<n; i++)
+		{
+			if(!m_scopes[i]->GetPendingWaveformTimestamp(secs[i], fs[i]))
+				return false;
+			if(TimestampDelta(secs[i], fs[i], secs[newest], fs[newest]) > 0)
+				newest = i;
+		}
+
+		//Drop anything too far behind it
+		bool dropped = false;
+		for(size_t i=0; i<n; i++)
+		{
+			if(TimestampDelta(secs[newest], fs[newest], secs[i], fs[i]) > m_tolerance)
+			{
+				m_scopes[i]->DropPendingWaveform();
+				m_droppedCount ++;
+				dropped = true;
+			}
+		}
+
+		if(!dropped)
+			return true;
+		m_spaceAvailable.notify_all();
+	}
+}
+
+/**
+	@brief Checks if a complete, matched set of waveforms is ready
+
+	Stale waveforms are discarded as a side effect.
+ */
+bool AcquisitionCoordinator::HasPendingSet()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return MatchHeads();
+}
+
+/**
+	@brief Pops one matched waveform on every instrument
+
+	On return, every channel of every instrument holds data from the same trigger event and the filter graph can be
+	refreshed.
+
+	@return True if a set was popped, false if no complete set was ready
+ */
+bool AcquisitionCoordinator::PopPendingSet()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		if(!MatchHeads())
+			return false;
+
+		for(auto& scope : m_scopes)
+			scope->PopPendingWaveform();
+	}
+	m_spaceAvailable.notify_all();
+	return true;
+}
+
+/**
+	@brief Blocks until a complete, matched set of waveforms is ready or the timeout elapses
+
+	@return True if a set is ready to pop
+ */
+bool AcquisitionCoordinator::WaitForPendingSet(chrono::milliseconds timeout)
+{
+	unique_lock<mutex> lock(m_mutex);
+	return m_dataReady.wait_for(lock, timeout, [this]{ return m_terminating || MatchHeads(); }) && !m_terminating;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Acquisition
+
+/**
+	@brief Thread function: polls one instrument and downloads waveforms until we're stopped
+ */
+void AcquisitionCoordinator::AcquisitionThread(shared_ptr<Oscilloscope> scope)
+{
+	#ifdef __linux__
+	pthread_setname_np(pthread_self(), "AcqCoordinator");
+	#endif
+
+	while(true)
+	{
+		//Don't run too far ahead of the consumer
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_spaceAvailable.wait(lock, [&]
+				{ return m_terminating || (scope->GetPendingWaveformCount() < MAX_PENDING_PER_INSTRUMENT); });
+			if(m_terminating)
+				return;
+		}
+
+		scope->BackgroundProcessing();
+
+		auto mode = scope->PollTrigger();
+		scope->OnTriggerPolled(mode);
+		if( (mode == Oscilloscope::TRIGGER_MODE_TRIGGERED) && scope->AcquireData() )
+		{
+			//Take the lock so the notification can't slip in between a waiter's check and its sleep.
+			//Go straight back to polling, if the instrument is triggering fast another waveform may already be ready.
+			lock_guard<mutex> lock(m_mutex);
+			m_dataReady.notify_all();
+		}
+
+		//Nothing to do yet. Block until the driver says data is ready, or for its adaptive poll interval.
+		//The timeout bounds how long Stop() can take for drivers that block on a socket.
+		else
+			scope->WaitForTriggerEvent(chrono::milliseconds(10));
+	}
+}
@@ -0,0 +1,132 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of AcquisitionCoordinator
+	@ingroup core
+ */
+
+#ifndef AcquisitionCoordinator_h
+#define AcquisitionCoordinator_h
+
+#include <condition_variable>
+
+/**
+	@brief Acquires from several oscilloscopes sharing a trigger in parallel, and groups their waveforms by trigger
+
+	When several instruments are slaved to one trigger (daisy chained, or fanned out by a trigger crossbar), each
+	trigger event produces one pending SequenceSet per instrument. Polling every instrument from one thread
+	serializes the (often slow) waveform downloads, and leaves it up to the client to figure out which sets belong
+	together if one instrument missed a trigger.
+
+	The coordinator runs one acquisition thread per instrument, each polling the trigger and downloading waveforms
+	into that instrument's pending queue. PopPendingSet() then looks at the oldest pending waveform of every
+	instrument, compares their trigger timestamps, discards any which have no partner within the tolerance (an
+	instrument which armed late, or dropped a trigger), and pops one matched waveform on every instrument at once
+	so the filter graph always sees a coherent multi-instrument capture.
+
+	The triggering and arming of the instruments is left to the caller, as is the filter graph refresh.
+
+	@ingroup core
+ */
+class AcquisitionCoordinator
+{
+public:
+	AcquisitionCoordinator(int64_t tolerance = (int64_t)(0.05 * FS_PER_SECOND));
+	~AcquisitionCoordinator();
+
+	void AddInstrument(std::shared_ptr<Oscilloscope> scope);
+	void Start();
+	void Stop();
+
+	bool HasPendingSet();
+	bool PopPendingSet();
+	bool WaitForPendingSet(std::chrono::milliseconds timeout);
+
+	/**
+		@brief Sets the maximum trigger timestamp skew between instruments with waveforms in the same set
+
+		@param tolerance	Maximum skew, in femtoseconds
+	 */
+	void SetTolerance(int64_t tolerance)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tolerance = tolerance;
+	}
+
+	///@brief Gets the number of waveforms discarded so far because no other instrument triggered at the same time
+	uint64_t GetDroppedCount()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_droppedCount;
+	}
+
+	///@brief Returns true if the acquisition threads are running
+	bool IsRunning()
+	{ return !m_threads.empty(); }
+
+	/**
+		@brief Maximum number of waveforms an acquisition thread will queue up before waiting for the consumer
+
+		Keeps one instrument that's triggering on its own (and will never match) from using up all of our RAM.
+	 */
+	static constexpr size_t MAX_PENDING_PER_INSTRUMENT = 4;
+
+protected:
+	void AcquisitionThread(std::shared_ptr<Oscilloscope> scope);
+	bool MatchHeads();
+
+	///@brief Mutex protecting everything below except the thread list
+	std::mutex m_mutex;
+
+	///@brief Signaled when a new waveform is downloaded, or when we're shutting down
+	std::condition_variable m_dataReady;
+
+	///@brief Signaled when a set is popped, or when we're shutting down
+	std::condition_variable m_spaceAvailable;
+
+	///@brief The instruments being coordinated
+	std::vector<std::shared_ptr<Oscilloscope>> m_scopes;
+
+	///@brief Maximum trigger timestamp skew, in femtoseconds
+	int64_t m_tolerance;
+
+	///@brief Number of waveforms dropped without a match
+	uint64_t m_droppedCount;
+
+	///@brief Set when the acquisition threads should exit
+	bool m_terminating;
+
+	///@brief The acquisition threads, one per instrument
+	std::vector<std::thread> m_threads;
+};
+
+#endif
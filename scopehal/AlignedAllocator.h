@@ -39,6 +39,8 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <sys/mman.h>
 #endif
 
 /**
@@ -46,6 +48,10 @@
 
 	Based on https://devblogs.microsoft.com/cppblog/the-mallocator/
 
+	Large blocks (HUGE_PAGE_THRESHOLD bytes or more, unless the caller says otherwise) are aligned to a huge page
+	boundary and, on Linux, marked with MADV_HUGEPAGE so the kernel backs them with 2 MB transparent huge pages.
+	Streaming through a gigasample waveform with 4 kB pages otherwise takes a TLB miss every 1024 samples.
+
 	@ingroup core
  */
 template <class T, size_t alignment>
@@ -53,6 +59,12 @@ class AlignedAllocator
 {
 public:
 
+	///@brief Size of a transparent huge page on x86-64 and most ARM64 kernels
+	static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+	///@brief Blocks of at least this many bytes use huge pages by default
+	static constexpr size_t HUGE_PAGE_THRESHOLD = 16 * 1024 * 1024;
+
 	///@brief Pointer to the allocated type
 	typedef T* pointer;
 
@@ -152,11 +164,28 @@ public:
 	{}
 
 	/**
-		@brief Allocate a block of memory
+		@brief Allocate a block of memory, using huge pages if it's at least HUGE_PAGE_THRESHOLD bytes
 
-		@param n	Size in bytes (internally rounded up to our alignment)
+		@param n	Number of elements (internally rounded up to our alignment)
 	 */
 	T* allocate(size_t n) const
+	{
+		if(n > max_size())
+			throw std::length_error("AlignedAllocator<T>::allocate(): requested size is too large, integer overflow?");
+		return allocate(n, (n * sizeof(T)) >= HUGE_PAGE_THRESHOLD);
+	}
+
+	/**
+		@brief Allocate a block of memory
+
+		Huge page blocks are rounded up to a whole number of huge pages, so only ask for them on large blocks.
+		Whether the kernel actually uses huge pages depends on /sys/kernel/mm/transparent_hugepage/enabled (any
+		setting other than "never" works). On Windows, large pages need a special privilege so we ignore the request.
+
+		@param n			Number of elements (internally rounded up to our alignment)
+		@param hugePages	True to align to, and advise the kernel to use, huge pages
+	 */
+	T* allocate(size_t n, bool hugePages) const
 	{
 		//Fail if we got an invalid size
 		if(n == 0)
@@ -173,9 +202,23 @@ public:
 
 		//Do the actual allocation
 #ifdef _WIN32
+		(void)hugePages;
 		T* ret = static_cast<T*>(_aligned_malloc(n*sizeof(T), alignment));
 #else
-		T* ret = static_cast<T*>(aligned_alloc(alignment, n*sizeof(T)));
+		T* ret;
+		if(hugePages)
+		{
+			size_t bytes = (n*sizeof(T) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+			ret = static_cast<T*>(aligned_alloc(HUGE_PAGE_SIZE, bytes));
+
+			//Advisory only, so failure (e.g. THP compiled out) just leaves us with normal pages
+			#ifdef MADV_HUGEPAGE
+			if(ret != NULL)
+				madvise(ret, bytes, MADV_HUGEPAGE);
+			#endif
+		}
+		else
+			ret = static_cast<T*>(aligned_alloc(alignment, n*sizeof(T)));
 #endif
 
 		//Error check
@@ -0,0 +1,338 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of AnalogStatistics
+	@ingroup datamodel
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+mutex AnalogStatistics::m_cacheMutex;
+unique_ptr<AnalogStatistics::Engine> AnalogStatistics::m_engine;
+mutex AnalogStatistics::m_engineMutex;
+
+/**
+	@brief Waveforms smaller than this are reduced on the CPU, since the GPU round trip costs more than it saves
+ */
+static const size_t GPU_REDUCE_THRESHOLD = 1024 * 1024;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// GPU reduction
+
+/**
+	@brief GPU accelerated reduction of an analog waveform
+
+	The first pass reduces the waveform to per-thread partial min/max/sum/sum-of-squares. The second pass finds the
+	global min/max from the partials and bins the waveform, so both run in one submission. The partials (a few
+	tens of kB) and the histogram are then read back and the CPU finishes the sums in double precision.
+ */
+class AnalogStatistics::Engine
+{
+public:
+	Engine();
+
+	void Run(AcceleratorBuffer<float>& samples, AnalogStatistics& stats);
+
+protected:
+	std::shared_ptr<QueueHandle> m_queue;
+	std::unique_ptr<vk::raii::CommandPool> m_pool;
+	std::unique_ptr<vk::raii::CommandBuffer> m_cmdBuf;
+
+	std::unique_ptr<ComputePipeline> m_firstPassPipeline;
+	std::unique_ptr<ComputePipeline> m_histogramPipeline;
+
+	///@brief Per thread min, max, sum, and sum of squares
+	AcceleratorBuffer<float> m_partials;
+
+	///@brief Histogram bins
+	AcceleratorBuffer<uint32_t> m_histogram;
+};
+
+AnalogStatistics::Engine::Engine()
+{
+	m_queue = g_vkQueueManager->GetComputeQueue("AnalogStatistics.queue");
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		m_queue->m_family );
+	m_pool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(**m_pool, vk::CommandBufferLevel::ePrimary, 1);
+	m_cmdBuf = make_unique<vk::raii::CommandBuffer>(
+		std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	if(g_hasDebugUtils)
+	{
+		string poolname = "AnalogStatistics.pool";
+		string bufname = "AnalogStatistics.cmdbuf";
+
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandPool,
+				reinterpret_cast<uint64_t>(static_cast<VkCommandPool>(**m_pool)),
+				poolname.c_str()));
+
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandBuffer,
+				reinterpret_cast<uint64_t>(static_cast<VkCommandBuffer>(**m_cmdBuf)),
+				bufname.c_str()));
+	}
+
+	m_firstPassPipeline = make_unique<ComputePipeline>(
+		"shaders/AnalogStatistics_FirstPass.spv",
+		2,
+		sizeof(AnalogStatisticsPushConstants));
+
+	m_histogramPipeline = make_unique<ComputePipeline>(
+		"shaders/AnalogStatistics_Histogram.spv",
+		3,
+		sizeof(AnalogStatisticsPushConstants));
+
+	m_partials.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_partials.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_histogram.SetCpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+	m_histogram.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+
+	m_partials.SetName("AnalogStatistics.m_partials");
+	m_histogram.SetName("AnalogStatistics.m_histogram");
+}
+
+/**
+	@brief Reduces a waveform's samples
+
+	@param samples	Sample data, at least numThreads long
+	@param stats	Statistics object to fill
+ */
+void AnalogStatistics::Engine::Run(AcceleratorBuffer<float>& samples, AnalogStatistics& stats)
+{
+	const uint32_t numThreads = 4096;
+	const uint32_t histogramBlocks = 64;
+
+	AnalogStatisticsPushConstants push;
+	push.size = samples.size();
+	push.numThreads = numThreads;
+	push.bins = HISTOGRAM_BINS;
+
+	m_partials.resize(numThreads * 4);
+
+	//Zero the histogram CPU side, it's tiny
+	m_histogram.resize(HISTOGRAM_BINS);
+	m_histogram.PrepareForCpuAccess();
+	memset(m_histogram.GetCpuPointer(), 0, HISTOGRAM_BINS * sizeof(uint32_t));
+	m_histogram.MarkModifiedFromCpu();
+
+	m_cmdBuf->begin({});
+
+	m_firstPassPipeline->BindBufferNonblocking(0, samples, *m_cmdBuf);
+	m_firstPassPipeline->BindBufferNonblocking(1, m_partials, *m_cmdBuf, true);
+	m_firstPassPipeline->Dispatch(*m_cmdBuf, push, GetComputeBlockCount(numThreads, 64));
+	m_partials.MarkModifiedFromGpu();
+	m_firstPassPipeline->AddComputeMemoryBarrier(*m_cmdBuf);
+
+	m_histogramPipeline->BindBufferNonblocking(0, samples, *m_cmdBuf);
+	m_histogramPipeline->BindBufferNonblocking(1, m_partials, *m_cmdBuf);
+	m_histogramPipeline->BindBufferNonblocking(2, m_histogram, *m_cmdBuf);
+	m_histogramPipeline->Dispatch(*m_cmdBuf, push, histogramBlocks);
+	m_histogram.MarkModifiedFromGpu();
+
+	m_partials.PrepareForCpuAccessNonblocking(*m_cmdBuf);
+	m_histogram.PrepareForCpuAccessNonblocking(*m_cmdBuf);
+
+	m_cmdBuf->end();
+	m_queue->SubmitAndBlock(*m_cmdBuf);
+
+	//Final reduction in double precision
+	stats.m_count = samples.size();
+	stats.m_min = m_partials[0];
+	stats.m_max = m_partials[1];
+	stats.m_sum = 0;
+	stats.m_sumSquares = 0;
+	for(uint32_t i=0; i<numThreads; i++)
+	{
+		stats.m_min = min(stats.m_min, m_partials[i*4]);
+		stats.m_max = max(stats.m_max, m_partials[i*4 + 1]);
+		stats.m_sum += m_partials[i*4 + 2];
+		stats.m_sumSquares += m_partials[i*4 + 3];
+	}
+
+	for(size_t i=0; i<HISTOGRAM_BINS; i++)
+		stats.m_histogram[i] = m_histogram[i];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+AnalogStatistics::AnalogStatistics()
+	: m_count(0)
+	, m_min(0)
+	, m_max(0)
+	, m_sum(0)
+	, m_sumSquares(0)
+	, m_histogram(HISTOGRAM_BINS, 0)
+{
+}
+
+/**
+	@brief Frees the shared GPU engine
+
+	Must be called before the Vulkan device is destroyed.
+ */
+void AnalogStatistics::DestroyEngine()
+{
+	lock_guard<mutex> lock(m_engineMutex);
+	m_engine = nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reduction
+
+/**
+	@brief Gets the statistics for an analog waveform, computing them if the cached copy is missing or stale
+
+	@param wfm	A SparseAnalogWaveform or UniformAnalogWaveform
+
+	@return The statistics (all zero if the waveform is empty or not analog)
+ */
+shared_ptr<AnalogStatistics> AnalogStatistics::Get(WaveformBase* wfm)
+{
+	uint64_t rev = wfm->m_revision;
+	{
+		lock_guard<mutex> lock(m_cacheMutex);
+		if(wfm->m_cachedStatistics && (wfm->m_cachedStatisticsRevision == rev))
+			return wfm->m_cachedStatistics;
+	}
+
+	//Same locking strategy as DigitalEdgeList::Get()
+	auto stats = make_shared<AnalogStatistics>();
+	stats->Compute(wfm);
+
+	lock_guard<mutex> lock(m_cacheMutex);
+	wfm->m_cachedStatistics = stats;
+	wfm->m_cachedStatisticsRevision = rev;
+	return stats;
+}
+
+/**
+	@brief Fills this object from a waveform
+ */
+void AnalogStatistics::Compute(WaveformBase* wfm)
+{
+	auto sdin = WaveformCast<SparseAnalogWaveform>(wfm);
+	auto udin = WaveformCast<UniformAnalogWaveform>(wfm);
+	if(!sdin && !udin)
+		return;
+	if(wfm->size() == 0)
+		return;
+
+	auto& samples = sdin ? sdin->m_samples : udin->m_samples;
+	if(samples.size() >= GPU_REDUCE_THRESHOLD)
+	{
+		lock_guard<mutex> lock(m_engineMutex);
+		if(!m_engine)
+			m_engine = make_unique<Engine>();
+		m_engine->Run(samples, *this);
+	}
+	else if(sdin)
+		ComputeOnCpu(sdin);
+	else
+		ComputeOnCpu(udin);
+}
+
+/**
+	@brief CPU reduction: min/max and compensated sums, plus a pass for the histogram once we know the range
+ */
+template<class T>
+void AnalogStatistics::ComputeOnCpu(T* wfm)
+{
+	wfm->PrepareForCpuAccess();
+
+	size_t len = wfm->size();
+	float* p = wfm->m_samples.GetCpuPointer();
+
+	m_count = len;
+	m_min = p[0];
+	m_max = p[0];
+	for(size_t i=0; i<len; i++)
+	{
+		float f = p[i];
+		m_min = min(m_min, f);
+		m_max = max(m_max, f);
+	}
+
+	//Compensated SIMD sums are both faster and more accurate than a serial double accumulator
+	m_sum = g_simdKernels.sum(p, len);
+	m_sumSquares = g_simdKernels.sumSquares(p, len, 0);
+
+	m_histogram = Filter::MakeHistogram(wfm, m_min, m_max, HISTOGRAM_BINS);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+/**
+	@brief Gets the center voltage of the tallest histogram bin in a range
+ */
+float AnalogStatistics::GetPeakInRange(size_t first, size_t last) const
+{
+	size_t binval = 0;
+	size_t idx = first;
+	for(size_t i=first; i<last; i++)
+	{
+		if(m_histogram[i] > binval)
+		{
+			binval = m_histogram[i];
+			idx = i;
+		}
+	}
+
+	float fbin = (idx + 0.5f)/HISTOGRAM_BINS;
+	return fbin*(m_max - m_min) + m_min;
+}
+
+/**
+	@brief Gets the most probable "0" level: the highest peak in the first quarter of the histogram
+ */
+float AnalogStatistics::GetBase() const
+{
+	return GetPeakInRange(0, HISTOGRAM_BINS/4);
+}
+
+/**
+	@brief Gets the most probable "1" level: the highest peak in the last quarter of the histogram
+ */
+float AnalogStatistics::GetTop() const
+{
+	return GetPeakInRange((HISTOGRAM_BINS*3)/4, HISTOGRAM_BINS);
+}
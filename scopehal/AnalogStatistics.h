@@ -0,0 +1,119 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of AnalogStatistics
+	@ingroup datamodel
+ */
+
+#ifndef AnalogStatistics_h
+#define AnalogStatistics_h
+
+struct __attribute__((packed)) AnalogStatisticsPushConstants
+{
+	uint32_t size;
+	uint32_t numThreads;
+	uint32_t bins;
+};
+
+/**
+	@brief Summary statistics of an analog waveform: min, max, sum, sum of squares, and a coarse histogram
+	@ingroup datamodel
+
+	Many measurements on the same channel need the same few numbers (the min/max for a histogram range, the
+	average for a zero crossing threshold, the top and base levels for amplitude measurements...). Computing them
+	all in one pass and caching the result on the source waveform until its revision changes means the waveform
+	is only read once no matter how many consumers ask.
+
+	Statistics are created by Get(). Large waveforms are reduced on the GPU, small ones on the CPU.
+ */
+class AnalogStatistics
+{
+public:
+	AnalogStatistics();
+
+	static std::shared_ptr<AnalogStatistics> Get(WaveformBase* wfm);
+	static void DestroyEngine();
+
+	///@brief Number of bins in m_histogram
+	static const size_t HISTOGRAM_BINS = 100;
+
+	///@brief Number of samples in the source waveform
+	size_t m_count;
+
+	///@brief Lowest sample value
+	float m_min;
+
+	///@brief Highest sample value
+	float m_max;
+
+	///@brief Sum of all sample values
+	double m_sum;
+
+	///@brief Sum of the squares of all sample values
+	double m_sumSquares;
+
+	///@brief Histogram of sample values with HISTOGRAM_BINS bins spanning [m_min, m_max]
+	std::vector<size_t> m_histogram;
+
+	///@brief Average (DC) value
+	float GetAverage() const
+	{ return m_count ? (m_sum / m_count) : 0; }
+
+	///@brief RMS value including the DC component
+	float GetRMS() const
+	{ return m_count ? sqrt(m_sumSquares / m_count) : 0; }
+
+	float GetBase() const;
+	float GetTop() const;
+
+protected:
+	void Compute(WaveformBase* wfm);
+
+	template<class T>
+	void ComputeOnCpu(T* wfm);
+
+	float GetPeakInRange(size_t first, size_t last) const;
+
+	class Engine;
+
+	///@brief Mutex protecting the cache fields of every WaveformBase
+	static std::mutex m_cacheMutex;
+
+	///@brief Shared GPU reduction engine, created on first use
+	static std::unique_ptr<Engine> m_engine;
+
+	///@brief Mutex protecting m_engine
+	static std::mutex m_engineMutex;
+};
+
+#endif
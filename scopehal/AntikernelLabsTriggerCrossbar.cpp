@@ -55,6 +55,7 @@ using namespace std;
 AntikernelLabsTriggerCrossbar::AntikernelLabsTriggerCrossbar(SCPITransport* transport)
 	: SCPIDevice(transport)
 	, SCPIInstrument(transport)
+	, m_config(transport)
 	, m_loadInProgress(true)
 	, m_bathtubScanInProgress(false)
 	, m_eyeScanInProgress(false)
@@ -82,6 +83,44 @@ void AntikernelLabsTriggerCrossbar::PostCtorInit()
 {
 	auto sthis = dynamic_pointer_cast<SCPIBERT>(shared_from_this());
 
+	//Read all of the existing hardware state in one pipelined batch, rather than one round trip per setting
+	vector<string> queries;
+	size_t base = m_channels.size();
+	for(size_t i=0; i<8; i++)
+	{
+		auto hwname = string("IN") + to_string(i + base);
+		queries.push_back(hwname + ":THRESH?");
+		queries.push_back(hwname + ":NICK?");
+	}
+	for(size_t i=0; i<4; i++)
+	{
+		auto hwname = string("IO") + to_string(i + 8);
+		for(auto q : { ":LEV?", ":THRESH?", ":NICK?", ":DIR?", ":MUX?" })
+			queries.push_back(hwname + q);
+	}
+	for(size_t i=0; i<8; i++)
+	{
+		auto hwname = string("OUT") + to_string(i);
+		for(auto q : { ":LEV?", ":NICK?", ":MUX?" })
+			queries.push_back(hwname + q);
+	}
+	for(size_t i=0; i<2; i++)
+	{
+		auto hwname = string("TX") + to_string(i);
+		for(auto q : { ":PATTERN?", ":INVERT?", ":ENABLE?", ":SWING?", ":PRECURSOR?", ":POSTCURSOR?", ":CLKSEL?", ":CLKDIV?" })
+			queries.push_back(hwname + q);
+	}
+	for(size_t i=0; i<2; i++)
+	{
+		auto hwname = string("RX") + to_string(i);
+		for(auto q : { ":PRESCALE?", ":INVERT?", ":CLKSEL?", ":CLKDIV?" })
+			queries.push_back(hwname + q);
+	}
+	queries.push_back("LA:MEMDEPTH?");
+	queries.push_back("TRIGMUX?");
+	queries.push_back("LA:TRIGPOS?");
+	m_config.Prefetch(queries);
+
 	//Input-only channels
 	m_triggerInChannelBase = m_channels.size();
 	for(size_t i=0; i<8; i++)
@@ -104,7 +143,7 @@ void AntikernelLabsTriggerCrossbar::PostCtorInit()
 		chan->m_visibilityMode = InstrumentChannel::VIS_HIDE;
 
 		//Get raw DAC threshold
-		auto reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":THRESH?"));
+		auto reply = Trim(m_config.Query(hwname + ":THRESH?"));
 		auto thresh = 0.001f * atoi(reply.c_str());
 
 		//Scale to account for attenuator on channel 7
@@ -114,7 +153,7 @@ void AntikernelLabsTriggerCrossbar::PostCtorInit()
 		m_trigThreshold[i] = thresh;
 
 		//Load the nickname
-		reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":NICK?"));
+		reply = Trim(m_config.Query(hwname + ":NICK?"));
 		chan->SetDisplayName(reply);
 	}
 
@@ -140,18 +179,18 @@ void AntikernelLabsTriggerCrossbar::PostCtorInit()
 		chan->m_visibilityMode = InstrumentChannel::VIS_HIDE;
 
 		//Get the output drive level
-		auto reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":LEV?"));
+		auto reply = Trim(m_config.Query(hwname + ":LEV?"));
 		m_trigDrive[i + m_triggerBidirChannelBase] = 0.001f * atoi(reply.c_str());
 
 		//Get input switching threshold, scale to account for attenuator on channels 10/11
-		reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":THRESH?"));
+		reply = Trim(m_config.Query(hwname + ":THRESH?"));
 		auto thresh = 0.001f * atoi(reply.c_str());
 		if(i >= 2)
 			thresh *= 2;
 		m_trigThreshold[i + m_triggerBidirChannelBase] = thresh;
 
 		//Load the nickname
-		reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":NICK?"));
+		reply = Trim(m_config.Query(hwname + ":NICK?"));
 		chan->SetDisplayName(reply);
 	}
 
@@ -177,11 +216,11 @@ void AntikernelLabsTriggerCrossbar::PostCtorInit()
 		//Default to being displayed since it's always outputting a signal
 		chan->m_visibilityMode = InstrumentChannel::VIS_SHOW;
 
-		auto reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":LEV?"));
+		auto reply = Trim(m_config.Query(hwname + ":LEV?"));
 		m_trigDrive[i] = 0.001f * atoi(reply.c_str());
 
 		//Load the nickname
-		reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":NICK?"));
+		reply = Trim(m_config.Query(hwname + ":NICK?"));
 		chan->SetDisplayName(reply);
 	}
 
@@ -200,7 +239,7 @@ void AntikernelLabsTriggerCrossbar::PostCtorInit()
 
 		//Read existing config once, then cache
 		//No need to ever flush cache as instrument has no front panel UI
-		auto reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":PATTERN?"));
+		auto reply = Trim(m_config.Query(hwname + ":PATTERN?"));
 		if(reply == "PRBS7")
 			m_txPattern[i] = PATTERN_PRBS7;
 		else if(reply == "PRBS15")
@@ -216,10 +255,10 @@ void AntikernelLabsTriggerCrossbar::PostCtorInit()
 		else if(reply == "SLOWSQUARE")
 			m_txPattern[i] = PATTERN_CLOCK_DIV32;
 
-		reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":INVERT?"));
+		reply = Trim(m_config.Query(hwname + ":INVERT?"));
 		m_txInvert[i] = (atoi(reply.c_str()) == 1);
 
-		reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":ENABLE?"));
+		reply = Trim(m_config.Query(hwname + ":ENABLE?"));
 		m_txEnable[i] = (atoi(reply.c_str()) == 1);
 
 		//Default to being shown if transmitting
@@ -228,7 +267,7 @@ void AntikernelLabsTriggerCrossbar::PostCtorInit()
 		else
 			chan->m_visibilityMode = InstrumentChannel::VIS_HIDE;
 
-		reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":SWING?"));
+		reply = Trim(m_config.Query(hwname + ":SWING?"));
 		auto drives = AntikernelLabsTriggerCrossbar::GetAvailableTxDriveStrengths(m_txChannelBase+i);
 		size_t idx = atoi(reply.c_str());
 		if(idx >= drives.size())
@@ -236,12 +275,12 @@ void AntikernelLabsTriggerCrossbar::PostCtorInit()
 		m_txDrive[i] = drives[idx];
 
 		//precursor range is 0 to 20
-		reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":PRECURSOR?"));
+		reply = Trim(m_config.Query(hwname + ":PRECURSOR?"));
 		idx = atoi(reply.c_str());
 		m_txPreCursor[i] = idx / 20.0f;
 
 		//postcursor range is 0 to 31
-		reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":POSTCURSOR?"));
+		reply = Trim(m_config.Query(hwname + ":POSTCURSOR?"));
 		idx = atoi(reply.c_str());
 		m_txPostCursor[i] = idx / 31.0f;
 
@@ -249,10 +288,10 @@ void AntikernelLabsTriggerCrossbar::PostCtorInit()
 		//In the current gateware, QPLL is always 10.31235 Gbps and CPLL is always 5 Gbps
 		//then we may sub-rate from that
 		int64_t pllLineRate = 10312500000LL;
-		reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":CLKSEL?"));
+		reply = Trim(m_config.Query(hwname + ":CLKSEL?"));
 		if(reply == "CPLL")
 			pllLineRate = 5000000000LL;
-		reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":CLKDIV?"));
+		reply = Trim(m_config.Query(hwname + ":CLKDIV?"));
 		auto clkdiv = stoi(reply);
 		if(clkdiv <= 0)		//0 means use OUT_DIV attribute, which is also set to 1 in the gateware
 			clkdiv = 1;
@@ -277,20 +316,20 @@ void AntikernelLabsTriggerCrossbar::PostCtorInit()
 		chan->m_visibilityMode = InstrumentChannel::VIS_HIDE;
 
 		//BER prescaler
-		auto reply = Trim(m_transport->SendCommandQueuedWithReply(
+		auto reply = Trim(m_config.Query(
 			m_channels[m_rxChannelBase + i]->GetHwname() + ":PRESCALE?"));
 		m_scanDepth[i] = 1 << (17 + atoi(reply.c_str()));
 
 		//Inversion
-		reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":INVERT?"));
+		reply = Trim(m_config.Query(hwname + ":INVERT?"));
 		m_rxInvert[i] = (atoi(reply.c_str()) == 1);
 
 		//Same as for TX, can we abstract this better?
 		int64_t pllLineRate = 10312500000LL;
-		reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":CLKSEL?"));
+		reply = Trim(m_config.Query(hwname + ":CLKSEL?"));
 		if(reply == "CPLL")
 			pllLineRate = 5000000000LL;
-		reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":CLKDIV?"));
+		reply = Trim(m_config.Query(hwname + ":CLKDIV?"));
 		auto clkdiv = stoi(reply);
 		if(clkdiv <= 0)		//0 means use OUT_DIV attribute, which is also set to 1 in the gateware
 			clkdiv = 1;
@@ -316,7 +355,7 @@ void AntikernelLabsTriggerCrossbar::PostCtorInit()
 	{
 		//Get the existing mux selector
 		auto hwname = string("OUT") + to_string(i);
-		auto reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":MUX?"));
+		auto reply = Trim(m_config.Query(hwname + ":MUX?"));
 		auto muxsel = stoi(reply);
 
 		//Mark the input as active
@@ -332,12 +371,12 @@ void AntikernelLabsTriggerCrossbar::PostCtorInit()
 	{
 		//Get the direction
 		auto hwname = string("IO") + to_string(i + 8);
-		auto reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":DIR?"));
+		auto reply = Trim(m_config.Query(hwname + ":DIR?"));
 		if(reply == "IN")
 			continue;
 
 		//Get the existing mux selector
-		reply = Trim(m_transport->SendCommandQueuedWithReply(hwname + ":MUX?"));
+		reply = Trim(m_config.Query(hwname + ":MUX?"));
 		auto muxsel = stoi(reply);
 
 		//If in output mode, show the channel
@@ -353,17 +392,27 @@ void AntikernelLabsTriggerCrossbar::PostCtorInit()
 	}
 
 	//Logic analyzer config
-	auto reply = Trim(m_transport->SendCommandQueuedWithReply("LA:MEMDEPTH?"));
+	auto reply = Trim(m_config.Query("LA:MEMDEPTH?"));
 	m_maxLogicDepth = stoi(reply) * 32;
 
 	//Get the trigger position
 	PullTrigger();
-	reply = Trim(m_transport->SendCommandQueuedWithReply("LA:TRIGPOS?"));
+	reply = Trim(m_config.Query("LA:TRIGPOS?"));
 	m_triggerOffsetSamples = stoull(reply) * 32;
 
 	m_loadInProgress = false;
 }
 
+void AntikernelLabsTriggerCrossbar::BeginConfigTransaction()
+{
+	m_config.Begin();
+}
+
+void AntikernelLabsTriggerCrossbar::CommitConfigTransaction()
+{
+	m_config.Commit();
+}
+
 void AntikernelLabsTriggerCrossbar::SetMuxPath(size_t dstchan, size_t srcchan)
 {
 	LogTrace("SetMuxPathOpen %zu %zu\n", dstchan, srcchan);
@@ -371,12 +420,12 @@ void AntikernelLabsTriggerCrossbar::SetMuxPath(size_t dstchan, size_t srcchan)
 	if(m_loadInProgress)
 		return;
 
-	m_transport->SendCommandQueued(
+	m_config.Set(
 		m_channels[dstchan]->GetHwname() + ":MUX " + to_string(srcchan - m_triggerInChannelBase));
 
 	//If the destination channel is a bidirectional port, make it an output
 	if( (dstchan >= m_triggerBidirChannelBase) && (dstchan < m_triggerOutChannelBase) )
-		m_transport->SendCommandQueued(m_channels[dstchan]->GetHwname() + ":DIR OUT");
+		m_config.Set(m_channels[dstchan]->GetHwname() + ":DIR OUT");
 }
 
 void AntikernelLabsTriggerCrossbar::SetMuxPathOpen(size_t dstchan)
@@ -384,7 +433,7 @@ void AntikernelLabsTriggerCrossbar::SetMuxPathOpen(size_t dstchan)
 	LogTrace("SetMuxPathOpen %zu\n", dstchan);
 
 	if( (dstchan >= m_triggerBidirChannelBase) && (dstchan < m_triggerOutChannelBase) )
-		m_transport->SendCommandQueued(m_channels[dstchan]->GetHwname() + ":DIR IN");
+		m_config.Set(m_channels[dstchan]->GetHwname() + ":DIR IN");
 }
 
 bool AntikernelLabsTriggerCrossbar::MuxHasConfigurableDrive(size_t dstchan)
@@ -432,7 +481,7 @@ void AntikernelLabsTriggerCrossbar::SetMuxOutputDrive(size_t dstchan, float v)
 	}
 
 	int mv = round(v * 1000);
-	m_transport->SendCommandQueued(m_channels[dstchan]->GetHwname() + ":LEV " + to_string(mv));
+	m_config.Set(m_channels[dstchan]->GetHwname() + ":LEV " + to_string(mv));
 }
 
 bool AntikernelLabsTriggerCrossbar::MuxHasConfigurableThreshold([[maybe_unused]] size_t dstchan)
@@ -454,7 +503,7 @@ void AntikernelLabsTriggerCrossbar::SetMuxInputThreshold(size_t dstchan, float v
 		m_trigThreshold[dstchan] = v;
 
 		int mv = round(v * 1000);
-		m_transport->SendCommandQueued(m_channels[dstchan]->GetHwname() + ":THRESH " + to_string(mv));
+		m_config.Set(m_channels[dstchan]->GetHwname() + ":THRESH " + to_string(mv));
 	}
 }
 
@@ -485,7 +534,7 @@ uint32_t AntikernelLabsTriggerCrossbar::GetInstrumentTypesForChannel(size_t i) c
 void AntikernelLabsTriggerCrossbar::SetChannelDisplayName(size_t i, string name)
 {
 	SCPIBERT::SetChannelDisplayName(i, name);
-	m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":NICK " + name);
+	m_config.Set(m_channels[i]->GetHwname() + ":NICK " + name);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -502,24 +551,24 @@ void AntikernelLabsTriggerCrossbar::SetRxPattern(size_t i, Pattern pattern)
 	/*switch(pattern)
 	{
 		case PATTERN_PRBS7:
-			m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":POLY PRBS7");
+			m_config.Set(m_channels[i]->GetHwname() + ":POLY PRBS7");
 			break;
 		case PATTERN_PRBS9:
-			m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":POLY PRBS9");
+			m_config.Set(m_channels[i]->GetHwname() + ":POLY PRBS9");
 			break;
 		case PATTERN_PRBS15:
-			m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":POLY PRBS15");
+			m_config.Set(m_channels[i]->GetHwname() + ":POLY PRBS15");
 			break;
 		case PATTERN_PRBS23:
-			m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":POLY PRBS23");
+			m_config.Set(m_channels[i]->GetHwname() + ":POLY PRBS23");
 			break;
 		case PATTERN_PRBS31:
-			m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":POLY PRBS31");
+			m_config.Set(m_channels[i]->GetHwname() + ":POLY PRBS31");
 			break;
 
 		case PATTERN_CUSTOM:
 		default:
-			m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":POLY AUTO");
+			m_config.Set(m_channels[i]->GetHwname() + ":POLY AUTO");
 	}
 
 	m_rxPattern[i - m_rxChannelBase] = pattern;*/
@@ -547,9 +596,9 @@ bool AntikernelLabsTriggerCrossbar::GetRxInvert(size_t i)
 void AntikernelLabsTriggerCrossbar::SetRxInvert(size_t i, bool invert)
 {
 	/*if(invert)
-		m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":INVERT 1");
+		m_config.Set(m_channels[i]->GetHwname() + ":INVERT 1");
 	else
-		m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":INVERT 0");
+		m_config.Set(m_channels[i]->GetHwname() + ":INVERT 0");
 
 	m_rxInvert[i - m_rxChannelBase] = invert;*/
 }
@@ -618,22 +667,22 @@ void AntikernelLabsTriggerCrossbar::SetTxPattern(size_t i, Pattern pattern)
 	switch(pattern)
 	{
 		case PATTERN_PRBS7:
-			m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":PATTERN PRBS7");
+			m_config.Set(m_channels[i]->GetHwname() + ":PATTERN PRBS7");
 			break;
 		case PATTERN_PRBS15:
-			m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":PATTERN PRBS15");
+			m_config.Set(m_channels[i]->GetHwname() + ":PATTERN PRBS15");
 			break;
 		case PATTERN_PRBS23:
-			m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":PATTERN PRBS23");
+			m_config.Set(m_channels[i]->GetHwname() + ":PATTERN PRBS23");
 			break;
 		case PATTERN_PRBS31:
-			m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":PATTERN PRBS31");
+			m_config.Set(m_channels[i]->GetHwname() + ":PATTERN PRBS31");
 			break;
 		case PATTERN_CLOCK_DIV2:
-			m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":PATTERN FASTSQUARE");
+			m_config.Set(m_channels[i]->GetHwname() + ":PATTERN FASTSQUARE");
 			break;
 		case PATTERN_CLOCK_DIV32:
-			m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":PATTERN SLOWSQUARE");
+			m_config.Set(m_channels[i]->GetHwname() + ":PATTERN SLOWSQUARE");
 			break;
 
 		case PATTERN_CUSTOM:
@@ -675,9 +724,9 @@ bool AntikernelLabsTriggerCrossbar::GetTxInvert(size_t i)
 void AntikernelLabsTriggerCrossbar::SetTxInvert(size_t i, bool invert)
 {
 	if(invert)
-		m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":INVERT 1");
+		m_config.Set(m_channels[i]->GetHwname() + ":INVERT 1");
 	else
-		m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":INVERT 0");
+		m_config.Set(m_channels[i]->GetHwname() + ":INVERT 0");
 
 	m_txInvert[i - m_txChannelBase] = invert;
 }
@@ -720,16 +769,16 @@ void AntikernelLabsTriggerCrossbar::SetTxDriveStrength(size_t i, float drive)
 			swing = j;
 	}
 
-	m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":SWING " + to_string(swing));
+	m_config.Set(m_channels[i]->GetHwname() + ":SWING " + to_string(swing));
 	m_txDrive[i - m_txChannelBase] = drive;
 }
 
 void AntikernelLabsTriggerCrossbar::SetTxEnable(size_t i, bool enable)
 {
 	if(enable)
-		m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":ENABLE 1");
+		m_config.Set(m_channels[i]->GetHwname() + ":ENABLE 1");
 	else
-		m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":ENABLE 0");
+		m_config.Set(m_channels[i]->GetHwname() + ":ENABLE 0");
 
 	m_txEnable[i - m_txChannelBase] = enable;
 }
@@ -749,7 +798,7 @@ void AntikernelLabsTriggerCrossbar::SetTxPreCursor(size_t i, float precursor)
 	//precursor values range from 0 to 20
 	int precursorScaled = round(precursor * 20);
 
-	m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":PRECURSOR " + to_string(precursorScaled));
+	m_config.Set(m_channels[i]->GetHwname() + ":PRECURSOR " + to_string(precursorScaled));
 	m_txPreCursor[i - m_txChannelBase] = precursor;
 }
 
@@ -763,7 +812,7 @@ void AntikernelLabsTriggerCrossbar::SetTxPostCursor(size_t i, float postcursor)
 	//postcursor values range from 0 to 31
 	int postcursorScaled = round(postcursor * 31);
 
-	m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":POSTCURSOR " + to_string(postcursorScaled));
+	m_config.Set(m_channels[i]->GetHwname() + ":POSTCURSOR " + to_string(postcursorScaled));
 	m_txPostCursor[i - m_txChannelBase] = postcursor;
 }
 
@@ -827,7 +876,7 @@ void AntikernelLabsTriggerCrossbar::SetBERSamplingPoint(size_t i, int64_t dx, fl
 	//Offset our Y sample point by 200 mV (seems to be fixed scale)
 	float dy_offset = dy + 0.2;
 
-	m_transport->SendCommandQueued(
+	m_config.Set(
 		m_channels[i]->GetHwname() +
 		":SAMPLE " + to_string(dx_offset * 1e-3) + ", " +	//convert fs to ps
 		to_string(dy_offset * 1e3));						//convert v to mv
@@ -891,10 +940,10 @@ void AntikernelLabsTriggerCrossbar::SetDataRate(size_t i, int64_t rate)
 	//TODO: don't change clock source if we're only changing the divisor?
 
 	if(qpll)
-		m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":CLKSEL QPLL");
+		m_config.Set(m_channels[i]->GetHwname() + ":CLKSEL QPLL");
 	else
-		m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":CLKSEL CPLL");
-	m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":CLKDIV " + to_string(ndiv));
+		m_config.Set(m_channels[i]->GetHwname() + ":CLKSEL CPLL");
+	m_config.Set(m_channels[i]->GetHwname() + ":CLKDIV " + to_string(ndiv));
 
 	//Update cache
 	if(i >= m_rxChannelBase)
@@ -989,7 +1038,7 @@ void AntikernelLabsTriggerCrossbar::SetScanDepth(size_t i, int64_t depth)
 
 	int logdepth = log2(depth);
 
-	m_transport->SendCommandQueued(m_channels[i]->GetHwname() + ":PRESCALE " + to_string(logdepth - 17));
+	m_config.Set(m_channels[i]->GetHwname() + ":PRESCALE " + to_string(logdepth - 17));
 	m_scanDepth[i - m_rxChannelBase] = depth;
 }
 
@@ -1294,9 +1343,7 @@ bool AntikernelLabsTriggerCrossbar::AcquireData()
 	}
 
 	//Save the waveforms to our queue
-	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(s);
-	m_pendingWaveformsMutex.unlock();
+	PushPendingWaveform(s);
 
 	//If this was a one-shot trigger we're no longer armed
 	if(m_triggerOneShot)
@@ -1454,7 +1501,7 @@ void AntikernelLabsTriggerCrossbar::PullTrigger()
 	//(this is fake, but it'll do for starting out to enable control of trigger position)
 	auto trig = new EdgeTrigger(this);
 
-	auto source = Trim(m_transport->SendCommandQueuedWithReply("TRIGMUX?"));
+	auto source = Trim(m_config.Query("TRIGMUX?"));
 	auto chan = GetChannel(atoi(source.c_str()));
 	chan->m_visibilityMode = InstrumentChannel::VIS_SHOW;
 
@@ -1467,7 +1514,7 @@ void AntikernelLabsTriggerCrossbar::PushTrigger()
 	//Push mux selector
 	auto chan = m_trigger->GetInput(0);
 	if(chan)
-		m_transport->SendCommandQueued(string("TRIGMUX " ) + to_string(chan.m_channel->GetIndex()));
+		m_config.Set(string("TRIGMUX " ) + to_string(chan.m_channel->GetIndex()));
 }
 
 void AntikernelLabsTriggerCrossbar::Start()
@@ -1536,7 +1583,7 @@ void AntikernelLabsTriggerCrossbar::SetTriggerOffset(int64_t offset)
 	int64_t timescale = FS_PER_SECOND / m_rxDataRate[0];
 	m_triggerOffsetSamples = offset / timescale;
 
-	m_transport->SendCommandQueued(string("LA:TRIGPOS ") + to_string(m_triggerOffsetSamples / 32));
+	m_config.Set(string("LA:TRIGPOS ") + to_string(m_triggerOffsetSamples / 32));
 }
 
 int64_t AntikernelLabsTriggerCrossbar::GetTriggerOffset()
@@ -133,6 +133,8 @@ public:
 	virtual bool HasRefclkOut() override;
 
 	//Switch matrix
+	virtual void BeginConfigTransaction() override;
+	virtual void CommitConfigTransaction() override;
 	virtual void SetMuxPath(size_t dstchan, size_t srcchan) override;
 	virtual void SetMuxPathOpen(size_t dstchan) override;
 	virtual bool MuxHasConfigurableDrive(size_t dstchan) override;
@@ -223,6 +225,9 @@ protected:
 	uint64_t m_rxDataRate[2];
 	int64_t m_rxClkDiv[2];
 
+	///@brief Coalesces configuration writes, and batches reads of the initial hardware state
+	SCPIConfigBatch m_config;
+
 	/**
 		@brief True if in a constructor or similar initialization path (getting hardware state)
 
@@ -415,9 +415,7 @@ bool AntikernelLogicAnalyzer::AcquireData()
 			pending_waveforms[chan] = cap;
 		}
 	}
-	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(pending_waveforms);
-	m_pendingWaveformsMutex.unlock();
+	PushPendingWaveform(pending_waveforms);
 
 	//Re-arm the trigger if not in one-shot mode
 	if(!m_triggerOneShot)
@@ -130,6 +130,31 @@ AseqSpectrometer::AseqSpectrometer(SCPITransport* transport)
 	for(size_t i=0; i<npoints; i++)
 		m_irrcal.push_back(stof(irrcal[i]));
 
+	//Everything is stored highest wavelength first, so flip it around for display
+	size_t last = npoints-1;
+	vector<float> flatDisplay;
+	vector<float> irrDisplay;
+	m_binOffsets.resize(npoints);
+	m_binDurations.resize(npoints);
+	m_binOffsets.PrepareForCpuAccess();
+	m_binDurations.PrepareForCpuAccess();
+	for(size_t i=0; i<npoints; i++)
+	{
+		m_binOffsets[i] = m_wavelengths[last - i];
+		if(i+1 < npoints)
+			m_binDurations[i] = m_wavelengths[last - (i+1)] - m_wavelengths[last - i];
+		else
+			m_binDurations[i] = 0;
+
+		flatDisplay.push_back(m_flatcal[last - i]);
+		irrDisplay.push_back(m_irrcal[last - i]);
+	}
+	m_binOffsets.MarkModifiedFromCpu();
+	m_binDurations.MarkModifiedFromCpu();
+
+	m_frameProcessor = make_unique<SpectrometerFrameProcessor>("AseqSpectrometer", npoints, true);
+	m_frameProcessor->SetCalibration(flatDisplay, irrDisplay);
+
 	//Default to 125ms exposure
 	SetIntegrationTime(FS_PER_SECOND * 125e-3);
 }
@@ -264,15 +289,20 @@ Oscilloscope::TriggerMode AseqSpectrometer::PollTrigger()
 
 bool AseqSpectrometer::AcquireData()
 {
-	//Read the blob
-	size_t npoints = m_wavelengths.size();
-	float* buf = new float[npoints];
+	//Pick up any change to the averaging setting (discards frames already in the ring)
+	if(m_frameProcessor->GetAveraging() != GetFrameAveraging())
+		m_frameProcessor->SetAveraging(GetFrameAveraging());
 
-	//Pull the data from the server
-	if(!m_transport->ReadRawData(npoints * sizeof(float), (uint8_t*)buf))
+	//Pull the next frame from the server straight into the ring
+	size_t npoints = m_wavelengths.size();
+	if(!m_transport->ReadRawData(npoints * sizeof(float), (uint8_t*)m_frameProcessor->GetNextFrame()))
 		return false;
 
-	//Flip the samples around so the lowest wavelength is at the left, then display as a sparse waveform
+	//Nothing to show until we have enough frames to average
+	if(!m_frameProcessor->CommitFrame())
+		return true;
+
+	//Display as a sparse waveform, lowest wavelength at the left
 	double t = GetTime();
 	int64_t fs = (t - floor(t)) * FS_PER_SECOND;
 	auto rawcap = new SparseAnalogWaveform;
@@ -280,90 +310,61 @@ bool AseqSpectrometer::AcquireData()
 	rawcap->m_triggerPhase = 0;
 	rawcap->m_startTimestamp = floor(t);
 	rawcap->m_startFemtoseconds = fs;
-	rawcap->Resize(npoints);
-
-	size_t last = npoints-1;
-	for(size_t i=0; i<npoints; i++)
-	{
-		rawcap->m_offsets[i] = m_wavelengths[last - i];
-
-		if(i+1 < npoints)
-			rawcap->m_durations[i] = m_wavelengths[last - (i+1)] - m_wavelengths[last - i];
-		else
-			rawcap->m_durations[i] = 0;
-
-		rawcap->m_samples[i] = buf[last - i];
-	}
-	rawcap->MarkModifiedFromCpu();
+	rawcap->m_offsets.CopyFrom(m_binOffsets);
+	rawcap->m_durations.CopyFrom(m_binDurations);
+
+	auto flatcap = new SparseAnalogWaveform;
+	flatcap->m_timescale = 1;
+	flatcap->m_triggerPhase = 0;
+	flatcap->m_startTimestamp = rawcap->m_startTimestamp;
+	flatcap->m_startFemtoseconds = fs;
+	flatcap->m_offsets.CopyFrom(m_binOffsets);
+	flatcap->m_durations.CopyFrom(m_binDurations);
+
+	//TODO: only if spectrometer has absolute irradiance calibration data
+	auto irrcap = new SparseAnalogWaveform;
+	irrcap->m_timescale = 1;
+	irrcap->m_triggerPhase = 0;
+	irrcap->m_startTimestamp = rawcap->m_startTimestamp;
+	irrcap->m_startFemtoseconds = fs;
+	irrcap->m_offsets.CopyFrom(m_binOffsets);
+	irrcap->m_durations.CopyFrom(m_binDurations);
+
+	//Average the frames, then apply dark frame correction, flatness correction, and absolute irradiance calibration
+	auto darkframe = m_darkframe->GetInput(0);
+	auto darkcap = dynamic_cast<SparseAnalogWaveform*>(darkframe.GetData());
+	float exposureMicroseconds = GetIntegrationTime() / FS_PER_MICROSECOND;
+	m_frameProcessor->Process(
+		darkcap ? &darkcap->m_samples : nullptr,
+		1,
+		1.0 / (exposureMicroseconds * 10 * m_irrcoeff),
+		rawcap->m_samples,
+		flatcap->m_samples,
+		irrcap->m_samples);
 
 	//We always have raw count data
 	SequenceSet s;
 	s[StreamDescriptor(GetOscilloscopeChannel(CHAN_SPECTRUM),
 		AseqSpectrometerChannel::STREAM_RAW_COUNTS)] = rawcap;
 
-	//Given raw counts, apply dark frame correction and flatness correction coefficients
-	//(make sure to invert the ordering as well)
-	auto darkframe = m_darkframe->GetInput(0);
-	auto darkcap = dynamic_cast<SparseAnalogWaveform*>(darkframe.GetData());
+	//Corrected data is only meaningful with a dark frame
 	if(darkcap)
 	{
-		auto flatcap = new SparseAnalogWaveform;
-		flatcap->m_timescale = 1;
-		flatcap->m_triggerPhase = 0;
-		flatcap->m_startTimestamp = rawcap->m_startTimestamp;
-		flatcap->m_startFemtoseconds = fs;
-		flatcap->Resize(npoints);
-
-		for(size_t i=0; i<npoints; i++)
-		{
-			flatcap->m_samples[i] = (rawcap->m_samples[i] - darkcap->m_samples[i]) / m_flatcal[last - i];
-
-			flatcap->m_durations[i] = rawcap->m_durations[i];
-			flatcap->m_offsets[i] = rawcap->m_offsets[i];
-		}
-		flatcap->MarkModifiedFromCpu();
-
 		s[StreamDescriptor(GetOscilloscopeChannel(CHAN_SPECTRUM),
 			AseqSpectrometerChannel::STREAM_FLATTENED_COUNTS)] = flatcap;
-
-		//Apply absolute irradiance calibration
-		//TODO: only if spectrometer has this data
-		auto irrcap = new SparseAnalogWaveform;
-		irrcap->m_timescale = 1;
-		irrcap->m_triggerPhase = 0;
-		irrcap->m_startTimestamp = rawcap->m_startTimestamp;
-		irrcap->m_startFemtoseconds = fs;
-		irrcap->Resize(npoints);
-		for(size_t i=0; i<npoints; i++)
-		{
-			//Relative irradiance
-			float relirr = flatcap->m_samples[i] * m_irrcal[last - i];
-
-			//Absolute irradiance
-			float exposureMicroseconds = GetIntegrationTime() / FS_PER_MICROSECOND;
-			float absirr = relirr / (exposureMicroseconds * 10 * m_irrcoeff);
-
-			irrcap->m_samples[i] = absirr;
-
-			irrcap->m_durations[i] = rawcap->m_durations[i];
-			irrcap->m_offsets[i] = rawcap->m_offsets[i];
-		}
-		irrcap->MarkModifiedFromCpu();
-
 		s[StreamDescriptor(GetOscilloscopeChannel(CHAN_SPECTRUM),
 			AseqSpectrometerChannel::STREAM_ABSOLUTE_IRRADIANCE)] = irrcap;
-
+	}
+	else
+	{
+		delete flatcap;
+		delete irrcap;
 	}
 
 	m_channels[0]->SetYAxisUnits(Unit::UNIT_W_M2_NM, AseqSpectrometerChannel::STREAM_ABSOLUTE_IRRADIANCE);
 
 	//Save the waveforms to our queue
-	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(s);
-	m_pendingWaveformsMutex.unlock();
-
-	//Done, clean up
-	delete[] buf;
+	PushPendingWaveform(s);
 
 	//If this was a one-shot trigger we're no longer armed
 	if(m_triggerOneShot)
@@ -40,6 +40,7 @@
 class EdgeTrigger;
 
 #include "RemoteBridgeOscilloscope.h"
+#include "SpectrometerFrameProcessor.h"
 
 /**
 	@brief Helper class for creating output streams
@@ -165,6 +166,15 @@ protected:
 	///@brief Integration time, in femtoseconds
 	int64_t m_integrationTime;
 
+	///@brief Wavelength (in picometers) of each spectral bin, in display order
+	AcceleratorBuffer<int64_t> m_binOffsets;
+
+	///@brief Width (in picometers) of each spectral bin, in display order
+	AcceleratorBuffer<int64_t> m_binDurations;
+
+	///@brief Ring of raw frames, and the averaging / correction kernel applied to it
+	std::unique_ptr<SpectrometerFrameProcessor> m_frameProcessor;
+
 public:
 	static std::string GetDriverNameInternal();
 	SPECTROMETER_INITPROC(AseqSpectrometer)
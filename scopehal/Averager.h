@@ -84,9 +84,7 @@ public:
 
 		//Do the final summation
 		m_temporaryResults.PrepareForCpuAccess();
-		float finalSum = 0;
-		for(uint64_t i=0; i<numThreads; i++)
-			finalSum += m_temporaryResults[i];
+		double finalSum = g_simdKernels.sum(m_temporaryResults.GetCpuPointer(), numThreads);
 
 		return finalSum / depth;
 	}
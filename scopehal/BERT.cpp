@@ -167,6 +167,18 @@ int64_t BERT::GetExpectedEyeCaptureTime([[maybe_unused]] size_t i)
 	return 0;
 }
 
+void BERT::MeasureHBathtubs(const vector<size_t>& chans)
+{
+	for(auto i : chans)
+		MeasureHBathtub(i);
+}
+
+void BERT::MeasureEyes(const vector<size_t>& chans)
+{
+	for(auto i : chans)
+		MeasureEye(i);
+}
+
 bool BERT::IsHBathtubScanInProgress([[maybe_unused]] size_t i)
 {
 	return false;
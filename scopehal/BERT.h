@@ -363,6 +363,26 @@ public:
 	 */
 	virtual void MeasureEye(size_t i) =0;
 
+	/**
+		@brief Acquires bathtub curves on several channels
+
+		The default implementation calls MeasureHBathtub() on each channel in turn. Drivers which can have more than
+		one scan in flight should override this to overlap them.
+
+		@param chans		Channel indexes
+	 */
+	virtual void MeasureHBathtubs(const std::vector<size_t>& chans);
+
+	/**
+		@brief Acquires eye patterns on several channels
+
+		The default implementation calls MeasureEye() on each channel in turn. Drivers which can have more than one
+		scan in flight should override this to overlap them.
+
+		@param chans		Channel indexes
+	 */
+	virtual void MeasureEyes(const std::vector<size_t>& chans);
+
 	/**
 		@brief Set the integration period for BER measurements
 
@@ -0,0 +1,196 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of BoundedMPMCQueue
+	@ingroup core
+ */
+
+#ifndef BoundedMPMCQueue_h
+#define BoundedMPMCQueue_h
+
+#include <atomic>
+#include <memory>
+
+/**
+	@brief Fixed-capacity lock-free multi-producer, multi-consumer FIFO
+
+	Any number of threads may call Push() and Pop() concurrently. Each slot of the ring buffer carries a sequence
+	number which tells producers and consumers whether it is free or full for the current lap around the ring, so
+	there is no ABA problem and no per-item allocation.
+
+	Push() fails rather than blocking when the queue is full, which makes this suitable for bounded freelists.
+ */
+template<class T>
+class BoundedMPMCQueue
+{
+public:
+
+	/**
+		@brief Creates a queue
+
+		@param capacity		Minimum number of items the queue must be able to hold (rounded up to a power of two)
+	 */
+	BoundedMPMCQueue(size_t capacity)
+		: m_enqueuePos(0)
+		, m_dequeuePos(0)
+	{
+		size_t cap = 1;
+		while(cap < capacity)
+			cap <<= 1;
+
+		m_cells = std::make_unique<Cell[]>(cap);
+		m_mask = cap - 1;
+		for(size_t i=0; i<cap; i++)
+			m_cells[i].m_sequence.store(i, std::memory_order_relaxed);
+	}
+
+	//non-copyable
+	BoundedMPMCQueue(const BoundedMPMCQueue&) = delete;
+	BoundedMPMCQueue& operator=(const BoundedMPMCQueue&) = delete;
+
+	/**
+		@brief Adds an item to the tail of the queue
+
+		@return True on success, false if the queue was full
+	 */
+	bool Push(const T& item)
+	{
+		Cell* cell;
+		size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+		while(true)
+		{
+			cell = &m_cells[pos & m_mask];
+			size_t seq = cell->m_sequence.load(std::memory_order_acquire);
+			intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+			//Slot is free for this lap, try to claim it
+			if(dif == 0)
+			{
+				if(m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+
+			//Slot still holds an item from the previous lap, so we're full
+			else if(dif < 0)
+				return false;
+
+			//Someone else claimed it, try again
+			else
+				pos = m_enqueuePos.load(std::memory_order_relaxed);
+		}
+
+		cell->m_data = item;
+		cell->m_sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+		@brief Removes an item from the head of the queue
+
+		@return True on success, false if the queue was empty
+	 */
+	bool Pop(T& item)
+	{
+		Cell* cell;
+		size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+		while(true)
+		{
+			cell = &m_cells[pos & m_mask];
+			size_t seq = cell->m_sequence.load(std::memory_order_acquire);
+			intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+
+			//Slot is full for this lap, try to claim it
+			if(dif == 0)
+			{
+				if(m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+
+			//Slot hasn't been filled yet, so we're empty
+			else if(dif < 0)
+				return false;
+
+			//Someone else claimed it, try again
+			else
+				pos = m_dequeuePos.load(std::memory_order_relaxed);
+		}
+
+		item = cell->m_data;
+		cell->m_sequence.store(pos + m_mask + 1, std::memory_order_release);
+		return true;
+	}
+
+	///@brief Gets the number of items the queue can hold
+	size_t capacity() const
+	{ return m_mask + 1; }
+
+	///@brief Gets the approximate number of items in the queue (exact only if the queue is quiescent)
+	size_t size() const
+	{
+		size_t head = m_dequeuePos.load(std::memory_order_relaxed);
+		size_t tail = m_enqueuePos.load(std::memory_order_relaxed);
+		return (tail > head) ? (tail - head) : 0;
+	}
+
+protected:
+
+	///@brief A single slot in the ring buffer
+	class Cell
+	{
+	public:
+		Cell()
+			: m_sequence(0)
+			, m_data()
+		{}
+
+		///@brief Position which the slot is ready for (pos if free, pos+1 if full)
+		std::atomic<size_t> m_sequence;
+
+		///@brief The item stored in the slot
+		T m_data;
+	};
+
+	///@brief The ring buffer
+	std::unique_ptr<Cell[]> m_cells;
+
+	///@brief Bitmask for converting positions to indexes in m_cells
+	size_t m_mask;
+
+	///@brief Position of the next slot to push to
+	alignas(64) std::atomic<size_t> m_enqueuePos;
+
+	///@brief Position of the next slot to pop from
+	alignas(64) std::atomic<size_t> m_dequeuePos;
+};
+
+#endif
@@ -55,9 +55,83 @@ CANChannel::~CANChannel()
 {
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CANFrameIndex
+
+/**
+	@brief Builds the index by walking the symbol stream once
+
+	@param wfm	The waveform to index (must be valid on the CPU)
+ */
+CANFrameIndex::CANFrameIndex(CANWaveform* wfm)
+{
+	size_t len = wfm->size();
+
+	Frame* frame = nullptr;
+	bool inData = false;
+	for(size_t i=0; i<len; i++)
+	{
+		auto& s = wfm->m_samples[i];
+		switch(s.m_stype)
+		{
+			//New frame
+			case CANSymbol::TYPE_ID:
+				m_framesByID[s.m_data].push_back(m_frames.size());
+				m_frames.push_back({i, 0, 0, 0});
+				frame = &m_frames.back();
+				inData = false;
+				break;
+
+			//Data bytes start right after the DLC
+			case CANSymbol::TYPE_DLC:
+				if(frame && (frame->m_dlc == 0))
+				{
+					frame->m_dlc = s.m_data;
+					frame->m_data = i+1;
+					inData = true;
+				}
+				break;
+
+			case CANSymbol::TYPE_DATA:
+				if(frame && inData)
+					frame->m_ndata ++;
+				break;
+
+			//SOF means the previous frame is over even if it was truncated
+			case CANSymbol::TYPE_SOF:
+				frame = nullptr;
+				inData = false;
+				break;
+
+			//Anything else ends the data bytes
+			default:
+				inData = false;
+				break;
+		}
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // CANWaveform
 
+///@brief Mutex protecting the frame index of every CANWaveform
+static mutex g_canFrameIndexMutex;
+
+/**
+	@brief Returns the frame index for this waveform, building it if the waveform changed since it was last built
+ */
+shared_ptr<const CANFrameIndex> CANWaveform::GetFrameIndex()
+{
+	lock_guard<mutex> lock(g_canFrameIndexMutex);
+	if(!m_frameIndex || (m_frameIndexRevision != m_revision))
+	{
+		PrepareForCpuAccess();
+		m_frameIndex = make_shared<CANFrameIndex>(this);
+		m_frameIndexRevision = m_revision;
+	}
+	return m_frameIndex;
+}
+
 string CANWaveform::GetColor(size_t i)
 {
 	const CANSymbol& s = m_samples[i];
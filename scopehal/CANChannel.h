@@ -122,6 +122,62 @@ public:
 	}
 };
 
+class CANWaveform;
+
+/**
+	@brief Locations of every frame in a CANWaveform, grouped by ID
+	@ingroup datamodel
+
+	Filters which only care about a few IDs (bitmask filters, per-signal decoders) look up their frames here instead
+	of walking the whole symbol stream. The index is built once per waveform revision by CANWaveform::GetFrameIndex()
+	and shared by every consumer.
+ */
+class CANFrameIndex
+{
+public:
+	CANFrameIndex(CANWaveform* wfm);
+
+	///@brief One frame, starting at its ID symbol
+	class Frame
+	{
+	public:
+		///@brief Sample index of the ID symbol
+		size_t m_id;
+
+		///@brief Sample index of the first data byte (only meaningful if m_ndata is nonzero)
+		size_t m_data;
+
+		///@brief Data length code, or zero if the frame ended before a DLC was seen
+		uint32_t m_dlc;
+
+		///@brief Number of consecutive data bytes decoded after the DLC (may be less than m_dlc if truncated)
+		size_t m_ndata;
+	};
+
+	///@brief All frames, in order
+	std::vector<Frame> m_frames;
+
+	/**
+		@brief Returns the indexes (into m_frames) of all frames with a given ID, in order
+
+		@param id	CAN ID, as stored in the ID symbol (extended IDs have bit 31 set)
+	 */
+	const std::vector<size_t>& GetFramesWithID(uint32_t id) const
+	{
+		auto it = m_framesByID.find(id);
+		if(it == m_framesByID.end())
+			return m_noFrames;
+		return it->second;
+	}
+
+protected:
+	///@brief Map of CAN ID to indexes of frames with that ID
+	std::unordered_map<uint32_t, std::vector<size_t>> m_framesByID;
+
+	///@brief Empty list returned for IDs which never appear
+	std::vector<size_t> m_noFrames;
+};
+
 /**
 	@brief A waveform containing CAN bus packets
 	@ingroup datamodel
@@ -129,9 +185,18 @@ public:
 class CANWaveform : public SparseWaveform<CANSymbol>
 {
 public:
-	CANWaveform () : SparseWaveform<CANSymbol>() {};
+	CANWaveform () : SparseWaveform<CANSymbol>(), m_frameIndexRevision(0) {};
 	virtual std::string GetText(size_t) override;
 	virtual std::string GetColor(size_t) override;
+
+	std::shared_ptr<const CANFrameIndex> GetFrameIndex();
+
+protected:
+	///@brief Frame index built by GetFrameIndex(), if any
+	std::shared_ptr<const CANFrameIndex> m_frameIndex;
+
+	///@brief Revision m_frameIndex was built from
+	uint64_t m_frameIndexRevision;
 };
 
 /**
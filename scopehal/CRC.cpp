@@ -0,0 +1,161 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of table-driven CRC engines
+	@ingroup core
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ReflectedCRCTable
+
+/**
+	@brief Builds the tables for a reflected CRC
+
+	@param poly	Generator polynomial in reflected form (e.g. 0xedb88320 for CRC-32, 0xa001 for CRC-16/USB)
+ */
+ReflectedCRCTable::ReflectedCRCTable(uint32_t poly)
+{
+	for(uint32_t i=0; i<256; i++)
+	{
+		uint32_t crc = i;
+		for(int j=0; j<8; j++)
+			crc = (crc & 1) ? ( (crc >> 1) ^ poly ) : (crc >> 1);
+		m_table[0][i] = crc;
+	}
+
+	for(int k=1; k<8; k++)
+	{
+		for(int i=0; i<256; i++)
+		{
+			uint32_t crc = m_table[k-1][i];
+			m_table[k][i] = (crc >> 8) ^ m_table[0][crc & 0xff];
+		}
+	}
+}
+
+/**
+	@brief Feeds a buffer through the CRC
+
+	@param crc	Current CRC register value
+	@param data	Bytes to process
+	@param len	Number of bytes
+ */
+uint32_t ReflectedCRCTable::Update(uint32_t crc, const uint8_t* data, size_t len) const
+{
+	//Eight bytes per iteration: the first four are folded into the register, the next four are independent lookups
+	while(len >= 8)
+	{
+		uint32_t lo = crc ^ (
+			data[0] |
+			(data[1] << 8) |
+			(data[2] << 16) |
+			(static_cast<uint32_t>(data[3]) << 24) );
+		uint32_t hi =
+			data[4] |
+			(data[5] << 8) |
+			(data[6] << 16) |
+			(static_cast<uint32_t>(data[7]) << 24);
+
+		crc =	m_table[7][lo & 0xff] ^
+				m_table[6][(lo >> 8) & 0xff] ^
+				m_table[5][(lo >> 16) & 0xff] ^
+				m_table[4][lo >> 24] ^
+				m_table[3][hi & 0xff] ^
+				m_table[2][(hi >> 8) & 0xff] ^
+				m_table[1][(hi >> 16) & 0xff] ^
+				m_table[0][hi >> 24];
+
+		data += 8;
+		len -= 8;
+	}
+
+	for(size_t i=0; i<len; i++)
+		crc = Update(crc, data[i]);
+	return crc;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ForwardCRCTable
+
+/**
+	@brief Builds the table for an MSB-first CRC
+
+	@param width	Width of the CRC in bits (1 to 32)
+	@param poly		Generator polynomial in normal form, without the implicit x^width term (e.g. 0x07 for CRC-8)
+ */
+ForwardCRCTable::ForwardCRCTable(unsigned int width, uint32_t poly)
+	: m_shift(32 - width)
+{
+	uint32_t alignedPoly = poly << m_shift;
+	for(uint32_t i=0; i<256; i++)
+	{
+		uint32_t crc = i << 24;
+		for(int j=0; j<8; j++)
+			crc = (crc & 0x80000000) ? ( (crc << 1) ^ alignedPoly ) : (crc << 1);
+		m_table[i] = crc;
+	}
+}
+
+/**
+	@brief Feeds a buffer through the CRC, MSB first
+
+	@param crc	Current CRC register value (right aligned, width bits)
+	@param data	Bytes to process
+	@param len	Number of bytes
+ */
+uint32_t ForwardCRCTable::Update(uint32_t crc, const uint8_t* data, size_t len) const
+{
+	uint32_t reg = crc << m_shift;
+	for(size_t i=0; i<len; i++)
+		reg = (reg << 8) ^ m_table[(reg >> 24) ^ data[i]];
+	return reg >> m_shift;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CRC-32
+
+/**
+	@brief Portable backend for SIMDKernelTable::crc32
+
+	@param crc	Current (non-inverted) CRC-32 register value
+	@param data	Bytes to process
+	@param len	Number of bytes
+ */
+uint32_t CRC32Generic(uint32_t crc, const uint8_t* data, size_t len)
+{
+	static const ReflectedCRCTable table(0xedb88320);
+	return table.Update(crc, data, len);
+}
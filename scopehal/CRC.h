@@ -0,0 +1,111 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of table-driven CRC engines
+	@ingroup core
+ */
+
+#ifndef CRC_h
+#define CRC_h
+
+/**
+	@brief Table-driven engine for LSB-first (bit reflected) CRCs up to 32 bits wide
+	@ingroup core
+
+	Covers most CRCs seen on the wire: Ethernet/PCIe CRC32, USB/Modbus CRC16, PCIe DLLP CRC16, MIPI CRC16-CCITT, etc.
+	The register is kept in the low bits and the caller is responsible for the initial value and any final
+	inversion/byte swap, so this is a drop-in replacement for the usual "crc >>= 1; if(b) crc ^= poly" bit loop.
+
+	Buffers are processed eight bytes at a time ("slicing-by-8") using eight derived tables.
+
+	Construction builds 8 KB of tables, so instances should be long lived (typically function-local statics).
+ */
+class ReflectedCRCTable
+{
+public:
+	ReflectedCRCTable(uint32_t poly);
+
+	/**
+		@brief Feeds one byte through the CRC
+
+		@param crc	Current CRC register value
+		@param data	Byte to process
+	 */
+	uint32_t Update(uint32_t crc, uint8_t data) const
+	{ return (crc >> 8) ^ m_table[0][(crc ^ data) & 0xff]; }
+
+	uint32_t Update(uint32_t crc, const uint8_t* data, size_t len) const;
+
+protected:
+
+	///@brief m_table[0] is the usual byte-at-a-time table, m_table[k] advances a byte by k further zero bytes
+	uint32_t m_table[8][256];
+};
+
+/**
+	@brief Table-driven engine for MSB-first CRCs up to 32 bits wide (e.g. eSPI CRC8, SD CRC7/CRC16)
+	@ingroup core
+
+	The register is processed left-aligned in 32 bits internally so that widths narrower than a byte work too.
+ */
+class ForwardCRCTable
+{
+public:
+	ForwardCRCTable(unsigned int width, uint32_t poly);
+
+	/**
+		@brief Feeds one byte through the CRC, MSB first
+
+		@param crc	Current CRC register value (right aligned, width bits)
+		@param data	Byte to process
+	 */
+	uint32_t Update(uint32_t crc, uint8_t data) const
+	{
+		uint32_t reg = crc << m_shift;
+		reg = (reg << 8) ^ m_table[(reg >> 24) ^ data];
+		return reg >> m_shift;
+	}
+
+	uint32_t Update(uint32_t crc, const uint8_t* data, size_t len) const;
+
+protected:
+
+	///@brief Number of unused low bits when the register is left aligned in 32 bits
+	unsigned int m_shift;
+
+	///@brief Byte-at-a-time table, left aligned
+	uint32_t m_table[256];
+};
+
+uint32_t CRC32Generic(uint32_t crc, const uint8_t* data, size_t len);
+
+#endif
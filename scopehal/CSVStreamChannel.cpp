@@ -0,0 +1,76 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of CSVStreamChannel
+	@ingroup miscdrivers
+ */
+
+#include "scopehal.h"
+#include "CSVStreamInstrument.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Initialize a CSV stream channel
+
+	@param parent	The instrument this channel is part of
+	@param hwname	Name of the channel
+	@param yunit	Unit of the values in this column
+	@param index	Position of this channel within m_channels of the parent instrument
+ */
+CSVStreamChannel::CSVStreamChannel(
+	Instrument* parent,
+	const string& hwname,
+	Unit yunit,
+	size_t index)
+	: InstrumentChannel(parent, hwname, "#808080", Unit(Unit::UNIT_FS), index)
+{
+	AddStream(yunit, "Value", Stream::STREAM_TYPE_ANALOG_SCALAR);
+	AddStream(yunit, "Samples", Stream::STREAM_TYPE_ANALOG);
+}
+
+CSVStreamChannel::~CSVStreamChannel()
+{
+}
+
+/**
+	@brief Sets the Y axis unit of both the scalar and waveform outputs
+ */
+void CSVStreamChannel::SetUnit(Unit yunit)
+{
+	SetYAxisUnits(yunit, STREAM_VALUE);
+	SetYAxisUnits(yunit, STREAM_SAMPLES);
+}
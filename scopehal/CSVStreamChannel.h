@@ -0,0 +1,71 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of CSVStreamChannel
+	@ingroup miscdrivers
+ */
+
+#ifndef CSVStreamChannel_h
+#define CSVStreamChannel_h
+
+/**
+	@brief A single column of a CSVStreamInstrument
+
+	Each channel exposes the most recent value as a scalar, plus a sparse waveform containing every value received
+	during the last acquisition, timestamped by arrival time.
+
+	@ingroup miscdrivers
+ */
+class CSVStreamChannel : public InstrumentChannel
+{
+public:
+
+	CSVStreamChannel(
+		Instrument* parent,
+		const std::string& hwname,
+		Unit yunit = Unit(Unit::UNIT_VOLTS),
+		size_t index = 0);
+
+	virtual ~CSVStreamChannel();
+
+	void SetUnit(Unit yunit);
+
+	///@brief Indexes of our output streams
+	enum StreamIndexes
+	{
+		STREAM_VALUE,		///< Most recent value (scalar)
+		STREAM_SAMPLES		///< All values from the last acquisition (sparse waveform)
+	};
+};
+
+#endif
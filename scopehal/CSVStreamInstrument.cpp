@@ -27,6 +27,7 @@
 *                                                                                                                      *
 ***********************************************************************************************************************/
 
+
 /**
 	@file
 	@author Andrew D. Zonenberg
@@ -36,6 +37,8 @@
 
 #include "scopehal.h"
 #include "CSVStreamInstrument.h"
+#include <charconv>
+#include <string_view>
 
 using namespace std;
 
@@ -50,6 +53,11 @@ using namespace std;
 CSVStreamInstrument::CSVStreamInstrument(SCPITransport* transport)
 	: SCPIDevice(transport, false)
 	, SCPIInstrument(transport, false)
+	, m_freeBlocks(BLOCK_COUNT)
+	, m_fullBlocks(BLOCK_COUNT)
+	, m_terminating(false)
+	, m_droppedBlocks(0)
+	, m_lastBatchSize(0)
 {
 	m_vendor = "Antikernel Labs";
 	m_model = "CSV Stream";
@@ -57,22 +65,41 @@ CSVStreamInstrument::CSVStreamInstrument(SCPITransport* transport)
 	m_fwVersion = "1.0";
 
 	//Create initial stream
-	m_channels.push_back(new InstrumentChannel(
-		this,
-		"CH1",
-		"#808080",
-		Unit(Unit::UNIT_COUNTS),
-		Unit(Unit::UNIT_VOLTS),
-		Stream::STREAM_TYPE_ANALOG_SCALAR,
-		0));
+	m_channels.push_back(new CSVStreamChannel(this, "CH1", Unit(Unit::UNIT_VOLTS), 0));
 
 	//needs to run *before* the Oscilloscope class implementation
 	m_preloaders.push_front(sigc::mem_fun(*this, &CSVStreamInstrument::DoPreLoadConfiguration));
+
+	//Allocate the receive buffers up front so the reader thread never has to
+	for(size_t i=0; i<BLOCK_COUNT; i++)
+	{
+		auto block = make_unique<RxBlock>();
+		block->m_data.resize(BLOCK_SIZE);
+		block->m_len = 0;
+		block->m_start = 0;
+		block->m_end = 0;
+		m_freeBlocks.Push(block.get());
+		m_blocks.push_back(move(block));
+	}
+
+	m_readerThread = thread(&CSVStreamInstrument::ReaderThread, this);
 }
 
+/**
+	@brief Stops the reader thread
+
+	The thread only checks for termination between reads, so this blocks until the read in progress completes.
+	Read sizes shrink to a few bytes when data is arriving slowly, so this is normally a few milliseconds as long as
+	the device is still streaming.
+ */
 CSVStreamInstrument::~CSVStreamInstrument()
 {
+	m_terminating = true;
+	if(m_readerThread.joinable())
+		m_readerThread.join();
 
+	for(auto w : m_pendingWaveforms)
+		delete w;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -112,118 +139,312 @@ void CSVStreamInstrument::DoPreLoadConfiguration(
 		auto index = cnode["index"].as<int>();
 
 		//If we don't have the channel yet, create it
-		while(m_channels.size() <= (size_t)index)
-		{
-			m_channels.push_back(new InstrumentChannel(
-				this,
-				string("CH") + to_string(index),
-				"#808080",
-				Unit(Unit::UNIT_COUNTS),
-				Unit(Unit::UNIT_VOLTS),
-				Stream::STREAM_TYPE_ANALOG_SCALAR,
-				m_channels.size()));
-		}
+		auto chan = GetChannel(index);
 
 		//Channel exists, register its ID
-		auto chan = m_channels[index];
 		idmap.emplace(cnode["id"].as<int>(), chan);
 	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Acquisition
+// Channel management
 
-bool CSVStreamInstrument::AcquireData()
+/**
+	@brief Gets a channel by index, creating it (and any before it) if it doesn't exist yet
+ */
+CSVStreamChannel* CSVStreamInstrument::GetChannel(size_t i)
 {
-	//Read a line of input (may or may not be relevant to us)
-	auto line = Trim(m_transport->ReadReply(false));
+	while(m_channels.size() <= i)
+	{
+		m_channels.push_back(new CSVStreamChannel(
+			this,
+			string("CH") + to_string(m_channels.size() + 1),
+			Unit(Unit::UNIT_VOLTS),
+			m_channels.size()));
+	}
 
-	//Trim off anything before "CSV" prefix and discard mismatched lines
-	auto start = line.find("CSV-");
-	if(start == string::npos)
-		return true;
-	line = line.substr(start);
+	return dynamic_cast<CSVStreamChannel*>(m_channels[i]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reader thread
 
-	//Split up at commas
-	auto fields = explode(line, ',');
+/**
+	@brief Pulls raw data from the transport into receive blocks until the instrument is destroyed
 
-	if(fields[0] == "CSV-NAME")
+	Every ReadRawData() call blocks until the requested number of bytes have arrived, so the read size adapts to the
+	incoming data rate: it grows while reads complete quickly (data was already buffered) and shrinks when a read has
+	to wait, bounding the delay before a line is seen by AcquireData() at about STREAM_LATENCY_TARGET.
+ */
+void CSVStreamInstrument::ReaderThread()
+{
+	const double STREAM_LATENCY_TARGET = 0.02;
+
+	size_t maxRead = min(m_transport->GetStreamingReadSize(), BLOCK_SIZE);
+	size_t readSize = 1;
+
+	//Somewhere to put data when the application isn't keeping up and every block is full
+	RxBlock overflow;
+	overflow.m_data.resize(BLOCK_SIZE);
+
+	while(!m_terminating)
 	{
-		//Name all of our channels
-		for(size_t i=1; i<fields.size(); i++)
+		if(!m_transport->IsConnected())
 		{
-			//Add a new channel
-			if(m_channels.size() < i)
-			{
-				m_channels.push_back(new InstrumentChannel(
-					this,
-					fields[i],
-					"#808080",
-					Unit(Unit::UNIT_COUNTS),
-					Unit(Unit::UNIT_VOLTS),
-					Stream::STREAM_TYPE_ANALOG_SCALAR,
-					i-1));
-			}
+			this_thread::sleep_for(chrono::milliseconds(100));
+			continue;
+		}
 
-			//Rename an existing channel
-			else
-				m_channels[i-1]->SetDisplayName(fields[i]);
+		RxBlock* block;
+		bool dropped = false;
+		if(!m_freeBlocks.Pop(block))
+		{
+			block = &overflow;
+			dropped = true;
 		}
+
+		double start = GetTime();
+		block->m_len = m_transport->ReadRawData(readSize, &block->m_data[0]);
+		double end = GetTime();
+
+		//Drop on the floor if we had nowhere to put it
+		if(dropped)
+		{
+			if(m_droppedBlocks++ == 0)
+				LogWarning("CSVStreamInstrument: receive buffer full, discarding data\n");
+			continue;
+		}
+
+		//Read failed or timed out
+		if(block->m_len == 0)
+		{
+			m_freeBlocks.Push(block);
+			this_thread::sleep_for(chrono::milliseconds(1));
+			continue;
+		}
+
+		//Can't fail: the queue has room for every block
+		block->m_start = start;
+		block->m_end = end;
+		m_fullBlocks.Push(block);
+
+		//Adapt the next read to the data rate
+		double elapsed = end - start;
+		if(elapsed < STREAM_LATENCY_TARGET / 2)
+			readSize = min(readSize * 2, maxRead);
+		else if(elapsed > STREAM_LATENCY_TARGET)
+			readSize = max(readSize / 2, static_cast<size_t>(1));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Acquisition
+
+bool CSVStreamInstrument::AcquireData()
+{
+	//Parse everything the reader thread has received since last time
+	RxBlock* block;
+	bool gotData = false;
+	while(m_fullBlocks.Pop(block))
+	{
+		ConsumeBlock(block);
+		m_freeBlocks.Push(block);
+		gotData = true;
 	}
 
-	else if(fields[0] == "CSV-UNIT")
+	//Don't spin if the device is quiet
+	if(!gotData)
 	{
-		//Update units, creating new channels if needed
-		for(size_t i=1; i<fields.size(); i++)
-		{
-			Unit yunit(fields[i]);
+		this_thread::sleep_for(chrono::milliseconds(1));
+		return true;
+	}
 
-			//Add a new channel
-			if(m_channels.size() < i)
-			{
-				m_channels.push_back(new InstrumentChannel(
-					this,
-					string("CH") + to_string(i),
-					"#808080",
-					Unit(Unit::UNIT_COUNTS),
-					yunit,
-					Stream::STREAM_TYPE_ANALOG_SCALAR,
-					i-1));
-			}
+	FlushWaveforms();
+	return true;
+}
+
+/**
+	@brief Splits a receive block into lines and processes each of them
+
+	Lines are timestamped by interpolating between the start and end of the read they completed in.
+ */
+void CSVStreamInstrument::ConsumeBlock(const RxBlock* block)
+{
+	auto base = reinterpret_cast<const char*>(&block->m_data[0]);
+	auto p = base;
+	auto end = base + block->m_len;
+	double dt = block->m_end - block->m_start;
 
-			//Rename an existing channel
+	while(p < end)
+	{
+		//No newline in the rest of the block? Save it for next time
+		auto nl = static_cast<const char*>(memchr(p, '\n', end - p));
+		if(!nl)
+		{
+			//Give up on lines that never end, it's probably binary junk
+			if(m_partialLine.size() + (end - p) > MAX_LINE_LENGTH)
+				m_partialLine.clear();
 			else
-				m_channels[i-1]->SetYAxisUnits(yunit, 0);
+				m_partialLine.append(p, end);
+			break;
 		}
+
+		double t = block->m_start + dt * (nl + 1 - base) / block->m_len;
+
+		if(m_partialLine.empty())
+			ProcessLine(p, nl, t);
+		else
+		{
+			m_partialLine.append(p, nl);
+			ProcessLine(m_partialLine.data(), m_partialLine.data() + m_partialLine.size(), t);
+			m_partialLine.clear();
+		}
+
+		p = nl + 1;
 	}
+}
 
-	else if(fields[0] == "CSV-DATA")
+/**
+	@brief Parses a single line of input (may or may not be relevant to us)
+
+	@param p	Start of the line
+	@param end	End of the line (not including the newline)
+	@param t	Arrival time of the line
+ */
+void CSVStreamInstrument::ProcessLine(const char* p, const char* end, double t)
+{
+	//Trim off anything before "CSV-" prefix and discard mismatched lines
+	string_view line(p, end - p);
+	auto start = line.find("CSV-");
+	if(start == string_view::npos)
+		return;
+	line = line.substr(start);
+	while(!line.empty() && isspace(line.back()))
+		line.remove_suffix(1);
+
+	//Split off the keyword
+	auto comma = line.find(',');
+	if(comma == string_view::npos)
+		return;
+	auto keyword = line.substr(0, comma);
+	auto body = line.substr(comma + 1);
+
+	if(keyword == "CSV-DATA")
 	{
 		//Update data, creating new channels if needed
-		for(size_t i=1; i<fields.size(); i++)
+		auto f = body.data();
+		auto e = f + body.size();
+		for(size_t i=0; ; i++)
 		{
-			//Add a new channel if it doesn't exist
-			if(m_channels.size() < i)
+			auto fend = static_cast<const char*>(memchr(f, ',', e - f));
+			if(!fend)
+				fend = e;
+
+			auto chan = GetChannel(i);
+
+			//Fast path for plain numbers, full unit parsing if there's a suffix
+			auto fs = f;
+			auto fe = fend;
+			while( (fs < fe) && isspace(*fs) )
+				fs++;
+			if( (fs < fe) && (*fs == '+') )
+				fs++;
+			while( (fe > fs) && isspace(fe[-1]) )
+				fe--;
+
+			float value = 0;
+			#ifdef __APPLE__
+				//No floating point from_chars, and the field is not nul terminated
+				char buf[64] = {0};
+				size_t len = min(sizeof(buf) - 1, static_cast<size_t>(fe - fs));
+				memcpy(buf, fs, len);
+				char* parsed = nullptr;
+				value = strtof(buf, &parsed);
+				bool complete = (len > 0) && (parsed == buf + len);
+			#else
+				auto res = from_chars(fs, fe, value, std::chars_format::general);
+				bool complete = (res.ec == errc()) && (res.ptr == fe);
+			#endif
+			if(!complete)
+				value = chan->GetYAxisUnits(CSVStreamChannel::STREAM_VALUE).ParseString(string(f, fend));
+
+			chan->SetScalarValue(CSVStreamChannel::STREAM_VALUE, value);
+
+			//Append to this acquisition's waveform, starting a new one if needed
+			if(m_pendingWaveforms.size() <= i)
+				m_pendingWaveforms.resize(i + 1, nullptr);
+			auto& wfm = m_pendingWaveforms[i];
+			if(!wfm)
 			{
-				m_channels.push_back(new InstrumentChannel(
-					this,
-					string("CH") + to_string(i),
-					"#808080",
-					Unit(Unit::UNIT_COUNTS),
-					Unit(Unit::UNIT_VOLTS),
-					Stream::STREAM_TYPE_ANALOG_SCALAR,
-					i-1));
+				wfm = new SparseAnalogWaveform;
+				wfm->m_timescale = 1;
+				wfm->m_triggerPhase = 0;
+				wfm->m_startTimestamp = floor(t);
+				wfm->m_startFemtoseconds = (t - floor(t)) * FS_PER_SECOND;
+				wfm->PrepareForCpuAccess();
+				wfm->Reserve(max(m_lastBatchSize * 2, static_cast<size_t>(1024)));
 			}
+			double wstart = wfm->m_startTimestamp + wfm->m_startFemtoseconds * SECONDS_PER_FS;
+			wfm->m_offsets.push_back(static_cast<int64_t>(round((t - wstart) * FS_PER_SECOND)));
+			wfm->m_samples.push_back(value);
 
-			auto value = m_channels[i-1]->GetYAxisUnits(0).ParseString(fields[i]);
-			m_channels[i-1]->SetScalarValue(0, value);
+			if(fend == e)
+				break;
+			f = fend + 1;
 		}
 	}
 
+	else if(keyword == "CSV-NAME")
+	{
+		//Name all of our channels, creating new ones if needed
+		auto fields = explode(string(body), ',');
+		for(size_t i=0; i<fields.size(); i++)
+			GetChannel(i)->SetDisplayName(fields[i]);
+	}
+
+	else if(keyword == "CSV-UNIT")
+	{
+		//Update units, creating new channels if needed
+		auto fields = explode(string(body), ',');
+		for(size_t i=0; i<fields.size(); i++)
+			GetChannel(i)->SetUnit(Unit(fields[i]));
+	}
+
 	else
 	{
 		//Nothing to do, it's probably stdout data or something irrelevant
 	}
+}
 
-	return true;
+/**
+	@brief Finishes the waveforms built by this acquisition and hands them to the channels
+ */
+void CSVStreamInstrument::FlushWaveforms()
+{
+	size_t largest = 0;
+	for(size_t i=0; i<m_pendingWaveforms.size(); i++)
+	{
+		auto wfm = m_pendingWaveforms[i];
+		if(!wfm)
+			continue;
+		m_pendingWaveforms[i] = nullptr;
+
+		//Each sample lasts until the next one arrives
+		size_t len = wfm->m_samples.size();
+		wfm->m_durations.resize(len);
+		for(size_t j=0; j+1 < len; j++)
+			wfm->m_durations[j] = wfm->m_offsets[j+1] - wfm->m_offsets[j];
+		if(len)
+			wfm->m_durations[len-1] = 1;
+		wfm->MarkModifiedFromCpu();
+
+		largest = max(largest, len);
+
+		if(i < m_channels.size())
+			m_channels[i]->SetData(wfm, CSVStreamChannel::STREAM_SAMPLES);
+		else
+			delete wfm;
+	}
+
+	m_lastBatchSize = largest;
 }
@@ -37,6 +37,11 @@
 #ifndef CSVStreamInstrument_h
 #define CSVStreamInstrument_h
 
+#include <thread>
+#include <atomic>
+#include "BoundedMPMCQueue.h"
+#include "CSVStreamChannel.h"
+
 /**
 	@brief A miscellaneous instrument which streams scalar data over CSV
 
@@ -53,6 +58,10 @@
 	* CSV-DATA,1.23,3.14, ... : specify latest measurement value for each channel.
 	It is not possible to perform partial updates of a single channel without updating the others.
 
+	A dedicated reader thread pulls raw bytes from the transport into a pool of blocks so the UART keeps draining
+	while the rest of the application is busy. Each AcquireData() call then parses everything received since the last
+	call, updating the scalar outputs with the latest values and emitting every sample as a sparse waveform.
+
 	@ingroup miscdrivers
  */
 class CSVStreamInstrument
@@ -69,6 +78,10 @@ public:
 	//Acquisition
 	virtual bool AcquireData() override;
 
+	///@brief Returns the number of received blocks discarded because the application was not keeping up
+	uint64_t GetDroppedBlockCount()
+	{ return m_droppedBlocks; }
+
 protected:
 
 	/**
@@ -76,6 +89,67 @@ protected:
 	 */
 	void DoPreLoadConfiguration(int version, const YAML::Node& node, IDTable& idmap, ConfigWarningList& list);
 
+	/**
+		@brief A chunk of raw bytes from the transport
+	 */
+	class RxBlock
+	{
+	public:
+		///@brief Raw data (sized to BLOCK_SIZE)
+		std::vector<uint8_t> m_data;
+
+		///@brief Number of valid bytes in m_data
+		size_t m_len;
+
+		///@brief Time the read was issued (approximate arrival time of the first byte)
+		double m_start;
+
+		///@brief Time the read completed (arrival time of the last byte)
+		double m_end;
+	};
+
+	void ReaderThread();
+	void ConsumeBlock(const RxBlock* block);
+	void ProcessLine(const char* p, const char* end, double t);
+	void FlushWaveforms();
+	CSVStreamChannel* GetChannel(size_t i);
+
+	///@brief Size of each receive block
+	static constexpr size_t BLOCK_SIZE = 65536;
+
+	///@brief Number of receive blocks (BLOCK_SIZE * BLOCK_COUNT is the total amount of buffering)
+	static constexpr size_t BLOCK_COUNT = 256;
+
+	///@brief Longest line we'll buffer while waiting for a newline
+	static constexpr size_t MAX_LINE_LENGTH = 65536;
+
+	///@brief Backing storage for all receive blocks
+	std::vector<std::unique_ptr<RxBlock>> m_blocks;
+
+	///@brief Receive blocks available to the reader thread
+	BoundedMPMCQueue<RxBlock*> m_freeBlocks;
+
+	///@brief Receive blocks waiting to be parsed, in arrival order
+	BoundedMPMCQueue<RxBlock*> m_fullBlocks;
+
+	///@brief Thread pulling data from the transport
+	std::thread m_readerThread;
+
+	///@brief Set to request the reader thread to exit
+	std::atomic<bool> m_terminating;
+
+	///@brief Number of blocks read with no free buffer to put them in
+	std::atomic<uint64_t> m_droppedBlocks;
+
+	///@brief Start of a line split across two receive blocks
+	std::string m_partialLine;
+
+	///@brief Waveforms being filled by the current acquisition, indexed by channel (null if no samples yet)
+	std::vector<SparseAnalogWaveform*> m_pendingWaveforms;
+
+	///@brief Number of samples in the largest waveform of the last acquisition, used to pre-size the next
+	size_t m_lastBatchSize;
+
 public:
 	static std::string GetDriverNameInternal();
 	MISC_INITPROC(CSVStreamInstrument);
@@ -0,0 +1,190 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of CompressedTimeline
+	@ingroup datamodel
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+CompressedTimeline::CompressedTimeline()
+	: m_size(0)
+	, m_impliedDurations(true)
+	, m_lastDuration(0)
+{
+	m_blockBases.SetName("CompressedTimeline.m_blockBases");
+	m_deltas.SetName("CompressedTimeline.m_deltas");
+	m_durations.SetName("CompressedTimeline.m_durations");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Conversion
+
+/**
+	@brief Compresses a set of timestamps
+
+	The input is left untouched; the caller is responsible for freeing it on success.
+
+	@param offsets		Sample offsets, in timebase ticks (must be monotonic)
+	@param durations	Sample durations, in timebase ticks
+
+	@return True on success, false if the timestamps can't be represented (a sample more than 2^32 ticks after the
+			start of its block, or a duration which doesn't fit in 32 bits). The timeline is left empty on failure.
+ */
+bool CompressedTimeline::Compress(AcceleratorBuffer<int64_t>& offsets, AcceleratorBuffer<int64_t>& durations)
+{
+	offsets.PrepareForCpuAccess();
+	durations.PrepareForCpuAccess();
+
+	size_t len = offsets.size();
+	size_t nblocks = (len + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+	m_size = 0;
+	m_blockBases.resize(nblocks);
+	m_deltas.resize(len);
+	m_durations.clear();
+
+	//Check if durations are implied, and that everything fits in 32 bits
+	m_impliedDurations = true;
+	bool durationsFit = true;
+	for(size_t i=0; i<len; i++)
+	{
+		if( (i+1 < len) && (offsets[i] + durations[i] != offsets[i+1]) )
+			m_impliedDurations = false;
+		if( (durations[i] < 0) || (durations[i] > UINT32_MAX) )
+			durationsFit = false;
+	}
+	if(!m_impliedDurations && !durationsFit)
+	{
+		m_blockBases.clear();
+		m_deltas.clear();
+		return false;
+	}
+
+	//Pack offsets
+	for(size_t block=0; block<nblocks; block++)
+	{
+		size_t start = block * BLOCK_SIZE;
+		size_t end = min(len, start + BLOCK_SIZE);
+
+		int64_t base = offsets[start];
+		m_blockBases[block] = base;
+		for(size_t i=start; i<end; i++)
+		{
+			int64_t delta = offsets[i] - base;
+			if( (delta < 0) || (delta > UINT32_MAX) )
+			{
+				m_blockBases.clear();
+				m_deltas.clear();
+				return false;
+			}
+			m_deltas[i] = delta;
+		}
+	}
+
+	//Pack durations
+	if(m_impliedDurations)
+		m_lastDuration = len ? durations[len-1] : 0;
+	else
+	{
+		m_durations.resize(len);
+		for(size_t i=0; i<len; i++)
+			m_durations[i] = durations[i];
+		m_durations.MarkModifiedFromCpu();
+	}
+
+	m_blockBases.MarkModifiedFromCpu();
+	m_deltas.MarkModifiedFromCpu();
+	m_size = len;
+	return true;
+}
+
+/**
+	@brief Expands the timeline back into full 64-bit offsets and durations, then frees the compressed copy
+
+	@param offsets		Output sample offsets
+	@param durations	Output sample durations
+ */
+void CompressedTimeline::Expand(AcceleratorBuffer<int64_t>& offsets, AcceleratorBuffer<int64_t>& durations)
+{
+	PrepareForCpuAccess();
+
+	offsets.resize(m_size);
+	durations.resize(m_size);
+	offsets.PrepareForCpuAccess();
+	durations.PrepareForCpuAccess();
+
+	for(size_t i=0; i<m_size; i++)
+		offsets[i] = GetOffset(i);
+	for(size_t i=0; i<m_size; i++)
+		durations[i] = GetDuration(i);
+
+	offsets.MarkModifiedFromCpu();
+	durations.MarkModifiedFromCpu();
+
+	m_size = 0;
+	m_blockBases.clear();
+	m_blockBases.shrink_to_fit();
+	m_deltas.clear();
+	m_deltas.shrink_to_fit();
+	m_durations.clear();
+	m_durations.shrink_to_fit();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Memory management
+
+/**
+	@brief Makes the compressed timestamps available for CPU access
+ */
+void CompressedTimeline::PrepareForCpuAccess()
+{
+	m_blockBases.PrepareForCpuAccess();
+	m_deltas.PrepareForCpuAccess();
+	m_durations.PrepareForCpuAccess();
+}
+
+/**
+	@brief Makes the compressed timestamps available for GPU access
+ */
+void CompressedTimeline::PrepareForGpuAccess()
+{
+	m_blockBases.PrepareForGpuAccess();
+	m_deltas.PrepareForGpuAccess();
+	m_durations.PrepareForGpuAccess();
+}
@@ -0,0 +1,113 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of CompressedTimeline
+	@ingroup datamodel
+ */
+
+#ifndef CompressedTimeline_h
+#define CompressedTimeline_h
+
+/**
+	@brief Compact storage for the offsets and durations of a sparse waveform
+	@ingroup datamodel
+
+	Uncompressed sparse waveforms spend 16 bytes per sample on timestamps, which dwarfs the payload of most protocol
+	decodes. Here offsets are stored as a 64-bit base per block of BLOCK_SIZE samples plus a 32-bit delta per sample.
+	If every sample ends where the next one begins, durations are implied by the next offset and only the duration
+	of the last sample is kept; otherwise durations are stored as 32-bit values.
+
+	Random access stays O(1) on both CPU and GPU (see CompressedTimeline.glsl).
+ */
+class CompressedTimeline
+{
+public:
+	///@brief Number of samples sharing one base offset
+	static constexpr size_t BLOCK_SIZE = 1024;
+
+	CompressedTimeline();
+
+	bool Compress(AcceleratorBuffer<int64_t>& offsets, AcceleratorBuffer<int64_t>& durations);
+	void Expand(AcceleratorBuffer<int64_t>& offsets, AcceleratorBuffer<int64_t>& durations);
+
+	///@brief Gets the offset of sample i, in timebase ticks
+	int64_t GetOffset(size_t i) const
+	{ return m_blockBases[i / BLOCK_SIZE] + m_deltas[i]; }
+
+	///@brief Gets the duration of sample i, in timebase ticks
+	int64_t GetDuration(size_t i) const
+	{
+		if(!m_impliedDurations)
+			return m_durations[i];
+		if(i+1 == m_size)
+			return m_lastDuration;
+		return GetOffset(i+1) - GetOffset(i);
+	}
+
+	///@brief Returns the number of samples
+	size_t size() const
+	{ return m_size; }
+
+	///@brief Returns true if durations are implied by the next sample's offset rather than stored
+	bool HasImpliedDurations() const
+	{ return m_impliedDurations; }
+
+	///@brief Returns the number of bytes of sample storage used
+	size_t GetMemoryUsage() const
+	{ return m_blockBases.size()*sizeof(int64_t) + (m_deltas.size() + m_durations.size())*sizeof(uint32_t); }
+
+	void PrepareForCpuAccess();
+	void PrepareForGpuAccess();
+
+	///@brief Base offset of each block
+	AcceleratorBuffer<int64_t> m_blockBases;
+
+	///@brief Offset of each sample relative to its block base
+	AcceleratorBuffer<uint32_t> m_deltas;
+
+	///@brief Duration of each sample (empty if m_impliedDurations is set)
+	AcceleratorBuffer<uint32_t> m_durations;
+
+protected:
+
+	///@brief Number of samples
+	size_t m_size;
+
+	///@brief True if durations are implied
+	bool m_impliedDurations;
+
+	///@brief Duration of the last sample, if durations are implied
+	int64_t m_lastDuration;
+};
+
+#endif
@@ -35,6 +35,8 @@
 
 #include "../scopehal/scopehal.h"
 #include "PipelineCacheManager.h"
+#include "PipelineWarmupQueue.h"
+#include "ShaderBundle.h"
 
 using namespace std;
 
@@ -47,28 +49,39 @@ using namespace std;
 	Initialization is deferred until the first time the shader is bound. This allows creation of a ComputePipeline
 	object to be relatively inexpensive (so many pipelines can be created which may not ever be used).
 
+	If the pipeline warmup queue is running, the pipeline is also queued for creation in the background so it's
+	likely to be ready by the time it's first bound.
+
 	@param shaderPath			Path to the compiled shader binary
 	@param numSSBOs				Number of SSBO bindings
 	@param pushConstantSize		Size in bytes of our push constants
 	@param numStorageImages		Number of output image bindings
 	@param numSampledImages		Number of input image bindings
+	@param specializationConstants	Values of the shader's specialization constants, indexed by constant_id
  */
 ComputePipeline::ComputePipeline(
 	const string& shaderPath,
 	size_t numSSBOs,
 	size_t pushConstantSize,
 	size_t numStorageImages,
-	size_t numSampledImages)
+	size_t numSampledImages,
+	const vector<uint32_t>& specializationConstants)
 	: m_shaderPath(shaderPath)
 	, m_numSSBOs(numSSBOs)
 	, m_numStorageImages(numStorageImages)
 	, m_numSampledImages(numSampledImages)
 	, m_pushConstantSize(pushConstantSize)
+	, m_specializationConstants(specializationConstants)
+	, m_initialized(false)
+	, m_descriptorsDirty(true)
 {
 	m_writeDescriptors.resize(numSSBOs + numStorageImages + numSampledImages);
 	m_bufferInfo.resize(numSSBOs);
 	m_storageImageInfo.resize(numStorageImages);
 	m_sampledImageInfo.resize(numSampledImages);
+
+	if(g_pipelineWarmupQueue)
+		g_pipelineWarmupQueue->Add(this);
 }
 
 /**
@@ -82,36 +95,54 @@ ComputePipeline::ComputePipeline(
 	@param pushConstantSize		Size in bytes of our push constants
 	@param numStorageImages		Number of output image bindings
 	@param numSampledImages		Number of input image bindings
+	@param specializationConstants	Values of the shader's specialization constants, indexed by constant_id
  */
 void ComputePipeline::Reinitialize(
 	const string& shaderPath,
 	size_t numSSBOs,
 	size_t pushConstantSize,
 	size_t numStorageImages,
-	size_t numSampledImages)
+	size_t numSampledImages,
+	const vector<uint32_t>& specializationConstants)
 {
-	//Copy paths
-	m_shaderPath = shaderPath;
-	m_numSSBOs = numSSBOs;
-	m_numStorageImages = numStorageImages;
-	m_numSampledImages = numSampledImages;
-	m_pushConstantSize = pushConstantSize;
-
-	//Resize arrays
-	m_writeDescriptors.resize(numSSBOs + numStorageImages + numSampledImages);
-	m_bufferInfo.resize(numSSBOs);
-	m_storageImageInfo.resize(numStorageImages);
-	m_sampledImageInfo.resize(numSampledImages);
+	//Don't pull the state out from under a background warmup of the old shader
+	{
+		lock_guard<mutex> lock(m_initMutex);
 
-	//Clear all of our deferred state
-	m_computePipeline = nullptr;
-	m_descriptorSetLayout = nullptr;
-	m_pipelineLayout = nullptr;
-	m_shaderModule = nullptr;
+		//Copy paths
+		m_shaderPath = shaderPath;
+		m_numSSBOs = numSSBOs;
+		m_numStorageImages = numStorageImages;
+		m_numSampledImages = numSampledImages;
+		m_pushConstantSize = pushConstantSize;
+		m_specializationConstants = specializationConstants;
+
+		//Resize arrays
+		m_writeDescriptors.resize(numSSBOs + numStorageImages + numSampledImages);
+		m_bufferInfo.resize(numSSBOs);
+		m_storageImageInfo.resize(numStorageImages);
+		m_sampledImageInfo.resize(numSampledImages);
+
+		//Clear all of our deferred state
+		m_computePipeline = nullptr;
+		m_descriptorSetLayout = nullptr;
+		m_pipelineLayout = nullptr;
+		m_shaderModule = nullptr;
+		m_initialized = false;
+	}
+
+	//Queue the new shader for warmup (outside the init lock, the warmup workers take that after the queue lock)
+	if(g_pipelineWarmupQueue)
+		g_pipelineWarmupQueue->Add(this);
 }
 
 ComputePipeline::~ComputePipeline()
 {
+	//Make sure no warmup worker is, or will be, touching us
+	if(g_pipelineWarmupQueue)
+		g_pipelineWarmupQueue->Remove(this);
+	lock_guard<mutex> lock(m_initMutex);
+
 	//Make sure we destroy some objects in a particular order
 	//TODO: how much of this really is important?
 	m_computePipeline = nullptr;
@@ -123,21 +154,68 @@ ComputePipeline::~ComputePipeline()
 /**
 	@brief Performs deferred initialization of the compute pipeline the first time the object is used.
 
-	This function actually loads the shader binary and creates descriptor sets etc.
+	This function actually loads the shader binary and creates descriptor sets etc. If the warmup queue is creating
+	the pipeline right now, waits for it to finish instead.
  */
 void ComputePipeline::DeferredInit()
 {
-	//Look up the pipeline cache to see if we have a binary etc to use
-	time_t tstamp = 0;
-	int64_t fs = 0;
-	GetTimestampOfFile(FindDataFile(m_shaderPath), tstamp, fs);
+	lock_guard<mutex> lock(m_initMutex);
+	if(m_initialized)
+		return;
+
+	//If nothing created the pipeline ahead of time, whoever needed it first had to wait for it
+	double start = GetTime();
+	CreatePipeline();
+	PerformanceCounters::GetThreadCounters().m_pipelineStallTime += GetTime() - start;
+	m_initialized = true;
+}
+
+/**
+	@brief Creates the shader module, pipeline, and descriptor sets
+
+	The caller must hold m_initMutex.
+ */
+void ComputePipeline::CreatePipeline()
+{
+	//Use the copy of the shader linked into the library if there is one, so we don't have to go looking on disk.
+	//Cached pipelines are only valid for the exact SPIR-V they were built from, so version them by its content hash.
+	//Shaders loaded from disk are versioned by their CRC and size instead (reinstalling identical shaders with new
+	//timestamps keeps the cache warm, rebuilding them invalidates it).
+	const uint32_t* code = nullptr;
+	size_t words = 0;
+	uint64_t hash = 0;
+	vector<uint32_t> srcvec;
+	int64_t version = 0;
+	if(ShaderBundle::Lookup(m_shaderPath, code, words, hash))
+		version = static_cast<int64_t>(hash);
+	else
+	{
+		srcvec = ReadDataFileUint32(m_shaderPath);
+		code = srcvec.data();
+		words = srcvec.size();
+
+		size_t srcbytes = words * sizeof(uint32_t);
+		if(srcbytes)
+		{
+			version = (static_cast<int64_t>(srcbytes) << 32) |
+				CRC32(reinterpret_cast<const uint8_t*>(code), 0, srcbytes - 1);
+		}
+	}
+
+	//Look up the pipeline cache to see if we have a binary etc to use.
+	//Every set of specialization constants compiles to different code, so needs its own cache entry
 	auto shaderBase = BaseName(m_shaderPath);
-	auto cache = g_pipelineCacheMgr->Lookup(shaderBase, tstamp);
+	for(auto c : m_specializationConstants)
+		shaderBase += "_" + to_string(c);
+	auto cache = g_pipelineCacheMgr->Lookup(shaderBase, version);
 
-	//Load the shader module
-	auto srcvec = ReadDataFileUint32(m_shaderPath);
-	vk::ShaderModuleCreateInfo info({}, srcvec);
-	m_shaderModule = make_unique<vk::raii::ShaderModule>(*g_vkComputeDevice, info);
+	//Embedded shaders share one module between every pipeline using them
+	m_shaderModule = ShaderBundle::GetModule(m_shaderPath);
+	if(!m_shaderModule)
+	{
+		vk::ShaderModuleCreateInfo info({}, words * sizeof(uint32_t), code);
+		m_shaderModule = make_shared<vk::raii::ShaderModule>(*g_vkComputeDevice, info);
+	}
 
 	//Configure shader input bindings
 	vector<vk::DescriptorSetLayoutBinding> bindings;
@@ -181,8 +259,23 @@ void ComputePipeline::DeferredInit()
 		range);
 	m_pipelineLayout = make_unique<vk::raii::PipelineLayout>(*g_vkComputeDevice, linfo);
 
+	//Specialization constants are packed one uint32 per constant ID
+	vector<vk::SpecializationMapEntry> specEntries;
+	for(size_t i=0; i<m_specializationConstants.size(); i++)
+		specEntries.push_back(vk::SpecializationMapEntry(i, i * sizeof(uint32_t), sizeof(uint32_t)));
+	vk::SpecializationInfo specInfo(
+		specEntries.size(),
+		specEntries.data(),
+		m_specializationConstants.size() * sizeof(uint32_t),
+		m_specializationConstants.data());
+
 	//Make the pipeline
-	vk::PipelineShaderStageCreateInfo stageinfo({}, vk::ShaderStageFlagBits::eCompute, **m_shaderModule, "main");
+	vk::PipelineShaderStageCreateInfo stageinfo(
+		{},
+		vk::ShaderStageFlagBits::eCompute,
+		**m_shaderModule,
+		"main",
+		m_specializationConstants.empty() ? nullptr : &specInfo);
 	vk::ComputePipelineCreateInfo pinfo({}, stageinfo, **m_pipelineLayout);
 	m_computePipeline = make_unique<vk::raii::Pipeline>(
 		std::move(g_vkComputeDevice->createComputePipelines(*cache, pinfo).front()));
@@ -210,6 +303,26 @@ void ComputePipeline::DeferredInit()
 			std::move(vk::raii::DescriptorSets(*g_vkComputeDevice, dsinfo).front()));
 	}
 
+	//Build the descriptor writes once, so binding only has to fill in the buffer and image info
+	vk::DescriptorSet dset = g_hasPushDescriptor ? vk::DescriptorSet() : **m_descriptorSet;
+	size_t slot = 0;
+	for(size_t i=0; i<m_numSSBOs; i++, slot++)
+	{
+		m_writeDescriptors[slot] =
+			vk::WriteDescriptorSet(dset, slot, 0, vk::DescriptorType::eStorageBuffer, {}, m_bufferInfo[i]);
+	}
+	for(size_t i=0; i<m_numStorageImages; i++, slot++)
+	{
+		m_writeDescriptors[slot] =
+			vk::WriteDescriptorSet(dset, slot, 0, vk::DescriptorType::eStorageImage, m_storageImageInfo[i]);
+	}
+	for(size_t i=0; i<m_numSampledImages; i++, slot++)
+	{
+		m_writeDescriptors[slot] =
+			vk::WriteDescriptorSet(dset, slot, 0, vk::DescriptorType::eCombinedImageSampler, m_sampledImageInfo[i]);
+	}
+	m_descriptorsDirty = true;
+
 	//Name the various resources
 	if(g_hasDebugUtils)
 	{
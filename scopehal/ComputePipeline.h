@@ -38,6 +38,8 @@
 
 #include "scopehal.h"
 #include "AcceleratorBuffer.h"
+#include <atomic>
+#include <mutex>
 
 /**
 	@brief Encapsulates a Vulkan compute pipeline and all necessary resources to use it.
@@ -49,6 +51,10 @@
 	Prefers KHR_push_descriptor (and some APIs are only available if it is present), but basic functionality is
 	available without it.
 
+	Shaders may declare specialization constants (constant_id 0, 1, 2...) for anything fixed for the lifetime of the
+	pipeline, such as workgroup size or which variant of an algorithm to run. The driver then compiles the unused
+	branches out. Each distinct set of values is a separate pipeline with its own cache entry.
+
 	@ingroup vksupport
  */
 class ComputePipeline
@@ -59,7 +65,8 @@ public:
 		size_t numSSBOs,
 		size_t pushConstantSize,
 		size_t numStorageImages = 0,
-		size_t numSampledImages = 0);
+		size_t numSampledImages = 0,
+		const std::vector<uint32_t>& specializationConstants = {});
 	virtual ~ComputePipeline();
 
 	void Reinitialize(
@@ -67,7 +74,8 @@ public:
 		size_t numSSBOs,
 		size_t pushConstantSize,
 		size_t numStorageImages = 0,
-		size_t numSampledImages = 0);
+		size_t numSampledImages = 0,
+		const std::vector<uint32_t>& specializationConstants = {});
 
 	/**
 		@brief Binds an input or output SSBO to a descriptor slot
@@ -82,22 +90,11 @@ public:
 	template<class T>
 	void BindBuffer(size_t i, AcceleratorBuffer<T>& buf, bool outputOnly = false)
 	{
-		if(m_computePipeline == nullptr)
+		if(!m_initialized)
 			DeferredInit();
 
 		buf.PrepareForGpuAccess(outputOnly);
-
-		m_bufferInfo[i] = buf.GetBufferInfo();
-		if(g_hasPushDescriptor)
-		{
-			m_writeDescriptors[i] =
-				vk::WriteDescriptorSet(nullptr, i, 0, vk::DescriptorType::eStorageBuffer, {}, m_bufferInfo[i]);
-		}
-		else
-		{
-			m_writeDescriptors[i] =
-				vk::WriteDescriptorSet(**m_descriptorSet, i, 0, vk::DescriptorType::eStorageBuffer, {}, m_bufferInfo[i]);
-		}
+		SetBufferInfo(i, buf.GetBufferInfo());
 	}
 
 	/**
@@ -110,22 +107,10 @@ public:
 	 */
 	void BindStorageImage(size_t i, vk::Sampler sampler, vk::ImageView view, vk::ImageLayout layout)
 	{
-		if(m_computePipeline == nullptr)
+		if(!m_initialized)
 			DeferredInit();
 
-		size_t numImage = i - m_numSSBOs;
-		m_storageImageInfo[numImage] = vk::DescriptorImageInfo(sampler, view, layout);
-
-		if(g_hasPushDescriptor)
-		{
-			m_writeDescriptors[i] = vk::WriteDescriptorSet(
-				nullptr, i, 0, vk::DescriptorType::eStorageImage, m_storageImageInfo[numImage]);
-		}
-		else
-		{
-			m_writeDescriptors[i] = vk::WriteDescriptorSet(
-				**m_descriptorSet, i, 0, vk::DescriptorType::eStorageImage, m_storageImageInfo[numImage]);
-		}
+		SetImageInfo(m_storageImageInfo[i - m_numSSBOs], vk::DescriptorImageInfo(sampler, view, layout));
 	}
 
 	/**
@@ -138,22 +123,12 @@ public:
 	 */
 	void BindSampledImage(size_t i, vk::Sampler sampler, vk::ImageView view, vk::ImageLayout layout)
 	{
-		if(m_computePipeline == nullptr)
+		if(!m_initialized)
 			DeferredInit();
 
-		size_t numImage = i - (m_numSSBOs + m_numStorageImages);
-		m_sampledImageInfo[numImage] = vk::DescriptorImageInfo(sampler, view, layout);
-
-		if(g_hasPushDescriptor)
-		{
-			m_writeDescriptors[i] = vk::WriteDescriptorSet(
-				nullptr, i, 0, vk::DescriptorType::eCombinedImageSampler, m_sampledImageInfo[numImage]);
-		}
-		else
-		{
-			m_writeDescriptors[i] = vk::WriteDescriptorSet(
-				**m_descriptorSet, i, 0, vk::DescriptorType::eCombinedImageSampler, m_sampledImageInfo[numImage]);
-		}
+		SetImageInfo(
+			m_sampledImageInfo[i - (m_numSSBOs + m_numStorageImages)],
+			vk::DescriptorImageInfo(sampler, view, layout));
 	}
 
 	/**
@@ -177,22 +152,11 @@ public:
 			return;
 		}
 
-		if(m_computePipeline == nullptr)
+		if(!m_initialized)
 			DeferredInit();
 
 		buf.PrepareForGpuAccessNonblocking(outputOnly, cmdBuf);
-
-		m_bufferInfo[i] = buf.GetBufferInfo();
-		if(g_hasPushDescriptor)
-		{
-			m_writeDescriptors[i] =
-				vk::WriteDescriptorSet(nullptr, i, 0, vk::DescriptorType::eStorageBuffer, {}, m_bufferInfo[i]);
-		}
-		else
-		{
-			m_writeDescriptors[i] =
-				vk::WriteDescriptorSet(**m_descriptorSet, i, 0, vk::DescriptorType::eStorageBuffer, {}, m_bufferInfo[i]);
-		}
+		SetBufferInfo(i, buf.GetBufferInfo());
 	}
 
 	/**
@@ -218,7 +182,7 @@ public:
 	 */
 	void Bind(vk::raii::CommandBuffer& cmdBuf)
 	{
-		if(m_computePipeline == nullptr)
+		if(!m_initialized)
 			DeferredInit();
 		cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, **m_computePipeline);
 	}
@@ -226,8 +190,9 @@ public:
 	/**
 		@brief Adds a vkCmdDispatch operation to a command buffer to execute the compute shader.
 
-		If KHR_push_descriptor is not available, performs an updateDescriptorSets. This means only one Dispatch()
-		of a given ComputePipeline can be present in a command buffer at a time.
+		If KHR_push_descriptor is not available, performs an updateDescriptorSets if any binding changed since the
+		last Dispatch(). This means only one Dispatch() of a given ComputePipeline with a given set of bindings can be
+		present in a command buffer at a time.
 
 		If KHR_push_descriptor is available, performs a pushDescriptorSetKHR. In this case, arbitrarily many Dispatch()
 		calls on the same ComputePipeline may be submitted to the same command buffer in sequence.
@@ -241,8 +206,11 @@ public:
 	template<class T>
 	void Dispatch(vk::raii::CommandBuffer& cmdBuf, T pushConstants, uint32_t x, uint32_t y=1, uint32_t z=1)
 	{
-		if(!g_hasPushDescriptor)
+		if(!g_hasPushDescriptor && m_descriptorsDirty)
+		{
 			g_vkComputeDevice->updateDescriptorSets(m_writeDescriptors, nullptr);
+			m_descriptorsDirty = false;
+		}
 
 		Bind(cmdBuf);
 		cmdBuf.pushConstants<T>(
@@ -272,6 +240,56 @@ public:
 		cmdBuf.dispatch(x, y, z);
 	}
 
+	/**
+		@brief Adds a vkCmdDispatchIndirect operation to a command buffer, sized by a count computed on the GPU
+
+		Descriptors are handled exactly as by Dispatch(). DeviceLength::PrepareDispatch() must have been recorded
+		for the same length and this shader's workgroup size since the count was last written.
+
+		@param cmdBuf			Command buffer to append the dispatch operation to
+		@param pushConstants	Constants to pass to the shader
+		@param length			Count determining the number of thread blocks
+	 */
+	template<class T>
+	void DispatchIndirect(vk::raii::CommandBuffer& cmdBuf, T pushConstants, DeviceLength& length)
+	{
+		if(!g_hasPushDescriptor && m_descriptorsDirty)
+		{
+			g_vkComputeDevice->updateDescriptorSets(m_writeDescriptors, nullptr);
+			m_descriptorsDirty = false;
+		}
+
+		Bind(cmdBuf);
+		cmdBuf.pushConstants<T>(
+			**m_pipelineLayout,
+			vk::ShaderStageFlagBits::eCompute,
+			0,
+			pushConstants);
+
+		if(g_hasPushDescriptor)
+		{
+			cmdBuf.pushDescriptorSetKHR(
+				vk::PipelineBindPoint::eCompute,
+				**m_pipelineLayout,
+				0,
+			m_writeDescriptors
+			);
+		}
+		else
+		{
+			cmdBuf.bindDescriptorSets(
+				vk::PipelineBindPoint::eCompute,
+				**m_pipelineLayout,
+				0,
+				**m_descriptorSet,
+				{});
+		}
+
+		auto& buf = length.GetBuffer();
+		buf.PrepareForGpuAccessNonblocking(false, cmdBuf);
+		cmdBuf.dispatchIndirect(buf.GetBuffer(), DeviceLength::DISPATCH_INDEX * sizeof(uint32_t));
+	}
+
 	/**
 		@brief Similar to Dispatch() but does not bind descriptor sets.
 
@@ -309,9 +327,44 @@ public:
 	}
 
 protected:
+	friend class PipelineWarmupQueue;
+
 	void DeferredInit();
+	void CreatePipeline();
+
+	/**
+		@brief Updates the buffer bound to an SSBO slot
+
+		m_writeDescriptors already points at m_bufferInfo, so this is all binding takes with push descriptors. Without
+		them, the descriptor set is only rewritten if something actually changed, since most filters bind the same
+		buffers every time they run.
+	 */
+	void SetBufferInfo(size_t i, const vk::DescriptorBufferInfo& info)
+	{
+		if(m_bufferInfo[i] != info)
+		{
+			m_bufferInfo[i] = info;
+			m_descriptorsDirty = true;
+		}
+	}
 
-	///@brief Filesystem path to the compiled SPIR-V shader binary
+	///@brief Updates the image bound to an image slot (see SetBufferInfo())
+	void SetImageInfo(vk::DescriptorImageInfo& slot, const vk::DescriptorImageInfo& info)
+	{
+		if(slot != info)
+		{
+			slot = info;
+			m_descriptorsDirty = true;
+		}
+	}
+
+	///@brief Held while the pipeline is being created, either on first use or by PipelineWarmupQueue
+	std::mutex m_initMutex;
+
+	///@brief True once all of the deferred state has been created
+	std::atomic<bool> m_initialized;
+
+	///@brief Path to the compiled SPIR-V shader binary (only the file name is used if the shader is embedded)
 	std::string m_shaderPath;
 
 	///@brief Number of SSBO bindings in the shader
@@ -326,8 +379,11 @@ protected:
 	///@brief Size of the push constants, in bytes
 	size_t m_pushConstantSize;
 
-	///@brief Handle to the shader module object
-	std::unique_ptr<vk::raii::ShaderModule> m_shaderModule;
+	///@brief Values of the shader's specialization constants, indexed by constant_id
+	std::vector<uint32_t> m_specializationConstants;
+
+	///@brief Handle to the shader module object (shared with other pipelines if the shader is embedded)
+	std::shared_ptr<vk::raii::ShaderModule> m_shaderModule;
 
 	///@brief Handle to the Vulkan compute pipeline
 	std::unique_ptr<vk::raii::Pipeline> m_computePipeline;
@@ -344,9 +400,12 @@ protected:
 	///@brief The actual descriptor set storing our inputs and outputs
 	std::unique_ptr<vk::raii::DescriptorSet> m_descriptorSet;
 
-	///@brief Set of bindings to be written to m_descriptorSet
+	///@brief Set of bindings to be written to m_descriptorSet (or pushed), pointing at the info arrays below
 	std::vector<vk::WriteDescriptorSet> m_writeDescriptors;
 
+	///@brief True if bindings changed since m_descriptorSet was last updated
+	bool m_descriptorsDirty;
+
 	///@brief Details about our SSBOs
 	std::vector<vk::DescriptorBufferInfo> m_bufferInfo;
 
@@ -35,6 +35,7 @@
  */
 
 #include "../scopehal/scopehal.h"
+#include "EyeWaveform.h"
 #include "ConstellationWaveform.h"
 #include <algorithm>
 
@@ -48,16 +49,19 @@ ConstellationWaveform::ConstellationWaveform(size_t width, size_t height)
 	, m_saturationLevel(1)
 	, m_totalSymbols(0)
 {
+	m_accumdata.SetCpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
+	m_accumdata.SetGpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
+
 	size_t npix = width*height;
-	m_accumdata = new int64_t[npix];
+	m_accumdata.resize(npix);
+	m_accumdata.PrepareForCpuAccess();
 	for(size_t i=0; i<npix; i++)
 		m_accumdata[i] = 0;
+	m_accumdata.MarkModifiedFromCpu();
 }
 
 ConstellationWaveform::~ConstellationWaveform()
 {
-	delete[] m_accumdata;
-	m_accumdata = NULL;
 }
 
 /**
@@ -69,9 +73,10 @@ void ConstellationWaveform::Normalize()
 {
 	//Preprocessing
 	int64_t nmax = 0;
+	auto accum = GetAccumData();
 	for(size_t y=0; y<m_height; y++)
 	{
-		int64_t* row = m_accumdata + y*m_width;
+		int64_t* row = accum + y*m_width;
 
 		//Find peak amplitude
 		for(size_t x=0; x<m_width; x++)
@@ -81,11 +86,38 @@ void ConstellationWaveform::Normalize()
 		nmax = 1;
 	float norm = 2.0f / nmax;
 
-	//TODO: do this in a shader?
 	norm *= m_saturationLevel;
 	size_t len = m_width * m_height;
 	m_outdata.PrepareForCpuAccess();
 	for(size_t i=0; i<len; i++)
-		m_outdata[i] = min(1.0f, m_accumdata[i] * norm);
+		m_outdata[i] = min(1.0f, accum[i] * norm);
 	m_outdata.MarkModifiedFromCpu();
 }
+
+/**
+	@brief Normalizes the waveform on the GPU
+
+	Unlike eye patterns there is no reduction pass: the peak pixel value must already be in nmaxBuf, as left there by
+	the accumulation kernel. The dispatch is recorded into an already open command buffer.
+
+	@param cmdBuf				Command buffer to record into
+	@param normalizeScalePipe	Pipeline for EyeNormalizeScale.glsl
+	@param nmaxBuf				Peak accumulator value
+ */
+void ConstellationWaveform::Normalize(
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<ComputePipeline> normalizeScalePipe,
+	AcceleratorBuffer<int64_t>& nmaxBuf)
+{
+	EyeNormalizeConstants cfg;
+	cfg.width = m_width;
+	cfg.height = m_height;
+	cfg.satLevel = m_saturationLevel;
+
+	normalizeScalePipe->BindBufferNonblocking(0, m_accumdata, cmdBuf);
+	normalizeScalePipe->BindBufferNonblocking(1, nmaxBuf, cmdBuf);
+	normalizeScalePipe->BindBufferNonblocking(2, m_outdata, cmdBuf);
+	normalizeScalePipe->Dispatch(cmdBuf, cfg, GetComputeBlockCount(m_height, 64));
+
+	m_outdata.MarkModifiedFromGpu();
+}
@@ -54,11 +54,22 @@ public:
 	ConstellationWaveform(const ConstellationWaveform&) =delete;
 	ConstellationWaveform& operator=(const ConstellationWaveform&) =delete;
 
-	///@brief Returns the raw accumulator sample data
+	///@brief Returns a pointer to the raw accumulator sample data, prepared for CPU access
 	int64_t* GetAccumData()
+	{
+		m_accumdata.PrepareForCpuAccess();
+		return m_accumdata.GetCpuPointer();
+	}
+
+	///@brief Returns the raw accumulator buffer
+	AcceleratorBuffer<int64_t>& GetAccumBuffer()
 	{ return m_accumdata; }
 
 	void Normalize();
+	void Normalize(
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<ComputePipeline> normalizeScalePipe,
+		AcceleratorBuffer<int64_t>& nmaxBuf);
 
 	///@brief Returns the number of integrated symbols in the constellation
 	size_t GetTotalSymbols()
@@ -86,10 +97,53 @@ public:
 	float m_saturationLevel;
 
 	virtual void FreeGpuMemory() override
-	{}
+	{ m_accumdata.FreeGpuBuffer(); }
 
 	virtual bool HasGpuBuffer() override
-	{ return false; }
+	{ return m_accumdata.HasGpuBuffer(); }
+
+	virtual void PrepareForCpuAccess() override
+	{
+		m_outdata.PrepareForCpuAccess();
+		m_accumdata.PrepareForCpuAccess();
+	}
+
+	virtual ReadbackFuture PrepareForCpuAccessAsync() override
+	{
+		auto ret = m_outdata.PrepareForCpuAccessAsync();
+		ret.Merge(m_accumdata.PrepareForCpuAccessAsync());
+		return ret;
+	}
+
+	virtual void PrepareForGpuAccess() override
+	{
+		m_outdata.PrepareForGpuAccess();
+		m_accumdata.PrepareForGpuAccess();
+	}
+
+	virtual void MarkSamplesModifiedFromCpu() override
+	{
+		m_outdata.MarkModifiedFromCpu();
+		m_accumdata.MarkModifiedFromCpu();
+	}
+
+	virtual void MarkSamplesModifiedFromGpu() override
+	{
+		m_outdata.MarkModifiedFromGpu();
+		m_accumdata.MarkModifiedFromGpu();
+	}
+
+	virtual void MarkModifiedFromCpu() override
+	{
+		m_outdata.MarkModifiedFromCpu();
+		m_accumdata.MarkModifiedFromCpu();
+	}
+
+	virtual void MarkModifiedFromGpu() override
+	{
+		m_outdata.MarkModifiedFromGpu();
+		m_accumdata.MarkModifiedFromGpu();
+	}
 
 protected:
 
@@ -98,7 +152,7 @@ protected:
 
 		2D array of width*height values, each counting the number of hits at that pixel location
 	 */
-	int64_t* m_accumdata;
+	AcceleratorBuffer<int64_t> m_accumdata;
 
 	///@brief The number of symbols which have been integrated so far
 	size_t m_totalSymbols;
@@ -45,6 +45,8 @@ CopperMountainVNA::CopperMountainVNA(SCPITransport* transport)
 	: SCPIDevice(transport)
 	, SCPIInstrument(transport)
 	, m_rbw(1)
+	, m_binaryTraces(false)
+	, m_traceBuffer("CopperMountainVNA.m_traceBuffer")
 {
 	//For now, assume we're a 2-port VNA only
 	auto snport = m_transport->SendCommandQueuedWithReply("SERV:PORT:COUN?");
@@ -81,6 +83,15 @@ CopperMountainVNA::CopperMountainVNA(SCPITransport* transport)
 
 	//Apparently binary data transfer is not supported over TCP sockets since they ONLY use newline as end of message
 	//while HiSLIP does not support pipelining of commands? That's derpy...
+	//So use little endian REAL32 blocks on every other transport, and fall back to ASCII on raw sockets.
+	if(m_transport->GetName() != SCPISocketTransport::GetTransportName())
+	{
+		m_binaryTraces = true;
+		m_transport->SendCommandQueued("FORM:DATA REAL32");
+		m_transport->SendCommandQueued("FORM:BORD SWAP");
+	}
+	else
+		m_transport->SendCommandQueued("FORM:DATA ASC");
 
 	//Set trigger source to internal
 	m_transport->SendCommandQueued("TRIG:SOUR INT");
@@ -252,65 +263,60 @@ bool CopperMountainVNA::AcquireData()
 	double tstart = GetTime();
 	int64_t fs = (tstart - floor(tstart)) * FS_PER_SECOND;
 
-	for(size_t dest = 0; dest<2; dest ++)
-	{
-		for(size_t src=0; src<2; src++)
-		{
-			//Hardware name of the channel
-			string chname = "S" + to_string(dest+1) + to_string(src+1);
+	ChannelsDownloadStarted();
 
-			int nparam = dest*2 + src;
-			auto sdata = m_transport->SendCommandQueuedWithReply(
-				string("CALC:TRAC") + to_string(nparam+1) + ":DATA:FDAT?");
-
-			auto values = explode(sdata, ',');
-			size_t npoints = values.size() / 2;
-
-			int64_t stepsize = (m_sweepStop - m_sweepStart) / npoints;
-
-			//Create the waveforms
-			auto mcap = new UniformAnalogWaveform;
-			mcap->m_timescale = stepsize;
-			mcap->m_triggerPhase = m_sweepStart;
-			mcap->m_startTimestamp = floor(tstart);
-			mcap->m_startFemtoseconds = fs;
-			mcap->PrepareForCpuAccess();
-
-			auto acap = new UniformAnalogWaveform;
-			acap->m_timescale = stepsize;
-			acap->m_triggerPhase = m_sweepStart;
-			acap->m_startTimestamp = floor(tstart);
-			acap->m_startFemtoseconds = fs;
-			acap->PrepareForCpuAccess();
-
-			//Make content for display (dB and degrees)
-			mcap->Resize(npoints);
-			acap->Resize(npoints);
-			for(size_t i=0; i<npoints; i++)
-			{
-				float real = stof(values[i*2]);
-				float imag = stof(values[i*2 + 1]);
+	//Request all four traces in one burst, then consume the replies in order as they come back
+	vector<string> queries;
+	for(size_t i=0; i<4; i++)
+		queries.push_back(string("CALC:TRAC") + to_string(i+1) + ":DATA:FDAT?");
 
-				float mag = sqrt(real*real + imag*imag);
-				float angle = atan2(imag, real);
+	if(m_binaryTraces)
+	{
+		lock_guard<recursive_mutex> lock(m_transport->GetMutex());
+		m_transport->FlushCommandQueue();
 
-				mcap->m_samples[i] = 20 * log10(mag);
-				acap->m_samples[i] = angle * 180 / M_PI;
+		size_t depth = m_transport->GetMaxQueriesInFlight();
+		size_t nsent = 0;
+		for(size_t nparam=0; nparam<queries.size(); nparam++)
+		{
+			while( (nsent < queries.size()) && (nsent - nparam < depth) )
+			{
+				m_transport->SendCommand(queries[nsent]);
+				nsent ++;
 			}
 
-			acap->MarkModifiedFromCpu();
-			mcap->MarkModifiedFromCpu();
+			if(!m_transport->ReadBinaryBlock(
+				m_traceBuffer,
+				[nparam, this] (float progress)
+				{ ChannelsDownloadStatusUpdate(nparam, InstrumentChannel::DownloadState::DOWNLOAD_IN_PROGRESS, progress); }))
+			{
+				LogError("Failed to download trace %zu\n", nparam+1);
+			}
 
-			auto chan = GetChannel(nparam);
-			s[StreamDescriptor(chan, 0)] = mcap;
-			s[StreamDescriptor(chan, 1)] = acap;
+			//Real/imaginary pairs
+			ProcessTrace(s, nparam, m_traceBuffer.GetCpuPointer(), m_traceBuffer.size() / 2, tstart, fs);
 		}
 	}
+	else
+	{
+		m_transport->SendQueriesPipelined(
+			queries,
+			[&] (size_t nparam, const string& sdata)
+			{
+				auto values = explode(sdata, ',');
+				m_traceBuffer.resize(values.size());
+				m_traceBuffer.PrepareForCpuAccess();
+				for(size_t i=0; i<values.size(); i++)
+					m_traceBuffer[i] = stof(values[i]);
+
+				ProcessTrace(s, nparam, m_traceBuffer.GetCpuPointer(), values.size() / 2, tstart, fs);
+			});
+	}
+
+	ChannelsDownloadFinished();
 
 	//Save the waveforms to our queue
-	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(s);
-	m_pendingWaveformsMutex.unlock();
+	PushPendingWaveform(s);
 
 	//If this was a one-shot trigger we're no longer armed
 	if(m_triggerOneShot)
@@ -326,6 +332,69 @@ bool CopperMountainVNA::AcquireData()
 	return true;
 }
 
+/**
+	@brief Converts one trace from interleaved real/imaginary values to display oriented dB and degrees waveforms
+
+	@param s		Sequence set to add the magnitude and angle waveforms to
+	@param nparam	Index of the S-parameter channel
+	@param data		Interleaved real and imaginary values
+	@param npoints	Number of complex points in the trace
+	@param tstart	Acquisition timestamp
+	@param fs		Fractional part of the timestamp, in femtoseconds
+ */
+void CopperMountainVNA::ProcessTrace(
+	SequenceSet& s,
+	size_t nparam,
+	const float* data,
+	size_t npoints,
+	double tstart,
+	int64_t fs)
+{
+	if(npoints == 0)
+		return;
+
+	int64_t stepsize = (m_sweepStop - m_sweepStart) / npoints;
+
+	//Create the waveforms
+	auto mcap = new UniformAnalogWaveform;
+	mcap->m_timescale = stepsize;
+	mcap->m_triggerPhase = m_sweepStart;
+	mcap->m_startTimestamp = floor(tstart);
+	mcap->m_startFemtoseconds = fs;
+	mcap->PrepareForCpuAccess();
+
+	auto acap = new UniformAnalogWaveform;
+	acap->m_timescale = stepsize;
+	acap->m_triggerPhase = m_sweepStart;
+	acap->m_startTimestamp = floor(tstart);
+	acap->m_startFemtoseconds = fs;
+	acap->PrepareForCpuAccess();
+
+	//Make content for display (dB and degrees)
+	mcap->Resize(npoints);
+	acap->Resize(npoints);
+	for(size_t i=0; i<npoints; i++)
+	{
+		float real = data[i*2];
+		float imag = data[i*2 + 1];
+
+		float mag = sqrt(real*real + imag*imag);
+		float angle = atan2(imag, real);
+
+		mcap->m_samples[i] = 20 * log10(mag);
+		acap->m_samples[i] = angle * 180 / M_PI;
+	}
+
+	acap->MarkModifiedFromCpu();
+	mcap->MarkModifiedFromCpu();
+
+	auto chan = GetChannel(nparam);
+	s[StreamDescriptor(chan, 0)] = mcap;
+	s[StreamDescriptor(chan, 1)] = acap;
+
+	ChannelsDownloadStatusUpdate(nparam, InstrumentChannel::DownloadState::DOWNLOAD_FINISHED, 1.0);
+}
+
 vector<uint64_t> CopperMountainVNA::GetSampleDepthsNonInterleaved()
 {
 	vector<uint64_t> ret;
@@ -78,6 +78,14 @@ protected:
 
 	std::string GetChannelColor(size_t i);
 
+	void ProcessTrace(
+		SequenceSet& s,
+		size_t nparam,
+		const float* data,
+		size_t npoints,
+		double tstart,
+		int64_t fs);
+
 	bool m_triggerArmed;
 	bool m_triggerOneShot;
 
@@ -90,6 +98,12 @@ protected:
 
 	int64_t m_rbw;
 
+	///@brief True if traces are downloaded as binary REAL32 blocks rather than ASCII
+	bool m_binaryTraces;
+
+	///@brief Interleaved real/imaginary values of the trace currently being downloaded
+	AcceleratorBuffer<float> m_traceBuffer;
+
 public:
 	static std::string GetDriverNameInternal();
 	VNA_INITPROC(CopperMountainVNA)
@@ -0,0 +1,122 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of CounterRNG
+	@ingroup core
+ */
+
+#ifndef CounterRNG_h
+#define CounterRNG_h
+
+#include <cmath>
+#include <cstdint>
+
+/**
+	@brief Counter based random number generator (Philox4x32-10)
+
+	Every block of four outputs is a pure function of (seed, stream, block index), so any sample can be generated
+	independently of all others. Threads can split a buffer any way they like and still get the same result, and the
+	GLSL implementation in shaders/CounterRNG.glsl produces bit-identical integers for the same seed.
+
+	Gaussian values are computed with Box-Muller; they match the GPU to within the rounding of log/sin/cos.
+ */
+class CounterRNG
+{
+public:
+	CounterRNG(uint32_t seed, uint32_t stream = 0)
+	{
+		m_key[0] = seed;
+		m_key[1] = stream;
+	}
+
+	///@brief Generates the four 32-bit random words of one block
+	void Block(uint64_t block, uint32_t out[4]) const
+	{
+		uint32_t c[4] = { static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32), 0, 0 };
+		uint32_t k0 = m_key[0];
+		uint32_t k1 = m_key[1];
+
+		for(int round=0; round<10; round++)
+		{
+			uint64_t p0 = static_cast<uint64_t>(0xd2511f53) * c[0];
+			uint64_t p1 = static_cast<uint64_t>(0xcd9e8d57) * c[2];
+
+			uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k0;
+			uint32_t n1 = static_cast<uint32_t>(p1);
+			uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k1;
+			uint32_t n3 = static_cast<uint32_t>(p0);
+			c[0] = n0;
+			c[1] = n1;
+			c[2] = n2;
+			c[3] = n3;
+
+			k0 += 0x9e3779b9;
+			k1 += 0xbb67ae85;
+		}
+
+		for(int i=0; i<4; i++)
+			out[i] = c[i];
+	}
+
+	///@brief Converts a random word to a float in the open interval (0, 1), exactly representable on CPU and GPU
+	static float ToUnitFloat(uint32_t x)
+	{ return (x >> 8) * (1.0f / 16777216.0f) + (0.5f / 16777216.0f); }
+
+	///@brief Generates four standard normal values (mean 0, sigma 1) for one block
+	void Gaussian4(uint64_t block, float out[4]) const
+	{
+		uint32_t raw[4];
+		Block(block, raw);
+
+		const float twopi = 2 * M_PI;
+		for(int i=0; i<4; i += 2)
+		{
+			float mag = sqrtf(-2 * logf(ToUnitFloat(raw[i])));
+			float theta = twopi * ToUnitFloat(raw[i+1]);
+			out[i] = mag * cosf(theta);
+			out[i+1] = mag * sinf(theta);
+		}
+	}
+
+	///@brief Generates the standard normal value for sample i (element i%4 of block i/4)
+	float Gaussian(uint64_t i) const
+	{
+		float tmp[4];
+		Gaussian4(i / 4, tmp);
+		return tmp[i % 4];
+	}
+
+protected:
+	///@brief Seed and stream ID
+	uint32_t m_key[2];
+};
+
+#endif
@@ -67,6 +67,9 @@ DSLabsOscilloscope::DSLabsOscilloscope(SCPITransport* transport)
 	, m_diag_droppedWFMs(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS))
 	, m_diag_droppedPercent(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_PERCENT))
 {
+	//Streaming instrument: if we get backed up, drop old waveforms rather than falling further behind
+	SetPendingWaveformPolicy(PENDING_DROP_OLDEST, 2);
+
 	//Set up initial cache configuration as "not valid" and let it populate as we go
 	IdentifyHardware();
 
@@ -503,20 +506,7 @@ bool DSLabsOscilloscope::AcquireData()
 	int dropped = param->GetIntVal();
 
 	//Save the waveforms to our queue
-	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(s);
-
-	while (m_pendingWaveforms.size() > 2)
-	{
-		SequenceSet set = *m_pendingWaveforms.begin();
-		for(auto it : set)
-			delete it.second;
-		m_pendingWaveforms.pop_front();
-
-		dropped++;
-	}
-
-	m_pendingWaveformsMutex.unlock();
+	dropped += PushPendingWaveform(s);
 
 	param->SetIntVal(dropped);
 
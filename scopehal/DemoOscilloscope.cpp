@@ -549,7 +549,7 @@ bool DemoOscilloscope::AcquireData()
 		{
 			case 0:
 				{
-					auto wfm = AllocateAnalogWaveform("NoisySine");
+					auto wfm = AllocateAnalogWaveform("NoisySine", depth);
 					waveforms[i] = wfm;
 					m_source[i]->GenerateNoisySinewave(
 						*m_cmdBuf[i], m_queue[i], wfm, 0.9, 0.0, 1e6, sampleperiod, depth, noise[0]);
@@ -558,7 +558,7 @@ bool DemoOscilloscope::AcquireData()
 
 			case 1:
 				{
-					auto wfm = AllocateAnalogWaveform("NoisySineSum");
+					auto wfm = AllocateAnalogWaveform("NoisySineSum", depth);
 					waveforms[i] = wfm;
 					m_source[i]->GenerateNoisySinewaveSum(
 						*m_cmdBuf[i], m_queue[i], wfm, 0.9, 0.0, M_PI_4, 1e6, sweepPeriod, sampleperiod, depth, noise[1]);
@@ -567,7 +567,7 @@ bool DemoOscilloscope::AcquireData()
 
 			case 2:
 				{
-					auto wfm = AllocateAnalogWaveform("PRBS31");
+					auto wfm = AllocateAnalogWaveform("PRBS31", depth);
 					waveforms[i] = wfm;
 					m_source[i]->GeneratePRBS31(
 						*m_cmdBuf[i], m_queue[i], wfm, 0.9, 96969.6, sampleperiod, depth, lpf2, noise[2]);
@@ -576,7 +576,7 @@ bool DemoOscilloscope::AcquireData()
 
 			case 3:
 				{
-					auto wfm = AllocateAnalogWaveform("8B10B");
+					auto wfm = AllocateAnalogWaveform("8B10B", depth);
 					waveforms[i] = wfm;
 					m_source[i]->Generate8b10b(
 						*m_cmdBuf[i], m_queue[i], wfm, 0.9, 800e3, sampleperiod, depth, lpf3, noise[3]);
@@ -612,9 +612,7 @@ bool DemoOscilloscope::AcquireData()
 		wfm->m_triggerPhase = 0;
 	}
 
-	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(s);
-	m_pendingWaveformsMutex.unlock();
+	PushPendingWaveform(s);
 
 	if(m_triggerOneShot)
 		m_triggerArmed = false;
@@ -94,6 +94,9 @@ public:
 	virtual void PrepareForCpuAccess() override
 	{ m_outdata.PrepareForCpuAccess(); }
 
+	virtual ReadbackFuture PrepareForCpuAccessAsync() override
+	{ return m_outdata.PrepareForCpuAccessAsync(); }
+
 	virtual void PrepareForGpuAccess() override
 	{ m_outdata.PrepareForGpuAccess();}
 
@@ -0,0 +1,184 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of DeviceLength
+	@ingroup vksupport
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+///@brief Push constants for DeviceLengthDispatch.glsl
+class DeviceLengthDispatchConstants
+{
+public:
+	uint32_t blockSize;
+	uint32_t maxGroupsX;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates a new length buffer
+
+	The buffer lives in pinned host memory which the GPU writes to directly, so reading back the count is just a
+	memory access once the kernel has completed.
+
+	@param name	Name for debugging
+ */
+DeviceLength::DeviceLength(const string& name)
+	: m_buffer(make_unique<AcceleratorBuffer<uint32_t>>(name))
+	, m_pending(false)
+	, m_length(0)
+{
+	m_buffer->SetCpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+	m_buffer->SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_UNLIKELY);
+	m_buffer->resize(WORD_COUNT);
+	m_buffer->PrepareForCpuAccess();
+	for(size_t i=0; i<WORD_COUNT; i++)
+		(*m_buffer)[i] = 0;
+	m_buffer->MarkModifiedFromCpu();
+}
+
+DeviceLength::~DeviceLength()
+{
+}
+
+/**
+	@brief Gets a length from a pool which no buffer is still attached to, or adds a new one if there is none
+
+	@param pool	The pool, typically owned by the filter
+	@param name	Name for debugging, if a new length has to be created
+ */
+shared_ptr<DeviceLength> DeviceLength::Acquire(vector<shared_ptr<DeviceLength>>& pool, const string& name)
+{
+	for(auto& l : pool)
+	{
+		if(l.use_count() == 1)
+			return l;
+	}
+
+	auto l = make_shared<DeviceLength>(name);
+	pool.push_back(l);
+	return l;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+///@brief Gets the buffer holding the count, for binding to shaders
+AcceleratorBuffer<uint32_t>& DeviceLength::GetBuffer()
+{
+	return *m_buffer;
+}
+
+/**
+	@brief Records that a kernel writing the count has been submitted
+
+	Must be called after the command buffer containing the kernel has been submitted. If a QueueSubmitScope is
+	active, the count is valid once all of the work submitted within the scope has completed, otherwise the
+	submission has already completed.
+ */
+void DeviceLength::MarkWritten()
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	m_buffer->MarkModifiedFromGpu();
+
+	auto scope = QueueSubmitScope::GetCurrent();
+	if(scope)
+		m_readyAfter = scope->GetSignals();
+	else
+		m_readyAfter.clear();
+	m_pending = true;
+}
+
+/**
+	@brief Gets the count, waiting for the kernel which wrote it and reading it back if necessary
+ */
+uint32_t DeviceLength::Resolve()
+{
+	lock_guard<mutex> lock(m_mutex);
+	if(!m_pending)
+		return m_length;
+
+	QueueHandle::WaitForPoints(m_readyAfter);
+	m_buffer->PrepareForCpuAccess();
+	m_length = (*m_buffer)[LENGTH_INDEX];
+
+	m_readyAfter.clear();
+	m_pending = false;
+	return m_length;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Indirect dispatch
+
+/**
+	@brief Appends a pass to a command buffer which fills out the indirect dispatch arguments from the count
+
+	The count must have been written earlier in the same command buffer, or by work this command buffer waits for.
+
+	@param cmdBuf		Command buffer to append to
+	@param blockSize	Number of threads per workgroup of the shader to be dispatched (one thread per element)
+	@param maxGroupsX	Maximum number of workgroups in the X dimension, larger dispatches spill over into Y
+ */
+void DeviceLength::PrepareDispatch(vk::raii::CommandBuffer& cmdBuf, uint32_t blockSize, uint32_t maxGroupsX)
+{
+	//Each length has its own pipeline, so the descriptor set never has to be rewritten while a previous dispatch
+	//might still be pending
+	if(!m_dispatchPipeline)
+	{
+		m_dispatchPipeline = make_unique<ComputePipeline>(
+			"shaders/DeviceLengthDispatch.spv", 1, sizeof(DeviceLengthDispatchConstants));
+	}
+
+	DeviceLengthDispatchConstants cfg;
+	cfg.blockSize = blockSize;
+	cfg.maxGroupsX = maxGroupsX;
+
+	m_dispatchPipeline->BindBufferNonblocking(0, *m_buffer, cmdBuf);
+	m_dispatchPipeline->Dispatch(cmdBuf, cfg, 1);
+
+	//Make the arguments visible to the indirect dispatch
+	cmdBuf.pipelineBarrier(
+		vk::PipelineStageFlagBits::eComputeShader,
+		vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
+		{},
+		vk::MemoryBarrier(
+			vk::AccessFlagBits::eShaderWrite,
+			vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead),
+		{},
+		{});
+}
@@ -0,0 +1,119 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of DeviceLength
+	@ingroup vksupport
+ */
+
+#ifndef DeviceLength_h
+#define DeviceLength_h
+
+#include <mutex>
+#include "QueueManager.h"
+
+template<class T>
+class AcceleratorBuffer;
+
+class ComputePipeline;
+
+/**
+	@brief Number of valid elements in one or more AcceleratorBuffers, as written by a GPU kernel
+
+	Filters which produce a data-dependent number of outputs on the GPU size their output buffers to a conservative
+	upper bound, have the kernel write the actual count to a DeviceLength, and attach it to the buffers (see
+	AcceleratorBuffer::SetDeviceLength()) instead of reading the count back before they can finish. GPU consumers can
+	launch exactly as many threads as there are elements with ComputePipeline::DispatchIndirect() and read the count
+	from the same buffer, so a chain of such filters never waits on the CPU. The count is only read back the first
+	time something looks at one of the buffers from the CPU.
+
+	The underlying buffer holds the count in word LENGTH_INDEX and a VkDispatchIndirectCommand starting at word
+	DISPATCH_INDEX, filled out by PrepareDispatch().
+
+	A DeviceLength must not be rewritten while buffers are still attached to it, since they would pick up the new
+	count. Acquire() hands out one which nothing is waiting on.
+
+	@ingroup vksupport
+ */
+class DeviceLength
+{
+public:
+	DeviceLength(const std::string& name = "");
+	~DeviceLength();
+
+	///@brief Index of the element count within the buffer
+	static const size_t LENGTH_INDEX = 0;
+
+	///@brief Index of the first word of the indirect dispatch arguments within the buffer
+	static const size_t DISPATCH_INDEX = 1;
+
+	///@brief Total size of the buffer, in 32-bit words
+	static const size_t WORD_COUNT = 4;
+
+	AcceleratorBuffer<uint32_t>& GetBuffer();
+
+	void MarkWritten();
+	uint32_t Resolve();
+
+	///@brief Checks if the count was written on the GPU and has not yet been read back
+	bool IsPending()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_pending;
+	}
+
+	void PrepareDispatch(vk::raii::CommandBuffer& cmdBuf, uint32_t blockSize, uint32_t maxGroupsX = 32768);
+
+	static std::shared_ptr<DeviceLength> Acquire(
+		std::vector<std::shared_ptr<DeviceLength>>& pool,
+		const std::string& name);
+
+protected:
+	///@brief Mutex protecting our state
+	std::mutex m_mutex;
+
+	///@brief The count and dispatch arguments
+	std::unique_ptr<AcceleratorBuffer<uint32_t>> m_buffer;
+
+	///@brief Pipeline for converting the count into dispatch arguments (created on first use)
+	std::unique_ptr<ComputePipeline> m_dispatchPipeline;
+
+	///@brief Points which must be reached before the count in m_buffer is valid
+	std::vector<QueueTimelinePoint> m_readyAfter;
+
+	///@brief True if the count was written on the GPU and has not yet been read back
+	bool m_pending;
+
+	///@brief The count, as of the last Resolve()
+	uint32_t m_length;
+};
+
+#endif
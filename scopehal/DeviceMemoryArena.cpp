@@ -0,0 +1,398 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of DeviceMemoryArena and DeviceMemoryAllocation
+	@ingroup vksupport
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+/**
+	@brief Arena for device-local memory (MEM_TYPE_GPU_ONLY buffers)
+	@ingroup vksupport
+
+	On unified memory platforms this is the same arena as g_vkPinnedMemoryArena.
+ */
+shared_ptr<DeviceMemoryArena> g_vkLocalMemoryArena;
+
+/**
+	@brief Arena for pinned, host visible memory (MEM_TYPE_CPU_DMA_CAPABLE buffers)
+	@ingroup vksupport
+ */
+shared_ptr<DeviceMemoryArena> g_vkPinnedMemoryArena;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// DeviceMemoryAllocation
+
+DeviceMemoryAllocation::DeviceMemoryAllocation(
+	shared_ptr<DeviceMemoryArena> arena,
+	size_t block,
+	vk::DeviceSize offset,
+	vk::DeviceSize size,
+	vk::DeviceMemory memory,
+	void* mapped,
+	bool dedicated)
+	: m_arena(arena)
+	, m_block(block)
+	, m_offset(offset)
+	, m_size(size)
+	, m_memory(memory)
+	, m_mapped(mapped)
+	, m_dedicated(dedicated)
+{
+}
+
+DeviceMemoryAllocation::~DeviceMemoryAllocation()
+{
+	m_arena->Free(m_block, m_offset, m_size);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates an arena
+
+	@param device		The device to allocate from
+	@param memoryType	Index of the memory type to allocate
+	@param hostVisible	True if the memory type is host visible, and blocks should be mapped
+	@param name			Name of the arena, for debug tools and log messages
+	@param blockSize	Size of each shared block
+ */
+DeviceMemoryArena::DeviceMemoryArena(
+	shared_ptr<vk::raii::Device> device,
+	uint32_t memoryType,
+	bool hostVisible,
+	const string& name,
+	vk::DeviceSize blockSize)
+	: m_device(device)
+	, m_memoryType(memoryType)
+	, m_hostVisible(hostVisible)
+	, m_name(name)
+	, m_blockSize(blockSize)
+{
+}
+
+DeviceMemoryArena::~DeviceMemoryArena()
+{
+	//Every allocation holds a reference to us, so by now all blocks are empty
+	m_blocks.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Block management
+
+/**
+	@brief Allocates a new Vulkan memory object
+
+	Assumes m_mutex is locked.
+
+	@param size			Size of the block
+	@param dedicated	True if the block is for a single allocation
+
+	@return Index of the new block. Throws vk::OutOfDeviceMemoryError (or another vk::SystemError) on failure.
+ */
+size_t DeviceMemoryArena::AllocateBlock(vk::DeviceSize size, bool dedicated)
+{
+	auto block = make_unique<Block>();
+	vk::MemoryAllocateInfo info(size, m_memoryType);
+	block->m_memory = make_unique<vk::raii::DeviceMemory>(*m_device, info);
+	block->m_size = size;
+	block->m_dedicated = dedicated;
+	if(m_hostVisible)
+		block->m_mapped = reinterpret_cast<uint8_t*>(block->m_memory->mapMemory(0, size));
+	if(!dedicated)
+		block->m_freeRanges[0] = size;
+
+	//Reuse a free slot if there is one
+	size_t index = m_blocks.size();
+	for(size_t i=0; i<m_blocks.size(); i++)
+	{
+		if(m_blocks[i] == nullptr)
+		{
+			index = i;
+			break;
+		}
+	}
+	if(index == m_blocks.size())
+		m_blocks.push_back(nullptr);
+
+	if(g_hasDebugUtils)
+	{
+		string blockname = m_name + (dedicated ? ".dedicated" : ".block") + to_string(index);
+		m_device->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eDeviceMemory,
+				reinterpret_cast<uint64_t>(static_cast<VkDeviceMemory>(**block->m_memory)),
+				blockname.c_str()));
+	}
+
+	m_blocks[index] = std::move(block);
+	return index;
+}
+
+/**
+	@brief Frees a Vulkan memory object
+
+	Assumes m_mutex is locked.
+ */
+void DeviceMemoryArena::FreeBlock(size_t block)
+{
+	m_blocks[block] = nullptr;
+
+	//Trim trailing empty slots
+	while(!m_blocks.empty() && (m_blocks.back() == nullptr))
+		m_blocks.pop_back();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Allocation
+
+/**
+	@brief Allocates memory satisfying the given requirements
+
+	Throws vk::OutOfDeviceMemoryError if a new block is needed and cannot be allocated, the same as a direct
+	vkAllocateMemory() would.
+
+	@param req	Size and alignment requirements (typically from vk::raii::Buffer::getMemoryRequirements())
+ */
+unique_ptr<DeviceMemoryAllocation> DeviceMemoryArena::Allocate(const vk::MemoryRequirements& req)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	vk::DeviceSize size = max(req.size, (vk::DeviceSize)1);
+	vk::DeviceSize align = max(req.alignment, (vk::DeviceSize)1);
+
+	//Big allocations get a block to themselves
+	if(size >= m_blockSize / 4)
+	{
+		size_t index = AllocateBlock(size, true);
+		auto& block = m_blocks[index];
+		block->m_used = size;
+		block->m_allocationCount = 1;
+		return make_unique<DeviceMemoryAllocation>(
+			shared_from_this(), index, 0, size, **block->m_memory, block->m_mapped, true);
+	}
+
+	//Find the smallest free range which fits
+	size_t bestBlock = SIZE_MAX;
+	vk::DeviceSize bestRangeStart = 0;
+	vk::DeviceSize bestWaste = 0;
+	for(size_t i=0; i<m_blocks.size(); i++)
+	{
+		auto& block = m_blocks[i];
+		if( (block == nullptr) || block->m_dedicated)
+			continue;
+
+		for(auto& it : block->m_freeRanges)
+		{
+			vk::DeviceSize aligned = (it.first + align - 1) / align * align;
+			vk::DeviceSize needed = (aligned - it.first) + size;
+			if(needed > it.second)
+				continue;
+
+			vk::DeviceSize waste = it.second - needed;
+			if( (bestBlock == SIZE_MAX) || (waste < bestWaste) )
+			{
+				bestBlock = i;
+				bestRangeStart = it.first;
+				bestWaste = waste;
+			}
+		}
+	}
+
+	//Nothing fits, we need a new block
+	if(bestBlock == SIZE_MAX)
+	{
+		bestBlock = AllocateBlock(m_blockSize, false);
+		bestRangeStart = 0;
+	}
+
+	//Carve our range out of the free one, leaving the alignment padding and the tail free
+	auto& block = m_blocks[bestBlock];
+	vk::DeviceSize rangeSize = block->m_freeRanges[bestRangeStart];
+	block->m_freeRanges.erase(bestRangeStart);
+
+	vk::DeviceSize offset = (bestRangeStart + align - 1) / align * align;
+	if(offset != bestRangeStart)
+		block->m_freeRanges[bestRangeStart] = offset - bestRangeStart;
+
+	vk::DeviceSize end = offset + size;
+	vk::DeviceSize rangeEnd = bestRangeStart + rangeSize;
+	if(end != rangeEnd)
+		block->m_freeRanges[end] = rangeEnd - end;
+
+	block->m_used += size;
+	block->m_allocationCount ++;
+
+	void* mapped = block->m_mapped ? (block->m_mapped + offset) : nullptr;
+	return make_unique<DeviceMemoryAllocation>(
+		shared_from_this(), bestBlock, offset, size, **block->m_memory, mapped, false);
+}
+
+/**
+	@brief Returns a range to its block, merging it with adjacent free ranges
+
+	Dedicated blocks are freed immediately. At most one empty shared block is kept around, to avoid thrashing when a
+	single buffer is repeatedly freed and reallocated.
+ */
+void DeviceMemoryArena::Free(size_t index, vk::DeviceSize offset, vk::DeviceSize size)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	auto& block = m_blocks[index];
+	if(block->m_dedicated)
+	{
+		FreeBlock(index);
+		return;
+	}
+
+	//Merge with the following range if adjacent
+	auto& ranges = block->m_freeRanges;
+	auto next = ranges.lower_bound(offset);
+	vk::DeviceSize rangeSize = size;
+	if( (next != ranges.end()) && (next->first == offset + size) )
+	{
+		rangeSize += next->second;
+		next = ranges.erase(next);
+	}
+
+	//Merge with the preceding range if adjacent, otherwise add a new range
+	if(next != ranges.begin())
+	{
+		auto prev = std::prev(next);
+		if(prev->first + prev->second == offset)
+			prev->second += rangeSize;
+		else
+			ranges[offset] = rangeSize;
+	}
+	else
+		ranges[offset] = rangeSize;
+
+	block->m_used -= size;
+	block->m_allocationCount --;
+
+	//If the block is now empty, free it unless it's the only empty one
+	if(block->m_allocationCount == 0)
+	{
+		for(size_t i=0; i<m_blocks.size(); i++)
+		{
+			auto& b = m_blocks[i];
+			if( (i != index) && b && !b->m_dedicated && (b->m_allocationCount == 0) )
+			{
+				FreeBlock(index);
+				break;
+			}
+		}
+	}
+}
+
+/**
+	@brief Releases memory which is reserved by the arena but not in use
+
+	Live allocations are never moved, since buffers bound to them may be referenced by descriptor sets and command
+	buffers we know nothing about. Best fit allocation keeps fragmentation low in practice; this frees every empty
+	shared block so the memory can be used by other allocations (or other applications).
+
+	@return Number of bytes released
+ */
+size_t DeviceMemoryArena::Defragment()
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	size_t freed = 0;
+	for(size_t i=0; i<m_blocks.size(); i++)
+	{
+		auto& b = m_blocks[i];
+		if(b && !b->m_dedicated && (b->m_allocationCount == 0) )
+		{
+			freed += b->m_size;
+			b = nullptr;
+		}
+	}
+
+	while(!m_blocks.empty() && (m_blocks.back() == nullptr))
+		m_blocks.pop_back();
+
+	return freed;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Statistics
+
+/**
+	@brief Gets current usage statistics for the arena
+ */
+DeviceMemoryArena::Statistics DeviceMemoryArena::GetStatistics()
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	Statistics stats;
+	for(auto& b : m_blocks)
+	{
+		if(!b)
+			continue;
+
+		stats.m_blockCount ++;
+		if(b->m_dedicated)
+			stats.m_dedicatedBlockCount ++;
+		stats.m_reservedBytes += b->m_size;
+		stats.m_usedBytes += b->m_used;
+		stats.m_allocationCount += b->m_allocationCount;
+		stats.m_freeRangeCount += b->m_freeRanges.size();
+		for(auto& it : b->m_freeRanges)
+			stats.m_largestFreeRange = max(stats.m_largestFreeRange, it.second);
+	}
+	return stats;
+}
+
+/**
+	@brief Prints current usage statistics to the debug log
+ */
+void DeviceMemoryArena::LogStatistics()
+{
+	auto stats = GetStatistics();
+	Unit bytes(Unit::UNIT_BYTES);
+
+	LogDebug("Device memory arena %s:\n", m_name.c_str());
+	LogIndenter li;
+	LogDebug("Blocks:        %zu (%zu dedicated)\n", stats.m_blockCount, stats.m_dedicatedBlockCount);
+	LogDebug("Allocations:   %zu\n", stats.m_allocationCount);
+	LogDebug("Reserved:      %s\n", bytes.PrettyPrint(stats.m_reservedBytes, 4).c_str());
+	LogDebug("Used:          %s\n", bytes.PrettyPrint(stats.m_usedBytes, 4).c_str());
+	LogDebug("Free ranges:   %zu (largest %s)\n",
+		stats.m_freeRangeCount, bytes.PrettyPrint(stats.m_largestFreeRange, 4).c_str());
+	LogDebug("Fragmentation: %.1f %%\n", stats.GetFragmentation() * 100);
+}
@@ -0,0 +1,280 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of DeviceMemoryArena and DeviceMemoryAllocation
+	@ingroup vksupport
+ */
+
+#ifndef DeviceMemoryArena_h
+#define DeviceMemoryArena_h
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+class DeviceMemoryArena;
+
+/**
+	@brief A range of Vulkan device memory sub-allocated from a DeviceMemoryArena
+	@ingroup vksupport
+
+	The range is returned to the arena when this object is destroyed. Any buffer bound to it must be destroyed first.
+ */
+class DeviceMemoryAllocation
+{
+public:
+	DeviceMemoryAllocation(
+		std::shared_ptr<DeviceMemoryArena> arena,
+		size_t block,
+		vk::DeviceSize offset,
+		vk::DeviceSize size,
+		vk::DeviceMemory memory,
+		void* mapped,
+		bool dedicated);
+	~DeviceMemoryAllocation();
+
+	//non-copyable
+	DeviceMemoryAllocation(const DeviceMemoryAllocation&) = delete;
+	DeviceMemoryAllocation& operator=(const DeviceMemoryAllocation&) = delete;
+
+	///@brief Get the memory object the range lives in (shared with other allocations unless IsDedicated())
+	vk::DeviceMemory GetMemory() const
+	{ return m_memory; }
+
+	///@brief Get the offset of the range within GetMemory()
+	vk::DeviceSize GetOffset() const
+	{ return m_offset; }
+
+	///@brief Get the size of the range, in bytes
+	vk::DeviceSize GetSize() const
+	{ return m_size; }
+
+	///@brief Get a host pointer to the start of the range (null if the memory type is not host visible)
+	void* GetMappedPointer() const
+	{ return m_mapped; }
+
+	///@brief Check if the range has a memory object all to itself
+	bool IsDedicated() const
+	{ return m_dedicated; }
+
+protected:
+
+	///@brief The arena we came from
+	std::shared_ptr<DeviceMemoryArena> m_arena;
+
+	///@brief Index of the block within the arena
+	size_t m_block;
+
+	///@brief Offset of the range within the block
+	vk::DeviceSize m_offset;
+
+	///@brief Size of the range
+	vk::DeviceSize m_size;
+
+	///@brief Memory object of the block
+	vk::DeviceMemory m_memory;
+
+	///@brief Mapped pointer to the range, if host visible
+	void* m_mapped;
+
+	///@brief True if the block was allocated just for us
+	bool m_dedicated;
+};
+
+/**
+	@brief Sub-allocator for a single Vulkan memory type
+	@ingroup vksupport
+
+	Vulkan implementations limit the number of live allocations (maxMemoryAllocationCount, as low as 4096) and
+	vkAllocateMemory() is often slow, so small buffers are carved out of large blocks instead of each getting its own
+	allocation. Free ranges within each block are tracked by offset and merged with their neighbours when released;
+	allocation is best fit.
+
+	Requests larger than a quarter of the block size get a dedicated block, which is freed as soon as the allocation
+	is. Host visible blocks are persistently mapped.
+
+	All methods are thread safe.
+ */
+class DeviceMemoryArena : public std::enable_shared_from_this<DeviceMemoryArena>
+{
+public:
+	DeviceMemoryArena(
+		std::shared_ptr<vk::raii::Device> device,
+		uint32_t memoryType,
+		bool hostVisible,
+		const std::string& name,
+		vk::DeviceSize blockSize = 64 * 1024 * 1024);
+	~DeviceMemoryArena();
+
+	//non-copyable
+	DeviceMemoryArena(const DeviceMemoryArena&) = delete;
+	DeviceMemoryArena& operator=(const DeviceMemoryArena&) = delete;
+
+	std::unique_ptr<DeviceMemoryAllocation> Allocate(const vk::MemoryRequirements& req);
+
+	size_t Defragment();
+
+	/**
+		@brief Usage statistics for an arena
+	 */
+	class Statistics
+	{
+	public:
+		Statistics()
+		: m_blockCount(0)
+		, m_dedicatedBlockCount(0)
+		, m_reservedBytes(0)
+		, m_usedBytes(0)
+		, m_allocationCount(0)
+		, m_freeRangeCount(0)
+		, m_largestFreeRange(0)
+		{}
+
+		///@brief Number of live Vulkan memory objects, including dedicated ones
+		size_t m_blockCount;
+
+		///@brief Number of blocks which hold a single large allocation
+		size_t m_dedicatedBlockCount;
+
+		///@brief Total size of all blocks
+		vk::DeviceSize m_reservedBytes;
+
+		///@brief Total size of all live allocations (including alignment padding)
+		vk::DeviceSize m_usedBytes;
+
+		///@brief Number of live allocations
+		size_t m_allocationCount;
+
+		///@brief Number of free ranges in shared blocks
+		size_t m_freeRangeCount;
+
+		///@brief Size of the largest free range in any shared block
+		vk::DeviceSize m_largestFreeRange;
+
+		/**
+			@brief Fraction of free space in shared blocks which is not part of the largest free range
+
+			Zero means all free space is contiguous; values close to one mean it is scattered in small pieces.
+		 */
+		float GetFragmentation() const
+		{
+			vk::DeviceSize free = m_reservedBytes - m_usedBytes;
+			if(free == 0)
+				return 0;
+			return 1.0f - static_cast<float>(m_largestFreeRange) / free;
+		}
+	};
+
+	Statistics GetStatistics();
+	void LogStatistics();
+
+	///@brief Get the Vulkan memory type index we allocate from
+	uint32_t GetMemoryType() const
+	{ return m_memoryType; }
+
+	///@brief Get the name of the arena
+	const std::string& GetName() const
+	{ return m_name; }
+
+protected:
+	friend class DeviceMemoryAllocation;
+
+	void Free(size_t block, vk::DeviceSize offset, vk::DeviceSize size);
+	size_t AllocateBlock(vk::DeviceSize size, bool dedicated);
+	void FreeBlock(size_t block);
+
+	/**
+		@brief A single Vulkan memory object
+	 */
+	class Block
+	{
+	public:
+		Block()
+		: m_size(0)
+		, m_mapped(nullptr)
+		, m_used(0)
+		, m_allocationCount(0)
+		, m_dedicated(false)
+		{}
+
+		///@brief The memory object
+		std::unique_ptr<vk::raii::DeviceMemory> m_memory;
+
+		///@brief Size of the memory object
+		vk::DeviceSize m_size;
+
+		///@brief Host pointer to the start of the block, if mapped
+		uint8_t* m_mapped;
+
+		///@brief Free ranges (offset to size), never adjacent to each other
+		std::map<vk::DeviceSize, vk::DeviceSize> m_freeRanges;
+
+		///@brief Number of bytes in use
+		vk::DeviceSize m_used;
+
+		///@brief Number of live allocations
+		size_t m_allocationCount;
+
+		///@brief True if the block holds a single large allocation
+		bool m_dedicated;
+	};
+
+	///@brief Mutex protecting all of our state
+	std::mutex m_mutex;
+
+	///@brief The device we allocate from
+	std::shared_ptr<vk::raii::Device> m_device;
+
+	///@brief Memory type index
+	uint32_t m_memoryType;
+
+	///@brief True if blocks should be mapped
+	bool m_hostVisible;
+
+	///@brief Name for debug tools
+	std::string m_name;
+
+	///@brief Size of each shared block
+	vk::DeviceSize m_blockSize;
+
+	///@brief All blocks (null entries are free slots, so indexes held by live allocations stay valid)
+	std::vector<std::unique_ptr<Block>> m_blocks;
+};
+
+extern std::shared_ptr<DeviceMemoryArena> g_vkLocalMemoryArena;
+extern std::shared_ptr<DeviceMemoryArena> g_vkPinnedMemoryArena;
+
+#endif
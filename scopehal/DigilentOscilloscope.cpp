@@ -271,7 +271,7 @@ Oscilloscope::TriggerMode DigilentOscilloscope::PollTrigger()
 		return TRIGGER_MODE_STOP;
 
 	//See if we have data ready
-	if(dynamic_cast<SCPITwinLanTransport*>(m_transport)->GetSecondarySocket().GetRxBytesAvailable() > 0)
+	if(dynamic_cast<SCPITwinLanTransport*>(m_transport)->GetDataBytesAvailable() > 0)
 		return TRIGGER_MODE_TRIGGERED;
 
 	else
@@ -427,24 +427,24 @@ bool DigilentOscilloscope::AcquireData()
 	}
 
 	//Process analog captures in parallel
-	#pragma omp parallel for
-	for(size_t i=0; i<awfms.size(); i++)
+	ParallelFor(0, awfms.size(), 1, [&](size_t first, size_t last)
 	{
-		auto cap = awfms[i];
+		for(size_t i=first; i<last; i++)
+		{
+			auto cap = awfms[i];
 
-		double* buf = abufs[i];
-		cap->PrepareForCpuAccess();
-		for(size_t j=0; j<memdepth; j++)
-			cap->m_samples[j] = buf[j];
-		cap->MarkSamplesModifiedFromCpu();
+			double* buf = abufs[i];
+			cap->PrepareForCpuAccess();
+			for(size_t j=0; j<memdepth; j++)
+				cap->m_samples[j] = buf[j];
+			cap->MarkSamplesModifiedFromCpu();
 
-		delete[] abufs[i];
-	}
+			delete[] abufs[i];
+		}
+	});
 
 	//Save the waveforms to our queue
-	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(s);
-	m_pendingWaveformsMutex.unlock();
+	PushPendingWaveform(s);
 
 	//If this was a one-shot trigger we're no longer armed
 	if(m_triggerOneShot)
@@ -0,0 +1,557 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of DigitalEdgeList
+	@ingroup datamodel
+ */
+
+#include "scopehal.h"
+#include "LevelCrossingDetector.h"
+
+using namespace std;
+
+mutex DigitalEdgeList::m_cacheMutex;
+unique_ptr<DigitalEdgeList::Extractor> DigitalEdgeList::m_extractor;
+mutex DigitalEdgeList::m_extractorMutex;
+
+/**
+	@brief Uniform waveforms smaller than this are scanned on the CPU, since the GPU round trip costs more than it saves
+ */
+static const size_t GPU_EXTRACT_THRESHOLD = 1024 * 1024;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// GPU extraction
+
+/**
+	@brief GPU accelerated edge search for byte-per-sample uniform digital waveforms
+
+	Two passes, so we never need more scratch space than one counter per thread: count the edges in each block,
+	prefix sum the counts to find where each block's edges go, then write them out.
+ */
+class DigitalEdgeList::Extractor
+{
+public:
+	Extractor();
+
+	void Run(UniformDigitalWaveform* wfm, AcceleratorBuffer<int64_t>& edges);
+
+protected:
+	std::shared_ptr<QueueHandle> m_queue;
+	std::unique_ptr<vk::raii::CommandPool> m_pool;
+	std::unique_ptr<vk::raii::CommandBuffer> m_cmdBuf;
+
+	std::unique_ptr<ComputePipeline> m_countPipeline;
+	std::unique_ptr<ComputePipeline> m_preGatherPipeline;
+	std::unique_ptr<ComputePipeline> m_writePipeline;
+
+	///@brief Number of edges in each block
+	AcceleratorBuffer<int64_t> m_counts;
+
+	///@brief Start index of each block in the output (plus the total at the end)
+	AcceleratorBuffer<int64_t> m_offsets;
+};
+
+DigitalEdgeList::Extractor::Extractor()
+{
+	m_queue = g_vkQueueManager->GetComputeQueue("DigitalEdgeList.queue");
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		m_queue->m_family );
+	m_pool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(**m_pool, vk::CommandBufferLevel::ePrimary, 1);
+	m_cmdBuf = make_unique<vk::raii::CommandBuffer>(
+		std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	if(g_hasDebugUtils)
+	{
+		string poolname = "DigitalEdgeList.pool";
+		string bufname = "DigitalEdgeList.cmdbuf";
+
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandPool,
+				reinterpret_cast<uint64_t>(static_cast<VkCommandPool>(**m_pool)),
+				poolname.c_str()));
+
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandBuffer,
+				reinterpret_cast<uint64_t>(static_cast<VkCommandBuffer>(**m_cmdBuf)),
+				bufname.c_str()));
+	}
+
+	m_countPipeline = make_unique<ComputePipeline>(
+		"shaders/CountDigitalEdges.spv",
+		2,
+		sizeof(DigitalEdgePushConstants));
+
+	m_preGatherPipeline = make_unique<ComputePipeline>(
+		"shaders/PreGather.spv",
+		2,
+		sizeof(PreGatherPushConstants));
+
+	m_writePipeline = make_unique<ComputePipeline>(
+		"shaders/WriteDigitalEdges.spv",
+		3,
+		sizeof(DigitalEdgePushConstants));
+
+	//Counts never need to leave the GPU, but we need the final total on the CPU
+	m_counts.SetCpuAccessHint(AcceleratorBuffer<int64_t>::HINT_NEVER);
+	m_counts.SetGpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
+	m_offsets.SetCpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
+	m_offsets.SetGpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
+
+	m_counts.SetName("DigitalEdgeList.m_counts");
+	m_offsets.SetName("DigitalEdgeList.m_offsets");
+}
+
+/**
+	@brief Finds all toggles in a uniform digital waveform
+
+	@param wfm		Input waveform
+	@param edges	Output buffer, filled with sample indexes of each toggle
+ */
+void DigitalEdgeList::Extractor::Run(UniformDigitalWaveform* wfm, AcceleratorBuffer<int64_t>& edges)
+{
+	//Same tuning as LevelCrossingDetector
+	const uint32_t numThreads = 8192;
+
+	DigitalEdgePushConstants push;
+	push.inputSize = wfm->size();
+	push.inputPerThread = (push.inputSize + numThreads - 1) / numThreads;
+	push.numThreads = numThreads;
+	const uint32_t compute_block_count = GetComputeBlockCount(numThreads, 64);
+
+	//First pass: count edges per block, then find where each block starts
+	m_counts.resize(numThreads);
+	m_offsets.resize(numThreads + 1);
+
+	m_cmdBuf->begin({});
+
+	m_countPipeline->BindBufferNonblocking(0, m_counts, *m_cmdBuf, true);
+	m_countPipeline->BindBufferNonblocking(1, wfm->m_samples, *m_cmdBuf);
+	m_countPipeline->Dispatch(*m_cmdBuf, push, compute_block_count);
+	m_counts.MarkModifiedFromGpu();
+	m_countPipeline->AddComputeMemoryBarrier(*m_cmdBuf);
+
+	PreGatherPushConstants ppush;
+	ppush.numBlocks = numThreads + 1;
+	ppush.stride = 1;
+	m_preGatherPipeline->BindBufferNonblocking(0, m_offsets, *m_cmdBuf, true);
+	m_preGatherPipeline->BindBufferNonblocking(1, m_counts, *m_cmdBuf);
+	m_preGatherPipeline->Dispatch(*m_cmdBuf, ppush, GetComputeBlockCount(numThreads + 1, 64));
+	m_offsets.MarkModifiedFromGpu();
+	m_offsets.PrepareForCpuAccessNonblocking(*m_cmdBuf);
+
+	m_cmdBuf->end();
+	m_queue->SubmitAndBlock(*m_cmdBuf);
+
+	//Now we know how big the output is
+	size_t total = m_offsets[numThreads];
+	edges.resize(total);
+	if(total == 0)
+		return;
+
+	//Second pass: write the edges
+	m_cmdBuf->begin({});
+
+	m_writePipeline->BindBufferNonblocking(0, edges, *m_cmdBuf, true);
+	m_writePipeline->BindBufferNonblocking(1, wfm->m_samples, *m_cmdBuf);
+	m_writePipeline->BindBufferNonblocking(2, m_offsets, *m_cmdBuf);
+	m_writePipeline->Dispatch(*m_cmdBuf, push, compute_block_count);
+	edges.MarkModifiedFromGpu();
+	edges.PrepareForCpuAccessNonblocking(*m_cmdBuf);
+
+	m_cmdBuf->end();
+	m_queue->SubmitAndBlock(*m_cmdBuf);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+DigitalEdgeList::DigitalEdgeList()
+	: m_initialLevel(false)
+	, m_start(0)
+	, m_end(0)
+	, m_timescale(0)
+	, m_triggerPhase(0)
+{
+	//Edge lists are consumed by decoders running on the CPU
+	m_edges.SetCpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
+	m_edges.SetGpuAccessHint(AcceleratorBuffer<int64_t>::HINT_UNLIKELY);
+	m_edges.SetName("DigitalEdgeList.m_edges");
+}
+
+/**
+	@brief Frees the shared GPU extractor
+
+	Must be called before the Vulkan device is destroyed.
+ */
+void DigitalEdgeList::DestroyExtractor()
+{
+	lock_guard<mutex> lock(m_extractorMutex);
+	m_extractor = nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Extraction
+
+/**
+	@brief Gets the edge list for a digital waveform, extracting it if the cached copy is missing or stale
+
+	@param wfm	A SparseDigitalWaveform, UniformDigitalWaveform, or UniformPackedDigitalWaveform
+
+	@return The edge list (empty if the waveform is not digital)
+ */
+shared_ptr<DigitalEdgeList> DigitalEdgeList::Get(WaveformBase* wfm)
+{
+	uint64_t rev = wfm->m_revision;
+	{
+		lock_guard<mutex> lock(m_cacheMutex);
+		if(wfm->m_cachedEdgeList && (wfm->m_cachedEdgeListRevision == rev))
+			return wfm->m_cachedEdgeList;
+	}
+
+	//Extract without holding the lock, other consumers of other waveforms shouldn't have to wait for us.
+	//If two threads race on the same waveform they both do the work, but get identical results.
+	auto list = make_shared<DigitalEdgeList>();
+	list->Extract(wfm);
+
+	lock_guard<mutex> lock(m_cacheMutex);
+	wfm->m_cachedEdgeList = list;
+	wfm->m_cachedEdgeListRevision = rev;
+	return list;
+}
+
+/**
+	@brief Fills this edge list from a waveform
+ */
+void DigitalEdgeList::Extract(WaveformBase* wfm)
+{
+	m_timescale = wfm->m_timescale;
+	m_triggerPhase = wfm->m_triggerPhase;
+	if(wfm->size() == 0)
+		return;
+
+	auto sdin = WaveformCast<SparseDigitalWaveform>(wfm);
+	auto udin = WaveformCast<UniformDigitalWaveform>(wfm);
+	auto pdin = dynamic_cast<UniformPackedDigitalWaveform*>(wfm);
+
+	if(sdin)
+		ExtractSparse(sdin);
+	else if(udin)
+		ExtractUniform(udin);
+	else if(pdin)
+		ExtractPacked(pdin);
+}
+
+void DigitalEdgeList::ExtractSparse(SparseDigitalWaveform* wfm)
+{
+	wfm->PrepareForCpuAccess();
+
+	size_t len = wfm->size();
+	m_start = wfm->m_offsets[0];
+	m_end = wfm->m_offsets[len-1] + wfm->m_durations[len-1];
+	m_initialLevel = wfm->m_samples[0];
+
+	vector<int64_t> edges;
+	for(size_t i=1; i<len; i++)
+	{
+		if(wfm->m_samples[i] != wfm->m_samples[i-1])
+			edges.push_back(wfm->m_offsets[i]);
+	}
+
+	m_edges.resize(edges.size());
+	if(!edges.empty())
+		memcpy(&m_edges[0], &edges[0], edges.size() * sizeof(int64_t));
+	m_edges.MarkModifiedFromCpu();
+}
+
+void DigitalEdgeList::ExtractUniform(UniformDigitalWaveform* wfm)
+{
+	size_t len = wfm->size();
+	m_start = 0;
+	m_end = len;
+
+	//Big waveforms are scanned on the GPU, if it can handle byte addressing and 64-bit integers
+	if( (len >= GPU_EXTRACT_THRESHOLD) && g_hasShaderInt8 && g_hasShaderInt64 && (len < UINT32_MAX) )
+	{
+		{
+			lock_guard<mutex> lock(m_extractorMutex);
+			if(!m_extractor)
+				m_extractor = make_unique<Extractor>();
+			m_extractor->Run(wfm, m_edges);
+		}
+
+		wfm->m_samples.PrepareForCpuAccess();
+		m_initialLevel = wfm->m_samples[0];
+		return;
+	}
+
+	wfm->PrepareForCpuAccess();
+	m_initialLevel = wfm->m_samples[0];
+
+	vector<int64_t> edges;
+	for(size_t i=1; i<len; i++)
+	{
+		if(wfm->m_samples[i] != wfm->m_samples[i-1])
+			edges.push_back(i);
+	}
+
+	m_edges.resize(edges.size());
+	if(!edges.empty())
+		memcpy(&m_edges[0], &edges[0], edges.size() * sizeof(int64_t));
+	m_edges.MarkModifiedFromCpu();
+}
+
+void DigitalEdgeList::ExtractPacked(UniformPackedDigitalWaveform* wfm)
+{
+	wfm->PrepareForCpuAccess();
+
+	m_start = 0;
+	m_end = wfm->size();
+	m_initialLevel = wfm->GetSample(0);
+
+	vector<int64_t> edges;
+	wfm->FindEdges(edges, true, true);
+
+	m_edges.resize(edges.size());
+	if(!edges.empty())
+		memcpy(&m_edges[0], &edges[0], edges.size() * sizeof(int64_t));
+	m_edges.MarkModifiedFromCpu();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sampling
+
+/**
+	@brief Samples a digital signal on rising edges of a clock, working only from the edge lists of each
+
+	Produces the same output as Filter::SampleOnRisingEdgesBase() (femtosecond timestamps, data value as of just
+	before each clock edge) but costs O(edges) rather than O(samples), and shares the cached edge lists with any
+	other decoder looking at the same signals. Clock/data protocols like MDIO and SWD spend most of their time
+	idle, so this skips almost all of the input.
+
+	@param data		The data signal to sample. Must be sparse, uniform, or packed digital.
+	@param clock	The clock signal to use. Must be sparse, uniform, or packed digital.
+	@param samples	Output waveform
+ */
+void DigitalEdgeList::SampleOnRisingEdges(WaveformBase* data, WaveformBase* clock, SparseDigitalWaveform& samples)
+{
+	samples.clear();
+	samples.SetGpuAccessHint(AcceleratorBuffer<bool>::HINT_NEVER);	//assume we're being used as part of a CPU-side filter
+	samples.PrepareForCpuAccess();
+	if( (data->size() == 0) || (clock->size() == 0) )
+	{
+		samples.MarkModifiedFromCpu();
+		return;
+	}
+
+	auto dataEdges = Get(data);
+	auto clockEdges = Get(clock);
+
+	//Clock edges alternate rising and falling, and the first rising edge depends on the initial level
+	size_t nclk = clockEdges->size();
+	size_t first = clockEdges->GetFirstRisingEdge();
+	size_t len = (nclk > first) ? (nclk - first + 1) / 2 : 0;
+	samples.Resize(len);
+
+	size_t idata = 0;
+	for(size_t i=0; i<len; i++)
+	{
+		int64_t t = clockEdges->GetEdgeScaled(first + 2*i);
+		samples.m_offsets[i] = t;
+		samples.m_samples[i] = dataEdges->GetValueBeforeScaled(t, idata);
+	}
+
+	//Each sample lasts until the next one, last sample has constant duration
+	for(size_t i=1; i<len; i++)
+		samples.m_durations[i-1] = samples.m_offsets[i] - samples.m_offsets[i-1];
+	if(len)
+		samples.m_durations[len-1] = 1;
+
+	samples.MarkModifiedFromCpu();
+}
+
+/**
+	@brief Samples several lanes of a parallel bus on the edges of one clock, packing them into one word per edge
+
+	Equivalent to calling Filter::SampleOnRisingEdgesBase() (or SampleOnAnyEdgesBase() etc.) on each lane then
+	combining the results, but walks the clock once instead of once per lane, and works from the cached edge lists
+	of single bit lanes so idle lanes cost almost nothing. The output is split into blocks sampled in parallel on
+	the ThreadPool; each block binary searches every lane to its starting position, then walks forward.
+
+	Each output sample starts at a clock edge (femtosecond timestamps) and lasts until the next one, and holds the
+	value of every lane as of just before the edge.
+
+	@param clock	The clock signal. Must be sparse, uniform, or packed digital.
+	@param type		Which clock edges to sample on
+	@param lanes	The signals to sample, and where each goes in the output word
+	@param samples	Output waveform
+ */
+void DigitalEdgeList::SampleLanes(
+	WaveformBase* clock,
+	EdgeSampler::EdgeType type,
+	const vector<Lane>& lanes,
+	SparseDigitalBusWaveform& samples)
+{
+	samples.clear();
+	samples.SetGpuAccessHint(AcceleratorBuffer<uint64_t>::HINT_NEVER);	//assume we're being used as part of a CPU-side filter
+	samples.PrepareForCpuAccess();
+	if(clock->size() == 0)
+	{
+		samples.MarkModifiedFromCpu();
+		return;
+	}
+
+	//Figure out which clock edges we want
+	auto clockEdges = Get(clock);
+	size_t nclk = clockEdges->size();
+	size_t first = 0;
+	size_t stride = 1;
+	if(type == EdgeSampler::EDGE_RISING)
+	{
+		first = clockEdges->GetFirstRisingEdge();
+		stride = 2;
+	}
+	else if(type == EdgeSampler::EDGE_FALLING)
+	{
+		first = 1 - clockEdges->GetFirstRisingEdge();
+		stride = 2;
+	}
+	size_t len = (nclk > first) ? (nclk - first + stride - 1) / stride : 0;
+	samples.Resize(len);
+
+	//Single bit lanes are sampled from their edge lists, buses sample by sample
+	class LaneState
+	{
+	public:
+		shared_ptr<DigitalEdgeList> m_edges;
+		SparseWaveformBase* m_sparse = nullptr;
+		UniformWaveformBase* m_uniform = nullptr;
+		const uint64_t* m_samples = nullptr;
+		size_t m_len = 0;
+		unsigned int m_shift = 0;
+		uint64_t m_mask = 0;
+	};
+	vector<LaneState> states(lanes.size());
+	samples.m_width = 0;
+	for(size_t k=0; k<lanes.size(); k++)
+	{
+		auto& lane = lanes[k];
+		auto& st = states[k];
+		st.m_shift = lane.m_shift;
+		st.m_mask = lane.m_mask;
+		st.m_len = lane.m_waveform->size();
+		if(lane.m_mask)
+			samples.m_width = max(samples.m_width, static_cast<size_t>(lane.m_shift + 64 - __builtin_clzll(lane.m_mask)));
+
+		auto sbus = dynamic_cast<SparseWaveform<uint64_t>*>(lane.m_waveform);
+		auto ubus = dynamic_cast<UniformWaveform<uint64_t>*>(lane.m_waveform);
+		if(sbus)
+		{
+			sbus->PrepareForCpuAccess();
+			st.m_sparse = sbus;
+			st.m_samples = sbus->m_samples.GetCpuPointer();
+		}
+		else if(ubus)
+		{
+			ubus->PrepareForCpuAccess();
+			st.m_uniform = ubus;
+			st.m_samples = ubus->m_samples.GetCpuPointer();
+		}
+		else
+			st.m_edges = Get(lane.m_waveform);
+	}
+
+	const size_t blockSize = 65536;
+	ThreadPool::Get().ParallelFor(0, len, blockSize, [&](size_t begin, size_t end)
+		{
+			//Find where each lane is at the start of the block: number of edges (or samples) strictly before it
+			int64_t tstart = clockEdges->GetEdgeScaled(first + stride*begin);
+			vector<size_t> cursors(states.size());
+			for(size_t k=0; k<states.size(); k++)
+			{
+				auto& st = states[k];
+				size_t lo = 0;
+				size_t hi = st.m_edges ? st.m_edges->size() : st.m_len;
+				while(lo < hi)
+				{
+					size_t mid = lo + (hi - lo) / 2;
+					int64_t t = st.m_edges ?
+						st.m_edges->GetEdgeScaled(mid) : GetOffsetScaled(st.m_sparse, st.m_uniform, mid);
+					if(t < tstart)
+						lo = mid + 1;
+					else
+						hi = mid;
+				}
+				cursors[k] = lo;
+			}
+
+			for(size_t i=begin; i<end; i++)
+			{
+				int64_t t = clockEdges->GetEdgeScaled(first + stride*i);
+				samples.m_offsets[i] = t;
+
+				uint64_t value = 0;
+				for(size_t k=0; k<states.size(); k++)
+				{
+					auto& st = states[k];
+					uint64_t v;
+					if(st.m_edges)
+						v = st.m_edges->GetValueBeforeScaled(t, cursors[k]);
+					else if(st.m_len == 0)
+						v = 0;
+					else
+					{
+						//Last sample starting before the edge (or the first, if the edge precedes all of them)
+						size_t& c = cursors[k];
+						while( (c < st.m_len) && (GetOffsetScaled(st.m_sparse, st.m_uniform, c) < t) )
+							c ++;
+						v = st.m_samples[c ? c-1 : 0];
+					}
+					value |= (v & st.m_mask) << st.m_shift;
+				}
+				samples.m_samples[i] = value;
+			}
+		});
+
+	//Each sample lasts until the next one, last sample has constant duration
+	for(size_t i=1; i<len; i++)
+		samples.m_durations[i-1] = samples.m_offsets[i] - samples.m_offsets[i-1];
+	if(len)
+		samples.m_durations[len-1] = 1;
+
+	samples.MarkModifiedFromCpu();
+}
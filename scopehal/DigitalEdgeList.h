@@ -0,0 +1,205 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of DigitalEdgeList
+	@ingroup datamodel
+ */
+
+#ifndef DigitalEdgeList_h
+#define DigitalEdgeList_h
+
+struct __attribute__((packed)) DigitalEdgePushConstants
+{
+	uint32_t inputSize;
+	uint32_t inputPerThread;
+	uint32_t numThreads;
+};
+
+/**
+	@brief Run-length view of a digital waveform: the initial level plus the timestamp of every toggle
+	@ingroup datamodel
+
+	Protocol decoders mostly care about when a signal changes, not about every sample. Walking the edge list is
+	O(edges) rather than O(samples), which makes a huge difference on long, mostly idle serial lines.
+
+	Timestamps are in timebase ticks of the source waveform (the same units as GetOffset()); edge i is the offset
+	of the first sample with the new level. Use the *Scaled() helpers to work in X axis units instead.
+
+	Edge lists are created by Get(), which caches the result on the source waveform until its revision changes, so
+	every decoder attached to the same signal shares one extraction.
+ */
+class DigitalEdgeList
+{
+public:
+	DigitalEdgeList();
+
+	static std::shared_ptr<DigitalEdgeList> Get(WaveformBase* wfm);
+	static void DestroyExtractor();
+
+	static void SampleOnRisingEdges(WaveformBase* data, WaveformBase* clock, SparseDigitalWaveform& samples);
+
+	/**
+		@brief One input of SampleLanes()
+
+		Single bit lanes (sparse, uniform, or packed digital) contribute 0 or 1, buses (sparse or uniform uint64_t)
+		contribute their value. Either way the value is masked, then shifted left into place in the output word.
+	 */
+	class Lane
+	{
+	public:
+		Lane(WaveformBase* wfm, unsigned int shift, uint64_t mask = 1)
+		: m_waveform(wfm)
+		, m_shift(shift)
+		, m_mask(mask)
+		{}
+
+		///@brief The signal to sample
+		WaveformBase* m_waveform;
+
+		///@brief Bit position of the lane's LSB in the output word
+		unsigned int m_shift;
+
+		///@brief Mask applied to the lane's value before shifting
+		uint64_t m_mask;
+	};
+
+	static void SampleLanes(
+		WaveformBase* clock,
+		EdgeSampler::EdgeType type,
+		const std::vector<Lane>& lanes,
+		SparseDigitalBusWaveform& samples);
+
+	///@brief Level of the signal before the first edge
+	bool m_initialLevel;
+
+	///@brief Offset of the first sample of the source waveform, in ticks
+	int64_t m_start;
+
+	///@brief End of the last sample of the source waveform, in ticks
+	int64_t m_end;
+
+	///@brief Timebase of the source waveform
+	int64_t m_timescale;
+
+	///@brief Trigger phase of the source waveform
+	int64_t m_triggerPhase;
+
+	///@brief Timestamps of each toggle, in ticks
+	AcceleratorBuffer<int64_t> m_edges;
+
+	///@brief Number of edges
+	size_t size() const
+	{ return m_edges.size(); }
+
+	///@brief Level of the signal after edge i (and before edge i+1)
+	bool GetLevelAfterEdge(size_t i) const
+	{ return m_initialLevel == ((i & 1) != 0); }
+
+	///@brief Converts a timestamp in ticks to X axis units
+	int64_t ToScaled(int64_t t) const
+	{ return t * m_timescale + m_triggerPhase; }
+
+	///@brief Gets the timestamp of edge i, in X axis units
+	int64_t GetEdgeScaled(size_t i) const
+	{ return ToScaled(m_edges[i]); }
+
+	/**
+		@brief Gets the level of the signal at a given time, in ticks
+
+		@param t		Timestamp to look up
+		@param iedge	Cursor, initially zero. Advanced past all edges at or before t, so a series of monotonically
+						increasing lookups costs O(edges) in total.
+	 */
+	bool GetValueAt(int64_t t, size_t& iedge) const
+	{
+		size_t len = m_edges.size();
+		while( (iedge < len) && (m_edges[iedge] <= t) )
+			iedge ++;
+		return m_initialLevel != ((iedge & 1) != 0);
+	}
+
+	/**
+		@brief Gets the level of the signal at a given time, in X axis units
+
+		@param t		Timestamp to look up
+		@param iedge	Cursor, as for GetValueAt()
+	 */
+	bool GetValueAtScaled(int64_t t, size_t& iedge) const
+	{
+		size_t len = m_edges.size();
+		while( (iedge < len) && (GetEdgeScaled(iedge) <= t) )
+			iedge ++;
+		return m_initialLevel != ((iedge & 1) != 0);
+	}
+
+	/**
+		@brief Gets the level of the signal just before a given time, in X axis units
+
+		This is the value a flip-flop clocked at t would capture, as used by Filter::SampleOnRisingEdges().
+
+		@param t		Timestamp to look up
+		@param iedge	Cursor, as for GetValueAt(). Advanced past all edges strictly before t.
+	 */
+	bool GetValueBeforeScaled(int64_t t, size_t& iedge) const
+	{
+		size_t len = m_edges.size();
+		while( (iedge < len) && (GetEdgeScaled(iedge) < t) )
+			iedge ++;
+		return m_initialLevel != ((iedge & 1) != 0);
+	}
+
+	/**
+		@brief Gets the index of the first rising edge (edges then alternate falling, rising, ...)
+	 */
+	size_t GetFirstRisingEdge() const
+	{ return m_initialLevel ? 1 : 0; }
+
+protected:
+	void Extract(WaveformBase* wfm);
+	void ExtractSparse(SparseDigitalWaveform* wfm);
+	void ExtractUniform(UniformDigitalWaveform* wfm);
+	void ExtractPacked(UniformPackedDigitalWaveform* wfm);
+
+	class Extractor;
+
+	///@brief Mutex protecting the cache fields of every WaveformBase
+	static std::mutex m_cacheMutex;
+
+	///@brief Shared GPU extractor, created on first use
+	static std::unique_ptr<Extractor> m_extractor;
+
+	///@brief Mutex protecting m_extractor
+	static std::mutex m_extractorMutex;
+};
+
+#endif
@@ -0,0 +1,359 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of EdgeSampler
+	@ingroup datamodel
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+unique_ptr<EdgeSampler::Engine> EdgeSampler::m_engine;
+mutex EdgeSampler::m_engineMutex;
+
+/**
+	@brief Outputs smaller than this are computed on the CPU, since the GPU round trip costs more than it saves
+ */
+static const size_t GPU_SAMPLE_THRESHOLD = 64 * 1024;
+
+/**
+	@brief Number of outputs per block on the CPU path
+ */
+static const size_t CPU_BLOCK_SIZE = 16384;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// GPU sampling
+
+/**
+	@brief GPU accelerated sampling of an analog waveform on clock edges
+
+	One thread per output sample; the output size is known from the edge list, so there's no compaction pass.
+ */
+class EdgeSampler::Engine
+{
+public:
+	Engine();
+
+	void Run(
+		WaveformBase* data,
+		DigitalEdgeList& clockEdges,
+		SparseAnalogWaveform& samples,
+		size_t firstEdge,
+		size_t edgeStride,
+		bool interpolate);
+
+protected:
+	std::shared_ptr<QueueHandle> m_queue;
+	std::unique_ptr<vk::raii::CommandPool> m_pool;
+	std::unique_ptr<vk::raii::CommandBuffer> m_cmdBuf;
+
+	std::unique_ptr<ComputePipeline> m_pipeline;
+};
+
+EdgeSampler::Engine::Engine()
+{
+	m_queue = g_vkQueueManager->GetComputeQueue("EdgeSampler.queue");
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		m_queue->m_family );
+	m_pool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(**m_pool, vk::CommandBufferLevel::ePrimary, 1);
+	m_cmdBuf = make_unique<vk::raii::CommandBuffer>(
+		std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	if(g_hasDebugUtils)
+	{
+		string poolname = "EdgeSampler.pool";
+		string bufname = "EdgeSampler.cmdbuf";
+
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandPool,
+				reinterpret_cast<uint64_t>(static_cast<VkCommandPool>(**m_pool)),
+				poolname.c_str()));
+
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandBuffer,
+				reinterpret_cast<uint64_t>(static_cast<VkCommandBuffer>(**m_cmdBuf)),
+				bufname.c_str()));
+	}
+
+	m_pipeline = make_unique<ComputePipeline>(
+		"shaders/EdgeSampler.spv",
+		6,
+		sizeof(EdgeSamplerPushConstants));
+}
+
+/**
+	@brief Samples a waveform on the GPU
+
+	@param data			Data waveform (sparse or uniform analog)
+	@param clockEdges	Edge list of the clock
+	@param samples		Output waveform, already resized to the number of outputs
+	@param firstEdge	Index of the first clock edge to sample on
+	@param edgeStride	Distance between successive clock edges to sample on
+	@param interpolate	True to interpolate linearly between data samples
+ */
+void EdgeSampler::Engine::Run(
+	WaveformBase* data,
+	DigitalEdgeList& clockEdges,
+	SparseAnalogWaveform& samples,
+	size_t firstEdge,
+	size_t edgeStride,
+	bool interpolate)
+{
+	auto sdata = WaveformCast<SparseAnalogWaveform>(data);
+	auto udata = WaveformCast<UniformAnalogWaveform>(data);
+
+	EdgeSamplerPushConstants push;
+	push.clockTimescale = clockEdges.m_timescale;
+	push.clockTriggerPhase = clockEdges.m_triggerPhase;
+	push.dataTimescale = data->m_timescale;
+	push.dataTriggerPhase = data->m_triggerPhase;
+	push.firstEdge = firstEdge;
+	push.edgeStride = edgeStride;
+	push.outputCount = samples.size();
+	push.dataLen = data->size();
+	push.sparseData = (sdata != nullptr);
+	push.interpolate = interpolate;
+
+	//Compact representations of the input have to be expanded before the shader can index them
+	if(sdata)
+		sdata->ExpandTimestamps();
+	else
+		udata->ExpandRawSamples();
+
+	m_cmdBuf->begin({});
+
+	m_pipeline->BindBufferNonblocking(0, clockEdges.m_edges, *m_cmdBuf);
+	if(sdata)
+	{
+		m_pipeline->BindBufferNonblocking(1, sdata->m_offsets, *m_cmdBuf);
+		m_pipeline->BindBufferNonblocking(2, sdata->m_samples, *m_cmdBuf);
+	}
+	else
+	{
+		//Uniform data has no offsets, but the slot still needs a valid buffer
+		m_pipeline->BindBufferNonblocking(1, clockEdges.m_edges, *m_cmdBuf);
+		m_pipeline->BindBufferNonblocking(2, udata->m_samples, *m_cmdBuf);
+	}
+	m_pipeline->BindBufferNonblocking(3, samples.m_offsets, *m_cmdBuf, true);
+	m_pipeline->BindBufferNonblocking(4, samples.m_samples, *m_cmdBuf, true);
+	m_pipeline->BindBufferNonblocking(5, samples.m_durations, *m_cmdBuf, true);
+
+	const uint32_t compute_block_count = GetComputeBlockCount(push.outputCount, 64);
+	m_pipeline->Dispatch(*m_cmdBuf, push,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
+
+	m_cmdBuf->end();
+	m_queue->SubmitAndBlock(*m_cmdBuf);
+
+	samples.MarkModifiedFromGpu();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Frees the shared GPU engine
+
+	Must be called before the Vulkan device is destroyed.
+ */
+void EdgeSampler::DestroyEngine()
+{
+	lock_guard<mutex> lock(m_engineMutex);
+	m_engine = nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sampling
+
+/**
+	@brief Samples an analog waveform on edges of a clock
+
+	Produces the same output as the generic Filter::SampleOnAnyEdges() family: femtosecond timestamps at each clock
+	edge, the value of the last data sample strictly before the edge (or the first data sample, if there is none),
+	and durations running up to the next output sample.
+
+	@param data			The data signal to sample. Must be sparse or uniform analog.
+	@param clock		The clock signal to use. Must be sparse, uniform, or packed digital.
+	@param samples		Output waveform
+	@param type			Which edges of the clock to sample on
+	@param interpolate	True to interpolate linearly between data samples for sub-sample accuracy
+	@param cpuOnly		True if the output will only be used on the CPU
+ */
+void EdgeSampler::Sample(
+	WaveformBase* data,
+	WaveformBase* clock,
+	SparseAnalogWaveform& samples,
+	EdgeType type,
+	bool interpolate,
+	bool cpuOnly)
+{
+	samples.clear();
+	if(cpuOnly)
+		samples.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_NEVER);	//assume we're being used as part of a CPU-side filter
+
+	auto sdata = WaveformCast<SparseAnalogWaveform>(data);
+	auto udata = WaveformCast<UniformAnalogWaveform>(data);
+	if( (!sdata && !udata) || (data->size() == 0) || (clock->size() == 0) )
+	{
+		samples.MarkModifiedFromCpu();
+		return;
+	}
+
+	//Pick out the edges we want: all of them, or every other one starting from the first rising or falling edge
+	auto clockEdges = DigitalEdgeList::Get(clock);
+	size_t nedges = clockEdges->size();
+	size_t firstEdge = 0;
+	size_t edgeStride = 1;
+	if(type == EDGE_RISING)
+	{
+		firstEdge = clockEdges->GetFirstRisingEdge();
+		edgeStride = 2;
+	}
+	else if(type == EDGE_FALLING)
+	{
+		firstEdge = 1 - clockEdges->GetFirstRisingEdge();
+		edgeStride = 2;
+	}
+	size_t len = (nedges > firstEdge) ? (nedges - firstEdge + edgeStride - 1) / edgeStride : 0;
+	samples.Resize(len);
+	if(len == 0)
+	{
+		samples.MarkModifiedFromCpu();
+		return;
+	}
+
+	//Outputs headed for another GPU filter are computed in place there
+	if(!cpuOnly && (len >= GPU_SAMPLE_THRESHOLD) && g_hasShaderInt64 &&
+		(data->size() < UINT32_MAX) && (nedges < UINT32_MAX) )
+	{
+		lock_guard<mutex> lock(m_engineMutex);
+		if(!m_engine)
+			m_engine = make_unique<Engine>();
+		m_engine->Run(data, *clockEdges, samples, firstEdge, edgeStride, interpolate);
+	}
+	else
+		SampleOnCpu(data, *clockEdges, samples, firstEdge, edgeStride, interpolate);
+}
+
+/**
+	@brief CPU implementation of Sample()
+
+	Outputs are split into blocks processed in parallel. Each block binary searches for the data sample before its
+	first edge, then walks forward, so the total work is O(outputs + data samples) plus O(log n) per block.
+ */
+void EdgeSampler::SampleOnCpu(
+	WaveformBase* data,
+	DigitalEdgeList& clockEdges,
+	SparseAnalogWaveform& samples,
+	size_t firstEdge,
+	size_t edgeStride,
+	bool interpolate)
+{
+	auto sdata = WaveformCast<SparseAnalogWaveform>(data);
+	auto udata = WaveformCast<UniformAnalogWaveform>(data);
+	data->PrepareForCpuAccess();
+	samples.PrepareForCpuAccess();
+
+	size_t len = samples.size();
+	size_t dlen = data->size();
+	int64_t* pedges = clockEdges.m_edges.GetCpuPointer();
+	float* pdata = sdata ? sdata->m_samples.GetCpuPointer() : udata->m_samples.GetCpuPointer();
+	int64_t* pdoffsets = sdata ? sdata->m_offsets.GetCpuPointer() : nullptr;
+	int64_t* poffsets = samples.m_offsets.GetCpuPointer();
+	float* psamples = samples.m_samples.GetCpuPointer();
+	int64_t* pdurations = samples.m_durations.GetCpuPointer();
+
+	int64_t dataTimescale = data->m_timescale;
+	int64_t dataTriggerPhase = data->m_triggerPhase;
+	auto dataOffset = [&](size_t i)
+	{
+		if(pdoffsets)
+			return pdoffsets[i] * dataTimescale + dataTriggerPhase;
+		return static_cast<int64_t>(i) * dataTimescale + dataTriggerPhase;
+	};
+
+	size_t nblocks = (len + CPU_BLOCK_SIZE - 1) / CPU_BLOCK_SIZE;
+
+	#pragma omp parallel for
+	for(size_t nblock=0; nblock<nblocks; nblock++)
+	{
+		size_t istart = nblock * CPU_BLOCK_SIZE;
+		size_t iend = min(istart + CPU_BLOCK_SIZE, len);
+
+		//Find the last data sample strictly before our first edge
+		int64_t t = clockEdges.ToScaled(pedges[firstEdge + istart*edgeStride]);
+		size_t lo = 0;
+		size_t hi = dlen;
+		while(lo < hi)
+		{
+			size_t mid = lo + (hi - lo)/2;
+			if(dataOffset(mid) < t)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		size_t idata = (lo > 0) ? (lo - 1) : 0;
+
+		for(size_t i=istart; i<iend; i++)
+		{
+			t = clockEdges.ToScaled(pedges[firstEdge + i*edgeStride]);
+			while( (idata+1 < dlen) && (dataOffset(idata+1) < t) )
+				idata ++;
+
+			float v = pdata[idata];
+			if(interpolate && (idata+1 < dlen))
+			{
+				float frac = (t - dataOffset(idata)) * 1.0 / dataTimescale;
+				if(pdoffsets)
+					frac /= (pdoffsets[idata+1] - pdoffsets[idata]);
+				v += (pdata[idata+1] - v) * frac;
+			}
+
+			poffsets[i] = t;
+			psamples[i] = v;
+
+			//Each sample lasts until the next one, last sample has constant duration
+			if(i+1 < len)
+				pdurations[i] = clockEdges.ToScaled(pedges[firstEdge + (i+1)*edgeStride]) - t;
+			else
+				pdurations[i] = 1;
+		}
+	}
+
+	samples.MarkModifiedFromCpu();
+}
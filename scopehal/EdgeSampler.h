@@ -0,0 +1,107 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of EdgeSampler
+	@ingroup datamodel
+ */
+
+#ifndef EdgeSampler_h
+#define EdgeSampler_h
+
+class DigitalEdgeList;
+
+struct __attribute__((packed)) EdgeSamplerPushConstants
+{
+	int64_t clockTimescale;
+	int64_t clockTriggerPhase;
+	int64_t dataTimescale;
+	int64_t dataTriggerPhase;
+	uint32_t firstEdge;
+	uint32_t edgeStride;
+	uint32_t outputCount;
+	uint32_t dataLen;
+	uint32_t sparseData;
+	uint32_t interpolate;
+};
+
+/**
+	@brief Samples an analog waveform on edges of a digital clock
+	@ingroup datamodel
+
+	This is the engine behind the float specializations of Filter::SampleOnAnyEdges() and friends. Rather than
+	walking every clock sample, it works from the clock's cached DigitalEdgeList, so the number of outputs is known
+	up front and each one can be computed independently: find the edge, look up the last data sample before it
+	(directly for uniform data, by binary search for sparse data), and optionally interpolate.
+
+	Outputs which will be consumed on the GPU are computed there and never leave it. Everything else is computed on
+	the CPU, in parallel blocks which each binary search to their starting data sample and then walk forward.
+ */
+class EdgeSampler
+{
+public:
+
+	///@brief Which clock edges to sample on
+	enum EdgeType
+	{
+		EDGE_ANY,
+		EDGE_RISING,
+		EDGE_FALLING
+	};
+
+	static void Sample(
+		WaveformBase* data,
+		WaveformBase* clock,
+		SparseAnalogWaveform& samples,
+		EdgeType type,
+		bool interpolate,
+		bool cpuOnly);
+
+	static void DestroyEngine();
+
+protected:
+	static void SampleOnCpu(
+		WaveformBase* data,
+		DigitalEdgeList& clockEdges,
+		SparseAnalogWaveform& samples,
+		size_t firstEdge,
+		size_t edgeStride,
+		bool interpolate);
+
+	class Engine;
+
+	///@brief Shared GPU sampling engine, created on first use
+	static std::unique_ptr<Engine> m_engine;
+
+	///@brief Mutex protecting m_engine
+	static std::mutex m_engineMutex;
+};
+
+#endif
@@ -38,11 +38,6 @@
 #include "EyeWaveform.h"
 #include "EyeMask.h"
 
-#ifndef CANVAS_ITY_IMPLEMENTATION
-#define CANVAS_ITY_IMPLEMENTATION
-#include "../canvas_ity/src/canvas_ity.hpp"
-#endif
-
 #include <time.h>
 #include <iostream>
 
@@ -55,7 +50,14 @@ using namespace std;
 EyeMask::EyeMask()
 	: m_hitrate(0)
 	, m_timebaseIsRelative(false)
+	, m_width(0)
+	, m_height(0)
+	, m_bitmapDirty(true)
+	, m_rasterRevision(0)
+	, m_weights("EyeMask.m_weights")
 {
+	m_weights.SetCpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+	m_weights.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
 }
 
 EyeMask::~EyeMask()
@@ -182,7 +184,10 @@ bool EyeMask::Load(const YAML::Node& node)
 }
 
 /**
-	@brief Renders the mask to an offscreen buffer we can use for hit testing
+	@brief Renders the mask to the coverage buffer we use for hit testing
+
+	Each polygon is scan converted analytically: a pixel is inside if its center is (even-odd rule), and is tagged
+	with the polygon's bit from GetPolygonBit().
  */
 void EyeMask::RenderForAnalysis(
 		EyeWaveform* waveform,
@@ -190,19 +195,31 @@ void EyeMask::RenderForAnalysis(
 		float xoff,
 		float yscale,
 		float yoff,
-		float height) const
+		float height)
 {
 	LogTrace("Rendering mask for testing\n");
 
 	//clear background to blank
-	m_canvas->clear_rectangle(0, 0, m_width, m_height);
+	m_coverage.assign(m_width * m_height, 0);
 
-	//Draw each polygon
-	m_canvas->set_color( canvas_ity::fill_style, 1.0f, 1.0f, 1.0f, 1.0f );
 	float ypixoff = height / 2;
-	for(auto poly : m_polygons)
+	vector<float> xs;
+	vector<float> ys;
+	vector<float> crossings;
+	for(size_t ipoly=0; ipoly<m_polygons.size(); ipoly++)
 	{
-		for(size_t i=0; i<poly.m_points.size(); i++)
+		auto& poly = m_polygons[ipoly];
+		uint16_t bit = GetPolygonBit(ipoly);
+		size_t npoints = poly.m_points.size();
+		if(npoints < 3)
+			continue;
+
+		//Convert the vertices to pixel coordinates
+		xs.resize(npoints);
+		ys.resize(npoints);
+		float ymin = FLT_MAX;
+		float ymax = -FLT_MAX;
+		for(size_t i=0; i<npoints; i++)
 		{
 			auto point = poly.m_points[i];
 
@@ -211,22 +228,47 @@ void EyeMask::RenderForAnalysis(
 			if(m_timebaseIsRelative)
 				time *= waveform->GetUIWidth();
 
-			float x = (time - xoff) * xscale;
-			float y = ( (point.m_voltage + yoff) * -yscale ) + ypixoff;
+			xs[i] = (time - xoff) * xscale;
+			ys[i] = ( (point.m_voltage + yoff) * -yscale ) + ypixoff;
+			ymin = min(ymin, ys[i]);
+			ymax = max(ymax, ys[i]);
+		}
 
-			if(i == 0) // TODO: Probably not necessary and can always run line_to(x, y)
-				m_canvas->move_to(x, y); // Set to starting point for line if first run
-			else
-				m_canvas->line_to(x, y); // Draw line to next coord
+		//Walk each row the polygon touches, filling between pairs of edge crossings at the pixel centers
+		int64_t rowStart = max((int64_t)0, (int64_t)ceil(ymin - 0.5f));
+		int64_t rowEnd = min((int64_t)m_height, (int64_t)ceil(ymax - 0.5f));
+		for(int64_t y=rowStart; y<rowEnd; y++)
+		{
+			float yc = y + 0.5f;
+
+			crossings.clear();
+			for(size_t i=0; i<npoints; i++)
+			{
+				size_t j = (i + 1) % npoints;
+				if( (ys[i] > yc) == (ys[j] > yc) )
+					continue;
+				crossings.push_back(xs[i] + (yc - ys[i]) * (xs[j] - xs[i]) / (ys[j] - ys[i]));
+			}
+			sort(crossings.begin(), crossings.end());
+
+			auto row = &m_coverage[y * m_width];
+			for(size_t i=0; i+1 < crossings.size(); i += 2)
+			{
+				int64_t xstart = max((int64_t)0, (int64_t)ceil(crossings[i] - 0.5f));
+				int64_t xend = min((int64_t)m_width, (int64_t)ceil(crossings[i+1] - 0.5f));
+				for(int64_t x=xstart; x<xend; x++)
+					row[x] |= bit;
+			}
 		}
-		m_canvas->fill(); // fill the resultant line defined polygon with the current color (white)
 	}
 }
 
 /**
-	@brief Checks a raw eye pattern dataset against the mask
+	@brief Rasterizes the mask at the given geometry, if it isn't already
+
+	@return True if the mask was (re)rendered, false if the existing rasterization was still valid
  */
-float EyeMask::CalculateHitRate(
+bool EyeMask::Rasterize(
 	EyeWaveform* cap,
 	size_t width,
 	size_t height,
@@ -235,55 +277,106 @@ float EyeMask::CalculateHitRate(
 	float xoff
 	)
 {
-	//TODO: GPU this?
-	//For now, we're running on the CPU though. Make sure the data is here when we need it
-	if(!m_canvas || (m_width != width) || (m_height != height) || m_bitmapDirty)
+	if( (m_width == width) && (m_height == height) && !m_bitmapDirty)
+		return false;
+
+	m_width = width;
+	m_height = height;
+
+	float yscale = height / fullscalerange;
+	RenderForAnalysis(
+		cap,
+		xscale,
+		xoff,
+		yscale,
+		0,
+		height);
+
+	m_bitmapDirty = false;
+	m_rasterRevision ++;
+
+	//Fold the left half onto the right for GPU side hit counting
+	size_t halfwidth = width/2;
+	m_weights.resize(width*height);
+	m_weights.PrepareForCpuAccess();
+	for(size_t y=0; y<height; y++)
 	{
-		m_width = width;
-		m_height = height;
-		m_canvas = std::make_unique< canvas_ity::canvas >( width, height );
-
-		//Software rendering
-		float yscale = height / fullscalerange;
-		RenderForAnalysis(
-			cap,
-			xscale,
-			xoff,
-			yscale,
-			0,
-			height);
-
-		m_bitmapDirty = false;
+		auto row = &m_coverage[y*width];
+		auto wrow = m_weights.GetCpuPointer() + (y*width);
+		for(size_t x=0; x<halfwidth; x++)
+			wrow[x] = 0;
+		for(size_t x=halfwidth; x<width; x++)
+		{
+			wrow[x] = row[x];
+			if( (x - halfwidth) < halfwidth)
+				wrow[x] |= static_cast<uint32_t>(row[x - halfwidth]) << 16;
+		}
 	}
+	m_weights.MarkModifiedFromCpu();
 
-	//Test each pixel of the eye pattern against the mask
+	return true;
+}
 
-	vector<uint8_t> image_data(width*height*4);
-	m_canvas->get_image_data(image_data.data(), width, height, m_width*4, 0,0);
+/**
+	@brief Counts the total number of (EYE_ACCUM_SCALE scaled) hits on the rasterized mask in a normal eye
 
-	if(cap->GetType() == EyeWaveform::EYE_NORMAL)
-	{
-		cap->GetAccumBuffer().PrepareForCpuAccess();
-		auto accum = cap->GetAccumData();
-		size_t nhits = 0;
+	Rasterize() must have been called first.
 
-		uint32_t* data = reinterpret_cast<uint32_t*>(&image_data[0]);
-		for(size_t y=0; y<height; y++)
-		{
-			auto row = data + (y*width);
-			auto eyerow = accum + (y*width);
+	@param cap			The eye to check
+	@param polygonHits	If not null, resized to MAX_POLYGONS and filled with the hits on each polygon. Pixels
+						covered by several overlapping polygons count towards each of them, but only once in the total.
+ */
+int64_t EyeMask::CountHits(EyeWaveform* cap, vector<int64_t>* polygonHits)
+{
+	cap->GetAccumBuffer().PrepareForCpuAccess();
+	auto accum = cap->GetAccumData();
+	int64_t nhits = 0;
+
+	if(polygonHits)
+		polygonHits->assign(MAX_POLYGONS, 0);
 
-			for(size_t x=0; x<width; x++)
+	size_t len = m_width * m_height;
+	for(size_t i=0; i<len; i++)
+	{
+		//If mask pixel isn't black, count violations
+		uint16_t pix = m_coverage[i];
+		if(!pix)
+			continue;
+
+		auto hits = accum[i];
+		nhits += hits;
+		if(polygonHits)
+		{
+			for(size_t j=0; j<MAX_POLYGONS; j++)
 			{
-				//If mask pixel isn't black, count violations
-				uint32_t pix = row[x];
-				auto hits = eyerow[x];
-				if(pix & 0xff)
-					nhits += hits;
+				if(pix & (1 << j))
+					(*polygonHits)[j] += hits;
 			}
 		}
+	}
+
+	return nhits;
+}
+
+/**
+	@brief Checks a raw eye pattern dataset against the mask
+ */
+float EyeMask::CalculateHitRate(
+	EyeWaveform* cap,
+	size_t width,
+	size_t height,
+	float fullscalerange,
+	float xscale,
+	float xoff
+	)
+{
+	Rasterize(cap, width, height, fullscalerange, xscale, xoff);
 
-		LogTrace("Total %zu hits out of %zu samples\n", nhits / EYE_ACCUM_SCALE, cap->GetTotalSamples());
+	//Test each pixel of the eye pattern against the mask
+	if(cap->GetType() == EyeWaveform::EYE_NORMAL)
+	{
+		auto nhits = CountHits(cap);
+		LogTrace("Total %zu hits out of %zu samples\n", (size_t)(nhits / EYE_ACCUM_SCALE), cap->GetTotalSamples());
 		return nhits * 1.0 / (cap->GetTotalSamples() * EYE_ACCUM_SCALE);
 	}
 	else //if(cap->GetType() == EyeWaveform::EYE_BER)
@@ -292,22 +385,16 @@ float EyeMask::CalculateHitRate(
 		auto accum = cap->GetData();
 		float nmax = 0;
 
-		uint32_t* data = reinterpret_cast<uint32_t*>(&image_data[0]);
-		for(size_t y=0; y<height; y++)
+		size_t len = m_width * m_height;
+		for(size_t i=0; i<len; i++)
 		{
-			auto row = data + (y*width);
-			auto eyerow = accum + (y*width);
-			for(size_t x=0; x<width; x++)
+			//If mask pixel isn't black, count violations
+			if(m_coverage[i] != 0)
 			{
-				//If mask pixel isn't black, count violations
-				uint32_t pix = row[x];
-				if( (pix & 0xff) != 0)
-				{
-					//BER eyes don't need any preprocessing since the pixel values are already raw BER
-					float rate = eyerow[x];
-					if(rate > nmax)
-						nmax = rate;
-				}
+				//BER eyes don't need any preprocessing since the pixel values are already raw BER
+				float rate = accum[i];
+				if(rate > nmax)
+					nmax = rate;
 			}
 		}
 
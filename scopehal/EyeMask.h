@@ -37,8 +37,6 @@
 #ifndef EyeMask_h
 #define EyeMask_h
 
-#include "../canvas_ity/src/canvas_ity.hpp"
-
 class EyeDecoder2;
 class EyeWaveform;
 
@@ -126,7 +124,7 @@ public:
 		float xoff,
 		float yscale,
 		float yoff,
-		float height) const;
+		float height);
 
 	float CalculateHitRate(
 		EyeWaveform* cap,
@@ -136,6 +134,46 @@ public:
 		float xscale,
 		float xoff);
 
+	bool Rasterize(
+		EyeWaveform* cap,
+		size_t width,
+		size_t height,
+		float fullscalerange,
+		float xscale,
+		float xoff);
+
+	int64_t CountHits(EyeWaveform* cap, std::vector<int64_t>* polygonHits = nullptr);
+
+	/**
+		@brief Maximum number of polygons hits are counted separately for
+
+		Any further polygons are counted together with the last one.
+	 */
+	static const size_t MAX_POLYGONS = 16;
+
+	///@brief Gets the bit representing a polygon in the coverage and weight buffers
+	static uint32_t GetPolygonBit(size_t i)
+	{ return 1 << ( (i < MAX_POLYGONS) ? i : (MAX_POLYGONS - 1) ); }
+
+	/**
+		@brief Incremented every time the mask is re-rasterized
+
+		Anything derived from the rasterized mask (such as running hit counts) is stale if this changes.
+	 */
+	uint64_t GetRasterRevision() const
+	{ return m_rasterRevision; }
+
+	/**
+		@brief Per-pixel mask coverage of the rasterized mask, for use in shaders
+
+		One value per eye pixel. Since the eye integration only draws the right half of the eye and Normalize() then
+		copies it to the left, each right half pixel ends up in two places: the low 16 bits are the polygons (see
+		GetPolygonBit()) covering the pixel itself, and the high 16 bits the polygons covering its copy in the left
+		half. Left half pixels are zero. A hit on a pixel counts once for each half with any bit set.
+	 */
+	AcceleratorBuffer<uint32_t>& GetWeightBuffer()
+	{ return m_weights; }
+
 	///@brief Return true if there are no polygons in the mask
 	bool empty() const
 	{ return m_polygons.empty(); }
@@ -167,7 +205,12 @@ public:
 	void GetPixels(std::vector<uint8_t>& pixels)
 	{
 		pixels.resize(m_width * m_height * 4);
-		m_canvas->get_image_data(pixels.data(), m_width, m_height, m_width*4, 0,0);
+		for(size_t i=0; i<m_coverage.size(); i++)
+		{
+			uint8_t v = m_coverage[i] ? 0xff : 0;
+			for(size_t j=0; j<4; j++)
+				pixels[i*4 + j] = v;
+		}
 	}
 
 protected:
@@ -187,8 +230,8 @@ protected:
 	///@brief Human readable name of the mask (e.g. "XFI")
 	std::string m_maskname;
 
-	///@brief Canvas for rasterizing the mask
-    std::unique_ptr< canvas_ity::canvas > m_canvas;
+	///@brief Polygons covering each pixel of the rasterized mask, as a bitmask of GetPolygonBit() values
+	std::vector<uint16_t> m_coverage;
 
 	///@brief Current width
     size_t m_width;
@@ -198,6 +241,12 @@ protected:
 
     ///@brief True if we need to re-render
     bool m_bitmapDirty;
+
+	///@brief Number of times the mask has been rasterized
+	uint64_t m_rasterRevision;
+
+	///@brief Hit weight of each eye pixel (see GetWeightBuffer())
+	AcceleratorBuffer<uint32_t> m_weights;
 };
 
 #endif
@@ -0,0 +1,409 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of EyeStatistics
+	@ingroup datamodel
+ */
+
+#include "scopehal.h"
+#include "EyeStatistics.h"
+
+using namespace std;
+
+mutex EyeStatistics::m_cacheMutex;
+unique_ptr<EyeStatistics::Engine> EyeStatistics::m_engine;
+mutex EyeStatistics::m_engineMutex;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// GPU reduction
+
+/**
+	@brief GPU accelerated reductions of an eye pattern
+ */
+class EyeStatistics::Engine
+{
+public:
+	Engine();
+
+	void RunOccupancy(EyeWaveform* eye, EyeStatistics& stats);
+	void RunBERProfile(EyeWaveform* eye, EyeBERProfilePushConstants& push, vector<float>& ber);
+
+protected:
+	std::shared_ptr<QueueHandle> m_queue;
+	std::unique_ptr<vk::raii::CommandPool> m_pool;
+	std::unique_ptr<vk::raii::CommandBuffer> m_cmdBuf;
+
+	std::unique_ptr<ComputePipeline> m_occupancyPipeline;
+	std::unique_ptr<ComputePipeline> m_berProfilePipeline;
+
+	///@brief Packed hit bitmap
+	AcceleratorBuffer<uint32_t> m_occupancy;
+
+	///@brief BER of each requested point
+	AcceleratorBuffer<float> m_ber;
+};
+
+EyeStatistics::Engine::Engine()
+{
+	m_queue = g_vkQueueManager->GetComputeQueue("EyeStatistics.queue");
+
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		m_queue->m_family );
+	m_pool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(**m_pool, vk::CommandBufferLevel::ePrimary, 1);
+	m_cmdBuf = make_unique<vk::raii::CommandBuffer>(
+		std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	if(g_hasDebugUtils)
+	{
+		string poolname = "EyeStatistics.pool";
+		string bufname = "EyeStatistics.cmdbuf";
+
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandPool,
+				reinterpret_cast<uint64_t>(static_cast<VkCommandPool>(**m_pool)),
+				poolname.c_str()));
+
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandBuffer,
+				reinterpret_cast<uint64_t>(static_cast<VkCommandBuffer>(**m_cmdBuf)),
+				bufname.c_str()));
+	}
+
+	m_occupancyPipeline = make_unique<ComputePipeline>(
+		"shaders/EyeStatistics_Occupancy.spv",
+		2,
+		sizeof(EyeOccupancyPushConstants));
+	if(g_hasShaderInt64)
+	{
+		m_berProfilePipeline = make_unique<ComputePipeline>(
+			"shaders/EyeStatistics_BERProfile.spv",
+			2,
+			sizeof(EyeBERProfilePushConstants));
+	}
+
+	m_occupancy.SetCpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+	m_occupancy.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+	m_ber.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_ber.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+
+	m_occupancy.SetName("EyeStatistics.m_occupancy");
+	m_ber.SetName("EyeStatistics.m_ber");
+}
+
+/**
+	@brief Reduces the normalized eye to a hit bitmap
+
+	@param eye		The eye
+	@param stats	Statistics object to fill (dimensions already set)
+ */
+void EyeStatistics::Engine::RunOccupancy(EyeWaveform* eye, EyeStatistics& stats)
+{
+	EyeOccupancyPushConstants push;
+	push.width = stats.m_width;
+	push.height = stats.m_height;
+	push.wordsPerRow = stats.m_wordsPerRow;
+	push.threshold = HIT_THRESHOLD;
+
+	size_t nwords = stats.m_wordsPerRow * stats.m_height;
+	m_occupancy.resize(nwords);
+
+	m_cmdBuf->begin({});
+
+	m_occupancyPipeline->BindBufferNonblocking(0, eye->GetOutData(), *m_cmdBuf);
+	m_occupancyPipeline->BindBufferNonblocking(1, m_occupancy, *m_cmdBuf, true);
+	const uint32_t compute_block_count = GetComputeBlockCount(nwords, 64);
+	m_occupancyPipeline->Dispatch(*m_cmdBuf, push,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
+	m_occupancy.MarkModifiedFromGpu();
+
+	m_occupancy.PrepareForCpuAccessNonblocking(*m_cmdBuf);
+
+	m_cmdBuf->end();
+	m_queue->SubmitAndBlock(*m_cmdBuf);
+
+	memcpy(&stats.m_occupancy[0], m_occupancy.GetCpuPointer(), nwords * sizeof(uint32_t));
+}
+
+/**
+	@brief Computes the BER of a line of points
+
+	@param eye		The eye
+	@param push		Push constants describing the line
+	@param ber		BER of each point
+ */
+void EyeStatistics::Engine::RunBERProfile(EyeWaveform* eye, EyeBERProfilePushConstants& push, vector<float>& ber)
+{
+	m_ber.resize(push.count);
+
+	m_cmdBuf->begin({});
+
+	m_berProfilePipeline->BindBufferNonblocking(0, eye->GetAccumBuffer(), *m_cmdBuf);
+	m_berProfilePipeline->BindBufferNonblocking(1, m_ber, *m_cmdBuf, true);
+	m_berProfilePipeline->Dispatch(*m_cmdBuf, push, GetComputeBlockCount(push.count, 64));
+	m_ber.MarkModifiedFromGpu();
+
+	m_ber.PrepareForCpuAccessNonblocking(*m_cmdBuf);
+
+	m_cmdBuf->end();
+	m_queue->SubmitAndBlock(*m_cmdBuf);
+
+	ber.resize(push.count);
+	memcpy(&ber[0], m_ber.GetCpuPointer(), push.count * sizeof(float));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+EyeStatistics::EyeStatistics()
+	: m_width(0)
+	, m_height(0)
+	, m_wordsPerRow(0)
+{
+}
+
+/**
+	@brief Frees the shared GPU engine
+
+	Must be called before the Vulkan device is destroyed.
+ */
+void EyeStatistics::DestroyEngine()
+{
+	lock_guard<mutex> lock(m_engineMutex);
+	m_engine = nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reduction
+
+/**
+	@brief Gets the statistics for an eye, computing them if the cached copy is missing or stale
+
+	@param eye	The eye
+ */
+shared_ptr<EyeStatistics> EyeStatistics::Get(EyeWaveform* eye)
+{
+	uint64_t rev = eye->m_revision;
+	{
+		lock_guard<mutex> lock(m_cacheMutex);
+		if(eye->m_cachedEyeStatistics && (eye->m_cachedEyeStatisticsRevision == rev))
+			return eye->m_cachedEyeStatistics;
+	}
+
+	//Same locking strategy as DigitalEdgeList::Get()
+	auto stats = make_shared<EyeStatistics>();
+	stats->Compute(eye);
+
+	lock_guard<mutex> lock(m_cacheMutex);
+	eye->m_cachedEyeStatistics = stats;
+	eye->m_cachedEyeStatisticsRevision = rev;
+	return stats;
+}
+
+/**
+	@brief Fills this object from an eye
+ */
+void EyeStatistics::Compute(EyeWaveform* eye)
+{
+	m_width = eye->GetWidth();
+	m_height = eye->GetHeight();
+	m_wordsPerRow = (m_width + 31) / 32;
+	m_occupancy.resize(m_wordsPerRow * m_height);
+	if(m_occupancy.empty())
+		return;
+
+	//Only go to the GPU if that's the only place the eye is, otherwise a CPU scan is cheaper than the round trip
+	if(eye->GetOutData().IsCurrentOnlyOnGpu())
+	{
+		lock_guard<mutex> lock(m_engineMutex);
+		if(!m_engine)
+			m_engine = make_unique<Engine>();
+		m_engine->RunOccupancy(eye, *this);
+	}
+	else
+		ComputeOnCpu(eye);
+}
+
+void EyeStatistics::ComputeOnCpu(EyeWaveform* eye)
+{
+	float* data = eye->GetData();
+	for(size_t y=0; y<m_height; y++)
+	{
+		float* row = data + y*m_width;
+		uint32_t* bits = &m_occupancy[y*m_wordsPerRow];
+		for(size_t i=0; i<m_wordsPerRow; i++)
+		{
+			size_t x0 = i*32;
+			size_t nbits = min((size_t)32, m_width - x0);
+
+			uint32_t word = 0;
+			for(size_t b=0; b<nbits; b++)
+			{
+				if(row[x0 + b] > HIT_THRESHOLD)
+					word |= (1u << b);
+			}
+			bits[i] = word;
+		}
+	}
+}
+
+/**
+	@brief Computes the BER at a line of points through the eye (see EyeWaveform::GetBERAtPoint())
+
+	Not cached, since the points depend on the caller's settings.
+
+	@param eye			The eye
+	@param horizontal	True for a row of points, false for a column
+	@param index		Index of the row or column
+	@param first		Index of the first point within the row or column
+	@param count		Number of points
+	@param xmid			X coordinate of the eye center
+	@param ymid			Y coordinate of the eye center
+	@param ber			BER of each point
+ */
+void EyeStatistics::GetBERProfile(
+	EyeWaveform* eye,
+	bool horizontal,
+	size_t index,
+	size_t first,
+	size_t count,
+	ssize_t xmid,
+	ssize_t ymid,
+	vector<float>& ber)
+{
+	ber.resize(count);
+	if(count == 0)
+		return;
+
+	//GPU path needs int64 support and is only worth it if the accumulator is already there
+	if(g_hasShaderInt64 && eye->GetAccumBuffer().IsCurrentOnlyOnGpu())
+	{
+		EyeBERProfilePushConstants push;
+		push.width = eye->GetWidth();
+		push.height = eye->GetHeight();
+		push.xmid = xmid;
+		push.ymid = ymid;
+		push.horizontal = horizontal;
+		push.index = index;
+		push.first = first;
+		push.count = count;
+		push.isBER = (eye->GetType() == EyeWaveform::EYE_BER);
+
+		lock_guard<mutex> lock(m_engineMutex);
+		if(!m_engine)
+			m_engine = make_unique<Engine>();
+		m_engine->RunBERProfile(eye, push, ber);
+	}
+
+	else
+	{
+		for(size_t i=0; i<count; i++)
+		{
+			if(horizontal)
+				ber[i] = eye->GetBERAtPoint(first + i, index, xmid, ymid);
+			else
+				ber[i] = eye->GetBERAtPoint(index, first + i, xmid, ymid);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+/**
+	@brief Finds the first hit above and below a point in one column of the eye
+
+	@param x		Column
+	@param mid		Row to search up and down from
+	@param bottom	First hit row at or below mid (0 if none)
+	@param top		First hit row at or above mid (the eye height if none)
+ */
+void EyeStatistics::GetColumnOpening(size_t x, size_t mid, size_t& bottom, size_t& top) const
+{
+	top = mid;
+	for(; top < m_height; top ++)
+	{
+		if(IsHit(x, top))
+			break;
+	}
+
+	bottom = mid;
+	for(; bottom > 0; bottom --)
+	{
+		if(IsHit(x, bottom))
+			break;
+	}
+}
+
+/**
+	@brief Finds the inner and outer edges of the eye opening in one row
+
+	@param y		Row
+	@param cleft	Innermost hit left of center (0 if none)
+	@param cright	Innermost hit right of center (width-1 if none)
+	@param left		Outermost hit left of center (width-1 if none)
+	@param right	Outermost hit right of center (0 if none)
+ */
+void EyeStatistics::GetRowEdges(size_t y, int64_t& cleft, int64_t& cright, int64_t& left, int64_t& right) const
+{
+	int64_t w = m_width;
+	int64_t xcenter = w / 2;
+
+	cleft = 0;
+	cright = w-1;
+	left = cright;
+	right = cleft;
+
+	for(int64_t dx = 0; dx < xcenter; dx ++)
+	{
+		//left of center
+		int64_t x = xcenter - dx;
+		if(IsHit(x, y))
+		{
+			cleft = max(cleft, x);
+			left = min(left, x);
+		}
+
+		//right of center
+		x = xcenter + dx;
+		if(IsHit(x, y))
+		{
+			cright = min(cright, x);
+			right = max(right, x);
+		}
+	}
+}
@@ -0,0 +1,130 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of EyeStatistics
+	@ingroup datamodel
+ */
+
+#ifndef EyeStatistics_h
+#define EyeStatistics_h
+
+#include "EyeWaveform.h"
+
+struct __attribute__((packed)) EyeOccupancyPushConstants
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t wordsPerRow;
+	float threshold;
+};
+
+struct __attribute__((packed)) EyeBERProfilePushConstants
+{
+	uint32_t width;
+	uint32_t height;
+	int32_t xmid;
+	int32_t ymid;
+	uint32_t horizontal;
+	uint32_t index;
+	uint32_t first;
+	uint32_t count;
+	uint32_t isBER;
+};
+
+/**
+	@brief Statistics of an eye pattern which eye measurements are derived from
+	@ingroup datamodel
+
+	Eye height, width and jitter measurements only care whether each pixel of the normalized eye was hit at all.
+	Rather than each of them reading back the whole float32 eye and scanning it, Get() reduces the eye to a bitmap
+	with one bit per pixel (on the GPU, if that's where the eye is) and caches it on the eye until its revision
+	changes. Consumers then search rows and columns of the bitmap.
+
+	Bathtub curves need the raw hit counts along a line through the eye, so GetBERProfile() computes just the BER of
+	the requested points on the GPU and only those are read back.
+ */
+class EyeStatistics
+{
+public:
+	EyeStatistics();
+
+	static std::shared_ptr<EyeStatistics> Get(EyeWaveform* eye);
+	static void GetBERProfile(
+		EyeWaveform* eye,
+		bool horizontal,
+		size_t index,
+		size_t first,
+		size_t count,
+		ssize_t xmid,
+		ssize_t ymid,
+		std::vector<float>& ber);
+	static void DestroyEngine();
+
+	///@brief Normalized values above this count as a hit
+	static constexpr float HIT_THRESHOLD = FLT_EPSILON;
+
+	///@brief Checks if a pixel of the eye was hit
+	bool IsHit(size_t x, size_t y) const
+	{ return (m_occupancy[y*m_wordsPerRow + x/32] >> (x % 32)) & 1; }
+
+	void GetColumnOpening(size_t x, size_t mid, size_t& bottom, size_t& top) const;
+	void GetRowEdges(size_t y, int64_t& cleft, int64_t& cright, int64_t& left, int64_t& right) const;
+
+	///@brief Width of the eye, in pixels
+	size_t m_width;
+
+	///@brief Height of the eye, in pixels
+	size_t m_height;
+
+	///@brief Number of 32-bit words per row of m_occupancy
+	size_t m_wordsPerRow;
+
+	///@brief One bit per pixel, set if the pixel was hit. Rows are padded to a whole number of words
+	std::vector<uint32_t> m_occupancy;
+
+protected:
+	void Compute(EyeWaveform* eye);
+	void ComputeOnCpu(EyeWaveform* eye);
+
+	class Engine;
+
+	///@brief Mutex protecting the cache fields of every EyeWaveform
+	static std::mutex m_cacheMutex;
+
+	///@brief Shared GPU engine, created on first use
+	static std::unique_ptr<Engine> m_engine;
+
+	///@brief Mutex protecting m_engine
+	static std::mutex m_engineMutex;
+};
+
+#endif
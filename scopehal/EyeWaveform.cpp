@@ -63,6 +63,7 @@ EyeWaveform::EyeWaveform(size_t width, size_t height, float center, EyeType etyp
 	, m_centerVoltage(center)
 	, m_maskHitRate(0)
 	, m_type(etype)
+	, m_cachedEyeStatisticsRevision(0)
 {
 	m_accumdata.SetCpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
 	m_accumdata.SetGpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
@@ -41,6 +41,8 @@
 
 #define EYE_ACCUM_SCALE 64
 
+class EyeStatistics;
+
 class EyeNormalizeConstants
 {
 public:
@@ -115,7 +117,8 @@ public:
 
 		This does not actually do anything to waveform data, it just increments the symbol count.
 
-		Typically called by filters at the end of a refresh cycle.
+		Typically called by filters at the end of a refresh cycle. Also bumps the revision number, since the
+		accumulated data is updated in place and consumers may cache results derived from it.
 
 		@param uis		Number of UIs integrated
 		@param samples	Number of samples integrated
@@ -124,6 +127,7 @@ public:
 	{
 		m_totalUIs += uis;
 		m_totalSamples += samples;
+		m_revision ++;
 	}
 
 	///@brief Return the UI width, in X axis units
@@ -157,6 +161,21 @@ public:
 	void SetMaskHitRate(float rate)
 	{ m_maskHitRate = rate; }
 
+	/**
+		@brief Hit rate of each polygon of the mask, in mask file order (see EyeMask::GetPolygonBit())
+
+		Empty if there is no mask, or the owner doesn't count hits per polygon.
+	 */
+	std::vector<float> m_maskPolygonHitRates;
+
+	/**
+		@brief Start times of UIs of the most recent input waveform which hit the mask
+
+		Only filled when the mask test is done as part of the integration, and capped at a fixed number of UIs.
+		Times are in X axis units of that waveform.
+	 */
+	std::vector<int64_t> m_maskFailingUIs;
+
 	double GetBERAtPoint(ssize_t pointx, ssize_t pointy, ssize_t xmid, ssize_t ymid);
 
 	///@brief Return the eye type (normal or BER)
@@ -185,6 +204,13 @@ public:
 		m_accumdata.PrepareForCpuAccess();
 	}
 
+	virtual ReadbackFuture PrepareForCpuAccessAsync() override
+	{
+		auto ret = m_outdata.PrepareForCpuAccessAsync();
+		ret.Merge(m_accumdata.PrepareForCpuAccessAsync());
+		return ret;
+	}
+
 	virtual void PrepareForGpuAccess() override
 	{
 		m_outdata.PrepareForGpuAccess();
@@ -234,6 +260,14 @@ protected:
 
 	///@brief Type of the eye pattern
 	EyeType m_type;
+
+	friend class EyeStatistics;
+
+	///@brief Statistics computed from this eye by EyeStatistics::Get(), if any
+	std::shared_ptr<EyeStatistics> m_cachedEyeStatistics;
+
+	///@brief Revision m_cachedEyeStatistics was computed from
+	uint64_t m_cachedEyeStatisticsRevision;
 };
 
 #endif
@@ -45,10 +45,13 @@ using namespace std;
 Filter::CreateMapType Filter::m_createprocs;
 set<Filter*> Filter::m_filters;
 
-mutex Filter::m_cacheMutex;
-map<pair<WaveformBase*, float>, vector<int64_t> > Filter::m_zeroCrossingCache;
-
 map<string, unsigned int> Filter::m_instanceCount;
+mutex Filter::m_filtersMutex;
+
+atomic<uint64_t> Filter::m_steadyStateAllocations(0);
+
+mutex Filter::m_gpuCrossoverMutex;
+map<string, size_t> Filter::m_gpuCrossovers;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Construction / destruction
@@ -60,9 +63,14 @@ Filter::Filter(
 	: OscilloscopeChannel(NULL, "", color, xunit, 0)	//TODO: handle this better?
 	, m_category(cat)
 	, m_usingDefault(true)
+	, m_outputPool(OUTPUT_POOL_DEPTH)
+	, m_outputAllocationCount(0)
 {
 	m_instanceNum = 0;
-	m_filters.emplace(this);
+	{
+		lock_guard<mutex> lock(m_filtersMutex);
+		m_filters.emplace(this);
+	}
 
 	//Create default stream gain/offset
 	m_ranges.push_back(0);
@@ -71,6 +79,7 @@ Filter::Filter(
 
 Filter::~Filter()
 {
+	lock_guard<mutex> lock(m_filtersMutex);
 	m_filters.erase(this);
 }
 
@@ -94,6 +103,53 @@ void Filter::Release()
 		delete this;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stream demand
+
+/**
+	@brief Registers a consumer outside the filter graph (a waveform view, export, measurement readout...) of a stream
+
+	When the executor evaluates lazily (see FilterGraphExecutor::SetLazyEvaluation()), streams with neither an
+	external consumer nor a live consumer inside the graph are not computed, and filters none of whose streams are
+	demanded are not refreshed at all. Every call must be balanced by a call to RemoveStreamConsumer().
+
+	@param stream	Index of the stream
+ */
+void Filter::AddStreamConsumer(size_t stream)
+{
+	lock_guard<mutex> lock(m_streamConsumersMutex);
+	if(m_streamConsumers.size() <= stream)
+		m_streamConsumers.resize(stream + 1, 0);
+	m_streamConsumers[stream] ++;
+}
+
+/**
+	@brief Unregisters a consumer previously added by AddStreamConsumer()
+
+	@param stream	Index of the stream
+ */
+void Filter::RemoveStreamConsumer(size_t stream)
+{
+	lock_guard<mutex> lock(m_streamConsumersMutex);
+	if( (stream >= m_streamConsumers.size()) || (m_streamConsumers[stream] == 0) )
+	{
+		LogWarning("Filter::RemoveStreamConsumer: stream %zu of %s has no consumers\n", stream, GetHwname().c_str());
+		return;
+	}
+	m_streamConsumers[stream] --;
+}
+
+/**
+	@brief Checks if a stream has any consumers outside the filter graph
+
+	@param stream	Index of the stream
+ */
+bool Filter::HasStreamConsumers(size_t stream)
+{
+	lock_guard<mutex> lock(m_streamConsumersMutex);
+	return (stream < m_streamConsumers.size()) && (m_streamConsumers[stream] != 0);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Enumeration
 
@@ -110,9 +166,11 @@ void Filter::EnumProtocols(vector<string>& names)
 
 Filter* Filter::CreateFilter(const string& protocol, const string& color)
 {
-	if(m_createprocs.find(protocol) != m_createprocs.end())
+	auto it = m_createprocs.find(protocol);
+	if(it != m_createprocs.end())
 	{
-		auto f = m_createprocs[protocol](color);
+		auto f = it->second(color);
+		lock_guard<mutex> lock(m_filtersMutex);
 		f->m_instanceNum = (m_instanceCount[protocol] ++);
 		return f;
 	}
@@ -121,6 +179,96 @@ Filter* Filter::CreateFilter(const string& protocol, const string& color)
 	return NULL;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CPU/GPU dispatch
+
+/**
+	@brief Sets the smallest input size at which a filter should use its GPU path
+
+	This is normally fed from measured data (see FilterBenchmark::ApplyCrossovers()). Filters without a crossover
+	use the GPU whenever g_gpuFilterEnabled is set.
+
+	@param protocol	Protocol display name of the filter
+	@param depth	Input size, in points, from which the GPU path is faster. Zero to always use the GPU.
+ */
+void Filter::SetGpuCrossover(const string& protocol, size_t depth)
+{
+	lock_guard<mutex> lock(m_gpuCrossoverMutex);
+	if(depth == 0)
+		m_gpuCrossovers.erase(protocol);
+	else
+		m_gpuCrossovers[protocol] = depth;
+}
+
+/**
+	@brief Gets the smallest input size at which a filter uses its GPU path, or zero if there is no crossover
+ */
+size_t Filter::GetGpuCrossover(const string& protocol)
+{
+	lock_guard<mutex> lock(m_gpuCrossoverMutex);
+	auto it = m_gpuCrossovers.find(protocol);
+	if(it == m_gpuCrossovers.end())
+		return 0;
+	return it->second;
+}
+
+/**
+	@brief Removes all crossovers, so every filter uses the GPU whenever g_gpuFilterEnabled is set
+ */
+void Filter::ClearGpuCrossovers()
+{
+	lock_guard<mutex> lock(m_gpuCrossoverMutex);
+	m_gpuCrossovers.clear();
+}
+
+/**
+	@brief Decides whether a filter with both CPU and GPU implementations should use the GPU for this refresh
+
+	This only looks at the size of the input, see the overload with no arguments to also consider where the input
+	data currently lives.
+
+	@param depth	Number of points in the input being processed
+ */
+bool Filter::IsGpuPreferred(size_t depth)
+{
+	if(!g_gpuFilterEnabled)
+		return false;
+	return depth >= GetGpuCrossover(GetProtocolDisplayName());
+}
+
+/**
+	@brief Decides whether a filter with both CPU and GPU implementations should use the GPU for this refresh,
+	based on the current inputs
+
+	Inputs at or above the measured crossover size run on the GPU. Below it, the CPU path is used unless an input is
+	only up to date in GPU memory: downloading it would cost about as much as the dispatch we are trying to avoid,
+	and would leave our output on the CPU for consumers which may well want it back on the GPU.
+
+	Filters using this must return LOC_DONTCARE from GetInputLocation() and move their own inputs, since the right
+	place for them isn't known until Refresh() is called.
+ */
+bool Filter::IsGpuPreferred()
+{
+	if(!g_gpuFilterEnabled)
+		return false;
+
+	size_t depth = 0;
+	bool gpuOnly = false;
+	for(size_t i=0; i<GetInputCount(); i++)
+	{
+		auto data = GetInput(i).GetData();
+		if(!data)
+			continue;
+		depth = max(depth, data->size());
+		if(data->IsCurrentOnlyOnGpu())
+			gpuOnly = true;
+	}
+
+	if(depth >= GetGpuCrossover(GetProtocolDisplayName()))
+		return true;
+	return gpuOnly;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Input verification helpers
 
@@ -179,7 +327,7 @@ bool Filter::VerifyAllInputsOKAndUniformAnalog()
 		if(data->size() == 0)
 			return false;
 
-		auto adata = dynamic_cast<UniformAnalogWaveform*>(data);
+		auto adata = WaveformCast<UniformAnalogWaveform>(data);
 		if(adata == nullptr)
 			return false;
 	}
@@ -203,7 +351,7 @@ bool Filter::VerifyAllInputsOKAndSparseAnalog()
 		if(data->size() == 0)
 			return false;
 
-		auto adata = dynamic_cast<SparseAnalogWaveform*>(data);
+		auto adata = WaveformCast<SparseAnalogWaveform>(data);
 		if(adata == nullptr)
 			return false;
 	}
@@ -227,7 +375,7 @@ bool Filter::VerifyAllInputsOKAndSparseDigital()
 		if(data->size() == 0)
 			return false;
 
-		auto ddata = dynamic_cast<SparseDigitalWaveform*>(data);
+		auto ddata = WaveformCast<SparseDigitalWaveform>(data);
 		if(ddata == nullptr)
 			return false;
 	}
@@ -251,8 +399,8 @@ bool Filter::VerifyAllInputsOKAndSparseOrUniformDigital()
 		if(data->size() == 0)
 			return false;
 
-		auto ddata = dynamic_cast<SparseDigitalWaveform*>(data);
-		auto udata = dynamic_cast<UniformDigitalWaveform*>(data);
+		auto ddata = WaveformCast<SparseDigitalWaveform>(data);
+		auto udata = WaveformCast<UniformDigitalWaveform>(data);
 		if( (ddata == nullptr) && (udata == nullptr) )
 			return false;
 	}
@@ -260,6 +408,22 @@ bool Filter::VerifyAllInputsOKAndSparseOrUniformDigital()
 	return true;
 }
 
+/**
+	@brief Converts any inputs holding raw ADC codes to floating point
+
+	For filters which report AcceptsRawSamples() because one of their code paths (typically SetupElementwiseOp())
+	can read the codes in place, to call from the paths which can't.
+ */
+void Filter::ExpandRawInputs()
+{
+	for(size_t i=0; i<m_inputs.size(); i++)
+	{
+		auto data = GetInputWaveform(i);
+		if(data)
+			data->ExpandRawSamples();
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Sampling helpers
 
@@ -313,41 +477,55 @@ void Filter::FillDurationsAVX2(SparseWaveformBase& wfm)
 #endif /* __x86_64__ */
 
 /**
-	@brief Find rising edges in a waveform, interpolating to sub-sample resolution as necessary
+	@brief Find rising edges in an analog waveform, as every other entry of its cached LevelCrossingList
+
+	Crossings alternate in direction, so once we know which way the first one goes the rest follow. The search (on
+	the GPU, for big waveforms) is shared with every other filter looking at the same signal and threshold.
+
+	@param data				The waveform
+	@param threshold		Threshold to compare against
+	@param firstPairChecked	True if the crossing list includes a crossing between samples 0 and 1. Edges there
+							have never been reported as rising edges, so we skip it.
+	@param edges			Timestamps of the rising edges are appended here
  */
-void Filter::FindRisingEdges(UniformAnalogWaveform* data, float threshold, std::vector<int64_t>& edges)
+template<class T>
+static void FindRisingCrossings(T* data, float threshold, bool firstPairChecked, vector<int64_t>& edges)
 {
-	//Find times of the zero crossings
-	bool first = true;
-	bool last = false;
-	int64_t phoff = data->m_triggerPhase;
-	size_t len = data->size();
-	float fscale = data->m_timescale;
+	if(data->size() < 3)
+		return;
 
-	for(size_t i=1; i<len; i++)
-	{
-		bool value = data->m_samples[i] > threshold;
+	auto list = LevelCrossingList::Get(data, threshold);
+	size_t ncross = list->size();
+	if(ncross == 0)
+		return;
 
-		//Save the last value
-		if(first)
-		{
-			last = value;
-			first = false;
-			continue;
-		}
-		if(!value)
-			last = false;
+	data->m_samples.PrepareForCpuAccess();
+	bool v0 = data->m_samples[0] > threshold;
+	bool v1 = data->m_samples[1] > threshold;
+
+	//Everything after sample 1 alternates starting from the level of sample 1
+	size_t first = 0;
+	if(firstPairChecked && (v0 != v1))
+		first = 1;
+	if(v1)
+		first ++;
+	if(first >= ncross)
+		return;
 
-		//Skip samples with no rising edge
-		if(!value || last)
-			continue;
+	list->m_crossings.PrepareForCpuAccess();
+	size_t start = edges.size();
+	size_t count = (ncross - first + 1) / 2;
+	edges.resize(start + count);
+	for(size_t i=0; i<count; i++)
+		edges[start + i] = list->m_crossings[first + 2*i];
+}
 
-		//Midpoint of the sample, plus the zero crossing
-		int64_t tfrac = fscale * InterpolateTime(data, i-1, threshold);
-		int64_t t = phoff + data->m_timescale*(i-1) + tfrac;
-		edges.push_back(t);
-		last = true;
-	}
+/**
+	@brief Find rising edges in a waveform, interpolating to sub-sample resolution as necessary
+ */
+void Filter::FindRisingEdges(UniformAnalogWaveform* data, float threshold, std::vector<int64_t>& edges)
+{
+	FindRisingCrossings(data, threshold, true, edges);
 }
 
 /**
@@ -355,151 +533,75 @@ void Filter::FindRisingEdges(UniformAnalogWaveform* data, float threshold, std::
  */
 void Filter::FindRisingEdges(SparseAnalogWaveform* data, float threshold, std::vector<int64_t>& edges)
 {
-	//Find times of the zero crossings
-	bool first = true;
-	bool last = false;
-	int64_t phoff = data->m_triggerPhase;
-	size_t len = data->size();
-	float fscale = data->m_timescale;
-
-	for(size_t i=1; i<len; i++)
-	{
-		bool value = data->m_samples[i] > threshold;
-
-		//Save the last value
-		if(first)
-		{
-			last = value;
-			first = false;
-			continue;
-		}
-
-		if(!value)
-			last = false;
-
-		//Skip samples with no rising edge
-		if(!value || last)
-			continue;
-
-		//Midpoint of the sample, plus the zero crossing
-		int64_t tfrac = fscale * InterpolateTime(data, i-1, threshold);
-		int64_t t = phoff + data->m_timescale * data->m_offsets[i-1] + tfrac;
-		edges.push_back(t);
-		last = true;
-	}
+	FindRisingCrossings(data, threshold, false, edges);
 }
 
 /**
 	@brief Find zero crossings in a waveform, interpolating as necessary
+
+	The crossings are cached on the waveform by LevelCrossingList, so every filter looking at the same signal and
+	threshold shares one search. Use LevelCrossingList::Get() directly to avoid copying them.
  */
 void Filter::FindZeroCrossings(SparseAnalogWaveform* data, float threshold, vector<int64_t>& edges)
 {
-	pair<WaveformBase*, float> cachekey(data, threshold);
-
-	//Check cache
-	{
-		lock_guard<mutex> lock(m_cacheMutex);
-		auto it = m_zeroCrossingCache.find(cachekey);
-		if(it != m_zeroCrossingCache.end())
-		{
-			edges = it->second;
-			return;
-		}
-	}
-
-	//Preallocate a bunch of outputs to reduce reallocations
-	edges.reserve(1024 * 1024);
-
-	//Find times of the zero crossings
-	bool first = true;
-	bool last = false;
-	int64_t phoff = data->m_triggerPhase;
-	size_t len = data->m_samples.size();
-	float fscale = data->m_timescale;
-
-	for(size_t i=1; i<len; i++)
-	{
-		bool value = data->m_samples[i] > threshold;
-
-		//Save the last value
-		if(first)
-		{
-			last = value;
-			first = false;
-			continue;
-		}
-
-		//Skip samples with no transition
-		if(last == value)
-			continue;
-
-		//Midpoint of the sample, plus the zero crossing
-		int64_t tfrac = fscale * InterpolateTime(data, i-1, threshold);
-		int64_t t = phoff + data->m_timescale * data->m_offsets[i-1] + tfrac;
-		edges.push_back(t);
-		last = value;
-	}
-
-	//Add to cache
-	lock_guard<mutex> lock(m_cacheMutex);
-	m_zeroCrossingCache[cachekey] = edges;
+	auto list = LevelCrossingList::Get(data, threshold);
+	auto p = list->m_crossings.GetCpuPointer();
+	edges.assign(p, p + list->size());
 }
 
 /**
 	@brief Find zero crossings in a waveform, interpolating as necessary
+
+	The crossings are cached on the waveform by LevelCrossingList, so every filter looking at the same signal and
+	threshold shares one search. Use LevelCrossingList::Get() directly to avoid copying them.
  */
 void Filter::FindZeroCrossings(UniformAnalogWaveform* data, float threshold, vector<int64_t>& edges)
 {
-	pair<WaveformBase*, float> cachekey(data, threshold);
-
-	//Check cache
-	{
-		lock_guard<mutex> lock(m_cacheMutex);
-		auto it = m_zeroCrossingCache.find(cachekey);
-		if(it != m_zeroCrossingCache.end())
-		{
-			edges = it->second;
-			return;
-		}
-	}
+	auto list = LevelCrossingList::Get(data, threshold);
+	auto p = list->m_crossings.GetCpuPointer();
+	edges.assign(p, p + list->size());
+}
 
-	//Preallocate a bunch of outputs to reduce reallocations
-	edges.reserve(1024 * 1024);
+/**
+	@brief Find edges of the selected polarity in a digital waveform, from its cached DigitalEdgeList
 
-	//Find times of the zero crossings
-	bool last = data->m_samples[0] > threshold;
-	size_t len = data->m_samples.size();
-	float fscale = data->m_timescale;
+	The edge list is extracted once per waveform revision (on the GPU, for big uniform waveforms) and shared with
+	every other consumer, so this is O(edges) and the output is sized exactly before it's filled.
 
-	float flast = data->m_samples[0];
-	int64_t timescale = data->m_timescale;
-	int64_t timestamp = data->m_triggerPhase;
-	for(size_t i=1; i<len; i++)
-	{
-		float fcur = data->m_samples[i];
-		bool value = fcur > threshold;
+	@param data		The waveform
+	@param second	Offset of sample 1, in ticks. A toggle between samples 0 and 1 has never been reported as an edge.
+	@param edges	Timestamps of the edges, at the middle of the first sample with the new level, are appended here
+	@param rising	True to report rising edges
+	@param falling	True to report falling edges
+ */
+static void FindDigitalEdges(WaveformBase* data, int64_t second, vector<int64_t>& edges, bool rising, bool falling)
+{
+	auto list = DigitalEdgeList::Get(data);
+	size_t nedges = list->size();
+	if(nedges == 0)
+		return;
 
-		//Skip samples with no transition
-		if(last == value)
-		{
-			flast = fcur;
-			timestamp += timescale;
-			continue;
-		}
+	list->m_edges.PrepareForCpuAccess();
+	size_t first = (list->m_edges[0] == second) ? 1 : 0;
 
-		//Midpoint of the sample, plus the zero crossing
-		float slope = (fcur - flast);
-		float delta = threshold - flast;
-		int64_t tfrac = (fscale * delta) / slope;
-		edges.push_back(timestamp + tfrac);
-		last = value;
-		flast = fcur;
-		timestamp += timescale;
+	//If we only want one polarity, take every other edge starting from the first one we want
+	size_t stride = 1;
+	if(rising != falling)
+	{
+		stride = 2;
+		if(list->GetLevelAfterEdge(first) != rising)
+			first ++;
 	}
+	if(first >= nedges)
+		return;
 
-	//Add to cache
-	lock_guard<mutex> lock(m_cacheMutex);
-	m_zeroCrossingCache[cachekey] = edges;
+	size_t start = edges.size();
+	size_t count = (nedges - first + stride - 1) / stride;
+	edges.resize(start + count);
+
+	int64_t phoff = list->m_timescale / 2;
+	for(size_t i=0; i<count; i++)
+		edges[start + i] = phoff + list->ToScaled(list->m_edges[first + i*stride]);
 }
 
 /**
@@ -507,47 +609,10 @@ void Filter::FindZeroCrossings(UniformAnalogWaveform* data, float threshold, vec
  */
 void Filter::FindZeroCrossings(SparseDigitalWaveform* data, vector<int64_t>& edges)
 {
-	pair<WaveformBase*, float> cachekey(data, 0);
-
-	//Check cache
-	{
-		lock_guard<mutex> lock(m_cacheMutex);
-		auto it = m_zeroCrossingCache.find(cachekey);
-		if(it != m_zeroCrossingCache.end())
-		{
-			edges = it->second;
-			return;
-		}
-	}
-
-	//Find times of the zero crossings
-	bool first = true;
-	bool last = data->m_samples[0];
-	int64_t phoff = data->m_timescale/2 + data->m_triggerPhase;
-	size_t len = data->m_samples.size();
-	for(size_t i=1; i<len; i++)
-	{
-		bool value = data->m_samples[i];
-
-		//Save the last value
-		if(first)
-		{
-			last = value;
-			first = false;
-			continue;
-		}
-
-		//Skip samples with no transition
-		if(last == value)
-			continue;
-
-		edges.push_back(phoff + data->m_timescale * data->m_offsets[i]);
-		last = value;
-	}
-
-	//Add to cache
-	lock_guard<mutex> lock(m_cacheMutex);
-	m_zeroCrossingCache[cachekey] = edges;
+	if(data->size() < 2)
+		return;
+	data->m_offsets.PrepareForCpuAccess();
+	FindDigitalEdges(data, data->m_offsets[1], edges, true, true);
 }
 
 /**
@@ -555,30 +620,7 @@ void Filter::FindZeroCrossings(SparseDigitalWaveform* data, vector<int64_t>& edg
  */
 void Filter::FindZeroCrossings(UniformDigitalWaveform* data, vector<int64_t>& edges)
 {
-	//Find times of the zero crossings
-	bool first = true;
-	bool last = data->m_samples[0];
-	int64_t phoff = data->m_timescale/2 + data->m_triggerPhase;
-	size_t len = data->m_samples.size();
-	for(size_t i=1; i<len; i++)
-	{
-		bool value = data->m_samples[i];
-
-		//Save the last value
-		if(first)
-		{
-			last = value;
-			first = false;
-			continue;
-		}
-
-		//Skip samples with no transition
-		if(last == value)
-			continue;
-
-		edges.push_back(phoff + data->m_timescale * i);
-		last = value;
-	}
+	FindDigitalEdges(data, 1, edges, true, true);
 }
 
 /**
@@ -586,29 +628,10 @@ void Filter::FindZeroCrossings(UniformDigitalWaveform* data, vector<int64_t>& ed
  */
 void Filter::FindRisingEdges(SparseDigitalWaveform* data, vector<int64_t>& edges)
 {
-	//Find times of the zero crossings
-	bool first = true;
-	bool last = data->m_samples[0];
-	int64_t phoff = data->m_timescale/2 + data->m_triggerPhase;
-	size_t len = data->m_samples.size();
-	for(size_t i=1; i<len; i++)
-	{
-		bool value = data->m_samples[i];
-
-		//Save the last value
-		if(first)
-		{
-			last = value;
-			first = false;
-			continue;
-		}
-
-		//Save samples with an edge
-		if(value && !last)
-			edges.push_back(phoff + data->m_timescale * data->m_offsets[i]);
-
-		last = value;
-	}
+	if(data->size() < 2)
+		return;
+	data->m_offsets.PrepareForCpuAccess();
+	FindDigitalEdges(data, data->m_offsets[1], edges, true, false);
 }
 
 /**
@@ -616,29 +639,7 @@ void Filter::FindRisingEdges(SparseDigitalWaveform* data, vector<int64_t>& edges
  */
 void Filter::FindRisingEdges(UniformDigitalWaveform* data, vector<int64_t>& edges)
 {
-	//Find times of the zero crossings
-	bool first = true;
-	bool last = data->m_samples[0];
-	int64_t phoff = data->m_timescale/2 + data->m_triggerPhase;
-	size_t len = data->m_samples.size();
-	for(size_t i=1; i<len; i++)
-	{
-		bool value = data->m_samples[i];
-
-		//Save the last value
-		if(first)
-		{
-			last = value;
-			first = false;
-			continue;
-		}
-
-		//Save samples with an edge
-		if(value && !last)
-			edges.push_back(phoff + data->m_timescale * i);
-
-		last = value;
-	}
+	FindDigitalEdges(data, 1, edges, true, false);
 }
 
 /**
@@ -646,29 +647,10 @@ void Filter::FindRisingEdges(UniformDigitalWaveform* data, vector<int64_t>& edge
  */
 void Filter::FindFallingEdges(SparseDigitalWaveform* data, vector<int64_t>& edges)
 {
-	//Find times of the zero crossings
-	bool first = true;
-	bool last = data->m_samples[0];
-	int64_t phoff = data->m_timescale/2 + data->m_triggerPhase;
-	size_t len = data->m_samples.size();
-	for(size_t i=1; i<len; i++)
-	{
-		bool value = data->m_samples[i];
-
-		//Save the last value
-		if(first)
-		{
-			last = value;
-			first = false;
-			continue;
-		}
-
-		//Save samples with an edge
-		if(!value && last)
-			edges.push_back(phoff + data->m_timescale * data->m_offsets[i]);
-
-		last = value;
-	}
+	if(data->size() < 2)
+		return;
+	data->m_offsets.PrepareForCpuAccess();
+	FindDigitalEdges(data, data->m_offsets[1], edges, false, true);
 }
 
 /**
@@ -676,29 +658,45 @@ void Filter::FindFallingEdges(SparseDigitalWaveform* data, vector<int64_t>& edge
  */
 void Filter::FindFallingEdges(UniformDigitalWaveform* data, vector<int64_t>& edges)
 {
-	//Find times of the zero crossings
-	bool first = true;
-	bool last = data->m_samples[0];
+	FindDigitalEdges(data, 1, edges, false, true);
+}
+
+/**
+	@brief Find edges of the selected polarity in a packed waveform, a word at a time
+ */
+void Filter::FindPackedEdges(UniformPackedDigitalWaveform* data, vector<int64_t>& edges, bool rising, bool falling)
+{
+	//Get sample indexes of the edges, then convert them to timestamps in place
+	size_t start = edges.size();
+	data->FindEdges(edges, rising, falling);
+
 	int64_t phoff = data->m_timescale/2 + data->m_triggerPhase;
-	size_t len = data->m_samples.size();
-	for(size_t i=1; i<len; i++)
-	{
-		bool value = data->m_samples[i];
+	for(size_t i=start; i<edges.size(); i++)
+		edges[i] = phoff + data->m_timescale * edges[i];
+}
 
-		//Save the last value
-		if(first)
-		{
-			last = value;
-			first = false;
-			continue;
-		}
+/**
+	@brief Find zero crossings in a packed waveform
+ */
+void Filter::FindZeroCrossings(UniformPackedDigitalWaveform* data, vector<int64_t>& edges)
+{
+	FindPackedEdges(data, edges, true, true);
+}
 
-		//Save samples with an edge
-		if(!value && last)
-			edges.push_back(phoff + data->m_timescale * i);
+/**
+	@brief Find rising edges in a packed waveform
+ */
+void Filter::FindRisingEdges(UniformPackedDigitalWaveform* data, vector<int64_t>& edges)
+{
+	FindPackedEdges(data, edges, true, false);
+}
 
-		last = value;
-	}
+/**
+	@brief Find falling edges in a packed waveform
+ */
+void Filter::FindFallingEdges(UniformPackedDigitalWaveform* data, vector<int64_t>& edges)
+{
+	FindPackedEdges(data, edges, false, true);
 }
 
 /**
@@ -837,6 +835,124 @@ void Filter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> qu
 	}
 }
 
+/**
+	@brief Describes the filter's current processing as a single per-sample operation, if possible
+
+	Filters whose output is a simple elementwise function of one or two uniform analog inputs may implement this so
+	that FilterGraphExecutor can evaluate chains of them in one compute shader pass. If the filter can be expressed
+	as an ElementwiseOp with its current inputs and configuration, the implementation must do everything Refresh()
+	would except compute the output samples (set units, set up and resize the output waveform, etc.), fill out op,
+	and return true. Otherwise it must return false without changing anything, and Refresh() is called as usual.
+
+	The shader can read inputs holding raw ADC codes (see RawAnalogSamples) directly, so implementations should
+	usually also return true from AcceptsRawSamples(), and call ExpandRawInputs() from Refresh().
+
+	The default implementation returns false.
+
+	@param op	The operation to fill out
+ */
+bool Filter::SetupElementwiseOp(ElementwiseOp& /*op*/)
+{
+	return false;
+}
+
+/**
+	@brief Evaluates one scalar output stream over many waveforms (typically history segments) of the first input
+
+	Re-running a measurement over thousands of history segments by swapping each one into the filter graph in turn
+	costs a full graph pass per segment. Filters which compute a scalar from a single input waveform may instead
+	implement SupportsScalarBatch() and EvaluateScalarSegment(), after which this function measures all of the segments in parallel in one call.
+
+	The output is laid out like that of TrendFilter: one sample per segment, positioned at the segment's start time
+	relative to the first segment. Segments for which no value can be computed (e.g. not enough edges) are skipped.
+
+	The filter's own outputs and state are not modified.
+
+	@param segments	Waveforms to measure, in chronological order
+	@param stream	Index of the scalar output stream to evaluate
+	@param out		Output waveform
+
+	@return True on success, false if this filter or stream doesn't support batch evaluation (out is then unchanged)
+ */
+bool Filter::EvaluateScalarBatch(const vector<WaveformBase*>& segments, size_t stream, SparseAnalogWaveform* out)
+{
+	if( (stream >= m_streams.size()) || (m_streams[stream].m_stype != Stream::STREAM_TYPE_ANALOG_SCALAR) )
+		return false;
+	if(!SupportsScalarBatch(stream) || segments.empty())
+		return false;
+
+	//Pull everything over to the CPU up front, since this may need to touch the GPU queues
+	for(auto w : segments)
+		w->PrepareForCpuAccess();
+
+	//Measure every segment independently
+	size_t nsegs = segments.size();
+	vector<float> values(nsegs);
+	vector<uint8_t> valid(nsegs);
+	#pragma omp parallel for
+	for(size_t i=0; i<nsegs; i++)
+		valid[i] = EvaluateScalarSegment(segments[i], stream, values[i]);
+
+	//Pack the results into the output, timestamped relative to the first segment
+	auto first = segments[0];
+	out->PrepareForCpuAccess();
+	out->clear();
+	out->m_timescale = 1;
+	out->m_triggerPhase = 0;
+	out->m_startTimestamp = first->m_startTimestamp;
+	out->m_startFemtoseconds = first->m_startFemtoseconds;
+	for(size_t i=0; i<nsegs; i++)
+	{
+		if(!valid[i])
+			continue;
+
+		auto w = segments[i];
+		int64_t offset =
+			(w->m_startTimestamp - first->m_startTimestamp) * FS_PER_SECOND +
+			(w->m_startFemtoseconds - first->m_startFemtoseconds);
+
+		size_t n = out->m_samples.size();
+		if(n)
+			out->m_durations[n-1] = offset - out->m_offsets[n-1];
+
+		out->m_offsets.push_back(offset);
+		out->m_durations.push_back(1);
+		out->m_samples.push_back(values[i]);
+	}
+	out->MarkModifiedFromCpu();
+
+	return true;
+}
+
+/**
+	@brief Checks if EvaluateScalarBatch() can be used on a given output stream
+
+	The default implementation returns false.
+
+	@param stream	Index of the scalar output stream
+ */
+bool Filter::SupportsScalarBatch(size_t /*stream*/)
+{
+	return false;
+}
+
+/**
+	@brief Computes the value of one scalar output stream for a single waveform, for EvaluateScalarBatch()
+
+	Implementations must not modify the filter's outputs or other state, and must be safe to call from several
+	threads at once. The input waveform is already prepared for CPU access.
+
+	@param din		Input waveform, standing in for the first input
+	@param stream	Index of the scalar output stream to evaluate
+	@param value	Computed value
+
+	@return True if a value was computed
+ */
+bool Filter::EvaluateScalarSegment(WaveformBase* /*din*/, size_t /*stream*/, float& /*value*/)
+{
+	return false;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Serialization
 
@@ -1041,8 +1157,7 @@ float Filter::InterpolateValue(UniformAnalogWaveform* cap, size_t index, float f
 
 void Filter::ClearAnalysisCache()
 {
-	lock_guard<mutex> lock(m_cacheMutex);
-	m_zeroCrossingCache.clear();
+	//Edge and crossing lists are cached on the waveform itself and invalidated by its revision, nothing to do here
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1051,7 +1166,8 @@ void Filter::ClearAnalysisCache()
 /**
 	@brief Sets up an analog output waveform and copies basic metadata from the input.
 
-	A new output waveform is created if necessary, but when possible the existing one is reused.
+	A new output waveform is created if necessary, but when possible the existing one (or a recycled one, see
+	GetOutputWaveform()) is reused.
 
 	@param din			Input waveform
 	@param stream		Stream index
@@ -1061,13 +1177,7 @@ void Filter::ClearAnalysisCache()
  */
 UniformAnalogWaveform* Filter::SetupEmptyUniformAnalogOutputWaveform(WaveformBase* din, size_t stream, bool clear)
 {
-	//Create the waveform, but only if necessary
-	auto cap = dynamic_cast<UniformAnalogWaveform*>(GetData(stream));
-	if(cap == NULL)
-	{
-		cap = new UniformAnalogWaveform;
-		SetData(cap, stream);
-	}
+	auto cap = GetOutputWaveform<UniformAnalogWaveform>(stream);
 
 	//Copy configuration
 	cap->m_startTimestamp 		= din->m_startTimestamp;
@@ -1088,7 +1198,8 @@ UniformAnalogWaveform* Filter::SetupEmptyUniformAnalogOutputWaveform(WaveformBas
 /**
 	@brief Sets up an analog output waveform and copies basic metadata from the input.
 
-	A new output waveform is created if necessary, but when possible the existing one is reused.
+	A new output waveform is created if necessary, but when possible the existing one (or a recycled one, see
+	GetOutputWaveform()) is reused.
 
 	@param din			Input waveform
 	@param stream		Stream index
@@ -1098,13 +1209,7 @@ UniformAnalogWaveform* Filter::SetupEmptyUniformAnalogOutputWaveform(WaveformBas
  */
 SparseAnalogWaveform* Filter::SetupEmptySparseAnalogOutputWaveform(WaveformBase* din, size_t stream, bool clear)
 {
-	//Create the waveform, but only if necessary
-	auto cap = dynamic_cast<SparseAnalogWaveform*>(GetData(stream));
-	if(cap == NULL)
-	{
-		cap = new SparseAnalogWaveform;
-		SetData(cap, stream);
-	}
+	auto cap = GetOutputWaveform<SparseAnalogWaveform>(stream);
 
 	//Copy configuration
 	cap->m_startTimestamp 		= din->m_startTimestamp;
@@ -1125,22 +1230,18 @@ SparseAnalogWaveform* Filter::SetupEmptySparseAnalogOutputWaveform(WaveformBase*
 /**
 	@brief Sets up an digital output waveform and copies basic metadata from the input.
 
-	A new output waveform is created if necessary, but when possible the existing one is reused.
+	A new output waveform is created if necessary, but when possible the existing one (or a recycled one, see
+	GetOutputWaveform()) is reused.
 
 	@param din			Input waveform
 	@param stream		Stream index
+	@param clear		True to clear an existing waveform, false to leave it as-is
 
 	@return	The ready-to-use output waveform
  */
-UniformDigitalWaveform* Filter::SetupEmptyUniformDigitalOutputWaveform(WaveformBase* din, size_t stream)
+UniformDigitalWaveform* Filter::SetupEmptyUniformDigitalOutputWaveform(WaveformBase* din, size_t stream, bool clear)
 {
-	//Create the waveform, but only if necessary
-	auto cap = dynamic_cast<UniformDigitalWaveform*>(GetData(stream));
-	if(cap == NULL)
-	{
-		cap = new UniformDigitalWaveform;
-		SetData(cap, stream);
-	}
+	auto cap = GetOutputWaveform<UniformDigitalWaveform>(stream);
 
 	//Copy configuration
 	cap->m_startTimestamp 		= din->m_startTimestamp;
@@ -1152,7 +1253,8 @@ UniformDigitalWaveform* Filter::SetupEmptyUniformDigitalOutputWaveform(WaveformB
 	cap->m_revision ++;
 
 	//Clear output
-	cap->clear();
+	if(clear)
+		cap->clear();
 
 	return cap;
 }
@@ -1160,22 +1262,18 @@ UniformDigitalWaveform* Filter::SetupEmptyUniformDigitalOutputWaveform(WaveformB
 /**
 	@brief Sets up an digital output waveform and copies basic metadata from the input.
 
-	A new output waveform is created if necessary, but when possible the existing one is reused.
+	A new output waveform is created if necessary, but when possible the existing one (or a recycled one, see
+	GetOutputWaveform()) is reused.
 
 	@param din			Input waveform
 	@param stream		Stream index
+	@param clear		True to clear an existing waveform, false to leave it as-is
 
 	@return	The ready-to-use output waveform
  */
-SparseDigitalWaveform* Filter::SetupEmptySparseDigitalOutputWaveform(WaveformBase* din, size_t stream)
+SparseDigitalWaveform* Filter::SetupEmptySparseDigitalOutputWaveform(WaveformBase* din, size_t stream, bool clear)
 {
-	//Create the waveform, but only if necessary
-	auto cap = dynamic_cast<SparseDigitalWaveform*>(GetData(stream));
-	if(cap == NULL)
-	{
-		cap = new SparseDigitalWaveform;
-		SetData(cap, stream);
-	}
+	auto cap = GetOutputWaveform<SparseDigitalWaveform>(stream);
 
 	//Copy configuration
 	cap->m_startTimestamp 		= din->m_startTimestamp;
@@ -1187,7 +1285,8 @@ SparseDigitalWaveform* Filter::SetupEmptySparseDigitalOutputWaveform(WaveformBas
 	cap->m_revision ++;
 
 	//Clear output
-	cap->clear();
+	if(clear)
+		cap->clear();
 
 	return cap;
 }
@@ -1195,7 +1294,8 @@ SparseDigitalWaveform* Filter::SetupEmptySparseDigitalOutputWaveform(WaveformBas
 /**
 	@brief Sets up an analog output waveform and copies timebase configuration from the input.
 
-	A new output waveform is created if necessary, but when possible the existing one is reused.
+	A new output waveform is created if necessary, but when possible the existing one (or a recycled one, see
+	GetOutputWaveform()) is reused.
 	Timestamps are copied from the input to the output.
 
 	@param din			Input waveform
@@ -1229,7 +1329,8 @@ SparseAnalogWaveform* Filter::SetupSparseOutputWaveform(SparseWaveformBase* din,
 /**
 	@brief Sets up a digital output waveform and copies timebase configuration from the input.
 
-	A new output waveform is created if necessary, but when possible the existing one is reused.
+	A new output waveform is created if necessary, but when possible the existing one (or a recycled one, see
+	GetOutputWaveform()) is reused.
 	Timestamps are copied from the input to the output.
 
 	@param din			Input waveform
@@ -1241,13 +1342,7 @@ SparseAnalogWaveform* Filter::SetupSparseOutputWaveform(SparseWaveformBase* din,
  */
 SparseDigitalWaveform* Filter::SetupSparseDigitalOutputWaveform(SparseWaveformBase* din, size_t stream, size_t skipstart, size_t skipend)
 {
-	//Create the waveform, but only if necessary
-	auto cap = dynamic_cast<SparseDigitalWaveform*>(GetData(stream));
-	if(cap == NULL)
-	{
-		cap = new SparseDigitalWaveform;
-		SetData(cap, stream);
-	}
+	auto cap = GetOutputWaveform<SparseDigitalWaveform>(stream);
 
 	//Copy configuration
 	cap->m_timescale 			= din->m_timescale;
@@ -1278,9 +1373,95 @@ SparseDigitalWaveform* Filter::SetupSparseDigitalOutputWaveform(SparseWaveformBa
 	return cap;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Output recycling
+
+/**
+	@brief Gives a waveform previously Detach()ed from one of our streams back to us for reuse
+
+	Consumers which take ownership of our outputs (history, export, etc) should call this rather than deleting them
+	once they're done, so steady state refreshes don't allocate new waveforms and buffers. Ownership is transferred
+	to the filter.
+ */
+void Filter::RecycleOutputWaveform(WaveformBase* w)
+{
+	m_outputPool.Add(w);
+}
+
+/**
+	@brief Bookkeeping for a newly allocated output waveform
+
+	The first allocation for each stream is expected. Any later one means an output was handed off and never given
+	back, which costs a heap (and probably a GPU) allocation every refresh.
+ */
+void Filter::OnOutputAllocated(size_t stream)
+{
+	if(m_streamAllocations.size() <= stream)
+		m_streamAllocations.resize(stream + 1, 0);
+
+	m_outputAllocationCount ++;
+	if(m_streamAllocations[stream] ++ == 0)
+		return;
+
+	//Only complain once per stream, the counter keeps track of the rest
+	if(m_streamAllocations[stream] == 2)
+	{
+		LogDebug("Filter %s allocated a new waveform for stream %zu after its first refresh "
+			"(outputs not returned with RecycleOutputWaveform?)\n",
+			GetDisplayName().c_str(), stream);
+	}
+	m_steadyStateAllocations ++;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Event driven filter processing
 
+/**
+	@brief Advances i to the last index before len for which atOrBefore() holds, given that it holds for a prefix
+
+	Merge joins usually advance by zero or one samples per step, so the next sample is checked first. Longer runs
+	are found by galloping (doubling the step until we overshoot) and then a binary search, so skipping ahead by k
+	samples costs O(log k) rather than O(k).
+
+	@param i			Current index (updated in place)
+	@param len			Number of samples
+	@param atOrBefore	Predicate which is true for every sample at or before the target time, and false after
+ */
+template<class F>
+static void GallopToTimestamp(size_t& i, size_t len, F atOrBefore)
+{
+	if( ((i+1) >= len) || !atOrBefore(i+1) )
+		return;
+
+	//Find an index past the target, if there is one
+	size_t lo = i+1;
+	size_t hi = len;
+	for(size_t step = 1; ; step *= 2)
+	{
+		size_t probe = lo + step;
+		if(probe >= len)
+			break;
+		if(!atOrBefore(probe))
+		{
+			hi = probe;
+			break;
+		}
+		lo = probe;
+	}
+
+	//Binary search between the last probe at or before the target and the first one after it
+	while( (hi - lo) > 1)
+	{
+		size_t mid = lo + (hi - lo)/2;
+		if(atOrBefore(mid))
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	i = lo;
+}
+
 /**
 	@brief Gets the timestamp of the next event (if any) on a waveform
 
@@ -1314,8 +1495,8 @@ int64_t Filter::GetNextEventTimestamp(UniformWaveformBase* /*wfm*/, size_t i, si
  */
 void Filter::AdvanceToTimestamp(SparseWaveformBase* wfm, size_t& i, size_t len, int64_t timestamp)
 {
-	while( ((i+1) < len) && (wfm->m_offsets[i+1] <= timestamp) )
-		i ++;
+	int64_t* offsets = wfm->m_offsets.GetCpuPointer();
+	GallopToTimestamp(i, len, [&](size_t j) { return offsets[j] <= timestamp; });
 }
 
 /**
@@ -1363,8 +1544,9 @@ void Filter::AdvanceToTimestampScaled(SparseWaveformBase* wfm, size_t& i, size_t
 {
 	timestamp -= wfm->m_triggerPhase;
 
-	while( ((i+1) < len) && ( (wfm->m_offsets[i+1] * wfm->m_timescale) <= timestamp) )
-		i ++;
+	int64_t* offsets = wfm->m_offsets.GetCpuPointer();
+	int64_t timescale = wfm->m_timescale;
+	GallopToTimestamp(i, len, [&](size_t j) { return (offsets[j] * timescale) <= timestamp; });
 }
 
 /**
@@ -1376,8 +1558,12 @@ void Filter::AdvanceToTimestampScaled(UniformWaveformBase* wfm, size_t& i, size_
 {
 	timestamp -= wfm->m_triggerPhase;
 
-	while( ((i+1) < len) && ( ( static_cast<int64_t>(i+1) * wfm->m_timescale) <= timestamp) )
-		i ++;
+	//Samples are evenly spaced, so jump straight to the last one at or before the target
+	if( ((i+1) >= len) || (wfm->m_timescale <= 0) || (timestamp < 0) )
+		return;
+	size_t target = timestamp / wfm->m_timescale;
+	if(target > i)
+		i = min(target, len-1);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1619,8 +1805,8 @@ size_t Filter::AddStream(Unit yunit, const string& name, Stream::StreamType styp
 void Filter::AutoscaleVertical(size_t stream)
 {
 	auto data = GetData(stream);
-	auto swfm = dynamic_cast<SparseAnalogWaveform*>(data);
-	auto uwfm = dynamic_cast<UniformAnalogWaveform*>(data);
+	auto swfm = WaveformCast<SparseAnalogWaveform>(data);
+	auto uwfm = WaveformCast<UniformAnalogWaveform>(data);
 	if(!swfm && !uwfm)
 	{
 		LogTrace("No waveform\n");
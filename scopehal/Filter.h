@@ -96,6 +96,56 @@ public:
 	uint64_t m_rev;
 };
 
+/**
+	@brief A single per-sample operation on uniform analog waveforms, as reported by Filter::SetupElementwiseOp()
+	@ingroup core
+
+	FilterGraphExecutor uses these to evaluate chains of simple math filters in a single compute shader pass, rather
+	than launching a kernel (and reading every intermediate waveform back from memory) for each filter in the chain.
+ */
+class ElementwiseOp
+{
+public:
+	ElementwiseOp()
+	: m_type(OP_ADD)
+	, m_constant(0)
+	, m_output(nullptr)
+	, m_len(0)
+	{
+		for(size_t i=0; i<2; i++)
+		{
+			m_inputs[i] = nullptr;
+			m_offsets[i] = 0;
+		}
+	}
+
+	///@brief The operation to perform (values must match ElementwiseChain.glsl)
+	enum OpType
+	{
+		OP_ADD			= 0,	///< out = a + b
+		OP_SUBTRACT		= 1,	///< out = a - b
+		OP_MULTIPLY		= 2,	///< out = a * b
+		OP_NEGATE		= 3,	///< out = -a
+		OP_MIN			= 4,	///< out = min(a, constant)
+		OP_MAX			= 5		///< out = max(a, constant)
+	} m_type;
+
+	///@brief The input waveforms (a, b). Unary operations leave b null
+	UniformAnalogWaveform* m_inputs[2];
+
+	///@brief Index of the input sample corresponding to output sample zero, for each input
+	size_t m_offsets[2];
+
+	///@brief Constant operand of OP_MIN and OP_MAX
+	float m_constant;
+
+	///@brief The output waveform, already set up and resized to m_len samples
+	UniformAnalogWaveform* m_output;
+
+	///@brief Number of output samples
+	size_t m_len;
+};
+
 /**
 	@brief Abstract base class for all filter graph blocks which are not physical instrument channels
 	@ingroup core
@@ -140,11 +190,17 @@ public:
 
 	///@brief Get all currently existing filters
 	static std::set<Filter*> GetAllInstances()
-	{ return m_filters; }
+	{
+		std::lock_guard<std::mutex> lock(m_filtersMutex);
+		return m_filters;
+	}
 
 	///@brief Get all currently existing filters
 	static size_t GetNumInstances()
-	{ return m_filters.size(); }
+	{
+		std::lock_guard<std::mutex> lock(m_filtersMutex);
+		return m_filters.size();
+	}
 
 	/**
 		@brief Removes this filter from the global list
@@ -154,8 +210,10 @@ public:
 	 */
 	void HideFromList()
 	{
+		auto name = GetProtocolDisplayName();
+		std::lock_guard<std::mutex> lock(m_filtersMutex);
 		m_filters.erase(this);
-		m_instanceCount[GetProtocolDisplayName()] --;
+		m_instanceCount[name] --;
 	}
 
 	virtual void ClearStreams() override;
@@ -212,6 +270,43 @@ public:
 	size_t GetRefCount()
 	{ return m_refcount; }
 
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Stream demand
+
+	void AddStreamConsumer(size_t stream);
+	void RemoveStreamConsumer(size_t stream);
+	bool HasStreamConsumers(size_t stream);
+
+	/**
+		@brief Checks if anything will use the output of a stream from the refresh currently in progress
+
+		Filters with several output streams may skip computing (and leave untouched) any stream for which this
+		returns false. It always returns true unless the executor was asked to evaluate the graph lazily.
+
+		@param stream	Index of the stream
+	 */
+	bool IsStreamDemanded(size_t stream)
+	{ return (stream >= m_streamDemand.size()) || m_streamDemand[stream]; }
+
+	/**
+		@brief Sets which streams are demanded by the refresh about to start (called by FilterGraphExecutor)
+
+		@param demand	One nonzero/zero entry per stream, or empty if every stream is demanded
+	 */
+	void SetStreamDemand(const std::vector<uint8_t>& demand)
+	{ m_streamDemand = demand; }
+
+protected:
+	///@brief Demand for each stream in the current refresh (empty if every stream is demanded)
+	std::vector<uint8_t> m_streamDemand;
+
+	///@brief Number of consumers outside the filter graph (displays, exports etc) of each stream
+	std::vector<size_t> m_streamConsumers;
+
+	///@brief Mutex protecting m_streamConsumers
+	std::mutex m_streamConsumersMutex;
+
+public:
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Accessors
 
@@ -240,6 +335,15 @@ public:
 	//GPU accelerated refresh method
 	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
 
+	virtual bool SetupElementwiseOp(ElementwiseOp& op);
+
+	bool EvaluateScalarBatch(const std::vector<WaveformBase*>& segments, size_t stream, SparseAnalogWaveform* out);
+	virtual bool SupportsScalarBatch(size_t stream);
+
+protected:
+	virtual bool EvaluateScalarSegment(WaveformBase* din, size_t stream, float& value);
+
+public:
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Vertical scaling
 
@@ -285,6 +389,8 @@ protected:
 	bool VerifyAllInputsOKAndSparseDigital();
 	bool VerifyAllInputsOKAndSparseOrUniformDigital();
 
+	void ExpandRawInputs();
+
 public:
 	static int64_t GetNextEventTimestamp(SparseWaveformBase* wfm, size_t i, size_t len, int64_t timestamp);
 	static int64_t GetNextEventTimestamp(UniformWaveformBase* wfm, size_t i, size_t len, int64_t timestamp);
@@ -339,11 +445,46 @@ public:
 protected:
 	UniformAnalogWaveform* SetupEmptyUniformAnalogOutputWaveform(WaveformBase* din, size_t stream, bool clear=true);
 	SparseAnalogWaveform* SetupEmptySparseAnalogOutputWaveform(WaveformBase* din, size_t stream, bool clear=true);
-	UniformDigitalWaveform* SetupEmptyUniformDigitalOutputWaveform(WaveformBase* din, size_t stream);
-	SparseDigitalWaveform* SetupEmptySparseDigitalOutputWaveform(WaveformBase* din, size_t stream);
+	UniformDigitalWaveform* SetupEmptyUniformDigitalOutputWaveform(WaveformBase* din, size_t stream, bool clear=true);
+	SparseDigitalWaveform* SetupEmptySparseDigitalOutputWaveform(WaveformBase* din, size_t stream, bool clear=true);
 	SparseAnalogWaveform* SetupSparseOutputWaveform(SparseWaveformBase* din, size_t stream, size_t skipstart, size_t skipend);
 	SparseDigitalWaveform* SetupSparseDigitalOutputWaveform(SparseWaveformBase* din, size_t stream, size_t skipstart, size_t skipend);
 
+	/**
+		@brief Gets the waveform to write a stream's output into
+
+		If we still own last pass's output it's reused as is. If it was handed off downstream (Detach()ed, e.g. into
+		history) we take one the consumer gave back with RecycleOutputWaveform() instead, so its buffers are reused
+		at their existing capacity. Only if neither is available is a new waveform allocated.
+
+		@param stream	Stream index
+
+		@return The output waveform, not cleared and with metadata from the previous use
+	 */
+	template<class T>
+	T* GetOutputWaveform(size_t stream)
+	{
+		auto old = GetData(stream);
+		auto cap = WaveformCast<T>(old);
+		if(cap != nullptr)
+			return cap;
+
+		//Output type changed, keep the old one around in case we change back
+		if(old != nullptr)
+			m_outputPool.Add(Detach(stream));
+
+		cap = m_outputPool.Get<T>();
+		if(cap != nullptr)
+			cap->Rename();
+		else
+		{
+			cap = new T;
+			OnOutputAllocated(stream);
+		}
+		SetData(cap, stream);
+		return cap;
+	}
+
 	/**
 		@brief Sets up an empty output waveform and copies basic metadata from the input.
 
@@ -358,13 +499,7 @@ protected:
 	template<class T>
 	T* SetupEmptyWaveform(WaveformBase* din, size_t stream, bool clear = true)
 	{
-		//Create the waveform, but only if necessary
-		auto cap = dynamic_cast<T*>(GetData(stream));
-		if(cap == nullptr)
-		{
-			cap = new T;
-			SetData(cap, stream);
-		}
+		auto cap = GetOutputWaveform<T>(stream);
 
 		//Copy configuration
 		if(din != nullptr)
@@ -385,6 +520,155 @@ protected:
 		return cap;
 	}
 
+	/**
+		@brief Sets up an analog output waveform with the same sample layout and timebase as the input
+
+		Sparse inputs get a sparse output with the first len timestamps copied, uniform inputs a uniform output.
+
+		@param din			Input waveform (UniformAnalogWaveform or SparseAnalogWaveform)
+		@param stream		Stream index
+		@param len			Number of samples in the output, no more than din->size()
+
+		@return	The ready-to-use output waveform (CPU-side sample contents undefined)
+	 */
+	template<class W>
+	typename std::conditional<std::is_base_of<SparseWaveformBase, W>::value,
+		SparseAnalogWaveform, UniformAnalogWaveform>::type*
+	SetupAnalogOutputWaveformLike(W* din, size_t stream, size_t len)
+	{
+		if constexpr(std::is_base_of<SparseWaveformBase, W>::value)
+			return SetupSparseOutputWaveform(din, stream, 0, din->size() - len);
+		else
+		{
+			auto cap = SetupEmptyUniformAnalogOutputWaveform(din, stream);
+			cap->Resize(len);
+			return cap;
+		}
+	}
+
+	/**
+		@brief Wraps an angle in degrees, which is within one turn of the range [-180, 180], back into that range
+	 */
+	static float WrapDegrees(float deg)
+	{
+		if(deg < -180)
+			deg += 360;
+		if(deg > 180)
+			deg -= 360;
+		return deg;
+	}
+
+	/**
+		@brief Applies a scalar function to each sample of a uniform or sparse analog waveform, on the CPU
+
+		The loop is compiled separately for each input type, so there is no per-sample type dispatch.
+
+		@param din			Input waveform
+		@param stream		Output stream index
+		@param func			Function taking the input sample value and returning the output value
+	 */
+	template<class W, class F>
+	void ApplyPointwise(W* din, size_t stream, F&& func)
+	{
+		AssertTypeIsAnalogWaveform(din);
+
+		size_t len = din->size();
+		auto cap = SetupAnalogOutputWaveformLike(din, stream, len);
+		din->PrepareForCpuAccess();
+		cap->PrepareForCpuAccess();
+
+		float* fin = (float*)__builtin_assume_aligned(din->m_samples.GetCpuPointer(), 16);
+		float* fdst = (float*)__builtin_assume_aligned(cap->m_samples.GetCpuPointer(), 16);
+		for(size_t i=0; i<len; i++)
+			fdst[i] = func(fin[i]);
+
+		cap->MarkModifiedFromCpu();
+	}
+
+	/**
+		@brief Combines two uniform or sparse analog waveforms point by point, on the CPU
+
+		Inputs with the same sample layout are combined index by index and the output takes its timebase from a.
+		For a mix of sparse and uniform inputs the output follows the sparse input, and the uniform input is sampled
+		at the start of each sparse sample (clamped to its first and last samples).
+
+		Each of the four type combinations is compiled separately, so there is no per-sample type dispatch.
+
+		@param a			First input
+		@param b			Second input
+		@param stream		Output stream index
+		@param func			Function taking a sample of a and the matching sample of b and returning the output value
+	 */
+	template<class WA, class WB, class F>
+	void ApplyPointwise(WA* a, WB* b, size_t stream, F&& func)
+	{
+		AssertTypeIsAnalogWaveform(a);
+		AssertTypeIsAnalogWaveform(b);
+
+		constexpr bool sparseA = std::is_base_of<SparseWaveformBase, WA>::value;
+		constexpr bool sparseB = std::is_base_of<SparseWaveformBase, WB>::value;
+
+		a->PrepareForCpuAccess();
+		b->PrepareForCpuAccess();
+		float* fa = (float*)__builtin_assume_aligned(a->m_samples.GetCpuPointer(), 16);
+		float* fb = (float*)__builtin_assume_aligned(b->m_samples.GetCpuPointer(), 16);
+
+		if constexpr(sparseA == sparseB)
+		{
+			size_t len = std::min(a->size(), b->size());
+			auto cap = SetupAnalogOutputWaveformLike(a, stream, len);
+			cap->PrepareForCpuAccess();
+
+			float* fdst = (float*)__builtin_assume_aligned(cap->m_samples.GetCpuPointer(), 16);
+			for(size_t i=0; i<len; i++)
+				fdst[i] = func(fa[i], fb[i]);
+
+			cap->MarkModifiedFromCpu();
+		}
+		else
+		{
+			SparseWaveformBase* sparse;
+			UniformWaveformBase* uniform;
+			if constexpr(sparseA)
+			{
+				sparse = a;
+				uniform = b;
+			}
+			else
+			{
+				sparse = b;
+				uniform = a;
+			}
+
+			size_t len = sparse->size();
+			size_t ulen = uniform->size();
+			if(ulen == 0)
+			{
+				SetData(nullptr, stream);
+				return;
+			}
+			auto cap = SetupSparseOutputWaveform(sparse, stream, 0, 0);
+			cap->PrepareForCpuAccess();
+
+			float* fdst = (float*)__builtin_assume_aligned(cap->m_samples.GetCpuPointer(), 16);
+			for(size_t i=0; i<len; i++)
+			{
+				//Find the uniform sample containing the start of this one
+				int64_t t = GetOffsetScaled(sparse, i) - uniform->m_triggerPhase;
+				size_t j = 0;
+				if(t > 0)
+					j = std::min(static_cast<size_t>(t / uniform->m_timescale), ulen - 1);
+
+				if constexpr(sparseA)
+					fdst[i] = func(fa[i], fb[j]);
+				else
+					fdst[i] = func(fa[j], fb[i]);
+			}
+
+			cap->MarkModifiedFromCpu();
+		}
+	}
+
 public:
 	//Helpers for sub-sample interpolation
 
@@ -456,15 +740,38 @@ public:
 	{
 		AssertTypeIsAnalogWaveform(cap);
 
-		vmin = FLT_MAX;
-		vmax = FLT_MIN;
-		for(float f : cap->m_samples)
-		{
-			if(f < vmin)
-				vmin = f;
-			if(f > vmax)
-				vmax = f;
-		}
+		g_simdKernels.getMinMax(cap->m_samples.GetCpuPointer(), cap->size(), vmin, vmax);
+	}
+
+	/**
+		@brief Gets the lowest and highest voltage over a range of samples of a uniform waveform
+
+		Uses the cached MinMaxPyramid of the waveform, so this is O(log n) once the pyramid has been built.
+
+		@param cap		The waveform
+		@param first	Index of the first sample in the range
+		@param last		One past the index of the last sample in the range
+		@param vmin		Lowest voltage (FLT_MAX if the range is empty)
+		@param vmax		Highest voltage (-FLT_MAX if the range is empty)
+	 */
+	static void GetMinMaxVoltage(UniformAnalogWaveform* cap, size_t first, size_t last, float& vmin, float& vmax)
+	{
+		float vmean;
+		MinMaxPyramid::Get(cap)->Query(cap, first, last, vmin, vmax, vmean);
+	}
+
+	/**
+		@brief Gets the average voltage over a range of samples of a uniform waveform
+
+		Uses the cached MinMaxPyramid of the waveform, so this is O(log n) once the pyramid has been built.
+	 */
+	static float GetAvgVoltage(UniformAnalogWaveform* cap, size_t first, size_t last)
+	{
+		float vmin;
+		float vmax;
+		float vmean;
+		MinMaxPyramid::Get(cap)->Query(cap, first, last, vmin, vmax, vmean);
+		return vmean;
 	}
 
 	/**
@@ -518,21 +825,16 @@ public:
 
 	/**
 		@brief Gets the lowest voltage of a waveform
+
+		Uses the cached AnalogStatistics of the waveform, so repeated calls on the same revision are free.
 	 */
 	template<class T>
-	__attribute__((noinline))
 	static float GetMinVoltage(T* cap)
 	{
 		AssertTypeIsAnalogWaveform(cap);
-
-		//Loop over samples and find the minimum
-		float tmp = FLT_MAX;
-		for(float f : cap->m_samples)
-		{
-			if(f < tmp)
-				tmp = f;
-		}
-		return tmp;
+		if(cap->size() == 0)
+			return FLT_MAX;
+		return AnalogStatistics::Get(cap)->m_min;
 	}
 
 	/**
@@ -550,19 +852,12 @@ public:
 		@brief Gets the highest voltage of a waveform
 	 */
 	template<class T>
-	__attribute__((noinline))
 	static float GetMaxVoltage(T* cap)
 	{
 		AssertTypeIsAnalogWaveform(cap);
-
-		//Loop over samples and find the maximum
-		float tmp = -FLT_MAX;
-		for(float f : cap->m_samples)
-		{
-			if(f > tmp)
-				tmp = f;
-		}
-		return tmp;
+		if(cap->size() == 0)
+			return -FLT_MAX;
+		return AnalogStatistics::Get(cap)->m_max;
 	}
 
 	/**
@@ -580,31 +875,10 @@ public:
 		@brief Gets the most probable "0" level for a digital waveform
 	 */
 	template<class T>
-	__attribute__((noinline))
 	static float GetBaseVoltage(T* cap)
 	{
 		AssertTypeIsAnalogWaveform(cap);
-
-		float vmin = GetMinVoltage(cap);
-		float vmax = GetMaxVoltage(cap);
-		float delta = vmax - vmin;
-		const int nbins = 100;
-		auto hist = MakeHistogram(cap, vmin, vmax, nbins);
-
-		//Find the highest peak in the first quarter of the histogram
-		size_t binval = 0;
-		int idx = 0;
-		for(int i=0; i<(nbins/4); i++)
-		{
-			if(hist[i] > binval)
-			{
-				binval = hist[i];
-				idx = i;
-			}
-		}
-
-		float fbin = (idx + 0.5f)/nbins;
-		return fbin*delta + vmin;
+		return AnalogStatistics::Get(cap)->GetBase();
 	}
 
 	/**
@@ -622,31 +896,10 @@ public:
 		@brief Gets the most probable "1" level for a digital waveform
 	 */
 	template<class T>
-	__attribute__((noinline))
 	static float GetTopVoltage(T* cap)
 	{
 		AssertTypeIsAnalogWaveform(cap);
-
-		float vmin = GetMinVoltage(cap);
-		float vmax = GetMaxVoltage(cap);
-		float delta = vmax - vmin;
-		const int nbins = 100;
-		auto hist = MakeHistogram(cap, vmin, vmax, nbins);
-
-		//Find the highest peak in the third quarter of the histogram
-		size_t binval = 0;
-		int idx = 0;
-		for(int i=(nbins*3)/4; i<nbins; i++)
-		{
-			if(hist[i] > binval)
-			{
-				binval = hist[i];
-				idx = i;
-			}
-		}
-
-		float fbin = (idx + 0.5f)/nbins;
-		return fbin*delta + vmin;
+		return AnalogStatistics::Get(cap)->GetTop();
 	}
 
 	/**
@@ -664,17 +917,10 @@ public:
 		@brief Gets the average voltage of a waveform
 	 */
 	template<class T>
-	__attribute__((noinline))
 	static float GetAvgVoltage(T* cap)
 	{
 		AssertTypeIsAnalogWaveform(cap);
-
-		//Loop over samples and find the average
-		//TODO: more numerically stable summation algorithm for deep captures
-		double sum = 0;
-		for(float f : cap->m_samples)
-			sum += f;
-		return sum / cap->m_samples.size();
+		return AnalogStatistics::Get(cap)->GetAverage();
 	}
 
 	/**
@@ -861,6 +1107,13 @@ public:
 		AssertTypeIsDigitalWaveform(clock);
 		AssertSampleTypesAreSame(data, &samples);
 
+		//Analog data goes through the edge list based sampler, which can stay on the GPU
+		if constexpr(std::is_same<S, float>::value)
+		{
+			EdgeSampler::Sample(data, clock, samples, EdgeSampler::EDGE_ANY, false, cpuOnly);
+			return;
+		}
+
 		samples.clear();
 		if(cpuOnly)
 			samples.SetGpuAccessHint(AcceleratorBuffer<S>::HINT_NEVER);	//assume we're being used as part of a CPU-side filter
@@ -875,7 +1128,7 @@ public:
 
 		//If the clock is sparse, assume it probably has edges on every sample and allocate that much buffer to start
 		//(we might overallocate here but it'll be a lot faster)
-		if(dynamic_cast<SparseDigitalWaveform*>(clock) != nullptr)
+		if(WaveformCast<SparseDigitalWaveform>(clock) != nullptr)
 		{
 			//Allocate exactly enough space
 			samples.Resize(clock->size());
@@ -959,20 +1212,8 @@ public:
 		clock->PrepareForCpuAccess();
 		samples.PrepareForCpuAccess();
 
-		auto udata = dynamic_cast<UniformWaveform<T>*>(data);
-		auto sdata = dynamic_cast<SparseWaveform<T>*>(data);
-
-		auto uclock = dynamic_cast<UniformDigitalWaveform*>(clock);
-		auto sclock = dynamic_cast<SparseDigitalWaveform*>(clock);
-
-		if(udata && uclock)
-			SampleOnAnyEdges(udata, uclock, samples);
-		else if(udata && sclock)
-			SampleOnAnyEdges(udata, sclock, samples);
-		else if(sdata && sclock)
-			SampleOnAnyEdges(sdata, sclock, samples);
-		else if(sdata && uclock)
-			SampleOnAnyEdges(sdata, uclock, samples);
+		VisitWaveforms<T, bool>(data, clock, [&](auto d, auto c)
+			{ SampleOnAnyEdges(d, c, samples); });
 	}
 
 	/**
@@ -996,6 +1237,13 @@ public:
 		AssertTypeIsSparseWaveform(&samples);
 		AssertSampleTypesAreSame(data, &samples);
 
+		//Analog data goes through the edge list based sampler
+		if constexpr(std::is_same<S, float>::value)
+		{
+			EdgeSampler::Sample(data, clock, samples, EdgeSampler::EDGE_RISING, false, true);
+			return;
+		}
+
 		samples.clear();
 		samples.SetGpuAccessHint(AcceleratorBuffer<S>::HINT_NEVER);	//assume we're being used as part of a CPU-side filter
 		samples.Reserve(1 * 1024 * 1024);	//preallocate 1 MB sample buffer to avoid lots of reallocation when small
@@ -1057,20 +1305,8 @@ public:
 		clock->PrepareForCpuAccess();
 		samples.PrepareForCpuAccess();
 
-		auto udata = dynamic_cast<UniformWaveform<T>*>(data);
-		auto sdata = dynamic_cast<SparseWaveform<T>*>(data);
-
-		auto uclock = dynamic_cast<UniformDigitalWaveform*>(clock);
-		auto sclock = dynamic_cast<SparseDigitalWaveform*>(clock);
-
-		if(udata && uclock)
-			SampleOnRisingEdges(udata, uclock, samples);
-		else if(udata && sclock)
-			SampleOnRisingEdges(udata, sclock, samples);
-		else if(sdata && sclock)
-			SampleOnRisingEdges(sdata, sclock, samples);
-		else if(sdata && uclock)
-			SampleOnRisingEdges(sdata, uclock, samples);
+		VisitWaveforms<T, bool>(data, clock, [&](auto d, auto c)
+			{ SampleOnRisingEdges(d, c, samples); });
 	}
 
 	/**
@@ -1094,6 +1330,13 @@ public:
 		AssertTypeIsSparseWaveform(&samples);
 		AssertSampleTypesAreSame(data, &samples);
 
+		//Analog data goes through the edge list based sampler
+		if constexpr(std::is_same<S, float>::value)
+		{
+			EdgeSampler::Sample(data, clock, samples, EdgeSampler::EDGE_FALLING, false, true);
+			return;
+		}
+
 		samples.clear();
 		samples.SetGpuAccessHint(AcceleratorBuffer<S>::HINT_NEVER);	//assume we're being used as part of a CPU-side filter
 		samples.Reserve(1 * 1024 * 1024);	//preallocate 1 MB sample buffer to avoid lots of reallocation when small
@@ -1154,50 +1397,7 @@ public:
 		AssertTypeIsAnalogWaveform(data);
 		AssertTypeIsDigitalWaveform(clock);
 
-		samples.clear();
-		samples.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_NEVER);	//assume we're being used as part of a CPU-side filter
-		samples.Reserve(1 * 1024 * 1024);	//preallocate 1 MB sample buffer to avoid lots of reallocation when small
-											//if it's smaller than this, we won't waste a lot of memory
-
-		//TODO: split up into blocks and multithread?
-		//TODO: AVX vcompress
-
-		size_t len = clock->size();
-		size_t dlen = data->size();
-
-		size_t ndata = 0;
-		for(size_t i=1; i<len; i++)
-		{
-			//Throw away clock samples until we find an edge
-			if(clock->m_samples[i] == clock->m_samples[i-1])
-				continue;
-
-			//Throw away data samples until the data is synced with us
-			int64_t clkstart = GetOffsetScaled(clock, i);
-			while( (ndata+1 < dlen) && (GetOffsetScaled(data, ndata+1) < clkstart) )
-				ndata ++;
-			if(ndata >= dlen)
-				break;
-
-			//Find the fractional position of the clock edge
-			int64_t tsample = GetOffsetScaled(data, ndata);
-			int64_t delta = clkstart - tsample;
-			float frac = delta * 1.0 / data->m_timescale;
-
-			//Add the new sample
-			samples.m_offsets.push_back(clkstart);
-			samples.m_samples.push_back(InterpolateValue(data, ndata, frac));
-		}
-
-		//Compute sample durations
-		#ifdef __x86_64__
-		if(g_hasAvx2)
-			FillDurationsAVX2(samples);
-		else
-		#endif
-			FillDurationsGeneric(samples);
-
-		samples.MarkModifiedFromCpu();
+		EdgeSampler::Sample(data, clock, samples, EdgeSampler::EDGE_ANY, true, true);
 	}
 
 	/**
@@ -1220,20 +1420,8 @@ public:
 		clock->PrepareForCpuAccess();
 		samples.PrepareForCpuAccess();
 
-		auto udata = dynamic_cast<UniformWaveform<T>*>(data);
-		auto sdata = dynamic_cast<SparseWaveform<T>*>(data);
-
-		auto uclock = dynamic_cast<UniformDigitalWaveform*>(clock);
-		auto sclock = dynamic_cast<SparseDigitalWaveform*>(clock);
-
-		if(udata && uclock)
-			SampleOnAnyEdgesWithInterpolation(udata, uclock, samples);
-		else if(udata && sclock)
-			SampleOnAnyEdgesWithInterpolation(udata, sclock, samples);
-		else if(sdata && sclock)
-			SampleOnAnyEdgesWithInterpolation(sdata, sclock, samples);
-		else if(sdata && uclock)
-			SampleOnAnyEdgesWithInterpolation(sdata, uclock, samples);
+		VisitWaveforms<T, bool>(data, clock, [&](auto d, auto c)
+			{ SampleOnAnyEdgesWithInterpolation(d, c, samples); });
 	}
 
 	/**
@@ -1270,18 +1458,16 @@ public:
 	static void FindRisingEdges(SparseDigitalWaveform* data, std::vector<int64_t>& edges);
 	static void FindFallingEdges(UniformDigitalWaveform* data, std::vector<int64_t>& edges);
 	static void FindFallingEdges(SparseDigitalWaveform* data, std::vector<int64_t>& edges);
+	static void FindZeroCrossings(UniformPackedDigitalWaveform* data, std::vector<int64_t>& edges);
+	static void FindRisingEdges(UniformPackedDigitalWaveform* data, std::vector<int64_t>& edges);
+	static void FindFallingEdges(UniformPackedDigitalWaveform* data, std::vector<int64_t>& edges);
 	static void FindPeaks(UniformAnalogWaveform* data, float peak_threshold, std::vector<int64_t>& peak_indices);
 	static void FindPeaks(SparseAnalogWaveform* data, float peak_threshold, std::vector<int64_t>& peak_indices);
 
 	static void FindZeroCrossingsBase(WaveformBase* data, float threshold, std::vector<int64_t>& edges)
 	{
-		auto udata = dynamic_cast<UniformAnalogWaveform*>(data);
-		auto sdata = dynamic_cast<SparseAnalogWaveform*>(data);
-
-		if(udata)
-			FindZeroCrossings(udata, threshold, edges);
-		else
-			FindZeroCrossings(sdata, threshold, edges);
+		VisitWaveform<float>(data, [&](auto d)
+			{ FindZeroCrossings(d, threshold, edges); });
 	}
 
 	static void FindRisingEdges(
@@ -1331,6 +1517,12 @@ public:
 
 	static void ClearAnalysisCache();
 
+protected:
+	static void FindPackedEdges(
+		UniformPackedDigitalWaveform* data, std::vector<int64_t>& edges, bool rising, bool falling);
+
+public:
+
 	enum FIRFilterType
 	{
 		FILTER_TYPE_LOWPASS,
@@ -1376,6 +1568,57 @@ public:
 	static void EnumProtocols(std::vector<std::string>& names);
 	static Filter* CreateFilter(const std::string& protocol, const std::string& color = "#ffffff");
 
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Output recycling
+
+	void RecycleOutputWaveform(WaveformBase* w);
+
+	///@brief Gets the number of output waveforms this filter has allocated, rather than reused
+	uint64_t GetOutputAllocationCount()
+	{ return m_outputAllocationCount; }
+
+	///@brief Gets the number of output allocations, across all filters, made after a stream's first refresh
+	static uint64_t GetSteadyStateAllocationCount()
+	{ return m_steadyStateAllocations; }
+
+	/**
+		@brief Number of recycled waveforms of each size kept per filter
+
+		Enough for the current output, the one the consumer is still drawing, and one in flight back to us.
+	 */
+	static constexpr size_t OUTPUT_POOL_DEPTH = 3;
+
+protected:
+	void OnOutputAllocated(size_t stream);
+
+	///@brief Output waveforms handed back by consumers, for reuse by GetOutputWaveform()
+	WaveformPool m_outputPool;
+
+	///@brief Number of output waveforms allocated for each stream
+	std::vector<uint64_t> m_streamAllocations;
+
+	///@brief Total number of output waveforms allocated
+	uint64_t m_outputAllocationCount;
+
+	///@brief Total number of output waveforms allocated by any filter after a stream's first refresh
+	static std::atomic<uint64_t> m_steadyStateAllocations;
+
+public:
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// CPU/GPU dispatch
+
+	static void SetGpuCrossover(const std::string& protocol, size_t depth);
+	static size_t GetGpuCrossover(const std::string& protocol);
+	static void ClearGpuCrossovers();
+
+protected:
+	bool IsGpuPreferred(size_t depth);
+	bool IsGpuPreferred();
+
+	//Measured CPU/GPU crossover sizes, indexed by protocol display name
+	static std::mutex m_gpuCrossoverMutex;
+	static std::map<std::string, size_t> m_gpuCrossovers;
+
 protected:
 	//Class enumeration
 	typedef std::map< std::string, CreateProcType > CreateMapType;
@@ -1387,9 +1630,8 @@ protected:
 	//Instance naming
 	static std::map<std::string, unsigned int> m_instanceCount;
 
-	//Caching
-	static std::mutex m_cacheMutex;
-	static std::map<std::pair<WaveformBase*, float>, std::vector<int64_t> > m_zeroCrossingCache;
+	//Protects m_filters and m_instanceCount, since filters may be constructed in parallel (see FilterGraphLoader)
+	static std::mutex m_filtersMutex;
 };
 
 #define PROTOCOL_DECODER_INITPROC(T) \
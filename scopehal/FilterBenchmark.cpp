@@ -0,0 +1,750 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of FilterBenchmark
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "FilterBenchmark.h"
+#include "TestWaveformSource.h"
+#include <algorithm>
+#include <cinttypes>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+FilterBenchmark::FilterBenchmark()
+	: m_depths{1000, 10000, 100000, 1000000, 10000000, 100000000}
+	, m_warmupIterations(2)
+	, m_iterations(10)
+	, m_uniform(true)
+	, m_sparse(true)
+	, m_cpu(true)
+	, m_gpu(true)
+	, m_minRelativeChange(0.05)
+	, m_madMultiple(3)
+	, m_rng(0)
+	, m_source(make_unique<TestWaveformSource>(m_rng))
+	, m_analogChannel(make_unique<OscilloscopeChannel>(
+		nullptr, "BenchAnalog", "#ffffff", Unit(Unit::UNIT_FS), Unit(Unit::UNIT_VOLTS), Stream::STREAM_TYPE_ANALOG))
+	, m_digitalChannel(make_unique<OscilloscopeChannel>(
+		nullptr, "BenchDigital", "#ffffff", Unit(Unit::UNIT_FS), Unit(Unit::UNIT_COUNTS), Stream::STREAM_TYPE_DIGITAL))
+{
+	m_queue = g_vkQueueManager->GetComputeQueue("FilterBenchmark.queue");
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		m_queue->m_family );
+	m_pool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(**m_pool, vk::CommandBufferLevel::ePrimary, 1);
+	m_cmdBuf = make_unique<vk::raii::CommandBuffer>(
+		std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+}
+
+FilterBenchmark::~FilterBenchmark()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Running
+
+/**
+	@brief Benchmarks every registered filter
+ */
+void FilterBenchmark::RunAll()
+{
+	vector<string> names;
+	Filter::EnumProtocols(names);
+	for(auto& name : names)
+		Run(name);
+}
+
+/**
+	@brief Benchmarks one filter across every configured size, input type and execution mode
+
+	@param protocol	Protocol name of the filter
+ */
+void FilterBenchmark::Run(const string& protocol)
+{
+	for(auto depth : m_depths)
+	{
+		for(int sparse = 0; sparse < 2; sparse ++)
+		{
+			if( (sparse && !m_sparse) || (!sparse && !m_uniform) )
+				continue;
+
+			GenerateInputs(depth, sparse);
+
+			for(int gpu = 0; gpu < 2; gpu ++)
+			{
+				if( (gpu && !m_gpu) || (!gpu && !m_cpu) )
+					continue;
+
+				m_results.push_back(RunOne(protocol, depth, sparse, gpu));
+			}
+		}
+	}
+}
+
+/**
+	@brief Benchmarks one filter in one configuration, using the inputs from the last GenerateInputs() call
+ */
+FilterBenchmarkResult FilterBenchmark::RunOne(const string& protocol, size_t depth, bool sparse, bool gpu)
+{
+	FilterBenchmarkResult ret;
+	ret.m_protocol = protocol;
+	ret.m_depth = depth;
+	ret.m_sparse = sparse;
+	ret.m_gpu = gpu;
+
+	//GPU mode is only meaningful if we have a usable GPU to begin with
+	bool gpuWasEnabled = g_gpuFilterEnabled;
+	if(gpu && !gpuWasEnabled)
+	{
+		ret.m_error = "GPU filters are disabled";
+		return ret;
+	}
+	g_gpuFilterEnabled = gpu;
+
+	//Measure each path on its own, without any crossover from an earlier ApplyCrossovers() getting in the way
+	size_t crossover = Filter::GetGpuCrossover(protocol);
+	Filter::SetGpuCrossover(protocol, 0);
+
+	auto f = Filter::CreateFilter(protocol);
+	if(!f)
+	{
+		g_gpuFilterEnabled = gpuWasEnabled;
+		Filter::SetGpuCrossover(protocol, crossover);
+		ret.m_error = "unknown protocol";
+		return ret;
+	}
+	f->AddRef();
+
+	if(!ConnectInputs(f))
+		ret.m_error = "no generated waveform type is accepted by every input";
+	else
+	{
+		auto& counters = PerformanceCounters::GetThreadCounters();
+
+		for(size_t i=0; i<m_warmupIterations; i++)
+		{
+			TouchInputs();
+			f->Refresh(*m_cmdBuf, m_queue);
+		}
+
+		vector<double> times;
+		uint64_t uploadStart = counters.m_uploadBytes;
+		uint64_t readbackStart = counters.m_readbackBytes;
+		for(size_t i=0; i<m_iterations; i++)
+		{
+			//Filters may skip work if the input revision is unchanged, so make every refresh look like new data
+			TouchInputs();
+
+			double start = GetTime();
+			f->Refresh(*m_cmdBuf, m_queue);
+			times.push_back(GetTime() - start);
+		}
+
+		if(!times.empty())
+		{
+			ret.m_iterations = times.size();
+			ret.m_uploadBytes = (counters.m_uploadBytes - uploadStart) / times.size();
+			ret.m_readbackBytes = (counters.m_readbackBytes - readbackStart) / times.size();
+
+			double total = 0;
+			for(auto t : times)
+				total += t;
+			if(total > 0)
+				ret.m_samplesPerSecond = depth * times.size() / total;
+
+			sort(times.begin(), times.end());
+			auto percentile = [&times](double p)
+				{ return times[min(times.size() - 1, static_cast<size_t>(p * times.size()))]; };
+			ret.m_latencyMin = times.front();
+			ret.m_latencyP50 = percentile(0.5);
+			ret.m_latencyP90 = percentile(0.9);
+			ret.m_latencyP99 = percentile(0.99);
+			ret.m_latencyMax = times.back();
+
+			vector<double> deviations;
+			for(auto t : times)
+				deviations.push_back(fabs(t - ret.m_latencyP50));
+			sort(deviations.begin(), deviations.end());
+			ret.m_latencyMAD = deviations[deviations.size() / 2];
+		}
+
+		for(size_t i=0; i<f->GetStreamCount(); i++)
+		{
+			auto data = f->GetData(i);
+			if(!data)
+				continue;
+			ret.m_outputSamples += data->size();
+			ret.m_outputBytes += GetWaveformBytes(data);
+		}
+	}
+
+	f->Release();
+	g_gpuFilterEnabled = gpuWasEnabled;
+	Filter::SetGpuCrossover(protocol, crossover);
+
+	LogDebug("%s: %zu points, %s, %s: %.3e samples/sec\n",
+		protocol.c_str(), depth, sparse ? "sparse" : "uniform", gpu ? "GPU" : "CPU", ret.m_samplesPerSecond);
+	return ret;
+}
+
+/**
+	@brief Connects every input of a filter to the generated analog waveform, or the digital one if that's rejected
+
+	@return True if every input was connected
+ */
+bool FilterBenchmark::ConnectInputs(Filter* f)
+{
+	StreamDescriptor analog(m_analogChannel.get(), 0);
+	StreamDescriptor digital(m_digitalChannel.get(), 0);
+
+	for(size_t i=0; i<f->GetInputCount(); i++)
+	{
+		if(f->ValidateChannel(i, analog))
+			f->SetInput(i, analog);
+		else if(f->ValidateChannel(i, digital))
+			f->SetInput(i, digital);
+		else
+			return false;
+	}
+	return true;
+}
+
+/**
+	@brief Creates the input waveforms for one size and input type
+
+	The analog input is a noisy sine with a period of 100 points. The digital input is the same, thresholded at zero.
+	Sparse inputs have the same samples, with explicit one-point durations.
+ */
+void FilterBenchmark::GenerateInputs(size_t depth, bool sparse)
+{
+	const int64_t sampleperiod = 10000;
+
+	auto sine = new UniformAnalogWaveform;
+	m_source->GenerateNoisySinewave(*m_cmdBuf, m_queue, sine, 1.0, 0, 100 * sampleperiod, sampleperiod, depth);
+	sine->PrepareForCpuAccess();
+
+	if(!sparse)
+	{
+		auto dig = new UniformDigitalWaveform;
+		dig->m_timescale = sampleperiod;
+		dig->Resize(depth);
+		for(size_t i=0; i<depth; i++)
+			dig->m_samples[i] = (sine->m_samples[i] > 0);
+		dig->MarkModifiedFromCpu();
+
+		m_analogChannel->SetData(sine, 0);
+		m_digitalChannel->SetData(dig, 0);
+		return;
+	}
+
+	auto sa = new SparseAnalogWaveform;
+	auto sd = new SparseDigitalWaveform;
+	sa->m_timescale = sampleperiod;
+	sd->m_timescale = sampleperiod;
+	sa->Resize(depth);
+	sd->Resize(depth);
+	for(size_t i=0; i<depth; i++)
+	{
+		sa->m_offsets[i] = i;
+		sa->m_durations[i] = 1;
+		sa->m_samples[i] = sine->m_samples[i];
+
+		sd->m_offsets[i] = i;
+		sd->m_durations[i] = 1;
+		sd->m_samples[i] = (sine->m_samples[i] > 0);
+	}
+	sa->MarkModifiedFromCpu();
+	sd->MarkModifiedFromCpu();
+	delete sine;
+
+	m_analogChannel->SetData(sa, 0);
+	m_digitalChannel->SetData(sd, 0);
+}
+
+/**
+	@brief Bumps the revision of both input waveforms, so filters don't reuse results cached from the last refresh
+ */
+void FilterBenchmark::TouchInputs()
+{
+	for(auto chan : {m_analogChannel.get(), m_digitalChannel.get()})
+	{
+		auto data = chan->GetData(0);
+		if(data)
+			data->m_revision ++;
+	}
+}
+
+/**
+	@brief Estimates the memory used by a waveform's samples and timestamps
+
+	Only the standard analog and digital types are counted; anything else (eyes, protocol packets...) is reported as 0.
+ */
+uint64_t FilterBenchmark::GetWaveformBytes(WaveformBase* wfm)
+{
+	uint64_t timestamps = 0;
+	if(dynamic_cast<SparseWaveformBase*>(wfm))
+		timestamps = wfm->size() * 2 * sizeof(int64_t);
+
+	if(dynamic_cast<UniformAnalogWaveform*>(wfm) || dynamic_cast<SparseAnalogWaveform*>(wfm))
+		return timestamps + wfm->size() * sizeof(float);
+	if(dynamic_cast<UniformDigitalWaveform*>(wfm) || dynamic_cast<SparseDigitalWaveform*>(wfm))
+		return timestamps + wfm->size() * sizeof(bool);
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Output
+
+/**
+	@brief Formats every result so far as a JSON document
+
+	Times are in seconds and sizes in bytes. Failed configurations are included, with a non-empty "error".
+ */
+string FilterBenchmark::ToJSON()
+{
+	string ret = "{\"results\":[";
+	char tmp[1024];
+	for(size_t i=0; i<m_results.size(); i++)
+	{
+		auto& r = m_results[i];
+		snprintf(tmp, sizeof(tmp),
+			"%s\n{\"protocol\":\"%s\",\"depth\":%zu,\"inputs\":\"%s\",\"mode\":\"%s\",\"iterations\":%zu,"
+			"\"samplesPerSecond\":%.6e,"
+			"\"latency\":{\"min\":%.6e,\"p50\":%.6e,\"p90\":%.6e,\"p99\":%.6e,\"max\":%.6e,\"mad\":%.6e},"
+			"\"outputSamples\":%zu,\"outputBytes\":%" PRIu64 ","
+			"\"uploadBytesPerRefresh\":%" PRIu64 ",\"readbackBytesPerRefresh\":%" PRIu64 ",\"error\":\"%s\"}",
+			(i == 0) ? "" : ",",
+			PerformanceTrace::EscapeJson(r.m_protocol).c_str(),
+			r.m_depth,
+			r.m_sparse ? "sparse" : "uniform",
+			r.m_gpu ? "gpu" : "cpu",
+			r.m_iterations,
+			r.m_samplesPerSecond,
+			r.m_latencyMin,
+			r.m_latencyP50,
+			r.m_latencyP90,
+			r.m_latencyP99,
+			r.m_latencyMax,
+			r.m_latencyMAD,
+			r.m_outputSamples,
+			r.m_outputBytes,
+			r.m_uploadBytes,
+			r.m_readbackBytes,
+			PerformanceTrace::EscapeJson(r.m_error).c_str());
+		ret += tmp;
+	}
+
+	ret += "\n],\"crossovers\":[";
+	auto crossovers = GetCrossovers();
+	for(size_t i=0; i<crossovers.size(); i++)
+	{
+		auto& c = crossovers[i];
+		snprintf(tmp, sizeof(tmp), "%s\n{\"protocol\":\"%s\",\"inputs\":\"%s\",\"depth\":%s}",
+			(i == 0) ? "" : ",",
+			PerformanceTrace::EscapeJson(c.m_protocol).c_str(),
+			c.m_sparse ? "sparse" : "uniform",
+			(c.m_depth == FilterBenchmarkCrossover::NEVER) ? "null" : to_string(c.m_depth).c_str());
+		ret += tmp;
+	}
+	ret += "\n],\"device\":\"" + GetDeviceID() + "\"}\n";
+	return ret;
+}
+
+/**
+	@brief Writes ToJSON() to a file
+
+	@return True on success
+ */
+bool FilterBenchmark::WriteJSON(const string& path)
+{
+	FILE* fp = fopen(path.c_str(), "w");
+	if(!fp)
+	{
+		LogError("Failed to open benchmark results file %s\n", path.c_str());
+		return false;
+	}
+
+	auto json = ToJSON();
+	fwrite(json.c_str(), 1, json.length(), fp);
+
+	bool ok = !ferror(fp);
+	fclose(fp);
+	return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Baselines
+
+/**
+	@brief Returns a string identifying the compute device, so baselines from different machines are kept apart
+
+	This is the pipeline cache UUID and driver version of the Vulkan device, in hex.
+ */
+string FilterBenchmark::GetDeviceID()
+{
+	string ret;
+	char tmp[16];
+	for(size_t i=0; i<16; i++)
+	{
+		snprintf(tmp, sizeof(tmp), "%02x", g_vkComputeDeviceUuid[i]);
+		ret += tmp;
+	}
+	snprintf(tmp, sizeof(tmp), "-%08x", g_vkComputeDeviceDriverVer);
+	ret += tmp;
+	return ret;
+}
+
+/**
+	@brief Gets the key used to match a result against its baseline
+ */
+string FilterBenchmark::GetResultKey(const string& protocol, size_t depth, bool sparse, bool gpu)
+{
+	return protocol + "|" + to_string(depth) + "|" + (sparse ? "sparse" : "uniform") + "|" + (gpu ? "gpu" : "cpu");
+}
+
+/**
+	@brief Adds every successful result so far to a baseline file for this device
+
+	Entries for other devices, and for configurations not run this time, are kept.
+
+	@return True on success
+ */
+bool FilterBenchmark::SaveBaseline(const string& path)
+{
+	string device = GetDeviceID();
+
+	//Load whatever is already there, if anything
+	YAML::Node root;
+	bool exists = false;
+	FILE* fp = fopen(path.c_str(), "r");
+	if(fp)
+	{
+		exists = true;
+		fclose(fp);
+	}
+
+	//Merge our results over this device's existing entries
+	map<string, YAML::Node> entries;
+	try
+	{
+		if(exists)
+			root = YAML::LoadFile(path);
+
+		auto old = root["devices"][device];
+		if(old.IsSequence())
+		{
+			for(auto it : old)
+			{
+				auto key = GetResultKey(
+					it["protocol"].as<string>(),
+					it["depth"].as<size_t>(),
+					it["inputs"].as<string>() == "sparse",
+					it["mode"].as<string>() == "gpu");
+				entries[key] = it;
+			}
+		}
+	}
+	catch(const YAML::Exception& e)
+	{
+		LogError("Failed to parse existing baseline file %s: %s\n", path.c_str(), e.what());
+		return false;
+	}
+	for(auto& r : m_results)
+	{
+		if(!r.m_error.empty())
+			continue;
+
+		YAML::Node entry;
+		entry["protocol"] = r.m_protocol;
+		entry["depth"] = r.m_depth;
+		entry["inputs"] = r.m_sparse ? "sparse" : "uniform";
+		entry["mode"] = r.m_gpu ? "gpu" : "cpu";
+		entry["median"] = r.m_latencyP50;
+		entry["mad"] = r.m_latencyMAD;
+		entry["iterations"] = r.m_iterations;
+		entries[GetResultKey(r.m_protocol, r.m_depth, r.m_sparse, r.m_gpu)] = entry;
+	}
+
+	YAML::Node list;
+	for(auto& it : entries)
+		list.push_back(it.second);
+	root["devices"][device] = list;
+
+	fp = fopen(path.c_str(), "w");
+	if(!fp)
+	{
+		LogError("Failed to open baseline file %s\n", path.c_str());
+		return false;
+	}
+
+	YAML::Emitter out;
+	out << root;
+	fwrite(out.c_str(), 1, out.size(), fp);
+	fputs("\n", fp);
+
+	bool ok = !ferror(fp);
+	fclose(fp);
+	return ok;
+}
+
+/**
+	@brief Loads this device's entries from a baseline file, replacing any previously loaded baseline
+
+	@return True if the file was read and contains a baseline for this device
+ */
+bool FilterBenchmark::LoadBaseline(const string& path)
+{
+	m_baseline.clear();
+
+	YAML::Node root;
+	try
+	{
+		root = YAML::LoadFile(path);
+	}
+	catch(const YAML::Exception& e)
+	{
+		LogError("Failed to load baseline file %s: %s\n", path.c_str(), e.what());
+		return false;
+	}
+
+	string device = GetDeviceID();
+	auto entries = root["devices"][device];
+	if(!entries.IsSequence())
+	{
+		LogWarning("Baseline file %s has no results for device %s\n", path.c_str(), device.c_str());
+		return false;
+	}
+
+	try
+	{
+		for(auto it : entries)
+		{
+			FilterBenchmarkResult r;
+			r.m_protocol = it["protocol"].as<string>();
+			r.m_depth = it["depth"].as<size_t>();
+			r.m_sparse = (it["inputs"].as<string>() == "sparse");
+			r.m_gpu = (it["mode"].as<string>() == "gpu");
+			r.m_latencyP50 = it["median"].as<double>();
+			r.m_latencyMAD = it["mad"].as<double>();
+			r.m_iterations = it["iterations"].as<size_t>();
+			m_baseline[GetResultKey(r.m_protocol, r.m_depth, r.m_sparse, r.m_gpu)] = r;
+		}
+	}
+	catch(const YAML::Exception& e)
+	{
+		LogError("Malformed entry in baseline file %s: %s\n", path.c_str(), e.what());
+		m_baseline.clear();
+		return false;
+	}
+
+	LogDebug("Loaded %zu baseline results for device %s\n", m_baseline.size(), device.c_str());
+	return true;
+}
+
+/**
+	@brief Compares every successful result so far against the loaded baseline
+
+	A change in median refresh time is significant if it is larger than the minimum relative change, and also
+	larger than the configured multiple of the MAD (scaled by 1.4826 to estimate a standard deviation) of whichever
+	of the two runs was noisier. Configurations with no baseline entry are skipped.
+ */
+vector<FilterBenchmarkComparison> FilterBenchmark::CompareToBaseline()
+{
+	//Converts a MAD to an estimate of standard deviation for normally distributed data
+	const double madScale = 1.4826;
+
+	vector<FilterBenchmarkComparison> ret;
+	for(auto& r : m_results)
+	{
+		if(!r.m_error.empty())
+			continue;
+
+		auto it = m_baseline.find(GetResultKey(r.m_protocol, r.m_depth, r.m_sparse, r.m_gpu));
+		if(it == m_baseline.end())
+			continue;
+		auto& b = it->second;
+		if(b.m_latencyP50 <= 0)
+			continue;
+
+		FilterBenchmarkComparison c;
+		c.m_protocol = r.m_protocol;
+		c.m_depth = r.m_depth;
+		c.m_sparse = r.m_sparse;
+		c.m_gpu = r.m_gpu;
+		c.m_baselineMedian = b.m_latencyP50;
+		c.m_baselineMAD = b.m_latencyMAD;
+		c.m_currentMedian = r.m_latencyP50;
+		c.m_currentMAD = r.m_latencyMAD;
+
+		double delta = c.m_currentMedian - c.m_baselineMedian;
+		c.m_relativeChange = delta / c.m_baselineMedian;
+
+		double noise = m_madMultiple * madScale * max(c.m_baselineMAD, c.m_currentMAD);
+		double threshold = max(noise, m_minRelativeChange * c.m_baselineMedian);
+		c.m_significant = (fabs(delta) > threshold);
+		c.m_regression = c.m_significant && (delta > 0);
+
+		if(c.m_regression)
+		{
+			LogWarning("%s (%zu points, %s, %s): median %.3f ms -> %.3f ms (%+.1f%%)\n",
+				c.m_protocol.c_str(),
+				c.m_depth,
+				c.m_sparse ? "sparse" : "uniform",
+				c.m_gpu ? "GPU" : "CPU",
+				c.m_baselineMedian * 1e3,
+				c.m_currentMedian * 1e3,
+				c.m_relativeChange * 100);
+		}
+
+		ret.push_back(c);
+	}
+	return ret;
+}
+
+/**
+	@brief Formats the output of CompareToBaseline() as a JSON document
+ */
+string FilterBenchmark::ComparisonsToJSON(const vector<FilterBenchmarkComparison>& comparisons)
+{
+	string ret = "{\"comparisons\":[";
+	char tmp[1024];
+	bool regression = false;
+	for(size_t i=0; i<comparisons.size(); i++)
+	{
+		auto& c = comparisons[i];
+		regression |= c.m_regression;
+		snprintf(tmp, sizeof(tmp),
+			"%s\n{\"protocol\":\"%s\",\"depth\":%zu,\"inputs\":\"%s\",\"mode\":\"%s\","
+			"\"baseline\":{\"median\":%.6e,\"mad\":%.6e},"
+			"\"current\":{\"median\":%.6e,\"mad\":%.6e},"
+			"\"change\":%.4f,\"significant\":%s,\"regression\":%s}",
+			(i == 0) ? "" : ",",
+			PerformanceTrace::EscapeJson(c.m_protocol).c_str(),
+			c.m_depth,
+			c.m_sparse ? "sparse" : "uniform",
+			c.m_gpu ? "gpu" : "cpu",
+			c.m_baselineMedian,
+			c.m_baselineMAD,
+			c.m_currentMedian,
+			c.m_currentMAD,
+			c.m_relativeChange,
+			c.m_significant ? "true" : "false",
+			c.m_regression ? "true" : "false");
+		ret += tmp;
+	}
+	ret += string("\n],\"regression\":") + (regression ? "true" : "false") + "}\n";
+	return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CPU/GPU crossovers
+
+/**
+	@brief Finds, for each filter and input type with both CPU and GPU results, the size from which the GPU wins
+
+	The crossover is the smallest benchmarked depth at which the GPU median is faster than the CPU median at that
+	depth and at every larger one, so a single fast point in a noisy sweep doesn't move it.
+ */
+vector<FilterBenchmarkCrossover> FilterBenchmark::GetCrossovers()
+{
+	//(protocol, sparse) -> depth -> (cpu median, gpu median)
+	map<pair<string, bool>, map<size_t, pair<double, double> > > times;
+	for(auto& r : m_results)
+	{
+		if(!r.m_error.empty())
+			continue;
+
+		auto& t = times[pair<string, bool>(r.m_protocol, r.m_sparse)];
+		auto it = t.find(r.m_depth);
+		if(it == t.end())
+			it = t.emplace(r.m_depth, pair<double, double>(-1, -1)).first;
+		if(r.m_gpu)
+			it->second.second = r.m_latencyP50;
+		else
+			it->second.first = r.m_latencyP50;
+	}
+
+	vector<FilterBenchmarkCrossover> ret;
+	for(auto& it : times)
+	{
+		FilterBenchmarkCrossover c;
+		c.m_protocol = it.first.first;
+		c.m_sparse = it.first.second;
+
+		//Walk down from the largest size until the GPU stops winning
+		bool paired = false;
+		for(auto jt = it.second.rbegin(); jt != it.second.rend(); ++jt)
+		{
+			double cpu = jt->second.first;
+			double gpu = jt->second.second;
+			if( (cpu < 0) || (gpu < 0) )
+				continue;
+			paired = true;
+
+			if(gpu >= cpu)
+				break;
+			c.m_depth = jt->first;
+		}
+
+		if(paired)
+			ret.push_back(c);
+	}
+
+	return ret;
+}
+
+/**
+	@brief Feeds the crossovers measured with uniform inputs to Filter::SetGpuCrossover()
+
+	Filters whose GPU path never won get a crossover of SIZE_MAX, so they always run on the CPU.
+ */
+void FilterBenchmark::ApplyCrossovers()
+{
+	for(auto& c : GetCrossovers())
+	{
+		//Dispatch is by size only, so use the uniform numbers which are what most real inputs look like
+		if(c.m_sparse)
+			continue;
+
+		LogDebug("%s: GPU crossover at %s points\n",
+			c.m_protocol.c_str(),
+			(c.m_depth == FilterBenchmarkCrossover::NEVER) ? "(never)" : to_string(c.m_depth).c_str());
+		Filter::SetGpuCrossover(c.m_protocol, c.m_depth);
+	}
+}
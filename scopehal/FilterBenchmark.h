@@ -0,0 +1,361 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of FilterBenchmark
+	@ingroup core
+ */
+
+#ifndef FilterBenchmark_h
+#define FilterBenchmark_h
+
+#include <random>
+
+class TestWaveformSource;
+
+/**
+	@brief Result of benchmarking one filter at one input size and configuration
+	@ingroup core
+ */
+class FilterBenchmarkResult
+{
+public:
+	FilterBenchmarkResult()
+	: m_depth(0)
+	, m_sparse(false)
+	, m_gpu(false)
+	, m_iterations(0)
+	, m_samplesPerSecond(0)
+	, m_latencyMin(0)
+	, m_latencyP50(0)
+	, m_latencyP90(0)
+	, m_latencyP99(0)
+	, m_latencyMax(0)
+	, m_latencyMAD(0)
+	, m_outputSamples(0)
+	, m_outputBytes(0)
+	, m_uploadBytes(0)
+	, m_readbackBytes(0)
+	{}
+
+	///@brief Protocol name of the filter, as passed to Filter::CreateFilter()
+	std::string m_protocol;
+
+	///@brief Number of points in each input waveform
+	size_t m_depth;
+
+	///@brief True if the inputs were sparse waveforms
+	bool m_sparse;
+
+	///@brief True if g_gpuFilterEnabled was set
+	bool m_gpu;
+
+	///@brief Number of timed refreshes
+	size_t m_iterations;
+
+	///@brief Input points processed per second, averaged over all timed refreshes
+	double m_samplesPerSecond;
+
+	///@brief Fastest refresh, in seconds
+	double m_latencyMin;
+
+	///@brief Median refresh time, in seconds
+	double m_latencyP50;
+
+	///@brief 90th percentile refresh time, in seconds
+	double m_latencyP90;
+
+	///@brief 99th percentile refresh time, in seconds
+	double m_latencyP99;
+
+	///@brief Slowest refresh, in seconds
+	double m_latencyMax;
+
+	///@brief Median absolute deviation of the refresh time from m_latencyP50, in seconds
+	double m_latencyMAD;
+
+	///@brief Total number of points in all output streams after the last refresh
+	size_t m_outputSamples;
+
+	///@brief Approximate memory used by all output streams after the last refresh
+	uint64_t m_outputBytes;
+
+	///@brief Bytes copied from CPU to GPU memory per refresh, on average
+	uint64_t m_uploadBytes;
+
+	///@brief Bytes copied from GPU to CPU memory per refresh, on average
+	uint64_t m_readbackBytes;
+
+	///@brief Reason the filter could not be benchmarked, or empty on success
+	std::string m_error;
+};
+
+/**
+	@brief Comparison of one benchmark configuration against its recorded baseline
+	@ingroup core
+ */
+class FilterBenchmarkComparison
+{
+public:
+	FilterBenchmarkComparison()
+	: m_depth(0)
+	, m_sparse(false)
+	, m_gpu(false)
+	, m_baselineMedian(0)
+	, m_baselineMAD(0)
+	, m_currentMedian(0)
+	, m_currentMAD(0)
+	, m_relativeChange(0)
+	, m_significant(false)
+	, m_regression(false)
+	{}
+
+	///@brief Protocol name of the filter
+	std::string m_protocol;
+
+	///@brief Number of points in each input waveform
+	size_t m_depth;
+
+	///@brief True if the inputs were sparse waveforms
+	bool m_sparse;
+
+	///@brief True if g_gpuFilterEnabled was set
+	bool m_gpu;
+
+	///@brief Median refresh time in the baseline, in seconds
+	double m_baselineMedian;
+
+	///@brief Median absolute deviation of the refresh time in the baseline, in seconds
+	double m_baselineMAD;
+
+	///@brief Median refresh time now, in seconds
+	double m_currentMedian;
+
+	///@brief Median absolute deviation of the refresh time now, in seconds
+	double m_currentMAD;
+
+	///@brief (current - baseline) / baseline median. Positive is slower.
+	double m_relativeChange;
+
+	///@brief True if the change is larger than both the noise of the two runs and the minimum relative change
+	bool m_significant;
+
+	///@brief True if the change is significant and a slowdown
+	bool m_regression;
+};
+
+/**
+	@brief Smallest input size at which a filter's GPU path beats its CPU path
+	@ingroup core
+ */
+class FilterBenchmarkCrossover
+{
+public:
+	///@brief Value of m_depth if the GPU was slower at every size benchmarked
+	static const size_t NEVER = SIZE_MAX;
+
+	FilterBenchmarkCrossover()
+	: m_sparse(false)
+	, m_depth(NEVER)
+	{}
+
+	///@brief Protocol name of the filter
+	std::string m_protocol;
+
+	///@brief True if measured with sparse inputs
+	bool m_sparse;
+
+	///@brief Smallest benchmarked depth from which the GPU path is faster at every larger size, or NEVER
+	size_t m_depth;
+};
+
+/**
+	@brief Benchmarks filters in isolation, with no instrument or GUI
+
+	Each filter is created by protocol name, its inputs are connected to generated waveforms (a noisy sine for analog
+	inputs, and the same thresholded for digital inputs), and it is refreshed repeatedly. This is swept over input
+	sizes, uniform or sparse inputs, and CPU or GPU execution, as configured. Results can be saved as JSON for
+	tracking regressions between versions.
+
+	Inputs whose type the filter rejects in ValidateChannel() for both analog and digital streams make the filter
+	unbenchmarkable; this (and any other failure) is reported in FilterBenchmarkResult::m_error rather than skipped.
+
+	To use the suite as a regression gate, save a baseline with SaveBaseline() on a known good build and on later runs
+	load it and call CompareToBaseline(). Baselines are stored per compute device, so one file can hold results from
+	several machines. A change only counts as significant if it exceeds both a minimum relative change and a multiple
+	of the run-to-run noise (median absolute deviation) of the baseline and current runs, so run enough iterations
+	for the MAD to be meaningful.
+
+	When both CPU and GPU modes are run, GetCrossovers() gives the size from which each filter's GPU path wins.
+	ApplyCrossovers() hands these to Filter::SetGpuCrossover(), so filters which implement both paths pick the faster
+	one for the size of each refresh.
+
+	VulkanInit() must already have been called, and the protocol libraries loaded.
+ */
+class FilterBenchmark
+{
+public:
+	FilterBenchmark();
+	~FilterBenchmark();
+
+	FilterBenchmark(const FilterBenchmark&) =delete;
+	FilterBenchmark& operator=(const FilterBenchmark&) =delete;
+
+	/**
+		@brief Sets the input sizes to sweep
+
+		The default stops at 100M points, since 1G point inputs need several GB of memory per stream.
+	 */
+	void SetDepths(const std::vector<size_t>& depths)
+	{ m_depths = depths; }
+
+	///@brief Sets the number of untimed refreshes run before timing starts, to warm up caches and pipelines
+	void SetWarmupIterations(size_t n)
+	{ m_warmupIterations = n; }
+
+	///@brief Sets the number of timed refreshes for each configuration
+	void SetIterations(size_t n)
+	{ m_iterations = n; }
+
+	///@brief Selects uniform and/or sparse inputs
+	void SetInputTypes(bool uniform, bool sparse)
+	{
+		m_uniform = uniform;
+		m_sparse = sparse;
+	}
+
+	///@brief Selects CPU and/or GPU execution
+	void SetModes(bool cpu, bool gpu)
+	{
+		m_cpu = cpu;
+		m_gpu = gpu;
+	}
+
+	void Run(const std::string& protocol);
+	void RunAll();
+
+	///@brief Gets the results of every configuration run so far
+	const std::vector<FilterBenchmarkResult>& GetResults()
+	{ return m_results; }
+
+	///@brief Discards all results
+	void ClearResults()
+	{ m_results.clear(); }
+
+	std::string ToJSON();
+	bool WriteJSON(const std::string& path);
+
+	bool SaveBaseline(const std::string& path);
+	bool LoadBaseline(const std::string& path);
+	std::vector<FilterBenchmarkComparison> CompareToBaseline();
+	static std::string ComparisonsToJSON(const std::vector<FilterBenchmarkComparison>& comparisons);
+
+	/**
+		@brief Sets how large a change has to be to count as significant
+
+		@param minRelativeChange	Smallest relative change in median refresh time to report (default 5%)
+		@param madMultiple			Change must also exceed this many (normal-scaled) MADs of the noisier run
+	 */
+	void SetSignificanceThresholds(double minRelativeChange, double madMultiple)
+	{
+		m_minRelativeChange = minRelativeChange;
+		m_madMultiple = madMultiple;
+	}
+
+	std::vector<FilterBenchmarkCrossover> GetCrossovers();
+	void ApplyCrossovers();
+
+	static std::string GetDeviceID();
+
+protected:
+	static std::string GetResultKey(const std::string& protocol, size_t depth, bool sparse, bool gpu);
+
+	FilterBenchmarkResult RunOne(const std::string& protocol, size_t depth, bool sparse, bool gpu);
+	bool ConnectInputs(Filter* f);
+	void GenerateInputs(size_t depth, bool sparse);
+	void TouchInputs();
+	static uint64_t GetWaveformBytes(WaveformBase* wfm);
+
+	///@brief Input sizes to sweep
+	std::vector<size_t> m_depths;
+
+	///@brief Untimed refreshes per configuration
+	size_t m_warmupIterations;
+
+	///@brief Timed refreshes per configuration
+	size_t m_iterations;
+
+	///@brief True to benchmark with uniform inputs
+	bool m_uniform;
+
+	///@brief True to benchmark with sparse inputs
+	bool m_sparse;
+
+	///@brief True to benchmark with g_gpuFilterEnabled cleared
+	bool m_cpu;
+
+	///@brief True to benchmark with g_gpuFilterEnabled set
+	bool m_gpu;
+
+	///@brief Results so far
+	std::vector<FilterBenchmarkResult> m_results;
+
+	///@brief Baseline results for this device, indexed by GetResultKey()
+	std::map<std::string, FilterBenchmarkResult> m_baseline;
+
+	///@brief Smallest relative change in median refresh time which counts as significant
+	double m_minRelativeChange;
+
+	///@brief Number of normal-scaled MADs a change must exceed to count as significant
+	double m_madMultiple;
+
+	///@brief Random number generator for test waveforms
+	std::minstd_rand m_rng;
+
+	///@brief Test waveform generator
+	std::unique_ptr<TestWaveformSource> m_source;
+
+	///@brief Channel providing the analog input stream
+	std::unique_ptr<OscilloscopeChannel> m_analogChannel;
+
+	///@brief Channel providing the digital input stream
+	std::unique_ptr<OscilloscopeChannel> m_digitalChannel;
+
+	///@brief Queue used for waveform generation and filter refreshes
+	std::shared_ptr<QueueHandle> m_queue;
+
+	///@brief Command pool from which m_cmdBuf was allocated
+	std::unique_ptr<vk::raii::CommandPool> m_pool;
+
+	///@brief Command buffer for waveform generation and filter refreshes
+	std::unique_ptr<vk::raii::CommandBuffer> m_cmdBuf;
+};
+
+#endif
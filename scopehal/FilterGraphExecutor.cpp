@@ -42,160 +42,1511 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Construction / destruction
 
+/**
+	@brief Creates the executor and starts its worker threads
+
+	@param numThreads	Number of worker threads. If zero, one thread is created per hardware thread, but only
+						INITIAL_WORKERS of them are active at first, and automatic tuning is enabled.
+ */
 FilterGraphExecutor::FilterGraphExecutor(size_t numThreads)
-	: m_allWorkersComplete(true)
+	: m_incremental(true)
+	, m_fusion(true)
+	, m_profiling(false)
+	, m_lazy(false)
+	, m_lastRefreshedNodeCount(0)
+	, m_nextSequence(1)
+	, m_completedSequence(0)
+	, m_pipelineDepth(2)
+	, m_readyQueueCapacity(0)
+	, m_tasksReady(0)
+	, m_searchingWorkers(0)
+	, m_idleWorkers(0)
+	, m_parkedTaskCount(0)
 	, m_terminating(false)
+	, m_autoTuning(numThreads == 0)
+	, m_activeWorkers(numThreads)
+	, m_gpuLimit(numThreads)
+	, m_gpuTasksRunning(0)
+	, m_peakGpuTasks(0)
+	, m_throttleEvents(0)
+	, m_gpuLimitChosen(numThreads != 0)
 {
+	//If not told otherwise, have a thread per hardware thread, but start out with no more workers than a laptop has
+	//cores. The tuner brings in the rest if the graph is wide enough to keep them busy.
+	if(numThreads == 0)
+	{
+		numThreads = max(1u, thread::hardware_concurrency());
+		m_activeWorkers = min(numThreads, (size_t)INITIAL_WORKERS);
+		m_gpuLimit = 2;
+	}
+
+	//Create the ready queues before any threads start so they never see a partially constructed vector
+	for(size_t i=0; i<numThreads; i++)
+		m_readyQueues.push_back(make_unique<WorkStealingDeque<Task*>>());
+
+	//Spread the workers across NUMA nodes, if there's more than one
+	size_t nodes = NumaTopology::GetNodeCount();
+	for(size_t i=0; i<numThreads; i++)
+		m_workerNodes.push_back(NumaTopology::IsNuma() ? static_cast<int>(i % nodes) : -1);
+	if(NumaTopology::IsNuma())
+	{
+		for(size_t i=0; i<nodes; i++)
+			m_nodeQueues.push_back(make_unique<NodeQueue>());
+	}
+
+	//Steal from neighbors on the same node before going across the interconnect
+	m_stealOrder.resize(numThreads);
+	for(size_t i=0; i<numThreads; i++)
+	{
+		for(int sameNode=1; sameNode>=0; sameNode--)
+		{
+			for(size_t j=1; j<numThreads; j++)
+			{
+				size_t victim = (i + j) % numThreads;
+				if( (m_workerNodes[victim] == m_workerNodes[i]) == (sameNode != 0) )
+					m_stealOrder[i].push_back(victim);
+			}
+		}
+	}
+
 	//Create our thread pool
 	for(size_t i=0; i<numThreads; i++)
 		m_threads.push_back(make_unique<thread>(&FilterGraphExecutor::ExecutorThread, this, i));
 }
 
-FilterGraphExecutor::~FilterGraphExecutor()
+FilterGraphExecutor::~FilterGraphExecutor()
+{
+	//Let anything still in flight finish
+	Flush();
+
+	//Terminate worker threads
+	{
+		lock_guard<mutex> lock(m_idleCvarMutex);
+		m_terminating = true;
+	}
+	m_idleCvar.notify_all();
+	m_inactiveCvar.notify_all();
+	for(auto& t : m_threads)
+		t->join();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Topology management
+
+/**
+	@brief Checks if the cached topology is still valid for a given set of nodes
+
+	This is O(N + E) but, unlike a full rebuild, does not allocate.
+ */
+bool FilterGraphExecutor::IsTopologyCurrent(const set<FlowGraphNode*>& nodes)
+{
+	if(nodes != m_topology.m_nodeSet)
+		return false;
+
+	for(size_t i=0; i<m_topology.m_nodes.size(); i++)
+	{
+		auto f = m_topology.m_nodes[i];
+		auto& inputs = m_topology.m_inputs[i];
+		if(f->GetInputCount() != inputs.size())
+			return false;
+		for(size_t j=0; j<inputs.size(); j++)
+		{
+			if(static_cast<FlowGraphNode*>(f->GetInput(j).m_channel) != inputs[j])
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+	@brief Recomputes the dependency graph for a set of nodes
+
+	Nodes are sorted topologically (Kahn's algorithm). Any nodes which are part of a dependency cycle can never
+	become runnable, so they are dropped from the topology with a warning rather than deadlocking the executor.
+
+	Must only be called when nothing is in flight.
+ */
+void FilterGraphExecutor::UpdateTopology(const set<FlowGraphNode*>& nodes)
+{
+	m_topology = Topology();
+	m_topology.m_nodeSet = nodes;
+	m_topology.m_nodeSet.erase(nullptr);	//don't crash if a null filter somehow ended up in the list
+
+	//Assign provisional indexes and record input connections
+	vector<FlowGraphNode*> unsorted(m_topology.m_nodeSet.begin(), m_topology.m_nodeSet.end());
+	map<FlowGraphNode*, size_t> indexes;
+	for(size_t i=0; i<unsorted.size(); i++)
+		indexes[unsorted[i]] = i;
+
+	vector< vector<FlowGraphNode*> > inputs(unsorted.size());
+	vector< vector<uint8_t> > internal(unsorted.size());
+	vector< set<size_t> > upstream(unsorted.size());
+	vector< vector<size_t> > consumers(unsorted.size());
+	for(size_t i=0; i<unsorted.size(); i++)
+	{
+		auto f = unsorted[i];
+		for(size_t j=0; j<f->GetInputCount(); j++)
+		{
+			FlowGraphNode* in = f->GetInput(j).m_channel;
+			inputs[i].push_back(in);
+
+			auto it = indexes.find(in);
+			internal[i].push_back(it != indexes.end());
+			if( (it != indexes.end()) && (it->second != i) && upstream[i].emplace(it->second).second )
+				consumers[it->second].push_back(i);
+		}
+	}
+
+	//Topological sort
+	vector<uint32_t> pending(unsorted.size());
+	vector<size_t> order;
+	order.reserve(unsorted.size());
+	for(size_t i=0; i<unsorted.size(); i++)
+	{
+		pending[i] = upstream[i].size();
+		if(pending[i] == 0)
+			order.push_back(i);
+	}
+	for(size_t i=0; i<order.size(); i++)
+	{
+		for(auto c : consumers[order[i]])
+		{
+			if(--pending[c] == 0)
+				order.push_back(c);
+		}
+	}
+
+	if(order.size() != unsorted.size())
+	{
+		LogWarning("FilterGraphExecutor: %zu nodes are part of a dependency cycle and will not be evaluated\n",
+			unsorted.size() - order.size());
+	}
+
+	//Renumber everything in topological order
+	vector<size_t> newIndex(unsorted.size(), SIZE_MAX);
+	for(size_t i=0; i<order.size(); i++)
+		newIndex[order[i]] = i;
+
+	size_t n = order.size();
+	m_topology.m_nodes.resize(n);
+	m_topology.m_inputs.resize(n);
+	m_topology.m_inputIsInternal.resize(n);
+	m_topology.m_consumers.resize(n);
+	m_topology.m_producers.resize(n);
+	m_topology.m_channels.resize(n);
+	m_topology.m_readsSources.resize(n);
+	for(size_t i=0; i<n; i++)
+	{
+		size_t old = order[i];
+		m_topology.m_nodes[i] = unsorted[old];
+		m_topology.m_indexes[unsorted[old]] = i;
+		m_topology.m_channels[i] = dynamic_cast<InstrumentChannel*>(unsorted[old]);
+		m_topology.m_inputs[i] = std::move(inputs[old]);
+		m_topology.m_inputIsInternal[i] = std::move(internal[old]);
+
+		m_topology.m_readsSources[i] = 0;
+		for(size_t j=0; j<m_topology.m_inputs[i].size(); j++)
+		{
+			if(m_topology.m_inputs[i][j] && !m_topology.m_inputIsInternal[i][j])
+				m_topology.m_readsSources[i] = 1;
+		}
+
+		for(auto c : consumers[old])
+		{
+			if(newIndex[c] != SIZE_MAX)
+				m_topology.m_consumers[i].push_back(newIndex[c]);
+		}
+		for(auto p : upstream[old])
+			m_topology.m_producers[i].push_back(newIndex[p]);
+	}
+
+	//Forget everything we knew about the previous topology, so every node runs at least once
+	m_dirty.assign(n, 1);
+	m_live.assign(n, 1);
+	m_demand.assign(n, vector<uint8_t>());
+	m_lastTask.assign(n, nullptr);
+	m_nodeSequence = make_unique<atomic<uint64_t>[]>(n);
+	m_gpuPoints.assign(n, vector<QueueTimelinePoint>());
+	m_priority.assign(n, 0);
+
+	//Until a node has run, guess whether it uses the GPU from where it wants its inputs
+	m_nodeUsesGpu = make_unique<atomic<uint8_t>[]>(n);
+	for(size_t i=0; i<n; i++)
+		m_nodeUsesGpu[i] = (m_topology.m_nodes[i]->GetInputLocation() == Filter::LOC_GPU);
+
+	//Seed the cost estimates from whatever we measured under previous topologies
+	m_nodeCost.assign(n, 0);
+	{
+		lock_guard<mutex> plock(m_perfStatsMutex);
+		for(size_t i=0; i<n; i++)
+		{
+			auto it = m_lastExecutionTime.find(m_topology.m_nodes[i]);
+			if(it != m_lastExecutionTime.end())
+				m_nodeCost[i] = it->second;
+		}
+	}
+	m_nodeBestCost = m_nodeCost;
+
+	lock_guard<mutex> lock(m_stateMutex);
+	m_hasRun.assign(n, 0);
+	m_lastInputState.assign(n, vector<InputState>());
+	m_lastOutputState.assign(n, vector<WaveformCacheKey>());
+	m_lastOutputHash.assign(n, vector<uint64_t>());
+	m_lastConfigRevision.assign(n, 0);
+	m_lastDemand.assign(n, vector<uint8_t>());
+}
+
+/**
+	@brief Makes sure the ready queues can hold every task which might be in flight at once
+
+	Must only be called when nothing is in flight.
+ */
+void FilterGraphExecutor::ResizeReadyQueues()
+{
+	size_t capacity = max((size_t)1, m_topology.m_nodes.size() * m_pipelineDepth);
+	if(capacity <= m_readyQueueCapacity)
+		return;
+
+	//Wait for any worker which raced with the completion of the last task to stop looking at the queues
+	while(m_searchingWorkers.load() != 0)
+		this_thread::yield();
+
+	for(auto& q : m_readyQueues)
+		q->Reset(capacity);
+	m_readyQueueCapacity = capacity;
+}
+
+/**
+	@brief Gets the sequence number of the most recent generation in which a node was refreshed
+
+	@param node	The node to look up
+
+	@return	Sequence number, or zero if the node is not part of the current graph or has not yet been refreshed
+ */
+uint64_t FilterGraphExecutor::GetNodeSequence(FlowGraphNode* node)
+{
+	lock_guard<recursive_mutex> lock(m_submitMutex);
+
+	auto it = m_topology.m_indexes.find(node);
+	if(it == m_topology.m_indexes.end())
+		return 0;
+	return m_nodeSequence[it->second];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Incremental evaluation
+
+/**
+	@brief Checks if anything a node depends on has changed since it was last refreshed
+
+	This only looks at the node itself; staleness of upstream nodes is propagated by FindDirtyNodes().
+
+	Assumes m_stateMutex is locked.
+ */
+bool FilterGraphExecutor::IsNodeStale(size_t node)
+{
+	//If the node is still in flight from an earlier generation it will read the latest data from its in-graph
+	//producers when it runs (and it cannot be reading sources, since those were released before we were called),
+	//so it only needs to run again if one of its producers does.
+	auto last = m_lastTask[node];
+	if(last && !last->m_complete)
+		return false;
+
+	auto f = m_topology.m_nodes[node];
+
+	if(!m_hasRun[node] || !f->IsRefreshSkippable())
+		return true;
+	if(f->GetConfigRevision() != m_lastConfigRevision[node])
+		return true;
+
+	//Streams which were skipped last time, but are wanted now, have to be computed
+	auto& demand = m_demand[node];
+	auto& lastDemand = m_lastDemand[node];
+	if(!lastDemand.empty())
+	{
+		for(size_t i=0; i<lastDemand.size(); i++)
+		{
+			if(!lastDemand[i] && (demand.empty() || ((i < demand.size()) && demand[i])))
+				return true;
+		}
+	}
+
+	//Check every input edge
+	auto& inputs = m_lastInputState[node];
+	for(size_t i=0; i<inputs.size(); i++)
+	{
+		if(InputState(f->GetInput(i)) != inputs[i])
+			return true;
+	}
+
+	//If something else replaced or modified our output since we last ran, we need to regenerate it
+	auto chan = m_topology.m_channels[node];
+	if(chan)
+	{
+		auto& outputs = m_lastOutputState[node];
+		if(outputs.size() != chan->GetStreamCount())
+			return true;
+		for(size_t i=0; i<outputs.size(); i++)
+		{
+			auto data = chan->GetData(i);
+			if( (data == nullptr) ? (outputs[i].m_wfm != nullptr) : (outputs[i] != data) )
+				return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+	@brief Determines which output streams of each node are used by anything in the generation being submitted
+
+	A stream is demanded if it has a consumer outside the graph (see Filter::AddStreamConsumer()), or if a live node
+	inside the graph reads it. A node is live if any of its streams is demanded, or if it has no output streams at all
+	(exports, sinks etc). Nodes which aren't filters are always live and have all of their streams demanded. Since
+	every consumer comes after its producers in m_topology.m_nodes, a single backward sweep suffices.
+
+	If lazy evaluation is disabled every node is live and every stream is demanded.
+ */
+void FilterGraphExecutor::FindDemandedStreams()
+{
+	size_t n = m_topology.m_nodes.size();
+	if(!m_lazy)
+	{
+		for(size_t i=0; i<n; i++)
+		{
+			m_live[i] = 1;
+			m_demand[i].clear();
+		}
+		return;
+	}
+
+	//Start with only the external consumers
+	for(size_t i=0; i<n; i++)
+	{
+		auto& demand = m_demand[i];
+		auto chan = m_topology.m_channels[i];
+		auto filter = dynamic_cast<Filter*>(m_topology.m_nodes[i]);
+		if(!filter)
+		{
+			demand.assign(chan ? chan->GetStreamCount() : 0, 1);
+			continue;
+		}
+
+		demand.resize(filter->GetStreamCount());
+		for(size_t j=0; j<demand.size(); j++)
+			demand[j] = filter->HasStreamConsumers(j);
+	}
+
+	//Then pull demand upstream from every live node
+	for(size_t i=n; i>0; i--)
+	{
+		size_t node = i-1;
+		auto& demand = m_demand[node];
+		bool live = demand.empty();
+		for(auto d : demand)
+			live |= (d != 0);
+		m_live[node] = live;
+		if(!live)
+			continue;
+
+		auto f = m_topology.m_nodes[node];
+		for(size_t j=0; j<f->GetInputCount(); j++)
+		{
+			if(!m_topology.m_inputIsInternal[node][j])
+				continue;
+
+			auto in = f->GetInput(j);
+			auto& pdemand = m_demand[m_topology.m_indexes[in.m_channel]];
+			if(in.m_stream < pdemand.size())
+				pdemand[in.m_stream] = 1;
+		}
+	}
+}
+
+/**
+	@brief Determines which nodes need to be refreshed in the generation being submitted
+
+	A node is dirty if it is stale, or if anything upstream of it is dirty. Since m_topology.m_nodes is in
+	topological order, a single forward sweep suffices. Nodes already known to be dirty from an upstream node are
+	not checked at all.
+
+	Nodes which are not live (see FindDemandedStreams()) are never dirty, since nothing would look at their output.
+	Only other dead nodes can consume a dead node, so skipping them never leaves a live node with stale input.
+
+	@return The number of dirty nodes
+ */
+size_t FilterGraphExecutor::FindDirtyNodes()
+{
+	size_t n = m_topology.m_nodes.size();
+
+	bool incremental = m_incremental;
+	for(size_t i=0; i<n; i++)
+		m_dirty[i] = !incremental;
+
+	FindDemandedStreams();
+
+	lock_guard<mutex> lock(m_stateMutex);
+
+	size_t ndirty = 0;
+	for(size_t i=0; i<n; i++)
+	{
+		if(!m_live[i])
+		{
+			m_dirty[i] = 0;
+			continue;
+		}
+
+		if(!m_dirty[i] && !IsNodeStale(i))
+			continue;
+
+		m_dirty[i] = 1;
+		ndirty ++;
+		for(auto c : m_topology.m_consumers[i])
+			m_dirty[c] = 1;
+	}
+
+	return ndirty;
+}
+
+/**
+	@brief Records the input, output and configuration state of a node after it has been refreshed
+
+	@param node				Index of the node
+	@param configRevision	Configuration revision of the node as of the start of the refresh
+	@param demand			Streams which were demanded by the refresh (empty if all of them)
+ */
+void FilterGraphExecutor::SaveNodeState(size_t node, uint64_t configRevision, const vector<uint8_t>& demand)
+{
+	auto f = m_topology.m_nodes[node];
+
+	lock_guard<mutex> lock(m_stateMutex);
+
+	auto& inputs = m_lastInputState[node];
+	inputs.resize(f->GetInputCount());
+	for(size_t i=0; i<inputs.size(); i++)
+		inputs[i] = InputState(f->GetInput(i));
+
+	auto chan = m_topology.m_channels[node];
+	if(chan)
+	{
+		auto& outputs = m_lastOutputState[node];
+		outputs.resize(chan->GetStreamCount());
+		for(size_t i=0; i<outputs.size(); i++)
+		{
+			auto data = chan->GetData(i);
+			outputs[i] = data ? WaveformCacheKey(data) : WaveformCacheKey();
+		}
+	}
+
+	m_lastConfigRevision[node] = configRevision;
+	m_lastDemand[node] = demand;
+	m_hasRun[node] = 1;
+}
+
+/**
+	@brief Undoes the revision bump of any output which was regenerated with exactly the same content as last time
+
+	Must be called after the node has been refreshed and before SaveNodeState(). Only outputs which are still the
+	same waveform object as last time are considered, so a node which allocates a fresh waveform per refresh is
+	never suppressed.
+
+	@param node	Index of the node
+ */
+void FilterGraphExecutor::SuppressUnchangedOutputs(size_t node)
+{
+	auto chan = m_topology.m_channels[node];
+	if(!chan)
+		return;
+
+	//Hash outside the lock, this is a full pass over the data
+	size_t nstreams = chan->GetStreamCount();
+	vector<uint64_t> hashes(nstreams, 0);
+	for(size_t i=0; i<nstreams; i++)
+	{
+		auto data = chan->GetData(i);
+		if(data && !data->GetContentHash(hashes[i]))
+			hashes[i] = 0;
+	}
+
+	lock_guard<mutex> lock(m_stateMutex);
+
+	auto& outputs = m_lastOutputState[node];
+	auto& lastHashes = m_lastOutputHash[node];
+	if(m_hasRun[node] && (lastHashes.size() == nstreams) && (outputs.size() == nstreams))
+	{
+		for(size_t i=0; i<nstreams; i++)
+		{
+			auto data = chan->GetData(i);
+			if(data && hashes[i] && (hashes[i] == lastHashes[i]) && (outputs[i].m_wfm == data))
+				data->m_revision = outputs[i].m_rev;
+		}
+	}
+	lastHashes = hashes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Submission API
+
+/**
+	@brief Evaluates the filter graph, blocking until execution has completed
+
+	Any previously submitted pipelined generations are also complete when this function returns.
+ */
+void FilterGraphExecutor::RunBlocking(const set<FlowGraphNode*>& nodes)
+{
+	//Nothing to do if we have no nodes to run
+	if(nodes.empty())
+		return;
+
+	lock_guard<recursive_mutex> lock(m_submitMutex);
+	WaitForSequence(Submit(nodes));
+}
+
+/**
+	@brief Starts evaluating the filter graph without waiting for the whole graph to finish
+
+	Blocks until no more than GetPipelineDepth() generations are in flight, submits a new generation, then blocks
+	until every node of the new generation which reads data from outside the graph (instrument channels etc.) has
+	finished. At that point it is safe for the caller to load the next acquisition into those channels and call
+	RunPipelined() again, while the rest of this generation continues in the background.
+
+	@param nodes	The nodes to evaluate
+
+	@return	Sequence number of the new generation, which may be passed to WaitForSequence()
+ */
+uint64_t FilterGraphExecutor::RunPipelined(const set<FlowGraphNode*>& nodes)
+{
+	lock_guard<recursive_mutex> lock(m_submitMutex);
+
+	uint64_t seq = Submit(nodes);
+
+	//Find the new generation (if nothing was dirty, none was created)
+	Generation* gen = nullptr;
+	if(!m_generations.empty() && (m_generations.back()->m_sequence == seq))
+		gen = m_generations.back().get();
+
+	if(gen)
+	{
+		unique_lock<mutex> clock(m_completionCvarMutex);
+		m_completionCvar.wait(clock, [gen]{ return gen->m_sourceReadersRemaining.load() == 0; });
+	}
+
+	RetireGenerations();
+	return seq;
+}
+
+/**
+	@brief Blocks until a generation, and every generation before it, has completed
+
+	@param sequence	Sequence number returned by RunPipelined()
+ */
+void FilterGraphExecutor::WaitForSequence(uint64_t sequence)
+{
+	lock_guard<recursive_mutex> lock(m_submitMutex);
+
+	{
+		unique_lock<mutex> clock(m_completionCvarMutex);
+		m_completionCvar.wait(clock, [this, sequence]
+			{
+				for(auto& gen : m_generations)
+				{
+					if( (gen->m_sequence <= sequence) && (gen->m_tasksRemaining.load() != 0) )
+						return false;
+				}
+				return true;
+			});
+	}
+
+	RetireGenerations();
+}
+
+/**
+	@brief Blocks until every submitted generation has completed
+ */
+void FilterGraphExecutor::Flush()
+{
+	lock_guard<recursive_mutex> lock(m_submitMutex);
+	WaitForSequence(UINT64_MAX);
+}
+
+/**
+	@brief Sets the maximum number of generations which may be in flight at once
+
+	A depth of 1 disables pipelining: RunPipelined() will not submit a new generation until the previous one has
+	completely finished.
+ */
+void FilterGraphExecutor::SetPipelineDepth(size_t depth)
+{
+	lock_guard<recursive_mutex> lock(m_submitMutex);
+
+	Flush();
+	m_pipelineDepth = max((size_t)1, depth);
+	ResizeReadyQueues();
+}
+
+/**
+	@brief Returns the number of generations which have not yet completed
+
+	Must be called from the submitting thread.
+ */
+size_t FilterGraphExecutor::GetGenerationsInFlight()
+{
+	size_t count = 0;
+	for(auto& gen : m_generations)
+	{
+		if(gen->m_tasksRemaining.load() != 0)
+			count ++;
+	}
+	return count;
+}
+
+/**
+	@brief Creates and releases the tasks for a new generation
+
+	Every dirty node gets one task, which depends on:
+	* the most recent task of each of its in-graph producers (the data it reads)
+	* the most recent task of the node itself (refreshes of one node never overlap)
+	* the most recent task of each of its consumers (they must finish reading our previous output before we
+	  overwrite it)
+
+	Assumes m_submitMutex is locked.
+
+	@return Sequence number of the new generation
+ */
+uint64_t FilterGraphExecutor::Submit(const set<FlowGraphNode*>& nodes)
+{
+	//Topology changes require the pipeline to drain, since in-flight tasks refer to node indexes
+	if(!IsTopologyCurrent(nodes))
+	{
+		Flush();
+		UpdateTopology(nodes);
+		ResizeReadyQueues();
+	}
+
+	//Wait for a free pipeline slot
+	{
+		unique_lock<mutex> clock(m_completionCvarMutex);
+		m_completionCvar.wait(clock, [this]{ return GetGenerationsInFlight() < m_pipelineDepth; });
+	}
+	RetireGenerations();
+
+	uint64_t seq = m_nextSequence ++;
+
+	//Figure out what actually needs to run
+	size_t n = m_topology.m_nodes.size();
+	size_t ndirty = 0;
+	if(n != 0)
+		ndirty = FindDirtyNodes();
+	m_lastRefreshedNodeCount = ndirty;
+	if(ndirty == 0)
+	{
+		RetireGenerations();
+		return seq;
+	}
+
+	Filter::ClearAnalysisCache();
+	UpdatePriorities();
+	ExpandRawInputs();
+
+	auto gen = make_unique<Generation>(seq, ndirty);
+	size_t k = 0;
+	size_t nsources = 0;
+	for(size_t i=0; i<n; i++)
+	{
+		if(!m_dirty[i])
+			continue;
+
+		auto task = &gen->m_tasks[k++];
+		task->m_node = i;
+		task->m_generation = gen.get();
+		task->m_readsSources = m_topology.m_readsSources[i];
+		task->m_priority = m_priority[i];
+		task->m_demand = m_demand[i];
+		if(task->m_readsSources)
+			nsources ++;
+
+		for(auto p : m_topology.m_producers[i])
+			AddDependency(task, m_lastTask[p]);
+		AddDependency(task, m_lastTask[i]);
+		for(auto c : m_topology.m_consumers[i])
+			AddDependency(task, m_lastTask[c]);
+
+		PlanFusion(task);
+		m_lastTask[i] = task;
+	}
+	gen->m_sourceReadersRemaining = nsources;
+
+	auto pgen = gen.get();
+	m_generations.push_back(std::move(gen));
+
+	//Drop the submission reference from every task; anything with no outstanding dependencies can start now,
+	//most critical first
+	vector<Task*> runnable;
+	for(size_t j=0; j<pgen->m_taskCount; j++)
+	{
+		auto task = &pgen->m_tasks[j];
+		if(task->m_pending.fetch_sub(1, memory_order_acq_rel) == 1)
+			runnable.push_back(task);
+	}
+	sort(runnable.begin(), runnable.end(), [](Task* a, Task* b){ return a->m_priority > b->m_priority; });
+	for(auto task : runnable)
+		InjectRunnable(task);
+	WakeIdleWorker(true);
+
+	return seq;
+}
+
+/**
+	@brief Converts raw ADC codes (see RawAnalogSamples) on the inputs of dirty nodes which can't read them as is
+
+	This is done before any task of the generation starts, since a waveform may feed several nodes running in
+	parallel and some of them may be reading the raw codes. Changing which nodes consume a waveform changes the
+	topology, which drains the pipeline first, so no older generation can be reading codes freed here.
+ */
+void FilterGraphExecutor::ExpandRawInputs()
+{
+	for(size_t i=0; i<m_topology.m_nodes.size(); i++)
+	{
+		if(!m_dirty[i])
+			continue;
+
+		auto node = m_topology.m_nodes[i];
+		for(size_t j=0; j<node->GetInputCount(); j++)
+		{
+			auto data = node->GetInput(j).GetData();
+			if(data && data->HasRawSamples() && !node->AcceptsRawSamples(j))
+				data->ExpandRawSamples();
+		}
+	}
+}
+
+/**
+	@brief Makes one task wait for another, if the other has not already completed
+
+	@param task			The task which must wait
+	@param dependency	The task to wait for (may be null)
+
+	@return True if a dependency was added
+ */
+bool FilterGraphExecutor::AddDependency(Task* task, Task* dependency)
+{
+	if(dependency == nullptr)
+		return false;
+
+	lock_guard<mutex> lock(dependency->m_mutex);
+	if(dependency->m_complete)
+		return false;
+
+	dependency->m_dependents.push_back(task);
+	task->m_pending.fetch_add(1, memory_order_relaxed);
+	return true;
+}
+
+/**
+	@brief Links a task into its producer's elementwise chain, if the producer's task could evaluate it too
+
+	This is only possible if the node's sole in-graph producer is refreshed in the same generation, and is not already
+	chained to another consumer. Whether the filters can actually be fused is only known once they run (see
+	RunFusedChain()), so this just records the possibility.
+
+	Any task in the chain upstream of the node may end up writing its output, so they all have to wait for the node's
+	previous refresh, and every consumer of it, to finish.
+
+	Must be called before the task is recorded as m_lastTask for its node.
+ */
+void FilterGraphExecutor::PlanFusion(Task* task)
+{
+	size_t node = task->m_node;
+	auto& producers = m_topology.m_producers[node];
+	if(!m_fusion || (producers.size() != 1) || !m_dirty[producers[0]])
+		return;
+
+	//Sources are only guaranteed stable while the generation's source readers are running, so a task which doesn't
+	//read sources itself can't read them on our behalf
+	auto prev = m_lastTask[producers[0]];
+	if(prev->m_fuseNext || (task->m_readsSources && !prev->m_readsSources))
+		return;
+
+	//No point chaining more nodes than fit in one pass
+	size_t depth = 1;
+	for(auto t = prev->m_fusePrev; t != nullptr; t = t->m_fusePrev)
+		depth ++;
+	if(depth >= ElementwiseChainConstants::MAX_OPS)
+		return;
+
+	prev->m_fuseNext = task;
+	task->m_fusePrev = prev;
+	for(auto t = prev; t != nullptr; t = t->m_fusePrev)
+	{
+		AddDependency(t, m_lastTask[node]);
+		for(auto c : m_topology.m_consumers[node])
+			AddDependency(t, m_lastTask[c]);
+	}
+}
+
+/**
+	@brief Computes the critical path length from each dirty node to the end of the generation being submitted
+
+	This is the node's own estimated cost plus the largest priority of any dirty consumer, computed in reverse
+	topological order. One femtosecond is added per node so that, before any run times have been measured, longer
+	chains still go first.
+ */
+void FilterGraphExecutor::UpdatePriorities()
+{
+	for(size_t i=m_topology.m_nodes.size(); i>0; i--)
+	{
+		size_t node = i-1;
+		if(!m_dirty[node])
+			continue;
+
+		int64_t downstream = 0;
+		for(auto c : m_topology.m_consumers[node])
+		{
+			if(m_dirty[c])
+				downstream = max(downstream, m_priority[c]);
+		}
+		m_priority[node] = m_nodeCost[node] + 1 + downstream;
+	}
+}
+
+/**
+	@brief Frees completed generations, oldest first, and folds their run times into the performance statistics
+
+	Must be called from the submitting thread.
+ */
+void FilterGraphExecutor::RetireGenerations()
+{
+	bool retired = false;
+	while(!m_generations.empty() && (m_generations.front()->m_tasksRemaining.load(memory_order_acquire) == 0) )
+	{
+		auto& gen = m_generations.front();
+
+		{
+			lock_guard<mutex> lock(m_perfStatsMutex);
+
+			//For now, fixed half life exponential moving average
+			float halflife = 8;
+			float decay = 1 / pow(2, 1/halflife);
+
+			//TODO: staleness or removing of some sort for old entries?
+
+			//Add the new data (nodes which were skipped keep their previous value)
+			for(size_t i=0; i<gen->m_taskCount; i++)
+			{
+				auto& task = gen->m_tasks[i];
+				auto f = m_topology.m_nodes[task.m_node];
+				m_lastExecutionTime[f] = (m_lastExecutionTime[f] * decay) + (task.m_executionTime * (1-decay));
+				m_nodeCost[task.m_node] = m_lastExecutionTime[f];
+			}
+		}
+
+		UpdateProfile(gen.get());
+		RecordTuningSample(gen.get());
+
+		for(size_t i=0; i<gen->m_taskCount; i++)
+		{
+			auto task = &gen->m_tasks[i];
+			if(m_lastTask[task->m_node] == task)
+				m_lastTask[task->m_node] = nullptr;
+		}
+
+		m_generations.pop_front();
+		retired = true;
+	}
+
+	if(m_generations.empty())
+		m_completedSequence = m_nextSequence - 1;
+	else
+		m_completedSequence = m_generations.front()->m_sequence - 1;
+
+	//Good time to make space in VRAM if we're running low: whatever we just retired is idle now
+	if(retired && g_gpuMemoryBudget)
+		g_gpuMemoryBudget->Poll();
+
+	if(retired)
+		Retune();
+}
+
+/**
+	@brief Reads back the GPU timestamps of a completed generation and adds its tasks to the profile
+
+	Timestamp pairs are always resolved (and so returned to their pools), even if profiling has since been disabled.
+ */
+void FilterGraphExecutor::UpdateProfile(Generation* gen)
+{
+	for(size_t i=0; i<gen->m_taskCount; i++)
+	{
+		auto& task = gen->m_tasks[i];
+		if(!task.m_profiled)
+			continue;
+
+		auto f = m_topology.m_nodes[task.m_node];
+		auto chan = m_topology.m_channels[task.m_node];
+		string name = chan ? chan->GetDisplayName() : string();
+
+		double gpuTime = 0;
+		size_t ntimed = 0;
+		for(auto pair : task.m_timestampPairs)
+		{
+			double start;
+			double duration;
+			if(!task.m_timestampPool->Resolve(pair, start, duration))
+				continue;
+
+			gpuTime += duration;
+			ntimed ++;
+			PerformanceTrace::AddEvent(name, "gpu", PerformanceTrace::PID_GPU, task.m_traceTrack, start, duration);
+		}
+
+		lock_guard<mutex> lock(m_perfStatsMutex);
+		auto& profile = m_profile[f];
+		profile.m_refreshCount ++;
+		profile.m_cpuTime += task.m_executionTime;
+		profile.m_gpuTime += gpuTime * FS_PER_SECOND;
+		profile.m_timedSubmissions += ntimed;
+		profile.m_uploadBytes += task.m_uploadBytes;
+		profile.m_readbackBytes += task.m_readbackBytes;
+		profile.m_pipelineStallTime += task.m_pipelineStallTime * FS_PER_SECOND;
+		profile.m_gpuThrottleTime += task.m_throttleTime * FS_PER_SECOND;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scheduling
+
+/**
+	@brief Gets the next task available to run, without blocking
+
+	Tasks are taken from the calling thread's own queue first (most recently readied first, for cache locality),
+	then from tasks queued for the thread's NUMA node, then from tasks submitted by the client thread, then stolen
+	from the other threads' queues (same node first). Tasks queued for other NUMA nodes are only taken as a last
+	resort, so a busy node never starves work it could have helped with.
+
+	@param i		Index of the calling worker thread
+	@param task		The task to run
+
+	@return			True if a task was found, false if nothing is currently runnable
+ */
+bool FilterGraphExecutor::GetNextRunnableTask(size_t i, Task*& task)
+{
+	m_searchingWorkers.fetch_add(1);
+	if(m_tasksReady.load() == 0)
+	{
+		m_searchingWorkers.fetch_sub(1);
+		return false;
+	}
+
+	bool found = m_readyQueues[i]->Pop(task);
+
+	//Pop the oldest task from a node queue, if it has any
+	auto popNode = [&](size_t node)
+	{
+		auto& q = *m_nodeQueues[node];
+		lock_guard<mutex> lock(q.m_mutex);
+		if(q.m_tasks.empty())
+			return false;
+		task = q.m_tasks.front();
+		q.m_tasks.pop_front();
+		return true;
+	};
+
+	if(!found && !m_nodeQueues.empty())
+		found = popNode(m_workerNodes[i]);
+
+	if(!found)
+	{
+		unique_lock<mutex> lock(m_injectedTasksMutex, try_to_lock);
+		if(lock.owns_lock() && !m_injectedTasks.empty())
+		{
+			task = m_injectedTasks.front();
+			m_injectedTasks.pop_front();
+			found = true;
+		}
+	}
+
+	for(size_t j=0; !found && (j < m_stealOrder[i].size()); j++)
+		found = m_readyQueues[m_stealOrder[i][j]]->Steal(task);
+
+	for(size_t j=1; !found && (j < m_nodeQueues.size()); j++)
+		found = popNode( (m_workerNodes[i] + j) % m_nodeQueues.size());
+
+	if(found)
+		m_tasksReady.fetch_sub(1);
+	m_searchingWorkers.fetch_sub(1);
+	return found;
+}
+
+/**
+	@brief Adds a newly runnable task to the calling worker's queue and wakes an idle worker if there is one
+ */
+void FilterGraphExecutor::PushRunnable(size_t i, Task* task)
+{
+	m_readyQueues[i]->Push(task);
+	m_tasksReady.fetch_add(1);
+	WakeIdleWorker(false);
+}
+
+/**
+	@brief Adds a runnable task from a thread which does not own a ready queue
+ */
+void FilterGraphExecutor::InjectRunnable(Task* task)
+{
+	lock_guard<mutex> lock(m_injectedTasksMutex);
+	m_injectedTasks.push_back(task);
+	m_tasksReady.fetch_add(1);
+}
+
+/**
+	@brief Queues a runnable task for the workers of one NUMA node
+
+	We can't tell which idle worker a notify_one() would wake, so wake all of them: the ones on other nodes find
+	nothing else to do and only take the task if no worker of the right node picks it up first.
+ */
+void FilterGraphExecutor::PushToNode(int node, Task* task)
+{
+	{
+		auto& q = *m_nodeQueues[node];
+		lock_guard<mutex> lock(q.m_mutex);
+		q.m_tasks.push_back(task);
+	}
+	m_tasksReady.fetch_add(1);
+	WakeIdleWorker(true);
+}
+
+/**
+	@brief Finds the NUMA node a task would best run on
+
+	This is the node holding the CPU-side samples of the node's largest input waveform. Small waveforms fit in cache
+	wherever they are, and looking up the location of a page is a system call, so inputs below a size threshold are
+	ignored.
+
+	@return The node number, or -1 if there's no preference (or the host isn't NUMA)
+ */
+int FilterGraphExecutor::GetPreferredNode(Task* task)
+{
+	if(m_nodeQueues.empty())
+		return -1;
+
+	//Roughly the size of a per-core L2 cache worth of float samples
+	const size_t minSamples = 256 * 1024;
+
+	auto f = m_topology.m_nodes[task->m_node];
+	WaveformBase* largest = nullptr;
+	for(size_t j=0; j<f->GetInputCount(); j++)
+	{
+		auto data = f->GetInput(j).GetData();
+		if(!data || (data->size() < minSamples) || data->IsCurrentOnlyOnGpu())
+			continue;
+		if(!largest || (data->size() > largest->size()))
+			largest = data;
+	}
+	if(!largest)
+		return -1;
+
+	int node = largest->GetCpuNode();
+	if( (node < 0) || (static_cast<size_t>(node) >= m_nodeQueues.size()) )
+		return -1;
+	return node;
+}
+
+/**
+	@brief Wakes one or all idle workers, if there are any
+ */
+void FilterGraphExecutor::WakeIdleWorker(bool all)
+{
+	if(m_idleWorkers.load() == 0)
+		return;
+
+	//Empty critical section ensures the waiter is either not yet checking its predicate or already waiting
+	{
+		lock_guard<mutex> lock(m_idleCvarMutex);
+	}
+	if(all)
+		m_idleCvar.notify_all();
+	else
+		m_idleCvar.notify_one();
+}
+
+/**
+	@brief Wakes the submitting thread to re-check whatever it is waiting on
+ */
+void FilterGraphExecutor::NotifyCompletion()
+{
+	{
+		lock_guard<mutex> lock(m_completionCvarMutex);
+	}
+	m_completionCvar.notify_all();
+}
+
+/**
+	@brief Resolves dependencies after a task finishes executing
+
+	@param i		Index of the calling worker thread
+	@param task		The task which completed
+ */
+void FilterGraphExecutor::OnTaskComplete(size_t i, Task* task)
+{
+	vector<Task*> dependents;
+	{
+		lock_guard<mutex> lock(task->m_mutex);
+		task->m_complete = true;
+		dependents.swap(task->m_dependents);
+	}
+
+	//Our own queue is LIFO and thieves take from the other end, so push the most critical task last: we'll run it
+	//next, and idle workers steal the cheap stuff
+	vector<Task*> runnable;
+	for(auto d : dependents)
+	{
+		if(d->m_pending.fetch_sub(1, memory_order_acq_rel) == 1)
+			runnable.push_back(d);
+	}
+	sort(runnable.begin(), runnable.end(), [](Task* a, Task* b){ return a->m_priority < b->m_priority; });
+	for(auto d : runnable)
+	{
+		//Tasks whose data lives on another NUMA node are better off running over there
+		int node = GetPreferredNode(d);
+		if( (node >= 0) && (node != m_workerNodes[i]) )
+			PushToNode(node, d);
+		else
+			PushRunnable(i, d);
+	}
+
+	//The caller may overwrite our sources as soon as all of the source readers are done, so the GPU has to be too
+	auto gen = task->m_generation;
+	bool notify = false;
+	if(task->m_readsSources)
+	{
+		QueueHandle::WaitForPoints(task->m_gpuPoints);
+		if(gen->m_sourceReadersRemaining.fetch_sub(1, memory_order_acq_rel) == 1)
+			notify = true;
+	}
+
+	//If this was the last task, wait for the GPU work of the whole generation to complete then drop the final
+	//reference. Once m_tasksRemaining hits zero, the submitting thread may free the generation (and this task) at
+	//any time.
+	if(gen->m_tasksRemaining.fetch_sub(1, memory_order_acq_rel) == 2)
+	{
+		for(size_t j=0; j<gen->m_taskCount; j++)
+			QueueHandle::WaitForPoints(gen->m_tasks[j].m_gpuPoints);
+		gen->m_tasksRemaining.fetch_sub(1, memory_order_acq_rel);
+		notify = true;
+	}
+
+	if(notify)
+		NotifyCompletion();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Concurrency limits and self tuning
+
+/**
+	@brief Sets the number of worker threads allowed to run tasks
+
+	Workers beyond the new count finish the task they are running, then sleep. Anything left in their ready queues is
+	stolen by the others. If auto tuning is enabled, this is only a starting point.
+
+	@param count	Number of workers, clamped to between 1 and GetMaxWorkerCount()
+ */
+void FilterGraphExecutor::SetActiveWorkerCount(size_t count)
+{
+	count = min(max((size_t)1, count), m_threads.size());
+	{
+		lock_guard<mutex> lock(m_idleCvarMutex);
+		m_activeWorkers = count;
+	}
+	m_inactiveCvar.notify_all();
+	m_idleCvar.notify_all();
+}
+
+/**
+	@brief Sets the maximum number of nodes which submit GPU work that may be refreshed at once
+
+	If auto tuning is enabled, this is only a starting point.
+
+	@param limit	Number of nodes (at least 1)
+ */
+void FilterGraphExecutor::SetGpuConcurrencyLimit(size_t limit)
+{
+	{
+		lock_guard<mutex> lock(m_tuningMutex);
+		m_gpuLimitChosen = true;
+	}
+	m_gpuLimit = max((size_t)1, limit);
+	ReleaseThrottledTasks();
+}
+
+/**
+	@brief Gets the current worker count and GPU concurrency limit, along with the measurements behind them
+ */
+ExecutorTuning FilterGraphExecutor::GetTuning()
+{
+	lock_guard<mutex> lock(m_tuningMutex);
+	ExecutorTuning ret = m_tuning;
+	ret.m_autoTuning = m_autoTuning;
+	ret.m_maxWorkers = m_threads.size();
+	ret.m_activeWorkers = m_activeWorkers;
+	ret.m_gpuLimit = m_gpuLimit;
+	return ret;
+}
+
+/**
+	@brief Records the compute queue a worker thread uses, and seeds the GPU concurrency limit from the queue count
+
+	Until the limit is chosen by hand or by the tuner, two GPU-submitting nodes are allowed per distinct queue, so one
+	can be recording commands while the other's work is being submitted.
+ */
+void FilterGraphExecutor::RegisterWorkerQueue(QueueHandle* queue)
 {
-	//Terminate worker threads
-	m_terminating = true;
-	m_workerCvar.notify_all();
-	for(auto& t : m_threads)
-		t->join();
+	{
+		lock_guard<mutex> lock(m_tuningMutex);
+		m_workerQueues.emplace(queue);
+		if(m_gpuLimitChosen)
+			return;
+		m_gpuLimit = 2 * m_workerQueues.size();
+	}
+	ReleaseThrottledTasks();
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Setup for a run
-
 /**
-	@brief Evaluates the filter graph, blocking until execution has completed
+	@brief Takes a GPU slot for a task which is about to run, if it needs one
+
+	Nodes which did not submit any GPU work the last time they ran, and nodes already evaluated as part of a producer's
+	elementwise chain, don't need a slot. If every slot is taken, the task is set aside until ReleaseGpuSlot() hands it
+	back to a worker.
+
+	@return True if the task can run now, false if it was set aside
  */
-void FilterGraphExecutor::RunBlocking(const set<FlowGraphNode*>& nodes)
+bool FilterGraphExecutor::AcquireGpuSlot(Task* task)
 {
-	//Nothing to do if we have no nodes to run
-	if(nodes.empty())
-		return;
+	if(task->m_fusedBy || !m_nodeUsesGpu[task->m_node].load(memory_order_relaxed))
+		return true;
 
+	lock_guard<mutex> lock(m_gpuSlotMutex);
+	if(m_gpuTasksRunning < m_gpuLimit.load())
 	{
-		lock_guard<mutex> lock(m_perfStatsMutex);
-		m_currentExecutionTime.clear();
+		m_gpuTasksRunning ++;
+		m_peakGpuTasks = max(m_peakGpuTasks, m_gpuTasksRunning);
+		task->m_holdsGpuSlot = true;
+		if(task->m_throttleStart != 0)
+		{
+			task->m_throttleTime += GetTime() - task->m_throttleStart;
+			task->m_throttleStart = 0;
+		}
+		return true;
 	}
 
+	if(task->m_throttleStart == 0)
 	{
-		lock_guard<mutex> lock(m_mutex);
-
-		if(!m_allWorkersComplete)
-			LogWarning("Entering RunBlocking() but not all workers are complete from previous run\n");
-
-		m_incompleteNodes = nodes;
-		m_incompleteNodes.erase(nullptr);	//don't crash if a null filter somehow ended up in the list
+		task->m_throttleStart = GetTime();
+		m_throttleEvents ++;
+	}
+	m_throttledTasks.push_back(task);
+	return false;
+}
 
-		m_runnableNodes.clear();
-		m_allWorkersComplete = false;
+/**
+	@brief Frees the GPU slot of a task which has finished running, and hands the most critical task waiting for a slot
+	to the calling worker
 
-		Filter::ClearAnalysisCache();
-	}
+	The task we wake up may still lose the slot to another task, in which case it is set aside again. Either way,
+	someone is holding a slot and will wake up the next one.
 
-	//Wake up our workers
-	m_workerCvar.notify_all();
+	@param i		Index of the calling worker thread
+	@param task		The task which finished
+ */
+void FilterGraphExecutor::ReleaseGpuSlot(size_t i, Task* task)
+{
+	if(!task->m_holdsGpuSlot)
+		return;
+	task->m_holdsGpuSlot = false;
 
-	//Block until they're finished
-	while(true)
+	Task* next;
 	{
-		unique_lock<mutex> lock(m_completionCvarMutex);
-		m_completionCvar.wait(lock, [this]{return m_allWorkersComplete;});
+		lock_guard<mutex> lock(m_gpuSlotMutex);
+		m_gpuTasksRunning --;
+		if(m_throttledTasks.empty())
+			return;
 
-		lock_guard<mutex> lock2(m_mutex);
-		if(m_runnableNodes.empty())
-			break;
+		auto it = max_element(m_throttledTasks.begin(), m_throttledTasks.end(),
+			[](Task* a, Task* b){ return a->m_priority < b->m_priority; });
+		next = *it;
+		*it = m_throttledTasks.back();
+		m_throttledTasks.pop_back();
 	}
+	PushRunnable(i, next);
+}
 
-	//Update global performance stats
+/**
+	@brief Makes every task waiting for a GPU slot runnable again, after the limit was raised
+ */
+void FilterGraphExecutor::ReleaseThrottledTasks()
+{
+	vector<Task*> tasks;
 	{
-		lock_guard<mutex> lock(m_perfStatsMutex);
-
-		//For now, fixed half life exponential moving average
-		float halflife = 8;
-		float decay = 1 / pow(2, 1/halflife);
-
-		//TODO: staleness or removing of some sort for old entries?
-
-		//Add the new data
-		for(auto& it : m_currentExecutionTime)
-			m_lastExecutionTime[it.first] = (m_lastExecutionTime[it.first] * decay) + (it.second * (1-decay));
+		lock_guard<mutex> lock(m_gpuSlotMutex);
+		tasks.swap(m_throttledTasks);
 	}
-}
+	if(tasks.empty())
+		return;
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Scheduling
+	for(auto task : tasks)
+		InjectRunnable(task);
+	WakeIdleWorker(true);
+}
 
 /**
-	@brief Returns the next filter available to run, blocking if none are ready.
+	@brief Adds the run times of a retired generation to the measurements for the next tuning decision
+
+	The critical path is computed from the measured run times, in reverse topological order (the order of the
+	generation's tasks). Time during which an earlier generation was still running is only counted once, so in
+	pipelined mode overlapping generations don't look like idle workers.
 
-	Returns null if there are no remaining filters to evaluate.
+	Must be called from the submitting thread.
  */
-FlowGraphNode* FilterGraphExecutor::GetNextRunnableNode()
+void FilterGraphExecutor::RecordTuningSample(Generation* gen)
 {
-	while(true)
+	auto& w = m_tuningWindow;
+	vector<double> path(m_topology.m_nodes.size(), 0);
+	double criticalPath = 0;
+	double start = DBL_MAX;
+	double end = 0;
+	for(size_t j=gen->m_taskCount; j>0; j--)
 	{
-		//Check for stuff
-		{
-			lock_guard<mutex> lock(m_mutex);
+		auto& task = gen->m_tasks[j-1];
+		size_t node = task.m_node;
+		double runtime = task.m_executionTime / FS_PER_SECOND;
 
-			//Nothing left to run? Stop
-			if(m_incompleteNodes.empty())
-				return nullptr;
+		double downstream = 0;
+		for(auto c : m_topology.m_consumers[node])
+			downstream = max(downstream, path[c]);
+		path[node] = runtime + downstream;
+		criticalPath = max(criticalPath, path[node]);
 
-			//Nothing ready to run? Update the run queue
-			if(m_runnableNodes.empty())
-				UpdateRunnable();
+		//Nodes evaluated by a producer's elementwise chain didn't really run
+		if(task.m_fusedBy)
+			continue;
+		w.m_busyTime += runtime;
+		start = min(start, task.m_startTime);
+		end = max(end, task.m_startTime + runtime);
 
-			//If there is something ready to run, grab it
-			if(!m_runnableNodes.empty())
-			{
-				auto f = *m_runnableNodes.begin();
-				m_runnableNodes.erase(f);
-				m_runningNodes.emplace(f);
-				return f;
-			}
+		//Remember how fast each node can be, forgetting a little each time so we follow changes in input size
+		auto& best = m_nodeBestCost[node];
+		if( (best == 0) || (task.m_executionTime < best) )
+			best = task.m_executionTime;
+		else
+			best += best / 64;
+
+		if(task.m_submittedGpuWork)
+		{
+			w.m_gpuTime += task.m_executionTime;
+			w.m_gpuBestTime += best;
 		}
+	}
 
-		//Still nothing to run? Block
-		unique_lock<mutex> lock(m_workerCvarMutex);
-		m_workerCvar.wait(lock);
+	w.m_generations ++;
+	w.m_criticalPath += criticalPath;
+	if(end > start)
+	{
+		w.m_wallTime += max(0.0, end - max(start, w.m_lastEnd));
+		w.m_lastEnd = max(w.m_lastEnd, end);
 	}
 }
 
 /**
-	@brief Searches m_incompleteNodes for any that are unblocked, and adds them to m_runnableNodes
+	@brief Adjusts the worker count and GPU concurrency limit, once TUNING_WINDOW generations have been measured
+
+	The worker count is capped at the parallelism of the graph (total run time over critical path length, times the
+	pipeline depth since that many generations may overlap): more workers than that can never all be busy. Below the
+	cap it grows by a quarter while the active workers are busy more than 3/4 of the time, and shrinks by a quarter if
+	they are busy less than half of it.
 
-	Assumes m_mutex is locked
+	The GPU concurrency limit is cut by a quarter if GPU-submitting nodes ran 1.5x slower than their best while several
+	of them were running at once, and raised by one if tasks were held back while GPU nodes ran close to their best.
+	Decreasing quickly and increasing slowly lets it settle just below the point where the queues saturate.
+
+	Must be called from the submitting thread.
  */
-void FilterGraphExecutor::UpdateRunnable()
+void FilterGraphExecutor::Retune()
 {
-	//Do nothing if we already have other filters marked runnable
-	if(!m_runnableNodes.empty())
+	auto& w = m_tuningWindow;
+	if(w.m_generations < TUNING_WINDOW)
 		return;
 
-	//Look for new filters that are eligible to run
-	for(auto f : m_incompleteNodes)
+	size_t active = m_activeWorkers;
+	float efficiency = (w.m_wallTime > 0) ? (w.m_busyTime / (active * w.m_wallTime)) : 0;
+	float parallelism = (w.m_criticalPath > 0) ? (w.m_busyTime / w.m_criticalPath) : 0;
+	float slowdown = (w.m_gpuBestTime > 0) ? (w.m_gpuTime / w.m_gpuBestTime) : 0;
+	w.Clear();
+
+	size_t peakGpuTasks;
 	{
-		//If the filter is already running, nothing we can do
-		if(m_runningNodes.find(f) != m_runningNodes.end())
-			continue;
+		lock_guard<mutex> lock(m_gpuSlotMutex);
+		peakGpuTasks = m_peakGpuTasks;
+		m_peakGpuTasks = m_gpuTasksRunning;
+	}
+	size_t throttled = m_throttleEvents.exchange(0);
 
-		//Not actively running.
-		//Is it blocked by any of our incomplete filters?
-		bool ok = true;
-		for(size_t i=0; i<f->GetInputCount(); i++)
+	size_t workers = active;
+	size_t gpuLimit = m_gpuLimit;
+	if(m_autoTuning)
+	{
+		size_t cap = static_cast<size_t>(ceil(parallelism * m_pipelineDepth));
+		cap = min(max((size_t)1, cap), m_threads.size());
+		size_t step = max((size_t)1, active / 4);
+		if(active > cap)
+			workers = max(cap, active - step);
+		else if(efficiency < 0.5f)
+			workers = max((size_t)1, active - step);
+		else if(efficiency > 0.75f)
+			workers = min(cap, active + step);
+
+		if( (slowdown > 1.5f) && (peakGpuTasks > 1) )
 		{
-			auto in = f->GetInput(i).m_channel;
-			if(m_incompleteNodes.find(in) != m_incompleteNodes.end())
-			{
-				ok = false;
-				break;
-			}
+			size_t base = min(gpuLimit, peakGpuTasks);
+			gpuLimit = base - max((size_t)1, base / 4);
+		}
+		else if( (throttled != 0) && (slowdown < 1.2f) )
+			gpuLimit = min(gpuLimit + 1, m_threads.size());
+	}
+
+	bool changed = (workers != active) || (gpuLimit != m_gpuLimit);
+	{
+		lock_guard<mutex> lock(m_tuningMutex);
+		m_tuning.m_parallelEfficiency = efficiency;
+		m_tuning.m_graphParallelism = parallelism;
+		m_tuning.m_gpuSlowdown = slowdown;
+		m_tuning.m_peakGpuTasks = peakGpuTasks;
+		m_tuning.m_throttledTasks += throttled;
+		if(changed)
+		{
+			m_tuning.m_adjustments ++;
+			m_gpuLimitChosen = true;
 		}
+	}
+	if(!changed)
+		return;
 
-		//Not blocked. It's runnable.
-		if(ok)
-			m_runnableNodes.emplace(f);
+	LogTrace("FilterGraphExecutor: %zu -> %zu workers, GPU limit %zu -> %zu "
+		"(efficiency %.2f, parallelism %.1f, GPU slowdown %.2f)\n",
+		active, workers, m_gpuLimit.load(), gpuLimit, efficiency, parallelism, slowdown);
+	PerformanceTrace::AddEvent(
+		string("Retune: ") + to_string(workers) + " workers, GPU limit " + to_string(gpuLimit),
+		"executor",
+		PerformanceTrace::PID_CPU,
+		PerformanceTrace::GetThreadTrack(),
+		GetTime(),
+		0);
+
+	if(workers != active)
+		SetActiveWorkerCount(workers);
+	if(gpuLimit != m_gpuLimit)
+	{
+		bool raised = (gpuLimit > m_gpuLimit);
+		m_gpuLimit = gpuLimit;
+		if(raised)
+			ReleaseThrottledTasks();
 	}
 }
 
@@ -211,6 +1562,10 @@ void FilterGraphExecutor::ExecutorThread(FilterGraphExecutor* pThis, size_t i)
 	pthread_setname_np(pthread_self(), "FilterGraph");
 	#endif
 
+	//Stay on our NUMA node so the buffers we first touch stay local
+	if(pThis->m_workerNodes[i] >= 0)
+		NumaTopology::PinCurrentThread(pThis->m_workerNodes[i]);
+
 	//Make locale handling thread safe on Windows
 	#ifdef _WIN32
 	_configthreadlocale(_ENABLE_PER_THREAD_LOCALE);
@@ -226,112 +1581,545 @@ void FilterGraphExecutor::DoExecutorThread(size_t i)
 		nvtx3::scoped_range range("FilterGraphExecutor::DoExecutorThread");
 	#endif
 
-	//Create a queue and command buffer for this thread's accelerated processing
-	std::shared_ptr<QueueHandle> queue(g_vkQueueManager->GetComputeQueue("FilterGraphExecutor[" + to_string(i) + "].queue"));
-	vk::CommandPoolCreateInfo poolInfo(
-		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-		queue->m_family );
-	vk::raii::CommandPool pool(*g_vkComputeDevice, poolInfo);
+	//Create a queue and command buffers for this thread's accelerated processing
+	string prefix = string("FilterGraphExecutor[") + to_string(i) + "]";
+	std::shared_ptr<QueueHandle> queue(g_vkQueueManager->GetComputeQueue(prefix + ".queue"));
+	RegisterWorkerQueue(queue.get());
+	CommandBufferPool pool(queue, prefix);
+	ComputePipeline fusedPipeline(
+		"shaders/ElementwiseChain.spv",
+		ElementwiseChainConstants::MAX_SLOTS + ElementwiseChainConstants::MAX_RAW_SLOTS,
+		sizeof(ElementwiseChainConstants));
+	GpuTimestampPool timestamps(queue, prefix);
 
-	vk::CommandBufferAllocateInfo bufinfo(*pool, vk::CommandBufferLevel::ePrimary, 1);
-	vk::raii::CommandBuffer cmdbuf(std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+	//GPU work of this thread's tasks goes on the GPU track with the same number as our CPU track
+	auto track = PerformanceTrace::GetThreadTrack();
+	PerformanceTrace::SetTrackName(PerformanceTrace::PID_CPU, track, prefix);
+	PerformanceTrace::SetTrackName(PerformanceTrace::PID_GPU, track, queue->GetName() + " (" + prefix + ")");
 
-	if(g_hasDebugUtils)
+	//Main loop
+	while(true)
 	{
-		string prefix = string("FilterGraphExecutor[") + to_string(i) + "]";
+		//Workers beyond the active count sleep until the tuner wants them again
+		if(i >= m_activeWorkers.load())
+		{
+			unique_lock<mutex> lock(m_idleCvarMutex);
+			m_inactiveCvar.wait(lock, [this, i]{ return m_terminating || (i < m_activeWorkers.load()); });
+			if(m_terminating)
+				break;
+			continue;
+		}
 
-		string poolname = prefix + ".pool";
-		string bufname = prefix + ".cmdbuf";
+		ResumeParkedTasks(i);
 
-		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
-			vk::DebugUtilsObjectNameInfoEXT(
-				vk::ObjectType::eCommandPool,
-				reinterpret_cast<uint64_t>(static_cast<VkCommandPool>(*pool)),
-				poolname.c_str()));
+		Task* task;
+		if(!GetNextRunnableTask(i, task))
+		{
+			//Nothing ready to run? Block until something is pushed or the context is being destroyed.
+			//Readbacks don't wake us when they complete, so keep checking on them while any task is waiting for one
+			unique_lock<mutex> lock(m_idleCvarMutex);
+			m_idleWorkers.fetch_add(1);
+			auto pred = [this, i]
+				{ return m_terminating || (m_tasksReady.load() != 0) || (i >= m_activeWorkers.load()); };
+			if(m_parkedTaskCount.load() != 0)
+				m_idleCvar.wait_for(lock, chrono::microseconds(100), pred);
+			else
+				m_idleCvar.wait(lock, pred);
+			m_idleWorkers.fetch_sub(1);
+			if(m_terminating)
+				break;
+			continue;
+		}
 
-		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
-			vk::DebugUtilsObjectNameInfoEXT(
-				vk::ObjectType::eCommandBuffer,
-				reinterpret_cast<uint64_t>(static_cast<VkCommandBuffer>(*cmdbuf)),
-				bufname.c_str()));
+		//If the inputs are still on their way back from the GPU, do something else in the meantime
+		if(!StartInputReadback(task))
+		{
+			ParkTask(task);
+			continue;
+		}
+
+		//If too many GPU nodes are running already, the task waits for one of them to finish
+		if(!AcquireGpuSlot(task))
+			continue;
+
+		RunTask(task, pool, queue, fusedPipeline, timestamps);
+		ReleaseGpuSlot(i, task);
+		OnTaskComplete(i, task);
 	}
+}
 
-	//Main loop
-	while(true)
+/**
+	@brief Starts copying a task's inputs back from the GPU, if the node needs them on the CPU
+
+	The copies wait on the GPU for the node's producers, so they can be started as soon as the task is runnable.
+
+	@return True if the task can run now, false if it has to wait for its inputs
+ */
+bool FilterGraphExecutor::StartInputReadback(Task* task)
+{
+	if(task->m_readbackStarted)
+		return task->m_readback.IsReady();
+	task->m_readbackStarted = true;
+
+	if(task->m_fusedBy)
+		return true;
+	auto f = m_topology.m_nodes[task->m_node];
+	if(f->GetInputLocation() != Filter::LOC_CPU)
+		return true;
+
+	shared_lock<shared_mutex> lock(g_vulkanActivityMutex);
+
+	QueueSubmitScope scope;
+	for(auto p : m_topology.m_producers[task->m_node])
+	{
+		for(auto& point : m_gpuPoints[p])
+			scope.AddWait(point);
+	}
+	for(size_t j=0; j<f->GetInputCount(); j++)
+	{
+		auto data = f->GetInput(j).GetData();
+		if(data && data->IsCurrentOnlyOnGpu())
+			task->m_readback.Merge(data->PrepareForCpuAccessAsync());
+	}
+
+	return task->m_readback.IsReady();
+}
+
+/**
+	@brief Sets aside a task until the readbacks of its inputs have completed
+ */
+void FilterGraphExecutor::ParkTask(Task* task)
+{
+	lock_guard<mutex> lock(m_parkedTasksMutex);
+	m_parkedTasks.push_back(task);
+	m_parkedTaskCount.fetch_add(1);
+}
+
+/**
+	@brief Moves tasks whose input readbacks have completed to the calling worker's queue
+
+	@param i	Index of the calling worker thread
+ */
+void FilterGraphExecutor::ResumeParkedTasks(size_t i)
+{
+	if(m_parkedTaskCount.load() == 0)
+		return;
+
+	//Whoever has the lock is already doing this
+	unique_lock<mutex> lock(m_parkedTasksMutex, try_to_lock);
+	if(!lock.owns_lock())
+		return;
+
+	for(size_t j=0; j<m_parkedTasks.size(); )
 	{
+		auto task = m_parkedTasks[j];
+		if(!task->m_readback.IsReady())
 		{
-			//Wait until the main thread starts a new round of execution, or the timeout elapses
-			//When we time out, check if we're shutting down
-			unique_lock<mutex> lock(m_workerCvarMutex);
-			m_workerCvar.wait_for(lock, chrono::milliseconds(50));
+			j++;
+			continue;
 		}
 
-		//If they woke us up because the context is being destroyed, we're done
-		if(m_terminating)
-			break;
+		m_parkedTasks[j] = m_parkedTasks.back();
+		m_parkedTasks.pop_back();
+		m_parkedTaskCount.fetch_sub(1);
+		PushRunnable(i, task);
+	}
+}
 
-		//If we're already done, nothing to do
-		if(m_allWorkersComplete)
-			continue;
+/**
+	@brief Refreshes the node associated with a task
+
+	GPU work submitted by the node is not waited for here; the points it will signal are recorded in the task instead.
+ */
+void FilterGraphExecutor::RunTask(
+	Task* task,
+	CommandBufferPool& pool,
+	shared_ptr<QueueHandle> queue,
+	ComputePipeline& fusedPipeline,
+	GpuTimestampPool& timestamps)
+{
+	size_t node = task->m_node;
+	auto f = m_topology.m_nodes[node];
+
+	//If a producer already evaluated us as part of its elementwise chain, our output is done (or will be once the
+	//producer's GPU work completes)
+	if(task->m_fusedBy)
+	{
+		task->m_gpuPoints = task->m_fusedBy->m_gpuPoints;
+		m_gpuPoints[node] = task->m_gpuPoints;
+		SaveNodeState(node, task->m_fusedConfigRevision, task->m_demand);
+		m_nodeSequence[node].store(task->m_generation->m_sequence);
+		return;
+	}
+
+	shared_lock<shared_mutex> lock(g_vulkanActivityMutex);
 
-		//Evaluate nodes as they become available, then stop when there's nothing left to do
-		FlowGraphNode* f;
-		while( (f = GetNextRunnableNode()) != nullptr)
+	//Everything we submit waits for the GPU work of our producers, if we can avoid reading their output on the CPU.
+	//We can't overwrite our own output (or scratch buffers, descriptor sets etc.) until our previous refresh and all
+	//of its consumers are done with it on the GPU.
+	QueueSubmitScope scope;
+	bool gpuInputs = f->ConsumesInputsOnGpu();
+	for(auto p : m_topology.m_producers[node])
+	{
+		if(gpuInputs)
 		{
-			shared_lock<shared_mutex> lock(g_vulkanActivityMutex);
+			for(auto& point : m_gpuPoints[p])
+				scope.AddWait(point);
+		}
+		else
+			QueueHandle::WaitForPoints(m_gpuPoints[p]);
+	}
+	QueueHandle::WaitForPoints(m_gpuPoints[node]);
+	for(auto c : m_topology.m_consumers[node])
+		QueueHandle::WaitForPoints(m_gpuPoints[c]);
 
-			//Make sure the filter's inputs are where we need them
-			auto loc = f->GetInputLocation();
-			if(loc != Filter::LOC_DONTCARE)
+	//Make sure the filter's inputs are where we need them
+	auto loc = f->GetInputLocation();
+	if(loc != Filter::LOC_DONTCARE)
+	{
+		bool expectGpuInput = (loc == Filter::LOC_GPU);
+		bool expectCpuInput = (loc == Filter::LOC_CPU);
+		for(size_t j=0; j<f->GetInputCount(); j++)
+		{
+			auto data = f->GetInput(j).GetData();
+			if(data)
 			{
-				bool expectGpuInput = (loc == Filter::LOC_GPU);
-				bool expectCpuInput = (loc == Filter::LOC_CPU);
-				for(size_t j=0; j<f->GetInputCount(); j++)
-				{
-					auto data = f->GetInput(j).GetData();
-					if(data)
-					{
-						if(expectGpuInput)
-							data->PrepareForGpuAccess();
-						else if(expectCpuInput)
-							data->PrepareForCpuAccess();
-					}
-				}
+				if(expectGpuInput)
+					data->PrepareForGpuAccess();
+				else if(expectCpuInput)
+					data->PrepareForCpuAccess();
 			}
+		}
+	}
 
-			//Actually execute the filter
-			double start = GetTime();
+	//Actually execute the filter, charging any GPU memory it allocates to it
+	auto filter = dynamic_cast<Filter*>(f);
+	string name = filter ? filter->GetDisplayName() : string();
+	GpuMemoryBudget::OwnerScope owner(name);
+	auto& cmdbuf = pool.Acquire();
+	auto configRevision = f->GetConfigRevision();
+	if(filter)
+		filter->SetStreamDemand(task->m_demand);
+	bool profiling = m_profiling;
+	if(profiling)
+		scope.SetTimestampPool(&timestamps);
+	auto& counters = PerformanceCounters::GetThreadCounters();
+	auto countersBefore = counters;
+	double start = GetTime();
+	{
+		PerformanceTraceRange range(name, "filter");
+		if(!(task->m_fuseNext || (m_fusion && HasRawInput(f))) || !RunFusedChain(task, cmdbuf, queue, fusedPipeline))
 			f->Refresh(cmdbuf, queue);
-			double dt = GetTime() - start;
+	}
+	task->m_executionTime = (GetTime() - start) * FS_PER_SECOND;
+	task->m_startTime = start;
+	task->m_submittedGpuWork = (counters.m_queueSubmits != countersBefore.m_queueSubmits);
+	m_nodeUsesGpu[node].store(task->m_submittedGpuWork, memory_order_relaxed);
+	AcceleratorBufferRegistry::GetInstance().RecordRefresh(
+		name, counters.m_reallocations - countersBefore.m_reallocations);
+
+	//The timestamps can only be read back once the GPU is done, so leave that for UpdateProfile()
+	if(profiling)
+	{
+		task->m_profiled = true;
+		task->m_traceTrack = PerformanceTrace::GetThreadTrack();
+		task->m_timestampPool = &timestamps;
+		task->m_timestampPairs = scope.GetTimestampPairs();
+		task->m_uploadBytes = counters.m_uploadBytes - countersBefore.m_uploadBytes;
+		task->m_readbackBytes = counters.m_readbackBytes - countersBefore.m_readbackBytes;
+		task->m_pipelineStallTime = counters.m_pipelineStallTime - countersBefore.m_pipelineStallTime;
+	}
+
+	task->m_gpuPoints = scope.GetSignals();
+	m_gpuPoints[node] = task->m_gpuPoints;
+	pool.Release(task->m_gpuPoints);
+
+	//Outputs still being written by the GPU can't be hashed, and are never flagged anyway
+	if(m_incremental && f->IsOutputContentHashed() && task->m_gpuPoints.empty())
+		SuppressUnchangedOutputs(node);
+
+	SaveNodeState(node, configRevision, task->m_demand);
+	m_nodeSequence[node].store(task->m_generation->m_sequence);
+}
+
+/**
+	@brief Checks if any input of a node holds raw ADC codes (see RawAnalogSamples)
+ */
+bool FilterGraphExecutor::HasRawInput(FlowGraphNode* node)
+{
+	for(size_t j=0; j<node->GetInputCount(); j++)
+	{
+		auto data = node->GetInput(j).GetData();
+		if(data && data->HasRawSamples())
+			return true;
+	}
+	return false;
+}
+
+/**
+	@brief Evaluates a task's node, and as many of the nodes chained after it as possible, in one compute shader pass
+
+	Each node in the chain (see PlanFusion()) is asked to set itself up as an ElementwiseOp, stopping at the first one
+	which can't be, which has a different length than the first, or which would need more buffers than the shader has
+	slots for. Nodes from that point on are refreshed normally by their own tasks (and may start a new chain).
+
+	Every waveform is bound to a slot of ElementwiseChain.glsl once. The chained operand of each op is the previous
+	op's result, kept in a register, so intermediate waveforms are written but never read back. Inputs holding raw
+	ADC codes are read and scaled in place, so they never need to be converted to floating point.
+
+	@return True if at least two nodes were evaluated (or one, reading raw codes), false if the caller should refresh
+			the node normally
+ */
+bool FilterGraphExecutor::RunFusedChain(
+	Task* task,
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue,
+	ComputePipeline& fusedPipeline)
+{
+	ElementwiseChainConstants cfg;
+	cfg.len = 0;
+	cfg.nops = 0;
+	for(size_t i=0; i<ElementwiseChainConstants::MAX_OPS; i++)
+	{
+		cfg.ops[i] = 0;
+		cfg.constants[i] = 0;
+	}
+	for(size_t i=0; i<ElementwiseChainConstants::MAX_SLOTS; i++)
+		cfg.offsets[i] = 0;
+	cfg.rawFormats = 0x0f0f;
+	for(size_t i=0; i<ElementwiseChainConstants::MAX_RAW_SLOTS; i++)
+	{
+		cfg.rawGain[i] = 0;
+		cfg.rawOffset[i] = 0;
+	}
+
+	vector<UniformAnalogWaveform*> slots;
+	vector<uint8_t> slotIsOutput;
+	vector<ElementwiseOp> ops;
+	vector<Task*> tasks;
+	vector<uint64_t> revisions;
+	auto countRawSlots = [&]()
+		{ return count_if(slots.begin(), slots.end(), [](auto w){ return w->HasRawSamples(); }); };
+	for(auto t = task; t && (ops.size() < ElementwiseChainConstants::MAX_OPS); t = t->m_fuseNext)
+	{
+		auto f = dynamic_cast<Filter*>(m_topology.m_nodes[t->m_node]);
+		if(!f)
+			break;
+
+		auto rev = f->GetConfigRevision();
+		ElementwiseOp op;
+		if(!f->SetupElementwiseOp(op))
+			break;
+		if( (op.m_len == 0) || (op.m_output == nullptr) || (!ops.empty() && (op.m_len != ops[0].m_len)) )
+			break;
+
+		//Every op after the first must take the previous result as an operand. Any other waveform is read from a slot,
+		//which is only safe if nothing in the chain writes to it.
+		size_t nslots = slots.size();
+		uint32_t src[2] = { ElementwiseChainConstants::SLOT_PREVIOUS, ElementwiseChainConstants::SLOT_PREVIOUS };
+		bool chained = ops.empty();
+		bool ok = true;
+		for(size_t j=0; (j<2) && ok; j++)
+		{
+			auto in = op.m_inputs[j];
+			if(in == nullptr)
+				continue;
+			if(!ops.empty() && (in == ops.back().m_output) && (op.m_offsets[j] == 0))
 			{
-				lock_guard<mutex> slock(m_perfStatsMutex);
-				m_currentExecutionTime[f] = dt * FS_PER_SECOND;
+				chained = true;
+				continue;
 			}
 
-			//Filter execution has completed, remove it from the running list and mark as completed
-			lock_guard<mutex> lock2(m_mutex);
-			m_runningNodes.erase(f);
-			m_incompleteNodes.erase(f);
-
-			//Wake up all threads that might have been waiting on this filter to complete
-			m_workerCvar.notify_all();
+			auto it = find(slots.begin(), slots.end(), in);
+			if(it != slots.end())
+			{
+				size_t k = it - slots.begin();
+				if(slotIsOutput[k] || (cfg.offsets[k] != op.m_offsets[j]))
+					ok = false;
+				src[j] = k;
+			}
+			else if( (slots.size() < ElementwiseChainConstants::MAX_SLOTS) &&
+				(!in->HasRawSamples() || (countRawSlots() < ElementwiseChainConstants::MAX_RAW_SLOTS)) )
+			{
+				src[j] = slots.size();
+				cfg.offsets[slots.size()] = op.m_offsets[j];
+				slots.push_back(in);
+				slotIsOutput.push_back(0);
+			}
+			else
+				ok = false;
 		}
 
-		//We have no more filters to run.
-		//If this was the last filter (nothing left incomplete), we're done - wake up the main thread
-		bool empty = false;
+		size_t dst = slots.size();
+		if( (dst >= ElementwiseChainConstants::MAX_SLOTS) ||
+			(find(slots.begin(), slots.end(), op.m_output) != slots.end()) )
 		{
-			lock_guard<mutex> lock2(m_mutex);
-			empty = m_incompleteNodes.empty();
+			ok = false;
 		}
-		if(empty)
+		if(!ok || !chained)
 		{
-			{
-				lock_guard<mutex> lock3(m_completionCvarMutex);
-				m_allWorkersComplete = true;
-			}
+			slots.resize(nslots);
+			slotIsOutput.resize(nslots);
+			break;
+		}
+		cfg.offsets[dst] = 0;
+		slots.push_back(op.m_output);
+		slotIsOutput.push_back(1);
+
+		cfg.ops[cfg.nops] = op.m_type | (src[0] << 8) | (src[1] << 12) | (dst << 16);
+		cfg.constants[cfg.nops] = op.m_constant;
+		cfg.nops ++;
+
+		ops.push_back(op);
+		tasks.push_back(t);
+		revisions.push_back(rev);
+	}
+
+	//Slots holding raw ADC codes are read in place from buffers of their own
+	vector<RawAnalogSamples*> rawSlots;
+	for(size_t k=0; k<slots.size(); k++)
+	{
+		auto raw = slots[k]->m_rawSamples.get();
+		if(!raw)
+			continue;
+
+		size_t r = rawSlots.size();
+		size_t bytesPerCode = raw->GetBitsPerSample() / 8;
+		uint32_t format = k | ( (bytesPerCode == 2) ? 0x10 : 0);
+		cfg.rawFormats = (cfg.rawFormats & ~(0xffu << (8*r))) | (format << (8*r));
+		cfg.rawGain[r] = raw->GetGain();
+		cfg.rawOffset[r] = raw->GetOffset();
+		cfg.offsets[k] += raw->GetByteOffset() / bytesPerCode;
+		rawSlots.push_back(raw);
+	}
+
+	//Nothing to fuse, the first node may as well use its own kernel.
+	//A single op is still worth doing here if it saves converting raw codes to floating point first, though.
+	if(ops.empty() || ( (ops.size() < 2) && rawSlots.empty() ) )
+		return false;
+	cfg.len = ops[0].m_len;
+
+	//We're about to overwrite the outputs of the rest of the chain, so the GPU has to be done with them
+	for(size_t j=1; j<tasks.size(); j++)
+	{
+		size_t node = tasks[j]->m_node;
+		QueueHandle::WaitForPoints(m_gpuPoints[node]);
+		for(auto c : m_topology.m_consumers[node])
+			QueueHandle::WaitForPoints(m_gpuPoints[c]);
+	}
+
+	cmdBuf.begin({});
+
+	//Unused slots still need a valid buffer bound
+	for(size_t j=0; j<ElementwiseChainConstants::MAX_SLOTS; j++)
+	{
+		if( (j < slots.size()) && !slots[j]->HasRawSamples() )
+			fusedPipeline.BindBufferNonblocking(j, slots[j]->m_samples, cmdBuf, slotIsOutput[j]);
+		else
+			fusedPipeline.BindBufferNonblocking(j, ops[0].m_output->m_samples, cmdBuf, true);
+	}
+	for(size_t r=0; r<ElementwiseChainConstants::MAX_RAW_SLOTS; r++)
+	{
+		size_t binding = ElementwiseChainConstants::MAX_SLOTS + r;
+		if(r < rawSlots.size())
+			fusedPipeline.BindBufferNonblocking(binding, rawSlots[r]->GetCodes(), cmdBuf);
+		else
+			fusedPipeline.BindBufferNonblocking(binding, ops[0].m_output->m_samples, cmdBuf, true);
+	}
+
+	const uint32_t compute_block_count = GetComputeBlockCount(cfg.len, 64);
+	fusedPipeline.Dispatch(cmdBuf, cfg,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
+
+	cmdBuf.end();
+	queue->SubmitDeferred(cmdBuf);
+
+	for(auto& op : ops)
+		op.m_output->MarkSamplesModifiedFromGpu();
+
+	//Let the rest of the chain know they're done
+	for(size_t j=1; j<tasks.size(); j++)
+	{
+		tasks[j]->m_fusedConfigRevision = revisions[j];
+		tasks[j]->m_fusedBy = task;
+	}
+	return true;
+}
 
-			m_completionCvar.notify_all();
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Command buffer pool
+
+FilterGraphExecutor::CommandBufferPool::CommandBufferPool(shared_ptr<QueueHandle> queue, const string& name)
+	: m_name(name)
+	, m_pool(*g_vkComputeDevice, vk::CommandPoolCreateInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		queue->m_family))
+	, m_current(0)
+	, m_next(0)
+{
+	if(g_hasDebugUtils)
+	{
+		string poolname = m_name + ".pool";
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandPool,
+				reinterpret_cast<uint64_t>(static_cast<VkCommandPool>(*m_pool)),
+				poolname.c_str()));
+	}
+}
+
+/**
+	@brief Gets a command buffer which the GPU is not using
+
+	Buffers are recorded from scratch by the filter (vkBeginCommandBuffer implicitly resets them, since the pool was
+	created with eResetCommandBuffer), so no explicit reset is needed.
+ */
+vk::raii::CommandBuffer& FilterGraphExecutor::CommandBufferPool::Acquire()
+{
+	//Reuse the first idle buffer
+	for(size_t i=0; i<m_buffers.size(); i++)
+	{
+		if(QueueHandle::ArePointsComplete(m_busyUntil[i]))
+		{
+			m_current = i;
+			return *m_buffers[i];
+		}
+	}
+
+	//Allocate a new one if we have room
+	if(m_buffers.size() < MAX_BUFFERS)
+	{
+		vk::CommandBufferAllocateInfo bufinfo(*m_pool, vk::CommandBufferLevel::ePrimary, 1);
+		m_buffers.push_back(make_unique<vk::raii::CommandBuffer>(
+			std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front())));
+		m_busyUntil.push_back(vector<QueueTimelinePoint>());
+		m_current = m_buffers.size() - 1;
+
+		if(g_hasDebugUtils)
+		{
+			string bufname = m_name + ".cmdbuf" + to_string(m_current);
+			g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+				vk::DebugUtilsObjectNameInfoEXT(
+					vk::ObjectType::eCommandBuffer,
+					reinterpret_cast<uint64_t>(static_cast<VkCommandBuffer>(**m_buffers[m_current])),
+					bufname.c_str()));
 		}
+
+		return *m_buffers[m_current];
 	}
+
+	//Everything is busy, wait for the GPU to finish with one of them (round robin, so roughly the oldest)
+	m_current = m_next;
+	m_next = (m_next + 1) % m_buffers.size();
+	QueueHandle::WaitForPoints(m_busyUntil[m_current]);
+	return *m_buffers[m_current];
+}
+
+/**
+	@brief Marks the buffer most recently returned by Acquire() as in use until the given points are reached
+ */
+void FilterGraphExecutor::CommandBufferPool::Release(const vector<QueueTimelinePoint>& busyUntil)
+{
+	m_busyUntil[m_current] = busyUntil;
 }
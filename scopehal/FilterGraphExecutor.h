@@ -40,19 +40,265 @@
 #include <condition_variable>
 #include <atomic>
 
+#include "WorkStealingDeque.h"
+#include "GpuTimestampPool.h"
+#include "ReadbackFuture.h"
+
+/**
+	@brief Push constants for ElementwiseChain.glsl
+	@ingroup core
+ */
+class ElementwiseChainConstants
+{
+public:
+	///@brief Maximum number of ops in one chain
+	static const size_t MAX_OPS = 8;
+
+	///@brief Number of waveform buffers the shader can access
+	static const size_t MAX_SLOTS = 8;
+
+	///@brief Slot number referring to the result of the previous op, rather than a buffer
+	static const uint32_t SLOT_PREVIOUS = 15;
+
+	///@brief Number of input slots which may hold raw ADC codes rather than floating point samples
+	static const size_t MAX_RAW_SLOTS = 2;
+
+	uint32_t	len;
+	uint32_t	nops;
+	uint32_t	ops[MAX_OPS];
+	float		constants[MAX_OPS];
+	uint32_t	offsets[MAX_SLOTS];
+	uint32_t	rawFormats;
+	float		rawGain[MAX_RAW_SLOTS];
+	float		rawOffset[MAX_RAW_SLOTS];
+};
+
+/**
+	@brief Profiling statistics for one node, accumulated over every refresh since profiling was last reset
+	@ingroup core
+ */
+class FilterProfile
+{
+public:
+	FilterProfile()
+	: m_refreshCount(0)
+	, m_cpuTime(0)
+	, m_gpuTime(0)
+	, m_timedSubmissions(0)
+	, m_uploadBytes(0)
+	, m_readbackBytes(0)
+	, m_pipelineStallTime(0)
+	, m_gpuThrottleTime(0)
+	{}
+
+	///@brief Number of times the node was refreshed
+	size_t m_refreshCount;
+
+	///@brief Wall clock time spent in Refresh(), in femtoseconds (includes any waits for the GPU)
+	int64_t m_cpuTime;
+
+	///@brief Execution time of the GPU work the node submitted, in femtoseconds
+	int64_t m_gpuTime;
+
+	///@brief Number of GPU submissions included in m_gpuTime
+	size_t m_timedSubmissions;
+
+	///@brief Bytes copied from CPU to GPU memory
+	uint64_t m_uploadBytes;
+
+	///@brief Bytes copied from GPU to CPU memory
+	uint64_t m_readbackBytes;
+
+	///@brief Time spent waiting for compute pipelines to be created, in femtoseconds
+	int64_t m_pipelineStallTime;
+
+	///@brief Time the node was runnable but held back by the GPU concurrency limit, in femtoseconds
+	int64_t m_gpuThrottleTime;
+};
+
+/**
+	@brief Current state of the executor's self tuning, and the measurements its last decision was based on
+	@ingroup core
+ */
+class ExecutorTuning
+{
+public:
+	ExecutorTuning()
+	: m_autoTuning(false)
+	, m_maxWorkers(0)
+	, m_activeWorkers(0)
+	, m_gpuLimit(0)
+	, m_parallelEfficiency(0)
+	, m_graphParallelism(0)
+	, m_gpuSlowdown(0)
+	, m_peakGpuTasks(0)
+	, m_throttledTasks(0)
+	, m_adjustments(0)
+	{}
+
+	///@brief True if the worker count and GPU concurrency limit are being tuned automatically
+	bool m_autoTuning;
+
+	///@brief Number of worker threads which exist
+	size_t m_maxWorkers;
+
+	///@brief Number of worker threads currently allowed to run tasks
+	size_t m_activeWorkers;
+
+	///@brief Maximum number of GPU-submitting nodes which may be refreshed at once
+	size_t m_gpuLimit;
+
+	///@brief Fraction of the time graph evaluation was in progress that the active workers spent running nodes
+	float m_parallelEfficiency;
+
+	///@brief Total node run time divided by critical path length, i.e. the most workers one generation can keep busy
+	float m_graphParallelism;
+
+	///@brief Run time of GPU-submitting nodes relative to the best recently seen for each of them
+	float m_gpuSlowdown;
+
+	///@brief Largest number of GPU-submitting nodes seen running at once
+	size_t m_peakGpuTasks;
+
+	///@brief Number of tasks held back by the GPU concurrency limit, since the executor was created
+	size_t m_throttledTasks;
+
+	///@brief Number of times the worker count or GPU concurrency limit has been changed by the tuner
+	size_t m_adjustments;
+};
+
 /**
 	@brief Execution manager / scheduler for the filter graph
 	@ingroup core
+
+	The dependency graph is precomputed once per topology change (see UpdateTopology()). Each refresh of a node is
+	a task with an atomic count of unresolved dependencies, and ready tasks are handed out to worker threads via
+	per-thread work stealing deques, so completion of a node only costs O(out-degree) and no global lock is held
+	during execution.
+
+	When incremental evaluation is enabled (the default), the executor remembers the WaveformCacheKey of every input
+	edge and the configuration revision of every node as of its last refresh. Only nodes for which something has
+	changed, and everything downstream of them, are scheduled; unchanged subgraphs are never dispatched.
+
+	Each call to RunBlocking() or RunPipelined() submits one generation, identified by a sequence number. In
+	pipelined mode up to GetPipelineDepth() generations may be in flight at once: a node may start on generation
+	N+1 as soon as its producers have finished N+1 and all of its consumers are done reading its output from
+	generation N, so slow leaves no longer hold back the next acquisition.
+
+	Each task runs inside a QueueSubmitScope, and gets a command buffer from a per-thread pool which is only reused once
+	the GPU has finished with it. Filters which submit with QueueHandle::SubmitDeferred() therefore return as soon as
+	their work is queued. If a consumer reports ConsumesInputsOnGpu(), its submissions wait for the producer's work on
+	the GPU via timeline semaphores; otherwise it blocks until the producer's GPU work completes before it starts. All
+	GPU work of a generation has completed by the time the generation is reported complete.
+
+	Filters which need their inputs on the CPU don't tie up a worker while those inputs are copied back from the GPU.
+	Once such a task becomes runnable, asynchronous readbacks of its GPU-resident inputs are started (see
+	WaveformBase::PrepareForCpuAccessAsync()) and the task is set aside until they complete, while the worker gets on
+	with other nodes.
+
+	When profiling is enabled (see SetProfiling()), GPU submissions made by each node are bracketed by timestamp
+	queries, which are read back once the generation retires. Together with CPU time, host/device copy volume and
+	pipeline creation stalls this gives a per-node breakdown (see GetProfile()). If PerformanceTrace recording is
+	enabled, each refresh and each timed submission is also recorded as a trace event.
+
+	When lazy evaluation is enabled (see SetLazyEvaluation()), a backward sweep over the graph determines which output
+	streams anything actually consumes. Filters with no consumed streams are skipped entirely, and the others are told
+	which of their streams they may leave uncomputed.
+
+	Chains of filters which implement Filter::SetupElementwiseOp() (add, subtract, multiply, invert, clip...) are
+	fused when kernel fusion is enabled: if a node's only in-graph producer is refreshed in the same generation, the
+	producer's task may evaluate the node too, in the same compute shader pass (see RunFusedChain()). Every
+	intermediate waveform is still written, since the GUI may be displaying it, but it is never read back. Inputs
+	holding raw 8 or 16 bit ADC codes (see RawAnalogSamples) are scaled to volts as the shader reads them, so a chain
+	(even of a single op) applied directly to a deep capture never needs a floating point copy of it.
+
+	Tasks are prioritized by the estimated length of the longest path from the node to a sink, based on the recent run
+	times of each node (see GetRunTimes()). Newly runnable tasks are pushed lowest priority first, so each worker
+	continues down the most critical path while idle workers steal the cheapest work.
+
+	Executor threads only schedule nodes (each owns a compute queue and command buffers). Data parallel loops inside
+	a refresh should use ParallelFor(), which runs on the process-wide ThreadPool with the executor thread taking
+	part, rather than opening an OpenMP team per executor thread.
+
+	On NUMA hosts, executor threads are pinned round robin to the nodes, and a newly runnable task whose largest input
+	waveform lives on another node is queued for the workers of that node rather than on the completing worker's own
+	deque. Idle workers steal from workers on their own node first, and only take work queued for another node once
+	nothing else is runnable (see GetPreferredNode()).
+
+	Only the first GetActiveWorkerCount() threads take tasks; the rest sleep. Nodes which submitted GPU work the last
+	time they ran are also limited to GetGpuConcurrencyLimit() at once, since beyond a few of them the extra ones just
+	queue up on the same Vulkan queues. A task over the limit is set aside, without tying up its worker, until a GPU
+	slot frees up. With auto tuning enabled (see SetAutoTuning()) both numbers are adjusted every few generations from
+	the recorded run times: the worker count never exceeds what the critical path of the graph allows, and grows or
+	shrinks with the measured parallel efficiency, while the GPU limit is raised one at a time while tasks are being
+	held back and GPU nodes run no slower than their best, and cut by a quarter once they slow down (see Retune()).
  */
 class FilterGraphExecutor
 {
 public:
-	FilterGraphExecutor(size_t numThreads = 8);
+	FilterGraphExecutor(size_t numThreads = 0);
 	~FilterGraphExecutor();
 
 	void RunBlocking(const std::set<FlowGraphNode*>& nodes);
+	uint64_t RunPipelined(const std::set<FlowGraphNode*>& nodes);
+	void WaitForSequence(uint64_t sequence);
+	void Flush();
+
+	void SetPipelineDepth(size_t depth);
+
+	///@brief Get the maximum number of generations which may be in flight at once in pipelined mode
+	size_t GetPipelineDepth()
+	{ return m_pipelineDepth; }
+
+	///@brief Get the sequence number of the newest generation which, along with all before it, has completed
+	uint64_t GetCompletedSequence()
+	{ return m_completedSequence; }
 
-	FlowGraphNode* GetNextRunnableNode();
+	uint64_t GetNodeSequence(FlowGraphNode* node);
+
+	/**
+		@brief Enables or disables skipping of nodes whose inputs and configuration are unchanged
+
+		Disabling incremental evaluation forces every node to be refreshed on every call to RunBlocking().
+	 */
+	void SetIncrementalEvaluation(bool enable)
+	{ m_incremental = enable; }
+
+	///@brief Checks if incremental evaluation is enabled
+	bool IsIncrementalEvaluationEnabled()
+	{ return m_incremental; }
+
+	/**
+		@brief Enables or disables fusing chains of elementwise math filters into a single compute shader pass
+
+		Takes effect starting with the next generation submitted.
+	 */
+	void SetKernelFusion(bool enable)
+	{ m_fusion = enable; }
+
+	///@brief Checks if kernel fusion is enabled
+	bool IsKernelFusionEnabled()
+	{ return m_fusion; }
+
+	/**
+		@brief Enables or disables lazy evaluation, where only output streams which something consumes are computed
+
+		When enabled, a filter stream is only considered to be in use if it has a consumer registered with
+		Filter::AddStreamConsumer(), or feeds a filter which is itself in use. Filters with no stream in use are not
+		refreshed at all, and multi-stream filters can check Filter::IsStreamDemanded() to skip the rest.
+
+		Takes effect starting with the next generation submitted.
+	 */
+	void SetLazyEvaluation(bool enable)
+	{ m_lazy = enable; }
+
+	///@brief Checks if lazy evaluation is enabled
+	bool IsLazyEvaluationEnabled()
+	{ return m_lazy; }
+
+	///@brief Get the number of nodes scheduled for refresh by the most recently submitted generation
+	size_t GetLastRefreshedNodeCount()
+	{ return m_lastRefreshedNodeCount; }
 
 	///@brief Get the run times of the most recent filter graph evaluation
 	std::map<FlowGraphNode*, int64_t> GetRunTimes()
@@ -61,53 +307,630 @@ public:
 		return m_lastExecutionTime;
 	}
 
+	/**
+		@brief Enables or disables per-node profiling (GPU timestamps, copy volume and pipeline stalls)
+
+		Takes effect for tasks which start after the call.
+	 */
+	void SetProfiling(bool enable)
+	{ m_profiling = enable; }
+
+	///@brief Checks if per-node profiling is enabled
+	bool IsProfilingEnabled()
+	{ return m_profiling; }
+
+	///@brief Get the profiling statistics of every node accumulated since the last call to ResetProfile()
+	std::map<FlowGraphNode*, FilterProfile> GetProfile()
+	{
+		std::lock_guard<std::mutex> lock(m_perfStatsMutex);
+		return m_profile;
+	}
+
+	///@brief Discard all accumulated profiling statistics
+	void ResetProfile()
+	{
+		std::lock_guard<std::mutex> lock(m_perfStatsMutex);
+		m_profile.clear();
+	}
+
+	/**
+		@brief Enables or disables automatic tuning of the worker count and GPU concurrency limit
+
+		Enabled by default if the executor was created with numThreads = 0. Values set with SetActiveWorkerCount() or
+		SetGpuConcurrencyLimit() are only a starting point while tuning is enabled.
+	 */
+	void SetAutoTuning(bool enable)
+	{ m_autoTuning = enable; }
+
+	///@brief Checks if automatic tuning is enabled
+	bool IsAutoTuningEnabled()
+	{ return m_autoTuning; }
+
+	void SetActiveWorkerCount(size_t count);
+
+	///@brief Get the number of worker threads currently allowed to run tasks
+	size_t GetActiveWorkerCount()
+	{ return m_activeWorkers; }
+
+	///@brief Get the number of worker threads, which is the most GetActiveWorkerCount() can be
+	size_t GetMaxWorkerCount()
+	{ return m_threads.size(); }
+
+	void SetGpuConcurrencyLimit(size_t limit);
+
+	///@brief Get the maximum number of GPU-submitting nodes which may be refreshed at once
+	size_t GetGpuConcurrencyLimit()
+	{ return m_gpuLimit; }
+
+	ExecutorTuning GetTuning();
+
 protected:
+	class Generation;
+
+	///@brief Number of workers started with when the thread count is chosen automatically
+	static const size_t INITIAL_WORKERS = 8;
+
+	///@brief Number of generations measured for each tuning decision
+	static const size_t TUNING_WINDOW = 8;
+
+	/**
+		@brief A single refresh of one node in one generation
+	 */
+	class Task
+	{
+	public:
+		Task()
+		: m_node(0)
+		, m_generation(nullptr)
+		, m_readsSources(false)
+		, m_pending(1)
+		, m_complete(false)
+		, m_executionTime(0)
+		, m_priority(0)
+		, m_fusePrev(nullptr)
+		, m_fuseNext(nullptr)
+		, m_fusedBy(nullptr)
+		, m_fusedConfigRevision(0)
+		, m_traceTrack(0)
+		, m_profiled(false)
+		, m_startTime(0)
+		, m_timestampPool(nullptr)
+		, m_uploadBytes(0)
+		, m_readbackBytes(0)
+		, m_pipelineStallTime(0)
+		, m_readbackStarted(false)
+		, m_holdsGpuSlot(false)
+		, m_submittedGpuWork(false)
+		, m_throttleStart(0)
+		, m_throttleTime(0)
+		{}
+
+		///@brief Index of the node in the topology
+		size_t m_node;
+
+		///@brief The generation this task belongs to
+		Generation* m_generation;
+
+		///@brief True if the node consumes data from outside the graph (instrument channels etc)
+		bool m_readsSources;
+
+		///@brief Number of unresolved dependencies, plus one while the task is still being submitted
+		std::atomic<uint32_t> m_pending;
+
+		///@brief Mutex protecting m_dependents and updates to m_complete
+		std::mutex m_mutex;
+
+		///@brief Tasks which cannot start until this one completes
+		std::vector<Task*> m_dependents;
+
+		///@brief True once the task has finished executing
+		std::atomic<bool> m_complete;
+
+		///@brief Execution time of the task, in femtoseconds
+		int64_t m_executionTime;
+
+		///@brief Points which are reached once all GPU work submitted by the task has completed
+		std::vector<QueueTimelinePoint> m_gpuPoints;
+
+		///@brief Estimated time from the start of this task until the end of the longest path through its dependents
+		int64_t m_priority;
+
+		///@brief Streams of the node which are demanded in this generation (empty if all of them)
+		std::vector<uint8_t> m_demand;
+
+		///@brief Task of the node's producer, if this task may be fused into the producer's elementwise chain
+		Task* m_fusePrev;
+
+		///@brief Task of the node's consumer, if it may be fused into this task's elementwise chain
+		Task* m_fuseNext;
+
+		///@brief The task which evaluated this node as part of its elementwise chain, if any
+		Task* m_fusedBy;
+
+		///@brief Configuration revision of the node as of when m_fusedBy set it up
+		uint64_t m_fusedConfigRevision;
+
+		///@brief PerformanceTrace track of the worker thread which ran the task
+		uint64_t m_traceTrack;
+
+		///@brief True if profiling was enabled when the task ran
+		bool m_profiled;
+
+		///@brief Time the refresh started, in the GetTime() timebase
+		double m_startTime;
+
+		///@brief Pool the timestamp queries in m_timestampPairs came from
+		GpuTimestampPool* m_timestampPool;
+
+		///@brief Timestamp query pairs to resolve once the task's GPU work completes
+		std::vector<size_t> m_timestampPairs;
+
+		///@brief Bytes copied from CPU to GPU memory during the refresh
+		uint64_t m_uploadBytes;
+
+		///@brief Bytes copied from GPU to CPU memory during the refresh
+		uint64_t m_readbackBytes;
+
+		///@brief Time spent waiting for pipeline creation during the refresh, in seconds
+		double m_pipelineStallTime;
+
+		///@brief True once readbacks of the node's inputs have been started
+		bool m_readbackStarted;
+
+		///@brief Completion of the readbacks of the node's inputs
+		ReadbackFuture m_readback;
+
+		///@brief True while the task counts against the GPU concurrency limit
+		bool m_holdsGpuSlot;
+
+		///@brief True if the refresh submitted any GPU work
+		bool m_submittedGpuWork;
+
+		///@brief Time the task was last held back by the GPU concurrency limit, or zero if it is not held back
+		double m_throttleStart;
+
+		///@brief Total time the task was held back by the GPU concurrency limit, in seconds
+		double m_throttleTime;
+	};
+
+	/**
+		@brief All of the tasks submitted by one call to RunBlocking() or RunPipelined()
+	 */
+	class Generation
+	{
+	public:
+		Generation(uint64_t sequence, size_t ntasks)
+		: m_sequence(sequence)
+		, m_tasks(std::make_unique<Task[]>(ntasks))
+		, m_taskCount(ntasks)
+		, m_tasksRemaining(ntasks + 1)
+		, m_sourceReadersRemaining(0)
+		{}
+
+		///@brief Sequence number of the generation
+		uint64_t m_sequence;
+
+		///@brief The tasks in the generation
+		std::unique_ptr<Task[]> m_tasks;
+
+		///@brief Number of elements in m_tasks
+		size_t m_taskCount;
+
+		/**
+			@brief Number of tasks which have not yet completed, plus one until their GPU work has also completed
+
+			The thread which completes the last task waits for the GPU before dropping the final reference.
+		 */
+		std::atomic<size_t> m_tasksRemaining;
+
+		///@brief Number of tasks reading data from outside the graph which have not yet completed
+		std::atomic<size_t> m_sourceReadersRemaining;
+	};
+
+	/**
+		@brief Command buffers for one worker thread, each of which is reused once the GPU is done with it
+	 */
+	class CommandBufferPool
+	{
+	public:
+		CommandBufferPool(std::shared_ptr<QueueHandle> queue, const std::string& name);
+
+		vk::raii::CommandBuffer& Acquire();
+		void Release(const std::vector<QueueTimelinePoint>& busyUntil);
+
+	protected:
+		///@brief Maximum number of command buffers in flight before we wait for the oldest
+		static const size_t MAX_BUFFERS = 8;
+
+		///@brief Name prefix for debug labels
+		std::string m_name;
+
+		///@brief The pool buffers are allocated from
+		vk::raii::CommandPool m_pool;
+
+		///@brief All allocated command buffers
+		std::vector<std::unique_ptr<vk::raii::CommandBuffer>> m_buffers;
+
+		///@brief Points which must be reached before each buffer can be reused
+		std::vector<std::vector<QueueTimelinePoint>> m_busyUntil;
+
+		///@brief Index of the buffer most recently returned by Acquire()
+		size_t m_current;
+
+		///@brief Next buffer to evict if everything is busy
+		size_t m_next;
+	};
+
 	static void ExecutorThread(FilterGraphExecutor* pThis, size_t i);
 	void DoExecutorThread(size_t i);
+	void RunTask(
+		Task* task,
+		CommandBufferPool& pool,
+		std::shared_ptr<QueueHandle> queue,
+		ComputePipeline& fusedPipeline,
+		GpuTimestampPool& timestamps);
+	static bool HasRawInput(FlowGraphNode* node);
+	bool RunFusedChain(
+		Task* task,
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue,
+		ComputePipeline& fusedPipeline);
 
-	void UpdateRunnable();
+	uint64_t Submit(const std::set<FlowGraphNode*>& nodes);
+	bool AddDependency(Task* task, Task* dependency);
+	void PlanFusion(Task* task);
+	void UpdatePriorities();
+	void ExpandRawInputs();
+	void RetireGenerations();
+	void UpdateProfile(Generation* gen);
+	size_t GetGenerationsInFlight();
 
-	///@brief Mutex for access to shared state
-	std::mutex m_mutex;
+	bool GetNextRunnableTask(size_t i, Task*& task);
+	bool StartInputReadback(Task* task);
+	void ParkTask(Task* task);
+	void ResumeParkedTasks(size_t i);
+	void OnTaskComplete(size_t i, Task* task);
+	void PushRunnable(size_t i, Task* task);
+	void InjectRunnable(Task* task);
+	void PushToNode(int node, Task* task);
+	int GetPreferredNode(Task* task);
+	void WakeIdleWorker(bool all);
+	void NotifyCompletion();
 
-	///@brief Nodes that have not yet been updated
-	std::set<FlowGraphNode*> m_incompleteNodes;
+	bool AcquireGpuSlot(Task* task);
+	void ReleaseGpuSlot(size_t i, Task* task);
+	void ReleaseThrottledTasks();
+	void RecordTuningSample(Generation* gen);
+	void Retune();
+	void RegisterWorkerQueue(QueueHandle* queue);
 
-	///@brief Nodes that have no dependencies and are eligible to run now
-	std::set<FlowGraphNode*> m_runnableNodes;
+	bool IsTopologyCurrent(const std::set<FlowGraphNode*>& nodes);
+	void UpdateTopology(const std::set<FlowGraphNode*>& nodes);
+	void ResizeReadyQueues();
 
-	///@brief Nodes that are actively being run
-	std::set<FlowGraphNode*> m_runningNodes;
+	void FindDemandedStreams();
+	size_t FindDirtyNodes();
+	bool IsNodeStale(size_t node);
+	void SaveNodeState(size_t node, uint64_t configRevision, const std::vector<uint8_t>& demand);
+	void SuppressUnchangedOutputs(size_t node);
 
-	///@brief Set of thread contexts
-	std::vector<std::unique_ptr<std::thread>> m_threads;
+	/**
+		@brief State of a single input edge as of the last time its sink was refreshed
+	 */
+	class InputState
+	{
+	public:
+		InputState()
+		: m_scalar(0)
+		{}
+
+		explicit InputState(StreamDescriptor stream)
+		: m_scalar(0)
+		{
+			auto data = stream.GetData();
+			if(data)
+				m_key = WaveformCacheKey(data);
+			else
+				m_scalar = stream.GetScalarValue();
+		}
+
+		bool operator!=(const InputState& rhs)
+		{ return (m_key != rhs.m_key) || (m_scalar != rhs.m_scalar); }
+
+		///@brief Waveform pointer and revision (null for scalar or unconnected inputs)
+		WaveformCacheKey m_key;
+
+		///@brief Scalar value of the input (only meaningful if there is no waveform)
+		float m_scalar;
+	};
+
+	/**
+		@brief Cached dependency graph for the most recently executed set of nodes
+
+		All per-node state is stored in parallel arrays indexed by position in m_nodes
+	 */
+	class Topology
+	{
+	public:
+		///@brief The node set this topology was computed for
+		std::set<FlowGraphNode*> m_nodeSet;
+
+		///@brief Nodes to execute, in topological order
+		std::vector<FlowGraphNode*> m_nodes;
+
+		///@brief Index of each node in m_nodes
+		std::map<FlowGraphNode*, size_t> m_indexes;
+
+		///@brief Input connections of each node at the time the topology was computed (used for change detection)
+		std::vector< std::vector<FlowGraphNode*> > m_inputs;
+
+		///@brief True if the input at the same position in m_inputs is driven by a node inside the graph
+		std::vector< std::vector<uint8_t> > m_inputIsInternal;
+
+		///@brief Indexes of nodes which consume the output of each node
+		std::vector< std::vector<size_t> > m_consumers;
+
+		///@brief Indexes of in-graph nodes which each node consumes the output of
+		std::vector< std::vector<size_t> > m_producers;
+
+		///@brief Each node as an InstrumentChannel (null if it has no output streams)
+		std::vector<InstrumentChannel*> m_channels;
+
+		///@brief True if the node reads data from at least one source outside the graph
+		std::vector<uint8_t> m_readsSources;
+	};
+
+	///@brief The current graph topology
+	Topology m_topology;
+
+	///@brief Nonzero if a node needs to be refreshed in the generation being submitted
+	std::vector<uint8_t> m_dirty;
+
+	///@brief Nonzero if anything uses the output of a node in the generation being submitted
+	std::vector<uint8_t> m_live;
+
+	///@brief Streams of each node demanded in the generation being submitted (empty if all of them)
+	std::vector< std::vector<uint8_t> > m_demand;
+
+	///@brief Moving average of the run time of each node, in femtoseconds (used for prioritization)
+	std::vector<int64_t> m_nodeCost;
+
+	///@brief Critical path length from each node to the end of the generation being submitted, in femtoseconds
+	std::vector<int64_t> m_priority;
+
+	///@brief Shortest recent run time of each node, in femtoseconds (slowly forgotten, so it follows input size)
+	std::vector<int64_t> m_nodeBestCost;
+
+	///@brief Nonzero if a node submitted GPU work the last time it ran (or, before that, if it wants GPU inputs)
+	std::unique_ptr<std::atomic<uint8_t>[]> m_nodeUsesGpu;
+
+	///@brief Most recently submitted task for each node, or null if it belongs to a retired generation
+	std::vector<Task*> m_lastTask;
+
+	///@brief Sequence number of the most recent generation in which each node was refreshed
+	std::unique_ptr<std::atomic<uint64_t>[]> m_nodeSequence;
+
+	/**
+		@brief Points which are reached once the GPU work of each node's most recent refresh has completed
+
+		Only written by a task of the node itself, and only read by tasks which are ordered against it by a dependency
+		edge, so no locking is needed.
+	 */
+	std::vector< std::vector<QueueTimelinePoint> > m_gpuPoints;
+
+	///@brief Mutex protecting the per-node incremental evaluation state below
+	std::mutex m_stateMutex;
+
+	///@brief True if a node has been refreshed at least once since the topology last changed
+	std::vector<uint8_t> m_hasRun;
+
+	///@brief State of each node's inputs as of its last refresh
+	std::vector< std::vector<InputState> > m_lastInputState;
 
-	///@brief Condition variable for waking up worker threads when work arrives
-	std::condition_variable m_workerCvar;
+	///@brief Key of each node's output waveforms as of its last refresh
+	std::vector< std::vector<WaveformCacheKey> > m_lastOutputState;
 
-	///@brief Mutex for access to m_workerCvar
-	std::mutex m_workerCvarMutex;
+	///@brief Content hash of each node's output waveforms as of its last refresh (zero if not hashed)
+	std::vector< std::vector<uint64_t> > m_lastOutputHash;
 
-	///@brief Condition variable for waking up main thread when work is complete
+	///@brief Configuration revision of each node as of its last refresh
+	std::vector<uint64_t> m_lastConfigRevision;
+
+	///@brief Streams demanded by each node's last refresh (empty if all of them)
+	std::vector< std::vector<uint8_t> > m_lastDemand;
+
+	///@brief True if incremental evaluation is enabled
+	std::atomic<bool> m_incremental;
+
+	///@brief True if kernel fusion is enabled
+	std::atomic<bool> m_fusion;
+
+	///@brief True if per-node profiling is enabled
+	std::atomic<bool> m_profiling;
+
+	///@brief True if lazy evaluation is enabled
+	std::atomic<bool> m_lazy;
+
+	///@brief Number of nodes scheduled by the most recently submitted generation
+	size_t m_lastRefreshedNodeCount;
+
+	///@brief Mutex serializing calls from client threads into the submission API
+	std::recursive_mutex m_submitMutex;
+
+	///@brief Generations which have been submitted but not yet retired, oldest first
+	std::deque<std::unique_ptr<Generation>> m_generations;
+
+	///@brief Sequence number to be assigned to the next generation
+	uint64_t m_nextSequence;
+
+	///@brief Sequence number of the newest generation which, along with all before it, has completed
+	std::atomic<uint64_t> m_completedSequence;
+
+	///@brief Maximum number of generations in flight in pipelined mode
+	size_t m_pipelineDepth;
+
+	///@brief Per-thread queues of tasks that are ready to run
+	std::vector<std::unique_ptr<WorkStealingDeque<Task*>>> m_readyQueues;
+
+	///@brief Capacity the ready queues were last sized for
+	size_t m_readyQueueCapacity;
+
+	///@brief Ready tasks submitted from outside the worker threads
+	std::deque<Task*> m_injectedTasks;
+
+	///@brief Mutex for access to m_injectedTasks
+	std::mutex m_injectedTasksMutex;
+
+	/**
+		@brief Ready tasks waiting for a worker on a particular NUMA node
+	 */
+	class NodeQueue
+	{
+	public:
+		///@brief Mutex for access to m_tasks
+		std::mutex m_mutex;
+
+		///@brief The tasks, oldest first
+		std::deque<Task*> m_tasks;
+	};
+
+	///@brief Ready tasks for each NUMA node (empty if the host isn't NUMA)
+	std::vector<std::unique_ptr<NodeQueue>> m_nodeQueues;
+
+	///@brief NUMA node each worker thread is pinned to, or -1 if not pinned
+	std::vector<int> m_workerNodes;
+
+	///@brief Order in which each worker tries to steal from the others: workers on its own node first
+	std::vector< std::vector<size_t> > m_stealOrder;
+
+	///@brief Number of tasks currently sitting in a ready queue
+	std::atomic<size_t> m_tasksReady;
+
+	///@brief Number of worker threads currently looking through the ready queues
+	std::atomic<size_t> m_searchingWorkers;
+
+	///@brief Number of worker threads sleeping while waiting for tasks to become ready
+	std::atomic<size_t> m_idleWorkers;
+
+	///@brief Tasks waiting for readbacks of their inputs to complete
+	std::vector<Task*> m_parkedTasks;
+
+	///@brief Mutex for access to m_parkedTasks
+	std::mutex m_parkedTasksMutex;
+
+	///@brief Number of tasks in m_parkedTasks
+	std::atomic<size_t> m_parkedTaskCount;
+
+	///@brief Condition variable for waking up idle workers when a task becomes ready
+	std::condition_variable m_idleCvar;
+
+	///@brief Mutex for access to m_idleCvar
+	std::mutex m_idleCvarMutex;
+
+	///@brief Set of thread contexts
+	std::vector<std::unique_ptr<std::thread>> m_threads;
+
+	///@brief Condition variable for waking up the submitting thread when a generation (or its source reads) completes
 	std::condition_variable m_completionCvar;
 
 	///@brief Mutex for access to m_completionCvar
 	std::mutex m_completionCvarMutex;
 
-	///@brief Indicates that all worker threads have finished executing this pass
-	bool m_allWorkersComplete;
-
 	///@brief Shutdown flag
 	bool m_terminating;
 
 	///@brief Performance statistics from previous execution
 	std::map<FlowGraphNode*, int64_t> m_lastExecutionTime;
 
-	///@brief Performance statistics from current execution
-	std::map<FlowGraphNode*, int64_t> m_currentExecutionTime;
+	///@brief Profiling statistics accumulated since the last ResetProfile()
+	std::map<FlowGraphNode*, FilterProfile> m_profile;
 
 	///@brief Mutex for updating performance statistics
 	std::mutex m_perfStatsMutex;
+
+	///@brief True if the worker count and GPU concurrency limit are tuned automatically
+	std::atomic<bool> m_autoTuning;
+
+	///@brief Number of worker threads allowed to run tasks (the first m_activeWorkers of m_threads)
+	std::atomic<size_t> m_activeWorkers;
+
+	///@brief Condition variable for waking up workers parked because they are beyond m_activeWorkers
+	std::condition_variable m_inactiveCvar;
+
+	///@brief Maximum number of GPU-submitting tasks which may run at once
+	std::atomic<size_t> m_gpuLimit;
+
+	///@brief Number of tasks currently holding a GPU slot
+	size_t m_gpuTasksRunning;
+
+	///@brief Largest value of m_gpuTasksRunning since the last tuning decision
+	size_t m_peakGpuTasks;
+
+	///@brief Tasks held back by the GPU concurrency limit
+	std::vector<Task*> m_throttledTasks;
+
+	///@brief Mutex for access to m_gpuTasksRunning, m_peakGpuTasks and m_throttledTasks
+	std::mutex m_gpuSlotMutex;
+
+	///@brief Number of tasks held back by the GPU concurrency limit since the last tuning decision
+	std::atomic<size_t> m_throttleEvents;
+
+	/**
+		@brief Measurements accumulated over the generations retired since the last tuning decision
+	 */
+	class TuningWindow
+	{
+	public:
+		TuningWindow()
+		{ Clear(); }
+
+		void Clear()
+		{
+			m_generations = 0;
+			m_busyTime = 0;
+			m_wallTime = 0;
+			m_lastEnd = 0;
+			m_criticalPath = 0;
+			m_gpuTime = 0;
+			m_gpuBestTime = 0;
+		}
+
+		///@brief Number of generations retired
+		size_t m_generations;
+
+		///@brief Total run time of all tasks, in seconds
+		double m_busyTime;
+
+		///@brief Wall clock time during which at least one generation was running, in seconds
+		double m_wallTime;
+
+		///@brief End of the most recent generation, in the GetTime() timebase
+		double m_lastEnd;
+
+		///@brief Sum of the critical path lengths of every generation, in seconds
+		double m_criticalPath;
+
+		///@brief Total run time of GPU-submitting tasks, in femtoseconds
+		double m_gpuTime;
+
+		///@brief Sum of the best recent run times of the nodes of the GPU-submitting tasks, in femtoseconds
+		double m_gpuBestTime;
+	};
+
+	///@brief Measurements towards the next tuning decision
+	TuningWindow m_tuningWindow;
+
+	///@brief The state reported by GetTuning()
+	ExecutorTuning m_tuning;
+
+	///@brief True once the GPU concurrency limit has been set by hand or by the tuner, rather than seeded
+	bool m_gpuLimitChosen;
+
+	///@brief Distinct compute queues used by the worker threads
+	std::set<QueueHandle*> m_workerQueues;
+
+	///@brief Mutex for access to m_tuning, m_gpuLimitChosen and m_workerQueues
+	std::mutex m_tuningMutex;
 };
 
 #endif
@@ -0,0 +1,265 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of FilterGraphLoader
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "FilterGraphLoader.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Prepares to load a set of filters
+
+	@param filters	Map of filter configurations, one per filter, each with at least "id" and "protocol" fields
+					(the "filters" section of a session file)
+ */
+FilterGraphLoader::FilterGraphLoader(const YAML::Node& filters)
+{
+	for(auto it : filters)
+	{
+		Entry e;
+		e.m_node = YAML::Clone(it.second);
+		e.m_id = e.m_node["id"].as<uintptr_t>();
+
+		//Inputs are formatted as %d/%d, same as FlowGraphNode::LoadInputs()
+		for(auto jt : e.m_node["inputs"])
+			e.m_inputIDs.push_back(strtoull(jt.second.as<string>().c_str(), nullptr, 10));
+
+		m_entries.push_back(std::move(e));
+	}
+}
+
+/**
+	@brief Waits for any background work to finish
+
+	If Finish() was never called, filters which were created are released.
+ */
+FilterGraphLoader::~FilterGraphLoader()
+{
+	if(m_thread.joinable())
+		m_thread.join();
+
+	if(m_filters.empty())
+	{
+		for(auto& e : m_entries)
+		{
+			if(e.m_filter)
+				e.m_filter->Release();
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Loading
+
+/**
+	@brief Starts constructing the filters and loading their parameters in the background
+ */
+void FilterGraphLoader::Start()
+{
+	m_thread = thread(&FilterGraphLoader::ConstructAll, this);
+}
+
+/**
+	@brief Constructs every filter, then loads every filter's parameters, each in parallel
+ */
+void FilterGraphLoader::ConstructAll()
+{
+	#ifdef __linux__
+	pthread_setname_np(pthread_self(), "FilterLoader");
+	#endif
+
+	//Keep going after a failure so every filter we did create is in a consistent state, but remember the first error
+	auto fail = [this]
+	{
+		lock_guard<mutex> lock(m_errorMutex);
+		if(!m_error)
+			m_error = current_exception();
+	};
+
+	ParallelFor(0, m_entries.size(), 1, [&](size_t begin, size_t end)
+	{
+		for(size_t i=begin; i<end; i++)
+		{
+			auto& node = m_entries[i].m_node;
+			try
+			{
+				m_entries[i].m_filter = Filter::CreateFilter(
+					node["protocol"].as<string>(),
+					node["color"] ? node["color"].as<string>() : "#ffffff");
+			}
+			catch(...)
+			{
+				fail();
+			}
+		}
+	});
+
+	for(auto& e : m_entries)
+	{
+		if(e.m_filter)
+			m_localTable.emplace(e.m_id, e.m_filter);
+	}
+
+	ParallelFor(0, m_entries.size(), 1, [&](size_t begin, size_t end)
+	{
+		for(size_t i=begin; i<end; i++)
+		{
+			auto f = m_entries[i].m_filter;
+			if(!f)
+				continue;
+
+			try
+			{
+				f->LoadParameters(m_entries[i].m_node, m_localTable);
+			}
+			catch(...)
+			{
+				fail();
+			}
+		}
+	});
+}
+
+/**
+	@brief Waits for Start() to complete, then registers the filters and connects their inputs
+
+	Instrument channels and anything else the filters take input from must already be in the table.
+	Calls Start() first if it hasn't been already.
+
+	@param table	The session's ID table
+ */
+void FilterGraphLoader::Finish(IDTable& table)
+{
+	if(!m_thread.joinable())
+		Start();
+	m_thread.join();
+
+	if(m_error)
+		rethrow_exception(m_error);
+
+	for(auto& e : m_entries)
+	{
+		if(!e.m_filter)
+			continue;
+		table.emplace(e.m_id, e.m_filter);
+		m_filters.push_back(e.m_filter);
+	}
+
+	for(auto i : GetInputOrder())
+		m_entries[i].m_filter->LoadInputs(m_entries[i].m_node, table);
+}
+
+/**
+	@brief Orders the filters so every filter comes after every other filter it takes input from
+
+	Ties are broken by file order. Cycles (which a valid session can't contain) are broken by falling back to file
+	order for the filters involved.
+
+	@return Indexes into m_entries of every filter which was created
+ */
+vector<size_t> FilterGraphLoader::GetInputOrder()
+{
+	map<uintptr_t, size_t> indexes;
+	for(size_t i=0; i<m_entries.size(); i++)
+	{
+		if(m_entries[i].m_filter)
+			indexes[m_entries[i].m_id] = i;
+	}
+
+	//Count in-set producers of each filter, and list the consumers of each
+	vector<size_t> pending(m_entries.size(), 0);
+	vector< vector<size_t> > consumers(m_entries.size());
+	for(auto it : indexes)
+	{
+		size_t i = it.second;
+		set<size_t> producers;
+		for(auto id : m_entries[i].m_inputIDs)
+		{
+			auto jt = indexes.find(id);
+			if( (jt != indexes.end()) && (jt->second != i) )
+				producers.emplace(jt->second);
+		}
+		pending[i] = producers.size();
+		for(auto p : producers)
+			consumers[p].push_back(i);
+	}
+
+	//Kahn's algorithm, lowest index first
+	vector<size_t> order;
+	vector<uint8_t> done(m_entries.size(), 0);
+	set<size_t> ready;
+	for(auto it : indexes)
+	{
+		if(pending[it.second] == 0)
+			ready.emplace(it.second);
+	}
+	while(order.size() < indexes.size())
+	{
+		//Stuck on a cycle? Break it at the first filter left
+		if(ready.empty())
+		{
+			for(size_t i=0; i<m_entries.size(); i++)
+			{
+				if(m_entries[i].m_filter && !done[i])
+				{
+					ready.emplace(i);
+					break;
+				}
+			}
+		}
+
+		size_t i = *ready.begin();
+		ready.erase(ready.begin());
+		if(done[i])
+			continue;
+		done[i] = 1;
+		order.push_back(i);
+
+		for(auto c : consumers[i])
+		{
+			if(!done[c] && (--pending[c] == 0) )
+				ready.emplace(c);
+		}
+	}
+
+	return order;
+}
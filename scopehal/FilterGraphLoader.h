@@ -0,0 +1,132 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of FilterGraphLoader
+	@ingroup core
+ */
+
+#ifndef FilterGraphLoader_h
+#define FilterGraphLoader_h
+
+#include <exception>
+#include <thread>
+
+/**
+	@brief Reconstructs the filters of a saved session in parallel, overlapped with whatever the caller does meanwhile
+	@ingroup core
+
+	Loading a large session one filter at a time spends most of its time in things which don't depend on any other
+	filter: constructors, and LoadParameters() (which for import filters parses the file). The loader works in two
+	halves:
+
+	* Start() returns immediately, having kicked off a background thread which constructs every filter and loads its
+	  parameters, both spread across the ThreadPool. Compute pipelines are not created here, since ComputePipeline
+	  defers creation to the PipelineWarmupQueue. Meanwhile the caller can connect to instruments.
+	* Finish() waits for that, adds each filter to the caller's IDTable under its saved ID, then connects inputs one
+	  filter at a time in dependency order (producers before consumers), so every filter sees its inputs fully set up.
+
+	The YAML is parsed once by the caller. Each filter's subtree is cloned up front, since yaml-cpp nodes sharing one
+	document may not be read from several threads at once.
+
+	During Start(), the IDTable passed to LoadParameters() only contains the filters being loaded. No filter in the
+	tree refers to other objects while loading parameters; any which needs to has to do so in LoadInputs().
+
+	Exceptions thrown while constructing or configuring filters (e.g. malformed YAML) are rethrown by Finish().
+ */
+class FilterGraphLoader
+{
+public:
+	FilterGraphLoader(const YAML::Node& filters);
+	~FilterGraphLoader();
+
+	//non-copyable
+	FilterGraphLoader(const FilterGraphLoader&) = delete;
+	FilterGraphLoader& operator=(const FilterGraphLoader&) = delete;
+
+	void Start();
+	void Finish(IDTable& table);
+
+	/**
+		@brief Gets the filters created, in file order (only valid after Finish())
+
+		Filters which could not be created (unknown protocol) are left out. The caller owns the references.
+	 */
+	const std::vector<Filter*>& GetFilters()
+	{ return m_filters; }
+
+protected:
+	void ConstructAll();
+	std::vector<size_t> GetInputOrder();
+
+	/**
+		@brief One filter being loaded
+	 */
+	class Entry
+	{
+	public:
+		Entry()
+		: m_id(0)
+		, m_filter(nullptr)
+		{}
+
+		///@brief Private copy of the filter's configuration
+		YAML::Node m_node;
+
+		///@brief ID of the filter in the session file
+		uintptr_t m_id;
+
+		///@brief The filter (null if construction failed, or hasn't happened yet)
+		Filter* m_filter;
+
+		///@brief IDs of every object the filter takes input from
+		std::vector<uintptr_t> m_inputIDs;
+	};
+
+	///@brief The filters being loaded, in file order
+	std::vector<Entry> m_entries;
+
+	///@brief Table mapping saved IDs to the new filters, for use during Start()
+	IDTable m_localTable;
+
+	///@brief Background thread started by Start()
+	std::thread m_thread;
+
+	///@brief First exception thrown on a worker thread, if any
+	std::exception_ptr m_error;
+
+	///@brief Mutex protecting m_error
+	std::mutex m_errorMutex;
+
+	///@brief The filters, in file order (filled in by Finish())
+	std::vector<Filter*> m_filters;
+};
+
+#endif
@@ -42,6 +42,8 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // FilterParameter
 
+atomic<uint64_t> FilterParameter::m_nextRevision(1);
+
 /**
 	@brief Creates a parameter
 
@@ -57,6 +59,7 @@ FilterParameter::FilterParameter(ParameterTypes type, Unit unit)
 	, m_string("")
 	, m_hidden(false)
 	, m_readOnly(false)
+	, m_revision(0)
 {
 
 }
@@ -216,7 +219,7 @@ void FilterParameter::ParseString(const string& str, bool useDisplayLocale)
 			break;
 	}
 
-	m_changeSignal.emit();
+	NotifyChanged();
 }
 
 /**
@@ -298,7 +301,7 @@ void FilterParameter::SetBoolVal(bool b)
 	m_string = b ? "1" : "0";
 	m_8b10bPattern.clear();
 
-	m_changeSignal.emit();
+	NotifyChanged();
 }
 
 /**
@@ -314,7 +317,7 @@ void FilterParameter::SetIntVal(int64_t i)
 	if(m_reverseEnumMap.find(i) != m_reverseEnumMap.end())
 		m_string = m_reverseEnumMap[i];
 
-	m_changeSignal.emit();
+	NotifyChanged();
 }
 
 /**
@@ -327,7 +330,7 @@ void FilterParameter::SetFloatVal(float f)
 	m_string = "";
 	m_8b10bPattern.clear();
 
-	m_changeSignal.emit();
+	NotifyChanged();
 }
 
 /**
@@ -348,7 +351,7 @@ void FilterParameter::SetFileName(const string& f)
 	m_string = f;
 	m_8b10bPattern.clear();
 
-	m_changeSignal.emit();
+	NotifyChanged();
 }
 
 void FilterParameter::Set8B10BPattern(const vector<T8B10BSymbol>& pattern)
@@ -358,5 +361,14 @@ void FilterParameter::Set8B10BPattern(const vector<T8B10BSymbol>& pattern)
 	m_8b10bPattern = pattern;
 	m_string = ToString();
 
+	NotifyChanged();
+}
+
+/**
+	@brief Assigns a new revision number and notifies listeners that the value has changed
+ */
+void FilterParameter::NotifyChanged()
+{
+	m_revision = AllocateRevision();
 	m_changeSignal.emit();
 }
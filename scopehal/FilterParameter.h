@@ -37,6 +37,8 @@
 #ifndef FilterParameter_h
 #define FilterParameter_h
 
+#include <atomic>
+
 /**
 	@brief An 8B/10B symbol within a pattern, used for trigger matching
 	@ingroup core
@@ -243,7 +245,22 @@ public:
 	bool IsReadOnly()
 	{ return m_readOnly; }
 
+	/**
+		@brief Returns the revision number of the parameter's value.
+
+		Revision numbers are allocated from a global counter every time any parameter changes, so they are unique
+		across all parameters and strictly increasing.
+	 */
+	uint64_t GetRevision() const
+	{ return m_revision; }
+
+	///@brief Allocates a new, globally unique revision number
+	static uint64_t AllocateRevision()
+	{ return m_nextRevision.fetch_add(1); }
+
 protected:
+	void NotifyChanged();
+
 	ParameterTypes				m_type;
 
 	sigc::signal<void()>		m_changeSignal;
@@ -262,6 +279,12 @@ protected:
 
 	bool						m_hidden;
 	bool						m_readOnly;
+
+	///@brief Revision number of the current value (see GetRevision())
+	uint64_t					m_revision;
+
+	///@brief Next revision number to allocate
+	static std::atomic<uint64_t>	m_nextRevision;
 };
 
 #endif
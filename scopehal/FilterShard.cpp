@@ -0,0 +1,1240 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of FilterShard
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "FilterShard.h"
+#include "WaveformCodec.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+using namespace std;
+
+vector<string> FilterShard::m_workerCommand;
+mutex FilterShard::m_workerCommandMutex;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Control protocol
+
+/**
+	@brief Messages on the control socket between a shard and its worker
+ */
+enum ShardOpcode
+{
+	///@brief Shard to worker: subgraph configuration (YAML), plus one buffer descriptor per input and output
+	SHARD_CONFIG,
+
+	///@brief Worker to shard: subgraph loaded, payload describes the output streams (YAML)
+	SHARD_READY,
+
+	///@brief Worker to shard: something went wrong, payload is the error message
+	SHARD_ERROR,
+
+	///@brief Shard to worker: inputs have been written (or, for remote workers, are the payload), refresh the subgraph
+	SHARD_REFRESH,
+
+	///@brief Worker to shard: outputs have been written (or, for remote workers, compute time then the outputs)
+	SHARD_DONE,
+
+	///@brief Shard to worker: shut down
+	SHARD_EXIT
+};
+
+struct __attribute__((packed)) ShardMessageHeader
+{
+	uint32_t m_opcode;
+	uint32_t m_fdCount;
+	uint64_t m_len;
+};
+
+///@brief Maximum number of descriptors sent with one message
+static const size_t SHARD_MAX_FDS = 250;
+
+#ifdef __linux__
+
+/**
+	@brief Sends a message, optionally passing file descriptors along with it
+ */
+static bool SendShardMessage(int sock, uint32_t opcode, const void* payload, size_t len, const vector<int>& fds = {})
+{
+	if(fds.size() > SHARD_MAX_FDS)
+		return false;
+
+	ShardMessageHeader header;
+	header.m_opcode = opcode;
+	header.m_fdCount = fds.size();
+	header.m_len = len;
+
+	iovec iov;
+	iov.iov_base = &header;
+	iov.iov_len = sizeof(header);
+
+	msghdr msg = {};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+
+	//Descriptors ride along with the header
+	vector<uint8_t> control;
+	if(!fds.empty())
+	{
+		control.resize(CMSG_SPACE(fds.size() * sizeof(int)));
+		msg.msg_control = control.data();
+		msg.msg_controllen = control.size();
+
+		auto cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(fds.size() * sizeof(int));
+		memcpy(CMSG_DATA(cmsg), fds.data(), fds.size() * sizeof(int));
+	}
+
+	if(sendmsg(sock, &msg, MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(header)))
+		return false;
+
+	auto p = static_cast<const uint8_t*>(payload);
+	size_t done = 0;
+	while(done < len)
+	{
+		auto n = send(sock, p + done, len - done, MSG_NOSIGNAL);
+		if(n <= 0)
+			return false;
+		done += n;
+	}
+	return true;
+}
+
+static bool SendShardMessage(int sock, uint32_t opcode, const string& payload, const vector<int>& fds = {})
+{
+	return SendShardMessage(sock, opcode, payload.data(), payload.size(), fds);
+}
+
+/**
+	@brief Receives a message
+
+	@param sock			The socket
+	@param opcode		Opcode of the message
+	@param payload		Payload of the message
+	@param fds			Descriptors received with the message (the caller owns them)
+	@param timeoutMs	Maximum time to wait for the start of the message, or negative to wait forever
+
+	@return False on timeout, error, or if the peer closed the socket
+ */
+static bool RecvShardMessage(int sock, uint32_t& opcode, string& payload, vector<int>& fds, int timeoutMs)
+{
+	pollfd pfd;
+	pfd.fd = sock;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if(poll(&pfd, 1, timeoutMs) <= 0)
+		return false;
+
+	ShardMessageHeader header;
+	iovec iov;
+	iov.iov_base = &header;
+	iov.iov_len = sizeof(header);
+
+	vector<uint8_t> control(CMSG_SPACE(SHARD_MAX_FDS * sizeof(int)));
+	msghdr msg = {};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.data();
+	msg.msg_controllen = control.size();
+
+	if(recvmsg(sock, &msg, MSG_WAITALL | MSG_CMSG_CLOEXEC) != static_cast<ssize_t>(sizeof(header)))
+		return false;
+
+	fds.clear();
+	for(auto cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+	{
+		if( (cmsg->cmsg_level != SOL_SOCKET) || (cmsg->cmsg_type != SCM_RIGHTS) )
+			continue;
+		size_t n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		size_t base = fds.size();
+		fds.resize(base + n);
+		memcpy(&fds[base], CMSG_DATA(cmsg), n * sizeof(int));
+	}
+
+	opcode = header.m_opcode;
+	payload.resize(header.m_len);
+	size_t done = 0;
+	while(done < payload.size())
+	{
+		auto n = recv(sock, &payload[done], payload.size() - done, MSG_WAITALL);
+		if(n <= 0)
+			return false;
+		done += n;
+	}
+	return true;
+}
+
+#endif
+
+/**
+	@brief Parses an "id/stream" reference as used in session files (stream may be omitted)
+ */
+static FilterShard::Output ParseStreamRef(const string& s)
+{
+	int id = 0;
+	int stream = 0;
+	if(2 != sscanf(s.c_str(), "%d/%d", &id, &stream))
+	{
+		id = atoi(s.c_str());
+		stream = 0;
+	}
+	return FilterShard::Output(id, stream);
+}
+
+///@brief Updates a running estimate with a new measurement (an estimate which is negative or infinite has none yet)
+static double UpdateEstimate(double estimate, double sample)
+{
+	if( (estimate < 0) || isinf(estimate) )
+		return sample;
+	return estimate*0.75 + sample*0.25;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Subgraph hosting
+
+/**
+	@brief Stands in for a channel outside the subgraph
+ */
+class ShardInputChannel : public OscilloscopeChannel
+{
+public:
+	ShardInputChannel(uintptr_t id, Unit xunit)
+	: OscilloscopeChannel(nullptr, "ShardInput" + to_string(id), "#ffffff", xunit, 0)
+	{
+		ClearStreams();
+	}
+
+	void EnsureStream(size_t stream, Unit yunit, Stream::StreamType type)
+	{
+		while(GetStreamCount() <= stream)
+			AddStream(yunit, "data" + to_string(GetStreamCount()), type);
+	}
+};
+
+/**
+	@brief A subgraph loaded from a shard configuration, with placeholder channels for its external inputs
+
+	Used by workers, and by remote shards to run the subgraph in the shard's own process.
+ */
+class FilterShardHost
+{
+public:
+	FilterShardHost()
+	: m_executor(4)
+	{}
+
+	~FilterShardHost()
+	{
+		for(auto f : m_filters)
+			f->Release();
+		for(auto it : m_placeholders)
+			delete it.second;
+	}
+
+	bool Load(const YAML::Node& config, string& err);
+	YAML::Node DescribeOutputs();
+
+	///@brief Runs the subgraph
+	void Run()
+	{ m_executor.RunBlocking(m_nodes); }
+
+	///@brief Gets the placeholder channel and stream for an input
+	pair<ShardInputChannel*, size_t>& GetInput(size_t i)
+	{ return m_inputs[i]; }
+
+	///@brief Gets the filter and stream for an output
+	pair<Filter*, size_t>& GetOutput(size_t i)
+	{ return m_outputs[i]; }
+
+	size_t GetInputCount()
+	{ return m_inputs.size(); }
+
+	size_t GetOutputCount()
+	{ return m_outputs.size(); }
+
+	FilterGraphExecutor& GetExecutor()
+	{ return m_executor; }
+
+protected:
+	///@brief Placeholders for objects outside the subgraph, by ID
+	map<uintptr_t, ShardInputChannel*> m_placeholders;
+
+	///@brief Placeholder stream for each input
+	vector<pair<ShardInputChannel*, size_t>> m_inputs;
+
+	///@brief Filter stream for each output
+	vector<pair<Filter*, size_t>> m_outputs;
+
+	///@brief The filters in the subgraph (we hold a reference to each)
+	vector<Filter*> m_filters;
+
+	///@brief The filters in the subgraph, for the executor
+	set<FlowGraphNode*> m_nodes;
+
+	FilterGraphExecutor m_executor;
+};
+
+/**
+	@brief Creates the placeholders, loads the subgraph, and finds the outputs
+
+	@param config	Configuration from FilterShard::GetConfig()
+	@param err		Error message, if loading failed
+
+	@return True on success
+ */
+bool FilterShardHost::Load(const YAML::Node& config, string& err)
+{
+	//Stand-ins for whatever feeds the subgraph in the main process
+	IDTable table;
+	for(auto in : config["inputs"])
+	{
+		auto id = in["id"].as<uintptr_t>();
+		auto stream = in["stream"].as<size_t>();
+
+		auto& chan = m_placeholders[id];
+		if(!chan)
+		{
+			chan = new ShardInputChannel(id, Unit(in["xunit"].as<string>()));
+			table.emplace(id, chan);
+		}
+		chan->EnsureStream(stream, Unit(in["yunit"].as<string>()), static_cast<Stream::StreamType>(in["type"].as<int>()));
+		m_inputs.push_back(pair<ShardInputChannel*, size_t>(chan, stream));
+	}
+
+	//Load the subgraph
+	FilterGraphLoader loader(config["filters"]);
+	try
+	{
+		loader.Finish(table);
+	}
+	catch(const exception& e)
+	{
+		err = e.what();
+		return false;
+	}
+	m_filters = loader.GetFilters();
+	m_nodes = set<FlowGraphNode*>(m_filters.begin(), m_filters.end());
+
+	//Find the outputs
+	for(auto o : config["outputs"])
+	{
+		auto ref = ParseStreamRef(o.as<string>());
+		auto f = table.Lookup<Filter*>(ref.m_filter);
+		if(!f || (ref.m_stream >= f->GetStreamCount()) )
+		{
+			err = "no such output " + o.as<string>();
+			return false;
+		}
+		m_outputs.push_back(pair<Filter*, size_t>(f, ref.m_stream));
+	}
+
+	return true;
+}
+
+/**
+	@brief Describes the output streams, for the shard to mirror
+ */
+YAML::Node FilterShardHost::DescribeOutputs()
+{
+	YAML::Node desc;
+	for(auto& o : m_outputs)
+	{
+		YAML::Node s;
+		s["name"] = o.first->GetStreamName(o.second);
+		s["type"] = static_cast<int>(o.first->GetType(o.second));
+		s["yunit"] = o.first->GetYAxisUnits(o.second).ToString();
+		desc.push_back(s);
+	}
+	return desc;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates a shard for a subgraph
+
+	The worker isn't started until the first refresh, so the subgraph sees our inputs' types and units.
+
+	@param color	Display color
+	@param filters	The subgraph, as the "filters" section of a session file. Inputs referring to IDs which aren't
+					part of the subgraph become our inputs, in the order they're first seen.
+	@param outputs	Subgraph outputs to expose as our streams
+ */
+FilterShard::FilterShard(const string& color, const YAML::Node& filters, const vector<Output>& outputs)
+	: Filter(color, CAT_MISC)
+	, m_outputs(outputs)
+	, m_pid(0)
+	, m_sock(-1)
+	, m_timeout(5000)
+	, m_remotePort(0)
+	, m_ranLocally(false)
+	, m_refreshCount(0)
+	, m_localTimePerSample(-1)
+	, m_remoteTimePerSample(-1)
+	, m_bytesPerSample(-1)
+	, m_bandwidth(-1)
+{
+	YAML::Emitter out;
+	out << filters;
+	m_filters = out.c_str();
+
+	//Anything the subgraph takes input from that it doesn't contain is one of our inputs
+	set<uintptr_t> ids;
+	for(auto it : filters)
+		ids.emplace(it.second["id"].as<uintptr_t>());
+	set<string> seen;
+	for(auto it : filters)
+	{
+		for(auto jt : it.second["inputs"])
+		{
+			auto ref = ParseStreamRef(jt.second.as<string>());
+			if( (ref.m_filter == 0) || (ids.find(ref.m_filter) != ids.end()) )
+				continue;
+
+			auto name = to_string(ref.m_filter) + "/" + to_string(ref.m_stream);
+			if(!seen.emplace(name).second)
+				continue;
+			m_externalInputs.push_back(ref);
+			CreateInput(name);
+		}
+	}
+
+	//Placeholder outputs until the worker tells us what they really are
+	for(size_t i=0; i<m_outputs.size(); i++)
+		AddStream(Unit(Unit::UNIT_VOLTS), "out" + to_string(i), Stream::STREAM_TYPE_ANALOG);
+}
+
+FilterShard::~FilterShard()
+{
+	Shutdown(false);
+}
+
+/**
+	@brief Sets the command line used to start worker processes
+
+	The descriptor number of the worker's end of the control socket is appended as the last argument. The worker
+	should initialize the libraries as usual, then call FilterShard::RunWorker() with it and exit with its return value.
+
+	@param argv	Program and arguments, e.g. { "/usr/bin/ngscopeclient", "--filter-shard" }. The program is looked up
+				in PATH if it doesn't contain a slash.
+ */
+void FilterShard::SetWorkerCommand(const vector<string>& argv)
+{
+	lock_guard<mutex> lock(m_workerCommandMutex);
+	m_workerCommand = argv;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+string FilterShard::GetProtocolName()
+{
+	return "Filter Shard";
+}
+
+string FilterShard::GetProtocolDisplayName()
+{
+	return GetProtocolName();
+}
+
+bool FilterShard::ValidateChannel(size_t i, StreamDescriptor stream)
+{
+	if(stream.m_channel == nullptr)
+		return false;
+	if(i >= m_externalInputs.size())
+		return false;
+
+	switch(stream.GetType())
+	{
+		case Stream::STREAM_TYPE_ANALOG:
+		case Stream::STREAM_TYPE_DIGITAL:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Worker management
+
+/**
+	@brief Builds the configuration sent to a worker, describing the subgraph and its connections to the outside
+
+	@param inlineWaveforms	True if waveforms will travel over the control socket, rather than in shared memory
+ */
+YAML::Node FilterShard::GetConfig(bool inlineWaveforms)
+{
+	YAML::Node config;
+	config["filters"] = YAML::Load(m_filters);
+	config["inline"] = inlineWaveforms;
+	for(size_t i=0; i<m_externalInputs.size(); i++)
+	{
+		YAML::Node in;
+		in["id"] = m_externalInputs[i].m_filter;
+		in["stream"] = m_externalInputs[i].m_stream;
+
+		auto desc = GetInput(i);
+		if(desc.m_channel)
+		{
+			in["type"] = static_cast<int>(desc.GetType());
+			in["xunit"] = desc.GetXAxisUnits().ToString();
+			in["yunit"] = desc.GetYAxisUnits().ToString();
+		}
+		else
+		{
+			in["type"] = static_cast<int>(Stream::STREAM_TYPE_ANALOG);
+			in["xunit"] = Unit(Unit::UNIT_FS).ToString();
+			in["yunit"] = Unit(Unit::UNIT_VOLTS).ToString();
+		}
+		config["inputs"].push_back(in);
+	}
+	for(auto& o : m_outputs)
+		config["outputs"].push_back(to_string(o.m_filter) + "/" + to_string(o.m_stream));
+	return config;
+}
+
+/**
+	@brief Updates our streams to match the real outputs of the subgraph
+
+	@param streams	Output stream descriptions, from FilterShardHost::DescribeOutputs()
+ */
+void FilterShard::UpdateStreams(const YAML::Node& streams)
+{
+	bool changed = (streams.size() != GetStreamCount());
+	for(size_t i=0; (i<streams.size()) && !changed; i++)
+	{
+		auto s = streams[i];
+		if( (s["name"].as<string>() != GetStreamName(i)) ||
+			(s["type"].as<int>() != static_cast<int>(GetType(i))) ||
+			(s["yunit"].as<string>() != GetYAxisUnits(i).ToString()) )
+		{
+			changed = true;
+		}
+	}
+	if(!changed)
+		return;
+
+	ClearStreams();
+	for(auto s : streams)
+	{
+		AddStream(
+			Unit(s["yunit"].as<string>()),
+			s["name"].as<string>(),
+			static_cast<Stream::StreamType>(s["type"].as<int>()));
+	}
+}
+
+/**
+	@brief Runs the subgraph on a worker on another machine (see ServeWorkers()) instead of in a local process
+
+	Takes effect on the next refresh. Estimates of the remote node's performance start over.
+
+	@param host	Host name or address of the node, or empty to go back to a local worker process
+	@param port	TCP port the node is listening on
+ */
+void FilterShard::SetRemoteWorker(const string& host, uint16_t port)
+{
+	Shutdown(false);
+	m_remoteHost = host;
+	m_remotePort = port;
+	m_ranLocally = false;
+	m_remoteTimePerSample = -1;
+	m_bytesPerSample = -1;
+	m_bandwidth = -1;
+}
+
+/**
+	@brief Opens a connection to the remote worker
+
+	@return The socket, or -1 on failure
+ */
+int FilterShard::Connect()
+{
+#ifdef __linux__
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* res = nullptr;
+	if(getaddrinfo(m_remoteHost.c_str(), to_string(m_remotePort).c_str(), &hints, &res) != 0)
+	{
+		LogError("FilterShard: could not resolve %s\n", m_remoteHost.c_str());
+		return -1;
+	}
+
+	int sock = -1;
+	for(auto ai = res; ai != nullptr; ai = ai->ai_next)
+	{
+		sock = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, ai->ai_protocol);
+		if(sock < 0)
+			continue;
+
+		//Don't hang for the kernel's connect timeout if the node is down
+		if( (connect(sock, ai->ai_addr, ai->ai_addrlen) == 0) || (errno == EINPROGRESS) )
+		{
+			pollfd pfd;
+			pfd.fd = sock;
+			pfd.events = POLLOUT;
+			pfd.revents = 0;
+			int err = 0;
+			socklen_t len = sizeof(err);
+			if( (poll(&pfd, 1, m_timeout.count()) == 1) &&
+				(getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &len) == 0) &&
+				(err == 0) )
+			{
+				break;
+			}
+		}
+		close(sock);
+		sock = -1;
+	}
+	freeaddrinfo(res);
+
+	if(sock < 0)
+	{
+		LogError("FilterShard: could not connect to worker at %s:%d\n", m_remoteHost.c_str(), m_remotePort);
+		return -1;
+	}
+
+	//Back to blocking, and don't let Nagle hold back control messages
+	fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) & ~O_NONBLOCK);
+	int one = 1;
+	setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	return sock;
+#else
+	return -1;
+#endif
+}
+
+/**
+	@brief Starts a worker process (or connects to the remote worker) and sends it the subgraph
+
+	@return True if the worker loaded the subgraph successfully
+ */
+bool FilterShard::Launch()
+{
+#ifdef __linux__
+	vector<int> fds;
+	if(IsRemote())
+	{
+		m_sock = Connect();
+		if(m_sock < 0)
+			return false;
+	}
+	else
+	{
+		vector<string> cmd;
+		{
+			lock_guard<mutex> lock(m_workerCommandMutex);
+			cmd = m_workerCommand;
+		}
+		if(cmd.empty())
+		{
+			LogError("FilterShard: no worker command, call FilterShard::SetWorkerCommand() first\n");
+			return false;
+		}
+
+		//Only the worker's end of the socket is inherited
+		int socks[2];
+		if(socketpair(AF_UNIX, SOCK_STREAM, 0, socks) != 0)
+		{
+			LogError("FilterShard: failed to create control socket\n");
+			return false;
+		}
+		fcntl(socks[0], F_SETFD, FD_CLOEXEC);
+
+		cmd.push_back(to_string(socks[1]));
+		vector<char*> argv;
+		for(auto& s : cmd)
+			argv.push_back(&s[0]);
+		argv.push_back(nullptr);
+
+		pid_t pid;
+		int err = posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ);
+		close(socks[1]);
+		if(err != 0)
+		{
+			LogError("FilterShard: failed to start worker %s (%s)\n", cmd[0].c_str(), strerror(err));
+			close(socks[0]);
+			return false;
+		}
+		m_pid = pid;
+		m_sock = socks[0];
+
+		//Set up shared memory for every input and output
+		m_inputBuffers.clear();
+		m_outputBuffers.clear();
+		for(size_t i=0; i<m_externalInputs.size(); i++)
+		{
+			auto buf = SharedWaveformBuffer::Create(GetDisplayName() + ".in" + to_string(i));
+			if(!buf)
+			{
+				Shutdown(true);
+				return false;
+			}
+			fds.push_back(buf->GetFD());
+			m_inputBuffers.push_back(move(buf));
+		}
+		for(size_t i=0; i<m_outputs.size(); i++)
+		{
+			auto buf = SharedWaveformBuffer::Create(GetDisplayName() + ".out" + to_string(i));
+			if(!buf)
+			{
+				Shutdown(true);
+				return false;
+			}
+			fds.push_back(buf->GetFD());
+			m_outputBuffers.push_back(move(buf));
+		}
+	}
+
+	YAML::Emitter out;
+	out << GetConfig(IsRemote());
+	if(!SendShardMessage(m_sock, SHARD_CONFIG, out.c_str(), fds))
+	{
+		LogError("FilterShard: failed to send configuration to worker\n");
+		Shutdown(true);
+		return false;
+	}
+
+	//Wait for it to load (this includes library startup, so be generous)
+	uint32_t opcode = SHARD_ERROR;
+	string payload;
+	vector<int> rxfds;
+	if(!RecvShardMessage(m_sock, opcode, payload, rxfds, 10 * m_timeout.count()) || (opcode != SHARD_READY) )
+	{
+		if( (opcode == SHARD_ERROR) && !payload.empty() )
+			LogError("FilterShard: worker failed to load subgraph: %s\n", payload.c_str());
+		else
+			LogError("FilterShard: worker did not start\n");
+		Shutdown(true);
+		return false;
+	}
+
+	UpdateStreams(YAML::Load(payload));
+
+	if(IsRemote())
+		LogTrace("FilterShard: connected to worker at %s:%d\n", m_remoteHost.c_str(), m_remotePort);
+	else
+		LogTrace("FilterShard: started worker %d\n", m_pid);
+	return true;
+#else
+	LogError("FilterShard: worker processes are only supported on Linux\n");
+	return false;
+#endif
+}
+
+/**
+	@brief Stops the worker process (or disconnects from the remote worker), if there is one
+
+	@param kill		True to kill the worker outright (it's misbehaving), false to ask it to exit
+ */
+void FilterShard::Shutdown(bool kill)
+{
+#ifdef __linux__
+	if(m_sock >= 0)
+	{
+		if(!kill)
+			SendShardMessage(m_sock, SHARD_EXIT, "");
+		close(m_sock);
+		m_sock = -1;
+	}
+
+	if(m_pid > 0)
+	{
+		if(kill)
+			::kill(m_pid, SIGKILL);
+		waitpid(m_pid, nullptr, 0);
+		m_pid = 0;
+	}
+#else
+	(void)kill;
+#endif
+
+	m_inputBuffers.clear();
+	m_outputBuffers.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Actual decoder logic
+
+void FilterShard::Refresh(
+	[[maybe_unused]] vk::raii::CommandBuffer& cmdBuf,
+	[[maybe_unused]] shared_ptr<QueueHandle> queue)
+{
+	//Compute time scales with the amount of input, so the estimates are per input sample
+	size_t samples = 0;
+	for(size_t i=0; i<m_externalInputs.size(); i++)
+	{
+		auto wfm = GetInputWaveform(i);
+		if(wfm)
+			samples += wfm->size();
+	}
+	samples = max(samples, static_cast<size_t>(1));
+
+	bool ok = false;
+	if(!IsRemote())
+		ok = RefreshWorker(samples);
+	else
+	{
+		m_refreshCount ++;
+		m_ranLocally = ShouldRunLocally(samples);
+		if(!m_ranLocally)
+		{
+			ok = RefreshWorker(samples);
+
+			//Don't keep trying a node which is down, until the next probe
+			if(!ok)
+				m_remoteTimePerSample = numeric_limits<double>::infinity();
+		}
+		if(!ok)
+		{
+			m_ranLocally = true;
+			ok = RefreshLocal(samples);
+		}
+	}
+
+	if(!ok)
+	{
+		for(size_t i=0; i<GetStreamCount(); i++)
+			SetData(nullptr, i);
+	}
+}
+
+/**
+	@brief Decides whether a remote shard should run the subgraph in this process for the current refresh
+
+	@param samples	Total number of input samples
+ */
+bool FilterShard::ShouldRunLocally(size_t samples)
+{
+	//Measure both sides before comparing them
+	if(m_remoteTimePerSample < 0)
+		return false;
+	if(m_localTimePerSample < 0)
+		return true;
+
+	double local = m_localTimePerSample * samples;
+	double remote = m_remoteTimePerSample * samples;
+	if(m_bandwidth > 0)
+		remote += m_bytesPerSample * samples / m_bandwidth;
+	bool localIsFaster = (local <= remote);
+
+	//Every so often use the other side, so its estimate follows changes in load or link speed
+	if( (m_refreshCount % PROBE_INTERVAL) == 0)
+		return !localIsFaster;
+	return localIsFaster;
+}
+
+/**
+	@brief Runs the subgraph on the worker
+
+	@param samples	Total number of input samples
+
+	@return True on success. On failure the worker has been shut down, and will be restarted next time.
+ */
+bool FilterShard::RefreshWorker([[maybe_unused]] size_t samples)
+{
+#ifdef __linux__
+	if( (m_sock < 0) && !Launch() )
+		return false;
+
+	//Hand the inputs over
+	vector<uint8_t> request;
+	if(IsRemote())
+	{
+		for(size_t i=0; i<m_externalInputs.size(); i++)
+			WaveformCodec::Encode(GetInputWaveform(i), request);
+	}
+	else
+	{
+		for(size_t i=0; i<m_inputBuffers.size(); i++)
+		{
+			if(!m_inputBuffers[i]->Write(GetInputWaveform(i)))
+				return false;
+		}
+	}
+
+	double start = GetTime();
+	uint32_t opcode = SHARD_ERROR;
+	string payload;
+	vector<int> fds;
+	if(!SendShardMessage(m_sock, SHARD_REFRESH, request.data(), request.size()) ||
+		!RecvShardMessage(m_sock, opcode, payload, fds, m_timeout.count()) ||
+		(opcode != SHARD_DONE) )
+	{
+		if( (opcode == SHARD_ERROR) && !payload.empty() )
+			LogError("FilterShard %s: %s\n", GetDisplayName().c_str(), payload.c_str());
+		else
+		{
+			LogError("FilterShard %s: worker crashed or timed out, restarting it on the next refresh\n",
+				GetDisplayName().c_str());
+		}
+		Shutdown(true);
+		return false;
+	}
+	double elapsed = GetTime() - start;
+
+	if(!IsRemote())
+	{
+		//Pick up the outputs, reusing last time's waveforms where possible
+		for(size_t i=0; i<m_outputBuffers.size(); i++)
+		{
+			auto old = GetData(i);
+			auto wfm = m_outputBuffers[i]->Read(old);
+			if(wfm != old)
+				SetData(wfm, i);
+		}
+		return true;
+	}
+
+	//Remote workers send how long the subgraph took, then the outputs
+	auto p = reinterpret_cast<const uint8_t*>(payload.data());
+	size_t pos = sizeof(double);
+	double compute = 0;
+	bool ok = (payload.size() >= pos);
+	if(ok)
+		memcpy(&compute, p, sizeof(double));
+	for(size_t i=0; ok && (i<GetStreamCount()); i++)
+	{
+		auto old = GetData(i);
+		WaveformBase* wfm;
+		ok = WaveformCodec::Decode(p, payload.size(), pos, old, wfm);
+		if(ok && (wfm != old))
+			SetData(wfm, i);
+	}
+	if(!ok)
+	{
+		LogError("FilterShard %s: corrupted output from worker\n", GetDisplayName().c_str());
+		Shutdown(true);
+		return false;
+	}
+
+	//Whatever the worker wasn't computing, we were waiting on the network
+	double bytes = request.size() + payload.size();
+	double transfer = max(elapsed - compute, 1e-6);
+	m_remoteTimePerSample = UpdateEstimate(m_remoteTimePerSample, compute / samples);
+	m_bytesPerSample = UpdateEstimate(m_bytesPerSample, bytes / samples);
+	m_bandwidth = UpdateEstimate(m_bandwidth, bytes / transfer);
+	return true;
+#else
+	LogError("FilterShard: worker processes are only supported on Linux\n");
+	return false;
+#endif
+}
+
+/**
+	@brief Runs the subgraph in this process
+
+	@param samples	Total number of input samples
+
+	@return True on success
+ */
+bool FilterShard::RefreshLocal(size_t samples)
+{
+	if(!m_localHost)
+	{
+		m_localHost = make_unique<FilterShardHost>();
+		string err;
+		if(!m_localHost->Load(GetConfig(false), err))
+		{
+			LogError("FilterShard %s: failed to load subgraph: %s\n", GetDisplayName().c_str(), err.c_str());
+			m_localHost = nullptr;
+			return false;
+		}
+
+		//We take the outputs every time, so every node has to run every time
+		m_localHost->GetExecutor().SetIncrementalEvaluation(false);
+		UpdateStreams(m_localHost->DescribeOutputs());
+	}
+
+	double start = GetTime();
+
+	//Lend our inputs to the placeholders for the duration of the run
+	for(size_t i=0; i<m_localHost->GetInputCount(); i++)
+	{
+		auto& in = m_localHost->GetInput(i);
+		in.first->SetData(GetInputWaveform(i), in.second);
+	}
+
+	m_localHost->Run();
+
+	for(size_t i=0; i<m_localHost->GetInputCount(); i++)
+	{
+		auto& in = m_localHost->GetInput(i);
+		in.first->Detach(in.second);
+	}
+
+	//Take the outputs, giving last time's back to the filters that made them so their buffers get reused
+	for(size_t i=0; i<m_localHost->GetOutputCount(); i++)
+	{
+		auto& out = m_localHost->GetOutput(i);
+		auto old = Detach(i);
+		if(old)
+			out.first->RecycleOutputWaveform(old);
+		SetData(out.first->Detach(out.second), i);
+	}
+
+	m_localTimePerSample = UpdateEstimate(m_localTimePerSample, (GetTime() - start) / samples);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Worker side
+
+/**
+	@brief Hosts a subgraph for a FilterShard in another process (or on another machine), until told to exit
+
+	Call from the worker process after initializing the libraries.
+
+	@param sock		Descriptor of the control socket, as passed on the command line
+
+	@return Process exit code
+ */
+int FilterShard::RunWorker(int sock)
+{
+#ifdef __linux__
+	pthread_setname_np(pthread_self(), "FilterShard");
+
+	uint32_t opcode;
+	string payload;
+	vector<int> fds;
+	if(!RecvShardMessage(sock, opcode, payload, fds, -1) || (opcode != SHARD_CONFIG) )
+	{
+		LogError("FilterShard worker: did not get a configuration\n");
+		close(sock);
+		return 1;
+	}
+
+	auto config = YAML::Load(payload);
+	bool inlineWaveforms = config["inline"] && config["inline"].as<bool>();
+	size_t numInputs = config["inputs"].size();
+	size_t numOutputs = config["outputs"].size();
+
+	auto fail = [&](const string& err)
+	{
+		SendShardMessage(sock, SHARD_ERROR, err);
+		close(sock);
+		return 1;
+	};
+
+	//Local workers exchange waveforms in shared memory
+	vector<unique_ptr<SharedWaveformBuffer>> inputBuffers;
+	vector<unique_ptr<SharedWaveformBuffer>> outputBuffers;
+	if(!inlineWaveforms)
+	{
+		if(fds.size() != numInputs + numOutputs)
+			return fail("wrong number of shared memory buffers");
+
+		for(size_t i=0; i<numInputs; i++)
+			inputBuffers.push_back(SharedWaveformBuffer::Attach(fds[i]));
+		for(size_t i=0; i<numOutputs; i++)
+			outputBuffers.push_back(SharedWaveformBuffer::Attach(fds[numInputs + i]));
+
+		for(auto& b : inputBuffers)
+		{
+			if(!b)
+				return fail("bad shared memory buffer");
+		}
+		for(auto& b : outputBuffers)
+		{
+			if(!b)
+				return fail("bad shared memory buffer");
+		}
+	}
+
+	FilterShardHost host;
+	string err;
+	if(!host.Load(config, err))
+		return fail(err);
+
+	//Tell the shard what the outputs are
+	YAML::Emitter out;
+	out << host.DescribeOutputs();
+	if(!SendShardMessage(sock, SHARD_READY, out.c_str()))
+	{
+		close(sock);
+		return 1;
+	}
+
+	//Run the subgraph every time we're asked to, until the shard goes away
+	vector<uint8_t> reply;
+	while(RecvShardMessage(sock, opcode, payload, fds, -1))
+	{
+		if(opcode == SHARD_EXIT)
+			break;
+		if(opcode != SHARD_REFRESH)
+			continue;
+
+		bool ok = true;
+		auto p = reinterpret_cast<const uint8_t*>(payload.data());
+		size_t pos = 0;
+		for(size_t i=0; ok && (i<host.GetInputCount()); i++)
+		{
+			auto chan = host.GetInput(i).first;
+			auto stream = host.GetInput(i).second;
+			auto old = chan->GetData(stream);
+			WaveformBase* wfm;
+			if(inlineWaveforms)
+				ok = WaveformCodec::Decode(p, payload.size(), pos, old, wfm);
+			else
+				wfm = inputBuffers[i]->Read(old);
+			if(ok && (wfm != old))
+				chan->SetData(wfm, stream);
+		}
+		if(!ok)
+		{
+			if(!SendShardMessage(sock, SHARD_ERROR, "corrupted input"))
+				break;
+			continue;
+		}
+
+		double start = GetTime();
+		host.Run();
+		double compute = GetTime() - start;
+
+		reply.resize(sizeof(double));
+		memcpy(reply.data(), &compute, sizeof(double));
+		for(size_t i=0; i<host.GetOutputCount(); i++)
+		{
+			auto wfm = host.GetOutput(i).first->GetData(host.GetOutput(i).second);
+			if(inlineWaveforms)
+				WaveformCodec::Encode(wfm, reply);
+			else
+				ok &= outputBuffers[i]->Write(wfm);
+		}
+
+		bool sent;
+		if(!ok)
+			sent = SendShardMessage(sock, SHARD_ERROR, "failed to write outputs");
+		else if(inlineWaveforms)
+			sent = SendShardMessage(sock, SHARD_DONE, reply.data(), reply.size());
+		else
+			sent = SendShardMessage(sock, SHARD_DONE, "");
+		if(!sent)
+			break;
+	}
+
+	close(sock);
+	return 0;
+#else
+	(void)sock;
+	LogError("FilterShard: worker processes are only supported on Linux\n");
+	return 1;
+#endif
+}
+
+/**
+	@brief Runs a headless analysis node, hosting subgraphs for remote shards (see SetRemoteWorker())
+
+	Listens on a TCP port and runs each shard which connects on its own thread, as RunWorker() would. Call from the
+	worker application after initializing the libraries; only returns on error.
+
+	There is no authentication: anyone who can connect can load any filter (including ones which read files), so only
+	listen on a trusted network.
+
+	@param port		TCP port to listen on
+
+	@return Process exit code
+ */
+int FilterShard::ServeWorkers(uint16_t port)
+{
+#ifdef __linux__
+	int sock = socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if(sock < 0)
+	{
+		LogError("FilterShard: failed to create listening socket\n");
+		return 1;
+	}
+
+	//Accept both IPv4 and IPv6 clients
+	int one = 1;
+	int zero = 0;
+	setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero));
+
+	sockaddr_in6 addr = {};
+	addr.sin6_family = AF_INET6;
+	addr.sin6_port = htons(port);
+	addr.sin6_addr = in6addr_any;
+	if( (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) || (listen(sock, 16) != 0) )
+	{
+		LogError("FilterShard: could not listen on port %d\n", port);
+		close(sock);
+		return 1;
+	}
+	LogNotice("FilterShard: serving workers on port %d\n", port);
+
+	while(true)
+	{
+		int client = accept4(sock, nullptr, nullptr, SOCK_CLOEXEC);
+		if(client < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			LogError("FilterShard: accept failed (%s)\n", strerror(errno));
+			break;
+		}
+		setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+		thread([client] { RunWorker(client); }).detach();
+	}
+
+	close(sock);
+	return 1;
+#else
+	(void)port;
+	LogError("FilterShard: remote workers are only supported on Linux\n");
+	return 1;
+#endif
+}
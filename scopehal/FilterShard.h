@@ -0,0 +1,199 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of FilterShard
+	@ingroup core
+ */
+
+#ifndef FilterShard_h
+#define FilterShard_h
+
+#include "SharedWaveformBuffer.h"
+
+class FilterShardHost;
+
+/**
+	@brief Runs a subgraph of filters in a separate worker process, standing in for it in this process's graph
+
+	The shard is a proxy node: its inputs are the signals the subgraph takes from outside, and its output streams
+	are the subgraph outputs the caller asked for. Each Refresh() writes the inputs into shared memory (one
+	SharedWaveformBuffer per input), tells the worker to run the subgraph, and reads the outputs back the same way.
+	Only small control messages go over the socket connecting the two processes.
+
+	This isolates heavy or untrusted decoders: if the worker crashes or doesn't answer within the timeout, the shard
+	logs an error, kills it, produces no output for that refresh, and starts a new worker on the next one. The rest of
+	the graph keeps running. Workers can also be spread across processes or containers (see SetWorkerCommand()) to
+	scale horizontally.
+
+	The worker is a separate executable (usually the host application itself, with a special command line) which
+	initializes libscopehal and the protocol library as usual and then calls RunWorker(). It receives the subgraph as
+	the "filters" section of a session file, and loads it with FilterGraphLoader.
+
+	The worker can also be on another machine (see SetRemoteWorker() and ServeWorkers()). Waveforms then travel over
+	the control socket in the compact encoding of WaveformCodec, and the shard picks, on each refresh, whichever of
+	running the subgraph remotely or in this process it predicts will be faster. The prediction uses running
+	estimates of compute time per input sample on each side and of the link's throughput, so a remote node which is
+	much faster wins for small transfers, while slow links or huge waveforms keep the work local. The losing side is
+	re-measured every PROBE_INTERVAL refreshes. If the remote node fails, the subgraph runs locally instead.
+
+	Only analog and digital waveforms can cross the process boundary (see SharedWaveformBuffer), so protocol decodes
+	have to stay inside the subgraph. Worker processes need Linux (memfd and descriptor passing, or BSD sockets for
+	remote workers).
+
+	@ingroup core
+ */
+class FilterShard : public Filter
+{
+public:
+
+	/**
+		@brief A reference to a stream of an object in the subgraph's configuration, by ID
+	 */
+	class Output
+	{
+	public:
+		Output(uintptr_t filter = 0, size_t stream = 0)
+		: m_filter(filter)
+		, m_stream(stream)
+		{}
+
+		///@brief ID of the object, in the subgraph's configuration
+		uintptr_t m_filter;
+
+		///@brief Stream index on that filter
+		size_t m_stream;
+	};
+
+	FilterShard(const std::string& color, const YAML::Node& filters, const std::vector<Output>& outputs);
+	virtual ~FilterShard();
+
+	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
+
+	static std::string GetProtocolName();
+	virtual std::string GetProtocolDisplayName() override;
+	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
+
+	///@brief Returns true if a worker process is currently running
+	bool IsWorkerRunning()
+	{ return m_pid > 0; }
+
+	///@brief Sets how long to wait for the worker to refresh the subgraph before giving up on it
+	void SetTimeout(std::chrono::milliseconds timeout)
+	{ m_timeout = timeout; }
+
+	void SetRemoteWorker(const std::string& host, uint16_t port);
+
+	///@brief Returns true if the subgraph runs on a worker on another machine (or in this process, when faster)
+	bool IsRemote()
+	{ return !m_remoteHost.empty(); }
+
+	///@brief Returns true if the most recent refresh ran the subgraph in this process
+	bool IsRunningLocally()
+	{ return m_ranLocally; }
+
+	static void SetWorkerCommand(const std::vector<std::string>& argv);
+	static int RunWorker(int sock);
+	static int ServeWorkers(uint16_t port);
+
+	///@brief Number of refreshes between measurements of whichever of local or remote execution isn't being used
+	static const size_t PROBE_INTERVAL = 32;
+
+protected:
+	bool Launch();
+	int Connect();
+	void Shutdown(bool kill);
+	YAML::Node GetConfig(bool inlineWaveforms);
+	void UpdateStreams(const YAML::Node& streams);
+
+	bool ShouldRunLocally(size_t samples);
+	bool RefreshWorker(size_t samples);
+	bool RefreshLocal(size_t samples);
+
+	///@brief The subgraph, as the "filters" section of a session file
+	std::string m_filters;
+
+	///@brief Streams outside the subgraph which it takes input from, in input index order
+	std::vector<Output> m_externalInputs;
+
+	///@brief Subgraph outputs
+	std::vector<Output> m_outputs;
+
+	///@brief Process ID of the worker (0 if not running)
+	int m_pid;
+
+	///@brief Our end of the control socket (-1 if not connected)
+	int m_sock;
+
+	///@brief Shared memory for each input
+	std::vector<std::unique_ptr<SharedWaveformBuffer>> m_inputBuffers;
+
+	///@brief Shared memory for each output
+	std::vector<std::unique_ptr<SharedWaveformBuffer>> m_outputBuffers;
+
+	///@brief Maximum time to wait for a refresh
+	std::chrono::milliseconds m_timeout;
+
+	///@brief Host name of the remote worker (empty to spawn a local worker process instead)
+	std::string m_remoteHost;
+
+	///@brief TCP port of the remote worker
+	uint16_t m_remotePort;
+
+	///@brief The subgraph, loaded in this process (remote mode only, created when first needed)
+	std::unique_ptr<FilterShardHost> m_localHost;
+
+	///@brief True if the last refresh ran locally
+	bool m_ranLocally;
+
+	///@brief Number of refreshes so far, for scheduling probes
+	size_t m_refreshCount;
+
+	///@brief Estimated local run time, in seconds per input sample (negative if not yet measured)
+	double m_localTimePerSample;
+
+	///@brief Estimated remote compute time, in seconds per input sample (negative if not yet measured)
+	double m_remoteTimePerSample;
+
+	///@brief Estimated bytes sent and received per input sample
+	double m_bytesPerSample;
+
+	///@brief Estimated throughput of the link to the remote worker, in bytes per second
+	double m_bandwidth;
+
+	///@brief Command line used to start workers (the control socket's descriptor number is appended)
+	static std::vector<std::string> m_workerCommand;
+
+	///@brief Mutex protecting m_workerCommand
+	static std::mutex m_workerCommandMutex;
+};
+
+#endif
@@ -0,0 +1,135 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of FlatSequenceSet
+	@ingroup core
+ */
+
+#ifndef FlatSequenceSet_h
+#define FlatSequenceSet_h
+
+/**
+	@brief The set of waveforms captured from one trigger event, keyed by stream
+
+	A small flat map, looked up by linear search. Almost every instrument has few enough streams that they fit in
+	the inline storage, so building a set, copying it into the pending waveform queue, and popping it back out again
+	never touches the heap. Instruments with more streams than that (large logic analyzers etc) overflow into a
+	vector, which keeps its capacity when the set is cleared or assigned to.
+
+	Iteration order is insertion order. Iterators are invalidated by inserting a new stream, as with std::vector.
+
+	@ingroup core
+ */
+class FlatSequenceSet
+{
+public:
+	typedef std::pair<StreamDescriptor, WaveformBase*> value_type;
+	typedef value_type* iterator;
+	typedef const value_type* const_iterator;
+
+	///@brief Number of streams which can be stored without a heap allocation
+	static constexpr size_t INLINE_CAPACITY = 8;
+
+	FlatSequenceSet()
+		: m_size(0)
+	{}
+
+	///@brief Looks up the waveform for a stream, adding a null entry if it's not present yet
+	WaveformBase*& operator[](const StreamDescriptor& stream)
+	{
+		auto it = find(stream);
+		if(it != end())
+			return it->second;
+
+		if(m_overflow.empty() && (m_size < INLINE_CAPACITY))
+		{
+			m_inline[m_size] = value_type(stream, nullptr);
+			return m_inline[m_size ++].second;
+		}
+
+		//Out of inline space, move everything to the heap
+		if(m_overflow.empty())
+			m_overflow.assign(m_inline, m_inline + m_size);
+		m_overflow.push_back(value_type(stream, nullptr));
+		m_size ++;
+		return m_overflow.back().second;
+	}
+
+	///@brief Finds the entry for a stream, or end() if it's not present
+	iterator find(const StreamDescriptor& stream)
+	{
+		for(auto it = begin(); it != end(); it++)
+		{
+			if( (it->first.m_channel == stream.m_channel) && (it->first.m_stream == stream.m_stream) )
+				return it;
+		}
+		return end();
+	}
+
+	iterator begin()
+	{ return m_overflow.empty() ? m_inline : m_overflow.data(); }
+
+	iterator end()
+	{ return begin() + m_size; }
+
+	const_iterator begin() const
+	{ return m_overflow.empty() ? m_inline : m_overflow.data(); }
+
+	const_iterator end() const
+	{ return begin() + m_size; }
+
+	size_t size() const
+	{ return m_size; }
+
+	bool empty() const
+	{ return (m_size == 0); }
+
+	///@brief Removes all entries (without freeing any waveforms)
+	void clear()
+	{
+		m_size = 0;
+		m_overflow.clear();
+	}
+
+protected:
+
+	///@brief Number of entries
+	size_t m_size;
+
+	///@brief Entries, if there are no more than INLINE_CAPACITY of them
+	value_type m_inline[INLINE_CAPACITY];
+
+	///@brief All entries, once there are more than INLINE_CAPACITY of them (empty otherwise)
+	std::vector<value_type> m_overflow;
+};
+
+#endif
@@ -49,6 +49,7 @@ string StreamDescriptor::GetName() const
 // Construction / destruction
 
 FlowGraphNode::FlowGraphNode()
+	: m_dirtyRevision(0)
 {
 }
 
@@ -122,6 +123,83 @@ FlowGraphNode::DataLocation FlowGraphNode::GetInputLocation()
 	return LOC_CPU;
 }
 
+/**
+	@brief Checks if the node only ever reads its input waveforms from GPU work it submits during Refresh()
+
+	If this returns true, FilterGraphExecutor does not wait on the CPU for GPU work of upstream nodes to complete
+	before refreshing this node, and instead makes this node's own submissions wait for it on the GPU. Nodes which
+	read input samples from the CPU, even occasionally, must return false.
+
+	Reading waveform metadata (size, timescale, etc.) on the CPU is fine, since only sample data is written by the GPU.
+	So are blocking submissions whose results are read back afterwards (e.g. a reduction), since they also wait for the
+	upstream work.
+
+	The default implementation returns true if GetInputLocation() is LOC_GPU.
+ */
+bool FlowGraphNode::ConsumesInputsOnGpu()
+{
+	return GetInputLocation() == LOC_GPU;
+}
+
+/**
+	@brief Checks if the node can read an input waveform holding unconverted ADC codes (see RawAnalogSamples)
+
+	If this returns false, FilterGraphExecutor converts raw codes on the input to floating point before refreshing
+	the node. Nodes returning true must check WaveformBase::HasRawSamples() and read UniformWaveform::m_rawSamples
+	instead of m_samples when it's set (or call PrepareForCpuAccess() / PrepareForGpuAccess() to convert on demand).
+
+	The default implementation returns false.
+
+	@param i	Input index
+ */
+bool FlowGraphNode::AcceptsRawSamples([[maybe_unused]] size_t i)
+{
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Incremental evaluation
+
+/**
+	@brief Checks if the executor may skip refreshing this node when its inputs and configuration are unchanged.
+
+	The default implementation returns true for any node with at least one input. Nodes with no inputs (signal
+	generators, import filters, etc.) are always refreshed since they may produce new output on every evaluation.
+
+	Nodes whose output depends on state the executor cannot see (wall clock time, instrument state, etc.) should
+	override this and return false.
+ */
+bool FlowGraphNode::IsRefreshSkippable()
+{
+	return !m_inputs.empty();
+}
+
+/**
+	@brief Checks if the executor should hash this node's outputs after each refresh to detect unchanged data
+
+	If an output waveform is the same object as last time and its content hash (see WaveformBase::GetContentHash())
+	is unchanged, the executor puts its revision back to the previous value, so everything downstream is skipped.
+	Worth enabling for nodes which often regenerate identical data, such as file imports and sources which refresh
+	unconditionally. Hashing costs a pass over the data on the CPU, so the default implementation returns false.
+ */
+bool FlowGraphNode::IsOutputContentHashed()
+{
+	return false;
+}
+
+/**
+	@brief Gets a number which changes every time the configuration of this node changes
+
+	The value is the newest revision of any parameter, or of the last MarkDirty() call, so it never repeats.
+ */
+uint64_t FlowGraphNode::GetConfigRevision()
+{
+	uint64_t rev = m_dirtyRevision;
+	for(auto& it : m_parameters)
+		rev = std::max(rev, it.second.GetRevision());
+	return rev;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Accessors
 
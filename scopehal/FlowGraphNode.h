@@ -128,6 +128,8 @@ public:
 	};
 
 	virtual DataLocation GetInputLocation();
+	virtual bool ConsumesInputsOnGpu();
+	virtual bool AcceptsRawSamples(size_t i);
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Filter evaluation
@@ -139,6 +141,23 @@ public:
 	//Filter evaluation (GPU accelerated)
 	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue);
 
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Incremental evaluation
+
+	virtual bool IsRefreshSkippable();
+	virtual bool IsOutputContentHashed();
+	uint64_t GetConfigRevision();
+
+	/**
+		@brief Forces the node to be refreshed the next time the graph is evaluated, even if nothing it depends on
+		has changed.
+
+		This should be called after changing any internal state that affects the output of Refresh() but is not
+		visible to the executor as a parameter or input change (for example, clearing accumulated sweeps).
+	 */
+	void MarkDirty()
+	{ m_dirtyRevision = FilterParameter::AllocateRevision(); }
+
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Error detection and reporting
 public:
@@ -167,23 +186,23 @@ protected:
 
 	///@brief Gets the analog waveform attached to the specified input
 	SparseAnalogWaveform* GetSparseAnalogInputWaveform(size_t i)
-	{ return dynamic_cast<SparseAnalogWaveform*>(GetInputWaveform(i)); }
+	{ return WaveformCast<SparseAnalogWaveform>(GetInputWaveform(i)); }
 
 	///@brief Gets the analog waveform attached to the specified input
 	UniformAnalogWaveform* GetUniformAnalogInputWaveform(size_t i)
-	{ return dynamic_cast<UniformAnalogWaveform*>(GetInputWaveform(i)); }
+	{ return WaveformCast<UniformAnalogWaveform>(GetInputWaveform(i)); }
 
 	///@brief Gets the digital waveform attached to the specified input
 	SparseDigitalWaveform* GetSparseDigitalInputWaveform(size_t i)
-	{ return dynamic_cast<SparseDigitalWaveform*>(GetInputWaveform(i)); }
+	{ return WaveformCast<SparseDigitalWaveform>(GetInputWaveform(i)); }
 
 	///@brief Gets the digital waveform attached to the specified input
 	UniformDigitalWaveform* GetUniformDigitalInputWaveform(size_t i)
-	{ return dynamic_cast<UniformDigitalWaveform*>(GetInputWaveform(i)); }
+	{ return WaveformCast<UniformDigitalWaveform>(GetInputWaveform(i)); }
 
 	///Gets the digital bus waveform attached to the specified input
 	SparseDigitalBusWaveform* GetSparseDigitalBusInputWaveform(size_t i)
-	{ return dynamic_cast<SparseDigitalBusWaveform*>(GetInputWaveform(i)); }
+	{ return WaveformCast<SparseDigitalBusWaveform>(GetInputWaveform(i)); }
 
 	void CreateInput(const std::string& name);
 
@@ -249,6 +268,9 @@ protected:
 
 	///@brief Log of error messages from the most recent filter refresh
 	std::string m_errorLog;
+
+	///@brief Revision number assigned by the most recent MarkDirty() call
+	std::atomic<uint64_t> m_dirtyRevision;
 };
 
 #endif
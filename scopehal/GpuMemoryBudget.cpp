@@ -0,0 +1,279 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of GpuMemoryBudget
+	@ingroup vksupport
+ */
+
+#include "scopehal.h"
+#include "GpuMemoryBudget.h"
+
+using namespace std;
+
+unique_ptr<GpuMemoryBudget> g_gpuMemoryBudget;
+
+thread_local GpuMemoryBudget::OwnerScope* GpuMemoryBudget::OwnerScope::m_current = nullptr;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+GpuMemoryBudget::GpuMemoryBudget()
+	: m_pollCount(0)
+	, m_minIdlePolls(2)
+	, m_highWatermark(0.9f)
+	, m_lowWatermark(0.75f)
+{
+}
+
+GpuMemoryBudget::~GpuMemoryBudget()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Registration
+
+/**
+	@brief Gets the owner that allocations made by the calling thread are attributed to
+
+	@return The innermost active owner, or an empty string if there is none
+ */
+const string& GpuMemoryBudget::OwnerScope::GetCurrentOwner()
+{
+	static const string none;
+	if(m_current)
+		return m_current->m_owner;
+	return none;
+}
+
+/**
+	@brief Registers a buffer's GPU allocation, replacing any previous registration of the same buffer
+
+	@param buffer	The buffer (only used as a key and passed back to evict)
+	@param evict	Function to call to evict the buffer
+	@param bytes	Size of the GPU allocation
+
+	@return The registration, valid until the buffer is unregistered or evicted
+ */
+GpuMemoryBudget::Entry* GpuMemoryBudget::Register(void* buffer, EvictFunction evict, size_t bytes)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	auto& entry = m_entries[buffer];
+	if(entry)
+	{
+		auto& old = m_usage[entry->m_owner];
+		old.m_bufferCount --;
+		old.m_bytes -= entry->m_bytes;
+	}
+
+	auto& owner = OwnerScope::GetCurrentOwner();
+	entry = make_unique<Entry>(evict, bytes, owner, m_pollCount.load(memory_order_relaxed));
+
+	auto& usage = m_usage[owner];
+	usage.m_bufferCount ++;
+	usage.m_bytes += bytes;
+
+	return entry.get();
+}
+
+/**
+	@brief Removes a buffer's registration, if it has one
+
+	@param buffer	The buffer
+ */
+void GpuMemoryBudget::Unregister(void* buffer)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	auto it = m_entries.find(buffer);
+	if(it == m_entries.end())
+		return;
+
+	auto& usage = m_usage[it->second->m_owner];
+	usage.m_bufferCount --;
+	usage.m_bytes -= it->second->m_bytes;
+	m_entries.erase(it);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Budget enforcement
+
+/**
+	@brief Sets the watermarks, as fractions of the budget
+
+	@param high		Usage above which Poll() starts freeing memory
+	@param low		Usage Poll() tries to get back down to
+ */
+void GpuMemoryBudget::SetWatermarks(float high, float low)
+{
+	m_highWatermark = high;
+	m_lowWatermark = min(low, high);
+}
+
+/**
+	@brief Gets the budget and current usage of the device-local heap
+
+	@param budget	Memory the driver lets us use (VK_EXT_memory_budget), or the whole heap without the extension
+	@param usage	Memory currently in use, including allocations by other processes if the driver reports them
+
+	@return False if there's no separate device-local memory to manage
+ */
+bool GpuMemoryBudget::GetDeviceUsage(uint64_t& budget, uint64_t& usage)
+{
+	if(g_vulkanDeviceHasUnifiedMemory || !g_vkComputePhysicalDevice || !g_vkLocalMemoryArena)
+		return false;
+
+	if(g_hasMemoryBudget)
+	{
+		auto props = g_vkComputePhysicalDevice->getMemoryProperties2<
+			vk::PhysicalDeviceMemoryProperties2,
+			vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+		auto& budgetProps = props.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+		budget = budgetProps.heapBudget[g_vkLocalMemoryHeap];
+		usage = budgetProps.heapUsage[g_vkLocalMemoryHeap];
+	}
+	else
+	{
+		budget = g_vkComputePhysicalDevice->getMemoryProperties().memoryHeaps[g_vkLocalMemoryHeap].size;
+		usage = g_vkLocalMemoryArena->GetStatistics().m_reservedBytes;
+	}
+
+	return budget != 0;
+}
+
+/**
+	@brief Checks GPU memory usage, and frees memory if we're above the high watermark
+
+	Call this regularly from a thread which isn't running filters, e.g. once per waveform.
+	FilterGraphExecutor does this each time a generation completes.
+
+	@return Number of bytes of GPU copies evicted
+ */
+size_t GpuMemoryBudget::Poll()
+{
+	uint64_t poll = m_pollCount.fetch_add(1, memory_order_relaxed) + 1;
+
+	uint64_t budget;
+	uint64_t usage;
+	if(!GetDeviceUsage(budget, usage))
+		return 0;
+	if(usage <= budget * m_highWatermark.load())
+		return 0;
+
+	//Nobody may be using buffers while we evict them. If filters are running, try again next time
+	unique_lock<shared_mutex> lock(g_vulkanActivityMutex, try_to_lock);
+	if(!lock.owns_lock())
+		return 0;
+
+	//Drop pooled waveforms and caches first, that's cheaper than evicting data we might need again
+	OnMemoryPressure(MemoryPressureLevel::Soft, MemoryPressureType::Device, 0);
+	if(!GetDeviceUsage(budget, usage))
+		return 0;
+	uint64_t target = budget * m_lowWatermark.load();
+	if(usage <= target)
+		return 0;
+
+	uint64_t idle = m_minIdlePolls.load();
+	size_t evicted = EvictLeastRecentlyUsed(usage - target, (poll > idle) ? (poll - idle) : 0);
+	if(evicted)
+	{
+		//Hand blocks which are now empty back to the driver
+		g_vkLocalMemoryArena->Defragment();
+
+		LogDebug("GpuMemoryBudget: evicted %s of idle GPU buffers (was using %s of %s)\n",
+			Unit(Unit::UNIT_BYTES).PrettyPrint(evicted, 4).c_str(),
+			Unit(Unit::UNIT_BYTES).PrettyPrint(usage, 4).c_str(),
+			Unit(Unit::UNIT_BYTES).PrettyPrint(budget, 4).c_str());
+	}
+
+	return evicted;
+}
+
+/**
+	@brief Evicts registered buffers, least recently used first
+
+	@param bytes			Amount of memory to free
+	@param lastUseBefore	Only buffers last used before this poll are considered
+
+	@return Number of bytes freed
+ */
+size_t GpuMemoryBudget::EvictLeastRecentlyUsed(size_t bytes, uint64_t lastUseBefore)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	vector<pair<uint64_t, void*>> candidates;
+	for(auto& it : m_entries)
+	{
+		auto lastUse = it.second->m_lastUse.load(memory_order_relaxed);
+		if(lastUse < lastUseBefore)
+			candidates.push_back(make_pair(lastUse, it.first));
+	}
+	sort(candidates.begin(), candidates.end());
+
+	size_t freed = 0;
+	for(auto& c : candidates)
+	{
+		if(freed >= bytes)
+			break;
+
+		auto it = m_entries.find(c.second);
+		auto& entry = it->second;
+		if(!entry->m_evict(c.second))
+			continue;
+
+		freed += entry->m_bytes;
+
+		auto& usage = m_usage[entry->m_owner];
+		usage.m_bufferCount --;
+		usage.m_bytes -= entry->m_bytes;
+		usage.m_evictions ++;
+		usage.m_evictedBytes += entry->m_bytes;
+
+		m_entries.erase(it);
+	}
+
+	return freed;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Statistics
+
+/**
+	@brief Gets GPU memory usage broken down by owner
+
+	Buffers allocated outside of any OwnerScope are listed under an empty name.
+ */
+map<string, GpuMemoryBudget::Usage> GpuMemoryBudget::GetUsage()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_usage;
+}
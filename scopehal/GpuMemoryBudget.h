@@ -0,0 +1,212 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of GpuMemoryBudget
+	@ingroup vksupport
+ */
+
+#ifndef GpuMemoryBudget_h
+#define GpuMemoryBudget_h
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+	@brief Keeps GPU memory usage under the driver's budget by evicting idle GPU copies of buffers
+	@ingroup vksupport
+
+	Every AcceleratorBuffer which allocates dedicated GPU memory registers it here. The registration is tagged with
+	the owner active on the calling thread (see OwnerScope), normally the filter being refreshed. Each time a buffer
+	is prepared for GPU access, it marks its registration as used.
+
+	Poll() compares device-local heap usage against the budget. The budget comes from VK_EXT_memory_budget if
+	available, otherwise it is the heap size. Once usage crosses the high watermark, Poll() raises soft memory
+	pressure. If that is not enough, it frees the GPU copies of the least recently used buffers until usage is back
+	under the low watermark. A buffer holding GPU data newer than its CPU copy is copied back first. Buffers with no
+	CPU-side storage at all are never evicted. An evicted buffer is uploaded again the next time it is prepared for GPU
+	access, so the amount of history a session can hold is bounded by host memory, not by VRAM.
+
+	Eviction must not race with anything using the buffers. Poll() therefore does nothing unless it can take
+	g_vulkanActivityMutex exclusively, and it never touches buffers used within the last few polls.
+ */
+class GpuMemoryBudget
+{
+public:
+	GpuMemoryBudget();
+	~GpuMemoryBudget();
+
+	/**
+		@brief Frees the GPU copy of a registered buffer
+
+		Called with the budget's lock held; must not call Unregister(). Returns false if the buffer cannot be evicted
+		right now.
+	 */
+	typedef bool (*EvictFunction)(void* buffer);
+
+	/**
+		@brief A registered GPU allocation
+	 */
+	class Entry
+	{
+	public:
+		Entry(EvictFunction evict, size_t bytes, const std::string& owner, uint64_t lastUse)
+		: m_evict(evict)
+		, m_bytes(bytes)
+		, m_owner(owner)
+		, m_lastUse(lastUse)
+		{}
+
+		///@brief Function to call to evict the buffer
+		EvictFunction m_evict;
+
+		///@brief Size of the GPU allocation
+		size_t m_bytes;
+
+		///@brief Owner of the buffer at the time the GPU memory was allocated
+		std::string m_owner;
+
+		///@brief Poll count at which the buffer was last prepared for GPU access
+		std::atomic<uint64_t> m_lastUse;
+	};
+
+	/**
+		@brief GPU memory usage of all buffers belonging to a single owner
+	 */
+	class Usage
+	{
+	public:
+		Usage()
+		: m_bufferCount(0)
+		, m_bytes(0)
+		, m_evictions(0)
+		, m_evictedBytes(0)
+		{}
+
+		///@brief Number of buffers currently holding GPU memory
+		size_t m_bufferCount;
+
+		///@brief Total GPU memory currently held
+		size_t m_bytes;
+
+		///@brief Number of times a buffer was evicted (since startup)
+		size_t m_evictions;
+
+		///@brief Total GPU memory evicted (since startup)
+		size_t m_evictedBytes;
+	};
+
+	/**
+		@brief Sets the owner that GPU allocations made by the calling thread are attributed to, while it exists
+	 */
+	class OwnerScope
+	{
+	public:
+		OwnerScope(const std::string& owner)
+		: m_owner(owner)
+		, m_previous(m_current)
+		{ m_current = this; }
+
+		~OwnerScope()
+		{ m_current = m_previous; }
+
+		//non-copyable
+		OwnerScope(const OwnerScope&) = delete;
+		OwnerScope& operator=(const OwnerScope&) = delete;
+
+		///@brief Get the owner active on the calling thread (empty if none)
+		static const std::string& GetCurrentOwner();
+
+	protected:
+		///@brief Name of the owner
+		std::string m_owner;
+
+		///@brief Scope which was active before this one was created
+		OwnerScope* m_previous;
+
+		///@brief Scope active on the calling thread
+		static thread_local OwnerScope* m_current;
+	};
+
+	Entry* Register(void* buffer, EvictFunction evict, size_t bytes);
+	void Unregister(void* buffer);
+
+	///@brief Marks a registered buffer as used just now
+	void Touch(Entry* entry)
+	{ entry->m_lastUse.store(m_pollCount.load(std::memory_order_relaxed), std::memory_order_relaxed); }
+
+	size_t Poll();
+
+	std::map<std::string, Usage> GetUsage();
+
+	void SetWatermarks(float high, float low);
+
+	/**
+		@brief Sets how many calls to Poll() a buffer must go unused for before it may be evicted
+
+		@param polls	Minimum idle time, in polls
+	 */
+	void SetMinimumIdlePolls(uint64_t polls)
+	{ m_minIdlePolls = polls; }
+
+	bool GetDeviceUsage(uint64_t& budget, uint64_t& usage);
+
+protected:
+	size_t EvictLeastRecentlyUsed(size_t bytes, uint64_t lastUseBefore);
+
+	///@brief Mutex protecting the registry and usage statistics
+	std::mutex m_mutex;
+
+	///@brief Every registered buffer
+	std::map<void*, std::unique_ptr<Entry>> m_entries;
+
+	///@brief Usage statistics by owner
+	std::map<std::string, Usage> m_usage;
+
+	///@brief Number of times Poll() has been called
+	std::atomic<uint64_t> m_pollCount;
+
+	///@brief Minimum number of polls a buffer must be idle for before it can be evicted
+	std::atomic<uint64_t> m_minIdlePolls;
+
+	///@brief Fraction of the budget above which we start evicting
+	std::atomic<float> m_highWatermark;
+
+	///@brief Fraction of the budget we evict down to
+	std::atomic<float> m_lowWatermark;
+};
+
+extern std::unique_ptr<GpuMemoryBudget> g_gpuMemoryBudget;
+
+#endif
@@ -0,0 +1,196 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of GpuTimestampPool
+	@ingroup vksupport
+ */
+
+#include "scopehal.h"
+#include "GpuTimestampPool.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates a pool of timestamp query pairs for a queue
+
+	@param queue	The queue the timed submissions will be made to
+	@param name		Name prefix for debug labels
+	@param npairs	Number of submissions which may be in flight at once
+ */
+GpuTimestampPool::GpuTimestampPool(shared_ptr<QueueHandle> queue, const string& name, size_t npairs)
+	: m_supported(false)
+	, m_family(queue->m_family)
+	, m_period(1)
+	, m_mask(~0ULL)
+	, m_offset(0)
+{
+	auto families = g_vkComputePhysicalDevice->getQueueFamilyProperties();
+	uint32_t validBits = 0;
+	if(m_family < families.size())
+		validBits = families[m_family].timestampValidBits;
+	if( (validBits == 0) || (npairs == 0) )
+	{
+		LogDebug("%s: queue does not support timestamps, GPU time will not be measured\n", name.c_str());
+		return;
+	}
+	m_period = g_vkComputePhysicalDevice->getProperties().limits.timestampPeriod;
+	if(validBits < 64)
+		m_mask = (1ULL << validBits) - 1;
+
+	vk::QueryPoolCreateInfo qinfo({}, vk::QueryType::eTimestamp, npairs * 2);
+	m_queryPool = make_unique<vk::raii::QueryPool>(*g_vkComputeDevice, qinfo);
+
+	vk::CommandPoolCreateInfo poolInfo({}, m_family);
+	m_commandPool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo);
+
+	//The command buffers never change, so record them all up front
+	vk::CommandBufferAllocateInfo bufinfo(**m_commandPool, vk::CommandBufferLevel::ePrimary, npairs * 2);
+	vk::raii::CommandBuffers bufs(*g_vkComputeDevice, bufinfo);
+	for(size_t i=0; i<npairs; i++)
+	{
+		auto begin = make_unique<vk::raii::CommandBuffer>(std::move(bufs[i*2]));
+		begin->begin({});
+		begin->resetQueryPool(**m_queryPool, i*2, 2);
+		begin->writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, **m_queryPool, i*2);
+		begin->end();
+
+		auto end = make_unique<vk::raii::CommandBuffer>(std::move(bufs[i*2 + 1]));
+		end->begin({});
+		end->writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, **m_queryPool, i*2 + 1);
+		end->end();
+
+		m_beginBuffers.push_back(std::move(begin));
+		m_endBuffers.push_back(std::move(end));
+		m_freePairs.push_back(npairs - 1 - i);
+	}
+
+	if(g_hasDebugUtils)
+	{
+		string poolname = name + ".queryPool";
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eQueryPool,
+				reinterpret_cast<uint64_t>(static_cast<VkQueryPool>(**m_queryPool)),
+				poolname.c_str()));
+	}
+
+	Calibrate(queue);
+	m_supported = true;
+}
+
+GpuTimestampPool::~GpuTimestampPool()
+{
+	//Command buffers have to go before the pool they came from
+	m_beginBuffers.clear();
+	m_endBuffers.clear();
+}
+
+/**
+	@brief Measures the offset between GPU timestamps and GetTime()
+
+	Writes a single timestamp and assumes it was taken halfway between submission and completion, which is accurate to
+	within the submission latency.
+ */
+void GpuTimestampPool::Calibrate(shared_ptr<QueueHandle> queue)
+{
+	size_t pair = m_freePairs.back();
+
+	double start = GetTime();
+	queue->SubmitAndBlock(*m_beginBuffers[pair]);
+	double end = GetTime();
+
+	auto res = m_queryPool->getResults<uint64_t>(
+		pair * 2, 1, sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+	if(res.first != vk::Result::eSuccess)
+		return;
+
+	m_offset = (start + end)/2 - (res.second[0] & m_mask) * m_period * 1e-9;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Query management
+
+/**
+	@brief Gets a free pair of queries
+
+	@param pair	Index of the pair
+	@return False if no pairs are free (or timestamps are not supported)
+ */
+bool GpuTimestampPool::Allocate(size_t& pair)
+{
+	if(!m_supported)
+		return false;
+
+	lock_guard<mutex> lock(m_mutex);
+	if(m_freePairs.empty())
+		return false;
+
+	pair = m_freePairs.back();
+	m_freePairs.pop_back();
+	return true;
+}
+
+///@brief Returns a pair to the pool without reading it
+void GpuTimestampPool::Free(size_t pair)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_freePairs.push_back(pair);
+}
+
+/**
+	@brief Reads back the timestamps of a pair and returns it to the pool
+
+	The submission the pair was used for must have completed.
+
+	@param pair		Index of the pair
+	@param start	Start time of the work, in the GetTime() timebase
+	@param duration	Execution time of the work, in seconds
+
+	@return False if the timestamps were not available
+ */
+bool GpuTimestampPool::Resolve(size_t pair, double& start, double& duration)
+{
+	auto res = m_queryPool->getResults<uint64_t>(
+		pair * 2, 2, 2 * sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+	Free(pair);
+	if(res.first != vk::Result::eSuccess)
+		return false;
+
+	uint64_t t0 = res.second[0] & m_mask;
+	uint64_t ticks = (res.second[1] - t0) & m_mask;
+	start = m_offset + t0 * m_period * 1e-9;
+	duration = ticks * m_period * 1e-9;
+	return true;
+}
@@ -0,0 +1,131 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of GpuTimestampPool
+	@ingroup vksupport
+ */
+
+#ifndef GpuTimestampPool_h
+#define GpuTimestampPool_h
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+class QueueHandle;
+
+/**
+	@brief Measures how long GPU work takes, using pairs of timestamp queries around each submission
+	@ingroup vksupport
+
+	Each pair of queries has two prerecorded command buffers: one resets the pair and writes the start timestamp, the
+	other writes the end timestamp. While a pool is attached to a QueueSubmitScope (see
+	QueueSubmitScope::SetTimestampPool()), every submission to a queue of the pool's family is bracketed by the
+	command buffers of a free pair, in the same vkQueueSubmit() call, and the pair is recorded in the scope. Once the
+	work has completed, Resolve() reads the timestamps back without stalling and frees the pair.
+
+	Timestamps are converted to the GetTime() timebase using an offset measured once, when the pool is created, so
+	GPU and CPU events can be shown on the same timeline.
+
+	Allocation is thread safe. If all pairs are in use, submissions are simply not timed.
+ */
+class GpuTimestampPool
+{
+public:
+	GpuTimestampPool(std::shared_ptr<QueueHandle> queue, const std::string& name, size_t npairs = 256);
+	~GpuTimestampPool();
+
+	///@brief Returns true if the queue supports timestamps
+	bool IsSupported()
+	{ return m_supported; }
+
+	///@brief Gets the family of the queue the pool was created for
+	size_t GetFamily()
+	{ return m_family; }
+
+	bool Allocate(size_t& pair);
+	void Free(size_t pair);
+	bool Resolve(size_t pair, double& start, double& duration);
+
+	///@brief Gets the command buffer which starts timing with a pair
+	vk::CommandBuffer GetBeginCommandBuffer(size_t pair)
+	{ return **m_beginBuffers[pair]; }
+
+	///@brief Gets the command buffer which ends timing with a pair
+	vk::CommandBuffer GetEndCommandBuffer(size_t pair)
+	{ return **m_endBuffers[pair]; }
+
+public:
+	//non-copyable
+	GpuTimestampPool(GpuTimestampPool const&) = delete;
+	GpuTimestampPool& operator=(GpuTimestampPool const&) = delete;
+
+protected:
+	void Calibrate(std::shared_ptr<QueueHandle> queue);
+
+	///@brief True if the queue family supports timestamps
+	bool m_supported;
+
+	///@brief Queue family the command buffers were allocated for
+	size_t m_family;
+
+	///@brief Nanoseconds per timestamp tick
+	double m_period;
+
+	///@brief Mask of valid timestamp bits
+	uint64_t m_mask;
+
+	///@brief GetTime() at GPU timestamp zero, in seconds
+	double m_offset;
+
+	///@brief The query pool (two queries per pair)
+	std::unique_ptr<vk::raii::QueryPool> m_queryPool;
+
+	///@brief Pool the prerecorded command buffers came from
+	std::unique_ptr<vk::raii::CommandPool> m_commandPool;
+
+	///@brief Command buffers resetting each pair and writing its start timestamp
+	std::vector<std::unique_ptr<vk::raii::CommandBuffer>> m_beginBuffers;
+
+	///@brief Command buffers writing the end timestamp of each pair
+	std::vector<std::unique_ptr<vk::raii::CommandBuffer>> m_endBuffers;
+
+	///@brief Mutex protecting m_freePairs
+	std::mutex m_mutex;
+
+	///@brief Pairs which are not in use
+	std::vector<size_t> m_freePairs;
+};
+
+#endif
@@ -63,6 +63,9 @@ HaasoscopePro::HaasoscopePro(SCPITransport* transport)
 	, m_diag_droppedWFMs(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS))
 	, m_diag_droppedPercent(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_PERCENT))
 {
+	//Streaming instrument: if we get backed up, drop old waveforms rather than falling further behind
+	SetPendingWaveformPolicy(PENDING_DROP_OLDEST, 2);
+
 	m_analogChannelCount = 4;
 
 	//Add analog channel objects
@@ -117,47 +120,9 @@ HaasoscopePro::HaasoscopePro(SCPITransport* transport)
 
 	ResetPerCaptureDiagnostics();
 
-	//Initialize waveform buffers
-	for(size_t i=0; i<m_analogChannelCount; i++)
-	{
-		m_analogRawWaveformBuffers.push_back(std::make_unique<AcceleratorBuffer<int16_t> >());
-		m_analogRawWaveformBuffers[i]->SetCpuAccessHint(AcceleratorBuffer<int16_t>::HINT_LIKELY);
-		m_analogRawWaveformBuffers[i]->SetGpuAccessHint(AcceleratorBuffer<int16_t>::HINT_LIKELY);
-	}
-
-	//Create Vulkan objects for the waveform conversion
-	m_queue = g_vkQueueManager->GetComputeQueue("HaasoscopePro.queue");
-	vk::CommandPoolCreateInfo poolInfo(
-		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-		m_queue->m_family );
-	m_pool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo);
-
-	vk::CommandBufferAllocateInfo bufinfo(**m_pool, vk::CommandBufferLevel::ePrimary, 1);
-	m_cmdBuf = make_unique<vk::raii::CommandBuffer>(
-		std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
-
-	if(g_hasDebugUtils)
-	{
-		string poolname = "HaasoscopePro.pool";
-		string bufname = "HaasoscopePro.cmdbuf";
-
-		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
-			vk::DebugUtilsObjectNameInfoEXT(
-				vk::ObjectType::eCommandPool,
-				reinterpret_cast<uint64_t>(static_cast<VkCommandPool>(**m_pool)),
-				poolname.c_str()));
-
-		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
-			vk::DebugUtilsObjectNameInfoEXT(
-				vk::ObjectType::eCommandBuffer,
-				reinterpret_cast<uint64_t>(static_cast<VkCommandBuffer>(**m_cmdBuf)),
-				bufname.c_str()));
-	}
-
-	m_conversionPipeline = make_unique<ComputePipeline>(
-		"shaders/Convert16BitSamples.spv", 2, sizeof(ConvertRawSamplesShaderArgs) );
-
-	m_clippingBuffer.resize(1);
+	//Raw samples are streamed into a ring and converted straight from there
+	m_converter = make_unique<RawSampleConverter>("HaasoscopePro");
+	m_ring = make_unique<RawSampleRing>("HaasoscopePro", m_converter.get());
 
 	//set initial bandwidth on all channels to full
 	m_bandwidthLimits.resize(4);
@@ -353,6 +318,8 @@ bool HaasoscopePro::AcquireData()
 	vector<size_t> achans;
 	vector<float> scales;
 	vector<float> offsets;
+	vector<RawSampleRing::Region> regions;
+	vector<size_t> depths;
 
 	for(size_t i=0; i<numChannels; i++)
 	{
@@ -363,16 +330,11 @@ bool HaasoscopePro::AcquireData()
 			return false;
 		LogTrace("HaasoscopePro got memdepth %" PRIu64 " \n", memdepth);
 
-		auto& abuf = m_analogRawWaveformBuffers[chnum];
-		abuf->resize(memdepth);
-		abuf->PrepareForCpuAccess();
 		achans.push_back(chnum);
 
 		//Analog channels
 		if(chnum < m_analogChannelCount)
 		{
-			auto buf = abuf->GetCpuPointer();
-
 			//Scale and offset are sent in the header since they might have changed since the capture began
 			if(!m_transport->ReadRawData(sizeof(config), (uint8_t*)&config))
 				return false;
@@ -391,13 +353,16 @@ bool HaasoscopePro::AcquireData()
 
 			//FIXME: stream timestamp from the server
 
-			if(!m_transport->ReadRawData(memdepth * sizeof(int16_t), (uint8_t*)buf))
+			//Read straight into the next free region of the ring
+			auto region = m_ring->Allocate(memdepth * sizeof(int16_t));
+			if(!m_transport->ReadRawData(memdepth * sizeof(int16_t), region.m_ptr))
 				return false;
+			auto buf = reinterpret_cast<const int16_t*>(region.m_ptr);
 			LogTrace("HaasoscopePro got data bytes... %d %d %d ...\n", buf[0],buf[1],buf[2]);
-			abuf->MarkModifiedFromCpu();
+			region.m_slab->MarkModifiedFromCpu();
 
 			//Create our waveform
-			UniformAnalogWaveform* cap = AllocateAnalogWaveform(m_nickname + "." + GetChannel(i)->GetHwname());
+			UniformAnalogWaveform* cap = AllocateAnalogWaveform(m_nickname + "." + GetChannel(i)->GetHwname(), memdepth);
 			cap->m_timescale = fs_per_sample;
 			cap->m_triggerPhase = trigphase;
 			cap->m_startTimestamp = time(NULL);
@@ -405,10 +370,11 @@ bool HaasoscopePro::AcquireData()
 			if (clipping)
 				cap->m_flags |= WaveformBase::WAVEFORM_CLIPPING;
 
-			cap->Resize(memdepth);
 			awfms.push_back(cap);
 			scales.push_back(scale);
 			offsets.push_back(offset);
+			regions.push_back(region);
+			depths.push_back(memdepth);
 
 			s[GetOscilloscopeChannel(chnum)] = cap;
 		}
@@ -418,54 +384,25 @@ bool HaasoscopePro::AcquireData()
 		}
 	}
 
-	//Prefer GPU path
-	if(g_hasShaderInt16 && g_hasPushDescriptor)
+	//Convert all channels in one batch straight from the ring on the GPU. Without GPU conversion, make each
+	//waveform a view of its raw codes and only convert on the CPU if something needs floating point samples
+	bool gpu = RawSampleConverter::IsGpuConversionAvailable16Bit();
+	for(size_t i=0; i<awfms.size(); i++)
 	{
-		LogTrace("HaasoscopePro doing GPU path \n");
-		m_cmdBuf->begin({});
-		m_conversionPipeline->Bind(*m_cmdBuf);
-		for(size_t i=0; i<awfms.size(); i++)
+		auto& region = regions[i];
+		size_t depth = depths[i];
+		if(gpu)
 		{
-			auto cap = awfms[i];
-
-			m_conversionPipeline->BindBufferNonblocking(0, cap->m_samples, *m_cmdBuf, true);
-			m_conversionPipeline->BindBufferNonblocking(1, *m_analogRawWaveformBuffers[achans[i]], *m_cmdBuf);
-
-			ConvertRawSamplesShaderArgs args;
-			args.size = cap->size();
-			args.gain = scales[i];
-			args.offset = -offsets[i];
-
-			const uint32_t compute_block_count = GetComputeBlockCount(cap->size(), 64);
-			m_conversionPipeline->DispatchNoRebind(
-				*m_cmdBuf, args,
-				min(compute_block_count, 32768u),
-				compute_block_count / 32768 + 1);
-			cap->MarkModifiedFromGpu();
+			awfms[i]->Resize(depth);
+			m_converter->Convert16Bit(awfms[i], *region.m_slab, scales[i], offsets[i], region.m_byteOffset / sizeof(int16_t));
 		}
-
-		m_cmdBuf->end();
-		m_queue->SubmitAndBlock(*m_cmdBuf);
-	}
-
-	//Fallback path if GPU doesn't have suitable integer support
-	else
-	{
-		LogTrace("HaasoscopePro doing GPU path \n");
-		#pragma omp parallel for  //Process analog captures in parallel
-		for(size_t i=0; i<awfms.size(); i++)
+		else
 		{
-			auto cap = awfms[i];
-			cap->PrepareForCpuAccess();
-			Convert16BitSamples(
-				(float*)&cap->m_samples[0],
-				(int16_t*)m_analogRawWaveformBuffers[achans[i]]->GetCpuPointer(),
-				scales[i],
-				offsets[i],
-				cap->m_samples.size());
-			cap->MarkModifiedFromCpu();
+			awfms[i]->SetRawSampleView(
+				region.m_slab, region.m_byteOffset, depth, 16, scales[i], offsets[i]);
 		}
 	}
+	m_converter->WaitIdle();
 
 	FilterParameter* param = &m_diag_totalWFMs;
 	int total = param->GetIntVal() + 1;
@@ -475,20 +412,7 @@ bool HaasoscopePro::AcquireData()
 	int dropped = param->GetIntVal();
 
 	//Save the waveforms to our queue
-	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(s);
-
-	while (m_pendingWaveforms.size() > 2)
-	{
-		SequenceSet set = *m_pendingWaveforms.begin();
-		for(auto it : set)
-			delete it.second;
-		m_pendingWaveforms.pop_front();
-
-		dropped++;
-	}
-
-	m_pendingWaveformsMutex.unlock();
+	dropped += PushPendingWaveform(s);
 
 	param->SetIntVal(dropped);
 
@@ -120,23 +120,11 @@ protected:
 	///@brief Counter of average trigger rate
 	HzClock m_receiveClock;
 
-	///@brief Buffers for storing raw ADC samples before converting to fp32
-	std::vector<std::unique_ptr<AcceleratorBuffer<int16_t> > > m_analogRawWaveformBuffers;
+	///@brief Converts raw ADC codes to float32 samples
+	std::unique_ptr<RawSampleConverter> m_converter;
 
-	///@brief Vulkan queue used for sample conversion
-	std::shared_ptr<QueueHandle> m_queue;
-
-	///@brief Command pool from which m_cmdBuf was allocated
-	std::unique_ptr<vk::raii::CommandPool> m_pool;
-
-	///@brief Command buffer for sample conversion
-	std::unique_ptr<vk::raii::CommandBuffer> m_cmdBuf;
-
-	///@brief Compute pipeline for converting raw ADC codes to float32 samples
-	std::unique_ptr<ComputePipeline> m_conversionPipeline;
-
-	///@brief Buffer for storing channel clip state
-	AcceleratorBuffer<uint32_t> m_clippingBuffer;
+	///@brief Pinned memory raw ADC samples are streamed into
+	std::unique_ptr<RawSampleRing> m_ring;
 
 	///@brief Bandwidth limiters
 	std::vector<unsigned int> m_bandwidthLimits;
@@ -37,10 +37,80 @@
 
 using namespace std;
 
+/**
+	@brief Builds a lookup table from a set of raw, sorted points
+
+	The table spacing is the smallest X step in the raw data (so uniformly spaced data, as is typical for V/T curves,
+	resamples exactly) unless that would exceed IBISLookupTable::MAX_POINTS.
+
+	@param table	Table to build
+	@param xmin		X value of the first raw point
+	@param xmax		X value of the last raw point
+	@param minStep	Smallest positive X step between consecutive raw points
+	@param eval		Function evaluating the raw curve at a given X value
+ */
+template<class F>
+static void BuildLookupTable(IBISLookupTable& table, float xmin, float xmax, float minStep, F eval)
+{
+	float span = xmax - xmin;
+	if( (span <= 0) || (minStep <= 0) )
+	{
+		table.m_start = xmin;
+		table.m_invStep = 0;
+		table.m_values.assign(1, eval(xmin));
+		return;
+	}
+
+	size_t npoints = ceil(span / minStep) + 1;
+	if(npoints > IBISLookupTable::MAX_POINTS)
+		npoints = IBISLookupTable::MAX_POINTS;
+	float step = span / (npoints - 1);
+
+	table.m_start = xmin;
+	table.m_invStep = 1.0f / step;
+	table.m_values.resize(npoints);
+	for(size_t i=0; i<npoints; i++)
+		table.m_values[i] = eval(xmin + step*i);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // IVCurve
 
+/**
+	@brief Resamples the curve into m_table
+ */
+void IVCurve::Precompile()
+{
+	m_table.clear();
+	if(m_curve.empty())
+		return;
+
+	float minStep = FLT_MAX;
+	for(size_t i=1; i<m_curve.size(); i++)
+	{
+		float dv = m_curve[i].m_voltage - m_curve[i-1].m_voltage;
+		if(dv > 0)
+			minStep = min(minStep, dv);
+	}
+
+	BuildLookupTable(m_table, m_curve[0].m_voltage, m_curve.back().m_voltage, minStep,
+		[this](float v) { return InterpolateRawCurrent(v); });
+}
+
+/**
+	@brief Gets the current at a given voltage, using the precompiled table if available
+ */
 float IVCurve::InterpolateCurrent(float voltage)
+{
+	if(!m_table.empty())
+		return m_table.Lookup(voltage);
+	return InterpolateRawCurrent(voltage);
+}
+
+/**
+	@brief Gets the current at a given voltage by searching the raw curve data
+ */
+float IVCurve::InterpolateRawCurrent(float voltage)
 {
 	//Binary search to find the points straddling us
 	size_t len = m_curve.size();
@@ -97,7 +167,46 @@ float IVCurve::InterpolateCurrent(float voltage)
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // VTCurves
 
+/**
+	@brief Resamples each corner's curve into a lookup table
+ */
+void VTCurves::Precompile()
+{
+	for(int corner=CORNER_MIN; corner<=CORNER_MAX; corner++)
+	{
+		auto& curve = m_curves[corner];
+		m_tables[corner].clear();
+		if(curve.empty())
+			continue;
+
+		float minStep = FLT_MAX;
+		for(size_t i=1; i<curve.size(); i++)
+		{
+			float dt = curve[i].m_time - curve[i-1].m_time;
+			if(dt > 0)
+				minStep = min(minStep, dt);
+		}
+
+		auto c = static_cast<IBISCorner>(corner);
+		BuildLookupTable(m_tables[corner], curve[0].m_time, curve.back().m_time, minStep,
+			[this, c](float t) { return InterpolateRawVoltage(c, t); });
+	}
+}
+
+/**
+	@brief Gets the voltage at a given time, using the precompiled table if available
+ */
 float VTCurves::InterpolateVoltage(IBISCorner corner, float time)
+{
+	if(!m_tables[corner].empty())
+		return m_tables[corner].Lookup(time);
+	return InterpolateRawVoltage(corner, time);
+}
+
+/**
+	@brief Gets the voltage at a given time by searching the raw curve data
+ */
+float VTCurves::InterpolateRawVoltage(IBISCorner corner, float time)
 {
 	//Binary search to find the points straddling us
 	size_t len = m_curves[corner].size();
@@ -172,6 +281,23 @@ int64_t VTCurves::GetPropagationDelay(IBISCorner corner)
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // IBISModel
 
+/**
+	@brief Precompiles every curve in the model into uniformly sampled lookup tables
+ */
+void IBISModel::Precompile()
+{
+	for(int corner=CORNER_MIN; corner<=CORNER_MAX; corner++)
+	{
+		m_pulldown[corner].Precompile();
+		m_pullup[corner].Precompile();
+	}
+
+	for(auto& curve : m_rising)
+		curve.Precompile();
+	for(auto& curve : m_falling)
+		curve.Precompile();
+}
+
 /**
 	@brief Get the falling-edge waveform terminated to ground (or lowest available voltage)
  */
@@ -650,6 +776,11 @@ bool IBISParser::Load(string fname)
 	}
 
 	fclose(fp);
+
+	//Resample all of the curves now so nothing has to search them later
+	for(auto it : m_models)
+		it.second->Precompile();
+
 	return true;
 }
 
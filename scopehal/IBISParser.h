@@ -37,6 +37,63 @@
 #ifndef IBISParser_h
 #define IBISParser_h
 
+/**
+	@brief A curve uniformly resampled along its X axis, for fast lookups
+
+	Built once from the raw (arbitrarily spaced) table data, so that evaluating the curve is a multiply, a clamp, and a
+	lerp rather than a search.
+ */
+class IBISLookupTable
+{
+public:
+	IBISLookupTable()
+	: m_start(0)
+	, m_invStep(0)
+	{}
+
+	///@brief Max number of points in a table
+	static const size_t MAX_POINTS = 65536;
+
+	///@brief Returns true if the table has been built
+	bool empty() const
+	{ return m_values.empty(); }
+
+	void clear()
+	{ m_values.clear(); }
+
+	/**
+		@brief Evaluates the table at the given X value, clipping to the first / last point if out of range
+
+		Returns zero if the table is empty, same as searching an empty curve.
+	 */
+	float Lookup(float x) const
+	{
+		if(m_values.empty())
+			return 0;
+
+		float pos = (x - m_start) * m_invStep;
+		size_t last = m_values.size() - 1;
+		if(pos <= 0)
+			return m_values[0];
+		if(pos >= last)
+			return m_values[last];
+
+		size_t i = static_cast<size_t>(pos);
+		float frac = pos - i;
+		float lo = m_values[i];
+		return lo + (m_values[i+1] - lo)*frac;
+	}
+
+	///@brief X value of the first point
+	float m_start;
+
+	///@brief Reciprocal of the X axis spacing between points
+	float m_invStep;
+
+	///@brief Y values for each point
+	std::vector<float> m_values;
+};
+
 //Almost all properties are indexed by a corner
 enum IBISCorner
 {
@@ -71,9 +128,15 @@ class IVCurve
 public:
 
 	float InterpolateCurrent(float voltage);
+	float InterpolateRawCurrent(float voltage);
+
+	void Precompile();
 
 	///@brief The raw I/V curve data
 	std::vector<IVPoint> m_curve;
+
+	///@brief m_curve resampled to uniformly spaced voltages (empty until Precompile() is called)
+	IBISLookupTable m_table;
 };
 
 /**
@@ -106,6 +169,15 @@ public:
 	{}
 
 	float InterpolateVoltage(IBISCorner corner, float time);
+	float InterpolateRawVoltage(IBISCorner corner, float time);
+
+	void Precompile();
+
+	/**
+		@brief Returns the precompiled lookup table for one corner (empty until Precompile() is called)
+	 */
+	const IBISLookupTable& GetTable(IBISCorner corner) const
+	{ return m_tables[corner]; }
 
 	int64_t GetPropagationDelay(IBISCorner corner);
 
@@ -114,6 +186,11 @@ public:
 
 	///@brief The raw V/T curve data
 	std::vector<VTPoint> m_curves[3];
+
+protected:
+
+	///@brief m_curves resampled to uniformly spaced timestamps
+	IBISLookupTable m_tables[3];
 };
 
 /**
@@ -173,6 +250,8 @@ public:
 
 	VTCurves* GetHighestFallingWaveform();
 	VTCurves* GetHighestRisingWaveform();
+
+	void Precompile();
 };
 
 /**
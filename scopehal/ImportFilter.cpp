@@ -67,6 +67,16 @@ bool ImportFilter::ValidateChannel(
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Accessors
 
+/**
+	@brief Clears all output streams, and forgets any paged loading state
+ */
+void ImportFilter::ClearStreams()
+{
+	m_pagedStreams.clear();
+	m_pagedFile = nullptr;
+	Filter::ClearStreams();
+}
+
 void ImportFilter::SetDefaultName()
 {
 	auto fname = m_parameters[m_fpname].ToString();
@@ -90,6 +100,220 @@ void ImportFilter::Refresh()
 	//everything happens in OnFileNameChanged
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Paged loading
+
+/**
+	@brief Adds the parameters controlling paged loading, for filters which use LoadMappedSamples()
+
+	Must be called from the constructor, after m_fpname is set up.
+ */
+void ImportFilter::AddPagingParameters()
+{
+	m_pagedname = "Paged Loading";
+	m_parameters[m_pagedname] = FilterParameter(FilterParameter::TYPE_BOOL, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_pagedname].SetBoolVal(false);
+	m_parameters[m_pagedname].signal_changed().connect(sigc::mem_fun(*this, &ImportFilter::OnPagingChanged));
+
+	m_windowStartName = "Window Start";
+	m_parameters[m_windowStartName] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_FS));
+	m_parameters[m_windowStartName].SetIntVal(0);
+	m_parameters[m_windowStartName].signal_changed().connect(sigc::mem_fun(*this, &ImportFilter::OnWindowChanged));
+
+	//Zero means as much as fits in the memory limit
+	m_windowLengthName = "Window Length";
+	m_parameters[m_windowLengthName] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_FS));
+	m_parameters[m_windowLengthName].SetIntVal(0);
+	m_parameters[m_windowLengthName].signal_changed().connect(sigc::mem_fun(*this, &ImportFilter::OnWindowChanged));
+
+	m_memoryLimitName = "Memory Limit";
+	m_parameters[m_memoryLimitName] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_BYTES));
+	m_parameters[m_memoryLimitName].SetIntVal(1024LL * 1024 * 1024);
+	m_parameters[m_memoryLimitName].signal_changed().connect(sigc::mem_fun(*this, &ImportFilter::OnWindowChanged));
+}
+
+/**
+	@brief Asks for a time window of the file to be loaded, if paged loading is on
+
+	The window is rounded out to whole pages, and cut short if it would use more than the memory limit.
+
+	@param start	Start of the window, in X axis units on the timebase of the full waveform
+	@param length	Length of the window, or zero for as much as fits in the memory limit
+ */
+void ImportFilter::RequestTimeWindow(int64_t start, int64_t length)
+{
+	if(m_pagedname.empty())
+		return;
+
+	//Don't reload twice
+	if( (m_parameters[m_windowStartName].GetIntVal() == start) &&
+		(m_parameters[m_windowLengthName].GetIntVal() == length) )
+	{
+		return;
+	}
+
+	m_parameters[m_windowLengthName].SetIntVal(length);
+	m_parameters[m_windowStartName].SetIntVal(start);
+}
+
+/**
+	@brief Gets the time range covered by the whole file, as opposed to the currently loaded window
+
+	@return False if nothing is paged
+ */
+bool ImportFilter::GetFullTimeRange(int64_t& start, int64_t& end)
+{
+	if(m_pagedStreams.empty())
+		return false;
+
+	start = INT64_MAX;
+	end = INT64_MIN;
+	for(auto& ps : m_pagedStreams)
+	{
+		start = min(start, ps.m_triggerPhase);
+		end = max(end, ps.m_triggerPhase + static_cast<int64_t>(ps.m_count) * ps.m_timescale);
+	}
+	return true;
+}
+
+/**
+	@brief Converts samples from a mapped file into a waveform, or indexes them for paged loading
+
+	Without paging this resizes the waveform and calls ConvertMappedSamples(). With paging on, the sample data is
+	only indexed, and the pages covering the current window are loaded. The file is mapped again internally, so the
+	caller's mapping doesn't need to stay open.
+
+	The waveform's m_timescale and m_triggerPhase must already be set, and it must already be the output of stream.
+
+	@return False if the sample data extends past the end of the file
+ */
+bool ImportFilter::LoadMappedSamples(
+	size_t stream,
+	UniformAnalogWaveform* wfm,
+	MappedFile& file,
+	size_t dataOffset,
+	size_t count,
+	size_t bytesPerSample,
+	float gain,
+	float offset)
+{
+	bool paged = !m_pagedname.empty() && m_parameters[m_pagedname].GetBoolVal();
+	if(!paged)
+	{
+		wfm->Resize(count);
+		return ConvertMappedWindow(stream, wfm, file, dataOffset, count, bytesPerSample, gain, offset);
+	}
+
+	if(!file.GetPointer(dataOffset, count * bytesPerSample))
+		return false;
+
+	if(!m_pagedFile)
+	{
+		m_pagedFile = make_unique<MappedFile>();
+		if(!m_pagedFile->Open(m_parameters[m_fpname].ToString()))
+		{
+			m_pagedFile = nullptr;
+			return false;
+		}
+	}
+
+	//Build the index
+	PagedStream ps;
+	ps.m_stream = stream;
+	ps.m_bytesPerSample = bytesPerSample;
+	ps.m_gain = gain;
+	ps.m_offset = offset;
+	ps.m_timescale = max(wfm->m_timescale, static_cast<int64_t>(1));
+	ps.m_triggerPhase = wfm->m_triggerPhase;
+	ps.m_count = count;
+	for(size_t i=0; i<count; i += PAGE_SAMPLES)
+	{
+		ImportPage page;
+		page.m_fileOffset = dataOffset + i*bytesPerSample;
+		page.m_firstSample = i;
+		page.m_count = min(PAGE_SAMPLES, count - i);
+		ps.m_pages.push_back(page);
+	}
+	LogTrace("Paged loading: %zu samples in %zu pages\n", count, ps.m_pages.size());
+
+	m_pagedStreams.push_back(ps);
+	LoadPagedWindow(m_pagedStreams.back());
+	return true;
+}
+
+/**
+	@brief Reloads the file when paged loading is turned on or off
+ */
+void ImportFilter::OnPagingChanged()
+{
+	m_parameters[m_fpname].signal_changed().emit();
+}
+
+/**
+	@brief Loads the new window into every paged stream
+ */
+void ImportFilter::OnWindowChanged()
+{
+	for(auto& ps : m_pagedStreams)
+		LoadPagedWindow(ps);
+}
+
+/**
+	@brief Converts the pages of one stream which overlap the current window, replacing whatever was loaded before
+ */
+void ImportFilter::LoadPagedWindow(PagedStream& ps)
+{
+	auto wfm = dynamic_cast<UniformAnalogWaveform*>(GetData(ps.m_stream));
+	if(!wfm || ps.m_pages.empty() || !m_pagedFile)
+		return;
+
+	//Split the memory limit between the paged streams, but always allow at least one page each
+	size_t limit = m_parameters[m_memoryLimitName].GetIntVal();
+	size_t maxPages = max(
+		static_cast<size_t>(1),
+		limit / (m_pagedStreams.size() * PAGE_SAMPLES * sizeof(float)));
+
+	//Find the pages overlapping the window
+	int64_t start = m_parameters[m_windowStartName].GetIntVal();
+	int64_t length = m_parameters[m_windowLengthName].GetIntVal();
+	int64_t firstSample = (start - ps.m_triggerPhase) / ps.m_timescale;
+	firstSample = max(firstSample, static_cast<int64_t>(0));
+	size_t firstPage = min(static_cast<size_t>(firstSample) / PAGE_SAMPLES, ps.m_pages.size() - 1);
+	size_t endPage = ps.m_pages.size();
+	if(length > 0)
+	{
+		int64_t endSample = (start + length - ps.m_triggerPhase + ps.m_timescale - 1) / ps.m_timescale;
+		endSample = max(endSample, firstSample + 1);
+		endPage = min(endPage, (static_cast<size_t>(endSample) + PAGE_SAMPLES - 1) / PAGE_SAMPLES);
+	}
+	if(endPage - firstPage > maxPages)
+	{
+		LogWarning("Requested window needs %zu pages, only loading %zu to stay within the memory limit\n",
+			endPage - firstPage, maxPages);
+		endPage = firstPage + maxPages;
+	}
+
+	auto& first = ps.m_pages[firstPage];
+	auto& last = ps.m_pages[endPage - 1];
+	size_t count = last.m_firstSample + last.m_count - first.m_firstSample;
+
+	//Don't hang on to a big buffer from an earlier, longer window
+	wfm->Resize(count);
+	if(wfm->m_samples.capacity() > 2*count)
+		wfm->m_samples.shrink_to_fit();
+
+	wfm->m_triggerPhase = ps.m_triggerPhase + static_cast<int64_t>(first.m_firstSample) * ps.m_timescale;
+	if(!ConvertMappedWindow(
+		ps.m_stream, wfm, *m_pagedFile, first.m_fileOffset, count, ps.m_bytesPerSample, ps.m_gain, ps.m_offset))
+	{
+		LogError("Failed to read paged sample data\n");
+		return;
+	}
+	wfm->m_revision ++;
+
+	LogTrace("Loaded pages %zu-%zu of stream %zu (%zu samples)\n", firstPage, endPage - 1, ps.m_stream, count);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Import helpers
 
@@ -139,6 +363,32 @@ bool ImportFilter::TryNormalizeTimebase(SparseWaveformBase* wfm)
 	uint64_t stdev = sqrt(stdev_sum / interval_count);
 	LogTrace("Stdev of intervals:      %s\n", xunit.PrettyPrint(stdev).c_str());
 
+	if(!IsUniformInterval(interval_min, interval_max, avg, stdev))
+		return false;
+
+	//If we get here, assume uniform sampling.
+	//Use time zero as the trigger phase.
+	wfm->m_timescale = avg;
+	wfm->m_triggerPhase = wfm->m_offsets[0];
+	size_t len = wfm->m_offsets.size();
+	for(size_t j=0; j<len; j++)
+	{
+		wfm->m_offsets[j] = j;
+		wfm->m_durations[j] = 1;
+	}
+	return true;
+}
+
+/**
+	@brief Decides whether a set of sample interval statistics describes uniformly sampled data
+
+	@param interval_min		Shortest sample interval
+	@param interval_max		Longest sample interval
+	@param avg				Mean sample interval
+	@param stdev			Standard deviation of sample intervals
+ */
+bool ImportFilter::IsUniformInterval(uint64_t interval_min, uint64_t interval_max, uint64_t avg, uint64_t stdev)
+{
 	//If the standard deviation is more than 2% of the average sample period, assume the data is sampled irregularly.
 	if( (stdev * 50) > avg)
 	{
@@ -153,15 +403,166 @@ bool ImportFilter::TryNormalizeTimebase(SparseWaveformBase* wfm)
 		return false;
 	}
 
-	//If we get here, assume uniform sampling.
-	//Use time zero as the trigger phase.
-	wfm->m_timescale = avg;
-	wfm->m_triggerPhase = wfm->m_offsets[0];
-	size_t len = wfm->m_offsets.size();
-	for(size_t j=0; j<len; j++)
+	return true;
+}
+
+/**
+	@brief Checks if a list of sample timestamps is uniformly spaced, before any waveform has been created
+
+	Uses the same criteria as TryNormalizeTimebase(), so importers that have their timestamps up front can allocate a
+	uniform waveform directly rather than building a sparse one and converting it.
+
+	@param timestamps	Sample timestamps, in X axis units
+	@param interval		Average sample interval, if uniform
+
+	@return True if the samples are uniformly spaced
+ */
+bool ImportFilter::DetectUniformTimebase(const vector<int64_t>& timestamps, int64_t& interval)
+{
+	size_t count = timestamps.size();
+	if(count < 2)
+		return false;
+
+	//Find the min, max, and mean sample interval
+	uint64_t interval_sum = 0;
+	uint64_t interval_min = std::numeric_limits<uint64_t>::max();
+	uint64_t interval_max = std::numeric_limits<uint64_t>::min();
+	for(size_t i=1; i<count; i++)
 	{
-		wfm->m_offsets[j] = j;
-		wfm->m_durations[j] = 1;
+		int64_t delta = timestamps[i] - timestamps[i-1];
+		if(delta <= 0)
+			return false;
+
+		uint64_t dur = delta;
+		interval_sum += dur;
+		interval_min = min(interval_min, dur);
+		interval_max = max(interval_max, dur);
 	}
+	uint64_t avg = interval_sum / (count - 1);
+
+	//Find the standard deviation of sample intervals
+	uint64_t stdev_sum = 0;
+	for(size_t i=1; i<count; i++)
+	{
+		int64_t delta = (timestamps[i] - timestamps[i-1]) - avg;
+		stdev_sum += delta*delta;
+	}
+	uint64_t stdev = sqrt(stdev_sum / (count - 1));
+
+	Unit xunit(GetXAxisUnits());
+	LogTrace("Min sample interval:     %s\n", xunit.PrettyPrint(interval_min).c_str());
+	LogTrace("Average sample interval: %s\n", xunit.PrettyPrint(avg).c_str());
+	LogTrace("Max sample interval:     %s\n", xunit.PrettyPrint(interval_max).c_str());
+	LogTrace("Stdev of intervals:      %s\n", xunit.PrettyPrint(stdev).c_str());
+
+	if(!IsUniformInterval(interval_min, interval_max, avg, stdev))
+		return false;
+
+	interval = avg;
+	return true;
+}
+
+/**
+	@brief Converts a range of samples of one output stream out of a mapped file
+
+	Called by LoadMappedSamples() and for each window of a paged stream. The default implementation calls
+	ConvertMappedSamples(); filters whose files are not a flat array of int8_t or int16_t codes (e.g. interleaved
+	channels) override this, and interpret bytesPerSample as the stride between consecutive samples of a stream.
+
+	@param stream			Output stream index
+	@param wfm				Output waveform, must already be resized to at least count samples
+	@param file				The mapped file
+	@param dataOffset		Byte offset of the first sample within the file
+	@param count			Number of samples to convert
+	@param bytesPerSample	Byte stride between consecutive samples
+	@param gain				Volts per code
+	@param offset			Offset subtracted after scaling
+
+	@return False if the sample data extends past the end of the file
+ */
+bool ImportFilter::ConvertMappedWindow(
+	[[maybe_unused]] size_t stream,
+	UniformAnalogWaveform* wfm,
+	MappedFile& file,
+	size_t dataOffset,
+	size_t count,
+	size_t bytesPerSample,
+	float gain,
+	float offset)
+{
+	return ConvertMappedSamples(wfm, file, dataOffset, count, bytesPerSample, gain, offset);
+}
+
+/**
+	@brief Converts raw signed integer samples straight out of a memory mapped file into a waveform
+
+	Samples are converted in chunks, prefetching the next chunk while the current one is processed and releasing
+	pages once they have been consumed, so the file is streamed through once without ever being fully resident.
+
+	Computes wfm[i] = raw[i]*gain - offset.
+
+	@param wfm				Output waveform, must already be resized to at least count samples
+	@param file				The mapped file
+	@param dataOffset		Byte offset of the first sample within the file
+	@param count			Number of samples to convert
+	@param bytesPerSample	Size of one raw sample (1 for int8_t or 2 for int16_t)
+	@param gain				Volts per code
+	@param offset			Offset subtracted after scaling
+
+	@return False if the sample data extends past the end of the file
+ */
+bool ImportFilter::ConvertMappedSamples(
+	UniformAnalogWaveform* wfm,
+	MappedFile& file,
+	size_t dataOffset,
+	size_t count,
+	size_t bytesPerSample,
+	float gain,
+	float offset)
+{
+	auto raw = file.GetPointer(dataOffset, count * bytesPerSample);
+	if(!raw)
+		return false;
+
+	//Chunk starts must be multiples of 64 samples to keep vectorized output stores aligned
+	const size_t chunkSamples = 4 * 1024 * 1024;
+	const size_t chunkBytes = chunkSamples * bytesPerSample;
+
+	//Sample data often starts at an odd offset in the file (e.g. after a 357 byte TRC header),
+	//so bounce misaligned 16-bit data through a small aligned buffer rather than casting the pointer
+	vector<int16_t> bounce;
+	bool aligned = (reinterpret_cast<uintptr_t>(raw) % bytesPerSample) == 0;
+	if(!aligned)
+		bounce.resize(min(count, chunkSamples));
+
+	wfm->PrepareForCpuAccess();
+	float* pout = wfm->m_samples.GetCpuPointer();
+
+	file.Prefetch(dataOffset, chunkBytes);
+	for(size_t i=0; i<count; i += chunkSamples)
+	{
+		size_t n = min(chunkSamples, count - i);
+		file.Prefetch(dataOffset + (i + chunkSamples)*bytesPerSample, chunkBytes);
+
+		auto pchunk = raw + i*bytesPerSample;
+		if(bytesPerSample == 2)
+		{
+			const int16_t* pin;
+			if(aligned)
+				pin = reinterpret_cast<const int16_t*>(pchunk);
+			else
+			{
+				memcpy(bounce.data(), pchunk, n * sizeof(int16_t));
+				pin = bounce.data();
+			}
+			Oscilloscope::Convert16BitSamples(pout + i, pin, gain, offset, n);
+		}
+		else
+			Oscilloscope::Convert8BitSamples(pout + i, reinterpret_cast<const int8_t*>(pchunk), gain, offset, n);
+
+		file.Release(dataOffset + i*bytesPerSample, n*bytesPerSample);
+	}
+
+	wfm->MarkModifiedFromCpu();
 	return true;
 }
@@ -41,6 +41,12 @@
 	@ingroup core
 
 	Note that not all import filters derive from this class (e.g. some derive from SParameterSourceFilter instead).
+
+	Filters whose sample data is a flat array of ADC codes in the file can offer paged loading by calling
+	AddPagingParameters() in their constructor and LoadMappedSamples() instead of ConvertMappedSamples(). With
+	paging on, only an index of the sample data is built when the file is opened, and only the pages covering the
+	requested time window (see RequestTimeWindow()) are converted. Everything else stays in the file, so captures
+	much larger than RAM can be opened and browsed.
  */
 class ImportFilter : public Filter
 {
@@ -59,10 +65,120 @@ public:
 	std::string GetFileNameParameter()
 	{ return m_fpname; }
 
+	virtual void ClearStreams() override;
+
+	void RequestTimeWindow(int64_t start, int64_t length);
+	bool GetFullTimeRange(int64_t& start, int64_t& end);
+
+	///@brief Returns true if any output is being loaded a window at a time
+	bool IsPaged() const
+	{ return !m_pagedStreams.empty(); }
+
+	///@brief Number of samples per page of the import index
+	static const size_t PAGE_SAMPLES = 1024 * 1024;
+
 protected:
 	std::string m_fpname;
 
+	void AddPagingParameters();
+
+	bool LoadMappedSamples(
+		size_t stream,
+		UniformAnalogWaveform* wfm,
+		MappedFile& file,
+		size_t dataOffset,
+		size_t count,
+		size_t bytesPerSample,
+		float gain,
+		float offset);
+
+	///@brief One page of the import-time index
+	class ImportPage
+	{
+	public:
+		///@brief Byte offset of the first sample of the page within the file
+		size_t m_fileOffset;
+
+		///@brief Index of the first sample of the page within the stream
+		size_t m_firstSample;
+
+		///@brief Number of samples in the page
+		size_t m_count;
+	};
+
+	///@brief An output stream which is loaded a window at a time
+	class PagedStream
+	{
+	public:
+		///@brief Output stream index
+		size_t m_stream;
+
+		///@brief Byte stride between samples (1 for int8_t or 2 for int16_t, unless ConvertMappedWindow() is overridden)
+		size_t m_bytesPerSample;
+
+		///@brief Volts per code
+		float m_gain;
+
+		///@brief Offset subtracted after scaling
+		float m_offset;
+
+		///@brief Sample interval of the full waveform
+		int64_t m_timescale;
+
+		///@brief Trigger phase of the first sample of the full waveform
+		int64_t m_triggerPhase;
+
+		///@brief Total number of samples in the file
+		size_t m_count;
+
+		///@brief Index of the sample data, PAGE_SAMPLES at a time
+		std::vector<ImportPage> m_pages;
+	};
+
+	void OnPagingChanged();
+	void OnWindowChanged();
+	void LoadPagedWindow(PagedStream& ps);
+
+	///@brief Streams being loaded a window at a time
+	std::vector<PagedStream> m_pagedStreams;
+
+	///@brief Mapping of the file, kept open while any stream is paged
+	std::unique_ptr<MappedFile> m_pagedFile;
+
+	///@brief Name of the parameter enabling paged loading (empty if the filter doesn't support it)
+	std::string m_pagedname;
+
+	///@brief Name of the parameter for the start of the loaded window
+	std::string m_windowStartName;
+
+	///@brief Name of the parameter for the length of the loaded window
+	std::string m_windowLengthName;
+
+	///@brief Name of the parameter for the maximum memory used by loaded pages
+	std::string m_memoryLimitName;
+
 	bool TryNormalizeTimebase(SparseWaveformBase* wfm);
+	bool DetectUniformTimebase(const std::vector<int64_t>& timestamps, int64_t& interval);
+	static bool IsUniformInterval(uint64_t interval_min, uint64_t interval_max, uint64_t avg, uint64_t stdev);
+
+	virtual bool ConvertMappedWindow(
+		size_t stream,
+		UniformAnalogWaveform* wfm,
+		MappedFile& file,
+		size_t dataOffset,
+		size_t count,
+		size_t bytesPerSample,
+		float gain,
+		float offset);
+
+	static bool ConvertMappedSamples(
+		UniformAnalogWaveform* wfm,
+		MappedFile& file,
+		size_t dataOffset,
+		size_t count,
+		size_t bytesPerSample,
+		float gain,
+		float offset);
 };
 
 #endif
@@ -0,0 +1,282 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of InstrumentPollScheduler
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "InstrumentPollScheduler.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates the scheduler and starts the worker threads
+
+	@param numThreads	Maximum number of instruments (in different bus groups) to poll at once
+ */
+InstrumentPollScheduler::InstrumentPollScheduler(size_t numThreads)
+	: m_changeThreshold(1e-4)
+	, m_terminating(false)
+{
+	for(size_t i=0; i<numThreads; i++)
+		m_threads.push_back(thread(&InstrumentPollScheduler::WorkerThread, this));
+}
+
+/**
+	@brief Stops the worker threads, after any polls in progress have finished
+ */
+InstrumentPollScheduler::~InstrumentPollScheduler()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_terminating = true;
+	}
+	m_wake.notify_all();
+
+	for(auto& t : m_threads)
+		t.join();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Instrument management
+
+/**
+	@brief Starts polling an instrument
+
+	@param inst			The instrument
+	@param minInterval	Shortest time between polls, in seconds (the instrument's rate budget)
+	@param maxInterval	Longest time between polls, in seconds, once readings have stopped changing
+	@param busGroup		Name of the bus the instrument is on. Instruments in the same group are never polled at the
+						same time. If empty, the transport connection string is used.
+ */
+void InstrumentPollScheduler::AddInstrument(
+	shared_ptr<Instrument> inst,
+	double minInterval,
+	double maxInterval,
+	const string& busGroup)
+{
+	auto p = make_shared<PolledInstrument>();
+	p->m_inst = inst;
+	p->m_group = busGroup.empty() ? inst->GetTransportConnectionString() : busGroup;
+	p->m_minInterval = minInterval;
+	p->m_maxInterval = max(minInterval, maxInterval);
+	p->m_interval = minInterval;
+	p->m_nextPoll = GetTime();
+	p->m_busy = false;
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_instruments[inst.get()] = p;
+	}
+	m_wake.notify_one();
+}
+
+/**
+	@brief Stops polling an instrument
+
+	A poll which is already in progress is allowed to finish, but its readings are discarded.
+ */
+void InstrumentPollScheduler::RemoveInstrument(shared_ptr<Instrument> inst)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_instruments.erase(inst.get());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+/**
+	@brief Copies the readings history for one stream of an instrument channel, oldest first
+
+	@return False if the instrument isn't being polled or the stream has no readings yet
+ */
+bool InstrumentPollScheduler::GetReadings(Instrument* inst, size_t chan, size_t stream, vector<Reading>& readings)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	auto it = m_instruments.find(inst);
+	if(it == m_instruments.end())
+		return false;
+
+	auto& history = it->second->m_history;
+	auto jt = history.find(pair<size_t, size_t>(chan, stream));
+	if(jt == history.end())
+		return false;
+
+	jt->second.CopyTo(readings);
+	return true;
+}
+
+/**
+	@brief Gets the current poll interval of an instrument, in seconds (zero if it isn't being polled)
+ */
+double InstrumentPollScheduler::GetCurrentInterval(Instrument* inst)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	auto it = m_instruments.find(inst);
+	if(it == m_instruments.end())
+		return 0;
+	return it->second->m_interval;
+}
+
+/**
+	@brief Copies the readings out of the ring, oldest first
+ */
+void InstrumentPollScheduler::ReadingRing::CopyTo(vector<Reading>& out) const
+{
+	out.clear();
+	if(m_full)
+		out.insert(out.end(), m_readings.begin() + m_next, m_readings.end());
+	out.insert(out.end(), m_readings.begin(), m_readings.begin() + m_next);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scheduling
+
+/**
+	@brief Finds the most overdue instrument which isn't being polled and whose bus is free
+
+	Must be called with m_mutex held.
+
+	@param waitTime	Set to the time until the next poll is due, if nothing is due yet
+
+	@return The instrument to poll, or null if none are due
+ */
+shared_ptr<InstrumentPollScheduler::PolledInstrument> InstrumentPollScheduler::GetNextDue(double& waitTime)
+{
+	//Nothing ready: wake up occasionally anyway in case a bus frees up
+	waitTime = 1;
+
+	shared_ptr<PolledInstrument> best;
+	for(auto& it : m_instruments)
+	{
+		auto& p = it.second;
+		if(p->m_busy || (m_busyGroups.find(p->m_group) != m_busyGroups.end()) )
+			continue;
+		if(!best || (p->m_nextPoll < best->m_nextPoll))
+			best = p;
+	}
+
+	if(!best)
+		return nullptr;
+
+	double dt = best->m_nextPoll - GetTime();
+	if(dt > 0)
+	{
+		waitTime = dt;
+		return nullptr;
+	}
+
+	return best;
+}
+
+/**
+	@brief Saves the current scalar readings of an instrument, and adjusts its poll interval
+
+	Must be called with m_mutex held.
+ */
+void InstrumentPollScheduler::RecordReadings(PolledInstrument& p, double now)
+{
+	bool changed = false;
+
+	auto inst = p.m_inst;
+	for(size_t i=0; i<inst->GetChannelCount(); i++)
+	{
+		auto chan = inst->GetChannel(i);
+		for(size_t j=0; j<chan->GetStreamCount(); j++)
+		{
+			if(chan->GetType(j) != Stream::STREAM_TYPE_ANALOG_SCALAR)
+				continue;
+
+			float v = chan->GetScalarValue(j);
+			pair<size_t, size_t> key(i, j);
+			p.m_history[key].Push(now, v);
+
+			auto it = p.m_lastValues.find(key);
+			if( (it == p.m_lastValues.end()) || (fabs(v - it->second) > m_changeThreshold * fabs(it->second)) )
+				changed = true;
+			p.m_lastValues[key] = v;
+		}
+	}
+
+	if(changed)
+		p.m_interval = p.m_minInterval;
+	else
+		p.m_interval = min(p.m_interval * BACKOFF_FACTOR, p.m_maxInterval);
+	p.m_nextPoll = now + p.m_interval;
+}
+
+/**
+	@brief Thread function: polls whichever instrument is most overdue, until we're shut down
+ */
+void InstrumentPollScheduler::WorkerThread()
+{
+	#ifdef __linux__
+	pthread_setname_np(pthread_self(), "InstrumentPoll");
+	#endif
+
+	unique_lock<mutex> lock(m_mutex);
+	while(!m_terminating)
+	{
+		double waitTime;
+		auto p = GetNextDue(waitTime);
+		if(!p)
+		{
+			m_wake.wait_for(lock, chrono::duration<double>(waitTime));
+			continue;
+		}
+
+		p->m_busy = true;
+		m_busyGroups.insert(p->m_group);
+		lock.unlock();
+
+		p->m_inst->AcquireData();
+		double now = GetTime();
+
+		lock.lock();
+		p->m_busy = false;
+		m_busyGroups.erase(p->m_group);
+
+		//Don't bother saving anything if the instrument was removed while we were polling it
+		auto it = m_instruments.find(p->m_inst.get());
+		if( (it != m_instruments.end()) && (it->second == p) )
+			RecordReadings(*p, now);
+
+		//Our bus is free again, so someone else may be able to go
+		m_wake.notify_all();
+	}
+}
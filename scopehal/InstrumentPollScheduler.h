@@ -0,0 +1,203 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of InstrumentPollScheduler
+	@ingroup core
+ */
+
+#ifndef InstrumentPollScheduler_h
+#define InstrumentPollScheduler_h
+
+#include <condition_variable>
+
+/**
+	@brief Polls a large number of slow instruments (meters, power supplies, loads...) from a small shared thread pool
+
+	Running one thread per instrument, each calling AcquireData() as fast as it can, works for a handful of
+	instruments but turns into a thundering herd of tiny transactions once there are dozens of them sharing USB serial
+	hubs or a GPIB bus. The scheduler instead keeps a due time for every instrument and hands the most overdue one to
+	the next free worker, subject to:
+
+	- A rate budget: each instrument is polled at most once per minimum interval.
+	- Bus groups: at most one instrument per group is polled at a time. By default instruments are grouped by transport
+	  connection string; instruments sharing an adapter with different addresses can be put in an explicit group.
+	- Adaptive intervals: if a poll returns the same readings as the last one (within the change threshold), the
+	  interval is stretched by BACKOFF_FACTOR up to the maximum. Any change snaps it back to the minimum.
+
+	Every scalar reading is timestamped and saved in a per-stream ring buffer, so clients see the full history rather
+	than only the most recent value.
+
+	@ingroup core
+ */
+class InstrumentPollScheduler
+{
+public:
+	InstrumentPollScheduler(size_t numThreads = 4);
+	~InstrumentPollScheduler();
+
+	void AddInstrument(
+		std::shared_ptr<Instrument> inst,
+		double minInterval = 0.1,
+		double maxInterval = 2,
+		const std::string& busGroup = "");
+	void RemoveInstrument(std::shared_ptr<Instrument> inst);
+
+	/**
+		@brief A single timestamped scalar reading
+	 */
+	class Reading
+	{
+	public:
+		///@brief Time the poll finished (see GetTime())
+		double m_time;
+
+		///@brief The reading
+		float m_value;
+	};
+
+	bool GetReadings(Instrument* inst, size_t chan, size_t stream, std::vector<Reading>& readings);
+	double GetCurrentInterval(Instrument* inst);
+
+	/**
+		@brief Sets the smallest relative change in a reading which counts as the instrument's state having changed
+
+		@param threshold	Relative threshold, e.g. 1e-4 for 0.01%
+	 */
+	void SetChangeThreshold(float threshold)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_changeThreshold = threshold;
+	}
+
+	///@brief Number of readings kept per stream
+	static constexpr size_t HISTORY_DEPTH = 4096;
+
+	///@brief Factor by which the poll interval is stretched after a poll with no change
+	static constexpr double BACKOFF_FACTOR = 1.5;
+
+protected:
+
+	/**
+		@brief Fixed-size history of readings for one stream
+	 */
+	class ReadingRing
+	{
+	public:
+		ReadingRing()
+			: m_next(0)
+			, m_full(false)
+		{ m_readings.resize(HISTORY_DEPTH); }
+
+		void Push(double t, float v)
+		{
+			m_readings[m_next] = { t, v };
+			m_next ++;
+			if(m_next == m_readings.size())
+			{
+				m_next = 0;
+				m_full = true;
+			}
+		}
+
+		void CopyTo(std::vector<Reading>& out) const;
+
+		///@brief Storage for readings
+		std::vector<Reading> m_readings;
+
+		///@brief Index of the next reading to write
+		size_t m_next;
+
+		///@brief True if the ring has wrapped
+		bool m_full;
+	};
+
+	/**
+		@brief Scheduling state for a single instrument
+	 */
+	class PolledInstrument
+	{
+	public:
+		///@brief The instrument
+		std::shared_ptr<Instrument> m_inst;
+
+		///@brief Bus group the instrument is in
+		std::string m_group;
+
+		///@brief Shortest allowed time between polls, in seconds
+		double m_minInterval;
+
+		///@brief Longest allowed time between polls, in seconds
+		double m_maxInterval;
+
+		///@brief Current time between polls, in seconds
+		double m_interval;
+
+		///@brief Time the next poll is due
+		double m_nextPoll;
+
+		///@brief True if a worker is polling this instrument right now
+		bool m_busy;
+
+		///@brief Readings history, indexed by (channel, stream)
+		std::map< std::pair<size_t, size_t>, ReadingRing > m_history;
+
+		///@brief Most recent value of each stream, for change detection
+		std::map< std::pair<size_t, size_t>, float > m_lastValues;
+	};
+
+	void WorkerThread();
+	std::shared_ptr<PolledInstrument> GetNextDue(double& waitTime);
+	void RecordReadings(PolledInstrument& p, double now);
+
+	///@brief Mutex protecting everything below except the thread list
+	std::mutex m_mutex;
+
+	///@brief Signaled when instruments are added or finish polling, or when we're shutting down
+	std::condition_variable m_wake;
+
+	///@brief Every instrument we're polling
+	std::map<Instrument*, std::shared_ptr<PolledInstrument> > m_instruments;
+
+	///@brief Bus groups with a poll in progress
+	std::set<std::string> m_busyGroups;
+
+	///@brief Smallest relative change in a reading which resets the poll interval
+	float m_changeThreshold;
+
+	///@brief Set when the workers should exit
+	bool m_terminating;
+
+	///@brief The worker threads
+	std::vector<std::thread> m_threads;
+};
+
+#endif
@@ -68,4 +68,28 @@ protected:
 	float m_errorTerm;
 };
 
+/**
+	@brief Adds a value to a Kahan sum held as a separate partial sum and error term
+
+	Building block for kernels which keep several independent sums (e.g. one per SIMD lane).
+ */
+inline void KahanAdd(float& sum, float& err, float x)
+{
+	float y = x - err;
+	float t = sum + y;
+	err = (t - sum) - y;
+	sum = t;
+}
+
+/**
+	@brief Combines independent Kahan partial sums (and their error terms) in double precision
+ */
+inline double KahanCombine(const float* sums, const float* errs, size_t n)
+{
+	double total = 0;
+	for(size_t i=0; i<n; i++)
+		total += static_cast<double>(sums[i]) - static_cast<double>(errs[i]);
+	return total;
+}
+
 #endif
@@ -274,15 +274,13 @@ bool LeCroyFWPOscilloscope::AcquireData()
 	}
 
 	//Now that we have all of the pending waveforms, save them in sets across all channels
-	m_pendingWaveformsMutex.lock();
-		SequenceSet s;
-		for(size_t j=0; j<m_channels.size(); j++)
-		{
-			if(pending_waveforms.find(j) != pending_waveforms.end())
-				s[GetOscilloscopeChannel(j)] = pending_waveforms[j];
-		}
-		m_pendingWaveforms.push_back(s);
-	m_pendingWaveformsMutex.unlock();
+	SequenceSet s;
+	for(size_t j=0; j<m_channels.size(); j++)
+	{
+		if(pending_waveforms.find(j) != pending_waveforms.end())
+			s[GetOscilloscopeChannel(j)] = pending_waveforms[j];
+	}
+	PushPendingWaveform(s);
 
 	return true;
 }
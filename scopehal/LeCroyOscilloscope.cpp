@@ -87,6 +87,7 @@ LeCroyOscilloscope::LeCroyOscilloscope(SCPITransport* transport)
 	, m_meterMode(Multimeter::DC_VOLTAGE)
 	, m_meterModeValid(false)
 	, m_highDefinition(false)
+	, m_bulkConfigEnabled(false)
 {
 	//standard initialization
 	FlushConfigCache();
@@ -94,6 +95,10 @@ LeCroyOscilloscope::LeCroyOscilloscope(SCPITransport* transport)
 	DetectAnalogChannels();
 	SharedCtorInit();
 	DetectOptions();
+
+	//Warm up the channel caches in one burst rather than a round trip per getter
+	m_bulkConfigEnabled = true;
+	BulkCheckChannelConfig();
 }
 
 void LeCroyOscilloscope::SharedCtorInit()
@@ -133,6 +138,14 @@ void LeCroyOscilloscope::SharedCtorInit()
 		m_channels.size());
 	m_channels.push_back(m_fastEdgeChannel);
 
+	//Raw waveform download buffers
+	for(size_t i=0; i<m_analogChannelCount; i++)
+	{
+		m_analogRawWaveformBuffers.push_back(std::make_unique<AcceleratorBuffer<int8_t> >());
+		m_analogRawWaveformBuffers[i]->SetCpuAccessHint(AcceleratorBuffer<int8_t>::HINT_LIKELY);
+		m_analogRawWaveformBuffers[i]->SetGpuAccessHint(AcceleratorBuffer<int8_t>::HINT_LIKELY);
+	}
+
 	//Desired format for waveform data
 	//Only use increased bit depth if the scope actually puts content there!
 	if(m_highDefinition)
@@ -1063,32 +1076,37 @@ OscilloscopeChannel* LeCroyOscilloscope::GetExternalTrigger()
 
 void LeCroyOscilloscope::FlushConfigCache()
 {
-	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	{
+		lock_guard<recursive_mutex> lock(m_cacheMutex);
 
-	if(m_trigger)
-		delete m_trigger;
-	m_trigger = NULL;
-
-	m_channelVoltageRanges.clear();
-	m_channelOffsets.clear();
-	m_channelDigitalThresholds.clear();
-	m_channelsEnabled.clear();
-	m_channelDeskew.clear();
-	m_probeIsActive.clear();
-	m_channelIsInverted.clear();
-	m_channelNavg.clear();
-	m_sampleRateValid = false;
-	m_memoryDepthValid = false;
-	m_triggerOffsetValid = false;
-	m_interleavingValid = false;
-	m_meterModeValid = false;
+		if(m_trigger)
+			delete m_trigger;
+		m_trigger = NULL;
 
-	//Clear cached display name of all channels
-	for(auto c : m_channels)
-	{
-		if(GetInstrumentTypesForChannel(c->GetIndex()) & Instrument::INST_OSCILLOSCOPE)
-			c->ClearCachedDisplayName();
+		m_channelVoltageRanges.clear();
+		m_channelOffsets.clear();
+		m_channelDigitalThresholds.clear();
+		m_channelsEnabled.clear();
+		m_channelDeskew.clear();
+		m_probeIsActive.clear();
+		m_channelIsInverted.clear();
+		m_channelNavg.clear();
+		m_sampleRateValid = false;
+		m_memoryDepthValid = false;
+		m_triggerOffsetValid = false;
+		m_interleavingValid = false;
+		m_meterModeValid = false;
+
+		//Clear cached display name of all channels
+		for(auto c : m_channels)
+		{
+			if(GetInstrumentTypesForChannel(c->GetIndex()) & Instrument::INST_OSCILLOSCOPE)
+				c->ClearCachedDisplayName();
+		}
 	}
+
+	if(m_bulkConfigEnabled)
+		BulkCheckChannelConfig();
 }
 
 /**
@@ -2386,40 +2404,15 @@ void LeCroyOscilloscope::BulkCheckChannelEnableState()
 			uncached.push_back(i);
 	}
 
-	//Batched implementation
-	if(m_transport->IsCommandBatchingSupported())
-	{
-		lock_guard<recursive_mutex> lock(m_transport->GetMutex());
-
-		for(auto i : uncached)
-			m_transport->SendCommandQueued(GetOscilloscopeChannel(i)->GetHwname() + ":TRACE?");
-		m_transport->FlushCommandQueue();
-		for(auto i : uncached)
-		{
-			auto reply = m_transport->ReadReply();
-
-			lock_guard<recursive_mutex> lock2(m_cacheMutex);
-			if(reply == "OFF")
-				m_channelsEnabled[i] = false;
-			else
-				m_channelsEnabled[i] = true;
-		}
-	}
-
-	//Unoptimized fallback for use with transports that can't handle batching
-	else
-	{
-		for(auto i : uncached)
-		{
-			auto reply = m_transport->SendCommandQueuedWithReply(GetOscilloscopeChannel(i)->GetHwname() + ":TRACE?");
+	//Pipelined query when batching is supported, one at a time otherwise
+	vector<string> queries;
+	for(auto i : uncached)
+		queries.push_back(GetOscilloscopeChannel(i)->GetHwname() + ":TRACE?");
+	auto replies = m_transport->SendQueriesPipelined(queries);
 
-			lock_guard<recursive_mutex> lock(m_cacheMutex);
-			if(reply == "OFF")
-				m_channelsEnabled[i] = false;
-			else
-				m_channelsEnabled[i] = true;
-		}
-	}
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	for(size_t j=0; j<uncached.size(); j++)
+		m_channelsEnabled[uncached[j]] = (replies[j] != "OFF");
 
 	/*
 	//Check digital status
@@ -2439,6 +2432,55 @@ void LeCroyOscilloscope::BulkCheckChannelEnableState()
 	}*/
 }
 
+/**
+	@brief Loads the commonly used per-channel settings for every analog channel in one pipelined burst
+
+	Fills the same caches the individual getters do, so a client querying every channel on connect (or after
+	FlushConfigCache()) doesn't pay a round trip per setting.
+ */
+void LeCroyOscilloscope::BulkCheckChannelConfig()
+{
+	BulkCheckChannelEnableState();
+
+	const size_t nper = 4;
+	vector<string> queries;
+	for(size_t i=0; i<m_analogChannelCount; i++)
+	{
+		auto hwname = GetOscilloscopeChannel(i)->GetHwname();
+		queries.push_back(string("VBS? 'return = app.Acquisition.") + hwname + ".Invert'");
+		queries.push_back(hwname + ":OFFSET?");
+		queries.push_back(hwname + ":VOLT_DIV?");
+		queries.push_back(string("VBS? 'return = app.Acquisition.") + hwname + ".Deskew'");
+	}
+	auto replies = m_transport->SendQueriesPipelined(queries);
+
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	for(size_t i=0; i<m_analogChannelCount; i++)
+	{
+		auto base = i*nper;
+
+		bool inverted = (Trim(replies[base]) == "-1");
+		m_channelIsInverted[i] = inverted;
+
+		//Offset is reported before frontend inversion, same as GetChannelOffset()
+		float offset;
+		sscanf(replies[base + 1].c_str(), "%f", &offset);
+		if(inverted)
+			offset = -offset;
+		m_channelOffsets[i] = offset;
+
+		//plot is 8 divisions high on all MAUI scopes
+		double volts_per_div;
+		sscanf(replies[base + 2].c_str(), "%lf", &volts_per_div);
+		m_channelVoltageRanges[i] = volts_per_div * 8;
+
+		//Deskew comes back as floating point seconds
+		float skew;
+		sscanf(replies[base + 3].c_str(), "%f", &skew);
+		m_channelDeskew[i] = round(skew * FS_PER_SECOND);
+	}
+}
+
 bool LeCroyOscilloscope::ReadWavedescs(
 	vector<string>& wavedescs,
 	bool* enabled,
@@ -2579,7 +2621,8 @@ vector<WaveformBase*> LeCroyOscilloscope::ProcessAnalogWaveform(
 	uint32_t num_sequences,
 	time_t ttime,
 	double basetime,
-	double* wavetime)
+	double* wavetime,
+	const SegmentedCapture* segments)
 {
 	vector<WaveformBase*> ret;
 
@@ -2628,6 +2671,14 @@ vector<WaveformBase*> LeCroyOscilloscope::ProcessAnalogWaveform(
 		else
 			cap->m_startFemtoseconds = static_cast<int64_t>(basetime * FS_PER_SECOND);
 
+		//Segmented capture: point at our slice of the downloaded block, it's converted if and when it's needed
+		if(segments)
+		{
+			segments->AttachSegment(cap, j, v_gain, -v_off);
+			ret.push_back(cap);
+			continue;
+		}
+
 		cap->Resize(num_per_segment);
 
 		//Convert raw ADC samples to volts
@@ -2736,7 +2787,7 @@ map<int, SparseDigitalWaveform*> LeCroyOscilloscope::ProcessDigitalWaveform(stri
 	base64_decode_block(tmp.c_str(), tmp.length(), (char*)block, &bstate);
 
 	//We have each channel's data from start to finish before the next (no interleaving).
-	//TODO: Multithread across waveforms
+	vector<uint64_t> packed;
 	unsigned int icapchan = 0;
 	for(unsigned int i=0; i<m_digitalChannelCount; i++)
 	{
@@ -2751,56 +2802,21 @@ map<int, SparseDigitalWaveform*> LeCroyOscilloscope::ProcessDigitalWaveform(stri
 			cap->m_startFemtoseconds = start_fs;
 			cap->m_triggerPhase = trigger_phase;
 
-			//Preallocate memory assuming no deduplication possible
-			cap->Resize(num_samples);
-
-			//Save the first sample (can't merge with sample -1 because that doesn't exist)
+			//Pack the byte per sample data to bits, then run length encode a word at a time
 			size_t base = icapchan*num_samples;
-			size_t k = 0;
-			cap->m_offsets[0] = 0;
-			cap->m_durations[0] = 1;
-			cap->m_samples[0] = block[base];
-
-			//Read and de-duplicate the other samples
-			//TODO: can we vectorize this somehow?
-			bool last = block[base];
-			for(size_t j=1; j<num_samples; j++)
-			{
-				bool sample = block[base + j];
-
-				//Deduplicate consecutive samples with same value
-				//FIXME: temporary workaround for rendering bugs
-				//if(last == sample)
-				if( (last == sample) && ((j+3) < num_samples) )
-					cap->m_durations[k] ++;
-
-				//Nope, it toggled - store the new value
-				else
-				{
-					k++;
-					cap->m_offsets[k] = j;
-					cap->m_durations[k] = 1;
-					cap->m_samples[k] = sample;
-					last = sample;
-				}
-
-			}
-
-			//Done, shrink any unused space
-			cap->Resize(k);
-			cap->m_offsets.shrink_to_fit();
-			cap->m_durations.shrink_to_fit();
-			cap->m_samples.shrink_to_fit();
-			cap->MarkSamplesModifiedFromCpu();
-			cap->MarkTimestampsModifiedFromCpu();
+			packed.resize(UniformPackedDigitalWaveform::GetWordCount(num_samples));
+			UniformPackedDigitalWaveform::PackBits(
+				reinterpret_cast<const bool*>(block + base), packed.data(), num_samples);
+			UniformPackedDigitalWaveform::ExtractRuns(
+				reinterpret_cast<const uint8_t*>(packed.data()), num_samples, *cap, 3);
 
 			//See how much space we saved
 			/*
 			LogDebug("%s: %zu samples deduplicated to %zu (%.1f %%)\n",
 				m_digitalChannels[i]->GetDisplayName().c_str(),
 				num_samples,
-				k,
-				(k * 100.0f) / num_samples);
+				cap->size(),
+				(cap->size() * 100.0f) / num_samples);
 			*/
 
 			//Done, save data and go on to next
@@ -2825,12 +2841,12 @@ bool LeCroyOscilloscope::AcquireData()
 	time_t ttime = 0;
 	double basetime = 0;
 	bool denabled = false;
-	map<int, string> analogWaveformData;
 	string wavetime;
 	bool enabled[8] = {false};
 	vector<string> wavedescs;
 	double* pwtime = nullptr;
 	string digitalWaveformData;
+	shared_ptr<AcceleratorBuffer<int8_t> > segmentBlocks[8];
 
 	ChannelsDownloadStarted();
 
@@ -2933,9 +2949,17 @@ bool LeCroyOscilloscope::AcquireData()
 			{
 				if(enabled[i])
 				{
-					analogWaveformData[i] = m_transport->ReadReply(
-						false,
-						[i, this] (float progress) { ChannelsDownloadStatusUpdate(i, InstrumentChannel::DownloadState::DOWNLOAD_IN_PROGRESS, progress); });
+					//Segmented captures get a fresh block, which is shared by all of the segment waveforms
+					if(num_sequences > 1)
+						segmentBlocks[i] = SegmentedCapture::AllocateBlock(0);
+					auto& rawbuf = segmentBlocks[i] ? *segmentBlocks[i] : *m_analogRawWaveformBuffers[i];
+
+					if(!m_transport->ReadBinaryBlock(
+						rawbuf,
+						[i, this] (float progress) { ChannelsDownloadStatusUpdate(i, InstrumentChannel::DownloadState::DOWNLOAD_IN_PROGRESS, progress); }))
+					{
+						LogError("Failed to download waveform data for channel %u\n", i);
+					}
 					ChannelsDownloadStatusUpdate(i, InstrumentChannel::DownloadState::DOWNLOAD_FINISHED, 1.0);
 				}
 			}
@@ -2988,14 +3012,27 @@ bool LeCroyOscilloscope::AcquireData()
 				m_channels[i]->SetYAxisUnits(Unit(Unit::UNIT_AMPS), 0);
 			//else unknown unit, ignore for now
 
+			unique_ptr<SegmentedCapture> segments;
+			if(segmentBlocks[i])
+			{
+				auto& block = segmentBlocks[i];
+				segments = make_unique<SegmentedCapture>(
+					block,
+					m_highDefinition ? 16 : 8,
+					num_sequences,
+					m_highDefinition ? (block->size() / 2) : block->size());
+			}
+
+			auto& rawbuf = segmentBlocks[i] ? *segmentBlocks[i] : *m_analogRawWaveformBuffers[i];
 			waveforms[i] = ProcessAnalogWaveform(
-				&analogWaveformData[i][16],			//skip 16-byte SCPI header DATA,\n#9xxxxxxxx
-				analogWaveformData[i].size() - 17,	//skip header plus \n at end
+				reinterpret_cast<const char*>(rawbuf.GetCpuPointer()),
+				rawbuf.size(),
 				wavedescs[i],
 				num_sequences,
 				ttime,
 				basetime,
-				pwtime);
+				pwtime,
+				segments.get());
 		}
 	}
 
@@ -3023,7 +3060,6 @@ bool LeCroyOscilloscope::AcquireData()
 	}
 
 	//Now that we have all of the pending waveforms, save them in sets across all channels
-	m_pendingWaveformsMutex.lock();
 	for(size_t i=0; i<num_sequences; i++)
 	{
 		SequenceSet s;
@@ -3032,9 +3068,8 @@ bool LeCroyOscilloscope::AcquireData()
 			if(pending_waveforms.find(j) != pending_waveforms.end())
 				s[GetOscilloscopeChannel(j)] = pending_waveforms[j][i];
 		}
-		m_pendingWaveforms.push_back(s);
+		PushPendingWaveform(s);
 	}
-	m_pendingWaveformsMutex.unlock();
 
 	double dt = GetTime() - start;
 	LogTrace("Waveform download and processing took %.3f ms\n", dt * 1000);
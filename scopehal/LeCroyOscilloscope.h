@@ -310,6 +310,8 @@ protected:
 	void OnCDRTriggerAutoBaud();
 
 	void BulkCheckChannelEnableState();
+	void BulkCheckChannelConfig();
+	void BulkCheckChannelConfig();
 
 	std::string GetPossiblyEmptyString(const std::string& property);
 
@@ -327,7 +329,8 @@ protected:
 		uint32_t num_sequences,
 		time_t ttime,
 		double basetime,
-		double* wavetime
+		double* wavetime,
+		const SegmentedCapture* segments = nullptr
 		);
 	std::map<int, SparseDigitalWaveform*> ProcessDigitalWaveform(std::string& data, int64_t analog_hoff);
 
@@ -387,6 +390,15 @@ protected:
 	//True if we have >8 bit capture depth
 	bool m_highDefinition;
 
+	///@brief True once the analog channels are known, so FlushConfigCache() can reload them with BulkCheckChannelConfig()
+	bool m_bulkConfigEnabled;
+
+	///@brief True once the analog channels are known, so FlushConfigCache() can reload them with BulkCheckChannelConfig()
+	bool m_bulkConfigEnabled;
+
+	///@brief Raw DAT1 blocks for each analog channel, in pinned memory (bytes, or little endian int16 if HD)
+	std::vector<std::unique_ptr<AcceleratorBuffer<int8_t> > > m_analogRawWaveformBuffers;
+
 	///@brief External trigger input
 	OscilloscopeChannel* m_extTrigChannel;
 
@@ -46,6 +46,11 @@ LevelCrossingDetector::LevelCrossingDetector()
 			2,
 			sizeof(ZeroCrossingPushConstants));
 
+		m_sparseZeroCrossingPipeline = make_unique<ComputePipeline>(
+			"shaders/FindZeroCrossingsSparse.spv",
+			3,
+			sizeof(ZeroCrossingPushConstants));
+
 		//don't bother with a CPU side allocation here
 		m_temporaryResults.SetCpuAccessHint(AcceleratorBuffer<int64_t>::HINT_NEVER);
 		m_temporaryResults.SetGpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
@@ -94,6 +99,53 @@ int64_t LevelCrossingDetector::FindZeroCrossings(
 		return len;
 	}
 
+	return FindZeroCrossings(*m_zeroCrossingPipeline, wfm, wfm->m_samples, nullptr, threshold, cmdBuf, queue);
+}
+
+/**
+	@brief Finds zero crossings in a sparse waveform
+
+	Results are identical to Filter::FindZeroCrossings(SparseAnalogWaveform*), and stay on the GPU until somebody
+	asks for them on the CPU.
+ */
+int64_t LevelCrossingDetector::FindZeroCrossings(
+	SparseAnalogWaveform* wfm,
+	float threshold,
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue)
+{
+	//Fallback in case GPU has no int64 support
+	if(!g_hasShaderInt64)
+	{
+		wfm->PrepareForCpuAccess();
+
+		vector<int64_t> edges;
+		Filter::FindZeroCrossings(wfm, threshold, edges);
+
+		int64_t len = edges.size();
+		m_outbuf.resize(len);
+		memcpy(&m_outbuf[0], &edges[0], len*sizeof(int64_t));
+		return len;
+	}
+
+	//Timestamps must be expanded for the shader to bind them
+	wfm->ExpandTimestamps();
+	return FindZeroCrossings(
+		*m_sparseZeroCrossingPipeline, wfm, wfm->m_samples, &wfm->m_offsets, threshold, cmdBuf, queue);
+}
+
+/**
+	@brief Runs the zero crossing search on either a uniform (offsets null) or sparse waveform
+ */
+int64_t LevelCrossingDetector::FindZeroCrossings(
+	ComputePipeline& pipeline,
+	WaveformBase* wfm,
+	AcceleratorBuffer<float>& samples,
+	AcceleratorBuffer<int64_t>* offsets,
+	float threshold,
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue)
+{
 	//This value experimentally gives the best speedup for an NVIDIA 2080 Ti vs an Intel Xeon Gold 6144
 	//Maybe consider dynamic tuning in the future at initialization?
 	const uint64_t numThreads = 8192;
@@ -111,15 +163,17 @@ int64_t LevelCrossingDetector::FindZeroCrossings(
 	zpush.threshold = threshold;
 	m_temporaryResults.resize(zpush.outputPerThread * numThreads);
 
-	m_zeroCrossingPipeline->BindBufferNonblocking(0, m_temporaryResults, cmdBuf, true);
-	m_zeroCrossingPipeline->BindBufferNonblocking(1, wfm->m_samples, cmdBuf);
+	pipeline.BindBufferNonblocking(0, m_temporaryResults, cmdBuf, true);
+	pipeline.BindBufferNonblocking(1, samples, cmdBuf);
+	if(offsets)
+		pipeline.BindBufferNonblocking(2, *offsets, cmdBuf);
 	const uint32_t compute_block_count = GetComputeBlockCount(numThreads, 64);
-	m_zeroCrossingPipeline->Dispatch(cmdBuf, zpush,
+	pipeline.Dispatch(cmdBuf, zpush,
 		min(compute_block_count, 32768u),
 		compute_block_count / 32768 + 1);
 
 	m_temporaryResults.MarkModifiedFromGpu();
-	m_zeroCrossingPipeline->AddComputeMemoryBarrier(cmdBuf);
+	pipeline.AddComputeMemoryBarrier(cmdBuf);
 
 	//Second pass: find boundaries of each block to find where the output blocks start
 	//(the very last entry here is going to be the total number of edges we found)
@@ -71,11 +71,27 @@ public:
 		vk::raii::CommandBuffer& cmdBuf,
 		std::shared_ptr<QueueHandle> queue);
 
+	int64_t FindZeroCrossings(
+		SparseAnalogWaveform* wfm,
+		float threshold,
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue);
+
 	AcceleratorBuffer<int64_t>& GetResults()
 	{ return m_outbuf; }
 
 protected:
+	int64_t FindZeroCrossings(
+		ComputePipeline& pipeline,
+		WaveformBase* wfm,
+		AcceleratorBuffer<float>& samples,
+		AcceleratorBuffer<int64_t>* offsets,
+		float threshold,
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue);
+
 	std::unique_ptr<ComputePipeline> m_zeroCrossingPipeline;
+	std::unique_ptr<ComputePipeline> m_sparseZeroCrossingPipeline;
 	std::unique_ptr<ComputePipeline> m_preGatherPipeline;
 	std::unique_ptr<ComputePipeline> m_gatherPipeline;
 
@@ -0,0 +1,374 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of LevelCrossingList
+	@ingroup datamodel
+ */
+
+#include "scopehal.h"
+#include "LevelCrossingDetector.h"
+
+using namespace std;
+
+mutex LevelCrossingList::m_cacheMutex;
+unique_ptr<LevelCrossingList::Engine> LevelCrossingList::m_engine;
+mutex LevelCrossingList::m_engineMutex;
+
+/**
+	@brief Waveforms smaller than this are searched on the CPU, since the GPU round trip costs more than it saves
+ */
+static const size_t GPU_SEARCH_THRESHOLD = 1024 * 1024;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// GPU search
+
+/**
+	@brief Owns a LevelCrossingDetector plus a queue and command buffer to run it on, for use outside of filters
+ */
+class LevelCrossingList::Engine
+{
+public:
+	Engine();
+
+	void Run(WaveformBase* wfm, float threshold, AcceleratorBuffer<int64_t>& crossings);
+
+protected:
+	std::shared_ptr<QueueHandle> m_queue;
+	std::unique_ptr<vk::raii::CommandPool> m_pool;
+	std::unique_ptr<vk::raii::CommandBuffer> m_cmdBuf;
+
+	LevelCrossingDetector m_detector;
+};
+
+LevelCrossingList::Engine::Engine()
+{
+	m_queue = g_vkQueueManager->GetComputeQueue("LevelCrossingList.queue");
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		m_queue->m_family );
+	m_pool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(**m_pool, vk::CommandBufferLevel::ePrimary, 1);
+	m_cmdBuf = make_unique<vk::raii::CommandBuffer>(
+		std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	if(g_hasDebugUtils)
+	{
+		string poolname = "LevelCrossingList.pool";
+		string bufname = "LevelCrossingList.cmdbuf";
+
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandPool,
+				reinterpret_cast<uint64_t>(static_cast<VkCommandPool>(**m_pool)),
+				poolname.c_str()));
+
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandBuffer,
+				reinterpret_cast<uint64_t>(static_cast<VkCommandBuffer>(**m_cmdBuf)),
+				bufname.c_str()));
+	}
+}
+
+/**
+	@brief Finds the crossings of a uniform or sparse analog waveform on the GPU
+
+	@param wfm			Input waveform
+	@param threshold	Threshold to search for
+	@param crossings	Output buffer
+ */
+void LevelCrossingList::Engine::Run(WaveformBase* wfm, float threshold, AcceleratorBuffer<int64_t>& crossings)
+{
+	auto sdin = dynamic_cast<SparseAnalogWaveform*>(wfm);
+	auto udin = dynamic_cast<UniformAnalogWaveform*>(wfm);
+
+	if(sdin)
+		m_detector.FindZeroCrossings(sdin, threshold, *m_cmdBuf, m_queue);
+	else
+		m_detector.FindZeroCrossings(udin, threshold, *m_cmdBuf, m_queue);
+
+	//Lists are shared between threads once cached, so make sure nobody has to move the data later
+	crossings.CopyFrom(m_detector.GetResults());
+	crossings.PrepareForCpuAccess();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+LevelCrossingList::LevelCrossingList(float threshold, float hysteresis, Interpolation interp)
+	: m_threshold(threshold)
+	, m_hysteresis(hysteresis)
+	, m_interpolation(interp)
+{
+	m_crossings.SetCpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
+	m_crossings.SetGpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
+	m_crossings.SetName("LevelCrossingList.m_crossings");
+}
+
+/**
+	@brief Frees the shared GPU engine
+
+	Must be called before the Vulkan device is destroyed.
+ */
+void LevelCrossingList::DestroyEngine()
+{
+	lock_guard<mutex> lock(m_engineMutex);
+	m_engine = nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Search
+
+/**
+	@brief Gets the crossings of a threshold by an analog waveform, searching for them if no up to date list with the
+	same parameters is cached
+
+	@param wfm			A SparseAnalogWaveform or UniformAnalogWaveform
+	@param threshold	Threshold to search for
+	@param hysteresis	Width of the hysteresis band around the threshold
+	@param interp		Interpolation mode
+
+	@return The crossing list (empty if the waveform is not analog)
+ */
+shared_ptr<LevelCrossingList> LevelCrossingList::Get(
+	WaveformBase* wfm,
+	float threshold,
+	float hysteresis,
+	Interpolation interp)
+{
+	uint64_t rev = wfm->m_revision;
+	{
+		lock_guard<mutex> lock(m_cacheMutex);
+		if(wfm->m_cachedCrossingsRevision == rev)
+		{
+			for(auto& list : wfm->m_cachedCrossings)
+			{
+				if(list->Matches(threshold, hysteresis, interp))
+					return list;
+			}
+		}
+	}
+
+	//Same locking strategy as DigitalEdgeList::Get()
+	auto list = make_shared<LevelCrossingList>(threshold, hysteresis, interp);
+	list->Find(wfm);
+
+	lock_guard<mutex> lock(m_cacheMutex);
+	if(wfm->m_cachedCrossingsRevision != rev)
+	{
+		wfm->m_cachedCrossings.clear();
+		wfm->m_cachedCrossingsRevision = rev;
+	}
+
+	//Keep the most recently searched parameters at the front, and drop the oldest once we have too many
+	auto& cache = wfm->m_cachedCrossings;
+	cache.insert(cache.begin(), list);
+	if(cache.size() > MAX_CACHED_PER_WAVEFORM)
+		cache.pop_back();
+	return list;
+}
+
+/**
+	@brief Fills this list from a waveform
+ */
+void LevelCrossingList::Find(WaveformBase* wfm)
+{
+	auto sdin = dynamic_cast<SparseAnalogWaveform*>(wfm);
+	auto udin = dynamic_cast<UniformAnalogWaveform*>(wfm);
+	if(!sdin && !udin)
+		return;
+	if(wfm->size() < 2)
+		return;
+
+	//The GPU search only does linear interpolation without hysteresis, which is by far the most common case
+	if( (m_hysteresis == 0) && (m_interpolation == INTERP_LINEAR) )
+	{
+		if( (wfm->size() >= GPU_SEARCH_THRESHOLD) && g_hasShaderInt64 )
+		{
+			lock_guard<mutex> lock(m_engineMutex);
+			if(!m_engine)
+				m_engine = make_unique<Engine>();
+			m_engine->Run(wfm, m_threshold, m_crossings);
+		}
+		else if(sdin)
+			FindOnCpuNoHysteresis(sdin);
+		else
+			FindOnCpuNoHysteresis(udin);
+	}
+
+	else if(sdin)
+		FindOnCpu(sdin);
+	else
+		FindOnCpu(udin);
+}
+
+/**
+	@brief Counts the samples in [start, len) on the other side of the threshold from the sample before them
+
+	This is a branch-free reduction, so the compiler can vectorize it. Counting first lets the search write straight
+	into an exactly sized output buffer instead of growing a vector and copying it.
+ */
+static size_t CountCrossings(const float* samples, size_t start, size_t len, float threshold)
+{
+	size_t count = 0;
+	for(size_t i=start; i<len; i++)
+		count += (samples[i] > threshold) != (samples[i-1] > threshold);
+	return count;
+}
+
+/**
+	@brief Finds crossings of a sparse waveform with linear interpolation and no hysteresis
+
+	This is the same search the GPU does, so the results are identical.
+ */
+void LevelCrossingList::FindOnCpuNoHysteresis(SparseAnalogWaveform* data)
+{
+	data->PrepareForCpuAccess();
+
+	//The first pair of samples is never checked for a crossing
+	auto samples = data->m_samples.GetCpuPointer();
+	size_t len = data->m_samples.size();
+	m_crossings.resize(CountCrossings(samples, 2, len, m_threshold));
+
+	//Find times of the zero crossings
+	int64_t phoff = data->m_triggerPhase;
+	float fscale = data->m_timescale;
+	size_t icross = 0;
+	for(size_t i=2; i<len; i++)
+	{
+		//Skip samples with no transition
+		if( (samples[i] > m_threshold) == (samples[i-1] > m_threshold) )
+			continue;
+
+		//Midpoint of the sample, plus the zero crossing
+		int64_t tfrac = fscale * Filter::InterpolateTime(data, i-1, m_threshold);
+		m_crossings[icross ++] = phoff + data->m_timescale * data->m_offsets[i-1] + tfrac;
+	}
+
+	m_crossings.MarkModifiedFromCpu();
+}
+
+/**
+	@brief Finds crossings of a uniform waveform with linear interpolation and no hysteresis
+
+	This is the same search the GPU does, so the results are identical.
+ */
+void LevelCrossingList::FindOnCpuNoHysteresis(UniformAnalogWaveform* data)
+{
+	data->PrepareForCpuAccess();
+
+	auto samples = data->m_samples.GetCpuPointer();
+	size_t len = data->m_samples.size();
+	m_crossings.resize(CountCrossings(samples, 1, len, m_threshold));
+
+	//Find times of the zero crossings
+	float fscale = data->m_timescale;
+	int64_t timescale = data->m_timescale;
+	int64_t phoff = data->m_triggerPhase;
+	size_t icross = 0;
+	for(size_t i=1; i<len; i++)
+	{
+		float flast = samples[i-1];
+		float fcur = samples[i];
+
+		//Skip samples with no transition
+		if( (fcur > m_threshold) == (flast > m_threshold) )
+			continue;
+
+		//Midpoint of the sample, plus the zero crossing
+		float slope = (fcur - flast);
+		float delta = m_threshold - flast;
+		int64_t tfrac = (fscale * delta) / slope;
+		m_crossings[icross ++] = phoff + timescale*(i-1) + tfrac;
+	}
+
+	m_crossings.MarkModifiedFromCpu();
+}
+
+/**
+	@brief Finds crossings with hysteresis and/or without interpolation
+
+	The signal has to leave the hysteresis band on the far side before a crossing is counted, but the timestamp is
+	that of the last time it actually crossed the threshold, so noise near the threshold doesn't bias the timing.
+ */
+template<class T>
+void LevelCrossingList::FindOnCpu(T* wfm)
+{
+	wfm->PrepareForCpuAccess();
+
+	float hi = m_threshold + m_hysteresis/2;
+	float lo = m_threshold - m_hysteresis/2;
+
+	vector<int64_t> edges;
+	size_t len = wfm->size();
+	bool high = wfm->m_samples[0] > m_threshold;
+	size_t icross = 0;
+	for(size_t i=1; i<len; i++)
+	{
+		float prev = wfm->m_samples[i-1];
+		float cur = wfm->m_samples[i];
+
+		//Remember where the signal last crossed the threshold itself, in either direction.
+		//By the time it leaves the band this is the crossing in the direction it left.
+		if( (prev > m_threshold) != (cur > m_threshold) )
+			icross = i;
+
+		if(high ? (cur > lo) : (cur <= hi))
+			continue;
+		high = !high;
+
+		int64_t t = ::GetOffset(wfm, icross);
+		if(m_interpolation == INTERP_LINEAR)
+		{
+			t = ::GetOffset(wfm, icross-1);
+			edges.push_back(
+				wfm->m_triggerPhase + t*wfm->m_timescale +
+				static_cast<int64_t>(wfm->m_timescale * Filter::InterpolateTime(wfm, icross-1, m_threshold)));
+		}
+		else
+			edges.push_back(wfm->m_triggerPhase + t*wfm->m_timescale);
+	}
+
+	SetCrossings(edges);
+}
+
+/**
+	@brief Copies crossings found on the CPU into m_crossings
+ */
+void LevelCrossingList::SetCrossings(const vector<int64_t>& edges)
+{
+	if(edges.empty())
+		m_crossings.clear();
+	else
+		m_crossings.CopyFrom(edges);
+}
@@ -0,0 +1,126 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of LevelCrossingList
+	@ingroup datamodel
+ */
+
+#ifndef LevelCrossingList_h
+#define LevelCrossingList_h
+
+/**
+	@brief Interpolated timestamps of every crossing of a threshold by an analog waveform
+	@ingroup datamodel
+
+	Frequency, period, duty cycle, pulse width, TIE, clock recovery and friends all start by finding the crossings
+	of the same input at the same auto-computed threshold. Crossing lists are created by Get(), which caches the
+	result on the source waveform (one list per set of search parameters) until its revision changes, so all of
+	those filters share one search.
+
+	Timestamps are in X axis units, with the trigger phase already applied, exactly as returned by
+	Filter::FindZeroCrossings(). Crossings alternate in direction. The list is always valid on the CPU, and is
+	also kept on the GPU if it was found there.
+ */
+class LevelCrossingList
+{
+public:
+	///@brief How the time of each crossing is estimated
+	enum Interpolation
+	{
+		///@brief Linear interpolation between the two samples either side of the threshold
+		INTERP_LINEAR,
+
+		///@brief Start of the first sample past the threshold
+		INTERP_NONE
+	};
+
+	LevelCrossingList(float threshold, float hysteresis, Interpolation interp);
+
+	static std::shared_ptr<LevelCrossingList> Get(
+		WaveformBase* wfm,
+		float threshold,
+		float hysteresis = 0,
+		Interpolation interp = INTERP_LINEAR);
+	static void DestroyEngine();
+
+	///@brief Maximum number of lists (with different parameters) cached per waveform
+	static const size_t MAX_CACHED_PER_WAVEFORM = 8;
+
+	///@brief Threshold the crossings were found at
+	float m_threshold;
+
+	/**
+		@brief Width of the hysteresis band, centered on the threshold
+
+		A crossing is only counted once the signal leaves the band on the far side, but its timestamp is still
+		that of the last crossing of the threshold itself.
+	 */
+	float m_hysteresis;
+
+	///@brief Interpolation mode used to find the timestamps
+	Interpolation m_interpolation;
+
+	///@brief Timestamps of each crossing, in X axis units
+	AcceleratorBuffer<int64_t> m_crossings;
+
+	///@brief Number of crossings
+	size_t size() const
+	{ return m_crossings.size(); }
+
+	///@brief Checks if this list was found with the given parameters
+	bool Matches(float threshold, float hysteresis, Interpolation interp) const
+	{ return (m_threshold == threshold) && (m_hysteresis == hysteresis) && (m_interpolation == interp); }
+
+protected:
+	void Find(WaveformBase* wfm);
+
+	template<class T>
+	void FindOnCpu(T* wfm);
+
+	void FindOnCpuNoHysteresis(SparseAnalogWaveform* wfm);
+	void FindOnCpuNoHysteresis(UniformAnalogWaveform* wfm);
+
+	void SetCrossings(const std::vector<int64_t>& edges);
+
+	class Engine;
+
+	///@brief Mutex protecting the cache fields of every WaveformBase
+	static std::mutex m_cacheMutex;
+
+	///@brief Shared GPU search engine, created on first use
+	static std::unique_ptr<Engine> m_engine;
+
+	///@brief Mutex protecting m_engine
+	static std::mutex m_engineMutex;
+};
+
+#endif
@@ -0,0 +1,804 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of LoadGeneratorOscilloscope
+
+	@ingroup scopedrivers
+ */
+
+#include "scopehal.h"
+#include "OscilloscopeChannel.h"
+#include "LoadGeneratorOscilloscope.h"
+#include <cinttypes>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Initialize the driver
+
+	@param transport	SCPINullTransport whose arguments hold the generator configuration
+ */
+LoadGeneratorOscilloscope::LoadGeneratorOscilloscope(SCPITransport* transport)
+	: SCPIDevice(transport, false)
+	, SCPIInstrument(transport, false)
+	, m_args(transport->GetConnectionString())
+	, m_analogChannelCount(4)
+	, m_digitalChannelCount(0)
+	, m_triggerArmed(false)
+	, m_triggerOneShot(false)
+	, m_depth(1000000)
+	, m_rate(10000000000LL)
+	, m_triggerRate(0)
+	, m_segments(1)
+	, m_nextTrigger(0)
+	, m_triggers(0)
+	, m_missedTriggers(0)
+	, m_droppedWaveforms(0)
+	, m_generationTime(0)
+	, m_samplesGenerated(0)
+	, m_statsStart(GetTime())
+	, m_diag_requestedWFMHz(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_HZ))
+	, m_diag_generatedWFMHz(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_HZ))
+	, m_diag_totalWFMs(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS))
+	, m_diag_missedTriggers(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS))
+	, m_diag_droppedWFMs(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS))
+	, m_diag_lostPercent(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_PERCENT))
+{
+	m_model = "Load Generator";
+	m_vendor = "Antikernel Labs";
+	m_serial = "12345";
+
+	//Streaming instrument: if the consumer gets backed up, drop old waveforms rather than falling further behind
+	size_t queueDepth = 4;
+	ParseArguments(m_args, queueDepth);
+	SetPendingWaveformPolicy(PENDING_DROP_OLDEST, queueDepth);
+
+	CreateChannels();
+
+	m_diagnosticValues["Requested WFM/s"] = &m_diag_requestedWFMHz;
+	m_diagnosticValues["Generated WFM/s"] = &m_diag_generatedWFMHz;
+	m_diagnosticValues["Total Waveforms Generated"] = &m_diag_totalWFMs;
+	m_diagnosticValues["Triggers Missed (generator too slow)"] = &m_diag_missedTriggers;
+	m_diagnosticValues["Waveforms Dropped (consumer too slow)"] = &m_diag_droppedWFMs;
+	m_diagnosticValues["% Waveforms Lost"] = &m_diag_lostPercent;
+	ResetLoadStatistics();
+
+	LogDebug("Load generator: %zu analog + %zu digital channels, %" PRIu64 " points at %" PRIu64 " Sa/s, "
+		"%.1f triggers/s, %zu segments\n",
+		m_analogChannelCount, m_digitalChannelCount, m_depth, m_rate, m_triggerRate, m_segments);
+}
+
+LoadGeneratorOscilloscope::~LoadGeneratorOscilloscope()
+{
+	LogTrace("Shutting down load generator\n");
+}
+
+/**
+	@brief Reads the generator configuration from the transport arguments
+
+	Unknown keys and out of range values are warned about and ignored.
+
+	@param args			Comma separated key=value pairs
+	@param queueDepth	Set to the requested pending waveform queue depth, if one was given
+ */
+void LoadGeneratorOscilloscope::ParseArguments(const string& args, size_t& queueDepth)
+{
+	Unit counts(Unit::UNIT_SAMPLEDEPTH);
+	Unit hz(Unit::UNIT_HZ);
+
+	for(auto& kv : explode(args, ','))
+	{
+		if(kv.empty())
+			continue;
+
+		auto eq = kv.find('=');
+		if(eq == string::npos)
+		{
+			LogWarning("Load generator: ignoring malformed argument \"%s\" (expected key=value)\n", kv.c_str());
+			continue;
+		}
+		string key = kv.substr(0, eq);
+		string value = kv.substr(eq+1);
+
+		if(key == "channels")
+			m_analogChannelCount = counts.ParseString(value, false);
+		else if(key == "digital")
+			m_digitalChannelCount = counts.ParseString(value, false);
+		else if(key == "depth")
+			m_depth = counts.ParseString(value, false);
+		else if(key == "rate")
+			m_rate = hz.ParseString(value, false);
+		else if(key == "trigrate")
+			m_triggerRate = hz.ParseString(value, false);
+		else if(key == "segments")
+			m_segments = max(1.0, counts.ParseString(value, false));
+		else if(key == "queue")
+			queueDepth = max(1.0, counts.ParseString(value, false));
+		else
+			LogWarning("Load generator: ignoring unknown argument \"%s\"\n", key.c_str());
+	}
+
+	if(m_analogChannelCount + m_digitalChannelCount > MAX_CHANNELS)
+	{
+		LogWarning("Load generator: at most %zu channels are supported, reducing digital channel count\n",
+			MAX_CHANNELS);
+		m_analogChannelCount = min(m_analogChannelCount, MAX_CHANNELS);
+		m_digitalChannelCount = MAX_CHANNELS - m_analogChannelCount;
+	}
+	if(m_depth == 0)
+		m_depth = 1;
+	if(m_rate == 0)
+		m_rate = 1000000000LL;
+}
+
+/**
+	@brief Creates the channels and the per-channel generator state
+ */
+void LoadGeneratorOscilloscope::CreateChannels()
+{
+	static const char* colors[8] =
+	{ "#ffff00", "#ff6abc", "#00ffff", "#00c100", "#d7ffd7", "#8482ff", "#ff0000", "#ff8000" };
+	static const char* patternNames[PATTERN_COUNT] = { "Tone", "Ramp", "PRBS31", "8B10B" };
+
+	size_t nchans = m_analogChannelCount + m_digitalChannelCount;
+	m_channelsEnabled.resize(nchans, true);
+	m_channelCoupling.resize(nchans, OscilloscopeChannel::COUPLE_DC_50);
+	m_channelAttenuation.resize(nchans, 10);
+	m_channelBandwidth.resize(nchans, 0);
+	m_channelVoltageRange.resize(nchans, 1);
+	m_channelOffset.resize(nchans, 0);
+
+	for(size_t i=0; i<m_analogChannelCount; i++)
+	{
+		auto pattern = static_cast<Pattern>(i % PATTERN_COUNT);
+		m_channelPatterns.push_back(pattern);
+
+		m_channels.push_back(
+			new OscilloscopeChannel(
+				this,
+				string("CH") + to_string(i+1),
+				colors[i % 8],
+				Unit(Unit::UNIT_FS),
+				Unit(Unit::UNIT_VOLTS),
+				Stream::STREAM_TYPE_ANALOG,
+				i));
+		m_channels[i]->SetDisplayName(string(patternNames[pattern]) + to_string(i+1));
+
+		m_rng.push_back(make_unique<minstd_rand>(m_rd()));
+		m_source.push_back(make_unique<TestWaveformSource>(*m_rng[i]));
+
+		m_queue.push_back(g_vkQueueManager->GetComputeQueue(string("LoadGeneratorOscilloscope.queue") + to_string(i)));
+		vk::CommandPoolCreateInfo poolInfo(
+			vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+			m_queue[i]->m_family );
+		m_pool.push_back(make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo));
+
+		vk::CommandBufferAllocateInfo bufinfo(**m_pool[i], vk::CommandBufferLevel::ePrimary, 1);
+		m_cmdBuf.push_back(make_unique<vk::raii::CommandBuffer>(
+			std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front())));
+
+		if(g_hasDebugUtils)
+		{
+			string bufname = string("LoadGeneratorOscilloscope.cmdbuf") + to_string(i);
+			g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+				vk::DebugUtilsObjectNameInfoEXT(
+					vk::ObjectType::eCommandBuffer,
+					reinterpret_cast<uint64_t>(static_cast<VkCommandBuffer>(**m_cmdBuf[i])),
+					bufname.c_str()));
+
+			string poolname = string("LoadGeneratorOscilloscope.pool") + to_string(i);
+			g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+				vk::DebugUtilsObjectNameInfoEXT(
+					vk::ObjectType::eCommandPool,
+					reinterpret_cast<uint64_t>(static_cast<VkCommandPool>(**m_pool[i])),
+					poolname.c_str()));
+		}
+	}
+
+	for(size_t i=0; i<m_digitalChannelCount; i++)
+	{
+		size_t index = m_analogChannelCount + i;
+		m_channels.push_back(
+			new OscilloscopeChannel(
+				this,
+				string("D") + to_string(i),
+				colors[index % 8],
+				Unit(Unit::UNIT_FS),
+				Unit(Unit::UNIT_COUNTS),
+				Stream::STREAM_TYPE_DIGITAL,
+				index));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Information queries
+
+string LoadGeneratorOscilloscope::IDPing()
+{
+	return "";
+}
+
+string LoadGeneratorOscilloscope::GetTransportName()
+{
+	return "null";
+}
+
+string LoadGeneratorOscilloscope::GetTransportConnectionString()
+{
+	return m_args;
+}
+
+///@brief Return the constant driver name "loadgen"
+string LoadGeneratorOscilloscope::GetDriverNameInternal()
+{
+	return "loadgen";
+}
+
+unsigned int LoadGeneratorOscilloscope::GetInstrumentTypes() const
+{
+	return INST_OSCILLOSCOPE;
+}
+
+uint32_t LoadGeneratorOscilloscope::GetInstrumentTypesForChannel([[maybe_unused]] size_t i) const
+{
+	return Instrument::INST_OSCILLOSCOPE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Triggering
+
+Oscilloscope::TriggerMode LoadGeneratorOscilloscope::PollTrigger()
+{
+	if(m_triggerArmed)
+		return TRIGGER_MODE_TRIGGERED;
+	else
+		return TRIGGER_MODE_STOP;
+}
+
+void LoadGeneratorOscilloscope::StartSingleTrigger()
+{
+	m_triggerArmed = true;
+	m_triggerOneShot = true;
+}
+
+void LoadGeneratorOscilloscope::Start()
+{
+	m_triggerArmed = true;
+	m_triggerOneShot = false;
+	m_nextTrigger = 0;
+}
+
+void LoadGeneratorOscilloscope::Stop()
+{
+	m_triggerArmed = false;
+	m_triggerOneShot = false;
+}
+
+void LoadGeneratorOscilloscope::ForceTrigger()
+{
+	StartSingleTrigger();
+}
+
+bool LoadGeneratorOscilloscope::IsTriggerArmed()
+{
+	return m_triggerArmed;
+}
+
+void LoadGeneratorOscilloscope::PushTrigger()
+{
+	//no-op
+}
+
+void LoadGeneratorOscilloscope::PullTrigger()
+{
+	//no-op
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Channel configuration. Mostly trivial stubs.
+
+bool LoadGeneratorOscilloscope::IsChannelEnabled(size_t i)
+{
+	return m_channelsEnabled[i];
+}
+
+void LoadGeneratorOscilloscope::EnableChannel(size_t i)
+{
+	m_channelsEnabled[i] = true;
+}
+
+void LoadGeneratorOscilloscope::DisableChannel(size_t i)
+{
+	m_channelsEnabled[i] = false;
+}
+
+OscilloscopeChannel::CouplingType LoadGeneratorOscilloscope::GetChannelCoupling(size_t i)
+{
+	return m_channelCoupling[i];
+}
+
+vector<OscilloscopeChannel::CouplingType> LoadGeneratorOscilloscope::GetAvailableCouplings(size_t /*i*/)
+{
+	vector<OscilloscopeChannel::CouplingType> ret;
+	ret.push_back(OscilloscopeChannel::COUPLE_DC_50);
+	return ret;
+}
+
+void LoadGeneratorOscilloscope::SetChannelCoupling(size_t i, OscilloscopeChannel::CouplingType type)
+{
+	m_channelCoupling[i] = type;
+}
+
+double LoadGeneratorOscilloscope::GetChannelAttenuation(size_t i)
+{
+	return m_channelAttenuation[i];
+}
+
+void LoadGeneratorOscilloscope::SetChannelAttenuation(size_t i, double atten)
+{
+	m_channelAttenuation[i] = atten;
+}
+
+unsigned int LoadGeneratorOscilloscope::GetChannelBandwidthLimit(size_t i)
+{
+	return m_channelBandwidth[i];
+}
+
+void LoadGeneratorOscilloscope::SetChannelBandwidthLimit(size_t i, unsigned int limit_mhz)
+{
+	m_channelBandwidth[i] = limit_mhz;
+}
+
+float LoadGeneratorOscilloscope::GetChannelVoltageRange(size_t i, size_t /*stream*/)
+{
+	return m_channelVoltageRange[i];
+}
+
+void LoadGeneratorOscilloscope::SetChannelVoltageRange(size_t i, size_t /*stream*/, float range)
+{
+	m_channelVoltageRange[i] = range;
+}
+
+OscilloscopeChannel* LoadGeneratorOscilloscope::GetExternalTrigger()
+{
+	return nullptr;
+}
+
+float LoadGeneratorOscilloscope::GetChannelOffset(size_t i, size_t /*stream*/)
+{
+	return m_channelOffset[i];
+}
+
+void LoadGeneratorOscilloscope::SetChannelOffset(size_t i, size_t /*stream*/, float offset)
+{
+	m_channelOffset[i] = offset;
+}
+
+vector<uint64_t> LoadGeneratorOscilloscope::GetSampleRatesNonInterleaved()
+{
+	uint64_t k = 1000;
+	uint64_t m = k * k;
+	uint64_t g = k * m;
+
+	vector<uint64_t> ret;
+	ret.push_back(100 * m);
+	ret.push_back(1 * g);
+	ret.push_back(10 * g);
+	ret.push_back(50 * g);
+	ret.push_back(100 * g);
+	if(find(ret.begin(), ret.end(), m_rate) == ret.end())
+		ret.push_back(m_rate);
+	sort(ret.begin(), ret.end());
+	return ret;
+}
+
+vector<uint64_t> LoadGeneratorOscilloscope::GetSampleRatesInterleaved()
+{
+	//no-op
+	vector<uint64_t> ret;
+	return ret;
+}
+
+set<Oscilloscope::InterleaveConflict> LoadGeneratorOscilloscope::GetInterleaveConflicts()
+{
+	//no-op
+	set<Oscilloscope::InterleaveConflict> ret;
+	return ret;
+}
+
+vector<uint64_t> LoadGeneratorOscilloscope::GetSampleDepthsNonInterleaved()
+{
+	uint64_t k = 1000;
+	uint64_t m = k * k;
+
+	vector<uint64_t> ret;
+	ret.push_back(1 * k);
+	ret.push_back(10 * k);
+	ret.push_back(100 * k);
+	ret.push_back(1 * m);
+	ret.push_back(10 * m);
+	ret.push_back(100 * m);
+	if(find(ret.begin(), ret.end(), m_depth) == ret.end())
+		ret.push_back(m_depth);
+	sort(ret.begin(), ret.end());
+	return ret;
+}
+
+vector<uint64_t> LoadGeneratorOscilloscope::GetSampleDepthsInterleaved()
+{
+	//no-op
+	vector<uint64_t> ret;
+	return ret;
+}
+
+uint64_t LoadGeneratorOscilloscope::GetSampleRate()
+{
+	return m_rate;
+}
+
+uint64_t LoadGeneratorOscilloscope::GetSampleDepth()
+{
+	return m_depth;
+}
+
+void LoadGeneratorOscilloscope::SetSampleDepth(uint64_t depth)
+{
+	m_depth = depth;
+}
+
+void LoadGeneratorOscilloscope::SetSampleRate(uint64_t rate)
+{
+	m_rate = rate;
+}
+
+void LoadGeneratorOscilloscope::SetTriggerOffset(int64_t /*offset*/)
+{
+	//not meaningful for generated data
+}
+
+int64_t LoadGeneratorOscilloscope::GetTriggerOffset()
+{
+	return 0;
+}
+
+bool LoadGeneratorOscilloscope::CanInterleave()
+{
+	return false;
+}
+
+bool LoadGeneratorOscilloscope::IsInterleaving()
+{
+	return false;
+}
+
+bool LoadGeneratorOscilloscope::SetInterleaving([[maybe_unused]] bool combine)
+{
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pattern selection
+
+vector<string> LoadGeneratorOscilloscope::GetADCModeNames(size_t /*channel*/)
+{
+	vector<string> ret;
+	ret.push_back("Noisy sine");
+	ret.push_back("Noisy two-tone sum");
+	ret.push_back("PRBS-31 + ISI channel");
+	ret.push_back("8B/10B idles + ISI channel");
+	return ret;
+}
+
+size_t LoadGeneratorOscilloscope::GetADCMode(size_t channel)
+{
+	lock_guard<recursive_mutex> lock(m_mutex);
+	if(channel >= m_analogChannelCount)
+		return 0;
+	return m_channelPatterns[channel];
+}
+
+void LoadGeneratorOscilloscope::SetADCMode(size_t channel, size_t mode)
+{
+	lock_guard<recursive_mutex> lock(m_mutex);
+	if( (channel < m_analogChannelCount) && (mode < PATTERN_COUNT) )
+		m_channelPatterns[channel] = static_cast<Pattern>(mode);
+}
+
+bool LoadGeneratorOscilloscope::IsADCModeConfigurable()
+{
+	return true;
+}
+
+vector<Oscilloscope::AnalogBank> LoadGeneratorOscilloscope::GetAnalogBanks()
+{
+	vector<AnalogBank> ret;
+	for(size_t i=0; i<m_analogChannelCount; i++)
+		ret.push_back(GetAnalogBank(i));
+	return ret;
+}
+
+Oscilloscope::AnalogBank LoadGeneratorOscilloscope::GetAnalogBank(size_t channel)
+{
+	AnalogBank bank;
+	bank.push_back(GetOscilloscopeChannel(channel));
+	return bank;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Statistics
+
+/**
+	@brief Gets how well the generator and its consumer have kept up since the last ResetLoadStatistics()
+ */
+LoadGeneratorOscilloscope::LoadStatistics LoadGeneratorOscilloscope::GetLoadStatistics()
+{
+	lock_guard<mutex> lock(m_statsMutex);
+
+	LoadStatistics ret;
+	ret.m_triggers = m_triggers;
+	ret.m_missedTriggers = m_missedTriggers;
+	ret.m_droppedWaveforms = m_droppedWaveforms;
+
+	double elapsed = GetTime() - m_statsStart;
+	ret.m_triggerRate = (elapsed > 0) ? m_triggers / elapsed : 0;
+	ret.m_generationTime = m_triggers ? m_generationTime / m_triggers : 0;
+	ret.m_samplesPerSecond = (elapsed > 0) ? m_samplesGenerated / elapsed : 0;
+	return ret;
+}
+
+/**
+	@brief Zeroes the load statistics
+ */
+void LoadGeneratorOscilloscope::ResetLoadStatistics()
+{
+	lock_guard<mutex> lock(m_statsMutex);
+	m_triggers = 0;
+	m_missedTriggers = 0;
+	m_droppedWaveforms = 0;
+	m_generationTime = 0;
+	m_samplesGenerated = 0;
+	m_statsStart = GetTime();
+	m_triggerClock.Reset();
+	UpdateDiagnostics();
+}
+
+/**
+	@brief Copies the statistics to the diagnostics values
+
+	Must be called with m_statsMutex held.
+ */
+void LoadGeneratorOscilloscope::UpdateDiagnostics()
+{
+	m_diag_requestedWFMHz.SetFloatVal(m_triggerRate);
+	m_diag_generatedWFMHz.SetFloatVal(m_triggerClock.GetAverageHz());
+	m_diag_totalWFMs.SetIntVal(m_triggers);
+	m_diag_missedTriggers.SetIntVal(m_missedTriggers);
+	m_diag_droppedWFMs.SetIntVal(m_droppedWaveforms);
+
+	uint64_t requested = m_triggers + m_missedTriggers;
+	uint64_t lost = m_missedTriggers + m_droppedWaveforms;
+	m_diag_lostPercent.SetFloatVal(requested ? static_cast<double>(lost) / requested : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Waveform synthesis
+
+void LoadGeneratorOscilloscope::RecyclePendingWaveform(WaveformBase* w)
+{
+	if(dynamic_cast<SparseDigitalWaveform*>(w))
+		AddWaveformToDigitalPool(w);
+	else
+		AddWaveformToAnalogPool(w);
+}
+
+bool LoadGeneratorOscilloscope::AcquireData()
+{
+	if(!m_triggerArmed)
+		return false;
+
+	int64_t sampleperiod = FS_PER_SECOND / m_rate;
+	for(size_t seg=0; seg<m_segments; seg++)
+	{
+		//Pace to the requested trigger rate, counting any triggers we were too slow to generate
+		if(m_triggerRate > 0)
+		{
+			double interval = 1.0 / m_triggerRate;
+			double now = GetTime();
+			if(m_nextTrigger == 0)
+				m_nextTrigger = now;
+
+			if(now < m_nextTrigger)
+			{
+				this_thread::sleep_for(chrono::duration<double>(m_nextTrigger - now));
+				now = m_nextTrigger;
+			}
+
+			uint64_t missed = floor((now - m_nextTrigger) / interval);
+			if(missed)
+			{
+				lock_guard<mutex> lock(m_statsMutex);
+				m_missedTriggers += missed;
+			}
+			m_nextTrigger += (missed + 1) * interval;
+		}
+
+		GenerateTrigger(sampleperiod);
+
+		if(m_triggerOneShot)
+		{
+			m_triggerArmed = false;
+			break;
+		}
+	}
+
+	return true;
+}
+
+/**
+	@brief Generates one waveform on every enabled channel and pushes it to the pending queue
+
+	Analog channels are generated in parallel, each on its own queue.
+ */
+void LoadGeneratorOscilloscope::GenerateTrigger(int64_t sampleperiod)
+{
+	SCOPEHAL_TRACE_SPAN("LoadGeneratorOscilloscope::GenerateTrigger", "acquisition");
+
+	double start = GetTime();
+	size_t depth = m_depth;
+
+	vector<Pattern> patterns;
+	{
+		lock_guard<recursive_mutex> lock(m_mutex);
+		patterns = m_channelPatterns;
+	}
+
+	//Allocate up front, the waveform pools aren't meant to be hit from many threads at once
+	size_t nchans = m_analogChannelCount + m_digitalChannelCount;
+	vector<WaveformBase*> waveforms(nchans, nullptr);
+	size_t samples = 0;
+	for(size_t i=0; i<nchans; i++)
+	{
+		if(!m_channelsEnabled[i])
+			continue;
+		if(i < m_analogChannelCount)
+			waveforms[i] = AllocateAnalogWaveform(m_channels[i]->GetDisplayName(), depth);
+		else
+			waveforms[i] = AllocateDigitalWaveform(m_channels[i]->GetDisplayName());
+		samples += depth;
+	}
+
+	ChannelsDownloadStarted();
+
+	float period = 1e6;
+	float sweepPeriod = FS_PER_SECOND / 1.2e9;
+
+	#pragma omp parallel for
+	for(size_t i=0; i<m_analogChannelCount; i++)
+	{
+		auto wfm = dynamic_cast<UniformAnalogWaveform*>(waveforms[i]);
+		if(!wfm)
+			continue;
+
+		switch(patterns[i])
+		{
+			case PATTERN_SINE:
+				m_source[i]->GenerateNoisySinewave(
+					*m_cmdBuf[i], m_queue[i], wfm, 0.9, 0.0, period, sampleperiod, depth, 0.01);
+				break;
+
+			case PATTERN_SINE_SUM:
+				m_source[i]->GenerateNoisySinewaveSum(
+					*m_cmdBuf[i], m_queue[i], wfm, 0.9, 0.0, M_PI_4, period, sweepPeriod, sampleperiod, depth, 0.01);
+				break;
+
+			case PATTERN_PRBS31:
+				m_source[i]->GeneratePRBS31(
+					*m_cmdBuf[i], m_queue[i], wfm, 0.9, 96969.6, sampleperiod, depth, true, 0.01);
+				break;
+
+			case PATTERN_8B10B:
+			default:
+				m_source[i]->Generate8b10b(
+					*m_cmdBuf[i], m_queue[i], wfm, 0.9, 800e3, sampleperiod, depth, true, 0.01);
+				break;
+		}
+	}
+
+	for(size_t i=0; i<m_digitalChannelCount; i++)
+	{
+		auto wfm = dynamic_cast<SparseDigitalWaveform*>(waveforms[m_analogChannelCount + i]);
+		if(wfm)
+			GenerateCounterBit(wfm, i, sampleperiod, depth);
+	}
+
+	//Timestamp the waveform(s)
+	double now = GetTime();
+	time_t tstart = now;
+	int64_t fs = (now - tstart) * FS_PER_SECOND;
+
+	SequenceSet s;
+	for(size_t i=0; i<nchans; i++)
+	{
+		auto wfm = waveforms[i];
+		if(!wfm)
+			continue;
+
+		wfm->m_startTimestamp = tstart;
+		wfm->m_startFemtoseconds = fs;
+		wfm->m_triggerPhase = 0;
+		s[GetOscilloscopeChannel(i)] = wfm;
+	}
+
+	size_t dropped = PushPendingWaveform(s);
+	ChannelsDownloadFinished();
+
+	lock_guard<mutex> lock(m_statsMutex);
+	m_triggers ++;
+	m_droppedWaveforms += dropped;
+	m_generationTime += now - start;
+	m_samplesGenerated += samples;
+	m_triggerClock.Tick();
+	UpdateDiagnostics();
+}
+
+/**
+	@brief Generates one bit of a free running counter as a sparse digital waveform
+
+	Bit k toggles every 2^(k+4) samples, so a waveform has depth / 2^(k+4) samples regardless of how deep the
+	capture is for higher bits.
+ */
+void LoadGeneratorOscilloscope::GenerateCounterBit(
+	SparseDigitalWaveform* wfm,
+	size_t bit,
+	int64_t sampleperiod,
+	size_t depth)
+{
+	size_t halfPeriod = 1ULL << min(bit + 4, static_cast<size_t>(62));
+	size_t nedges = (depth + halfPeriod - 1) / halfPeriod;
+
+	wfm->m_timescale = sampleperiod;
+	wfm->m_triggerPhase = 0;
+	wfm->PrepareForCpuAccess();
+	wfm->Resize(nedges);
+
+	for(size_t i=0; i<nedges; i++)
+	{
+		size_t off = i * halfPeriod;
+		wfm->m_offsets[i] = off;
+		wfm->m_durations[i] = min(halfPeriod, depth - off);
+		wfm->m_samples[i] = (i & 1);
+	}
+
+	wfm->MarkModifiedFromCpu();
+}
@@ -0,0 +1,322 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of LoadGeneratorOscilloscope
+	@ingroup scopedrivers
+ */
+
+#ifndef LoadGeneratorOscilloscope_h
+#define LoadGeneratorOscilloscope_h
+
+#include "TestWaveformSource.h"
+#include "../xptools/HzClock.h"
+#include <random>
+
+/**
+	@brief Simulated high channel count, high trigger rate oscilloscope for soak and scaling tests
+	@ingroup scopedrivers
+
+	Unlike DemoOscilloscope, which is meant to look like a real instrument, this driver exists to find how much data
+	a filter graph can sustain on a given machine. It is configured through the arguments of its (null) transport,
+	as comma separated key=value pairs with SI suffixes allowed:
+
+	* channels: number of analog channels (default 4)
+	* digital: number of digital channels (default 0). At most 64 channels in total.
+	* depth: samples per channel per trigger (default 1M)
+	* rate: sample rate (default 10G)
+	* trigrate: trigger rate in Hz, or 0 to trigger as fast as waveforms can be generated (default 0)
+	* segments: triggers generated back to back per AcquireData() call, as in a segmented capture (default 1)
+	* queue: depth of the pending waveform queue (default 4)
+
+	For example "channels=16,digital=8,depth=10M,trigrate=50".
+
+	Each analog channel generates one of four patterns, selected with the ADC mode: a noisy sine, a noisy two-tone sum,
+	PRBS-31 and 8B/10B idles, the latter two through an ISI channel (so they exercise CDR and protocol decodes).
+	Sines are generated entirely on the GPU; serial patterns are generated on the CPU and degraded on the GPU. All
+	channels are generated in parallel, each with its own queue and command buffer. Digital channel k carries bit k of
+	a counter, so the digital channels together form a parallel bus.
+
+	Two kinds of loss are counted: triggers missed because generation could not keep up with the requested trigger
+	rate, and waveforms dropped because the consumer (usually the filter graph) could not keep up and the pending
+	queue overflowed. Both are reported through the diagnostics values and GetLoadStatistics().
+ */
+class LoadGeneratorOscilloscope : public virtual SCPIOscilloscope
+{
+public:
+	LoadGeneratorOscilloscope(SCPITransport* transport);
+	virtual ~LoadGeneratorOscilloscope();
+
+	//not copyable or assignable
+	LoadGeneratorOscilloscope(const LoadGeneratorOscilloscope& rhs) =delete;
+	LoadGeneratorOscilloscope& operator=(const LoadGeneratorOscilloscope& rhs) =delete;
+
+	virtual std::string IDPing() override;
+
+	virtual std::string GetTransportConnectionString() override;
+	virtual std::string GetTransportName() override;
+	virtual uint32_t GetInstrumentTypesForChannel(size_t i) const override;
+
+	//Channel configuration
+	virtual bool IsChannelEnabled(size_t i) override;
+	virtual void EnableChannel(size_t i) override;
+	virtual void DisableChannel(size_t i) override;
+	virtual OscilloscopeChannel::CouplingType GetChannelCoupling(size_t i) override;
+	virtual void SetChannelCoupling(size_t i, OscilloscopeChannel::CouplingType type) override;
+	virtual std::vector<OscilloscopeChannel::CouplingType> GetAvailableCouplings(size_t i) override;
+	virtual double GetChannelAttenuation(size_t i) override;
+	virtual void SetChannelAttenuation(size_t i, double atten) override;
+	virtual unsigned int GetChannelBandwidthLimit(size_t i) override;
+	virtual void SetChannelBandwidthLimit(size_t i, unsigned int limit_mhz) override;
+	virtual float GetChannelVoltageRange(size_t i, size_t stream) override;
+	virtual void SetChannelVoltageRange(size_t i, size_t stream, float range) override;
+	virtual OscilloscopeChannel* GetExternalTrigger() override;
+	virtual float GetChannelOffset(size_t i, size_t stream) override;
+	virtual void SetChannelOffset(size_t i, size_t stream, float offset) override;
+
+	//Triggering
+	virtual Oscilloscope::TriggerMode PollTrigger() override;
+	virtual bool AcquireData() override;
+	virtual void Start() override;
+	virtual void StartSingleTrigger() override;
+	virtual void Stop() override;
+	virtual void ForceTrigger() override;
+	virtual bool IsTriggerArmed() override;
+	virtual void PushTrigger() override;
+	virtual void PullTrigger() override;
+
+	virtual std::vector<uint64_t> GetSampleRatesNonInterleaved() override;
+	virtual std::vector<uint64_t> GetSampleRatesInterleaved() override;
+	virtual std::set<InterleaveConflict> GetInterleaveConflicts() override;
+	virtual std::vector<uint64_t> GetSampleDepthsNonInterleaved() override;
+	virtual std::vector<uint64_t> GetSampleDepthsInterleaved() override;
+	virtual uint64_t GetSampleRate() override;
+	virtual uint64_t GetSampleDepth() override;
+	virtual void SetSampleDepth(uint64_t depth) override;
+	virtual void SetSampleRate(uint64_t rate) override;
+	virtual void SetTriggerOffset(int64_t offset) override;
+	virtual int64_t GetTriggerOffset() override;
+	virtual bool IsInterleaving() override;
+	virtual bool SetInterleaving(bool combine) override;
+	virtual bool CanInterleave() override;
+
+	virtual bool IsADCModeConfigurable() override;
+	virtual std::vector<std::string> GetADCModeNames(size_t channel) override;
+	virtual size_t GetADCMode(size_t channel) override;
+	virtual void SetADCMode(size_t channel, size_t mode) override;
+	virtual std::vector<AnalogBank> GetAnalogBanks() override;
+	virtual AnalogBank GetAnalogBank(size_t channel) override;
+
+	virtual unsigned int GetInstrumentTypes() const override;
+
+	/**
+		@brief Counters describing how well the generator and its consumer kept up
+	 */
+	class LoadStatistics
+	{
+	public:
+		///@brief Triggers generated and pushed to the pending queue
+		uint64_t m_triggers;
+
+		///@brief Triggers which were due but skipped because generation fell behind the requested rate
+		uint64_t m_missedTriggers;
+
+		///@brief Waveforms discarded because the pending queue was full
+		uint64_t m_droppedWaveforms;
+
+		///@brief Average rate at which triggers were generated, in Hz
+		double m_triggerRate;
+
+		///@brief Average time to generate one trigger on all channels, in seconds
+		double m_generationTime;
+
+		///@brief Samples generated per second, over all channels
+		double m_samplesPerSecond;
+	};
+
+	LoadStatistics GetLoadStatistics();
+	void ResetLoadStatistics();
+
+	///@brief Sets the requested trigger rate in Hz, or 0 to trigger as fast as possible
+	void SetTriggerRate(double hz)
+	{ m_triggerRate = hz; }
+
+	///@brief Gets the requested trigger rate in Hz
+	double GetTriggerRate()
+	{ return m_triggerRate; }
+
+	///@brief Largest number of channels (analog plus digital) the generator can be configured with
+	static const size_t MAX_CHANNELS = 64;
+
+protected:
+	void ParseArguments(const std::string& args, size_t& queueDepth);
+	void CreateChannels();
+	void GenerateTrigger(int64_t sampleperiod);
+	void GenerateCounterBit(SparseDigitalWaveform* wfm, size_t bit, int64_t sampleperiod, size_t depth);
+	void UpdateDiagnostics();
+
+	virtual void RecyclePendingWaveform(WaveformBase* w) override;
+
+	///@brief Patterns selectable per analog channel through the ADC mode
+	enum Pattern
+	{
+		///@brief Noisy sine
+		PATTERN_SINE,
+
+		///@brief Noisy sum of two sines
+		PATTERN_SINE_SUM,
+
+		///@brief PRBS-31 through a lossy channel
+		PATTERN_PRBS31,
+
+		///@brief 8B/10B idles through a lossy channel
+		PATTERN_8B10B,
+
+		///@brief Number of patterns
+		PATTERN_COUNT
+	};
+
+	///@brief Connection string the driver was configured with
+	std::string m_args;
+
+	///@brief Number of analog channels
+	size_t m_analogChannelCount;
+
+	///@brief Number of digital channels
+	size_t m_digitalChannelCount;
+
+	///@brief Per-channel on/off state
+	std::vector<bool> m_channelsEnabled;
+
+	///@brief Per-channel coupling
+	std::vector<OscilloscopeChannel::CouplingType> m_channelCoupling;
+
+	///@brief Per-channel probe attenuation
+	std::vector<double> m_channelAttenuation;
+
+	///@brief Per-channel bandwidth limit
+	std::vector<unsigned int> m_channelBandwidth;
+
+	///@brief Per-channel vertical scale range
+	std::vector<float> m_channelVoltageRange;
+
+	///@brief Per-channel offset
+	std::vector<float> m_channelOffset;
+
+	///@brief Pattern generated by each analog channel
+	std::vector<Pattern> m_channelPatterns;
+
+	///@brief True if trigger is armed
+	bool m_triggerArmed;
+
+	///@brief True if most recent trigger arm was a single-shot trigger
+	bool m_triggerOneShot;
+
+	///@brief Memory depth
+	uint64_t m_depth;
+
+	///@brief Sample rate
+	uint64_t m_rate;
+
+	///@brief Requested trigger rate in Hz, or 0 for free running
+	double m_triggerRate;
+
+	///@brief Number of triggers generated per AcquireData() call
+	size_t m_segments;
+
+	///@brief Time the next trigger is due, in the GetTime() timebase (zero if not yet started)
+	double m_nextTrigger;
+
+	///@brief Random number source for seeding the generators
+	std::random_device m_rd;
+
+	///@brief Random number generators for AWGN synthesis, one per analog channel
+	std::vector<std::unique_ptr<std::minstd_rand> > m_rng;
+
+	///@brief Signal sources, one per analog channel so channels can be generated in parallel
+	std::vector<std::unique_ptr<TestWaveformSource> > m_source;
+
+	///@brief Vulkan queue for each analog channel
+	std::vector<std::shared_ptr<QueueHandle> > m_queue;
+
+	///@brief Vulkan command pool for each analog channel
+	std::vector<std::unique_ptr<vk::raii::CommandPool> > m_pool;
+
+	///@brief Vulkan command buffer for each analog channel
+	std::vector<std::unique_ptr<vk::raii::CommandBuffer> > m_cmdBuf;
+
+	///@brief Mutex protecting the statistics below
+	std::mutex m_statsMutex;
+
+	///@brief Triggers generated since the last reset
+	uint64_t m_triggers;
+
+	///@brief Triggers missed since the last reset
+	uint64_t m_missedTriggers;
+
+	///@brief Waveforms dropped since the last reset
+	uint64_t m_droppedWaveforms;
+
+	///@brief Total time spent generating waveforms since the last reset, in seconds
+	double m_generationTime;
+
+	///@brief Total samples generated since the last reset
+	uint64_t m_samplesGenerated;
+
+	///@brief Time of the last statistics reset
+	double m_statsStart;
+
+	///@brief Average trigger rate
+	HzClock m_triggerClock;
+
+	///@brief Requested trigger rate
+	FilterParameter m_diag_requestedWFMHz;
+
+	///@brief Number of WFM/s actually generated
+	FilterParameter m_diag_generatedWFMHz;
+
+	///@brief Number of triggers generated since the last reset
+	FilterParameter m_diag_totalWFMs;
+
+	///@brief Number of triggers missed because generation could not keep up
+	FilterParameter m_diag_missedTriggers;
+
+	///@brief Number of waveforms dropped because the consumer could not keep up
+	FilterParameter m_diag_droppedWFMs;
+
+	///@brief Percentage of requested triggers which were missed or dropped
+	FilterParameter m_diag_lostPercent;
+
+public:
+	static std::string GetDriverNameInternal();
+	OSCILLOSCOPE_INITPROC(LoadGeneratorOscilloscope)
+};
+
+#endif
@@ -1408,51 +1408,11 @@ vector<SparseDigitalWaveform*> MagnovaOscilloscope::ProcessDigitalWaveform(
 		else
 			cap->m_startFemtoseconds = static_cast<int64_t>(basetime * FS_PER_SECOND);
 
-		//Preallocate memory assuming no deduplication possible
-		cap->Resize(numSamples);
-
-		size_t k = 0;
-		size_t sampleIndex = 0;
-		bool sampleValue = false;
-		bool lastSampleValue = false;
-
-
-		// Skip metadata
-		const uint8_t* ptr = data.data() + 32;
-		//Read and de-duplicate the other samples
-		const uint8_t* rawData = ptr;
-		for (size_t curByteIndex = 0; curByteIndex < datalen; curByteIndex++)
-		{
-			char samples = rawData[curByteIndex];
-			for (int ii = 0; ii < 8; ii++, samples >>= 1)
-			{	// Check if the current scope sample bit is set.
-				sampleValue = (samples & 0x1);
-				if((sampleIndex > 0) && (lastSampleValue == sampleValue) && ((sampleIndex + 3) < numSamples))
-				{	//Deduplicate consecutive samples with same value
-					cap->m_durations[k]++;
-				}
-				else
-				{	//Nope, it toggled - store the new value
-					cap->m_offsets[k] = sampleIndex;
-					cap->m_durations[k] = 1;
-					cap->m_samples[k] = sampleValue;
-					lastSampleValue = sampleValue;
-					k++;
-				}
-				sampleIndex++;
-			}
-		}
-
-		//Done, shrink any unused space
-		cap->Resize(k);
-		cap->m_offsets.shrink_to_fit();
-		cap->m_durations.shrink_to_fit();
-		cap->m_samples.shrink_to_fit();
-		cap->MarkSamplesModifiedFromCpu();
-		cap->MarkTimestampsModifiedFromCpu();
+		// Skip metadata, then run length encode the bit packed samples
+		UniformPackedDigitalWaveform::ExtractRuns(data.data() + 32, numSamples, *cap, 3);
 
 		//See how much space we saved
-		//LogDebug("%zu samples deduplicated to %zu (%.1f %%)\n",	numSamples,	k, (k * 100.0f) / (numSamples));
+		//LogDebug("%zu samples deduplicated to %zu (%.1f %%)\n",	numSamples,	cap->size(), (cap->size() * 100.0f) / (numSamples));
 
 		//Done, save data and go on to next
 		ret.push_back(cap);
@@ -1625,18 +1585,16 @@ bool MagnovaOscilloscope::AcquireData()
 	}
 
 	
-	{	//Now that we have all of the pending waveforms, save them in sets across all channels
-		lock_guard<mutex> lock(m_pendingWaveformsMutex);
-		for(size_t i = 0; i < num_sequences; i++)
+	//Now that we have all of the pending waveforms, save them in sets across all channels
+	for(size_t i = 0; i < num_sequences; i++)
+	{
+		SequenceSet s;
+		for(size_t j = 0; j < m_analogAndDigitalChannelCount; j++)
 		{
-			SequenceSet s;
-			for(size_t j = 0; j < m_analogAndDigitalChannelCount; j++)
-			{
-				if(pending_waveforms.find(j) != pending_waveforms.end())
-					s[GetOscilloscopeChannel(j)] = pending_waveforms[j][i];
-			}
-			m_pendingWaveforms.push_back(s);
+			if(pending_waveforms.find(j) != pending_waveforms.end())
+				s[GetOscilloscopeChannel(j)] = pending_waveforms[j][i];
 		}
+		PushPendingWaveform(s);
 	}
 
 	double dt = GetTime() - start;
@@ -0,0 +1,230 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of MappedFile
+	@ingroup core
+ */
+
+#include "scopehal.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+MappedFile::MappedFile()
+	: m_data(nullptr)
+	, m_size(0)
+	, m_pos(0)
+#ifdef _WIN32
+	, m_file(INVALID_HANDLE_VALUE)
+	, m_mapping(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Mapping
+
+/**
+	@brief Maps a file read-only
+
+	@param path	Path to the file
+
+	@return True on success. Empty files cannot be mapped and are reported as a failure.
+ */
+bool MappedFile::Open(const string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	m_file = CreateFileA(
+		path.c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		nullptr);
+	if(m_file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(m_file, &size) || (size.QuadPart == 0))
+	{
+		Close();
+		return false;
+	}
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(!m_mapping)
+	{
+		Close();
+		return false;
+	}
+
+	m_data = reinterpret_cast<uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if(!m_data)
+	{
+		Close();
+		return false;
+	}
+	m_size = size.QuadPart;
+
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	struct stat st;
+	if( (fstat(fd, &st) != 0) || (st.st_size == 0) )
+	{
+		close(fd);
+		return false;
+	}
+
+	void* ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	//The mapping holds its own reference to the file
+	close(fd);
+
+	if(ptr == MAP_FAILED)
+		return false;
+
+	m_data = reinterpret_cast<uint8_t*>(ptr);
+	m_size = st.st_size;
+
+	//We almost always walk the file front to back once
+	madvise(m_data, m_size, MADV_SEQUENTIAL);
+#endif
+
+	m_pos = 0;
+	return true;
+}
+
+/**
+	@brief Unmaps the file, if one is open
+ */
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if(m_data)
+		UnmapViewOfFile(m_data);
+	if(m_mapping)
+		CloseHandle(m_mapping);
+	if(m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+	m_mapping = nullptr;
+	m_file = INVALID_HANDLE_VALUE;
+#else
+	if(m_data)
+		munmap(m_data, m_size);
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+	m_pos = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Access
+
+/**
+	@brief Copies data from the read cursor and advances it, with the same semantics as fread()
+
+	@param buf		Output buffer
+	@param size		Size of one element
+	@param count	Number of elements to read
+
+	@return Number of complete elements read
+ */
+size_t MappedFile::Read(void* buf, size_t size, size_t count)
+{
+	if(size == 0)
+		return 0;
+
+	size_t n = min(count, (m_size - m_pos) / size);
+	memcpy(buf, m_data + m_pos, n * size);
+	m_pos += n * size;
+	return n;
+}
+
+/**
+	@brief Hints that a range of the file will be accessed soon, so the kernel can start reading it in
+ */
+void MappedFile::Prefetch([[maybe_unused]] size_t offset, [[maybe_unused]] size_t len)
+{
+#ifndef _WIN32
+	if( (offset >= m_size) || (len == 0) )
+		return;
+	len = min(len, m_size - offset);
+
+	//madvise needs a page aligned start
+	size_t pagesize = sysconf(_SC_PAGESIZE);
+	size_t start = offset - (offset % pagesize);
+	madvise(m_data + start, len + (offset - start), MADV_WILLNEED);
+#endif
+}
+
+/**
+	@brief Hints that a range of the file has been consumed and its pages can be dropped from our working set
+
+	Only whole pages inside the range are released. This is purely advisory, the data can still be accessed afterwards
+	(it will just be read in from disk again).
+ */
+void MappedFile::Release([[maybe_unused]] size_t offset, [[maybe_unused]] size_t len)
+{
+#ifndef _WIN32
+	if( (offset >= m_size) || (len == 0) )
+		return;
+	len = min(len, m_size - offset);
+
+	size_t pagesize = sysconf(_SC_PAGESIZE);
+	size_t start = (offset + pagesize - 1) / pagesize * pagesize;
+	size_t end = (offset + len) / pagesize * pagesize;
+	if(end > start)
+		madvise(m_data + start, end - start, MADV_DONTNEED);
+#endif
+}
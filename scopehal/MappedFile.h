@@ -0,0 +1,130 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of MappedFile
+	@ingroup core
+ */
+
+#ifndef MappedFile_h
+#define MappedFile_h
+
+/**
+	@brief A read-only memory mapping of an entire file
+
+	Used by import filters to parse headers in place and convert sample data straight out of the page cache,
+	rather than fread()-ing the whole file into a heap buffer first. The mapping is opened with a sequential
+	access hint so the kernel reads ahead aggressively, and Release() lets callers drop pages they have
+	already consumed so multi-GB files don't linger in our resident set.
+
+	Also provides fread()/fseek()-style cursor helpers for walking variable-length headers.
+ */
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	///@brief Returns true if a file is currently mapped
+	bool IsOpen() const
+	{ return m_data != nullptr; }
+
+	///@brief Returns a pointer to the start of the mapped file
+	const uint8_t* GetData() const
+	{ return m_data; }
+
+	///@brief Returns the size of the mapped file, in bytes
+	size_t GetSize() const
+	{ return m_size; }
+
+	/**
+		@brief Returns a pointer to a range of the file, or nullptr if the range is not entirely within the file
+	 */
+	const uint8_t* GetPointer(size_t offset, size_t len) const
+	{
+		if( (offset > m_size) || (len > m_size - offset) )
+			return nullptr;
+		return m_data + offset;
+	}
+
+	size_t Read(void* buf, size_t size, size_t count);
+
+	/**
+		@brief Moves the read cursor to an absolute offset
+
+		@return False if the offset is past the end of the file
+	 */
+	bool Seek(size_t offset)
+	{
+		if(offset > m_size)
+			return false;
+		m_pos = offset;
+		return true;
+	}
+
+	///@brief Advances the read cursor, clamping at the end of the file
+	void Skip(size_t len)
+	{ m_pos = std::min(m_size, m_pos + len); }
+
+	///@brief Returns the current read cursor position
+	size_t Tell() const
+	{ return m_pos; }
+
+	void Prefetch(size_t offset, size_t len);
+	void Release(size_t offset, size_t len);
+
+protected:
+	///@brief Start of the mapping
+	uint8_t* m_data;
+
+	///@brief Size of the mapping
+	size_t m_size;
+
+	///@brief Cursor for Read()
+	size_t m_pos;
+
+#ifdef _WIN32
+	///@brief File handle
+	HANDLE m_file;
+
+	///@brief File mapping handle
+	HANDLE m_mapping;
+#endif
+};
+
+#endif
@@ -0,0 +1,452 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of MinMaxPyramid
+	@ingroup datamodel
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+mutex MinMaxPyramid::m_cacheMutex;
+unique_ptr<MinMaxPyramid::Engine> MinMaxPyramid::m_engine;
+mutex MinMaxPyramid::m_engineMutex;
+
+/**
+	@brief Waveforms smaller than this are reduced on the CPU, since the GPU round trip costs more than it saves
+ */
+static const size_t GPU_REDUCE_THRESHOLD = 1024 * 1024;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// GPU reduction
+
+/**
+	@brief GPU accelerated construction of a pyramid
+
+	Each level is one dispatch of MinMaxPyramid.glsl reading the level below (or the samples, for level 0). With
+	KHR_push_descriptor all levels go out in one submission, otherwise each level is submitted separately since the
+	bindings change every time.
+ */
+class MinMaxPyramid::Engine
+{
+public:
+	Engine();
+
+	void Run(UniformAnalogWaveform* wfm, MinMaxPyramid& pyramid);
+
+protected:
+	std::shared_ptr<QueueHandle> m_queue;
+	std::unique_ptr<vk::raii::CommandPool> m_pool;
+	std::unique_ptr<vk::raii::CommandBuffer> m_cmdBuf;
+
+	std::unique_ptr<ComputePipeline> m_pipeline;
+};
+
+MinMaxPyramid::Engine::Engine()
+{
+	m_queue = g_vkQueueManager->GetComputeQueue("MinMaxPyramid.queue");
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		m_queue->m_family );
+	m_pool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(**m_pool, vk::CommandBufferLevel::ePrimary, 1);
+	m_cmdBuf = make_unique<vk::raii::CommandBuffer>(
+		std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	if(g_hasDebugUtils)
+	{
+		string poolname = "MinMaxPyramid.pool";
+		string bufname = "MinMaxPyramid.cmdbuf";
+
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandPool,
+				reinterpret_cast<uint64_t>(static_cast<VkCommandPool>(**m_pool)),
+				poolname.c_str()));
+
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandBuffer,
+				reinterpret_cast<uint64_t>(static_cast<VkCommandBuffer>(**m_cmdBuf)),
+				bufname.c_str()));
+	}
+
+	m_pipeline = make_unique<ComputePipeline>(
+		"shaders/MinMaxPyramid.spv",
+		2,
+		sizeof(MinMaxPyramidPushConstants));
+}
+
+/**
+	@brief Builds every level of a pyramid whose levels have already been allocated
+
+	@param wfm		Source waveform (must not hold raw ADC codes)
+	@param pyramid	Pyramid to fill
+ */
+void MinMaxPyramid::Engine::Run(UniformAnalogWaveform* wfm, MinMaxPyramid& pyramid)
+{
+	m_cmdBuf->begin({});
+
+	size_t childSpan = 1;
+	for(size_t i=0; i<pyramid.m_levels.size(); i++)
+	{
+		auto& out = *pyramid.m_levels[i];
+
+		MinMaxPyramidPushConstants push;
+		push.outputCount = out.size() / 3;
+		push.childSpan = childSpan;
+		push.totalSamples = pyramid.m_count;
+
+		if(i == 0)
+		{
+			push.inputCount = wfm->m_samples.size();
+			push.inputStride = 1;
+			m_pipeline->BindBufferNonblocking(0, wfm->m_samples, *m_cmdBuf);
+		}
+		else
+		{
+			auto& in = *pyramid.m_levels[i-1];
+			push.inputCount = in.size() / 3;
+			push.inputStride = 3;
+			m_pipeline->BindBufferNonblocking(0, in, *m_cmdBuf);
+		}
+		m_pipeline->BindBufferNonblocking(1, out, *m_cmdBuf, true);
+
+		uint32_t compute_block_count = GetComputeBlockCount(push.outputCount, 64);
+		m_pipeline->Dispatch(*m_cmdBuf, push,
+			min(compute_block_count, 32768u),
+			compute_block_count / 32768 + 1);
+		out.MarkModifiedFromGpu();
+		m_pipeline->AddComputeMemoryBarrier(*m_cmdBuf);
+
+		//Without push descriptors, flush before the bindings change
+		if(!g_hasPushDescriptor && (i+1 < pyramid.m_levels.size()))
+		{
+			m_cmdBuf->end();
+			m_queue->SubmitAndBlock(*m_cmdBuf);
+			m_cmdBuf->begin({});
+		}
+
+		childSpan *= DECIMATION;
+	}
+
+	//Queries run on the CPU, so pull everything back while we're here
+	for(auto& level : pyramid.m_levels)
+		level->PrepareForCpuAccessNonblocking(*m_cmdBuf);
+
+	m_cmdBuf->end();
+	m_queue->SubmitAndBlock(*m_cmdBuf);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+MinMaxPyramid::MinMaxPyramid()
+	: m_count(0)
+{
+}
+
+/**
+	@brief Frees the shared GPU engine
+
+	Must be called before the Vulkan device is destroyed.
+ */
+void MinMaxPyramid::DestroyEngine()
+{
+	lock_guard<mutex> lock(m_engineMutex);
+	m_engine = nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction of the pyramid
+
+/**
+	@brief Gets the pyramid for a waveform, building it if the cached copy is missing or stale
+
+	@param wfm	The source waveform
+
+	@return The pyramid (with no levels if the waveform is empty)
+ */
+shared_ptr<MinMaxPyramid> MinMaxPyramid::Get(UniformAnalogWaveform* wfm)
+{
+	uint64_t rev = wfm->m_revision;
+	{
+		lock_guard<mutex> lock(m_cacheMutex);
+		if(wfm->m_cachedPyramid && (wfm->m_cachedPyramidRevision == rev))
+			return wfm->m_cachedPyramid;
+	}
+
+	//Same locking strategy as DigitalEdgeList::Get()
+	auto pyramid = make_shared<MinMaxPyramid>();
+	pyramid->Compute(wfm);
+
+	lock_guard<mutex> lock(m_cacheMutex);
+	wfm->m_cachedPyramid = pyramid;
+	wfm->m_cachedPyramidRevision = rev;
+	return pyramid;
+}
+
+/**
+	@brief Allocates m_levels for a waveform of m_count samples, stopping at the first level with a single entry
+ */
+void MinMaxPyramid::AllocateLevels()
+{
+	m_levels.clear();
+
+	size_t n = m_count;
+	while(n > 1)
+	{
+		n = (n + DECIMATION - 1) / DECIMATION;
+
+		auto level = make_unique< AcceleratorBuffer<float> >();
+		level->SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+		level->SetGpuAccessHint(AcceleratorBuffer<float>::HINT_UNLIKELY);
+		level->SetName(string("MinMaxPyramid.m_levels[") + to_string(m_levels.size()) + "]");
+		level->resize(n * 3);
+		m_levels.push_back(std::move(level));
+	}
+}
+
+/**
+	@brief Fills this object from a waveform
+ */
+void MinMaxPyramid::Compute(UniformAnalogWaveform* wfm)
+{
+	m_count = wfm->size();
+	AllocateLevels();
+	if(m_levels.empty())
+		return;
+
+	//Raw ADC codes are read in place on the CPU rather than expanding them just to build the pyramid.
+	//The shader indexes samples with 32 bit integers, so really huge waveforms also stay on the CPU.
+	if( (m_count >= GPU_REDUCE_THRESHOLD) && (m_count < 0x80000000) && !wfm->HasRawSamples() )
+	{
+		lock_guard<mutex> lock(m_engineMutex);
+		if(!m_engine)
+			m_engine = make_unique<Engine>();
+		m_engine->Run(wfm, *this);
+	}
+	else
+		ComputeOnCpu(wfm);
+}
+
+/**
+	@brief Builds level 0 from the samples, then each following level from the one below it
+ */
+void MinMaxPyramid::ComputeOnCpu(UniformAnalogWaveform* wfm)
+{
+	//Level 0
+	auto& out0 = *m_levels[0];
+	size_t nout0 = out0.size() / 3;
+	auto raw = wfm->m_rawSamples.get();
+	float* p = nullptr;
+	if(!raw)
+	{
+		wfm->m_samples.PrepareForCpuAccess();
+		p = wfm->m_samples.GetCpuPointer();
+	}
+
+	#pragma omp parallel for
+	for(size_t j=0; j<nout0; j++)
+	{
+		size_t istart = j * DECIMATION;
+		size_t iend = min(istart + DECIMATION, m_count);
+
+		float vmin = FLT_MAX;
+		float vmax = -FLT_MAX;
+		float sum = 0;
+		for(size_t i=istart; i<iend; i++)
+		{
+			float f = raw ? raw->GetSample(i) : p[i];
+			vmin = min(vmin, f);
+			vmax = max(vmax, f);
+			sum += f;
+		}
+
+		out0[j*3] = vmin;
+		out0[j*3 + 1] = vmax;
+		out0[j*3 + 2] = sum / (iend - istart);
+	}
+	out0.MarkModifiedFromCpu();
+
+	//Higher levels, weighting each child's mean by the number of samples it covers
+	size_t childSpan = DECIMATION;
+	for(size_t l=1; l<m_levels.size(); l++)
+	{
+		auto& in = *m_levels[l-1];
+		auto& out = *m_levels[l];
+		size_t nin = in.size() / 3;
+		size_t nout = out.size() / 3;
+
+		for(size_t j=0; j<nout; j++)
+		{
+			size_t istart = j * DECIMATION;
+			size_t iend = min(istart + DECIMATION, nin);
+
+			float vmin = FLT_MAX;
+			float vmax = -FLT_MAX;
+			double sum = 0;
+			size_t count = 0;
+			for(size_t i=istart; i<iend; i++)
+			{
+				size_t n = min(childSpan, m_count - i*childSpan);
+				vmin = min(vmin, in[i*3]);
+				vmax = max(vmax, in[i*3 + 1]);
+				sum += in[i*3 + 2] * n;
+				count += n;
+			}
+
+			out[j*3] = vmin;
+			out[j*3 + 1] = vmax;
+			out[j*3 + 2] = sum / count;
+		}
+		out.MarkModifiedFromCpu();
+
+		childSpan *= DECIMATION;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+/**
+	@brief Gets the min, max, and mean sample value over a range of samples
+
+	Only the partial blocks at either end of the range are visited at each level, so this is O(log n) in the length
+	of the range.
+
+	@param wfm		The waveform this pyramid was built from
+	@param first	Index of the first sample in the range
+	@param last		One past the index of the last sample in the range (clamped to the end of the waveform)
+	@param vmin		Lowest sample value (FLT_MAX if the range is empty)
+	@param vmax		Highest sample value (-FLT_MAX if the range is empty)
+	@param vmean	Average sample value (zero if the range is empty)
+ */
+void MinMaxPyramid::Query(
+	UniformAnalogWaveform* wfm,
+	size_t first,
+	size_t last,
+	float& vmin,
+	float& vmax,
+	float& vmean)
+{
+	vmin = FLT_MAX;
+	vmax = -FLT_MAX;
+	vmean = 0;
+
+	last = min(last, m_count);
+	if(first >= last)
+		return;
+
+	double sum = 0;
+
+	//Samples at the start and end of the range, not covered by a whole level 0 entry
+	auto raw = wfm->m_rawSamples.get();
+	float* p = nullptr;
+	if(!raw)
+	{
+		wfm->m_samples.PrepareForCpuAccess();
+		p = wfm->m_samples.GetCpuPointer();
+	}
+
+	auto addSamples = [&](size_t istart, size_t iend)
+	{
+		for(size_t i=istart; i<iend; i++)
+		{
+			float f = raw ? raw->GetSample(i) : p[i];
+			vmin = min(vmin, f);
+			vmax = max(vmax, f);
+			sum += f;
+		}
+	};
+
+	//Range [a, b) in units of entries of the current level
+	size_t a = first;
+	size_t b = last;
+	size_t nentries = m_count;
+	size_t span = 1;
+	for(size_t l=0; ; l++)
+	{
+		auto addEntries = [&](size_t jstart, size_t jend)
+		{
+			if(l == 0)
+			{
+				addSamples(jstart, jend);
+				return;
+			}
+
+			auto& level = *m_levels[l-1];
+			level.PrepareForCpuAccess();
+			for(size_t j=jstart; j<jend; j++)
+			{
+				size_t n = min(span, m_count - j*span);
+				vmin = min(vmin, level[j*3]);
+				vmax = max(vmax, level[j*3 + 1]);
+				sum += level[j*3 + 2] * n;
+			}
+		};
+
+		//Ranges which don't span two whole blocks of the next level (or have no next level) are finished here
+		if( (l >= m_levels.size()) || ( (b - a) < 2*DECIMATION ) )
+		{
+			addEntries(a, b);
+			break;
+		}
+
+		//Visit the partial blocks at each end, then move up to the whole blocks in between.
+		//The last entry of each level may be short, so a range ending at the end of the waveform stays there.
+		size_t na = (a + DECIMATION - 1) / DECIMATION;
+		size_t nb = (b == nentries) ? ( (nentries + DECIMATION - 1) / DECIMATION ) : (b / DECIMATION);
+		addEntries(a, na * DECIMATION);
+		addEntries(min(nb * DECIMATION, b), b);
+
+		a = na;
+		b = nb;
+		nentries = (nentries + DECIMATION - 1) / DECIMATION;
+		span *= DECIMATION;
+	}
+
+	vmean = sum / (last - first);
+}
+
+/**
+	@brief Returns the number of bytes used by all levels
+ */
+size_t MinMaxPyramid::GetMemoryUsage() const
+{
+	size_t ret = 0;
+	for(auto& level : m_levels)
+		ret += level->size() * sizeof(float);
+	return ret;
+}
@@ -0,0 +1,112 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of MinMaxPyramid
+	@ingroup datamodel
+ */
+
+#ifndef MinMaxPyramid_h
+#define MinMaxPyramid_h
+
+struct __attribute__((packed)) MinMaxPyramidPushConstants
+{
+	uint32_t inputCount;
+	uint32_t outputCount;
+	uint32_t inputStride;
+	uint32_t childSpan;
+	uint32_t totalSamples;
+};
+
+/**
+	@brief Multi-resolution min/max/mean summary of a uniform analog waveform
+	@ingroup datamodel
+
+	Level 0 holds the min, max, and mean of each block of DECIMATION samples, level 1 of each block of DECIMATION
+	level 0 entries, and so on up to a single entry covering the whole waveform. This costs about 5% of the size of
+	the sample data, and lets Query() find the min, max, and mean of any range of samples in O(log n) time: only
+	the partial blocks at either end of the range are visited at each level.
+
+	Pyramids are built by Get() and cached on the source waveform until its revision changes. Large waveforms are
+	reduced on the GPU, small ones (and waveforms still holding raw ADC codes) on the CPU.
+ */
+class MinMaxPyramid
+{
+public:
+	MinMaxPyramid();
+
+	static std::shared_ptr<MinMaxPyramid> Get(UniformAnalogWaveform* wfm);
+	static void DestroyEngine();
+
+	///@brief Number of entries of the level below (or samples) summarized by each entry
+	static const size_t DECIMATION = 64;
+
+	void Query(UniformAnalogWaveform* wfm, size_t first, size_t last, float& vmin, float& vmax, float& vmean);
+
+	///@brief Returns the number of samples in the source waveform
+	size_t size() const
+	{ return m_count; }
+
+	///@brief Returns the number of levels
+	size_t GetLevelCount() const
+	{ return m_levels.size(); }
+
+	size_t GetMemoryUsage() const;
+
+	/**
+		@brief Entries of each level, as interleaved (min, max, mean) triplets
+
+		Entry j of level i covers samples [j * DECIMATION^(i+1), (j+1) * DECIMATION^(i+1)), clamped to the end of
+		the waveform.
+	 */
+	std::vector< std::unique_ptr< AcceleratorBuffer<float> > > m_levels;
+
+protected:
+	void Compute(UniformAnalogWaveform* wfm);
+	void ComputeOnCpu(UniformAnalogWaveform* wfm);
+	void AllocateLevels();
+
+	///@brief Number of samples in the source waveform
+	size_t m_count;
+
+	class Engine;
+
+	///@brief Mutex protecting the pyramid cache fields of every WaveformBase
+	static std::mutex m_cacheMutex;
+
+	///@brief Shared GPU reduction engine, created on first use
+	static std::unique_ptr<Engine> m_engine;
+
+	///@brief Mutex protecting m_engine
+	static std::mutex m_engineMutex;
+};
+
+#endif
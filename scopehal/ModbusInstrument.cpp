@@ -60,6 +60,11 @@ void ModbusInstrument::Converse(ModbusFunction function, std::vector<uint8_t>* d
 
 uint16_t ModbusInstrument::ReadRegister(uint16_t address)
 {
+	lock_guard<recursive_mutex> lock(m_modbusMutex);
+	auto it = m_registerSnapshot.find(address);
+	if(it != m_registerSnapshot.end())
+		return it->second;
+
 	std::vector<uint8_t> data;
 	// Adress to read
 	PushUint16(&data,address,false);
@@ -77,6 +82,9 @@ uint16_t ModbusInstrument::ReadRegister(uint16_t address)
 
 uint16_t ModbusInstrument::WriteRegister(uint16_t address, uint16_t value)
 {
+	lock_guard<recursive_mutex> lock(m_modbusMutex);
+	m_registerSnapshot.erase(address);
+
 	std::vector<uint8_t> data;
 	// Adress to write
 	PushUint16(&data,address,false);
@@ -117,6 +125,64 @@ uint8_t ModbusInstrument::ReadRegisters(uint16_t address, std::vector<uint16_t>*
 	return count;
 }
 
+/**
+	@brief Reads a set of registers with as few requests as possible and serves subsequent ReadRegister() calls from it
+
+	Addresses are sorted and merged into contiguous blocks (reading through short runs of unused registers), so e.g.
+	a power supply's voltage/current set points and readbacks come back in a single Read Holding Registers request
+	rather than one round trip each. The snapshot stays valid until ClearRegisterSnapshot() is called; writing a
+	register drops it from the snapshot so the next read goes to the device.
+
+	Callers should hold m_modbusMutex across the snapshot/read/clear sequence.
+
+	@param addresses	Registers to read
+ */
+void ModbusInstrument::ReadRegisterSnapshot(const vector<uint16_t>& addresses)
+{
+	lock_guard<recursive_mutex> lock(m_modbusMutex);
+	if(addresses.empty())
+		return;
+
+	vector<uint16_t> sorted = addresses;
+	sort(sorted.begin(), sorted.end());
+
+	size_t i = 0;
+	while(i < sorted.size())
+	{
+		//Grow the block as long as the next address is close enough and the request stays within limits
+		uint16_t first = sorted[i];
+		uint16_t last = first;
+		size_t j = i + 1;
+		for(; j < sorted.size(); j++)
+		{
+			if(sorted[j] - last > m_maxSnapshotGap + 1)
+				break;
+			if(sorted[j] - first + 1 > m_maxRegistersPerRead)
+				break;
+			last = sorted[j];
+		}
+
+		vector<uint16_t> values;
+		uint8_t count = last - first + 1;
+		if(ReadRegisters(first, &values, count) == count)
+		{
+			for(size_t k = i; k < j; k++)
+				m_registerSnapshot[sorted[k]] = values[sorted[k] - first];
+		}
+
+		i = j;
+	}
+}
+
+/**
+	@brief Discards the register snapshot so that subsequent reads go to the device
+ */
+void ModbusInstrument::ClearRegisterSnapshot()
+{
+	lock_guard<recursive_mutex> lock(m_modbusMutex);
+	m_registerSnapshot.clear();
+}
+
 void ModbusInstrument::SendCommand(ModbusFunction function, const std::vector<uint8_t> &data)
 {
 	// Modbus query frame format is:
@@ -148,6 +214,18 @@ void ModbusInstrument::ReadResponse(ModbusFunction function, std::vector<uint8_t
 		LogError("Could not read Modbus slave adress and function response.\n");
 		return;
 	}
+	if(buffer[1] == (function | 0x80))
+	{
+		// Exception response: | 1 byte slave adress | 1 byte function # | 0x80 | 1 byte exception code | 2 bytes CRC |
+		buffer.resize(3);
+		if(m_transport->ReadRawData(3,buffer.begin().base()))
+			LogError("Modbus exception %d for function %d.\n",buffer[0],function);
+		else
+			LogError("Could not read Modbus exception response.\n");
+		if(data)
+			data->clear();
+		return;
+	}
 	if(buffer[1]!=function)
 	{
 		LogWarning("Wrong Modbus response function #: %d, expected %d.\n",buffer[1],function);
@@ -169,7 +247,7 @@ void ModbusInstrument::ReadResponse(ModbusFunction function, std::vector<uint8_t
 		dataLength = 4;
 	}
 	// Read data and CRC
-	buffer.reserve(dataLength+2);
+	buffer.resize(dataLength+2);
 	if(!m_transport->ReadRawData(dataLength+2,buffer.begin().base()))
 	{
 		LogError("Could not read Modbus data and CRC response.\n");
@@ -50,6 +50,9 @@ public:
 	virtual uint16_t WriteRegister(uint16_t address, uint16_t value);
 	virtual uint8_t ReadRegisters(uint16_t address, std::vector<uint16_t>* data, uint8_t count);
 
+	void ReadRegisterSnapshot(const std::vector<uint16_t>& addresses);
+	void ClearRegisterSnapshot();
+
 protected:
 	enum ModbusFunction : uint8_t
 	{
@@ -74,6 +77,20 @@ protected:
 	// Make sure several request don't collide before we received the corresponding response
 	std::recursive_mutex m_modbusMutex;
 
+	///@brief Register values captured by ReadRegisterSnapshot(), served by ReadRegister() until cleared
+	std::map<uint16_t, uint16_t> m_registerSnapshot;
+
+	/**
+		@brief Largest run of unused registers we'll read through to merge two snapshot blocks into one request
+
+		Each extra transaction costs an 8 byte request, a 5 byte response header/CRC and two 3.5 character inter-frame
+		gaps, so reading a couple of unwanted 2-byte registers is cheaper than another round trip.
+	 */
+	static const uint16_t m_maxSnapshotGap = 8;
+
+	///@brief Maximum number of registers in a single Read Holding Registers request
+	static const uint16_t m_maxRegistersPerRead = 125;
+
 	uint8_t m_slaveAdress;
 	void Converse(ModbusFunction function, std::vector<uint8_t>* data);
 	void SendCommand(ModbusFunction function, const std::vector<uint8_t> &data);
@@ -639,17 +639,73 @@ bool MultiLaneBERT::GetRxCdrLockState(size_t i)
 
 void MultiLaneBERT::MeasureHBathtub(size_t i)
 {
-	auto reply = m_transport->SendCommandQueuedWithReply(m_channels[i]->GetHwname() + ":HBATHTUB?");
+	ProcessHBathtub(i, m_transport->SendCommandQueuedWithReply(m_channels[i]->GetHwname() + ":HBATHTUB?"));
+}
 
-	//Parse the reply
-	auto data = explode(reply, ',');
-	vector<float> values;
-	float tmp;
-	for(auto num : data)
+/**
+	@brief Runs bathtub scans on several channels, parsing each result while the next scan is in progress
+ */
+void MultiLaneBERT::MeasureHBathtubs(const vector<size_t>& chans)
+{
+	vector<string> queries;
+	for(auto i : chans)
+		queries.push_back(m_channels[i]->GetHwname() + ":HBATHTUB?");
+
+	m_transport->SendQueriesPipelined(
+		queries,
+		[&] (size_t j, const string& reply) { ProcessHBathtub(chans[j], reply); });
+}
+
+/**
+	@brief Runs eye scans on several channels, parsing each result while the next scan is in progress
+ */
+void MultiLaneBERT::MeasureEyes(const vector<size_t>& chans)
+{
+	vector<string> queries;
+	for(auto i : chans)
+		queries.push_back(m_channels[i]->GetHwname() + ":EYE?");
+
+	m_transport->SendQueriesPipelined(
+		queries,
+		[&] (size_t j, const string& reply) { ProcessEye(chans[j], reply); });
+}
+
+/**
+	@brief Parses a comma separated list of numbers
+
+	Eye scans return 32K values, so this avoids creating a temporary string for each one.
+ */
+void MultiLaneBERT::ParseFloatList(const string& reply, vector<float>& values)
+{
+	values.clear();
+
+	const char* p = reply.c_str();
+	while(*p)
 	{
-		sscanf(num.c_str(), "%f", &tmp);
-		values.push_back(tmp);
+		char* end;
+		float f = strtof(p, &end);
+		if(end == p)
+			f = 0;
+		values.push_back(f);
+
+		//Skip to the next field
+		p = strchr(end, ',');
+		if(!p)
+			break;
+		p++;
 	}
+}
+
+/**
+	@brief Converts a bathtub scan result to a waveform
+
+	@param i		Channel index
+	@param reply	Reply to the HBATHTUB? query
+ */
+void MultiLaneBERT::ProcessHBathtub(size_t i, const string& reply)
+{
+	vector<float> values;
+	ParseFloatList(reply, values);
 
 	if(values.size() < 256)
 	{
@@ -733,20 +789,24 @@ void MultiLaneBERT::MeasureHBathtub(size_t i)
 
 void MultiLaneBERT::MeasureEye(size_t i)
 {
-	auto reply = m_transport->SendCommandQueuedWithReply(m_channels[i]->GetHwname() + ":EYE?");
+	ProcessEye(i, m_transport->SendCommandQueuedWithReply(m_channels[i]->GetHwname() + ":EYE?"));
+}
+
+/**
+	@brief Converts an eye scan result to a waveform
+
+	@param i		Channel index
+	@param reply	Reply to the EYE? query
+ */
+void MultiLaneBERT::ProcessEye(size_t i, const string& reply)
+{
 	auto chan = dynamic_cast<BERTInputChannel*>(GetChannel(i));
 	if(!chan)
 		return;
 
-	//Parse the reply
-	auto data = explode(reply, ',');
 	vector<float> values;
-	float tmp;
-	for(auto num : data)
-	{
-		sscanf(num.c_str(), "%f", &tmp);
-		values.push_back(tmp);
-	}
+	values.reserve(32770);
+	ParseFloatList(reply, values);
 
 	if(values.size() < 32770)	//expect 32k plus x and y spacing
 	{
@@ -808,15 +868,17 @@ void MultiLaneBERT::MeasureEye(size_t i)
 
 bool MultiLaneBERT::AcquireData()
 {
-	//Poll CDR lock status
+	//Poll CDR lock status and read BER for each channel, all in one batch
+	vector<string> queries;
 	for(int i=0; i<4; i++)
-	{
-		auto reply = m_transport->SendCommandQueuedWithReply(m_channels[i + m_rxChannelBase]->GetHwname() + ":LOCK?");
-		m_rxLock[i] = (reply == "1");
-	}
+		queries.push_back(m_channels[i + m_rxChannelBase]->GetHwname() + ":LOCK?");
+	queries.push_back("BER?");
+	auto replies = m_transport->SendQueriesPipelined(queries);
+
+	for(int i=0; i<4; i++)
+		m_rxLock[i] = (replies[i] == "1");
 
-	//Read BER for each channel
-	auto sber = m_transport->SendCommandQueuedWithReply("BER?");
+	auto& sber = replies[4];
 	float bers[4];
 	sscanf(sber.c_str(), "%f,%f,%f,%f", &bers[0], &bers[1], &bers[2], &bers[3]);
 
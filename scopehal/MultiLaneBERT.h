@@ -95,6 +95,8 @@ public:
 	virtual bool GetRxCdrLockState(size_t i) override;
 	virtual void MeasureHBathtub(size_t i) override;
 	virtual void MeasureEye(size_t i) override;
+	virtual void MeasureHBathtubs(const std::vector<size_t>& chans) override;
+	virtual void MeasureEyes(const std::vector<size_t>& chans) override;
 	virtual void SetBERIntegrationLength(int64_t uis) override;
 	virtual int64_t GetBERIntegrationLength() override;
 	virtual void SetBERSamplingPoint(size_t i, int64_t dx, float dy) override;
@@ -118,6 +120,9 @@ public:
 	virtual bool GetUseExternalRefclk() override;
 
 protected:
+	void ProcessHBathtub(size_t i, const std::string& reply);
+	void ProcessEye(size_t i, const std::string& reply);
+	static void ParseFloatList(const std::string& reply, std::vector<float>& values);
 
 	///@brief Index of the first receive channel
 	int m_rxChannelBase;
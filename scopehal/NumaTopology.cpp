@@ -0,0 +1,255 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of NumaTopology
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "NumaTopology.h"
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Reads the CPU list of each NUMA node from sysfs
+ */
+NumaTopology::NumaTopology()
+{
+	#ifdef __linux__
+	for(size_t node=0; ; node++)
+	{
+		string path = string("/sys/devices/system/node/node") + to_string(node) + "/cpulist";
+		FILE* fp = fopen(path.c_str(), "r");
+		if(!fp)
+			break;
+
+		//Comma separated list of CPU numbers and ranges, e.g. "0-15,32-47"
+		vector<int> cpus;
+		int first;
+		while(fscanf(fp, "%d", &first) == 1)
+		{
+			int last = first;
+			int c = fgetc(fp);
+			if(c == '-')
+			{
+				if(fscanf(fp, "%d", &last) != 1)
+					break;
+				c = fgetc(fp);
+			}
+			for(int cpu=first; cpu<=last; cpu++)
+				cpus.push_back(cpu);
+			if(c != ',')
+				break;
+		}
+		fclose(fp);
+
+		//Memory-only nodes (no CPUs) can't run anything, skip them
+		if(cpus.empty())
+			continue;
+
+		for(auto cpu : cpus)
+		{
+			if(m_cpuNodes.size() <= static_cast<size_t>(cpu))
+				m_cpuNodes.resize(cpu + 1, -1);
+			m_cpuNodes[cpu] = m_nodeCpus.size();
+		}
+		m_nodeCpus.push_back(cpus);
+	}
+
+	//Nothing to be gained from placement on a single node system
+	if(m_nodeCpus.size() < 2)
+	{
+		m_nodeCpus.clear();
+		m_cpuNodes.clear();
+	}
+	else
+		LogTrace("NUMA topology: %zu nodes\n", m_nodeCpus.size());
+	#endif
+}
+
+/**
+	@brief Gets the topology, reading it the first time it's needed
+ */
+NumaTopology& NumaTopology::Get()
+{
+	static NumaTopology topo;
+	return topo;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Queries
+
+/**
+	@brief Gets the number of NUMA nodes with CPUs (1 if the host isn't NUMA, or we can't tell)
+ */
+size_t NumaTopology::GetNodeCount()
+{
+	auto& topo = Get();
+	return topo.m_nodeCpus.empty() ? 1 : topo.m_nodeCpus.size();
+}
+
+/**
+	@brief Gets the CPU numbers belonging to a node (empty if the host isn't NUMA)
+ */
+const vector<int>& NumaTopology::GetNodeCpus(size_t node)
+{
+	static const vector<int> empty;
+
+	auto& topo = Get();
+	if(node >= topo.m_nodeCpus.size())
+		return empty;
+	return topo.m_nodeCpus[node];
+}
+
+/**
+	@brief Gets the node of the CPU the calling thread is currently running on, or -1 if unknown
+ */
+int NumaTopology::GetCurrentNode()
+{
+	#ifdef __linux__
+	auto& topo = Get();
+	if(topo.m_cpuNodes.empty())
+		return -1;
+
+	int cpu = sched_getcpu();
+	if( (cpu < 0) || (static_cast<size_t>(cpu) >= topo.m_cpuNodes.size()) )
+		return -1;
+	return topo.m_cpuNodes[cpu];
+	#else
+	return -1;
+	#endif
+}
+
+/**
+	@brief Gets the node holding the page which contains an address, or -1 if unknown
+
+	This is a system call, so don't use it in inner loops.
+ */
+int NumaTopology::GetNodeOfAddress(const void* ptr)
+{
+	#ifdef __linux__
+	if( (ptr == nullptr) || !IsNuma())
+		return -1;
+
+	int node = -1;
+	if(0 != syscall(SYS_get_mempolicy, &node, nullptr, 0, ptr, MPOL_F_NODE | MPOL_F_ADDR))
+		return -1;
+	return node;
+	#else
+	(void)ptr;
+	return -1;
+	#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Placement
+
+/**
+	@brief Confines the calling thread to the CPUs of one node
+
+	@return True if the thread was pinned, false on single node hosts or on failure
+ */
+bool NumaTopology::PinCurrentThread(int node)
+{
+	#ifdef __linux__
+	auto& cpus = GetNodeCpus(node);
+	if(cpus.empty())
+		return false;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for(auto cpu : cpus)
+		CPU_SET(cpu, &set);
+	return (0 == pthread_setaffinity_np(pthread_self(), sizeof(set), &set));
+	#else
+	(void)node;
+	return false;
+	#endif
+}
+
+/**
+	@brief Asks the kernel to place a range of memory on one node
+
+	This is a preference rather than a hard binding: if the node runs out of memory, pages spill to other nodes
+	instead of failing. Pages already touched are migrated. Only whole pages inside the range are affected, so the
+	partial pages at either end of a small heap block keep whatever placement they had.
+
+	@param ptr	Start of the range
+	@param len	Length of the range, in bytes
+	@param node	Node to place the memory on
+
+	@return True if the policy was applied, false on single node hosts, for ranges smaller than a page, or on failure
+ */
+bool NumaTopology::BindMemory(void* ptr, size_t len, int node)
+{
+	#ifdef __linux__
+	if( (ptr == nullptr) || (node < 0) || (static_cast<size_t>(node) >= Get().m_nodeCpus.size()) )
+		return false;
+
+	//Round inwards to page boundaries
+	static const uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+	uintptr_t start = (reinterpret_cast<uintptr_t>(ptr) + pageSize - 1) & ~(pageSize - 1);
+	uintptr_t end = (reinterpret_cast<uintptr_t>(ptr) + len) & ~(pageSize - 1);
+	if(end <= start)
+		return false;
+
+	//Node mask, one bit per node. The kernel ignores the last bit of maxnode so pass one extra.
+	const size_t bitsPerWord = sizeof(unsigned long) * 8;
+	vector<unsigned long> mask(node / bitsPerWord + 1, 0);
+	mask[node / bitsPerWord] = 1UL << (node % bitsPerWord);
+	unsigned long maxnode = mask.size() * bitsPerWord + 1;
+
+	return (0 == syscall(
+		SYS_mbind,
+		reinterpret_cast<void*>(start),
+		end - start,
+		MPOL_PREFERRED,
+		mask.data(),
+		maxnode,
+		MPOL_MF_MOVE));
+	#else
+	(void)ptr;
+	(void)len;
+	(void)node;
+	return false;
+	#endif
+}
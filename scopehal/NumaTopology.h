@@ -0,0 +1,84 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of NumaTopology
+	@ingroup core
+ */
+
+#ifndef NumaTopology_h
+#define NumaTopology_h
+
+#include <cstddef>
+#include <vector>
+
+/**
+	@brief Static helpers for finding and using the NUMA layout of the host
+	@ingroup core
+
+	On dual socket workstations, a waveform buffer which is allocated (or first touched) by a thread on one socket
+	and then processed by a filter running on the other has every cache miss cross the inter-socket link. These
+	helpers let the thread pools pin their workers to a node, let AcceleratorBuffer place its pages on a chosen
+	node, and let the FilterGraphExecutor find out where a filter's inputs live.
+
+	The topology is read from sysfs once, on first use. Only Linux is supported; everywhere else, and on single node
+	systems, the host is reported as a single node and the binding calls do nothing.
+ */
+class NumaTopology
+{
+public:
+	static size_t GetNodeCount();
+	static const std::vector<int>& GetNodeCpus(size_t node);
+
+	/**
+		@brief Returns true if the host has more than one NUMA node, so placement matters
+	 */
+	static bool IsNuma()
+	{ return GetNodeCount() > 1; }
+
+	static int GetCurrentNode();
+	static int GetNodeOfAddress(const void* ptr);
+
+	static bool PinCurrentThread(int node);
+	static bool BindMemory(void* ptr, size_t len, int node);
+
+protected:
+	NumaTopology();
+
+	static NumaTopology& Get();
+
+	///@brief CPU numbers of each NUMA node (empty if there's only one node, or we can't tell)
+	std::vector< std::vector<int> > m_nodeCpus;
+
+	///@brief NUMA node of each CPU number, or -1 if unknown
+	std::vector<int> m_cpuNodes;
+};
+
+#endif
@@ -41,7 +41,6 @@
 #ifdef __x86_64__
 #include <immintrin.h>
 #endif
-#include <omp.h>
 
 #include "EdgeTrigger.h"
 
@@ -53,6 +52,12 @@ Oscilloscope::CreateMapType Oscilloscope::m_createprocs;
 // Construction / destruction
 
 Oscilloscope::Oscilloscope()
+	: m_pendingWaveforms(make_unique< BoundedMPMCQueue<SequenceSet> >(DEFAULT_PENDING_DEPTH))
+	, m_hasPeekedWaveform(false)
+	, m_pendingWaveformPolicy(PENDING_DROP_OLDEST)
+	, m_pendingWaveformDepth(DEFAULT_PENDING_DEPTH)
+	, m_triggerWaitCancelled(false)
+	, m_triggerPeriodEstimate(-1)
 {
 	m_trigger = NULL;
 
@@ -70,12 +75,13 @@ Oscilloscope::~Oscilloscope()
 		m_trigger = NULL;
 	}
 
-	for(auto set : m_pendingWaveforms)
+	//Can't call RecyclePendingWaveform() here since the derived class is already gone, so just delete them
+	SequenceSet set;
+	while(PopPendingSet(set))
 	{
 		for(auto it : set)
 			delete it.second;
 	}
-	m_pendingWaveforms.clear();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -141,19 +147,85 @@ bool Oscilloscope::WaitForTrigger(int timeout)
 	return false;
 }
 
+/**
+	@brief Updates the trigger rate estimate used for the adaptive poll interval
+
+	Acquisition loops should call this with the result of every PollTrigger() call.
+ */
+void Oscilloscope::OnTriggerPolled(TriggerMode mode)
+{
+	if(mode != TRIGGER_MODE_TRIGGERED)
+		return;
+
+	auto now = chrono::steady_clock::now();
+
+	lock_guard<mutex> lock(m_triggerEventMutex);
+	if(m_lastTriggerTime != chrono::steady_clock::time_point())
+	{
+		double dt = chrono::duration<double>(now - m_lastTriggerTime).count();
+		if(m_triggerPeriodEstimate < 0)
+			m_triggerPeriodEstimate = dt;
+		else
+			m_triggerPeriodEstimate = 0.75*m_triggerPeriodEstimate + 0.25*dt;
+	}
+	m_lastTriggerTime = now;
+}
+
+/**
+	@brief Gets the current adaptive poll interval
+
+	This is an eighth of the typical time between triggers, so on average a trigger is picked up within a few percent
+	of a trigger period. If the instrument has gone quiet for longer than usual (stopped, or waiting on a rare event)
+	the interval backs off accordingly, up to MAX_TRIGGER_POLL_INTERVAL.
+ */
+chrono::microseconds Oscilloscope::GetTriggerPollInterval()
+{
+	lock_guard<mutex> lock(m_triggerEventMutex);
+
+	//No history yet, use a middle of the road interval
+	if(m_triggerPeriodEstimate < 0)
+		return chrono::microseconds(1000);
+
+	double period = m_triggerPeriodEstimate;
+	double idle = chrono::duration<double>(chrono::steady_clock::now() - m_lastTriggerTime).count();
+	if(idle > 2*period)
+		period = idle;
+
+	auto interval = chrono::microseconds(static_cast<int64_t>(period * 1e6 / 8));
+	return max(MIN_TRIGGER_POLL_INTERVAL, min(MAX_TRIGGER_POLL_INTERVAL, interval));
+}
+
+bool Oscilloscope::WaitForTriggerEvent(chrono::microseconds timeout)
+{
+	auto interval = min(timeout, GetTriggerPollInterval());
+
+	unique_lock<mutex> lock(m_triggerEventMutex);
+	m_triggerEventCond.wait_for(lock, interval, [this]{ return m_triggerWaitCancelled; });
+	m_triggerWaitCancelled = false;
+	return false;
+}
+
+/**
+	@brief Wakes up a thread blocked in the default WaitForTriggerEvent(), e.g. when shutting down
+ */
+void Oscilloscope::CancelTriggerWait()
+{
+	lock_guard<mutex> lock(m_triggerEventMutex);
+	m_triggerWaitCancelled = true;
+	m_triggerEventCond.notify_all();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Sequenced capture
 
 size_t Oscilloscope::GetPendingWaveformCount()
 {
-	lock_guard<mutex> lock(m_pendingWaveformsMutex);
-	return m_pendingWaveforms.size();
+	return m_pendingWaveforms->size() + (m_hasPeekedWaveform ? 1 : 0);
 }
 
 bool Oscilloscope::HasPendingWaveforms()
 {
-	lock_guard<mutex> lock(m_pendingWaveformsMutex);
-	return (m_pendingWaveforms.size() != 0);
+	return m_hasPeekedWaveform || (m_pendingWaveforms->size() != 0);
 }
 
 /**
@@ -161,13 +233,11 @@ bool Oscilloscope::HasPendingWaveforms()
  */
 void Oscilloscope::ClearPendingWaveforms()
 {
-	lock_guard<mutex> lock(m_pendingWaveformsMutex);
-	while(!m_pendingWaveforms.empty())
+	SequenceSet set;
+	while(PopPendingSet(set))
 	{
-		SequenceSet set = *m_pendingWaveforms.begin();
 		for(auto it : set)
-			delete it.second;
-		m_pendingWaveforms.pop_front();
+			RecyclePendingWaveform(it.second);
 	}
 }
 
@@ -176,24 +246,167 @@ void Oscilloscope::ClearPendingWaveforms()
  */
 bool Oscilloscope::PopPendingWaveform()
 {
-	lock_guard<mutex> lock(m_pendingWaveformsMutex);
-	if(m_pendingWaveforms.size())
+	SCOPEHAL_TRACE_SPAN("Oscilloscope::PopPendingWaveform", "acquisition");
+
+	SequenceSet set;
+	if(!PopPendingSet(set))
+		return false;
+
+	for(auto it : set)
+		it.first.m_channel->SetData(it.second, it.first.m_stream);
+	return true;
+}
+
+/**
+	@brief Removes the oldest pending waveform from the queue, without doing anything with it
+
+	@return False if there are no pending waveforms
+ */
+bool Oscilloscope::PopPendingSet(SequenceSet& set)
+{
+	//If we've already peeked at the oldest waveform, it's not in the queue any more
+	if(m_hasPeekedWaveform)
+	{
+		lock_guard<mutex> lock(m_peekedWaveformMutex);
+		if(m_hasPeekedWaveform)
+		{
+			set = m_peekedWaveform;
+			m_hasPeekedWaveform = false;
+			return true;
+		}
+	}
+
+	return m_pendingWaveforms->Pop(set);
+}
+
+/**
+	@brief Gets the trigger timestamp of the oldest pending waveform, without popping it
+
+	@param sec	Integer part of the timestamp
+	@param fs	Fractional part, in femtoseconds
+
+	@return False if there are no pending waveforms
+ */
+bool Oscilloscope::GetPendingWaveformTimestamp(time_t& sec, int64_t& fs)
+{
+	lock_guard<mutex> lock(m_peekedWaveformMutex);
+	if(!m_hasPeekedWaveform)
+	{
+		if(!m_pendingWaveforms->Pop(m_peekedWaveform))
+			return false;
+		m_hasPeekedWaveform = true;
+	}
+
+	//All waveforms in a set come from the same trigger, so any of them will do
+	if(m_peekedWaveform.empty())
+		return false;
+
+	auto w = m_peekedWaveform.begin()->second;
+	sec = w->m_startTimestamp;
+	fs = w->m_startFemtoseconds;
+	return true;
+}
+
+/**
+	@brief Discards the oldest pending waveform without processing it
+ */
+void Oscilloscope::DropPendingWaveform()
+{
+	SequenceSet set;
+	if(PopPendingSet(set))
 	{
-		SequenceSet set = *m_pendingWaveforms.begin();
 		for(auto it : set)
-			it.first.m_channel->SetData(it.second, it.first.m_stream);
-		m_pendingWaveforms.pop_front();
-		return true;
+			RecyclePendingWaveform(it.second);
 	}
-	return false;
 }
 
 /**
-	@brief Checks if we are appending to the existing waveform or creating a new one
+	@brief Adds a newly acquired set of waveforms to the pending queue, applying the overflow policy if it's full
+
+	Called by drivers from the acquisition thread. Only one thread may push at a time, but this never waits on
+	consumers (unless the policy is PENDING_BLOCK and the queue is full).
+
+	@param set	The waveforms to push
+
+	@return Number of sets discarded to make room (or the new set itself, under PENDING_DROP_NEWEST)
+ */
+size_t Oscilloscope::PushPendingWaveform(const SequenceSet& set)
+{
+	size_t dropped = 0;
+	switch(m_pendingWaveformPolicy)
+	{
+		case PENDING_BLOCK:
+			while( (GetPendingWaveformCount() >= m_pendingWaveformDepth) || !m_pendingWaveforms->Push(set) )
+				this_thread::sleep_for(chrono::microseconds(50));
+			break;
+
+		case PENDING_DROP_NEWEST:
+			if( (GetPendingWaveformCount() >= m_pendingWaveformDepth) || !m_pendingWaveforms->Push(set) )
+			{
+				for(auto it : set)
+					RecyclePendingWaveform(it.second);
+				dropped = 1;
+			}
+			break;
+
+		case PENDING_DROP_OLDEST:
+		default:
+			while(true)
+			{
+				if( (GetPendingWaveformCount() < m_pendingWaveformDepth) && m_pendingWaveforms->Push(set) )
+					break;
+
+				//Leave the peeked waveform alone, the consumer is about to use it
+				SequenceSet old;
+				if(m_pendingWaveforms->Pop(old))
+				{
+					for(auto it : old)
+						RecyclePendingWaveform(it.second);
+					dropped ++;
+				}
+				else if(m_pendingWaveforms->Push(set))
+					break;
+			}
+			break;
+	}
+
+	if(dropped)
+		LogTrace("Dropped %zu waveforms due to excessive pend queue depth\n", dropped);
+	return dropped;
+}
+
+/**
+	@brief Frees a waveform which was discarded from the pending queue
+
+	The default implementation deletes it. Drivers which allocate waveforms from a pool should override this to
+	return them to the pool.
  */
-bool Oscilloscope::IsAppendingToWaveform()
+void Oscilloscope::RecyclePendingWaveform(WaveformBase* w)
 {
-	return false;
+	delete w;
+}
+
+/**
+	@brief Selects what happens when waveforms are acquired faster than the client consumes them
+
+	The queue is grown if necessary, which is not thread safe: call this before starting acquisition.
+
+	@param policy	Overflow policy
+	@param depth	Maximum number of pending waveforms
+ */
+void Oscilloscope::SetPendingWaveformPolicy(PendingWaveformPolicy policy, size_t depth)
+{
+	m_pendingWaveformPolicy = policy;
+	m_pendingWaveformDepth = max(depth, (size_t)1);
+
+	if(m_pendingWaveforms->capacity() < m_pendingWaveformDepth)
+	{
+		auto q = make_unique< BoundedMPMCQueue<SequenceSet> >(m_pendingWaveformDepth);
+		SequenceSet set;
+		while(m_pendingWaveforms->Pop(set))
+			q->Push(set);
+		m_pendingWaveforms = std::move(q);
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -967,58 +1180,36 @@ bool Oscilloscope::HasTimebaseControls()
  */
 void Oscilloscope::Convert8BitSamples(float* pout, const int8_t* pin, float gain, float offset, size_t count)
 {
+	SCOPEHAL_TRACE_SPAN("Oscilloscope::Convert8BitSamples", "conversion");
+
 	//Divide large waveforms (>1M points) into blocks and multithread them
 	//TODO: tune split
 	if(count > 1000000)
 	{
 		//Round blocks to multiples of 32 samples for clean vectorization
-		size_t numblocks = omp_get_max_threads();
+		size_t numblocks = ThreadPool::Get().GetThreadCount() + 1;
 		size_t lastblock = numblocks - 1;
 		size_t blocksize = count / numblocks;
 		blocksize = blocksize - (blocksize % 32);
 
-		#pragma omp parallel for
-		for(size_t i=0; i<numblocks; i++)
+		ParallelFor(0, numblocks, 1, [&](size_t first, size_t last)
 		{
-			//Last block gets any extra that didn't divide evenly
-			size_t nsamp = blocksize;
-			if(i == lastblock)
-				nsamp = count - i*blocksize;
-
-			size_t off = i*blocksize;
-			#ifdef __x86_64__
-			if(g_hasAvx2)
-			{
-				Convert8BitSamplesAVX2(
-					pout + off,
-					pin + off,
-					gain,
-					offset,
-					nsamp);
-			}
-			else
-			#endif /* __x86_64__ */
+			for(size_t i=first; i<last; i++)
 			{
-				Convert8BitSamplesGeneric(
-					pout + off,
-					pin + off,
-					gain,
-					offset,
-					nsamp);
+				//Last block gets any extra that didn't divide evenly
+				size_t nsamp = blocksize;
+				if(i == lastblock)
+					nsamp = count - i*blocksize;
+
+				size_t off = i*blocksize;
+				g_simdKernels.convert8BitSamples(pout + off, pin + off, gain, offset, nsamp);
 			}
-		}
+		});
 	}
 
 	//Small waveforms get done single threaded to avoid overhead
 	else
-	{
-		#ifdef __x86_64__
-		if(g_hasAvx2)
-			Convert8BitSamplesAVX2(pout, pin, gain, offset, count);
-		else
-		#endif
-			Convert8BitSamplesGeneric(pout, pin, gain, offset, count);
-	}
+		g_simdKernels.convert8BitSamples(pout, pin, gain, offset, count);
 }
 
 /**
@@ -1099,58 +1290,36 @@ void Oscilloscope::Convert8BitSamplesAVX2(float* pout, const int8_t* pin, float
  */
 void Oscilloscope::ConvertUnsigned8BitSamples(float* pout, const uint8_t* pin, float gain, float offset, size_t count)
 {
+	SCOPEHAL_TRACE_SPAN("Oscilloscope::ConvertUnsigned8BitSamples", "conversion");
+
 	//Divide large waveforms (>1M points) into blocks and multithread them
 	//TODO: tune split
 	if(count > 1000000)
 	{
 		//Round blocks to multiples of 32 samples for clean vectorization
-		size_t numblocks = omp_get_max_threads();
+		size_t numblocks = ThreadPool::Get().GetThreadCount() + 1;
 		size_t lastblock = numblocks - 1;
 		size_t blocksize = count / numblocks;
 		blocksize = blocksize - (blocksize % 32);
 
-		#pragma omp parallel for
-		for(size_t i=0; i<numblocks; i++)
+		ParallelFor(0, numblocks, 1, [&](size_t first, size_t last)
 		{
-			//Last block gets any extra that didn't divide evenly
-			size_t nsamp = blocksize;
-			if(i == lastblock)
-				nsamp = count - i*blocksize;
-
-			size_t off = i*blocksize;
-			#ifdef __x86_64__
-			if(g_hasAvx2)
+			for(size_t i=first; i<last; i++)
 			{
-				ConvertUnsigned8BitSamplesAVX2(
-					pout + off,
-					pin + off,
-					gain,
-					offset,
-					nsamp);
-			}
-			else
-			#endif
-			{
-				ConvertUnsigned8BitSamplesGeneric(
-					pout + off,
-					pin + off,
-					gain,
-					offset,
-					nsamp);
+				//Last block gets any extra that didn't divide evenly
+				size_t nsamp = blocksize;
+				if(i == lastblock)
+					nsamp = count - i*blocksize;
+
+				size_t off = i*blocksize;
+				g_simdKernels.convertUnsigned8BitSamples(pout + off, pin + off, gain, offset, nsamp);
 			}
-		}
+		});
 	}
 
 	//Small waveforms get done single threaded to avoid overhead
 	else
-	{
-		#ifdef __x86_64__
-		if(g_hasAvx2)
-			ConvertUnsigned8BitSamplesAVX2(pout, pin, gain, offset, count);
-		else
-		#endif
-			ConvertUnsigned8BitSamplesGeneric(pout, pin, gain, offset, count);
-	}
+		g_simdKernels.convertUnsigned8BitSamples(pout, pin, gain, offset, count);
 }
 
 /**
@@ -1234,84 +1403,36 @@ void Oscilloscope::ConvertUnsigned8BitSamplesAVX2(float* pout, const uint8_t* pi
  */
 void Oscilloscope::Convert16BitSamples(float* pout, const int16_t* pin, float gain, float offset, size_t count)
 {
+	SCOPEHAL_TRACE_SPAN("Oscilloscope::Convert16BitSamples", "conversion");
+
 	//Divide large waveforms (>1M points) into blocks and multithread them
 	//TODO: tune split
 	if(count > 1000000)
 	{
 		//Round blocks to multiples of 64 samples for clean vectorization
-		size_t numblocks = omp_get_max_threads();
+		size_t numblocks = ThreadPool::Get().GetThreadCount() + 1;
 		size_t lastblock = numblocks - 1;
 		size_t blocksize = count / numblocks;
 		blocksize = blocksize - (blocksize % 64);
 
-		#pragma omp parallel for
-		for(size_t i=0; i<numblocks; i++)
+		ParallelFor(0, numblocks, 1, [&](size_t first, size_t last)
 		{
-			//Last block gets any extra that didn't divide evenly
-			size_t nsamp = blocksize;
-			if(i == lastblock)
-				nsamp = count - i*blocksize;
-
-			size_t off = i*blocksize;
-			#ifdef __x86_64__
-			if(g_hasAvx512F)
+			for(size_t i=first; i<last; i++)
 			{
-				Convert16BitSamplesAVX512F(
-					pout + off,
-					pin + off,
-					gain,
-					offset,
-					nsamp);
-			}
-			else if(g_hasAvx2)
-			{
-				if(g_hasFMA)
-				{
-					Convert16BitSamplesFMA(
-						pout + off,
-						pin + off,
-						gain,
-						offset,
-						nsamp);
-				}
-				else
-				{
-					Convert16BitSamplesAVX2(
-						pout + off,
-						pin + off,
-						gain,
-						offset,
-						nsamp);
-				}
-			}
-			else
-			#endif /* __x86_64__ */
-			{
-				Convert16BitSamplesGeneric(
-					pout + off,
-					pin + off,
-					gain,
-					offset,
-					nsamp);
+				//Last block gets any extra that didn't divide evenly
+				size_t nsamp = blocksize;
+				if(i == lastblock)
+					nsamp = count - i*blocksize;
+
+				size_t off = i*blocksize;
+				g_simdKernels.convert16BitSamplesBlocked(pout + off, pin + off, gain, offset, nsamp);
 			}
-		}
+		});
 	}
 
 	//Small waveforms get done single threaded to avoid overhead
 	else
-	{
-		#ifdef __x86_64__
-		if(g_hasAvx2)
-		{
-			if(g_hasFMA)
-				Convert16BitSamplesFMA(pout, pin, gain, offset, count);
-			else
-				Convert16BitSamplesAVX2(pout, pin, gain, offset, count);
-		}
-		else
-		#endif /* __x86_64__ */
-			Convert16BitSamplesGeneric(pout, pin, gain, offset, count);
-	}
+		g_simdKernels.convert16BitSamples(pout, pin, gain, offset, count);
 }
 
 /**
@@ -40,6 +40,9 @@ class Instrument;
 
 #include "SCPITransport.h"
 #include "WaveformPool.h"
+#include "FlatSequenceSet.h"
+
+#include <condition_variable>
 
 /**
 	@brief Generic representation of an oscilloscope, logic analyzer, or spectrum analyzer.
@@ -443,6 +446,34 @@ public:
 	 */
 	bool WaitForTrigger(int timeout);
 
+	/**
+		@brief Blocks until PollTrigger() is worth calling again, or a timeout elapses
+
+		Acquisition threads call this between unsuccessful PollTrigger() calls instead of sleeping for a fixed time.
+
+		Drivers which are told when data is ready (for example a bridge server pushing waveforms over a data socket)
+		should override this to block on that notification, so a trigger is picked up as soon as it arrives.
+
+		The default implementation sleeps for an adaptive poll interval derived from the observed trigger rate (see
+		OnTriggerPolled()): a fraction of the typical time between triggers, so fast-triggering instruments are
+		polled often and idle ones aren't hammered with status queries.
+
+		@param timeout	Maximum time to block
+
+		@return True if woken by a notification, false on timeout or if the poll interval elapsed
+	 */
+	virtual bool WaitForTriggerEvent(std::chrono::microseconds timeout);
+
+	void OnTriggerPolled(TriggerMode mode);
+	void CancelTriggerWait();
+	std::chrono::microseconds GetTriggerPollInterval();
+
+	///@brief Shortest adaptive poll interval
+	static constexpr std::chrono::microseconds MIN_TRIGGER_POLL_INTERVAL{100};
+
+	///@brief Longest adaptive poll interval
+	static constexpr std::chrono::microseconds MAX_TRIGGER_POLL_INTERVAL{20000};
+
 	/**
 		@brief Sets a new trigger on the instrument and pushes changes.
 
@@ -891,13 +922,87 @@ public:
 	size_t GetPendingWaveformCount();
 	virtual bool PopPendingWaveform();
 	virtual bool IsAppendingToWaveform();
+	bool GetPendingWaveformTimestamp(time_t& sec, int64_t& fs);
+	void DropPendingWaveform();
+
+	/**
+		@brief What to do when a new waveform is acquired and the pending waveform queue is already full
+	 */
+	enum PendingWaveformPolicy
+	{
+		///Discard the oldest pending waveform to make room
+		PENDING_DROP_OLDEST,
+
+		///Discard the newly acquired waveform
+		PENDING_DROP_NEWEST,
+
+		///Stall the acquisition thread until the consumer pops a waveform
+		PENDING_BLOCK
+	};
+
+	void SetPendingWaveformPolicy(PendingWaveformPolicy policy, size_t depth = DEFAULT_PENDING_DEPTH);
+
+	///@brief Gets the overflow policy for the pending waveform queue
+	PendingWaveformPolicy GetPendingWaveformPolicy()
+	{ return m_pendingWaveformPolicy; }
+
+	///@brief Gets the maximum number of waveforms which may be pending at once
+	size_t GetPendingWaveformDepth()
+	{ return m_pendingWaveformDepth; }
+
+	///@brief Default maximum number of pending waveforms (enough for most segmented captures)
+	static constexpr size_t DEFAULT_PENDING_DEPTH = 16384;
 
 protected:
-	typedef std::map<StreamDescriptor, WaveformBase*> SequenceSet;
-	std::list<SequenceSet> m_pendingWaveforms;
-	std::mutex m_pendingWaveformsMutex;
+	typedef FlatSequenceSet SequenceSet;
+
+	size_t PushPendingWaveform(const SequenceSet& set);
+	bool PopPendingSet(SequenceSet& set);
+	virtual void RecyclePendingWaveform(WaveformBase* w);
+
+	///@brief Waveforms which have been acquired but not yet popped. Lock-free, so producers never block consumers.
+	std::unique_ptr< BoundedMPMCQueue<SequenceSet> > m_pendingWaveforms;
+
+	/**
+		@brief A waveform popped from m_pendingWaveforms by GetPendingWaveformTimestamp(), but not yet consumed
+
+		Once the consumer has looked at a waveform, it's moved out of the queue so a producer dropping old waveforms
+		can't free it out from under us. Only consumers touch this, so the lock never blocks acquisition.
+	 */
+	SequenceSet m_peekedWaveform;
+
+	///@brief True if m_peekedWaveform is valid
+	std::atomic<bool> m_hasPeekedWaveform;
+
+	///@brief Mutex protecting m_peekedWaveform against concurrent consumers
+	std::mutex m_peekedWaveformMutex;
+
+	///@brief Overflow policy for m_pendingWaveforms
+	PendingWaveformPolicy m_pendingWaveformPolicy;
+
+	///@brief Maximum number of waveforms allowed in m_pendingWaveforms
+	size_t m_pendingWaveformDepth;
+
 	std::recursive_mutex m_mutex;
 
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Trigger event tracking
+protected:
+	///@brief Mutex protecting the trigger rate estimate and m_triggerWaitCancelled
+	std::mutex m_triggerEventMutex;
+
+	///@brief Signaled by CancelTriggerWait() to wake a thread sleeping in WaitForTriggerEvent()
+	std::condition_variable m_triggerEventCond;
+
+	///@brief Set by CancelTriggerWait(), cleared when a waiting thread wakes up
+	bool m_triggerWaitCancelled;
+
+	///@brief Time PollTrigger() last reported a trigger
+	std::chrono::steady_clock::time_point m_lastTriggerTime;
+
+	///@brief Moving average of the time between triggers, in seconds (negative if no triggers seen yet)
+	double m_triggerPeriodEstimate;
+
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Diagnostics Access
 protected:
@@ -939,38 +1044,42 @@ protected:
 
 	WaveformPool m_digitalWaveformPool;
 
-	UniformAnalogWaveform* AllocateAnalogWaveform(const std::string& name)
+	/**
+		@brief Gets an analog waveform from the pool, or allocates a new one if there's nothing suitable
+
+		@param name		Name of the waveform
+		@param depth	Expected number of samples, if known. A pooled waveform is only reused if it can hold this
+						many samples without reallocating.
+	 */
+	UniformAnalogWaveform* AllocateAnalogWaveform(const std::string& name, size_t depth = 0)
 	{
-		auto p = m_analogWaveformPool.Get();
-		auto ret = dynamic_cast<UniformAnalogWaveform*>(p);
+		auto ret = m_analogWaveformPool.Get<UniformAnalogWaveform>(depth);
 		if(ret)
 		{
 			ret->Rename(name);
 			return ret;
 		}
 
-		//Delete garbage if somebody pushed the wrong type of waveform
-		if(p)
-			delete p;
-
 		//Pool was empty, allocate a new waveform
 		return new UniformAnalogWaveform(name);
 	}
 
-	SparseDigitalWaveform* AllocateDigitalWaveform(const std::string& name)
+	/**
+		@brief Gets a digital waveform from the pool, or allocates a new one if there's nothing suitable
+
+		@param name		Name of the waveform
+		@param depth	Expected number of samples, if known. A pooled waveform is only reused if it can hold this
+						many samples without reallocating.
+	 */
+	SparseDigitalWaveform* AllocateDigitalWaveform(const std::string& name, size_t depth = 0)
 	{
-		auto p = m_digitalWaveformPool.Get();
-		auto ret = dynamic_cast<SparseDigitalWaveform*>(p);
+		auto ret = m_digitalWaveformPool.Get<SparseDigitalWaveform>(depth);
 		if(ret)
 		{
 			ret->Rename(name);
 			return ret;
 		}
 
-		//Delete garbage if somebody pushed the wrong type of waveform
-		if(p)
-			delete p;
-
 		//Pool was empty, allocate a new waveform
 		return new SparseDigitalWaveform(name);
 	}
@@ -983,7 +1092,11 @@ public:
 		@return True if memory was freed, false if pools were already empty
 	 */
 	bool FreeWaveformPools()
-	{ return m_analogWaveformPool.clear() || m_digitalWaveformPool.clear();	}
+	{
+		bool analogFreed = m_analogWaveformPool.clear();
+		bool digitalFreed = m_digitalWaveformPool.clear();
+		return analogFreed || digitalFreed;
+	}
 
 	void AddWaveformToAnalogPool(WaveformBase* w)
 	{ m_analogWaveformPool.Add(w); }
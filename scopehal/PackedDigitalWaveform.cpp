@@ -0,0 +1,396 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of UniformPackedDigitalWaveform
+	@ingroup datamodel
+ */
+
+#include "scopehal.h"
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Edge search
+
+/**
+	@brief Finds the first sample at or after i with a given value
+
+	Whole words which cannot contain a match are skipped without looking at individual bits.
+
+	@return Index of the sample, or size() if none was found
+ */
+size_t UniformPackedDigitalWaveform::FindNextSampleWithValue(size_t i, bool value) const
+{
+	if(i >= m_size)
+		return m_size;
+
+	size_t nwords = GetWordCount(m_size);
+	size_t iword = i / SAMPLES_PER_WORD;
+
+	//Invert so we're always looking for a 1 bit, and ignore bits before the starting point
+	uint64_t invert = value ? 0 : ~0ULL;
+	uint64_t w = (m_words[iword] ^ invert) & (~0ULL << (i % SAMPLES_PER_WORD));
+	while(w == 0)
+	{
+		iword ++;
+		if(iword >= nwords)
+			return m_size;
+		w = m_words[iword] ^ invert;
+	}
+
+	return min(m_size, iword*SAMPLES_PER_WORD + __builtin_ctzll(w));
+}
+
+/**
+	@brief Finds all toggles in the waveform
+
+	A toggle at index j means sample j has a different value than sample j-1.
+
+	@param indexes	Sample indexes of the selected edges are appended here
+	@param rising	Report rising (0 to 1) edges
+	@param falling	Report falling (1 to 0) edges
+ */
+void UniformPackedDigitalWaveform::FindEdges(vector<int64_t>& indexes, bool rising, bool falling) const
+{
+	if(m_size < 2)
+		return;
+
+	size_t nwords = GetWordCount(m_size);
+	uint64_t carry = m_words[0] & 1;
+	for(size_t iword=0; iword<nwords; iword++)
+	{
+		uint64_t w = m_words[iword];
+
+		//Bit k of toggles is set if sample k differs from sample k-1 (carrying across word boundaries)
+		uint64_t toggles = w ^ ((w << 1) | carry);
+		carry = w >> 63;
+
+		//Mask off undefined bits past the end
+		size_t base = iword * SAMPLES_PER_WORD;
+		if(m_size - base < SAMPLES_PER_WORD)
+			toggles &= (1ULL << (m_size - base)) - 1;
+
+		if(!rising)
+			toggles &= ~w;
+		if(!falling)
+			toggles &= w;
+
+		while(toggles)
+		{
+			indexes.push_back(base + __builtin_ctzll(toggles));
+			toggles &= toggles - 1;
+		}
+	}
+}
+
+/**
+	@brief Counts the number of toggles in the waveform
+ */
+size_t UniformPackedDigitalWaveform::CountEdges() const
+{
+	if(m_size < 2)
+		return 0;
+
+	size_t count = 0;
+	size_t nwords = GetWordCount(m_size);
+	uint64_t carry = m_words[0] & 1;
+	for(size_t iword=0; iword<nwords; iword++)
+	{
+		uint64_t w = m_words[iword];
+		uint64_t toggles = w ^ ((w << 1) | carry);
+		carry = w >> 63;
+
+		size_t base = iword * SAMPLES_PER_WORD;
+		if(m_size - base < SAMPLES_PER_WORD)
+			toggles &= (1ULL << (m_size - base)) - 1;
+
+		count += __builtin_popcountll(toggles);
+	}
+	return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Conversion
+
+/**
+	@brief Packs an unpacked digital waveform into this one, copying timebase metadata
+
+	@param wfm	The waveform to pack
+ */
+void UniformPackedDigitalWaveform::Pack(const UniformDigitalWaveform& wfm)
+{
+	m_timescale			= wfm.m_timescale;
+	m_startTimestamp	= wfm.m_startTimestamp;
+	m_startFemtoseconds	= wfm.m_startFemtoseconds;
+	m_triggerPhase		= wfm.m_triggerPhase;
+
+	size_t len = wfm.m_samples.size();
+	Resize(len);
+	PrepareForCpuAccess();
+	if(len == 0)
+		return;
+
+	PackBits(&wfm.m_samples[0], m_words.GetCpuPointer(), len);
+	MarkModifiedFromCpu();
+}
+
+/**
+	@brief Packs an array of bools (or any bytes, nonzero meaning true) into words, using the fastest available method
+
+	@param in	Input samples
+	@param out	Output words, must have room for GetWordCount(len) words
+	@param len	Number of samples
+ */
+void UniformPackedDigitalWaveform::PackBits(const bool* in, uint64_t* out, size_t len)
+{
+	#ifdef __x86_64__
+	if(g_hasAvx2)
+		PackAVX2(in, out, len);
+	else
+	#endif
+		PackGeneric(in, out, len);
+}
+
+/**
+	@brief Run length encodes bit packed samples into a sparse digital waveform
+
+	Works a word at a time: toggles are found with a shift and XOR and visited with ctz, so the cost scales with the
+	number of edges rather than the number of samples. The input is split into chunks which are counted, then
+	written, in parallel. Only the sample data is written, the caller is responsible for timestamps and timebase.
+
+	@param packed		Samples, LSB first (sample i is bit i%8 of byte i/8). This is the same layout as m_words,
+						so an array of words may be passed. Need not be aligned.
+	@param len			Number of samples
+	@param wfm			Output waveform
+	@param unmergedTail	Number of samples at the end which are always given a run of their own, even if they have
+						the same value as the previous sample. Drivers traditionally did this to work around a
+						rendering problem.
+ */
+void UniformPackedDigitalWaveform::ExtractRuns(
+	const uint8_t* packed,
+	size_t len,
+	SparseDigitalWaveform& wfm,
+	size_t unmergedTail)
+{
+	wfm.PrepareForCpuAccess();
+	if(len == 0)
+	{
+		wfm.Resize(0);
+		wfm.MarkModifiedFromCpu();
+		return;
+	}
+
+	//Samples in [1, mergeEnd) extend the previous run if they have the same value, all others start a new one
+	size_t mergeEnd = (len > unmergedTail) ? (len - unmergedTail) : 0;
+	size_t forcedStart = max<size_t>(mergeEnd, 1);
+
+	//Unaligned word load, zero filled past the end of the input
+	size_t nbytes = (len + 7) / 8;
+	auto load = [&](size_t iword)
+	{
+		uint64_t w = 0;
+		size_t off = iword * sizeof(uint64_t);
+		memcpy(&w, packed + off, min(sizeof(uint64_t), nbytes - off));
+		return w;
+	};
+
+	//Toggles within one word: bit k is set if sample k differs from sample k-1
+	auto toggles = [&](size_t iword, uint64_t w)
+	{
+		uint64_t carry = iword ? (load(iword - 1) >> 63) : (w & 1);
+		uint64_t t = w ^ ((w << 1) | carry);
+
+		size_t base = iword * SAMPLES_PER_WORD;
+		if(mergeEnd - base < SAMPLES_PER_WORD)
+			t &= (1ULL << (mergeEnd - base)) - 1;
+		return t;
+	};
+
+	//Count edges in each chunk
+	const size_t chunkWords = 16384;
+	size_t nwords = GetWordCount(mergeEnd);
+	size_t nchunks = (nwords + chunkWords - 1) / chunkWords;
+	vector<size_t> chunkStarts(nchunks + 1, 0);
+	ParallelFor(0, nchunks, 1, [&](size_t first, size_t last)
+	{
+		for(size_t c=first; c<last; c++)
+		{
+			size_t count = 0;
+			size_t end = min(nwords, (c+1) * chunkWords);
+			for(size_t iword = c*chunkWords; iword < end; iword++)
+				count += __builtin_popcountll(toggles(iword, load(iword)));
+			chunkStarts[c+1] = count;
+		}
+	});
+	for(size_t c=0; c<nchunks; c++)
+		chunkStarts[c+1] += chunkStarts[c];
+
+	//One run for the first sample, one per edge, one per forced sample at the end
+	size_t nedges = chunkStarts[nchunks];
+	size_t nruns = 1 + nedges + (len - forcedStart);
+	wfm.Resize(nruns);
+	auto offsets = wfm.m_offsets.GetCpuPointer();
+	auto durations = wfm.m_durations.GetCpuPointer();
+	auto samples = wfm.m_samples.GetCpuPointer();
+
+	offsets[0] = 0;
+	samples[0] = load(0) & 1;
+
+	ParallelFor(0, nchunks, 1, [&](size_t first, size_t last)
+	{
+		for(size_t c=first; c<last; c++)
+		{
+			size_t k = 1 + chunkStarts[c];
+			size_t end = min(nwords, (c+1) * chunkWords);
+			for(size_t iword = c*chunkWords; iword < end; iword++)
+			{
+				uint64_t w = load(iword);
+				uint64_t t = toggles(iword, w);
+				size_t base = iword * SAMPLES_PER_WORD;
+				while(t)
+				{
+					size_t bit = __builtin_ctzll(t);
+					offsets[k] = base + bit;
+					samples[k] = (w >> bit) & 1;
+					k++;
+					t &= t - 1;
+				}
+			}
+		}
+	});
+
+	for(size_t i=forcedStart, k=1+nedges; i<len; i++, k++)
+	{
+		offsets[k] = i;
+		samples[k] = (packed[i / 8] >> (i % 8)) & 1;
+	}
+
+	//Each run lasts until the next one starts
+	for(size_t k=0; k+1<nruns; k++)
+		durations[k] = offsets[k+1] - offsets[k];
+	durations[nruns-1] = len - offsets[nruns-1];
+
+	wfm.MarkModifiedFromCpu();
+}
+
+/**
+	@brief Packs an array of bools into words
+ */
+void UniformPackedDigitalWaveform::PackGeneric(const bool* in, uint64_t* out, size_t len)
+{
+	size_t nwords = GetWordCount(len);
+
+	#pragma omp parallel for
+	for(size_t iword=0; iword<nwords; iword++)
+	{
+		size_t base = iword * SAMPLES_PER_WORD;
+		size_t end = min(len, base + SAMPLES_PER_WORD);
+
+		uint64_t w = 0;
+		for(size_t i=base; i<end; i++)
+		{
+			if(in[i])
+				w |= 1ULL << (i - base);
+		}
+		out[iword] = w;
+	}
+}
+
+#ifdef __x86_64__
+/**
+	@brief AVX2 optimized version of PackGeneric()
+ */
+__attribute__((target("avx2")))
+void UniformPackedDigitalWaveform::PackAVX2(const bool* in, uint64_t* out, size_t len)
+{
+	size_t nfull = len / SAMPLES_PER_WORD;
+	auto pin = reinterpret_cast<const uint8_t*>(in);
+	__m256i zero = _mm256_setzero_si256();
+
+	#pragma omp parallel for
+	for(size_t iword=0; iword<nfull; iword++)
+	{
+		auto p = pin + iword*SAMPLES_PER_WORD;
+
+		//Anything nonzero is true; movemask collects the inverted "equals zero" flags 32 at a time
+		__m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+		uint32_t wlo = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, zero)));
+		uint32_t whi = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, zero)));
+
+		out[iword] = (static_cast<uint64_t>(whi) << 32) | wlo;
+	}
+
+	//Last partial word
+	if(len % SAMPLES_PER_WORD)
+	{
+		size_t base = nfull * SAMPLES_PER_WORD;
+		PackGeneric(in + base, out + nfull, len - base);
+	}
+}
+#endif /* __x86_64__ */
+
+/**
+	@brief Unpacks this waveform into a byte-per-sample digital waveform, copying timebase metadata
+
+	@param wfm	The waveform to write to
+ */
+void UniformPackedDigitalWaveform::Unpack(UniformDigitalWaveform& wfm) const
+{
+	wfm.m_timescale			= m_timescale;
+	wfm.m_startTimestamp	= m_startTimestamp;
+	wfm.m_startFemtoseconds	= m_startFemtoseconds;
+	wfm.m_triggerPhase		= m_triggerPhase;
+
+	wfm.Resize(m_size);
+	wfm.PrepareForCpuAccess();
+
+	size_t nwords = GetWordCount(m_size);
+	auto out = wfm.m_samples.GetCpuPointer();
+
+	#pragma omp parallel for
+	for(size_t iword=0; iword<nwords; iword++)
+	{
+		uint64_t w = m_words[iword];
+		size_t base = iword * SAMPLES_PER_WORD;
+		size_t end = min(m_size, base + SAMPLES_PER_WORD);
+		for(size_t i=base; i<end; i++)
+			out[i] = (w >> (i - base)) & 1;
+	}
+
+	wfm.MarkModifiedFromCpu();
+}
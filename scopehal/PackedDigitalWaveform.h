@@ -0,0 +1,256 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of UniformPackedDigitalWaveform
+	@ingroup datamodel
+ */
+
+#ifndef PackedDigitalWaveform_h
+#define PackedDigitalWaveform_h
+
+/**
+	@brief A digital waveform sampled at uniform intervals, stored one bit per sample
+	@ingroup datamodel
+
+	UniformDigitalWaveform spends a full byte on every sample. This class packs 64 samples into each word of m_words,
+	LSB first (sample i is bit i%64 of word i/64), for an 8x reduction in memory footprint and bandwidth. Since the
+	words are little endian, shaders may view the same buffer as an array of 32-bit words with the same bit order;
+	see PackedDigital.glsl for accessors.
+
+	Bits past size() in the last word are undefined.
+
+	This is not a drop-in replacement for UniformDigitalWaveform: filters must explicitly support it (or call
+	Unpack()) to consume it.
+ */
+class UniformPackedDigitalWaveform : public UniformWaveformBase
+{
+public:
+
+	///@brief Number of samples stored in each element of m_words
+	static constexpr size_t SAMPLES_PER_WORD = 64;
+
+	/**
+		@brief Creates a new packed digital waveform
+
+		@param name Internal name for this waveform, to be displayed in debug log messages etc
+	 */
+	UniformPackedDigitalWaveform(const std::string& name = "")
+		: m_size(0)
+	{
+		Rename(name);
+
+		//Default data to CPU/GPU mirror
+		m_words.SetCpuAccessHint(AcceleratorBuffer<uint64_t>::HINT_LIKELY);
+		m_words.SetGpuAccessHint(AcceleratorBuffer<uint64_t>::HINT_LIKELY);
+		m_words.PrepareForCpuAccess();
+	}
+
+	virtual ~UniformPackedDigitalWaveform()
+	{}
+
+	virtual void Rename(const std::string& name = "") override
+	{
+		if(name.empty())
+			m_words.SetName("UniformPackedDigitalWaveform.m_words");
+		else
+			m_words.SetName(name + ".m_words");
+	}
+
+	///@brief Packed sample data
+	AcceleratorBuffer<uint64_t> m_words;
+
+	///@brief Returns the number of words needed to store a given number of samples
+	static size_t GetWordCount(size_t samples)
+	{ return (samples + SAMPLES_PER_WORD - 1) / SAMPLES_PER_WORD; }
+
+	///@brief Gets the value of a single sample
+	bool GetSample(size_t i) const
+	{ return (m_words[i / SAMPLES_PER_WORD] >> (i % SAMPLES_PER_WORD)) & 1; }
+
+	///@brief Sets the value of a single sample (not thread safe with respect to other samples in the same word)
+	void SetSample(size_t i, bool value)
+	{
+		uint64_t mask = 1ULL << (i % SAMPLES_PER_WORD);
+		if(value)
+			m_words[i / SAMPLES_PER_WORD] |= mask;
+		else
+			m_words[i / SAMPLES_PER_WORD] &= ~mask;
+	}
+
+	size_t FindNextSampleWithValue(size_t i, bool value) const;
+
+	/**
+		@brief Finds the next toggle after a given sample
+
+		@return Index of the first sample after i with a different value than sample i, or size() if none
+	 */
+	size_t FindNextEdge(size_t i) const
+	{
+		if(i+1 >= m_size)
+			return m_size;
+		return FindNextSampleWithValue(i+1, !GetSample(i));
+	}
+
+	void FindEdges(std::vector<int64_t>& indexes, bool rising, bool falling) const;
+	size_t CountEdges() const;
+
+	void Pack(const UniformDigitalWaveform& wfm);
+	void Unpack(UniformDigitalWaveform& wfm) const;
+
+	static void PackBits(const bool* in, uint64_t* out, size_t len);
+	static void ExtractRuns(const uint8_t* packed, size_t len, SparseDigitalWaveform& wfm, size_t unmergedTail = 0);
+
+	virtual void FreeGpuMemory() override
+	{ m_words.FreeGpuBuffer(); }
+
+	virtual bool HasGpuBuffer() override
+	{ return m_words.HasGpuBuffer(); }
+
+	virtual bool IsCurrentOnlyOnGpu() override
+	{ return m_words.IsCurrentOnlyOnGpu(); }
+
+	virtual void Resize(size_t size) override
+	{
+		m_words.resize(GetWordCount(size));
+		m_size = size;
+	}
+
+	virtual void Reserve(size_t size) override
+	{ m_words.reserve(GetWordCount(size)); }
+
+	virtual size_t size() const override
+	{ return m_size; }
+
+	virtual size_t capacity() const override
+	{ return m_words.capacity() * SAMPLES_PER_WORD; }
+
+	virtual void clear() override
+	{
+		m_words.clear();
+		m_size = 0;
+	}
+
+	virtual void PrepareForCpuAccess() override
+	{ m_words.PrepareForCpuAccess(); }
+
+	virtual ReadbackFuture PrepareForCpuAccessAsync() override
+	{ return m_words.PrepareForCpuAccessAsync(); }
+
+	virtual void PrepareForGpuAccess() override
+	{ m_words.PrepareForGpuAccess(); }
+
+	virtual void PrepareForGpuAccessNonblocking(vk::raii::CommandBuffer& cmdBuf) override
+	{ m_words.PrepareForGpuAccessNonblocking(false, cmdBuf); }
+
+	virtual void MarkSamplesModifiedFromCpu() override
+	{ m_words.MarkModifiedFromCpu(); }
+
+	virtual void MarkSamplesModifiedFromGpu() override
+	{ m_words.MarkModifiedFromGpu(); }
+
+	virtual void MarkModifiedFromCpu() override
+	{ MarkSamplesModifiedFromCpu(); }
+
+	virtual void MarkModifiedFromGpu() override
+	{ MarkSamplesModifiedFromGpu(); }
+
+	/**
+		@brief Passes a hint to the memory allocator about where our sample data is expected to be used
+
+		@param hint	Hint value for expected usage
+	 */
+	void SetGpuAccessHint(enum AcceleratorBuffer<uint64_t>::UsageHint hint)
+	{ m_words.SetGpuAccessHint(hint); }
+
+protected:
+
+	static void PackGeneric(const bool* in, uint64_t* out, size_t len);
+#ifdef __x86_64__
+	static void PackAVX2(const bool* in, uint64_t* out, size_t len);
+#endif
+
+	///@brief Number of valid samples in m_words
+	size_t m_size;
+};
+
+//Make sure inline helpers aren't warned about if unused
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+/**
+	@brief Helper for getting the value of a digital waveform which may be sparse, uniform, or packed
+	@ingroup datamodel
+
+	The caller is expected to dynamic_cast the waveform three times and pass all copies, two of which should be null.
+ */
+static bool GetValue(
+	const SparseDigitalWaveform* sparse,
+	const UniformDigitalWaveform* uniform,
+	const UniformPackedDigitalWaveform* packed,
+	size_t i)
+{
+	if(packed)
+		return packed->GetSample(i);
+	else if(sparse)
+		return sparse->m_samples[i];
+	else
+		return uniform->m_samples[i];
+}
+
+/**
+	@brief Finds the first sample at or after i with a given value, in a waveform which may be sparse, uniform, or packed
+	@ingroup datamodel
+
+	Packed waveforms skip 64 samples at a time; other types are searched linearly.
+
+	@return Index of the sample, or len if none was found
+ */
+static size_t FindNextSampleWithValue(
+	const SparseDigitalWaveform* sparse,
+	const UniformDigitalWaveform* uniform,
+	const UniformPackedDigitalWaveform* packed,
+	size_t i,
+	size_t len,
+	bool value)
+{
+	if(packed)
+		return std::min(len, packed->FindNextSampleWithValue(i, value));
+
+	while( (i < len) && (GetValue(sparse, uniform, packed, i) != value) )
+		i++;
+	return i;
+}
+
+#pragma GCC diagnostic pop
+
+#endif
@@ -29,6 +29,9 @@
 
 #include "scopehal.h"
 #include "PacketDecoder.h"
+#include <cstddef>
+#include <mutex>
+#include <omp.h>
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Color schemes
@@ -44,6 +47,117 @@ std::string PacketDecoder::m_backgroundColors[PROTO_STANDARD_COLOR_COUNT] =
 	"#600050",		//PROTO_COLOR_COMMAND
 };
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Packet pool
+
+/**
+	@brief Slab allocator for Packet objects
+
+	Packets are small, fixed size, and created and destroyed in huge numbers, so they're carved out of large slabs
+	and recycled through a free list rather than going through the general purpose heap every time. When the last
+	live packet is freed, the arena is reset in one go.
+ */
+class PacketPool
+{
+public:
+	PacketPool()
+		: m_freeList(nullptr)
+		, m_slabUsed(PACKETS_PER_SLAB)
+		, m_liveCount(0)
+	{}
+
+	void* Allocate()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_liveCount ++;
+
+		//Reuse a previously freed packet if we have one
+		if(m_freeList)
+		{
+			auto ret = m_freeList;
+			m_freeList = *reinterpret_cast<void**>(ret);
+			return ret;
+		}
+
+		//Start a new slab if needed
+		if(m_slabUsed == PACKETS_PER_SLAB)
+		{
+			m_slabs.push_back(static_cast<uint8_t*>(::operator new(SLOT_SIZE * PACKETS_PER_SLAB)));
+			m_slabUsed = 0;
+		}
+
+		return m_slabs.back() + (SLOT_SIZE * m_slabUsed++);
+	}
+
+	void Free(void* p)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		*reinterpret_cast<void**>(p) = m_freeList;
+		m_freeList = p;
+
+		//Last one out resets the whole arena.
+		//Keep the first slab around so a decoder that creates and frees one packet at a time doesn't thrash.
+		m_liveCount --;
+		if(m_liveCount == 0)
+		{
+			for(size_t i=1; i<m_slabs.size(); i++)
+				::operator delete(m_slabs[i]);
+			m_slabs.resize(1);
+			m_freeList = nullptr;
+			m_slabUsed = 0;
+		}
+	}
+
+protected:
+	static const size_t SLOT_SIZE =
+		(sizeof(Packet) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+	static const size_t PACKETS_PER_SLAB = 4096;
+
+	std::mutex m_mutex;
+
+	///@brief All slabs allocated so far
+	std::vector<uint8_t*> m_slabs;
+
+	///@brief Singly linked list of freed packets, threaded through the first word of each
+	void* m_freeList;
+
+	///@brief Number of packets allocated from the last slab
+	size_t m_slabUsed;
+
+	///@brief Number of packets currently allocated
+	size_t m_liveCount;
+};
+
+static PacketPool& GetPacketPool()
+{
+	//Intentionally never destroyed, since packets may still be freed during static destruction
+	static PacketPool* pool = new PacketPool;
+	return *pool;
+}
+
+/**
+	@brief Allocates a packet from the pool
+
+	Derived classes with a different size fall back to the global heap.
+ */
+void* Packet::operator new(size_t size)
+{
+	if(size != sizeof(Packet))
+		return ::operator new(size);
+	return GetPacketPool().Allocate();
+}
+
+void Packet::operator delete(void* p, size_t size)
+{
+	if(p == nullptr)
+		return;
+	if(size != sizeof(Packet))
+		::operator delete(p);
+	else
+		GetPacketPool().Free(p);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Packet
 
@@ -65,6 +179,9 @@ Packet::~Packet()
 
 PacketDecoder::PacketDecoder(const std::string& color, Category cat)
 	: Filter(color, cat, Unit(Unit::UNIT_FS))
+	, m_appendInputRevision(0)
+	, m_appendInputLen(0)
+	, m_appendOutputRevision(0)
 {
 	AddProtocolStream("data");
 }
@@ -82,8 +199,156 @@ void PacketDecoder::ClearPackets()
 	for(auto p : m_packets)
 		delete p;
 	m_packets.clear();
+	m_packetIndex.Clear();
+	ResetAppend();
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Chunked decoding
+
+/**
+	@brief Finds points at which decoding can start from scratch, with no state carried over from earlier data
+
+	Used by ParallelDecode(). A restart point must be somewhere a sequential decode is guaranteed to be idle and
+	waiting for a new frame (bus idle before a UART start bit, chip select deasserted, etc) so that decoding each
+	chunk independently produces exactly the same output as decoding the whole input at once. This is meant to be a
+	cheap prescan, not a decode.
+
+	The default implementation in PacketDecoder returns false, meaning the decoder doesn't support chunked decoding.
+
+	@param maxChunks	Maximum number of chunks worth creating (a few per thread)
+	@param points		Sorted restart points in whatever units the decoder likes (sample or edge indexes,
+						timestamps...). The first entry is the start of the input and the last is the end, so there is
+						one more point than there are chunks.
+
+	@return True if points were found
+ */
+bool PacketDecoder::FindRestartPoints(size_t /*maxChunks*/, std::vector<int64_t>& /*points*/)
+{
+	return false;
+}
+
+/**
+	@brief Decodes the input between two restart points
+
+	Called from ParallelDecode(), possibly from several threads at once.
+
+	@param start	Restart point at which decoding begins
+	@param end		Restart point at which decoding ends (the next chunk begins here)
+	@param cap		Waveform to append output samples to. This is always the same type as the waveform passed to
+					ParallelDecode().
+	@param packets	List to append output packets to
+ */
+void PacketDecoder::DecodeChunk(
+	int64_t /*start*/,
+	int64_t /*end*/,
+	SparseWaveformBase* /*cap*/,
+	std::vector<Packet*>& /*packets*/)
+{
+}
+
+/**
+	@brief Gets the chunk boundaries for ParallelDecode()
+
+	@param points	Restart points, as returned by FindRestartPoints()
+
+	@return True if there is at least one chunk to decode
+ */
+bool PacketDecoder::GetRestartPoints(std::vector<int64_t>& points)
+{
+	points.clear();
+	size_t maxChunks = omp_get_max_threads() * 4;
+	if(!FindRestartPoints(maxChunks, points))
+	{
+		LogError("%s does not support chunked decoding\n", GetProtocolDisplayName().c_str());
+		return false;
+	}
+
+	if(points.size() < 2)
+		return false;
+	LogTrace("Decoding in %zu chunks\n", points.size() - 1);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Streaming decoding
+
+/**
+	@brief Checks whether we can decode only the new part of an input that's being streamed into
+
+	Instruments which accumulate data into one waveform over a long capture (IsAppendingToWaveform()) keep adding
+	samples to the same object rather than replacing it. A decoder that keeps the state of its decode loop
+	at the end of the previous update can then pick up where it left off, appending to its existing output
+	waveform and packet list, instead of decoding the entire capture again every time.
+
+	Incremental decoding is only allowed if all of the following hold:
+	* The input comes straight from an instrument that reports it is appending
+	* The input is the same waveform object we decoded last time, and it has grown since then
+	* Our output waveform hasn't been replaced or modified by anyone else since the last CommitAppend()
+
+	Decoders which support this call GetAppendStart() at the top of Refresh(). If it returns zero, they clear
+	their packets and state and decode from scratch as usual. Either way, they call CommitAppend() once done.
+
+	@param i	Input index to check
+	@param din	Current waveform on that input
+
+	@return Index of the first sample not yet decoded, or zero if the entire input must be decoded
+ */
+size_t PacketDecoder::GetAppendStart(size_t i, WaveformBase* din)
+{
+	auto chan = dynamic_cast<OscilloscopeChannel*>(GetInput(i).m_channel);
+	if(!chan || !chan->GetScope() || !chan->GetScope()->IsAppendingToWaveform())
+		return 0;
+
+	//The high half of the revision identifies the waveform object, the low half counts modifications
+	if( (din->m_revision >> 32) != (m_appendInputRevision >> 32) )
+		return 0;
+	if( (din->m_revision <= m_appendInputRevision) || (din->size() <= m_appendInputLen) )
+		return 0;
+
+	auto dout = GetData(0);
+	if(!dout || (dout->m_revision != m_appendOutputRevision) )
+		return 0;
+
+	return m_appendInputLen;
+}
+
+/**
+	@brief Records how much of the input has been decoded, after a full or incremental decode
+
+	Must be called after the output waveform is in its final state for this update (including bumping its
+	revision if it was appended to) so later changes to it can be detected.
+ */
+void PacketDecoder::CommitAppend(WaveformBase* din)
+{
+	auto dout = GetData(0);
+	if(!dout)
+	{
+		ResetAppend();
+		return;
+	}
+
+	m_appendInputRevision = din->m_revision;
+	m_appendInputLen = din->size();
+	m_appendOutputRevision = dout->m_revision;
+}
+
+/**
+	@brief Forces the next update to decode the entire input
+
+	Decoders supporting incremental decoding should call this when a setting changes, since the part of the input
+	which was already decoded would otherwise keep its old interpretation.
+ */
+void PacketDecoder::ResetAppend()
+{
+	m_appendInputRevision = 0;
+	m_appendInputLen = 0;
+	m_appendOutputRevision = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Display helpers
+
 bool PacketDecoder::GetShowDataColumn()
 {
 	return true;
@@ -31,10 +31,99 @@
 #define PacketDecoder_h
 
 #include "Filter.h"
+#include "PacketIndex.h"
+
+/**
+	@brief Header fields of a Packet
+
+	Provides the subset of the std::map<std::string, std::string> API used by decoders and the protocol analyzer.
+	Packets rarely have more than a dozen headers, so a sorted vector is much cheaper than a tree: one allocation per
+	packet instead of one per field, and nothing to chase on teardown. Iteration order and equality are the same as
+	std::map.
+ */
+class PacketHeaders
+{
+public:
+	typedef std::pair<std::string, std::string> value_type;
+	typedef std::vector<value_type>::iterator iterator;
+	typedef std::vector<value_type>::const_iterator const_iterator;
+
+	std::string& operator[](const std::string& key)
+	{
+		auto it = LowerBound(key);
+		if( (it == m_fields.end()) || (it->first != key) )
+			it = m_fields.insert(it, value_type(key, ""));
+		return it->second;
+	}
+
+	iterator find(const std::string& key)
+	{
+		auto it = LowerBound(key);
+		if( (it == m_fields.end()) || (it->first != key) )
+			return m_fields.end();
+		return it;
+	}
+
+	const_iterator find(const std::string& key) const
+	{ return const_cast<PacketHeaders*>(this)->find(key); }
+
+	size_t count(const std::string& key) const
+	{ return (find(key) == end()) ? 0 : 1; }
+
+	size_t erase(const std::string& key)
+	{
+		auto it = find(key);
+		if(it == m_fields.end())
+			return 0;
+		m_fields.erase(it);
+		return 1;
+	}
+
+	void clear()
+	{ m_fields.clear(); }
+
+	size_t size() const
+	{ return m_fields.size(); }
+
+	bool empty() const
+	{ return m_fields.empty(); }
+
+	iterator begin()
+	{ return m_fields.begin(); }
+
+	iterator end()
+	{ return m_fields.end(); }
+
+	const_iterator begin() const
+	{ return m_fields.begin(); }
+
+	const_iterator end() const
+	{ return m_fields.end(); }
+
+	bool operator==(const PacketHeaders& rhs) const
+	{ return m_fields == rhs.m_fields; }
+
+	bool operator!=(const PacketHeaders& rhs) const
+	{ return m_fields != rhs.m_fields; }
+
+protected:
+	iterator LowerBound(const std::string& key)
+	{
+		//Linear search is faster than binary for the handful of fields we typically have
+		auto it = m_fields.begin();
+		while( (it != m_fields.end()) && (it->first < key) )
+			++it;
+		return it;
+	}
+
+	std::vector<value_type> m_fields;
+};
 
 /**
 	@class
 	@brief Generic display representation for arbitrary packetized data
+
+	Packets are allocated from a shared pool (see operator new) since deep captures can produce millions of them.
  */
 class Packet
 {
@@ -42,6 +131,9 @@ public:
 	Packet();
 	virtual ~Packet();
 
+	static void* operator new(size_t size);
+	static void operator delete(void* p, size_t size);
+
 	///Offset of the packet from the start of the capture (femtoseconds)
 	int64_t m_offset;
 
@@ -49,7 +141,7 @@ public:
 	int64_t m_len;
 
 	//Arbitrary header properties (human readable)
-	std::map<std::string, std::string> m_headers;
+	PacketHeaders m_headers;
 
 	//Packet bytes
 	std::vector<uint8_t> m_data;
@@ -124,12 +216,109 @@ public:
 		Typically used after copying the packets somewhere else and assuming ownership of them.
 	 */
 	void DetachPackets()
-	{ m_packets.clear(); }
+	{
+		m_packets.clear();
+		m_packetIndex.Clear();
+	}
+
+	/**
+		@brief Finds all packets matching a query
+
+		@param query	Conditions to test
+		@param results	Indexes of matching packets within GetPackets(), in ascending order
+	 */
+	void FindPackets(const PacketQuery& query, std::vector<size_t>& results)
+	{ m_packetIndex.Find(m_packets, query, results); }
+
+	/**
+		@brief Gets the search index over our packets, brought up to date with any new packets
+	 */
+	PacketIndex& GetPacketIndex()
+	{
+		m_packetIndex.Update(m_packets);
+		return m_packetIndex;
+	}
 
 protected:
 	void ClearPackets();
 
+	virtual bool FindRestartPoints(size_t maxChunks, std::vector<int64_t>& points);
+	virtual void DecodeChunk(int64_t start, int64_t end, SparseWaveformBase* cap, std::vector<Packet*>& packets);
+
+	bool GetRestartPoints(std::vector<int64_t>& points);
+
+	size_t GetAppendStart(size_t i, WaveformBase* din);
+	void CommitAppend(WaveformBase* din);
+	void ResetAppend();
+
+	/**
+		@brief Decodes the input in independent chunks on all available threads, then stitches the sparse output
+		samples and packets back together in order.
+
+		The chunk boundaries come from FindRestartPoints(). Each chunk is decoded by DecodeChunk() into a private
+		waveform and packet list, so the decoder must not modify any member state from DecodeChunk().
+
+		@param cap	Output waveform. Samples from all chunks are appended to it.
+	 */
+	template<class T>
+	void ParallelDecode(SparseWaveform<T>* cap)
+	{
+		std::vector<int64_t> points;
+		if(!GetRestartPoints(points))
+			return;
+		size_t nchunks = points.size() - 1;
+
+		//Only one chunk? Decode directly into the output
+		if(nchunks == 1)
+		{
+			DecodeChunk(points[0], points[1], cap, m_packets);
+			return;
+		}
+
+		std::vector<SparseWaveform<T>> chunkData(nchunks);
+		std::vector<std::vector<Packet*>> chunkPackets(nchunks);
+		#pragma omp parallel for
+		for(size_t i=0; i<nchunks; i++)
+		{
+			chunkData[i].SetCpuOnlyHint();
+			DecodeChunk(points[i], points[i+1], &chunkData[i], chunkPackets[i]);
+		}
+
+		//Stitch everything together
+		size_t base = cap->m_samples.size();
+		size_t total = base;
+		for(auto& d : chunkData)
+			total += d.m_samples.size();
+		cap->Resize(total);
+		for(size_t i=0; i<nchunks; i++)
+		{
+			auto& d = chunkData[i];
+			size_t len = d.m_samples.size();
+			for(size_t j=0; j<len; j++)
+			{
+				cap->m_offsets[base + j] = d.m_offsets[j];
+				cap->m_durations[base + j] = d.m_durations[j];
+				cap->m_samples[base + j] = d.m_samples[j];
+			}
+			base += len;
+
+			m_packets.insert(m_packets.end(), chunkPackets[i].begin(), chunkPackets[i].end());
+		}
+	}
+
 	std::vector<Packet*> m_packets;
+
+	///@brief Search index over m_packets
+	PacketIndex m_packetIndex;
+
+	///@brief Revision of the input waveform as of the last CommitAppend()
+	uint64_t m_appendInputRevision;
+
+	///@brief Number of input samples decoded as of the last CommitAppend()
+	size_t m_appendInputLen;
+
+	///@brief Revision of our output waveform as of the last CommitAppend()
+	uint64_t m_appendOutputRevision;
 };
 
 #endif
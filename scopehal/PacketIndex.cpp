@@ -0,0 +1,318 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of PacketIndex, PacketQuery and PacketQueryTerm
+ */
+
+#include "scopehal.h"
+#include "PacketDecoder.h"
+#include <algorithm>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PacketQueryTerm
+
+/**
+	@brief Checks if a single packet satisfies this condition
+ */
+bool PacketQueryTerm::Matches(const Packet* p) const
+{
+	auto it = p->m_headers.find(m_column);
+	if(it == p->m_headers.end())
+		return (m_op == OP_NOT_EQUAL);
+
+	const string& field = it->second;
+	switch(m_op)
+	{
+		case OP_EQUAL:
+			return field == m_value;
+
+		case OP_NOT_EQUAL:
+			return field != m_value;
+
+		case OP_CONTAINS:
+			return field.find(m_value) != string::npos;
+
+		case OP_PREFIX:
+			return field.compare(0, m_value.length(), m_value) == 0;
+
+		default:
+			return false;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PacketQuery
+
+/**
+	@brief Checks if a single packet satisfies every condition of the query
+ */
+bool PacketQuery::Matches(const Packet* p) const
+{
+	if(m_hasTimeRange)
+	{
+		if( (p->m_offset > m_end) || (p->m_offset + p->m_len < m_start) )
+			return false;
+	}
+
+	for(auto& t : m_terms)
+	{
+		if(!t.Matches(p))
+			return false;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+PacketIndex::PacketIndex()
+	: m_indexedCount(0)
+	, m_maxLen(0)
+{
+}
+
+/**
+	@brief Forgets all indexed packets, but keeps the list of indexed columns
+ */
+void PacketIndex::Clear()
+{
+	m_indexedCount = 0;
+	m_byTime.clear();
+	m_maxLen = 0;
+	for(auto& it : m_columns)
+		it.second.clear();
+}
+
+/**
+	@brief Adds an inverted index for a header column
+
+	Packets already in the index are re-indexed on the next Update().
+ */
+void PacketIndex::IndexColumn(const string& column)
+{
+	if(m_columns.find(column) != m_columns.end())
+		return;
+
+	m_columns[column];
+	Clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Index maintenance
+
+/**
+	@brief Adds any packets appended to the list since the last call
+
+	@param packets	The packet list being indexed. Must be the same list every time, other than appends.
+ */
+void PacketIndex::Update(const vector<Packet*>& packets)
+{
+	size_t len = packets.size();
+
+	//List got shorter? It was cleared and refilled, start over
+	if(len < m_indexedCount)
+		Clear();
+	if(len == m_indexedCount)
+		return;
+
+	//Packets almost always arrive in time order, so appending normally keeps m_byTime sorted
+	size_t oldsize = m_byTime.size();
+	bool sorted = true;
+	for(size_t i=m_indexedCount; i<len; i++)
+	{
+		auto p = packets[i];
+
+		if(!m_byTime.empty() && (p->m_offset < m_byTime.back().first) )
+			sorted = false;
+		m_byTime.push_back(pair<int64_t, uint32_t>(p->m_offset, i));
+		m_maxLen = max(m_maxLen, p->m_len);
+
+		for(auto& col : m_columns)
+		{
+			auto it = p->m_headers.find(col.first);
+			if(it != p->m_headers.end())
+				col.second[it->second].push_back(i);
+		}
+	}
+
+	//Out of order: sort the new packets and merge them with the ones we already had
+	if(!sorted)
+	{
+		sort(m_byTime.begin() + oldsize, m_byTime.end());
+		inplace_merge(m_byTime.begin(), m_byTime.begin() + oldsize, m_byTime.end());
+	}
+
+	m_indexedCount = len;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Queries
+
+/**
+	@brief Gets the positions of all packets overlapping a time range, in ascending order
+
+	@param start	Start of the range (femtoseconds, inclusive)
+	@param end		End of the range (femtoseconds, inclusive)
+ */
+void PacketIndex::GetTimeRangeCandidates(int64_t start, int64_t end, vector<uint32_t>& candidates)
+{
+	candidates.clear();
+
+	//Anything starting more than one max-length packet before the range can't overlap it
+	auto first = lower_bound(
+		m_byTime.begin(),
+		m_byTime.end(),
+		pair<int64_t, uint32_t>(start - m_maxLen, 0));
+	auto last = upper_bound(
+		first,
+		m_byTime.end(),
+		pair<int64_t, uint32_t>(end, UINT32_MAX));
+
+	for(auto it = first; it != last; ++it)
+		candidates.push_back(it->second);
+	sort(candidates.begin(), candidates.end());
+}
+
+/**
+	@brief Gets the list of packets an equality term can possibly match
+
+	@param term		The term to look up
+	@param indexed	Set true if the term could be answered from an index
+
+	@return The posting list, or nullptr if no packet has that value (or the term can't use an index)
+ */
+const vector<uint32_t>* PacketIndex::GetPostingList(const PacketQueryTerm& term, bool& indexed)
+{
+	indexed = false;
+	if(term.m_op != PacketQueryTerm::OP_EQUAL)
+		return nullptr;
+
+	auto col = m_columns.find(term.m_column);
+	if(col == m_columns.end())
+		return nullptr;
+
+	indexed = true;
+	auto it = col->second.find(term.m_value);
+	if(it == col->second.end())
+		return nullptr;
+	return &it->second;
+}
+
+/**
+	@brief Finds all packets overlapping a time range
+
+	@param packets	The packet list being indexed
+	@param start	Start of the range (femtoseconds, inclusive)
+	@param end		End of the range (femtoseconds, inclusive)
+	@param results	Positions of matching packets within the list, in ascending order
+ */
+void PacketIndex::FindInTimeRange(const vector<Packet*>& packets, int64_t start, int64_t end, vector<size_t>& results)
+{
+	PacketQuery query;
+	query.During(start, end);
+	Find(packets, query, results);
+}
+
+/**
+	@brief Finds all packets matching a query
+
+	Uses the smallest of the indexes that apply (an inverted index for an equality term, or the time index), then
+	checks the remaining conditions on each candidate. Queries no index can help with scan every packet in parallel.
+
+	@param packets	The packet list being indexed
+	@param query	The conditions to test
+	@param results	Positions of matching packets within the list, in ascending order
+ */
+void PacketIndex::Find(const vector<Packet*>& packets, const PacketQuery& query, vector<size_t>& results)
+{
+	results.clear();
+	Update(packets);
+
+	//Find the shortest posting list among indexed equality terms
+	const vector<uint32_t>* candidates = nullptr;
+	for(auto& t : query.m_terms)
+	{
+		bool indexed;
+		auto list = GetPostingList(t, indexed);
+		if(!indexed)
+			continue;
+
+		//Nothing has this value at all, so nothing can match
+		if(!list)
+			return;
+
+		if(!candidates || (list->size() < candidates->size()) )
+			candidates = list;
+	}
+
+	//See if the time index narrows things down more
+	vector<uint32_t> timeCandidates;
+	if(query.m_hasTimeRange)
+	{
+		GetTimeRangeCandidates(query.m_start, query.m_end, timeCandidates);
+		if(!candidates || (timeCandidates.size() < candidates->size()) )
+			candidates = &timeCandidates;
+	}
+
+	//Check the remaining conditions on each candidate
+	if(candidates)
+	{
+		for(auto i : *candidates)
+		{
+			if(query.Matches(packets[i]))
+				results.push_back(i);
+		}
+		return;
+	}
+
+	//No index applies, so scan everything in blocks
+	size_t len = m_indexedCount;
+	const size_t blocksize = 65536;
+	size_t nblocks = (len + blocksize - 1) / blocksize;
+	vector<vector<size_t>> blockResults(nblocks);
+	#pragma omp parallel for
+	for(size_t block=0; block<nblocks; block++)
+	{
+		size_t end = min(len, (block+1) * blocksize);
+		for(size_t i=block*blocksize; i<end; i++)
+		{
+			if(query.Matches(packets[i]))
+				blockResults[block].push_back(i);
+		}
+	}
+	for(auto& r : blockResults)
+		results.insert(results.end(), r.begin(), r.end());
+}
@@ -0,0 +1,183 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of PacketIndex, PacketQuery and PacketQueryTerm
+ */
+
+#ifndef PacketIndex_h
+#define PacketIndex_h
+
+#include <unordered_map>
+
+class Packet;
+
+/**
+	@brief A single condition on one header field of a packet
+ */
+class PacketQueryTerm
+{
+public:
+
+	enum Operator
+	{
+		OP_EQUAL,			//Field is exactly the value
+		OP_NOT_EQUAL,		//Field is missing, or anything other than the value
+		OP_CONTAINS,		//Field contains the value as a substring
+		OP_PREFIX			//Field starts with the value
+	};
+
+	PacketQueryTerm(const std::string& column, Operator op, const std::string& value)
+	: m_column(column)
+	, m_op(op)
+	, m_value(value)
+	{}
+
+	bool Matches(const Packet* p) const;
+
+	///@brief Name of the header field to test
+	std::string m_column;
+
+	///@brief Comparison to perform
+	Operator m_op;
+
+	///@brief Value to compare against
+	std::string m_value;
+};
+
+/**
+	@brief A filter expression over packets
+
+	A packet matches if every term matches and, if a time range is set, the packet overlaps it.
+ */
+class PacketQuery
+{
+public:
+	PacketQuery()
+	: m_hasTimeRange(false)
+	, m_start(0)
+	, m_end(0)
+	{}
+
+	/**
+		@brief Restricts the query to packets overlapping the given time range (femtoseconds, inclusive)
+	 */
+	PacketQuery& During(int64_t start, int64_t end)
+	{
+		m_hasTimeRange = true;
+		m_start = start;
+		m_end = end;
+		return *this;
+	}
+
+	/**
+		@brief Adds a condition on a header field
+	 */
+	PacketQuery& Where(const std::string& column, PacketQueryTerm::Operator op, const std::string& value)
+	{
+		m_terms.push_back(PacketQueryTerm(column, op, value));
+		return *this;
+	}
+
+	bool Matches(const Packet* p) const;
+
+	///@brief True if the query is restricted to a time range
+	bool m_hasTimeRange;
+
+	///@brief Start of the time range
+	int64_t m_start;
+
+	///@brief End of the time range
+	int64_t m_end;
+
+	///@brief Conditions which must all be true
+	std::vector<PacketQueryTerm> m_terms;
+};
+
+/**
+	@brief Search index over a list of packets
+
+	Keeps packets sorted by start time for O(log n) time range lookups, plus inverted indexes (value to list of
+	packets) for selected header columns so equality tests on them don't have to look at every packet.
+
+	The index refers to packets by their position in the list, and is maintained incrementally: Update() only looks at
+	packets appended since the last call. If the list shrinks the index is rebuilt from scratch. Anything which
+	reorders or replaces packets in place must call Clear().
+ */
+class PacketIndex
+{
+public:
+	PacketIndex();
+
+	void Clear();
+	void IndexColumn(const std::string& column);
+
+	void Update(const std::vector<Packet*>& packets);
+
+	void Find(const std::vector<Packet*>& packets, const PacketQuery& query, std::vector<size_t>& results);
+	void FindInTimeRange(
+		const std::vector<Packet*>& packets,
+		int64_t start,
+		int64_t end,
+		std::vector<size_t>& results);
+
+	///@brief Gets the number of packets currently in the index
+	size_t GetIndexedCount() const
+	{ return m_indexedCount; }
+
+	/**
+		@brief Notes that a packet which was already indexed has grown to a new length
+
+		Needed when a streaming decoder completes a packet it had left open at the end of the previous update, so
+		that time range lookups still reach back far enough to find it.
+	 */
+	void ExtendMaxLength(int64_t len)
+	{ m_maxLen = std::max(m_maxLen, len); }
+
+protected:
+	void GetTimeRangeCandidates(int64_t start, int64_t end, std::vector<uint32_t>& candidates);
+	const std::vector<uint32_t>* GetPostingList(const PacketQueryTerm& term, bool& indexed);
+
+	///@brief Number of packets, from the start of the list, which have been indexed
+	size_t m_indexedCount;
+
+	///@brief Start time and position of every indexed packet, sorted by start time
+	std::vector<std::pair<int64_t, uint32_t>> m_byTime;
+
+	///@brief Length of the longest indexed packet, so range lookups can find packets starting before the range
+	int64_t m_maxLen;
+
+	///@brief Inverted indexes for selected columns: column name, then field value, then ascending packet positions
+	std::map<std::string, std::unordered_map<std::string, std::vector<uint32_t>>> m_columns;
+};
+
+#endif
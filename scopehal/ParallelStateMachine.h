@@ -0,0 +1,156 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of ParallelStateMachine
+	@ingroup core
+ */
+
+#ifndef ParallelStateMachine_h
+#define ParallelStateMachine_h
+
+#include <array>
+#include <vector>
+
+#include "ThreadPool.h"
+
+/**
+	@brief Runs a small finite state machine over a long symbol stream on all cores
+	@ingroup core
+
+	Protocol decoders which walk a state machine over every clock edge (JTAG TAP, link training, etc) are serial by
+	nature, since the state at each symbol depends on every symbol before it. If the machine only has a handful of
+	states, though, the stream can be split into chunks and each chunk run from every possible starting state at
+	once, recording where each of them ends up. A short serial pass then chains these transfer maps together to find
+	the true state at the start of every chunk, after which the chunks can be decoded independently.
+
+	Runs from different starting states almost always converge within a few symbols (five TMS highs take a TAP to
+	TEST_LOGIC_RESET from anywhere) and are merged as soon as they do, so the speculative pass typically costs little
+	more than a single run of the machine.
+
+	@tparam NSTATES	Number of states. States are numbered 0 to NSTATES-1.
+ */
+template<size_t NSTATES>
+class ParallelStateMachine
+{
+public:
+	static_assert(NSTATES <= 256, "state must fit in a uint8_t");
+
+	/**
+		@brief Finds the state of the machine at the start of each chunk of the input
+
+		@param len			Number of symbols in the input
+		@param chunkSize	Number of symbols per chunk
+		@param initial		State before the first symbol
+		@param step			Transition function: step(i, state) returns the state after consuming symbol i
+
+		@return State before the first symbol of each chunk. Chunk k begins at symbol k*chunkSize.
+	 */
+	template<class StepFn>
+	static std::vector<uint8_t> FindChunkStates(size_t len, size_t chunkSize, uint8_t initial, StepFn step)
+	{
+		if(chunkSize == 0)
+			chunkSize = 1;
+		size_t nchunks = (len + chunkSize - 1) / chunkSize;
+
+		//Transfer map of each chunk, in parallel. The last chunk's map is never used so don't bother with it
+		std::vector< std::array<uint8_t, NSTATES> > maps(nchunks);
+		ParallelFor(0, (nchunks > 0) ? nchunks-1 : 0, 1, [&](size_t first, size_t last)
+		{
+			for(size_t k=first; k<last; k++)
+				maps[k] = RunAllStates(k*chunkSize, std::min(len, (k+1)*chunkSize), step);
+		});
+
+		//Chain them together
+		std::vector<uint8_t> ret(nchunks);
+		uint8_t state = initial;
+		for(size_t k=0; k<nchunks; k++)
+		{
+			ret[k] = state;
+			state = maps[k][state];
+		}
+		return ret;
+	}
+
+	/**
+		@brief Runs the machine over symbols [first, last) from every starting state
+
+		@return Map from each starting state to the state after symbol last-1
+	 */
+	template<class StepFn>
+	static std::array<uint8_t, NSTATES> RunAllStates(size_t first, size_t last, StepFn& step)
+	{
+		//Distinct states still being tracked, and which of them each starting state has become
+		std::array<uint8_t, NSTATES> live;
+		std::array<uint8_t, NSTATES> which;
+		for(size_t s=0; s<NSTATES; s++)
+		{
+			live[s] = s;
+			which[s] = s;
+		}
+		size_t nlive = NSTATES;
+
+		std::array<uint8_t, NSTATES> remap;
+		for(size_t i=first; i<last; i++)
+		{
+			for(size_t j=0; j<nlive; j++)
+				live[j] = step(i, live[j]);
+
+			if(nlive == 1)
+				continue;
+
+			//Merge runs which have converged onto the same state
+			size_t n = 0;
+			for(size_t j=0; j<nlive; j++)
+			{
+				size_t m = 0;
+				while( (m < n) && (live[m] != live[j]) )
+					m++;
+				if(m == n)
+					live[n++] = live[j];
+				remap[j] = m;
+			}
+			if(n != nlive)
+			{
+				for(size_t s=0; s<NSTATES; s++)
+					which[s] = remap[which[s]];
+				nlive = n;
+			}
+		}
+
+		std::array<uint8_t, NSTATES> ret;
+		for(size_t s=0; s<NSTATES; s++)
+			ret[s] = live[which[s]];
+		return ret;
+	}
+};
+
+#endif
@@ -38,13 +38,197 @@ using namespace std;
 
 PeakDetector::PeakDetector()
 	: m_peakFirComputePipeline("shaders/FIRFilter.spv", 3, sizeof(FIRFilterArgs))
+	, m_peakBlockScanComputePipeline("shaders/PeakBlockScan.spv", 4, sizeof(PeakDetectorArgs))
+	, m_peakCandidatesComputePipeline("shaders/PeakCandidates.spv", 5, sizeof(PeakDetectorArgs))
+	, m_peakSelectComputePipeline("shaders/PeakSelect.spv", 2, sizeof(PeakDetectorArgs))
+	, m_peakHistogramComputePipeline("shaders/PeakHistogram.spv", 2, sizeof(PeakDetectorArgs))
+	, m_peakEmitComputePipeline("shaders/PeakEmit.spv", 4, sizeof(PeakDetectorArgs))
 {
+	m_peakPrefix.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_peakPrefix.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_NEVER);
+	m_peakSuffix.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_peakSuffix.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_NEVER);
+	m_peakBlockMin.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_peakBlockMin.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_NEVER);
+	m_peakCandidates.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+	m_peakCandidates.SetCpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_NEVER);
+	m_peakState.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+	m_peakState.SetCpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+	m_peakResults.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+	m_peakResults.SetCpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+
+	m_peakPrefix.SetName("PeakDetector.m_peakPrefix");
+	m_peakSuffix.SetName("PeakDetector.m_peakSuffix");
+	m_peakBlockMin.SetName("PeakDetector.m_peakBlockMin");
+	m_peakCandidates.SetName("PeakDetector.m_peakCandidates");
+	m_peakState.SetName("PeakDetector.m_peakState");
+	m_peakResults.SetName("PeakDetector.m_peakResults");
 }
 
 PeakDetector::~PeakDetector()
 {
 }
 
+/**
+	@brief Finds peaks in a uniform waveform, on the GPU if it's big enough to be worth it (or already there)
+
+	Gives the same peaks as the CPU search, but the order of peaks with exactly equal magnitude may differ.
+
+	@param cap			Input waveform
+	@param max_peaks	Number of peaks to find
+	@param search_hz	Peaks must be the highest point within this distance on either side, in X axis units
+	@param yUnitIsDB	True if the Y axis is logarithmic, so FWHM is measured at -3 dB rather than half magnitude
+	@param cmdBuf		Command buffer to use (must not be in the recording state)
+	@param queue		Queue to submit to
+ */
+void PeakDetector::FindPeaks(
+	UniformAnalogWaveform* cap,
+	int64_t max_peaks,
+	float search_hz,
+	bool yUnitIsDB,
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue)
+{
+	size_t nouts = cap->size();
+	bool useGpu = g_gpuFilterEnabled && ( (nouts >= GPU_MIN_SIZE) || cap->IsCurrentOnlyOnGpu() );
+
+	//Skip this many bins at left to avoid false positives on the DC peak (same as the CPU path)
+	const size_t minpeak = 10;
+	if(!useGpu || (max_peaks <= 0) || (nouts <= minpeak + 1) )
+	{
+		FindPeaks<UniformAnalogWaveform>(cap, max_peaks, search_hz, yUnitIsDB, cmdBuf, queue);
+		return;
+	}
+
+	int64_t search_bins = ceil(search_hz / cap->m_timescale);
+	int64_t search_rad = max(search_bins/2, (int64_t)1);
+	FindPeaksGPU(cap, max_peaks, search_rad, minpeak, yUnitIsDB, cmdBuf, queue);
+}
+
+/**
+	@brief GPU peak search
+
+	A sample is a peak if it's strictly higher than every sample within search_rad on either side. This is found
+	for every sample at once using van Herk/Gil-Werman running maxima (a fixed cost per sample, however wide the
+	window). The peaks are compacted into a candidate list, the top max_peaks are chosen by a radix select on their
+	magnitude, and only those have their FWHM measured and are read back.
+ */
+void PeakDetector::FindPeaksGPU(
+	UniformAnalogWaveform* cap,
+	int64_t max_peaks,
+	int64_t search_rad,
+	size_t minpeak,
+	bool yUnitIsDB,
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue)
+{
+	size_t nouts = cap->size();
+	size_t rad = search_rad;
+
+	//Peaks are more than rad samples apart, which bounds the candidate count
+	PeakDetectorArgs args;
+	args.size = nouts;
+	args.radius = rad;
+	args.minpeak = minpeak;
+	args.numBlocks = (nouts + 3*rad - 1) / rad;
+	args.capacity = nouts / (rad + 1) + 2;
+	args.maxPeaks = max_peaks;
+	args.shift = 24;
+	args.isDB = yUnitIsDB;
+
+	size_t padded = args.numBlocks * rad;
+	m_peakPrefix.resize(padded);
+	m_peakSuffix.resize(padded);
+	m_peakBlockMin.resize(args.numBlocks);
+	m_peakCandidates.resize(args.capacity * 4);
+	m_peakResults.resize(max_peaks * 5);
+
+	//Zero the state CPU side, it's tiny
+	const size_t stateSize = 8 + 256;
+	m_peakState.resize(stateSize);
+	m_peakState.PrepareForCpuAccess();
+	memset(m_peakState.GetCpuPointer(), 0, stateSize * sizeof(uint32_t));
+	m_peakState.MarkModifiedFromCpu();
+
+	cmdBuf.begin({});
+
+	//Running maxima
+	m_peakBlockScanComputePipeline.BindBufferNonblocking(0, cap->m_samples, cmdBuf);
+	m_peakBlockScanComputePipeline.BindBufferNonblocking(1, m_peakPrefix, cmdBuf, true);
+	m_peakBlockScanComputePipeline.BindBufferNonblocking(2, m_peakSuffix, cmdBuf, true);
+	m_peakBlockScanComputePipeline.BindBufferNonblocking(3, m_peakBlockMin, cmdBuf, true);
+	uint32_t blocks = GetComputeBlockCount(args.numBlocks, 64);
+	m_peakBlockScanComputePipeline.Dispatch(cmdBuf, args, min(blocks, 32768u), blocks / 32768 + 1);
+	m_peakBlockScanComputePipeline.AddComputeMemoryBarrier(cmdBuf);
+	m_peakPrefix.MarkModifiedFromGpu();
+	m_peakSuffix.MarkModifiedFromGpu();
+	m_peakBlockMin.MarkModifiedFromGpu();
+
+	//Local maxima, plus the histogram for the first radix select pass
+	m_peakCandidatesComputePipeline.BindBufferNonblocking(0, cap->m_samples, cmdBuf);
+	m_peakCandidatesComputePipeline.BindBufferNonblocking(1, m_peakPrefix, cmdBuf);
+	m_peakCandidatesComputePipeline.BindBufferNonblocking(2, m_peakSuffix, cmdBuf);
+	m_peakCandidatesComputePipeline.BindBufferNonblocking(3, m_peakCandidates, cmdBuf, true);
+	m_peakCandidatesComputePipeline.BindBufferNonblocking(4, m_peakState, cmdBuf);
+	blocks = GetComputeBlockCount(nouts, 64);
+	m_peakCandidatesComputePipeline.Dispatch(cmdBuf, args, min(blocks, 32768u), blocks / 32768 + 1);
+	m_peakCandidatesComputePipeline.AddComputeMemoryBarrier(cmdBuf);
+	m_peakCandidates.MarkModifiedFromGpu();
+
+	//Radix select the top max_peaks candidates, one byte of the sort key at a time
+	m_peakSelectComputePipeline.BindBufferNonblocking(0, m_peakBlockMin, cmdBuf);
+	m_peakSelectComputePipeline.BindBufferNonblocking(1, m_peakState, cmdBuf);
+	m_peakHistogramComputePipeline.BindBufferNonblocking(0, m_peakCandidates, cmdBuf);
+	m_peakHistogramComputePipeline.BindBufferNonblocking(1, m_peakState, cmdBuf);
+	blocks = GetComputeBlockCount(args.capacity, 64);
+	for(int shift = 24; shift >= 0; shift -= 8)
+	{
+		args.shift = shift;
+		if(shift != 24)
+		{
+			m_peakHistogramComputePipeline.Dispatch(cmdBuf, args, min(blocks, 32768u), blocks / 32768 + 1);
+			m_peakHistogramComputePipeline.AddComputeMemoryBarrier(cmdBuf);
+		}
+		m_peakSelectComputePipeline.Dispatch(cmdBuf, args, 1);
+		m_peakSelectComputePipeline.AddComputeMemoryBarrier(cmdBuf);
+	}
+
+	//Measure and write out the winners
+	m_peakEmitComputePipeline.BindBufferNonblocking(0, cap->m_samples, cmdBuf);
+	m_peakEmitComputePipeline.BindBufferNonblocking(1, m_peakCandidates, cmdBuf);
+	m_peakEmitComputePipeline.BindBufferNonblocking(2, m_peakState, cmdBuf);
+	m_peakEmitComputePipeline.BindBufferNonblocking(3, m_peakResults, cmdBuf, true);
+	m_peakEmitComputePipeline.Dispatch(cmdBuf, args, min(blocks, 32768u), blocks / 32768 + 1);
+	m_peakState.MarkModifiedFromGpu();
+	m_peakResults.MarkModifiedFromGpu();
+
+	m_peakState.PrepareForCpuAccessNonblocking(cmdBuf);
+	m_peakResults.PrepareForCpuAccessNonblocking(cmdBuf);
+
+	cmdBuf.end();
+	queue->SubmitAndBlock(cmdBuf);
+
+	//Convert to sub-sample X positions and widths, then sort (only max_peaks entries so this is cheap)
+	size_t count = min((size_t)m_peakState[7], (size_t)max_peaks);
+	auto results = m_peakResults.GetCpuPointer();
+	m_peaks.clear();
+	for(size_t i=0; i<count; i++)
+	{
+		auto r = results + i*5;
+		int64_t index = r[0];
+		float p;
+		float mag;
+		memcpy(&p, &r[1], sizeof(float));
+		memcpy(&mag, &r[2], sizeof(float));
+
+		int64_t location = (index * cap->m_timescale) + static_cast<int64_t>(round(p * cap->m_timescale)) +
+			cap->m_triggerPhase;
+		float fwhm = (static_cast<int64_t>(r[4]) - static_cast<int64_t>(r[3])) * cap->m_timescale;
+		m_peaks.push_back(Peak(location, mag, fwhm));
+	}
+	sort(m_peaks.rbegin(), m_peaks.rend(), less<Peak>());
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Construction / destruction
 
@@ -54,6 +54,19 @@ public:
 	float m_fwhm;
 };
 
+///@brief Push constants shared by all of the PeakDetector shaders
+struct __attribute__((packed)) PeakDetectorArgs
+{
+	uint32_t size;
+	uint32_t radius;
+	uint32_t minpeak;
+	uint32_t numBlocks;
+	uint32_t capacity;
+	uint32_t maxPeaks;
+	uint32_t shift;
+	uint32_t isDB;
+};
+
 class PeakDetector
 {
 public:
@@ -63,6 +76,17 @@ public:
 	const std::vector<Peak>& GetPeaks()
 	{ return m_peaks; }
 
+	void FindPeaks(
+		UniformAnalogWaveform* cap,
+		int64_t max_peaks,
+		float search_hz,
+		bool yUnitIsDB,
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue);
+
+	///@brief Waveforms smaller than this are searched on the CPU unless they are already only on the GPU
+	static const size_t GPU_MIN_SIZE = 65536;
+
 	template<class T>
 	__attribute__((noinline))
 	void FindPeaks(
@@ -83,7 +107,7 @@ public:
 			m_peaks.clear();
 		else
 		{
-			//TODO: use the GPU
+			//Uniform waveforms can use the GPU, see the non-template overload
 			cap->PrepareForCpuAccess();
 
 			std::vector<Peak> peaks;
@@ -193,12 +217,45 @@ public:
 	}
 
 protected:
+	void FindPeaksGPU(
+		UniformAnalogWaveform* cap,
+		int64_t max_peaks,
+		int64_t search_rad,
+		size_t minpeak,
+		bool yUnitIsDB,
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue);
+
 	std::vector<Peak> m_peaks;
 
 	AcceleratorBuffer<float> m_filteredInput;
 	AcceleratorBuffer<float> m_peakCoefficients;
 
 	ComputePipeline m_peakFirComputePipeline;
+
+	///@brief Running max within each block, from the block start (see PeakBlockScan.glsl)
+	AcceleratorBuffer<float> m_peakPrefix;
+
+	///@brief Running max within each block, to the block end
+	AcceleratorBuffer<float> m_peakSuffix;
+
+	///@brief Min of each block, for the FWHM baseline
+	AcceleratorBuffer<float> m_peakBlockMin;
+
+	///@brief Every local max: index, interpolation offset, magnitude, sort key
+	AcceleratorBuffer<uint32_t> m_peakCandidates;
+
+	///@brief Candidate count, radix select state, and histogram (see PeakSelect.glsl)
+	AcceleratorBuffer<uint32_t> m_peakState;
+
+	///@brief Selected peaks: index, interpolation offset, magnitude, half max left and right indexes
+	AcceleratorBuffer<uint32_t> m_peakResults;
+
+	ComputePipeline m_peakBlockScanComputePipeline;
+	ComputePipeline m_peakCandidatesComputePipeline;
+	ComputePipeline m_peakSelectComputePipeline;
+	ComputePipeline m_peakHistogramComputePipeline;
+	ComputePipeline m_peakEmitComputePipeline;
 };
 
 /**
@@ -217,6 +274,7 @@ protected:
 	template<class T>
 	void FindPeaks(T* cap, vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue)
 	{
+		//Uniform inputs resolve to the non-template overload, which can use the GPU
 		PeakDetector::FindPeaks(
 			cap,
 			m_parameters[m_numpeaksname].GetIntVal(),
@@ -0,0 +1,305 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of PerformanceTrace
+	@ingroup core
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+atomic<bool> PerformanceTrace::m_enabled(false);
+mutex PerformanceTrace::m_mutex;
+vector<PerformanceTrace::Event> PerformanceTrace::m_events;
+map<pair<uint32_t, uint64_t>, string> PerformanceTrace::m_trackNames;
+size_t PerformanceTrace::m_maxEvents = 1000000;
+size_t PerformanceTrace::m_droppedEvents = 0;
+atomic<uint64_t> PerformanceTrace::m_nextThreadTrack(1);
+vector<shared_ptr<PerformanceTraceRing>> PerformanceTrace::m_rings;
+vector<pair<uint64_t, PerformanceTraceRing::Span>> PerformanceTrace::m_spans;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Recording
+
+/**
+	@brief Records a completed range, if recording is enabled
+
+	@param name		Name of the range
+	@param category	Category of the range (must be a string literal)
+	@param pid		PID_CPU or PID_GPU
+	@param tid		Track within the process
+	@param start	Start time, in the GetTime() timebase
+	@param duration	Duration, in seconds
+ */
+void PerformanceTrace::AddEvent(
+	const string& name,
+	const char* category,
+	uint32_t pid,
+	uint64_t tid,
+	double start,
+	double duration)
+{
+	if(!IsEnabled())
+		return;
+
+	lock_guard<mutex> lock(m_mutex);
+	if(m_events.size() + m_spans.size() >= m_maxEvents)
+	{
+		m_droppedEvents ++;
+		return;
+	}
+
+	Event e;
+	e.m_name = name;
+	e.m_category = category;
+	e.m_pid = pid;
+	e.m_tid = tid;
+	e.m_start = start;
+	e.m_duration = duration;
+	m_events.push_back(std::move(e));
+}
+
+/**
+	@brief Sets the name a track is displayed under
+
+	Names are kept across calls to Clear().
+ */
+void PerformanceTrace::SetTrackName(uint32_t pid, uint64_t tid, const string& name)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_trackNames[pair<uint32_t, uint64_t>(pid, tid)] = name;
+}
+
+///@brief Gets the ID of the calling thread's track, which is assigned on first use
+uint64_t PerformanceTrace::GetThreadTrack()
+{
+	static thread_local uint64_t track = m_nextThreadTrack.fetch_add(1);
+	return track;
+}
+
+/**
+	@brief Gets the span ring of the calling thread, creating it on first use
+ */
+PerformanceTraceRing& PerformanceTrace::GetThreadRing()
+{
+	static thread_local shared_ptr<PerformanceTraceRing> ring;
+	if(!ring)
+	{
+		ring = make_shared<PerformanceTraceRing>(GetThreadTrack());
+
+		lock_guard<mutex> lock(m_mutex);
+		m_rings.push_back(ring);
+	}
+	return *ring;
+}
+
+/**
+	@brief Moves spans from every thread's ring into the event store
+
+	Rings whose thread has exited are released once empty. Must be called with m_mutex held.
+ */
+void PerformanceTrace::DrainRings()
+{
+	vector<PerformanceTraceRing::Span> spans;
+	for(size_t i=0; i<m_rings.size(); )
+	{
+		auto& ring = m_rings[i];
+
+		spans.clear();
+		ring->Drain(spans);
+		m_droppedEvents += ring->TakeDroppedCount();
+		for(auto& s : spans)
+		{
+			if(m_events.size() + m_spans.size() >= m_maxEvents)
+				m_droppedEvents ++;
+			else
+				m_spans.push_back(pair<uint64_t, PerformanceTraceRing::Span>(ring->GetTrack(), s));
+		}
+
+		//Only we hold a reference, so the thread is gone and nothing more can be pushed
+		if(ring.use_count() == 1)
+			m_rings.erase(m_rings.begin() + i);
+		else
+			i++;
+	}
+}
+
+///@brief Discards all recorded events
+void PerformanceTrace::Clear()
+{
+	lock_guard<mutex> lock(m_mutex);
+	DrainRings();
+	m_events.clear();
+	m_spans.clear();
+	m_droppedEvents = 0;
+}
+
+///@brief Gets the number of events currently recorded
+size_t PerformanceTrace::GetEventCount()
+{
+	lock_guard<mutex> lock(m_mutex);
+	DrainRings();
+	return m_events.size() + m_spans.size();
+}
+
+///@brief Gets the number of events dropped since the last Clear() because the limit was reached
+size_t PerformanceTrace::GetDroppedEventCount()
+{
+	lock_guard<mutex> lock(m_mutex);
+	DrainRings();
+	return m_droppedEvents;
+}
+
+///@brief Sets the maximum number of events to keep
+void PerformanceTrace::SetMaxEvents(size_t count)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_maxEvents = count;
+}
+
+///@brief Gets the maximum number of events to keep
+size_t PerformanceTrace::GetMaxEvents()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_maxEvents;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Export
+
+/**
+	@brief Escapes a string for use inside a JSON string literal
+ */
+string PerformanceTrace::EscapeJson(const string& str)
+{
+	string ret;
+	for(auto c : str)
+	{
+		if( (c == '"') || (c == '\\') )
+		{
+			ret += '\\';
+			ret += c;
+		}
+		else if(static_cast<unsigned char>(c) < 0x20)
+		{
+			char tmp[8];
+			snprintf(tmp, sizeof(tmp), "\\u%04x", c);
+			ret += tmp;
+		}
+		else
+			ret += c;
+	}
+	return ret;
+}
+
+/**
+	@brief Writes the recorded events to a file in the Chrome trace event format
+
+	The file can be opened in Perfetto (ui.perfetto.dev) or chrome://tracing. Timestamps are relative to the earliest
+	recorded event. Spans are written with nanosecond resolution.
+
+	@param path	Path of the file to write
+	@return True on success
+ */
+bool PerformanceTrace::ExportChromeTrace(const string& path)
+{
+	lock_guard<mutex> lock(m_mutex);
+	DrainRings();
+
+	FILE* fp = fopen(path.c_str(), "w");
+	if(!fp)
+	{
+		LogError("Failed to open trace file %s\n", path.c_str());
+		return false;
+	}
+
+	//Spans use the steady clock rather than GetTime(), so find the offset between the two.
+	//The origin is kept in span time as an integer so spans don't lose precision.
+	int64_t clockOffset = llround(GetTime() * 1e9) - GetTimestamp();
+	int64_t origin = 0;
+	bool haveOrigin = false;
+	for(auto& e : m_events)
+	{
+		int64_t start = llround(e.m_start * 1e9) - clockOffset;
+		if(!haveOrigin || (start < origin))
+			origin = start;
+		haveOrigin = true;
+	}
+	for(auto& it : m_spans)
+	{
+		if(!haveOrigin || (it.second.m_start < origin))
+			origin = it.second.m_start;
+		haveOrigin = true;
+	}
+
+	fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"CPU\"}},\n", PID_CPU);
+	fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"GPU\"}}", PID_GPU);
+	for(auto& it : m_trackNames)
+	{
+		fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%" PRIu64 ",\"args\":{\"name\":\"%s\"}}",
+			it.first.first, it.first.second, EscapeJson(it.second).c_str());
+	}
+	for(auto& e : m_events)
+	{
+		fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%" PRIu64
+			",\"ts\":%.3f,\"dur\":%.3f}",
+			EscapeJson(e.m_name).c_str(),
+			e.m_category,
+			e.m_pid,
+			e.m_tid,
+			(llround(e.m_start * 1e9) - clockOffset - origin) * 1e-3,
+			e.m_duration * 1e6);
+	}
+	for(auto& it : m_spans)
+	{
+		auto& s = it.second;
+		fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%" PRIu64
+			",\"ts\":%.3f,\"dur\":%.3f}",
+			EscapeJson(s.m_name).c_str(),
+			s.m_category,
+			PID_CPU,
+			it.first,
+			(s.m_start - origin) * 1e-3,
+			s.m_duration * 1e-3);
+	}
+	fprintf(fp, "\n]}\n");
+
+	bool ok = !ferror(fp);
+	fclose(fp);
+	if(!ok)
+		LogError("Failed to write trace file %s\n", path.c_str());
+	else if(m_droppedEvents)
+		LogWarning("Trace %s is incomplete: %zu events were dropped\n", path.c_str(), m_droppedEvents);
+	return ok;
+}
@@ -0,0 +1,421 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of PerformanceTrace and related classes
+	@ingroup core
+ */
+
+#ifndef PerformanceTrace_h
+#define PerformanceTrace_h
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+	@brief Counts work done by the calling thread which is of interest when profiling
+	@ingroup core
+
+	Each thread has its own counters, which only ever increase. To charge work to something, read the counters before
+	and after doing it.
+ */
+class PerformanceCounters
+{
+public:
+	PerformanceCounters()
+	: m_uploadBytes(0)
+	, m_readbackBytes(0)
+	, m_pipelineStallTime(0)
+	, m_reallocations(0)
+	, m_queueSubmits(0)
+	{}
+
+	///@brief Bytes copied from CPU to GPU memory by AcceleratorBuffer
+	uint64_t m_uploadBytes;
+
+	///@brief Bytes copied from GPU to CPU memory by AcceleratorBuffer
+	uint64_t m_readbackBytes;
+
+	///@brief Time spent waiting for compute pipelines to be created on first use, in seconds
+	double m_pipelineStallTime;
+
+	///@brief Number of AcceleratorBuffer reallocations
+	uint64_t m_reallocations;
+
+	///@brief Number of command buffers submitted to a QueueHandle
+	uint64_t m_queueSubmits;
+
+	///@brief Gets the counters of the calling thread
+	static PerformanceCounters& GetThreadCounters()
+	{
+		static thread_local PerformanceCounters counters;
+		return counters;
+	}
+};
+
+/**
+	@brief Fixed-size queue of completed spans, written by one thread and drained by PerformanceTrace
+	@ingroup core
+
+	Each thread which records a PerformanceTraceSpan gets its own ring, so recording a span never takes a lock. The
+	owning thread is the only producer and PerformanceTrace (under its mutex) the only consumer. Spans which arrive
+	while the ring is full are dropped and counted.
+ */
+class PerformanceTraceRing
+{
+public:
+
+	/**
+		@brief A completed span
+	 */
+	class Span
+	{
+	public:
+		///@brief Name of the span (must be a string literal)
+		const char* m_name;
+
+		///@brief Category of the span (must be a string literal)
+		const char* m_category;
+
+		///@brief Start time, in nanoseconds of PerformanceTrace::GetTimestamp()
+		int64_t m_start;
+
+		///@brief Duration, in nanoseconds
+		int64_t m_duration;
+	};
+
+	///@brief Number of spans the ring holds (must be a power of two)
+	static const size_t CAPACITY = 16384;
+
+	PerformanceTraceRing(uint64_t track)
+	: m_track(track)
+	, m_head(0)
+	, m_tail(0)
+	, m_dropped(0)
+	{}
+
+	/**
+		@brief Adds a span to the ring (owning thread only)
+	 */
+	void Push(const char* name, const char* category, int64_t start, int64_t duration)
+	{
+		uint64_t head = m_head.load(std::memory_order_relaxed);
+		if(head - m_tail.load(std::memory_order_acquire) >= CAPACITY)
+		{
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		auto& s = m_spans[head & (CAPACITY - 1)];
+		s.m_name = name;
+		s.m_category = category;
+		s.m_start = start;
+		s.m_duration = duration;
+		m_head.store(head + 1, std::memory_order_release);
+	}
+
+	/**
+		@brief Moves all spans in the ring to the end of a vector (consumer only)
+	 */
+	void Drain(std::vector<Span>& spans)
+	{
+		uint64_t tail = m_tail.load(std::memory_order_relaxed);
+		uint64_t head = m_head.load(std::memory_order_acquire);
+		for(; tail != head; tail++)
+			spans.push_back(m_spans[tail & (CAPACITY - 1)]);
+		m_tail.store(tail, std::memory_order_release);
+	}
+
+	///@brief Gets and resets the number of spans dropped because the ring was full
+	size_t TakeDroppedCount()
+	{ return m_dropped.exchange(0, std::memory_order_relaxed); }
+
+	///@brief Gets the track of the thread which owns the ring
+	uint64_t GetTrack()
+	{ return m_track; }
+
+protected:
+
+	///@brief Track of the owning thread
+	uint64_t m_track;
+
+	///@brief Total number of spans pushed
+	std::atomic<uint64_t> m_head;
+
+	///@brief Total number of spans drained
+	std::atomic<uint64_t> m_tail;
+
+	///@brief Number of spans dropped since the last TakeDroppedCount()
+	std::atomic<size_t> m_dropped;
+
+	///@brief Span storage
+	Span m_spans[CAPACITY];
+};
+
+/**
+	@brief Process-wide recorder of timed events, which can be saved as a Chrome / Perfetto trace
+	@ingroup core
+
+	Recording is disabled by default and costs a relaxed atomic load per event while disabled. Events are grouped into
+	tracks, identified by a process ID (PID_CPU for threads, PID_GPU for queues) and a track ID within it. CPU ranges
+	are usually recorded with PerformanceTraceRange, which also emits an NVTX range if NVTX support is compiled in, so
+	the same ranges show up in Nsight and in the trace.
+
+	Hot paths should use the SCOPEHAL_TRACE_SPAN() macro instead, which records into a lock-free per-thread
+	PerformanceTraceRing with nanosecond timestamps and compiles to nothing when SCOPEHAL_DISABLE_TRACING is defined.
+	If HAVE_TRACY is defined the macro also opens a Tracy zone. Rings are drained into the event store whenever the
+	trace is queried or exported.
+
+	At most GetMaxEvents() events are kept, after which new events are dropped (and counted) until Clear() is called.
+ */
+class PerformanceTrace
+{
+public:
+
+	///@brief Process ID of CPU thread tracks
+	static const uint32_t PID_CPU = 1;
+
+	///@brief Process ID of GPU queue tracks
+	static const uint32_t PID_GPU = 2;
+
+	///@brief Starts or stops recording events
+	static void SetEnabled(bool enable)
+	{ m_enabled = enable; }
+
+	///@brief Checks if events are being recorded
+	static bool IsEnabled()
+	{ return m_enabled.load(std::memory_order_relaxed); }
+
+	static void AddEvent(
+		const std::string& name,
+		const char* category,
+		uint32_t pid,
+		uint64_t tid,
+		double start,
+		double duration);
+	static void SetTrackName(uint32_t pid, uint64_t tid, const std::string& name);
+	static uint64_t GetThreadTrack();
+
+	///@brief Gets the timebase of spans, in nanoseconds
+	static int64_t GetTimestamp()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	static PerformanceTraceRing& GetThreadRing();
+
+	static void Clear();
+	static size_t GetEventCount();
+	static size_t GetDroppedEventCount();
+	static void SetMaxEvents(size_t count);
+	static size_t GetMaxEvents();
+
+	static bool ExportChromeTrace(const std::string& path);
+	static std::string EscapeJson(const std::string& str);
+
+protected:
+	static void DrainRings();
+
+	/**
+		@brief A single completed range
+	 */
+	class Event
+	{
+	public:
+		///@brief Name of the range
+		std::string m_name;
+
+		///@brief Category of the range (must be a string literal)
+		const char* m_category;
+
+		///@brief Process ID of the track
+		uint32_t m_pid;
+
+		///@brief ID of the track within the process
+		uint64_t m_tid;
+
+		///@brief Start time, in the GetTime() timebase
+		double m_start;
+
+		///@brief Duration, in seconds
+		double m_duration;
+	};
+
+	///@brief True if events are being recorded
+	static std::atomic<bool> m_enabled;
+
+	///@brief Mutex protecting everything below
+	static std::mutex m_mutex;
+
+	///@brief The recorded events, in order of completion
+	static std::vector<Event> m_events;
+
+	///@brief Names of tracks, by process and track ID
+	static std::map<std::pair<uint32_t, uint64_t>, std::string> m_trackNames;
+
+	///@brief Maximum number of events to keep
+	static size_t m_maxEvents;
+
+	///@brief Number of events dropped since the last Clear()
+	static size_t m_droppedEvents;
+
+	///@brief Next track ID to assign to a thread
+	static std::atomic<uint64_t> m_nextThreadTrack;
+
+	///@brief Rings of every thread which has recorded a span (kept alive after the thread exits until drained)
+	static std::vector<std::shared_ptr<PerformanceTraceRing>> m_rings;
+
+	///@brief Spans drained from the rings, with the track they were recorded on
+	static std::vector<std::pair<uint64_t, PerformanceTraceRing::Span>> m_spans;
+};
+
+/**
+	@brief Records the lifetime of the object as a span on the calling thread's ring
+	@ingroup core
+
+	Intended for hot paths: while recording is disabled the cost is one relaxed atomic load, and while enabled nothing
+	is allocated or locked. Use through SCOPEHAL_TRACE_SPAN() so it can be compiled out.
+ */
+class PerformanceTraceSpan
+{
+public:
+	PerformanceTraceSpan(const char* name, const char* category)
+	: m_name(name)
+	, m_category(category)
+	, m_start(PerformanceTrace::IsEnabled() ? PerformanceTrace::GetTimestamp() : 0)
+	{}
+
+	~PerformanceTraceSpan()
+	{
+		if(m_start != 0)
+		{
+			PerformanceTrace::GetThreadRing().Push(
+				m_name, m_category, m_start, PerformanceTrace::GetTimestamp() - m_start);
+		}
+	}
+
+public:
+	//non-copyable
+	PerformanceTraceSpan(PerformanceTraceSpan const&) = delete;
+	PerformanceTraceSpan& operator=(PerformanceTraceSpan const&) = delete;
+
+protected:
+	///@brief Name of the span (must be a string literal)
+	const char* m_name;
+
+	///@brief Category of the span (must be a string literal)
+	const char* m_category;
+
+	///@brief Start time, or zero if not recording
+	int64_t m_start;
+};
+
+#define SCOPEHAL_TRACE_CONCAT2(a, b) a ## b
+#define SCOPEHAL_TRACE_CONCAT(a, b) SCOPEHAL_TRACE_CONCAT2(a, b)
+
+/**
+	@brief Records the rest of the enclosing scope as a span (name and category must be string literals)
+	@ingroup core
+ */
+#if defined(SCOPEHAL_DISABLE_TRACING)
+	#define SCOPEHAL_TRACE_SPAN(name, category)
+#elif defined(HAVE_TRACY)
+	#define SCOPEHAL_TRACE_SPAN(name, category) \
+		ZoneScopedN(name); \
+		PerformanceTraceSpan SCOPEHAL_TRACE_CONCAT(traceSpan_, __LINE__)(name, category)
+#else
+	#define SCOPEHAL_TRACE_SPAN(name, category) \
+		PerformanceTraceSpan SCOPEHAL_TRACE_CONCAT(traceSpan_, __LINE__)(name, category)
+#endif
+
+/**
+	@brief Records the lifetime of the object as a range on the calling thread's track
+	@ingroup core
+
+	Also emits an NVTX range of the same name if NVTX support is compiled in.
+ */
+class PerformanceTraceRange
+{
+public:
+	PerformanceTraceRange(const std::string& name, const char* category = "cpu")
+#ifdef HAVE_NVTX
+	: m_range(name)
+	, m_category(category)
+#else
+	: m_category(category)
+#endif
+	, m_start(0)
+	{
+		if(PerformanceTrace::IsEnabled())
+		{
+			m_name = name;
+			m_start = GetTime();
+		}
+	}
+
+	~PerformanceTraceRange()
+	{
+		if(m_start != 0)
+		{
+			PerformanceTrace::AddEvent(
+				m_name, m_category, PerformanceTrace::PID_CPU, PerformanceTrace::GetThreadTrack(),
+				m_start, GetTime() - m_start);
+		}
+	}
+
+public:
+	//non-copyable
+	PerformanceTraceRange(PerformanceTraceRange const&) = delete;
+	PerformanceTraceRange& operator=(PerformanceTraceRange const&) = delete;
+
+protected:
+#ifdef HAVE_NVTX
+	///@brief The NVTX range
+	nvtx3::scoped_range m_range;
+#endif
+
+	///@brief Name of the range (only set if recording)
+	std::string m_name;
+
+	///@brief Category of the range
+	const char* m_category;
+
+	///@brief Start time, or zero if not recording
+	double m_start;
+};
+
+#endif
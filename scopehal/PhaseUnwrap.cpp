@@ -0,0 +1,102 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of phase unwrapping helpers
+	@ingroup core
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+/**
+	@brief Unwraps a sequence of phase angles
+
+	Unwrapping is a running sum of wrapped differences, which looks inherently serial. It is done here as a prefix
+	scan instead: each step contributes a whole number of periods (see PhaseWrapCount()), the counts are summed per
+	block in parallel, the block totals are scanned, then every block rebuilds its output in parallel as the input
+	plus its running count of periods. Since the counts are integers the result also doesn't drift the way a float
+	accumulator does over millions of points.
+
+	@param in		Wrapped input phases
+	@param len		Number of input phases
+	@param out		Output buffer, with room for len - first values
+	@param first	Index of the first unwrapped phase to write to out (earlier points are still used for unwrapping)
+	@param period	Length of one turn (360 for degrees, 2*pi for radians)
+ */
+void UnwrapPhase(const float* in, size_t len, float* out, size_t first, float period)
+{
+	if(len <= first)
+		return;
+
+	const size_t blocksize = 65536;
+	size_t nblocks = (len + blocksize - 1) / blocksize;
+
+	//Net number of wraps within each block (step i-1 to i belongs to the block containing i)
+	vector<int64_t> wraps(nblocks + 1, 0);
+	ParallelFor(0, nblocks, 1, [&](size_t firstBlock, size_t lastBlock)
+	{
+		for(size_t nblock = firstBlock; nblock < lastBlock; nblock++)
+		{
+			size_t start = max(nblock * blocksize, (size_t)1);
+			size_t end = min(len, (nblock + 1) * blocksize);
+
+			int64_t count = 0;
+			for(size_t i=start; i<end; i++)
+				count += PhaseWrapCount(in[i-1], in[i], period);
+			wraps[nblock + 1] = count;
+		}
+	});
+
+	//Exclusive scan of the block totals
+	for(size_t i=0; i<nblocks; i++)
+		wraps[i+1] += wraps[i];
+
+	//Rebuild each block from its starting count
+	ParallelFor(0, nblocks, 1, [&](size_t firstBlock, size_t lastBlock)
+	{
+		for(size_t nblock = firstBlock; nblock < lastBlock; nblock++)
+		{
+			size_t start = nblock * blocksize;
+			size_t end = min(len, (nblock + 1) * blocksize);
+
+			int64_t count = wraps[nblock];
+			for(size_t i=start; i<end; i++)
+			{
+				if(i > 0)
+					count += PhaseWrapCount(in[i-1], in[i], period);
+				if(i >= first)
+					out[i - first] = in[i] + count * period;
+			}
+		}
+	});
+}
@@ -0,0 +1,74 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of phase unwrapping helpers
+	@ingroup core
+ */
+
+#ifndef PhaseUnwrap_h
+#define PhaseUnwrap_h
+
+/**
+	@brief Gets the number of whole periods to add to the step from lo to hi to make it as short as possible
+	@ingroup core
+
+	Inputs are assumed to be wrapped into a single period (e.g. +/- 180 degrees), so a step never needs more than one.
+
+	@param lo		Phase of the earlier point
+	@param hi		Phase of the later point
+	@param period	Length of one turn (360 for degrees, 2*pi for radians)
+ */
+inline int PhaseWrapCount(float lo, float hi, float period)
+{
+	float d = hi - lo;
+	float half = period / 2;
+	if(d > half)
+		return -1;
+	if(d < -half)
+		return 1;
+	return 0;
+}
+
+/**
+	@brief Subtracts two phase angles, wrapping correctly around the singularity
+	@ingroup core
+
+	@param lo		Phase of the earlier point
+	@param hi		Phase of the later point
+	@param period	Length of one turn (360 for degrees, 2*pi for radians)
+ */
+inline float WrappedPhaseDelta(float lo, float hi, float period)
+{ return (hi - lo) + PhaseWrapCount(lo, hi, period) * period; }
+
+void UnwrapPhase(const float* in, size_t len, float* out, size_t first = 0, float period = 360);
+
+#endif
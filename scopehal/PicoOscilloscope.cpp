@@ -65,6 +65,9 @@ PicoOscilloscope::PicoOscilloscope(SCPITransport* transport)
 	, m_dropUntilSeq(0)
 	, m_nextWaveformWriteBuffer(0)
 {
+	//Streaming instrument: if we get backed up, drop old waveforms rather than falling further behind
+	SetPendingWaveformPolicy(PENDING_DROP_OLDEST, 2);
+
 	//Set up initial cache configuration as "not valid" and let it populate as we go
 
 	IdentifyHardware();
@@ -293,38 +296,7 @@ PicoOscilloscope::PicoOscilloscope(SCPITransport* transport)
 		m_analogRawWaveformBuffers[i]->SetGpuAccessHint(AcceleratorBuffer<int16_t>::HINT_LIKELY);
 	}
 
-	//Create Vulkan objects for the waveform conversion
-	m_queue = g_vkQueueManager->GetComputeQueue("PicoOscilloscope.queue");
-	vk::CommandPoolCreateInfo poolInfo(
-		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-		m_queue->m_family );
-
-	m_pool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo);
-
-	vk::CommandBufferAllocateInfo bufinfo(**m_pool, vk::CommandBufferLevel::ePrimary, 1);
-	m_cmdBuf = make_unique<vk::raii::CommandBuffer>(
-		std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
-
-	if(g_hasDebugUtils)
-	{
-		string poolname = "PicoOscilloscope.pool";
-		string bufname = "PicoOscilloscope.cmdbuf";
-
-		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
-			vk::DebugUtilsObjectNameInfoEXT(
-				vk::ObjectType::eCommandPool,
-				reinterpret_cast<uint64_t>(static_cast<VkCommandPool>(**m_pool)),
-				poolname.c_str()));
-
-		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
-			vk::DebugUtilsObjectNameInfoEXT(
-				vk::ObjectType::eCommandBuffer,
-				reinterpret_cast<uint64_t>(static_cast<VkCommandBuffer>(**m_cmdBuf)),
-				bufname.c_str()));
-	}
-
-	m_conversionPipeline = make_unique<ComputePipeline>(
-			"shaders/Convert16BitSamples.spv", 2, sizeof(ConvertRawSamplesShaderArgs) );
+	m_converter = make_unique<RawSampleConverter>("PicoOscilloscope");
 }
 
 /**
@@ -765,25 +737,11 @@ void PicoOscilloscope::PushPendingWaveformsIfReady()
 		return;
 
 	//Wait up to 1ms for GPU side conversion to finish and return if it's not done
-	if(!m_queue->WaitIdleWithTimeout(1000 * 1000))
+	if(!m_converter->WaitIdleWithTimeout(1000 * 1000))
 		return;
 
-	//Save the waveforms to our queue
-	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(m_wipWaveforms);
-
-	//If we got backed up, drop the extra waveforms
-	while (m_pendingWaveforms.size() > 2)
-	{
-		LogTrace("Dropping waveform due to excessive pend queue depth\n");
-
-		SequenceSet set = *m_pendingWaveforms.begin();
-		for(auto it : set)
-			AddWaveformToAnalogPool(it.second);
-		m_pendingWaveforms.pop_front();
-	}
-
-	m_pendingWaveformsMutex.unlock();
+	//Save the waveforms to our queue (if we got backed up, the oldest ones are dropped)
+	PushPendingWaveform(m_wipWaveforms);
 	m_wipWaveforms.clear();
 }
 
@@ -794,7 +752,7 @@ Oscilloscope::TriggerMode PicoOscilloscope::PollTrigger()
 		return TRIGGER_MODE_STOP;
 
 	//See if we have data ready
-	if(dynamic_cast<SCPITwinLanTransport*>(m_transport)->GetSecondarySocket().GetRxBytesAvailable() > 0)
+	if(dynamic_cast<SCPITwinLanTransport*>(m_transport)->GetDataBytesAvailable() > 0)
 	{
 		#ifdef HAVE_NVTX
 			nvtxMark("PollTrigger");
@@ -824,9 +782,8 @@ bool PicoOscilloscope::AcquireData()
 
 bool PicoOscilloscope::DoAcquireData(bool keep)
 {
-	#ifdef HAVE_NVTX
-		nvtx3::scoped_range range("PicoOscilloscope::DoAcquireData");
-	#endif
+	//Also shows up as an NVTX range, if enabled
+	PerformanceTraceRange range("PicoOscilloscope::DoAcquireData", "acquisition");
 
 	#pragma pack(push, 1)
 	struct
@@ -911,7 +868,6 @@ bool PicoOscilloscope::DoAcquireData(bool keep)
 			cap->m_triggerPhase = trigphase;
 			cap->m_startTimestamp = time(NULL);
 			cap->m_startFemtoseconds = fs;
-			cap->Resize(memdepth);
 
 			//Clear out any previously pending waveforms before we queue up this one
 			if(i == 0)
@@ -919,44 +875,17 @@ bool PicoOscilloscope::DoAcquireData(bool keep)
 
 			m_wipWaveforms[GetOscilloscopeChannel(chnum)] = cap;
 
-			if(g_hasShaderInt16)
+			//If the conversion would have to be done on the CPU, keep the raw codes and only convert them
+			//if something downstream actually needs floating point samples
+			if(RawSampleConverter::IsGpuConversionAvailable16Bit())
 			{
-				m_queue->WaitIdle();
-				m_cmdBuf->begin({});
-
-				m_conversionPipeline->BindBufferNonblocking(0, cap->m_samples, *m_cmdBuf, true);
-				m_conversionPipeline->BindBufferNonblocking(1, *abuf, *m_cmdBuf);
-
-				ConvertRawSamplesShaderArgs args;
-				args.size = cap->size();
-				args.gain = scale;
-				args.offset = -offset;
-
-				const uint32_t compute_block_count = GetComputeBlockCount(cap->size(), 64);
-				m_conversionPipeline->Dispatch(
-					*m_cmdBuf, args,
-					min(compute_block_count, 32768u),
-					compute_block_count / 32768 + 1);
-
-				cap->MarkModifiedFromGpu();
-
-				m_cmdBuf->end();
-				m_queue->Submit(*m_cmdBuf);
-
+				cap->Resize(memdepth);
+				m_converter->Convert16Bit(cap, *abuf, scale, offset);
+				m_converter->Submit();
 				processedWaveformsOnGPU = true;
 			}
 			else
-			{
-				cap->PrepareForCpuAccess();
-				Convert16BitSamples(
-					cap->m_samples.GetCpuPointer(),
-					abuf->GetCpuPointer(),
-					scale,
-					-offset,
-					cap->size());
-
-				cap->MarkSamplesModifiedFromCpu();
-			}
+				cap->SetRawSamples16Bit(abuf->GetCpuPointer(), memdepth, scale, offset);
 		}
 
 		//Digital pod
@@ -201,6 +201,9 @@ protected:
 
 	void PushPendingWaveformsIfReady();
 
+	virtual void RecyclePendingWaveform(WaveformBase* w) override
+	{ AddWaveformToAnalogPool(w); }
+
 	//Helpers for determining legal configurations
 	bool Is10BitModeAvailable();
 	bool Is12BitModeAvailable();
@@ -290,11 +293,8 @@ protected:
 	///@brief Index of next buffer from m_analogRawWaveformBuffers to use
 	unsigned int m_nextWaveformWriteBuffer;
 
-	//Vulkan waveform conversion
-	std::shared_ptr<QueueHandle> m_queue;
-	std::unique_ptr<vk::raii::CommandPool> m_pool;
-	std::unique_ptr<vk::raii::CommandBuffer> m_cmdBuf;
-	std::unique_ptr<ComputePipeline> m_conversionPipeline;
+	///@brief Converts raw ADC codes to float32 samples
+	std::unique_ptr<RawSampleConverter> m_converter;
 
 	///@brief Mutex for m_wipWaveforms
 	std::recursive_mutex m_wipWaveformMutex;
@@ -178,9 +178,9 @@ bool PicoVNA::AcquireData()
 
 	double tstart = 0;
 	int64_t fs = 0;
+	double lastPartial = 0;
 
-	//For now, we don't support streaming of partial waveforms.
-	//Just wait for the complete waveform to show up, then display it in one block.
+	//Read blocks until the sweep is complete, optionally pushing snapshots of the sweep so far as we go
 	while(true)
 	{
 		//Read the packet header
@@ -230,6 +230,7 @@ bool PicoVNA::AcquireData()
 			//Save capture timestamp (TODO: get this in header)
 			tstart = GetTime();
 			fs = (tstart - floor(tstart)) * FS_PER_SECOND;
+			lastPartial = tstart;
 
 			for(int i=0; i<2; i++)
 			{
@@ -316,6 +317,18 @@ bool PicoVNA::AcquireData()
 				ChannelsDownloadStatusUpdate(i, InstrumentChannel::DownloadState::DOWNLOAD_FINISHED, 1.0);
 			break;
 		}
+
+		//Sweep still in progress, show what we have so far if it's been long enough since the last update
+		if( (m_partialSweepInterval > 0) && m_triggerArmed )
+		{
+			double now = GetTime();
+			if( (now - lastPartial) >= m_partialSweepInterval)
+			{
+				lastPartial = now;
+				m_rbw = ((sweepStopmHz - sweepStartmHz) * 1e-3) / numPointsAllocated;
+				PushSweep(mags, angles, expectedFirstSample, sweepStartmHz, tstart, fs, true);
+			}
+		}
 	}
 
 	float sweepSpanmHz = sweepStopmHz - sweepStartmHz;
@@ -323,61 +336,11 @@ bool PicoVNA::AcquireData()
 
 	//If we sent a stop command mid acquisition, discard the data now.
 	//So only proceed here if trigger is armed.
-	float angscale = 180 / M_PI;	//we use degrees for display
 	bool skipping = false;
 	if(!m_triggerArmed)
 		skipping = true;
 	else
-	{
-		//Process and convert sample data
-		SequenceSet s;
-		for(int dest=0; dest<2; dest++)
-		{
-			for(int src=0; src<2; src++)
-			{
-				int nchan = dest*2 + src;
-				auto chan = m_channels[nchan];
-
-				double* mag = mags[dest][src];
-				double* angle = angles[dest][src];
-
-				//Create the waveforms
-				auto mcap = new UniformAnalogWaveform;
-				mcap->m_timescale = m_rbw;
-				mcap->m_triggerPhase = sweepStartmHz * 1e-3;
-				mcap->m_startTimestamp = floor(tstart);
-				mcap->m_startFemtoseconds = fs;
-				mcap->PrepareForCpuAccess();
-
-				auto acap = new UniformAnalogWaveform;
-				acap->m_timescale = m_rbw;
-				acap->m_triggerPhase = sweepStartmHz * 1e-3;
-				acap->m_startTimestamp = floor(tstart);
-				acap->m_startFemtoseconds = fs;
-				acap->PrepareForCpuAccess();
-
-				//Make content for display (dB and degrees)
-				mcap->Resize(numPointsAllocated);
-				acap->Resize(numPointsAllocated);
-				for(size_t i=0; i<numPointsAllocated; i++)
-				{
-					mcap->m_samples[i] = 20 * log10(mag[i]);
-					acap->m_samples[i] = angle[i] * angscale;
-				}
-
-				acap->MarkModifiedFromCpu();
-				mcap->MarkModifiedFromCpu();
-
-				s[StreamDescriptor(chan, 0)] = mcap;
-				s[StreamDescriptor(chan, 1)] = acap;
-			}
-		}
-
-		//Save the waveforms to our queue
-		m_pendingWaveformsMutex.lock();
-		m_pendingWaveforms.push_back(s);
-		m_pendingWaveformsMutex.unlock();
-	}
+		PushSweep(mags, angles, numPointsAllocated, sweepStartmHz, tstart, fs, false);
 
 	//Done, clean up
 	for(int i=0; i<2; i++)
@@ -443,6 +406,78 @@ bool PicoVNA::IsTriggerArmed()
 	return m_triggerArmed;
 }
 
+/**
+	@brief Converts the first npoints points of a sweep to dB / degrees waveforms and pushes them to the queue
+
+	@param mags				Linear magnitude of each S-parameter, indexed by [dest][src]
+	@param angles			Angle of each S-parameter in radians, indexed by [dest][src]
+	@param npoints			Number of points to convert
+	@param sweepStartmHz	Start frequency of the sweep, in mHz
+	@param tstart			Time the sweep started
+	@param fs				Fractional part of tstart, in femtoseconds
+	@param partial			True if the sweep isn't done yet and the waveforms should be flagged WAVEFORM_PARTIAL
+ */
+void PicoVNA::PushSweep(
+	double* mags[2][2],
+	double* angles[2][2],
+	size_t npoints,
+	uint64_t sweepStartmHz,
+	double tstart,
+	int64_t fs,
+	bool partial)
+{
+	float angscale = 180 / M_PI;	//we use degrees for display
+	uint8_t flags = partial ? WaveformBase::WAVEFORM_PARTIAL : 0;
+
+	SequenceSet s;
+	for(int dest=0; dest<2; dest++)
+	{
+		for(int src=0; src<2; src++)
+		{
+			int nchan = dest*2 + src;
+			auto chan = m_channels[nchan];
+
+			double* mag = mags[dest][src];
+			double* angle = angles[dest][src];
+
+			//Create the waveforms
+			auto mcap = new UniformAnalogWaveform;
+			mcap->m_timescale = m_rbw;
+			mcap->m_triggerPhase = sweepStartmHz * 1e-3;
+			mcap->m_startTimestamp = floor(tstart);
+			mcap->m_startFemtoseconds = fs;
+			mcap->m_flags = flags;
+			mcap->PrepareForCpuAccess();
+
+			auto acap = new UniformAnalogWaveform;
+			acap->m_timescale = m_rbw;
+			acap->m_triggerPhase = sweepStartmHz * 1e-3;
+			acap->m_startTimestamp = floor(tstart);
+			acap->m_startFemtoseconds = fs;
+			acap->m_flags = flags;
+			acap->PrepareForCpuAccess();
+
+			//Make content for display (dB and degrees)
+			mcap->Resize(npoints);
+			acap->Resize(npoints);
+			for(size_t i=0; i<npoints; i++)
+			{
+				mcap->m_samples[i] = 20 * log10(mag[i]);
+				acap->m_samples[i] = angle[i] * angscale;
+			}
+
+			acap->MarkModifiedFromCpu();
+			mcap->MarkModifiedFromCpu();
+
+			s[StreamDescriptor(chan, 0)] = mcap;
+			s[StreamDescriptor(chan, 1)] = acap;
+		}
+	}
+
+	//Save the waveforms to our queue
+	PushPendingWaveform(s);
+}
+
 vector<uint64_t> PicoVNA::GetSampleDepthsNonInterleaved()
 {
 	vector<uint64_t> ret;
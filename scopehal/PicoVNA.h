@@ -86,6 +86,15 @@ public:
 protected:
 	std::string GetChannelColor(size_t i);
 
+	void PushSweep(
+		double* mags[2][2],
+		double* angles[2][2],
+		size_t npoints,
+		uint64_t sweepStartmHz,
+		double tstart,
+		int64_t fs,
+		bool partial);
+
 	bool m_triggerArmed;
 	bool m_triggerOneShot;
 
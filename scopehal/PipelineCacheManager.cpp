@@ -31,6 +31,7 @@
 #include "PipelineCacheManager.h"
 #include "FileSystem.h"
 #include "VulkanFFTPlan.h"
+#include <filesystem>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -38,6 +39,7 @@
 #include <shlobj.h>
 #else
 #include <sys/stat.h>
+#include <unistd.h>
 #include <wordexp.h>
 #endif
 
@@ -146,18 +148,22 @@ void PipelineCacheManager::StoreRaw(const string& key, shared_ptr< vector<uint8_
 }
 
 /**
-	@brief Returns a Vulkan pipeline cache object for the given path.
+	@brief Returns a Vulkan pipeline cache object for the given key.
 
-	If not found, a new cache object is created and returned.
+	If not found, or if the cached object was built from a different version of the content, a new cache object is
+	created and returned.
+
+	@param key		Name of the cache entry
+	@param version	Version of the content being cached (e.g. a hash of the shader binary)
  */
-shared_ptr<vk::raii::PipelineCache> PipelineCacheManager::Lookup(const string& key, time_t target)
+shared_ptr<vk::raii::PipelineCache> PipelineCacheManager::Lookup(const string& key, int64_t version)
 {
 	lock_guard<mutex> lock(m_mutex);
 
 	//Already in the cache? Return that copy
 	if(m_vkCache.find(key) != m_vkCache.end())
 	{
-		if(m_vkCacheTimestamps[key] != target)
+		if(m_vkCacheVersions[key] != version)
 			LogTrace("Ignoring out of date cache entry for %s\n", key.c_str());
 		else
 		{
@@ -171,7 +177,7 @@ shared_ptr<vk::raii::PipelineCache> PipelineCacheManager::Lookup(const string& k
 	vk::PipelineCacheCreateInfo info({},{});
 	auto ret = make_shared<vk::raii::PipelineCache>(*g_vkComputeDevice, info);
 	m_vkCache[key] = ret;
-	m_vkCacheTimestamps[key] = target;
+	m_vkCacheVersions[key] = version;
 
 	//Name it
 	if(g_hasDebugUtils)
@@ -190,6 +196,122 @@ shared_ptr<vk::raii::PipelineCache> PipelineCacheManager::Lookup(const string& k
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Serialization
 
+/**
+	@brief Reads a single cache file, and checks that it's intact and was made for our device and driver
+
+	@param path		Path to the file
+	@param header	Header of the file
+	@param data		Content of the file
+
+	@return True if the file is valid
+ */
+bool PipelineCacheManager::ReadFile(const string& path, PipelineCacheFileHeader& header, shared_ptr<vector<uint8_t> >& data)
+{
+	FILE* fp = fopen(path.c_str(), "rb");
+	if(!fp)
+		return false;
+
+	//Read the header and make sure it checks out
+	if(1 != fread(&header, sizeof(header), 1, fp))
+	{
+		LogWarning("Read cache header failed (%s)\n", path.c_str());
+		fclose(fp);
+		return false;
+	}
+
+	if(0 != memcmp(header.cache_uuid, g_vkComputeDeviceUuid, 16))
+	{
+		LogTrace("Rejecting cache file (%s) due to mismatching UUID\n", path.c_str());
+		fclose(fp);
+		return false;
+	}
+	if(header.vkfft_ver != VkFFTGetVersion())
+	{
+		LogTrace("Rejecting cache file (%s) due to mismatching vkFFT version\n", path.c_str());
+		fclose(fp);
+		return false;
+	}
+	if(header.driver_ver != g_vkComputeDeviceDriverVer)
+	{
+		LogTrace("Rejecting cache file (%s) due to mismatching driver version\n", path.c_str());
+		fclose(fp);
+		return false;
+	}
+
+	//All good. Read the file content
+	data = make_shared< vector<uint8_t> >();
+	data->resize(header.len);
+	if( (header.len == 0) || (header.len != fread(&((*data)[0]), 1, header.len, fp)) )
+	{
+		LogWarning("Read cache content failed (%s)\n", path.c_str());
+		fclose(fp);
+		return false;
+	}
+	fclose(fp);
+
+	//Verify the CRC
+	if(header.crc != CRC32(*data))
+	{
+		LogWarning("Rejecting cache file (%s) due to bad CRC\n", path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+/**
+	@brief Writes a single cache file
+
+	The content is written to a temporary file which then replaces the old one, so another process loading the cache
+	at the same time sees either the old file or the new one, never a partial write.
+
+	@param path		Path to the file
+	@param header	Header of the file (length and CRC are filled in here)
+	@param data		Content of the file
+ */
+void PipelineCacheManager::WriteFile(const string& path, PipelineCacheFileHeader& header, const vector<uint8_t>& data)
+{
+	if(data.empty())
+		return;
+
+#ifdef _WIN32
+	auto tmpPath = path + ".tmp" + to_string(GetCurrentProcessId());
+#else
+	auto tmpPath = path + ".tmp" + to_string(getpid());
+#endif
+
+	FILE* fp = fopen(tmpPath.c_str(), "wb");
+	if(!fp)
+	{
+		LogWarning("Failed to create cache file (%s)\n", tmpPath.c_str());
+		return;
+	}
+
+	//Write the cache header
+	header.len = data.size();
+	header.crc = CRC32(data);
+	bool ok = (1 == fwrite(&header, sizeof(header), 1, fp));
+	if(!ok)
+		LogWarning("Write cache header failed (%s)\n", path.c_str());
+
+	//Write the data
+	else if(header.len != fwrite(&data[0], 1, header.len, fp))
+	{
+		LogWarning("Write cache data failed (%s)\n", path.c_str());
+		ok = false;
+	}
+
+	if(0 != fclose(fp))
+		ok = false;
+
+	//Swap it in
+	error_code ec;
+	if(ok)
+		filesystem::rename(tmpPath, path, ec);
+	if(!ok || ec)
+		filesystem::remove(tmpPath, ec);
+}
+
 /**
 	@brief Loads cache content from disk
  */
@@ -200,16 +322,13 @@ void PipelineCacheManager::LoadFromDisk()
 	LogTrace("Loading pipeline cache\n");
 	LogIndenter li;
 
-	PipelineCacheFileHeader header;
-	int vkfft_expected = VkFFTGetVersion();
-
 	string rawPrefix = "raw_";
 	string shaderPrefix = "pipeline_";
 	string shaderSuffix = ".bin";
 
 	//Load raw binary blobs (mostly for vkFFT)
 	auto prefix = m_cacheRootDir + "shader_";
-	auto files = Glob(prefix + "*", false);
+	auto files = Glob(prefix + "*" + shaderSuffix, false);
 	for(auto f : files)
 	{
 		if(f.find(prefix) == string::npos)
@@ -224,54 +343,13 @@ void PipelineCacheManager::LoadFromDisk()
 		else
 			key = key.substr(shaderPrefix.length());
 
-		//Read the header and make sure it checks out
-		FILE* fp = fopen(f.c_str(), "rb");
-		if(1 != fread(&header, sizeof(header), 1, fp))
-		{
-			LogWarning("Read cache header failed (%s)\n", f.c_str());
-			fclose(fp);
-			continue;
-		}
-
-		LogTrace("Loading cache object %s (from %s, timestamp %zu)\n", key.c_str(), f.c_str(), (size_t)header.file_mtime);
+		LogTrace("Loading cache object %s (from %s)\n", key.c_str(), f.c_str());
 		LogIndenter li2;
 
-		if(0 != memcmp(header.cache_uuid, g_vkComputeDeviceUuid, 16))
-		{
-			LogTrace("Rejecting cache file (%s) due to mismatching UUID\n", f.c_str());
-			fclose(fp);
-			continue;
-		}
-		if(header.vkfft_ver != vkfft_expected)
-		{
-			LogTrace("Rejecting cache file (%s) due to mismatching vkFFT version\n", f.c_str());
-			fclose(fp);
-			continue;
-		}
-		if(header.driver_ver != g_vkComputeDeviceDriverVer)
-		{
-			LogTrace("Rejecting cache file (%s) due to mismatching driver version\n", f.c_str());
-			fclose(fp);
-			continue;
-		}
-
-		//All good. Read the file content
-		auto p = make_shared< vector<uint8_t> >();
-		p->resize(header.len);
-		if(header.len != fread(&((*p)[0]), 1, header.len, fp))
-		{
-			LogWarning("Read cache content failed (%s)\n", f.c_str());
-			fclose(fp);
-			continue;
-		}
-		fclose(fp);
-
-		//Verify the CRC
-		if(header.crc != CRC32(*p))
-		{
-			LogWarning("Rejecting cache file (%s) due to bad CRC\n", f.c_str());
+		PipelineCacheFileHeader header;
+		shared_ptr<vector<uint8_t> > p;
+		if(!ReadFile(f, header, p))
 			continue;
-		}
 
 		//Done, add to cache if we get this far
 		if(typeIsRaw)
@@ -282,7 +360,7 @@ void PipelineCacheManager::LoadFromDisk()
 			vk::PipelineCacheCreateInfo info({}, vec.size(), &vec[0]);
 			auto ret = make_shared<vk::raii::PipelineCache>(*g_vkComputeDevice, info);
 			m_vkCache[key] = ret;
-			m_vkCacheTimestamps[key] = header.file_mtime;
+			m_vkCacheVersions[key] = header.version;
 		}
 	}
 }
@@ -309,24 +387,9 @@ void PipelineCacheManager::SaveToDisk()
 		auto& vec = *it.second;
 		auto fname = m_cacheRootDir + "shader_raw_" + key + ".bin";
 		LogTrace("Saving shader %s (%zu bytes)\n", fname.c_str(), vec.size());
-		FILE* fp = fopen(fname.c_str(), "wb");
-
-		//Write the cache header
-		header.len = vec.size();
-		header.crc = CRC32(vec);
-		header.file_mtime = 0;	//not used
-		if(1 != fwrite(&header, sizeof(header), 1, fp))
-		{
-			LogWarning("Write cache header failed (%s)\n", fname.c_str());
-			fclose(fp);
-			continue;
-		}
-
-		//Write the data
-		if(header.len != fwrite(&vec[0], 1, header.len, fp))
-			LogWarning("Write cache data failed (%s)\n", fname.c_str());
 
-		fclose(fp);
+		header.version = 0;	//not used
+		WriteFile(fname, header, vec);
 	}
 
 	//Save Vulkan shader cache
@@ -334,29 +397,31 @@ void PipelineCacheManager::SaveToDisk()
 	{
 		auto key = it.first;
 		auto pcache = it.second;
+		auto version = m_vkCacheVersions[key];
 		auto fname = m_cacheRootDir + "shader_pipeline_" + key + ".bin";
 
-		//Extract the raw shader content
-		auto vec = pcache->getData();
-		LogTrace("Saving shader %s (%zu bytes)\n", fname.c_str(), vec.size());
-
-		FILE* fp = fopen(fname.c_str(), "wb");
-
-		//Write the cache header
-		header.len = vec.size();
-		header.crc = CRC32(vec);
-		header.file_mtime = m_vkCacheTimestamps[key];
-		if(1 != fwrite(&header, sizeof(header), 1, fp))
+		//If another instance saved this pipeline since we loaded it, keep whatever it compiled that we didn't
+		PipelineCacheFileHeader oldHeader;
+		shared_ptr<vector<uint8_t> > oldData;
+		if(ReadFile(fname, oldHeader, oldData) && (oldHeader.version == version))
 		{
-			LogWarning("Write cache header failed (%s)\n", fname.c_str());
-			fclose(fp);
-			continue;
+			try
+			{
+				vk::PipelineCacheCreateInfo info({}, oldData->size(), &(*oldData)[0]);
+				vk::raii::PipelineCache oldCache(*g_vkComputeDevice, info);
+				pcache->merge(*oldCache);
+			}
+			catch(const vk::SystemError& err)
+			{
+				LogTrace("Failed to merge existing cache file %s: %s\n", fname.c_str(), err.what());
+			}
 		}
 
-		//Write the data
-		if(header.len != fwrite(&vec[0], 1, header.len, fp))
-			LogWarning("Write cache data failed (%s)\n", fname.c_str());
+		//Extract the raw shader content
+		auto vec = pcache->getData();
+		LogTrace("Saving shader %s (%zu bytes)\n", fname.c_str(), vec.size());
 
-		fclose(fp);
+		header.version = version;
+		WriteFile(fname, header, vec);
 	}
 }
@@ -40,7 +40,7 @@
 struct PipelineCacheFileHeader
 {
 	uint8_t		cache_uuid[16];
-	time_t		file_mtime;
+	int64_t		version;
 	int32_t		vkfft_ver;
 	uint32_t	driver_ver;
 	uint32_t	len;
@@ -55,6 +55,14 @@ struct PipelineCacheFileHeader
 
 	Raw data: $cachedir/shader_raw_[key].bin
 	Vulkan shader data: $cachedir/shader_pipeline_[key].bin
+
+	Every file is tagged with the pipeline cache UUID and driver version of the device, plus a caller-supplied version
+	of the content it was built from (a hash of the SPIR-V for shaders), so files left over from other devices,
+	drivers or shader builds are ignored rather than fed to the driver.
+
+	Several processes may share one cache directory. Files are replaced atomically, and before a pipeline cache is
+	written out, whatever another process saved for the same key in the meantime is merged into it, so concurrent
+	instances add to each other's warm cache instead of overwriting it.
  */
 class PipelineCacheManager
 {
@@ -65,15 +73,22 @@ public:
 	std::shared_ptr< std::vector<uint8_t> > LookupRaw(const std::string& key);
 	void StoreRaw(const std::string& key, std::shared_ptr< std::vector<uint8_t> > value);
 
-	std::shared_ptr<vk::raii::PipelineCache> Lookup(const std::string& key, time_t target);
+	std::shared_ptr<vk::raii::PipelineCache> Lookup(const std::string& key, int64_t version);
 
 	void LoadFromDisk();
 	void SaveToDisk();
 	void Clear();
 
+	///@brief Returns the directory cache files are stored in, including the trailing path separator
+	const std::string& GetCacheRootDir() const
+	{ return m_cacheRootDir; }
+
 protected:
 	void FindPath();
 
+	bool ReadFile(const std::string& path, PipelineCacheFileHeader& header, std::shared_ptr<std::vector<uint8_t> >& data);
+	void WriteFile(const std::string& path, PipelineCacheFileHeader& header, const std::vector<uint8_t>& data);
+
 	///@brief Mutex to interlock access to the STL containers
 	std::mutex m_mutex;
 
@@ -83,8 +98,8 @@ protected:
 	///@brief The actual cache data store
 	std::map<std::string, std::shared_ptr<std::vector<uint8_t> > > m_rawDataCache;
 
-	///@brief Modification timestamps of the files
-	std::map<std::string, time_t> m_vkCacheTimestamps;
+	///@brief Version of the content each Vulkan pipeline cache was built from
+	std::map<std::string, int64_t> m_vkCacheVersions;
 
 	///@brief Root directory of the cache
 	std::string m_cacheRootDir;
@@ -0,0 +1,183 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of PipelineWarmupQueue
+	@ingroup vksupport
+ */
+
+#include "scopehal.h"
+#include "PipelineWarmupQueue.h"
+
+using namespace std;
+
+unique_ptr<PipelineWarmupQueue> g_pipelineWarmupQueue;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates the queue and starts the worker threads
+
+	@param numThreads	Number of pipelines to create in parallel
+ */
+PipelineWarmupQueue::PipelineWarmupQueue(size_t numThreads)
+	: m_nextSequence(0)
+	, m_terminating(false)
+{
+	for(size_t i=0; i<numThreads; i++)
+		m_threads.push_back(thread(&PipelineWarmupQueue::WorkerThread, this));
+}
+
+/**
+	@brief Stops the worker threads
+
+	Any pipeline currently being created is finished first. Pipelines still in the queue are left alone and will
+	be created on first use.
+ */
+PipelineWarmupQueue::~PipelineWarmupQueue()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_terminating = true;
+		m_byPriority.clear();
+		m_keys.clear();
+	}
+	m_wake.notify_all();
+
+	for(auto& t : m_threads)
+		t.join();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Queue management
+
+/**
+	@brief Adds a pipeline to the queue. Does nothing if it's already queued.
+
+	@param pipe		The pipeline to create
+	@param priority	Pipelines with higher priority are created first
+ */
+void PipelineWarmupQueue::Add(ComputePipeline* pipe, int priority)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		if(m_terminating || (m_keys.find(pipe) != m_keys.end()) )
+			return;
+
+		QueueKey key(-priority, m_nextSequence ++);
+		m_byPriority[key] = pipe;
+		m_keys[pipe] = key;
+	}
+	m_wake.notify_one();
+}
+
+/**
+	@brief Removes a pipeline from the queue, if it's still there
+
+	Must be called before the pipeline is destroyed.
+ */
+void PipelineWarmupQueue::Remove(ComputePipeline* pipe)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	auto it = m_keys.find(pipe);
+	if(it == m_keys.end())
+		return;
+
+	m_byPriority.erase(it->second);
+	m_keys.erase(it);
+}
+
+/**
+	@brief Changes the priority of a queued pipeline, for example because a filter using it is about to run
+
+	Does nothing if the pipeline is not queued (already created, or being created right now).
+ */
+void PipelineWarmupQueue::SetPriority(ComputePipeline* pipe, int priority)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	auto it = m_keys.find(pipe);
+	if(it == m_keys.end())
+		return;
+
+	//Keep the original sequence number so ties are still broken by queue order
+	QueueKey key(-priority, it->second.second);
+	m_byPriority.erase(it->second);
+	m_byPriority[key] = pipe;
+	it->second = key;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Worker
+
+/**
+	@brief Thread function: creates queued pipelines, highest priority first, until we're shut down
+ */
+void PipelineWarmupQueue::WorkerThread()
+{
+	#ifdef __linux__
+	pthread_setname_np(pthread_self(), "PipelineWarmup");
+	#endif
+
+	while(true)
+	{
+		unique_lock<mutex> lock(m_mutex);
+		m_wake.wait(lock, [this]{ return m_terminating || !m_byPriority.empty(); });
+		if(m_terminating)
+			return;
+
+		auto it = m_byPriority.begin();
+		auto pipe = it->second;
+		m_keys.erase(pipe);
+		m_byPriority.erase(it);
+
+		//Grab the pipeline's init lock before letting go of the queue, so it can't be destroyed out from under us
+		//(the destructor removes itself from the queue, then takes the init lock)
+		unique_lock<mutex> plock(pipe->m_initMutex);
+		lock.unlock();
+
+		if(pipe->m_initialized)
+			continue;
+
+		try
+		{
+			pipe->CreatePipeline();
+			pipe->m_initialized = true;
+		}
+		catch(const exception& e)
+		{
+			//Leave it uninitialized, the first real use will try again and report the error there
+			LogWarning("Failed to warm up pipeline %s: %s\n", pipe->m_shaderPath.c_str(), e.what());
+		}
+	}
+}
@@ -0,0 +1,105 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of PipelineWarmupQueue
+	@ingroup vksupport
+ */
+
+#ifndef PipelineWarmupQueue_h
+#define PipelineWarmupQueue_h
+
+#include <condition_variable>
+
+class ComputePipeline;
+
+/**
+	@brief Background worker pool which creates compute pipelines before they are first used
+
+	Pipeline creation is deferred until first bind so that constructing a ComputePipeline is cheap, but that moves
+	the shader compile (tens to hundreds of ms each on a cold driver cache) onto the first trigger after loading a
+	session. Every ComputePipeline created while the queue is running is added to it, and a few worker threads
+	initialize them in the background. A pipeline which is bound before its turn comes is simply initialized on
+	the spot, as before.
+
+	Pipelines with higher priority are created first. Pipelines of equal priority are created in the order they
+	were queued, which for a loaded session approximates the order filters will first run in.
+
+	@ingroup vksupport
+ */
+class PipelineWarmupQueue
+{
+public:
+	PipelineWarmupQueue(size_t numThreads);
+	~PipelineWarmupQueue();
+
+	void Add(ComputePipeline* pipe, int priority = 0);
+	void Remove(ComputePipeline* pipe);
+	void SetPriority(ComputePipeline* pipe, int priority);
+
+	///@brief Gets the number of pipelines still waiting to be created
+	size_t GetPendingCount()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_byPriority.size();
+	}
+
+protected:
+	void WorkerThread();
+
+	///@brief Sort key for queued pipelines: highest priority first, then first come first served
+	typedef std::pair<int, uint64_t> QueueKey;
+
+	///@brief Mutex protecting everything below
+	std::mutex m_mutex;
+
+	///@brief Signaled when a pipeline is queued, or when we're shutting down
+	std::condition_variable m_wake;
+
+	///@brief Queued pipelines, sorted by priority (negated, so lowest key is processed first) then sequence number
+	std::map<QueueKey, ComputePipeline*> m_byPriority;
+
+	///@brief Queue key of every queued pipeline, so we can find and remove it
+	std::map<ComputePipeline*, QueueKey> m_keys;
+
+	///@brief Sequence number for the next pipeline added
+	uint64_t m_nextSequence;
+
+	///@brief Set when the workers should exit
+	bool m_terminating;
+
+	///@brief The worker threads
+	std::vector<std::thread> m_threads;
+};
+
+extern std::unique_ptr<PipelineWarmupQueue> g_pipelineWarmupQueue;
+
+#endif
@@ -0,0 +1,1652 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of ProtocolBenchmark
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "ProtocolBenchmark.h"
+#include "TestWaveformSource.h"
+#include "CRC.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+
+/**
+	@brief Renders the lines of a generated capture as step waveforms, one uniform analog waveform per line
+
+	Generators set the level of each line, then advance time. Every sample before the new time gets the current levels.
+	Samples past the end of the capture are dropped, so generators just keep going until Full() returns true.
+ */
+class LineWriter
+{
+public:
+	LineWriter(size_t nlines, int64_t sampleperiod, size_t depth)
+	: m_levels(nlines, 0)
+	, m_sampleperiod(sampleperiod)
+	, m_depth(depth)
+	, m_now(0)
+	, m_pos(0)
+	{
+		for(size_t i=0; i<nlines; i++)
+		{
+			auto wfm = new UniformAnalogWaveform;
+			wfm->m_timescale = sampleperiod;
+			wfm->Resize(depth);
+			wfm->PrepareForCpuAccess();
+			m_lines.push_back(wfm);
+		}
+	}
+
+	~LineWriter()
+	{
+		for(auto w : m_lines)
+			delete w;
+	}
+
+	LineWriter(const LineWriter&) =delete;
+	LineWriter& operator=(const LineWriter&) =delete;
+
+	///@brief Sets the level of one line, from the current time on
+	void Set(size_t line, float level)
+	{ m_levels[line] = level; }
+
+	///@brief Holds every line at its current level for dt femtoseconds
+	void Advance(int64_t dt)
+	{ AdvanceTo(m_now + dt); }
+
+	///@brief Holds every line at its current level until time t, in femtoseconds
+	void AdvanceTo(int64_t t)
+	{
+		m_now = t;
+		size_t end = min(m_depth, static_cast<size_t>( (t + m_sampleperiod - 1) / m_sampleperiod));
+		if(end <= m_pos)
+			return;
+
+		for(size_t i=0; i<m_lines.size(); i++)
+		{
+			float* p = m_lines[i]->m_samples.GetCpuPointer();
+			fill(p + m_pos, p + end, m_levels[i]);
+		}
+		m_pos = end;
+	}
+
+	///@brief Current time, in femtoseconds
+	int64_t GetTime() const
+	{ return m_now; }
+
+	///@brief True once every sample of the capture has been written
+	bool Full() const
+	{ return m_pos >= m_depth; }
+
+	/**
+		@brief Fills the rest of the capture with the current levels, and hands over ownership of one line
+	 */
+	UniformAnalogWaveform* Take(size_t line)
+	{
+		AdvanceTo(m_depth * m_sampleperiod);
+
+		auto ret = m_lines[line];
+		m_lines[line] = nullptr;
+		return ret;
+	}
+
+protected:
+
+	///@brief Current level of each line
+	vector<float> m_levels;
+
+	///@brief Waveform for each line (null once taken)
+	vector<UniformAnalogWaveform*> m_lines;
+
+	///@brief Interval between samples, in femtoseconds
+	int64_t m_sampleperiod;
+
+	///@brief Number of samples in each line
+	size_t m_depth;
+
+	///@brief Current time, in femtoseconds
+	int64_t m_now;
+
+	///@brief Index of the first sample not written yet
+	size_t m_pos;
+};
+
+/**
+	@brief Encodes one byte with IBM 8b/10b
+
+	@param data			Byte to encode (HGF EDCBA)
+	@param control		True for a K character
+	@param rdPositive	Running disparity, updated for the code group
+
+	@return Code group, with the first bit on the wire (a) in bit 9
+ */
+static uint16_t Encode8b10b(uint8_t data, bool control, bool& rdPositive)
+{
+	//5b/6b codes for RD-, indexed by EDCBA
+	static const uint8_t code6[32] =
+	{
+		0x27, 0x1d, 0x2d, 0x31, 0x35, 0x29, 0x19, 0x38,
+		0x39, 0x25, 0x15, 0x34, 0x0d, 0x2c, 0x1c, 0x17,
+		0x1b, 0x23, 0x13, 0x32, 0x0b, 0x2a, 0x1a, 0x3a,
+		0x33, 0x26, 0x16, 0x36, 0x0e, 0x2e, 0x1e, 0x2b
+	};
+
+	//3b/4b codes for RD-, indexed by HGF
+	static const uint8_t code4[8] = { 0xb, 0x9, 0x5, 0xc, 0xd, 0xa, 0x6, 0xe };
+	static const uint8_t code4k[8] = { 0xb, 0x6, 0xa, 0xc, 0xd, 0x5, 0x9, 0x7 };
+
+	unsigned int x = data & 0x1f;
+	unsigned int y = data >> 5;
+
+	//5b/6b sub-block. Unbalanced codes (and D.7, which has two balanced forms) are inverted at RD+.
+	unsigned int c6 = (control && (x == 28)) ? 0x0f : code6[x];
+	bool balanced6 = (__builtin_popcount(c6) == 3);
+	if(rdPositive && (!balanced6 || (x == 7)))
+		c6 ^= 0x3f;
+	if(!balanced6)
+		rdPositive = !rdPositive;
+
+	//3b/4b sub-block, chosen by the disparity after the 6b sub-block. D.x.A7 avoids runs of five identical bits.
+	unsigned int c4;
+	if(control)
+		c4 = code4k[y];
+	else if( (y == 7) &&
+		( (!rdPositive && ( (x == 17) || (x == 18) || (x == 20) ) ) ||
+		  (rdPositive && ( (x == 11) || (x == 13) || (x == 14) ) ) ) )
+	{
+		c4 = 0x7;
+	}
+	else
+		c4 = code4[y];
+	bool balanced4 = (__builtin_popcount(c4) == 2);
+	if(rdPositive && (!balanced4 || (y == 3) || control))
+		c4 ^= 0xf;
+	if(!balanced4)
+		rdPositive = !rdPositive;
+
+	return (c6 << 4) | c4;
+}
+
+/**
+	@brief Advances the PCIe gen 1/2 scrambler LFSR by one byte
+
+	Same as PCIeGen2LogicalDecoder::RunScrambler()
+ */
+static uint8_t PCIeScramble(uint16_t& state)
+{
+	uint8_t ret = 0;
+	for(int j=0; j<8; j++)
+	{
+		bool b = (state & 0x8000) ? true : false;
+		ret >>= 1;
+
+		if(b)
+		{
+			ret |= 0x80;
+			state ^= 0x1c;
+		}
+		state = (state << 1) | b;
+	}
+	return ret;
+}
+
+/**
+	@brief Calculates the USB token CRC5 of an 11-bit address/endpoint or frame number field
+ */
+static uint8_t USBCRC5(uint16_t field)
+{
+	uint8_t crc = 0x1f;
+	for(int i=0; i<11; i++)
+	{
+		bool b = ( (field >> i) ^ crc) & 1;
+		crc >>= 1;
+		if(b)
+			crc ^= 0x14;
+	}
+	return ~crc & 0x1f;
+}
+
+/**
+	@brief Makes a USB PID byte (PID in the low nibble, its complement in the high nibble)
+ */
+static uint8_t USBPid(uint8_t pid)
+{
+	return pid | ( (~pid & 0xf) << 4);
+}
+
+/**
+	@brief Appends a CRC16 as transmitted, in the form the USB and PCIe DLLP decoders compare against
+
+	@param out		Buffer to append to
+	@param table	CRC table for the polynomial
+	@param data		Bytes covered by the CRC
+	@param len		Number of bytes
+ */
+static void AppendCRC16(vector<uint8_t>& out, const ReflectedCRCTable& table, const uint8_t* data, size_t len)
+{
+	uint16_t crc = table.Update(0xffff, data, len);
+	uint16_t wire = ~( (crc << 8) | ( (crc >> 8) & 0xff) );
+	out.push_back(wire >> 8);
+	out.push_back(wire & 0xff);
+}
+
+/**
+	@brief Appends a CRC32 big endian, in the form the Ethernet and PCIe data link decoders compare against
+ */
+static void AppendCRC32(vector<uint8_t>& data)
+{
+	uint32_t crc = CRC32(data);
+	for(int i=3; i>=0; i--)
+		data.push_back( (crc >> (i*8)) & 0xff);
+}
+
+/**
+	@brief One decoder in a protocol chain
+ */
+class ProtocolChainStage
+{
+public:
+	///@brief Protocol name of the decoder
+	string m_protocol;
+
+	///@brief Parameters to set before the first refresh, as name/value pairs
+	vector<pair<string, string> > m_parameters;
+};
+
+/**
+	@brief Gets the decoders to run on a corpus, in order
+
+	The first decoder is fed by the generated lines, and each later one by stream 0 of the one before.
+ */
+static vector<ProtocolChainStage> GetChain(ProtocolBenchmark::Corpus corpus)
+{
+	switch(corpus)
+	{
+		case ProtocolBenchmark::CORPUS_UART:
+			return { { "UART", { { "Baud rate", "1000000" } } } };
+
+		case ProtocolBenchmark::CORPUS_SPI:
+			return { { "SPI", {} } };
+
+		case ProtocolBenchmark::CORPUS_I2C:
+			return { { "I2C", {} } };
+
+		case ProtocolBenchmark::CORPUS_CAN:
+			return { { "CAN", { { "Bit Rate", "500000" } } } };
+
+		case ProtocolBenchmark::CORPUS_USB2:
+			return
+			{
+				{ "USB 1.x/2.0 PMA", {} },
+				{ "USB 1.x/2.0 PCS", {} },
+				{ "USB 1.x/2.0 Packet", {} }
+			};
+
+		case ProtocolBenchmark::CORPUS_PCIE:
+			return
+			{
+				{ "8b/10b (IBM)", {} },
+				{ "PCIe Gen 1/2 Logical", {} },
+				{ "PCIe Data Link", {} },
+				{ "PCIe Transport", {} }
+			};
+
+		case ProtocolBenchmark::CORPUS_100BASETX:
+			return { { "Ethernet - 100baseTX", {} } };
+
+		case ProtocolBenchmark::CORPUS_DDR3:
+			return { { "DDR3 Command Bus", {} } };
+
+		default:
+			return {};
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+ProtocolBenchmark::ProtocolBenchmark()
+	: m_densities{0.05, 0.5, 0.95}
+	, m_warmupIterations(2)
+	, m_iterations(10)
+	, m_density(0.5)
+	, m_burstRemaining(0)
+	, m_frames(0)
+	, m_corruptFrames(0)
+	, m_rng(0)
+	, m_source(make_unique<TestWaveformSource>(m_rng))
+{
+	m_queue = g_vkQueueManager->GetComputeQueue("ProtocolBenchmark.queue");
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		m_queue->m_family );
+	m_pool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(**m_pool, vk::CommandBufferLevel::ePrimary, 1);
+	m_cmdBuf = make_unique<vk::raii::CommandBuffer>(
+		std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+}
+
+ProtocolBenchmark::~ProtocolBenchmark()
+{
+}
+
+/**
+	@brief Gets the name of a corpus, as used in the results
+ */
+string ProtocolBenchmark::GetCorpusName(Corpus corpus)
+{
+	switch(corpus)
+	{
+		case CORPUS_UART:		return "UART";
+		case CORPUS_SPI:		return "SPI";
+		case CORPUS_I2C:		return "I2C";
+		case CORPUS_CAN:		return "CAN";
+		case CORPUS_USB2:		return "USB2";
+		case CORPUS_PCIE:		return "PCIe";
+		case CORPUS_100BASETX:	return "100baseTX";
+		case CORPUS_DDR3:		return "DDR3";
+		default:				return "";
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Running
+
+/**
+	@brief Benchmarks every corpus
+ */
+void ProtocolBenchmark::RunAll()
+{
+	for(int i=0; i<CORPUS_COUNT; i++)
+		Run(static_cast<Corpus>(i));
+}
+
+/**
+	@brief Benchmarks the decoder chain for one corpus at every configured density
+ */
+void ProtocolBenchmark::Run(Corpus corpus)
+{
+	for(auto density : m_densities)
+	{
+		Generate(corpus, density);
+		RunChain(corpus, density);
+	}
+
+	//Don't hold on to the last capture, it can be large
+	m_lines.clear();
+}
+
+/**
+	@brief Runs every decoder in a corpus' chain on the capture from the last Generate() call
+
+	All stages are refreshed in order each iteration, so every stage sees fresh input, but each is timed on its own.
+ */
+void ProtocolBenchmark::RunChain(Corpus corpus, double density)
+{
+	auto chain = GetChain(corpus);
+
+	vector<ProtocolBenchmarkResult> results(chain.size());
+	for(size_t i=0; i<chain.size(); i++)
+	{
+		auto& r = results[i];
+		r.m_corpus = GetCorpusName(corpus);
+		r.m_protocol = chain[i].m_protocol;
+		r.m_stage = i;
+		r.m_density = density;
+		r.m_frames = m_frames;
+		r.m_corruptFrames = m_corruptFrames;
+	}
+
+	//Create and connect the stages. Each one is refreshed as soon as it's connected, since many decoders check the
+	//type of their input waveform and the upstream decoder has no output until it has run.
+	vector<Filter*> filters;
+	for(size_t i=0; i<chain.size(); i++)
+	{
+		auto f = Filter::CreateFilter(chain[i].m_protocol);
+		if(!f)
+		{
+			results[i].m_error = "unknown protocol";
+			break;
+		}
+		f->AddRef();
+		filters.push_back(f);
+
+		for(auto& p : chain[i].m_parameters)
+			f->GetParameter(p.first).ParseString(p.second, false);
+
+		bool connected = true;
+		for(size_t j=0; j<f->GetInputCount(); j++)
+		{
+			StreamDescriptor stream;
+			if(i > 0)
+				stream = StreamDescriptor(filters[i-1], 0);
+			else
+			{
+				for(auto& line : m_lines)
+				{
+					if(line.first == f->GetInputName(j))
+						stream = StreamDescriptor(line.second.get(), 0);
+				}
+			}
+
+			if(!stream.m_channel || !f->ValidateChannel(j, stream))
+			{
+				connected = false;
+				break;
+			}
+			f->SetInput(j, stream);
+		}
+		if(!connected)
+		{
+			results[i].m_error = (i > 0) ? "output of previous stage rejected" : "generated lines rejected";
+			filters.pop_back();
+			f->Release();
+			break;
+		}
+
+		TouchInputs();
+		f->Refresh(*m_cmdBuf, m_queue);
+	}
+	size_t nstages = filters.size();
+	for(size_t i=nstages+1; i<chain.size(); i++)
+		results[i].m_error = "previous stage failed";
+
+	auto& counters = PerformanceCounters::GetThreadCounters();
+	for(size_t i=0; i<m_warmupIterations; i++)
+	{
+		TouchInputs();
+		for(auto f : filters)
+			f->Refresh(*m_cmdBuf, m_queue);
+	}
+
+	vector<vector<double>> times(nstages);
+	for(size_t i=0; i<nstages; i++)
+		results[i].m_outputAllocations = filters[i]->GetOutputAllocationCount();
+	for(size_t i=0; i<m_iterations; i++)
+	{
+		//Decoders may skip work if the input revision is unchanged, so make every refresh look like new data
+		TouchInputs();
+
+		for(size_t j=0; j<nstages; j++)
+		{
+			auto& r = results[j];
+			uint64_t base = ResetPeakMemory();
+			uint64_t reallocStart = counters.m_reallocations;
+
+			double start = GetTime();
+			filters[j]->Refresh(*m_cmdBuf, m_queue);
+			times[j].push_back(GetTime() - start);
+
+			r.m_bufferReallocations += counters.m_reallocations - reallocStart;
+			uint64_t peak = GetProcessMemory("VmHWM:");
+			if(base && (peak > base))
+				r.m_peakMemory = max(r.m_peakMemory, peak - base);
+		}
+	}
+
+	for(size_t i=0; i<nstages; i++)
+	{
+		auto f = filters[i];
+		auto& r = results[i];
+		r.m_outputAllocations = f->GetOutputAllocationCount() - r.m_outputAllocations;
+
+		for(size_t j=0; j<f->GetInputCount(); j++)
+		{
+			auto data = f->GetInput(j).GetData();
+			if(data)
+				r.m_inputSamples = max(r.m_inputSamples, data->size());
+		}
+		for(size_t j=0; j<f->GetStreamCount(); j++)
+		{
+			auto data = f->GetData(j);
+			if(data)
+				r.m_outputSamples += data->size();
+		}
+		auto pd = dynamic_cast<PacketDecoder*>(f);
+		if(pd)
+			r.m_packets = pd->GetPackets().size();
+
+		auto& t = times[i];
+		if(t.empty())
+			continue;
+		r.m_iterations = t.size();
+
+		double total = 0;
+		for(auto x : t)
+			total += x;
+		if(total > 0)
+		{
+			r.m_samplesPerSecond = r.m_inputSamples * t.size() / total;
+			r.m_packetsPerSecond = r.m_packets * t.size() / total;
+		}
+
+		sort(t.begin(), t.end());
+		r.m_latencyMin = t.front();
+		r.m_latencyP50 = t[t.size() / 2];
+		r.m_latencyMax = t.back();
+
+		LogDebug("%s / %s (density %.2f): %.3e samples/sec, %.3e packets/sec\n",
+			r.m_corpus.c_str(), r.m_protocol.c_str(), density, r.m_samplesPerSecond, r.m_packetsPerSecond);
+	}
+
+	//Downstream stages hold references to upstream ones, so release from the end
+	for(size_t i=nstages; i>0; i--)
+		filters[i-1]->Release();
+
+	m_results.insert(m_results.end(), results.begin(), results.end());
+}
+
+/**
+	@brief Bumps the revision of every generated line, so decoders don't reuse results cached from the last refresh
+ */
+void ProtocolBenchmark::TouchInputs()
+{
+	for(auto& line : m_lines)
+	{
+		auto data = line.second->GetData(0);
+		if(data)
+			data->m_revision ++;
+	}
+}
+
+/**
+	@brief Reads a memory size field (e.g. "VmRSS:") of /proc/self/status
+
+	@return Size in bytes, or 0 if not available on this platform
+ */
+uint64_t ProtocolBenchmark::GetProcessMemory(const char* field)
+{
+	uint64_t ret = 0;
+
+	#ifdef __linux__
+	FILE* fp = fopen("/proc/self/status", "r");
+	if(!fp)
+		return 0;
+
+	char line[256];
+	size_t len = strlen(field);
+	while(fgets(line, sizeof(line), fp))
+	{
+		if(!strncmp(line, field, len))
+		{
+			ret = strtoull(line + len, nullptr, 10) * 1024;
+			break;
+		}
+	}
+	fclose(fp);
+	#else
+	(void)field;
+	#endif
+
+	return ret;
+}
+
+/**
+	@brief Resets the peak resident set size of the process to the current size
+
+	@return The current resident set size in bytes, or 0 if the peak can't be reset on this platform
+ */
+uint64_t ProtocolBenchmark::ResetPeakMemory()
+{
+	#ifdef __linux__
+	FILE* fp = fopen("/proc/self/clear_refs", "w");
+	if(!fp)
+		return 0;
+	bool ok = (fputs("5", fp) >= 0);
+	if(fclose(fp) != 0)
+		ok = false;
+	if(ok)
+		return GetProcessMemory("VmRSS:");
+	#endif
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Corpus generation
+
+/**
+	@brief Generates the lines for one corpus, replacing any previous capture
+
+	@param corpus	Corpus to generate
+	@param density	Fraction of the capture to fill with frames
+ */
+void ProtocolBenchmark::Generate(Corpus corpus, double density)
+{
+	m_lines.clear();
+	m_density = min(1.0, max(0.001, density));
+	m_burstRemaining = 0;
+	m_frames = 0;
+	m_corruptFrames = 0;
+
+	switch(corpus)
+	{
+		case CORPUS_UART:
+			GenerateUART();
+			break;
+
+		case CORPUS_SPI:
+			GenerateSPI();
+			break;
+
+		case CORPUS_I2C:
+			GenerateI2C();
+			break;
+
+		case CORPUS_CAN:
+			GenerateCAN();
+			break;
+
+		case CORPUS_USB2:
+			GenerateUSB2();
+			break;
+
+		case CORPUS_PCIE:
+			GeneratePCIe();
+			break;
+
+		case CORPUS_100BASETX:
+			Generate100BaseTX();
+			break;
+
+		case CORPUS_DDR3:
+			GenerateDDR3();
+			break;
+
+		default:
+			break;
+	}
+}
+
+/**
+	@brief Picks the idle time before the next frame
+
+	Frames come in bursts of m_config.m_burstLength on average (geometrically distributed), separated by minGap.
+	Between bursts the line idles for an exponentially distributed time, with the mean chosen so that frames and their
+	minimum gaps occupy m_density of the capture.
+
+	@param frameLen	Length of the frame just sent
+	@param minGap	Minimum gap between frames allowed by the protocol, in the same units as frameLen
+
+	@return Gap to leave after the frame
+ */
+int64_t ProtocolBenchmark::NextGap(int64_t frameLen, int64_t minGap)
+{
+	if(m_burstRemaining > 0)
+	{
+		m_burstRemaining --;
+		return minGap;
+	}
+
+	//Start a new burst after this gap
+	double meanBurst = max<size_t>(1, m_config.m_burstLength);
+	geometric_distribution<size_t> burst(1 / meanBurst);
+	m_burstRemaining = burst(m_rng);
+
+	double meanIdle = (frameLen + minGap) * meanBurst * (1 - m_density) / m_density;
+	if(meanIdle < 1)
+		return minGap;
+	exponential_distribution<double> idle(1 / meanIdle);
+	return minGap + static_cast<int64_t>(idle(m_rng));
+}
+
+/**
+	@brief Counts a new frame, and decides whether to corrupt it
+
+	@return True if the generator should corrupt the frame
+ */
+bool ProtocolBenchmark::CorruptNextFrame()
+{
+	m_frames ++;
+
+	uniform_real_distribution<double> dist(0, 1);
+	if(dist(m_rng) >= m_config.m_errorRate)
+		return false;
+
+	m_corruptFrames ++;
+	return true;
+}
+
+/**
+	@brief Adds noise to a generated line
+
+	@param wfm		Line to degrade
+	@param swing	Difference between the highest and lowest levels of the line
+ */
+void ProtocolBenchmark::DegradeLine(UniformAnalogWaveform* wfm, float swing)
+{
+	m_source->DegradeSerialData(
+		wfm, wfm->m_timescale, wfm->size(), false, m_config.m_noise * swing, *m_cmdBuf, m_queue);
+	wfm->PrepareForCpuAccess();
+}
+
+/**
+	@brief Adds noise to a 0/1 line, then thresholds it to a digital input for the first decoder
+
+	Takes ownership of wfm.
+ */
+void ProtocolBenchmark::AddDigitalLine(const string& input, UniformAnalogWaveform* wfm)
+{
+	DegradeLine(wfm, 1);
+
+	size_t len = wfm->size();
+	auto dig = new UniformDigitalWaveform;
+	dig->m_timescale = wfm->m_timescale;
+	dig->Resize(len);
+	for(size_t i=0; i<len; i++)
+		dig->m_samples[i] = (wfm->m_samples[i] > 0.5f);
+	dig->MarkModifiedFromCpu();
+	delete wfm;
+
+	AddLine(input, dig, true);
+}
+
+/**
+	@brief Adds noise to a line, and uses it as an analog input for the first decoder
+
+	Takes ownership of wfm.
+ */
+void ProtocolBenchmark::AddAnalogLine(const string& input, UniformAnalogWaveform* wfm, float swing)
+{
+	DegradeLine(wfm, swing);
+	AddLine(input, wfm, false);
+}
+
+/**
+	@brief Wraps a generated waveform in a channel which can be connected to the given input of the first decoder
+
+	Takes ownership of wfm.
+ */
+void ProtocolBenchmark::AddLine(const string& input, WaveformBase* wfm, bool digital)
+{
+	auto chan = make_unique<OscilloscopeChannel>(
+		nullptr,
+		"Bench" + input,
+		"#ffffff",
+		Unit(Unit::UNIT_FS),
+		Unit(digital ? Unit::UNIT_COUNTS : Unit::UNIT_VOLTS),
+		digital ? Stream::STREAM_TYPE_DIGITAL : Stream::STREAM_TYPE_ANALOG);
+	chan->SetData(wfm, 0);
+	m_lines.push_back(make_pair(input, std::move(chan)));
+}
+
+/**
+	@brief 1 Mbaud 8N1 UART carrying printable ASCII, 16x oversampled
+
+	Each character is a frame. Corrupted characters have one bit inverted, which may be the start or stop bit.
+ */
+void ProtocolBenchmark::GenerateUART()
+{
+	const int64_t ui = 1000000000;
+	LineWriter w(1, ui / 16, m_config.m_depth);
+
+	w.Set(0, 1);
+	w.Advance(16 * ui);
+
+	while(!w.Full())
+	{
+		uint8_t c = ' ' + (m_rng() % 95);
+		bool bits[10];
+		bits[0] = false;
+		for(int i=0; i<8; i++)
+			bits[i+1] = (c >> i) & 1;
+		bits[9] = true;
+
+		if(CorruptNextFrame())
+		{
+			size_t i = m_rng() % 10;
+			bits[i] = !bits[i];
+		}
+
+		for(auto b : bits)
+		{
+			w.Set(0, b);
+			w.Advance(ui);
+		}
+
+		w.Set(0, 1);
+		w.Advance(NextGap(10 * ui, 0));
+	}
+
+	AddDigitalLine("din", w.Take(0));
+}
+
+/**
+	@brief Mode 0 SPI at 10 MHz, 8x oversampled, with transactions of 1-16 bytes
+
+	Corrupted transactions have chip select deasserted partway through the last byte.
+ */
+void ProtocolBenchmark::GenerateSPI()
+{
+	const int64_t ui = 100000000;
+	enum { CLK, CS, DATA };
+	LineWriter w(3, ui / 8, m_config.m_depth);
+
+	w.Set(CS, 1);
+	w.Advance(4 * ui);
+
+	while(!w.Full())
+	{
+		size_t nbits = 8 * (1 + m_rng() % 16);
+		if(CorruptNextFrame())
+			nbits -= 1 + m_rng() % 7;
+
+		w.Set(CS, 0);
+		w.Advance(ui / 2);
+
+		//Data changes on the falling edge and is sampled on the rising edge, MSB first
+		uint8_t byte = 0;
+		for(size_t i=0; i<nbits; i++)
+		{
+			if( (i % 8) == 0)
+				byte = m_rng();
+
+			w.Set(DATA, (byte >> (7 - (i % 8))) & 1);
+			w.Set(CLK, 0);
+			w.Advance(ui / 2);
+			w.Set(CLK, 1);
+			w.Advance(ui / 2);
+		}
+
+		w.Set(CLK, 0);
+		w.Advance(ui / 2);
+		w.Set(CS, 1);
+		w.Advance(NextGap( (nbits + 1) * ui, ui));
+	}
+
+	AddDigitalLine("clk", w.Take(CLK));
+	AddDigitalLine("cs#", w.Take(CS));
+	AddDigitalLine("data", w.Take(DATA));
+}
+
+/**
+	@brief 400 kHz I2C, 16x oversampled, with reads and writes of 1-8 bytes to a handful of devices
+
+	Corrupted transfers are NAKed partway through (or at the address), and the master then stops.
+ */
+void ProtocolBenchmark::GenerateI2C()
+{
+	const int64_t ui = 2500000000;
+	enum { SDA, SCL };
+	LineWriter w(2, ui / 16, m_config.m_depth);
+
+	static const uint8_t addresses[] = { 0x20, 0x48, 0x50, 0x68 };
+
+	//One bit: SDA changes in the middle of the low half of SCL
+	auto sendBit = [&](bool b)
+	{
+		w.Set(SCL, 0);
+		w.Advance(ui / 4);
+		w.Set(SDA, b);
+		w.Advance(ui / 4);
+		w.Set(SCL, 1);
+		w.Advance(ui / 2);
+	};
+
+	w.Set(SDA, 1);
+	w.Set(SCL, 1);
+	w.Advance(4 * ui);
+
+	while(!w.Full())
+	{
+		int64_t start = w.GetTime();
+
+		size_t nbytes = 2 + m_rng() % 8;
+		size_t nak = nbytes;
+		if(CorruptNextFrame())
+			nak = m_rng() % nbytes;
+
+		//START: SDA falls while SCL is high
+		w.Set(SDA, 0);
+		w.Advance(ui / 2);
+
+		for(size_t i=0; i<nbytes; i++)
+		{
+			uint8_t byte = m_rng();
+			if(i == 0)
+				byte = (addresses[m_rng() % 4] << 1) | (byte & 1);
+
+			for(int j=7; j>=0; j--)
+				sendBit( (byte >> j) & 1);
+
+			//ACK, or a NAK which ends the transfer
+			sendBit(i == nak);
+			if(i == nak)
+				break;
+		}
+
+		//STOP: SDA rises while SCL is high
+		w.Set(SCL, 0);
+		w.Advance(ui / 4);
+		w.Set(SDA, 0);
+		w.Advance(ui / 4);
+		w.Set(SCL, 1);
+		w.Advance(ui / 2);
+		w.Set(SDA, 1);
+
+		w.Advance(NextGap(w.GetTime() - start, ui));
+	}
+
+	AddDigitalLine("sda", w.Take(SDA));
+	AddDigitalLine("scl", w.Take(SCL));
+}
+
+/**
+	@brief 500 kbps CAN 2.0A data frames of 0-8 bytes, 16x oversampled
+
+	The line is CANH thresholded, so high is dominant. Corrupted frames have one bit between SOF and the end of the CRC
+	inverted, which shows up as a CRC or stuffing error.
+ */
+void ProtocolBenchmark::GenerateCAN()
+{
+	const int64_t ui = 2000000000;
+	LineWriter w(1, ui / 16, m_config.m_depth);
+
+	w.Set(0, 0);
+	w.Advance(16 * ui);
+
+	vector<bool> bits;
+	vector<bool> line;
+	auto append = [&bits](uint32_t value, int nbits)
+	{
+		for(int i=nbits-1; i>=0; i--)
+			bits.push_back( (value >> i) & 1);
+	};
+
+	while(!w.Full())
+	{
+		//SOF, ID, RTR, IDE, r0, DLC, data
+		bits.clear();
+		size_t len = m_rng() % 9;
+		append(0, 1);
+		append(m_rng() & 0x7ff, 11);
+		append(0, 3);
+		append(len, 4);
+		for(size_t i=0; i<len; i++)
+			append(m_rng() & 0xff, 8);
+
+		uint16_t crc = 0;
+		for(size_t i=1; i<bits.size(); i++)
+		{
+			bool next = bits[i] ^ ( (crc >> 14) & 1);
+			crc = (crc << 1) & 0x7fff;
+			if(next)
+				crc ^= 0x4599;
+		}
+		append(crc, 15);
+
+		//Stuff an opposite bit after five identical ones, from SOF to the end of the CRC
+		line.clear();
+		int run = 0;
+		bool last = false;
+		for(auto b : bits)
+		{
+			line.push_back(b);
+			if(run && (b == last))
+				run ++;
+			else
+			{
+				run = 1;
+				last = b;
+			}
+
+			if(run == 5)
+			{
+				line.push_back(!b);
+				last = !b;
+				run = 1;
+			}
+		}
+
+		if(CorruptNextFrame())
+		{
+			size_t i = 1 + m_rng() % (line.size() - 1);
+			line[i] = !line[i];
+		}
+
+		//CRC delimiter, ACK slot (driven dominant by the receivers), ACK delimiter, EOF
+		line.push_back(1);
+		line.push_back(0);
+		line.push_back(1);
+		for(int i=0; i<7; i++)
+			line.push_back(1);
+
+		for(auto b : line)
+		{
+			w.Set(0, !b);
+			w.Advance(ui);
+		}
+
+		//Intermission, then bus idle
+		w.Set(0, 0);
+		w.Advance(NextGap(line.size() * ui, 3 * ui));
+	}
+
+	AddDigitalLine("CANH", w.Take(0));
+}
+
+/**
+	@brief Full speed USB bulk traffic, sampled at 100 Msps
+
+	Each frame is an OUT or IN transaction (token, DATA0/DATA1 with 0-64 bytes of payload, ACK), and there's a SOF
+	packet every millisecond. Corrupted transactions have one bit of the data packet inverted before NRZI encoding,
+	which shows up as a CRC16 or bit stuffing error, and aren't ACKed.
+ */
+void ProtocolBenchmark::GenerateUSB2()
+{
+	const int64_t sampleperiod = 10000000;
+	const float vhi = 3.3;
+	enum { DP, DN };
+	LineWriter w(2, sampleperiod, m_config.m_depth);
+
+	//12 Mbps isn't a whole number of fs per bit, so keep time as a bit count and round
+	int64_t nbit = 0;
+	auto advance = [&](int64_t n)
+	{
+		nbit += n;
+		w.AdvanceTo(nbit * 250000000 / 3);
+	};
+
+	auto setState = [&](bool j)
+	{
+		w.Set(DP, j ? vhi : 0);
+		w.Set(DN, j ? 0 : vhi);
+	};
+
+	static const ReflectedCRCTable crc16(0xa001);
+	vector<bool> bits;
+	auto send = [&](const vector<uint8_t>& packet, bool corrupt)
+	{
+		//SYNC and the packet, LSB first, with a 0 stuffed after six consecutive 1s
+		bits.clear();
+		int ones = 0;
+		for(size_t i=0; i<=packet.size(); i++)
+		{
+			uint8_t byte = (i == 0) ? 0x80 : packet[i-1];
+			for(int j=0; j<8; j++)
+			{
+				bool b = (byte >> j) & 1;
+				bits.push_back(b);
+				if(!b)
+					ones = 0;
+				else if(++ones == 6)
+				{
+					bits.push_back(0);
+					ones = 0;
+				}
+			}
+		}
+
+		if(corrupt)
+		{
+			size_t i = 8 + m_rng() % (bits.size() - 8);
+			bits[i] = !bits[i];
+		}
+
+		//NRZI: a 0 is a transition, a 1 holds the line state
+		bool j = true;
+		for(auto b : bits)
+		{
+			if(!b)
+				j = !j;
+			setState(j);
+			advance(1);
+		}
+
+		//EOP: two bits of SE0, then J
+		w.Set(DP, 0);
+		w.Set(DN, 0);
+		advance(2);
+		setState(true);
+		advance(1);
+	};
+
+	auto token = [](uint8_t pid, uint16_t field) -> vector<uint8_t>
+	{
+		return
+		{
+			USBPid(pid),
+			static_cast<uint8_t>(field & 0xff),
+			static_cast<uint8_t>( (field >> 8) | (USBCRC5(field) << 3) )
+		};
+	};
+
+	setState(true);
+	advance(16);
+
+	const uint8_t PID_OUT = 0x1;
+	const uint8_t PID_ACK = 0x2;
+	const uint8_t PID_DATA0 = 0x3;
+	const uint8_t PID_SOF = 0x5;
+	const uint8_t PID_IN = 0x9;
+	const uint8_t PID_DATA1 = 0xb;
+
+	int64_t nextSof = 0;
+	uint16_t frameNumber = 0;
+	bool toggle = false;
+	vector<uint8_t> data;
+	while(!w.Full())
+	{
+		if(nbit >= nextSof)
+		{
+			send(token(PID_SOF, frameNumber & 0x7ff), false);
+			frameNumber ++;
+			nextSof += 12000;
+			advance(8);
+			continue;
+		}
+
+		int64_t start = nbit;
+		bool corrupt = CorruptNextFrame();
+
+		uint16_t addr = 1 + m_rng() % 4;
+		uint16_t endpoint = 1 + m_rng() % 2;
+		send(token( (m_rng() & 1) ? PID_OUT : PID_IN, addr | (endpoint << 7)), false);
+		advance(4);
+
+		size_t len = m_rng() % 65;
+		data.clear();
+		data.push_back(USBPid(toggle ? PID_DATA1 : PID_DATA0));
+		for(size_t i=0; i<len; i++)
+			data.push_back(m_rng());
+		AppendCRC16(data, crc16, &data[1], len);
+		send(data, corrupt);
+		advance(4);
+
+		if(!corrupt)
+		{
+			send({USBPid(PID_ACK)}, false);
+			toggle = !toggle;
+		}
+
+		advance(NextGap(nbit - start, 4));
+	}
+
+	AddAnalogLine("D+", w.Take(DP), vhi);
+	AddAnalogLine("D-", w.Take(DN), vhi);
+}
+
+/**
+	@brief PCIe gen 1 x1 link carrying memory reads and writes, each acknowledged by an Ack DLLP
+
+	The lines are the output of clock recovery: one data sample per UI, and a clock with an edge in the middle of each
+	bit. The capture starts with a SKP ordered set, which the logical layer decoder needs to lock its descrambler, and
+	there's another every 1180 symbols as the spec requires. The link sends logical idle between packets.
+
+	Corrupted TLPs have one line bit inverted, which shows up as an 8b/10b code error or an LCRC error.
+ */
+void ProtocolBenchmark::GeneratePCIe()
+{
+	const int64_t ui = 400000;
+	LineWriter w(1, ui, m_config.m_depth);
+
+	bool rdPositive = false;
+	uint16_t scrambler = 0xffff;
+	size_t symbolsSinceSkip = 0;
+	vector<uint16_t> codes;
+
+	//Scrambles and encodes one symbol. COM resets the scrambler, SKP doesn't advance it, and only data is scrambled.
+	auto symbol = [&](uint8_t data, bool control)
+	{
+		if(control && (data == 0xbc))
+			scrambler = 0xffff;
+		else if(!control || (data != 0x1c))
+		{
+			uint8_t s = PCIeScramble(scrambler);
+			if(!control)
+				data ^= s;
+		}
+		codes.push_back(Encode8b10b(data, control, rdPositive));
+	};
+
+	//Sends the pending code groups, first bit first
+	auto flush = [&](bool corrupt)
+	{
+		if(corrupt && !codes.empty())
+			codes[m_rng() % codes.size()] ^= 1 << (m_rng() % 10);
+
+		for(auto c : codes)
+		{
+			for(int i=9; i>=0; i--)
+			{
+				w.Set(0, (c >> i) & 1);
+				w.Advance(ui);
+			}
+		}
+		symbolsSinceSkip += codes.size();
+		codes.clear();
+	};
+
+	auto skip = [&]()
+	{
+		symbol(0xbc, true);
+		for(int i=0; i<3; i++)
+			symbol(0x1c, true);
+		flush(false);
+		symbolsSinceSkip = 0;
+	};
+
+	auto idle = [&](int64_t n)
+	{
+		for(int64_t i=0; (i < n) && !w.Full(); i++)
+		{
+			if(symbolsSinceSkip >= 1180)
+				skip();
+			symbol(0, false);
+			flush(false);
+		}
+	};
+
+	static const ReflectedCRCTable dllpCRC(0xd008);
+	uint16_t seq = 0;
+	uint8_t tag = 0;
+	vector<uint8_t> tlp;
+	vector<uint8_t> dllp;
+
+	skip();
+	idle(16);
+	while(!w.Full())
+	{
+		//Sequence number, then a 3DW memory read or write header with 1-32 DWORDs of payload
+		bool write = m_rng() & 1;
+		uint32_t len = 1 + m_rng() % 32;
+		uint32_t addr = m_rng() & 0x7ffffffc;
+		tlp =
+		{
+			static_cast<uint8_t>(seq >> 8),
+			static_cast<uint8_t>(seq & 0xff),
+			static_cast<uint8_t>(write ? 0x40 : 0x00),
+			0x00,
+			static_cast<uint8_t>( (len >> 8) & 3),
+			static_cast<uint8_t>(len & 0xff),
+			0x01,
+			0x00,
+			tag++,
+			0xff,
+			static_cast<uint8_t>(addr >> 24),
+			static_cast<uint8_t>( (addr >> 16) & 0xff),
+			static_cast<uint8_t>( (addr >> 8) & 0xff),
+			static_cast<uint8_t>(addr & 0xff)
+		};
+		if(write)
+		{
+			for(size_t i=0; i<len*4; i++)
+				tlp.push_back(m_rng());
+		}
+		AppendCRC32(tlp);
+
+		symbol(0xfb, true);
+		for(auto b : tlp)
+			symbol(b, false);
+		symbol(0xfd, true);
+		size_t frameLen = codes.size();
+		flush(CorruptNextFrame());
+
+		//Ack for it
+		dllp = { 0x00, 0x00, static_cast<uint8_t>(seq >> 8), static_cast<uint8_t>(seq & 0xff) };
+		AppendCRC16(dllp, dllpCRC, &dllp[0], 4);
+		symbol(0x5c, true);
+		for(auto b : dllp)
+			symbol(b, false);
+		symbol(0xfd, true);
+		frameLen += codes.size();
+		flush(false);
+
+		seq = (seq + 1) & 0xfff;
+		idle(NextGap(frameLen, 1));
+	}
+
+	//Threshold, and split into recovered data and clock
+	auto line = w.Take(0);
+	DegradeLine(line, 1);
+	size_t len = line->size();
+
+	auto data = new SparseDigitalWaveform;
+	auto clk = new SparseDigitalWaveform;
+	data->m_timescale = ui;
+	clk->m_timescale = ui;
+	clk->m_triggerPhase = ui / 2;
+	data->Resize(len);
+	clk->Resize(len);
+	for(size_t i=0; i<len; i++)
+	{
+		data->m_offsets[i] = i;
+		data->m_durations[i] = 1;
+		data->m_samples[i] = (line->m_samples[i] > 0.5f);
+
+		clk->m_offsets[i] = i;
+		clk->m_durations[i] = 1;
+		clk->m_samples[i] = (i & 1);
+	}
+	data->MarkModifiedFromCpu();
+	clk->MarkModifiedFromCpu();
+	delete line;
+
+	AddLine("data", data, true);
+	AddLine("clk", clk, true);
+}
+
+/**
+	@brief 100baseTX carrying IPv4 frames of 46-1500 bytes of payload
+
+	The line is the output of clock recovery: one MLT-3 voltage sample per UI. Corrupted frames have one code bit
+	inverted before scrambling, which shows up as an invalid code group or an FCS error.
+ */
+void ProtocolBenchmark::Generate100BaseTX()
+{
+	const int64_t ui = 8000000;
+	LineWriter w(1, ui, m_config.m_depth);
+
+	static const uint8_t code4b5b[16] =
+	{
+		0x1e, 0x09, 0x14, 0x15, 0x0a, 0x0b, 0x0e, 0x0f,
+		0x12, 0x13, 0x16, 0x17, 0x1a, 0x1b, 0x1c, 0x1d
+	};
+	const uint8_t CODE_IDLE = 0x1f;
+	const uint8_t CODE_J = 0x18;
+	const uint8_t CODE_K = 0x11;
+	const uint8_t CODE_T = 0x0d;
+	const uint8_t CODE_R = 0x07;
+	static const float levels[4] = { 0, 1, 0, -1 };
+
+	uint32_t lfsr = (m_rng() & 0x7ff) | 1;
+	int state = 0;
+	vector<uint8_t> codes;
+	vector<bool> bits;
+
+	//Scrambles and MLT-3 encodes the pending code groups, MSB first
+	auto flush = [&](bool corrupt)
+	{
+		bits.clear();
+		for(auto c : codes)
+		{
+			for(int i=4; i>=0; i--)
+				bits.push_back( (c >> i) & 1);
+		}
+		codes.clear();
+
+		if(corrupt)
+		{
+			size_t i = m_rng() % bits.size();
+			bits[i] = !bits[i];
+		}
+
+		for(size_t i=0; (i < bits.size()) && !w.Full(); i++)
+		{
+			bool c = ( (lfsr >> 8) ^ (lfsr >> 10) ) & 1;
+			lfsr = ( (lfsr << 1) ^ c) & 0x7ff;
+			if(bits[i] ^ c)
+				state = (state + 1) & 3;
+
+			w.Set(0, levels[state]);
+			w.Advance(ui);
+		}
+	};
+
+	auto byte = [&](uint8_t b)
+	{
+		codes.push_back(code4b5b[b & 0xf]);
+		codes.push_back(code4b5b[b >> 4]);
+	};
+
+	//Long enough idle for the descrambler to lock
+	codes.assign(64, CODE_IDLE);
+	flush(false);
+
+	vector<uint8_t> frame;
+	while(!w.Full())
+	{
+		//Mostly small frames, some full size
+		size_t len = 46 + m_rng() % 82;
+		if( (m_rng() % 4) == 0)
+			len = 46 + m_rng() % 1455;
+
+		frame.clear();
+		for(int i=0; i<6; i++)
+			frame.push_back( (i == 0) ? 0x02 : (m_rng() & 0xff) );
+		for(int i=0; i<6; i++)
+			frame.push_back( (i == 0) ? 0x02 : (m_rng() & 0xff) );
+		frame.push_back(0x08);
+		frame.push_back(0x00);
+		for(size_t i=0; i<len; i++)
+			frame.push_back(m_rng());
+		AppendCRC32(frame);
+
+		//J/K replaces the first preamble byte, and T/R ends the stream
+		codes.push_back(CODE_J);
+		codes.push_back(CODE_K);
+		for(int i=0; i<6; i++)
+			byte(0x55);
+		byte(0xd5);
+		for(auto b : frame)
+			byte(b);
+		codes.push_back(CODE_T);
+		codes.push_back(CODE_R);
+		size_t frameLen = codes.size();
+		flush(CorruptNextFrame());
+
+		//Inter-frame gap of at least 96 bit times
+		codes.assign(min<int64_t>(NextGap(frameLen, 24), m_config.m_depth / 5 + 1), CODE_IDLE);
+		flush(false);
+	}
+
+	auto line = w.Take(0);
+	DegradeLine(line, 2);
+	size_t len = line->size();
+
+	auto sampled = new SparseAnalogWaveform;
+	sampled->m_timescale = 1;
+	sampled->Resize(len);
+	for(size_t i=0; i<len; i++)
+	{
+		sampled->m_offsets[i] = i * ui;
+		sampled->m_durations[i] = ui;
+		sampled->m_samples[i] = line->m_samples[i];
+	}
+	sampled->MarkModifiedFromCpu();
+	delete line;
+
+	AddLine("sampledData", sampled, false);
+}
+
+/**
+	@brief DDR3-800 command bus, 8x oversampled
+
+	Each frame opens a row, issues 1-8 BL8 reads or writes to it and precharges it, and there's an all-bank refresh
+	every 7.8 us. Commands change on the falling clock edge. Corrupted frames have the WE# bit of one command inverted,
+	turning it into a different (out of sequence) command.
+ */
+void ProtocolBenchmark::GenerateDDR3()
+{
+	const int64_t tck = 2500000;
+	enum { CLK, WE, RAS, CAS, CS, A12, A10 };
+	LineWriter w(7, tck / 8, m_config.m_depth);
+
+	int64_t ncycle = 0;
+	auto cycle = [&](bool cs, bool ras, bool cas, bool we, bool a10, bool a12)
+	{
+		w.Set(CLK, 0);
+		w.Set(CS, cs);
+		w.Set(RAS, ras);
+		w.Set(CAS, cas);
+		w.Set(WE, we);
+		w.Set(A10, a10);
+		w.Set(A12, a12);
+		w.Advance(tck / 2);
+		w.Set(CLK, 1);
+		w.Advance(tck / 2);
+		ncycle ++;
+	};
+	auto nop = [&](int64_t n)
+	{
+		for(int64_t i=0; i<n; i++)
+			cycle(0, 1, 1, 1, 0, 0);
+	};
+	auto deselect = [&](int64_t n)
+	{
+		for(int64_t i=0; (i < n) && !w.Full(); i++)
+			cycle(1, 1, 1, 1, 0, 0);
+	};
+
+	deselect(16);
+
+	const int64_t refreshInterval = 3120;
+	int64_t nextRefresh = refreshInterval;
+	while(!w.Full())
+	{
+		//Precharge all, then refresh
+		if(ncycle >= nextRefresh)
+		{
+			cycle(0, 0, 1, 0, 1, 0);
+			nop(5);
+			cycle(0, 0, 0, 1, 0, 0);
+			nop(63);
+			nextRefresh += refreshInterval;
+			continue;
+		}
+
+		int64_t start = ncycle;
+		size_t ncols = 1 + m_rng() % 8;
+		size_t bad = SIZE_MAX;
+		if(CorruptNextFrame())
+			bad = m_rng() % (ncols + 2);
+
+		//Activate
+		cycle(0, 0, 1, bad != 0, m_rng() & 1, m_rng() & 1);
+		nop(5);
+
+		//Reads or writes, BL8 (A12 high), no auto precharge
+		bool write = m_rng() & 1;
+		for(size_t i=0; i<ncols; i++)
+		{
+			bool we = !write;
+			if(bad == i + 1)
+				we = !we;
+			cycle(0, 1, 0, we, 0, 1);
+			nop(3);
+		}
+		nop(write ? 10 : 4);
+
+		//Precharge this bank
+		cycle(0, 0, 1, bad == ncols + 1, 0, 0);
+		nop(5);
+
+		deselect(NextGap(ncycle - start, 1));
+	}
+
+	AddDigitalLine("CLK", w.Take(CLK));
+	AddDigitalLine("WE#", w.Take(WE));
+	AddDigitalLine("RAS#", w.Take(RAS));
+	AddDigitalLine("CAS#", w.Take(CAS));
+	AddDigitalLine("CS#", w.Take(CS));
+	AddDigitalLine("A12", w.Take(A12));
+	AddDigitalLine("A10", w.Take(A10));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Output
+
+/**
+	@brief Formats every result so far as a JSON document
+
+	Times are in seconds and memory in bytes. Failed stages are included, with a non-empty "error".
+ */
+string ProtocolBenchmark::ToJSON()
+{
+	string ret = "{\"results\":[";
+	char tmp[1024];
+	for(size_t i=0; i<m_results.size(); i++)
+	{
+		auto& r = m_results[i];
+		snprintf(tmp, sizeof(tmp),
+			"%s\n{\"corpus\":\"%s\",\"protocol\":\"%s\",\"stage\":%zu,\"density\":%.3f,"
+			"\"frames\":%zu,\"corruptFrames\":%zu,\"inputSamples\":%zu,\"iterations\":%zu,"
+			"\"samplesPerSecond\":%.6e,\"packetsPerSecond\":%.6e,"
+			"\"latency\":{\"min\":%.6e,\"p50\":%.6e,\"max\":%.6e},"
+			"\"packets\":%zu,\"outputSamples\":%zu,"
+			"\"outputAllocations\":%" PRIu64 ",\"bufferReallocations\":%" PRIu64 ",\"peakMemory\":%" PRIu64 ","
+			"\"error\":\"%s\"}",
+			(i == 0) ? "" : ",",
+			PerformanceTrace::EscapeJson(r.m_corpus).c_str(),
+			PerformanceTrace::EscapeJson(r.m_protocol).c_str(),
+			r.m_stage,
+			r.m_density,
+			r.m_frames,
+			r.m_corruptFrames,
+			r.m_inputSamples,
+			r.m_iterations,
+			r.m_samplesPerSecond,
+			r.m_packetsPerSecond,
+			r.m_latencyMin,
+			r.m_latencyP50,
+			r.m_latencyMax,
+			r.m_packets,
+			r.m_outputSamples,
+			r.m_outputAllocations,
+			r.m_bufferReallocations,
+			r.m_peakMemory,
+			PerformanceTrace::EscapeJson(r.m_error).c_str());
+		ret += tmp;
+	}
+	ret += "\n],\"device\":\"" + FilterBenchmark::GetDeviceID() + "\"}\n";
+	return ret;
+}
+
+/**
+	@brief Writes ToJSON() to a file
+
+	@return True on success
+ */
+bool ProtocolBenchmark::WriteJSON(const string& path)
+{
+	FILE* fp = fopen(path.c_str(), "w");
+	if(!fp)
+	{
+		LogError("Failed to open benchmark results file %s\n", path.c_str());
+		return false;
+	}
+
+	auto json = ToJSON();
+	fwrite(json.c_str(), 1, json.length(), fp);
+
+	bool ok = !ferror(fp);
+	fclose(fp);
+	return ok;
+}
@@ -0,0 +1,306 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of ProtocolBenchmark
+	@ingroup core
+ */
+
+#ifndef ProtocolBenchmark_h
+#define ProtocolBenchmark_h
+
+#include <random>
+
+class TestWaveformSource;
+
+/**
+	@brief Shape of the traffic in a generated protocol capture
+	@ingroup core
+ */
+class ProtocolCorpusConfig
+{
+public:
+	ProtocolCorpusConfig()
+	: m_depth(10000000)
+	, m_burstLength(8)
+	, m_errorRate(0.01)
+	, m_noise(0.02)
+	{}
+
+	/**
+		@brief Number of points in each line of a generated capture
+
+		Corpora which start above clock recovery (8b/10b and 100baseTX) have one point per unit interval, the rest are
+		oversampled 8-16x.
+	 */
+	size_t m_depth;
+
+	///@brief Mean number of back-to-back frames in each burst of traffic
+	size_t m_burstLength;
+
+	///@brief Probability of corrupting each frame
+	double m_errorRate;
+
+	///@brief Standard deviation of the noise added to every line, as a fraction of the signal swing
+	float m_noise;
+};
+
+/**
+	@brief Result of benchmarking one decoder in a protocol chain at one traffic density
+	@ingroup core
+ */
+class ProtocolBenchmarkResult
+{
+public:
+	ProtocolBenchmarkResult()
+	: m_stage(0)
+	, m_density(0)
+	, m_frames(0)
+	, m_corruptFrames(0)
+	, m_inputSamples(0)
+	, m_iterations(0)
+	, m_latencyMin(0)
+	, m_latencyP50(0)
+	, m_latencyMax(0)
+	, m_samplesPerSecond(0)
+	, m_packets(0)
+	, m_outputSamples(0)
+	, m_packetsPerSecond(0)
+	, m_outputAllocations(0)
+	, m_bufferReallocations(0)
+	, m_peakMemory(0)
+	{}
+
+	///@brief Name of the corpus, as returned by ProtocolBenchmark::GetCorpusName()
+	std::string m_corpus;
+
+	///@brief Protocol name of the decoder, as passed to Filter::CreateFilter()
+	std::string m_protocol;
+
+	///@brief Position of the decoder in the chain, 0 for the one fed by the generated lines
+	size_t m_stage;
+
+	///@brief Fraction of the capture occupied by frames
+	double m_density;
+
+	///@brief Number of frames in the generated capture
+	size_t m_frames;
+
+	///@brief Number of frames which were deliberately corrupted
+	size_t m_corruptFrames;
+
+	///@brief Number of points in the largest input of the decoder
+	size_t m_inputSamples;
+
+	///@brief Number of timed refreshes
+	size_t m_iterations;
+
+	///@brief Fastest refresh, in seconds
+	double m_latencyMin;
+
+	///@brief Median refresh time, in seconds
+	double m_latencyP50;
+
+	///@brief Slowest refresh, in seconds
+	double m_latencyMax;
+
+	///@brief Input points processed per second, averaged over all timed refreshes
+	double m_samplesPerSecond;
+
+	///@brief Number of packets in the decoder's packet list after the last refresh (0 if not a PacketDecoder)
+	size_t m_packets;
+
+	///@brief Total number of points in all output streams after the last refresh
+	size_t m_outputSamples;
+
+	///@brief Packets decoded per second, averaged over all timed refreshes
+	double m_packetsPerSecond;
+
+	///@brief Output waveforms allocated (rather than recycled) over all timed refreshes
+	uint64_t m_outputAllocations;
+
+	///@brief AcceleratorBuffer reallocations over all timed refreshes
+	uint64_t m_bufferReallocations;
+
+	/**
+		@brief Largest growth of the resident set during one refresh, in bytes
+
+		Only measured on Linux, and 0 elsewhere or if the kernel doesn't allow resetting the peak.
+	 */
+	uint64_t m_peakMemory;
+
+	///@brief Reason the decoder could not be benchmarked, or empty on success
+	std::string m_error;
+};
+
+/**
+	@brief Benchmarks protocol decoder chains against generated, protocol-valid captures
+
+	FilterBenchmark feeds every filter a noisy sine, which exercises signal processing filters fine but gives protocol
+	decoders nothing to decode. This generates captures which look like real traffic instead: bursts of valid frames
+	separated by idle periods, with a fraction of the frames corrupted and noise added to every line by
+	TestWaveformSource. Each corpus is then run through the usual chain of decoders for that protocol, and each stage is
+	timed separately.
+
+	Traffic density (the fraction of the capture occupied by frames) is swept, since most decoders do very different
+	amounts of work on idle and busy lines. Besides throughput, each stage reports the output allocations and buffer
+	reallocations made while refreshing, and the peak memory growth during a refresh.
+
+	VulkanInit() must already have been called, and the protocol libraries loaded.
+ */
+class ProtocolBenchmark
+{
+public:
+	ProtocolBenchmark();
+	~ProtocolBenchmark();
+
+	ProtocolBenchmark(const ProtocolBenchmark&) =delete;
+	ProtocolBenchmark& operator=(const ProtocolBenchmark&) =delete;
+
+	///@brief The generated captures
+	enum Corpus
+	{
+		CORPUS_UART,
+		CORPUS_SPI,
+		CORPUS_I2C,
+		CORPUS_CAN,
+		CORPUS_USB2,
+		CORPUS_PCIE,
+		CORPUS_100BASETX,
+		CORPUS_DDR3,
+
+		CORPUS_COUNT
+	};
+
+	static std::string GetCorpusName(Corpus corpus);
+
+	///@brief Sets the shape of the generated traffic
+	void SetConfig(const ProtocolCorpusConfig& config)
+	{ m_config = config; }
+
+	///@brief Sets the traffic densities to sweep, each in (0, 1]
+	void SetDensities(const std::vector<double>& densities)
+	{ m_densities = densities; }
+
+	///@brief Sets the number of untimed refreshes run before timing starts
+	void SetWarmupIterations(size_t n)
+	{ m_warmupIterations = n; }
+
+	///@brief Sets the number of timed refreshes for each density
+	void SetIterations(size_t n)
+	{ m_iterations = n; }
+
+	void Run(Corpus corpus);
+	void RunAll();
+
+	///@brief Gets the results of every stage run so far
+	const std::vector<ProtocolBenchmarkResult>& GetResults()
+	{ return m_results; }
+
+	///@brief Discards all results
+	void ClearResults()
+	{ m_results.clear(); }
+
+	std::string ToJSON();
+	bool WriteJSON(const std::string& path);
+
+protected:
+	void RunChain(Corpus corpus, double density);
+
+	void Generate(Corpus corpus, double density);
+	void GenerateUART();
+	void GenerateSPI();
+	void GenerateI2C();
+	void GenerateCAN();
+	void GenerateUSB2();
+	void GeneratePCIe();
+	void Generate100BaseTX();
+	void GenerateDDR3();
+
+	int64_t NextGap(int64_t frameLen, int64_t minGap);
+	bool CorruptNextFrame();
+
+	void DegradeLine(UniformAnalogWaveform* wfm, float swing);
+	void AddDigitalLine(const std::string& input, UniformAnalogWaveform* wfm);
+	void AddAnalogLine(const std::string& input, UniformAnalogWaveform* wfm, float swing);
+	void AddLine(const std::string& input, WaveformBase* wfm, bool digital);
+	void TouchInputs();
+
+	static uint64_t GetProcessMemory(const char* field);
+	static uint64_t ResetPeakMemory();
+
+	///@brief Traffic shape
+	ProtocolCorpusConfig m_config;
+
+	///@brief Traffic densities to sweep
+	std::vector<double> m_densities;
+
+	///@brief Untimed refreshes per density
+	size_t m_warmupIterations;
+
+	///@brief Timed refreshes per density
+	size_t m_iterations;
+
+	///@brief Results so far
+	std::vector<ProtocolBenchmarkResult> m_results;
+
+	///@brief Traffic density of the capture being generated
+	double m_density;
+
+	///@brief Frames left in the current burst
+	size_t m_burstRemaining;
+
+	///@brief Number of frames in the last generated capture
+	size_t m_frames;
+
+	///@brief Number of corrupted frames in the last generated capture
+	size_t m_corruptFrames;
+
+	///@brief Generated lines, with the name of the first decoder's input each one feeds
+	std::vector<std::pair<std::string, std::unique_ptr<OscilloscopeChannel>>> m_lines;
+
+	///@brief Random number generator for traffic and test waveforms
+	std::minstd_rand m_rng;
+
+	///@brief Test waveform generator
+	std::unique_ptr<TestWaveformSource> m_source;
+
+	///@brief Queue used for waveform generation and decoder refreshes
+	std::shared_ptr<QueueHandle> m_queue;
+
+	///@brief Command pool from which m_cmdBuf was allocated
+	std::unique_ptr<vk::raii::CommandPool> m_pool;
+
+	///@brief Command buffer for waveform generation and decoder refreshes
+	std::unique_ptr<vk::raii::CommandBuffer> m_cmdBuf;
+};
+
+#endif
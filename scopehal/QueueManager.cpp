@@ -37,11 +37,68 @@
 
 #include "log.h"
 #include "QueueManager.h"
+#include "GpuTimestampPool.h"
 
 using namespace std;
 
 
 extern bool g_hasDebugUtils;
+extern bool g_hasTimelineSemaphore;
+
+thread_local QueueSubmitScope* QueueSubmitScope::m_current = nullptr;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// QueueSubmitScope
+
+QueueSubmitScope::QueueSubmitScope()
+	: m_timestampPool(nullptr)
+	, m_previous(m_current)
+{
+	m_current = this;
+}
+
+QueueSubmitScope::~QueueSubmitScope()
+{
+	m_current = m_previous;
+}
+
+void QueueSubmitScope::AddWait(const QueueTimelinePoint& point)
+{
+	if(point.m_queue == nullptr)
+		return;
+
+	//Only the newest point on each queue matters
+	for(auto& w : m_waits)
+	{
+		if(w.m_queue == point.m_queue)
+		{
+			w.m_value = max(w.m_value, point.m_value);
+			return;
+		}
+	}
+	m_waits.push_back(point);
+}
+
+/**
+	@brief Records a submission made within the scope
+
+	Later submissions in the scope wait for this one, so the newest point on each queue covers all earlier ones.
+ */
+void QueueSubmitScope::OnSubmit(const QueueTimelinePoint& point)
+{
+	for(auto& s : m_signals)
+	{
+		if(s.m_queue == point.m_queue)
+		{
+			s.m_value = point.m_value;
+			return;
+		}
+	}
+	m_signals.push_back(point);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// QueueHandle
 
 
 QueueHandle::QueueHandle(std::shared_ptr<vk::raii::Device> device, size_t family, size_t index, string name)
@@ -53,7 +110,15 @@ QueueHandle::QueueHandle(std::shared_ptr<vk::raii::Device> device, size_t family
 	, m_queue(make_unique<vk::raii::Queue>(*device, family, index))
 	, m_fence(make_unique<vk::raii::Fence>(*m_device, vk::FenceCreateInfo()))
 	, m_fenceBusy(false)
+	, m_timelineValue(0)
 {
+	if(g_hasTimelineSemaphore)
+	{
+		vk::SemaphoreTypeCreateInfo typeInfo(vk::SemaphoreType::eTimeline, 0);
+		vk::SemaphoreCreateInfo info({}, &typeInfo);
+		m_timeline = make_unique<vk::raii::Semaphore>(*m_device, info);
+	}
+
 	AddName(name);
 
 	if(g_hasDebugUtils)
@@ -69,6 +134,8 @@ QueueHandle::QueueHandle(std::shared_ptr<vk::raii::Device> device, size_t family
 QueueHandle::~QueueHandle()
 {
 	const lock_guard<recursive_mutex> lock(m_mutex);
+	_waitIdle();
+	m_timeline = nullptr;
 	m_fence = nullptr;
 	m_queue = nullptr;
 	m_device = nullptr;
@@ -89,32 +156,145 @@ void QueueHandle::AddName(string name)
 				vk::ObjectType::eQueue,
 				reinterpret_cast<uint64_t>(static_cast<VkQueue>(**m_queue)),
 				m_name.c_str()));
+
+		if(m_timeline)
+		{
+			auto semname = m_name + ".timeline";
+			m_device->setDebugUtilsObjectNameEXT(
+				vk::DebugUtilsObjectNameInfoEXT(
+					vk::ObjectType::eSemaphore,
+					reinterpret_cast<uint64_t>(static_cast<VkSemaphore>(**m_timeline)),
+					semname.c_str()));
+		}
 	}
 }
 
 void QueueHandle::Submit(vk::raii::CommandBuffer const& cmdBuf)
 {
 	const lock_guard<recursive_mutex> lock(m_mutex);
+	_submit(cmdBuf, true);
+}
 
+void QueueHandle::SubmitAndBlock(vk::raii::CommandBuffer const& cmdBuf)
+{
+	const lock_guard<recursive_mutex> lock(m_mutex);
+	_submit(cmdBuf, true);
 	_waitFence();
+}
 
-	m_fenceBusy = true;
+/**
+	@brief Submits the given command buffer without waiting for it to complete, if the caller allows that
 
-	vk::SubmitInfo info({}, {}, *cmdBuf);
-	m_queue->submit(info, **m_fence);
-}
+	When called from within a QueueSubmitScope (as is the case for filters run by FilterGraphExecutor), no fence is
+	used: completion is tracked by the queue's timeline semaphore instead, and anything waiting on the results
+	synchronizes via the scope. Otherwise, or if timeline semaphores are not supported, this is the same as
+	SubmitAndBlock().
 
-void QueueHandle::SubmitAndBlock(vk::raii::CommandBuffer const& cmdBuf)
+	The command buffer must not be re-recorded or freed until the work completes, so this should be the last use of it
+	by the caller.
+ */
+void QueueHandle::SubmitDeferred(vk::raii::CommandBuffer const& cmdBuf)
 {
 	const lock_guard<recursive_mutex> lock(m_mutex);
 
-	_waitFence();
+	if(!m_timeline || !QueueSubmitScope::GetCurrent())
+	{
+		_submit(cmdBuf, true);
+		_waitFence();
+	}
+	else
+		_submit(cmdBuf, false);
+}
+
+/**
+	@brief Submits a command buffer, optionally signaling the fence
 
-	m_fenceBusy = true;
+	Every submission signals the next value of the timeline semaphore (if we have one). If a QueueSubmitScope is
+	active, the submission also waits for all of the scope's points and is recorded in the scope. If the scope has a
+	GpuTimestampPool for our queue family, the command buffer is bracketed by a pair of timestamp writes.
 
-	vk::SubmitInfo info({}, {}, *cmdBuf);
-	m_queue->submit(info, **m_fence);
-	_waitFence();
+	Must obtain the lock before calling!
+ */
+void QueueHandle::_submit(vk::raii::CommandBuffer const& cmdBuf, bool useFence)
+{
+	SCOPEHAL_TRACE_SPAN("QueueHandle::Submit", "gpu-submit");
+	PerformanceCounters::GetThreadCounters().m_queueSubmits ++;
+
+	if(useFence)
+	{
+		_waitFence();
+		m_fenceBusy = true;
+	}
+
+	//Time the work if asked to
+	auto scope = QueueSubmitScope::GetCurrent();
+	std::vector<vk::CommandBuffer> cmdBufs;
+	size_t pair;
+	auto timestamps = scope ? scope->m_timestampPool : nullptr;
+	if(timestamps && (timestamps->GetFamily() == m_family) && timestamps->Allocate(pair))
+	{
+		cmdBufs = { timestamps->GetBeginCommandBuffer(pair), *cmdBuf, timestamps->GetEndCommandBuffer(pair) };
+		scope->m_timestampPairs.push_back(pair);
+	}
+	else
+		cmdBufs = { *cmdBuf };
+	vk::SubmitInfo info({}, {}, cmdBufs);
+
+	if(!m_timeline)
+	{
+		m_queue->submit(info, useFence ? **m_fence : vk::Fence());
+		return;
+	}
+
+	//Wait for everything the scope depends on, plus everything previously submitted in it
+	std::vector<vk::Semaphore> waitSemaphores;
+	std::vector<uint64_t> waitValues;
+	if(scope)
+	{
+		for(auto v : { &scope->m_waits, &scope->m_signals })
+		{
+			for(auto& p : *v)
+			{
+				if(p.m_queue->m_timeline)
+				{
+					waitSemaphores.push_back(**p.m_queue->m_timeline);
+					waitValues.push_back(p.m_value);
+				}
+			}
+		}
+	}
+	std::vector<vk::PipelineStageFlags> waitStages(waitSemaphores.size(), vk::PipelineStageFlagBits::eAllCommands);
+
+	uint64_t signalValue = ++m_timelineValue;
+	vk::Semaphore signalSemaphore = **m_timeline;
+	vk::TimelineSemaphoreSubmitInfo timelineInfo(waitValues, signalValue);
+	info.setWaitSemaphores(waitSemaphores);
+	info.setWaitDstStageMask(waitStages);
+	info.setSignalSemaphores(signalSemaphore);
+	info.pNext = &timelineInfo;
+
+	m_queue->submit(info, useFence ? **m_fence : vk::Fence());
+
+	if(scope)
+		scope->OnSubmit(QueueTimelinePoint(this, signalValue));
+}
+
+void QueueHandle::WaitForValue(uint64_t value)
+{
+	if(!m_timeline || (value == 0))
+		return;
+
+	vk::Semaphore sem = **m_timeline;
+	vk::SemaphoreWaitInfo info({}, sem, value);
+	while(vk::Result::eTimeout == m_device->waitSemaphores(info, 1000 * 1000))
+	{}
+}
+
+bool QueueHandle::IsValueComplete(uint64_t value)
+{
+	if(!m_timeline || (value == 0))
+		return true;
+	return m_timeline->getCounterValue() >= value;
 }
 
 /**
@@ -124,6 +304,15 @@ void QueueHandle::SubmitAndBlock(vk::raii::CommandBuffer const& cmdBuf)
  */
 bool QueueHandle::WaitIdleWithTimeout(uint64_t nanoseconds)
 {
+	//Deferred submissions don't use the fence, so check the timeline semaphore
+	if(m_timeline && (m_timelineValue != 0))
+	{
+		vk::Semaphore sem = **m_timeline;
+		vk::SemaphoreWaitInfo info({}, sem, m_timelineValue);
+		if(vk::Result::eTimeout == m_device->waitSemaphores(info, nanoseconds))
+			return false;
+	}
+
 	//Not busy? Return immediately
 	if(!m_fenceBusy)
 		return true;
@@ -145,6 +334,7 @@ void QueueHandle::_waitFence()
 		return;
 
 	//Wait for any previous submit to finish
+	SCOPEHAL_TRACE_SPAN("QueueHandle::WaitFence", "gpu-submit");
 	while(vk::Result::eTimeout == m_device->waitForFences({**m_fence}, VK_TRUE, 1000 * 1000))
 	{}
 
@@ -152,6 +342,12 @@ void QueueHandle::_waitFence()
 	m_device->resetFences(**m_fence);
 }
 
+void QueueHandle::_waitIdle()
+{
+	_waitFence();
+	WaitForValue(m_timelineValue);
+}
+
 
 QueueManager::QueueManager(vk::raii::PhysicalDevice* phys, std::shared_ptr<vk::raii::Device> device)
 : m_phys(phys)
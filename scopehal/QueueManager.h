@@ -44,6 +44,92 @@
 #include <vulkan/vulkan_raii.hpp>
 
 class QueueLock;
+class QueueHandle;
+class GpuTimestampPool;
+
+/**
+ * @brief A value on the timeline semaphore of a QueueHandle
+ *
+ * The queue has finished everything submitted up to and including the submission that signaled this value once its
+ * semaphore reaches it. Queue handles are owned by the QueueManager and live until it is destroyed, so storing a raw
+ * pointer here is safe.
+ */
+class QueueTimelinePoint
+{
+public:
+	QueueTimelinePoint(QueueHandle* queue = nullptr, uint64_t value = 0)
+	: m_queue(queue)
+	, m_value(value)
+	{}
+
+	QueueHandle* m_queue;
+	uint64_t m_value;
+};
+
+/**
+ * @brief Collects the GPU work submitted by the calling thread while it exists, and makes that work wait for earlier work
+ *
+ * While a scope is active on a thread, every submission made from that thread to any QueueHandle waits (on the GPU)
+ * for all points passed to AddWait() and for everything previously submitted within the scope, and
+ * QueueHandle::SubmitDeferred() returns without blocking. GetSignals() then returns the points which, once reached,
+ * indicate that all of the work submitted within the scope has completed.
+ *
+ * Scopes are only meaningful when timeline semaphores are available (see g_hasTimelineSemaphore). Without them every
+ * submission blocks as usual and GetSignals() is always empty.
+ */
+class QueueSubmitScope
+{
+public:
+	QueueSubmitScope();
+	~QueueSubmitScope();
+
+	/// Make all subsequent submissions in the scope wait for a point on another queue
+	void AddWait(const QueueTimelinePoint& point);
+
+	/// Get the points signaled by the most recent submission to each queue in the scope
+	const std::vector<QueueTimelinePoint>& GetSignals() const
+	{ return m_signals; }
+
+	/// Time every subsequent submission in the scope to a queue of the pool's family
+	void SetTimestampPool(GpuTimestampPool* pool)
+	{ m_timestampPool = pool; }
+
+	/// Get the timestamp query pairs used by submissions in the scope, to be resolved once they complete
+	const std::vector<size_t>& GetTimestampPairs() const
+	{ return m_timestampPairs; }
+
+	/// Get the scope active on the calling thread, if any
+	static QueueSubmitScope* GetCurrent()
+	{ return m_current; }
+
+public:
+	//non-copyable
+	QueueSubmitScope(QueueSubmitScope const&) = delete;
+	QueueSubmitScope& operator=(QueueSubmitScope const&) = delete;
+
+protected:
+	friend class QueueHandle;
+
+	void OnSubmit(const QueueTimelinePoint& point);
+
+	/// Points every submission must wait for
+	std::vector<QueueTimelinePoint> m_waits;
+
+	/// Most recent point signaled on each queue
+	std::vector<QueueTimelinePoint> m_signals;
+
+	/// Pool to time submissions with, if any
+	GpuTimestampPool* m_timestampPool;
+
+	/// Timestamp query pairs used by submissions in the scope
+	std::vector<size_t> m_timestampPairs;
+
+	/// Scope which was active before this one was created
+	QueueSubmitScope* m_previous;
+
+	/// Scope active on the calling thread
+	static thread_local QueueSubmitScope* m_current;
+};
 
 /**
  * @brief Wrapper around a Vulkan Queue, protected by mutex for thread safety.
@@ -62,6 +148,31 @@ public:
 	void Submit(vk::raii::CommandBuffer const& cmdBuf);
 	/// Submit the given command buffer on the queue and wait until completion
 	void SubmitAndBlock(vk::raii::CommandBuffer const& cmdBuf);
+	/// Submit the given command buffer on the queue, only waiting for completion if no QueueSubmitScope is active
+	void SubmitDeferred(vk::raii::CommandBuffer const& cmdBuf);
+
+	/// Block until the timeline semaphore reaches the given value
+	void WaitForValue(uint64_t value);
+	/// Check if the timeline semaphore has reached the given value
+	bool IsValueComplete(uint64_t value);
+
+	/// Block until every point in a list has been reached
+	static void WaitForPoints(const std::vector<QueueTimelinePoint>& points)
+	{
+		for(auto& p : points)
+			p.m_queue->WaitForValue(p.m_value);
+	}
+
+	/// Check if every point in a list has been reached
+	static bool ArePointsComplete(const std::vector<QueueTimelinePoint>& points)
+	{
+		for(auto& p : points)
+		{
+			if(!p.m_queue->IsValueComplete(p.m_value))
+				return false;
+		}
+		return true;
+	}
 
 	const std::string& GetName() const
 	{ return m_name; }
@@ -72,7 +183,7 @@ public:
 	void WaitIdle()
 	{
 		const std::lock_guard<std::recursive_mutex> lock(m_mutex);
-		_waitFence();
+		_waitIdle();
 	}
 
 	bool WaitIdleWithTimeout(uint64_t nanoseconds);
@@ -87,6 +198,11 @@ protected:
 	/// Must obtain the lock before calling!
 	void _waitFence();
 
+	/// Waits for everything previously submitted, including deferred submissions. Must obtain the lock before calling!
+	void _waitIdle();
+
+	void _submit(vk::raii::CommandBuffer const& cmdBuf, bool useFence);
+
 public:
 	const size_t m_family;
 	const size_t m_index;
@@ -100,6 +216,12 @@ protected:
 	std::unique_ptr<vk::raii::Fence> m_fence;
 
 	bool m_fenceBusy;
+
+	/// Timeline semaphore signaled by every submission (null if timeline semaphores are not supported)
+	std::unique_ptr<vk::raii::Semaphore> m_timeline;
+
+	/// Value signaled by the most recent submission
+	uint64_t m_timelineValue;
 };
 
 
@@ -115,7 +237,7 @@ public:
 	QueueLock(std::shared_ptr<QueueHandle> handle)
 	: m_lock(handle->m_mutex)
 	, m_handle(handle)
-	{ handle->_waitFence(); }
+	{ handle->_waitIdle(); }
 
 	vk::raii::Queue& operator*()
 	{ return *(m_handle->m_queue); }
@@ -157,6 +279,11 @@ public:
 	std::shared_ptr<QueueHandle> GetTransferQueue(std::string name)
 	{ return GetQueueWithFlags(vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer, name); }
 
+	/// Get a handle to a queue for plain buffer copies
+	/// @note Only Transfer capabilities are required, so this is a dedicated DMA engine queue if the device has one
+	std::shared_ptr<QueueHandle> GetDmaQueue(std::string name)
+	{ return GetQueueWithFlags(vk::QueueFlagBits::eTransfer, name); }
+
 	/// Get a handle to a queue that has the given flag bits set, allocating the queue if necessary,
 	/// and set or append name to the queue name for debug
 	std::shared_ptr<QueueHandle> GetQueueWithFlags(vk::QueueFlags flags, std::string name);
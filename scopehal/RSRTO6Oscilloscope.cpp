@@ -111,7 +111,13 @@ RSRTO6Oscilloscope::RSRTO6Oscilloscope(SCPITransport* transport)
 			i);
 		m_channels.push_back(chan);
 		chan->SetDefaultDisplayName();
+
+		//Raw ADC codes are downloaded here, then converted to volts (on the GPU if possible)
+		m_analogRawWaveformBuffers.push_back(std::make_unique<AcceleratorBuffer<int16_t> >());
+		m_analogRawWaveformBuffers[i]->SetCpuAccessHint(AcceleratorBuffer<int16_t>::HINT_LIKELY);
+		m_analogRawWaveformBuffers[i]->SetGpuAccessHint(AcceleratorBuffer<int16_t>::HINT_LIKELY);
 	}
+	m_converter = make_unique<RawSampleConverter>("RSRTO6Oscilloscope");
 
 	// All RTO6 have external trigger; only edge is supported
 	m_extTrigChannel = new OscilloscopeChannel(
@@ -190,7 +196,8 @@ RSRTO6Oscilloscope::RSRTO6Oscilloscope(SCPITransport* transport)
 		}
 	}
 
-	m_transport->SendCommandQueued("FORMat:DATA REAL,32"); //Report in f32
+	m_transport->SendCommandQueued("FORMat:DATA INT,16"); //Report raw ADC codes, converted locally
+	m_transport->SendCommandQueued("FORMat:BORDer LSBFirst");
 	m_transport->SendCommandQueued("ACQuire:COUNt 1"); //Limit to one acquired waveform per "SINGLE"
 	m_transport->SendCommandQueued("EXPort:WAVeform:INCXvalues OFF"); //Don't include X values in data
 	m_transport->SendCommandQueued("TIMebase:ROLL:ENABle OFF"); //No roll mode
@@ -758,6 +765,28 @@ template <typename T> size_t RSRTO6Oscilloscope::AcquireHeader(T* cap, string ch
 	return length;
 }
 
+/**
+	@brief Reads the scaling of an analog channel's INT,16 waveform data
+
+	Queried fresh for every acquisition rather than taken from the config cache, since the data must be converted
+	with the settings it was actually captured with. Codes are signed, with zero at the center of the screen and
+	253*256 codes spanning the full vertical range (10 divisions).
+
+	@param i		Channel index
+	@param gain		Volts per code
+	@param offset	Offset, in volts, added after scaling
+ */
+void RSRTO6Oscilloscope::GetRawSampleScaling(size_t i, float& gain, float& offset)
+{
+	auto hwname = m_channels[i]->GetHwname();
+	float range = stof(m_transport->SendCommandImmediateWithReply(hwname + ":RANGe?"));
+	float offs = stof(m_transport->SendCommandImmediateWithReply(hwname + ":OFFSet?"));
+	float pos = stof(m_transport->SendCommandImmediateWithReply(hwname + ":POSition?"));
+
+	gain = range / (253 * 256);
+	offset = offs - pos * range / 10;
+}
+
 bool RSRTO6Oscilloscope::AcquireData()
 {
 	lock_guard<recursive_mutex> lock(m_mutex);
@@ -793,11 +822,18 @@ bool RSRTO6Oscilloscope::AcquireData()
 
 		any_data = true;
 
+		float gain;
+		float offset;
+		GetRawSampleScaling(i, gain, offset);
+
 		size_t transferred = 0;
 		// Request a reasonably-sized buffer as this may cause RAM allocation in recv(2)
 		const size_t block_size = 50e6;
 
-		unsigned char* dest_buf = (unsigned char*)cap->m_samples.GetCpuPointer();
+		auto& raw = *m_analogRawWaveformBuffers[i];
+		raw.resize(length);
+		raw.PrepareForCpuAccess();
+		unsigned char* dest_buf = (unsigned char*)raw.GetCpuPointer();
 
 		LogDebug(" - Begin transfer of %zu bytes\n", length);
 
@@ -818,12 +854,15 @@ bool RSRTO6Oscilloscope::AcquireData()
 			size_t len_bytes;
 			unsigned char* samples = (unsigned char*)m_transport->SendCommandImmediateWithRawBlockReply(m_channels[i]->GetHwname() + ":DATA?"+params+"; *WAI", len_bytes);
 
-			if (len_bytes != (this_length*sizeof(float)))
+			if (len_bytes != (this_length*sizeof(int16_t)))
 			{
 				LogError("Unexpected number of bytes back; aborting acquisition");
 				std::this_thread::sleep_for(std::chrono::microseconds(100000));
 				m_transport->FlushRXBuffer();
 
+				//Earlier channels may still be converting
+				m_converter->WaitIdle();
+
 				delete cap;
 
 				for (auto* c : pending_waveforms[i])
@@ -836,7 +875,7 @@ bool RSRTO6Oscilloscope::AcquireData()
 				return false;
 			}
 
-			unsigned char* cpy_target = dest_buf+(transferred*sizeof(float));
+			unsigned char* cpy_target = dest_buf+(transferred*sizeof(int16_t));
 			// LogDebug("Copying %zuB from %p to %p\n", len_bytes, samples, cpy_target);
 
 			memcpy(cpy_target, samples, len_bytes);
@@ -850,12 +889,16 @@ bool RSRTO6Oscilloscope::AcquireData()
 
 		LogDebug("[100%%] Done\n");
 
-		cap->MarkSamplesModifiedFromCpu();
+		raw.MarkModifiedFromCpu();
+		m_converter->Convert16Bit(cap, raw, gain, offset);
 
 		//Done, update the data
 		pending_waveforms[i].push_back(cap);
 	}
 
+	//Let the GPU convert the analog channels while we download the digital ones
+	m_converter->Submit();
+
 	bool didAcquireAnyDigitalChannels = false;
 
 	for(size_t i=m_digitalChannelBase; i<(m_digitalChannelBase + m_digitalChannelCount); i++)
@@ -961,12 +1004,13 @@ bool RSRTO6Oscilloscope::AcquireData()
 	}
 
 	if (didAcquireAnyDigitalChannels)
-		m_transport->SendCommandImmediate("FORMat:DATA REAL,32"); //Return to f32
+		m_transport->SendCommandImmediate("FORMat:DATA INT,16"); //Return to raw ADC codes
+
+	m_converter->WaitIdle();
 
 	if (any_data)
 	{
 		//Now that we have all of the pending waveforms, save them in sets across all channels
-		m_pendingWaveformsMutex.lock();
 		size_t num_pending = 1;	//TODO: segmented capture support
 		for(size_t i=0; i<num_pending; i++)
 		{
@@ -976,9 +1020,8 @@ bool RSRTO6Oscilloscope::AcquireData()
 				if(IsChannelEnabled(j))
 					s[m_channels[j]] = pending_waveforms[j][i];
 			}
-			m_pendingWaveforms.push_back(s);
+			PushPendingWaveform(s);
 		}
-		m_pendingWaveformsMutex.unlock();
 	}
 
 	if(!any_data || !m_triggerOneShot)
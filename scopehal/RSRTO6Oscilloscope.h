@@ -156,6 +156,13 @@ protected:
 	{ return index - m_digitalChannelBase; }
 
 	template <typename T> size_t AcquireHeader(T* cap, std::string chname);
+	void GetRawSampleScaling(size_t i, float& gain, float& offset);
+
+	///@brief Raw INT,16 sample data for each analog channel, as downloaded from the scope
+	std::vector<std::unique_ptr<AcceleratorBuffer<int16_t> > > m_analogRawWaveformBuffers;
+
+	///@brief Converts raw ADC codes to volts
+	std::unique_ptr<RawSampleConverter> m_converter;
 
 	//config cache
 	std::map<size_t, float> m_channelOffsets;
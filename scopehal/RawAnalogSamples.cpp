@@ -0,0 +1,183 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of RawAnalogSamples
+	@ingroup datamodel
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+RawAnalogSamples::RawAnalogSamples()
+	: m_byteOffset(0)
+	, m_cpuCodes(nullptr)
+	, m_size(0)
+	, m_bits(8)
+	, m_gain(1)
+	, m_offset(0)
+{
+}
+
+/**
+	@brief Makes sure we have a block of our own to copy codes into (not shared with anyone else)
+
+	@param bytes	Size of the block
+ */
+void RawAnalogSamples::AllocatePrivate(size_t bytes)
+{
+	if(!m_codes || (m_codes.use_count() > 1))
+	{
+		//Codes are only ever read and converted on the CPU
+		m_codes = make_shared< AcceleratorBuffer<int8_t> >();
+		m_codes->SetName("RawAnalogSamples.m_codes");
+		m_codes->SetCpuAccessHint(AcceleratorBuffer<int8_t>::HINT_LIKELY);
+		m_codes->SetGpuAccessHint(AcceleratorBuffer<int8_t>::HINT_NEVER);
+	}
+
+	m_codes->resize(bytes);
+	m_codes->PrepareForCpuAccess();
+	m_byteOffset = 0;
+	m_cpuCodes = m_codes->GetCpuPointer();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Conversion
+
+/**
+	@brief Stores a copy of signed 8-bit ADC codes
+
+	@param codes	Raw ADC codes (CPU readable)
+	@param len		Number of samples
+	@param gain		Volts per code
+	@param offset	Offset added after scaling
+ */
+void RawAnalogSamples::Set8Bit(const int8_t* codes, size_t len, float gain, float offset)
+{
+	AllocatePrivate(len * sizeof(int8_t));
+	memcpy(m_codes->GetCpuPointer(), codes, len * sizeof(int8_t));
+	m_codes->MarkModifiedFromCpu();
+
+	m_size = len;
+	m_bits = 8;
+	m_gain = gain;
+	m_offset = offset;
+}
+
+/**
+	@brief Stores a copy of signed 16-bit ADC codes
+
+	@param codes	Raw ADC codes (CPU readable)
+	@param len		Number of samples
+	@param gain		Volts per code
+	@param offset	Offset added after scaling
+ */
+void RawAnalogSamples::Set16Bit(const int16_t* codes, size_t len, float gain, float offset)
+{
+	AllocatePrivate(len * sizeof(int16_t));
+	memcpy(m_codes->GetCpuPointer(), codes, len * sizeof(int16_t));
+	m_codes->MarkModifiedFromCpu();
+
+	m_size = len;
+	m_bits = 16;
+	m_gain = gain;
+	m_offset = offset;
+}
+
+/**
+	@brief Refers to codes in a block shared with other waveforms, rather than copying them
+
+	The block is kept alive until every waveform referring to it has been expanded or destroyed, and must not be
+	modified afterwards.
+
+	@param block		Block of codes (CPU readable)
+	@param byteOffset	Offset of the first code within the block, in bytes (must be aligned for 16-bit codes)
+	@param len			Number of samples
+	@param bits			Bits per code (8 or 16)
+	@param gain			Volts per code
+	@param offset		Offset added after scaling
+ */
+void RawAnalogSamples::SetView(
+	shared_ptr<AcceleratorBuffer<int8_t> > block,
+	size_t byteOffset,
+	size_t len,
+	int bits,
+	float gain,
+	float offset)
+{
+	m_codes = block;
+	m_byteOffset = byteOffset;
+	m_codes->PrepareForCpuAccess();
+	m_cpuCodes = m_codes->GetCpuPointer() + m_byteOffset;
+
+	m_size = len;
+	m_bits = bits;
+	m_gain = gain;
+	m_offset = offset;
+}
+
+/**
+	@brief Makes sure the codes are readable from the CPU before calling GetCode() or GetSample()
+ */
+void RawAnalogSamples::PrepareForCpuAccess()
+{
+	if(!m_codes)
+		return;
+	m_codes->PrepareForCpuAccess();
+	m_cpuCodes = m_codes->GetCpuPointer() + m_byteOffset;
+}
+
+/**
+	@brief Converts the codes to floating point
+
+	@param samples	Output buffer, resized to size()
+ */
+void RawAnalogSamples::Expand(AcceleratorBuffer<float>& samples)
+{
+	samples.resize(m_size);
+	samples.PrepareForCpuAccess();
+	PrepareForCpuAccess();
+
+	//Oscilloscope helpers subtract the offset rather than adding it
+	if(m_bits == 8)
+		Oscilloscope::Convert8BitSamples(samples.GetCpuPointer(), m_cpuCodes, m_gain, -m_offset, m_size);
+	else
+	{
+		Oscilloscope::Convert16BitSamples(
+			samples.GetCpuPointer(), reinterpret_cast<const int16_t*>(m_cpuCodes), m_gain, -m_offset, m_size);
+	}
+
+	samples.MarkModifiedFromCpu();
+}
@@ -0,0 +1,147 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of RawAnalogSamples
+	@ingroup datamodel
+ */
+
+#ifndef RawAnalogSamples_h
+#define RawAnalogSamples_h
+
+/**
+	@brief Unconverted ADC codes for a uniform analog waveform, plus the gain and offset needed to turn them into volts
+	@ingroup datamodel
+
+	Converting 8 or 16 bit ADC codes to fp32 as soon as they're downloaded quadruples (or doubles) the memory used by
+	a deep capture, even if the only consumer is a threshold or a decode which never needs the voltages. Drivers can
+	instead hand the codes to UniformWaveform::SetRawSamples8Bit() / SetRawSamples16Bit(); they stay in this form
+	until something calls PrepareForCpuAccess() / PrepareForGpuAccess() on the waveform, at which point they're
+	converted (see Expand()) and freed.
+
+	Consumers which understand raw codes (see FlowGraphNode::AcceptsRawSamples()) can read them in place with
+	GetSample() and skip the conversion entirely. GPU consumers can bind GetCodes() to a shader: code i lives at
+	byte GetByteOffset() + i*GetBitsPerSample()/8. Like any byte buffer used on the GPU, it is padded to a multiple of
+	four bytes, so it can be read as an array of 32-bit words.
+
+	The codes may either be a private copy, or a view into a block shared with other waveforms (see SetView()). The
+	latter lets a segmented capture be downloaded as one block and split into per-segment waveforms without copying.
+
+	Sample i is GetCode(i) * GetGain() + GetOffset().
+ */
+class RawAnalogSamples
+{
+public:
+	RawAnalogSamples();
+
+	void Set8Bit(const int8_t* codes, size_t len, float gain, float offset);
+	void Set16Bit(const int16_t* codes, size_t len, float gain, float offset);
+	void SetView(
+		std::shared_ptr<AcceleratorBuffer<int8_t> > block,
+		size_t byteOffset,
+		size_t len,
+		int bits,
+		float gain,
+		float offset);
+
+	void Expand(AcceleratorBuffer<float>& samples);
+	void PrepareForCpuAccess();
+
+	///@brief Gets the ADC code for sample i
+	int GetCode(size_t i) const
+	{
+		if(m_bits == 8)
+			return m_cpuCodes[i];
+		return reinterpret_cast<const int16_t*>(m_cpuCodes)[i];
+	}
+
+	///@brief Gets sample i, in volts (or whatever unit the waveform is in)
+	float GetSample(size_t i) const
+	{ return GetCode(i) * m_gain + m_offset; }
+
+	///@brief Returns the number of samples
+	size_t size() const
+	{ return m_size; }
+
+	///@brief Returns the number of bits per ADC code (8 or 16)
+	int GetBitsPerSample() const
+	{ return m_bits; }
+
+	///@brief Returns the scale factor from codes to volts
+	float GetGain() const
+	{ return m_gain; }
+
+	///@brief Returns the offset added after scaling
+	float GetOffset() const
+	{ return m_offset; }
+
+	///@brief Returns the number of bytes of sample storage used (our share of it, if it's a view)
+	size_t GetMemoryUsage() const
+	{ return m_size * m_bits / 8; }
+
+	///@brief Gets the buffer holding the codes, which may be shared with other waveforms
+	AcceleratorBuffer<int8_t>& GetCodes()
+	{ return *m_codes; }
+
+	///@brief Gets the offset of our first code within GetCodes(), in bytes
+	size_t GetByteOffset() const
+	{ return m_byteOffset; }
+
+	///@brief Returns true if the codes are a view into a larger block shared with other waveforms
+	bool IsView() const
+	{ return m_codes && (m_codes.use_count() > 1); }
+
+protected:
+	void AllocatePrivate(size_t bytes);
+
+	///@brief Block holding the codes (8 or 16 bit, stored as bytes)
+	std::shared_ptr<AcceleratorBuffer<int8_t> > m_codes;
+
+	///@brief Offset of our first code within m_codes, in bytes
+	size_t m_byteOffset;
+
+	///@brief CPU pointer to our first code
+	const int8_t* m_cpuCodes;
+
+	///@brief Number of samples
+	size_t m_size;
+
+	///@brief Bits per code
+	int m_bits;
+
+	///@brief Volts per code
+	float m_gain;
+
+	///@brief Offset added after scaling
+	float m_offset;
+};
+
+#endif
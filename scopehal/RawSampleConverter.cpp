@@ -0,0 +1,262 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of RawSampleConverter
+	@ingroup core
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates the converter
+
+	@param name	Name of the owning driver, used to label Vulkan objects
+ */
+RawSampleConverter::RawSampleConverter(const string& name)
+	: m_name(name)
+	, m_recording(false)
+	, m_inFlight(false)
+{
+	m_queue = g_vkQueueManager->GetComputeQueue(name + ".conversionQueue");
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		m_queue->m_family );
+	m_pool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(**m_pool, vk::CommandBufferLevel::ePrimary, 1);
+	m_cmdBuf = make_unique<vk::raii::CommandBuffer>(
+		std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	if(g_hasDebugUtils)
+	{
+		string poolname = name + ".conversionPool";
+		string bufname = name + ".conversionCmdbuf";
+
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandPool,
+				reinterpret_cast<uint64_t>(static_cast<VkCommandPool>(**m_pool)),
+				poolname.c_str()));
+
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandBuffer,
+				reinterpret_cast<uint64_t>(static_cast<VkCommandBuffer>(**m_cmdBuf)),
+				bufname.c_str()));
+	}
+
+	if(g_hasShaderInt8)
+	{
+		m_conversion8BitPipeline = make_unique<ComputePipeline>(
+			"shaders/Convert8BitSamples.spv", 2, sizeof(ConvertRawSamplesShaderArgs) );
+		m_conversion8BitClipPipeline = make_unique<ComputePipeline>(
+			"shaders/Convert8BitSamplesWithClipDetection.spv", 3, sizeof(ConvertRawSamplesShaderArgs) );
+	}
+	if(g_hasShaderInt16)
+	{
+		m_conversion16BitPipeline = make_unique<ComputePipeline>(
+			"shaders/Convert16BitSamples.spv", 2, sizeof(ConvertRawSamplesShaderArgs) );
+	}
+}
+
+RawSampleConverter::~RawSampleConverter()
+{
+	WaitIdle();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Conversion
+
+/**
+	@brief Records the dispatch for a conversion whose buffers have already been bound
+
+	@param pipe		Pipeline to dispatch
+	@param cap		Output waveform
+	@param gain		Volts per code
+	@param offset	Offset added after scaling
+	@param start	Index of the first code within the raw buffer
+ */
+void RawSampleConverter::Dispatch(
+	ComputePipeline* pipe,
+	UniformAnalogWaveform* cap,
+	float gain,
+	float offset,
+	size_t start)
+{
+	ConvertRawSamplesShaderArgs args;
+	args.size = cap->size();
+	args.gain = gain;
+	args.offset = -offset;
+	args.start = start;
+
+	const uint32_t compute_block_count = GetComputeBlockCount(cap->size(), 64);
+	if(g_hasPushDescriptor)
+	{
+		pipe->Bind(*m_cmdBuf);
+		pipe->DispatchNoRebind(*m_cmdBuf, args, min(compute_block_count, 32768u), compute_block_count / 32768 + 1);
+	}
+	else
+		pipe->Dispatch(*m_cmdBuf, args, min(compute_block_count, 32768u), compute_block_count / 32768 + 1);
+
+	cap->MarkModifiedFromGpu();
+}
+
+/**
+	@brief Gets a zeroed clip detection flag buffer for a waveform in the batch being recorded
+ */
+AcceleratorBuffer<uint32_t>& RawSampleConverter::GetClipBuffer(UniformAnalogWaveform* cap)
+{
+	size_t iclip = m_clipWaveforms.size();
+	if(m_clipBuffers.size() <= iclip)
+	{
+		auto buf = make_unique<AcceleratorBuffer<uint32_t> >();
+		buf->SetCpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+		buf->SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+		buf->resize(1);
+		m_clipBuffers.push_back(std::move(buf));
+	}
+	m_clipWaveforms.push_back(cap);
+
+	auto& clip = *m_clipBuffers[iclip];
+	clip.PrepareForCpuAccess();
+	clip[0] = 0;
+	clip.MarkModifiedFromCpu();
+	return clip;
+}
+
+/**
+	@brief Sets the clipping flag on a waveform if any raw sample is at either rail
+ */
+void RawSampleConverter::DetectClippingCPU(UniformAnalogWaveform* cap, const int8_t* raw, size_t len)
+{
+	for(size_t i=0; i<len; i++)
+	{
+		if( (raw[i] == -128) || (raw[i] == 127) )
+		{
+			cap->m_flags |= WaveformBase::WAVEFORM_CLIPPING;
+			return;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Batching
+
+/**
+	@brief Makes sure m_cmdBuf is recording and can accept a dispatch of the given pipeline
+
+	Without push descriptors, each pipeline has a single descriptor set and can only be dispatched once per command
+	buffer, so a second use submits the current batch and starts a new one.
+ */
+void RawSampleConverter::BeginBatch(ComputePipeline* pipe)
+{
+	if(m_recording && !g_hasPushDescriptor && m_pipelinesUsed.count(pipe))
+		Submit();
+
+	if(!m_recording)
+	{
+		//Command buffer and clip buffers are reused, so the previous batch has to be done
+		WaitIdle();
+		m_cmdBuf->begin({});
+		m_recording = true;
+	}
+
+	m_pipelinesUsed.emplace(pipe);
+}
+
+/**
+	@brief Submits all conversions recorded so far, without blocking
+ */
+void RawSampleConverter::Submit()
+{
+	if(!m_recording)
+		return;
+
+	m_cmdBuf->end();
+	m_queue->Submit(*m_cmdBuf);
+	m_recording = false;
+	m_inFlight = true;
+	m_pipelinesUsed.clear();
+}
+
+/**
+	@brief Submits any pending conversions and blocks until they complete
+ */
+void RawSampleConverter::WaitIdle()
+{
+	Submit();
+	if(!m_inFlight)
+		return;
+
+	m_queue->WaitIdle();
+	FinishBatch();
+}
+
+/**
+	@brief Submits any pending conversions and waits up to the specified time for them to complete
+
+	@return True if all conversions are complete
+ */
+bool RawSampleConverter::WaitIdleWithTimeout(uint64_t nanoseconds)
+{
+	Submit();
+	if(!m_inFlight)
+		return true;
+
+	if(!m_queue->WaitIdleWithTimeout(nanoseconds))
+		return false;
+	FinishBatch();
+	return true;
+}
+
+/**
+	@brief Copies clip detection results into the waveforms of the completed batch
+ */
+void RawSampleConverter::FinishBatch()
+{
+	for(size_t i=0; i<m_clipWaveforms.size(); i++)
+	{
+		auto& clip = *m_clipBuffers[i];
+		clip.MarkModifiedFromGpu();
+		clip.PrepareForCpuAccess();
+		if(clip[0])
+			m_clipWaveforms[i]->m_flags |= WaveformBase::WAVEFORM_CLIPPING;
+	}
+	m_clipWaveforms.clear();
+	m_inFlight = false;
+}
@@ -0,0 +1,211 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of RawSampleConverter
+	@ingroup core
+ */
+
+#ifndef RawSampleConverter_h
+#define RawSampleConverter_h
+
+/**
+	@brief Shared helper for drivers converting raw ADC codes to UniformAnalogWaveforms
+
+	Drivers download raw samples into an AcceleratorBuffer (ideally pinned, with a GPU access hint) then call
+	Convert() once per channel. If the GPU supports the required integer storage types, Convert() records a
+	dispatch of the matching Convert*BitSamples shader and the output stays GPU resident. Only the raw bytes cross
+	the bus, which is a quarter (or half) the size of the converted floats. Otherwise the samples are converted on
+	the CPU immediately, so callers need no fallback code of their own.
+
+	Conversions are batched into a single submission where the device supports push descriptors. Call Submit()
+	after the last channel to start the GPU work without blocking, and WaitIdle() (or poll WaitIdleWithTimeout())
+	before handing the waveforms off. Clip detection results are written to the waveform flags once the batch completes.
+
+	Raw buffers must not be modified until the batch they were used in completes.
+ */
+class RawSampleConverter
+{
+public:
+	RawSampleConverter(const std::string& name);
+	~RawSampleConverter();
+
+	/**
+		@brief Converts signed 8-bit samples
+
+		The raw buffer may have any element type (some drivers reuse one set of buffers for 8 and 16 bit data),
+		its contents are interpreted as int8_t.
+
+		@param cap				Output waveform. Must already be resized to the number of samples to convert
+		@param raw				Raw ADC codes
+		@param gain				Volts per code
+		@param offset			Offset added after scaling
+		@param detectClipping	Set WAVEFORM_CLIPPING on the output if any sample is at either rail
+		@param start			Index of the first code to convert within raw (in codes, not elements of T)
+	 */
+	template<class T>
+	void Convert8Bit(
+		UniformAnalogWaveform* cap,
+		AcceleratorBuffer<T>& raw,
+		float gain,
+		float offset,
+		bool detectClipping = false,
+		size_t start = 0)
+	{
+		size_t len = cap->size();
+		if(len == 0)
+			return;
+
+		//CPU fallback
+		if(!IsGpuConversionAvailable8Bit())
+		{
+			raw.PrepareForCpuAccess();
+			cap->PrepareForCpuAccess();
+			auto p = reinterpret_cast<const int8_t*>(raw.GetCpuPointer()) + start;
+			Oscilloscope::Convert8BitSamples(cap->m_samples.GetCpuPointer(), p, gain, -offset, len);
+			if(detectClipping)
+				DetectClippingCPU(cap, p, len);
+			cap->MarkSamplesModifiedFromCpu();
+			return;
+		}
+
+		auto pipe = detectClipping ? m_conversion8BitClipPipeline.get() : m_conversion8BitPipeline.get();
+		BeginBatch(pipe);
+		pipe->BindBufferNonblocking(0, cap->m_samples, *m_cmdBuf, true);
+		pipe->BindBufferNonblocking(1, raw, *m_cmdBuf);
+		if(detectClipping)
+			pipe->BindBufferNonblocking(2, GetClipBuffer(cap), *m_cmdBuf);
+		Dispatch(pipe, cap, gain, offset, start);
+	}
+
+	/**
+		@brief Converts signed 16-bit samples
+
+		As with Convert8Bit(), the raw buffer may have any element type; its contents are interpreted as int16_t.
+
+		@param cap		Output waveform. Must already be resized to the number of samples to convert
+		@param raw		Raw ADC codes
+		@param gain		Volts per code
+		@param offset	Offset added after scaling
+		@param start	Index of the first code to convert within raw (in codes, not elements of T)
+	 */
+	template<class T>
+	void Convert16Bit(
+		UniformAnalogWaveform* cap,
+		AcceleratorBuffer<T>& raw,
+		float gain,
+		float offset,
+		size_t start = 0)
+	{
+		size_t len = cap->size();
+		if(len == 0)
+			return;
+
+		//CPU fallback
+		if(!IsGpuConversionAvailable16Bit())
+		{
+			raw.PrepareForCpuAccess();
+			cap->PrepareForCpuAccess();
+			Oscilloscope::Convert16BitSamples(
+				cap->m_samples.GetCpuPointer(),
+				reinterpret_cast<const int16_t*>(raw.GetCpuPointer()) + start,
+				gain,
+				-offset,
+				len);
+			cap->MarkSamplesModifiedFromCpu();
+			return;
+		}
+
+		auto pipe = m_conversion16BitPipeline.get();
+		BeginBatch(pipe);
+		pipe->BindBufferNonblocking(0, cap->m_samples, *m_cmdBuf, true);
+		pipe->BindBufferNonblocking(1, raw, *m_cmdBuf);
+		Dispatch(pipe, cap, gain, offset, start);
+	}
+
+	void Submit();
+	void WaitIdle();
+	bool WaitIdleWithTimeout(uint64_t nanoseconds);
+
+	///@brief Returns true if 8-bit samples will be converted on the GPU
+	static bool IsGpuConversionAvailable8Bit()
+	{ return g_hasShaderInt8; }
+
+	///@brief Returns true if 16-bit samples will be converted on the GPU
+	static bool IsGpuConversionAvailable16Bit()
+	{ return g_hasShaderInt16; }
+
+protected:
+	void BeginBatch(ComputePipeline* pipe);
+	void Dispatch(ComputePipeline* pipe, UniformAnalogWaveform* cap, float gain, float offset, size_t start);
+	void FinishBatch();
+	AcceleratorBuffer<uint32_t>& GetClipBuffer(UniformAnalogWaveform* cap);
+	static void DetectClippingCPU(UniformAnalogWaveform* cap, const int8_t* raw, size_t len);
+
+	///@brief Name used for Vulkan object names
+	std::string m_name;
+
+	///@brief Vulkan queue used for sample conversion
+	std::shared_ptr<QueueHandle> m_queue;
+
+	///@brief Command pool from which m_cmdBuf was allocated
+	std::unique_ptr<vk::raii::CommandPool> m_pool;
+
+	///@brief Command buffer for sample conversion
+	std::unique_ptr<vk::raii::CommandBuffer> m_cmdBuf;
+
+	///@brief Converts signed 8-bit samples
+	std::unique_ptr<ComputePipeline> m_conversion8BitPipeline;
+
+	///@brief Converts signed 8-bit samples and flags codes at either rail
+	std::unique_ptr<ComputePipeline> m_conversion8BitClipPipeline;
+
+	///@brief Converts signed 16-bit samples
+	std::unique_ptr<ComputePipeline> m_conversion16BitPipeline;
+
+	///@brief True if m_cmdBuf is being recorded
+	bool m_recording;
+
+	///@brief True if a batch has been submitted and not yet waited for
+	bool m_inFlight;
+
+	///@brief Pipelines already dispatched in the batch being recorded
+	std::set<ComputePipeline*> m_pipelinesUsed;
+
+	///@brief Clip detection flags, one per clip-detecting conversion in the current batch
+	std::vector<std::unique_ptr<AcceleratorBuffer<uint32_t> > > m_clipBuffers;
+
+	///@brief Waveforms whose m_clipBuffers entry (same index) is pending
+	std::vector<UniformAnalogWaveform*> m_clipWaveforms;
+};
+
+#endif
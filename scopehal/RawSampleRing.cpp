@@ -0,0 +1,147 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of RawSampleRing
+	@ingroup core
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates a ring. No memory is allocated until the first call to Allocate().
+
+	@param name			Name of the driver, used for buffer names
+	@param converter	Converter which may still be reading from a slab after its waveforms are gone (may be null)
+	@param slabBytes	Minimum size of each slab
+ */
+RawSampleRing::RawSampleRing(const string& name, RawSampleConverter* converter, size_t slabBytes)
+	: m_name(name)
+	, m_converter(converter)
+	, m_slabBytes(slabBytes)
+	, m_current(0)
+	, m_writeOffset(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Allocation
+
+/**
+	@brief Gets the next free region of the ring
+
+	The region stays valid (and unmodified by the ring) until the slab containing it is released by every waveform
+	referring to it and the ring wraps around to it again.
+
+	@param bytes	Size of the region. Regions are 64-byte aligned, so 16-bit codes may be used with any offset.
+ */
+RawSampleRing::Region RawSampleRing::Allocate(size_t bytes)
+{
+	bytes = (bytes + 63) & ~static_cast<size_t>(63);
+
+	//Move on to another slab if the current one is full
+	if(m_slabs.empty() || (m_writeOffset + bytes > m_slabs[m_current]->size()) )
+	{
+		//Prefer a slab nobody is using any more
+		size_t next = m_slabs.size();
+		for(size_t i=0; i<m_slabs.size(); i++)
+		{
+			if( (i != m_current) && (m_slabs[i].use_count() == 1) && (m_slabs[i]->size() >= bytes) )
+			{
+				next = i;
+				break;
+			}
+		}
+
+		//Conversions queued from the slab we're reusing (or one about to be freed) may not have finished yet.
+		//This only happens once per slab's worth of data, so just wait for them
+		if(m_converter)
+			m_converter->WaitIdle();
+		if(next == m_slabs.size())
+			m_slabs.push_back(AllocateSlab(max(bytes, m_slabBytes)));
+
+		m_current = next;
+		m_writeOffset = 0;
+		FreeIdleSlabs();
+	}
+
+	auto& slab = m_slabs[m_current];
+	Region ret;
+	ret.m_slab = slab;
+	ret.m_byteOffset = m_writeOffset;
+	ret.m_ptr = reinterpret_cast<uint8_t*>(slab->GetCpuPointer()) + m_writeOffset;
+	m_writeOffset += bytes;
+	return ret;
+}
+
+/**
+	@brief Allocates a new slab in pinned memory
+ */
+shared_ptr<AcceleratorBuffer<int8_t> > RawSampleRing::AllocateSlab(size_t bytes)
+{
+	auto slab = make_shared<AcceleratorBuffer<int8_t> >(m_name + ".RawSampleRing.slab");
+
+	//Pinned memory and no GPU copy, so shaders read the codes straight from host memory exactly once
+	slab->SetCpuAccessHint(AcceleratorBuffer<int8_t>::HINT_LIKELY);
+	slab->SetGpuAccessHint(AcceleratorBuffer<int8_t>::HINT_UNLIKELY);
+	slab->resize(bytes);
+	slab->PrepareForCpuAccess();
+	slab->MarkModifiedFromCpu();
+	return slab;
+}
+
+/**
+	@brief Frees slabs which are no longer in use, keeping one spare so a steady stream doesn't reallocate
+ */
+void RawSampleRing::FreeIdleSlabs()
+{
+	bool keptSpare = false;
+	for(size_t i=0; i<m_slabs.size(); )
+	{
+		bool idle = (i != m_current) && (m_slabs[i].use_count() == 1);
+		if(idle && keptSpare)
+		{
+			m_slabs.erase(m_slabs.begin() + i);
+			if(m_current > i)
+				m_current --;
+			continue;
+		}
+
+		if(idle)
+			keptSpare = true;
+		i++;
+	}
+}
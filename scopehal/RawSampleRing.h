@@ -0,0 +1,111 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of RawSampleRing
+	@ingroup core
+ */
+
+#ifndef RawSampleRing_h
+#define RawSampleRing_h
+
+/**
+	@brief Circular pinned memory for drivers receiving a continuous stream of raw ADC codes
+	@ingroup core
+
+	Rather than each trigger's samples getting a buffer of their own (and the CPU path copying them into each
+	waveform), a streaming driver reads every channel's codes straight into the next free region from Allocate().
+	The resulting waveform is then either converted from the region in place (see the start parameter of
+	RawSampleConverter::Convert8Bit() / Convert16Bit()), or made a view of it with
+	UniformAnalogWaveform::SetRawSampleView(). Either way nothing is allocated or copied per trigger.
+
+	The ring is made of large slabs of pinned host memory which the GPU reads directly, with no staging copy. Regions
+	are handed out from the current slab back to back. When it fills up, the ring moves on to a slab which no
+	waveform refers to any more (a view holds a reference to its whole slab), waiting for pending conversions first,
+	or allocates another one if all of them are still in use. Idle slabs beyond one spare are freed.
+ */
+class RawSampleRing
+{
+public:
+	RawSampleRing(const std::string& name, RawSampleConverter* converter, size_t slabBytes = DEFAULT_SLAB_BYTES);
+
+	///@brief Default size of one slab
+	static const size_t DEFAULT_SLAB_BYTES = 256 * 1024 * 1024;
+
+	/**
+		@brief One region handed out by Allocate()
+
+		Call m_slab->MarkModifiedFromCpu() once the region has been written, in case the slab could not be pinned
+		and has a separate GPU copy.
+	 */
+	class Region
+	{
+	public:
+		///@brief The slab containing the region
+		std::shared_ptr<AcceleratorBuffer<int8_t> > m_slab;
+
+		///@brief Offset of the region within m_slab, in bytes
+		size_t m_byteOffset;
+
+		///@brief CPU pointer to the start of the region
+		uint8_t* m_ptr;
+	};
+
+	Region Allocate(size_t bytes);
+
+	///@brief Gets the number of slabs currently allocated
+	size_t GetSlabCount() const
+	{ return m_slabs.size(); }
+
+protected:
+	std::shared_ptr<AcceleratorBuffer<int8_t> > AllocateSlab(size_t bytes);
+	void FreeIdleSlabs();
+
+	///@brief Name used for buffer names
+	std::string m_name;
+
+	///@brief Converter reading from our slabs, which has to be idle before one is reused
+	RawSampleConverter* m_converter;
+
+	///@brief Minimum size of a slab
+	size_t m_slabBytes;
+
+	///@brief All slabs, in use or not
+	std::vector<std::shared_ptr<AcceleratorBuffer<int8_t> > > m_slabs;
+
+	///@brief Index of the slab regions are currently handed out from
+	size_t m_current;
+
+	///@brief Offset of the next free byte in the current slab
+	size_t m_writeOffset;
+};
+
+#endif
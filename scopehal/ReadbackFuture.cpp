@@ -0,0 +1,192 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of ReadbackFuture
+	@ingroup vksupport
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+extern shared_ptr<QueueHandle> g_vkDmaQueue;
+
+/**
+	@brief Command buffers for asynchronous readbacks, each of which is reused once the GPU is done with it
+ */
+class ReadbackCommandBuffers
+{
+public:
+	ReadbackCommandBuffers()
+	: m_next(0)
+	{
+		vk::CommandPoolCreateInfo info(
+			vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+			g_vkDmaQueue->m_family);
+		m_pool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, info);
+	}
+
+	~ReadbackCommandBuffers()
+	{
+		//Can't free anything the GPU is still using
+		for(auto& b : m_busyUntil)
+			QueueHandle::WaitForPoints(b);
+		m_buffers.clear();
+	}
+
+	/**
+		@brief Gets a command buffer which is not in use, allocating a new one if necessary
+
+		@return Index of the buffer
+	 */
+	size_t Acquire()
+	{
+		for(size_t i=0; i<m_buffers.size(); i++)
+		{
+			if(QueueHandle::ArePointsComplete(m_busyUntil[i]))
+				return i;
+		}
+
+		//If there are too many copies in flight, wait for the oldest rather than growing forever
+		if(m_buffers.size() >= MAX_BUFFERS)
+		{
+			size_t i = m_next;
+			m_next = (m_next + 1) % MAX_BUFFERS;
+			QueueHandle::WaitForPoints(m_busyUntil[i]);
+			return i;
+		}
+
+		vk::CommandBufferAllocateInfo info(**m_pool, vk::CommandBufferLevel::ePrimary, 1);
+		m_buffers.push_back(make_unique<vk::raii::CommandBuffer>(
+			std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, info).front())));
+		m_busyUntil.push_back({});
+		return m_buffers.size() - 1;
+	}
+
+	///@brief Maximum number of readbacks in flight before we wait for the oldest
+	static const size_t MAX_BUFFERS = 32;
+
+	///@brief The pool buffers are allocated from
+	unique_ptr<vk::raii::CommandPool> m_pool;
+
+	///@brief All allocated command buffers
+	vector<unique_ptr<vk::raii::CommandBuffer>> m_buffers;
+
+	///@brief Points which must be reached before each buffer can be reused
+	vector<vector<QueueTimelinePoint>> m_busyUntil;
+
+	///@brief Next buffer to evict if everything is busy
+	size_t m_next;
+};
+
+///@brief Mutex protecting g_readbackCommandBuffers
+static mutex g_readbackMutex;
+
+///@brief Command buffers for readbacks, created on first use
+static unique_ptr<ReadbackCommandBuffers> g_readbackCommandBuffers;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Merging
+
+/**
+	@brief Adds the points of another future to this one, so this one only becomes ready once both are
+
+	@param rhs	The other future
+ */
+void ReadbackFuture::Merge(const ReadbackFuture& rhs)
+{
+	//Only the newest point on each queue matters
+	for(auto& p : rhs.m_points)
+	{
+		bool found = false;
+		for(auto& q : m_points)
+		{
+			if(q.m_queue == p.m_queue)
+			{
+				q.m_value = max(q.m_value, p.m_value);
+				found = true;
+				break;
+			}
+		}
+		if(!found)
+			m_points.push_back(p);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Submission
+
+/**
+	@brief Records a copy on a command buffer of its own and submits it to the DMA queue without waiting
+
+	If a QueueSubmitScope is active, the copy waits on the GPU for everything the scope depends on, as with any other
+	submission in it. Otherwise the data being copied must already have been written.
+
+	@param record	Function recording the copy commands into the command buffer it is passed
+
+	@return Future which becomes ready once the copy has completed
+ */
+ReadbackFuture ReadbackFuture::Submit(function<void(vk::raii::CommandBuffer&)> record)
+{
+	lock_guard<mutex> lock(g_readbackMutex);
+	if(!g_readbackCommandBuffers)
+		g_readbackCommandBuffers = make_unique<ReadbackCommandBuffers>();
+
+	auto i = g_readbackCommandBuffers->Acquire();
+	auto& cmdBuf = *g_readbackCommandBuffers->m_buffers[i];
+	cmdBuf.begin({});
+	record(cmdBuf);
+	cmdBuf.end();
+
+	//Without a scope of the caller's to record the submission in, make one of our own.
+	//(If there are no timeline semaphores, this blocks and we get no points back, which is just what we want)
+	unique_ptr<QueueSubmitScope> localScope;
+	if(!QueueSubmitScope::GetCurrent())
+		localScope = make_unique<QueueSubmitScope>();
+	g_vkDmaQueue->SubmitDeferred(cmdBuf);
+
+	//Everything else in the scope was waited for by the copy, so it's all done once the copy is
+	ReadbackFuture ret(QueueSubmitScope::GetCurrent()->GetSignals());
+	g_readbackCommandBuffers->m_busyUntil[i] = ret.m_points;
+	return ret;
+}
+
+/**
+	@brief Frees the command buffers used for readbacks, once all of them have completed
+
+	Called by VulkanCleanup().
+ */
+void ReadbackFuture::DestroyCommandBuffers()
+{
+	lock_guard<mutex> lock(g_readbackMutex);
+	g_readbackCommandBuffers = nullptr;
+}
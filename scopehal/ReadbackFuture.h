@@ -0,0 +1,90 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of ReadbackFuture
+	@ingroup vksupport
+ */
+
+#ifndef ReadbackFuture_h
+#define ReadbackFuture_h
+
+#include <functional>
+#include "QueueManager.h"
+
+/**
+	@brief Completion handle for a GPU to CPU copy started by AcceleratorBuffer::PrepareForCpuAccessAsync()
+
+	The copy is recorded on a command buffer of its own and submitted to the DMA queue without waiting, so the caller
+	can get on with other work (or, in the FilterGraphExecutor, other nodes) while it is in flight. A default
+	constructed future, or one returned when there was nothing to copy, is always ready.
+
+	Futures are just a list of timeline points, so they are cheap to copy and several of them can be merged to wait
+	for a whole waveform (or every input of a filter) at once. Without timeline semaphore support every readback
+	blocks as before, and the returned future is ready immediately.
+ */
+class ReadbackFuture
+{
+public:
+	ReadbackFuture()
+	{}
+
+	explicit ReadbackFuture(const std::vector<QueueTimelinePoint>& points)
+	: m_points(points)
+	{}
+
+	///@brief Returns true if the copy (if any) has completed
+	bool IsReady() const
+	{ return QueueHandle::ArePointsComplete(m_points); }
+
+	///@brief Blocks until the copy (if any) has completed
+	void Wait() const
+	{ QueueHandle::WaitForPoints(m_points); }
+
+	///@brief Returns true if there is a copy outstanding, which may or may not have completed yet
+	bool IsPending() const
+	{ return !m_points.empty(); }
+
+	///@brief Gets the points which are reached once the copy has completed
+	const std::vector<QueueTimelinePoint>& GetPoints() const
+	{ return m_points; }
+
+	void Merge(const ReadbackFuture& rhs);
+
+	static ReadbackFuture Submit(std::function<void(vk::raii::CommandBuffer&)> record);
+	static void DestroyCommandBuffers();
+
+protected:
+	///@brief Points which are reached once the copy has completed
+	std::vector<QueueTimelinePoint> m_points;
+};
+
+#endif
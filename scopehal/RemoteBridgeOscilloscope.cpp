@@ -182,6 +182,22 @@ bool RemoteBridgeOscilloscope::IsTriggerArmed()
 	return m_triggerArmed;
 }
 
+/**
+	@brief Sleeps until the bridge pushes waveform data, rather than polling for it
+
+	Falls back to the adaptive poll interval if the trigger isn't armed (nothing will arrive) or the bridge doesn't
+	have a separate data channel.
+ */
+bool RemoteBridgeOscilloscope::WaitForTriggerEvent(chrono::microseconds timeout)
+{
+	auto transport = dynamic_cast<SCPITwinLanTransport*>(m_transport);
+	if(!transport || !IsTriggerArmed())
+		return Oscilloscope::WaitForTriggerEvent(timeout);
+
+	auto ms = chrono::duration_cast<chrono::milliseconds>(timeout).count();
+	return transport->WaitForDataAvailable(max<int64_t>(ms, 1));
+}
+
 //
 
 bool RemoteBridgeOscilloscope::IsChannelEnabled(size_t i)
@@ -65,6 +65,7 @@ public:
 	virtual void PullTrigger() override;
 	virtual bool IsTriggerArmed() override;
 	virtual bool PeekTriggerArmed() override;
+	virtual bool WaitForTriggerEvent(std::chrono::microseconds timeout) override;
 
 	// Timebase
 	virtual void SetTriggerOffset(int64_t offset) override;
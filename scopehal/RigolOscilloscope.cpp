@@ -851,7 +851,7 @@ bool RigolOscilloscope::AcquireData()
 			continue;
 
 		//Set up the capture we're going to store our data into
-		auto cap = AllocateAnalogWaveform(m_nickname + "." + GetChannel(i)->GetHwname());
+		auto cap = AllocateAnalogWaveform(m_nickname + "." + GetChannel(i)->GetHwname(), npoints);
 		cap->Resize(0);
 		cap->m_timescale = fs_per_sample;
 		cap->m_triggerPhase = 0;
@@ -888,29 +888,19 @@ bool RigolOscilloscope::AcquireData()
 			}
 			m_transport->FlushCommandQueue();
 
-			//Read block header, should be maximally 11 long on MSO5 scope with >= 100 MPoints
-			unsigned char header[12] = {0};
-
-			unsigned char header_size;
-			m_transport->ReadRawData(2, header);
-			//LogWarning("Time %f\n", (GetTime() - start));
-
-			sscanf((char*)header, "#%c", &header_size);
-			header_size = header_size - '0';
-
-			if(header_size > 12)
-			{
-				header_size = 12;
-			}
-
-			m_transport->ReadRawData(header_size, header);
-
-			//Look up the block size
-			//size_t blocksize = end - npoints;
-			//LogDebug("Block size = %zu\n", blocksize);
+			//Read block header
 			size_t header_blocksize;
 			size_t header_blocksize_bytes;
-			sscanf((char*)header, "%zu", &header_blocksize);
+			if(!m_transport->ReadBinaryBlockHeader(header_blocksize, 0))
+			{
+				LogError("Malformed waveform block header after %zu points\n", npoint);
+				if(npoint == 0)
+				{
+					AddWaveformToAnalogPool(cap);
+					cap = nullptr;
+				}
+				break;
+			}
 			//LogDebug("Header block size = %zu\n", header_blocksize);
 
 			if(header_blocksize == 0)
@@ -939,14 +929,15 @@ bool RigolOscilloscope::AcquireData()
 			//Read actual block content and decode it
 			//Scale: (value - Yorigin - Yref) * Yinc
 
-			size_t bytesToRead = header_blocksize_bytes + 1; //trailing newline after data block
+			size_t bytesToRead = header_blocksize_bytes;
 			auto downloadCallback = [i, this, npoint, npoints, bytesToRead] (float progress) {
 				/* we get the percentage of this particular download; convert this into linear percentage across all chunks */
 				float bytes_progress = npoint * (m_highDefinition ? 2 : 1) + progress * bytesToRead;
 				float bytes_total = npoints * (m_highDefinition ? 2 : 1);
 				ChannelsDownloadStatusUpdate(i, InstrumentChannel::DownloadState::DOWNLOAD_IN_PROGRESS, bytes_progress / bytes_total);
 			};
-			m_transport->ReadRawData(bytesToRead, temp_buf, downloadCallback);
+			m_transport->ReadBinaryBlockData(bytesToRead, temp_buf, downloadCallback);
+			m_transport->EndBinaryBlock();	//discard the trailing newline
 
 			double ydelta = yorigin + yreference;
 			cap->Resize(cap->m_samples.size() + header_blocksize);
@@ -984,7 +975,6 @@ bool RigolOscilloscope::AcquireData()
 	}
 
 	//Now that we have all of the pending waveforms, save them in sets across all channels
-	m_pendingWaveformsMutex.lock();
 	size_t num_pending = 1;	   //TODO: segmented capture support
 	for(size_t i = 0; i < num_pending; i++)
 	{
@@ -994,9 +984,8 @@ bool RigolOscilloscope::AcquireData()
 			if(pending_waveforms.count(j) > 0)
 				s[GetOscilloscopeChannel(j)] = pending_waveforms[j][i];
 		}
-		m_pendingWaveforms.push_back(s);
+		PushPendingWaveform(s);
 	}
-	m_pendingWaveformsMutex.unlock();
 
 	//Clean up
 	delete[] temp_buf;
@@ -93,6 +93,39 @@ bool RohdeSchwarzHMC804xPowerSupply::SupportsOvercurrentShutdown()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual hardware interfacing
 
+/**
+	@brief Reads all four sensors on every channel
+
+	If the transport can pipeline commands, all four queries for a channel go out in one burst behind the channel
+	select rather than as four separate round trips, which matters when a scheduler is polling many supplies over slow
+	serial links.
+ */
+bool RohdeSchwarzHMC804xPowerSupply::AcquireData()
+{
+	if(!m_transport->IsCommandBatchingSupported())
+		return PowerSupply::AcquireData();
+
+	static const vector<string> queries = { "meas:volt?", "volt?", "meas:curr?", "curr?" };
+
+	lock_guard<recursive_mutex> lock(m_transport->GetMutex());
+	for(size_t i=0; i<m_channels.size(); i++)
+	{
+		auto pchan = dynamic_cast<PowerSupplyChannel*>(m_channels[i]);
+		if(!pchan)
+			continue;
+
+		SelectChannel(i);
+		auto replies = m_transport->SendQueriesPipelined(queries);
+
+		pchan->SetScalarValue(PowerSupplyChannel::STREAM_VOLTAGE_MEASURED, atof(replies[0].c_str()));
+		pchan->SetScalarValue(PowerSupplyChannel::STREAM_VOLTAGE_SET_POINT, atof(replies[1].c_str()));
+		pchan->SetScalarValue(PowerSupplyChannel::STREAM_CURRENT_MEASURED, atof(replies[2].c_str()));
+		pchan->SetScalarValue(PowerSupplyChannel::STREAM_CURRENT_SET_POINT, atof(replies[3].c_str()));
+	}
+
+	return true;
+}
+
 bool RohdeSchwarzHMC804xPowerSupply::IsPowerConstantCurrent(int chan)
 {
 	int reg = GetStatusRegister(chan);
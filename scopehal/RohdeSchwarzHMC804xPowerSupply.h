@@ -56,6 +56,7 @@ public:
 	double GetPowerCurrentActual(int chan) override;	//actual current drawn by the load
 	double GetPowerCurrentNominal(int chan) override;	//current limit
 	bool GetPowerChannelActive(int chan) override;
+	virtual bool AcquireData() override;
 
 	//Configuration
 	bool GetPowerOvercurrentShutdownEnabled(int chan) override;	//shut channel off entirely on overload,
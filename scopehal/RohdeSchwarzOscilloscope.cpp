@@ -127,10 +127,9 @@ RohdeSchwarzOscilloscope::RohdeSchwarzOscilloscope(SCPITransport* transport)
 	m_channels.push_back(m_extTrigChannel);
 	m_extTrigChannel->SetDefaultDisplayName();
 
-	//Configure transport format to raw IEEE754 float, little endian
-	//TODO: if instrument internal is big endian, skipping the bswap might improve download performance?
-	//Might be faster to do it on a beefy x86 than the embedded side of things.
-	m_transport->SendCommand("FORM:DATA REAL");
+	//Configure transport format to raw 16-bit ADC codes, little endian.
+	//This is half the size of REAL on the wire, we scale to volts ourselves in AcquireData()
+	m_transport->SendCommand("FORM:DATA INT,16");
 	m_transport->SendCommand("FORM:BORD LSBFirst");
 
 	//See what options we have
@@ -538,7 +537,18 @@ bool RohdeSchwarzOscilloscope::AcquireData()
 		int64_t fs_per_sample = round(sec_per_sample * FS_PER_SECOND);
 		//LogDebug("%ld fs/sample\n", fs_per_sample);
 
-		float* temp_buf = new float[length];
+		//Get the scaling for the raw codes. Codes are signed, zero is the center of the screen,
+		//and 253*256 codes span the full vertical range (10 divisions)
+		m_transport->SendCommand(m_channels[i]->GetHwname() + ":RANG?");
+		float range = stof(m_transport->ReadReply());
+		m_transport->SendCommand(m_channels[i]->GetHwname() + ":OFFS?");
+		float offs = stof(m_transport->ReadReply());
+		m_transport->SendCommand(m_channels[i]->GetHwname() + ":POS?");
+		float pos = stof(m_transport->ReadReply());
+		float gain = range / (253 * 256);
+		float offset = offs - pos * range / 10;
+
+		int16_t* temp_buf = new int16_t[length];
 
 		//Set up the capture we're going to store our data into (no high res timer on R&S scopes)
 		auto cap = new UniformAnalogWaveform;
@@ -558,11 +568,11 @@ bool RohdeSchwarzOscilloscope::AcquireData()
 		m_transport->ReadRawData(num_digits, (unsigned char*)tmp);
 		//int actual_len = atoi(tmp);
 
-		//Read the actual data.
-		//Super easy, it comes across the wire in IEEE754 already!
+		//Read the actual data and convert to volts
 		cap->Resize(length);
 		cap->PrepareForCpuAccess();
-		m_transport->ReadRawData(length*sizeof(float), (unsigned char*)cap->m_samples.GetCpuPointer());
+		m_transport->ReadRawData(length*sizeof(int16_t), (unsigned char*)temp_buf);
+		Convert16BitSamples(cap->m_samples.GetCpuPointer(), temp_buf, gain, -offset, length);
 		cap->MarkSamplesModifiedFromCpu();
 
 		//Discard trailing newline
@@ -587,7 +597,6 @@ bool RohdeSchwarzOscilloscope::AcquireData()
 		return false;
 	}
 	//Now that we have all of the pending waveforms, save them in sets across all channels
-	m_pendingWaveformsMutex.lock();
 	size_t num_pending = 1;	//TODO: segmented capture support
 	for(size_t i=0; i<num_pending; i++)
 	{
@@ -597,9 +606,8 @@ bool RohdeSchwarzOscilloscope::AcquireData()
 			if(IsChannelEnabled(j))
 				s[GetOscilloscopeChannel(j)] = pending_waveforms[j][i];
 		}
-		m_pendingWaveforms.push_back(s);
+		PushPendingWaveform(s);
 	}
-	m_pendingWaveformsMutex.unlock();
 
 	//TODO: support digital channels
 
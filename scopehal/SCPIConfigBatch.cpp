@@ -0,0 +1,226 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of SCPIConfigBatch
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "SCPIConfigBatch.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+SCPIConfigBatch::SCPIConfigBatch(SCPITransport* transport)
+	: m_transport(transport)
+	, m_depth(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Transactions
+
+/**
+	@brief Starts recording writes rather than sending them
+
+	Transactions nest: only the outermost Commit() actually sends anything.
+ */
+void SCPIConfigBatch::Begin()
+{
+	lock_guard<recursive_mutex> lock(m_mutex);
+	m_depth ++;
+}
+
+/**
+	@brief Sends every write recorded since Begin() which actually changes something, as a single batch
+
+	@return Number of commands sent
+ */
+size_t SCPIConfigBatch::Commit()
+{
+	lock_guard<recursive_mutex> lock(m_mutex);
+
+	if(m_depth == 0)
+		return 0;
+	m_depth --;
+	if(m_depth > 0)
+		return 0;
+
+	size_t nsent = 0;
+	for(auto& header : m_pendingOrder)
+	{
+		if(Apply(header, m_pending[header]))
+			nsent ++;
+	}
+	m_pending.clear();
+	m_pendingOrder.clear();
+
+	if(nsent)
+	{
+		LogTrace("SCPIConfigBatch: committing %zu commands\n", nsent);
+		m_transport->FlushCommandQueue();
+	}
+	return nsent;
+}
+
+/**
+	@brief Discards every write recorded since the outermost Begin()
+ */
+void SCPIConfigBatch::Abort()
+{
+	lock_guard<recursive_mutex> lock(m_mutex);
+
+	m_depth = 0;
+	m_pending.clear();
+	m_pendingOrder.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Writes
+
+/**
+	@brief Changes a setting
+
+	Outside a transaction the command is queued immediately, unless it's the same as the last one sent.
+
+	@param cmd	Complete command including arguments, e.g. "OUT3:MUX 5"
+ */
+void SCPIConfigBatch::Set(const string& cmd)
+{
+	lock_guard<recursive_mutex> lock(m_mutex);
+
+	auto header = GetHeader(cmd);
+	if(m_depth == 0)
+	{
+		Apply(header, cmd);
+		return;
+	}
+
+	if(m_pending.find(header) == m_pending.end())
+		m_pendingOrder.push_back(header);
+	m_pending[header] = cmd;
+}
+
+/**
+	@brief Queues a command if it differs from the last one sent with the same header
+
+	@return True if the command was queued
+ */
+bool SCPIConfigBatch::Apply(const string& header, const string& cmd)
+{
+	auto it = m_sent.find(header);
+	if( (it != m_sent.end()) && (it->second == cmd) )
+		return false;
+
+	m_sent[header] = cmd;
+	m_prefetched.erase(header + "?");
+	m_transport->SendCommandQueued(cmd);
+	return true;
+}
+
+/**
+	@brief Gets the header of a command, i.e. everything before the arguments
+ */
+string SCPIConfigBatch::GetHeader(const string& cmd)
+{
+	auto ispace = cmd.find(' ');
+	if(ispace == string::npos)
+		return cmd;
+	return cmd.substr(0, ispace);
+}
+
+/**
+	@brief Forgets what has been sent, so the next write of every setting goes to the instrument
+ */
+void SCPIConfigBatch::InvalidateCache()
+{
+	lock_guard<recursive_mutex> lock(m_mutex);
+
+	m_sent.clear();
+	m_prefetched.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reads
+
+/**
+	@brief Sends a list of queries in one pipelined batch and saves the replies for Query()
+
+	Any pending writes are sent first, so the replies reflect them.
+
+	@param queries			Queries to send
+	@param endOnSemicolon	Passed through to the transport, for instruments whose replies may contain semicolons
+ */
+void SCPIConfigBatch::Prefetch(const vector<string>& queries, bool endOnSemicolon)
+{
+	lock_guard<recursive_mutex> lock(m_mutex);
+
+	m_transport->SendQueriesPipelined(
+		queries,
+		[this, &queries] (size_t i, const string& reply) { m_prefetched[queries[i]] = reply; },
+		endOnSemicolon);
+}
+
+/**
+	@brief Throws away the prefetched reply for the setting a command changes, if there is one
+
+	@param cmd	Complete command including arguments, e.g. "OUT3:MUX 5"
+ */
+void SCPIConfigBatch::DiscardPrefetched(const string& cmd)
+{
+	lock_guard<recursive_mutex> lock(m_mutex);
+	m_prefetched.erase(GetHeader(cmd) + "?");
+}
+
+/**
+	@brief Gets the reply to a query, from the prefetched replies if possible
+
+	Each prefetched reply is only used once, so a second Query() for the same string goes to the instrument.
+ */
+string SCPIConfigBatch::Query(const string& query, bool endOnSemicolon)
+{
+	{
+		lock_guard<recursive_mutex> lock(m_mutex);
+
+		auto it = m_prefetched.find(query);
+		if(it != m_prefetched.end())
+		{
+			auto reply = it->second;
+			m_prefetched.erase(it);
+			return reply;
+		}
+	}
+
+	return m_transport->SendCommandQueuedWithReply(query, endOnSemicolon);
+}
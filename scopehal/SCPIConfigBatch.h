@@ -0,0 +1,102 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of SCPIConfigBatch
+	@ingroup core
+ */
+
+#ifndef SCPIConfigBatch_h
+#define SCPIConfigBatch_h
+
+/**
+	@brief Coalesces configuration writes and pipelines configuration reads for an SCPI instrument
+
+	Writes go through Set(), keyed by the command header (everything before the first space, e.g. "OUT3:MUX"). A write
+	whose value matches the last one sent for that header is dropped. Between Begin() and Commit() writes are only
+	recorded, so a setting changed several times in one transaction costs one command. Commit() queues the surviving
+	changes in the order their headers were first touched, then flushes them all at once.
+
+	Reads for warmup (initial connection, or after FlushConfigCache()) can be Prefetch()ed as one pipelined batch.
+	Later Query() calls for the same strings are then answered from the prefetched replies with no round trip. A write
+	to a setting discards its prefetched reply; drivers which send some writes directly should DiscardPrefetched() them.
+
+	The write cache assumes nothing else changes the instrument's configuration. Call InvalidateCache() if something
+	might have, e.g. from FlushConfigCache() on instruments with a front panel.
+ */
+class SCPIConfigBatch
+{
+public:
+	SCPIConfigBatch(SCPITransport* transport);
+
+	void Begin();
+	size_t Commit();
+	void Abort();
+
+	///@brief Returns true if a transaction is open
+	bool IsInTransaction()
+	{ return m_depth > 0; }
+
+	void Set(const std::string& cmd);
+
+	void Prefetch(const std::vector<std::string>& queries, bool endOnSemicolon = true);
+	std::string Query(const std::string& query, bool endOnSemicolon = true);
+	void DiscardPrefetched(const std::string& cmd);
+
+	void InvalidateCache();
+
+protected:
+	static std::string GetHeader(const std::string& cmd);
+	bool Apply(const std::string& header, const std::string& cmd);
+
+	///@brief The transport we're talking to
+	SCPITransport* m_transport;
+
+	///@brief Mutex protecting all of our state
+	std::recursive_mutex m_mutex;
+
+	///@brief Nesting depth of Begin() calls not yet committed
+	int m_depth;
+
+	///@brief Last command sent for each header
+	std::map<std::string, std::string> m_sent;
+
+	///@brief Latest command recorded for each header in the open transaction
+	std::map<std::string, std::string> m_pending;
+
+	///@brief Headers in m_pending, in the order they were first touched
+	std::vector<std::string> m_pendingOrder;
+
+	///@brief Replies to prefetched queries which haven't been consumed yet
+	std::map<std::string, std::string> m_prefetched;
+};
+
+#endif
@@ -0,0 +1,703 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of SCPIHiSLIPTransport
+	@ingroup transports
+ */
+
+#include "scopehal.h"
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+using namespace std;
+
+///@brief Protocol version we speak (1.0)
+static const uint16_t HISLIP_PROTOCOL_VERSION = 0x0100;
+
+///@brief Vendor ID we report to the instrument
+static const uint16_t HISLIP_VENDOR_ID = ('S' << 8) | 'H';
+
+///@brief First message ID of a session (and after a device clear)
+static const uint32_t HISLIP_INITIAL_MESSAGE_ID = 0xffffff00;
+
+///@brief Largest message we accept. Payloads are streamed to the caller so there is no need to be conservative
+static const uint64_t HISLIP_MAX_RX_MESSAGE_SIZE = 1024LL * 1024LL * 1024LL;
+
+///@brief Largest chunk of reply text ReadReply() pulls off the socket at once
+static const size_t HISLIP_RX_CHUNK = 65536;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Connects to an instrument
+
+	@param args	Arguments, of the format host[:port[:subaddress]]
+				If port number is not specified, defaults to 4880, and sub-address to hislip0
+ */
+SCPIHiSLIPTransport::SCPIHiSLIPTransport(const string& args)
+	: m_syncSocket(AF_INET, SOCK_STREAM, IPPROTO_TCP)
+	, m_asyncSocket(AF_INET, SOCK_STREAM, IPPROTO_TCP)
+	, m_port(DEFAULT_PORT)
+	, m_subaddress("hislip0")
+	, m_connected(false)
+	, m_overlapped(false)
+	, m_sessionID(0)
+	, m_maxMessageSize(272)
+	, m_messageID(HISLIP_INITIAL_MESSAGE_ID)
+	, m_rmtDelivered(false)
+	, m_payloadLeft(0)
+	, m_messageEnd(false)
+	, m_rxPos(0)
+	, m_pendingServiceRequests(0)
+	, m_lastServiceRequestStatus(0)
+{
+	char hostname[128];
+	char subaddress[64];
+	unsigned int port = 0;
+	int nargs = sscanf(args.c_str(), "%127[^:]:%u:%63s", hostname, &port, subaddress);
+	if(nargs < 2)
+		m_hostname = args;
+	else
+	{
+		m_hostname = hostname;
+		m_port = port;
+		if(nargs == 3)
+			m_subaddress = subaddress;
+	}
+
+	m_connected = Connect();
+	if(!m_connected)
+	{
+		m_syncSocket.Close();
+		m_asyncSocket.Close();
+	}
+}
+
+SCPIHiSLIPTransport::~SCPIHiSLIPTransport()
+{
+}
+
+/**
+	@brief Opens both channels and negotiates the session
+
+	@return True on success
+ */
+bool SCPIHiSLIPTransport::Connect()
+{
+	LogDebug("Connecting to HiSLIP device at %s:%d (%s)\n", m_hostname.c_str(), m_port, m_subaddress.c_str());
+
+	//Synchronous channel
+	if(!m_syncSocket.Connect(m_hostname, m_port))
+	{
+		LogError("Couldn't connect to socket\n");
+		return false;
+	}
+	if(!m_syncSocket.DisableNagle())
+	{
+		LogError("Couldn't disable Nagle\n");
+		return false;
+	}
+	if(!m_syncSocket.SetRxBuffer(SCPISocketTransport::RX_BUFFER_SIZE))
+		LogWarning("Could not set 32 MB RX buffer. Consider increasing /proc/sys/net/core/rmem_max\n");
+
+	if(!SendMessage(
+		m_syncSocket,
+		MSG_INITIALIZE,
+		0,
+		(HISLIP_PROTOCOL_VERSION << 16) | HISLIP_VENDOR_ID,
+		reinterpret_cast<const unsigned char*>(m_subaddress.c_str()),
+		m_subaddress.length()))
+	{
+		return false;
+	}
+
+	MessageHeader hdr;
+	vector<uint8_t> payload;
+	if(!ReadHeader(m_syncSocket, hdr) || !ReadPayload(m_syncSocket, hdr, payload))
+		return false;
+	if(hdr.m_type != MSG_INITIALIZE_RESPONSE)
+	{
+		LogError("HiSLIP: expected InitializeResponse, got message type %d\n", hdr.m_type);
+		return false;
+	}
+	m_overlapped = (hdr.m_control & 1) != 0;
+	m_sessionID = hdr.m_param & 0xffff;
+	LogDebug("HiSLIP server version %d.%d, session %d, %s mode\n",
+		hdr.m_param >> 24,
+		(hdr.m_param >> 16) & 0xff,
+		m_sessionID,
+		m_overlapped ? "overlapped" : "synchronized");
+
+	//Asynchronous channel
+	if(!m_asyncSocket.Connect(m_hostname, m_port))
+	{
+		LogError("Couldn't connect to HiSLIP async channel\n");
+		return false;
+	}
+	if(!m_asyncSocket.DisableNagle())
+	{
+		LogError("Couldn't disable Nagle\n");
+		return false;
+	}
+	if(!SendMessage(m_asyncSocket, MSG_ASYNC_INITIALIZE, 0, m_sessionID))
+		return false;
+	if(!ReadAsyncReply(MSG_ASYNC_INITIALIZE_RESPONSE, hdr, payload))
+		return false;
+
+	//Negotiate message sizes. Until we do, the instrument only has to accept 272 byte messages
+	unsigned char size[8];
+	for(int i=0; i<8; i++)
+		size[i] = (HISLIP_MAX_RX_MESSAGE_SIZE >> (56 - 8*i)) & 0xff;
+	if(!SendMessage(m_asyncSocket, MSG_ASYNC_MAXIMUM_MESSAGE_SIZE, 0, 0, size, sizeof(size)))
+		return false;
+	if(!ReadAsyncReply(MSG_ASYNC_MAXIMUM_MESSAGE_SIZE_RESPONSE, hdr, payload))
+		return false;
+	if(payload.size() == 8)
+	{
+		m_maxMessageSize = 0;
+		for(int i=0; i<8; i++)
+			m_maxMessageSize = (m_maxMessageSize << 8) | payload[i];
+	}
+	LogDebug("HiSLIP max message size %" PRIu64 " bytes\n", m_maxMessageSize);
+
+	//A synchronized mode server discards the reply to a query if another message arrives before it's read
+	if(!m_overlapped)
+		SetMaxQueriesInFlight(1);
+
+	return true;
+}
+
+bool SCPIHiSLIPTransport::IsConnected()
+{
+	return m_connected && m_syncSocket.IsValid() && m_asyncSocket.IsValid();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Message framing
+
+/**
+	@brief Sends one HiSLIP message
+
+	@param sock		Channel to send on
+	@param type		Message type
+	@param control	Control code
+	@param param	Message parameter
+	@param payload	Payload data, if any
+	@param len		Payload length
+
+	@return True on success
+ */
+bool SCPIHiSLIPTransport::SendMessage(
+	Socket& sock,
+	uint8_t type,
+	uint8_t control,
+	uint32_t param,
+	const unsigned char* payload,
+	size_t len)
+{
+	unsigned char header[16];
+	header[0] = 'H';
+	header[1] = 'S';
+	header[2] = type;
+	header[3] = control;
+	for(int i=0; i<4; i++)
+		header[4+i] = (param >> (24 - 8*i)) & 0xff;
+	uint64_t len64 = len;
+	for(int i=0; i<8; i++)
+		header[8+i] = (len64 >> (56 - 8*i)) & 0xff;
+
+	//Small messages go out in one segment
+	if(len <= HISLIP_RX_CHUNK)
+	{
+		vector<unsigned char> msg(header, header + sizeof(header));
+		if(len)
+			msg.insert(msg.end(), payload, payload + len);
+		return sock.SendLooped(msg.data(), msg.size());
+	}
+
+	if(!sock.SendLooped(header, sizeof(header)))
+		return false;
+	return sock.SendLooped(payload, len);
+}
+
+/**
+	@brief Reads the header of the next message on a channel
+
+	@return True on success, false on a socket error or bad prologue
+ */
+bool SCPIHiSLIPTransport::ReadHeader(Socket& sock, MessageHeader& hdr)
+{
+	unsigned char header[16];
+	if(sizeof(header) != SCPISocketTransport::ReadLooped(sock, sizeof(header), header, nullptr))
+		return false;
+
+	if( (header[0] != 'H') || (header[1] != 'S') )
+	{
+		LogError("HiSLIP: bad message prologue\n");
+		return false;
+	}
+
+	hdr.m_type = header[2];
+	hdr.m_control = header[3];
+	hdr.m_param = (header[4] << 24) | (header[5] << 16) | (header[6] << 8) | header[7];
+	hdr.m_len = 0;
+	for(int i=0; i<8; i++)
+		hdr.m_len = (hdr.m_len << 8) | header[8+i];
+	return true;
+}
+
+/**
+	@brief Reads the payload of a message whose header was just read
+ */
+bool SCPIHiSLIPTransport::ReadPayload(Socket& sock, const MessageHeader& hdr, vector<uint8_t>& payload)
+{
+	payload.resize(hdr.m_len);
+	if(hdr.m_len == 0)
+		return true;
+	return hdr.m_len == SCPISocketTransport::ReadLooped(sock, hdr.m_len, payload.data(), nullptr);
+}
+
+/**
+	@brief Checks whether a channel has data waiting, blocking for up to timeoutMs
+ */
+bool SCPIHiSLIPTransport::PollReadable(Socket& sock, int timeoutMs)
+{
+	ZSOCKET fd = sock;
+#ifdef _WIN32
+	WSAPOLLFD pfd;
+	pfd.fd = fd;
+	pfd.events = POLLRDNORM;
+	pfd.revents = 0;
+	return WSAPoll(&pfd, 1, timeoutMs) > 0;
+#else
+	pollfd pfd;
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	return poll(&pfd, 1, timeoutMs) > 0;
+#endif
+}
+
+/**
+	@brief Reads messages on the async channel until one of the requested type arrives
+
+	Service requests which arrive first are counted so WaitForServiceRequest() still sees them.
+	Must be called with m_asyncMutex held (or before the transport is shared).
+ */
+bool SCPIHiSLIPTransport::ReadAsyncReply(uint8_t type, MessageHeader& hdr, vector<uint8_t>& payload)
+{
+	while(true)
+	{
+		if(!ReadHeader(m_asyncSocket, hdr) || !ReadPayload(m_asyncSocket, hdr, payload))
+			return false;
+
+		if(hdr.m_type == type)
+			return true;
+
+		if(hdr.m_type == MSG_ASYNC_SERVICE_REQUEST)
+		{
+			m_pendingServiceRequests ++;
+			m_lastServiceRequestStatus = hdr.m_control;
+		}
+		else if( (hdr.m_type == MSG_ERROR) || (hdr.m_type == MSG_FATAL_ERROR) )
+		{
+			LogError("HiSLIP: async channel error %d: %s\n",
+				hdr.m_control, string(payload.begin(), payload.end()).c_str());
+			if(hdr.m_type == MSG_FATAL_ERROR)
+				return false;
+		}
+	}
+}
+
+/**
+	@brief Sends a complete message on the synchronous channel, split into Data messages if it's too big for the
+	instrument to take at once
+ */
+bool SCPIHiSLIPTransport::SendData(const unsigned char* buf, size_t len)
+{
+	size_t maxPayload = 256;
+	if(m_maxMessageSize > 16)
+		maxPayload = min<uint64_t>(m_maxMessageSize - 16, SIZE_MAX);
+
+	size_t pos = 0;
+	do
+	{
+		size_t chunk = min(len - pos, maxPayload);
+		bool last = (pos + chunk == len);
+		if(!SendMessage(
+			m_syncSocket,
+			last ? MSG_DATA_END : MSG_DATA,
+			m_rmtDelivered ? 1 : 0,
+			m_messageID,
+			buf + pos,
+			chunk))
+		{
+			return false;
+		}
+
+		m_rmtDelivered = false;
+		m_messageID += 2;
+		pos += chunk;
+	} while(pos < len);
+
+	return true;
+}
+
+/**
+	@brief Reads message headers on the synchronous channel until the next Data or DataEnd message
+
+	@return True if a data message was found, false on a socket or fatal protocol error
+ */
+bool SCPIHiSLIPTransport::ReadDataHeader()
+{
+	vector<uint8_t> payload;
+	while(true)
+	{
+		MessageHeader hdr;
+		if(!ReadHeader(m_syncSocket, hdr))
+			return false;
+
+		if( (hdr.m_type == MSG_DATA) || (hdr.m_type == MSG_DATA_END) )
+		{
+			m_payloadLeft = hdr.m_len;
+			m_messageEnd = (hdr.m_type == MSG_DATA_END);
+			if( (m_payloadLeft == 0) && m_messageEnd)
+				m_rmtDelivered = true;
+			return true;
+		}
+
+		if(!ReadPayload(m_syncSocket, hdr, payload))
+			return false;
+
+		switch(hdr.m_type)
+		{
+			case MSG_INTERRUPTED:
+				LogWarning("HiSLIP: instrument discarded an unread reply\n");
+				break;
+
+			case MSG_ERROR:
+				LogError("HiSLIP: error %d: %s\n", hdr.m_control, string(payload.begin(), payload.end()).c_str());
+				break;
+
+			case MSG_FATAL_ERROR:
+				LogError("HiSLIP: fatal error %d: %s\n", hdr.m_control, string(payload.begin(), payload.end()).c_str());
+				m_connected = false;
+				return false;
+
+			default:
+				LogTrace("HiSLIP: ignoring message type %d on sync channel\n", hdr.m_type);
+				break;
+		}
+	}
+}
+
+/**
+	@brief Pulls the next chunk of reply payload into m_rxBuffer, starting a new message if needed
+ */
+bool SCPIHiSLIPTransport::FillRxBuffer()
+{
+	if(m_payloadLeft == 0)
+	{
+		if(!ReadDataHeader())
+			return false;
+	}
+
+	size_t chunk = min<uint64_t>(m_payloadLeft, HISLIP_RX_CHUNK);
+	m_rxBuffer.resize(chunk);
+	m_rxPos = 0;
+	if(chunk)
+	{
+		if(chunk != SCPISocketTransport::ReadLooped(m_syncSocket, chunk, m_rxBuffer.data(), nullptr))
+		{
+			m_rxBuffer.clear();
+			return false;
+		}
+		m_payloadLeft -= chunk;
+		if( (m_payloadLeft == 0) && m_messageEnd)
+			m_rmtDelivered = true;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Actual transport code
+
+///@brief Returns the constant transport name "hislip"
+string SCPIHiSLIPTransport::GetTransportName()
+{
+	return "hislip";
+}
+
+string SCPIHiSLIPTransport::GetConnectionString()
+{
+	char tmp[256];
+	if(m_subaddress == "hislip0")
+		snprintf(tmp, sizeof(tmp), "%s:%u", m_hostname.c_str(), m_port);
+	else
+		snprintf(tmp, sizeof(tmp), "%s:%u:%s", m_hostname.c_str(), m_port, m_subaddress.c_str());
+	return string(tmp);
+}
+
+bool SCPIHiSLIPTransport::SendCommand(const string& cmd)
+{
+	LogTrace("[%s] Sending %s\n", m_hostname.c_str(), cmd.c_str());
+	string tempbuf = cmd + "\n";
+	return SendData(reinterpret_cast<const unsigned char*>(tempbuf.c_str()), tempbuf.length());
+}
+
+/**
+	@brief Reads reply text up to a newline (or semicolon), or the end of the reply message if there is neither
+ */
+string SCPIHiSLIPTransport::ReadReply(bool endOnSemicolon, [[maybe_unused]] function<void(float)> progress)
+{
+	string ret;
+	bool consumed = false;
+	while(true)
+	{
+		if(m_rxPos == m_rxBuffer.size())
+		{
+			//End of the reply message with no terminator
+			if(consumed && (m_payloadLeft == 0) && m_messageEnd)
+				break;
+
+			if(!FillRxBuffer())
+				break;
+			consumed = true;
+			continue;
+		}
+
+		char c = m_rxBuffer[m_rxPos ++];
+		consumed = true;
+		if( (c == '\n') || ( (c == ';') && endOnSemicolon ) )
+			break;
+		ret += c;
+	}
+
+	LogTrace("[%s] Got %s\n", m_hostname.c_str(), ret.c_str());
+	return ret;
+}
+
+/**
+	@brief Reads reply payload bytes, stripping HiSLIP framing so binary data lands directly in the caller's buffer
+ */
+size_t SCPIHiSLIPTransport::ReadRawData(size_t len, unsigned char* buf, function<void(float)> progress)
+{
+	//Anything ReadReply() already pulled off the socket goes first
+	size_t nread = min(len, m_rxBuffer.size() - m_rxPos);
+	if(nread)
+	{
+		memcpy(buf, m_rxBuffer.data() + m_rxPos, nread);
+		m_rxPos += nread;
+	}
+
+	while(nread < len)
+	{
+		if(m_payloadLeft == 0)
+		{
+			if(!ReadDataHeader())
+				break;
+			continue;
+		}
+
+		size_t chunk = min<uint64_t>(len - nread, m_payloadLeft);
+		function<void(float)> sub = nullptr;
+		if(progress)
+			sub = [nread, chunk, len, progress](float p) { progress( (nread + p*chunk) / len); };
+		if(chunk != SCPISocketTransport::ReadLooped(m_syncSocket, chunk, buf + nread, sub))
+			break;
+		nread += chunk;
+		m_payloadLeft -= chunk;
+		if( (m_payloadLeft == 0) && m_messageEnd)
+			m_rmtDelivered = true;
+	}
+	return nread;
+}
+
+void SCPIHiSLIPTransport::SendRawData(size_t len, const unsigned char* buf)
+{
+	SendData(buf, len);
+}
+
+/**
+	@brief Finishes a binary block, discarding the rest of the reply message so the next ReadReply() starts on a
+	message boundary
+ */
+void SCPIHiSLIPTransport::EndBinaryBlock(bool readTerminator)
+{
+	SCPITransport::EndBinaryBlock(readTerminator);
+
+	m_rxBuffer.clear();
+	m_rxPos = 0;
+
+	vector<unsigned char> discard;
+	while(m_payloadLeft)
+	{
+		size_t chunk = min<uint64_t>(m_payloadLeft, HISLIP_RX_CHUNK);
+		discard.resize(chunk);
+		if(chunk != SCPISocketTransport::ReadLooped(m_syncSocket, chunk, discard.data(), nullptr))
+			break;
+		m_payloadLeft -= chunk;
+
+		//Block was followed by more Data messages of the same reply
+		if( (m_payloadLeft == 0) && !m_messageEnd)
+		{
+			if(!ReadDataHeader())
+				break;
+		}
+	}
+	if(m_messageEnd)
+		m_rmtDelivered = true;
+}
+
+void SCPIHiSLIPTransport::FlushRXBuffer(void)
+{
+	m_rxBuffer.clear();
+	m_rxPos = 0;
+	m_payloadLeft = 0;
+	m_messageEnd = false;
+	m_syncSocket.FlushRxBuffer();
+}
+
+bool SCPIHiSLIPTransport::IsCommandBatchingSupported()
+{
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Asynchronous channel
+
+bool SCPIHiSLIPTransport::IsServiceRequestSupported()
+{
+	return IsConnected();
+}
+
+/**
+	@brief Blocks until the instrument raises a service request, or a timeout elapses
+
+	@param timeout	Maximum time to block
+
+	@return True if a service request arrived (see GetLastServiceRequestStatus()), false on timeout
+ */
+bool SCPIHiSLIPTransport::WaitForServiceRequest(chrono::microseconds timeout)
+{
+	auto deadline = chrono::steady_clock::now() + timeout;
+
+	lock_guard<mutex> lock(m_asyncMutex);
+	if(m_pendingServiceRequests)
+	{
+		m_pendingServiceRequests --;
+		return true;
+	}
+
+	auto left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+	if(!PollReadable(m_asyncSocket, max<int64_t>(left, 0)))
+		return false;
+
+	MessageHeader hdr;
+	vector<uint8_t> payload;
+	if(!ReadAsyncReply(MSG_ASYNC_SERVICE_REQUEST, hdr, payload))
+		return false;
+	m_lastServiceRequestStatus = hdr.m_control;
+	return true;
+}
+
+/**
+	@brief Reads the IEEE 488.2 status byte out of band, without disturbing replies on the synchronous channel
+
+	@return The status byte, or -1 on error
+ */
+int SCPIHiSLIPTransport::ReadStatusByte()
+{
+	lock_guard<mutex> lock(m_asyncMutex);
+
+	//Parameter is the ID of the last message we sent
+	if(!SendMessage(m_asyncSocket, MSG_ASYNC_STATUS_QUERY, m_rmtDelivered ? 1 : 0, m_messageID - 2))
+		return -1;
+
+	MessageHeader hdr;
+	vector<uint8_t> payload;
+	if(!ReadAsyncReply(MSG_ASYNC_STATUS_RESPONSE, hdr, payload))
+		return -1;
+	return hdr.m_control;
+}
+
+/**
+	@brief Performs a HiSLIP device clear, aborting any commands in progress and discarding unread replies
+
+	@return True on success
+ */
+bool SCPIHiSLIPTransport::DeviceClear()
+{
+	lock_guard<recursive_mutex> netlock(m_netMutex);
+
+	uint8_t features;
+	{
+		lock_guard<mutex> lock(m_asyncMutex);
+		if(!SendMessage(m_asyncSocket, MSG_ASYNC_DEVICE_CLEAR, 0, 0))
+			return false;
+
+		MessageHeader hdr;
+		vector<uint8_t> payload;
+		if(!ReadAsyncReply(MSG_ASYNC_DEVICE_CLEAR_ACKNOWLEDGE, hdr, payload))
+			return false;
+		features = hdr.m_control;
+	}
+
+	//Drop whatever was in flight, then confirm on the sync channel
+	m_rxBuffer.clear();
+	m_rxPos = 0;
+	m_payloadLeft = 0;
+	m_messageEnd = false;
+	if(!SendMessage(m_syncSocket, MSG_DEVICE_CLEAR_COMPLETE, features, 0))
+		return false;
+
+	vector<uint8_t> payload;
+	while(true)
+	{
+		MessageHeader hdr;
+		if(!ReadHeader(m_syncSocket, hdr) || !ReadPayload(m_syncSocket, hdr, payload))
+			return false;
+		if(hdr.m_type == MSG_DEVICE_CLEAR_ACKNOWLEDGE)
+		{
+			m_overlapped = (hdr.m_control & 1) != 0;
+			break;
+		}
+	}
+
+	m_messageID = HISLIP_INITIAL_MESSAGE_ID;
+	m_rmtDelivered = false;
+	return true;
+}
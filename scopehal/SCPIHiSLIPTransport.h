@@ -0,0 +1,228 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of SCPIHiSLIPTransport
+	@ingroup transports
+ */
+
+#ifndef SCPIHiSLIPTransport_h
+#define SCPIHiSLIPTransport_h
+
+#include "../xptools/Socket.h"
+
+/**
+	@brief A SCPI transport using the IVI High Speed LAN Instrument Protocol (IVI-6.1)
+
+	HiSLIP runs two TCP connections to the same port: a synchronous channel carrying commands and replies as framed
+	messages, and an asynchronous channel for out of band traffic (service requests, status queries, device clear).
+
+	Compared to VXI-11 there is no RPC round trip per message, and if the instrument grants overlapped mode any
+	number of queries may be outstanding at once, so SendQueriesPipelined() works as intended. In synchronized mode
+	the instrument discards a reply if another message arrives before it is read, so pipelining is limited to one
+	query in flight.
+
+	Service requests arriving on the asynchronous channel are delivered through WaitForServiceRequest(), which lets
+	SCPIOscilloscope wait for an acquisition-complete SRQ rather than polling the trigger status.
+
+	Connection string is host[:port[:subaddress]], defaulting to port 4880 and sub-address "hislip0".
+
+	@ingroup transports
+ */
+class SCPIHiSLIPTransport : public SCPITransport
+{
+public:
+	SCPIHiSLIPTransport(const std::string& args);
+	virtual ~SCPIHiSLIPTransport();
+
+	virtual std::string GetConnectionString() override;
+	static std::string GetTransportName();
+
+	virtual void FlushRXBuffer(void) override;
+	virtual bool SendCommand(const std::string& cmd) override;
+	virtual std::string ReadReply(bool endOnSemicolon = true, std::function<void(float)> progress = nullptr) override;
+	virtual size_t ReadRawData(size_t len, unsigned char* buf, std::function<void(float)> progress = nullptr) override;
+	virtual void SendRawData(size_t len, const unsigned char* buf) override;
+
+	virtual bool IsCommandBatchingSupported() override;
+	virtual bool IsConnected() override;
+
+	virtual void EndBinaryBlock(bool readTerminator = true) override;
+
+	virtual bool IsServiceRequestSupported() override;
+	virtual bool WaitForServiceRequest(std::chrono::microseconds timeout) override;
+
+	int ReadStatusByte();
+	bool DeviceClear();
+
+	///@brief Returns true if the instrument granted overlapped mode
+	bool IsOverlapped()
+	{ return m_overlapped; }
+
+	///@brief Returns the status byte sent with the most recent service request
+	uint8_t GetLastServiceRequestStatus()
+	{ return m_lastServiceRequestStatus; }
+
+	///@brief Returns the hostname of the connected instrument
+	const std::string& GetHostname()
+	{ return m_hostname; }
+
+	TRANSPORT_INITPROC(SCPIHiSLIPTransport)
+
+	///@brief Default HiSLIP port number
+	static const unsigned short DEFAULT_PORT = 4880;
+
+	///@brief HiSLIP message types
+	enum MessageType
+	{
+		MSG_INITIALIZE							= 0,
+		MSG_INITIALIZE_RESPONSE					= 1,
+		MSG_FATAL_ERROR							= 2,
+		MSG_ERROR								= 3,
+		MSG_ASYNC_LOCK							= 4,
+		MSG_ASYNC_LOCK_RESPONSE					= 5,
+		MSG_DATA								= 6,
+		MSG_DATA_END							= 7,
+		MSG_DEVICE_CLEAR_COMPLETE				= 8,
+		MSG_DEVICE_CLEAR_ACKNOWLEDGE			= 9,
+		MSG_ASYNC_REMOTE_LOCAL_CONTROL			= 10,
+		MSG_ASYNC_REMOTE_LOCAL_RESPONSE			= 11,
+		MSG_TRIGGER								= 12,
+		MSG_INTERRUPTED							= 13,
+		MSG_ASYNC_INTERRUPTED					= 14,
+		MSG_ASYNC_MAXIMUM_MESSAGE_SIZE			= 15,
+		MSG_ASYNC_MAXIMUM_MESSAGE_SIZE_RESPONSE	= 16,
+		MSG_ASYNC_INITIALIZE					= 17,
+		MSG_ASYNC_INITIALIZE_RESPONSE			= 18,
+		MSG_ASYNC_DEVICE_CLEAR					= 19,
+		MSG_ASYNC_SERVICE_REQUEST				= 20,
+		MSG_ASYNC_STATUS_QUERY					= 21,
+		MSG_ASYNC_STATUS_RESPONSE				= 22,
+		MSG_ASYNC_DEVICE_CLEAR_ACKNOWLEDGE		= 23
+	};
+
+protected:
+
+	/**
+		@brief Fixed 16-byte header of every HiSLIP message
+	 */
+	class MessageHeader
+	{
+	public:
+		MessageHeader()
+		: m_type(0)
+		, m_control(0)
+		, m_param(0)
+		, m_len(0)
+		{}
+
+		uint8_t m_type;
+		uint8_t m_control;
+		uint32_t m_param;
+
+		///@brief Payload length, in bytes
+		uint64_t m_len;
+	};
+
+	static bool SendMessage(
+		Socket& sock,
+		uint8_t type,
+		uint8_t control,
+		uint32_t param,
+		const unsigned char* payload = nullptr,
+		size_t len = 0);
+	static bool ReadHeader(Socket& sock, MessageHeader& hdr);
+	static bool ReadPayload(Socket& sock, const MessageHeader& hdr, std::vector<uint8_t>& payload);
+	static bool PollReadable(Socket& sock, int timeoutMs);
+
+	bool Connect();
+	bool SendData(const unsigned char* buf, size_t len);
+	bool ReadDataHeader();
+	bool FillRxBuffer();
+	bool ReadAsyncReply(uint8_t type, MessageHeader& hdr, std::vector<uint8_t>& payload);
+
+	///@brief Synchronous channel (commands and replies)
+	Socket m_syncSocket;
+
+	///@brief Asynchronous channel (SRQ, status query, device clear)
+	Socket m_asyncSocket;
+
+	///@brief Hostname our sockets are connected to
+	std::string m_hostname;
+
+	///@brief Port our sockets are connected to
+	unsigned short m_port;
+
+	///@brief HiSLIP sub-address (e.g. "hislip0")
+	std::string m_subaddress;
+
+	///@brief True if both channels were set up successfully
+	bool m_connected;
+
+	///@brief True if the instrument granted overlapped mode
+	bool m_overlapped;
+
+	///@brief Session ID assigned by the instrument
+	uint16_t m_sessionID;
+
+	///@brief Largest message the instrument accepts, in bytes, including the header
+	uint64_t m_maxMessageSize;
+
+	///@brief ID of the next message we send
+	uint32_t m_messageID;
+
+	///@brief True if a complete reply was read since the last message we sent (RMT-delivered)
+	bool m_rmtDelivered;
+
+	///@brief Payload bytes of the current Data/DataEnd message not yet read from the socket
+	uint64_t m_payloadLeft;
+
+	///@brief True if the current message is a DataEnd (last of its reply)
+	bool m_messageEnd;
+
+	///@brief Payload bytes read from the socket by ReadReply() but not consumed yet
+	std::vector<uint8_t> m_rxBuffer;
+
+	///@brief Read position in m_rxBuffer
+	size_t m_rxPos;
+
+	///@brief Mutex protecting the asynchronous channel
+	std::mutex m_asyncMutex;
+
+	///@brief Number of service requests received while waiting for something else on the async channel
+	size_t m_pendingServiceRequests;
+
+	///@brief Status byte of the most recent service request
+	uint8_t m_lastServiceRequestStatus;
+};
+
+#endif
@@ -35,6 +35,7 @@ using namespace std;
 // Construction / destruction
 
 SCPIOscilloscope::SCPIOscilloscope()
+	: m_serviceRequestOnTrigger(false)
 {
 }
 
@@ -52,3 +53,15 @@ string SCPIOscilloscope::IDPing()
 	m_transport->SendCommand("*IDN?");
 	return m_transport->ReadReply();
 }
+
+/**
+	@brief Sleeps until the instrument raises a service request, if the driver asked for one on acquisition complete
+	and the transport delivers them (e.g. HiSLIP). Otherwise falls back to the adaptive poll interval.
+ */
+bool SCPIOscilloscope::WaitForTriggerEvent(chrono::microseconds timeout)
+{
+	if(!m_serviceRequestOnTrigger || !m_triggerArmed || !m_transport->IsServiceRequestSupported())
+		return Oscilloscope::WaitForTriggerEvent(timeout);
+
+	return m_transport->WaitForServiceRequest(timeout);
+}
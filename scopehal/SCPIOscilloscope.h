@@ -42,10 +42,18 @@ public:
 
 	virtual std::string IDPing();
 
+	virtual bool WaitForTriggerEvent(std::chrono::microseconds timeout) override;
+
 protected:
 	bool m_triggerArmed;
 	bool m_triggerOneShot;
 
+	/**
+		@brief Set by drivers which have programmed the instrument to raise a service request when an acquisition
+		completes, so WaitForTriggerEvent() can block on the SRQ if the transport delivers them
+	 */
+	bool m_serviceRequestOnTrigger;
+
 	//Mutexing for thread safety
 	std::recursive_mutex m_cacheMutex;
 };
@@ -0,0 +1,250 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of SCPIRecordingTransport
+	@ingroup transports
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+/**
+	@brief Appends an integer to a buffer in little endian byte order
+ */
+static void AppendLE(string& buf, uint64_t value, size_t nbytes)
+{
+	for(size_t i=0; i<nbytes; i++)
+		buf += static_cast<char>( (value >> (8*i)) & 0xff);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates the wrapped transport from a connection string and starts recording
+
+	@param args	Wrapped transport and its arguments, then '@' and the recording path, e.g. "lan:192.168.1.5:5025@scope.rec"
+ */
+SCPIRecordingTransport::SCPIRecordingTransport(const string& args)
+	: m_inner(nullptr)
+	, m_fp(nullptr)
+	, m_startTime(GetTime())
+{
+	auto iat = args.rfind('@');
+	auto icolon = args.find(':');
+	if( (iat == string::npos) || (icolon == string::npos) || (icolon > iat) )
+	{
+		LogError("Invalid recording transport arguments \"%s\" (expected transport:args@path)\n", args.c_str());
+		return;
+	}
+
+	m_inner = SCPITransport::CreateTransport(args.substr(0, icolon), args.substr(icolon + 1, iat - icolon - 1));
+	if(m_inner)
+		Open(args.substr(iat + 1));
+}
+
+/**
+	@brief Starts recording an existing transport
+
+	@param inner	Transport to record. We take ownership of it.
+	@param path		Path of the recording file to create
+ */
+SCPIRecordingTransport::SCPIRecordingTransport(SCPITransport* inner, const string& path)
+	: m_inner(inner)
+	, m_fp(nullptr)
+	, m_startTime(GetTime())
+{
+	Open(path);
+}
+
+SCPIRecordingTransport::~SCPIRecordingTransport()
+{
+	if(m_fp)
+		fclose(m_fp);
+	delete m_inner;
+}
+
+/**
+	@brief Creates the recording file and writes the header
+ */
+void SCPIRecordingTransport::Open(const string& path)
+{
+	m_fp = fopen(path.c_str(), "wb");
+	if(!m_fp)
+	{
+		LogError("Failed to open recording file %s\n", path.c_str());
+		return;
+	}
+
+	auto connectionString = m_inner->GetConnectionString();
+	auto name = m_inner->GetName();
+
+	string header = "SCPIREC1";
+	AppendLE(header, m_inner->IsCommandBatchingSupported() ? 1 : 0, 1);
+	AppendLE(header, connectionString.length(), 4);
+	header += connectionString;
+	AppendLE(header, name.length(), 4);
+	header += name;
+	fwrite(header.c_str(), 1, header.length(), m_fp);
+}
+
+bool SCPIRecordingTransport::IsConnected()
+{
+	return m_inner && m_inner->IsConnected();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Recording
+
+/**
+	@brief Appends one record to the recording
+
+	@param type		Type of record
+	@param start	Time the call started, in the GetTime() timebase
+	@param data		Payload
+	@param len		Payload length in bytes
+ */
+void SCPIRecordingTransport::WriteRecord(RecordType type, double start, const void* data, size_t len)
+{
+	double now = GetTime();
+
+	lock_guard<mutex> lock(m_fileMutex);
+	if(!m_fp)
+		return;
+
+	string header;
+	AppendLE(header, type, 1);
+	AppendLE(header, static_cast<int64_t>(round( (start - m_startTime) * 1e9)), 8);
+	AppendLE(header, static_cast<int64_t>(round( (now - start) * 1e9)), 8);
+	AppendLE(header, len, 8);
+	fwrite(header.c_str(), 1, header.length(), m_fp);
+	if(len)
+		fwrite(data, 1, len, m_fp);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Actual transport code
+
+string SCPIRecordingTransport::GetTransportName()
+{
+	return "record";
+}
+
+string SCPIRecordingTransport::GetConnectionString()
+{
+	if(!m_inner)
+		return "";
+	return m_inner->GetConnectionString();
+}
+
+bool SCPIRecordingTransport::SendCommand(const string& cmd)
+{
+	if(!m_inner)
+		return false;
+
+	double start = GetTime();
+	bool ok = m_inner->SendCommand(cmd);
+	WriteRecord(RECORD_COMMAND, start, cmd.c_str(), cmd.length());
+	return ok;
+}
+
+string SCPIRecordingTransport::ReadReply(bool endOnSemicolon, function<void(float)> progress)
+{
+	if(!m_inner)
+		return "";
+
+	double start = GetTime();
+	auto reply = m_inner->ReadReply(endOnSemicolon, progress);
+	WriteRecord(RECORD_REPLY, start, reply.c_str(), reply.length());
+	return reply;
+}
+
+size_t SCPIRecordingTransport::ReadRawData(size_t len, unsigned char* buf, function<void(float)> progress)
+{
+	if(!m_inner)
+		return 0;
+
+	double start = GetTime();
+	size_t nread = m_inner->ReadRawData(len, buf, progress);
+	WriteRecord(RECORD_READ_RAW, start, buf, nread);
+	return nread;
+}
+
+void SCPIRecordingTransport::SendRawData(size_t len, const unsigned char* buf)
+{
+	if(!m_inner)
+		return;
+
+	double start = GetTime();
+	m_inner->SendRawData(len, buf);
+	WriteRecord(RECORD_SEND_RAW, start, buf, len);
+}
+
+/**
+	@brief Reads binary block payload through the wrapped transport, so its framing is stripped before recording
+ */
+size_t SCPIRecordingTransport::ReadBlockPayload(size_t len, unsigned char* buf, function<void(float)> progress)
+{
+	if(!m_inner)
+		return 0;
+
+	double start = GetTime();
+	size_t nread = m_inner->ReadBlockPayload(len, buf, progress);
+	WriteRecord(RECORD_READ_RAW, start, buf, nread);
+	return nread;
+}
+
+void SCPIRecordingTransport::EndBinaryBlock(bool readTerminator)
+{
+	if(!m_inner)
+		return;
+
+	double start = GetTime();
+	m_inner->EndBinaryBlock(readTerminator);
+	uint8_t flag = readTerminator ? 1 : 0;
+	WriteRecord(RECORD_END_BLOCK, start, &flag, 1);
+}
+
+void SCPIRecordingTransport::FlushRXBuffer()
+{
+	if(!m_inner)
+		return;
+
+	double start = GetTime();
+	m_inner->FlushRXBuffer();
+	WriteRecord(RECORD_FLUSH_RX, start, nullptr, 0);
+}
+
+bool SCPIRecordingTransport::IsCommandBatchingSupported()
+{
+	return m_inner && m_inner->IsCommandBatchingSupported();
+}
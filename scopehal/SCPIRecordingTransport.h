@@ -0,0 +1,127 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of SCPIRecordingTransport
+	@ingroup transports
+ */
+
+#ifndef SCPIRecordingTransport_h
+#define SCPIRecordingTransport_h
+
+/**
+	@brief Wraps another SCPITransport and logs all traffic through it to a file, for later use by SCPIReplayTransport
+
+	The file starts with a header:
+	* 8 byte magic "SCPIREC1"
+	* uint8 IsCommandBatchingSupported() of the wrapped transport
+	* uint32 length, then connection string of the wrapped transport
+	* uint32 length, then name of the wrapped transport
+
+	followed by one record per transport call:
+	* uint8 record type (RecordType)
+	* int64 start time of the call, in ns relative to the start of the recording
+	* int64 duration of the call, in ns
+	* uint64 length, then payload (command text, reply text, or raw bytes)
+
+	All integers are little endian. Binary block payloads are recorded as the bytes the driver actually received, after
+	the wrapped transport has stripped any framing of its own (e.g. VICP headers).
+
+	@ingroup transports
+ */
+class SCPIRecordingTransport : public SCPITransport
+{
+public:
+	SCPIRecordingTransport(const std::string& args);
+	SCPIRecordingTransport(SCPITransport* inner, const std::string& path);
+	virtual ~SCPIRecordingTransport();
+
+	///@brief Types of record in a recording
+	enum RecordType
+	{
+		///@brief SendCommand(), payload is the command
+		RECORD_COMMAND		= 1,
+
+		///@brief ReadReply(), payload is the reply
+		RECORD_REPLY		= 2,
+
+		///@brief ReadRawData(), or a read of binary block payload; payload is the bytes read
+		RECORD_READ_RAW		= 3,
+
+		///@brief SendRawData(), payload is the bytes sent
+		RECORD_SEND_RAW		= 4,
+
+		///@brief EndBinaryBlock(), payload is one byte: nonzero if the terminator was read
+		RECORD_END_BLOCK	= 5,
+
+		///@brief FlushRXBuffer(), no payload
+		RECORD_FLUSH_RX		= 6
+	};
+
+	virtual std::string GetConnectionString() override;
+	static std::string GetTransportName();
+
+	virtual bool SendCommand(const std::string& cmd) override;
+	virtual std::string ReadReply(bool endOnSemicolon = true, std::function<void(float)> progress = nullptr) override;
+	virtual size_t ReadRawData(size_t len, unsigned char* buf, std::function<void(float)> progress = nullptr) override;
+	virtual void SendRawData(size_t len, const unsigned char* buf) override;
+
+	virtual bool IsCommandBatchingSupported() override;
+	virtual bool IsConnected() override;
+
+	virtual void FlushRXBuffer() override;
+	virtual void EndBinaryBlock(bool readTerminator = true) override;
+
+	///@brief Gets the transport being recorded
+	SCPITransport* GetInner()
+	{ return m_inner; }
+
+	TRANSPORT_INITPROC(SCPIRecordingTransport)
+
+protected:
+	virtual size_t ReadBlockPayload(size_t len, unsigned char* buf, std::function<void(float)> progress) override;
+
+	void Open(const std::string& path);
+	void WriteRecord(RecordType type, double start, const void* data, size_t len);
+
+	///@brief The transport being recorded, owned by us
+	SCPITransport* m_inner;
+
+	///@brief Recording file
+	FILE* m_fp;
+
+	///@brief Mutex protecting m_fp
+	std::mutex m_fileMutex;
+
+	///@brief Time the recording started, in the GetTime() timebase
+	double m_startTime;
+};
+
+#endif
@@ -0,0 +1,300 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of SCPIReplayTransport
+	@ingroup transports
+ */
+
+#include "scopehal.h"
+#include <string.h>
+#include <thread>
+
+using namespace std;
+
+/**
+	@brief Reads a little endian integer from a file
+
+	@return True on success, false on EOF
+ */
+static bool ReadLE(FILE* fp, uint64_t& value, size_t nbytes)
+{
+	unsigned char buf[8];
+	if(nbytes != fread(buf, 1, nbytes, fp))
+		return false;
+
+	value = 0;
+	for(size_t i=0; i<nbytes; i++)
+		value |= static_cast<uint64_t>(buf[i]) << (8*i);
+	return true;
+}
+
+/**
+	@brief Reads a length-prefixed string from a file
+
+	@return True on success, false on EOF
+ */
+static bool ReadString(FILE* fp, string& str, size_t lenbytes)
+{
+	uint64_t len;
+	if(!ReadLE(fp, len, lenbytes))
+		return false;
+
+	str.resize(len);
+	if(len && (len != fread(&str[0], 1, len, fp)))
+		return false;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Opens a recording for playback
+
+	@param args	Path to the recording, optionally followed by ":fast" to replay with no delays
+ */
+SCPIReplayTransport::SCPIReplayTransport(const string& args)
+	: m_args(args)
+	, m_fp(nullptr)
+	, m_unlimited(false)
+	, m_batching(false)
+	, m_rawOffset(0)
+{
+	string path = args;
+	const string fast = ":fast";
+	if( (path.length() > fast.length()) && (path.compare(path.length() - fast.length(), fast.length(), fast) == 0) )
+	{
+		m_unlimited = true;
+		path.resize(path.length() - fast.length());
+	}
+
+	m_fp = fopen(path.c_str(), "rb");
+	if(!m_fp)
+	{
+		LogError("Failed to open recording file %s\n", path.c_str());
+		return;
+	}
+
+	if(!ReadHeader())
+	{
+		LogError("%s is not a valid SCPI recording\n", path.c_str());
+		fclose(m_fp);
+		m_fp = nullptr;
+		return;
+	}
+
+	LogDebug("Replaying %s (recorded through %s:%s)\n",
+		path.c_str(), m_recordedTransportName.c_str(), m_recordedConnectionString.c_str());
+}
+
+SCPIReplayTransport::~SCPIReplayTransport()
+{
+	if(m_fp)
+		fclose(m_fp);
+}
+
+/**
+	@brief Reads and checks the file header
+ */
+bool SCPIReplayTransport::ReadHeader()
+{
+	char magic[8];
+	if( (sizeof(magic) != fread(magic, 1, sizeof(magic), m_fp)) || (0 != memcmp(magic, "SCPIREC1", sizeof(magic))) )
+		return false;
+
+	uint64_t batching;
+	if(!ReadLE(m_fp, batching, 1))
+		return false;
+	m_batching = (batching != 0);
+
+	return ReadString(m_fp, m_recordedConnectionString, 4) && ReadString(m_fp, m_recordedTransportName, 4);
+}
+
+bool SCPIReplayTransport::IsConnected()
+{
+	return (m_fp != nullptr);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Playback
+
+/**
+	@brief Reads the next record from the file
+
+	@param type		Record type
+	@param duration	Duration of the recorded call, in ns
+	@param payload	Record payload
+
+	@return True on success, false on EOF
+ */
+bool SCPIReplayTransport::ReadRecord(uint8_t& type, int64_t& duration, string& payload)
+{
+	if(!m_fp)
+		return false;
+
+	uint64_t t;
+	uint64_t start;
+	uint64_t dur;
+	if(!ReadLE(m_fp, t, 1) || !ReadLE(m_fp, start, 8) || !ReadLE(m_fp, dur, 8) || !ReadString(m_fp, payload, 8))
+		return false;
+
+	type = t;
+	duration = static_cast<int64_t>(dur);
+	return true;
+}
+
+/**
+	@brief Advances to the next record of a given type, waiting as long as the recorded call took unless in fast mode
+
+	Raw writes, RX buffer flushes and binary block ends are skipped silently if they aren't what we're looking for,
+	since the driver doesn't depend on their results. Anything else skipped means the driver has diverged from the
+	recording, and is logged.
+
+	@return True if a record was found, false at the end of the recording
+ */
+bool SCPIReplayTransport::NextRecord(SCPIRecordingTransport::RecordType type, string& payload)
+{
+	uint8_t t;
+	int64_t duration;
+	while(ReadRecord(t, duration, payload))
+	{
+		if(t == type)
+		{
+			if(!m_unlimited && (duration > 0))
+				this_thread::sleep_for(chrono::nanoseconds(duration));
+			return true;
+		}
+
+		switch(t)
+		{
+			case SCPIRecordingTransport::RECORD_SEND_RAW:
+			case SCPIRecordingTransport::RECORD_FLUSH_RX:
+			case SCPIRecordingTransport::RECORD_END_BLOCK:
+				break;
+
+			default:
+				LogWarning("SCPIReplayTransport: driver diverged from recording (wanted record type %d, skipping %d)\n",
+					type, t);
+				break;
+		}
+	}
+
+	LogWarning("SCPIReplayTransport: end of recording\n");
+	fclose(m_fp);
+	m_fp = nullptr;
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Actual transport code
+
+string SCPIReplayTransport::GetTransportName()
+{
+	return "replay";
+}
+
+string SCPIReplayTransport::GetConnectionString()
+{
+	return m_args;
+}
+
+bool SCPIReplayTransport::SendCommand(const string& cmd)
+{
+	string recorded;
+	if(!NextRecord(SCPIRecordingTransport::RECORD_COMMAND, recorded))
+		return false;
+
+	if(recorded != cmd)
+	{
+		LogWarning("SCPIReplayTransport: sent \"%s\" but recording has \"%s\"\n",
+			Trim(cmd).c_str(), Trim(recorded).c_str());
+	}
+	return true;
+}
+
+string SCPIReplayTransport::ReadReply(bool /*endOnSemicolon*/, [[maybe_unused]] function<void(float)> progress)
+{
+	string reply;
+	NextRecord(SCPIRecordingTransport::RECORD_REPLY, reply);
+	return reply;
+}
+
+void SCPIReplayTransport::SendRawData(size_t /*len*/, const unsigned char* /*buf*/)
+{
+}
+
+size_t SCPIReplayTransport::ReadRawData(size_t len, unsigned char* buf, function<void(float)> progress)
+{
+	size_t nread = 0;
+	while(nread < len)
+	{
+		if(m_rawOffset >= m_rawPending.length())
+		{
+			m_rawOffset = 0;
+			if(!NextRecord(SCPIRecordingTransport::RECORD_READ_RAW, m_rawPending))
+			{
+				m_rawPending.clear();
+				break;
+			}
+			continue;
+		}
+
+		size_t n = min(len - nread, m_rawPending.length() - m_rawOffset);
+		memcpy(buf + nread, m_rawPending.c_str() + m_rawOffset, n);
+		m_rawOffset += n;
+		nread += n;
+
+		if(progress)
+			progress(static_cast<float>(nread) / len);
+	}
+	return nread;
+}
+
+void SCPIReplayTransport::EndBinaryBlock(bool /*readTerminator*/)
+{
+	//Anything the driver didn't read was discarded by the recorded transport too
+	m_rawPending.clear();
+	m_rawOffset = 0;
+
+	string flag;
+	NextRecord(SCPIRecordingTransport::RECORD_END_BLOCK, flag);
+}
+
+void SCPIReplayTransport::FlushRXBuffer()
+{
+	m_rawPending.clear();
+	m_rawOffset = 0;
+}
+
+bool SCPIReplayTransport::IsCommandBatchingSupported()
+{
+	return m_batching;
+}
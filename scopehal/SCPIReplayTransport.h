@@ -0,0 +1,114 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of SCPIReplayTransport
+	@ingroup transports
+ */
+
+#ifndef SCPIReplayTransport_h
+#define SCPIReplayTransport_h
+
+/**
+	@brief Plays back a file recorded by SCPIRecordingTransport, with no instrument attached
+
+	Each call is answered by the next record of the matching type. By default each read takes as long as it did
+	during the recording, so a driver sees the original instrument latency; add ":fast" to the arguments to replay
+	with no delays, leaving only the host side cost of parsing and conversion.
+
+	Raw and binary block reads are served as a byte stream, so they don't need to be chunked the same way as when
+	recorded. Commands are compared against the recording and a warning is logged if the driver has diverged from it.
+
+	Drivers which check the concrete type of their transport (e.g. for SCPISocketTransport) may take a different
+	code path during replay than during recording.
+
+	@ingroup transports
+ */
+class SCPIReplayTransport : public SCPITransport
+{
+public:
+	SCPIReplayTransport(const std::string& args);
+	virtual ~SCPIReplayTransport();
+
+	virtual std::string GetConnectionString() override;
+	static std::string GetTransportName();
+
+	///@brief Gets the connection string of the transport the recording was made through
+	std::string GetRecordedConnectionString()
+	{ return m_recordedConnectionString; }
+
+	///@brief Gets the name of the transport the recording was made through
+	std::string GetRecordedTransportName()
+	{ return m_recordedTransportName; }
+
+	virtual bool SendCommand(const std::string& cmd) override;
+	virtual std::string ReadReply(bool endOnSemicolon = true, std::function<void(float)> progress = nullptr) override;
+	virtual size_t ReadRawData(size_t len, unsigned char* buf, std::function<void(float)> progress = nullptr) override;
+	virtual void SendRawData(size_t len, const unsigned char* buf) override;
+
+	virtual bool IsCommandBatchingSupported() override;
+	virtual bool IsConnected() override;
+
+	virtual void FlushRXBuffer() override;
+	virtual void EndBinaryBlock(bool readTerminator = true) override;
+
+	TRANSPORT_INITPROC(SCPIReplayTransport)
+
+protected:
+	bool ReadHeader();
+	bool NextRecord(SCPIRecordingTransport::RecordType type, std::string& payload);
+	bool ReadRecord(uint8_t& type, int64_t& duration, std::string& payload);
+
+	///@brief Arguments we were created with
+	std::string m_args;
+
+	///@brief Recording file
+	FILE* m_fp;
+
+	///@brief True to replay with no delays
+	bool m_unlimited;
+
+	///@brief IsCommandBatchingSupported() of the recorded transport
+	bool m_batching;
+
+	///@brief Connection string of the recorded transport
+	std::string m_recordedConnectionString;
+
+	///@brief Name of the recorded transport
+	std::string m_recordedTransportName;
+
+	///@brief Bytes of the current raw read record not yet returned
+	std::string m_rawPending;
+
+	///@brief Position of the next unread byte in m_rawPending
+	size_t m_rawOffset;
+};
+
+#endif
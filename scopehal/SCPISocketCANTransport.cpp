@@ -54,9 +54,26 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Construction / destruction
 
+/**
+	@brief Size of the control message buffer for each received frame (room for every timestamp format)
+ */
+static const size_t CONTROL_SIZE = 256;
+
 SCPISocketCANTransport::SCPISocketCANTransport(const string& args)
 	: m_devname(args)
+	, m_timestamping(false)
 {
+	//Split the interface list
+	stringstream ss(args);
+	string name;
+	while(getline(ss, name, ','))
+	{
+		if(!name.empty())
+			m_interfaces.push_back(name);
+	}
+	m_hwClockOffsets.resize(m_interfaces.size(), 0);
+	m_hwClockOffsetsValid.resize(m_interfaces.size(), false);
+
 	m_socket = socket(PF_CAN, SOCK_RAW, CAN_RAW);
 	if(m_socket < 0)
 	{
@@ -66,19 +83,30 @@ SCPISocketCANTransport::SCPISocketCANTransport(const string& args)
 	}
 
 	ifreq ifr;
-	memset(&ifr, 0, sizeof(ifr));
-	strncpy(ifr.ifr_name, args.c_str(), sizeof(ifr.ifr_name) - 1);
-	if(0 != ioctl(m_socket, SIOCGIFINDEX, &ifr))
+	for(auto& iface : m_interfaces)
 	{
-		perror("SIOCGIFINDEX failed\n");
-		LogError("Failed to open CAN interface\n");
+		memset(&ifr, 0, sizeof(ifr));
+		strncpy(ifr.ifr_name, iface.c_str(), sizeof(ifr.ifr_name) - 1);
+		if(0 != ioctl(m_socket, SIOCGIFINDEX, &ifr))
+		{
+			perror("SIOCGIFINDEX failed\n");
+			LogError("Failed to open CAN interface %s\n", iface.c_str());
+			return;
+		}
+		LogTrace("Found CAN interface %s at index %d\n", iface.c_str(), ifr.ifr_ifindex);
+		m_ifindexes.push_back(ifr.ifr_ifindex);
+	}
+	if(m_ifindexes.empty())
+	{
+		LogError("No CAN interface specified\n");
 		return;
 	}
-	LogTrace("Found CAN interface %s at index %d\n", args.c_str(), ifr.ifr_ifindex);
 
+	//A single interface is bound directly. For several, bind to all CAN interfaces and sort frames out by source
 	sockaddr_can addr;
+	memset(&addr, 0, sizeof(addr));
 	addr.can_family = AF_CAN;
-	addr.can_ifindex = ifr.ifr_ifindex;
+	addr.can_ifindex = (m_ifindexes.size() == 1) ? m_ifindexes[0] : 0;
 	if(0 != bind(m_socket, (sockaddr*)&addr, sizeof(addr)))
 	{
 		perror("bind failed\n");
@@ -86,6 +114,11 @@ SCPISocketCANTransport::SCPISocketCANTransport(const string& args)
 		return;
 	}
 
+	//Accept CAN-FD frames too (classic frames still arrive as can_frame sized reads)
+	int enable = 1;
+	if(0 != setsockopt(m_socket, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable)))
+		LogDebug("CAN-FD frames not supported\n");
+
 	//set 1ms timeout if no packets
 	struct timeval tv;
 	tv.tv_sec = 0;
@@ -100,9 +133,9 @@ SCPISocketCANTransport::SCPISocketCANTransport(const string& args)
 	//request hardware timestamping requires root
 	//alternatively do hwstamp_ctl -i can0 -r 1
 	hwtstamp_config cfg;
-	/*cfg.flags = 0;
-	cfg.tx_type = HWTSTAMP_TX_OFF;
-	cfg.rx_filter = HWTSTAMP_FILTER_ALL;*/
+	memset(&cfg, 0, sizeof(cfg));
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, m_interfaces[0].c_str(), sizeof(ifr.ifr_name) - 1);
 	ifr.ifr_data = (char*)&cfg;
 	if(0 != ioctl(m_socket, SIOCGHWTSTAMP, &ifr))
 		perror("SIOCGHWTSTAMP failed\n");
@@ -112,14 +145,27 @@ SCPISocketCANTransport::SCPISocketCANTransport(const string& args)
 	else
 		LogDebug("hardware timestamp state %d\n", cfg.rx_filter);
 
-	//Enable hardware timestamping
-	int enable = 1;
-	if(0 != setsockopt(m_socket, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)))
+	//Ask for both hardware and software timestamps, we use hardware when the interface provides them
+	int flags =
+		SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE |
+		SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+	if(0 == setsockopt(m_socket, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)))
+		m_timestamping = true;
+
+	//Fall back to plain software timestamps
+	else if(0 != setsockopt(m_socket, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)))
 	{
 		perror("setsockopt SO_TIMESTAMPNS\n");
 		LogError("Failed to enable timestamping\n");
 		return;
 	}
+
+	//Set up receive buffers for batched reads
+	m_rxFrames.resize(MAX_BATCH);
+	m_rxAddrs.resize(MAX_BATCH);
+	m_rxIovecs.resize(MAX_BATCH);
+	m_rxHeaders.resize(MAX_BATCH);
+	m_rxControl.resize(MAX_BATCH * CONTROL_SIZE);
 }
 
 SCPISocketCANTransport::~SCPISocketCANTransport()
@@ -165,66 +211,173 @@ void SCPISocketCANTransport::SendRawData(size_t /*len*/, const unsigned char* /*
 }
 
 /**
-	@brief Recommended interface w/ hardware timestamping
+	@brief Reads a single classic CAN frame
+
+	CAN-FD frames are truncated to 8 bytes. Prefer ReadPackets(), which reads many frames per system call.
  */
 size_t SCPISocketCANTransport::ReadPacket(can_frame* frame, int64_t& sec, int64_t& ns)
 {
-	iovec iov;
-	iov.iov_base = frame;
-	iov.iov_len = sizeof(can_frame);
+	SocketCANFrame f;
+	if(0 == ReadPackets(&f, 1))
+		return 0;
 
-	char ctrl[1536];
+	memset(frame, 0, sizeof(can_frame));
+	frame->can_id = f.frame.can_id;
+	frame->can_dlc = min(f.frame.len, (uint8_t)CAN_MAX_DLEN);
+	memcpy(frame->data, f.frame.data, frame->can_dlc);
+	sec = f.sec;
+	ns = f.ns;
+	return sizeof(can_frame);
+}
 
-	msghdr msg;
-	msg.msg_name = nullptr;
-	msg.msg_namelen = 0;
-	msg.msg_iov = &iov;
-	msg.msg_iovlen = 1;
-	msg.msg_control = ctrl;
-	msg.msg_controllen = sizeof(ctrl);
-	msg.msg_flags = 0;
+/**
+	@brief Reads as many frames as are available (up to maxFrames) with one system call
 
-	auto rlen = recvmsg(m_socket, &msg, 0);
+	Blocks for up to the receive timeout (1 ms) for the first frame, then returns whatever else has already
+	arrived without waiting.
+
+	@param frames		Output buffer
+	@param maxFrames	Size of the output buffer (only the first MAX_BATCH entries are used)
+
+	@return Number of frames read
+ */
+size_t SCPISocketCANTransport::ReadPackets(SocketCANFrame* frames, size_t maxFrames)
+{
+	if(m_rxHeaders.empty())
+		return 0;
+
+	size_t n = min(maxFrames, MAX_BATCH);
+	for(size_t i=0; i<n; i++)
+	{
+		m_rxIovecs[i].iov_base = &m_rxFrames[i];
+		m_rxIovecs[i].iov_len = sizeof(canfd_frame);
+
+		auto& msg = m_rxHeaders[i].msg_hdr;
+		msg.msg_name = &m_rxAddrs[i];
+		msg.msg_namelen = sizeof(sockaddr_can);
+		msg.msg_iov = &m_rxIovecs[i];
+		msg.msg_iovlen = 1;
+		msg.msg_control = &m_rxControl[i * CONTROL_SIZE];
+		msg.msg_controllen = CONTROL_SIZE;
+		msg.msg_flags = 0;
+		m_rxHeaders[i].msg_len = 0;
+	}
+
+	int nmsgs = recvmmsg(m_socket, &m_rxHeaders[0], n, MSG_WAITFORONE, nullptr);
 
 	//failed
-	if(rlen < 0)
+	if(nmsgs < 0)
 	{
 		//normal timeout
 		if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
 			return 0;
 
-		perror("ReadRawData failed\n");
+		perror("ReadPackets failed\n");
 		return 0;
 	}
 
-	//no data
-	else if(rlen == 0)
-		return 0;
+	size_t nout = 0;
+	for(int i=0; i<nmsgs; i++)
+	{
+		//Figure out which interface the frame came from, discarding any on interfaces we don't care about
+		size_t iface = 0;
+		if(m_ifindexes.size() > 1)
+		{
+			iface = find(m_ifindexes.begin(), m_ifindexes.end(), m_rxAddrs[i].can_ifindex) - m_ifindexes.begin();
+			if(iface >= m_ifindexes.size())
+				continue;
+		}
+
+		//Classic frames are CAN_MTU bytes, FD frames CANFD_MTU. Anything else is garbage.
+		auto len = m_rxHeaders[i].msg_len;
+		auto& out = frames[nout];
+		if(len == CAN_MTU)
+		{
+			out.fd = false;
+			memcpy(&out.frame, &m_rxFrames[i], CAN_MTU);
+		}
+		else if(len == CANFD_MTU)
+		{
+			out.fd = true;
+			memcpy(&out.frame, &m_rxFrames[i], CANFD_MTU);
+		}
+		else
+			continue;
+
+		out.iface = iface;
+		ExtractTimestamp(m_rxHeaders[i].msg_hdr, out);
+		nout ++;
+	}
+
+	return nout;
+}
+
+/**
+	@brief Gets the timestamp of a received frame from its control messages
+
+	Hardware timestamps usually count from an arbitrary epoch, so they are mapped onto CLOCK_REALTIME using the
+	offset from the software timestamp of the first frame on each interface. This keeps the hardware's precision for
+	the spacing between frames. If the two clocks drift more than 10 ms apart, we re-anchor.
+ */
+void SCPISocketCANTransport::ExtractTimestamp(msghdr& msg, SocketCANFrame& frame)
+{
+	frame.sec = 0;
+	frame.ns = 0;
+	frame.hwTimestamp = false;
 
-	//extract timestamp
 	for(auto pmsg = CMSG_FIRSTHDR(&msg); pmsg != nullptr; pmsg = CMSG_NXTHDR(&msg, pmsg) )
 	{
 		if(pmsg->cmsg_level != SOL_SOCKET)
 			continue;
-		if(pmsg->cmsg_type != SCM_TIMESTAMPNS)
+
+		//Software timestamp only
+		if(pmsg->cmsg_type == SCM_TIMESTAMPNS)
+		{
+			timespec ts;
+			memcpy(&ts, CMSG_DATA(pmsg), sizeof(ts));
+			frame.sec = ts.tv_sec;
+			frame.ns = ts.tv_nsec;
+			return;
+		}
+
+		if(pmsg->cmsg_type != SCM_TIMESTAMPING)
 			continue;
 
-		scm_timestamping64 data;
+		//ts[0] is the software timestamp, ts[2] the raw hardware timestamp (zero if not available)
+		scm_timestamping data;
 		memcpy(&data, CMSG_DATA(pmsg), sizeof(data));
-
-		//LogDebug("got valid timestamp\n");
-		//for(int i=0; i<3; i++)
-		//	LogDebug("[%d] %lld.%lld\n", i, data.ts[i].tv_sec, data.ts[i].tv_nsec);
-
-		//got a timestamp, for now only use the first
-		//(there can be up to 3 and its not clear which to use, but the first looks to make the most sense)
-		sec = data.ts[0].tv_sec;
-		ns = data.ts[0].tv_nsec;
-
-		break;
+		frame.sec = data.ts[0].tv_sec;
+		frame.ns = data.ts[0].tv_nsec;
+
+		if( (data.ts[2].tv_sec == 0) && (data.ts[2].tv_nsec == 0) )
+			return;
+
+		int64_t sw = frame.sec * 1000000000LL + frame.ns;
+		int64_t hw = data.ts[2].tv_sec * 1000000000LL + data.ts[2].tv_nsec;
+		auto& offset = m_hwClockOffsets[frame.iface];
+		if(!m_hwClockOffsetsValid[frame.iface] || (llabs(hw + offset - sw) > 10000000LL))
+		{
+			offset = sw - hw;
+			m_hwClockOffsetsValid[frame.iface] = true;
+		}
+
+		int64_t t = hw + offset;
+		frame.sec = t / 1000000000LL;
+		frame.ns = t % 1000000000LL;
+		frame.hwTimestamp = true;
+		return;
 	}
+}
 
-	return rlen;
+/**
+	@brief Forgets the mapping from each interface's hardware clock to CLOCK_REALTIME
+
+	Call this when starting a new capture, so that the first frame re-establishes it.
+ */
+void SCPISocketCANTransport::ResetTimestampAnchors()
+{
+	for(size_t i=0; i<m_hwClockOffsetsValid.size(); i++)
+		m_hwClockOffsetsValid[i] = false;
 }
 
 /**
@@ -39,12 +39,41 @@
 
 #ifdef __linux
 
+#include <sys/socket.h>
 #include <linux/can.h>
 #include <linux/can/raw.h>
 
+/**
+	@brief A single frame received by SCPISocketCANTransport::ReadPackets()
+	@ingroup transports
+ */
+struct SocketCANFrame
+{
+	///@brief The frame itself (classic frames have len <= 8)
+	canfd_frame frame;
+
+	///@brief True if this is a CAN-FD frame
+	bool fd;
+
+	///@brief Index of the interface the frame arrived on, in the order given in the connection string
+	size_t iface;
+
+	///@brief Receive timestamp, integer part (CLOCK_REALTIME seconds)
+	int64_t sec;
+
+	///@brief Receive timestamp, fractional part (nanoseconds)
+	int64_t ns;
+
+	///@brief True if the timestamp came from the interface hardware rather than the kernel
+	bool hwTimestamp;
+};
+
 /**
 	@brief SocketCAN based interface for implementing CAN protocol analyzer functionality
 	@ingroup transports
+
+	The connection string is an interface name (e.g. "can0"), or a comma separated list of them to capture from
+	several buses at once through a single socket.
  */
 class SCPISocketCANTransport : public SCPITransport
 {
@@ -62,6 +91,19 @@ public:
 	virtual void SendRawData(size_t len, const unsigned char* buf) override;
 
 	size_t ReadPacket(can_frame* frame, int64_t& sec, int64_t& ns);
+	size_t ReadPackets(SocketCANFrame* frames, size_t maxFrames);
+	void ResetTimestampAnchors();
+
+	///@brief Maximum number of frames read by one call to ReadPackets()
+	static const size_t MAX_BATCH = 64;
+
+	///@brief Gets the number of interfaces we're capturing from
+	size_t GetInterfaceCount()
+	{ return m_interfaces.size(); }
+
+	///@brief Gets the name of an interface
+	const std::string& GetInterfaceName(size_t i)
+	{ return m_interfaces[i]; }
 
 	virtual bool IsCommandBatchingSupported() override;
 	virtual bool IsConnected() override;
@@ -70,9 +112,41 @@ public:
 
 protected:
 
+	void ExtractTimestamp(msghdr& msg, SocketCANFrame& frame);
+
 	int m_socket;
 
 	std::string m_devname;
+
+	///@brief Names of each interface
+	std::vector<std::string> m_interfaces;
+
+	///@brief Kernel interface index of each interface
+	std::vector<int> m_ifindexes;
+
+	///@brief True if SO_TIMESTAMPING is enabled (otherwise we only have SO_TIMESTAMPNS software timestamps)
+	bool m_timestamping;
+
+	///@brief Per interface offset from the hardware clock to CLOCK_REALTIME, in ns
+	std::vector<int64_t> m_hwClockOffsets;
+
+	///@brief Per interface flag indicating m_hwClockOffsets is valid
+	std::vector<bool> m_hwClockOffsetsValid;
+
+	///@brief Receive buffers for ReadPackets()
+	std::vector<canfd_frame> m_rxFrames;
+
+	///@brief Source addresses for ReadPackets()
+	std::vector<sockaddr_can> m_rxAddrs;
+
+	///@brief Scatter list for ReadPackets()
+	std::vector<iovec> m_rxIovecs;
+
+	///@brief Message headers for ReadPackets()
+	std::vector<mmsghdr> m_rxHeaders;
+
+	///@brief Control message buffers for ReadPackets()
+	std::vector<char> m_rxControl;
 };
 
 #endif
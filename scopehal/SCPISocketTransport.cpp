@@ -110,6 +110,10 @@ void SCPISocketTransport::SharedCtorInit()
 		LogError("Couldn't disable delayed ACK\n");
 		return;
 	}
+
+	//Deep waveform downloads on 10GbE stall on the default RX buffer size long before line rate
+	if(!m_socket.SetRxBuffer(RX_BUFFER_SIZE))
+		LogWarning("Could not set 32 MB RX buffer. Consider increasing /proc/sys/net/core/rmem_max\n");
 }
 
 SCPISocketTransport::~SCPISocketTransport()
@@ -173,22 +177,36 @@ void SCPISocketTransport::SendRawData(size_t len, const unsigned char* buf)
 }
 
 size_t SCPISocketTransport::ReadRawData(size_t len, unsigned char* buf, std::function<void(float)> progress)
+{
+	return ReadLooped(m_socket, len, buf, progress);
+}
+
+/**
+	@brief Receives exactly len bytes from a socket straight into the caller's buffer
+
+	Without a progress callback this is a single RecvLooped() call. With one, the read is split into chunks of 1% of
+	the total (but at least RECV_CHUNK_MIN bytes, so there are not thousands of wakeups on small blocks) and progress
+	is reported after each chunk.
+
+	@param sock		Socket to read from
+	@param len		Number of bytes to read
+	@param buf		Output buffer
+	@param progress	Optional progress callback
+
+	@return len on success, 0 on failure
+ */
+size_t SCPISocketTransport::ReadLooped(Socket& sock, size_t len, unsigned char* buf, std::function<void(float)> progress)
 {
 	size_t chunk_size = len;
 	if (progress)
-	{
-		/* carve up the chunk_size into either 1% or 32kB chunks, whichever is larger; later, we'll want RecvLooped to do this for us */
-		chunk_size /= 100;
-		if (chunk_size < 32768)
-			chunk_size = 32768;
-	}
+		chunk_size = max(len / 100, RECV_CHUNK_MIN);
 
 	for (size_t pos = 0; pos < len; )
 	{
 		size_t n = chunk_size;
 		if (n > (len - pos))
 			n = len - pos;
-		if(!m_socket.RecvLooped(buf + pos, n))
+		if(!sock.RecvLooped(buf + pos, n))
 		{
 			LogTrace("Failed to get %zu bytes (@ pos %zu)\n", len, pos);
 			return 0;
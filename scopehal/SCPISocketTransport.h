@@ -85,6 +85,14 @@ public:
 		m_socket.SetRxTimeout(rxUs);
 	}
 
+	static size_t ReadLooped(Socket& sock, size_t len, unsigned char* buf, std::function<void(float)> progress);
+
+	///@brief Requested kernel receive buffer size for instrument sockets
+	static constexpr int RX_BUFFER_SIZE = 32 * 1024 * 1024;
+
+	///@brief Smallest chunk ReadLooped() splits a read into when reporting progress
+	static constexpr size_t RECV_CHUNK_MIN = 256 * 1024;
+
 protected:
 
 	void SharedCtorInit();
@@ -38,6 +38,7 @@ SCPISpectrometer::SpectrometerCreateMapType SCPISpectrometer::m_spectrometercrea
 // Construction / destruction
 
 SCPISpectrometer::SCPISpectrometer()
+	: m_frameAveraging(1)
 {
 	m_serializers.push_back(sigc::mem_fun(*this, &SCPISpectrometer::DoSerializeConfiguration));
 	m_loaders.push_back(sigc::mem_fun(*this, &SCPISpectrometer::DoLoadConfiguration));
@@ -239,12 +240,15 @@ void SCPISpectrometer::SetChannelOffset(size_t i, size_t stream, float offset)
 void SCPISpectrometer::DoSerializeConfiguration(YAML::Node& node, IDTable& /*table*/)
 {
 	node["integration"] = GetIntegrationTime();
+	node["averaging"] = GetFrameAveraging();
 }
 
 void SCPISpectrometer::DoLoadConfiguration(int /*version*/, const YAML::Node& node, IDTable& /*idmap*/)
 {
 	if(node["integration"])
 		SetIntegrationTime(node["integration"].as<int64_t>());
+	if(node["averaging"])
+		SetFrameAveraging(node["averaging"].as<size_t>());
 }
 
 void SCPISpectrometer::DoPreLoadConfiguration(
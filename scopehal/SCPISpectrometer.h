@@ -83,6 +83,19 @@ public:
 	virtual int64_t GetIntegrationTime() =0;
 	virtual void SetIntegrationTime(int64_t t) =0;
 
+	/**
+		@brief Sets the number of frames averaged into each displayed spectrum
+
+		Drivers which stream frames continuously average (and decimate) blocks of this many frames before
+		creating waveforms. Drivers which don't support averaging ignore it.
+	 */
+	void SetFrameAveraging(size_t nframes)
+	{ m_frameAveraging = std::max(nframes, (size_t)1); }
+
+	///@brief Gets the number of frames averaged into each displayed spectrum
+	size_t GetFrameAveraging()
+	{ return m_frameAveraging; }
+
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Configuration storage
@@ -104,6 +117,9 @@ protected:
 	void DoPreLoadConfiguration(int version, const YAML::Node& node, IDTable& idmap, ConfigWarningList& list);
 
 protected:
+	///@brief Number of frames averaged into each displayed spectrum
+	size_t m_frameAveraging;
+
 	std::map<std::pair<size_t, size_t>, float> m_channelVoltageRange;
 	std::map<std::pair<size_t, size_t>, float> m_channelOffset;
 
@@ -39,6 +39,8 @@
 #include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/usb/tmc.h>
 
 #include "scopehal.h"
 
@@ -56,13 +58,13 @@ SCPITMCTransport::SCPITMCTransport(const string& args)
 	, m_data_depleted(false)
 	, m_fix_buggy_driver(false)
 	, m_transfer_size(48)
+	, m_largeReads(false)
 {
 	// TODO: add configuration options:
 	// - set the maximum request size of usbtmc read requests (currently 2032)
-	// - set timeout value (when using kernel that has usbtmc v2 version)
 	// - set size of staging buffer (or get rid of it entirely?)
 
-	// FIXME: currently not used
+	//Only used with usbtmc v2 drivers
 	m_timeout = 1000;
 
 	LogDebug("Connecting to SCPI oscilloscope over USBTMC through %s\n", m_devicePath.c_str());
@@ -91,6 +93,22 @@ SCPITMCTransport::SCPITMCTransport(const string& args)
 		return;
 	}
 
+	//The v2 driver (Linux 4.20 and later) reassembles a whole message from one read() of any size.
+	//Older drivers don't know this ioctl, and the buggy firmware workaround needs the small request path anyway.
+#ifdef USBTMC_IOCTL_API_VERSION
+	unsigned int apiVersion = 0;
+	if( !m_fix_buggy_driver && (ioctl(m_handle, USBTMC_IOCTL_API_VERSION, &apiVersion) == 0) && (apiVersion >= 2) )
+	{
+		m_largeReads = true;
+
+		uint32_t timeout = m_timeout;
+		if(ioctl(m_handle, USBTMC_IOCTL_SET_TIMEOUT, &timeout) != 0)
+			LogWarning("Failed to set USBTMC timeout\n");
+
+		LogDebug("usbtmc driver API version %u, using large reads\n", apiVersion);
+	}
+#endif
+
 	// Right now, I'm using an internal staging buffer because this code has been copied from the lxi transport driver.
 	// It's not strictly needed...
 	m_staging_buf_size = 150000000;
@@ -182,36 +200,10 @@ size_t SCPITMCTransport::ReadRawData(size_t len, unsigned char* buf, std::functi
 	{
 		if (m_data_in_staging_buf == 0)
 		{
-
-#if 0
-			// This is what we'd use if we could be sure that the installed Linux kernel had
-			// usbtmc driver v2.
-			m_data_in_staging_buf = read(m_handle, (char *)m_staging_buf, m_staging_buf_size);
-#else
-			// Split up one potentially large read into a bunch of smaller ones.
-			// The performance impact of this is pretty small.
-			const int max_bytes_per_req = 2032;
-			int i = 0;
-			int bytes_fetched, bytes_requested;
-
-			do
-			{
-				if(m_fix_buggy_driver == false)
-				{
-				    bytes_requested = (max_bytes_per_req < len) ? max_bytes_per_req : len;
-				    bytes_fetched = read(m_handle, (char *)m_staging_buf + i, m_staging_buf_size);
-				}
-				else
-				{
-					// limit each request to m_transfer_size
-					bytes_requested = m_transfer_size;
-				    bytes_fetched = read(m_handle, (char *)m_staging_buf + i, m_transfer_size);
-				}
-				i += bytes_fetched;
-			} while(bytes_fetched == bytes_requested);
-
-			m_data_in_staging_buf = i;
-#endif
+			if(m_largeReads)
+				m_data_in_staging_buf = ReadLarge();
+			else
+				m_data_in_staging_buf = ReadSmall(len);
 
 			if (m_data_in_staging_buf <= 0)
 				m_data_in_staging_buf = 0;
@@ -242,6 +234,67 @@ size_t SCPITMCTransport::ReadRawData(size_t len, unsigned char* buf, std::functi
 	return len;
 }
 
+/**
+	@brief Reads a whole message into the staging buffer with as few read() calls as possible (usbtmc v2 only)
+
+	@return Number of bytes read
+ */
+size_t SCPITMCTransport::ReadLarge()
+{
+	//The driver stops at the end of the message, so a short read means we're done.
+	//Keep going if the message filled the request, in case the driver caps the size of one read.
+	size_t i = 0;
+	while(i < (size_t)m_staging_buf_size)
+	{
+		size_t bytes_requested = m_staging_buf_size - i;
+		ssize_t bytes_fetched = read(m_handle, (char *)m_staging_buf + i, bytes_requested);
+		if(bytes_fetched <= 0)
+			break;
+		i += bytes_fetched;
+		if((size_t)bytes_fetched < bytes_requested)
+			break;
+	}
+	return i;
+}
+
+/**
+	@brief Reads a message into the staging buffer one small request at a time
+
+	This works with the original usbtmc driver, which can't return more than one USB transfer per read(), and with
+	firmware which can't handle requests larger than m_transfer_size.
+
+	@param len	Number of bytes the caller asked for
+
+	@return Number of bytes read
+ */
+size_t SCPITMCTransport::ReadSmall(size_t len)
+{
+	// Split up one potentially large read into a bunch of smaller ones.
+	const size_t max_bytes_per_req = 2032;
+	int i = 0;
+	int bytes_fetched, bytes_requested;
+
+	do
+	{
+		if(m_fix_buggy_driver == false)
+		{
+			bytes_requested = (max_bytes_per_req < len) ? max_bytes_per_req : len;
+			bytes_fetched = read(m_handle, (char *)m_staging_buf + i, m_staging_buf_size);
+		}
+		else
+		{
+			// limit each request to m_transfer_size
+			bytes_requested = m_transfer_size;
+			bytes_fetched = read(m_handle, (char *)m_staging_buf + i, m_transfer_size);
+		}
+		if(bytes_fetched <= 0)
+			break;
+		i += bytes_fetched;
+	} while(bytes_fetched == bytes_requested);
+
+	return i;
+}
+
 bool SCPITMCTransport::IsCommandBatchingSupported()
 {
 	return false;
@@ -81,6 +81,12 @@ protected:
 	bool m_data_depleted;
 	bool m_fix_buggy_driver;
 	int m_transfer_size;
+
+	///@brief True if the kernel driver is usbtmc v2 or later, and can return a whole message from one read()
+	bool m_largeReads;
+
+	size_t ReadLarge();
+	size_t ReadSmall(size_t len);
 };
 
 #endif
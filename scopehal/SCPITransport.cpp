@@ -41,9 +41,13 @@ using namespace std;
 SCPITransport::CreateMapType SCPITransport::m_createprocs;
 
 SCPITransport::SCPITransport()
-	: m_rateLimitingEnabled(false)
+	: m_maxQueriesInFlight(0)
+	, m_rateLimitingEnabled(false)
 	, m_rateLimitingInterval(0)
+	, m_statsLogInterval(0)
 {
+	m_stats.m_startTime = GetTime();
+	m_lastStatsLog = m_stats.m_startTime;
 }
 
 SCPITransport::~SCPITransport()
@@ -150,6 +154,9 @@ void SCPITransport::SendCommandQueued(const string& cmd)
 					it++;
 
 					m_txQueue.erase(oldit);
+
+					lock_guard<mutex> slock(m_statsMutex);
+					m_stats.m_dedupHits ++;
 				}
 
 				//Nope, skip it
@@ -162,6 +169,11 @@ void SCPITransport::SendCommandQueued(const string& cmd)
 
 	m_txQueue.push_back(cmd);
 
+	{
+		lock_guard<mutex> slock(m_statsMutex);
+		m_stats.m_maxQueueDepth = max(m_stats.m_maxQueueDepth, m_txQueue.size());
+	}
+
 	LogTrace("%zu commands now queued\n", m_txQueue.size());
 }
 
@@ -170,8 +182,12 @@ void SCPITransport::SendCommandQueued(const string& cmd)
  */
 void SCPITransport::RateLimitingWait()
 {
+	double start = GetTime();
 	this_thread::sleep_until(m_nextCommandReady);
 	m_nextCommandReady = chrono::system_clock::now() + m_rateLimitingInterval;
+
+	lock_guard<mutex> lock(m_statsMutex);
+	m_stats.m_rateLimitWaitTime += GetTime() - start;
 }
 
 /**
@@ -190,16 +206,96 @@ bool SCPITransport::FlushCommandQueue()
 	if(tmp.size())
 		LogTrace("%zu commands being flushed\n", tmp.size());
 
-	lock_guard<recursive_mutex> lock(m_netMutex);
+	unique_lock<recursive_mutex> lock(m_netMutex, defer_lock);
+	AcquireNetMutexTimed(lock);
 	for(auto str : tmp)
 	{
 		if(m_rateLimitingEnabled)
 			RateLimitingWait();
 		SendCommand(str);
+		RecordCommand(str);
 	}
+
+	MaybeLogStats();
 	return true;
 }
 
+/**
+	@brief Returns the maximum number of pipelined queries which may be awaiting a reply at once
+
+	Unless overridden by SetMaxQueriesInFlight(), transports which support command batching allow 32 and all others
+	allow one (i.e. no pipelining).
+ */
+size_t SCPITransport::GetMaxQueriesInFlight()
+{
+	if(m_maxQueriesInFlight)
+		return m_maxQueriesInFlight;
+	if(IsCommandBatchingSupported())
+		return 32;
+	return 1;
+}
+
+/**
+	@brief Sends a batch of queries (flushing any pending/queued commands first) and returns the replies in order
+
+	This is an atomic operation requiring no mutexing at the caller side.
+
+	@param queries			Queries to send
+	@param endOnSemicolon	Passed to ReadReply() for each reply
+
+	@return Replies, in the same order as the queries
+ */
+vector<string> SCPITransport::SendQueriesPipelined(const vector<string>& queries, bool endOnSemicolon)
+{
+	vector<string> ret(queries.size());
+	SendQueriesPipelined(
+		queries,
+		[&ret](size_t i, const string& reply) { ret[i] = reply; },
+		endOnSemicolon);
+	return ret;
+}
+
+/**
+	@brief Sends a batch of queries (flushing any pending/queued commands first), invoking a callback for each reply
+
+	The callback runs on the calling thread with the transport mutex held, as soon as each reply arrives, so
+	results can be consumed while later queries are still in flight. It must not issue commands of its own.
+
+	@param queries			Queries to send
+	@param callback			Called with the index of the query and its reply
+	@param endOnSemicolon	Passed to ReadReply() for each reply
+ */
+void SCPITransport::SendQueriesPipelined(
+	const vector<string>& queries,
+	function<void(size_t, const string&)> callback,
+	bool endOnSemicolon)
+{
+	unique_lock<recursive_mutex> lock(m_netMutex, defer_lock);
+	AcquireNetMutexTimed(lock);
+	FlushCommandQueue();
+
+	size_t depth = GetMaxQueriesInFlight();
+	size_t nsent = 0;
+	vector<double> sendTimes(queries.size());
+	for(size_t nread = 0; nread < queries.size(); nread++)
+	{
+		//Top up the pipeline
+		while( (nsent < queries.size()) && (nsent - nread < depth) )
+		{
+			if(m_rateLimitingEnabled)
+				RateLimitingWait();
+			sendTimes[nsent] = GetTime();
+			SendCommand(queries[nsent]);
+			RecordCommand(queries[nsent]);
+			nsent ++;
+		}
+
+		auto reply = ReadReply(endOnSemicolon);
+		RecordReply(reply, GetTime() - sendTimes[nread]);
+		callback(nread, reply);
+	}
+}
+
 /**
 	@brief Sends a command (flushing any pending/queued commands first), then returns the response.
 
@@ -218,14 +314,19 @@ string SCPITransport::SendCommandQueuedWithReply(string cmd, bool endOnSemicolon
  */
 string SCPITransport::SendCommandImmediateWithReply(string cmd, bool endOnSemicolon)
 {
-	lock_guard<recursive_mutex> lock(m_netMutex);
+	unique_lock<recursive_mutex> lock(m_netMutex, defer_lock);
+	AcquireNetMutexTimed(lock);
 
 	if(m_rateLimitingEnabled)
 		RateLimitingWait();
 
+	double start = GetTime();
 	SendCommand(cmd);
+	RecordCommand(cmd);
 
-	return ReadReply(endOnSemicolon);
+	auto reply = ReadReply(endOnSemicolon);
+	RecordReply(reply, GetTime() - start);
+	return reply;
 }
 
 /**
@@ -233,12 +334,14 @@ string SCPITransport::SendCommandImmediateWithReply(string cmd, bool endOnSemico
  */
 void SCPITransport::SendCommandImmediate(string cmd)
 {
-	lock_guard<recursive_mutex> lock(m_netMutex);
+	unique_lock<recursive_mutex> lock(m_netMutex, defer_lock);
+	AcquireNetMutexTimed(lock);
 
 	if(m_rateLimitingEnabled)
 		RateLimitingWait();
 
 	SendCommand(cmd);
+	RecordCommand(cmd);
 }
 
 /**
@@ -246,33 +349,312 @@ void SCPITransport::SendCommandImmediate(string cmd)
  */
 void* SCPITransport::SendCommandImmediateWithRawBlockReply(string cmd, size_t& len)
 {
-	lock_guard<recursive_mutex> lock(m_netMutex);
+	unique_lock<recursive_mutex> lock(m_netMutex, defer_lock);
+	AcquireNetMutexTimed(lock);
 
 	if(m_rateLimitingEnabled)
 		RateLimitingWait();
 	SendCommand(cmd);
+	RecordCommand(cmd);
 
-	//Read the length
-	char tmplen[3] = {0};
-	if(2 != ReadRawData(2, (unsigned char*)tmplen))			//expect #n
-		return NULL;
-	if(tmplen[0] == 0)	//Not sure how this happens, but sometimes occurs on Tek MSO6?
-		return NULL;
-	size_t ndigits = stoull(tmplen+1);
-
-	//Read the digits
-	char digits[10] = {0};
-	if(ndigits != ReadRawData(ndigits, (unsigned char*)digits))
+	if(!ReadBinaryBlockHeader(len))
 		return NULL;
-	len = stoull(digits);
 
 	//Read the actual data
 	unsigned char* buf = new unsigned char[len];
-	len = ReadRawData(len, buf);
+	len = ReadBinaryBlockData(len, buf);
+	EndBinaryBlock(false);
 	return buf;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Binary blocks
+
+/**
+	@brief Reads the header of an IEEE 488.2 definite length binary block
+
+	@param len			Length of the block payload, in bytes
+	@param maxPrefix	Maximum number of response header bytes to skip before the '#'
+
+	@return True on success, false if no valid header was found
+ */
+bool SCPITransport::ReadBinaryBlockHeader(size_t& len, size_t maxPrefix)
+{
+	len = 0;
+
+	//Skip anything before the '#'
+	unsigned char c = 0;
+	for(size_t i=0; ; i++)
+	{
+		if(1 != ReadBlockPayload(1, &c, nullptr))
+			return false;
+		if(c == '#')
+			break;
+		if(i >= maxPrefix)
+		{
+			LogError("ReadBinaryBlockHeader: threw away %zu bytes of data and never saw a '#'\n", maxPrefix);
+			return false;
+		}
+	}
+
+	//Number of digits in the length field
+	if(1 != ReadBlockPayload(1, &c, nullptr))
+		return false;
+	if( (c < '1') || (c > '9') )
+	{
+		LogError("ReadBinaryBlockHeader: unsupported or malformed length-of-length '%c'\n", c);
+		return false;
+	}
+	size_t ndigits = c - '0';
+
+	//The length itself
+	char digits[10] = {0};
+	if(ndigits != ReadBlockPayload(ndigits, (unsigned char*)digits, nullptr))
+		return false;
+	for(size_t i=0; i<ndigits; i++)
+	{
+		if( (digits[i] < '0') || (digits[i] > '9') )
+		{
+			LogError("ReadBinaryBlockHeader: malformed length field '%s'\n", digits);
+			return false;
+		}
+		len = len*10 + (digits[i] - '0');
+	}
+
+	return true;
+}
+
+/**
+	@brief Reads payload bytes of a binary block whose header was read by ReadBinaryBlockHeader()
+
+	@param len		Number of bytes to read
+	@param buf		Output buffer
+	@param progress	Optional download progress callback
+
+	@return Number of bytes actually read
+ */
+size_t SCPITransport::ReadBinaryBlockData(size_t len, unsigned char* buf, function<void(float)> progress)
+{
+	SCOPEHAL_TRACE_SPAN("SCPITransport::ReadBinaryBlockData", "transport");
+
+	double start = GetTime();
+	size_t nread = 0;
+	while(nread < len)
+	{
+		auto sub = progress;
+		if(progress)
+			sub = [nread, len, progress](float p) { progress( (nread + p*(len - nread)) / len); };
+
+		size_t n = ReadBlockPayload(len - nread, buf + nread, sub);
+		if(n == 0)
+			break;
+		nread += n;
+	}
+
+	RecordBlockRead(nread, GetTime() - start);
+	return nread;
+}
+
+/**
+	@brief Finishes reading a binary block
+
+	@param readTerminator	True to consume the newline which most instruments send after the block
+ */
+void SCPITransport::EndBinaryBlock(bool readTerminator)
+{
+	if(readTerminator)
+	{
+		unsigned char c;
+		ReadBlockPayload(1, &c, nullptr);
+	}
+}
+
+/**
+	@brief Reads bytes of a binary block reply
+
+	The default implementation is a plain ReadRawData(). Transports which add their own framing to replies
+	override this to strip it.
+ */
+size_t SCPITransport::ReadBlockPayload(size_t len, unsigned char* buf, function<void(float)> progress)
+{
+	return ReadRawData(len, buf, progress);
+}
+
 void SCPITransport::FlushRXBuffer(void)
 {
 	LogError("SCPITransport::FlushRXBuffer is unimplemented\n");
 }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Statistics
+
+/**
+	@brief Gets a snapshot of the statistics collected since the last ResetStats()
+ */
+SCPITransportStats SCPITransport::GetStats()
+{
+	lock_guard<mutex> lock(m_statsMutex);
+	return m_stats;
+}
+
+/**
+	@brief Clears all statistics
+ */
+void SCPITransport::ResetStats()
+{
+	lock_guard<mutex> lock(m_statsMutex);
+	m_stats = SCPITransportStats();
+	m_stats.m_startTime = GetTime();
+}
+
+/**
+	@brief Locks the transport mutex, counting any time spent waiting for another thread to release it
+ */
+void SCPITransport::AcquireNetMutexTimed(unique_lock<recursive_mutex>& lock)
+{
+	if(lock.try_lock())
+		return;
+
+	double start = GetTime();
+	lock.lock();
+
+	lock_guard<mutex> slock(m_statsMutex);
+	m_stats.m_mutexWaitTime += GetTime() - start;
+}
+
+void SCPITransport::RecordCommand(const string& cmd)
+{
+	lock_guard<mutex> lock(m_statsMutex);
+	m_stats.m_commandsSent ++;
+	m_stats.m_bytesOut += cmd.length();
+}
+
+/**
+	@brief Counts a reply
+
+	@param reply	The reply
+	@param latency	Time from sending the query to having its reply, in seconds
+ */
+void SCPITransport::RecordReply(const string& reply, double latency)
+{
+	size_t bin = 0;
+	for(double us = latency * 1e6; (us >= 1) && (bin + 1 < SCPITransportStats::LATENCY_BINS); us /= 2)
+		bin ++;
+
+	lock_guard<mutex> lock(m_statsMutex);
+	m_stats.m_repliesReceived ++;
+	m_stats.m_bytesIn += reply.length();
+	m_stats.m_replyLatencyTotal += latency;
+	m_stats.m_replyLatencyHistogram[bin] ++;
+}
+
+void SCPITransport::RecordBlockRead(size_t len, double time)
+{
+	lock_guard<mutex> lock(m_statsMutex);
+	m_stats.m_bytesIn += len;
+	m_stats.m_blockBytesIn += len;
+	m_stats.m_blockReadTime += time;
+}
+
+/**
+	@brief Logs a statistics summary if logging is enabled and the interval has elapsed since the last one
+ */
+void SCPITransport::MaybeLogStats()
+{
+	if(m_statsLogInterval <= 0)
+		return;
+
+	double now = GetTime();
+	if( (now - m_lastStatsLog) < m_statsLogInterval)
+		return;
+	m_lastStatsLog = now;
+
+	LogDebug("%s %s: %s\n", GetName().c_str(), GetConnectionString().c_str(), GetStats().ToString().c_str());
+}
+
+/**
+	@brief Gets the time over which the statistics were collected, in seconds
+ */
+double SCPITransportStats::GetElapsedTime() const
+{
+	return GetTime() - m_startTime;
+}
+
+/**
+	@brief Gets the average number of commands (including queries) sent per second
+ */
+double SCPITransportStats::GetCommandRate() const
+{
+	double dt = GetElapsedTime();
+	if(dt <= 0)
+		return 0;
+	return m_commandsSent / dt;
+}
+
+/**
+	@brief Gets the average number of text replies read per second
+ */
+double SCPITransportStats::GetReplyRate() const
+{
+	double dt = GetElapsedTime();
+	if(dt <= 0)
+		return 0;
+	return m_repliesReceived / dt;
+}
+
+/**
+	@brief Gets the mean reply latency, in seconds
+ */
+double SCPITransportStats::GetAverageReplyLatency() const
+{
+	if(m_repliesReceived == 0)
+		return 0;
+	return m_replyLatencyTotal / m_repliesReceived;
+}
+
+/**
+	@brief Estimates a reply latency percentile from the histogram
+
+	@param fraction	Fraction of replies, e.g. 0.99 for the 99th percentile
+
+	@return Upper edge of the histogram bin containing the percentile, in seconds
+ */
+double SCPITransportStats::GetReplyLatencyPercentile(double fraction) const
+{
+	uint64_t target = ceil(fraction * m_repliesReceived);
+	uint64_t total = 0;
+	for(size_t i=0; i<LATENCY_BINS; i++)
+	{
+		total += m_replyLatencyHistogram[i];
+		if( (total >= target) && (total > 0) )
+			return pow(2, i) * 1e-6;
+	}
+	return 0;
+}
+
+/**
+	@brief Formats the statistics as a one-line summary
+ */
+string SCPITransportStats::ToString() const
+{
+	double dt = GetElapsedTime();
+	double blockRate = (m_blockReadTime > 0) ? m_blockBytesIn / m_blockReadTime : 0;
+
+	char tmp[512];
+	snprintf(tmp, sizeof(tmp),
+		"%.1f cmd/s, %.1f replies/s, %.1f kB/s out, %.1f kB/s in, latency avg %.3f ms / p50 %.3f ms / p99 %.3f ms, "
+		"blocks %.1f MB/s, mutex wait %.3f s, rate limit wait %.3f s, %" PRIu64 " dedup hits, max queue %zu",
+		GetCommandRate(),
+		GetReplyRate(),
+		(dt > 0) ? m_bytesOut * 1e-3 / dt : 0,
+		(dt > 0) ? m_bytesIn * 1e-3 / dt : 0,
+		GetAverageReplyLatency() * 1e3,
+		GetReplyLatencyPercentile(0.5) * 1e3,
+		GetReplyLatencyPercentile(0.99) * 1e3,
+		blockRate * 1e-6,
+		m_mutexWaitTime,
+		m_rateLimitWaitTime,
+		m_dedupHits,
+		m_maxQueueDepth);
+	return tmp;
+}
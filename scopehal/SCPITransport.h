@@ -39,6 +39,88 @@
 
 #include <chrono>
 
+/**
+	@brief Traffic and timing statistics for one SCPITransport
+	@ingroup transports
+
+	Collected by the SCPITransport helper APIs (queued, immediate, pipelined and binary block), so calls a driver makes
+	directly to SendCommand(), ReadReply() or ReadRawData() are not counted.
+ */
+class SCPITransportStats
+{
+public:
+	SCPITransportStats()
+	: m_startTime(0)
+	, m_commandsSent(0)
+	, m_repliesReceived(0)
+	, m_bytesOut(0)
+	, m_bytesIn(0)
+	, m_blockBytesIn(0)
+	, m_blockReadTime(0)
+	, m_dedupHits(0)
+	, m_maxQueueDepth(0)
+	, m_mutexWaitTime(0)
+	, m_rateLimitWaitTime(0)
+	, m_replyLatencyTotal(0)
+	, m_replyLatencyHistogram{0}
+	{}
+
+	///@brief Number of reply latency histogram bins
+	static const size_t LATENCY_BINS = 24;
+
+	///@brief Time the statistics were last reset, in the GetTime() timebase
+	double m_startTime;
+
+	///@brief Number of commands (including queries) sent
+	uint64_t m_commandsSent;
+
+	///@brief Number of text replies read
+	uint64_t m_repliesReceived;
+
+	///@brief Bytes of command text sent
+	uint64_t m_bytesOut;
+
+	///@brief Bytes of text replies and binary block payload read
+	uint64_t m_bytesIn;
+
+	///@brief Bytes of binary block payload read
+	uint64_t m_blockBytesIn;
+
+	///@brief Time spent reading binary block payload, in seconds
+	double m_blockReadTime;
+
+	///@brief Number of queued commands dropped as duplicates (see SCPITransport::DeduplicateCommand())
+	uint64_t m_dedupHits;
+
+	///@brief Largest number of commands seen waiting in the queue
+	size_t m_maxQueueDepth;
+
+	///@brief Time spent waiting to acquire the transport mutex, in seconds
+	double m_mutexWaitTime;
+
+	///@brief Time spent sleeping for rate limiting, in seconds
+	double m_rateLimitWaitTime;
+
+	///@brief Sum of all reply latencies, in seconds
+	double m_replyLatencyTotal;
+
+	/**
+		@brief Histogram of reply latency (time from sending a query to having its reply)
+
+		Bin 0 counts replies under 1 us, bin i counts replies from 2^(i-1) to 2^i us, and the last bin counts everything
+		slower.
+	 */
+	uint64_t m_replyLatencyHistogram[LATENCY_BINS];
+
+	double GetElapsedTime() const;
+	double GetCommandRate() const;
+	double GetReplyRate() const;
+	double GetAverageReplyLatency() const;
+	double GetReplyLatencyPercentile(double fraction) const;
+
+	std::string ToString() const;
+};
+
 /**
 	@brief Abstraction of a transport layer for moving SCPI data between endpoints
 	@ingroup transports
@@ -69,6 +151,31 @@ public:
 	void* SendCommandImmediateWithRawBlockReply(std::string cmd, size_t& len);
 	bool FlushCommandQueue();
 
+	/*
+		Pipelined query API
+
+		Sends a batch of queries keeping up to GetMaxQueriesInFlight() of them outstanding at once, and matches
+		replies to queries in FIFO order. On high latency links this costs roughly one round trip per batch rather
+		than one per query.
+	 */
+	std::vector<std::string> SendQueriesPipelined(const std::vector<std::string>& queries, bool endOnSemicolon = true);
+	void SendQueriesPipelined(
+		const std::vector<std::string>& queries,
+		std::function<void(size_t, const std::string&)> callback,
+		bool endOnSemicolon = true);
+
+	/**
+		@brief Limits the number of pipelined queries which may be awaiting a reply at once
+
+		Use 1 for instruments which drop or corrupt replies if sent a second query before the first was answered.
+
+		@param depth	Maximum number of outstanding queries (0 to use the default)
+	 */
+	void SetMaxQueriesInFlight(size_t depth)
+	{ m_maxQueriesInFlight = depth; }
+
+	size_t GetMaxQueriesInFlight();
+
 	//Manual mutex locking for ReadRawData() etc
 	std::recursive_mutex& GetMutex()
 	{ return m_netMutex; }
@@ -83,6 +190,93 @@ public:
 	virtual bool IsCommandBatchingSupported() =0;
 	virtual bool IsConnected() =0;
 
+	/**
+		@brief Returns true if the transport can deliver service requests (SRQ) from the instrument out of band
+	 */
+	virtual bool IsServiceRequestSupported()
+	{ return false; }
+
+	/**
+		@brief Blocks until the instrument raises a service request, or a timeout elapses
+
+		Only meaningful if IsServiceRequestSupported() returns true. The default implementation returns immediately.
+
+		@param timeout	Maximum time to block
+
+		@return True if a service request arrived, false on timeout
+	 */
+	virtual bool WaitForServiceRequest([[maybe_unused]] std::chrono::microseconds timeout)
+	{ return false; }
+
+	/**
+		@brief Returns the largest ReadRawData() call a streaming reader should issue
+
+		ReadRawData() blocks until every requested byte has arrived, so a reader consuming an open-ended byte stream
+		(rather than a reply of known length) should not ask for more than the transport typically delivers at once.
+		Readers are expected to adapt downwards from this when data arrives slowly.
+	 */
+	virtual size_t GetStreamingReadSize()
+	{ return 4096; }
+
+	/*
+		IEEE 488.2 definite length binary block API
+
+		Reads "#<n><len><data>" replies straight into caller-provided memory, with no intermediate std::string.
+		Any response header before the '#' (e.g. "C1:WF DAT1,") is skipped.
+
+		Typical use is ReadBinaryBlockHeader(), then one or more ReadBinaryBlockData() calls for exactly the
+		advertised number of bytes, then EndBinaryBlock(). ReadBinaryBlock() does all three into an AcceleratorBuffer.
+	 */
+	bool ReadBinaryBlockHeader(size_t& len, size_t maxPrefix = 32);
+	size_t ReadBinaryBlockData(size_t len, unsigned char* buf, std::function<void(float)> progress = nullptr);
+	virtual void EndBinaryBlock(bool readTerminator = true);
+
+	/**
+		@brief Reads an entire IEEE 488.2 binary block into an AcceleratorBuffer
+
+		If the buffer has a GPU access hint other than HINT_NEVER its CPU side lives in pinned memory, so the result
+		can be bound directly to a conversion shader without a staging copy.
+
+		@param buf				Output buffer, resized to the number of whole elements in the block
+		@param progress			Optional download progress callback
+		@param readTerminator	True to consume the newline following the block
+
+		@return True on success, false if the header was malformed or the block was truncated
+	 */
+	template<class T>
+	bool ReadBinaryBlock(
+		AcceleratorBuffer<T>& buf,
+		std::function<void(float)> progress = nullptr,
+		bool readTerminator = true)
+	{
+		size_t len;
+		if(!ReadBinaryBlockHeader(len))
+			return false;
+
+		size_t count = len / sizeof(T);
+		buf.resize(count);
+		buf.PrepareForCpuAccess();
+
+		size_t nread = 0;
+		if(count)
+			nread = ReadBinaryBlockData(count * sizeof(T), reinterpret_cast<unsigned char*>(buf.GetCpuPointer()), progress);
+
+		//Discard any trailing partial element
+		uint8_t discard;
+		for(size_t i=count * sizeof(T); i<len; i++)
+			ReadBinaryBlockData(1, &discard);
+
+		EndBinaryBlock(readTerminator);
+		buf.MarkModifiedFromCpu();
+
+		if(nread != count * sizeof(T))
+		{
+			buf.resize(nread / sizeof(T));
+			return false;
+		}
+		return true;
+	}
+
 	/**
 		@brief Enables rate limiting. Rate limiting is only applied to the queued command API.
 
@@ -120,6 +314,23 @@ public:
 	void DeduplicateCommand(const std::string& cmd)
 	{ m_dedupCommands.emplace(cmd); }
 
+	/*
+		Statistics API
+
+		Counters are always collected. SetStatsLogInterval() additionally logs a summary (at debug level) no more
+		often than the given interval, checked whenever the command queue is flushed.
+	 */
+	SCPITransportStats GetStats();
+	void ResetStats();
+
+	/**
+		@brief Sets how often to log a statistics summary
+
+		@param seconds	Minimum interval between summaries, or 0 to disable logging
+	 */
+	void SetStatsLogInterval(double seconds)
+	{ m_statsLogInterval = seconds; }
+
 public:
 	typedef SCPITransport* (*CreateProcType)(const std::string& args);
 	static void DoAddTransportClass(std::string name, CreateProcType proc);
@@ -128,7 +339,17 @@ public:
 	static SCPITransport* CreateTransport(const std::string& transport, const std::string& args);
 
 protected:
+	//Needs to call ReadBlockPayload() of the transport it wraps
+	friend class SCPIRecordingTransport;
+
 	void RateLimitingWait();
+	void AcquireNetMutexTimed(std::unique_lock<std::recursive_mutex>& lock);
+	void RecordCommand(const std::string& cmd);
+	void RecordReply(const std::string& reply, double latency);
+	void RecordBlockRead(size_t len, double time);
+	void MaybeLogStats();
+
+	virtual size_t ReadBlockPayload(size_t len, unsigned char* buf, std::function<void(float)> progress);
 
 	//Class enumeration
 	typedef std::map< std::string, CreateProcType > CreateMapType;
@@ -142,10 +363,25 @@ protected:
 	//Set of commands that are OK to deduplicate
 	std::set<std::string> m_dedupCommands;
 
+	///@brief Maximum number of outstanding pipelined queries (0 = default)
+	size_t m_maxQueriesInFlight;
+
 	//Rate limiting (send max of one command per X time)
 	bool m_rateLimitingEnabled;
 	std::chrono::system_clock::time_point m_nextCommandReady;
 	std::chrono::milliseconds m_rateLimitingInterval;
+
+	///@brief Mutex protecting m_stats
+	std::mutex m_statsMutex;
+
+	///@brief Traffic statistics since the last ResetStats()
+	SCPITransportStats m_stats;
+
+	///@brief Minimum interval between logged statistics summaries, in seconds (0 = never)
+	double m_statsLogInterval;
+
+	///@brief Time of the last logged statistics summary
+	double m_lastStatsLog;
 };
 
 #define TRANSPORT_INITPROC(T) \
@@ -36,6 +36,10 @@
 
 #include "scopehal.h"
 
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
 using namespace std;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -68,6 +72,21 @@ SCPITwinLanTransport::SCPITwinLanTransport(const string& args)
 	LogDebug("Connecting to data plane socket\n");
 	m_secondarysocket.Connect(hostname2, m_dataport);
 	m_secondarysocket.DisableNagle();
+	if(!m_secondarysocket.SetRxBuffer(RX_BUFFER_SIZE))
+		LogWarning("Could not set 32 MB RX buffer on data plane socket. Consider increasing /proc/sys/net/core/rmem_max\n");
+
+	//Bridges on the same host may offer a shared memory data plane. The socket stays connected either way since
+	//the bridge uses it to detect the client going away.
+	if(IsLocalHost(hostname2))
+		m_shmRing = SharedMemoryRing::Open(SharedMemoryRing::GetBridgeRingName(m_dataport));
+}
+
+/**
+	@brief Returns true if a hostname refers to the local machine
+ */
+bool SCPITwinLanTransport::IsLocalHost(const string& hostname)
+{
+	return (hostname == "localhost") || (hostname == "::1") || (hostname.find("127.") == 0);
 }
 
 SCPITwinLanTransport::~SCPITwinLanTransport()
@@ -92,12 +111,49 @@ string SCPITwinLanTransport::GetConnectionString()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Secondary socket I/O
 
-size_t SCPITwinLanTransport::ReadRawData(size_t len, unsigned char* buf, std::function<void(float)> /*progress*/)
+size_t SCPITwinLanTransport::ReadRawData(size_t len, unsigned char* buf, std::function<void(float)> progress)
+{
+	if(m_shmRing)
+		return m_shmRing->Read(len, buf, progress, 5000);
+	return ReadLooped(m_secondarysocket, len, buf, progress);
+}
+
+/**
+	@brief Returns the number of waveform data bytes which can be read without blocking
+ */
+size_t SCPITwinLanTransport::GetDataBytesAvailable()
+{
+	if(m_shmRing)
+		return m_shmRing->GetBytesAvailable();
+	return m_secondarysocket.GetRxBytesAvailable();
+}
+
+/**
+	@brief Blocks until waveform data is ready to read, or the timeout expires
+
+	Lets drivers sleep until the bridge pushes a waveform rather than polling GetDataBytesAvailable().
+
+	@return True if data is available
+ */
+bool SCPITwinLanTransport::WaitForDataAvailable(unsigned int timeoutMs)
 {
-	if(m_secondarysocket.RecvLooped(buf, len))
-		return len;
-	else
-		return 0;
+	if(m_shmRing)
+		return m_shmRing->WaitForReadable(timeoutMs);
+
+	ZSOCKET sock = m_secondarysocket;
+#ifdef _WIN32
+	WSAPOLLFD pfd;
+	pfd.fd = sock;
+	pfd.events = POLLRDNORM;
+	pfd.revents = 0;
+	return WSAPoll(&pfd, 1, timeoutMs) > 0;
+#else
+	pollfd pfd;
+	pfd.fd = sock;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	return poll(&pfd, 1, timeoutMs) > 0;
+#endif
 }
 
 void SCPITwinLanTransport::SendRawData(size_t len, const unsigned char* buf)
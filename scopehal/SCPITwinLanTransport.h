@@ -41,6 +41,9 @@
 	@brief A SCPISocketTransport plus a second socket for waveform data
 
 	Read/WriteRawData methods are directed at the secondary stream, rather than the SCPI socket.
+
+	If the instrument is a bridge server on the same host which published a SharedMemoryRing for its data port,
+	waveform data is read from the ring instead of the data socket. The byte stream is identical either way.
  */
 class SCPITwinLanTransport : public SCPISocketTransport
 {
@@ -62,10 +65,22 @@ public:
 	const Socket& GetSecondarySocket()
 	{ return m_secondarysocket; }
 
+	size_t GetDataBytesAvailable();
+	bool WaitForDataAvailable(unsigned int timeoutMs);
+
+	///@brief Returns true if waveform data is coming over shared memory rather than the data socket
+	bool IsUsingSharedMemory()
+	{ return m_shmRing != nullptr; }
+
 protected:
+	static bool IsLocalHost(const std::string& hostname);
+
 	unsigned short m_dataport;
 
 	Socket m_secondarysocket;
+
+	///@brief Local data plane, if the bridge offers one
+	std::unique_ptr<SharedMemoryRing> m_shmRing;
 };
 
 #endif
@@ -167,6 +167,21 @@ size_t SCPIUARTTransport::ReadRawData(size_t len, unsigned char* buf, std::funct
 	return len;
 }
 
+/**
+	@brief Returns the number of bytes which arrive during one USB-serial latency timer period at full line rate
+
+	USB-serial bridges (FTDI, CP210x, etc) hold received bytes until either their buffer fills or the latency timer
+	(16 ms by default) expires, so reading in blocks of about this size avoids a syscall per byte without adding latency.
+ */
+size_t SCPIUARTTransport::GetStreamingReadSize()
+{
+	const size_t latencyMs = 16;
+
+	//8N1 framing: 10 bits per byte
+	size_t bytes = (static_cast<size_t>(m_baudrate) / 10) * latencyMs / 1000;
+	return max(static_cast<size_t>(1), min(bytes, static_cast<size_t>(65536)));
+}
+
 bool SCPIUARTTransport::IsCommandBatchingSupported()
 {
 	return false;
@@ -59,6 +59,7 @@ public:
 
 	virtual bool IsCommandBatchingSupported() override;
 	virtual bool IsConnected() override;
+	virtual size_t GetStreamingReadSize() override;
 
 	TRANSPORT_INITPROC(SCPIUARTTransport)
 
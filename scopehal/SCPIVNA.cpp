@@ -38,6 +38,7 @@ SCPIVNA::VNACreateMapType SCPIVNA::m_vnacreateprocs;
 // Construction / destruction
 
 SCPIVNA::SCPIVNA()
+	: m_partialSweepInterval(0)
 {
 }
 
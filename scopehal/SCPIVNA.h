@@ -79,7 +79,24 @@ public:
 	virtual bool HasFrequencyControls() override;
 	virtual bool HasTimebaseControls() override;
 
+	/**
+		@brief Sets how often to deliver partial sweeps while a slow sweep is in progress
+
+		Drivers for instruments which stream sweep data as it is measured push a snapshot of the points received so
+		far, flagged with WAVEFORM_PARTIAL, at most once per interval. Zero (the default) waits for the full sweep.
+
+		@param interval	Minimum time between partial updates, in seconds
+	 */
+	void SetPartialSweepInterval(double interval)
+	{ m_partialSweepInterval = interval; }
+
+	///@brief Gets the minimum time between partial sweep updates, in seconds (zero if disabled)
+	double GetPartialSweepInterval()
+	{ return m_partialSweepInterval; }
+
 protected:
+	double m_partialSweepInterval;
+
 	std::map<std::pair<size_t, size_t>, float> m_channelVoltageRange;
 	std::map<std::pair<size_t, size_t>, float> m_channelOffset;
 
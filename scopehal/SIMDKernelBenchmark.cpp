@@ -0,0 +1,534 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of SIMDKernelBenchmark
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "SIMDKernelBenchmark.h"
+#include "avx_mathfun.h"
+#include <cinttypes>
+#include <type_traits>
+
+using namespace std;
+
+///@brief Vector whose storage meets the alignment the vector kernels assume
+template<class T>
+using BenchmarkVector = vector<T, AlignedAllocator<T, 64> >;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Math routine wrappers
+
+#ifdef __x86_64__
+
+/**
+	@brief Applies an avx_mathfun routine to a buffer, 8 elements at a time
+
+	The buffer is processed in whole vectors, with the tail padded through a temporary, so every element goes through
+	the vector code path.
+ */
+template<v8sf (*FN)(v8sf)>
+__attribute__((target("avx2")))
+static void ApplyMathFunction(float* pout, const float* pin, size_t count)
+{
+	size_t end = count - (count % 8);
+	for(size_t i=0; i<end; i += 8)
+		_mm256_storeu_ps(pout + i, FN(_mm256_loadu_ps(pin + i)));
+
+	if(end < count)
+	{
+		float tmp[8] = {1, 1, 1, 1, 1, 1, 1, 1};
+		for(size_t i=end; i<count; i++)
+			tmp[i - end] = pin[i];
+		_mm256_storeu_ps(tmp, FN(_mm256_loadu_ps(tmp)));
+		for(size_t i=end; i<count; i++)
+			pout[i] = tmp[i - end];
+	}
+}
+
+#endif /* __x86_64__ */
+
+static double ReferenceLog(double x)
+{ return log(x); }
+
+static double ReferenceExp(double x)
+{ return exp(x); }
+
+static double ReferenceSin(double x)
+{ return sin(x); }
+
+static double ReferenceCos(double x)
+{ return cos(x); }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+SIMDKernelBenchmark::SIMDKernelBenchmark()
+	: m_counts{1, 7, 31, 64, 1000, 65536, 1000000, 16000000}
+	, m_misalignments{0, 1, 3}
+	, m_iterations(5)
+	, m_converterTolerance(2)
+	, m_mathTolerance(2)
+	, m_gpu(true)
+	, m_rng(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Running
+
+/**
+	@brief Benchmarks every kernel
+ */
+void SIMDKernelBenchmark::Run()
+{
+	RunConverters();
+	RunMath();
+}
+
+/**
+	@brief Benchmarks every implementation of the sample converters
+ */
+void SIMDKernelBenchmark::RunConverters()
+{
+#ifdef __x86_64__
+	bool avx2 = g_hasAvx2;
+	bool fma = g_hasAvx2 && g_hasFMA;
+	bool avx512 = g_hasAvx512F;
+#endif
+
+	vector<ConverterVariant<int8_t> > convert8 =
+	{
+		{ "Generic", Oscilloscope::Convert8BitSamplesGeneric, true },
+		{ "Dispatch", Oscilloscope::Convert8BitSamples, true },
+#ifdef __x86_64__
+		{ "AVX2", Oscilloscope::Convert8BitSamplesAVX2, avx2 },
+#endif
+#ifdef __aarch64__
+		{ "NEON", Convert8BitSamplesNEON, true },
+#endif
+	};
+	RunConverter("convert8BitSamples", convert8, true);
+
+	vector<ConverterVariant<uint8_t> > convertUnsigned8 =
+	{
+		{ "Generic", Oscilloscope::ConvertUnsigned8BitSamplesGeneric, true },
+		{ "Dispatch", Oscilloscope::ConvertUnsigned8BitSamples, true },
+#ifdef __x86_64__
+		{ "AVX2", Oscilloscope::ConvertUnsigned8BitSamplesAVX2, avx2 },
+#endif
+#ifdef __aarch64__
+		{ "NEON", ConvertUnsigned8BitSamplesNEON, true },
+#endif
+	};
+	RunConverter("convertUnsigned8BitSamples", convertUnsigned8, false);
+
+	vector<ConverterVariant<int16_t> > convert16 =
+	{
+		{ "Generic", Oscilloscope::Convert16BitSamplesGeneric, true },
+		{ "Dispatch", Oscilloscope::Convert16BitSamples, true },
+#ifdef __x86_64__
+		{ "AVX2", Oscilloscope::Convert16BitSamplesAVX2, avx2 },
+		{ "FMA", Oscilloscope::Convert16BitSamplesFMA, fma },
+		{ "AVX512F", Oscilloscope::Convert16BitSamplesAVX512F, avx512 },
+#endif
+#ifdef __aarch64__
+		{ "NEON", Convert16BitSamplesNEON, true },
+#endif
+	};
+	RunConverter("convert16BitSamples", convert16, true);
+}
+
+/**
+	@brief Benchmarks the avx_mathfun routines against libm
+ */
+void SIMDKernelBenchmark::RunMath()
+{
+#ifdef __x86_64__
+	RunMathFunction("log", ApplyMathFunction<_mm256_log_ps>, ReferenceLog, 1e-3, 1e3, 1);
+	RunMathFunction("exp", ApplyMathFunction<exp256_ps>, ReferenceExp, -80, 80, 0);
+	RunMathFunction("sin", ApplyMathFunction<_mm256_sin_ps>, ReferenceSin, -100, 100, 1);
+	RunMathFunction("cos", ApplyMathFunction<_mm256_cos_ps>, ReferenceCos, -100, 100, 1);
+#else
+	RunMathFunction("log", nullptr, ReferenceLog, 1e-3, 1e3, 1);
+	RunMathFunction("exp", nullptr, ReferenceExp, -80, 80, 0);
+	RunMathFunction("sin", nullptr, ReferenceSin, -100, 100, 1);
+	RunMathFunction("cos", nullptr, ReferenceCos, -100, 100, 1);
+#endif
+}
+
+/**
+	@brief Benchmarks every variant of one converter over every size and alignment
+
+	The first variant is the reference the others are checked against.
+
+	@param kernel	Name of the kernel
+	@param variants	Implementations to run
+	@param gpu		True if there is a GPU shader for this kernel
+ */
+template<class T>
+void SIMDKernelBenchmark::RunConverter(const char* kernel, const vector<ConverterVariant<T> >& variants, bool gpu)
+{
+	const float gain = 0.0123f;
+	const float offset = 0.5f;
+
+	for(auto count : m_counts)
+	{
+		//Every possible code shows up, including both rails
+		uniform_int_distribution<int> dist(numeric_limits<T>::min(), numeric_limits<T>::max());
+		size_t maxMisalignment = 0;
+		for(auto m : m_misalignments)
+			maxMisalignment = max(maxMisalignment, m);
+		BenchmarkVector<T> input(count + maxMisalignment);
+		for(auto& x : input)
+			x = dist(m_rng);
+
+		//Generic output on aligned input, and the magnitude each output's error is measured against
+		vector<float> reference(count);
+		vector<float> magnitude(count);
+		variants[0].m_fn(reference.data(), input.data(), gain, offset, count);
+		for(size_t i=0; i<count; i++)
+			magnitude[i] = max(fabs(gain * input[i]), fabs(offset));
+
+		BenchmarkVector<float> output(count);
+		for(auto misalignment : m_misalignments)
+		{
+			const T* pin = input.data() + misalignment;
+
+			//Inputs are shifted, so the reference has to be recomputed for them
+			vector<float> shiftedReference;
+			vector<float> shiftedMagnitude;
+			const float* ref = reference.data();
+			const float* mag = magnitude.data();
+			if(misalignment != 0)
+			{
+				shiftedReference.resize(count);
+				shiftedMagnitude.resize(count);
+				variants[0].m_fn(shiftedReference.data(), pin, gain, offset, count);
+				for(size_t i=0; i<count; i++)
+					shiftedMagnitude[i] = max(fabs(gain * pin[i]), fabs(offset));
+				ref = shiftedReference.data();
+				mag = shiftedMagnitude.data();
+			}
+
+			for(auto& v : variants)
+			{
+				SIMDKernelBenchmarkResult result;
+				result.m_kernel = kernel;
+				result.m_variant = v.m_name;
+				result.m_count = count;
+				result.m_misalignment = misalignment;
+
+				if(!v.m_supported)
+				{
+					result.m_error = "not supported by this CPU";
+					m_results.push_back(result);
+					continue;
+				}
+
+				result.m_bestTime = FLT_MAX;
+				for(size_t i=0; i<m_iterations; i++)
+				{
+					double start = GetTime();
+					v.m_fn(output.data(), pin, gain, offset, count);
+					result.m_bestTime = min(result.m_bestTime, GetTime() - start);
+				}
+				result.m_iterations = m_iterations;
+				if(result.m_bestTime > 0)
+					result.m_gigabytesPerSecond = count * (sizeof(T) + sizeof(float)) / result.m_bestTime * 1e-9;
+
+				Compare(result, output.data(), ref, mag, m_converterTolerance);
+				m_results.push_back(result);
+			}
+		}
+
+		if(gpu && m_gpu)
+			RunConverterGpu<T>(kernel, vector<T>(input.begin(), input.begin() + count), reference);
+	}
+}
+
+/**
+	@brief Benchmarks the GPU shader for one converter on aligned input
+
+	Timing covers recording, submitting and waiting for the dispatch, with the raw samples already GPU resident.
+ */
+template<class T>
+void SIMDKernelBenchmark::RunConverterGpu(const char* kernel, const vector<T>& input, const vector<float>& reference)
+{
+	const float gain = 0.0123f;
+	const float offset = 0.5f;
+	size_t count = input.size();
+
+	SIMDKernelBenchmarkResult result;
+	result.m_kernel = kernel;
+	result.m_variant = "GPU";
+	result.m_count = count;
+
+	bool available = is_same<T, int16_t>::value ?
+		RawSampleConverter::IsGpuConversionAvailable16Bit() : RawSampleConverter::IsGpuConversionAvailable8Bit();
+	if(!available)
+	{
+		result.m_error = "not supported by this GPU";
+		m_results.push_back(result);
+		return;
+	}
+
+	AcceleratorBuffer<T> raw;
+	raw.SetGpuAccessHint(AcceleratorBuffer<T>::HINT_LIKELY);
+	raw.CopyFrom(input);
+	raw.PrepareForGpuAccess();
+
+	UniformAnalogWaveform cap;
+	cap.Resize(count);
+	RawSampleConverter converter("SIMDKernelBenchmark");
+
+	//RawSampleConverter adds its offset rather than subtracting it
+	auto convert = [&]()
+	{
+		if constexpr(is_same<T, int16_t>::value)
+			converter.Convert16Bit(&cap, raw, gain, -offset);
+		else
+			converter.Convert8Bit(&cap, raw, gain, -offset);
+		converter.WaitIdle();
+	};
+
+	//Untimed run to create pipelines and move the output to the GPU
+	convert();
+
+	result.m_bestTime = FLT_MAX;
+	for(size_t i=0; i<m_iterations; i++)
+	{
+		double start = GetTime();
+		convert();
+		result.m_bestTime = min(result.m_bestTime, GetTime() - start);
+	}
+	result.m_iterations = m_iterations;
+	if(result.m_bestTime > 0)
+		result.m_gigabytesPerSecond = count * (sizeof(T) + sizeof(float)) / result.m_bestTime * 1e-9;
+
+	vector<float> magnitude(count);
+	for(size_t i=0; i<count; i++)
+		magnitude[i] = max(fabs(gain * input[i]), fabs(offset));
+
+	cap.PrepareForCpuAccess();
+	Compare(result, cap.m_samples.GetCpuPointer(), reference.data(), magnitude.data(), m_converterTolerance);
+	m_results.push_back(result);
+}
+
+/**
+	@brief Benchmarks one vectorized math routine against its double precision libm equivalent
+
+	@param kernel			Name of the routine
+	@param fn				Vectorized implementation, or null if not built for this architecture
+	@param reference		Double precision reference
+	@param lo				Lowest input value
+	@param hi				Highest input value
+	@param magnitudeFloor	Smallest magnitude errors are measured against (1 for routines with absolute accuracy
+							near their zeroes, 0 for purely relative error)
+ */
+void SIMDKernelBenchmark::RunMathFunction(
+	const char* kernel,
+	void (*fn)(float*, const float*, size_t),
+	double (*reference)(double),
+	float lo,
+	float hi,
+	float magnitudeFloor)
+{
+	uniform_real_distribution<float> dist(lo, hi);
+
+	for(auto count : m_counts)
+	{
+		size_t maxMisalignment = 0;
+		for(auto m : m_misalignments)
+			maxMisalignment = max(maxMisalignment, m);
+		BenchmarkVector<float> input(count + maxMisalignment);
+		for(auto& x : input)
+			x = dist(m_rng);
+
+		BenchmarkVector<float> output(count);
+		vector<float> ref(count);
+		vector<float> mag(count);
+		for(auto misalignment : m_misalignments)
+		{
+			const float* pin = input.data() + misalignment;
+
+			SIMDKernelBenchmarkResult result;
+			result.m_kernel = kernel;
+			result.m_variant = "AVX2";
+			result.m_count = count;
+			result.m_misalignment = misalignment;
+
+#ifdef __x86_64__
+			bool supported = (fn != nullptr) && g_hasAvx2;
+#else
+			bool supported = (fn != nullptr);
+#endif
+			if(!supported)
+			{
+				result.m_error = "not supported by this CPU";
+				m_results.push_back(result);
+				continue;
+			}
+
+			result.m_bestTime = FLT_MAX;
+			for(size_t i=0; i<m_iterations; i++)
+			{
+				double start = GetTime();
+				fn(output.data(), pin, count);
+				result.m_bestTime = min(result.m_bestTime, GetTime() - start);
+			}
+			result.m_iterations = m_iterations;
+			if(result.m_bestTime > 0)
+				result.m_gigabytesPerSecond = count * 2 * sizeof(float) / result.m_bestTime * 1e-9;
+
+			for(size_t i=0; i<count; i++)
+			{
+				double r = reference(pin[i]);
+				ref[i] = r;
+				mag[i] = max(fabs(r), static_cast<double>(magnitudeFloor));
+			}
+			Compare(result, output.data(), ref.data(), mag.data(), m_mathTolerance);
+			m_results.push_back(result);
+		}
+	}
+}
+
+/**
+	@brief Checks a variant's output against the reference
+
+	@param result		Result to fill in
+	@param out			Output of the variant
+	@param reference	Expected output
+	@param magnitude	Magnitude each element's error is measured in ULPs of
+	@param tolerance	Largest acceptable error, in ULPs
+ */
+void SIMDKernelBenchmark::Compare(
+	SIMDKernelBenchmarkResult& result,
+	const float* out,
+	const float* reference,
+	const float* magnitude,
+	double tolerance)
+{
+	for(size_t i=0; i<result.m_count; i++)
+	{
+		if(memcmp(&out[i], &reference[i], sizeof(float)) == 0)
+			continue;
+		result.m_bitExact = false;
+
+		//Mismatched NaNs or infinities can't be measured in ULPs
+		double error = fabs(static_cast<double>(out[i]) - reference[i]);
+		if(!isfinite(error))
+		{
+			result.m_maxUlpError = INFINITY;
+			result.m_mismatches ++;
+			continue;
+		}
+
+		float m = max(magnitude[i], FLT_MIN);
+		double ulps = error / (nextafterf(m, INFINITY) - m);
+		result.m_maxUlpError = max(result.m_maxUlpError, ulps);
+		if(ulps > tolerance)
+			result.m_mismatches ++;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Output
+
+/**
+	@brief Checks if every variant that could run met its tolerance
+ */
+bool SIMDKernelBenchmark::AllPassed()
+{
+	for(auto& r : m_results)
+	{
+		if(r.m_error.empty() && !r.Passed())
+			return false;
+	}
+	return true;
+}
+
+/**
+	@brief Formats every result so far as a JSON document
+
+	Times are in seconds. Variants which could not run are included, with a non-empty "error".
+ */
+string SIMDKernelBenchmark::ToJSON()
+{
+	string ret = "{\"results\":[";
+	char tmp[1024];
+	for(size_t i=0; i<m_results.size(); i++)
+	{
+		auto& r = m_results[i];
+		snprintf(tmp, sizeof(tmp),
+			"%s\n{\"kernel\":\"%s\",\"variant\":\"%s\",\"count\":%zu,\"misalignment\":%zu,\"iterations\":%zu,"
+			"\"bestTime\":%.6e,\"gigabytesPerSecond\":%.6e,\"maxUlpError\":%.6e,\"mismatches\":%zu,"
+			"\"bitExact\":%s,\"error\":\"%s\"}",
+			(i == 0) ? "" : ",",
+			r.m_kernel.c_str(),
+			r.m_variant.c_str(),
+			r.m_count,
+			r.m_misalignment,
+			r.m_iterations,
+			r.m_bestTime,
+			r.m_gigabytesPerSecond,
+			isfinite(r.m_maxUlpError) ? r.m_maxUlpError : DBL_MAX,
+			r.m_mismatches,
+			r.m_bitExact ? "true" : "false",
+			PerformanceTrace::EscapeJson(r.m_error).c_str());
+		ret += tmp;
+	}
+	ret += "\n]}\n";
+	return ret;
+}
+
+/**
+	@brief Writes ToJSON() to a file
+
+	@return True on success
+ */
+bool SIMDKernelBenchmark::WriteJSON(const string& path)
+{
+	FILE* fp = fopen(path.c_str(), "w");
+	if(!fp)
+	{
+		LogError("Failed to open benchmark results file %s\n", path.c_str());
+		return false;
+	}
+
+	auto json = ToJSON();
+	fwrite(json.c_str(), 1, json.length(), fp);
+
+	bool ok = !ferror(fp);
+	fclose(fp);
+	return ok;
+}
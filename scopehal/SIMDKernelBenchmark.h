@@ -0,0 +1,230 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of SIMDKernelBenchmark
+	@ingroup core
+ */
+
+#ifndef SIMDKernelBenchmark_h
+#define SIMDKernelBenchmark_h
+
+#include <random>
+
+/**
+	@brief Result of benchmarking one implementation of a kernel at one buffer size and alignment
+	@ingroup core
+ */
+class SIMDKernelBenchmarkResult
+{
+public:
+	SIMDKernelBenchmarkResult()
+	: m_count(0)
+	, m_misalignment(0)
+	, m_iterations(0)
+	, m_bestTime(0)
+	, m_gigabytesPerSecond(0)
+	, m_maxUlpError(0)
+	, m_mismatches(0)
+	, m_bitExact(true)
+	{}
+
+	///@brief True if the variant ran and every output was within tolerance of the reference
+	bool Passed() const
+	{ return m_error.empty() && (m_mismatches == 0); }
+
+	///@brief Name of the kernel, e.g. "convert16BitSamples"
+	std::string m_kernel;
+
+	///@brief Name of the implementation, e.g. "Generic", "AVX2" or "GPU"
+	std::string m_variant;
+
+	///@brief Number of elements processed per call
+	size_t m_count;
+
+	/**
+		@brief Offset of the input buffer from 64-byte alignment, in elements
+
+		Outputs are always 64-byte aligned, since the vector kernels use aligned stores.
+	 */
+	size_t m_misalignment;
+
+	///@brief Number of timed calls
+	size_t m_iterations;
+
+	///@brief Fastest call, in seconds
+	double m_bestTime;
+
+	///@brief Input plus output bytes moved per second by the fastest call, in units of 1e9
+	double m_gigabytesPerSecond;
+
+	///@brief Largest difference from the reference, in ULPs of the magnitude of the result
+	double m_maxUlpError;
+
+	///@brief Number of outputs whose error exceeded the tolerance
+	size_t m_mismatches;
+
+	///@brief True if every output was bitwise identical to the reference
+	bool m_bitExact;
+
+	///@brief Reason the variant could not be benchmarked, or empty on success
+	std::string m_error;
+};
+
+/**
+	@brief Runs every implementation of the CPU sample converters and AVX math routines side by side
+
+	Each kernel in SIMDKernelTable is run through every variant built into this binary (Generic, AVX2, FMA and
+	AVX-512F on x86, NEON on AArch64), the multithreaded Oscilloscope::Convert*Samples() front ends, and the GPU
+	conversion shaders via RawSampleConverter. Variants the host CPU or GPU can't run are reported with an error
+	rather than skipped.
+
+	Converter outputs are compared against the Generic implementation and the avx_mathfun routines against double
+	precision libm. Errors are measured in ULPs of the magnitude of the result (for converters, of the larger of the
+	two terms gain*x and offset, since FMA variants legitimately round once instead of twice). This makes the class
+	both a regression suite and the harness for bringing up new kernels: add the variant to the relevant list in
+	SIMDKernelBenchmark.cpp and it is swept over every size and alignment.
+
+	VulkanInit() must already have been called.
+ */
+class SIMDKernelBenchmark
+{
+public:
+	SIMDKernelBenchmark();
+
+	SIMDKernelBenchmark(const SIMDKernelBenchmark&) =delete;
+	SIMDKernelBenchmark& operator=(const SIMDKernelBenchmark&) =delete;
+
+	///@brief Sets the buffer sizes to sweep, in elements
+	void SetCounts(const std::vector<size_t>& counts)
+	{ m_counts = counts; }
+
+	///@brief Sets the input buffer misalignments to sweep, in elements (0 is 64-byte aligned)
+	void SetMisalignments(const std::vector<size_t>& misalignments)
+	{ m_misalignments = misalignments; }
+
+	///@brief Sets the number of timed calls per configuration (the fastest is reported)
+	void SetIterations(size_t n)
+	{ m_iterations = n; }
+
+	///@brief Sets the largest acceptable converter error, in ULPs
+	void SetConverterTolerance(double ulps)
+	{ m_converterTolerance = ulps; }
+
+	///@brief Sets the largest acceptable math routine error, in ULPs
+	void SetMathTolerance(double ulps)
+	{ m_mathTolerance = ulps; }
+
+	///@brief Enables or disables the GPU shader variants
+	void SetGpuEnabled(bool enable)
+	{ m_gpu = enable; }
+
+	void Run();
+	void RunConverters();
+	void RunMath();
+
+	///@brief Gets the results of every configuration run so far
+	const std::vector<SIMDKernelBenchmarkResult>& GetResults()
+	{ return m_results; }
+
+	///@brief Discards all results
+	void ClearResults()
+	{ m_results.clear(); }
+
+	bool AllPassed();
+	std::string ToJSON();
+	bool WriteJSON(const std::string& path);
+
+protected:
+
+	/**
+		@brief One implementation of a sample converter
+	 */
+	template<class T>
+	class ConverterVariant
+	{
+	public:
+		///@brief Name of the implementation
+		const char* m_name;
+
+		///@brief The implementation
+		void (*m_fn)(float* pout, const T* pin, float gain, float offset, size_t count);
+
+		///@brief True if the host CPU can run it
+		bool m_supported;
+	};
+
+	template<class T>
+	void RunConverter(const char* kernel, const std::vector<ConverterVariant<T> >& variants, bool gpu);
+
+	template<class T>
+	void RunConverterGpu(const char* kernel, const std::vector<T>& input, const std::vector<float>& reference);
+
+	void RunMathFunction(
+		const char* kernel,
+		void (*fn)(float*, const float*, size_t),
+		double (*reference)(double),
+		float lo,
+		float hi,
+		float magnitudeFloor);
+
+	void Compare(
+		SIMDKernelBenchmarkResult& result,
+		const float* out,
+		const float* reference,
+		const float* magnitude,
+		double tolerance);
+
+	///@brief Buffer sizes to sweep
+	std::vector<size_t> m_counts;
+
+	///@brief Buffer misalignments to sweep
+	std::vector<size_t> m_misalignments;
+
+	///@brief Timed calls per configuration
+	size_t m_iterations;
+
+	///@brief Largest acceptable converter error, in ULPs
+	double m_converterTolerance;
+
+	///@brief Largest acceptable math routine error, in ULPs
+	double m_mathTolerance;
+
+	///@brief True to benchmark the GPU shaders
+	bool m_gpu;
+
+	///@brief Results so far
+	std::vector<SIMDKernelBenchmarkResult> m_results;
+
+	///@brief Random number generator for test data
+	std::minstd_rand m_rng;
+};
+
+#endif
@@ -0,0 +1,199 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Kernel dispatch table and portable kernel implementations
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "KahanSummation.h"
+
+using namespace std;
+
+///@brief The active kernel table. Starts out with portable implementations until InitializeSIMDKernels() runs
+SIMDKernelTable g_simdKernels =
+{
+	Oscilloscope::Convert8BitSamplesGeneric,
+	Oscilloscope::ConvertUnsigned8BitSamplesGeneric,
+	Oscilloscope::Convert16BitSamplesGeneric,
+	Oscilloscope::Convert16BitSamplesGeneric,
+	GetMinMaxGeneric,
+	FIRFilterGeneric,
+	CRC32Generic,
+	CompensatedSumGeneric,
+	CompensatedSumAbsGeneric,
+	CompensatedSumSquaresGeneric,
+	CompensatedDotProductGeneric
+};
+
+/**
+	@brief Selects the fastest implementation of each kernel for the current CPU
+
+	Must be called after the g_has* CPU feature flags are populated.
+ */
+void InitializeSIMDKernels()
+{
+#ifdef __x86_64__
+	if(g_hasAvx2)
+	{
+		g_simdKernels.convert8BitSamples = Oscilloscope::Convert8BitSamplesAVX2;
+		g_simdKernels.convertUnsigned8BitSamples = Oscilloscope::ConvertUnsigned8BitSamplesAVX2;
+		g_simdKernels.getMinMax = GetMinMaxAVX2;
+		g_simdKernels.sum = CompensatedSumAVX2;
+		g_simdKernels.sumAbs = CompensatedSumAbsAVX2;
+		g_simdKernels.sumSquares = CompensatedSumSquaresAVX2;
+		g_simdKernels.dotProduct = CompensatedDotProductAVX2;
+
+		if(g_hasFMA)
+		{
+			g_simdKernels.convert16BitSamples = Oscilloscope::Convert16BitSamplesFMA;
+			g_simdKernels.firFilter = FIRFilterFMA;
+		}
+		else
+		{
+			g_simdKernels.convert16BitSamples = Oscilloscope::Convert16BitSamplesAVX2;
+			g_simdKernels.firFilter = FIRFilterAVX2;
+		}
+		g_simdKernels.convert16BitSamplesBlocked = g_simdKernels.convert16BitSamples;
+	}
+	if(g_hasAvx512F)
+		g_simdKernels.convert16BitSamplesBlocked = Oscilloscope::Convert16BitSamplesAVX512F;
+	if(g_hasPCLMUL)
+		g_simdKernels.crc32 = CRC32PCLMUL;
+#endif /* __x86_64__ */
+
+#ifdef __aarch64__
+	//NEON is mandatory in ARMv8-A, so no runtime check needed
+	g_simdKernels.convert8BitSamples = Convert8BitSamplesNEON;
+	g_simdKernels.convertUnsigned8BitSamples = ConvertUnsigned8BitSamplesNEON;
+	g_simdKernels.convert16BitSamples = Convert16BitSamplesNEON;
+	g_simdKernels.convert16BitSamplesBlocked = Convert16BitSamplesNEON;
+	g_simdKernels.getMinMax = GetMinMaxNEON;
+	g_simdKernels.firFilter = FIRFilterNEON;
+	g_simdKernels.sum = CompensatedSumNEON;
+	g_simdKernels.sumAbs = CompensatedSumAbsNEON;
+	g_simdKernels.sumSquares = CompensatedSumSquaresNEON;
+	g_simdKernels.dotProduct = CompensatedDotProductNEON;
+
+	//CRC instructions are optional in ARMv8.0, so only use them if the build targets a CPU that has them
+#ifdef __ARM_FEATURE_CRC32
+	g_simdKernels.crc32 = CRC32ARMv8;
+#endif
+#endif /* __aarch64__ */
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Portable implementations
+
+/**
+	@brief Portable backend for SIMDKernelTable::getMinMax
+ */
+void GetMinMaxGeneric(const float* p, size_t count, float& vmin, float& vmax)
+{
+	vmin = FLT_MAX;
+	vmax = FLT_MIN;
+	for(size_t i=0; i<count; i++)
+	{
+		float f = p[i];
+		if(f < vmin)
+			vmin = f;
+		if(f > vmax)
+			vmax = f;
+	}
+}
+
+/**
+	@brief Portable backend for SIMDKernelTable::firFilter
+ */
+void FIRFilterGeneric(const float* pin, float* pout, const float* coeffs, size_t end, size_t filterlen)
+{
+	for(size_t i=0; i<end; i++)
+	{
+		float v = 0;
+		for(size_t j=0; j<filterlen; j++)
+			v += pin[i + j] * coeffs[j];
+
+		pout[i]	= v;
+	}
+}
+
+/**
+	@brief Portable backend for SIMDKernelTable::sum
+ */
+double CompensatedSumGeneric(const float* p, size_t count)
+{
+	float sums[COMPENSATED_SUM_LANES] = {0};
+	float errs[COMPENSATED_SUM_LANES] = {0};
+	for(size_t i=0; i<count; i++)
+		KahanAdd(sums[i % COMPENSATED_SUM_LANES], errs[i % COMPENSATED_SUM_LANES], p[i]);
+	return KahanCombine(sums, errs, COMPENSATED_SUM_LANES);
+}
+
+/**
+	@brief Portable backend for SIMDKernelTable::sumAbs
+ */
+double CompensatedSumAbsGeneric(const float* p, size_t count)
+{
+	float sums[COMPENSATED_SUM_LANES] = {0};
+	float errs[COMPENSATED_SUM_LANES] = {0};
+	for(size_t i=0; i<count; i++)
+		KahanAdd(sums[i % COMPENSATED_SUM_LANES], errs[i % COMPENSATED_SUM_LANES], fabsf(p[i]));
+	return KahanCombine(sums, errs, COMPENSATED_SUM_LANES);
+}
+
+/**
+	@brief Portable backend for SIMDKernelTable::sumSquares
+ */
+double CompensatedSumSquaresGeneric(const float* p, size_t count, float offset)
+{
+	float sums[COMPENSATED_SUM_LANES] = {0};
+	float errs[COMPENSATED_SUM_LANES] = {0};
+	for(size_t i=0; i<count; i++)
+	{
+		float d = p[i] - offset;
+		KahanAdd(sums[i % COMPENSATED_SUM_LANES], errs[i % COMPENSATED_SUM_LANES], d*d);
+	}
+	return KahanCombine(sums, errs, COMPENSATED_SUM_LANES);
+}
+
+/**
+	@brief Portable backend for SIMDKernelTable::dotProduct
+ */
+double CompensatedDotProductGeneric(const float* a, const float* b, size_t count)
+{
+	float sums[COMPENSATED_SUM_LANES] = {0};
+	float errs[COMPENSATED_SUM_LANES] = {0};
+	for(size_t i=0; i<count; i++)
+		KahanAdd(sums[i % COMPENSATED_SUM_LANES], errs[i % COMPENSATED_SUM_LANES], a[i] * b[i]);
+	return KahanCombine(sums, errs, COMPENSATED_SUM_LANES);
+}
@@ -0,0 +1,147 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of SIMDKernelTable and the per-ISA kernel implementations
+	@ingroup core
+ */
+
+#ifndef SIMDKernels_h
+#define SIMDKernels_h
+
+/**
+	@brief Table of CPU-side SIMD kernels, resolved once at startup for the ISA extensions the host supports
+
+	Each entry starts out pointing at the portable implementation, so kernels are safe to call even before
+	InitializeSIMDKernels() runs. DetectCPUFeatures() then replaces them with the fastest variant available
+	(AVX2 / FMA / AVX-512F on x86, NEON on AArch64).
+
+	Per-ISA implementations live in their own translation units (SIMDKernelsAVX2.cpp, SIMDKernelsNEON.cpp) so
+	that adding a new instruction set does not touch the call sites.
+ */
+struct SIMDKernelTable
+{
+	///@brief Converts signed 8-bit ADC codes to fp32: pout[i] = pin[i]*gain - offset
+	void (*convert8BitSamples)(float* pout, const int8_t* pin, float gain, float offset, size_t count);
+
+	///@brief Converts unsigned 8-bit ADC codes to fp32: pout[i] = pin[i]*gain - offset
+	void (*convertUnsigned8BitSamples)(float* pout, const uint8_t* pin, float gain, float offset, size_t count);
+
+	///@brief Converts signed 16-bit ADC codes to fp32: pout[i] = pin[i]*gain - offset
+	void (*convert16BitSamples)(float* pout, const int16_t* pin, float gain, float offset, size_t count);
+
+	/**
+		@brief Same as convert16BitSamples, for large blocks whose start is 64-sample aligned
+
+		May use wider vectors (AVX-512F) that aren't worth the clock penalty for short waveforms.
+	 */
+	void (*convert16BitSamplesBlocked)(float* pout, const int16_t* pin, float gain, float offset, size_t count);
+
+	/**
+		@brief Finds the lowest and highest value in a buffer
+
+		vmin starts at FLT_MAX and vmax at FLT_MIN, matching the historical scalar implementation.
+	 */
+	void (*getMinMax)(const float* p, size_t count, float& vmin, float& vmax);
+
+	/**
+		@brief Non-symmetric FIR filter: pout[i] = sum(pin[i+j] * coeffs[j]) for i in [0, end)
+	 */
+	void (*firFilter)(const float* pin, float* pout, const float* coeffs, size_t end, size_t filterlen);
+
+	/**
+		@brief Feeds a buffer through the Ethernet/PCIe CRC-32 (reflected 0xedb88320) and returns the new register
+
+		No initial value, final inversion or byte swap is applied; see CRC32() for the conventional checksum.
+	 */
+	uint32_t (*crc32)(uint32_t crc, const uint8_t* data, size_t len);
+
+	/**
+		@brief Compensated sum of a buffer
+
+		Keeps COMPENSATED_SUM_LANES independent Kahan sums (sample i goes to lane i % COMPENSATED_SUM_LANES) and
+		combines them in double precision at the end. Every backend uses the same lane assignment, so results only
+		differ between ISAs by FMA contraction.
+	 */
+	double (*sum)(const float* p, size_t count);
+
+	///@brief Compensated sum of absolute values: sum(|p[i]|)
+	double (*sumAbs)(const float* p, size_t count);
+
+	///@brief Compensated sum of squared differences from a constant: sum((p[i] - offset)^2)
+	double (*sumSquares)(const float* p, size_t count, float offset);
+
+	///@brief Compensated dot product: sum(a[i] * b[i])
+	double (*dotProduct)(const float* a, const float* b, size_t count);
+};
+
+///@brief Number of independent accumulators used by the compensated summation kernels
+const size_t COMPENSATED_SUM_LANES = 16;
+
+extern SIMDKernelTable g_simdKernels;
+
+void InitializeSIMDKernels();
+
+void GetMinMaxGeneric(const float* p, size_t count, float& vmin, float& vmax);
+void FIRFilterGeneric(const float* pin, float* pout, const float* coeffs, size_t end, size_t filterlen);
+double CompensatedSumGeneric(const float* p, size_t count);
+double CompensatedSumAbsGeneric(const float* p, size_t count);
+double CompensatedSumSquaresGeneric(const float* p, size_t count, float offset);
+double CompensatedDotProductGeneric(const float* a, const float* b, size_t count);
+
+#ifdef __x86_64__
+void GetMinMaxAVX2(const float* p, size_t count, float& vmin, float& vmax);
+void FIRFilterAVX2(const float* pin, float* pout, const float* coeffs, size_t end, size_t filterlen);
+void FIRFilterFMA(const float* pin, float* pout, const float* coeffs, size_t end, size_t filterlen);
+uint32_t CRC32PCLMUL(uint32_t crc, const uint8_t* data, size_t len);
+double CompensatedSumAVX2(const float* p, size_t count);
+double CompensatedSumAbsAVX2(const float* p, size_t count);
+double CompensatedSumSquaresAVX2(const float* p, size_t count, float offset);
+double CompensatedDotProductAVX2(const float* a, const float* b, size_t count);
+#endif
+
+#ifdef __aarch64__
+void Convert8BitSamplesNEON(float* pout, const int8_t* pin, float gain, float offset, size_t count);
+void ConvertUnsigned8BitSamplesNEON(float* pout, const uint8_t* pin, float gain, float offset, size_t count);
+void Convert16BitSamplesNEON(float* pout, const int16_t* pin, float gain, float offset, size_t count);
+void GetMinMaxNEON(const float* p, size_t count, float& vmin, float& vmax);
+void FIRFilterNEON(const float* pin, float* pout, const float* coeffs, size_t end, size_t filterlen);
+double CompensatedSumNEON(const float* p, size_t count);
+double CompensatedSumAbsNEON(const float* p, size_t count);
+double CompensatedSumSquaresNEON(const float* p, size_t count, float offset);
+double CompensatedDotProductNEON(const float* a, const float* b, size_t count);
+#ifdef __ARM_FEATURE_CRC32
+uint32_t CRC32ARMv8(uint32_t crc, const uint8_t* data, size_t len);
+#endif
+#endif
+
+#endif
@@ -0,0 +1,381 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief AVX2 / FMA / PCLMULQDQ implementations of SIMDKernelTable entries
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "KahanSummation.h"
+
+#ifdef __x86_64__
+
+#include <immintrin.h>
+
+using namespace std;
+
+/**
+	@brief AVX2 backend for SIMDKernelTable::getMinMax
+ */
+__attribute__((target("avx2")))
+void GetMinMaxAVX2(const float* p, size_t count, float& vmin, float& vmax)
+{
+	size_t end = count - (count % 8);
+
+	__m256 vmins = _mm256_set1_ps(FLT_MAX);
+	__m256 vmaxs = _mm256_set1_ps(FLT_MIN);
+	for(size_t i=0; i<end; i+=8)
+	{
+		//Accumulator is the second operand so NaN samples are skipped, same as the scalar compare
+		__m256 v = _mm256_loadu_ps(p + i);
+		vmins = _mm256_min_ps(v, vmins);
+		vmaxs = _mm256_max_ps(v, vmaxs);
+	}
+
+	//Horizontal reduction
+	float mins[8];
+	float maxs[8];
+	_mm256_storeu_ps(mins, vmins);
+	_mm256_storeu_ps(maxs, vmaxs);
+	vmin = mins[0];
+	vmax = maxs[0];
+	for(size_t i=1; i<8; i++)
+	{
+		if(mins[i] < vmin)
+			vmin = mins[i];
+		if(maxs[i] > vmax)
+			vmax = maxs[i];
+	}
+
+	//Get any extras we didn't get in the SIMD loop
+	for(size_t i=end; i<count; i++)
+	{
+		if(p[i] < vmin)
+			vmin = p[i];
+		if(p[i] > vmax)
+			vmax = p[i];
+	}
+}
+
+/**
+	@brief AVX2 backend for SIMDKernelTable::firFilter
+
+	Computes eight outputs per iteration, broadcasting one coefficient at a time.
+ */
+__attribute__((target("avx2")))
+void FIRFilterAVX2(const float* pin, float* pout, const float* coeffs, size_t end, size_t filterlen)
+{
+	size_t end_rounded = end - (end % 8);
+
+	for(size_t i=0; i<end_rounded; i+=8)
+	{
+		__m256 v = _mm256_setzero_ps();
+		for(size_t j=0; j<filterlen; j++)
+		{
+			__m256 coeff = _mm256_set1_ps(coeffs[j]);
+			__m256 samples = _mm256_loadu_ps(pin + i + j);
+			v = _mm256_add_ps(v, _mm256_mul_ps(samples, coeff));
+		}
+		_mm256_storeu_ps(pout + i, v);
+	}
+
+	//Get any extras we didn't get in the SIMD loop
+	FIRFilterGeneric(pin + end_rounded, pout + end_rounded, coeffs, end - end_rounded, filterlen);
+}
+
+/**
+	@brief AVX2 + FMA backend for SIMDKernelTable::firFilter
+ */
+__attribute__((target("avx2,fma")))
+void FIRFilterFMA(const float* pin, float* pout, const float* coeffs, size_t end, size_t filterlen)
+{
+	size_t end_rounded = end - (end % 8);
+
+	for(size_t i=0; i<end_rounded; i+=8)
+	{
+		__m256 v = _mm256_setzero_ps();
+		for(size_t j=0; j<filterlen; j++)
+		{
+			__m256 coeff = _mm256_set1_ps(coeffs[j]);
+			__m256 samples = _mm256_loadu_ps(pin + i + j);
+			v = _mm256_fmadd_ps(samples, coeff, v);
+		}
+		_mm256_storeu_ps(pout + i, v);
+	}
+
+	//Get any extras we didn't get in the SIMD loop
+	FIRFilterGeneric(pin + end_rounded, pout + end_rounded, coeffs, end - end_rounded, filterlen);
+}
+
+/**
+	@brief Carry-less multiply backend for SIMDKernelTable::crc32
+
+	Folds 64 bytes per iteration with PCLMULQDQ, then reduces to 32 bits. Short buffers and the sub-16-byte tail go
+	through the slicing-by-8 table.
+ */
+__attribute__((target("pclmul,sse4.1")))
+uint32_t CRC32PCLMUL(uint32_t crc, const uint8_t* p, size_t len)
+{
+	if(len < 64)
+		return CRC32Generic(crc, p, len);
+
+	//Folding constants for the reflected CRC-32 polynomial (Intel, "Fast CRC Computation for Generic Polynomials
+	//Using PCLMULQDQ Instruction"): k1/k2 fold by 512 bits, k3/k4 by 128, k5 by 64, then Barrett reduction
+	const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+	const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+	const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+	const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+	const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+	__m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x00));
+	__m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x10));
+	__m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x20));
+	__m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+	p += 64;
+	len -= 64;
+
+	//Fold four 128-bit lanes in parallel while we have at least 64 more bytes
+	while(len >= 64)
+	{
+		__m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+		__m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+		__m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+		__m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x30)));
+		p += 64;
+		len -= 64;
+	}
+
+	//Collapse the four lanes into one
+	__m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x2), x5);
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x3), x5);
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x4), x5);
+
+	//Fold any remaining whole 16-byte blocks
+	while(len >= 16)
+	{
+		x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+		p += 16;
+		len -= 16;
+	}
+
+	//Reduce 128 -> 64 -> 32 bits
+	x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, mask32);
+	x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	x2 = _mm_and_si128(x1, mask32);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+	x2 = _mm_and_si128(x2, mask32);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	//Tail is shorter than a block, finish it with the table
+	crc = _mm_extract_epi32(x1, 1);
+	return CRC32Generic(crc, p, len);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Compensated summation
+
+/**
+	@brief Adds a vector of terms to eight Kahan sums
+ */
+__attribute__((target("avx2")))
+static inline void KahanAddAVX2(__m256& sum, __m256& err, __m256 x)
+{
+	__m256 y = _mm256_sub_ps(x, err);
+	__m256 t = _mm256_add_ps(sum, y);
+	err = _mm256_sub_ps(_mm256_sub_ps(t, sum), y);
+	sum = t;
+}
+
+/**
+	@brief Spills the two vector accumulators into per-lane arrays, in the generic kernels' lane order
+ */
+__attribute__((target("avx2")))
+static inline void StoreLanesAVX2(float* sums, float* errs, __m256 s0, __m256 s1, __m256 e0, __m256 e1)
+{
+	_mm256_storeu_ps(sums, s0);
+	_mm256_storeu_ps(sums + 8, s1);
+	_mm256_storeu_ps(errs, e0);
+	_mm256_storeu_ps(errs + 8, e1);
+}
+
+/**
+	@brief AVX2 backend for SIMDKernelTable::sum
+
+	Two independent vector accumulators hide the add latency so the loop runs at load bandwidth.
+ */
+__attribute__((target("avx2")))
+double CompensatedSumAVX2(const float* p, size_t count)
+{
+	size_t end = count - (count % COMPENSATED_SUM_LANES);
+
+	__m256 s0 = _mm256_setzero_ps();
+	__m256 s1 = _mm256_setzero_ps();
+	__m256 e0 = _mm256_setzero_ps();
+	__m256 e1 = _mm256_setzero_ps();
+	for(size_t i=0; i<end; i += 16)
+	{
+		KahanAddAVX2(s0, e0, _mm256_loadu_ps(p + i));
+		KahanAddAVX2(s1, e1, _mm256_loadu_ps(p + i + 8));
+	}
+
+	float sums[COMPENSATED_SUM_LANES];
+	float errs[COMPENSATED_SUM_LANES];
+	StoreLanesAVX2(sums, errs, s0, s1, e0, e1);
+
+	//Get any extras we didn't get in the SIMD loop
+	for(size_t i=end; i<count; i++)
+		KahanAdd(sums[i - end], errs[i - end], p[i]);
+
+	return KahanCombine(sums, errs, COMPENSATED_SUM_LANES);
+}
+
+/**
+	@brief AVX2 backend for SIMDKernelTable::sumAbs
+ */
+__attribute__((target("avx2")))
+double CompensatedSumAbsAVX2(const float* p, size_t count)
+{
+	size_t end = count - (count % COMPENSATED_SUM_LANES);
+
+	//Clear the sign bit
+	__m256 absmask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+	__m256 s0 = _mm256_setzero_ps();
+	__m256 s1 = _mm256_setzero_ps();
+	__m256 e0 = _mm256_setzero_ps();
+	__m256 e1 = _mm256_setzero_ps();
+	for(size_t i=0; i<end; i += 16)
+	{
+		KahanAddAVX2(s0, e0, _mm256_and_ps(_mm256_loadu_ps(p + i), absmask));
+		KahanAddAVX2(s1, e1, _mm256_and_ps(_mm256_loadu_ps(p + i + 8), absmask));
+	}
+
+	float sums[COMPENSATED_SUM_LANES];
+	float errs[COMPENSATED_SUM_LANES];
+	StoreLanesAVX2(sums, errs, s0, s1, e0, e1);
+
+	//Get any extras we didn't get in the SIMD loop
+	for(size_t i=end; i<count; i++)
+		KahanAdd(sums[i - end], errs[i - end], fabsf(p[i]));
+
+	return KahanCombine(sums, errs, COMPENSATED_SUM_LANES);
+}
+
+/**
+	@brief AVX2 backend for SIMDKernelTable::sumSquares
+ */
+__attribute__((target("avx2")))
+double CompensatedSumSquaresAVX2(const float* p, size_t count, float offset)
+{
+	size_t end = count - (count % COMPENSATED_SUM_LANES);
+
+	__m256 offsets = _mm256_set1_ps(offset);
+
+	__m256 s0 = _mm256_setzero_ps();
+	__m256 s1 = _mm256_setzero_ps();
+	__m256 e0 = _mm256_setzero_ps();
+	__m256 e1 = _mm256_setzero_ps();
+	for(size_t i=0; i<end; i += 16)
+	{
+		__m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(p + i), offsets);
+		__m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(p + i + 8), offsets);
+		KahanAddAVX2(s0, e0, _mm256_mul_ps(d0, d0));
+		KahanAddAVX2(s1, e1, _mm256_mul_ps(d1, d1));
+	}
+
+	float sums[COMPENSATED_SUM_LANES];
+	float errs[COMPENSATED_SUM_LANES];
+	StoreLanesAVX2(sums, errs, s0, s1, e0, e1);
+
+	//Get any extras we didn't get in the SIMD loop
+	for(size_t i=end; i<count; i++)
+	{
+		float d = p[i] - offset;
+		KahanAdd(sums[i - end], errs[i - end], d*d);
+	}
+
+	return KahanCombine(sums, errs, COMPENSATED_SUM_LANES);
+}
+
+/**
+	@brief AVX2 backend for SIMDKernelTable::dotProduct
+ */
+__attribute__((target("avx2")))
+double CompensatedDotProductAVX2(const float* a, const float* b, size_t count)
+{
+	size_t end = count - (count % COMPENSATED_SUM_LANES);
+
+	__m256 s0 = _mm256_setzero_ps();
+	__m256 s1 = _mm256_setzero_ps();
+	__m256 e0 = _mm256_setzero_ps();
+	__m256 e1 = _mm256_setzero_ps();
+	for(size_t i=0; i<end; i += 16)
+	{
+		KahanAddAVX2(s0, e0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+		KahanAddAVX2(s1, e1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+	}
+
+	float sums[COMPENSATED_SUM_LANES];
+	float errs[COMPENSATED_SUM_LANES];
+	StoreLanesAVX2(sums, errs, s0, s1, e0, e1);
+
+	//Get any extras we didn't get in the SIMD loop
+	for(size_t i=end; i<count; i++)
+		KahanAdd(sums[i - end], errs[i - end], a[i] * b[i]);
+
+	return KahanCombine(sums, errs, COMPENSATED_SUM_LANES);
+}
+
+#endif /* __x86_64__ */
@@ -0,0 +1,368 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief ARM NEON implementations of SIMDKernelTable entries
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "KahanSummation.h"
+
+#ifdef __aarch64__
+
+#include <arm_neon.h>
+#ifdef __ARM_FEATURE_CRC32
+#include <arm_acle.h>
+#endif
+
+using namespace std;
+
+/**
+	@brief NEON backend for SIMDKernelTable::convert8BitSamples
+ */
+void Convert8BitSamplesNEON(float* pout, const int8_t* pin, float gain, float offset, size_t count)
+{
+	size_t end = count - (count % 16);
+
+	float32x4_t gains = vdupq_n_f32(gain);
+	float32x4_t offsets = vdupq_n_f32(offset);
+
+	for(size_t k=0; k<end; k += 16)
+	{
+		//Load 16 samples and sign extend to 16 then 32 bits
+		int8x16_t raw = vld1q_s8(pin + k);
+		int16x8_t lo16 = vmovl_s8(vget_low_s8(raw));
+		int16x8_t hi16 = vmovl_high_s8(raw);
+
+		float32x4_t f0 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(lo16)));
+		float32x4_t f1 = vcvtq_f32_s32(vmovl_high_s16(lo16));
+		float32x4_t f2 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(hi16)));
+		float32x4_t f3 = vcvtq_f32_s32(vmovl_high_s16(hi16));
+
+		//Separate multiply and subtract (not vfmsq) so results are bit-identical to the generic path
+		vst1q_f32(pout + k,		vsubq_f32(vmulq_f32(f0, gains), offsets));
+		vst1q_f32(pout + k + 4,		vsubq_f32(vmulq_f32(f1, gains), offsets));
+		vst1q_f32(pout + k + 8,		vsubq_f32(vmulq_f32(f2, gains), offsets));
+		vst1q_f32(pout + k + 12,	vsubq_f32(vmulq_f32(f3, gains), offsets));
+	}
+
+	//Get any extras we didn't get in the SIMD loop
+	for(size_t k=end; k<count; k++)
+		pout[k] = pin[k] * gain - offset;
+}
+
+/**
+	@brief NEON backend for SIMDKernelTable::convertUnsigned8BitSamples
+ */
+void ConvertUnsigned8BitSamplesNEON(float* pout, const uint8_t* pin, float gain, float offset, size_t count)
+{
+	size_t end = count - (count % 16);
+
+	float32x4_t gains = vdupq_n_f32(gain);
+	float32x4_t offsets = vdupq_n_f32(offset);
+
+	for(size_t k=0; k<end; k += 16)
+	{
+		//Load 16 samples and zero extend to 16 then 32 bits
+		uint8x16_t raw = vld1q_u8(pin + k);
+		uint16x8_t lo16 = vmovl_u8(vget_low_u8(raw));
+		uint16x8_t hi16 = vmovl_high_u8(raw);
+
+		float32x4_t f0 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo16)));
+		float32x4_t f1 = vcvtq_f32_u32(vmovl_high_u16(lo16));
+		float32x4_t f2 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi16)));
+		float32x4_t f3 = vcvtq_f32_u32(vmovl_high_u16(hi16));
+
+		vst1q_f32(pout + k,		vsubq_f32(vmulq_f32(f0, gains), offsets));
+		vst1q_f32(pout + k + 4,		vsubq_f32(vmulq_f32(f1, gains), offsets));
+		vst1q_f32(pout + k + 8,		vsubq_f32(vmulq_f32(f2, gains), offsets));
+		vst1q_f32(pout + k + 12,	vsubq_f32(vmulq_f32(f3, gains), offsets));
+	}
+
+	//Get any extras we didn't get in the SIMD loop
+	for(size_t k=end; k<count; k++)
+		pout[k] = pin[k] * gain - offset;
+}
+
+/**
+	@brief NEON backend for SIMDKernelTable::convert16BitSamples
+ */
+void Convert16BitSamplesNEON(float* pout, const int16_t* pin, float gain, float offset, size_t count)
+{
+	size_t end = count - (count % 16);
+
+	float32x4_t gains = vdupq_n_f32(gain);
+	float32x4_t offsets = vdupq_n_f32(offset);
+
+	for(size_t k=0; k<end; k += 16)
+	{
+		int16x8_t raw0 = vld1q_s16(pin + k);
+		int16x8_t raw1 = vld1q_s16(pin + k + 8);
+
+		float32x4_t f0 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(raw0)));
+		float32x4_t f1 = vcvtq_f32_s32(vmovl_high_s16(raw0));
+		float32x4_t f2 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(raw1)));
+		float32x4_t f3 = vcvtq_f32_s32(vmovl_high_s16(raw1));
+
+		vst1q_f32(pout + k,		vsubq_f32(vmulq_f32(f0, gains), offsets));
+		vst1q_f32(pout + k + 4,		vsubq_f32(vmulq_f32(f1, gains), offsets));
+		vst1q_f32(pout + k + 8,		vsubq_f32(vmulq_f32(f2, gains), offsets));
+		vst1q_f32(pout + k + 12,	vsubq_f32(vmulq_f32(f3, gains), offsets));
+	}
+
+	//Get any extras we didn't get in the SIMD loop
+	for(size_t k=end; k<count; k++)
+		pout[k] = gain*pin[k] - offset;
+}
+
+/**
+	@brief NEON backend for SIMDKernelTable::getMinMax
+ */
+void GetMinMaxNEON(const float* p, size_t count, float& vmin, float& vmax)
+{
+	size_t end = count - (count % 4);
+
+	float32x4_t vmins = vdupq_n_f32(FLT_MAX);
+	float32x4_t vmaxs = vdupq_n_f32(FLT_MIN);
+	for(size_t i=0; i<end; i+=4)
+	{
+		//vminnm/vmaxnm return the non-NaN operand, so NaN samples are skipped like in the scalar compare
+		float32x4_t v = vld1q_f32(p + i);
+		vmins = vminnmq_f32(vmins, v);
+		vmaxs = vmaxnmq_f32(vmaxs, v);
+	}
+	vmin = vminnmvq_f32(vmins);
+	vmax = vmaxnmvq_f32(vmaxs);
+
+	//Get any extras we didn't get in the SIMD loop
+	for(size_t i=end; i<count; i++)
+	{
+		if(p[i] < vmin)
+			vmin = p[i];
+		if(p[i] > vmax)
+			vmax = p[i];
+	}
+}
+
+/**
+	@brief NEON backend for SIMDKernelTable::firFilter
+
+	Computes eight outputs per iteration, broadcasting one coefficient at a time.
+ */
+void FIRFilterNEON(const float* pin, float* pout, const float* coeffs, size_t end, size_t filterlen)
+{
+	size_t end_rounded = end - (end % 8);
+
+	for(size_t i=0; i<end_rounded; i+=8)
+	{
+		float32x4_t v0 = vdupq_n_f32(0);
+		float32x4_t v1 = vdupq_n_f32(0);
+		for(size_t j=0; j<filterlen; j++)
+		{
+			float32x4_t coeff = vdupq_n_f32(coeffs[j]);
+			v0 = vfmaq_f32(v0, vld1q_f32(pin + i + j), coeff);
+			v1 = vfmaq_f32(v1, vld1q_f32(pin + i + j + 4), coeff);
+		}
+		vst1q_f32(pout + i, v0);
+		vst1q_f32(pout + i + 4, v1);
+	}
+
+	//Get any extras we didn't get in the SIMD loop
+	FIRFilterGeneric(pin + end_rounded, pout + end_rounded, coeffs, end - end_rounded, filterlen);
+}
+
+#ifdef __ARM_FEATURE_CRC32
+/**
+	@brief ARMv8 CRC32 instruction backend for SIMDKernelTable::crc32
+
+	CRC32X/CRC32B implement exactly the reflected Ethernet polynomial without pre/post inversion, so no folding or
+	tables are needed.
+ */
+uint32_t CRC32ARMv8(uint32_t crc, const uint8_t* data, size_t len)
+{
+	while(len >= 8)
+	{
+		uint64_t v;
+		memcpy(&v, data, sizeof(v));
+		crc = __crc32d(crc, v);
+		data += 8;
+		len -= 8;
+	}
+
+	for(size_t i=0; i<len; i++)
+		crc = __crc32b(crc, data[i]);
+	return crc;
+}
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Compensated summation
+
+/**
+	@brief Adds a vector of terms to four Kahan sums
+ */
+static inline void KahanAddNEON(float32x4_t& sum, float32x4_t& err, float32x4_t x)
+{
+	float32x4_t y = vsubq_f32(x, err);
+	float32x4_t t = vaddq_f32(sum, y);
+	err = vsubq_f32(vsubq_f32(t, sum), y);
+	sum = t;
+}
+
+/**
+	@brief Spills the four vector accumulators into per-lane arrays, in the generic kernels' lane order
+ */
+static inline void StoreLanesNEON(float* sums, float* errs, const float32x4_t* s, const float32x4_t* e)
+{
+	for(size_t j=0; j<4; j++)
+	{
+		vst1q_f32(sums + 4*j, s[j]);
+		vst1q_f32(errs + 4*j, e[j]);
+	}
+}
+
+/**
+	@brief NEON backend for SIMDKernelTable::sum
+ */
+double CompensatedSumNEON(const float* p, size_t count)
+{
+	size_t end = count - (count % COMPENSATED_SUM_LANES);
+
+	float32x4_t s[4] = {vdupq_n_f32(0), vdupq_n_f32(0), vdupq_n_f32(0), vdupq_n_f32(0)};
+	float32x4_t e[4] = {vdupq_n_f32(0), vdupq_n_f32(0), vdupq_n_f32(0), vdupq_n_f32(0)};
+	for(size_t i=0; i<end; i += 16)
+	{
+		for(size_t j=0; j<4; j++)
+			KahanAddNEON(s[j], e[j], vld1q_f32(p + i + 4*j));
+	}
+
+	float sums[COMPENSATED_SUM_LANES];
+	float errs[COMPENSATED_SUM_LANES];
+	StoreLanesNEON(sums, errs, s, e);
+
+	//Get any extras we didn't get in the SIMD loop
+	for(size_t i=end; i<count; i++)
+		KahanAdd(sums[i - end], errs[i - end], p[i]);
+
+	return KahanCombine(sums, errs, COMPENSATED_SUM_LANES);
+}
+
+/**
+	@brief NEON backend for SIMDKernelTable::sumAbs
+ */
+double CompensatedSumAbsNEON(const float* p, size_t count)
+{
+	size_t end = count - (count % COMPENSATED_SUM_LANES);
+
+	float32x4_t s[4] = {vdupq_n_f32(0), vdupq_n_f32(0), vdupq_n_f32(0), vdupq_n_f32(0)};
+	float32x4_t e[4] = {vdupq_n_f32(0), vdupq_n_f32(0), vdupq_n_f32(0), vdupq_n_f32(0)};
+	for(size_t i=0; i<end; i += 16)
+	{
+		for(size_t j=0; j<4; j++)
+			KahanAddNEON(s[j], e[j], vabsq_f32(vld1q_f32(p + i + 4*j)));
+	}
+
+	float sums[COMPENSATED_SUM_LANES];
+	float errs[COMPENSATED_SUM_LANES];
+	StoreLanesNEON(sums, errs, s, e);
+
+	//Get any extras we didn't get in the SIMD loop
+	for(size_t i=end; i<count; i++)
+		KahanAdd(sums[i - end], errs[i - end], fabsf(p[i]));
+
+	return KahanCombine(sums, errs, COMPENSATED_SUM_LANES);
+}
+
+/**
+	@brief NEON backend for SIMDKernelTable::sumSquares
+ */
+double CompensatedSumSquaresNEON(const float* p, size_t count, float offset)
+{
+	size_t end = count - (count % COMPENSATED_SUM_LANES);
+
+	float32x4_t offsets = vdupq_n_f32(offset);
+
+	float32x4_t s[4] = {vdupq_n_f32(0), vdupq_n_f32(0), vdupq_n_f32(0), vdupq_n_f32(0)};
+	float32x4_t e[4] = {vdupq_n_f32(0), vdupq_n_f32(0), vdupq_n_f32(0), vdupq_n_f32(0)};
+	for(size_t i=0; i<end; i += 16)
+	{
+		for(size_t j=0; j<4; j++)
+		{
+			//Separate multiply and add (not vfmaq) so the rounding matches the generic path
+			float32x4_t d = vsubq_f32(vld1q_f32(p + i + 4*j), offsets);
+			KahanAddNEON(s[j], e[j], vmulq_f32(d, d));
+		}
+	}
+
+	float sums[COMPENSATED_SUM_LANES];
+	float errs[COMPENSATED_SUM_LANES];
+	StoreLanesNEON(sums, errs, s, e);
+
+	//Get any extras we didn't get in the SIMD loop
+	for(size_t i=end; i<count; i++)
+	{
+		float d = p[i] - offset;
+		KahanAdd(sums[i - end], errs[i - end], d*d);
+	}
+
+	return KahanCombine(sums, errs, COMPENSATED_SUM_LANES);
+}
+
+/**
+	@brief NEON backend for SIMDKernelTable::dotProduct
+ */
+double CompensatedDotProductNEON(const float* a, const float* b, size_t count)
+{
+	size_t end = count - (count % COMPENSATED_SUM_LANES);
+
+	float32x4_t s[4] = {vdupq_n_f32(0), vdupq_n_f32(0), vdupq_n_f32(0), vdupq_n_f32(0)};
+	float32x4_t e[4] = {vdupq_n_f32(0), vdupq_n_f32(0), vdupq_n_f32(0), vdupq_n_f32(0)};
+	for(size_t i=0; i<end; i += 16)
+	{
+		for(size_t j=0; j<4; j++)
+			KahanAddNEON(s[j], e[j], vmulq_f32(vld1q_f32(a + i + 4*j), vld1q_f32(b + i + 4*j)));
+	}
+
+	float sums[COMPENSATED_SUM_LANES];
+	float errs[COMPENSATED_SUM_LANES];
+	StoreLanesNEON(sums, errs, s, e);
+
+	//Get any extras we didn't get in the SIMD loop
+	for(size_t i=end; i<count; i++)
+		KahanAdd(sums[i - end], errs[i - end], a[i] * b[i]);
+
+	return KahanCombine(sums, errs, COMPENSATED_SUM_LANES);
+}
+
+#endif /* __aarch64__ */
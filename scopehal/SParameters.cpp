@@ -209,12 +209,13 @@ float SParameterVector::GetGroupDelay(size_t bin) const
 		return 0;
 
 	auto a = m_points[bin];
-	auto b = m_points[bin+1+1];
+	auto b = m_points[bin+1];
 
 	//frequency is in Hz, not rad/sec, so we need to convert
 	float dfreq = (b.m_frequency - a.m_frequency) * 2*M_PI;
 
-	return (a.m_phase - b.m_phase) / dfreq;
+	//Phases are wrapped to +/- pi so unwrap the step between them
+	return -WrappedPhaseDelta(a.m_phase, b.m_phase, 2*M_PI) / dfreq;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,101 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of SegmentedCapture
+	@ingroup datamodel
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Wraps a downloaded block of equally sized segments
+
+	@param block		Raw ADC codes for every segment, back to back
+	@param bits			Bits per ADC code (8 or 16)
+	@param numSegments	Number of segments
+	@param numSamples	Total number of samples in the block. Any remainder after dividing it evenly among the
+						segments is ignored, as with the original per-segment copies.
+ */
+SegmentedCapture::SegmentedCapture(
+	shared_ptr<AcceleratorBuffer<int8_t> > block,
+	int bits,
+	size_t numSegments,
+	size_t numSamples)
+	: m_block(block)
+	, m_bits(bits)
+{
+	size_t perSegment = numSegments ? (numSamples / numSegments) : 0;
+	m_segmentStarts.resize(numSegments + 1);
+	for(size_t i=0; i<=numSegments; i++)
+		m_segmentStarts[i] = i * perSegment;
+}
+
+/**
+	@brief Allocates a block suitable for downloading a segmented capture into
+
+	@param bytes	Size of the block
+ */
+shared_ptr<AcceleratorBuffer<int8_t> > SegmentedCapture::AllocateBlock(size_t bytes)
+{
+	//Recycled through the staging pool once the last segment waveform referring to it goes away
+	return StagingBufferPool::Borrow<int8_t>(bytes, "SegmentedCapture.m_block");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+/**
+	@brief Makes a waveform refer to the samples of one segment
+
+	Only the sample data is set up, the driver is responsible for timestamps and timebase.
+
+	@param cap		The waveform
+	@param segment	Index of the segment
+	@param gain		Volts per code
+	@param offset	Offset added after scaling
+ */
+void SegmentedCapture::AttachSegment(UniformAnalogWaveform* cap, size_t segment, float gain, float offset) const
+{
+	size_t bytesPerSample = m_bits / 8;
+	cap->SetRawSampleView(
+		m_block,
+		GetSegmentStart(segment) * bytesPerSample,
+		GetSegmentLength(segment),
+		m_bits,
+		gain,
+		offset);
+}
@@ -0,0 +1,97 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of SegmentedCapture
+	@ingroup datamodel
+ */
+
+#ifndef SegmentedCapture_h
+#define SegmentedCapture_h
+
+/**
+	@brief One channel's worth of a segmented (sequence / history / fast frame) capture, downloaded as a single block
+	@ingroup datamodel
+
+	Instruments in segmented mode return every segment of a channel back to back in one transfer. Rather than copying
+	each segment out into a waveform of its own, the driver downloads straight into the block returned by
+	AllocateBlock(), wraps it in a SegmentedCapture, and calls AttachSegment() to make each segment's waveform a view
+	of its slice of the block (see RawAnalogSamples::SetView()). Nothing is copied or converted to volts until a
+	consumer actually needs the samples of a given segment, and the block is freed once every segment is done with it.
+
+	The resulting per-segment waveforms can be handed to Filter::EvaluateScalarBatch() as is.
+ */
+class SegmentedCapture
+{
+public:
+	SegmentedCapture(
+		std::shared_ptr<AcceleratorBuffer<int8_t> > block,
+		int bits,
+		size_t numSegments,
+		size_t numSamples);
+
+	static std::shared_ptr<AcceleratorBuffer<int8_t> > AllocateBlock(size_t bytes);
+
+	void AttachSegment(UniformAnalogWaveform* cap, size_t segment, float gain, float offset) const;
+
+	///@brief Gets the number of segments
+	size_t GetSegmentCount() const
+	{ return m_segmentStarts.size() - 1; }
+
+	///@brief Gets the index of the first sample of a segment within the block
+	size_t GetSegmentStart(size_t segment) const
+	{ return m_segmentStarts[segment]; }
+
+	///@brief Gets the number of samples in a segment
+	size_t GetSegmentLength(size_t segment) const
+	{ return m_segmentStarts[segment+1] - m_segmentStarts[segment]; }
+
+	///@brief Gets the number of bits per ADC code
+	int GetBitsPerSample() const
+	{ return m_bits; }
+
+	///@brief Gets the backing block
+	std::shared_ptr<AcceleratorBuffer<int8_t> > GetBlock() const
+	{ return m_block; }
+
+protected:
+
+	///@brief The raw codes of every segment, back to back
+	std::shared_ptr<AcceleratorBuffer<int8_t> > m_block;
+
+	///@brief Bits per ADC code (8 or 16)
+	int m_bits;
+
+	///@brief Index of the first sample in each segment, plus one past the end of the last segment
+	std::vector<size_t> m_segmentStarts;
+};
+
+#endif
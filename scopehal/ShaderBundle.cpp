@@ -0,0 +1,181 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of ShaderBundle
+	@ingroup vksupport
+ */
+
+#include "scopehal.h"
+#include "ShaderBundle.h"
+
+using namespace std;
+
+/**
+	@brief Gets the table of registered shaders, indexed by file name
+
+	This is a function local static since blobs are registered from static initializers in other translation units
+	(and other libraries), which may run before ours.
+ */
+map<string, ShaderBundle::Shader>& ShaderBundle::GetShaders()
+{
+	static map<string, Shader> shaders;
+	return shaders;
+}
+
+///@brief Gets the mutex protecting the shader table
+mutex& ShaderBundle::GetMutex()
+{
+	static mutex m;
+	return m;
+}
+
+/**
+	@brief Adds the shaders in an embedded blob to the bundle
+
+	If two blobs contain a shader of the same name, the one registered last wins.
+
+	@param entries	Index of the blob
+	@param count	Number of elements in entries
+	@param blob		The blob itself
+ */
+void ShaderBundle::Register(const Entry* entries, size_t count, const uint32_t* blob)
+{
+	lock_guard<mutex> lock(GetMutex());
+	auto& shaders = GetShaders();
+	for(size_t i=0; i<count; i++)
+	{
+		auto& s = shaders[entries[i].m_name];
+		s.m_code = blob + entries[i].m_offset;
+		s.m_words = entries[i].m_words;
+		s.m_hash = entries[i].m_hash;
+		s.m_module = nullptr;
+	}
+}
+
+/**
+	@brief Looks up an embedded shader
+
+	@param path		Path of the shader, as passed to ComputePipeline (only the file name is used)
+	@param code		Set to the first word of the SPIR-V binary
+	@param words	Set to the size of the binary, in 32-bit words
+	@param hash		Set to the content hash of the binary
+
+	@return True if the shader was found
+ */
+bool ShaderBundle::Lookup(const string& path, const uint32_t*& code, size_t& words, uint64_t& hash)
+{
+	lock_guard<mutex> lock(GetMutex());
+	auto& shaders = GetShaders();
+	auto it = shaders.find(BaseName(path));
+	if(it == shaders.end())
+		return false;
+
+	code = it->second.m_code;
+	words = it->second.m_words;
+	hash = it->second.m_hash;
+	return true;
+}
+
+/**
+	@brief Gets the shader module for an embedded shader, creating it if this is the first request
+
+	@param path		Path of the shader, as passed to ComputePipeline (only the file name is used)
+
+	@return The module, or null if the shader is not embedded
+ */
+shared_ptr<vk::raii::ShaderModule> ShaderBundle::GetModule(const string& path)
+{
+	lock_guard<mutex> lock(GetMutex());
+	auto& shaders = GetShaders();
+	auto it = shaders.find(BaseName(path));
+	if(it == shaders.end())
+		return nullptr;
+
+	return CreateModule(it->second);
+}
+
+/**
+	@brief Creates the module for a shader if it doesn't already exist
+
+	The caller must hold the mutex.
+ */
+shared_ptr<vk::raii::ShaderModule> ShaderBundle::CreateModule(Shader& shader)
+{
+	if(!shader.m_module)
+	{
+		vk::ShaderModuleCreateInfo info({}, shader.m_words * sizeof(uint32_t), shader.m_code);
+		shader.m_module = make_shared<vk::raii::ShaderModule>(*g_vkComputeDevice, info);
+	}
+	return shader.m_module;
+}
+
+/**
+	@brief Creates a shader module for every embedded shader which doesn't have one yet
+
+	Must be called after the Vulkan device is created.
+
+	@return Number of modules created
+ */
+size_t ShaderBundle::CreateAllModules()
+{
+	lock_guard<mutex> lock(GetMutex());
+
+	size_t n = 0;
+	for(auto& it : GetShaders())
+	{
+		if(it.second.m_module)
+			continue;
+
+		CreateModule(it.second);
+		n++;
+	}
+	return n;
+}
+
+/**
+	@brief Releases our references to all shader modules
+
+	Must be called before the Vulkan device is destroyed. Pipelines still using a module keep it alive.
+ */
+void ShaderBundle::DestroyModules()
+{
+	lock_guard<mutex> lock(GetMutex());
+	for(auto& it : GetShaders())
+		it.second.m_module = nullptr;
+}
+
+///@brief Gets the number of embedded shaders
+size_t ShaderBundle::GetShaderCount()
+{
+	lock_guard<mutex> lock(GetMutex());
+	return GetShaders().size();
+}
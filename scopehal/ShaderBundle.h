@@ -0,0 +1,129 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of ShaderBundle
+	@ingroup vksupport
+ */
+
+#ifndef ShaderBundle_h
+#define ShaderBundle_h
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+	@brief Compiled SPIR-V shaders linked into the libraries, so pipelines don't have to be loaded from disk
+
+	At build time, every compiled shader of a library is concatenated into one array of words, along with an index
+	of the name, location and a content hash of each one (see shaders/EmbedShaders.cmake). The generated source file
+	registers its index with the bundle when the library is loaded.
+
+	ComputePipeline looks shaders up here before falling back to searching the data directories, which costs a
+	path search, a stat and a file read per shader (painful on network home directories). The content hash is used
+	as the pipeline cache version, so the cache stays valid for exactly as long as the shader is unchanged.
+
+	Shader modules created from bundled shaders are shared by every pipeline using them, and may all be created up
+	front by CreateAllModules().
+
+	@ingroup vksupport
+ */
+class ShaderBundle
+{
+public:
+
+	/**
+		@brief Location of one shader within an embedded blob
+	 */
+	class Entry
+	{
+	public:
+		///@brief File name of the shader, without any directory (e.g. "MinMax.spv")
+		const char* m_name;
+
+		///@brief Offset of the first word of the shader within the blob
+		size_t m_offset;
+
+		///@brief Size of the shader, in 32-bit words
+		size_t m_words;
+
+		///@brief Content hash of the shader binary
+		uint64_t m_hash;
+	};
+
+	/**
+		@brief Registers a blob with the bundle from a static initializer in the generated source file
+	 */
+	class Registrar
+	{
+	public:
+		Registrar(const Entry* entries, size_t count, const uint32_t* blob)
+		{ ShaderBundle::Register(entries, count, blob); }
+	};
+
+	static void Register(const Entry* entries, size_t count, const uint32_t* blob);
+	static bool Lookup(const std::string& path, const uint32_t*& code, size_t& words, uint64_t& hash);
+	static std::shared_ptr<vk::raii::ShaderModule> GetModule(const std::string& path);
+
+	static size_t CreateAllModules();
+	static void DestroyModules();
+	static size_t GetShaderCount();
+
+protected:
+
+	/**
+		@brief A single embedded shader
+	 */
+	class Shader
+	{
+	public:
+		///@brief First word of the SPIR-V binary
+		const uint32_t* m_code;
+
+		///@brief Size of the binary, in 32-bit words
+		size_t m_words;
+
+		///@brief Content hash of the binary
+		uint64_t m_hash;
+
+		///@brief Shader module created from the binary, if any
+		std::shared_ptr<vk::raii::ShaderModule> m_module;
+	};
+
+	static std::shared_ptr<vk::raii::ShaderModule> CreateModule(Shader& shader);
+
+	static std::map<std::string, Shader>& GetShaders();
+	static std::mutex& GetMutex();
+};
+
+#endif
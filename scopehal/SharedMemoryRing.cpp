@@ -0,0 +1,274 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of SharedMemoryRing
+	@ingroup transports
+ */
+
+#include "scopehal.h"
+#include "SharedMemoryRing.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+SharedMemoryRing::SharedMemoryRing()
+	: m_fd(-1)
+	, m_mapping(nullptr)
+	, m_mappingSize(0)
+	, m_header(nullptr)
+	, m_data(nullptr)
+{
+}
+
+SharedMemoryRing::~SharedMemoryRing()
+{
+#ifndef _WIN32
+	if(m_mapping)
+		munmap(m_mapping, m_mappingSize);
+	if(m_fd >= 0)
+		close(m_fd);
+#endif
+}
+
+/**
+	@brief Returns the name of the ring a bridge server listening on the given data port would create
+ */
+string SharedMemoryRing::GetBridgeRingName(unsigned short dataport)
+{
+	return string("/scopehal-bridge-") + to_string(dataport);
+}
+
+/**
+	@brief Attaches to an existing ring created by a producer
+
+	@param name	POSIX shared memory object name
+
+	@return The ring, or nullptr if it doesn't exist or isn't a compatible ring
+ */
+unique_ptr<SharedMemoryRing> SharedMemoryRing::Open(const string& name)
+{
+#ifdef _WIN32
+	(void)name;
+	return nullptr;
+#else
+	int fd = shm_open(name.c_str(), O_RDWR, 0);
+	if(fd < 0)
+		return nullptr;
+
+	unique_ptr<SharedMemoryRing> ring(new SharedMemoryRing);
+	ring->m_fd = fd;
+
+	struct stat st;
+	if( (fstat(fd, &st) != 0) || (static_cast<size_t>(st.st_size) < sizeof(SharedMemoryRingHeader)) )
+		return nullptr;
+	ring->m_mappingSize = st.st_size;
+
+	ring->m_mapping = mmap(nullptr, ring->m_mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if(ring->m_mapping == MAP_FAILED)
+	{
+		ring->m_mapping = nullptr;
+		return nullptr;
+	}
+
+	//Validate the header
+	ring->m_header = reinterpret_cast<SharedMemoryRingHeader*>(ring->m_mapping);
+	auto cap = ring->m_header->m_capacity;
+	if( (ring->m_header->m_magic != MAGIC) || (ring->m_header->m_version != VERSION) )
+	{
+		LogWarning("Shared memory object %s is not a compatible ring\n", name.c_str());
+		return nullptr;
+	}
+	if( (cap == 0) || (cap & (cap-1)) || (cap > ring->m_mappingSize - sizeof(SharedMemoryRingHeader)) )
+	{
+		LogWarning("Shared memory ring %s has invalid capacity %" PRIu64 "\n", name.c_str(), cap);
+		return nullptr;
+	}
+	if(ring->m_header->m_closed.load())
+		return nullptr;
+
+	ring->m_data = reinterpret_cast<uint8_t*>(ring->m_mapping) + sizeof(SharedMemoryRingHeader);
+
+	LogDebug("Attached to shared memory ring %s (%" PRIu64 " kB)\n", name.c_str(), cap / 1024);
+	return ring;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Data transfer
+
+/**
+	@brief Returns the number of bytes which can be read without blocking
+ */
+size_t SharedMemoryRing::GetBytesAvailable()
+{
+	return m_header->m_writePos.load(memory_order_acquire) - m_header->m_readPos.load(memory_order_relaxed);
+}
+
+/**
+	@brief Blocks until there is data to read, the producer closes the ring, or the timeout expires
+
+	@return True if data is available
+ */
+bool SharedMemoryRing::WaitForReadable(unsigned int timeoutMs)
+{
+	//Sample the sequence number before checking, same as Read()
+	uint32_t seq = m_header->m_writeSeq.load(memory_order_acquire);
+	if(GetBytesAvailable() != 0)
+		return true;
+	if(m_header->m_closed.load())
+		return false;
+
+	WaitForData(seq, timeoutMs);
+	return GetBytesAvailable() != 0;
+}
+
+/**
+	@brief Reads exactly len bytes from the ring, blocking as needed
+
+	@param len			Number of bytes to read
+	@param buf			Output buffer
+	@param progress		Optional progress callback
+	@param timeoutMs	Maximum time to wait for the producer without any new data arriving
+
+	@return len on success, 0 on timeout or if the producer closed the ring
+ */
+size_t SharedMemoryRing::Read(size_t len, unsigned char* buf, function<void(float)> progress, unsigned int timeoutMs)
+{
+	uint64_t mask = m_header->m_capacity - 1;
+	uint64_t rpos = m_header->m_readPos.load(memory_order_relaxed);
+
+	size_t done = 0;
+	while(done < len)
+	{
+		//Sample the sequence number before the position so a write between the two can't be missed
+		uint32_t seq = m_header->m_writeSeq.load(memory_order_acquire);
+		uint64_t wpos = m_header->m_writePos.load(memory_order_acquire);
+
+		if(wpos == rpos)
+		{
+			if(m_header->m_closed.load())
+				return 0;
+			if(!WaitForData(seq, timeoutMs))
+			{
+				LogTrace("Timed out waiting for shared memory ring data (@ pos %zu of %zu)\n", done, len);
+				return 0;
+			}
+			continue;
+		}
+
+		//Copy out as much as is contiguous
+		size_t offset = rpos & mask;
+		size_t n = min<uint64_t>(wpos - rpos, len - done);
+		n = min<size_t>(n, m_header->m_capacity - offset);
+		memcpy(buf + done, m_data + offset, n);
+
+		done += n;
+		rpos += n;
+		m_header->m_readPos.store(rpos, memory_order_release);
+		WakeProducer();
+
+		if(progress)
+			progress(done * 1.0f / len);
+	}
+
+	return len;
+}
+
+/**
+	@brief Blocks until the producer's sequence number changes from seq, or the timeout expires
+
+	@return False on timeout
+ */
+bool SharedMemoryRing::WaitForData(uint32_t seq, unsigned int timeoutMs)
+{
+#ifdef __linux__
+	struct timespec ts;
+	ts.tv_sec = timeoutMs / 1000;
+	ts.tv_nsec = (timeoutMs % 1000) * 1000000L;
+
+	long ret = syscall(
+		SYS_futex,
+		reinterpret_cast<uint32_t*>(&m_header->m_writeSeq),
+		FUTEX_WAIT,
+		seq,
+		&ts,
+		nullptr,
+		0);
+	if( (ret != 0) && (errno == ETIMEDOUT) )
+		return false;
+	return true;
+#else
+	//No cross-process futex, poll instead
+	auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+	while(m_header->m_writeSeq.load(memory_order_acquire) == seq)
+	{
+		if(chrono::steady_clock::now() > deadline)
+			return false;
+		this_thread::sleep_for(chrono::microseconds(50));
+	}
+	return true;
+#endif
+}
+
+/**
+	@brief Tells the producer we have freed up space in the ring
+ */
+void SharedMemoryRing::WakeProducer()
+{
+	m_header->m_readSeq.fetch_add(1, memory_order_release);
+
+#ifdef __linux__
+	syscall(
+		SYS_futex,
+		reinterpret_cast<uint32_t*>(&m_header->m_readSeq),
+		FUTEX_WAKE,
+		INT_MAX,
+		nullptr,
+		nullptr,
+		0);
+#endif
+}
@@ -0,0 +1,126 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of SharedMemoryRing
+	@ingroup transports
+ */
+
+#ifndef SharedMemoryRing_h
+#define SharedMemoryRing_h
+
+#include <atomic>
+#include <functional>
+
+/**
+	@brief Header at the start of a shared memory ring, shared with the producing process
+
+	Layout is part of the bridge protocol: the fields are naturally aligned and the producer must use the same
+	definition. Positions are free-running byte counters; the offset into the data area is pos & (capacity - 1).
+ */
+struct SharedMemoryRingHeader
+{
+	///@brief Must be SharedMemoryRing::MAGIC
+	uint32_t m_magic;
+
+	///@brief Must be SharedMemoryRing::VERSION
+	uint32_t m_version;
+
+	///@brief Size of the data area following the header, in bytes (power of two)
+	uint64_t m_capacity;
+
+	///@brief Total bytes written by the producer (producer stores with release ordering)
+	alignas(64) std::atomic<uint64_t> m_writePos;
+
+	///@brief Incremented by the producer after every write, used as a futex word for waking the consumer
+	std::atomic<uint32_t> m_writeSeq;
+
+	///@brief Total bytes consumed by the reader
+	alignas(64) std::atomic<uint64_t> m_readPos;
+
+	///@brief Incremented by the consumer after every read, used as a futex word for waking the producer
+	std::atomic<uint32_t> m_readSeq;
+
+	///@brief Set by the producer when it is shutting down
+	std::atomic<uint32_t> m_closed;
+};
+
+/**
+	@brief Consumer side of a single-producer single-consumer byte ring in POSIX shared memory
+
+	Used as a local data plane by bridge servers running on the same host as the client. The producer writes exactly
+	the byte stream it would otherwise send over the TCP data socket, so framing is unchanged; the ring only removes
+	the kernel socket copies. Waiting uses futexes on Linux and short sleeps elsewhere.
+
+	@ingroup transports
+ */
+class SharedMemoryRing
+{
+public:
+	~SharedMemoryRing();
+
+	static std::unique_ptr<SharedMemoryRing> Open(const std::string& name);
+	static std::string GetBridgeRingName(unsigned short dataport);
+
+	size_t Read(size_t len, unsigned char* buf, std::function<void(float)> progress, unsigned int timeoutMs);
+	size_t GetBytesAvailable();
+	bool WaitForReadable(unsigned int timeoutMs);
+
+	///@brief Magic number identifying a ring ("SHRB")
+	static constexpr uint32_t MAGIC = 0x42524853;
+
+	///@brief Ring format version
+	static constexpr uint32_t VERSION = 1;
+
+protected:
+	SharedMemoryRing();
+
+	bool WaitForData(uint32_t seq, unsigned int timeoutMs);
+	void WakeProducer();
+
+	///@brief File descriptor of the shared memory object
+	int m_fd;
+
+	///@brief Base of the mapping
+	void* m_mapping;
+
+	///@brief Size of the mapping
+	size_t m_mappingSize;
+
+	///@brief Ring header
+	SharedMemoryRingHeader* m_header;
+
+	///@brief Ring data area
+	uint8_t* m_data;
+};
+
+#endif
@@ -0,0 +1,360 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of SharedWaveformBuffer
+	@ingroup datamodel
+ */
+
+#include "scopehal.h"
+#include "SharedWaveformBuffer.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+SharedWaveformBuffer::SharedWaveformBuffer()
+	: m_fd(-1)
+	, m_mapping(nullptr)
+	, m_mappingSize(0)
+{
+}
+
+SharedWaveformBuffer::~SharedWaveformBuffer()
+{
+#ifdef __linux__
+	if(m_mapping)
+		munmap(m_mapping, m_mappingSize);
+	if(m_fd >= 0)
+		close(m_fd);
+#endif
+}
+
+/**
+	@brief Creates a new, empty buffer
+
+	@param name	Name of the region, for debugging only
+
+	@return The buffer, or nullptr on failure
+ */
+unique_ptr<SharedWaveformBuffer> SharedWaveformBuffer::Create(const string& name)
+{
+#ifdef __linux__
+	int fd = memfd_create(name.c_str(), MFD_CLOEXEC);
+	if(fd < 0)
+	{
+		LogError("memfd_create failed for shared waveform buffer %s\n", name.c_str());
+		return nullptr;
+	}
+
+	unique_ptr<SharedWaveformBuffer> buf(new SharedWaveformBuffer);
+	buf->m_fd = fd;
+	if(!buf->Map(sizeof(SharedWaveformHeader), true))
+		return nullptr;
+
+	auto header = reinterpret_cast<SharedWaveformHeader*>(buf->m_mapping);
+	header->m_magic = MAGIC;
+	header->m_type = TYPE_NONE;
+	header->m_size = 0;
+	header->m_totalSize = sizeof(SharedWaveformHeader);
+	return buf;
+#else
+	(void)name;
+	return nullptr;
+#endif
+}
+
+/**
+	@brief Attaches to a buffer created by another process
+
+	@param fd	File descriptor of the region. Ownership is transferred to the buffer.
+
+	@return The buffer, or nullptr if the region isn't a shared waveform buffer
+ */
+unique_ptr<SharedWaveformBuffer> SharedWaveformBuffer::Attach(int fd)
+{
+#ifdef __linux__
+	unique_ptr<SharedWaveformBuffer> buf(new SharedWaveformBuffer);
+	buf->m_fd = fd;
+
+	struct stat st;
+	if( (fstat(fd, &st) != 0) || (static_cast<size_t>(st.st_size) < sizeof(SharedWaveformHeader)) )
+		return nullptr;
+	if(!buf->Map(st.st_size, false))
+		return nullptr;
+
+	if(reinterpret_cast<SharedWaveformHeader*>(buf->m_mapping)->m_magic != MAGIC)
+	{
+		LogWarning("File descriptor %d is not a shared waveform buffer\n", fd);
+		return nullptr;
+	}
+	return buf;
+#else
+	(void)fd;
+	return nullptr;
+#endif
+}
+
+/**
+	@brief Makes sure we have at least size bytes of the region mapped
+
+	@param size		Required size
+	@param grow		True to grow the region itself if it's too small (writer side), false if the peer already did
+ */
+bool SharedWaveformBuffer::Map(size_t size, bool grow)
+{
+#ifdef __linux__
+	if(size <= m_mappingSize)
+		return true;
+
+	//Round up so a slowly growing waveform doesn't remap on every write
+	size_t newSize = max(size, m_mappingSize * 2);
+	newSize = (newSize + 4095) & ~static_cast<size_t>(4095);
+	if(grow)
+	{
+		if(ftruncate(m_fd, newSize) != 0)
+		{
+			LogError("Failed to grow shared waveform buffer to %zu bytes\n", newSize);
+			return false;
+		}
+	}
+	else
+		newSize = size;
+
+	void* p;
+	if(m_mapping)
+		p = mremap(m_mapping, m_mappingSize, newSize, MREMAP_MAYMOVE);
+	else
+		p = mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	if(p == MAP_FAILED)
+	{
+		LogError("Failed to map %zu bytes of shared waveform buffer\n", newSize);
+		return false;
+	}
+
+	m_mapping = reinterpret_cast<uint8_t*>(p);
+	m_mappingSize = newSize;
+	return true;
+#else
+	(void)size;
+	(void)grow;
+	return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Data transfer
+
+/**
+	@brief Figures out which of the exchangeable types a waveform is (TYPE_NONE if it can't be exchanged)
+ */
+SharedWaveformBuffer::WaveformType SharedWaveformBuffer::GetType(WaveformBase* wfm)
+{
+	if(wfm == nullptr)
+		return TYPE_NONE;
+	if(dynamic_cast<UniformAnalogWaveform*>(wfm))
+		return TYPE_UNIFORM_ANALOG;
+	if(dynamic_cast<SparseAnalogWaveform*>(wfm))
+		return TYPE_SPARSE_ANALOG;
+	if(dynamic_cast<UniformDigitalWaveform*>(wfm))
+		return TYPE_UNIFORM_DIGITAL;
+	if(dynamic_cast<SparseDigitalWaveform*>(wfm))
+		return TYPE_SPARSE_DIGITAL;
+	return TYPE_NONE;
+}
+
+/**
+	@brief Lays out a waveform in the buffer, replacing whatever was there
+
+	@param wfm	The waveform. Null, or a type which can't be exchanged, writes an empty buffer.
+
+	@return False if the buffer could not be grown to fit
+ */
+bool SharedWaveformBuffer::Write(WaveformBase* wfm)
+{
+	auto type = GetType(wfm);
+	if( (wfm != nullptr) && (type == TYPE_NONE) )
+		LogWarning("SharedWaveformBuffer: %s can't be exchanged, sending an empty waveform\n", typeid(*wfm).name());
+
+	bool sparse = (type == TYPE_SPARSE_ANALOG) || (type == TYPE_SPARSE_DIGITAL);
+	bool analog = (type == TYPE_UNIFORM_ANALOG) || (type == TYPE_SPARSE_ANALOG);
+	size_t len = (type == TYPE_NONE) ? 0 : wfm->size();
+	size_t sampleSize = analog ? sizeof(float) : sizeof(bool);
+
+	//Figure out the layout
+	size_t offsetsStart = Align(sizeof(SharedWaveformHeader));
+	size_t durationsStart = offsetsStart + (sparse ? Align(len * sizeof(int64_t)) : 0);
+	size_t samplesStart = durationsStart + (sparse ? Align(len * sizeof(int64_t)) : 0);
+	size_t total = samplesStart + len*sampleSize;
+	if(!Map(total, true))
+		return false;
+
+	auto header = reinterpret_cast<SharedWaveformHeader*>(m_mapping);
+	header->m_type = type;
+	header->m_size = len;
+	header->m_totalSize = total;
+	if(type == TYPE_NONE)
+		return true;
+
+	header->m_timescale = wfm->m_timescale;
+	header->m_startTimestamp = wfm->m_startTimestamp;
+	header->m_startFemtoseconds = wfm->m_startFemtoseconds;
+	header->m_triggerPhase = wfm->m_triggerPhase;
+	header->m_revision = wfm->m_revision;
+	header->m_flags = wfm->m_flags;
+
+	wfm->PrepareForCpuAccess();
+	if(sparse)
+	{
+		auto swfm = dynamic_cast<SparseWaveformBase*>(wfm);
+		memcpy(m_mapping + offsetsStart, swfm->m_offsets.GetCpuPointer(), len * sizeof(int64_t));
+		memcpy(m_mapping + durationsStart, swfm->m_durations.GetCpuPointer(), len * sizeof(int64_t));
+	}
+
+	const void* samples = nullptr;
+	switch(type)
+	{
+		case TYPE_UNIFORM_ANALOG:
+			samples = static_cast<UniformAnalogWaveform*>(wfm)->m_samples.GetCpuPointer();
+			break;
+		case TYPE_SPARSE_ANALOG:
+			samples = static_cast<SparseAnalogWaveform*>(wfm)->m_samples.GetCpuPointer();
+			break;
+		case TYPE_UNIFORM_DIGITAL:
+			samples = static_cast<UniformDigitalWaveform*>(wfm)->m_samples.GetCpuPointer();
+			break;
+		case TYPE_SPARSE_DIGITAL:
+			samples = static_cast<SparseDigitalWaveform*>(wfm)->m_samples.GetCpuPointer();
+			break;
+		default:
+			break;
+	}
+	memcpy(m_mapping + samplesStart, samples, len*sampleSize);
+
+	return true;
+}
+
+/**
+	@brief Copies the waveform currently in the buffer out into a waveform object
+
+	@param reuse	Waveform to overwrite if it's of the right type (may be null). If not used, the caller still owns it.
+
+	@return The waveform (reuse, or a newly allocated one), or nullptr if the buffer is empty or unreadable
+ */
+WaveformBase* SharedWaveformBuffer::Read(WaveformBase* reuse)
+{
+	//The writer may have grown the region since we last looked
+	auto header = reinterpret_cast<SharedWaveformHeader*>(m_mapping);
+	if(!Map(header->m_totalSize, false))
+		return nullptr;
+	header = reinterpret_cast<SharedWaveformHeader*>(m_mapping);
+
+	auto type = static_cast<WaveformType>(header->m_type);
+	if(type == TYPE_NONE)
+		return nullptr;
+
+	WaveformBase* wfm = (GetType(reuse) == type) ? reuse : nullptr;
+	if(!wfm)
+	{
+		switch(type)
+		{
+			case TYPE_UNIFORM_ANALOG:
+				wfm = new UniformAnalogWaveform;
+				break;
+			case TYPE_SPARSE_ANALOG:
+				wfm = new SparseAnalogWaveform;
+				break;
+			case TYPE_UNIFORM_DIGITAL:
+				wfm = new UniformDigitalWaveform;
+				break;
+			case TYPE_SPARSE_DIGITAL:
+				wfm = new SparseDigitalWaveform;
+				break;
+			default:
+				LogWarning("SharedWaveformBuffer: unknown waveform type %u\n", header->m_type);
+				return nullptr;
+		}
+	}
+
+	bool sparse = (type == TYPE_SPARSE_ANALOG) || (type == TYPE_SPARSE_DIGITAL);
+	bool analog = (type == TYPE_UNIFORM_ANALOG) || (type == TYPE_SPARSE_ANALOG);
+	size_t len = header->m_size;
+	size_t sampleSize = analog ? sizeof(float) : sizeof(bool);
+	size_t offsetsStart = Align(sizeof(SharedWaveformHeader));
+	size_t durationsStart = offsetsStart + (sparse ? Align(len * sizeof(int64_t)) : 0);
+	size_t samplesStart = durationsStart + (sparse ? Align(len * sizeof(int64_t)) : 0);
+
+	wfm->m_timescale = header->m_timescale;
+	wfm->m_startTimestamp = header->m_startTimestamp;
+	wfm->m_startFemtoseconds = header->m_startFemtoseconds;
+	wfm->m_triggerPhase = header->m_triggerPhase;
+	wfm->m_flags = header->m_flags;
+	wfm->m_revision ++;
+
+	wfm->Resize(len);
+	wfm->PrepareForCpuAccess();
+	if(sparse)
+	{
+		auto swfm = dynamic_cast<SparseWaveformBase*>(wfm);
+		memcpy(swfm->m_offsets.GetCpuPointer(), m_mapping + offsetsStart, len * sizeof(int64_t));
+		memcpy(swfm->m_durations.GetCpuPointer(), m_mapping + durationsStart, len * sizeof(int64_t));
+	}
+
+	void* samples = nullptr;
+	switch(type)
+	{
+		case TYPE_UNIFORM_ANALOG:
+			samples = static_cast<UniformAnalogWaveform*>(wfm)->m_samples.GetCpuPointer();
+			break;
+		case TYPE_SPARSE_ANALOG:
+			samples = static_cast<SparseAnalogWaveform*>(wfm)->m_samples.GetCpuPointer();
+			break;
+		case TYPE_UNIFORM_DIGITAL:
+			samples = static_cast<UniformDigitalWaveform*>(wfm)->m_samples.GetCpuPointer();
+			break;
+		case TYPE_SPARSE_DIGITAL:
+			samples = static_cast<SparseDigitalWaveform*>(wfm)->m_samples.GetCpuPointer();
+			break;
+		default:
+			break;
+	}
+	memcpy(samples, m_mapping + samplesStart, len*sampleSize);
+
+	wfm->MarkModifiedFromCpu();
+	return wfm;
+}
@@ -0,0 +1,134 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of SharedWaveformBuffer
+	@ingroup datamodel
+ */
+
+#ifndef SharedWaveformBuffer_h
+#define SharedWaveformBuffer_h
+
+/**
+	@brief Header at the start of a SharedWaveformBuffer
+
+	Everything needed to reconstruct the waveform on the other side. The sample arrays follow the header: offsets
+	and durations (int64_t, sparse waveforms only) then the samples themselves, each array starting on a 64-byte
+	boundary.
+ */
+struct SharedWaveformHeader
+{
+	///@brief Must be SharedWaveformBuffer::MAGIC
+	uint32_t m_magic;
+
+	///@brief Concrete type of the waveform (SharedWaveformBuffer::WaveformType)
+	uint32_t m_type;
+
+	///@brief Number of samples
+	uint64_t m_size;
+
+	///@brief Total size of the waveform including this header, in bytes. The mapping may be larger.
+	uint64_t m_totalSize;
+
+	int64_t m_timescale;
+	int64_t m_startTimestamp;
+	int64_t m_startFemtoseconds;
+	int64_t m_triggerPhase;
+	uint64_t m_revision;
+	uint32_t m_flags;
+	uint32_t m_reserved;
+};
+
+/**
+	@brief A waveform in a memory region which can be mapped by another process
+
+	Used to move waveforms between processes without going through a socket: the writer lays the waveform out in the
+	region, and the reader (which was handed the file descriptor once, when the buffer was set up) maps the same pages.
+	The region only ever grows, so in steady state exchanging a waveform costs no allocations or system calls on
+	either side.
+
+	Only the four basic analog and digital waveform types can be exchanged. On Linux the region is a memfd; other
+	platforms are not currently supported and Create() returns nullptr.
+
+	@ingroup datamodel
+ */
+class SharedWaveformBuffer
+{
+public:
+	~SharedWaveformBuffer();
+
+	//non-copyable
+	SharedWaveformBuffer(const SharedWaveformBuffer&) = delete;
+	SharedWaveformBuffer& operator=(const SharedWaveformBuffer&) = delete;
+
+	static std::unique_ptr<SharedWaveformBuffer> Create(const std::string& name);
+	static std::unique_ptr<SharedWaveformBuffer> Attach(int fd);
+
+	///@brief Gets the file descriptor of the region, for passing to another process
+	int GetFD()
+	{ return m_fd; }
+
+	bool Write(WaveformBase* wfm);
+	WaveformBase* Read(WaveformBase* reuse);
+
+	enum WaveformType
+	{
+		TYPE_NONE,
+		TYPE_UNIFORM_ANALOG,
+		TYPE_SPARSE_ANALOG,
+		TYPE_UNIFORM_DIGITAL,
+		TYPE_SPARSE_DIGITAL
+	};
+
+	static WaveformType GetType(WaveformBase* wfm);
+
+	///@brief Magic number identifying a shared waveform ("SHWF")
+	static constexpr uint32_t MAGIC = 0x46574853;
+
+protected:
+	SharedWaveformBuffer();
+
+	bool Map(size_t size, bool grow);
+
+	static size_t Align(size_t n)
+	{ return (n + 63) & ~static_cast<size_t>(63); }
+
+	///@brief File descriptor of the region
+	int m_fd;
+
+	///@brief Base of our mapping
+	uint8_t* m_mapping;
+
+	///@brief Size of our mapping
+	size_t m_mappingSize;
+};
+
+#endif
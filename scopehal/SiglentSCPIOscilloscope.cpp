@@ -134,6 +134,8 @@ SiglentSCPIOscilloscope::SiglentSCPIOscilloscope(SCPITransport* transport)
 	, m_acqPointsValid(false)
 	, m_digitalAcqPointsValid(false)
 	, m_highDefinition(false)
+	, m_config(transport)
+	, m_prefetchEnabled(false)
 {
 	//standard initialization
 	FlushConfigCache();
@@ -145,6 +147,10 @@ SiglentSCPIOscilloscope::SiglentSCPIOscilloscope(SCPITransport* transport)
 
 	//Figure out if scope is in low or high bit depth mode so we can download waveforms with the correct format
 	GetADCMode(0);
+
+	//Fetch per-channel state in one burst rather than a round trip per getter
+	m_prefetchEnabled = true;
+	PrefetchConfig();
 }
 
 string SiglentSCPIOscilloscope::converse(const char* fmt, ...)
@@ -156,7 +162,7 @@ string SiglentSCPIOscilloscope::converse(const char* fmt, ...)
 	vsnprintf(opString, sizeof(opString), fmt, va);
 	va_end(va);
 
-	ret = m_transport->SendCommandQueuedWithReply(opString, false);
+	ret = m_config.Query(opString, false);
 	return ret;
 }
 
@@ -169,6 +175,7 @@ void SiglentSCPIOscilloscope::sendOnly(const char* fmt, ...)
 	vsnprintf(opString, sizeof(opString), fmt, va);
 	va_end(va);
 
+	m_config.DiscardPrefetched(opString);
 	m_transport->SendCommandQueued(opString);
 }
 
@@ -692,42 +699,110 @@ OscilloscopeChannel* SiglentSCPIOscilloscope::GetExternalTrigger()
 
 void SiglentSCPIOscilloscope::FlushConfigCache()
 {
-	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	{
+		lock_guard<recursive_mutex> lock(m_cacheMutex);
 
-	if(m_trigger)
-		delete m_trigger;
-	m_trigger = NULL;
-
-	m_channelVoltageRanges.clear();
-	m_channelOffsets.clear();
-	m_channelsEnabled.clear();
-	m_channelDeskew.clear();
-	m_channelDigitalThresholds.clear();
-	m_probeIsActive.clear();
-	m_sampleRateValid = false;
-	m_memoryDepthValid = false;
-	m_triggerOffsetValid = false;
-	m_meterModeValid = false;
-	m_acqPointsValid = false;
-	m_maxPointsValid = false;
-	m_digitalAcqPointsValid = false;
-	m_awgEnabled.clear();
-	m_awgDutyCycle.clear();
-	m_awgRange.clear();
-	m_awgOffset.clear();
-	m_awgFrequency.clear();
-	m_awgShape.clear();
-	m_awgImpedance.clear();
-	m_adcModeValid = false;
+		if(m_trigger)
+			delete m_trigger;
+		m_trigger = NULL;
 
-	//Clear cached display name of all channels
-	for(auto c : m_channels)
-	{
-		if(GetInstrumentTypesForChannel(c->GetIndex()) & Instrument::INST_OSCILLOSCOPE)
-			c->ClearCachedDisplayName();
+		m_channelVoltageRanges.clear();
+		m_channelOffsets.clear();
+		m_channelsEnabled.clear();
+		m_channelDeskew.clear();
+		m_channelDigitalThresholds.clear();
+		m_probeIsActive.clear();
+		m_sampleRateValid = false;
+		m_memoryDepthValid = false;
+		m_triggerOffsetValid = false;
+		m_meterModeValid = false;
+		m_acqPointsValid = false;
+		m_maxPointsValid = false;
+		m_digitalAcqPointsValid = false;
+		m_awgEnabled.clear();
+		m_awgDutyCycle.clear();
+		m_awgRange.clear();
+		m_awgOffset.clear();
+		m_awgFrequency.clear();
+		m_awgShape.clear();
+		m_awgImpedance.clear();
+		m_adcModeValid = false;
+
+		//Clear cached display name of all channels
+		for(auto c : m_channels)
+		{
+			if(GetInstrumentTypesForChannel(c->GetIndex()) & Instrument::INST_OSCILLOSCOPE)
+				c->ClearCachedDisplayName();
+		}
 	}
+
+	//Settings may have been changed from the front panel, so anything prefetched is stale too
+	m_config.InvalidateCache();
+	if(m_prefetchEnabled)
+		PrefetchConfig();
 }
 
+/**
+	@brief Sends every per-channel state query as one pipelined burst
+
+	The replies are held in m_config, so the getters' own queries are answered without a round trip each. Only
+	queries the getters would send anyway go in the list, since this scope doesn't reply to queries it doesn't know.
+ */
+void SiglentSCPIOscilloscope::PrefetchConfig()
+{
+	vector<string> queries;
+	char tmp[128];
+	for(size_t i=0; i<m_analogChannelCount; i++)
+	{
+		vector<const char*> fmts;
+		switch(m_protocolId)
+		{
+			// --------------------------------------------------
+			case PROTOCOL_SPO:
+			case PROTOCOL_ESERIES:
+				fmts =
+				{
+					"C%zu:TRACE?",
+					"C%zu:COUPLING?",
+					"C%zu:ATTENUATION?",
+					"C%zu:BANDWIDTH_LIMIT?",
+					"C%zu:INVERTSET?",
+					"C%zu:OFST?",
+					"C%zu:VOLT_DIV?",
+					"C%zu:SKEW?"
+				};
+				break;
+			// --------------------------------------------------
+			case PROTOCOL_E11:
+				fmts =
+				{
+					":CHANNEL%zu:SWITCH?",
+					":CHANNEL%zu:COUPLING?",
+					":CHANNEL%zu:IMPEDANCE?",
+					":CHANNEL%zu:PROBE?",
+					":CHANNEL%zu:BWLIMIT?",
+					":CHANNEL%zu:INVERT?",
+					":CHANNEL%zu:LABEL:TEXT?",
+					":CHANNEL%zu:OFFSET?",
+					":CHANNEL%zu:SCALE?",
+					":CHANNEL%zu:SKEW?"
+				};
+				break;
+			// --------------------------------------------------
+			default:
+				return;
+		}
+
+		for(auto f : fmts)
+		{
+			snprintf(tmp, sizeof(tmp), f, i + 1);
+			queries.push_back(tmp);
+		}
+	}
+
+	LogTrace("Prefetching %zu channel settings\n", queries.size());
+	m_config.Prefetch(queries, false);
+}
 /**
 	@brief See what measurement capabilities we have
  */
@@ -1609,55 +1684,53 @@ Oscilloscope::TriggerMode SiglentSCPIOscilloscope::PollTrigger()
 	return TRIGGER_MODE_RUN;
 }
 
-int SiglentSCPIOscilloscope::ReadWaveformBlock(uint32_t maxsize, size_t& readBytes, char* data, bool hdSizeWorkaround, std::function<void(float)> progress)
+/**
+	@brief Reads a binary waveform block
+
+	If convertStream is a m_sampleConverter stream ID, data is converted in the background as it arrives. data must
+	then point convertOffset bytes into that stream's raw buffer.
+ */
+int SiglentSCPIOscilloscope::ReadWaveformBlock(
+	uint32_t maxsize,
+	size_t& readBytes,
+	char* data,
+	bool hdSizeWorkaround,
+	std::function<void(float)> progress,
+	size_t convertStream,
+	size_t convertOffset)
 {
 	readBytes = 0;
-	//Read and discard data until we see the '#'
-	uint8_t tmp;
-	for(int i=0; i<20; i++)
-	{
-		m_transport->ReadRawData(1, &tmp);
-		if(tmp == '#')
-			break;
 
-		//shouldn't ever get here
-		if(i == 19)
-		{
-			LogError("ReadWaveformBlock: threw away 20 bytes of data and never saw a '#'\n");
-			// This is a protocol error, flush pending rx data
-			flush();
-			// Stop aqcuisition after this protocol error
-			Stop();
-			return 0;
-		}
+	size_t blockLength;
+	if(!m_transport->ReadBinaryBlockHeader(blockLength, 20))
+	{
+		// This is a protocol error, flush pending rx data
+		flush();
+		// Stop aqcuisition after this protocol error
+		Stop();
+		return 0;
 	}
-
-	//Read length of the length field
-	m_transport->ReadRawData(1, &tmp);
-	int lengthOfLength = tmp - '0';
-
-	//Read the actual length field
-	char textlen[10] = {0};
-	m_transport->ReadRawData(lengthOfLength, (unsigned char*)textlen);
-	uint32_t getLength = atoi(textlen);
+	uint32_t getLength = blockLength;
 
 	uint32_t len = getLength;
 	if(hdSizeWorkaround)
 		len *= 2;
 
-	LogTrace("Got length %" PRIu32 " ('%s') from scope, hdSizeWorkaround = %s, expected bytes = %" PRIu32 ", maxsize = %" PRIu32 " => reading %" PRIu32 " bytes.\n",getLength, textlen, hdSizeWorkaround ? "true" : "false", len, maxsize, min(len, maxsize));
+	LogTrace("Got length %" PRIu32 " from scope, hdSizeWorkaround = %s, expected bytes = %" PRIu32 ", maxsize = %" PRIu32 " => reading %" PRIu32 " bytes.\n",getLength, hdSizeWorkaround ? "true" : "false", len, maxsize, min(len, maxsize));
 	if(len > maxsize)
 	{
 		len = maxsize;
 		LogError("Invalid waveform block length %" PRIu32 " : max size = %" PRIu32 "\n",len,maxsize);
 	}
 
-	while(readBytes < len)
-	{
-		size_t newBytes = m_transport->ReadRawData(len-readBytes, (unsigned char*)(data+readBytes), progress);
-		if(newBytes == 0) break;
-		readBytes += newBytes;
-	}
+	if(convertStream != SIZE_MAX)
+		progress = m_sampleConverter.GetProgressCallback(convertStream, convertOffset, len, progress);
+
+	readBytes = m_transport->ReadBinaryBlockData(len, (unsigned char*)data, progress);
+	m_transport->EndBinaryBlock(false);
+
+	if(convertStream != SIZE_MAX)
+		m_sampleConverter.UpdateStream(convertStream, convertOffset + readBytes);
 
 	if(hdSizeWorkaround)
 		return getLength*2;
@@ -1778,54 +1851,27 @@ time_t SiglentSCPIOscilloscope::ExtractTimestamp(unsigned char* wavedesc, double
 	return mktime(&tstruc);
 }
 
-vector<WaveformBase*> SiglentSCPIOscilloscope::ProcessAnalogWaveform(const char* data,
-	size_t datalen,
-	char* wavedesc,
-	uint32_t num_sequences,
-	time_t ttime,
-	double basetime,
-	double* wavetime,
-	int ch)
-{
-	vector<WaveformBase*> ret;
+/**
+	@brief Computes the raw-code-to-volts conversion for an analog channel from its wavedesc
 
-	//Parse the wavedesc headers
+	@param wavedesc	WAVEDESC block for the channel
+	@param ch		Channel index
+	@param v_gain	Volts per ADC code
+	@param v_off	Offset subtracted after scaling
+ */
+void SiglentSCPIOscilloscope::GetAnalogScaling(char* wavedesc, int ch, float& v_gain, float& v_off)
+{
 	auto pdesc = wavedesc;
 
 	//cppcheck-suppress invalidPointerCast
-	float v_gain = *reinterpret_cast<float*>(pdesc + 156);
+	v_gain = *reinterpret_cast<float*>(pdesc + 156);
 
 	//cppcheck-suppress invalidPointerCast
-	float v_off = *reinterpret_cast<float*>(pdesc + 160);
+	v_off = *reinterpret_cast<float*>(pdesc + 160);
 
 	//cppcheck-suppress invalidPointerCast
 	float v_probefactor = *reinterpret_cast<float*>(pdesc + 328);
 
-	//cppcheck-suppress invalidPointerCast
-	float interval = *reinterpret_cast<float*>(pdesc + 176) * FS_PER_SECOND;
-
-	//cppcheck-suppress invalidPointerCast
-	double h_off = *reinterpret_cast<double*>(pdesc + 180) * FS_PER_SECOND;	   //fs from start of waveform to trigger
-
-	//double h_off_frac = fmodf(h_off, interval);	   //fractional sample position, in fs
-
-	double h_off_frac = 0;	  //((interval*datalen)/2)+h_off;
-
-	if(h_off_frac < 0)
-		h_off_frac = h_off;	   //interval + h_off_frac;	   //double h_unit = *reinterpret_cast<double*>(pdesc + 244);
-
-	//Raw waveform data
-	size_t num_samples;
-	if(m_highDefinition)
-		num_samples = datalen / 2;
-	else
-		num_samples = datalen;
-	size_t num_per_segment = num_samples / num_sequences;
-	// int16_t* wdata = (int16_t*)&data[0];
-	// int8_t* bdata = (int8_t*)&data[0];
-	const int16_t* wdata = reinterpret_cast<const int16_t*>(data);
-	const int8_t* bdata = reinterpret_cast<const int8_t*>(data);
-
 	float codes_per_div;
 
 	//Codes per div varies with vertical scale on SDS6000A!
@@ -1861,6 +1907,52 @@ vector<WaveformBase*> SiglentSCPIOscilloscope::ProcessAnalogWaveform(const char*
 
 	// Vertical offset is also scaled by the probefactor
 	v_off = v_off * v_probefactor;
+}
+
+vector<WaveformBase*> SiglentSCPIOscilloscope::ProcessAnalogWaveform(const char* data,
+	size_t datalen,
+	char* wavedesc,
+	uint32_t num_sequences,
+	time_t ttime,
+	double basetime,
+	double* wavetime,
+	int ch,
+	UniformAnalogWaveform* streamed,
+	const SegmentedCapture* segments)
+{
+	vector<WaveformBase*> ret;
+
+	//Parse the wavedesc headers
+	auto pdesc = wavedesc;
+
+	//cppcheck-suppress invalidPointerCast
+	float interval = *reinterpret_cast<float*>(pdesc + 176) * FS_PER_SECOND;
+
+	//cppcheck-suppress invalidPointerCast
+	double h_off = *reinterpret_cast<double*>(pdesc + 180) * FS_PER_SECOND;	   //fs from start of waveform to trigger
+
+	//double h_off_frac = fmodf(h_off, interval);	   //fractional sample position, in fs
+
+	double h_off_frac = 0;	  //((interval*datalen)/2)+h_off;
+
+	if(h_off_frac < 0)
+		h_off_frac = h_off;	   //interval + h_off_frac;	   //double h_unit = *reinterpret_cast<double*>(pdesc + 244);
+
+	//Raw waveform data
+	size_t num_samples;
+	if(m_highDefinition)
+		num_samples = datalen / 2;
+	else
+		num_samples = datalen;
+	size_t num_per_segment = num_samples / num_sequences;
+	// int16_t* wdata = (int16_t*)&data[0];
+	// int8_t* bdata = (int8_t*)&data[0];
+	const int16_t* wdata = reinterpret_cast<const int16_t*>(data);
+	const int8_t* bdata = reinterpret_cast<const int8_t*>(data);
+
+	float v_gain;
+	float v_off;
+	GetAnalogScaling(wavedesc, ch, v_gain, v_off);
 
 	// Update channel voltages and offsets based on what is in this wavedesc
 	// m_channelVoltageRanges[ch] = v_gain * v_probefactor * 30 * 8;
@@ -1876,6 +1968,19 @@ vector<WaveformBase*> SiglentSCPIOscilloscope::ProcessAnalogWaveform(const char*
 		h_off_frac,
 		datalen);
 
+	//Samples were already converted by m_sampleConverter during download, just fill in the metadata
+	if(streamed)
+	{
+		streamed->m_timescale = round(interval);
+		streamed->m_triggerPhase = h_off_frac;
+		streamed->m_startTimestamp = ttime;
+		streamed->m_startFemtoseconds = static_cast<int64_t>(basetime * FS_PER_SECOND);
+		streamed->Resize(num_samples);
+		streamed->MarkSamplesModifiedFromCpu();
+		ret.push_back(streamed);
+		return ret;
+	}
+
 	for(size_t j = 0; j < num_sequences; j++)
 	{
 		//Set up the capture we're going to store our data into
@@ -1891,30 +1996,14 @@ vector<WaveformBase*> SiglentSCPIOscilloscope::ProcessAnalogWaveform(const char*
 		else
 			cap->m_startFemtoseconds = static_cast<int64_t>(basetime * FS_PER_SECOND);
 
-		cap->Resize(num_per_segment);
-		cap->PrepareForCpuAccess();
-
-		//Convert raw ADC samples to volts
-		if(m_highDefinition)
-		{
-			Convert16BitSamples(
-				cap->m_samples.GetCpuPointer(),
-				wdata + j * num_per_segment,
-				v_gain,
-				v_off,
-				num_per_segment);
-		}
+		//Keep the raw ADC samples, they're only converted to volts if something needs them that way.
+		//If the whole capture was downloaded as one block, just point at our slice of it.
+		if(segments)
+			segments->AttachSegment(cap, j, v_gain, -v_off);
+		else if(m_highDefinition)
+			cap->SetRawSamples16Bit(wdata + j * num_per_segment, num_per_segment, v_gain, -v_off);
 		else
-		{
-			Convert8BitSamples(
-				cap->m_samples.GetCpuPointer(),
-				bdata + j * num_per_segment,
-				v_gain,
-				v_off,
-				num_per_segment);
-		}
-
-		cap->MarkSamplesModifiedFromCpu();
+			cap->SetRawSamples8Bit(bdata + j * num_per_segment, num_per_segment, v_gain, -v_off);
 		ret.push_back(cap);
 	}
 
@@ -1969,48 +2058,11 @@ vector<SparseDigitalWaveform*> SiglentSCPIOscilloscope::ProcessDigitalWaveform(c
 		else
 			cap->m_startFemtoseconds = static_cast<int64_t>(basetime * FS_PER_SECOND);
 
-		//Preallocate memory assuming no deduplication possible
-		cap->Resize(numSamples);
-
-		size_t k = 0;
-		size_t sampleIndex = 0;
-		bool sampleValue = false;
-		bool lastSampleValue = false;
-
-
-		//Read and de-duplicate the other samples
-		for (size_t curByteIndex = 0; curByteIndex < datalen; curByteIndex++)
-		{
-			char samples = data[curByteIndex];
-			for (int ii = 0; ii < 8; ii++, samples >>= 1)
-			{	// Check if the current scope sample bit is set.
-				sampleValue = (samples & 0x1);
-				if((sampleIndex > 0) && (lastSampleValue == sampleValue) && ((sampleIndex + 3) < numSamples))
-				{	//Deduplicate consecutive samples with same value
-					cap->m_durations[k]++;
-				}
-				else
-				{	//Nope, it toggled - store the new value
-					cap->m_offsets[k] = sampleIndex;
-					cap->m_durations[k] = 1;
-					cap->m_samples[k] = sampleValue;
-					lastSampleValue = sampleValue;
-					k++;
-				}
-				sampleIndex++;
-			}
-		}
-
-		//Done, shrink any unused space
-		cap->Resize(k);
-		cap->m_offsets.shrink_to_fit();
-		cap->m_durations.shrink_to_fit();
-		cap->m_samples.shrink_to_fit();
-		cap->MarkSamplesModifiedFromCpu();
-		cap->MarkTimestampsModifiedFromCpu();
+		//Run length encode the bit packed samples
+		UniformPackedDigitalWaveform::ExtractRuns(reinterpret_cast<const uint8_t*>(data), numSamples, *cap, 3);
 
 		//See how much space we saved
-		//LogDebug("%zu samples deduplicated to %zu (%.1f %%)\n",	numSamples,	k, (k * 100.0f) / (numSamples));
+		//LogDebug("%zu samples deduplicated to %zu (%.1f %%)\n",	numSamples,	cap->size(), (cap->size() * 100.0f) / (numSamples));
 
 		//Done, save data and go on to next
 		ret.push_back(cap);
@@ -2023,6 +2075,9 @@ bool SiglentSCPIOscilloscope::AcquireData()
 	// Transfer buffers
 	char* analogWaveformData[MAX_ANALOG] {nullptr};
 	size_t analogWaveformDataSize[MAX_ANALOG] {0};
+	UniformAnalogWaveform* streamedWaveforms[MAX_ANALOG] {nullptr};
+	shared_ptr<AcceleratorBuffer<int8_t> > segmentBlocks[MAX_ANALOG];
+	shared_ptr<AcceleratorBuffer<int8_t> > stagingBlocks[MAX_ANALOG];
 	char wavedescs[MAX_ANALOG][WAVEDESC_SIZE];
 	char* digitalWaveformDataBytes[MAX_DIGITAL] {nullptr};
 	size_t digitalWaveformDataSize[MAX_DIGITAL] {0};
@@ -2074,8 +2129,9 @@ bool SiglentSCPIOscilloscope::AcquireData()
 			for(unsigned int i = 0; i < m_analogChannelCount; i++)
 			{
 				if(analogEnabled[i])
-				{	// Allocate buffer
-					analogWaveformData[i] = new char[WAVEFORM_SIZE];
+				{	// Borrow a buffer
+					stagingBlocks[i] = StagingBufferPool::Borrow<int8_t>(WAVEFORM_SIZE, "SiglentSCPIOscilloscope.staging");
+					analogWaveformData[i] = reinterpret_cast<char*>(stagingBlocks[i]->GetCpuPointer());
 					m_transport->SendCommand("C" + to_string(i + 1) + ":WAVEFORM? DAT2");
 					// length of data is current memory depth
 					analogWaveformDataSize[i] = ReadWaveformBlock(WAVEFORM_SIZE,readBytes,analogWaveformData[i],false, [i, this] (float progress) { ChannelsDownloadStatusUpdate(i, InstrumentChannel::DownloadState::DOWNLOAD_IN_PROGRESS, progress); });
@@ -2207,12 +2263,48 @@ bool SiglentSCPIOscilloscope::AcquireData()
 				size_t acqBytes = m_highDefinition ? (acqPoints*2) : acqPoints;
 				bool paginated = (pages > 1);
 				LogTrace("Acqu points = %" PRIu64 ", Acqu bytes = %zu, num pages = %" PRIu64 ", pageSize = %" PRIu64 ", pageSizeBytes = %" PRIu64 "\n",acqPoints,acqBytes,pages,pageSize,pageSizeBytes);
+
+				//Single captures are converted in the background as they download.
+				//Segmented captures are split into one waveform per segment afterwards, so convert them at the end.
+				bool streaming = (num_sequences == 1);
+				auto rawFormat = m_highDefinition ?
+					StreamingSampleConverter::FORMAT_INT16 : StreamingSampleConverter::FORMAT_INT8;
+
 				//Read the data from each analog waveform
 				for(unsigned int i = 0; i < m_analogChannelCount; i++)
 				{
 					if(analogEnabled[i])
-					{	// Allocate buffer
-						analogWaveformData[i] = new char[acqBytes];
+					{	// Allocate buffer. Segmented captures get a block shared by all of the segment waveforms.
+						if(streaming)
+						{
+							stagingBlocks[i] = StagingBufferPool::Borrow<int8_t>(acqBytes, "SiglentSCPIOscilloscope.staging");
+							analogWaveformData[i] = reinterpret_cast<char*>(stagingBlocks[i]->GetCpuPointer());
+						}
+						else
+						{
+							segmentBlocks[i] = SegmentedCapture::AllocateBlock(acqBytes);
+							analogWaveformData[i] = reinterpret_cast<char*>(segmentBlocks[i]->GetCpuPointer());
+						}
+
+						size_t stream = SIZE_MAX;
+						if(streaming)
+						{
+							float v_gain;
+							float v_off;
+							GetAnalogScaling(wavedescs[i], i, v_gain, v_off);
+
+							streamedWaveforms[i] = new UniformAnalogWaveform;
+							streamedWaveforms[i]->Resize(acqPoints);
+							streamedWaveforms[i]->PrepareForCpuAccess();
+							stream = m_sampleConverter.BeginStream(
+								streamedWaveforms[i]->m_samples.GetCpuPointer(),
+								analogWaveformData[i],
+								acqPoints,
+								rawFormat,
+								v_gain,
+								v_off);
+						}
+
 						// Run the same loop for paginated and unpagnated mode, if unpaginated we will run it only once
 						m_transport->SendCommand(":WAVEFORM:SOURCE C" + to_string(i + 1));
 						for(uint64_t page = 0; page < pages; page++)
@@ -2226,7 +2318,14 @@ bool SiglentSCPIOscilloscope::AcquireData()
 									float linear_progress = ((float)page + fprogress) / (float)pages; // the last page will go slightly faster, but oh well
 									ChannelsDownloadStatusUpdate(i, InstrumentChannel::DownloadState::DOWNLOAD_IN_PROGRESS, linear_progress);
 								};
-								ReadWaveformBlock(acqBytes-analogWaveformDataSize[i], readBytes, analogWaveformData[i]+analogWaveformDataSize[i], hdWorkaround, progress);
+								ReadWaveformBlock(
+									acqBytes-analogWaveformDataSize[i],
+									readBytes,
+									analogWaveformData[i]+analogWaveformDataSize[i],
+									hdWorkaround,
+									progress,
+									stream,
+									analogWaveformDataSize[i]);
 								if(readBytes == 0)
 								{
 									LogError("Protocol error, aborting acquisition.");
@@ -2244,7 +2343,13 @@ bool SiglentSCPIOscilloscope::AcquireData()
 									m_paginated = false;
 								}
 								m_transport->SendCommand(":WAVEFORM:DATA?");
-								ReadWaveformBlock(acqBytes, readBytes, analogWaveformData[i], hdWorkaround, [i, this] (float progress) { ChannelsDownloadStatusUpdate(i, InstrumentChannel::DownloadState::DOWNLOAD_IN_PROGRESS, progress); });
+								ReadWaveformBlock(
+									acqBytes,
+									readBytes,
+									analogWaveformData[i],
+									hdWorkaround,
+									[i, this] (float progress) { ChannelsDownloadStatusUpdate(i, InstrumentChannel::DownloadState::DOWNLOAD_IN_PROGRESS, progress); },
+									stream);
 								if(readBytes == 0)
 								{
 									LogError("Protocol error, aborting acquisition.");
@@ -2276,6 +2381,8 @@ bool SiglentSCPIOscilloscope::AcquireData()
 						}
 						// Safe-check data size
 						if(analogWaveformDataSize[i] > acqBytes) analogWaveformDataSize[i] = acqBytes;
+						if(stream != SIZE_MAX)
+							m_sampleConverter.EndStream(stream, analogWaveformDataSize[i] / (m_highDefinition ? 2 : 1));
 						ChannelsDownloadStatusUpdate(i, InstrumentChannel::DownloadState::DOWNLOAD_FINISHED, 1.0);
 					}
 				}
@@ -2370,11 +2477,23 @@ bool SiglentSCPIOscilloscope::AcquireData()
 				}
 
 				//Process analog waveforms
+				m_sampleConverter.Wait();
 				waveforms.resize(m_analogChannelCount);
 				for(unsigned int i = 0; i < m_analogChannelCount; i++)
 				{
 					if(analogEnabled[i])
 					{
+						unique_ptr<SegmentedCapture> segments;
+						if(segmentBlocks[i])
+						{
+							size_t bytesPerSample = m_highDefinition ? 2 : 1;
+							segments = make_unique<SegmentedCapture>(
+								segmentBlocks[i],
+								bytesPerSample * 8,
+								num_sequences,
+								analogWaveformDataSize[i] / bytesPerSample);
+						}
+
 						waveforms[i] = ProcessAnalogWaveform(&analogWaveformData[i][0],
 							analogWaveformDataSize[i],
 							&wavedescs[i][0],
@@ -2382,7 +2501,9 @@ bool SiglentSCPIOscilloscope::AcquireData()
 							ttime,
 							basetime,
 							pwtime,
-							i);
+							i,
+							streamedWaveforms[i],
+							segments.get());
 					}
 				}
 
@@ -2439,7 +2560,6 @@ bool SiglentSCPIOscilloscope::AcquireData()
 	}
 
 	//Now that we have all of the pending waveforms, save them in sets across all channels
-	m_pendingWaveformsMutex.lock();
 	for(size_t i = 0; i < num_sequences; i++)
 	{
 		SequenceSet s;
@@ -2448,16 +2568,10 @@ bool SiglentSCPIOscilloscope::AcquireData()
 			if(pending_waveforms.find(j) != pending_waveforms.end())
 				s[GetOscilloscopeChannel(j)] = pending_waveforms[j][i];
 		}
-		m_pendingWaveforms.push_back(s);
+		PushPendingWaveform(s);
 	}
-	m_pendingWaveformsMutex.unlock();
 
-	//Clean up
-	for(int i = 0; i < MAX_ANALOG; i++)
-	{
-		if(analogWaveformData[i] != nullptr)
-			delete[] analogWaveformData[i];
-	}
+	//Clean up (analog transfer buffers go back to the staging pool on their own)
 	for(int i = 0; i < MAX_DIGITAL; i++)
 	{
 		if(digitalWaveformDataBytes[i] != nullptr)
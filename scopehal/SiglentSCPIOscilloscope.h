@@ -306,7 +306,14 @@ protected:
 
 	std::string GetPossiblyEmptyString(const std::string& property);
 
-	int ReadWaveformBlock(uint32_t maxsize, size_t& readBytes, char* data, bool hdSizeWorkaround = false, std::function<void(float)> progress = nullptr);
+	int ReadWaveformBlock(
+		uint32_t maxsize,
+		size_t& readBytes,
+		char* data,
+		bool hdSizeWorkaround = false,
+		std::function<void(float)> progress = nullptr,
+		size_t convertStream = SIZE_MAX,
+		size_t convertOffset = 0);
 	bool ReadWavedescs(
 		char wavedescs[MAX_ANALOG][WAVEDESC_SIZE], bool* analogEnabled, bool* digitalEnabled, bool& anyAnalogEnabled, bool& anyDigitalEnabled);
 
@@ -319,7 +326,11 @@ protected:
 		time_t ttime,
 		double basetime,
 		double* wavetime,
-		int i);
+		int i,
+		UniformAnalogWaveform* streamed = nullptr,
+		const SegmentedCapture* segments = nullptr);
+	void GetAnalogScaling(char* wavedesc, int ch, float& v_gain, float& v_off);
+	void PrefetchConfig();
 	
 	std::vector<SparseDigitalWaveform*> ProcessDigitalWaveform(const char* data,
 		size_t datalen,
@@ -409,6 +420,15 @@ protected:
 	//True if we have >8 bit capture depth
 	bool m_highDefinition;
 
+	///@brief Converts analog channels to float while later channels are still downloading
+	StreamingSampleConverter m_sampleConverter;
+
+	///@brief Replies from the bulk channel state fetch done on connect and by FlushConfigCache()
+	SCPIConfigBatch m_config;
+
+	///@brief True once the channel count and protocol are known, so PrefetchConfig() can run
+	bool m_prefetchEnabled;
+
 	//Other channels
 	OscilloscopeChannel* m_extTrigChannel;
 	FunctionGeneratorChannel* m_awgChannel;
@@ -117,6 +117,18 @@ bool SinilinkPowerSupply::IsPowerConstantCurrent(int chan)
 		return false;
 }
 
+/**
+	@brief Polls set points and readbacks in a single Modbus transaction rather than one per register
+ */
+bool SinilinkPowerSupply::AcquireData()
+{
+	lock_guard<recursive_mutex> lock(m_modbusMutex);
+	ReadRegisterSnapshot({REGISTER_V_SET, REGISTER_I_SET, REGISTER_V_OUT, REGISTER_I_OUT});
+	bool ret = PowerSupply::AcquireData();
+	ClearRegisterSnapshot();
+	return ret;
+}
+
 double SinilinkPowerSupply::GetPowerVoltageActual(int chan)
 {
 	if(chan != 0)
@@ -56,6 +56,7 @@ public:
 	virtual bool SupportsVoltageCurrentControl(int chan) override;
 
 	//Read sensors
+	virtual bool AcquireData() override;
 	virtual double GetPowerVoltageActual(int chan) override;	//actual voltage after current limiting
 	virtual double GetPowerVoltageNominal(int chan) override;	//set point
 	virtual double GetPowerCurrentActual(int chan) override;	//actual current drawn by the load
@@ -62,8 +62,15 @@ SocketCANAnalyzer::SocketCANAnalyzer(SCPITransport* transport)
 	, m_startSec(0)
 	, m_startNsec(0)
 {
-	auto chan = new CANChannel(this, "CAN", "#808080", 0);
-	m_channels.push_back(chan);
+	//One channel per interface. Keep the old name if there's only one so existing sessions still load.
+	auto sock = dynamic_cast<SCPISocketCANTransport*>(transport);
+	size_t nifaces = sock ? max(sock->GetInterfaceCount(), (size_t)1) : 1;
+	for(size_t i=0; i<nifaces; i++)
+	{
+		string name = (nifaces == 1) ? "CAN" : sock->GetInterfaceName(i);
+		auto chan = new CANChannel(this, name, "#808080", i);
+		m_channels.push_back(chan);
+	}
 }
 
 SocketCANAnalyzer::~SocketCANAnalyzer()
@@ -193,164 +200,191 @@ bool SocketCANAnalyzer::IsAppendingToWaveform()
 
 bool SocketCANAnalyzer::PopPendingWaveform()
 {
-	lock_guard<mutex> lock(m_pendingWaveformsMutex);
-	if(m_pendingWaveforms.size())
+	SequenceSet set;
+	if(PopPendingSet(set))
 	{
-		SequenceSet set = *m_pendingWaveforms.begin();
 		for(auto it : set)
 		{
 			auto chan = it.first.m_channel;
 			auto data = dynamic_cast<CANWaveform*>(it.second);
 			auto nstream = it.first.m_stream;
 
-			//If there is an existing waveform, append to it
-			//TODO: make this more efficient
+			//If there is an existing waveform, append to it and recycle the new one
 			auto oldWaveform = dynamic_cast<CANWaveform*>(chan->GetData(nstream));
 			if(oldWaveform && data && m_appendingNext)
 			{
 				size_t len = data->size();
+				size_t base = oldWaveform->size();
 				oldWaveform->PrepareForCpuAccess();
 				data->PrepareForCpuAccess();
+				oldWaveform->Resize(base + len);
 				for(size_t i=0; i<len; i++)
 				{
-					oldWaveform->m_samples.push_back(data->m_samples[i]);
-					oldWaveform->m_offsets.push_back(data->m_offsets[i]);
-					oldWaveform->m_durations.push_back(data->m_durations[i]);
+					oldWaveform->m_samples[base + i] = data->m_samples[i];
+					oldWaveform->m_offsets[base + i] = data->m_offsets[i];
+					oldWaveform->m_durations[base + i] = data->m_durations[i];
 				}
 				oldWaveform->m_revision ++;
 				oldWaveform->MarkModifiedFromCpu();
+
+				AddWaveformToDigitalPool(data);
 			}
 			else
 				chan->SetData(data, nstream);
 		}
-		m_pendingWaveforms.pop_front();
-
 		m_appendingNext = true;
 		return true;
 	}
 	return false;
 }
 
+/**
+	@brief Adds the symbols for one frame to a waveform
+
+	@param cap		Waveform to append to, already resized to hold the symbols
+	@param base		Index of the first symbol to write
+	@param frame	The frame
+	@param trel		Start time of the frame relative to the capture
+	@param ui		Nominal bit time
+
+	@return Number of symbols written (GetSymbolCount())
+ */
+size_t SocketCANAnalyzer::WriteFrame(CANWaveform* cap, size_t base, const SocketCANFrame& frame, int64_t trel, int64_t ui)
+{
+	auto& f = frame.frame;
+	bool rtr = (f.can_id & CAN_RTR_FLAG) == CAN_RTR_FLAG;
+
+	size_t i = base;
+	auto add = [&](int64_t off, int64_t dur, const CANSymbol& sym)
+	{
+		cap->m_offsets[i] = off;
+		cap->m_durations[i] = dur;
+		cap->m_samples[i] = sym;
+		i++;
+	};
+
+	add(trel, ui, CANSymbol(CANSymbol::TYPE_SOF, 0));
+	add(trel + ui, 31 * ui, CANSymbol(CANSymbol::TYPE_ID, f.can_id));
+	add(trel + 32*ui, ui, CANSymbol(CANSymbol::TYPE_RTR, rtr));
+	add(trel + 33*ui, ui, CANSymbol(CANSymbol::TYPE_FD, frame.fd));
+	add(trel + 34*ui, ui, CANSymbol(CANSymbol::TYPE_R0, 0));
+	add(trel + 35*ui, ui*4, CANSymbol(CANSymbol::TYPE_DLC, f.len));
+
+	//Data
+	for(int j=0; j<f.len; j++)
+		add(trel + 39*ui + j*8*ui, ui*8, CANSymbol(CANSymbol::TYPE_DATA, f.data[j]));
+
+	return i - base;
+}
+
 bool SocketCANAnalyzer::AcquireData()
 {
 	auto transport = dynamic_cast<SCPISocketCANTransport*>(m_transport);
 	if(!transport)
 		return false;
 
-	//Get the existing waveform if we have one
+	//Get a waveform for each interface, reusing old ones if possible
 	//TODO: Start a new waveform only if a new trigger cycle
-
-	auto cap = new CANWaveform;
-	cap->m_timescale = 1;
-	cap->m_startTimestamp = m_startSec;
-	cap->m_startFemtoseconds = m_startNsec * 1e6;
-	cap->m_triggerPhase = 0;
-	cap->PrepareForCpuAccess();
+	size_t nchans = m_channels.size();
+	vector<CANWaveform*> caps(nchans);
+	vector<int64_t> tLastEnd(nchans, 0);
+	for(size_t i=0; i<nchans; i++)
+	{
+		auto cap = m_digitalWaveformPool.Get<CANWaveform>();
+		if(cap)
+			cap->clear();
+		else
+			cap = new CANWaveform;
+
+		cap->m_timescale = 1;
+		cap->m_startTimestamp = m_startSec;
+		cap->m_startFemtoseconds = m_startNsec * 1e6;
+		cap->m_triggerPhase = 0;
+		cap->PrepareForCpuAccess();
+		caps[i] = cap;
+	}
 
 	//Add timeline samples (fake durations assuming 250 Kbps for now)
 	//TODO make this configurable
 	int64_t ui = 4 * 1000LL * 1000LL * 1000LL;
 
 	//Read frames until we run out or a timeout elapses
-	size_t npackets = 0;
-	int64_t tLastEnd = 0;
+	SocketCANFrame frames[SCPISocketCANTransport::MAX_BATCH];
 	while(true)
 	{
-		//Grab a frame and stop capturing if nothing shows up within the timeout window
-		can_frame frame;
-		int64_t sec;
-		int64_t ns;
-		int nbytes = transport->ReadPacket(&frame, sec, ns);
-		if(nbytes <= 0)
+		//Grab a batch of frames and stop capturing if nothing shows up within the timeout window
+		size_t nframes = transport->ReadPackets(frames, SCPISocketCANTransport::MAX_BATCH);
+		if(nframes == 0)
 			break;
 
-		//Calculate delay since start of capture, wrapping properly around second boundaries
-		int64_t dsec = sec - m_startSec;
-		int64_t dnsec = ns - m_startNsec;
-		if(dnsec < 0)
+		//Make room for the whole batch up front
+		vector<size_t> nsyms(nchans, 0);
+		for(size_t i=0; i<nframes; i++)
 		{
-			dsec --;
-			dnsec += 1e9;
+			if(!(frames[i].frame.can_id & CAN_ERR_FLAG))
+				nsyms[frames[i].iface] += GetSymbolCount(frames[i]);
 		}
-
-		int64_t trel = dsec * FS_PER_SECOND + dnsec*1e6;
-
-		//if last packet hasnt ended, there was a timestamping roundoff
-		//bump our start to match
-		if(trel <= tLastEnd)
-			trel = tLastEnd + ui;
-
-		//bool ext = (frame.can_id & CAN_EFF_MASK) > 2047;
-		bool rtr = (frame.can_id & CAN_RTR_FLAG) == CAN_RTR_FLAG;
-
-		//If the packet is an error, discard and move on
-		bool err = (frame.can_id & CAN_ERR_FLAG);
-		if(err)
-			continue;
-
-		cap->m_offsets.push_back(trel);
-		cap->m_durations.push_back(ui);
-		cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_SOF, 0));
-
-		cap->m_offsets.push_back(trel + ui);
-		cap->m_durations.push_back(31 * ui);
-		cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_ID, frame.can_id));
-
-		cap->m_offsets.push_back(trel + 32*ui);
-		cap->m_durations.push_back(ui);
-		cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_RTR, rtr));
-
-		cap->m_offsets.push_back(trel + 33*ui);
-		cap->m_durations.push_back(ui);
-		cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_FD, 0));
-
-		cap->m_offsets.push_back(trel + 34*ui);
-		cap->m_durations.push_back(ui);
-		cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_R0, 0));
-
-		cap->m_offsets.push_back(trel + 35*ui);
-		cap->m_durations.push_back(ui*4);
-		cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_DLC, frame.can_dlc));
-
-		//Data
-		for(int i=0; i<frame.can_dlc; i++)
+		vector<size_t> wptr(nchans);
+		for(size_t i=0; i<nchans; i++)
 		{
-			cap->m_offsets.push_back(trel + 39*ui + i*8*ui);
-			cap->m_durations.push_back(ui*8);
-			cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_DATA, frame.data[i]));
+			wptr[i] = caps[i]->size();
+			caps[i]->Resize(wptr[i] + nsyms[i]);
 		}
 
-		//Find end of the packet
-		tLastEnd = trel + (39 + (frame.can_dlc*8)) * ui;
-
-		//Every 100 packets check timeout, after 50ms of acquisition stop
-		npackets ++;
-		if( (npackets % 100) == 0)
+		for(size_t i=0; i<nframes; i++)
 		{
-			//get elapsed time
-			timespec t;
-			clock_gettime(CLOCK_REALTIME,&t);
-			dsec = t.tv_sec - m_startSec;
-			dnsec = t.tv_nsec - m_startNsec;
+			auto& frame = frames[i];
+
+			//If the packet is an error, discard and move on
+			if(frame.frame.can_id & CAN_ERR_FLAG)
+				continue;
+
+			//Calculate delay since start of capture, wrapping properly around second boundaries
+			int64_t dsec = frame.sec - m_startSec;
+			int64_t dnsec = frame.ns - m_startNsec;
 			if(dnsec < 0)
 			{
 				dsec --;
 				dnsec += 1e9;
 			}
 
-			if( (dsec > 1) || (dnsec > 5e7) )
-				break;
+			int64_t trel = dsec * FS_PER_SECOND + dnsec*1e6;
+
+			//if last packet hasnt ended, there was a timestamping roundoff
+			//bump our start to match
+			auto iface = frame.iface;
+			if(trel <= tLastEnd[iface])
+				trel = tLastEnd[iface] + ui;
+
+			wptr[iface] += WriteFrame(caps[iface], wptr[iface], frame, trel, ui);
+
+			//Find end of the packet
+			tLastEnd[iface] = trel + (39 + (frame.frame.len*8)) * ui;
+		}
+
+		//After each batch check timeout, after 50ms of acquisition stop
+		timespec t;
+		clock_gettime(CLOCK_REALTIME,&t);
+		int64_t dsec = t.tv_sec - m_startSec;
+		int64_t dnsec = t.tv_nsec - m_startNsec;
+		if(dnsec < 0)
+		{
+			dsec --;
+			dnsec += 1e9;
 		}
-	}
 
-	cap->MarkModifiedFromCpu();
+		if( (dsec > 1) || (dnsec > 5e7) )
+			break;
+	}
 
-	//Save newly created waveform
-	m_pendingWaveformsMutex.lock();
-		SequenceSet s;
-		s[m_channels[0]] = cap;
-		m_pendingWaveforms.push_back(s);
-	m_pendingWaveformsMutex.unlock();
+	//Save newly created waveforms
+	SequenceSet s;
+	for(size_t i=0; i<nchans; i++)
+	{
+		caps[i]->MarkModifiedFromCpu();
+		s[m_channels[i]] = caps[i];
+	}
+	PushPendingWaveform(s);
 
 	if(m_triggerOneShot)
 		m_triggerArmed = false;
@@ -364,11 +398,7 @@ void SocketCANAnalyzer::Start()
 	m_triggerOneShot = false;
 
 	m_appendingNext = false;
-
-	timespec t;
-	clock_gettime(CLOCK_REALTIME,&t);
-	m_startSec = t.tv_sec;
-	m_startNsec = t.tv_nsec;
+	ResetCaptureStart();
 }
 
 void SocketCANAnalyzer::StartSingleTrigger()
@@ -377,11 +407,22 @@ void SocketCANAnalyzer::StartSingleTrigger()
 	m_triggerOneShot = true;
 
 	m_appendingNext = false;
+	ResetCaptureStart();
+}
 
+/**
+	@brief Marks the current time as the start of a new capture
+ */
+void SocketCANAnalyzer::ResetCaptureStart()
+{
 	timespec t;
 	clock_gettime(CLOCK_REALTIME,&t);
 	m_startSec = t.tv_sec;
 	m_startNsec = t.tv_nsec;
+
+	auto transport = dynamic_cast<SCPISocketCANTransport*>(m_transport);
+	if(transport)
+		transport->ResetTimestampAnchors();
 }
 
 void SocketCANAnalyzer::Stop()
@@ -112,6 +112,13 @@ public:
 	virtual bool IsAppendingToWaveform() override;
 
 protected:
+	void ResetCaptureStart();
+
+	///@brief Number of CANSymbols WriteFrame() generates for a frame
+	static size_t GetSymbolCount(const SocketCANFrame& frame)
+	{ return 6 + frame.frame.len; }
+
+	size_t WriteFrame(CANWaveform* cap, size_t base, const SocketCANFrame& frame, int64_t trel, int64_t ui);
 
 	///@brief True if the trigger is armed
 	bool m_triggerArmed;
@@ -0,0 +1,705 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of SoftwareTrigger
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "SoftwareTrigger.h"
+#include "EdgeTrigger.h"
+#include "PulseWidthTrigger.h"
+#include "GlitchTrigger.h"
+#include "RuntTrigger.h"
+#include "SlewRateTrigger.h"
+#include "WindowTrigger.h"
+#include "DropoutTrigger.h"
+#include "UartTrigger.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates an engine for a trigger
+
+	The trigger is not owned, and its settings are re-read on every call to Process().
+
+	@param trig		The trigger to evaluate (see IsSupported())
+ */
+SoftwareTrigger::SoftwareTrigger(Trigger* trig)
+	: m_trigger(trig)
+	, m_holdoff(0)
+{
+	Reset();
+}
+
+/**
+	@brief Checks if a trigger can be evaluated in software
+
+	@param trig		The trigger to check
+ */
+bool SoftwareTrigger::IsSupported(Trigger* trig)
+{
+	return
+		(dynamic_cast<EdgeTrigger*>(trig) != nullptr) ||
+		(dynamic_cast<RuntTrigger*>(trig) != nullptr) ||
+		(dynamic_cast<SlewRateTrigger*>(trig) != nullptr) ||
+		(dynamic_cast<WindowTrigger*>(trig) != nullptr) ||
+		(dynamic_cast<DropoutTrigger*>(trig) != nullptr) ||
+		(dynamic_cast<UartTrigger*>(trig) != nullptr);
+}
+
+/**
+	@brief Forgets all state carried over from previous blocks
+
+	Call this whenever the next block does not directly follow the last one (e.g. after samples were dropped).
+ */
+void SoftwareTrigger::Reset()
+{
+	m_hasLastTrigger = false;
+	m_lastTrigger = 0;
+	m_history.clear();
+	m_hasLastSample = false;
+	m_lastSample = 0;
+	m_blockLength = 0;
+	m_timescale = 0;
+	m_nextAlternateRising = true;
+	m_uartResume = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Evaluation
+
+/**
+	@brief Evaluates the trigger on the next block of samples
+
+	@param wfm	A UniformAnalogWaveform or SparseAnalogWaveform directly following the previous block
+
+	@return Times at which the trigger fired, in X axis units from the first sample of the block, in ascending order
+ */
+vector<int64_t> SoftwareTrigger::Process(WaveformBase* wfm)
+{
+	vector<int64_t> triggers;
+
+	auto udin = dynamic_cast<UniformAnalogWaveform*>(wfm);
+	auto sdin = dynamic_cast<SparseAnalogWaveform*>(wfm);
+	if( (!udin && !sdin) || wfm->empty())
+		return triggers;
+	wfm->PrepareForCpuAccess();
+
+	size_t last = wfm->size() - 1;
+	m_timescale = wfm->m_timescale;
+	if(udin)
+		m_blockLength = wfm->size() * m_timescale;
+	else
+		m_blockLength = (::GetOffset(sdin, last) + ::GetDuration(sdin, last)) * m_timescale;
+
+	//Candidate detection: crossings of one or both levels, merged into time order after the history
+	vector<Event> events = m_history;
+	auto tlt = dynamic_cast<TwoLevelTrigger*>(m_trigger);
+	if(tlt)
+	{
+		float lo = tlt->GetLowerBound();
+		float hi = tlt->GetUpperBound();
+		if(lo > hi)
+			swap(lo, hi);
+
+		vector<Event> upper;
+		FindEvents(wfm, lo, 0, events);
+		FindEvents(wfm, hi, 1, upper);
+
+		//History is all before this block, so history plus lower level crossings is already in order.
+		//Edges crossing both levels between the same two samples must still cross them in order.
+		size_t mid = events.size();
+		events.insert(events.end(), upper.begin(), upper.end());
+		inplace_merge(events.begin(), events.begin() + mid, events.end(),
+			[](const Event& a, const Event& b)
+			{
+				if(a.m_time != b.m_time)
+					return a.m_time < b.m_time;
+				return a.m_rising ? (a.m_level < b.m_level) : (a.m_level > b.m_level);
+			});
+	}
+	else
+		FindEvents(wfm, m_trigger->GetLevel(), 0, events);
+
+	//Qualification, in order (most derived trigger types first)
+	if(auto pw = dynamic_cast<PulseWidthTrigger*>(m_trigger))
+		QualifyPulseWidth(pw, events, triggers);
+	else if(auto gt = dynamic_cast<GlitchTrigger*>(m_trigger))
+		QualifyPulseWidth(gt, events, triggers);
+	else if(dynamic_cast<EdgeTrigger*>(m_trigger))
+		QualifyEdge(events, triggers);
+	else if(dynamic_cast<RuntTrigger*>(m_trigger))
+		QualifyRunt(events, triggers);
+	else if(dynamic_cast<SlewRateTrigger*>(m_trigger))
+		QualifySlewRate(events, triggers);
+	else if(dynamic_cast<WindowTrigger*>(m_trigger))
+		QualifyWindow(events, triggers);
+	else if(dynamic_cast<DropoutTrigger*>(m_trigger))
+		QualifyDropout(events, triggers);
+	else if(dynamic_cast<UartTrigger*>(m_trigger))
+		QualifyUart(events, triggers);
+
+	//Carry over the most recent crossings, plus everything in a UART frame still being received
+	size_t keep = min(events.size(), static_cast<size_t>(HISTORY_EVENTS));
+	if(dynamic_cast<UartTrigger*>(m_trigger))
+	{
+		while( (keep < events.size()) && (events[events.size() - keep - 1].m_time >= m_uartResume) )
+			keep ++;
+	}
+	m_history.assign(events.end() - keep, events.end());
+
+	//Rebase everything we keep on the start of the next block
+	for(auto& e : m_history)
+		e.m_time -= m_blockLength;
+	m_lastTrigger -= m_blockLength;
+	m_uartResume -= m_blockLength;
+
+	m_lastSample = udin ? udin->m_samples[last] : sdin->m_samples[last];
+	m_hasLastSample = true;
+
+	return triggers;
+}
+
+/**
+	@brief Finds the crossings of one level in the current block
+
+	A crossing between the last sample of the previous block and the first sample of this one is reported at the
+	start of this block.
+
+	@param wfm			The current block
+	@param threshold	The level to look for
+	@param level		Level index to tag the events with
+	@param events		Crossings are appended to this list
+ */
+void SoftwareTrigger::FindEvents(WaveformBase* wfm, float threshold, uint8_t level, vector<Event>& events)
+{
+	auto udin = dynamic_cast<UniformAnalogWaveform*>(wfm);
+	float first = udin ? udin->m_samples[0] : dynamic_cast<SparseAnalogWaveform*>(wfm)->m_samples[0];
+	bool high = first > threshold;
+
+	if(m_hasLastSample && ( (m_lastSample > threshold) != high) )
+		events.push_back({0, level, high});
+
+	//Crossings alternate in direction, starting away from the state of the first sample
+	auto list = LevelCrossingList::Get(wfm, threshold);
+	for(size_t i=0; i<list->size(); i++)
+	{
+		high = !high;
+		events.push_back({list->m_crossings[i], level, high});
+	}
+}
+
+/**
+	@brief Applies hold-off to a candidate trigger, and records it if accepted
+
+	Candidates outside the current block are ignored, since they were already considered in the block they fall in.
+
+	@param t			Time of the candidate, relative to the start of the current block
+	@param triggers		Accepted triggers are appended to this list
+
+	@return True if the trigger was accepted
+ */
+bool SoftwareTrigger::Accept(int64_t t, vector<int64_t>& triggers)
+{
+	if( (t < 0) || (t >= m_blockLength) )
+		return false;
+	if(m_hasLastTrigger && (t - m_lastTrigger < m_holdoff) )
+		return false;
+
+	triggers.push_back(t);
+	m_lastTrigger = t;
+	m_hasLastTrigger = true;
+	return true;
+}
+
+/**
+	@brief Checks a duration against a trigger condition
+
+	@param cond		The condition to check
+	@param value	Measured duration
+	@param lower	Lower bound of the condition
+	@param upper	Upper bound of the condition
+ */
+bool SoftwareTrigger::MatchCondition(Trigger::Condition cond, int64_t value, int64_t lower, int64_t upper)
+{
+	switch(cond)
+	{
+		case Trigger::CONDITION_EQUAL:
+			return llabs(value - lower) <= m_timescale;
+
+		case Trigger::CONDITION_NOT_EQUAL:
+			return llabs(value - lower) > m_timescale;
+
+		case Trigger::CONDITION_LESS:
+			return value < upper;
+
+		case Trigger::CONDITION_LESS_OR_EQUAL:
+			return value <= upper;
+
+		case Trigger::CONDITION_GREATER:
+			return value > lower;
+
+		case Trigger::CONDITION_GREATER_OR_EQUAL:
+			return value >= lower;
+
+		case Trigger::CONDITION_BETWEEN:
+			return (value >= lower) && (value <= upper);
+
+		case Trigger::CONDITION_NOT_BETWEEN:
+			return (value < lower) || (value > upper);
+
+		case Trigger::CONDITION_ANY:
+		default:
+			return true;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Qualification for each trigger type
+
+/**
+	@brief Fires on every crossing of the level in the selected direction
+ */
+void SoftwareTrigger::QualifyEdge(const vector<Event>& events, vector<int64_t>& triggers)
+{
+	auto type = dynamic_cast<EdgeTrigger*>(m_trigger)->GetType();
+	for(auto& e : events)
+	{
+		switch(type)
+		{
+			case EdgeTrigger::EDGE_RISING:
+				if(e.m_rising)
+					Accept(e.m_time, triggers);
+				break;
+
+			case EdgeTrigger::EDGE_FALLING:
+				if(!e.m_rising)
+					Accept(e.m_time, triggers);
+				break;
+
+			case EdgeTrigger::EDGE_ALTERNATING:
+				if( (e.m_rising == m_nextAlternateRising) && Accept(e.m_time, triggers) )
+					m_nextAlternateRising = !m_nextAlternateRising;
+				break;
+
+			case EdgeTrigger::EDGE_ANY:
+			default:
+				Accept(e.m_time, triggers);
+				break;
+		}
+	}
+}
+
+/**
+	@brief Fires at the end of each pulse whose width meets the condition
+
+	EDGE_RISING selects positive pulses (rising edge, then falling), EDGE_FALLING negative ones.
+
+	@param trig		A PulseWidthTrigger or GlitchTrigger
+ */
+template<class T>
+void SoftwareTrigger::QualifyPulseWidth(T* trig, const vector<Event>& events, vector<int64_t>& triggers)
+{
+	auto type = trig->GetType();
+	auto cond = trig->GetCondition();
+	int64_t lower = trig->GetLowerBound();
+	int64_t upper = trig->GetUpperBound();
+
+	for(size_t i=1; i<events.size(); i++)
+	{
+		auto& start = events[i-1];
+		if( (type == EdgeTrigger::EDGE_RISING) && !start.m_rising )
+			continue;
+		if( (type == EdgeTrigger::EDGE_FALLING) && start.m_rising )
+			continue;
+
+		if(MatchCondition(cond, events[i].m_time - start.m_time, lower, upper))
+			Accept(events[i].m_time, triggers);
+	}
+}
+
+/**
+	@brief Fires at the end of each pulse which crosses one level but not the other, if its width meets the condition
+
+	A positive runt rises through the lower level and falls back through it without reaching the upper one; a negative
+	runt is the mirror image. EDGE_RISING selects positive runts, EDGE_FALLING negative ones.
+ */
+void SoftwareTrigger::QualifyRunt(const vector<Event>& events, vector<int64_t>& triggers)
+{
+	auto trig = dynamic_cast<RuntTrigger*>(m_trigger);
+	auto slope = trig->GetSlope();
+	auto cond = trig->GetCondition();
+	int64_t lower = trig->GetLowerInterval();
+	int64_t upper = trig->GetUpperInterval();
+
+	for(size_t i=1; i<events.size(); i++)
+	{
+		auto& start = events[i-1];
+		auto& end = events[i];
+
+		//Two consecutive crossings of the same level mean the other level was never reached
+		if( (start.m_level != end.m_level) || (start.m_rising == end.m_rising) )
+			continue;
+
+		bool positive = (start.m_level == 0) && start.m_rising;
+		bool negative = (start.m_level == 1) && !start.m_rising;
+		if(!positive && !negative)
+			continue;
+		if( (slope == RuntTrigger::EDGE_RISING) && !positive )
+			continue;
+		if( (slope == RuntTrigger::EDGE_FALLING) && !negative )
+			continue;
+
+		if(MatchCondition(cond, end.m_time - start.m_time, lower, upper))
+			Accept(end.m_time, triggers);
+	}
+}
+
+/**
+	@brief Fires at the second level crossing of each edge whose transition time meets the condition
+ */
+void SoftwareTrigger::QualifySlewRate(const vector<Event>& events, vector<int64_t>& triggers)
+{
+	auto trig = dynamic_cast<SlewRateTrigger*>(m_trigger);
+	auto slope = trig->GetSlope();
+	auto cond = trig->GetCondition();
+	int64_t lower = trig->GetLowerInterval();
+	int64_t upper = trig->GetUpperInterval();
+
+	for(size_t i=1; i<events.size(); i++)
+	{
+		auto& start = events[i-1];
+		auto& end = events[i];
+
+		bool rising = start.m_rising && end.m_rising && (start.m_level == 0) && (end.m_level == 1);
+		bool falling = !start.m_rising && !end.m_rising && (start.m_level == 1) && (end.m_level == 0);
+		if(!rising && !falling)
+			continue;
+		if( (slope == SlewRateTrigger::EDGE_RISING) && !rising )
+			continue;
+		if( (slope == SlewRateTrigger::EDGE_FALLING) && !falling )
+			continue;
+
+		if(MatchCondition(cond, end.m_time - start.m_time, lower, upper))
+			Accept(end.m_time, triggers);
+	}
+}
+
+/**
+	@brief Fires on entry to or exit from the window between the two levels
+
+	Every crossing of either level moves the signal into or out of the window, so the time spent in the previous
+	state is always the time since the previous crossing. For the timed modes the crossing direction selects which
+	level the signal must leave (or enter) through; CROSS_NONE fires as soon as the signal has stayed inside (or
+	outside) for the set width, without waiting for it to leave.
+ */
+void SoftwareTrigger::QualifyWindow(const vector<Event>& events, vector<int64_t>& triggers)
+{
+	auto trig = dynamic_cast<WindowTrigger*>(m_trigger);
+	auto type = trig->GetWindowType();
+	auto dir = trig->GetCrossingDirection();
+	int64_t width = trig->GetWidth();
+
+	bool timed = (type == WindowTrigger::WINDOW_EXIT_TIMED) || (type == WindowTrigger::WINDOW_ENTER_TIMED);
+	bool wantEntry = (type == WindowTrigger::WINDOW_ENTER) || (type == WindowTrigger::WINDOW_ENTER_TIMED);
+
+	for(size_t i=0; i<events.size(); i++)
+	{
+		auto& e = events[i];
+		bool entry = (e.m_level == 0) == e.m_rising;
+
+		if(timed && (dir == WindowTrigger::CROSS_NONE) )
+		{
+			//Timer starts when the signal enters the state we're timing, and is cancelled when it leaves
+			if(entry == wantEntry)
+				continue;
+			int64_t t = e.m_time + width;
+			if( (i+1 < events.size()) && (events[i+1].m_time < t) )
+				continue;
+			Accept(t, triggers);
+			continue;
+		}
+
+		if(entry != wantEntry)
+			continue;
+		if(timed)
+		{
+			if( (dir == WindowTrigger::CROSS_UPPER) && (e.m_level != 1) )
+				continue;
+			if( (dir == WindowTrigger::CROSS_LOWER) && (e.m_level != 0) )
+				continue;
+			if( (i == 0) || (e.m_time - events[i-1].m_time < width) )
+				continue;
+		}
+		Accept(e.m_time, triggers);
+	}
+}
+
+/**
+	@brief Fires when no edge of the selected type has been seen for the dropout time
+
+	With RESET_OPPOSITE, edges in the other direction restart the timer as well.
+ */
+void SoftwareTrigger::QualifyDropout(const vector<Event>& events, vector<int64_t>& triggers)
+{
+	auto trig = dynamic_cast<DropoutTrigger*>(m_trigger);
+	auto type = trig->GetType();
+	bool anyEdge = (type == DropoutTrigger::EDGE_ANY) || (trig->GetResetType() == DropoutTrigger::RESET_OPPOSITE);
+	int64_t timeout = trig->GetDropoutTime();
+
+	//Times the timer was restarted
+	vector<int64_t> restarts;
+	for(auto& e : events)
+	{
+		if(anyEdge || (e.m_rising == (type == DropoutTrigger::EDGE_RISING)) )
+			restarts.push_back(e.m_time);
+	}
+
+	for(size_t i=0; i<restarts.size(); i++)
+	{
+		int64_t t = restarts[i] + timeout;
+		if( (i+1 < restarts.size()) && (restarts[i+1] < t) )
+			continue;
+		Accept(t, triggers);
+	}
+}
+
+/**
+	@brief Decodes UART frames and fires on the selected part of them
+
+	Bits are sampled in the middle of each UI, timed from the start bit edge. TYPE_START fires on the start bit edge;
+	the other match types fire in the middle of the stop bit, once the frame is complete.
+
+	The pattern (GetPattern1(), and GetPattern2() for ranges) is compared against each byte on its own. If it has more
+	than 8 bits only the first byte is used; an empty pattern matches every byte.
+ */
+void SoftwareTrigger::QualifyUart(const vector<Event>& events, vector<int64_t>& triggers)
+{
+	auto trig = dynamic_cast<UartTrigger*>(m_trigger);
+	auto parity = trig->GetParityType();
+	auto match = trig->GetMatchType();
+	auto cond = trig->GetCondition();
+	bool idleHigh = (trig->GetPolarity() == UartTrigger::IDLE_HIGH);
+	int64_t baud = trig->GetBitRate();
+	if(baud <= 0)
+		return;
+	int64_t ui = FS_PER_SECOND / baud;
+
+	//Parse the patterns (ternary, MSB first)
+	auto p1 = trig->GetPattern1();
+	auto p2 = trig->GetPattern2();
+	uint8_t mask = 0;
+	uint8_t value1 = 0;
+	uint8_t value2 = 0;
+	for(size_t i=0; i<8; i++)
+	{
+		mask <<= 1;
+		value1 <<= 1;
+		value2 <<= 1;
+		if( (i < p1.length()) && (tolower(p1[i]) != 'x') )
+		{
+			mask |= 1;
+			if(p1[i] == '1')
+				value1 |= 1;
+		}
+		if( (i < p2.length()) && (p2[i] == '1') )
+			value2 |= 1;
+	}
+	if(p1.empty())
+		cond = Trigger::CONDITION_ANY;
+
+	size_t nbits = (parity == UartTrigger::PARITY_NONE) ? 9 : 10;
+	for(size_t i=0; i<events.size(); i++)
+	{
+		//Look for the next edge away from idle
+		auto& start = events[i];
+		if( (start.m_rising == idleHigh) || (start.m_time < m_uartResume) )
+			continue;
+		int64_t tstart = start.m_time;
+
+		if(match == UartTrigger::TYPE_START)
+			Accept(tstart, triggers);
+
+		//Wait for the rest of the frame to arrive if it's not all here
+		int64_t tstop = tstart + ui*nbits + ui/2;
+		if(tstop >= m_blockLength)
+		{
+			m_uartResume = tstart;
+			return;
+		}
+
+		//Sample the start bit, data and parity. Bits are high in the idle state.
+		uint16_t bits = 0;
+		size_t j = i;
+		for(size_t k=0; k<nbits; k++)
+		{
+			int64_t tsample = tstart + ui*k + ui/2;
+			while( (j+1 < events.size()) && (events[j+1].m_time <= tsample) )
+				j++;
+			if(events[j].m_rising == idleHigh)
+				bits |= (1 << k);
+		}
+
+		//Start bit not still active in the middle of the UI? It was a glitch, look for the next edge
+		if(bits & 1)
+		{
+			m_uartResume = tstart + 1;
+			continue;
+		}
+		m_uartResume = tstop;
+
+		uint8_t data = (bits >> 1) & 0xff;
+		bool parityBit = (bits >> 9) & 1;
+		bool parityError = false;
+		switch(parity)
+		{
+			case UartTrigger::PARITY_ODD:
+				parityError = (__builtin_popcount(data) & 1) == parityBit;
+				break;
+
+			case UartTrigger::PARITY_EVEN:
+				parityError = (__builtin_popcount(data) & 1) != parityBit;
+				break;
+
+			case UartTrigger::PARITY_MARK:
+				parityError = !parityBit;
+				break;
+
+			case UartTrigger::PARITY_SPACE:
+				parityError = parityBit;
+				break;
+
+			case UartTrigger::PARITY_NONE:
+			default:
+				break;
+		}
+
+		switch(match)
+		{
+			case UartTrigger::TYPE_DATA:
+				{
+					//Equality honors don't care bits, ordered comparisons use the whole byte with them as zeroes
+					bool hit;
+					if(cond == Trigger::CONDITION_EQUAL)
+						hit = (data & mask) == value1;
+					else if(cond == Trigger::CONDITION_NOT_EQUAL)
+						hit = (data & mask) != value1;
+					else if( (cond == Trigger::CONDITION_BETWEEN) || (cond == Trigger::CONDITION_NOT_BETWEEN) )
+						hit = MatchCondition(cond, data, value1, value2);
+					else
+						hit = MatchCondition(cond, data, value1, value1);
+
+					if(hit)
+						Accept(tstop, triggers);
+				}
+				break;
+
+			case UartTrigger::TYPE_PARITY_ERR:
+				if(parityError)
+					Accept(tstop, triggers);
+				break;
+
+			case UartTrigger::TYPE_STOP:
+				Accept(tstop, triggers);
+				break;
+
+			case UartTrigger::TYPE_START:
+			default:
+				break;
+		}
+	}
+
+	//No frame in progress, so the next one can't start before the end of this block
+	m_uartResume = max(m_uartResume, m_blockLength);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Waveform slicing
+
+/**
+	@brief Copies the samples around a trigger into a new waveform
+
+	The slice is aligned so that the trigger falls at X = pretrigger, and is truncated if it would extend past either
+	end of the source block.
+
+	@param src			The block the trigger was found in
+	@param triggerTime	Time of the trigger, as returned by Process()
+	@param pretrigger	Time to include before the trigger, in X axis units
+	@param length		Total length of the slice, in X axis units
+
+	@return The new waveform (owned by the caller), or nullptr if no samples fall inside the slice
+ */
+UniformAnalogWaveform* SoftwareTrigger::Slice(
+	UniformAnalogWaveform* src,
+	int64_t triggerTime,
+	int64_t pretrigger,
+	int64_t length)
+{
+	if( (src->m_timescale <= 0) || (length <= 0) )
+		return nullptr;
+
+	//Find the range of samples to copy
+	int64_t tstart = triggerTime - pretrigger;
+	int64_t first = (tstart - src->m_triggerPhase) / src->m_timescale;
+	int64_t end = (tstart + length - src->m_triggerPhase + src->m_timescale - 1) / src->m_timescale;
+	first = max(first, (int64_t)0);
+	end = min(end, (int64_t)src->size());
+	if(end <= first)
+		return nullptr;
+	size_t len = end - first;
+
+	auto cap = new UniformAnalogWaveform;
+	cap->m_timescale = src->m_timescale;
+	cap->m_triggerPhase = src->m_triggerPhase + first*src->m_timescale - tstart;
+
+	//Start time of the slice, carrying whole seconds over from the femtosecond field
+	int64_t fs = src->m_startFemtoseconds + tstart;
+	int64_t sec = fs / (int64_t)FS_PER_SECOND;
+	fs %= (int64_t)FS_PER_SECOND;
+	if(fs < 0)
+	{
+		fs += FS_PER_SECOND;
+		sec --;
+	}
+	cap->m_startTimestamp = src->m_startTimestamp + sec;
+	cap->m_startFemtoseconds = fs;
+
+	src->PrepareForCpuAccess();
+	cap->Resize(len);
+	memcpy(cap->m_samples.GetCpuPointer(), src->m_samples.GetCpuPointer() + first, len * sizeof(float));
+	cap->MarkSamplesModifiedFromCpu();
+
+	return cap;
+}
@@ -0,0 +1,158 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of SoftwareTrigger
+	@ingroup core
+ */
+
+#ifndef SoftwareTrigger_h
+#define SoftwareTrigger_h
+
+/**
+	@brief Host side evaluation of a Trigger on streamed or imported analog data
+	@ingroup core
+
+	Trigger objects normally only hold configuration that drivers push to the hardware. Streaming instruments and
+	imported data have nothing to evaluate it, so this class does: each call to Process() is handed the next
+	contiguous block of samples and returns the times at which the trigger fires within it.
+
+	Evaluation is in two stages. Candidate detection, the part which touches every sample, is the threshold crossing
+	search of LevelCrossingList (on the GPU for large blocks, and cached on the waveform so other consumers of the
+	same crossings don't search again). Qualification then walks the much shorter list of crossings in order on the
+	CPU, checking pulse widths, runts, slew times, windows, dropouts or UART frames.
+
+	Supported trigger types are EdgeTrigger, PulseWidthTrigger, GlitchTrigger, RuntTrigger, SlewRateTrigger,
+	WindowTrigger, DropoutTrigger and UartTrigger (8 data bits). Only analog inputs are supported.
+
+	Enough state is carried over between blocks (the last few crossings, the hold-off timer and any partially decoded
+	UART frame) that pulses, timeouts and frames straddling a block boundary are found, in the block where they
+	complete. Blocks are assumed to follow each other without gaps; call Reset() after a discontinuity.
+
+	Comparisons with CONDITION_LESS(_OR_EQUAL) use the upper bound and CONDITION_GREATER(_OR_EQUAL) the lower bound,
+	as for hardware triggers. CONDITION_EQUAL matches within one sample period of the lower bound.
+ */
+class SoftwareTrigger
+{
+public:
+	SoftwareTrigger(Trigger* trig);
+
+	static bool IsSupported(Trigger* trig);
+
+	std::vector<int64_t> Process(WaveformBase* wfm);
+	void Reset();
+
+	/**
+		@brief Sets the minimum time from one trigger to the next
+
+		@param holdoff	Hold-off time, in X axis units (fs)
+	 */
+	void SetHoldoff(int64_t holdoff)
+	{ m_holdoff = holdoff; }
+
+	///@brief Gets the minimum time from one trigger to the next, in X axis units (fs)
+	int64_t GetHoldoff()
+	{ return m_holdoff; }
+
+	static UniformAnalogWaveform* Slice(
+		UniformAnalogWaveform* src,
+		int64_t triggerTime,
+		int64_t pretrigger,
+		int64_t length);
+
+protected:
+
+	/**
+		@brief A crossing of one of the trigger levels
+	 */
+	class Event
+	{
+	public:
+		///@brief Time of the crossing, relative to the first sample of the current block
+		int64_t m_time;
+
+		///@brief Which level was crossed (0 for single level triggers or the lower level, 1 for the upper level)
+		uint8_t m_level;
+
+		///@brief True if the signal went from below to above the level
+		bool m_rising;
+	};
+
+	void FindEvents(WaveformBase* wfm, float threshold, uint8_t level, std::vector<Event>& events);
+	bool Accept(int64_t t, std::vector<int64_t>& triggers);
+	bool MatchCondition(Trigger::Condition cond, int64_t value, int64_t lower, int64_t upper);
+
+	void QualifyEdge(const std::vector<Event>& events, std::vector<int64_t>& triggers);
+	template<class T>
+	void QualifyPulseWidth(T* trig, const std::vector<Event>& events, std::vector<int64_t>& triggers);
+	void QualifyRunt(const std::vector<Event>& events, std::vector<int64_t>& triggers);
+	void QualifySlewRate(const std::vector<Event>& events, std::vector<int64_t>& triggers);
+	void QualifyWindow(const std::vector<Event>& events, std::vector<int64_t>& triggers);
+	void QualifyDropout(const std::vector<Event>& events, std::vector<int64_t>& triggers);
+	void QualifyUart(const std::vector<Event>& events, std::vector<int64_t>& triggers);
+
+	///@brief Number of most recent crossings always carried over to the next block
+	static const size_t HISTORY_EVENTS = 4;
+
+	///@brief The trigger being evaluated
+	Trigger* m_trigger;
+
+	///@brief Minimum time between triggers
+	int64_t m_holdoff;
+
+	///@brief True if m_lastTrigger is valid
+	bool m_hasLastTrigger;
+
+	///@brief Time of the most recent trigger, relative to the first sample of the current block
+	int64_t m_lastTrigger;
+
+	///@brief Crossings carried over from previous blocks, relative to the first sample of the current block
+	std::vector<Event> m_history;
+
+	///@brief True if m_lastSample is valid
+	bool m_hasLastSample;
+
+	///@brief Value of the last sample of the previous block, to find crossings across the block boundary
+	float m_lastSample;
+
+	///@brief Length of the current block, in X axis units
+	int64_t m_blockLength;
+
+	///@brief Sample period of the current block
+	int64_t m_timescale;
+
+	///@brief Edge direction of the next trigger, for EdgeTrigger::EDGE_ALTERNATING
+	bool m_nextAlternateRising;
+
+	///@brief UART frames may only start after this time (end of the last frame decoded), relative to the block
+	int64_t m_uartResume;
+};
+
+#endif
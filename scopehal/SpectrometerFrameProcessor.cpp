@@ -0,0 +1,239 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of SpectrometerFrameProcessor
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "SpectrometerFrameProcessor.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates the processor
+
+	@param name		Name of the owning driver, used to label Vulkan objects
+	@param npoints	Number of points in each frame
+	@param reverse	True if raw frames are in the opposite order to the desired outputs
+ */
+SpectrometerFrameProcessor::SpectrometerFrameProcessor(const string& name, size_t npoints, bool reverse)
+	: m_npoints(npoints)
+	, m_reverse(reverse)
+	, m_averaging(1)
+	, m_framesCommitted(0)
+	, m_frames(name + ".frames")
+	, m_flatcal(name + ".flatcal")
+	, m_irrcal(name + ".irrcal")
+{
+	//Frames are written by the CPU as they arrive, then read once by the GPU
+	m_frames.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_frames.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_frames.resize(m_npoints);
+
+	if(!g_gpuFilterEnabled)
+		return;
+
+	m_queue = g_vkQueueManager->GetComputeQueue(name + ".frameQueue");
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		m_queue->m_family );
+	m_pool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(**m_pool, vk::CommandBufferLevel::ePrimary, 1);
+	m_cmdBuf = make_unique<vk::raii::CommandBuffer>(
+		std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	m_pipeline = make_unique<ComputePipeline>(
+		"shaders/SpectrometerFrameCorrection.spv", 7, sizeof(SpectrometerFrameConstants));
+}
+
+SpectrometerFrameProcessor::~SpectrometerFrameProcessor()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Configuration
+
+/**
+	@brief Sets the number of frames averaged into (and decimated to) each output
+
+	Any frames already in the ring are discarded.
+ */
+void SpectrometerFrameProcessor::SetAveraging(size_t nframes)
+{
+	m_averaging = max(nframes, (size_t)1);
+	m_framesCommitted = 0;
+	m_frames.resize(m_averaging * m_npoints);
+}
+
+/**
+	@brief Sets the flatness and irradiance calibration coefficients
+
+	@param flatcal	Flatness calibration, in display order
+	@param irrcal	Irradiance calibration, in display order. If empty, all ones.
+ */
+void SpectrometerFrameProcessor::SetCalibration(const vector<float>& flatcal, const vector<float>& irrcal)
+{
+	m_flatcal.CopyFrom(flatcal);
+
+	if(irrcal.empty())
+	{
+		m_irrcal.resize(m_npoints);
+		m_irrcal.PrepareForCpuAccess();
+		for(size_t i=0; i<m_npoints; i++)
+			m_irrcal[i] = 1;
+		m_irrcal.MarkModifiedFromCpu();
+	}
+	else
+		m_irrcal.CopyFrom(irrcal);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Processing
+
+/**
+	@brief Averages and corrects the frames in the ring, then empties it
+
+	Outputs are resized to the frame size and left GPU resident if the GPU was used.
+
+	@param dark				Dark frame to subtract, in display order, or null for none
+	@param exposureScale	Factor to normalize flattened counts by (e.g. reference exposure / actual exposure)
+	@param irradianceScale	Factor converting flattened counts times irradiance calibration to absolute irradiance
+	@param rawOut			Averaged raw counts
+	@param flatOut			Dark frame and flatness corrected counts
+	@param irrOut			Absolute irradiance
+ */
+void SpectrometerFrameProcessor::Process(
+	AcceleratorBuffer<float>* dark,
+	float exposureScale,
+	float irradianceScale,
+	AcceleratorBuffer<float>& rawOut,
+	AcceleratorBuffer<float>& flatOut,
+	AcceleratorBuffer<float>& irrOut)
+{
+	if( (m_framesCommitted == 0) || (m_npoints == 0) )
+		return;
+
+	//A dark frame of the wrong size (e.g. from a different detector) is useless
+	if(dark && (dark->size() < m_npoints))
+		dark = nullptr;
+
+	rawOut.resize(m_npoints);
+	flatOut.resize(m_npoints);
+	irrOut.resize(m_npoints);
+
+	if(!m_pipeline)
+		ProcessOnCpu(dark, exposureScale, irradianceScale, rawOut, flatOut, irrOut);
+
+	else
+	{
+		m_frames.MarkModifiedFromCpu();
+
+		SpectrometerFrameConstants push;
+		push.npoints = m_npoints;
+		push.nframes = m_framesCommitted;
+		push.reverse = m_reverse;
+		push.hasDark = (dark != nullptr);
+		push.exposureScale = exposureScale;
+		push.irradianceScale = irradianceScale;
+
+		m_cmdBuf->begin({});
+
+		//Without a dark frame the binding is never read, but it has to be bound to something
+		m_pipeline->BindBufferNonblocking(0, m_frames, *m_cmdBuf);
+		m_pipeline->BindBufferNonblocking(1, dark ? *dark : m_flatcal, *m_cmdBuf);
+		m_pipeline->BindBufferNonblocking(2, m_flatcal, *m_cmdBuf);
+		m_pipeline->BindBufferNonblocking(3, m_irrcal, *m_cmdBuf);
+		m_pipeline->BindBufferNonblocking(4, rawOut, *m_cmdBuf, true);
+		m_pipeline->BindBufferNonblocking(5, flatOut, *m_cmdBuf, true);
+		m_pipeline->BindBufferNonblocking(6, irrOut, *m_cmdBuf, true);
+
+		const uint32_t compute_block_count = GetComputeBlockCount(m_npoints, 64);
+		m_pipeline->Dispatch(*m_cmdBuf, push,
+			min(compute_block_count, 32768u),
+			compute_block_count / 32768 + 1);
+
+		m_cmdBuf->end();
+		m_queue->SubmitAndBlock(*m_cmdBuf);
+
+		rawOut.MarkModifiedFromGpu();
+		flatOut.MarkModifiedFromGpu();
+		irrOut.MarkModifiedFromGpu();
+	}
+
+	m_framesCommitted = 0;
+}
+
+void SpectrometerFrameProcessor::ProcessOnCpu(
+	AcceleratorBuffer<float>* dark,
+	float exposureScale,
+	float irradianceScale,
+	AcceleratorBuffer<float>& rawOut,
+	AcceleratorBuffer<float>& flatOut,
+	AcceleratorBuffer<float>& irrOut)
+{
+	m_frames.PrepareForCpuAccess();
+	m_flatcal.PrepareForCpuAccess();
+	m_irrcal.PrepareForCpuAccess();
+	if(dark)
+		dark->PrepareForCpuAccess();
+	rawOut.PrepareForCpuAccess();
+	flatOut.PrepareForCpuAccess();
+	irrOut.PrepareForCpuAccess();
+
+	float* frames = m_frames.GetCpuPointer();
+	size_t last = m_npoints - 1;
+	for(size_t i=0; i<m_npoints; i++)
+	{
+		size_t pixel = m_reverse ? (last - i) : i;
+
+		float sum = 0;
+		for(size_t k=0; k<m_framesCommitted; k++)
+			sum += frames[k*m_npoints + pixel];
+		float raw = sum / m_framesCommitted;
+		rawOut[i] = raw;
+
+		float d = dark ? (*dark)[i] : 0;
+		float flattened = ((raw - d) / m_flatcal[i]) * exposureScale;
+		flatOut[i] = flattened;
+
+		irrOut[i] = flattened * m_irrcal[i] * irradianceScale;
+	}
+
+	rawOut.MarkModifiedFromCpu();
+	flatOut.MarkModifiedFromCpu();
+	irrOut.MarkModifiedFromCpu();
+}
@@ -0,0 +1,150 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of SpectrometerFrameProcessor
+	@ingroup core
+ */
+
+#ifndef SpectrometerFrameProcessor_h
+#define SpectrometerFrameProcessor_h
+
+/**
+	@brief Push constants for SpectrometerFrameCorrection.glsl
+ */
+struct SpectrometerFrameConstants
+{
+	uint32_t npoints;
+	uint32_t nframes;
+	uint32_t reverse;
+	uint32_t hasDark;
+	float exposureScale;
+	float irradianceScale;
+};
+
+/**
+	@brief Helper for spectrometer drivers streaming frames faster than they can usefully be displayed
+
+	Raw frames are read straight into slots of a pinned ring buffer (GetNextFrame() / CommitFrame()). Once the ring
+	holds the configured number of frames, Process() runs a single dispatch which averages them, subtracts the dark
+	frame, applies flatness correction and exposure normalization, and produces the irradiance calibrated result.
+	Only that one set of outputs per N frames becomes a waveform.
+
+	Calibration vectors are in display order. Raw frames may be in reverse (detector pixel) order.
+ */
+class SpectrometerFrameProcessor
+{
+public:
+	SpectrometerFrameProcessor(const std::string& name, size_t npoints, bool reverse);
+	~SpectrometerFrameProcessor();
+
+	void SetAveraging(size_t nframes);
+
+	///@brief Gets the number of frames averaged into each output
+	size_t GetAveraging()
+	{ return m_averaging; }
+
+	///@brief Gets the number of points in each frame
+	size_t GetPointCount()
+	{ return m_npoints; }
+
+	///@brief Gets a pointer to the ring slot the next raw frame should be read into
+	float* GetNextFrame()
+	{
+		m_frames.PrepareForCpuAccess();
+		return m_frames.GetCpuPointer() + m_framesCommitted*m_npoints;
+	}
+
+	/**
+		@brief Marks the frame returned by GetNextFrame() as valid
+
+		@return True if the ring is now full and Process() should be called
+	 */
+	bool CommitFrame()
+	{
+		m_framesCommitted ++;
+		return (m_framesCommitted >= m_averaging);
+	}
+
+	void SetCalibration(const std::vector<float>& flatcal, const std::vector<float>& irrcal);
+
+	void Process(
+		AcceleratorBuffer<float>* dark,
+		float exposureScale,
+		float irradianceScale,
+		AcceleratorBuffer<float>& rawOut,
+		AcceleratorBuffer<float>& flatOut,
+		AcceleratorBuffer<float>& irrOut);
+
+protected:
+	void ProcessOnCpu(
+		AcceleratorBuffer<float>* dark,
+		float exposureScale,
+		float irradianceScale,
+		AcceleratorBuffer<float>& rawOut,
+		AcceleratorBuffer<float>& flatOut,
+		AcceleratorBuffer<float>& irrOut);
+
+	///@brief Number of points in each frame
+	size_t m_npoints;
+
+	///@brief True if raw frames are in the opposite order to the outputs
+	bool m_reverse;
+
+	///@brief Number of frames averaged into each output
+	size_t m_averaging;
+
+	///@brief Number of frames in the ring since the last Process()
+	size_t m_framesCommitted;
+
+	///@brief Raw frames, m_averaging slots of m_npoints each
+	AcceleratorBuffer<float> m_frames;
+
+	///@brief Flatness calibration coefficients, in display order
+	AcceleratorBuffer<float> m_flatcal;
+
+	///@brief Irradiance calibration coefficients, in display order
+	AcceleratorBuffer<float> m_irrcal;
+
+	///@brief Vulkan queue used for frame processing
+	std::shared_ptr<QueueHandle> m_queue;
+
+	///@brief Command pool from which m_cmdBuf was allocated
+	std::unique_ptr<vk::raii::CommandPool> m_pool;
+
+	///@brief Command buffer for frame processing
+	std::unique_ptr<vk::raii::CommandBuffer> m_cmdBuf;
+
+	///@brief Averaging and correction kernel
+	std::unique_ptr<ComputePipeline> m_pipeline;
+};
+
+#endif
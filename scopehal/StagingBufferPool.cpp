@@ -0,0 +1,82 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of StagingBufferPool
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "StagingBufferPool.h"
+
+using namespace std;
+
+mutex StagingBufferPool::m_poolsMutex;
+vector<StagingBufferPool::PoolBase*> StagingBufferPool::m_pools;
+
+/**
+	@brief Frees every buffer currently sitting in a pool
+
+	Buffers which are still borrowed are unaffected, and are pooled again when returned. Must be called before the
+	Vulkan device is destroyed.
+
+	@return True if memory was freed
+ */
+bool StagingBufferPool::Clear()
+{
+	return OnMemoryPressure(MemoryPressureLevel::Hard, MemoryPressureType::Host, 0);
+}
+
+/**
+	@brief Trims every pool in response to memory pressure
+
+	Called from the global OnMemoryPressure() handler. Pooled buffers are pinned host memory, so soft pressure on
+	device memory only matters on unified memory platforms.
+
+	@return True if memory was freed
+ */
+bool StagingBufferPool::OnMemoryPressure(
+	MemoryPressureLevel level,
+	MemoryPressureType type,
+	[[maybe_unused]] size_t requestedSize)
+{
+	if( (level == MemoryPressureLevel::Soft) && (type == MemoryPressureType::Device) && !g_vulkanDeviceHasUnifiedMemory)
+		return false;
+
+	lock_guard<mutex> lock(m_poolsMutex);
+
+	bool freed = false;
+	for(auto p : m_pools)
+	{
+		if(p->Trim(level))
+			freed = true;
+	}
+	return freed;
+}
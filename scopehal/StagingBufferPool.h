@@ -0,0 +1,232 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of StagingBufferPool
+	@ingroup core
+ */
+
+#ifndef StagingBufferPool_h
+#define StagingBufferPool_h
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+	@brief Process-wide pool of pinned host buffers for drivers to download raw sample data into
+	@ingroup core
+
+	Drivers used to read each acquisition into a fresh heap block, which costs a page fault per 4 kB on every
+	trigger and then a copy into pinned memory before the GPU can see the data. Buffers borrowed from this pool are
+	pinned (MEM_TYPE_CPU_DMA_CAPABLE) with the CPU and GPU views sharing one allocation, so a transport can read
+	straight into memory the GPU can read from directly: network to GPU with no intermediate CPU copy.
+
+	Borrow() returns a shared_ptr whose deleter hands the buffer back to the pool instead of freeing it, so a block
+	can be shared by everything referring to it (e.g. the segments of a SegmentedCapture) and is recycled as soon as
+	the last of them lets go. Free buffers are kept per element type, up to MAX_FREE_BUFFERS of each, and reused
+	without reallocating if they're big enough. In response to memory pressure (see OnMemoryPressure()), free
+	buffers are released.
+
+	The contents of a borrowed buffer are undefined.
+ */
+class StagingBufferPool
+{
+public:
+
+	///@brief Maximum number of free buffers of each element type kept for reuse
+	static constexpr size_t MAX_FREE_BUFFERS = 16;
+
+	/**
+		@brief Borrows a pinned buffer with room for at least count elements, and resizes it to count
+
+		@param count	Number of elements
+		@param name		Debug name for the buffer
+	 */
+	template<class T>
+	static std::shared_ptr<AcceleratorBuffer<T> > Borrow(size_t count, const std::string& name = "StagingBufferPool")
+	{
+		auto& pool = GetPool<T>();
+		auto buf = pool.Get(count);
+		buf->SetName(name);
+		buf->resize(count);
+		buf->PrepareForCpuAccess();
+		return std::shared_ptr<AcceleratorBuffer<T> >(buf, [&pool](AcceleratorBuffer<T>* b){ pool.Return(b); });
+	}
+
+	static bool Clear();
+	static bool OnMemoryPressure(MemoryPressureLevel level, MemoryPressureType type, size_t requestedSize);
+
+protected:
+
+	/**
+		@brief Free buffers of one element type, type erased so all of them can be trimmed together
+	 */
+	class PoolBase
+	{
+	public:
+		virtual ~PoolBase()
+		{}
+
+		virtual bool Trim(MemoryPressureLevel level) =0;
+	};
+
+	/**
+		@brief Free buffers of one element type
+	 */
+	template<class T>
+	class TypedPool : public PoolBase
+	{
+	public:
+
+		/**
+			@brief Gets the smallest free buffer with room for count elements, or a new one if there are none
+		 */
+		AcceleratorBuffer<T>* Get(size_t count)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				size_t best = SIZE_MAX;
+				for(size_t i=0; i<m_free.size(); i++)
+				{
+					auto cap = m_free[i]->capacity();
+					if( (cap >= count) && ( (best == SIZE_MAX) || (cap < m_free[best]->capacity()) ) )
+						best = i;
+				}
+
+				//Nothing big enough? Reuse the biggest we have anyway, growing it is no worse than a new one
+				if( (best == SIZE_MAX) && !m_free.empty())
+				{
+					best = 0;
+					for(size_t i=1; i<m_free.size(); i++)
+					{
+						if(m_free[i]->capacity() > m_free[best]->capacity())
+							best = i;
+					}
+				}
+
+				if(best != SIZE_MAX)
+				{
+					auto buf = m_free[best];
+					m_free.erase(m_free.begin() + best);
+					return buf;
+				}
+			}
+
+			//Pinned, and used as-is by the GPU rather than copied to device memory
+			auto buf = new AcceleratorBuffer<T>;
+			buf->SetCpuAccessHint(AcceleratorBuffer<T>::HINT_LIKELY);
+			buf->SetGpuAccessHint(AcceleratorBuffer<T>::HINT_UNLIKELY);
+			return buf;
+		}
+
+		/**
+			@brief Puts a buffer back in the pool, or frees it if the pool is full
+		 */
+		void Return(AcceleratorBuffer<T>* buf)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if(m_free.size() < MAX_FREE_BUFFERS)
+				{
+					//Contents are garbage now, no need to keep any of it coherent
+					buf->clear();
+					m_free.push_back(buf);
+					return;
+				}
+			}
+			delete buf;
+		}
+
+		/**
+			@brief Frees every free buffer on hard pressure, or the larger half of them on soft pressure
+		 */
+		virtual bool Trim(MemoryPressureLevel level) override
+		{
+			std::vector<AcceleratorBuffer<T>*> victims;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if(level == MemoryPressureLevel::Hard)
+					victims.swap(m_free);
+				else
+				{
+					std::sort(m_free.begin(), m_free.end(),
+						[](AcceleratorBuffer<T>* a, AcceleratorBuffer<T>* b){ return a->capacity() < b->capacity(); });
+					size_t keep = m_free.size() / 2;
+					victims.assign(m_free.begin() + keep, m_free.end());
+					m_free.resize(keep);
+				}
+			}
+
+			for(auto b : victims)
+				delete b;
+			return !victims.empty();
+		}
+
+	protected:
+		///@brief Mutex protecting m_free
+		std::mutex m_mutex;
+
+		///@brief Buffers available for reuse
+		std::vector<AcceleratorBuffer<T>*> m_free;
+	};
+
+	/**
+		@brief Gets the pool for one element type, creating and registering it on first use
+
+		Pools are deliberately never destroyed, so buffers handed back during static destruction have somewhere to go.
+	 */
+	template<class T>
+	static TypedPool<T>& GetPool()
+	{
+		static TypedPool<T>* pool = RegisterPool(new TypedPool<T>);
+		return *pool;
+	}
+
+	/**
+		@brief Adds a pool to the list trimmed by OnMemoryPressure()
+	 */
+	template<class P>
+	static P* RegisterPool(P* pool)
+	{
+		std::lock_guard<std::mutex> lock(m_poolsMutex);
+		m_pools.push_back(pool);
+		return pool;
+	}
+
+	///@brief Mutex protecting m_pools
+	static std::mutex m_poolsMutex;
+
+	///@brief Pools of every element type which has been borrowed so far
+	static std::vector<PoolBase*> m_pools;
+};
+
+#endif
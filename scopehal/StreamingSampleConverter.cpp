@@ -0,0 +1,284 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of StreamingSampleConverter
+	@ingroup core
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+StreamingSampleConverter::StreamingSampleConverter()
+	: m_inFlight(0)
+	, m_quit(false)
+{
+	m_thread = thread(&StreamingSampleConverter::ThreadProc, this);
+}
+
+StreamingSampleConverter::~StreamingSampleConverter()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_workCvar.notify_all();
+	m_thread.join();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stream management
+
+/**
+	@brief Starts a new conversion whose input has not been downloaded yet
+
+	@param out		Output buffer, with room for count samples. Must stay valid and untouched until Wait() returns.
+	@param raw		Raw sample buffer the download is being written to
+	@param count	Expected number of samples
+	@param format	Raw sample format
+	@param gain		Multiplier for raw sample values
+	@param offset	Value subtracted after scaling
+
+	@return Stream ID, valid until the next Wait()
+ */
+size_t StreamingSampleConverter::BeginStream(
+	float* out,
+	const void* raw,
+	size_t count,
+	SampleFormat format,
+	float gain,
+	float offset)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	Stream s;
+	s.m_out = out;
+	s.m_raw = reinterpret_cast<const uint8_t*>(raw);
+	s.m_format = format;
+	s.m_gain = gain;
+	s.m_offset = offset;
+	s.m_count = count;
+	s.m_available = 0;
+	s.m_converted = 0;
+	s.m_finished = false;
+	m_streams.push_back(s);
+
+	return m_streams.size() - 1;
+}
+
+/**
+	@brief Gets a transport progress callback which reports download progress of part of a stream
+
+	@param stream		Stream ID
+	@param rawOffset	Byte offset within the raw buffer at which this read starts
+	@param rawLength	Number of bytes this read covers
+	@param chained		Optional callback (e.g. download status UI) invoked with the same progress value
+ */
+function<void(float)> StreamingSampleConverter::GetProgressCallback(
+	size_t stream,
+	size_t rawOffset,
+	size_t rawLength,
+	function<void(float)> chained)
+{
+	return [this, stream, rawOffset, rawLength, chained](float progress)
+	{
+		//Progress is a rounded float, so back off a little to never claim bytes which haven't arrived yet
+		size_t bytes = static_cast<size_t>(static_cast<double>(progress) * rawLength);
+		size_t guard = (rawLength >> 20) + 16;
+		if(bytes > guard)
+			UpdateStream(stream, rawOffset + bytes - guard);
+		if(chained)
+			chained(progress);
+	};
+}
+
+/**
+	@brief Reports that the first rawBytesAvailable bytes of a stream's raw buffer are valid
+ */
+void StreamingSampleConverter::UpdateStream(size_t stream, size_t rawBytesAvailable)
+{
+	bool notify = false;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		auto& s = m_streams[stream];
+
+		size_t avail = min(s.m_count, rawBytesAvailable / GetSampleSize(s.m_format));
+		if(avail > s.m_available)
+		{
+			s.m_available = avail;
+			notify = (s.m_available - s.m_converted) >= MIN_CHUNK_SAMPLES;
+		}
+	}
+
+	if(notify)
+		m_workCvar.notify_one();
+}
+
+/**
+	@brief Marks the download for a stream as complete
+
+	@param stream	Stream ID
+	@param count	Number of samples actually received (clamped to the count passed to BeginStream)
+ */
+void StreamingSampleConverter::EndStream(size_t stream, size_t count)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		auto& s = m_streams[stream];
+		s.m_count = min(s.m_count, count);
+		s.m_available = s.m_count;
+		s.m_finished = true;
+	}
+	m_workCvar.notify_one();
+}
+
+/**
+	@brief Blocks until every stream has been ended and fully converted, then forgets all streams
+
+	Any stream which was never ended is treated as having ended with the data reported so far.
+ */
+void StreamingSampleConverter::Wait()
+{
+	unique_lock<mutex> lock(m_mutex);
+
+	for(auto& s : m_streams)
+	{
+		if(!s.m_finished)
+		{
+			s.m_count = s.m_available;
+			s.m_finished = true;
+		}
+	}
+	m_workCvar.notify_one();
+
+	m_doneCvar.wait(lock, [this]
+	{
+		if(m_inFlight)
+			return false;
+		for(auto& s : m_streams)
+		{
+			if(s.m_converted < s.m_count)
+				return false;
+		}
+		return true;
+	});
+
+	m_streams.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Conversion
+
+size_t StreamingSampleConverter::GetSampleSize(SampleFormat format)
+{
+	if(format == FORMAT_INT16)
+		return 2;
+	return 1;
+}
+
+/**
+	@brief Worker thread: converts whatever has been downloaded, oldest stream first
+ */
+void StreamingSampleConverter::ThreadProc()
+{
+	#ifdef __linux__
+	pthread_setname_np(pthread_self(), "SampleConvert");
+	#endif
+
+	unique_lock<mutex> lock(m_mutex);
+	while(true)
+	{
+		//Find the first stream with enough new data to be worth converting
+		Stream* work = nullptr;
+		size_t start = 0;
+		size_t end = 0;
+		for(auto& s : m_streams)
+		{
+			size_t pending = s.m_available - s.m_converted;
+			if( (pending >= MIN_CHUNK_SAMPLES) || (s.m_finished && pending) )
+			{
+				work = &s;
+				start = s.m_converted;
+				end = s.m_available;
+
+				//Keep batch boundaries on a multiple of 64 samples, since the vectorized kernels use aligned stores
+				if(!s.m_finished)
+					end -= end % 64;
+
+				s.m_converted = end;
+				break;
+			}
+		}
+
+		if(!work)
+		{
+			if(m_quit)
+				break;
+			m_workCvar.wait(lock);
+			continue;
+		}
+
+		//Copy parameters out since m_streams may reallocate while we're unlocked
+		auto out = work->m_out + start;
+		auto raw = work->m_raw + start*GetSampleSize(work->m_format);
+		auto format = work->m_format;
+		float gain = work->m_gain;
+		float offset = work->m_offset;
+		size_t count = end - start;
+
+		m_inFlight ++;
+		lock.unlock();
+
+		switch(format)
+		{
+			case FORMAT_INT8:
+				Oscilloscope::Convert8BitSamples(out, reinterpret_cast<const int8_t*>(raw), gain, offset, count);
+				break;
+
+			case FORMAT_UINT8:
+				Oscilloscope::ConvertUnsigned8BitSamples(out, raw, gain, offset, count);
+				break;
+
+			case FORMAT_INT16:
+				Oscilloscope::Convert16BitSamples(out, reinterpret_cast<const int16_t*>(raw), gain, offset, count);
+				break;
+		}
+
+		lock.lock();
+		m_inFlight --;
+		m_doneCvar.notify_all();
+	}
+}
@@ -0,0 +1,151 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of StreamingSampleConverter
+	@ingroup core
+ */
+
+#ifndef StreamingSampleConverter_h
+#define StreamingSampleConverter_h
+
+#include <condition_variable>
+#include <functional>
+
+/**
+	@brief Converts raw ADC samples to floating point on a background thread while they are still being downloaded
+	@ingroup core
+
+	Typical driver usage:
+
+	1. BeginStream() for each channel before its download starts, pointing at the raw and output buffers
+	2. Pass GetProgressCallback() as (or chained into) the transport's progress callback for each binary block read,
+	   so the worker can convert the prefix which has already arrived while the rest of the block downloads
+	3. EndStream() once the download is complete, with the number of samples actually received
+	4. Wait() before touching any of the output waveforms
+
+	Since conversion of channel K (or of the start of a deep channel) runs while channel K+1 downloads, the only
+	conversion latency left after the last byte arrives is the final partial chunk of the last channel.
+
+	Stream conversion only touches memory, so drivers must compute gain and offset up front rather than querying the
+	instrument from the worker thread.
+ */
+class StreamingSampleConverter
+{
+public:
+	StreamingSampleConverter();
+	~StreamingSampleConverter();
+
+	///@brief Raw sample formats
+	enum SampleFormat
+	{
+		FORMAT_INT8,
+		FORMAT_UINT8,
+		FORMAT_INT16
+	};
+
+	size_t BeginStream(float* out, const void* raw, size_t count, SampleFormat format, float gain, float offset);
+	std::function<void(float)> GetProgressCallback(
+		size_t stream,
+		size_t rawOffset,
+		size_t rawLength,
+		std::function<void(float)> chained = nullptr);
+	void UpdateStream(size_t stream, size_t rawBytesAvailable);
+	void EndStream(size_t stream, size_t count);
+	void Wait();
+
+	/**
+		@brief Minimum number of samples converted per batch while a stream is still downloading
+
+		Smaller batches would contend on the stream mutex for every progress callback without getting much more
+		overlap.
+	 */
+	static constexpr size_t MIN_CHUNK_SAMPLES = 256 * 1024;
+
+protected:
+	void ThreadProc();
+	static size_t GetSampleSize(SampleFormat format);
+
+	///@brief State of a single raw-to-float conversion
+	struct Stream
+	{
+		///@brief Output sample buffer
+		float* m_out;
+
+		///@brief Raw sample buffer
+		const uint8_t* m_raw;
+
+		///@brief Format of m_raw
+		SampleFormat m_format;
+
+		///@brief Gain applied to raw samples
+		float m_gain;
+
+		///@brief Offset subtracted from scaled samples
+		float m_offset;
+
+		///@brief Number of samples to convert (may shrink in EndStream)
+		size_t m_count;
+
+		///@brief Number of raw samples which have been downloaded
+		size_t m_available;
+
+		///@brief Number of samples converted so far (or claimed by the worker)
+		size_t m_converted;
+
+		///@brief True once the download has finished
+		bool m_finished;
+	};
+
+	///@brief Streams started since the last Wait()
+	std::vector<Stream> m_streams;
+
+	///@brief Mutex protecting m_streams and m_quit
+	std::mutex m_mutex;
+
+	///@brief Signaled when new data is available to convert
+	std::condition_variable m_workCvar;
+
+	///@brief Signaled when a batch of conversion completes
+	std::condition_variable m_doneCvar;
+
+	///@brief Number of batches currently being converted outside the mutex
+	size_t m_inFlight;
+
+	///@brief Set to shut down the worker thread
+	bool m_quit;
+
+	///@brief Conversion thread
+	std::thread m_thread;
+};
+
+#endif
@@ -57,6 +57,17 @@ unsigned int SwitchMatrix::GetInstrumentTypes() const
 	return INST_SWITCH_MATRIX;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Transactions
+
+void SwitchMatrix::BeginConfigTransaction()
+{
+}
+
+void SwitchMatrix::CommitConfigTransaction()
+{
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Serialization
 
@@ -51,6 +51,21 @@ public:
 
 	virtual unsigned int GetInstrumentTypes() const override;
 
+	/**
+		@brief Starts a batch of configuration changes
+
+		Until the matching CommitConfigTransaction(), drivers which support it record changes instead of sending
+		them, so a group of paths and levels can be reconfigured in one batch. Redundant changes, where a setting
+		returns to its current value, are dropped. The default implementation does nothing, so changes take effect
+		as they are made.
+	 */
+	virtual void BeginConfigTransaction();
+
+	/**
+		@brief Sends every change made since BeginConfigTransaction() to the hardware in one batch
+	 */
+	virtual void CommitConfigTransaction();
+
 	/**
 		@brief Sets the mux selector for an output channel
 	 */
@@ -112,18 +112,7 @@ bool TektronixHSIOscilloscope::AcquireData()
 
 	s[GetOscilloscopeChannel(0)] = cap;
 
-	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(s);
-
-	while (m_pendingWaveforms.size() > 2)
-	{
-		SequenceSet set = *m_pendingWaveforms.begin();
-		for(auto it : set)
-			delete it.second;
-		m_pendingWaveforms.pop_front();
-	}
-
-	m_pendingWaveformsMutex.unlock();
+	PushPendingWaveform(s);
 
 	if (m_triggerOneShot)
 		m_triggerArmed = false;
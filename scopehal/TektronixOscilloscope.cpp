@@ -89,6 +89,9 @@ TektronixOscilloscope::TektronixOscilloscope(SCPITransport* transport)
 	, m_afgShape(FunctionGenerator::SHAPE_SINE)
 	, m_afgImpedance(FunctionGenerator::IMPEDANCE_HIGH_Z)
 {
+	m_analogRawWaveformBuffer.SetCpuAccessHint(AcceleratorBuffer<int8_t>::HINT_LIKELY);
+	m_analogRawWaveformBuffer.SetGpuAccessHint(AcceleratorBuffer<int8_t>::HINT_LIKELY);
+
 	//If we are reconnecting after a crash or something went wrong, the scope might have a reply or two queued up
 	//If this happens, every time we send a command we'll get a reply meant for something else!
 	//Resync twice to verify we get good alignment after
@@ -1578,20 +1581,23 @@ bool TektronixOscilloscope::AcquireData()
 			break;
 	}
 
-	//Now that we have all of the pending waveforms, save them in sets across all channels
-	m_pendingWaveformsMutex.lock();
-	size_t num_pending = 1;	//TODO: segmented capture support
+	//Now that we have all of the pending waveforms, save them in sets across all channels.
+	//In FastFrame mode analog channels have one waveform per frame, everything else only has the first one
+	size_t num_pending = 1;
+	for(auto& it : pending_waveforms)
+		num_pending = max(num_pending, it.second.size());
 	for(size_t i=0; i<num_pending; i++)
 	{
 		SequenceSet s;
 		for(size_t j=0; j<m_channels.size(); j++)
 		{
-			if(IsChannelEnabled(j))
-				s[GetOscilloscopeChannel(j)] = pending_waveforms[j][i];
+			if(!IsChannelEnabled(j))
+				continue;
+			auto& wfms = pending_waveforms[j];
+			s[GetOscilloscopeChannel(j)] = (i < wfms.size()) ? wfms[i] : nullptr;
 		}
-		m_pendingWaveforms.push_back(s);
+		PushPendingWaveform(s);
 	}
-	m_pendingWaveformsMutex.unlock();
 
 	//Re-arm the trigger if not in one-shot mode
 	if(!m_triggerOneShot)
@@ -1806,6 +1812,16 @@ void TektronixOscilloscope::ResynchronizeSCPI()
 
 	@return True on success, false on failure
  */
+/**
+	@brief Gets the number of frames in the current acquisition, or 1 if FastFrame is off
+ */
+size_t TektronixOscilloscope::GetFastFrameCountMSO56()
+{
+	if(stoi(m_transport->SendCommandImmediateWithReply("HOR:FAST:STATE?")) == 0)
+		return 1;
+	return max(1, stoi(m_transport->SendCommandImmediateWithReply("HOR:FAST:COUN?")));
+}
+
 bool TektronixOscilloscope::AcquireDataMSO56(map<int, vector<WaveformBase*> >& pending_waveforms)
 {
 	//Seems like we might need a command before reading data after the trigger?
@@ -1814,6 +1830,9 @@ bool TektronixOscilloscope::AcquireDataMSO56(map<int, vector<WaveformBase*> >& p
 	//Make sure record length is valid
 	GetSampleDepth();
 
+	//In FastFrame mode, every frame of a channel is fetched with a single CURV? and split up without copying
+	size_t frames = GetFastFrameCountMSO56();
+
 	//Ask for the analog data
 	bool firstAnalog = true;
 	size_t timebase = 0;
@@ -1842,6 +1861,11 @@ bool TektronixOscilloscope::AcquireDataMSO56(map<int, vector<WaveformBase*> >& p
 			{
 				m_transport->SendCommandImmediate("DAT:WID 1");					//8-bit data in NORMAL mode
 				m_transport->SendCommandImmediate("DAT:ENC SRI");				//signed, little endian binary
+				if(frames > 1)
+				{
+					m_transport->SendCommandImmediate("DAT:FRAMESTAR 1");
+					m_transport->SendCommandImmediate(string("DAT:FRAMESTOP ") + to_string(frames));
+				}
 				firstAnalog = false;
 			}
 
@@ -1859,10 +1883,14 @@ bool TektronixOscilloscope::AcquireDataMSO56(map<int, vector<WaveformBase*> >& p
 			//LogDebug("Channel %zu (%s)\n", i, GetOscilloscopeChannel(i)->GetHwname().c_str());
 			LogIndenter li2;
 
-			//Read the data block
-			size_t nsamples;
-			int8_t* samples = (int8_t*)m_transport->SendCommandImmediateWithRawBlockReply("CURV?", nsamples);
-			if(samples == NULL)
+			//Read the data block. Frames are downloaded into a block of their own, since the waveforms keep
+			//referring to it until they're converted
+			shared_ptr<AcceleratorBuffer<int8_t> > block;
+			if(frames > 1)
+				block = SegmentedCapture::AllocateBlock(0);
+			auto& rawbuf = block ? *block : m_analogRawWaveformBuffer;
+			m_transport->SendCommandImmediate("CURV?");
+			if(!m_transport->ReadBinaryBlock(rawbuf, nullptr, false) || rawbuf.empty())
 			{
 				LogWarning("Didn't get any samples (timeout?)\n");
 
@@ -1871,17 +1899,40 @@ bool TektronixOscilloscope::AcquireDataMSO56(map<int, vector<WaveformBase*> >& p
 				continue; // retry
 			}
 
-			if (nsamples != (size_t)preamble.nr_pt)
+			//NR_PT is the length of either one frame or all of them, depending on firmware version
+			size_t nsamples = rawbuf.size();
+			if ( (nsamples != (size_t)preamble.nr_pt) && (nsamples != (size_t)preamble.nr_pt * frames) )
 			{
 				LogWarning("Didn't get the right number of points\n");
 
 				ResynchronizeSCPI();
 
-				delete[] samples;
-
 				continue; // retry
 			}
 
+			if(block)
+			{
+				SegmentedCapture segments(block, 8, frames, nsamples);
+				double t = GetTime();
+				for(size_t j=0; j<frames; j++)
+				{
+					//TODO: read per-frame trigger times from HOR:FAST:TIMESTAMP:ALL
+					auto cap = AllocateAnalogWaveform(m_nickname + "." + GetChannel(i)->GetHwname());
+					cap->m_timescale = timebase;
+					cap->m_triggerPhase = 0;
+					cap->m_startTimestamp = time(NULL);
+					cap->m_startFemtoseconds = (t - floor(t)) * FS_PER_SECOND;
+					segments.AttachSegment(cap, j, preamble.ymult, preamble.yoff);
+					pending_waveforms[i].push_back(cap);
+				}
+
+				if (m_transport->ReadReply() != "")
+					LogWarning("Tek has junk after CURV? reply\n");
+
+				succeeded = true;
+				break;
+			}
+
 			//Set up the capture we're going to store our data into
 			//(no TDC data or fine timestamping available on Tektronix scopes?)
 			auto cap = AllocateAnalogWaveform(m_nickname + "." + GetChannel(i)->GetHwname());
@@ -1895,7 +1946,7 @@ bool TektronixOscilloscope::AcquireDataMSO56(map<int, vector<WaveformBase*> >& p
 
 			Convert8BitSamples(
 				cap->m_samples.GetCpuPointer(),
-				samples,
+				m_analogRawWaveformBuffer.GetCpuPointer(),
 				preamble.ymult,
 				-preamble.yoff,
 				nsamples);
@@ -1905,9 +1956,6 @@ bool TektronixOscilloscope::AcquireDataMSO56(map<int, vector<WaveformBase*> >& p
 			//Done, update the data
 			pending_waveforms[i].push_back(cap);
 
-			//Done
-			delete[] samples;
-
 			//Throw out garbage at the end of the message (why is this needed?)
 			if (m_transport->ReadReply() != "")
 				LogWarning("Tek has junk after CURV? reply\n");
@@ -271,6 +271,7 @@ protected:
 	void ResynchronizeSCPI();
 	bool ReadPreamble(std::string& preamble_in, mso56_preamble& preamble_out);
 	bool AcquireDataMSO56(std::map<int, std::vector<WaveformBase*> >& pending_waveforms);
+	size_t GetFastFrameCountMSO56();
 	void DetectProbes();
 
 	///@brief Hardware analog channel count, independent of LA option etc
@@ -292,6 +293,9 @@ protected:
 		PROBE_TYPE_DIGITAL_8BIT
 	};
 
+	///@brief Pinned buffer for raw analog CURV? data
+	AcceleratorBuffer<int8_t> m_analogRawWaveformBuffer;
+
 	//config cache
 
 	///@brief Cached map of <channel ID, offset>
@@ -36,6 +36,7 @@
  */
 #include "scopehal.h"
 #include "TestWaveformSource.h"
+#include "CounterRNG.h"
 #include <complex>
 
 using namespace std;
@@ -81,6 +82,17 @@ TestWaveformSource::~TestWaveformSource()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Signal generation
 
+/**
+	@brief Splits depth samples across numThreads shader invocations
+
+	Rounded up to a multiple of 4 so each thread starts on a block boundary of the shader's counter based RNG.
+ */
+static uint32_t GetSamplesPerThread(size_t depth, size_t numThreads)
+{
+	size_t n = (depth + numThreads) / numThreads;
+	return (n + 3) & ~3;
+}
+
 /**
 	@brief Generates a step waveform
 
@@ -147,7 +159,7 @@ void TestWaveformSource::GenerateNoisySinewave(
 	NoisySinePushConstants push;
 	float samples_per_cycle = period * 1.0 / sampleperiod;
 	push.numSamples = depth;
-	push.samplesPerThread = (depth + numThreads) / numThreads;
+	push.samplesPerThread = GetSamplesPerThread(depth, numThreads);
 	push.rngSeed = m_rng();
 	push.startPhase = startphase;
 	push.scale = amplitude / 2;	//sin is +/- 1, so need to divide amplitude by 2 to get scaling factor
@@ -201,7 +213,7 @@ void TestWaveformSource::GenerateNoisySinewaveSum(
 	float samples_per_cycle1 = period1 * 1.0 / sampleperiod;
 	float samples_per_cycle2 = period2 * 1.0 / sampleperiod;
 	push.numSamples = depth;
-	push.samplesPerThread = (depth + numThreads) / numThreads;
+	push.samplesPerThread = GetSamplesPerThread(depth, numThreads);
 	push.rngSeed = m_rng();
 	push.startPhase1 = startphase1;
 	push.startPhase2 = startphase2;
@@ -390,8 +402,8 @@ void TestWaveformSource::DegradeSerialData(
 	//assume input came from CPU
 	cap->MarkModifiedFromCpu();
 
-	//RNGs
-	normal_distribution<> noise(0, noise_stdev);
+	//Same noise stream as the GPU path would use for this seed
+	CounterRNG noise(m_rng());
 
 	//Prepare for second pass: reallocate FFT buffer if sample depth changed
 	const size_t npoints = next_pow2(depth);
@@ -421,9 +433,9 @@ void TestWaveformSource::DegradeSerialData(
 
 	//Set up new FFT plans
 	if(!m_vkForwardPlan)
-		m_vkForwardPlan = make_unique<VulkanFFTPlan>(npoints, nouts, VulkanFFTPlan::DIRECTION_FORWARD);
+		m_vkForwardPlan = g_fftPlanCache->Acquire(npoints, nouts, VulkanFFTPlan::DIRECTION_FORWARD);
 	if(!m_vkReversePlan)
-		m_vkReversePlan = make_unique<VulkanFFTPlan>(npoints, nouts, VulkanFFTPlan::DIRECTION_REVERSE);
+		m_vkReversePlan = g_fftPlanCache->Acquire(npoints, nouts, VulkanFFTPlan::DIRECTION_REVERSE);
 
 	if(lpf)
 	{
@@ -487,7 +499,7 @@ void TestWaveformSource::DegradeSerialData(
 		const int numThreads = 32768;
 		DegradeSerialDataPushConstants push;
 		push.numSamples = finalLen;
-		push.samplesPerThread = (finalLen + numThreads) / numThreads;
+		push.samplesPerThread = GetSamplesPerThread(finalLen, numThreads);
 		push.rngSeed = m_rng();
 		push.sigma = noise_stdev;
 		push.scale = 1.0f / npoints;
@@ -513,8 +525,19 @@ void TestWaveformSource::DegradeSerialData(
 	//TODO: GPU accelerate this path
 	else
 	{
-		for(size_t i=0; i<depth; i++)
-			cap->m_samples[i] += noise(m_rng);
+		float* p = cap->m_samples.GetCpuPointer();
+		size_t nblocks = (depth + 3) / 4;
+
+		#pragma omp parallel for
+		for(size_t b=0; b<nblocks; b++)
+		{
+			float g[4];
+			noise.Gaussian4(b, g);
+
+			size_t iend = min(b*4 + 4, depth);
+			for(size_t i=b*4; i<iend; i++)
+				p[i] += g[i - b*4] * noise_stdev;
+		}
 		cap->MarkModifiedFromCpu();
 	}
 }
@@ -37,7 +37,7 @@
 #ifndef TestWaveformSource_h
 #define TestWaveformSource_h
 
-#include "VulkanFFTPlan.h"
+#include "VulkanFFTPlanCache.h"
 #include <random>
 
 struct __attribute__((packed)) DegradeSerialDataPushConstants
@@ -166,10 +166,10 @@ protected:
 	AcceleratorBuffer<float> m_reverseOutBuf;
 
 	///@brief FFT plan
-	std::unique_ptr<VulkanFFTPlan> m_vkForwardPlan;
+	VulkanFFTPlanHandle m_vkForwardPlan;
 
 	///@brief Inverse FFT plan
-	std::unique_ptr<VulkanFFTPlan> m_vkReversePlan;
+	VulkanFFTPlanHandle m_vkReversePlan;
 
 	///@brief FFT bin size, in Hz
 	double m_cachedBinSize;
@@ -0,0 +1,231 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of ThreadPool
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "ThreadPool.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+using namespace std;
+
+///@brief True on threads belonging to a ThreadPool
+static thread_local bool g_isPoolWorker = false;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates the pool and starts the worker threads
+
+	@param numThreads	Number of workers, or zero for one per hardware thread (less the caller, which also works)
+ */
+ThreadPool::ThreadPool(size_t numThreads)
+	: m_terminating(false)
+{
+	if(numThreads == 0)
+		numThreads = max(1u, thread::hardware_concurrency()) - 1;
+
+	for(size_t i=0; i<numThreads; i++)
+		m_threads.push_back(thread(&ThreadPool::WorkerThread, this, i));
+
+	LogTrace("Thread pool: %zu workers on %zu NUMA nodes\n", m_threads.size(), GetNodeCount());
+}
+
+/**
+	@brief Stops the workers once they've finished any queued jobs
+ */
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_terminating = true;
+	}
+	m_wake.notify_all();
+
+	for(auto& t : m_threads)
+		t.join();
+}
+
+/**
+	@brief Gets the process-wide pool, creating it the first time it's needed
+ */
+ThreadPool& ThreadPool::Get()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Job handling
+
+/**
+	@brief Queues a job to be run by the next free worker
+
+	The job runs asynchronously; it's up to the caller to find out when it has finished.
+ */
+void ThreadPool::Submit(function<void()> job)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_jobs.push_back(std::move(job));
+	}
+	m_wake.notify_one();
+}
+
+/**
+	@brief Checks if the calling thread is a pool worker
+ */
+bool ThreadPool::IsWorkerThread()
+{
+	return g_isPoolWorker;
+}
+
+void ThreadPool::WorkerThread(size_t i)
+{
+	#ifdef __linux__
+	pthread_setname_np(pthread_self(), "ThreadPool");
+	#endif
+
+	//Stay on one NUMA node
+	if(NumaTopology::IsNuma())
+		NumaTopology::PinCurrentThread(i % NumaTopology::GetNodeCount());
+
+	//Make locale handling thread safe on Windows
+	#ifdef _WIN32
+	_configthreadlocale(_ENABLE_PER_THREAD_LOCALE);
+	Unit::SetDefaultLocale();
+	#endif
+
+	g_isPoolWorker = true;
+
+	while(true)
+	{
+		function<void()> job;
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_wake.wait(lock, [&]{ return m_terminating || !m_jobs.empty(); });
+			if(m_jobs.empty())
+				return;
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+
+		job();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parallel loops
+
+/**
+	@brief Runs chunks of a loop until there are none left to claim
+
+	@return True if this call completed the last chunk
+ */
+bool ThreadPool::LoopState::RunChunks()
+{
+	bool last = false;
+	while(true)
+	{
+		size_t chunk = m_nextChunk.fetch_add(1);
+		if(chunk >= m_chunkCount)
+			return last;
+
+		size_t start = m_begin + chunk*m_chunkSize;
+		size_t end = min(m_end, start + m_chunkSize);
+		m_func(start, end);
+
+		if(m_chunksDone.fetch_add(1) + 1 == m_chunkCount)
+			last = true;
+	}
+}
+
+/**
+	@brief Runs a loop over [begin, end), in chunks of at least grain indexes, on the pool and the calling thread
+
+	Prefer the ParallelFor() template, which avoids the pool entirely for small ranges.
+
+	@param begin	First index
+	@param end		One past the last index
+	@param grain	Minimum number of indexes per chunk
+	@param func		Loop body, called as func(chunkBegin, chunkEnd)
+ */
+void ThreadPool::ParallelFor(size_t begin, size_t end, size_t grain, const function<void(size_t, size_t)>& func)
+{
+	if(end <= begin)
+		return;
+
+	//A few chunks per thread so uneven chunks even out, but not so many that scheduling dominates
+	size_t len = end - begin;
+	size_t nthreads = m_threads.size() + 1;
+	size_t nchunks = min( (len + grain - 1) / grain, nthreads * 4);
+	if( (nchunks <= 1) || m_threads.empty())
+	{
+		func(begin, end);
+		return;
+	}
+	size_t chunkSize = (len + nchunks - 1) / nchunks;
+	nchunks = (len + chunkSize - 1) / chunkSize;
+
+	//Wake up helpers. Any which only get scheduled after we're done find no chunks left and return immediately.
+	auto state = make_shared<LoopState>(begin, end, chunkSize, nchunks, func);
+	size_t nhelpers = min(nchunks - 1, m_threads.size());
+	{
+		lock_guard<mutex> lock(m_mutex);
+		for(size_t i=0; i<nhelpers; i++)
+		{
+			m_jobs.push_back([state]
+			{
+				if(state->RunChunks())
+				{
+					lock_guard<mutex> lock(state->m_doneMutex);
+					state->m_doneCvar.notify_all();
+				}
+			});
+		}
+	}
+	if(nhelpers == 1)
+		m_wake.notify_one();
+	else
+		m_wake.notify_all();
+
+	//Do our share, then wait for chunks other threads already started
+	state->RunChunks();
+	unique_lock<mutex> lock(state->m_doneMutex);
+	state->m_doneCvar.wait(lock, [&]{ return state->m_chunksDone.load() == state->m_chunkCount; });
+}
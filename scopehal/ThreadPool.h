@@ -0,0 +1,185 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of ThreadPool
+	@ingroup core
+ */
+
+#ifndef ThreadPool_h
+#define ThreadPool_h
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+
+#include "NumaTopology.h"
+
+/**
+	@brief Process-wide pool of worker threads for data parallel loops inside filters and drivers
+	@ingroup core
+
+	Filters are refreshed by several FilterGraphExecutor threads at once. When each of those opened its own OpenMP
+	parallel region, every region spun up a full team, giving (executor threads x cores) runnable threads. Loops
+	run through ParallelFor() instead share this one pool, sized to the number of hardware threads. The calling
+	thread always takes part in its own loop and only waits for chunks which other threads have already started, so
+	nested or concurrent loops can never deadlock: when every worker is busy, the caller simply runs the whole loop.
+
+	On Linux systems with more than one NUMA node, each worker is confined to the CPUs of one node (round robin), so
+	the memory it first touches stays local and the scheduler doesn't bounce it between sockets.
+ */
+class ThreadPool
+{
+public:
+	ThreadPool(size_t numThreads = 0);
+	~ThreadPool();
+
+	//non-copyable
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	static ThreadPool& Get();
+
+	void Submit(std::function<void()> job);
+
+	void ParallelFor(
+		size_t begin,
+		size_t end,
+		size_t grain,
+		const std::function<void(size_t, size_t)>& func);
+
+	///@brief Gets the number of worker threads in the pool
+	size_t GetThreadCount()
+	{ return m_threads.size(); }
+
+	///@brief Gets the number of NUMA nodes the workers are spread across (1 if not NUMA aware)
+	size_t GetNodeCount()
+	{ return NumaTopology::GetNodeCount(); }
+
+	static bool IsWorkerThread();
+
+protected:
+	void WorkerThread(size_t i);
+
+	/**
+		@brief Shared state of one ParallelFor() call
+	 */
+	class LoopState
+	{
+	public:
+		LoopState(size_t begin, size_t end, size_t chunkSize, size_t nchunks,
+			const std::function<void(size_t, size_t)>& func)
+		: m_begin(begin)
+		, m_end(end)
+		, m_chunkSize(chunkSize)
+		, m_chunkCount(nchunks)
+		, m_func(func)
+		, m_nextChunk(0)
+		, m_chunksDone(0)
+		{}
+
+		bool RunChunks();
+
+		///@brief First index of the loop
+		size_t m_begin;
+
+		///@brief One past the last index of the loop
+		size_t m_end;
+
+		///@brief Number of indexes per chunk
+		size_t m_chunkSize;
+
+		///@brief Number of chunks
+		size_t m_chunkCount;
+
+		///@brief Loop body (only valid until all chunks are done, the caller owns it)
+		const std::function<void(size_t, size_t)>& m_func;
+
+		///@brief Index of the next chunk to hand out
+		std::atomic<size_t> m_nextChunk;
+
+		///@brief Number of chunks completed
+		std::atomic<size_t> m_chunksDone;
+
+		///@brief Mutex for m_doneCvar
+		std::mutex m_doneMutex;
+
+		///@brief Signaled when the last chunk completes
+		std::condition_variable m_doneCvar;
+	};
+
+	///@brief Mutex protecting m_jobs and m_terminating
+	std::mutex m_mutex;
+
+	///@brief Signaled when a job is queued, or when we're shutting down
+	std::condition_variable m_wake;
+
+	///@brief Jobs waiting for a worker
+	std::deque< std::function<void()> > m_jobs;
+
+	///@brief Set when the workers should exit
+	bool m_terminating;
+
+	///@brief The worker threads
+	std::vector<std::thread> m_threads;
+};
+
+/**
+	@brief Runs a loop over [begin, end) on the shared ThreadPool
+	@ingroup core
+
+	The range is split into contiguous chunks of at least grain indexes, and func(chunkBegin, chunkEnd) is called
+	once per chunk, from the calling thread and/or pool workers. Returns once every chunk has completed.
+
+	Ranges of no more than one chunk are run inline on the calling thread without touching the pool.
+
+	@param begin	First index
+	@param end		One past the last index
+	@param grain	Minimum number of indexes per chunk
+	@param func		Loop body
+ */
+template<class F>
+void ParallelFor(size_t begin, size_t end, size_t grain, F&& func)
+{
+	if(grain == 0)
+		grain = 1;
+	if(end <= begin)
+		return;
+	if( (end - begin) <= grain)
+	{
+		func(begin, end);
+		return;
+	}
+
+	ThreadPool::Get().ParallelFor(begin, end, grain, std::function<void(size_t, size_t)>(std::forward<F>(func)));
+}
+
+#endif
@@ -67,11 +67,13 @@ ThunderScopeOscilloscope::ThunderScopeOscilloscope(SCPITransport* transport)
 	, m_diag_totalWFMs(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS))
 	, m_diag_droppedWFMs(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS))
 	, m_diag_droppedPercent(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_PERCENT))
-	, m_nextWaveformWriteBuffer(0)
 	, m_adcMode(MODE_8BIT)
 	, m_lastSeq(0)
 	, m_dropUntilSeq(0)
 {
+	//Streaming instrument: if we get backed up, drop old waveforms rather than falling further behind
+	SetPendingWaveformPolicy(PENDING_DROP_OLDEST, 2);
+
 	m_analogChannelCount = 4;
 
 	//Add analog channel objects
@@ -140,50 +142,10 @@ ThunderScopeOscilloscope::ThunderScopeOscilloscope(SCPITransport* transport)
 
 	ResetPerCaptureDiagnostics();
 
-	//Initialize waveform buffers. Allocate one extra so we can overlap download and conversion
-	for(size_t i=0; i<m_analogChannelCount + 1; i++)
-	{
-		m_analogRawWaveformBuffers.push_back(std::make_unique<AcceleratorBuffer<int16_t> >());
-		m_analogRawWaveformBuffers[i]->SetCpuAccessHint(AcceleratorBuffer<int16_t>::HINT_LIKELY);
-		m_analogRawWaveformBuffers[i]->SetGpuAccessHint(AcceleratorBuffer<int16_t>::HINT_LIKELY);
-	}
-
-	//Create Vulkan objects for the waveform conversion
-	m_queue = g_vkQueueManager->GetComputeQueue("ThunderScopeOscilloscope.queue");
-	vk::CommandPoolCreateInfo poolInfo(
-		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-		m_queue->m_family );
-	m_pool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo);
-
-	vk::CommandBufferAllocateInfo bufinfo(**m_pool, vk::CommandBufferLevel::ePrimary, 1);
-	m_cmdBuf = make_unique<vk::raii::CommandBuffer>(
-		std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
-
-	if(g_hasDebugUtils)
-	{
-		string poolname = "ThunderScopeOscilloscope.pool";
-		string bufname = "ThunderScopeOscilloscope.cmdbuf";
-
-		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
-			vk::DebugUtilsObjectNameInfoEXT(
-				vk::ObjectType::eCommandPool,
-				reinterpret_cast<uint64_t>(static_cast<VkCommandPool>(**m_pool)),
-				poolname.c_str()));
-
-		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
-			vk::DebugUtilsObjectNameInfoEXT(
-				vk::ObjectType::eCommandBuffer,
-				reinterpret_cast<uint64_t>(static_cast<VkCommandBuffer>(**m_cmdBuf)),
-				bufname.c_str()));
-	}
-
-	m_conversion8BitPipeline = make_unique<ComputePipeline>(
-		"shaders/Convert8BitSamples.spv", 2, sizeof(ConvertRawSamplesShaderArgs) );
-
-	m_conversion16BitPipeline = make_unique<ComputePipeline>(
-		"shaders/Convert16BitSamples.spv", 2, sizeof(ConvertRawSamplesShaderArgs) );
-
-	m_clippingBuffer.resize(1);
+	//Raw samples are streamed into a ring and converted (or viewed) in place, so download and conversion overlap
+	//without any per-waveform buffers
+	m_converter = make_unique<RawSampleConverter>("ThunderScopeOscilloscope");
+	m_ring = make_unique<RawSampleRing>("ThunderScopeOscilloscope", m_converter.get());
 
 	//TODO: query ADC mode on hardware
 }
@@ -341,7 +303,7 @@ Oscilloscope::TriggerMode ThunderScopeOscilloscope::PollTrigger()
 		return TRIGGER_MODE_STOP;
 
 	//See if we have data ready
-	if(dynamic_cast<SCPITwinLanTransport*>(m_transport)->GetSecondarySocket().GetRxBytesAvailable() > 0)
+	if(dynamic_cast<SCPITwinLanTransport*>(m_transport)->GetDataBytesAvailable() > 0)
 	{
 		#ifdef HAVE_NVTX
 			nvtxMark("PollTrigger");
@@ -371,9 +333,8 @@ bool ThunderScopeOscilloscope::AcquireData()
 
 bool ThunderScopeOscilloscope::DoAcquireData(bool keep)
 {
-	#ifdef HAVE_NVTX
-		nvtx3::scoped_range range("ThunderScopeOscilloscope::DoAcquireData");
-	#endif
+	//Also shows up as an NVTX range, if enabled
+	PerformanceTraceRange range("ThunderScopeOscilloscope::DoAcquireData", "acquisition");
 
 	//Read Version No.
 	uint8_t version;
@@ -443,8 +404,6 @@ bool ThunderScopeOscilloscope::DoAcquireData(bool keep)
 	vector<float> scales;
 	vector<float> offsets;
 
-	bool processedWaveformsOnGPU = true;
-
 	for(size_t i=0; i<numChannels; i++)
 	{
 		//Get channel ID and memory depth (samples, not bytes)
@@ -453,11 +412,6 @@ bool ThunderScopeOscilloscope::DoAcquireData(bool keep)
 		if(!m_transport->ReadRawData(sizeof(memdepth), (uint8_t*)&memdepth))
 			return false;
 
-		//Grab the next free buffer
-		auto& abuf = m_analogRawWaveformBuffers[m_nextWaveformWriteBuffer];
-		m_nextWaveformWriteBuffer = (m_nextWaveformWriteBuffer + 1) % m_analogRawWaveformBuffers.size();
-		abuf->resize(memdepth);
-		abuf->PrepareForCpuAccess();
 		achans.push_back(chnum);
 
 		#ifdef HAVE_NVTX
@@ -467,8 +421,6 @@ bool ThunderScopeOscilloscope::DoAcquireData(bool keep)
 		//Analog channels
 		if(chnum < m_analogChannelCount)
 		{
-			auto buf = abuf->GetCpuPointer();
-
 			//Scale and offset are sent in the header since they might have changed since the capture began
 			if(!m_transport->ReadRawData(sizeof(config), (uint8_t*)&config))
 				return false;
@@ -487,19 +439,20 @@ bool ThunderScopeOscilloscope::DoAcquireData(bool keep)
 				return false;
 
 			//TODO: stream timestamp from the server
-			uint32_t depth = memdepth * sizeof(int8_t);
-			if(dataType == DATATYPE_I16)
-				depth = memdepth * sizeof(int16_t);
-			if(!m_transport->ReadRawData(depth, (uint8_t*)buf))
+			//Read straight into the next free region of the ring
+			size_t bytesPerSample = (dataType == DATATYPE_I16) ? sizeof(int16_t) : sizeof(int8_t);
+			uint32_t depth = memdepth * bytesPerSample;
+			auto region = m_ring->Allocate(depth);
+			if(!m_transport->ReadRawData(depth, region.m_ptr))
 				return false;
-			abuf->MarkModifiedFromCpu();
+			region.m_slab->MarkModifiedFromCpu();
 
 			//If discarding data, stop processing at this point
 			if(!keep)
 				continue;
 
 			//Create our waveform
-			auto cap = AllocateAnalogWaveform(m_nickname + "." + GetChannel(i)->GetHwname());
+			auto cap = AllocateAnalogWaveform(m_nickname + "." + GetChannel(i)->GetHwname(), memdepth);
 			cap->m_timescale = fs_per_sample;
 			cap->m_triggerPhase = trigphase;
 			cap->m_startTimestamp = t;
@@ -507,7 +460,6 @@ bool ThunderScopeOscilloscope::DoAcquireData(bool keep)
 			if (clipping)
 				cap->m_flags |= WaveformBase::WAVEFORM_CLIPPING;
 
-			cap->Resize(memdepth);
 			awfms.push_back(cap);
 			scales.push_back(scale);
 			offsets.push_back(offset);
@@ -518,62 +470,31 @@ bool ThunderScopeOscilloscope::DoAcquireData(bool keep)
 
 			m_wipWaveforms[GetOscilloscopeChannel(chnum)] = cap;
 
-			//Kick off the GPU-side processing of the waveform to run nonblocking while we download the next
-			//Wait for any previous waveform processing to finish first, since we're reusing the command buffer
-			if(!keep)
-			{}
-			else if(g_hasShaderInt8 && g_hasPushDescriptor && (dataType == DATATYPE_I8))
+			//Kick off the GPU-side processing of the waveform, straight from the ring, to run nonblocking while we
+			//download the next. If the GPU can't do it, make the waveform a view of the raw codes in the ring and
+			//only convert them (on the CPU) if something downstream actually needs floating point samples
+			size_t start = region.m_byteOffset / bytesPerSample;
+			if(dataType == DATATYPE_I8)
 			{
-				m_queue->WaitIdle();
-				m_cmdBuf->begin({});
-
-				m_conversion8BitPipeline->Bind(*m_cmdBuf);
-				m_conversion8BitPipeline->BindBufferNonblocking(0, cap->m_samples, *m_cmdBuf, true);
-				m_conversion8BitPipeline->BindBufferNonblocking(1, *abuf, *m_cmdBuf);
-
-				ConvertRawSamplesShaderArgs args;
-				args.size = cap->size();
-				args.gain = scales[i];
-				args.offset = -offsets[i];
-
-				const uint32_t compute_block_count = GetComputeBlockCount(cap->size(), 64);
-				m_conversion8BitPipeline->DispatchNoRebind(
-					*m_cmdBuf, args,
-					min(compute_block_count, 32768u),
-					compute_block_count / 32768 + 1);
-
-				cap->MarkModifiedFromGpu();
-				m_cmdBuf->end();
-				m_queue->Submit(*m_cmdBuf);
+				if(RawSampleConverter::IsGpuConversionAvailable8Bit())
+				{
+					cap->Resize(memdepth);
+					m_converter->Convert8Bit(cap, *region.m_slab, scale, offset, false, start);
+				}
+				else
+					cap->SetRawSampleView(region.m_slab, region.m_byteOffset, memdepth, 8, scale, offset);
 			}
-			else if(g_hasShaderInt16 && g_hasPushDescriptor && (dataType == DATATYPE_I16))
+			else if(dataType == DATATYPE_I16)
 			{
-				m_queue->WaitIdle();
-				m_cmdBuf->begin({});
-
-				m_conversion16BitPipeline->Bind(*m_cmdBuf);
-				m_conversion16BitPipeline->BindBufferNonblocking(0, cap->m_samples, *m_cmdBuf, true);
-				m_conversion16BitPipeline->BindBufferNonblocking(1, *abuf, *m_cmdBuf);
-
-				ConvertRawSamplesShaderArgs args;
-				args.size = cap->size();
-				args.gain = scales[i];
-				args.offset = -offsets[i];
-
-				const uint32_t compute_block_count = GetComputeBlockCount(cap->size(), 64);
-				m_conversion16BitPipeline->DispatchNoRebind(
-					*m_cmdBuf, args,
-					min(compute_block_count, 32768u),
-					compute_block_count / 32768 + 1);
-
-				cap->MarkModifiedFromGpu();
-				m_cmdBuf->end();
-				m_queue->Submit(*m_cmdBuf);
+				if(RawSampleConverter::IsGpuConversionAvailable16Bit())
+				{
+					cap->Resize(memdepth);
+					m_converter->Convert16Bit(cap, *region.m_slab, scale, offset, start);
+				}
+				else
+					cap->SetRawSampleView(region.m_slab, region.m_byteOffset, memdepth, 16, scale, offset);
 			}
-
-			//Not available, fall back to CPU side processing
-			else
-				processedWaveformsOnGPU = false;
+			m_converter->Submit();
 		}
 		else
 		{
@@ -584,39 +505,11 @@ bool ThunderScopeOscilloscope::DoAcquireData(bool keep)
 	if(!keep)
 		return true;
 
-	//Fallback path if GPU doesn't have suitable integer support
-	if(!processedWaveformsOnGPU)
-	{
-		//Process analog captures in parallel
-		#pragma omp parallel for
-		for(size_t i=0; i<awfms.size(); i++)
-		{
-			auto cap = awfms[i];
-			cap->PrepareForCpuAccess();
-			if(dataType == DATATYPE_I8)
-			{
-				Convert8BitSamples(
-					(float*)&cap->m_samples[0],
-					(int8_t*)m_analogRawWaveformBuffers[achans[i]]->GetCpuPointer(),
-					scales[i],
-					offsets[i],
-					cap->m_samples.size());
-			}
-			else if(dataType == DATATYPE_I16)
-			{
-				Convert16BitSamples(
-					(float*)&cap->m_samples[0],
-					(int16_t*)m_analogRawWaveformBuffers[achans[i]]->GetCpuPointer(),
-					scales[i],
-					offsets[i],
-					cap->m_samples.size());
-			}
-			cap->MarkModifiedFromCpu();
-		}
-
-		//If we did CPU side conversion, push the waveforms to our queue now
+	//If the conversion was done CPU side, push the waveforms to our queue now
+	bool onGPU = (dataType == DATATYPE_I8) ?
+		RawSampleConverter::IsGpuConversionAvailable8Bit() : RawSampleConverter::IsGpuConversionAvailable16Bit();
+	if(!onGPU)
 		PushPendingWaveformsIfReady();
-	}
 
 	m_receiveClock.Tick();
 	m_diag_receivedWFMHz.SetFloatVal(m_receiveClock.GetAverageHz());
@@ -637,40 +530,24 @@ void ThunderScopeOscilloscope::PushPendingWaveformsIfReady()
 		return;
 
 	//Wait up to 1ms for GPU side conversion to finish and return if it's not done
-	if(!m_queue->WaitIdleWithTimeout(1000 * 1000))
+	if(!m_converter->WaitIdleWithTimeout(1000 * 1000))
 		return;
 
-	//Save the waveforms to our queue
-	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(m_wipWaveforms);
+	//Save the waveforms to our queue (if we got backed up, the oldest ones are dropped)
+	size_t newlyDropped = PushPendingWaveform(m_wipWaveforms);
 
 	//Bump waveform performance counters
 	FilterParameter* param = &m_diag_totalWFMs;
 	int total = param->GetIntVal() + 1;
 	param->SetIntVal(total);
 
-	//If we got backed up, drop the extra waveforms
-	param = &m_diag_droppedWFMs;
-	int dropped = param->GetIntVal();
-	while (m_pendingWaveforms.size() > 2)
-	{
-		LogTrace("Dropping waveform due to excessive pend queue depth\n");
-
-		SequenceSet set = *m_pendingWaveforms.begin();
-		for(auto it : set)
-			AddWaveformToAnalogPool(it.second);
-		m_pendingWaveforms.pop_front();
-
-		dropped++;
-	}
-
 	//Update dropped waveform perf counter
+	param = &m_diag_droppedWFMs;
+	int dropped = param->GetIntVal() + newlyDropped;
 	param->SetIntVal(dropped);
 	param = &m_diag_droppedPercent;
 	param->SetFloatVal((float)dropped / (float)total);
 
-	m_pendingWaveformsMutex.unlock();
-
 	m_wipWaveforms.clear();
 
 	#ifdef HAVE_NVTX
@@ -112,6 +112,9 @@ protected:
 
 	void PushPendingWaveformsIfReady();
 
+	virtual void RecyclePendingWaveform(WaveformBase* w) override
+	{ AddWaveformToAnalogPool(w); }
+
 	std::string GetChannelColor(size_t i);
 
 	///@brief Number of analog channels (always 4 at the moment)
@@ -138,29 +141,11 @@ protected:
 	///@brief Counter of average trigger rate
 	HzClock m_receiveClock;
 
-	///@brief Buffers for storing raw ADC samples before converting to fp32
-	std::vector<std::unique_ptr<AcceleratorBuffer<int16_t> > > m_analogRawWaveformBuffers;
-
-	///@brief Index of next buffer from m_analogRawWaveformBuffers to use
-	unsigned int m_nextWaveformWriteBuffer;
-
-	///@brief Vulkan queue used for sample conversion
-	std::shared_ptr<QueueHandle> m_queue;
-
-	///@brief Command pool from which m_cmdBuf was allocated
-	std::unique_ptr<vk::raii::CommandPool> m_pool;
-
-	///@brief Command buffer for sample conversion
-	std::unique_ptr<vk::raii::CommandBuffer> m_cmdBuf;
-
-	///@brief Compute pipeline for converting raw ADC codes to float32 samples
-	std::unique_ptr<ComputePipeline> m_conversion8BitPipeline;
-
-	///@brief Compute pipeline for converting raw ADC codes to float32 samples
-	std::unique_ptr<ComputePipeline> m_conversion16BitPipeline;
+	///@brief Converts raw ADC codes to float32 samples
+	std::unique_ptr<RawSampleConverter> m_converter;
 
-	///@brief Buffer for storing channel clip state
-	AcceleratorBuffer<uint32_t> m_clippingBuffer;
+	///@brief Pinned memory raw ADC samples are streamed into
+	std::unique_ptr<RawSampleRing> m_ring;
 
 	///@brief Bandwidth limiters
 	std::vector<unsigned int> m_bandwidthLimits;
@@ -34,13 +34,24 @@
 	@ingroup core
  */
 #include "scopehal.h"
+#include "PipelineCacheManager.h"
+#include <charconv>
+#include <filesystem>
 #include <math.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
 using namespace std;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // TouchstoneParser
 
+bool TouchstoneParser::m_cacheEnabled = true;
+
 /**
 	@brief Default constructor, does nothing
  */
@@ -68,11 +79,10 @@ bool TouchstoneParser::Load(string fname, SParameters& params)
 {
 	params.Clear();
 
-	//If file doesn't exist, bail early
-	//Open in binary mode because we ignore \r characters for files with Windows line endings,
-	//but we need files with Unix line endings to open correctly on Windows even if no \r is present.
-	FILE* fp = fopen(fname.c_str(), "rb");
-	if(!fp)
+	//If file doesn't exist, bail early.
+	//We ignore \r characters for files with Windows line endings, so map the raw bytes.
+	MappedFile file;
+	if(!file.Open(fname))
 	{
 		LogError("Unable to open S-parameter file %s\n", fname.c_str());
 		return false;
@@ -86,194 +96,502 @@ bool TouchstoneParser::Load(string fname, SParameters& params)
 	if(nports <= 0)
 	{
 		LogError("Unable to determine port count for S-parameter file %s\n", fname.c_str());
-		fclose(fp);
 		return false;
 	}
 	params.Allocate(nports);
 
-	//Read entire file into working buffer
-	fseek(fp, 0, SEEK_END);
-	size_t len = ftell(fp);
-	fseek(fp, 0, SEEK_SET);
-	char* buf = new char[len];
-	if(len != fread(buf, 1, len, fp))
+	auto buf = reinterpret_cast<const char*>(file.GetData());
+	size_t len = file.GetSize();
+
+	//See if we've parsed this exact file before
+	string cachePath;
+	uint64_t hash = 0;
+	if(m_cacheEnabled && (len >= CACHE_MIN_FILE_SIZE) )
 	{
-		delete[] buf;
-		fclose(fp);
-		return false;
+		hash = HashFile(file.GetData(), len);
+		cachePath = GetCachePath(hash);
 	}
-	fclose(fp);
+	if(!cachePath.empty() && LoadCache(cachePath, hash, len, params))
+	{
+		LogTrace("Loaded %zu S-parameter points from cache\n", params.m_params[SPair(1,1)]->m_points.size());
+		return true;
+	}
+
+	if(!Parse(buf, len, nports, params))
+		return false;
+	LogTrace("Loaded %zu S-parameter points\n", params.m_params[SPair(1,1)]->m_points.size());
+
+	if(!cachePath.empty())
+		SaveCache(cachePath, hash, len, params);
+	return true;
+}
+
+/**
+	@brief Parses the content of a SxP file
+
+	@param		buf		File content
+	@param		len		Size of the file content
+	@param		nports	Number of ports
+	@param[out]	params	The parsed S-parameters, already allocated for nports ports
 
-	//Main parsing loop
-	size_t i = 0;
-	bool ok = true;
+	@return	True on success, false on failure
+ */
+bool TouchstoneParser::Parse(const char* buf, size_t len, size_t nports, SParameters& params)
+{
+	//Walk the preamble serially: blank lines, comments, and the option line. Stop at the first line of data.
 	double unit_scale = 1;
 	bool mag_is_db = false;
 	bool polar = true;			//mag/angle
-	while(i < len)
+	const char* p = buf;
+	const char* end = buf + len;
+	while(p < end)
 	{
-		//Discard whitespace
-		if(isspace(buf[i]))
-			i++;
+		auto eol = reinterpret_cast<const char*>(memchr(p, '\n', end - p));
+		const char* lineEnd = eol ? eol : end;
+		const char* next = eol ? eol + 1 : end;
+
+		const char* q = p;
+		while( (q < lineEnd) && isspace(*q) )
+			q++;
 
-		//! is a comment, ignore everything until the next newline
-		else if(buf[i] == '!')
+		//# is the option line
+		if( (q < lineEnd) && (*q == '#') )
 		{
-			while( (i < len) && (buf[i] != '\n') )
-				i++;
+			if(!ParseOptionLine(string(q, lineEnd), unit_scale, mag_is_db, polar))
+				return false;
 		}
 
-		//# is the option line
-		else if(buf[i] == '#')
+		//Anything other than a blank line or ! comment is the start of the network data
+		else if( (q < lineEnd) && (*q != '!') )
+			break;
+
+		p = next;
+	}
+
+	//Split the network data into newline-aligned partitions
+	const size_t partitionSize = 1024 * 1024;
+	vector<const char*> bounds;
+	bounds.push_back(p);
+	while(true)
+	{
+		const char* target = bounds.back() + partitionSize;
+		if(target >= end)
+			break;
+		auto eol = reinterpret_cast<const char*>(memchr(target, '\n', end - target));
+		if(!eol)
+			break;
+		bounds.push_back(eol + 1);
+	}
+	bounds.push_back(end);
+	size_t npart = bounds.size() - 1;
+
+	//First pass: count the numbers in each partition so we know where each partition's values go
+	vector<size_t> firstTokens(npart + 1, 0);
+	#pragma omp parallel for
+	for(size_t i=0; i<npart; i++)
+	{
+		bool ignored;
+		firstTokens[i+1] = ScanTokens(bounds[i], bounds[i+1], 0, nullptr, nullptr, 0, ignored);
+	}
+	for(size_t i=0; i<npart; i++)
+		firstTokens[i+1] += firstTokens[i];
+
+	//Each point is the frequency followed by nports * nports mag/angle or real/imaginary tuples
+	size_t nparams = nports * nports;
+	size_t perPoint = 1 + 2*nparams;
+	size_t ntokens = firstTokens[npart];
+	if(ntokens % perPoint)
+	{
+		LogError("Touchstone file ends partway through a frequency point\n");
+		return false;
+	}
+	size_t npoints = ntokens / perPoint;
+
+	//Figure out where each parameter in the matrix goes.
+	//NOTE! Parameter ordering is different for 2 vs 3+ port
+	//For 2 port, we loop destination inner and source outer (S11 S21 S12 S22)
+	//For 3+ port, we have source inner and destination outer (S11 S12 S13 S21 S22 S23 ...)
+	//See pages 6 and 8 of Touchstone File Specification rev 1.1
+	vector<SParameterVector*> vecs;
+	vector<SParameterPoint*> dests;
+	for(size_t outer=1; outer <= nports; outer ++)
+	{
+		for(size_t inner=1; inner <= nports; inner ++)
 		{
-			//Format: # [freq unit] S [MA|DB|RI] R [impedance]
-			char freq_unit[32];
-			char volt_unit[32];
-			int impedance;
-			if(3 != sscanf(buf+i, "# %31s S %31s R %d", freq_unit, volt_unit, &impedance))
+			size_t src;
+			size_t dest;
+			if(nports <= 2)
 			{
-				LogError("Failed to parse Touchstone header line \"%s\"\n", buf+i);
-				ok = false;
-				break;
+				dest = inner;
+				src = outer;
 			}
-
-			//Figure out units
-			string funit(freq_unit);
-			if( (funit == "MHZ") ||  (funit == "MHz") )
-				unit_scale = 1e6;
-			else if( (funit == "GHZ") || (funit == "GHz") )
-				unit_scale = 1e9;
-			else if( (funit == "KHZ") || (funit == "kHz") )
-				unit_scale = 1e3;
-			else if( (funit == "HZ") || (funit == "Hz") )
-				unit_scale = 1;
 			else
 			{
-				LogError("Unrecognized Touchstone frequency unit (got %s)\n", freq_unit);
-				ok = false;
-				break;
-			}
-			if(0 == strcmp(volt_unit, "MA"))
-			{
-				//magnitude, no action required
+				dest = outer;
+				src = inner;
 			}
-			else if( (0 == strcmp(volt_unit, "DB")) || (0 == strcmp(volt_unit, "dB")) )
-				mag_is_db = true;
-			else if(0 == strcmp(volt_unit, "RI"))
-				polar = false;
+
+			auto vec = params.m_params[SPair(dest, src)];
+			vec->m_points.resize(npoints);
+			vec->m_points.PrepareForCpuAccess();
+			vecs.push_back(vec);
+			dests.push_back(vec->m_points.GetCpuPointer());
+		}
+	}
+
+	//Second pass: parse the raw numbers straight into the output arrays
+	vector<double> freqs(npoints);
+	vector<uint8_t> partitionOK(npart, 1);
+	#pragma omp parallel for
+	for(size_t i=0; i<npart; i++)
+	{
+		bool ok = true;
+		ScanTokens(bounds[i], bounds[i+1], firstTokens[i], freqs.data(), dests.data(), nparams, ok);
+		partitionOK[i] = ok;
+	}
+	for(auto ok : partitionOK)
+	{
+		if(!ok)
+		{
+			LogError("Malformed number in Touchstone network data\n");
+			return false;
+		}
+	}
+
+	//Scale frequencies and convert everything to magnitude (not dB) and angle in radians
+	#pragma omp parallel for
+	for(size_t i=0; i<npoints; i++)
+	{
+		float freq = freqs[i] * unit_scale;
+		for(size_t j=0; j<nparams; j++)
+		{
+			auto& point = dests[j][i];
+			float mag = point.m_amplitude;
+			float angle = point.m_phase;
+
+			//Convert dB magnitudes to absolute magnitudes
+			if(mag_is_db)
+				mag = pow(10, mag/20);
+
+			//Touchstone uses degrees, but we use radians internally
+			if(polar)
+				angle *= (M_PI / 180);
+
+			//Convert real/imaginary format to mag/angle
 			else
-			{
-				LogError("Touchstone units other than magnitude, real/imaginary, and dB not supported (got %s)\n", volt_unit);
-				ok = false;
-				break;
-			}
+				ComplexToPolar(mag, angle);
 
-			//Skip ahead to the next newline
-			while( (i < len) && (buf[i] != '\n') )
-				i++;
+			point = SParameterPoint(freq, mag, angle);
 		}
+	}
+
+	for(auto vec : vecs)
+		vec->m_points.MarkModifiedFromCpu();
+
+	return true;
+}
+
+/**
+	@brief Parses the option line
+
+	@param		line		The line, starting with the #
+	@param[out]	unit_scale	Frequency unit, in Hz
+	@param[out]	mag_is_db	True if magnitudes are in dB
+	@param[out]	polar		True if data is in polar (rather than real/imaginary) format
 
-		//Actual network data
+	@return True on success
+ */
+bool TouchstoneParser::ParseOptionLine(const string& line, double& unit_scale, bool& mag_is_db, bool& polar)
+{
+	//Format: # [freq unit] S [MA|DB|RI] R [impedance]
+	char freq_unit[32];
+	char volt_unit[32];
+	int impedance;
+	if(3 != sscanf(line.c_str(), "# %31s S %31s R %d", freq_unit, volt_unit, &impedance))
+	{
+		LogError("Failed to parse Touchstone header line \"%s\"\n", line.c_str());
+		return false;
+	}
+
+	//Figure out units
+	string funit(freq_unit);
+	if( (funit == "MHZ") ||  (funit == "MHz") )
+		unit_scale = 1e6;
+	else if( (funit == "GHZ") || (funit == "GHz") )
+		unit_scale = 1e9;
+	else if( (funit == "KHZ") || (funit == "kHz") )
+		unit_scale = 1e3;
+	else if( (funit == "HZ") || (funit == "Hz") )
+		unit_scale = 1;
+	else
+	{
+		LogError("Unrecognized Touchstone frequency unit (got %s)\n", freq_unit);
+		return false;
+	}
+	if(0 == strcmp(volt_unit, "MA"))
+	{
+		//magnitude, no action required
+	}
+	else if( (0 == strcmp(volt_unit, "DB")) || (0 == strcmp(volt_unit, "dB")) )
+		mag_is_db = true;
+	else if(0 == strcmp(volt_unit, "RI"))
+		polar = false;
+	else
+	{
+		LogError("Touchstone units other than magnitude, real/imaginary, and dB not supported (got %s)\n", volt_unit);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+	@brief Tokenizes one newline-aligned partition of the network data
+
+	Comments (from ! to end of line) and any further option lines are skipped.
+
+	@param		begin		Start of the partition
+	@param		end			End of the partition
+	@param		firstToken	Index of the first number in the partition, within the whole data section
+	@param		freqs		Output array of raw frequencies, one per point (if null, just count numbers)
+	@param		dests		Output array for each parameter, in file order. Raw values are stored in
+							m_amplitude and m_phase, m_frequency is not touched.
+	@param		nparams		Number of parameters in each point
+	@param[out]	ok			Cleared if a malformed number is found (not touched when only counting)
+
+	@return Number of numbers in the partition
+ */
+size_t TouchstoneParser::ScanTokens(
+	const char* begin,
+	const char* end,
+	size_t firstToken,
+	double* freqs,
+	SParameterPoint* const* dests,
+	size_t nparams,
+	bool& ok)
+{
+	size_t perPoint = 1 + 2*nparams;
+	size_t point = firstToken / perPoint;
+	size_t field = firstToken % perPoint;
+
+	size_t count = 0;
+	const char* p = begin;
+	while(p < end)
+	{
+		//Discard whitespace
+		if(isspace(*p))
+			p++;
+
+		//Comments and option lines, ignore everything until the next newline
+		else if( (*p == '!') || (*p == '#') )
+		{
+			auto eol = reinterpret_cast<const char*>(memchr(p, '\n', end - p));
+			p = eol ? eol : end;
+		}
+
+		//A number
 		else
 		{
-			//Read the frequency and scale appropriately
-			float freq;
-			if(!ReadFloat(buf, i, len, freq))
-			{
-				ok = false;
-				break;
-			}
-			freq *= unit_scale;
+			const char* tokEnd = p;
+			while( (tokEnd < end) && !isspace(*tokEnd) && (*tokEnd != '!') )
+				tokEnd ++;
 
-			//The actual S-matrix is nports * nports mag/angle or real/imaginary tuples
-			float mag;
-			float angle;
-			for(size_t outer=1; outer <= nports; outer ++)
+			if(freqs)
 			{
-				for(size_t inner=1; inner <= nports; inner ++)
+				//from_chars doesn't accept a leading +
+				if(*p == '+')
+					p++;
+
+				double v = 0;
+				auto result = from_chars(p, tokEnd, v);
+				if( (result.ec != errc()) || (result.ptr != tokEnd) )
+					ok = false;
+
+				if(field == 0)
+					freqs[point] = v;
+				else if(field & 1)
+					dests[(field - 1) / 2][point].m_amplitude = v;
+				else
+					dests[(field - 1) / 2][point].m_phase = v;
+
+				field ++;
+				if(field == perPoint)
 				{
-					//NOTE! Parameter ordering is different for 2 vs 3+ port
-					//For 2 port, we loop destination inner and source outer (S11 S21 S12 S22)
-					//For 3+ port, we have source inner and destination outer (S11 S12 S13 S21 S22 S23 ...)
-					//See pages 6 and 8 of Touchstone File Specification rev 1.1
-					size_t src;
-					size_t dest;
-					if(nports <= 2)
-					{
-						dest = inner;
-						src = outer;
-					}
-					else
-					{
-						dest = outer;
-						src = inner;
-					}
-
-					//Read the inputs
-					if(!ReadFloat(buf, i, len, mag) || !ReadFloat(buf, i, len, angle))
-					{
-						ok = false;
-						break;
-					}
-
-					//Convert dB magnitudes to absolute magnitudes
-					if(mag_is_db)
-						mag = pow(10, mag/20);
-
-					//Touchstone uses degrees, but we use radians internally
-					if(polar)
-						angle *= (M_PI / 180);
-
-					//Convert real/imaginary format to mag/angle
-					else
-						ComplexToPolar(mag, angle);
-
-					//and save the final results
-					params.m_params[SPair(dest, src)]->m_points.push_back(SParameterPoint(freq, mag, angle));
+					field = 0;
+					point ++;
 				}
-				if(!ok)
-					break;
 			}
-			if(!ok)
-				break;
 
-			i++;
+			count ++;
+			p = tokEnd;
 		}
 	}
 
+	return count;
+}
 
-	delete[] buf;
-	LogTrace("Loaded %zu S-parameter points\n", params.m_params[SPair(1,1)]->m_points.size());
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Binary cache
 
-	return ok;
+/**
+	@brief Hashes the content of a file
+
+	The file is hashed in 1 MB blocks in parallel, eight bytes at a time, then the block hashes are combined. This is
+	not a cryptographic hash, it only has to tell apart different versions of a file.
+ */
+uint64_t TouchstoneParser::HashFile(const uint8_t* buf, size_t len)
+{
+	//splitmix64 finalizer
+	auto mix = [](uint64_t x)
+	{
+		x ^= x >> 30;
+		x *= 0xbf58476d1ce4e5b9ULL;
+		x ^= x >> 27;
+		x *= 0x94d049bb133111ebULL;
+		x ^= x >> 31;
+		return x;
+	};
+
+	const size_t blocksize = 1024 * 1024;
+	size_t nblocks = (len + blocksize - 1) / blocksize;
+	vector<uint64_t> blockHashes(nblocks);
+	#pragma omp parallel for
+	for(size_t block=0; block<nblocks; block++)
+	{
+		size_t start = block * blocksize;
+		size_t end = min(len, start + blocksize);
+
+		uint64_t h = mix(block);
+		size_t i = start;
+		for(; i+8 <= end; i += 8)
+		{
+			uint64_t w;
+			memcpy(&w, buf + i, sizeof(w));
+			h = mix(h ^ w);
+		}
+
+		uint64_t tail = 0;
+		memcpy(&tail, buf + i, end - i);
+		blockHashes[block] = mix(h ^ tail);
+	}
+
+	uint64_t h = mix(len);
+	for(auto bh : blockHashes)
+		h = mix(h ^ bh);
+	return h;
 }
 
 /**
-	@brief Reads a single ASCII float from the input buffer
+	@brief Returns the path of the cache file for a given source file hash, or an empty string if there's no cache
+ */
+string TouchstoneParser::GetCachePath(uint64_t hash)
+{
+	if(!g_pipelineCacheMgr)
+		return "";
+
+	char name[64];
+	snprintf(name, sizeof(name), "touchstone_%016" PRIx64 ".bin", hash);
+	return g_pipelineCacheMgr->GetCacheRootDir() + name;
+}
 
-	@param		 	buf		Input buffer
-	@param		 	i		Index of the cursor within the buffer
-	@param		 	len		Size of the buffer
-	@param[out]		f		Output value
+/**
+	@brief Loads S-parameters from a cache file, if it exists and matches the source file
 
-	@param True on success, false on EOF or malformed data
+	@return True if the cache was valid and the S-parameters were loaded
  */
-bool TouchstoneParser::ReadFloat(const char* buf, size_t& i, size_t len, float& f)
+bool TouchstoneParser::LoadCache(const string& path, uint64_t hash, size_t fileSize, SParameters& params)
 {
-	//eat spaces
-	while(isspace(buf[i]) && (i < len) )
-		i++;
-	if(i >= len)
+	FILE* fp = fopen(path.c_str(), "rb");
+	if(!fp)
 		return false;
 
-	//read the value
-	f = atof(buf + i);
+	fseek(fp, 0, SEEK_END);
+	size_t cacheSize = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
 
-	//eat digits
-	while(!isspace(buf[i]) && (i < len) )
-		i++;
-	return true;
+	size_t nports = params.GetNumPorts();
+	TouchstoneCacheHeader header;
+	bool ok =
+		(1 == fread(&header, sizeof(header), 1, fp)) &&
+		(0 == memcmp(header.magic, "SXPCACH1", sizeof(header.magic))) &&
+		(header.hash == hash) &&
+		(header.fileSize == fileSize) &&
+		(header.pointSize == sizeof(SParameterPoint)) &&
+		(header.nports == nports) &&
+		(cacheSize == sizeof(header) + header.npoints * nports * nports * sizeof(SParameterPoint));
+
+	for(size_t d=1; ok && (d <= nports); d++)
+	{
+		for(size_t s=1; ok && (s <= nports); s++)
+		{
+			auto& points = params.m_params[SPair(d, s)]->m_points;
+			points.resize(header.npoints);
+			points.PrepareForCpuAccess();
+			ok = (header.npoints == fread(points.GetCpuPointer(), sizeof(SParameterPoint), header.npoints, fp));
+			points.MarkModifiedFromCpu();
+		}
+	}
 
+	fclose(fp);
+
+	if(!ok)
+		LogTrace("Touchstone cache file %s is stale or corrupted, ignoring\n", path.c_str());
+	return ok;
+}
+
+/**
+	@brief Writes S-parameters to a cache file
+
+	The content is written to a temporary file which then replaces the old one, so another process loading the cache
+	at the same time sees either the old file or the new one, never a partial write.
+ */
+void TouchstoneParser::SaveCache(const string& path, uint64_t hash, size_t fileSize, SParameters& params)
+{
+#ifdef _WIN32
+	auto tmpPath = path + ".tmp" + to_string(GetCurrentProcessId());
+#else
+	auto tmpPath = path + ".tmp" + to_string(getpid());
+#endif
+
+	FILE* fp = fopen(tmpPath.c_str(), "wb");
+	if(!fp)
+	{
+		LogWarning("Failed to create Touchstone cache file (%s)\n", tmpPath.c_str());
+		return;
+	}
+
+	size_t nports = params.GetNumPorts();
+	TouchstoneCacheHeader header;
+	memcpy(header.magic, "SXPCACH1", sizeof(header.magic));
+	header.hash = hash;
+	header.fileSize = fileSize;
+	header.pointSize = sizeof(SParameterPoint);
+	header.nports = nports;
+	header.npoints = params.m_params[SPair(1, 1)]->m_points.size();
+	bool ok = (1 == fwrite(&header, sizeof(header), 1, fp));
+
+	for(size_t d=1; ok && (d <= nports); d++)
+	{
+		for(size_t s=1; ok && (s <= nports); s++)
+		{
+			auto& points = params.m_params[SPair(d, s)]->m_points;
+			points.PrepareForCpuAccess();
+			ok = (header.npoints == fwrite(points.GetCpuPointer(), sizeof(SParameterPoint), header.npoints, fp));
+		}
+	}
+
+	if(0 != fclose(fp))
+		ok = false;
+
+	//Swap it in
+	error_code ec;
+	if(ok)
+		filesystem::rename(tmpPath, path, ec);
+	if(!ok || ec)
+	{
+		LogWarning("Failed to write Touchstone cache file (%s)\n", path.c_str());
+		filesystem::remove(tmpPath, ec);
+	}
 }
 
 /**
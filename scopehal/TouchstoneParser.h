@@ -37,9 +37,32 @@
 #ifndef TouchstoneParser_h
 #define TouchstoneParser_h
 
+/**
+	@brief Header of a binary Touchstone cache file
+	@ingroup core
+
+	The header is followed by the points of every S-parameter, as raw SParameterPoint arrays, in (destination, source)
+	order: S11, S12 ... S1n, S21 ...
+ */
+struct TouchstoneCacheHeader
+{
+	char		magic[8];
+	uint64_t	hash;			//hash of the source file content
+	uint64_t	fileSize;		//size of the source file
+	uint32_t	pointSize;		//sizeof(SParameterPoint) in the writing build
+	uint32_t	nports;
+	uint64_t	npoints;		//points per S-parameter
+};
+
 /**
 	@brief Touchstone (SxP) file parser
 	@ingroup core
+
+	The data section is split into newline-aligned partitions which are tokenized in parallel, each token being
+	written straight to its final location in the output SParameterVector.
+
+	Large files are also cached in binary form in the pipeline cache directory, keyed by a hash of the file content, so
+	loading a file that has been seen before is just a hash of the file and a block read.
  */
 class TouchstoneParser
 {
@@ -49,10 +72,38 @@ public:
 
 	bool Load(std::string fname, SParameters& params);
 
+	///@brief Enables or disables the binary cache of parsed files (enabled by default)
+	static void SetCacheEnabled(bool enabled)
+	{ m_cacheEnabled = enabled; }
+
+	///@brief Returns true if the binary cache of parsed files is enabled
+	static bool IsCacheEnabled()
+	{ return m_cacheEnabled; }
+
 protected:
 	void ComplexToPolar(float& f1, float& f2);
 
-	bool ReadFloat(const char* buf, size_t& i, size_t len, float& f);
+	bool Parse(const char* buf, size_t len, size_t nports, SParameters& params);
+	bool ParseOptionLine(const std::string& line, double& unit_scale, bool& mag_is_db, bool& polar);
+	static size_t ScanTokens(
+		const char* begin,
+		const char* end,
+		size_t firstToken,
+		double* freqs,
+		SParameterPoint* const* dests,
+		size_t nparams,
+		bool& ok);
+
+	static uint64_t HashFile(const uint8_t* buf, size_t len);
+	static std::string GetCachePath(uint64_t hash);
+	bool LoadCache(const std::string& path, uint64_t hash, size_t fileSize, SParameters& params);
+	void SaveCache(const std::string& path, uint64_t hash, size_t fileSize, SParameters& params);
+
+	///@brief True if the binary cache is enabled
+	static bool m_cacheEnabled;
+
+	///@brief Files smaller than this parse so fast they aren't worth caching
+	static const size_t CACHE_MIN_FILE_SIZE = 256 * 1024;
 };
 
 #endif
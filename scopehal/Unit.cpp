@@ -37,6 +37,7 @@
 #include "scopehal.h"
 
 #include <cinttypes>
+#include <charconv>
 
 using namespace std;
 
@@ -247,7 +248,7 @@ string Unit::ToString() const
 /**
 	@brief Gets the appropriate SI scaling factor for a number.
  */
-void Unit::GetSIScalingFactor(double num, double& scaleFactor, string& prefix) const
+void Unit::GetSIScalingFactor(double num, double& scaleFactor, const char*& prefix) const
 {
 	scaleFactor = 1;
 	prefix = "";
@@ -324,11 +325,13 @@ void Unit::GetSIScalingFactor(double num, double& scaleFactor, string& prefix) c
 /**
 	@brief Gets the suffix for a unit.
 
-	Note that this function may modify the SI scale factor and prefix
+	Note that this function may modify the SI scale factor and prefix. All strings returned are literals, so looking up
+	a unit never allocates.
  */
-void Unit::GetUnitSuffix(UnitType type, double num, double& scaleFactor, string& prefix, string& numprefix, string& suffix) const
+void Unit::GetUnitSuffix(UnitType type, double num, double& scaleFactor, const char*& prefix, const char*& numprefix, const char*& suffix) const
 {
 	numprefix = "";
+	suffix = "";
 
 	switch(type)
 	{
@@ -644,47 +647,123 @@ void Unit::GetUnitSuffix(UnitType type, double num, double& scaleFactor, string&
  */
 string Unit::PrettyPrint(double value, int sigfigs, bool useDisplayLocale) const
 {
+	char tmp[128];
+	size_t len = PrettyPrintToBuffer(tmp, sizeof(tmp), value, sigfigs, useDisplayLocale);
+	return string(tmp, len);
+}
+
+/**
+	@brief Appends a null terminated string to a bounded buffer
+
+	@return Pointer to the end of the copied text
+ */
+static char* AppendString(char* p, char* end, const char* str)
+{
+	while( (p < end) && (*str != '\0') )
+		*(p++) = *(str++);
+	return p;
+}
+
+/**
+	@brief Formats a floating point number into a bounded buffer the same way printf's %*.*f or %.*e would
+
+	@param p			Start of the output
+	@param end			End of the output buffer
+	@param value		The value to format
+	@param format		Fixed or scientific notation
+	@param precision	Digits after the decimal point
+	@param width		Minimum width of the field, padded with leading spaces
+	@param separator	Decimal separator to use
+
+	@return Pointer to the end of the formatted text
+ */
+static char* AppendDouble(
+	char* p,
+	char* end,
+	double value,
+	chars_format format,
+	int precision,
+	int width,
+	char separator)
+{
+	char tmp[64];
+	auto result = to_chars(tmp, tmp + sizeof(tmp), value, format, max(precision, 0));
+	if(result.ec != errc())
+		return p;
+
+	for(int pad = width - (result.ptr - tmp); (pad > 0) && (p < end); pad --)
+		*(p++) = ' ';
+	for(char* q = tmp; (q < result.ptr) && (p < end); q++)
+		*(p++) = (*q == '.') ? separator : *q;
+	return p;
+}
+
+/**
+	@brief Prints a value with SI scaling factors into a caller supplied buffer
+
+	This is the allocation-free backend for PrettyPrint(). It does not touch the thread's locale: numbers are formatted
+	with std::to_chars and the decimal separator of the display locale (cached by InitializeLocales()) is substituted
+	afterwards, so it is safe and cheap to call in render and export loops.
+
+	@param buf					Output buffer, always null terminated if len is nonzero
+	@param len					Size of the output buffer
+	@param value				The value
+	@param digits				Number of significant digits to display
+	@param useDisplayLocale		True if the string is formatted for display (user's locale)
+								False if the string is formatted for serialization ("C" locale regardless of user pref)
+
+	@return Number of characters written, not counting the null terminator. Output which does not fit is truncated.
+ */
+size_t Unit::PrettyPrintToBuffer(char* buf, size_t len, double value, int sigfigs, bool useDisplayLocale) const
+{
+	if(len == 0)
+		return 0;
+	char* p = buf;
+	char* end = buf + len - 1;
+
 	// Special handling for overload value
 	if(value >= std::numeric_limits<double>::max())
-		return UNIT_OVERLOAD_LABEL;
+	{
+		p = AppendString(p, end, UNIT_OVERLOAD_LABEL);
+		*p = '\0';
+		return p - buf;
+	}
 
-	if(useDisplayLocale)
-		SetPrintingLocale();
+	char separator = useDisplayLocale ? m_decimalSeparator : '.';
 
 	//Figure out scaling, prefix, and suffix
 	double scaleFactor;
-	string prefix;
-	string numprefix;
-	string suffix;
+	const char* prefix;
+	const char* numprefix;
+	const char* suffix;
 	GetSIScalingFactor(value, scaleFactor, prefix);
 	GetUnitSuffix(m_type, value, scaleFactor, prefix, numprefix, suffix);
 
 	double value_rescaled = value * scaleFactor;
 	bool space_after_number = (m_type != Unit::UNIT_UI) && (m_type != Unit::UNIT_HEXNUM);
 
-	char tmp[128];
+	p = AppendString(p, end, numprefix);
 	switch(m_type)
 	{
 		case UNIT_LOG_BER:		//special formatting for BER since it's already logarithmic
-			snprintf(tmp, sizeof(tmp), "%.2e", pow(10, value));
-			//snprintf(tmp, sizeof(tmp), "1e%.2f", value);
+			p = AppendDouble(p, end, pow(10, value), chars_format::scientific, 2, 0, separator);
 			break;
 
 		case UNIT_RATIO_SCI:
-			snprintf(tmp, sizeof(tmp), "%.2e", value);
+			p = AppendDouble(p, end, value, chars_format::scientific, 2, 0, separator);
 			break;
 
 		//NOTE: only works for 32 bit values or smaller
 		case UNIT_HEXNUM:
-			snprintf(tmp, sizeof(tmp), "%x", static_cast<uint32_t>(value));
+			{
+				auto result = to_chars(p, end, static_cast<uint32_t>(value), 16);
+				if(result.ec == errc())
+					p = result.ptr;
+			}
 			break;
 
 		default:
 			{
-				const char* space = " ";
-				if(!space_after_number)
-					space = "";
-
 				if(sigfigs > 0)
 				{
 					int leftdigits = 0;
@@ -698,32 +777,37 @@ string Unit::PrettyPrint(double value, int sigfigs, bool useDisplayLocale) const
 						leftdigits = 1;
 					int rightdigits = sigfigs - leftdigits;
 
-					string format = string("%") + to_string(leftdigits) + "." + to_string(rightdigits) + "f%s%s%s";
-					snprintf(tmp, sizeof(tmp), format.c_str(), value_rescaled, space, prefix.c_str(), suffix.c_str());
+					p = AppendDouble(p, end, value_rescaled, chars_format::fixed, rightdigits, leftdigits, separator);
 				}
 
 				//If not a round number, add more digits (up to 5)
 				else
 				{
+					int rightdigits = 5;
 					if( fabs(round(value_rescaled) - value_rescaled) < 0.001 )
-						snprintf(tmp, sizeof(tmp), "%.0f%s%s%s", value_rescaled, space, prefix.c_str(), suffix.c_str());
+						rightdigits = 0;
 					else if(fabs(round(value_rescaled*10) - value_rescaled*10) < 0.001)
-						snprintf(tmp, sizeof(tmp), "%.1f%s%s%s", value_rescaled, space, prefix.c_str(), suffix.c_str());
+						rightdigits = 1;
 					else if(fabs(round(value_rescaled*100) - value_rescaled*100) < 0.001 )
-						snprintf(tmp, sizeof(tmp), "%.2f%s%s%s", value_rescaled, space, prefix.c_str(), suffix.c_str());
+						rightdigits = 2;
 					else if(fabs(round(value_rescaled*1000) - value_rescaled*1000) < 0.001 )
-						snprintf(tmp, sizeof(tmp), "%.3f%s%s%s", value_rescaled, space, prefix.c_str(), suffix.c_str());
+						rightdigits = 3;
 					else if(fabs(round(value_rescaled*10000) - value_rescaled*10000) < 0.001 )
-						snprintf(tmp, sizeof(tmp), "%.4f%s%s%s", value_rescaled, space, prefix.c_str(), suffix.c_str());
-					else
-						snprintf(tmp, sizeof(tmp), "%.5f%s%s%s", value_rescaled, space, prefix.c_str(), suffix.c_str());
+						rightdigits = 4;
+
+					p = AppendDouble(p, end, value_rescaled, chars_format::fixed, rightdigits, 0, separator);
 				}
+
+				if(space_after_number)
+					p = AppendString(p, end, " ");
+				p = AppendString(p, end, prefix);
+				p = AppendString(p, end, suffix);
 			}
 			break;
 	}
 
-	SetDefaultLocale();
-	return numprefix + string(tmp);
+	*p = '\0';
+	return p - buf;
 }
 
 /**
@@ -741,9 +825,9 @@ string Unit::PrettyPrintInt64(int64_t value, int /*sigfigs*/, bool useDisplayLoc
 
 	//Figure out scaling, prefix, and suffix
 	double scaleFactor;
-	string prefix;
-	string numprefix;
-	string suffix;
+	const char* prefix;
+	const char* numprefix;
+	const char* suffix;
 	GetSIScalingFactor(value, scaleFactor, prefix);
 	GetUnitSuffix(m_type, value, scaleFactor, prefix, numprefix, suffix);
 
@@ -850,9 +934,9 @@ string Unit::PrettyPrintRange(double pixelMin, double pixelMax, double rangeMin,
 
 	//Figure out the scale factor to use. Use the full-scale range to select the factor even if we're small here
 	double scaleFactor;
-	string prefix;
-	string numprefix;
-	string suffix;
+	const char* prefix;
+	const char* numprefix;
+	const char* suffix;
 	double extremeValue = max(fabs(rangeMin), fabs(rangeMax));
 	GetSIScalingFactor(extremeValue, scaleFactor, prefix);
 	GetUnitSuffix(m_type, extremeValue, scaleFactor, prefix, numprefix, suffix);
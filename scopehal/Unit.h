@@ -118,6 +118,8 @@ public:
 	std::string ToString() const;
 
 	std::string PrettyPrint(double value, int sigfigs = -1, bool useDisplayLocale = true) const;
+	size_t PrettyPrintToBuffer(
+		char* buf, size_t len, double value, int sigfigs = -1, bool useDisplayLocale = true) const;
 	std::string PrettyPrintInt64(int64_t value, int sigfigs = -1, bool useDisplayLocale = true) const;
 
 	std::string PrettyPrintRange(double pixelMin, double pixelMax, double rangeMin, double rangeMax) const;
@@ -147,8 +149,8 @@ public:
 protected:
 	UnitType m_type;
 
-	void GetSIScalingFactor(double num, double& scaleFactor, std::string& prefix) const;
-	void GetUnitSuffix(UnitType type, double num, double& scaleFactor, std::string& prefix, std::string& numprefix, std::string& suffix) const;
+	void GetSIScalingFactor(double num, double& scaleFactor, const char*& prefix) const;
+	void GetUnitSuffix(UnitType type, double num, double& scaleFactor, const char*& prefix, const char*& numprefix, const char*& suffix) const;
 
 #ifdef _WIN32
 	/**
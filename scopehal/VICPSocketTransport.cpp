@@ -50,6 +50,8 @@ VICPSocketTransport::VICPSocketTransport(const string& args)
 	: m_nextSequence(1)
 	, m_lastSequence(1)
 	, m_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)
+	, m_blockFrameBytesLeft(0)
+	, m_blockFrameEOI(false)
 {
 	char hostname[128];
 	unsigned int port = 0;
@@ -81,7 +83,7 @@ VICPSocketTransport::VICPSocketTransport(const string& args)
 	}
 
 	//Attempt to set a 32 MB RX buffer.
-	if(!m_socket.SetRxBuffer(32 * 1024 * 1024))
+	if(!m_socket.SetRxBuffer(SCPISocketTransport::RX_BUFFER_SIZE))
 		LogWarning("Could not set 32 MB RX buffer. Consider increasing /proc/sys/net/core/rmem_max\n");
 }
 
@@ -252,34 +254,80 @@ void VICPSocketTransport::SendRawData(size_t len, const unsigned char* buf)
 
 size_t VICPSocketTransport::ReadRawData(size_t len, unsigned char* buf, function<void(float)> progress)
 {
-	size_t chunk_size = len;
-	if (progress)
+	return SCPISocketTransport::ReadLooped(m_socket, len, buf, progress);
+}
+
+/**
+	@brief Reads the next VICP frame header of a binary block reply
+
+	@return True on success, false on a socket or protocol error
+ */
+bool VICPSocketTransport::ReadBlockFrameHeader()
+{
+	unsigned char header[8];
+	if(8 != ReadRawData(8, header))
+		return false;
+	if(header[1] != 1)
 	{
-		/* carve up the chunk_size into either 1% or 32kB chunks, whichever is larger; later, we'll want RecvLooped to do this for us */
-		chunk_size /= 100;
-		if (chunk_size < 32768)
-			chunk_size = 32768;
+		LogError("Bad VICP protocol version\n");
+		return false;
 	}
 
-	for (size_t pos = 0; pos < len; )
+	m_blockFrameBytesLeft = (header[4] << 24) | (header[5] << 16) | (header[6] << 8) | header[7];
+	m_blockFrameEOI = (header[0] & OP_EOI) != 0;
+	return true;
+}
+
+/**
+	@brief Reads binary block bytes, stripping VICP framing so the payload lands directly in the caller's buffer
+ */
+size_t VICPSocketTransport::ReadBlockPayload(size_t len, unsigned char* buf, function<void(float)> progress)
+{
+	size_t nread = 0;
+	while(nread < len)
 	{
-		size_t n = chunk_size;
-		if (n > (len - pos))
-			n = len - pos;
-		if(!m_socket.RecvLooped(buf + pos, n))
+		if(m_blockFrameBytesLeft == 0)
 		{
-			LogTrace("Failed to get %zu bytes (@ pos %zu)\n", len, pos);
-			return 0;
+			if(!ReadBlockFrameHeader())
+				break;
+			continue;
 		}
-		pos += n;
-		if (progress)
+
+		size_t chunk = min(len - nread, m_blockFrameBytesLeft);
+		function<void(float)> sub = nullptr;
+		if(progress)
+			sub = [nread, chunk, len, progress](float p) { progress( (nread + p*chunk) / len); };
+		if(chunk != ReadRawData(chunk, buf + nread, sub))
+			break;
+		nread += chunk;
+		m_blockFrameBytesLeft -= chunk;
+	}
+	return nread;
+}
+
+/**
+	@brief Finishes a binary block, discarding the rest of the VICP message so the next ReadReply() starts on a
+	frame boundary
+ */
+void VICPSocketTransport::EndBinaryBlock(bool readTerminator)
+{
+	SCPITransport::EndBinaryBlock(readTerminator);
+
+	vector<unsigned char> discard;
+	while(true)
+	{
+		if(m_blockFrameBytesLeft)
 		{
-			progress((float)pos / (float)len);
+			discard.resize(m_blockFrameBytesLeft);
+			ReadRawData(m_blockFrameBytesLeft, discard.data());
+			m_blockFrameBytesLeft = 0;
 		}
+		if(m_blockFrameEOI)
+			break;
+		if(!ReadBlockFrameHeader())
+			break;
 	}
-
-	LogTrace("Got %zu bytes\n", len);
-	return len;
+	m_blockFrameEOI = false;
 }
 
 void VICPSocketTransport::FlushRXBuffer(void)
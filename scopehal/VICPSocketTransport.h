@@ -71,6 +71,8 @@ public:
 
 	virtual void FlushRXBuffer() override;
 
+	virtual void EndBinaryBlock(bool readTerminator = true) override;
+
 	///@brief VICP header opcode values
 	enum HEADER_OPS
 	{
@@ -101,6 +103,15 @@ public:
 protected:
 	uint8_t GetNextSequenceNumber();
 
+	virtual size_t ReadBlockPayload(size_t len, unsigned char* buf, std::function<void(float)> progress) override;
+	bool ReadBlockFrameHeader();
+
+	///@brief Payload bytes left in the VICP frame currently being read by ReadBlockPayload()
+	size_t m_blockFrameBytesLeft;
+
+	///@brief True if the VICP frame currently being read by ReadBlockPayload() has EOI set
+	bool m_blockFrameEOI;
+
 	///@brief Next sequence number
 	uint8_t m_nextSequence;
 
@@ -58,6 +58,10 @@ VulkanFFTPlan::VulkanFFTPlan(
 	size_t numBatches,
 	VulkanFFTDataType timeDomainType)
 	: m_size(npoints)
+	, m_nouts(nouts)
+	, m_direction(dir)
+	, m_numBatches(numBatches)
+	, m_timeDomainType(timeDomainType)
 	, m_fence(*g_vkComputeDevice, vk::FenceCreateInfo())
 {
 	memset(&m_app, 0, sizeof(m_app));
@@ -144,6 +144,22 @@ public:
 	size_t size() const
 	{ return m_size; }
 
+	///@brief Return the number of frequency domain points in each FFT
+	size_t GetNumOutputs() const
+	{ return m_nouts; }
+
+	///@brief Return the direction of the FFT
+	VulkanFFTPlanDirection GetDirection() const
+	{ return m_direction; }
+
+	///@brief Return the number of batched FFTs performed by each call
+	size_t GetNumBatches() const
+	{ return m_numBatches; }
+
+	///@brief Return the data type of the time domain signal
+	VulkanFFTDataType GetTimeDomainType() const
+	{ return m_timeDomainType; }
+
 protected:
 
 	///@brief VkFFT application handle
@@ -155,6 +171,18 @@ protected:
 	///@brief Number of points in the FFT
 	size_t m_size;
 
+	///@brief Number of frequency domain points in each FFT
+	size_t m_nouts;
+
+	///@brief Direction of the FFT
+	VulkanFFTPlanDirection m_direction;
+
+	///@brief Number of batched FFTs
+	size_t m_numBatches;
+
+	///@brief Data type of the time domain signal
+	VulkanFFTDataType m_timeDomainType;
+
 	//this is ugly but apparently we can't take a pointer to the underlying vk:: c++ wrapper objects?
 	///@brief Physical device the FFT is runnning on
 	VkPhysicalDevice m_physicalDevice;
@@ -0,0 +1,156 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of VulkanFFTPlanCache
+
+	@ingroup core
+ */
+#include "scopehal.h"
+#include "VulkanFFTPlanCache.h"
+
+using namespace std;
+
+unique_ptr<VulkanFFTPlanCache> g_fftPlanCache;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// VulkanFFTPlanReturner
+
+void VulkanFFTPlanReturner::operator()(VulkanFFTPlan* plan) const
+{
+	//Cache may already be gone during shutdown
+	if(g_fftPlanCache)
+		g_fftPlanCache->Release(plan);
+	else
+		delete plan;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates an empty plan cache
+
+	@param maxIdlePerKey	Maximum number of idle plans to keep for any one FFT configuration
+ */
+VulkanFFTPlanCache::VulkanFFTPlanCache(size_t maxIdlePerKey)
+	: m_maxIdlePerKey(maxIdlePerKey)
+	, m_plansCreated(0)
+	, m_plansReused(0)
+{
+}
+
+VulkanFFTPlanCache::~VulkanFFTPlanCache()
+{
+	Clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Plan management
+
+/**
+	@brief Borrows a plan for the given FFT configuration, creating one if there are no idle plans
+
+	@param npoints			Number of points in the FFT
+	@param nouts			Number of output samples
+	@param dir				Direction (forward or reverse)
+	@param numBatches		Number of batched FFTs to perform
+	@param timeDomainType	Data type of the time-domain signal (real or complex)
+ */
+VulkanFFTPlanHandle VulkanFFTPlanCache::Acquire(
+	size_t npoints,
+	size_t nouts,
+	VulkanFFTPlan::VulkanFFTPlanDirection dir,
+	size_t numBatches,
+	VulkanFFTPlan::VulkanFFTDataType timeDomainType)
+{
+	PlanKey key(npoints, nouts, dir, numBatches, timeDomainType);
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		auto it = m_idlePlans.find(key);
+		if( (it != m_idlePlans.end()) && !it->second.empty() )
+		{
+			auto plan = it->second.back();
+			it->second.pop_back();
+			m_plansReused ++;
+			return VulkanFFTPlanHandle(plan);
+		}
+		m_plansCreated ++;
+	}
+
+	//Create outside the lock since it's slow
+	return VulkanFFTPlanHandle(new VulkanFFTPlan(npoints, nouts, dir, numBatches, timeDomainType));
+}
+
+/**
+	@brief Returns a plan to the idle pool
+
+	Normally called by VulkanFFTPlanHandle's deleter, not directly.
+ */
+void VulkanFFTPlanCache::Release(VulkanFFTPlan* plan)
+{
+	if(!plan)
+		return;
+
+	PlanKey key(
+		plan->size(),
+		plan->GetNumOutputs(),
+		plan->GetDirection(),
+		plan->GetNumBatches(),
+		plan->GetTimeDomainType());
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		auto& idle = m_idlePlans[key];
+		if(idle.size() < m_maxIdlePerKey)
+		{
+			idle.push_back(plan);
+			return;
+		}
+	}
+
+	delete plan;
+}
+
+/**
+	@brief Destroys all idle plans
+ */
+void VulkanFFTPlanCache::Clear()
+{
+	lock_guard<mutex> lock(m_mutex);
+	for(auto& it : m_idlePlans)
+	{
+		for(auto plan : it.second)
+			delete plan;
+	}
+	m_idlePlans.clear();
+}
@@ -0,0 +1,124 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of VulkanFFTPlanCache
+	@ingroup core
+ */
+#ifndef VulkanFFTPlanCache_h
+#define VulkanFFTPlanCache_h
+
+#include <mutex>
+#include <tuple>
+#include "VulkanFFTPlan.h"
+
+/**
+	@brief Deleter for VulkanFFTPlanHandle which returns the plan to the shared cache rather than destroying it
+	@ingroup core
+ */
+struct VulkanFFTPlanReturner
+{
+	void operator()(VulkanFFTPlan* plan) const;
+};
+
+/**
+	@brief Exclusive handle to a VulkanFFTPlan borrowed from g_fftPlanCache
+
+	Resetting or destroying the handle returns the plan to the cache.
+	@ingroup core
+ */
+typedef std::unique_ptr<VulkanFFTPlan, VulkanFFTPlanReturner> VulkanFFTPlanHandle;
+
+/**
+	@brief Shared pool of idle vkFFT plans, keyed by size, direction, batch count, and data type
+
+	Creating a vkFFT plan is expensive (shader generation and pipeline creation), and every FFT-based filter used to
+	own one for each size it had ever seen. Plans are now borrowed from this cache and returned when the filter is
+	done with them, so filters of the same FFT size reuse each other's plans. Filter graphs with many channels of the
+	same length need no more plans than the number of FFTs in flight at once.
+
+	A plan records descriptor set updates into the command buffer at each Append call, so a plan is only ever lent
+	to one user at a time.
+	@ingroup core
+ */
+class VulkanFFTPlanCache
+{
+public:
+	VulkanFFTPlanCache(size_t maxIdlePerKey = 8);
+	~VulkanFFTPlanCache();
+
+	//non-copyable
+	VulkanFFTPlanCache(const VulkanFFTPlanCache&) = delete;
+	VulkanFFTPlanCache& operator=(const VulkanFFTPlanCache&) = delete;
+
+	VulkanFFTPlanHandle Acquire(
+		size_t npoints,
+		size_t nouts,
+		VulkanFFTPlan::VulkanFFTPlanDirection dir,
+		size_t numBatches = 1,
+		VulkanFFTPlan::VulkanFFTDataType timeDomainType = VulkanFFTPlan::TYPE_REAL);
+
+	void Release(VulkanFFTPlan* plan);
+
+	void Clear();
+
+	///@brief Number of plans created since startup
+	size_t GetNumPlansCreated()
+	{ return m_plansCreated; }
+
+	///@brief Number of Acquire() calls satisfied by an idle plan
+	size_t GetNumPlansReused()
+	{ return m_plansReused; }
+
+protected:
+
+	///@brief Key identifying interchangeable plans: (npoints, nouts, direction, batches, time domain type)
+	typedef std::tuple<size_t, size_t, int, size_t, int> PlanKey;
+
+	///@brief Mutex to interlock access to m_idlePlans
+	std::mutex m_mutex;
+
+	///@brief Plans not currently lent out
+	std::map<PlanKey, std::vector<VulkanFFTPlan*> > m_idlePlans;
+
+	///@brief Maximum number of idle plans kept for any one key
+	size_t m_maxIdlePerKey;
+
+	///@brief Number of plans created since startup
+	size_t m_plansCreated;
+
+	///@brief Number of Acquire() calls satisfied by an idle plan
+	size_t m_plansReused;
+};
+
+extern std::unique_ptr<VulkanFFTPlanCache> g_fftPlanCache;
+
+#endif
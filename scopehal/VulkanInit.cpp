@@ -36,6 +36,10 @@
 #include "scopehal.h"
 #include <glslang_c_interface.h>
 #include "PipelineCacheManager.h"
+#include "PipelineWarmupQueue.h"
+#include "ShaderBundle.h"
+#include "VulkanFFTPlanCache.h"
+#include "EyeStatistics.h"
 #include "QueueManager.h"
 #include <GLFW/glfw3.h>
 
@@ -97,6 +101,31 @@ unique_ptr<vk::raii::CommandBuffer> g_vkTransferCommandBuffer;
  */
 shared_ptr<QueueHandle> g_vkTransferQueue;
 
+/**
+	@brief Command pool for AcceleratorBuffer host/device copies
+	@ingroup vksupport
+
+	Interlocked by g_vkDmaMutex.
+ */
+unique_ptr<vk::raii::CommandPool> g_vkDmaCommandPool;
+
+/**
+	@brief Command buffer for AcceleratorBuffer host/device copies
+	@ingroup vksupport
+
+	Interlocked by g_vkDmaMutex.
+ */
+unique_ptr<vk::raii::CommandBuffer> g_vkDmaCommandBuffer;
+
+/**
+	@brief Queue for AcceleratorBuffer host/device copies
+	@ingroup vksupport
+
+	This is a transfer-only queue if the device has one, so blocking uploads and readbacks run on the DMA engine
+	instead of waiting behind compute work queued by filters (or holding up the next filter's shaders).
+ */
+shared_ptr<QueueHandle> g_vkDmaQueue;
+
 /**
 	@brief Allocates QueueHandle objects
 	@ingroup vksupport
@@ -111,6 +140,12 @@ std::unique_ptr<QueueManager> g_vkQueueManager;
  */
 mutex g_vkTransferMutex;
 
+/**
+	@brief Mutex for interlocking access to g_vkDmaCommandBuffer and g_vkDmaCommandPool
+	@ingroup vksupport
+ */
+mutex g_vkDmaMutex;
+
 /**
 	@brief Vulkan memory type for CPU-based memory that is also GPU-readable
 	@ingroup vksupport
@@ -153,7 +188,8 @@ uint32_t g_vkPinnedMemoryHeap = 0;
  */
 uint32_t g_vkLocalMemoryHeap = 0;
 
-bool IsDevicePreferred(const vk::PhysicalDeviceProperties& a, const vk::PhysicalDeviceProperties& b);
+bool IsDevicePreferred(const vk::raii::PhysicalDevice& a, const vk::raii::PhysicalDevice& b);
+static uint64_t GetDeviceLocalMemorySize(const vk::raii::PhysicalDevice& device);
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Feature flags indicating that we have support for specific data types / features on the GPU
@@ -212,6 +248,12 @@ bool g_hasMemoryBudget = false;
  */
 bool g_hasPushDescriptor = false;
 
+/**
+	@brief Indicates whether timeline semaphores are available (core in Vulkan 1.2)
+	@ingroup vksupport
+ */
+bool g_hasTimelineSemaphore = false;
+
 /**
 	@brief Indicates whether the Vulkan device is unified memory
 	@ingroup vksupport
@@ -231,6 +273,12 @@ bool g_vulkanDeviceHasUnifiedMemory = false;
  */
 size_t g_maxComputeGroupCount[3] = {0};
 
+/**
+	@brief Required alignment, in bytes, of the offset when binding part of a buffer as a storage buffer descriptor
+	@ingroup vksupport
+ */
+size_t g_vkStorageBufferOffsetAlignment = 0;
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Feature flags indicating specific drivers, for bug workarounds
 
@@ -403,9 +451,8 @@ bool VulkanInit(bool skipGLFW)
 				auto memProperties = device.getMemoryProperties();
 				auto limits = properties.limits;
 
-				//See what device to use
-				//TODO: preference to override this
-				if(IsDevicePreferred(devices[bestDevice].getProperties(), devices[i].getProperties()))
+				//See what device to use (SCOPEHAL_VULKAN_DEVICE_OVERRIDE can override this, see below)
+				if(IsDevicePreferred(devices[bestDevice], devices[i]))
 					bestDevice = i;
 
 				//TODO: check that the extensions we need are supported
@@ -600,6 +647,14 @@ bool VulkanInit(bool skipGLFW)
 
 			LogDebug("Selected device %zu\n", bestDevice);
 
+			//All filters share a single compute device, so the only way to spread work across several GPUs is to run
+			//one instance per GPU. Make that discoverable when we're not using all of the hardware.
+			if(devices.size() > 1)
+			{
+				LogDebug("%zu Vulkan devices present, set SCOPEHAL_VULKAN_DEVICE_OVERRIDE to choose which one to use\n",
+					devices.size());
+			}
+
 			//Check if user wanted to override it
 			auto deviceOverride = getenv("SCOPEHAL_VULKAN_DEVICE_OVERRIDE");
 			if(deviceOverride)
@@ -617,6 +672,7 @@ bool VulkanInit(bool skipGLFW)
 			{
 				auto& device = devices[bestDevice];
 				g_vkComputePhysicalDevice = &devices[bestDevice];
+				g_vkStorageBufferOffsetAlignment = device.getProperties().limits.minStorageBufferOffsetAlignment;
 
 				LogIndenter li3;
 
@@ -813,6 +869,14 @@ bool VulkanInit(bool skipGLFW)
 							LogDebug("Enabling 64-bit atomic int support for shared memory\n");
 						}
 
+						//Timeline semaphores let the filter graph chain GPU work without waiting on fences
+						if(vulkan12Features.timelineSemaphore)
+						{
+							featuresVulkan12.timelineSemaphore = true;
+							g_hasTimelineSemaphore = true;
+							LogDebug("Enabling timeline semaphore support\n");
+						}
+
 						//Enable 8 bit SSBOs
 						if(storageFeatures8.uniformAndStorageBuffer8BitAccess)
 						{
@@ -1000,10 +1064,78 @@ bool VulkanInit(bool skipGLFW)
 					}
 				}
 
+				//Integrated GPUs and CPU devices share system RAM with the host even when the driver doesn't expose
+				//a single superset type. MoltenVK on Apple silicon has no host cached + coherent type at all, and
+				//AMD APUs report the BIOS carveout as a separate device local heap. Pick one host visible, coherent
+				//type and use it for everything so buffers never have to be copied between two halves: prefer the
+				//largest heap (so we aren't limited to a small carveout), then device local, then host cached.
+				//Coherent memory is always available per the spec, so no explicit flushes are ever needed.
+				if(!g_vulkanDeviceHasUnifiedMemory &&
+					( (devtype == vk::PhysicalDeviceType::eIntegratedGpu) ||
+					  (devtype == vk::PhysicalDeviceType::eCpu) ) )
+				{
+					int best = -1;
+					auto score = [&](uint32_t j)
+					{
+						auto flags = memProperties.memoryTypes[j].propertyFlags;
+						return make_tuple(
+							memProperties.memoryHeaps[memProperties.memoryTypes[j].heapIndex].size,
+							static_cast<bool>(flags & vk::MemoryPropertyFlagBits::eDeviceLocal),
+							static_cast<bool>(flags & vk::MemoryPropertyFlagBits::eHostCached));
+					};
+					for(uint32_t j=0; j<memProperties.memoryTypeCount; j++)
+					{
+						auto flags = memProperties.memoryTypes[j].propertyFlags;
+						if( !(flags & vk::MemoryPropertyFlagBits::eHostVisible) ||
+							!(flags & vk::MemoryPropertyFlagBits::eHostCoherent) )
+						{
+							continue;
+						}
+
+						//Skip anything exotic (protected, lazily allocated, AMD uncached debug types, etc)
+						if(flags & ~(vk::MemoryPropertyFlagBits::eDeviceLocal |
+							vk::MemoryPropertyFlagBits::eHostVisible |
+							vk::MemoryPropertyFlagBits::eHostCoherent |
+							vk::MemoryPropertyFlagBits::eHostCached) )
+						{
+							continue;
+						}
+
+						if( (best < 0) || (score(j) > score(best)) )
+							best = j;
+					}
+
+					if(best >= 0)
+					{
+						g_vkPinnedMemoryType = best;
+						g_vkLocalMemoryType = best;
+						g_vkPinnedMemoryHeap = memProperties.memoryTypes[best].heapIndex;
+						g_vkLocalMemoryHeap = g_vkPinnedMemoryHeap;
+						g_vulkanDeviceHasUnifiedMemory = true;
+					}
+				}
+
 				LogDebug("Using heap %u, type %u for pinned host memory\n", g_vkPinnedMemoryHeap, g_vkPinnedMemoryType);
 				LogDebug("Using heap %u, type %u for card-local memory\n", g_vkLocalMemoryHeap, g_vkLocalMemoryType);
 				if(g_vulkanDeviceHasUnifiedMemory) { LogDebug("Unified memory GPU optimizations are enabled\n"); }
 
+				//Make the memory arenas. With unified memory both buffer types come from the same memory type,
+				//so share one arena rather than splitting it in two
+				if(g_vulkanDeviceHasUnifiedMemory)
+				{
+					g_vkPinnedMemoryArena = make_shared<DeviceMemoryArena>(
+						g_vkComputeDevice, g_vkPinnedMemoryType, true, "Unified");
+					g_vkLocalMemoryArena = g_vkPinnedMemoryArena;
+				}
+				else
+				{
+					g_vkPinnedMemoryArena = make_shared<DeviceMemoryArena>(
+						g_vkComputeDevice, g_vkPinnedMemoryType, true, "Pinned");
+					g_vkLocalMemoryArena = make_shared<DeviceMemoryArena>(
+						g_vkComputeDevice, g_vkLocalMemoryType, false, "GPU only");
+				}
+				g_gpuMemoryBudget = make_unique<GpuMemoryBudget>();
+
 				//Make the queue manager
 				g_vkQueueManager = make_unique<QueueManager>(g_vkComputePhysicalDevice, g_vkComputeDevice);
 
@@ -1020,6 +1152,16 @@ bool VulkanInit(bool skipGLFW)
 				vk::CommandBufferAllocateInfo bufinfo(**g_vkTransferCommandPool, vk::CommandBufferLevel::ePrimary, 1);
 				g_vkTransferCommandBuffer = make_unique<vk::raii::CommandBuffer>(
 					std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+				//Same again for AcceleratorBuffer copies, on the DMA engine if there is one
+				g_vkDmaQueue = g_vkQueueManager->GetDmaQueue("g_vkDmaQueue");
+				vk::CommandPoolCreateInfo dmaPoolInfo(
+					vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+					g_vkDmaQueue->m_family );
+				g_vkDmaCommandPool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, dmaPoolInfo);
+				vk::CommandBufferAllocateInfo dmaBufInfo(**g_vkDmaCommandPool, vk::CommandBufferLevel::ePrimary, 1);
+				g_vkDmaCommandBuffer = make_unique<vk::raii::CommandBuffer>(
+					std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, dmaBufInfo).front()));
 			}
 
 			//Destroy other physical devices that we're not using
@@ -1059,6 +1201,24 @@ bool VulkanInit(bool skipGLFW)
 	//Initialize our pipeline cache manager and load existing cache data
 	g_pipelineCacheMgr = make_unique<PipelineCacheManager>();
 
+	//Create the modules for every shader linked into the libraries now, rather than during the first refresh of each
+	//filter. Set SCOPEHAL_LAZY_SHADER_MODULES to skip this if startup time matters more.
+	if(getenv("SCOPEHAL_LAZY_SHADER_MODULES") == nullptr)
+	{
+		double start = GetTime();
+		size_t nmodules = ShaderBundle::CreateAllModules();
+		LogDebug("Created %zu shader modules in %.2f ms\n", nmodules, (GetTime() - start) * 1000);
+	}
+
+	//Start creating pipelines in the background as soon as filters instantiate them, so loading a session doesn't
+	//stall the first trigger on shader compilation. Leave some cores free for everything else going on at startup.
+	size_t warmupThreads = max(1u, thread::hardware_concurrency() / 2);
+	LogDebug("Using %zu threads for pipeline warmup\n", warmupThreads);
+	g_pipelineWarmupQueue = make_unique<PipelineWarmupQueue>(warmupThreads);
+
+	//Shared pool of FFT plans
+	g_fftPlanCache = make_unique<VulkanFFTPlanCache>();
+
 	//Print out vkFFT version for debugging
 	int vkfftver = VkFFTGetVersion();
 	int vkfft_major = vkfftver / 10000;
@@ -1080,6 +1240,12 @@ bool VulkanInit(bool skipGLFW)
 				reinterpret_cast<uint64_t>(static_cast<VkCommandBuffer>(**g_vkTransferCommandBuffer)),
 				"g_vkTransferCommandBuffer"));
 
+		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
+			vk::DebugUtilsObjectNameInfoEXT(
+				vk::ObjectType::eCommandBuffer,
+				reinterpret_cast<uint64_t>(static_cast<VkCommandBuffer>(**g_vkDmaCommandBuffer)),
+				"g_vkDmaCommandBuffer"));
+
 		//For some reason this doesn't work?
 		/*g_vkComputeDevice->setDebugUtilsObjectNameEXT(
 			vk::DebugUtilsObjectNameInfoEXT(
@@ -1091,36 +1257,83 @@ bool VulkanInit(bool skipGLFW)
 	return true;
 }
 
+/**
+	@brief Runs VulkanInit() on a background thread so it can overlap with driver/filter registration and plugin loading
+	@ingroup vksupport
+
+	None of TransportStaticInit(), DriverStaticInit(), InitializePlugins() or ScopeProtocolStaticInit() touch the GPU,
+	so a headless tool can kick this off first and only wait on the result before creating any waveforms or filters.
+
+	GLFW must be initialized from the main thread on some platforms, so interactive applications should keep calling
+	VulkanInit() directly; this is only intended for use with skipGLFW set.
+
+	@param skipGLFW Do not initialize GLFW
+	@return			Future which becomes ready with the return value of VulkanInit()
+ */
+shared_future<bool> VulkanInitAsync(bool skipGLFW)
+{
+	return async(launch::async, [skipGLFW]() { return VulkanInit(skipGLFW); }).share();
+}
+
 /**
 	@brief Checks if a given Vulkan device is "better" than another
 	@ingroup vksupport
 
+	Discrete GPUs beat integrated GPUs, which beat anything else. Between two devices of the same type, the one with
+	more device-local memory wins, so a system with several discrete cards picks the biggest one rather than whichever
+	happened to enumerate last.
+
 	@param a	One of two devices being considered
 	@param b	The second device being considered
 	@return		True if we should use device B over A
  */
-bool IsDevicePreferred(const vk::PhysicalDeviceProperties& a, const vk::PhysicalDeviceProperties& b)
+bool IsDevicePreferred(const vk::raii::PhysicalDevice& a, const vk::raii::PhysicalDevice& b)
 {
+	auto atype = a.getProperties().deviceType;
+	auto btype = b.getProperties().deviceType;
+
+	//Same type of device? Pick the one with more VRAM
+	if(atype == btype)
+		return GetDeviceLocalMemorySize(b) > GetDeviceLocalMemorySize(a);
+
 	//If B is a discrete GPU, always prefer it
-	//TODO: prefer one of multiple
-	if(b.deviceType == vk::PhysicalDeviceType::eDiscreteGpu)
+	if(btype == vk::PhysicalDeviceType::eDiscreteGpu)
 		return true;
 
 	//Integrated GPUs beat anything but a discrete GPU
-	if( (b.deviceType == vk::PhysicalDeviceType::eIntegratedGpu) &&
-		(a.deviceType != vk::PhysicalDeviceType::eDiscreteGpu) )
+	if( (btype == vk::PhysicalDeviceType::eIntegratedGpu) &&
+		(atype != vk::PhysicalDeviceType::eDiscreteGpu) )
 	{
 		return true;
 	}
 
 	//Anything is better than a CPU
-	if(a.deviceType == vk::PhysicalDeviceType::eCpu)
+	if(atype == vk::PhysicalDeviceType::eCpu)
 		return false;
 
 	//By default, assume A is good enough
 	return false;
 }
 
+/**
+	@brief Gets the total size of all device-local memory heaps on a Vulkan device
+	@ingroup vksupport
+
+	@param device	The device to query
+	@return			Device-local memory, in bytes
+ */
+static uint64_t GetDeviceLocalMemorySize(const vk::raii::PhysicalDevice& device)
+{
+	uint64_t total = 0;
+	auto memProperties = device.getMemoryProperties();
+	for(size_t i=0; i<memProperties.memoryHeapCount; i++)
+	{
+		if(memProperties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal)
+			total += memProperties.memoryHeaps[i].size;
+	}
+	return total;
+}
+
 /**
 	@brief Free all global Vulkan resources in the correct order
 	@ingroup vksupport
@@ -1129,7 +1342,11 @@ void VulkanCleanup()
 {
 	glfwTerminate();
 
+	g_fftPlanCache = nullptr;
+	g_pipelineWarmupQueue = nullptr;
 	g_pipelineCacheMgr = nullptr;
+	ShaderBundle::DestroyModules();
+	ReadbackFuture::DestroyCommandBuffers();
 
 	glslang_finalize_process();
 
@@ -1137,8 +1354,25 @@ void VulkanCleanup()
 	g_vkTransferCommandBuffer = nullptr;
 	g_vkTransferCommandPool = nullptr;
 
+	g_vkDmaQueue = nullptr;
+	g_vkDmaCommandBuffer = nullptr;
+	g_vkDmaCommandPool = nullptr;
+
+	DigitalEdgeList::DestroyExtractor();
+	LevelCrossingList::DestroyEngine();
+	AnalogStatistics::DestroyEngine();
+	EyeStatistics::DestroyEngine();
+	MinMaxPyramid::DestroyEngine();
+	EdgeSampler::DestroyEngine();
+
+	StagingBufferPool::Clear();
+
 	g_vkQueueManager = nullptr;
 
+	g_gpuMemoryBudget = nullptr;
+	g_vkLocalMemoryArena = nullptr;
+	g_vkPinnedMemoryArena = nullptr;
+
 	g_vkComputeDevice = nullptr;
 	g_vkInstance = nullptr;
 }
@@ -40,6 +40,8 @@
 
 using namespace std;
 
+atomic<uint64_t> WaveformBase::m_nextRevisionBase(0);
+
 template<class T>
 size_t BinarySearchForGequal(T* buf, size_t len, T value)
 {
@@ -106,7 +108,7 @@ size_t GetIndexNearestAtOrBeforeTimestamp(WaveformBase* wfm, int64_t time_fs, bo
 
 	int64_t result;
 
-	if(auto swfm = dynamic_cast<SparseWaveformBase*>(wfm))
+	if(auto swfm = WaveformCast<SparseWaveformBase>(wfm))
 	{
 		if(swfm->m_offsets[0] >= target)
 		{
@@ -158,8 +160,8 @@ size_t GetIndexNearestAtOrBeforeTimestamp(WaveformBase* wfm, int64_t time_fs, bo
 
 optional<float> GetValueAtTime(WaveformBase* waveform, int64_t time_fs, bool zero_hold_behavior)
 {
-	auto swaveform = dynamic_cast<SparseAnalogWaveform*>(waveform);
-	auto uwaveform = dynamic_cast<UniformAnalogWaveform*>(waveform);
+	auto swaveform = WaveformCast<SparseAnalogWaveform>(waveform);
+	auto uwaveform = WaveformCast<UniformAnalogWaveform>(waveform);
 
 	if(!swaveform && !uwaveform)
 		return {};
@@ -199,8 +201,8 @@ optional<float> GetValueAtTime(WaveformBase* waveform, int64_t time_fs, bool zer
 
 optional<bool> GetDigitalValueAtTime(WaveformBase* waveform, int64_t time_fs)
 {
-	auto swaveform = dynamic_cast<SparseDigitalWaveform*>(waveform);
-	auto uwaveform = dynamic_cast<UniformDigitalWaveform*>(waveform);
+	auto swaveform = WaveformCast<SparseDigitalWaveform>(waveform);
+	auto uwaveform = WaveformCast<UniformDigitalWaveform>(waveform);
 
 	if(!swaveform && !uwaveform)
 		return {};
@@ -230,7 +232,7 @@ optional<bool> GetDigitalValueAtTime(WaveformBase* waveform, int64_t time_fs)
 optional<string> GetProtocolValueAtTime(WaveformBase* waveform, int64_t time_fs)
 {
 	//All protocol waveforms are sparse
-	auto swaveform = dynamic_cast<SparseWaveformBase*>(waveform);
+	auto swaveform = WaveformCast<SparseWaveformBase>(waveform);
 	if(!swaveform)
 		return {};
 	if(waveform->empty())
@@ -326,3 +328,101 @@ void WaveformBase::CacheColors()
 
 	m_protocolColors.MarkModifiedFromCpu();
 }
+
+/**
+	@brief Looks up (and formats, if needed) the text of a protocol sample, and marks it most recently used
+
+	The cache is flushed whenever the waveform revision changes.
+
+	@param i			Sample index
+	@param capacity		Number of entries to keep when evicting
+ */
+void WaveformBase::TouchCachedText(size_t i, size_t capacity)
+{
+	if(m_cachedTextRevision != m_revision)
+	{
+		m_textCache.clear();
+		m_textCacheIndex.clear();
+		m_cachedTextRevision = m_revision;
+	}
+
+	//Hit? Move to the front
+	auto it = m_textCacheIndex.find(i);
+	if(it != m_textCacheIndex.end())
+	{
+		m_textCache.splice(m_textCache.begin(), m_textCache, it->second);
+		return;
+	}
+
+	//Miss. Evict the least recently used entries, then format it
+	while(m_textCache.size() >= capacity)
+	{
+		m_textCacheIndex.erase(m_textCache.back().first);
+		m_textCache.pop_back();
+	}
+	m_textCache.emplace_front(i, GetText(i));
+	m_textCacheIndex[i] = m_textCache.begin();
+}
+
+/**
+	@brief Returns the text representation of a protocol sample, formatting it only if not already cached
+
+	Intended for rendering, where the same visible samples are drawn every frame. The returned reference is valid
+	until the next call to any of the GetTextCached() / GetTextRangeCached() methods.
+
+	@param i	Sample index
+ */
+const string& WaveformBase::GetTextCached(size_t i)
+{
+	TouchCachedText(i, TEXT_CACHE_SIZE);
+	return m_textCache.front().second;
+}
+
+/**
+	@brief Copies the text representation of a protocol sample into a caller-provided buffer
+
+	The output is always null terminated, and truncated if it does not fit.
+
+	@param i		Sample index
+	@param buf		Output buffer
+	@param buflen	Size of the output buffer, in bytes
+
+	@return Length of the full (untruncated) string, not including the null terminator
+ */
+size_t WaveformBase::GetTextCached(size_t i, char* buf, size_t buflen)
+{
+	auto& str = GetTextCached(i);
+	if(buflen > 0)
+	{
+		size_t n = min(str.length(), buflen - 1);
+		memcpy(buf, str.c_str(), n);
+		buf[n] = '\0';
+	}
+	return str.length();
+}
+
+/**
+	@brief Returns the text of a range of protocol samples (e.g. everything currently visible)
+
+	The cache is allowed to grow to hold the entire range, so all of the returned pointers stay valid until the next
+	call to any of the GetTextCached() / GetTextRangeCached() methods.
+
+	@param first	First sample index
+	@param last		Last sample index (inclusive)
+	@param text		Output array with one entry per sample
+ */
+void WaveformBase::GetTextRangeCached(size_t first, size_t last, vector<const string*>& text)
+{
+	text.clear();
+	if(last < first)
+		return;
+
+	size_t count = last - first + 1;
+	size_t capacity = max(count, TEXT_CACHE_SIZE);
+	text.reserve(count);
+	for(size_t i=first; i<=last; i++)
+	{
+		TouchCachedText(i, capacity);
+		text.push_back(&m_textCache.front().second);
+	}
+}
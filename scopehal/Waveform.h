@@ -38,11 +38,23 @@
 #define Waveform_h
 
 #include <vector>
+#include <list>
+#include <unordered_map>
 #include <optional>
+#include <atomic>
 #include <AlignedAllocator.h>
 
 #include "StandardColors.h"
 #include "AcceleratorBuffer.h"
+#include "CompressedTimeline.h"
+#include "RawAnalogSamples.h"
+
+class DigitalEdgeList;
+class LevelCrossingList;
+class AnalogStatistics;
+class MinMaxPyramid;
+
+uint64_t ContentHash64(const void* data, size_t len, uint64_t seed = 0);
 
 /**
 	@brief Base class for all Waveform specializations
@@ -68,8 +80,14 @@ public:
 		, m_startFemtoseconds(0)
 		, m_triggerPhase(0)
 		, m_flags(0)
-		, m_revision(0)
+		, m_revision(m_nextRevisionBase.fetch_add(1) << 32)
 		, m_cachedColorRevision(0)
+		, m_cachedTextRevision(0)
+		, m_cachedEdgeListRevision(0)
+		, m_cachedCrossingsRevision(0)
+		, m_cachedStatisticsRevision(0)
+		, m_cachedPyramidRevision(0)
+		, m_typeTag(TYPE_OTHER)
 	{
 	}
 
@@ -83,6 +101,12 @@ public:
 		, m_triggerPhase(rhs.m_triggerPhase)
 		, m_flags(rhs.m_flags)
 		, m_revision(rhs.m_revision)
+		, m_cachedTextRevision(0)
+		, m_cachedEdgeListRevision(0)
+		, m_cachedCrossingsRevision(0)
+		, m_cachedStatisticsRevision(0)
+		, m_cachedPyramidRevision(0)
+		, m_typeTag(rhs.m_typeTag)
 	{}
 
 	//empty virtual destructor in case any derived classes need one
@@ -135,6 +159,9 @@ public:
 		This is a monotonically increasing counter that indicates waveform data has changed. Filters may choose to
 		cache pre-processed versions of input data (for example, resampled versions of raw input) as long as the
 		pointer and revision number have not changed.
+
+		Each newly constructed waveform starts at a distinct multiple of 2^32, so a waveform which is freed and
+		replaced by a new one at the same address will not be mistaken for an unchanged copy of the old one.
 	 */
 	uint64_t m_revision;
 
@@ -142,9 +169,50 @@ public:
 	enum WaveformFlags_t
 	{
 		///@brief Waveform amplitude exceeded ADC range, values were clipped
-		WAVEFORM_CLIPPING = 1
+		WAVEFORM_CLIPPING = 1,
+
+		///@brief Waveform is a snapshot of an acquisition still in progress (e.g. part of a VNA sweep)
+		WAVEFORM_PARTIAL = 2
+	};
+
+	/**
+		@brief Values for the type tag returned by GetTypeTag()
+
+		The low two bits give the sample layout and the next two the sample type. Waveforms whose sample type has
+		no tag (protocol decodes, eyes, etc) only carry the layout bits, if any.
+	 */
+	enum TypeTag_t : uint8_t
+	{
+		TYPE_OTHER					= 0x00,
+
+		//Sample layout
+		TYPE_UNIFORM				= 0x01,
+		TYPE_SPARSE					= 0x02,
+		TYPE_LAYOUT_MASK			= 0x03,
+
+		//Sample type
+		TYPE_SAMPLE_ANALOG			= 0x04,
+		TYPE_SAMPLE_DIGITAL			= 0x08,
+		TYPE_SAMPLE_DIGITAL_BUS		= 0x0c,
+		TYPE_SAMPLE_MASK			= 0x0c,
+
+		TYPE_UNIFORM_ANALOG			= TYPE_UNIFORM | TYPE_SAMPLE_ANALOG,
+		TYPE_SPARSE_ANALOG			= TYPE_SPARSE | TYPE_SAMPLE_ANALOG,
+		TYPE_UNIFORM_DIGITAL		= TYPE_UNIFORM | TYPE_SAMPLE_DIGITAL,
+		TYPE_SPARSE_DIGITAL			= TYPE_SPARSE | TYPE_SAMPLE_DIGITAL,
+		TYPE_UNIFORM_DIGITAL_BUS	= TYPE_UNIFORM | TYPE_SAMPLE_DIGITAL_BUS,
+		TYPE_SPARSE_DIGITAL_BUS		= TYPE_SPARSE | TYPE_SAMPLE_DIGITAL_BUS
 	};
 
+	/**
+		@brief Gets the type tag of this waveform (a TypeTag_t value)
+
+		This is set by the constructors and is much cheaper to check than RTTI. Use WaveformCast() or
+		VisitWaveform() rather than testing it directly.
+	 */
+	uint8_t GetTypeTag() const
+	{ return m_typeTag; }
+
 	///@brief Remove all samples from this waveform
 	virtual void clear() =0;
 
@@ -166,6 +234,14 @@ public:
 	///@brief Returns the number of samples in this waveform
 	virtual size_t size() const  =0;
 
+	/**
+		@brief Returns the number of samples this waveform can hold without reallocating
+
+		The default implementation returns size().
+	 */
+	virtual size_t capacity() const
+	{ return size(); }
+
 	///@brief Returns true if this waveform contains no samples, false otherwise
 	virtual bool empty()
 	{ return size() == 0; }
@@ -182,6 +258,10 @@ public:
 		return "(unimplemented)";
 	}
 
+	const std::string& GetTextCached(size_t i);
+	size_t GetTextCached(size_t i, char* buf, size_t buflen);
+	void GetTextRangeCached(size_t first, size_t last, std::vector<const std::string*>& text);
+
 	/**
 		@brief Returns the displayed color (in HTML #rrggbb or #rrggbbaa notation) of a given protocol sample.
 
@@ -211,6 +291,19 @@ public:
 	 */
 	virtual void PrepareForCpuAccess() =0;
 
+	/**
+		@brief Starts bringing the CPU-side copy of the data up to date, without waiting for the copy to complete
+
+		PrepareForCpuAccess() must still be called before the data is used, but it won't block once the returned
+		future is ready (see AcceleratorBuffer::PrepareForCpuAccessAsync()). The default implementation just calls
+		PrepareForCpuAccess() and returns a future which is already ready.
+	 */
+	virtual ReadbackFuture PrepareForCpuAccessAsync()
+	{
+		PrepareForCpuAccess();
+		return ReadbackFuture();
+	}
+
 	/**
 		@brief Indicates that this waveform is going to be used by the CPU in the near future.
 
@@ -253,15 +346,137 @@ public:
 	///@brief Returns true if we have at least one buffer resident on the GPU
 	virtual bool HasGpuBuffer() =0;
 
+	/**
+		@brief Returns true if the sample data is only up to date on the GPU, so reading it on the CPU needs a download
+
+		Used to decide where filters with both CPU and GPU paths run. The default implementation returns false.
+	 */
+	virtual bool IsCurrentOnlyOnGpu()
+	{ return false; }
+
+	/**
+		@brief Returns the NUMA node holding the CPU-side sample data, or -1 if unknown
+
+		Used by the FilterGraphExecutor to run filters on the node their inputs live on. This is a system call on
+		NUMA hosts, so don't call it per sample. The default implementation returns -1.
+	 */
+	virtual int GetCpuNode()
+	{ return -1; }
+
+	/**
+		@brief Returns true if the sample data is currently held as unconverted ADC codes
+
+		See UniformWaveform::SetRawSamples8Bit(). The default implementation returns false.
+	 */
+	virtual bool HasRawSamples() const
+	{ return false; }
+
+	/**
+		@brief Converts unconverted ADC codes to the waveform's normal sample format, if HasRawSamples() is true
+
+		Called implicitly by PrepareForCpuAccess() and PrepareForGpuAccess(). The default implementation does nothing.
+	 */
+	virtual void ExpandRawSamples()
+	{}
+
+	/**
+		@brief Computes a hash of the sample data and the metadata that positions it in time
+
+		The acquisition timestamp is not included, so repeated acquisitions of identical data hash the same. Used by
+		the FilterGraphExecutor to keep the revision of outputs which did not actually change (see
+		FlowGraphNode::IsOutputContentHashed()).
+
+		@param[out] hash	The hash, if one could be computed
+
+		@return True on success, false if the content can't be hashed cheaply (data only on the GPU, sample types
+				which aren't plain bytes, etc). The default implementation always returns false.
+	 */
+	virtual bool GetContentHash([[maybe_unused]] uint64_t& hash)
+	{ return false; }
+
 protected:
 
+	///@brief Hash of the metadata common to all waveform types, used as the seed for hashing the sample data
+	uint64_t GetMetadataHash(size_t len)
+	{
+		int64_t meta[4] = { m_timescale, m_triggerPhase, static_cast<int64_t>(m_flags), static_cast<int64_t>(len) };
+		return ContentHash64(meta, sizeof(meta), m_typeTag);
+	}
+
 	///@brief Cache of packed RGBA32 data with colors for each protocol decode event. Empty for non-protocol waveforms.
 	AcceleratorBuffer<uint32_t> m_protocolColors;
 
 	///@brief Revision we last cached colors of
 	uint64_t m_cachedColorRevision;
+
+	void TouchCachedText(size_t i, size_t capacity);
+
+	///@brief Maximum number of entries kept in the text cache (bulk lookups may temporarily exceed this)
+	static constexpr size_t TEXT_CACHE_SIZE = 16384;
+
+	///@brief Cache of formatted protocol sample text, most recently used first
+	std::list< std::pair<size_t, std::string> > m_textCache;
+
+	///@brief Index into m_textCache by sample index
+	std::unordered_map<size_t, std::list< std::pair<size_t, std::string> >::iterator> m_textCacheIndex;
+
+	///@brief Revision m_textCache was generated from
+	uint64_t m_cachedTextRevision;
+
+	friend class DigitalEdgeList;
+
+	///@brief Edge list extracted from this waveform by DigitalEdgeList::Get(), if any
+	std::shared_ptr<DigitalEdgeList> m_cachedEdgeList;
+
+	///@brief Revision m_cachedEdgeList was extracted from
+	uint64_t m_cachedEdgeListRevision;
+
+	friend class LevelCrossingList;
+
+	///@brief Crossing lists found in this waveform by LevelCrossingList::Get(), most recently searched first
+	std::vector<std::shared_ptr<LevelCrossingList>> m_cachedCrossings;
+
+	///@brief Revision m_cachedCrossings were found from
+	uint64_t m_cachedCrossingsRevision;
+
+	friend class AnalogStatistics;
+
+	///@brief Statistics computed from this waveform by AnalogStatistics::Get(), if any
+	std::shared_ptr<AnalogStatistics> m_cachedStatistics;
+
+	///@brief Revision m_cachedStatistics was computed from
+	uint64_t m_cachedStatisticsRevision;
+
+	friend class MinMaxPyramid;
+
+	///@brief Min/max pyramid built from this waveform by MinMaxPyramid::Get(), if any
+	std::shared_ptr<MinMaxPyramid> m_cachedPyramid;
+
+	///@brief Revision m_cachedPyramid was built from
+	uint64_t m_cachedPyramidRevision;
+
+	///@brief Starting revision for the next waveform to be created, divided by 2^32
+	static std::atomic<uint64_t> m_nextRevisionBase;
+
+protected:
+
+	///@brief Sample layout and type of the most derived waveform class, a TypeTag_t value
+	uint8_t m_typeTag;
 };
 
+/**
+	@brief Type tag bits for a sample type, zero if waveforms of this sample type are not tagged
+	@ingroup datamodel
+ */
+template<class S> struct WaveformSampleTag
+{ static constexpr uint8_t value = WaveformBase::TYPE_OTHER; };
+
+template<> struct WaveformSampleTag<float>
+{ static constexpr uint8_t value = WaveformBase::TYPE_SAMPLE_ANALOG; };
+
+template<> struct WaveformSampleTag<bool>
+{ static constexpr uint8_t value = WaveformBase::TYPE_SAMPLE_DIGITAL; };
+
 template<class S> class SparseWaveform;
 
 /**
@@ -284,6 +499,8 @@ public:
 	 */
 	SparseWaveformBase()
 	{
+		m_typeTag = TYPE_SPARSE;
+
 		//Default timestamps to CPU/GPU mirror
 		m_offsets.SetCpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
 		m_offsets.SetGpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
@@ -325,10 +542,71 @@ public:
 	 */
 	void CopyTimestamps(const SparseWaveformBase* rhs)
 	{
-		m_offsets.CopyFrom(rhs->m_offsets);
-		m_durations.CopyFrom(rhs->m_durations);
+		m_timeline = nullptr;
+		if(rhs->m_timeline)
+		{
+			m_offsets.resize(rhs->m_timeline->size());
+			m_durations.resize(rhs->m_timeline->size());
+			m_offsets.PrepareForCpuAccess();
+			m_durations.PrepareForCpuAccess();
+			for(size_t i=0; i<rhs->m_timeline->size(); i++)
+			{
+				m_offsets[i] = rhs->m_timeline->GetOffset(i);
+				m_durations[i] = rhs->m_timeline->GetDuration(i);
+			}
+			MarkTimestampsModifiedFromCpu();
+		}
+		else
+		{
+			m_offsets.CopyFrom(rhs->m_offsets);
+			m_durations.CopyFrom(rhs->m_durations);
+		}
 	}
 
+	/**
+		@brief Converts the timestamps to the compact CompressedTimeline representation and frees m_offsets and
+		m_durations
+
+		Intended for waveforms which are kept around but rarely touched (history, reference waveforms, large
+		protocol decodes). Random access through GetOffset() / GetDuration() keeps working, and any
+		PrepareForCpuAccess() / PrepareForGpuAccess() call expands the timestamps again, so code indexing
+		m_offsets directly remains correct.
+
+		@return True if the timestamps were compressed, false if they can't be represented compactly
+	 */
+	bool CompressTimestamps()
+	{
+		if(m_timeline)
+			return true;
+
+		auto timeline = std::make_unique<CompressedTimeline>();
+		if(!timeline->Compress(m_offsets, m_durations))
+			return false;
+
+		m_timeline = std::move(timeline);
+		m_offsets.clear();
+		m_offsets.shrink_to_fit();
+		m_durations.clear();
+		m_durations.shrink_to_fit();
+		return true;
+	}
+
+	///@brief Restores full 64-bit m_offsets and m_durations if the timestamps are compressed
+	void ExpandTimestamps()
+	{
+		if(!m_timeline)
+			return;
+		m_timeline->Expand(m_offsets, m_durations);
+		m_timeline = nullptr;
+	}
+
+	///@brief Returns true if the timestamps are currently stored in compressed form
+	bool AreTimestampsCompressed() const
+	{ return m_timeline != nullptr; }
+
+	///@brief Compressed timestamps, if CompressTimestamps() was called (m_offsets and m_durations are then empty)
+	std::unique_ptr<CompressedTimeline> m_timeline;
+
 	void MarkTimestampsModifiedFromCpu()
 	{
 		m_offsets.MarkModifiedFromCpu();
@@ -362,7 +640,7 @@ class UniformWaveformBase : public WaveformBase
 {
 public:
 	UniformWaveformBase()
-	{}
+	{ m_typeTag = TYPE_UNIFORM; }
 
 	/**
 		@brief Creates a uniform waveform as a copy of a sparse one.
@@ -373,7 +651,7 @@ public:
 	 */
 	UniformWaveformBase(const SparseWaveformBase& rhs)
 		: WaveformBase(rhs)
-	{}
+	{ m_typeTag = TYPE_UNIFORM | (m_typeTag & TYPE_SAMPLE_MASK); }
 
 	virtual ~UniformWaveformBase()
 	{}
@@ -397,6 +675,7 @@ public:
 	 */
 	UniformWaveform(const std::string& name = "")
 	{
+		m_typeTag = TYPE_UNIFORM | WaveformSampleTag<S>::value;
 		Rename(name);
 
 		//Default data to CPU/GPU mirror
@@ -423,6 +702,7 @@ public:
 	UniformWaveform(const SparseWaveform<S>& rhs)
 		: UniformWaveformBase(rhs)
 	{
+		m_typeTag = TYPE_UNIFORM | WaveformSampleTag<S>::value;
 		m_samples.SetName(std::string("UniformWaveform<") + typeid(S).name() + ">.m_samples");
 
 		m_samples.CopyFrom(rhs.m_samples);
@@ -431,35 +711,181 @@ public:
 	virtual ~UniformWaveform()
 	{}
 
-	///@brief Sample data
+	///@brief Sample data (empty while HasRawSamples() is true)
 	AcceleratorBuffer<S> m_samples;
 
+	///@brief Unconverted ADC codes, if SetRawSamples8Bit() or SetRawSamples16Bit() was called. Analog only.
+	std::unique_ptr<RawAnalogSamples> m_rawSamples;
+
+	/**
+		@brief Stores signed 8-bit ADC codes in place of the sample data, deferring conversion until it's needed
+
+		Any existing sample data is freed.
+
+		@param codes	Raw ADC codes (CPU readable). Copied, so the buffer may be reused as soon as this returns.
+		@param len		Number of samples
+		@param gain		Volts per code
+		@param offset	Offset added after scaling
+	 */
+	void SetRawSamples8Bit(const int8_t* codes, size_t len, float gain, float offset)
+	{
+		if(!m_rawSamples)
+			m_rawSamples = std::make_unique<RawAnalogSamples>();
+		m_rawSamples->Set8Bit(codes, len, gain, offset);
+		m_samples.clear();
+		m_samples.shrink_to_fit();
+	}
+
+	/**
+		@brief Stores signed 16-bit ADC codes in place of the sample data, deferring conversion until it's needed
+
+		Any existing sample data is freed.
+
+		@param codes	Raw ADC codes (CPU readable). Copied, so the buffer may be reused as soon as this returns.
+		@param len		Number of samples
+		@param gain		Volts per code
+		@param offset	Offset added after scaling
+	 */
+	void SetRawSamples16Bit(const int16_t* codes, size_t len, float gain, float offset)
+	{
+		if(!m_rawSamples)
+			m_rawSamples = std::make_unique<RawAnalogSamples>();
+		m_rawSamples->Set16Bit(codes, len, gain, offset);
+		m_samples.clear();
+		m_samples.shrink_to_fit();
+	}
+
+	/**
+		@brief Refers to ADC codes in a block shared with other waveforms (typically one segment of a segmented
+		capture) in place of the sample data, deferring conversion until it's needed
+
+		Any existing sample data is freed. See RawAnalogSamples::SetView().
+
+		@param block		Block of codes (CPU readable), which must not be modified afterwards
+		@param byteOffset	Offset of our first code within the block, in bytes
+		@param len			Number of samples
+		@param bits			Bits per code (8 or 16)
+		@param gain			Volts per code
+		@param offset		Offset added after scaling
+	 */
+	void SetRawSampleView(
+		std::shared_ptr<AcceleratorBuffer<int8_t> > block,
+		size_t byteOffset,
+		size_t len,
+		int bits,
+		float gain,
+		float offset)
+	{
+		if(!m_rawSamples)
+			m_rawSamples = std::make_unique<RawAnalogSamples>();
+		m_rawSamples->SetView(block, byteOffset, len, bits, gain, offset);
+		m_samples.clear();
+		m_samples.shrink_to_fit();
+	}
+
+	virtual bool HasRawSamples() const override
+	{ return m_rawSamples != nullptr; }
+
+	virtual void ExpandRawSamples() override
+	{ m_rawSamples = nullptr; }
+
 	virtual void FreeGpuMemory() override
 	{ m_samples.FreeGpuBuffer(); }
 
 	virtual bool HasGpuBuffer() override
 	{ return m_samples.HasGpuBuffer(); }
 
+	virtual bool IsCurrentOnlyOnGpu() override
+	{ return (m_rawSamples == nullptr) && m_samples.IsCurrentOnlyOnGpu(); }
+
+	virtual int GetCpuNode() override
+	{ return m_samples.GetCpuNode(); }
+
+	///@brief Hashes the sample data (see WaveformBase::GetContentHash())
+	virtual bool GetContentHash(uint64_t& hash) override
+	{
+		if(!std::is_trivially_copyable<S>::value || m_rawSamples || m_samples.IsCurrentOnlyOnGpu())
+			return false;
+
+		m_samples.PrepareForCpuAccess();
+		size_t len = m_samples.size();
+		hash = GetMetadataHash(len);
+		if(len)
+			hash = ContentHash64(m_samples.GetCpuPointer(), len * sizeof(S), hash);
+		return true;
+	}
+
+	/**
+		@brief Makes this waveform a zero-copy view of part of another waveform
+
+		The sample buffer aliases rhs's storage (see AcceleratorBuffer::ShareRangeFrom()) and the trigger phase is
+		moved so each sample stays at the same time it had in rhs. Other metadata is left to the caller.
+
+		@param rhs		Waveform to view
+		@param start	Index of the first sample of rhs to include
+		@param count	Number of samples to include
+	 */
+	void ShareRangeFrom(UniformWaveform<S>* rhs, size_t start, size_t count)
+	{
+		rhs->ExpandRawSamples();
+		m_rawSamples = nullptr;
+		m_samples.ShareRangeFrom(rhs->m_samples, start, count);
+		m_triggerPhase = rhs->m_triggerPhase + static_cast<int64_t>(start) * rhs->m_timescale;
+	}
+
+	/**
+		@brief Changes the number of samples
+
+		Raw ADC codes (see SetRawSamples8Bit()) are discarded, since the caller is about to write new sample data.
+	 */
 	virtual void Resize(size_t size) override
-	{ m_samples.resize(size); }
+	{
+		m_rawSamples = nullptr;
+		m_samples.resize(size);
+	}
 
 	virtual void Reserve(size_t size) override
 	{ m_samples.reserve(size); }
 
 	virtual size_t size() const override
-	{ return m_samples.size(); }
+	{
+		if(m_rawSamples)
+			return m_rawSamples->size();
+		return m_samples.size();
+	}
+
+	virtual size_t capacity() const override
+	{ return m_samples.capacity(); }
 
 	virtual void clear() override
-	{ m_samples.clear(); }
+	{
+		m_rawSamples = nullptr;
+		m_samples.clear();
+	}
 
 	virtual void PrepareForCpuAccess() override
-	{ m_samples.PrepareForCpuAccess(); }
+	{
+		ExpandRawSamples();
+		m_samples.PrepareForCpuAccess();
+	}
+
+	virtual ReadbackFuture PrepareForCpuAccessAsync() override
+	{
+		ExpandRawSamples();
+		return m_samples.PrepareForCpuAccessAsync();
+	}
 
 	virtual void PrepareForGpuAccess() override
-	{ m_samples.PrepareForGpuAccess(); }
+	{
+		ExpandRawSamples();
+		m_samples.PrepareForGpuAccess();
+	}
 
 	virtual void PrepareForGpuAccessNonblocking(vk::raii::CommandBuffer& cmdBuf) override
-	{ m_samples.PrepareForGpuAccessNonblocking(false, cmdBuf); }
+	{
+		ExpandRawSamples();
+		m_samples.PrepareForGpuAccessNonblocking(false, cmdBuf);
+	}
 
 	virtual void MarkSamplesModifiedFromCpu() override
 	{ m_samples.MarkModifiedFromCpu(); }
@@ -498,6 +924,7 @@ public:
 	 */
 	SparseWaveform(const std::string& name = "")
 	{
+		m_typeTag = TYPE_SPARSE | WaveformSampleTag<S>::value;
 		Rename(name);
 
 		//Default data to CPU/GPU mirror
@@ -527,6 +954,7 @@ public:
 	 */
 	SparseWaveform(UniformWaveform<S>& rhs)
 	{
+		m_typeTag = TYPE_SPARSE | WaveformSampleTag<S>::value;
 		m_samples.SetName(std::string("SparseWaveform<") + typeid(S).name() + ">.m_samples");
 		m_offsets.SetName(std::string("SparseWaveform<") + typeid(S).name() + ">.m_offsets");
 		m_durations.SetName(std::string("SparseWaveform<") + typeid(S).name() + ">.m_durations");
@@ -536,6 +964,7 @@ public:
 		m_samples.PrepareForCpuAccess();
 
 		//Copy sample data
+		rhs.ExpandRawSamples();
 		Resize(rhs.size());
 		m_samples.CopyFrom(rhs.m_samples);
 
@@ -575,8 +1004,55 @@ public:
 	virtual bool HasGpuBuffer() override
 	{ return m_samples.HasGpuBuffer() || m_offsets.HasGpuBuffer() || m_durations.HasGpuBuffer(); }
 
+	virtual bool IsCurrentOnlyOnGpu() override
+	{ return m_samples.IsCurrentOnlyOnGpu() || m_offsets.IsCurrentOnlyOnGpu() || m_durations.IsCurrentOnlyOnGpu(); }
+
+	virtual int GetCpuNode() override
+	{ return m_samples.GetCpuNode(); }
+
+	///@brief Hashes the sample data (see WaveformBase::GetContentHash())
+	virtual bool GetContentHash(uint64_t& hash) override
+	{
+		if(!std::is_trivially_copyable<S>::value || m_timeline || IsCurrentOnlyOnGpu())
+			return false;
+
+		m_offsets.PrepareForCpuAccess();
+		m_durations.PrepareForCpuAccess();
+		m_samples.PrepareForCpuAccess();
+		size_t len = m_samples.size();
+		hash = GetMetadataHash(len);
+		if(len)
+		{
+			hash = ContentHash64(m_offsets.GetCpuPointer(), len * sizeof(int64_t), hash);
+			hash = ContentHash64(m_durations.GetCpuPointer(), len * sizeof(int64_t), hash);
+			hash = ContentHash64(m_samples.GetCpuPointer(), len * sizeof(S), hash);
+		}
+		return true;
+	}
+
+	/**
+		@brief Makes this waveform a zero-copy view of part of another waveform
+
+		Timestamps and samples alias rhs's storage (see AcceleratorBuffer::ShareRangeFrom()). Offsets are absolute,
+		so the trigger phase is simply copied. Other metadata is left to the caller.
+
+		@param rhs		Waveform to view
+		@param start	Index of the first sample of rhs to include
+		@param count	Number of samples to include
+	 */
+	void ShareRangeFrom(SparseWaveform<S>* rhs, size_t start, size_t count)
+	{
+		rhs->ExpandTimestamps();
+		m_timeline = nullptr;
+		m_offsets.ShareRangeFrom(rhs->m_offsets, start, count);
+		m_durations.ShareRangeFrom(rhs->m_durations, start, count);
+		m_samples.ShareRangeFrom(rhs->m_samples, start, count);
+		m_triggerPhase = rhs->m_triggerPhase;
+	}
+
 	virtual void Resize(size_t size) override
 	{
+		ExpandTimestamps();
 		m_offsets.resize(size);
 		m_durations.resize(size);
 		m_samples.resize(size);
@@ -584,6 +1060,7 @@ public:
 
 	virtual void Reserve(size_t size) override
 	{
+		ExpandTimestamps();
 		m_offsets.reserve(size);
 		m_durations.reserve(size);
 		m_samples.reserve(size);
@@ -592,8 +1069,24 @@ public:
 	virtual size_t size() const override
 	{ return m_samples.size(); }
 
+	virtual size_t capacity() const override
+	{ return std::min(m_samples.capacity(), std::min(m_offsets.capacity(), m_durations.capacity())); }
+
+	/**
+		@brief Makes the length of the waveform the count most recently written by a GPU kernel
+
+		See AcceleratorBuffer::SetDeviceLength(). The waveform must already be sized to an upper bound on the count.
+	 */
+	void SetDeviceLength(std::shared_ptr<DeviceLength> length)
+	{
+		m_offsets.SetDeviceLength(length);
+		m_durations.SetDeviceLength(length);
+		m_samples.SetDeviceLength(length);
+	}
+
 	virtual void clear() override
 	{
+		m_timeline = nullptr;
 		m_offsets.clear();
 		m_durations.clear();
 		m_samples.clear();
@@ -601,13 +1094,24 @@ public:
 
 	virtual void PrepareForCpuAccess() override
 	{
+		ExpandTimestamps();
 		m_offsets.PrepareForCpuAccess();
 		m_durations.PrepareForCpuAccess();
 		m_samples.PrepareForCpuAccess();
 	}
 
+	virtual ReadbackFuture PrepareForCpuAccessAsync() override
+	{
+		ExpandTimestamps();
+		auto ret = m_offsets.PrepareForCpuAccessAsync();
+		ret.Merge(m_durations.PrepareForCpuAccessAsync());
+		ret.Merge(m_samples.PrepareForCpuAccessAsync());
+		return ret;
+	}
+
 	virtual void PrepareForGpuAccess() override
 	{
+		ExpandTimestamps();
 		m_offsets.PrepareForGpuAccess();
 		m_durations.PrepareForGpuAccess();
 		m_samples.PrepareForGpuAccess();
@@ -615,6 +1119,7 @@ public:
 
 	virtual void PrepareForGpuAccessNonblocking(vk::raii::CommandBuffer& cmdBuf) override
 	{
+		ExpandTimestamps();
 		m_samples.PrepareForGpuAccessNonblocking(false, cmdBuf);
 		m_offsets.PrepareForGpuAccessNonblocking(false, cmdBuf);
 		m_durations.PrepareForGpuAccessNonblocking(false, cmdBuf);
@@ -643,7 +1148,53 @@ typedef SparseWaveform<bool> 					SparseDigitalWaveform;
 typedef UniformWaveform<bool>					UniformDigitalWaveform;
 typedef SparseWaveform<float>					SparseAnalogWaveform;
 typedef UniformWaveform<float>					UniformAnalogWaveform;
-typedef SparseWaveform< std::vector<bool> > 	SparseDigitalBusWaveform;
+
+/**
+	@brief A sparse waveform of a digital bus, one packed 64-bit word per sample
+	@ingroup datamodel
+
+	Bit n of each sample is bit n of the bus, so buses are at most 64 bits wide. Storing the bus value as a word
+	rather than a vector of bits means no allocation per sample, and consumers get the value they almost always want
+	without converting it.
+ */
+class SparseDigitalBusWaveform : public SparseWaveform<uint64_t>
+{
+public:
+	SparseDigitalBusWaveform(size_t width = 0, const std::string& name = "")
+	: SparseWaveform<uint64_t>(name)
+	, m_width(width)
+	{ m_typeTag = TYPE_SPARSE | TYPE_SAMPLE_DIGITAL_BUS; }
+
+	///@brief Gets one bit of a sample
+	bool GetBit(size_t i, size_t bit)
+	{ return (m_samples[i] >> bit) & 1; }
+
+	/**
+		@brief Gets a sample as a vector of bits, bit 0 first
+
+		Only for compatibility with code written for the old representation; it allocates.
+	 */
+	std::vector<bool> GetBits(size_t i)
+	{
+		std::vector<bool> bits(m_width);
+		for(size_t j=0; j<m_width; j++)
+			bits[j] = GetBit(i, j);
+		return bits;
+	}
+
+	///@brief Number of bits in the bus
+	size_t m_width;
+};
+
+///@brief Converts raw ADC codes to fp32 and frees them
+template<>
+inline void UniformWaveform<float>::ExpandRawSamples()
+{
+	if(!m_rawSamples)
+		return;
+	m_rawSamples->Expand(m_samples);
+	m_rawSamples = nullptr;
+}
 
 //Make sure inline helpers aren't warned about if unused
 #pragma GCC diagnostic push
@@ -706,7 +1257,11 @@ float GetSampleTimesIndex(const SparseAnalogWaveform* wfm, ssize_t i)
 	@param i	Sample index
  */
 int64_t GetOffset(const SparseWaveformBase* wfm, size_t i)
-{ return wfm->m_offsets[i]; }
+{
+	if(wfm->m_timeline)
+		return wfm->m_timeline->GetOffset(i);
+	return wfm->m_offsets[i];
+}
 
 /**
 	@brief Returns the offset of a sample from the start of the waveform, in timebase ticks
@@ -731,7 +1286,11 @@ int64_t GetOffset(const UniformWaveformBase* /*wfm*/, size_t i)
 	@param i	Sample index
  */
 int64_t GetDuration(const SparseWaveformBase* wfm, size_t i)
-{ return wfm->m_durations[i]; }
+{
+	if(wfm->m_timeline)
+		return wfm->m_timeline->GetDuration(i);
+	return wfm->m_durations[i];
+}
 
 /**
 	@brief Returns the duration of this sample, in timebase ticks
@@ -850,6 +1409,123 @@ static T GetValue(const SparseWaveform<T>* sparse, const UniformWaveform<T>* uni
 		return uniform->m_samples[i];
 }
 
+/**
+	@brief Type tag test used by WaveformCast() for a given waveform class
+	@ingroup datamodel
+
+	A waveform matches if (tag & mask) == value. Classes with a zero mask have no tag and fall back to RTTI; this
+	includes classes derived from a tagged type (e.g. protocol waveforms), since the tag only identifies the base.
+ */
+template<class W> struct WaveformTypeTraits
+{
+	static constexpr uint8_t mask = 0;
+	static constexpr uint8_t value = 0;
+};
+
+template<> struct WaveformTypeTraits<UniformWaveformBase>
+{
+	static constexpr uint8_t mask = WaveformBase::TYPE_LAYOUT_MASK;
+	static constexpr uint8_t value = WaveformBase::TYPE_UNIFORM;
+};
+
+template<> struct WaveformTypeTraits<SparseWaveformBase>
+{
+	static constexpr uint8_t mask = WaveformBase::TYPE_LAYOUT_MASK;
+	static constexpr uint8_t value = WaveformBase::TYPE_SPARSE;
+};
+
+template<class S> struct WaveformTypeTraits< UniformWaveform<S> >
+{
+	static constexpr uint8_t mask = WaveformSampleTag<S>::value ? 0xff : 0;
+	static constexpr uint8_t value = WaveformBase::TYPE_UNIFORM | WaveformSampleTag<S>::value;
+};
+
+template<class S> struct WaveformTypeTraits< SparseWaveform<S> >
+{
+	static constexpr uint8_t mask = WaveformSampleTag<S>::value ? 0xff : 0;
+	static constexpr uint8_t value = WaveformBase::TYPE_SPARSE | WaveformSampleTag<S>::value;
+};
+
+template<> struct WaveformTypeTraits<SparseDigitalBusWaveform>
+{
+	static constexpr uint8_t mask = 0xff;
+	static constexpr uint8_t value = WaveformBase::TYPE_SPARSE | WaveformBase::TYPE_SAMPLE_DIGITAL_BUS;
+};
+
+/**
+	@brief Downcasts a waveform, returning null if it's not of the requested type
+	@ingroup datamodel
+
+	Equivalent to dynamic_cast, but uses the waveform type tag instead of RTTI for the analog, digital, and digital bus
+	waveform types (and the uniform/sparse base classes) so it's cheap enough to call on hot paths.
+
+	@param wfm	The waveform to cast (may be null)
+ */
+template<class W>
+W* WaveformCast(WaveformBase* wfm)
+{
+	if constexpr(std::is_same<W, WaveformBase>::value)
+		return wfm;
+	else if constexpr(WaveformTypeTraits<W>::mask != 0)
+	{
+		if( (wfm == nullptr) || ((wfm->GetTypeTag() & WaveformTypeTraits<W>::mask) != WaveformTypeTraits<W>::value) )
+			return nullptr;
+		return static_cast<W*>(wfm);
+	}
+	else
+		return dynamic_cast<W*>(wfm);
+}
+
+///@brief Const version of WaveformCast()
+template<class W>
+const W* WaveformCast(const WaveformBase* wfm)
+{ return WaveformCast<W>(const_cast<WaveformBase*>(wfm)); }
+
+/**
+	@brief Calls a function with a waveform downcast to its concrete uniform or sparse type
+	@ingroup datamodel
+
+	The function (normally a generic lambda) is instantiated once for UniformWaveform<S>* and once for
+	SparseWaveform<S>*, so loops inside it are fully specialized and need no per-sample sparse/uniform checks.
+
+	@param wfm	The waveform (may be null)
+	@param func	Function to call
+
+	@return		True if func was called, false if wfm was null or not a UniformWaveform<S> or SparseWaveform<S>
+ */
+template<class S, class F>
+bool VisitWaveform(WaveformBase* wfm, F&& func)
+{
+	if(auto u = WaveformCast< UniformWaveform<S> >(wfm))
+	{
+		func(u);
+		return true;
+	}
+	if(auto s = WaveformCast< SparseWaveform<S> >(wfm))
+	{
+		func(s);
+		return true;
+	}
+	return false;
+}
+
+/**
+	@brief Calls a function with two waveforms downcast to their concrete uniform or sparse types
+	@ingroup datamodel
+
+	Same as VisitWaveform() but dispatches on both waveforms, instantiating func for all four combinations.
+
+	@return True if func was called
+ */
+template<class SA, class SB, class F>
+bool VisitWaveforms(WaveformBase* a, WaveformBase* b, F&& func)
+{
+	bool ok = false;
+	VisitWaveform<SA>(a, [&](auto wa)
+		{ ok = VisitWaveform<SB>(b, [&](auto wb) { func(wa, wb); }); });
+	return ok;
+}
+
 //Template helper methods for validating that an input is the correct type
 static void AssertTypeIsSparseWaveform(const SparseWaveformBase* /*unused*/);
 static void AssertTypeIsUniformWaveform(const UniformWaveformBase* /*unused*/);
@@ -923,4 +1599,6 @@ std::optional<std::string> GetProtocolValueAtTime(WaveformBase* waveform, int64_
 
 #pragma GCC diagnostic pop
 
+#include "PackedDigitalWaveform.h"
+
 #endif
@@ -0,0 +1,158 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of WaveformAccumulator
+ */
+
+#include "scopehal.h"
+#include "WaveformAccumulator.h"
+
+using namespace std;
+
+WaveformAccumulator::WaveformAccumulator(AccumulateMode mode)
+	: m_mode(mode)
+	, m_computePipeline("shaders/WaveformAccumulator.spv", 3, sizeof(WaveformAccumulatorConstants))
+{
+}
+
+/**
+	@brief Folds a new waveform into the accumulated state
+
+	@param cmdBuf	Command buffer to use
+	@param queue	Queue to submit to
+	@param din		Input samples
+	@param len		Number of input samples. out0 (and out1, if used) must be at least this big.
+	@param validLen	Number of samples of existing state. Anything past this is initialized from the input.
+	@param out0		Accumulated state (maximum, minimum, or average)
+	@param out1		Second accumulated state (minimum, for envelope mode only)
+	@param delta	Fractional sample offset at which to linearly interpolate the input
+	@param coeff	Weight of the existing state, for exponential averaging
+ */
+void WaveformAccumulator::Accumulate(
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue,
+	AcceleratorBuffer<float>& din,
+	size_t len,
+	size_t validLen,
+	AcceleratorBuffer<float>& out0,
+	AcceleratorBuffer<float>* out1,
+	float delta,
+	float coeff)
+{
+	if(len == 0)
+		return;
+
+	if(!g_gpuFilterEnabled)
+	{
+		AccumulateOnCpu(din, len, validLen, out0, out1, delta, coeff);
+		return;
+	}
+
+	cmdBuf.begin({});
+
+	WaveformAccumulatorConstants push;
+	push.len = len;
+	push.validLen = validLen;
+	push.mode = m_mode;
+	push.delta = delta;
+	push.coeff = coeff;
+
+	//Modes which only use one output never touch the second binding, but it has to be bound to something
+	m_computePipeline.BindBufferNonblocking(0, din, cmdBuf);
+	m_computePipeline.BindBufferNonblocking(1, out0, cmdBuf);
+	m_computePipeline.BindBufferNonblocking(2, out1 ? *out1 : out0, cmdBuf);
+
+	const uint32_t compute_block_count = GetComputeBlockCount(len, 64);
+	m_computePipeline.Dispatch(cmdBuf, push,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
+
+	cmdBuf.end();
+	queue->SubmitAndBlock(cmdBuf);
+
+	out0.MarkModifiedFromGpu();
+	if(out1)
+		out1->MarkModifiedFromGpu();
+}
+
+void WaveformAccumulator::AccumulateOnCpu(
+	AcceleratorBuffer<float>& din,
+	size_t len,
+	size_t validLen,
+	AcceleratorBuffer<float>& out0,
+	AcceleratorBuffer<float>* out1,
+	float delta,
+	float coeff)
+{
+	din.PrepareForCpuAccess();
+	out0.PrepareForCpuAccess();
+	if(out1)
+		out1->PrepareForCpuAccess();
+
+	for(size_t i=0; i<len; i++)
+	{
+		float v = din[i];
+		if( (delta != 0) && (i+1 < len) )
+			v += (din[i+1] - v) * delta;
+
+		if(i >= validLen)
+		{
+			out0[i] = v;
+			if(out1)
+				(*out1)[i] = v;
+			continue;
+		}
+
+		switch(m_mode)
+		{
+			case ACCUM_MAX:
+				out0[i] = max(out0[i], v);
+				break;
+
+			case ACCUM_MIN:
+				out0[i] = min(out0[i], v);
+				break;
+
+			case ACCUM_ENVELOPE:
+				out0[i] = max(out0[i], v);
+				(*out1)[i] = min((*out1)[i], v);
+				break;
+
+			case ACCUM_EXPONENTIAL:
+				out0[i] = out0[i]*coeff + v*(1-coeff);
+				break;
+		}
+	}
+
+	out0.MarkModifiedFromCpu();
+	if(out1)
+		out1->MarkModifiedFromCpu();
+}
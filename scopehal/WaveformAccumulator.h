@@ -0,0 +1,105 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of WaveformAccumulator
+ */
+
+#ifndef WaveformAccumulator_h
+#define WaveformAccumulator_h
+
+/**
+	@brief Push constants for WaveformAccumulator.glsl
+ */
+struct WaveformAccumulatorConstants
+{
+	uint32_t len;
+	uint32_t validLen;
+	uint32_t mode;
+	float delta;
+	float coeff;
+};
+
+/**
+	@brief Helper for filters which fold each new waveform into state kept across triggers (peak hold, envelope...)
+
+	The state lives in the caller's output buffers, so it stays on the GPU from one trigger to the next and is only
+	copied back if something actually reads it on the CPU. Each update is a single elementwise dispatch.
+
+	Samples past the end of the existing state (e.g. on the first waveform, or if the record got longer) are
+	initialized from the input rather than combined with it.
+ */
+class WaveformAccumulator
+{
+public:
+	enum AccumulateMode
+	{
+		///@brief out0 = max(out0, in)
+		ACCUM_MAX,
+
+		///@brief out0 = min(out0, in)
+		ACCUM_MIN,
+
+		///@brief out0 = max(out0, in), out1 = min(out1, in)
+		ACCUM_ENVELOPE,
+
+		///@brief out0 = out0*coeff + in*(1-coeff)
+		ACCUM_EXPONENTIAL
+	};
+
+	WaveformAccumulator(AccumulateMode mode);
+
+	void Accumulate(
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue,
+		AcceleratorBuffer<float>& din,
+		size_t len,
+		size_t validLen,
+		AcceleratorBuffer<float>& out0,
+		AcceleratorBuffer<float>* out1 = nullptr,
+		float delta = 0,
+		float coeff = 0);
+
+protected:
+	void AccumulateOnCpu(
+		AcceleratorBuffer<float>& din,
+		size_t len,
+		size_t validLen,
+		AcceleratorBuffer<float>& out0,
+		AcceleratorBuffer<float>* out1,
+		float delta,
+		float coeff);
+
+	AccumulateMode m_mode;
+
+	ComputePipeline m_computePipeline;
+};
+
+#endif
@@ -0,0 +1,290 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of WaveformCodec
+	@ingroup datamodel
+ */
+
+#include "scopehal.h"
+#include "WaveformCodec.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Primitives
+
+void WaveformCodec::PutVarint(vector<uint8_t>& out, uint64_t v)
+{
+	while(v >= 0x80)
+	{
+		out.push_back(static_cast<uint8_t>(v) | 0x80);
+		v >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(v));
+}
+
+bool WaveformCodec::GetVarint(const uint8_t* buf, size_t len, size_t& pos, uint64_t& v)
+{
+	v = 0;
+	for(unsigned int shift = 0; shift < 64; shift += 7)
+	{
+		if(pos >= len)
+			return false;
+		uint8_t b = buf[pos++];
+		v |= static_cast<uint64_t>(b & 0x7f) << shift;
+		if( (b & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Encoding
+
+/**
+	@brief Appends the encoding of a waveform to a buffer
+
+	@param wfm	The waveform. Null, or a type which can't be encoded, is written as an empty waveform.
+	@param out	Buffer to append to
+ */
+void WaveformCodec::Encode(WaveformBase* wfm, vector<uint8_t>& out)
+{
+	auto type = SharedWaveformBuffer::GetType(wfm);
+	out.push_back(type);
+	if(type == SharedWaveformBuffer::TYPE_NONE)
+		return;
+
+	wfm->PrepareForCpuAccess();
+	size_t len = wfm->size();
+
+	out.push_back(wfm->m_flags);
+	PutVarint(out, len);
+	PutVarint(out, ZigZag(wfm->m_timescale));
+	PutVarint(out, ZigZag(wfm->m_startTimestamp));
+	PutVarint(out, ZigZag(wfm->m_startFemtoseconds));
+	PutVarint(out, ZigZag(wfm->m_triggerPhase));
+
+	//Timestamps
+	auto swfm = dynamic_cast<SparseWaveformBase*>(wfm);
+	if(swfm)
+	{
+		out.reserve(out.size() + 2*len);
+
+		int64_t last = 0;
+		for(size_t i=0; i<len; i++)
+		{
+			PutVarint(out, ZigZag(swfm->m_offsets[i] - last));
+			last = swfm->m_offsets[i];
+		}
+		for(size_t i=0; i<len; i++)
+			PutVarint(out, ZigZag(swfm->m_durations[i]));
+	}
+
+	//Samples
+	switch(type)
+	{
+		case SharedWaveformBuffer::TYPE_UNIFORM_ANALOG:
+		case SharedWaveformBuffer::TYPE_SPARSE_ANALOG:
+			{
+				const float* samples = (type == SharedWaveformBuffer::TYPE_UNIFORM_ANALOG) ?
+					static_cast<UniformAnalogWaveform*>(wfm)->m_samples.GetCpuPointer() :
+					static_cast<SparseAnalogWaveform*>(wfm)->m_samples.GetCpuPointer();
+				size_t base = out.size();
+				out.resize(base + len*sizeof(float));
+				memcpy(&out[base], samples, len*sizeof(float));
+			}
+			break;
+
+		case SharedWaveformBuffer::TYPE_UNIFORM_DIGITAL:
+		case SharedWaveformBuffer::TYPE_SPARSE_DIGITAL:
+			{
+				const bool* samples = (type == SharedWaveformBuffer::TYPE_UNIFORM_DIGITAL) ?
+					static_cast<UniformDigitalWaveform*>(wfm)->m_samples.GetCpuPointer() :
+					static_cast<SparseDigitalWaveform*>(wfm)->m_samples.GetCpuPointer();
+				size_t base = out.size();
+				out.resize(base + (len+7)/8, 0);
+				for(size_t i=0; i<len; i++)
+				{
+					if(samples[i])
+						out[base + i/8] |= (1 << (i & 7));
+				}
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Decoding
+
+/**
+	@brief Decodes one waveform from a buffer
+
+	@param buf		The buffer
+	@param len		Size of the buffer
+	@param pos		Position of the waveform in the buffer, advanced past it
+	@param reuse	Waveform to overwrite if it's of the right type (may be null). If not used, the caller still owns it.
+	@param wfm		The waveform (reuse, or a newly allocated one), or null if an empty waveform was encoded
+
+	@return False if the buffer is truncated or corrupted
+ */
+bool WaveformCodec::Decode(const uint8_t* buf, size_t len, size_t& pos, WaveformBase* reuse, WaveformBase*& wfm)
+{
+	wfm = nullptr;
+	if(pos >= len)
+		return false;
+	auto type = static_cast<SharedWaveformBuffer::WaveformType>(buf[pos++]);
+	if(type == SharedWaveformBuffer::TYPE_NONE)
+		return true;
+
+	//Header
+	if(pos >= len)
+		return false;
+	uint8_t flags = buf[pos++];
+	uint64_t size;
+	uint64_t timescale;
+	uint64_t startTimestamp;
+	uint64_t startFemtoseconds;
+	uint64_t triggerPhase;
+	if(!GetVarint(buf, len, pos, size) ||
+		!GetVarint(buf, len, pos, timescale) ||
+		!GetVarint(buf, len, pos, startTimestamp) ||
+		!GetVarint(buf, len, pos, startFemtoseconds) ||
+		!GetVarint(buf, len, pos, triggerPhase) )
+	{
+		return false;
+	}
+
+	//Every sample takes at least one bit, so a size bigger than that is corrupt (and would make us allocate it)
+	if(size > 8*(len - pos))
+		return false;
+
+	WaveformBase* out = (SharedWaveformBuffer::GetType(reuse) == type) ? reuse : nullptr;
+	if(!out)
+	{
+		switch(type)
+		{
+			case SharedWaveformBuffer::TYPE_UNIFORM_ANALOG:
+				out = new UniformAnalogWaveform;
+				break;
+			case SharedWaveformBuffer::TYPE_SPARSE_ANALOG:
+				out = new SparseAnalogWaveform;
+				break;
+			case SharedWaveformBuffer::TYPE_UNIFORM_DIGITAL:
+				out = new UniformDigitalWaveform;
+				break;
+			case SharedWaveformBuffer::TYPE_SPARSE_DIGITAL:
+				out = new SparseDigitalWaveform;
+				break;
+			default:
+				return false;
+		}
+	}
+
+	//Delete it again if it turns out to be corrupt, unless it belongs to the caller
+	auto fail = [&]
+	{
+		if(out != reuse)
+			delete out;
+		return false;
+	};
+
+	out->m_flags = flags;
+	out->m_timescale = UnZigZag(timescale);
+	out->m_startTimestamp = UnZigZag(startTimestamp);
+	out->m_startFemtoseconds = UnZigZag(startFemtoseconds);
+	out->m_triggerPhase = UnZigZag(triggerPhase);
+	out->m_revision ++;
+	out->Resize(size);
+	out->PrepareForCpuAccess();
+
+	//Timestamps
+	auto swfm = dynamic_cast<SparseWaveformBase*>(out);
+	if(swfm)
+	{
+		int64_t last = 0;
+		uint64_t v;
+		for(size_t i=0; i<size; i++)
+		{
+			if(!GetVarint(buf, len, pos, v))
+				return fail();
+			last += UnZigZag(v);
+			swfm->m_offsets[i] = last;
+		}
+		for(size_t i=0; i<size; i++)
+		{
+			if(!GetVarint(buf, len, pos, v))
+				return fail();
+			swfm->m_durations[i] = UnZigZag(v);
+		}
+	}
+
+	//Samples
+	switch(type)
+	{
+		case SharedWaveformBuffer::TYPE_UNIFORM_ANALOG:
+		case SharedWaveformBuffer::TYPE_SPARSE_ANALOG:
+			{
+				if(len - pos < size*sizeof(float))
+					return fail();
+				float* samples = (type == SharedWaveformBuffer::TYPE_UNIFORM_ANALOG) ?
+					static_cast<UniformAnalogWaveform*>(out)->m_samples.GetCpuPointer() :
+					static_cast<SparseAnalogWaveform*>(out)->m_samples.GetCpuPointer();
+				memcpy(samples, buf + pos, size*sizeof(float));
+				pos += size*sizeof(float);
+			}
+			break;
+
+		case SharedWaveformBuffer::TYPE_UNIFORM_DIGITAL:
+		case SharedWaveformBuffer::TYPE_SPARSE_DIGITAL:
+			{
+				if(len - pos < (size+7)/8)
+					return fail();
+				bool* samples = (type == SharedWaveformBuffer::TYPE_UNIFORM_DIGITAL) ?
+					static_cast<UniformDigitalWaveform*>(out)->m_samples.GetCpuPointer() :
+					static_cast<SparseDigitalWaveform*>(out)->m_samples.GetCpuPointer();
+				for(size_t i=0; i<size; i++)
+					samples[i] = (buf[pos + i/8] >> (i & 7)) & 1;
+				pos += (size+7)/8;
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	out->MarkModifiedFromCpu();
+	wfm = out;
+	return true;
+}
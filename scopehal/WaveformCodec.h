@@ -0,0 +1,77 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of WaveformCodec
+	@ingroup datamodel
+ */
+
+#ifndef WaveformCodec_h
+#define WaveformCodec_h
+
+#include "SharedWaveformBuffer.h"
+
+/**
+	@brief Compact binary encoding of analog and digital waveforms, for sending over a network
+
+	Each waveform is a small header followed by one column per sample array, and each column is encoded to suit its
+	contents:
+
+	* Offsets are delta coded then written as zigzag varints. Timestamps of most sparse waveforms increase by a small,
+	  nearly constant step, so this is usually one byte per sample instead of eight.
+	* Durations are written as varints, usually one byte each.
+	* Digital samples are bit packed, eight per byte.
+	* Analog samples are raw little endian floats, since they rarely compress well enough to be worth the CPU time.
+
+	Waveform types which can be encoded are the same as for SharedWaveformBuffer.
+
+	@ingroup datamodel
+ */
+class WaveformCodec
+{
+public:
+	static void Encode(WaveformBase* wfm, std::vector<uint8_t>& out);
+	static bool Decode(const uint8_t* buf, size_t len, size_t& pos, WaveformBase* reuse, WaveformBase*& wfm);
+
+protected:
+	static void PutVarint(std::vector<uint8_t>& out, uint64_t v);
+	static bool GetVarint(const uint8_t* buf, size_t len, size_t& pos, uint64_t& v);
+
+	///@brief Maps signed integers to unsigned so small magnitudes of either sign encode as short varints
+	static uint64_t ZigZag(int64_t v)
+	{ return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+
+	///@brief Inverse of ZigZag()
+	static int64_t UnZigZag(uint64_t v)
+	{ return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+};
+
+#endif
@@ -0,0 +1,902 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of WaveformHistory
+	@ingroup datamodel
+ */
+
+#include "scopehal.h"
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+///@brief Waveform types in a compressed snapshot
+enum HistoryWaveformType
+{
+	HISTORY_UNIFORM_ANALOG,
+	HISTORY_SPARSE_ANALOG,
+	HISTORY_UNIFORM_DIGITAL,
+	HISTORY_SPARSE_DIGITAL,
+	HISTORY_UNIFORM_PACKED_DIGITAL
+};
+
+///@brief Encodings for analog sample data
+enum HistoryAnalogCodec
+{
+	///@brief Delta coded indexes into a table of distinct sample values
+	HISTORY_CODEC_TABLE,
+
+	///@brief Each sample XORed with the previous one
+	HISTORY_CODEC_XOR
+};
+
+///@brief Largest number of distinct sample values HISTORY_CODEC_TABLE will be used for
+static const size_t MAX_TABLE_SIZE = 65536;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Varint helpers
+
+static void PutVarint(vector<uint8_t>& out, uint64_t v)
+{
+	while(v >= 0x80)
+	{
+		out.push_back((v & 0x7f) | 0x80);
+		v >>= 7;
+	}
+	out.push_back(v);
+}
+
+static void PutSigned(vector<uint8_t>& out, int64_t v)
+{
+	PutVarint(out, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+}
+
+static bool GetVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v)
+{
+	v = 0;
+	for(unsigned int shift=0; shift<64; shift += 7)
+	{
+		if(p >= end)
+			return false;
+		uint8_t b = *p++;
+		v |= static_cast<uint64_t>(b & 0x7f) << shift;
+		if(!(b & 0x80))
+			return true;
+	}
+	return false;
+}
+
+static bool GetSigned(const uint8_t*& p, const uint8_t* end, int64_t& v)
+{
+	uint64_t u;
+	if(!GetVarint(p, end, u))
+		return false;
+	v = static_cast<int64_t>(u >> 1) ^ -static_cast<int64_t>(u & 1);
+	return true;
+}
+
+/**
+	@brief Maps the bits of a float to an unsigned integer which sorts in the same order as the float values
+ */
+static uint32_t SortableFloatBits(uint32_t bits)
+{
+	if(bits & 0x80000000)
+		return ~bits;
+	return bits | 0x80000000;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sample codecs
+
+static void CompressAnalog(const float* samples, size_t len, vector<uint8_t>& out)
+{
+	//See if there are few enough distinct values to use a lookup table
+	unordered_map<uint32_t, uint32_t> codes;
+	bool useTable = true;
+	uint32_t prev = 0;
+	for(size_t i=0; i<len; i++)
+	{
+		uint32_t bits;
+		memcpy(&bits, &samples[i], sizeof(bits));
+		if( (i > 0) && (bits == prev) )
+			continue;
+		prev = bits;
+
+		if(codes.emplace(bits, 0).second && (codes.size() > MAX_TABLE_SIZE))
+		{
+			useTable = false;
+			break;
+		}
+	}
+
+	if(useTable)
+	{
+		//Sort the table by value, so slowly changing signals have small index deltas
+		vector<uint32_t> table;
+		table.reserve(codes.size());
+		for(auto it : codes)
+			table.push_back(it.first);
+		sort(table.begin(), table.end(),
+			[](uint32_t a, uint32_t b) { return SortableFloatBits(a) < SortableFloatBits(b); });
+		for(size_t i=0; i<table.size(); i++)
+			codes[table[i]] = i;
+
+		out.push_back(HISTORY_CODEC_TABLE);
+		PutVarint(out, table.size());
+		size_t base = out.size();
+		out.resize(base + table.size() * sizeof(uint32_t));
+		memcpy(&out[base], &table[0], table.size() * sizeof(uint32_t));
+
+		int64_t lastCode = 0;
+		uint32_t lastBits = 0;
+		for(size_t i=0; i<len; i++)
+		{
+			uint32_t bits;
+			memcpy(&bits, &samples[i], sizeof(bits));
+			int64_t code = lastCode;
+			if( (i == 0) || (bits != lastBits) )
+				code = codes[bits];
+			PutSigned(out, code - lastCode);
+			lastCode = code;
+			lastBits = bits;
+		}
+	}
+
+	else
+	{
+		out.push_back(HISTORY_CODEC_XOR);
+		uint32_t last = 0;
+		for(size_t i=0; i<len; i++)
+		{
+			uint32_t bits;
+			memcpy(&bits, &samples[i], sizeof(bits));
+			PutVarint(out, bits ^ last);
+			last = bits;
+		}
+	}
+}
+
+static bool DecompressAnalog(const uint8_t*& p, const uint8_t* end, float* samples, size_t len)
+{
+	if(p >= end)
+		return false;
+	uint8_t codec = *p++;
+
+	if(codec == HISTORY_CODEC_TABLE)
+	{
+		uint64_t tableSize;
+		if(!GetVarint(p, end, tableSize) || (tableSize > MAX_TABLE_SIZE) ||
+			(static_cast<size_t>(end - p) < tableSize * sizeof(float)) )
+		{
+			return false;
+		}
+		vector<float> table(tableSize);
+		if(tableSize)
+			memcpy(&table[0], p, tableSize * sizeof(float));
+		p += tableSize * sizeof(float);
+
+		int64_t code = 0;
+		for(size_t i=0; i<len; i++)
+		{
+			int64_t delta;
+			if(!GetSigned(p, end, delta))
+				return false;
+			code += delta;
+			if( (code < 0) || (static_cast<uint64_t>(code) >= tableSize) )
+				return false;
+			samples[i] = table[code];
+		}
+		return true;
+	}
+
+	else if(codec == HISTORY_CODEC_XOR)
+	{
+		uint32_t last = 0;
+		for(size_t i=0; i<len; i++)
+		{
+			uint64_t v;
+			if(!GetVarint(p, end, v))
+				return false;
+			last ^= static_cast<uint32_t>(v);
+			memcpy(&samples[i], &last, sizeof(last));
+		}
+		return true;
+	}
+
+	return false;
+}
+
+static void CompressDigital(const AcceleratorBuffer<bool>& samples, size_t len, vector<uint8_t>& out)
+{
+	size_t base = out.size();
+	out.resize(base + (len + 7) / 8, 0);
+	for(size_t i=0; i<len; i++)
+	{
+		if(samples[i])
+			out[base + i/8] |= (1 << (i % 8));
+	}
+}
+
+static bool DecompressDigital(const uint8_t*& p, const uint8_t* end, AcceleratorBuffer<bool>& samples, size_t len)
+{
+	size_t nbytes = (len + 7) / 8;
+	if(static_cast<size_t>(end - p) < nbytes)
+		return false;
+	for(size_t i=0; i<len; i++)
+		samples[i] = (p[i/8] >> (i % 8)) & 1;
+	p += nbytes;
+	return true;
+}
+
+/**
+	@brief Stores offsets as deltas, and durations relative to the gap to the next sample
+ */
+static void CompressTimestamps(SparseWaveformBase* wfm, size_t len, vector<uint8_t>& out)
+{
+	auto tl = wfm->m_timeline.get();
+	if(tl)
+		tl->PrepareForCpuAccess();
+	else
+	{
+		wfm->m_offsets.PrepareForCpuAccess();
+		wfm->m_durations.PrepareForCpuAccess();
+	}
+	auto offset = [&](size_t i) { return tl ? tl->GetOffset(i) : wfm->m_offsets[i]; };
+	auto duration = [&](size_t i) { return tl ? tl->GetDuration(i) : wfm->m_durations[i]; };
+
+	int64_t last = 0;
+	for(size_t i=0; i<len; i++)
+	{
+		int64_t off = offset(i);
+		PutSigned(out, off - last);
+		last = off;
+	}
+
+	for(size_t i=0; i<len; i++)
+	{
+		int64_t gap = 0;
+		if(i+1 < len)
+			gap = offset(i+1) - offset(i);
+		PutSigned(out, duration(i) - gap);
+	}
+}
+
+static bool DecompressTimestamps(const uint8_t*& p, const uint8_t* end, SparseWaveformBase* wfm, size_t len)
+{
+	int64_t last = 0;
+	for(size_t i=0; i<len; i++)
+	{
+		int64_t delta;
+		if(!GetSigned(p, end, delta))
+			return false;
+		last += delta;
+		wfm->m_offsets[i] = last;
+	}
+
+	for(size_t i=0; i<len; i++)
+	{
+		int64_t dur;
+		if(!GetSigned(p, end, dur))
+			return false;
+		if(i+1 < len)
+			dur += wfm->m_offsets[i+1] - wfm->m_offsets[i];
+		wfm->m_durations[i] = dur;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates an empty history
+
+	@param maxSnapshots	Maximum number of snapshots to keep (RAM and spill file combined)
+	@param memoryBudget	Maximum number of bytes of compressed data to keep in RAM
+ */
+WaveformHistory::WaveformHistory(size_t maxSnapshots, size_t memoryBudget)
+	: m_nextID(0)
+	, m_maxSnapshots(maxSnapshots)
+	, m_memoryBudget(memoryBudget)
+	, m_memoryUsage(0)
+	, m_spillUsage(0)
+	, m_spillData(nullptr)
+	, m_spillSize(0)
+	, m_spillWritePos(0)
+	, m_spillFd(-1)
+{
+}
+
+WaveformHistory::~WaveformHistory()
+{
+	CloseSpill();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Configuration
+
+/**
+	@brief Moves snapshots which don't fit in the memory budget to a spill file instead of dropping them
+
+	The file is created (replacing any existing file), sized to maxFileSize, and mapped. On POSIX systems it is
+	unlinked immediately, so it never outlives the process. Any snapshots in a previously configured spill file are
+	dropped.
+
+	Not currently supported on Windows.
+
+	@param path			Path of the spill file
+	@param maxFileSize	Size of the spill file, in bytes
+
+	@return True on success
+ */
+bool WaveformHistory::EnableSpill(const string& path, size_t maxFileSize)
+{
+	lock_guard<mutex> lock(m_mutex);
+	CloseSpill();
+
+#ifdef _WIN32
+	(void)path;
+	(void)maxFileSize;
+	LogWarning("WaveformHistory: spill files are not supported on Windows\n");
+	return false;
+#else
+	if(maxFileSize == 0)
+		return false;
+
+	int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if(fd < 0)
+	{
+		LogError("WaveformHistory: couldn't create spill file %s\n", path.c_str());
+		return false;
+	}
+	if(ftruncate(fd, maxFileSize) != 0)
+	{
+		LogError("WaveformHistory: couldn't resize spill file %s\n", path.c_str());
+		close(fd);
+		unlink(path.c_str());
+		return false;
+	}
+
+	void* mapping = mmap(nullptr, maxFileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	unlink(path.c_str());
+	if(mapping == MAP_FAILED)
+	{
+		LogError("WaveformHistory: couldn't map spill file %s\n", path.c_str());
+		close(fd);
+		return false;
+	}
+
+	m_spillFd = fd;
+	m_spillData = reinterpret_cast<uint8_t*>(mapping);
+	m_spillSize = maxFileSize;
+	m_spillWritePos = 0;
+
+	LogDebug("WaveformHistory: spilling to %s (%zu MB)\n", path.c_str(), maxFileSize / (1024 * 1024));
+	EnforceLimits();
+	return true;
+#endif
+}
+
+/**
+	@brief Drops everything in the spill file and unmaps it
+
+	Must be called with m_mutex held (or from the destructor).
+ */
+void WaveformHistory::CloseSpill()
+{
+	for(auto it = m_snapshots.begin(); it != m_snapshots.end(); )
+	{
+		if(it->m_spilled)
+			it = m_snapshots.erase(it);
+		else
+			++it;
+	}
+	m_spillUsage = 0;
+
+#ifndef _WIN32
+	if(m_spillData)
+		munmap(m_spillData, m_spillSize);
+	if(m_spillFd >= 0)
+		close(m_spillFd);
+#endif
+
+	m_spillData = nullptr;
+	m_spillFd = -1;
+	m_spillSize = 0;
+	m_spillWritePos = 0;
+}
+
+/**
+	@brief Changes the snapshot count and memory limits, dropping or spilling snapshots as needed
+ */
+void WaveformHistory::SetLimits(size_t maxSnapshots, size_t memoryBudget)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_maxSnapshots = maxSnapshots;
+	m_memoryBudget = memoryBudget;
+	EnforceLimits();
+}
+
+/**
+	@brief Removes all snapshots
+ */
+void WaveformHistory::Clear()
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_snapshots.clear();
+	m_memoryUsage = 0;
+	m_spillUsage = 0;
+	m_spillWritePos = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Snapshot management
+
+/**
+	@brief Returns true if the waveform is of a type WaveformHistory can store
+
+	Uniform and sparse analog and digital waveforms, and packed digital waveforms, are supported. Other types (protocol
+	decodes, eyes, etc.) are derived data and should be regenerated from the stored waveforms.
+ */
+bool WaveformHistory::IsSupported(WaveformBase* wfm)
+{
+	return
+		(dynamic_cast<UniformAnalogWaveform*>(wfm) != nullptr) ||
+		(dynamic_cast<SparseAnalogWaveform*>(wfm) != nullptr) ||
+		(dynamic_cast<UniformDigitalWaveform*>(wfm) != nullptr) ||
+		(dynamic_cast<SparseDigitalWaveform*>(wfm) != nullptr) ||
+		(dynamic_cast<UniformPackedDigitalWaveform*>(wfm) != nullptr);
+}
+
+/**
+	@brief Compresses a set of waveforms and adds them to the history as a new snapshot
+
+	Waveforms of unsupported types (see IsSupported()) are skipped. The caller retains ownership of the waveforms.
+
+	@return ID of the new snapshot
+ */
+uint64_t WaveformHistory::Add(const WaveformMap& waveforms)
+{
+	Snapshot snap;
+
+	vector<WaveformBase*> wfms;
+	for(auto it : waveforms)
+	{
+		if(!it.second || !IsSupported(it.second))
+			continue;
+
+		if(wfms.empty())
+		{
+			snap.m_startTimestamp = it.second->m_startTimestamp;
+			snap.m_startFemtoseconds = it.second->m_startFemtoseconds;
+		}
+		snap.m_streams.push_back(it.first);
+		wfms.push_back(it.second);
+	}
+
+	//Compress each waveform separately, then concatenate them
+	vector< vector<uint8_t> > blobs(wfms.size());
+	#pragma omp parallel for
+	for(size_t i=0; i<wfms.size(); i++)
+		Compress(wfms[i], blobs[i]);
+
+	for(auto& b : blobs)
+	{
+		PutVarint(snap.m_data, b.size());
+		snap.m_data.insert(snap.m_data.end(), b.begin(), b.end());
+	}
+	snap.m_data.shrink_to_fit();
+
+	lock_guard<mutex> lock(m_mutex);
+	snap.m_id = m_nextID ++;
+	m_memoryUsage += snap.m_data.size();
+	m_snapshots.push_back(std::move(snap));
+	uint64_t id = m_snapshots.back().m_id;
+	EnforceLimits();
+	return id;
+}
+
+/**
+	@brief Decompresses a snapshot
+
+	@param id			ID of the snapshot, as returned by Add()
+	@param waveforms	Newly allocated waveforms for each stream in the snapshot. The caller takes ownership.
+
+	@return True on success, false if the snapshot no longer exists or could not be decoded
+ */
+bool WaveformHistory::Load(uint64_t id, WaveformMap& waveforms)
+{
+	//Copy the compressed data out so we don't hold the lock while decompressing
+	vector<StreamDescriptor> streams;
+	vector<uint8_t> blob;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		auto it = lower_bound(m_snapshots.begin(), m_snapshots.end(), id,
+			[](const Snapshot& s, uint64_t i) { return s.m_id < i; });
+		if( (it == m_snapshots.end()) || (it->m_id != id) )
+			return false;
+
+		streams = it->m_streams;
+		if(it->m_spilled)
+			blob.assign(m_spillData + it->m_spillOffset, m_spillData + it->m_spillOffset + it->m_spillLength);
+		else
+			blob = it->m_data;
+	}
+
+	const uint8_t* p = blob.data();
+	const uint8_t* end = p + blob.size();
+	WaveformMap ret;
+	for(auto& stream : streams)
+	{
+		uint64_t len;
+		WaveformBase* wfm = nullptr;
+		if(GetVarint(p, end, len) && (len <= static_cast<uint64_t>(end - p)) )
+		{
+			const uint8_t* wend = p + len;
+			wfm = Decompress(p, wend);
+			p = wend;
+		}
+
+		if(!wfm)
+		{
+			LogError("WaveformHistory: snapshot %" PRIu64 " is corrupted\n", id);
+			for(auto it : ret)
+				delete it.second;
+			return false;
+		}
+		ret[stream] = wfm;
+	}
+
+	waveforms = ret;
+	return true;
+}
+
+/**
+	@brief Gets the IDs of the oldest and newest snapshots
+
+	@return False if the history is empty
+ */
+bool WaveformHistory::GetIDRange(uint64_t& oldest, uint64_t& newest)
+{
+	lock_guard<mutex> lock(m_mutex);
+	if(m_snapshots.empty())
+		return false;
+	oldest = m_snapshots.front().m_id;
+	newest = m_snapshots.back().m_id;
+	return true;
+}
+
+/**
+	@brief Gets the acquisition timestamp of a snapshot without decompressing it
+
+	@return False if the snapshot no longer exists
+ */
+bool WaveformHistory::GetTimestamp(uint64_t id, time_t& sec, int64_t& fs)
+{
+	lock_guard<mutex> lock(m_mutex);
+	auto it = lower_bound(m_snapshots.begin(), m_snapshots.end(), id,
+		[](const Snapshot& s, uint64_t i) { return s.m_id < i; });
+	if( (it == m_snapshots.end()) || (it->m_id != id) )
+		return false;
+	sec = it->m_startTimestamp;
+	fs = it->m_startFemtoseconds;
+	return true;
+}
+
+/**
+	@brief Drops or spills snapshots until we're within our limits
+
+	Must be called with m_mutex held.
+ */
+void WaveformHistory::EnforceLimits()
+{
+	while(m_snapshots.size() > m_maxSnapshots)
+		DropOldest();
+
+	//Spilled snapshots are always older than the ones in RAM, so the oldest in RAM is the first unspilled one
+	while(m_memoryUsage > m_memoryBudget)
+	{
+		auto it = m_snapshots.begin();
+		while( (it != m_snapshots.end()) && it->m_spilled)
+			++it;
+		if(it == m_snapshots.end())
+			break;
+
+		size_t pos = it - m_snapshots.begin();
+		if(!Spill(*it))
+		{
+			//Spill may have dropped older snapshots before failing, so find ours again
+			it = m_snapshots.begin() + min(pos, m_snapshots.size() - 1);
+			while(it->m_spilled)
+				++it;
+			m_memoryUsage -= it->m_data.size();
+			m_snapshots.erase(it);
+		}
+	}
+}
+
+/**
+	@brief Moves a snapshot's compressed data from RAM to the spill file, dropping the oldest spilled snapshots to make
+	room if needed
+
+	Must be called with m_mutex held.
+
+	@return False if spilling is disabled or the snapshot is larger than the spill file
+ */
+bool WaveformHistory::Spill(Snapshot& snap)
+{
+	size_t len = snap.m_data.size();
+	if(!m_spillData || (len > m_spillSize) )
+		return false;
+
+	//Wrap around if we'd run off the end of the file.
+	//Snapshots between the write pointer and the end of the file are the oldest ones, drop them
+	size_t pos = m_spillWritePos;
+	if(pos + len > m_spillSize)
+	{
+		while(!m_snapshots.empty() && m_snapshots.front().m_spilled && (m_snapshots.front().m_spillOffset >= pos) )
+			DropOldest();
+		pos = 0;
+	}
+
+	//Drop any spilled snapshots we're about to overwrite
+	while(!m_snapshots.empty() && m_snapshots.front().m_spilled)
+	{
+		auto& s = m_snapshots.front();
+		if( (s.m_spillOffset >= pos + len) || (s.m_spillOffset + s.m_spillLength <= pos) )
+			break;
+		DropOldest();
+	}
+
+	memcpy(m_spillData + pos, snap.m_data.data(), len);
+	snap.m_spilled = true;
+	snap.m_spillOffset = pos;
+	snap.m_spillLength = len;
+	m_spillWritePos = pos + len;
+	m_spillUsage += len;
+
+	m_memoryUsage -= len;
+	vector<uint8_t>().swap(snap.m_data);
+	return true;
+}
+
+/**
+	@brief Removes the oldest snapshot
+
+	Must be called with m_mutex held.
+ */
+void WaveformHistory::DropOldest()
+{
+	auto& snap = m_snapshots.front();
+	if(snap.m_spilled)
+		m_spillUsage -= snap.m_spillLength;
+	else
+		m_memoryUsage -= snap.m_data.size();
+	m_snapshots.pop_front();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Serialization
+
+/**
+	@brief Compresses a single waveform
+
+	Each waveform is stored as a type byte, its metadata, the sample count, timestamps if sparse, then the samples.
+ */
+void WaveformHistory::Compress(WaveformBase* wfm, vector<uint8_t>& out)
+{
+	auto ua = dynamic_cast<UniformAnalogWaveform*>(wfm);
+	auto sa = dynamic_cast<SparseAnalogWaveform*>(wfm);
+	auto ud = dynamic_cast<UniformDigitalWaveform*>(wfm);
+	auto sd = dynamic_cast<SparseDigitalWaveform*>(wfm);
+	auto pd = dynamic_cast<UniformPackedDigitalWaveform*>(wfm);
+
+	if(ua)
+		out.push_back(HISTORY_UNIFORM_ANALOG);
+	else if(sa)
+		out.push_back(HISTORY_SPARSE_ANALOG);
+	else if(ud)
+		out.push_back(HISTORY_UNIFORM_DIGITAL);
+	else if(sd)
+		out.push_back(HISTORY_SPARSE_DIGITAL);
+	else
+		out.push_back(HISTORY_UNIFORM_PACKED_DIGITAL);
+
+	size_t len = wfm->size();
+	PutSigned(out, wfm->m_timescale);
+	PutSigned(out, wfm->m_startTimestamp);
+	PutSigned(out, wfm->m_startFemtoseconds);
+	PutSigned(out, wfm->m_triggerPhase);
+	out.push_back(wfm->m_flags);
+	PutVarint(out, len);
+
+	if(ua && ua->HasRawSamples())
+	{
+		//Convert a copy rather than expanding the waveform, so it keeps its small footprint
+		auto raw = ua->m_rawSamples.get();
+		raw->PrepareForCpuAccess();
+		vector<float> samples(len);
+		for(size_t i=0; i<len; i++)
+			samples[i] = raw->GetSample(i);
+		CompressAnalog(samples.data(), len, out);
+	}
+	else if(ua)
+	{
+		ua->m_samples.PrepareForCpuAccess();
+		CompressAnalog(ua->m_samples.GetCpuPointer(), len, out);
+	}
+	else if(sa)
+	{
+		CompressTimestamps(sa, len, out);
+		sa->m_samples.PrepareForCpuAccess();
+		CompressAnalog(sa->m_samples.GetCpuPointer(), len, out);
+	}
+	else if(ud)
+	{
+		ud->m_samples.PrepareForCpuAccess();
+		CompressDigital(ud->m_samples, len, out);
+	}
+	else if(sd)
+	{
+		CompressTimestamps(sd, len, out);
+		sd->m_samples.PrepareForCpuAccess();
+		CompressDigital(sd->m_samples, len, out);
+	}
+	else if(pd)
+	{
+		pd->m_words.PrepareForCpuAccess();
+		size_t nbytes = (len + 7) / 8;
+		size_t base = out.size();
+		out.resize(base + nbytes);
+		if(nbytes)
+			memcpy(&out[base], pd->m_words.GetCpuPointer(), nbytes);
+	}
+}
+
+/**
+	@brief Decompresses a single waveform
+
+	@return The new waveform, or nullptr if the data was malformed
+ */
+WaveformBase* WaveformHistory::Decompress(const uint8_t*& p, const uint8_t* end)
+{
+	if(p >= end)
+		return nullptr;
+	uint8_t type = *p++;
+
+	int64_t timescale;
+	int64_t startTimestamp;
+	int64_t startFemtoseconds;
+	int64_t triggerPhase;
+	uint64_t len;
+	if(!GetSigned(p, end, timescale) ||
+		!GetSigned(p, end, startTimestamp) ||
+		!GetSigned(p, end, startFemtoseconds) ||
+		!GetSigned(p, end, triggerPhase) ||
+		(p >= end) )
+	{
+		return nullptr;
+	}
+	uint8_t flags = *p++;
+	if(!GetVarint(p, end, len))
+		return nullptr;
+
+	//Every sample takes at least one bit, so anything claiming more than that is corrupt
+	if(len / 8 > static_cast<uint64_t>(end - p))
+		return nullptr;
+
+	WaveformBase* wfm = nullptr;
+	bool ok = false;
+	switch(type)
+	{
+		case HISTORY_UNIFORM_ANALOG:
+			{
+				auto w = new UniformAnalogWaveform;
+				wfm = w;
+				w->Resize(len);
+				w->PrepareForCpuAccess();
+				ok = DecompressAnalog(p, end, w->m_samples.GetCpuPointer(), len);
+			}
+			break;
+
+		case HISTORY_SPARSE_ANALOG:
+			{
+				auto w = new SparseAnalogWaveform;
+				wfm = w;
+				w->Resize(len);
+				w->PrepareForCpuAccess();
+				ok = DecompressTimestamps(p, end, w, len) &&
+					DecompressAnalog(p, end, w->m_samples.GetCpuPointer(), len);
+			}
+			break;
+
+		case HISTORY_UNIFORM_DIGITAL:
+			{
+				auto w = new UniformDigitalWaveform;
+				wfm = w;
+				w->Resize(len);
+				w->PrepareForCpuAccess();
+				ok = DecompressDigital(p, end, w->m_samples, len);
+			}
+			break;
+
+		case HISTORY_SPARSE_DIGITAL:
+			{
+				auto w = new SparseDigitalWaveform;
+				wfm = w;
+				w->Resize(len);
+				w->PrepareForCpuAccess();
+				ok = DecompressTimestamps(p, end, w, len) && DecompressDigital(p, end, w->m_samples, len);
+			}
+			break;
+
+		case HISTORY_UNIFORM_PACKED_DIGITAL:
+			{
+				auto w = new UniformPackedDigitalWaveform;
+				wfm = w;
+				w->Resize(len);
+				w->PrepareForCpuAccess();
+				size_t nbytes = (len + 7) / 8;
+				if(static_cast<size_t>(end - p) >= nbytes)
+				{
+					if(nbytes)
+						memcpy(w->m_words.GetCpuPointer(), p, nbytes);
+					p += nbytes;
+					ok = true;
+				}
+			}
+			break;
+
+		default:
+			return nullptr;
+	}
+
+	if(!ok)
+	{
+		delete wfm;
+		return nullptr;
+	}
+
+	wfm->m_timescale = timescale;
+	wfm->m_startTimestamp = startTimestamp;
+	wfm->m_startFemtoseconds = startFemtoseconds;
+	wfm->m_triggerPhase = triggerPhase;
+	wfm->m_flags = flags;
+	wfm->MarkModifiedFromCpu();
+	return wfm;
+}
@@ -0,0 +1,194 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of WaveformHistory
+	@ingroup datamodel
+ */
+
+#ifndef WaveformHistory_h
+#define WaveformHistory_h
+
+#include <deque>
+#include <mutex>
+
+/**
+	@brief Compact long term storage for a ring of past acquisitions
+	@ingroup datamodel
+
+	Keeping every history point as live WaveformBase objects ties up several bytes of RAM (and possibly VRAM) per
+	sample, so long captures run out of memory after a few thousand triggers. Instead, Add() serializes each
+	acquisition into one losslessly compressed blob per snapshot:
+	- Analog samples with few distinct values (as with anything that came from an 8 or 16 bit ADC) are stored as
+	  indexes into a table of the values, delta plus varint coded. Other analog samples are XORed with the previous
+	  sample and varint coded.
+	- Digital samples are bit packed.
+	- Sparse timestamps are delta plus varint coded, and durations are stored relative to the gap to the next sample
+	  (so contiguous samples cost one byte).
+
+	Once the blobs in RAM exceed the memory budget, the oldest are moved to a fixed-size memory mapped spill file (if
+	EnableSpill() has been called) or dropped. The spill file is itself a ring: when it fills up, the oldest spilled
+	snapshots are dropped to make room.
+
+	Load() decompresses a snapshot back into freshly allocated waveforms when a history point is selected.
+
+	All methods are thread safe.
+ */
+class WaveformHistory
+{
+public:
+	WaveformHistory(size_t maxSnapshots, size_t memoryBudget);
+	~WaveformHistory();
+
+	WaveformHistory(const WaveformHistory&) = delete;
+	WaveformHistory& operator=(const WaveformHistory&) = delete;
+
+	typedef std::map<StreamDescriptor, WaveformBase*> WaveformMap;
+
+	bool EnableSpill(const std::string& path, size_t maxFileSize);
+
+	uint64_t Add(const WaveformMap& waveforms);
+	bool Load(uint64_t id, WaveformMap& waveforms);
+
+	void Clear();
+	void SetLimits(size_t maxSnapshots, size_t memoryBudget);
+
+	///@brief Returns the number of snapshots currently stored
+	size_t size()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_snapshots.size();
+	}
+
+	bool GetIDRange(uint64_t& oldest, uint64_t& newest);
+	bool GetTimestamp(uint64_t id, time_t& sec, int64_t& fs);
+
+	///@brief Returns the number of bytes of compressed data held in RAM
+	size_t GetMemoryUsage()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_memoryUsage;
+	}
+
+	///@brief Returns the number of bytes of compressed data held in the spill file
+	size_t GetSpillUsage()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_spillUsage;
+	}
+
+	static bool IsSupported(WaveformBase* wfm);
+
+protected:
+
+	/**
+		@brief A single compressed acquisition
+	 */
+	class Snapshot
+	{
+	public:
+		Snapshot()
+		: m_id(0)
+		, m_startTimestamp(0)
+		, m_startFemtoseconds(0)
+		, m_spilled(false)
+		, m_spillOffset(0)
+		, m_spillLength(0)
+		{}
+
+		///@brief Sequence number, assigned by Add()
+		uint64_t m_id;
+
+		///@brief Start time of the acquisition (from the first waveform), integer part
+		time_t m_startTimestamp;
+
+		///@brief Start time of the acquisition, fractional part
+		int64_t m_startFemtoseconds;
+
+		///@brief Streams in the snapshot, in the order they appear in the blob
+		std::vector<StreamDescriptor> m_streams;
+
+		///@brief Compressed waveforms, if held in RAM
+		std::vector<uint8_t> m_data;
+
+		///@brief True if the compressed waveforms are in the spill file rather than m_data
+		bool m_spilled;
+
+		///@brief Position of the compressed waveforms in the spill file
+		size_t m_spillOffset;
+
+		///@brief Size of the compressed waveforms in the spill file
+		size_t m_spillLength;
+	};
+
+	void EnforceLimits();
+	bool Spill(Snapshot& snap);
+	void DropOldest();
+	void CloseSpill();
+
+	static void Compress(WaveformBase* wfm, std::vector<uint8_t>& out);
+	static WaveformBase* Decompress(const uint8_t*& p, const uint8_t* end);
+
+	///@brief Mutex protecting all internal state
+	std::mutex m_mutex;
+
+	///@brief All stored snapshots, oldest first
+	std::deque<Snapshot> m_snapshots;
+
+	///@brief ID of the next snapshot to be added
+	uint64_t m_nextID;
+
+	///@brief Maximum number of snapshots to keep
+	size_t m_maxSnapshots;
+
+	///@brief Maximum number of bytes of compressed data to keep in RAM
+	size_t m_memoryBudget;
+
+	///@brief Number of bytes of compressed data currently in RAM
+	size_t m_memoryUsage;
+
+	///@brief Number of bytes of compressed data currently in the spill file
+	size_t m_spillUsage;
+
+	///@brief Start of the spill file mapping (null if spilling is disabled)
+	uint8_t* m_spillData;
+
+	///@brief Size of the spill file
+	size_t m_spillSize;
+
+	///@brief Position in the spill file at which the next snapshot will be written
+	size_t m_spillWritePos;
+
+	///@brief File descriptor of the spill file
+	int m_spillFd;
+};
+
+#endif
@@ -0,0 +1,333 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of WaveformPool
+	@ingroup datamodel
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+mutex WaveformPool::m_poolsMutex;
+set<WaveformPool*> WaveformPool::m_pools;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+WaveformPool::WaveformPool(size_t maxSize)
+	: m_maxSize(maxSize)
+{
+	lock_guard<mutex> lock(m_poolsMutex);
+	m_pools.emplace(this);
+}
+
+WaveformPool::~WaveformPool()
+{
+	{
+		lock_guard<mutex> lock(m_poolsMutex);
+		m_pools.erase(this);
+	}
+
+	clear();
+
+	for(auto& slot : m_slots)
+	{
+		for(auto& b : slot.m_buckets)
+			delete b.load();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Bucket management
+
+/**
+	@brief Gets the bucket a waveform with the given capacity belongs in, i.e. floor(log2(capacity))
+ */
+size_t WaveformPool::GetBucketForCapacity(size_t capacity)
+{
+	size_t bucket = 0;
+	while( (capacity >> 1) != 0)
+	{
+		capacity >>= 1;
+		bucket ++;
+	}
+	return bucket;
+}
+
+/**
+	@brief Finds the slot for a waveform type
+
+	@param type		Type of waveform
+	@param create	If true, claim an unused slot if the type doesn't have one yet
+
+	@return The slot, or null if there is none (and either create is false or all slots are in use)
+ */
+WaveformPool::TypeSlot* WaveformPool::GetSlot(const type_info& type, bool create)
+{
+	for(auto& slot : m_slots)
+	{
+		auto t = slot.m_type.load(memory_order_acquire);
+		if( (t != nullptr) && (*t == type) )
+			return &slot;
+
+		if( (t == nullptr) && create)
+		{
+			//Someone else might claim the slot first, possibly for the same type
+			const type_info* expected = nullptr;
+			if(slot.m_type.compare_exchange_strong(expected, &type, memory_order_acq_rel) || (*expected == type))
+				return &slot;
+		}
+	}
+
+	return nullptr;
+}
+
+/**
+	@brief Gets a bucket in a slot, optionally creating it
+ */
+WaveformPool::Bucket* WaveformPool::GetBucket(TypeSlot* slot, size_t bucket, bool create)
+{
+	auto b = slot->m_buckets[bucket].load(memory_order_acquire);
+	if( (b != nullptr) || !create)
+		return b;
+
+	//Install a new bucket, unless another thread beats us to it
+	auto nb = new Bucket(m_maxSize);
+	if(slot->m_buckets[bucket].compare_exchange_strong(b, nb, memory_order_acq_rel))
+		return nb;
+	delete nb;
+	return b;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Allocation
+
+/**
+	@brief Adds a new waveform to the pool if there's sufficient free slots in the pool.
+
+	If the pool is already full the waveform is destroyed.
+
+	@param w	The waveform to add
+ */
+void WaveformPool::Add(WaveformBase* w)
+{
+	w->Rename("WaveformPool.freelist");
+
+	auto slot = GetSlot(typeid(*w), true);
+	if(slot)
+	{
+		size_t bucket = min(GetBucketForCapacity(w->capacity()), NUM_BUCKETS - 1);
+		if(GetBucket(slot, bucket, true)->Push(w))
+		{
+			slot->m_lastBucket.store(bucket, memory_order_relaxed);
+			return;
+		}
+	}
+
+	delete w;
+}
+
+/**
+	@brief Attempts to get a waveform from the pool.
+
+	@param type			The concrete type of waveform required
+	@param minCapacity	Number of samples the waveform must be able to hold without reallocating (zero for any)
+
+	@return The waveform, if one is available. Returns nullptr if the pool has no suitable waveform.
+ */
+WaveformBase* WaveformPool::Get(const type_info& type, size_t minCapacity)
+{
+	auto slot = GetSlot(type, false);
+	if(!slot)
+		return nullptr;
+
+	WaveformBase* ret = nullptr;
+
+	//Don't care about size? Try the most recently used size first, then anything (biggest first)
+	if(minCapacity == 0)
+	{
+		auto b = GetBucket(slot, slot->m_lastBucket.load(memory_order_relaxed), false);
+		if( (b == nullptr) || !b->Pop(ret) )
+		{
+			for(size_t i=NUM_BUCKETS; i>0; i--)
+			{
+				b = GetBucket(slot, i-1, false);
+				if(b && b->Pop(ret))
+					break;
+			}
+		}
+	}
+
+	//Everything in bucket ceil(log2(minCapacity)) or higher is big enough, but don't hand out something far larger
+	//than we need
+	else
+	{
+		size_t first = GetBucketForCapacity(minCapacity);
+		if( (1ULL << first) < minCapacity)
+			first ++;
+		size_t last = min(first + MAX_OVERSIZE_BUCKETS, NUM_BUCKETS - 1);
+		for(size_t i=first; i<=last; i++)
+		{
+			auto b = GetBucket(slot, i, false);
+			if(b && b->Pop(ret))
+				break;
+		}
+	}
+
+	if(ret)
+	{
+		ret->m_revision ++;
+		ret->Rename("WaveformPool.allocated");
+	}
+	return ret;
+}
+
+/**
+	@brief Free all waveforms in the pool to reclaim memory
+
+	@return True if memory was freed, false if pool was empty to begin with
+ */
+bool WaveformPool::clear()
+{
+	bool freed = false;
+	for(auto& slot : m_slots)
+	{
+		for(auto& b : slot.m_buckets)
+		{
+			auto bucket = b.load(memory_order_acquire);
+			if(!bucket)
+				continue;
+
+			WaveformBase* w;
+			while(bucket->Pop(w))
+			{
+				delete w;
+				freed = true;
+			}
+		}
+	}
+	return freed;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Memory pressure handling
+
+/**
+	@brief Frees pooled memory in response to memory pressure
+
+	@param level	Hard pressure frees every pooled waveform. Soft pressure on device memory frees the GPU buffers of
+					pooled waveforms but keeps the waveforms; soft pressure on host memory frees the waveforms in the
+					larger half of the occupied buckets of each type.
+	@param type		Type of memory we are short on
+
+	@return True if memory was freed
+ */
+bool WaveformPool::Trim(MemoryPressureLevel level, MemoryPressureType type)
+{
+	if(level == MemoryPressureLevel::Hard)
+		return clear();
+
+	bool freed = false;
+	for(auto& slot : m_slots)
+	{
+		if(type == MemoryPressureType::Device)
+		{
+			for(auto& b : slot.m_buckets)
+			{
+				auto bucket = b.load(memory_order_acquire);
+				if(!bucket)
+					continue;
+
+				//Cycle through everything that's in the bucket now, dropping GPU buffers. Empty the waveform first
+				//since its contents are garbage and there's no sense copying them back to the CPU.
+				size_t count = bucket->size();
+				WaveformBase* w;
+				for(size_t i=0; (i < count) && bucket->Pop(w); i++)
+				{
+					if(w->HasGpuBuffer())
+					{
+						w->clear();
+						w->FreeGpuMemory();
+						freed = true;
+					}
+					if(!bucket->Push(w))
+						delete w;
+				}
+			}
+		}
+
+		else
+		{
+			vector<Bucket*> occupied;
+			for(auto& b : slot.m_buckets)
+			{
+				auto bucket = b.load(memory_order_acquire);
+				if(bucket && (bucket->size() != 0))
+					occupied.push_back(bucket);
+			}
+
+			for(size_t i=occupied.size()/2; i<occupied.size(); i++)
+			{
+				WaveformBase* w;
+				while(occupied[i]->Pop(w))
+				{
+					delete w;
+					freed = true;
+				}
+			}
+		}
+	}
+
+	return freed;
+}
+
+/**
+	@brief Trims every waveform pool in response to memory pressure
+
+	Called from the global OnMemoryPressure() handler.
+
+	@return True if memory was freed
+ */
+bool WaveformPool::OnMemoryPressure(MemoryPressureLevel level, MemoryPressureType type, [[maybe_unused]] size_t requestedSize)
+{
+	lock_guard<mutex> lock(m_poolsMutex);
+
+	bool freed = false;
+	for(auto p : m_pools)
+	{
+		if(p->Trim(level, type))
+			freed = true;
+	}
+	return freed;
+}
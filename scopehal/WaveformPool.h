@@ -36,12 +36,23 @@
 #ifndef WaveformPool_h
 #define WaveformPool_h
 
+#include <typeinfo>
+#include "BoundedMPMCQueue.h"
+
 /**
 	@brief Thread safe memory pool for reusing Waveform objects
 	@ingroup datamodel
 
 	Allocating and freeing GPU memory can be an expensive operation so it's usually preferable to recycle existing
 	Waveform objects if possible.
+
+	Free waveforms are binned by concrete type and by capacity, in power-of-two buckets: bucket N holds waveforms
+	with room for at least 2^N (and less than 2^(N+1)) samples. Get() only returns a waveform which already has room
+	for the requested number of samples, so reusing it does not cause a reallocation. Each bucket is a lock-free
+	queue, so Add() and Get() never block.
+
+	Pooled waveforms keep their CPU and GPU buffers. In response to memory pressure (see OnMemoryPressure()), pools
+	first drop GPU buffers or their largest waveforms, then everything.
  */
 class WaveformPool
 {
@@ -50,86 +61,90 @@ public:
 	/**
 		@brief Creates a waveform pool
 
-		@param maxSize	Maximum number of waveforms to store in the pool
+		@param maxSize	Maximum number of waveforms of each type to store in each capacity bucket
 	 */
-	WaveformPool(size_t maxSize = 16)
-	: m_maxSize(maxSize)
-	{}
+	WaveformPool(size_t maxSize = 16);
+	~WaveformPool();
 
-	~WaveformPool()
-	{
-		for(auto w : m_waveforms)
-			delete w;
-		m_waveforms.clear();
-	}
+	//non-copyable
+	WaveformPool(const WaveformPool&) = delete;
+	WaveformPool& operator=(const WaveformPool&) = delete;
+
+	void Add(WaveformBase* w);
 
 	/**
-		@brief Adds a new waveform to the pool if there's sufficient free slots in the pool.
+		@brief Attempts to get a waveform of a specific type from the pool.
 
-		If the pool is already full the waveform is destroyed.
+		@param minCapacity	Number of samples the waveform must be able to hold without reallocating. If zero, any
+							waveform of the requested type may be returned, preferring the size most recently added.
 
-		@param w	The waveform to add
+		@return The waveform, if one is available. Returns nullptr if the pool has no suitable waveform.
 	 */
-	void Add(WaveformBase* w)
-	{
-		std::lock_guard<std::mutex> lock(m_mutex);
-		w->Rename("WaveformPool.freelist");
+	template<class T>
+	T* Get(size_t minCapacity = 0)
+	{ return static_cast<T*>(Get(typeid(T), minCapacity)); }
 
-		if(m_waveforms.size() < m_maxSize)
-			m_waveforms.push_back(w);
-		else
-			delete w;
-	}
+	bool clear();
+	bool Trim(MemoryPressureLevel level, MemoryPressureType type);
 
-	/**
-		@brief Attempts to get a waveform from the pool.
+	static bool OnMemoryPressure(MemoryPressureLevel level, MemoryPressureType type, size_t requestedSize);
 
-		@return The waveform, if one is available. Returns nullptr if the pool is empty.
-	 */
-	WaveformBase* Get()
-	{
-		std::lock_guard<std::mutex> lock(m_mutex);
+protected:
+	WaveformBase* Get(const std::type_info& type, size_t minCapacity);
+
+	static size_t GetBucketForCapacity(size_t capacity);
+
+	///@brief Number of capacity buckets (enough for any 64-bit size)
+	static constexpr size_t NUM_BUCKETS = 64;
 
-		if(m_waveforms.empty())
-			return nullptr;
+	///@brief Maximum number of distinct waveform types in one pool
+	static constexpr size_t MAX_TYPES = 4;
 
-		auto ret = *m_waveforms.begin();
-		ret->m_revision ++;
-		m_waveforms.pop_front();
+	///@brief Number of buckets above the smallest suitable one that Get() will look in
+	static constexpr size_t MAX_OVERSIZE_BUCKETS = 2;
 
-		ret->Rename("WaveformPool.allocated");
-		return ret;
-	}
+	typedef BoundedMPMCQueue<WaveformBase*> Bucket;
 
 	/**
-		@brief Free all waveforms in the pool to reclaim memory
+		@brief Buckets for a single waveform type
 
-		@return True if memory was freed, false if pool was empty to begin with
+		Buckets are created on first use and never destroyed until the pool is.
 	 */
-	bool clear()
+	class TypeSlot
 	{
-		std::lock_guard<std::mutex> lock(m_mutex);
-
-		if(m_waveforms.empty())
-			return false;
-
-		for(auto w : m_waveforms)
-			delete w;
-		m_waveforms.clear();
-
-		return true;
-	}
+	public:
+		TypeSlot()
+		: m_type(nullptr)
+		, m_lastBucket(0)
+		{
+			for(auto& b : m_buckets)
+				b = nullptr;
+		}
+
+		///@brief The type of waveform stored in this slot (null if the slot is unused)
+		std::atomic<const std::type_info*> m_type;
+
+		///@brief Bucket to try first when the caller doesn't care about capacity
+		std::atomic<size_t> m_lastBucket;
+
+		///@brief Free waveforms, by capacity
+		std::atomic<Bucket*> m_buckets[NUM_BUCKETS];
+	};
+
+	///@brief Maximum number of waveforms to store in each bucket
+	size_t m_maxSize;
 
-protected:
+	///@brief Free waveforms of each type
+	TypeSlot m_slots[MAX_TYPES];
 
-	///@brief Maximum number of waveforms to store in the pool
-	size_t m_maxSize;
+	TypeSlot* GetSlot(const std::type_info& type, bool create);
+	Bucket* GetBucket(TypeSlot* slot, size_t bucket, bool create);
 
-	///@brief Mutex for synchronizing access to m_waveforms across threads
-	std::mutex m_mutex;
+	///@brief Mutex for synchronizing access to m_pools
+	static std::mutex m_poolsMutex;
 
-	///@brief The list of free waveforms
-	std::list<WaveformBase*> m_waveforms;
+	///@brief All pools which currently exist, for memory pressure handling
+	static std::set<WaveformPool*> m_pools;
 };
 
 #endif
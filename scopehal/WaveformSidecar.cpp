@@ -0,0 +1,653 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Implementation of WaveformSidecarWriter and WaveformSidecarReader
+	@ingroup datamodel
+ */
+
+#include "scopehal.h"
+#include "WaveformSidecar.h"
+#include <filesystem>
+
+using namespace std;
+
+const char WaveformSidecarWriter::DATA_MAGIC[8] = {'S', 'C', 'O', 'P', 'E', 'W', 'F', 'M'};
+
+///@brief Size of the data file header (magic and generation)
+static const size_t DATA_HEADER_SIZE = 16;
+
+///@brief Rounds a file offset up to the array alignment
+static uint64_t AlignUp(uint64_t n)
+{
+	return (n + WaveformSidecarWriter::ALIGNMENT - 1) & ~(WaveformSidecarWriter::ALIGNMENT - 1);
+}
+
+///@brief Gets the name a waveform type is stored under in the manifest
+static const char* GetTypeName(SharedWaveformBuffer::WaveformType type)
+{
+	switch(type)
+	{
+		case SharedWaveformBuffer::TYPE_UNIFORM_ANALOG:
+			return "uniform_analog";
+		case SharedWaveformBuffer::TYPE_SPARSE_ANALOG:
+			return "sparse_analog";
+		case SharedWaveformBuffer::TYPE_UNIFORM_DIGITAL:
+			return "uniform_digital";
+		case SharedWaveformBuffer::TYPE_SPARSE_DIGITAL:
+			return "sparse_digital";
+		default:
+			return "none";
+	}
+}
+
+///@brief Inverse of GetTypeName()
+static SharedWaveformBuffer::WaveformType ParseTypeName(const string& name)
+{
+	if(name == "uniform_analog")
+		return SharedWaveformBuffer::TYPE_UNIFORM_ANALOG;
+	if(name == "sparse_analog")
+		return SharedWaveformBuffer::TYPE_SPARSE_ANALOG;
+	if(name == "uniform_digital")
+		return SharedWaveformBuffer::TYPE_UNIFORM_DIGITAL;
+	if(name == "sparse_digital")
+		return SharedWaveformBuffer::TYPE_SPARSE_DIGITAL;
+	return SharedWaveformBuffer::TYPE_NONE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+WaveformSidecarWriter::WaveformSidecarWriter()
+	: m_busy(false)
+	, m_ok(true)
+	, m_generation(0)
+{
+}
+
+WaveformSidecarWriter::~WaveformSidecarWriter()
+{
+	Wait();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Saving
+
+/**
+	@brief Gets the path of the manifest for a data file
+ */
+string WaveformSidecarWriter::GetManifestPath(const string& path)
+{
+	return path + ".yml";
+}
+
+/**
+	@brief Snapshots a set of waveforms and starts writing them out in the background
+
+	If an earlier save is still being written, waits for it first (callers which would rather skip an autosave than
+	block can check IsBusy()). The caller must make sure nothing modifies the waveforms during the call, but is free
+	to do so as soon as it returns.
+
+	@param path			Path of the data file. The manifest is written next to it (see GetManifestPath()).
+	@param waveforms	Waveforms to save, by the key they will be loaded back under. Null waveforms, and types which
+						can't be saved, are skipped.
+
+	@return Result of the previous save
+ */
+bool WaveformSidecarWriter::Save(const string& path, const WaveformMap& waveforms)
+{
+	bool ret = Wait();
+
+	m_path = path;
+	m_generation = chrono::duration_cast<chrono::nanoseconds>(
+		chrono::system_clock::now().time_since_epoch()).count();
+	bool canReuse = (path == m_savedPath);
+
+	uint64_t offset = ALIGNMENT;
+	for(auto& it : waveforms)
+	{
+		auto wfm = it.second;
+		auto type = SharedWaveformBuffer::GetType(wfm);
+		if(type == SharedWaveformBuffer::TYPE_NONE)
+		{
+			if(wfm)
+				LogWarning("WaveformSidecarWriter: %s can't be saved\n", typeid(*wfm).name());
+			continue;
+		}
+
+		PendingWaveform p;
+		auto& e = p.m_entry;
+		e.m_key = it.first;
+		e.m_type = type;
+		e.m_flags = wfm->m_flags;
+		e.m_count = wfm->size();
+		e.m_timescale = wfm->m_timescale;
+		e.m_startTimestamp = wfm->m_startTimestamp;
+		e.m_startFemtoseconds = wfm->m_startFemtoseconds;
+		e.m_triggerPhase = wfm->m_triggerPhase;
+
+		//Lay out the arrays
+		e.m_samplesOffset = offset;
+		offset = AlignUp(offset + e.m_count * e.GetSampleSize());
+		if(e.IsSparse())
+		{
+			e.m_offsetsOffset = offset;
+			offset = AlignUp(offset + e.m_count * sizeof(int64_t));
+			e.m_durationsOffset = offset;
+			offset = AlignUp(offset + e.m_count * sizeof(int64_t));
+		}
+
+		//If it hasn't changed since the last save, copy it out of the old file rather than snapshotting it
+		auto jt = m_saved.find(it.first);
+		if( canReuse && (jt != m_saved.end()) && (jt->second.m_waveform == wfm) &&
+			(jt->second.m_revision == wfm->m_revision) && (jt->second.m_entry.m_count == e.m_count) )
+		{
+			p.m_fromPrevious = true;
+			p.m_previous = jt->second.m_entry;
+		}
+		else
+			Snapshot(wfm, p);
+
+		m_saving[it.first] = SavedRevision{wfm, wfm->m_revision, e};
+		m_pending.push_back(std::move(p));
+	}
+
+	m_busy = true;
+	m_thread = thread([this]()
+		{
+			m_ok = Write();
+			m_busy = false;
+		});
+
+	return ret;
+}
+
+/**
+	@brief Copies the sample data of a waveform into a pending save
+ */
+void WaveformSidecarWriter::Snapshot(WaveformBase* wfm, PendingWaveform& p)
+{
+	auto& e = p.m_entry;
+	wfm->PrepareForCpuAccess();
+
+	p.m_samples.resize(e.m_count * e.GetSampleSize());
+	const void* samples = nullptr;
+	switch(e.m_type)
+	{
+		case SharedWaveformBuffer::TYPE_UNIFORM_ANALOG:
+			samples = static_cast<UniformAnalogWaveform*>(wfm)->m_samples.GetCpuPointer();
+			break;
+		case SharedWaveformBuffer::TYPE_SPARSE_ANALOG:
+			samples = static_cast<SparseAnalogWaveform*>(wfm)->m_samples.GetCpuPointer();
+			break;
+		case SharedWaveformBuffer::TYPE_UNIFORM_DIGITAL:
+			samples = static_cast<UniformDigitalWaveform*>(wfm)->m_samples.GetCpuPointer();
+			break;
+		case SharedWaveformBuffer::TYPE_SPARSE_DIGITAL:
+			samples = static_cast<SparseDigitalWaveform*>(wfm)->m_samples.GetCpuPointer();
+			break;
+		default:
+			break;
+	}
+	if(samples && !p.m_samples.empty())
+		memcpy(p.m_samples.data(), samples, p.m_samples.size());
+
+	if(!e.IsSparse())
+		return;
+
+	//Don't expand compressed timestamps in place, the caller's waveform may be deliberately kept compact
+	auto swfm = dynamic_cast<SparseWaveformBase*>(wfm);
+	p.m_offsets.resize(e.m_count);
+	p.m_durations.resize(e.m_count);
+	if(swfm->m_timeline)
+	{
+		for(size_t i=0; i<e.m_count; i++)
+		{
+			p.m_offsets[i] = swfm->m_timeline->GetOffset(i);
+			p.m_durations[i] = swfm->m_timeline->GetDuration(i);
+		}
+	}
+	else if(e.m_count)
+	{
+		memcpy(p.m_offsets.data(), swfm->m_offsets.GetCpuPointer(), e.m_count * sizeof(int64_t));
+		memcpy(p.m_durations.data(), swfm->m_durations.GetCpuPointer(), e.m_count * sizeof(int64_t));
+	}
+}
+
+/**
+	@brief Waits for the save in progress (if any) to finish
+
+	@return True if the most recent save was written successfully
+ */
+bool WaveformSidecarWriter::Wait()
+{
+	if(!m_thread.joinable())
+		return m_ok;
+
+	m_thread.join();
+	m_pending.clear();
+
+	//Remember what's in the file, so the next save can skip anything which is unchanged
+	if(m_ok)
+	{
+		m_savedPath = m_path;
+		m_saved = std::move(m_saving);
+	}
+	else
+	{
+		m_savedPath.clear();
+		m_saved.clear();
+	}
+	m_saving.clear();
+	return m_ok;
+}
+
+/**
+	@brief Writes the data file and manifest (runs on m_thread)
+ */
+bool WaveformSidecarWriter::Write()
+{
+	auto tmpPath = m_path + ".tmp";
+	auto manifestPath = GetManifestPath(m_path);
+	auto tmpManifestPath = manifestPath + ".tmp";
+
+	//Write the header, then fill in the arrays in parallel
+	FILE* fp = fopen(tmpPath.c_str(), "wb");
+	if(!fp)
+	{
+		LogError("WaveformSidecarWriter: couldn't create %s\n", tmpPath.c_str());
+		return false;
+	}
+	bool ok = (1 == fwrite(DATA_MAGIC, sizeof(DATA_MAGIC), 1, fp));
+	ok &= (1 == fwrite(&m_generation, sizeof(m_generation), 1, fp));
+	if(0 != fclose(fp))
+		ok = false;
+
+	//Unchanged waveforms come out of the previous data file
+	MappedFile prev;
+	bool needPrev = false;
+	for(auto& p : m_pending)
+		needPrev |= p.m_fromPrevious;
+	if(needPrev && !prev.Open(m_path))
+	{
+		LogError("WaveformSidecarWriter: couldn't reopen previous data file %s\n", m_path.c_str());
+		ok = false;
+	}
+
+	atomic<bool> writeOK(ok);
+	if(ok)
+	{
+		ThreadPool::Get().ParallelFor(0, m_pending.size(), 1, [&](size_t begin, size_t end)
+			{
+				FILE* f = fopen(tmpPath.c_str(), "r+b");
+				if(!f)
+				{
+					writeOK = false;
+					return;
+				}
+
+				for(size_t i=begin; i<end; i++)
+				{
+					auto& p = m_pending[i];
+					auto& e = p.m_entry;
+					size_t sampleBytes = e.m_count * e.GetSampleSize();
+					size_t timestampBytes = e.m_count * sizeof(int64_t);
+					bool wok;
+					if(p.m_fromPrevious)
+					{
+						auto& pe = p.m_previous;
+						wok = CopyFromPrevious(f, prev, pe.m_samplesOffset, e.m_samplesOffset, sampleBytes);
+						if(e.IsSparse())
+						{
+							wok &= CopyFromPrevious(f, prev, pe.m_offsetsOffset, e.m_offsetsOffset, timestampBytes);
+							wok &= CopyFromPrevious(
+								f, prev, pe.m_durationsOffset, e.m_durationsOffset, timestampBytes);
+						}
+					}
+					else
+					{
+						wok = WriteAt(f, e.m_samplesOffset, p.m_samples.data(), sampleBytes);
+						if(e.IsSparse())
+						{
+							wok &= WriteAt(f, e.m_offsetsOffset, p.m_offsets.data(), timestampBytes);
+							wok &= WriteAt(f, e.m_durationsOffset, p.m_durations.data(), timestampBytes);
+						}
+
+						//Free the snapshot as soon as it's been written
+						p.m_samples = {};
+						p.m_offsets = {};
+						p.m_durations = {};
+					}
+
+					if(!wok)
+						writeOK = false;
+				}
+
+				if(0 != fclose(f))
+					writeOK = false;
+			});
+	}
+	ok = writeOK;
+	prev.Close();
+
+	if(ok)
+		ok = WriteManifest(tmpManifestPath);
+
+	//Swap the new files in, manifest last
+	error_code ec;
+	if(ok)
+		filesystem::rename(tmpPath, m_path, ec);
+	if(ok && !ec)
+		filesystem::rename(tmpManifestPath, manifestPath, ec);
+	if(!ok || ec)
+	{
+		LogError("WaveformSidecarWriter: failed to save %s\n", m_path.c_str());
+		filesystem::remove(tmpPath, ec);
+		filesystem::remove(tmpManifestPath, ec);
+		return false;
+	}
+
+	LogTrace("WaveformSidecarWriter: saved %zu waveforms to %s\n", m_pending.size(), m_path.c_str());
+	return true;
+}
+
+/**
+	@brief Writes the manifest describing the data file being written
+ */
+bool WaveformSidecarWriter::WriteManifest(const string& path)
+{
+	YAML::Node root;
+	root["version"] = 1;
+	root["generation"] = m_generation;
+	for(auto& p : m_pending)
+	{
+		auto& e = p.m_entry;
+
+		YAML::Node node;
+		node["key"] = e.m_key;
+		node["type"] = GetTypeName(e.m_type);
+		node["flags"] = static_cast<int>(e.m_flags);
+		node["count"] = e.m_count;
+		node["timescale"] = e.m_timescale;
+		node["startTimestamp"] = e.m_startTimestamp;
+		node["startFemtoseconds"] = e.m_startFemtoseconds;
+		node["triggerPhase"] = e.m_triggerPhase;
+		node["samples"] = e.m_samplesOffset;
+		if(e.IsSparse())
+		{
+			node["offsets"] = e.m_offsetsOffset;
+			node["durations"] = e.m_durationsOffset;
+		}
+		root["waveforms"].push_back(node);
+	}
+
+	FILE* fp = fopen(path.c_str(), "w");
+	if(!fp)
+	{
+		LogError("WaveformSidecarWriter: couldn't create %s\n", path.c_str());
+		return false;
+	}
+
+	YAML::Emitter out;
+	out << root;
+	fwrite(out.c_str(), 1, out.size(), fp);
+	fputs("\n", fp);
+
+	bool ok = !ferror(fp);
+	if(0 != fclose(fp))
+		ok = false;
+	return ok;
+}
+
+/**
+	@brief Writes a block of data at an absolute position in a file
+ */
+bool WaveformSidecarWriter::WriteAt(FILE* fp, uint64_t offset, const void* data, size_t len)
+{
+	if(len == 0)
+		return true;
+
+#ifdef _WIN32
+	if(0 != _fseeki64(fp, offset, SEEK_SET))
+#else
+	if(0 != fseeko(fp, offset, SEEK_SET))
+#endif
+		return false;
+
+	return (len == fwrite(data, 1, len, fp));
+}
+
+/**
+	@brief Copies one array from the previous data file into the new one
+ */
+bool WaveformSidecarWriter::CopyFromPrevious(
+	FILE* fp,
+	const MappedFile& prev,
+	uint64_t prevOffset,
+	uint64_t offset,
+	size_t len)
+{
+	if(len == 0)
+		return true;
+
+	auto p = prev.GetPointer(prevOffset, len);
+	if(!p)
+		return false;
+	return WriteAt(fp, offset, p, len);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Loading
+
+/**
+	@brief Opens a sidecar, reading the manifest but none of the sample data
+
+	@param path	Path of the data file, as passed to WaveformSidecarWriter::Save()
+
+	@return False if either file is missing or malformed, or they don't come from the same save
+ */
+bool WaveformSidecarReader::Open(const string& path)
+{
+	Close();
+
+	uint64_t generation = 0;
+	auto manifestPath = WaveformSidecarWriter::GetManifestPath(path);
+	try
+	{
+		auto root = YAML::LoadFile(manifestPath);
+		generation = root["generation"].as<uint64_t>();
+		for(auto node : root["waveforms"])
+		{
+			WaveformSidecarEntry e;
+			e.m_key = node["key"].as<string>();
+			e.m_type = ParseTypeName(node["type"].as<string>());
+			e.m_flags = node["flags"].as<int>();
+			e.m_count = node["count"].as<uint64_t>();
+			e.m_timescale = node["timescale"].as<int64_t>();
+			e.m_startTimestamp = node["startTimestamp"].as<int64_t>();
+			e.m_startFemtoseconds = node["startFemtoseconds"].as<int64_t>();
+			e.m_triggerPhase = node["triggerPhase"].as<int64_t>();
+			e.m_samplesOffset = node["samples"].as<uint64_t>();
+			if(e.IsSparse())
+			{
+				e.m_offsetsOffset = node["offsets"].as<uint64_t>();
+				e.m_durationsOffset = node["durations"].as<uint64_t>();
+			}
+			if(e.m_type == SharedWaveformBuffer::TYPE_NONE)
+				LogWarning("WaveformSidecarReader: waveform %s has an unknown type\n", e.m_key.c_str());
+			else
+				m_entries[e.m_key] = e;
+		}
+	}
+	catch(const YAML::Exception& ex)
+	{
+		LogError("WaveformSidecarReader: couldn't load manifest %s: %s\n", manifestPath.c_str(), ex.what());
+		m_entries.clear();
+		return false;
+	}
+
+	if(!m_file.Open(path))
+	{
+		LogError("WaveformSidecarReader: couldn't open %s\n", path.c_str());
+		m_entries.clear();
+		return false;
+	}
+
+	//Make sure the data file is the one the manifest describes
+	auto header = m_file.GetPointer(0, DATA_HEADER_SIZE);
+	uint64_t fileGeneration = 0;
+	if(header)
+		memcpy(&fileGeneration, header + sizeof(WaveformSidecarWriter::DATA_MAGIC), sizeof(fileGeneration));
+	if( !header ||
+		(0 != memcmp(header, WaveformSidecarWriter::DATA_MAGIC, sizeof(WaveformSidecarWriter::DATA_MAGIC))) ||
+		(fileGeneration != generation) )
+	{
+		LogError("WaveformSidecarReader: %s doesn't match its manifest\n", path.c_str());
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+/**
+	@brief Unmaps the data file and forgets the manifest
+ */
+void WaveformSidecarReader::Close()
+{
+	m_file.Close();
+	m_entries.clear();
+}
+
+/**
+	@brief Loads one waveform out of the data file
+
+	@param key	Key the waveform was saved under
+
+	@return The new waveform (owned by the caller), or null if there is no such waveform or the file is truncated
+ */
+WaveformBase* WaveformSidecarReader::Load(const string& key)
+{
+	auto it = m_entries.find(key);
+	if(it == m_entries.end())
+		return nullptr;
+	auto& e = it->second;
+
+	size_t sampleBytes = e.m_count * e.GetSampleSize();
+	size_t timestampBytes = e.m_count * sizeof(int64_t);
+	auto samples = m_file.GetPointer(e.m_samplesOffset, sampleBytes);
+	const uint8_t* offsets = nullptr;
+	const uint8_t* durations = nullptr;
+	if(e.IsSparse())
+	{
+		offsets = m_file.GetPointer(e.m_offsetsOffset, timestampBytes);
+		durations = m_file.GetPointer(e.m_durationsOffset, timestampBytes);
+	}
+	if(!samples || (e.IsSparse() && (!offsets || !durations)) )
+	{
+		LogError("WaveformSidecarReader: waveform %s extends past the end of the file\n", key.c_str());
+		return nullptr;
+	}
+
+	WaveformBase* wfm = nullptr;
+	void* psamples = nullptr;
+	switch(e.m_type)
+	{
+		case SharedWaveformBuffer::TYPE_UNIFORM_ANALOG:
+			{
+				auto w = new UniformAnalogWaveform;
+				w->Resize(e.m_count);
+				w->PrepareForCpuAccess();
+				psamples = w->m_samples.GetCpuPointer();
+				wfm = w;
+			}
+			break;
+
+		case SharedWaveformBuffer::TYPE_SPARSE_ANALOG:
+			{
+				auto w = new SparseAnalogWaveform;
+				w->Resize(e.m_count);
+				w->PrepareForCpuAccess();
+				psamples = w->m_samples.GetCpuPointer();
+				wfm = w;
+			}
+			break;
+
+		case SharedWaveformBuffer::TYPE_UNIFORM_DIGITAL:
+			{
+				auto w = new UniformDigitalWaveform;
+				w->Resize(e.m_count);
+				w->PrepareForCpuAccess();
+				psamples = w->m_samples.GetCpuPointer();
+				wfm = w;
+			}
+			break;
+
+		case SharedWaveformBuffer::TYPE_SPARSE_DIGITAL:
+			{
+				auto w = new SparseDigitalWaveform;
+				w->Resize(e.m_count);
+				w->PrepareForCpuAccess();
+				psamples = w->m_samples.GetCpuPointer();
+				wfm = w;
+			}
+			break;
+
+		default:
+			return nullptr;
+	}
+
+	wfm->m_flags = e.m_flags;
+	wfm->m_timescale = e.m_timescale;
+	wfm->m_startTimestamp = e.m_startTimestamp;
+	wfm->m_startFemtoseconds = e.m_startFemtoseconds;
+	wfm->m_triggerPhase = e.m_triggerPhase;
+
+	if(sampleBytes)
+		memcpy(psamples, samples, sampleBytes);
+	if(e.IsSparse() && timestampBytes)
+	{
+		auto swfm = dynamic_cast<SparseWaveformBase*>(wfm);
+		memcpy(swfm->m_offsets.GetCpuPointer(), offsets, timestampBytes);
+		memcpy(swfm->m_durations.GetCpuPointer(), durations, timestampBytes);
+	}
+	wfm->MarkModifiedFromCpu();
+
+	//We won't touch these pages again
+	m_file.Release(e.m_samplesOffset, sampleBytes);
+	if(e.IsSparse())
+	{
+		m_file.Release(e.m_offsetsOffset, timestampBytes);
+		m_file.Release(e.m_durationsOffset, timestampBytes);
+	}
+
+	return wfm;
+}
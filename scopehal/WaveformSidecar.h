@@ -0,0 +1,265 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg                                                                          *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of WaveformSidecarWriter and WaveformSidecarReader
+	@ingroup datamodel
+ */
+
+#ifndef WaveformSidecar_h
+#define WaveformSidecar_h
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "SharedWaveformBuffer.h"
+
+/**
+	@brief Metadata and file layout of one waveform in a sidecar file
+	@ingroup datamodel
+ */
+class WaveformSidecarEntry
+{
+public:
+	WaveformSidecarEntry()
+	: m_type(SharedWaveformBuffer::TYPE_NONE)
+	, m_flags(0)
+	, m_count(0)
+	, m_timescale(0)
+	, m_startTimestamp(0)
+	, m_startFemtoseconds(0)
+	, m_triggerPhase(0)
+	, m_samplesOffset(0)
+	, m_offsetsOffset(0)
+	, m_durationsOffset(0)
+	{}
+
+	///@brief Name the waveform was saved under
+	std::string m_key;
+
+	///@brief Kind of waveform
+	SharedWaveformBuffer::WaveformType m_type;
+
+	//Waveform metadata
+	uint8_t m_flags;
+	uint64_t m_count;
+	int64_t m_timescale;
+	int64_t m_startTimestamp;
+	int64_t m_startFemtoseconds;
+	int64_t m_triggerPhase;
+
+	///@brief Byte offset of the samples within the data file
+	uint64_t m_samplesOffset;
+
+	///@brief Byte offset of the sample offsets within the data file (sparse waveforms only)
+	uint64_t m_offsetsOffset;
+
+	///@brief Byte offset of the sample durations within the data file (sparse waveforms only)
+	uint64_t m_durationsOffset;
+
+	///@brief Returns true if the waveform has offsets and durations
+	bool IsSparse() const
+	{
+		return (m_type == SharedWaveformBuffer::TYPE_SPARSE_ANALOG) ||
+			(m_type == SharedWaveformBuffer::TYPE_SPARSE_DIGITAL);
+	}
+
+	///@brief Returns the size of one sample, in bytes
+	size_t GetSampleSize() const
+	{
+		if( (m_type == SharedWaveformBuffer::TYPE_UNIFORM_ANALOG) ||
+			(m_type == SharedWaveformBuffer::TYPE_SPARSE_ANALOG) )
+		{
+			return sizeof(float);
+		}
+		return sizeof(bool);
+	}
+};
+
+/**
+	@brief Saves waveforms to a raw binary sidecar file and YAML manifest, in the background
+	@ingroup datamodel
+
+	Intended for the waveforms a saved session persists (see InstrumentChannel::ShouldPersistWaveform()). Encoding
+	sample data into the session file itself is slow for deep waveforms and has to finish before acquisition can
+	resume. Instead, Save() only copies the sample arrays out of each waveform (a memcpy, much faster than any disk)
+	and returns, and a background thread writes them out, several waveforms at a time on the ThreadPool.
+
+	The data file is a header (DATA_MAGIC and a generation number) followed by each sample array, uncompressed and
+	aligned to ALIGNMENT bytes, so WaveformSidecarReader can load any one waveform straight out of a mapping without
+	touching the others. The manifest (path + ".yml") lists each waveform's metadata and where its arrays are. Both
+	files are written under temporary names and renamed into place when complete, manifest last, and the reader
+	rejects a manifest whose generation doesn't match the data file, so an interrupted save never leaves a session
+	pointing at half-written data.
+
+	Waveforms whose pointer and revision haven't changed since the last successful save to the same path aren't
+	copied at all: the background thread copies their arrays out of the previous data file instead. Periodic
+	autosaves during acquisition therefore only snapshot what actually changed.
+ */
+class WaveformSidecarWriter
+{
+public:
+	WaveformSidecarWriter();
+	~WaveformSidecarWriter();
+
+	WaveformSidecarWriter(const WaveformSidecarWriter&) = delete;
+	WaveformSidecarWriter& operator=(const WaveformSidecarWriter&) = delete;
+
+	typedef std::map<std::string, WaveformBase*> WaveformMap;
+
+	bool Save(const std::string& path, const WaveformMap& waveforms);
+	bool Wait();
+
+	///@brief Returns true if a save is still being written out
+	bool IsBusy()
+	{ return m_busy; }
+
+	static std::string GetManifestPath(const std::string& path);
+
+	///@brief Alignment of every array within the data file
+	static const uint64_t ALIGNMENT = 4096;
+
+	///@brief Magic number at the start of every data file
+	static const char DATA_MAGIC[8];
+
+protected:
+	/**
+		@brief One waveform being saved
+	 */
+	class PendingWaveform
+	{
+	public:
+		PendingWaveform()
+		: m_fromPrevious(false)
+		{}
+
+		///@brief Metadata, with the offsets it will be written at
+		WaveformSidecarEntry m_entry;
+
+		///@brief True to copy the arrays out of the previous data file rather than the vectors below
+		bool m_fromPrevious;
+
+		///@brief Metadata of the waveform in the previous data file, if m_fromPrevious is set
+		WaveformSidecarEntry m_previous;
+
+		///@brief Snapshot of the samples
+		std::vector<uint8_t> m_samples;
+
+		///@brief Snapshot of the offsets (sparse waveforms only)
+		std::vector<int64_t> m_offsets;
+
+		///@brief Snapshot of the durations (sparse waveforms only)
+		std::vector<int64_t> m_durations;
+	};
+
+	///@brief Identity of a waveform at the time it was saved
+	class SavedRevision
+	{
+	public:
+		///@brief The waveform object
+		WaveformBase* m_waveform;
+
+		///@brief Its revision
+		uint64_t m_revision;
+
+		///@brief Where it was written
+		WaveformSidecarEntry m_entry;
+	};
+
+	bool Write();
+	bool WriteManifest(const std::string& path);
+
+	static void Snapshot(WaveformBase* wfm, PendingWaveform& p);
+	static bool WriteAt(FILE* fp, uint64_t offset, const void* data, size_t len);
+	static bool CopyFromPrevious(FILE* fp, const MappedFile& prev, uint64_t prevOffset, uint64_t offset, size_t len);
+
+	///@brief Thread running Write()
+	std::thread m_thread;
+
+	///@brief True from Save() until the background write completes
+	std::atomic<bool> m_busy;
+
+	///@brief Result of the last background write
+	bool m_ok;
+
+	///@brief Path of the data file being written
+	std::string m_path;
+
+	///@brief Generation number of the data file being written
+	uint64_t m_generation;
+
+	///@brief Waveforms being written
+	std::vector<PendingWaveform> m_pending;
+
+	///@brief Path of the last successful save
+	std::string m_savedPath;
+
+	///@brief Identity of every waveform in the last successful save, by key
+	std::map<std::string, SavedRevision> m_saved;
+
+	///@brief Identity of every waveform in the save in progress, by key
+	std::map<std::string, SavedRevision> m_saving;
+};
+
+/**
+	@brief Loads waveforms saved by WaveformSidecarWriter, one at a time, on demand
+	@ingroup datamodel
+
+	Open() only parses the manifest and maps the data file. Each waveform's arrays are copied out of the mapping by
+	Load() when (and if) it's asked for, so opening a session with many deep waveforms is fast, and pages of
+	waveforms which are never looked at are never read from disk.
+ */
+class WaveformSidecarReader
+{
+public:
+	bool Open(const std::string& path);
+	void Close();
+
+	///@brief Returns true if a sidecar is open
+	bool IsOpen() const
+	{ return m_file.IsOpen(); }
+
+	///@brief Gets the metadata of every waveform in the file, by key
+	const std::map<std::string, WaveformSidecarEntry>& GetEntries() const
+	{ return m_entries; }
+
+	WaveformBase* Load(const std::string& key);
+
+protected:
+	///@brief Mapping of the data file
+	MappedFile m_file;
+
+	///@brief Metadata of every waveform in the file, by key
+	std::map<std::string, WaveformSidecarEntry> m_entries;
+};
+
+#endif
@@ -0,0 +1,183 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of WorkStealingDeque
+	@ingroup core
+ */
+
+#ifndef WorkStealingDeque_h
+#define WorkStealingDeque_h
+
+#include <atomic>
+#include <memory>
+
+/**
+	@brief Fixed-capacity lock-free Chase-Lev work stealing deque
+	@ingroup core
+
+	One thread (the owner) may call Push() and Pop() on the bottom of the deque, while any number of other threads
+	may concurrently call Steal() on the top.
+
+	The deque does not grow. The caller is responsible for calling Reset() with a large enough capacity for the
+	maximum number of items that will ever be present in the deque at once, at a time when no other thread is
+	accessing it. Indexes wrap around the ring buffer, so any number of items may be pushed over the lifetime of
+	the deque.
+ */
+template<class T>
+class WorkStealingDeque
+{
+public:
+	WorkStealingDeque()
+		: m_capacity(0)
+		, m_mask(0)
+		, m_top(0)
+		, m_bottom(0)
+	{}
+
+	//non-copyable
+	WorkStealingDeque(const WorkStealingDeque&) = delete;
+	WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+	/**
+		@brief Empties the deque and ensures it can hold at least the requested number of items
+
+		Not thread safe, must only be called while the deque is quiescent.
+
+		@param capacity		Maximum number of items which will be in the deque at any one time
+	 */
+	void Reset(size_t capacity)
+	{
+		if(capacity > m_capacity)
+		{
+			size_t cap = 1;
+			while(cap < capacity)
+				cap <<= 1;
+
+			m_buffer = std::make_unique<std::atomic<T>[]>(cap);
+			m_capacity = cap;
+			m_mask = cap - 1;
+		}
+
+		m_top.store(0, std::memory_order_relaxed);
+		m_bottom.store(0, std::memory_order_relaxed);
+	}
+
+	/**
+		@brief Adds an item to the bottom of the deque (owner thread only)
+	 */
+	void Push(T item)
+	{
+		int64_t b = m_bottom.load(std::memory_order_relaxed);
+		m_buffer[b & m_mask].store(item, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	/**
+		@brief Removes the most recently pushed item from the bottom of the deque (owner thread only)
+
+		@param item		Output item
+
+		@return True if an item was removed, false if the deque was empty or we lost a race with a thief
+	 */
+	bool Pop(T& item)
+	{
+		int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+		m_bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = m_top.load(std::memory_order_relaxed);
+
+		//Empty
+		if(t > b)
+		{
+			m_bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		item = m_buffer[b & m_mask].load(std::memory_order_relaxed);
+
+		//Last item in the deque: race against thieves for it
+		if(t == b)
+		{
+			bool won = m_top.compare_exchange_strong(
+				t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			m_bottom.store(b + 1, std::memory_order_relaxed);
+			return won;
+		}
+
+		return true;
+	}
+
+	/**
+		@brief Removes the oldest item from the top of the deque (any thread)
+
+		@param item		Output item
+
+		@return True if an item was removed, false if the deque was empty or we lost a race
+	 */
+	bool Steal(T& item)
+	{
+		int64_t t = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = m_bottom.load(std::memory_order_acquire);
+
+		if(t >= b)
+			return false;
+
+		item = m_buffer[t & m_mask].load(std::memory_order_relaxed);
+		return m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+	}
+
+	///@brief Returns true if the deque appears empty (approximate if other threads are active)
+	bool empty() const
+	{ return m_top.load(std::memory_order_acquire) >= m_bottom.load(std::memory_order_acquire); }
+
+protected:
+
+	///@brief Ring buffer of items
+	std::unique_ptr<std::atomic<T>[]> m_buffer;
+
+	///@brief Number of slots in m_buffer (always a power of two)
+	size_t m_capacity;
+
+	///@brief Bit mask for wrapping indexes into m_buffer
+	size_t m_mask;
+
+	///@brief Index of the oldest item (stolen from by other threads)
+	alignas(64) std::atomic<int64_t> m_top;
+
+	///@brief Index one past the newest item (pushed and popped by the owner)
+	alignas(64) std::atomic<int64_t> m_bottom;
+};
+
+#endif
@@ -48,6 +48,7 @@
 #include "DSLabsOscilloscope.h"
 #include "KeysightDCA.h"
 #include "LeCroyOscilloscope.h"
+#include "LoadGeneratorOscilloscope.h"
 #include "LeCroyFWPOscilloscope.h"
 #include "MagnovaOscilloscope.h"
 #include "PicoOscilloscope.h"
@@ -128,6 +129,7 @@ bool g_hasAvx512DQ = false;
 bool g_hasAvx512VL = false;
 bool g_hasAvx2 = false;
 bool g_hasFMA = false;
+bool g_hasPCLMUL = false;
 #endif
 
 #ifdef __APPLE__
@@ -170,7 +172,10 @@ void TransportStaticInit()
 	AddTransportClass(SCPIUARTTransport);
 	AddTransportClass(SCPIHIDTransport);
 	AddTransportClass(SCPINullTransport);
+	AddTransportClass(SCPIRecordingTransport);
+	AddTransportClass(SCPIReplayTransport);
 	AddTransportClass(VICPSocketTransport);
+	AddTransportClass(SCPIHiSLIPTransport);
 
 	//SocketCAN is a Linux-specific feature
 #ifdef __linux
@@ -197,6 +202,7 @@ void DetectCPUFeatures()
 	g_hasAvx512DQ = __builtin_cpu_supports("avx512dq");
 	g_hasAvx2 = __builtin_cpu_supports("avx2");
 	g_hasFMA = __builtin_cpu_supports("fma");
+	g_hasPCLMUL = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
 
 	if(g_hasAvx2)
 		LogDebug("* AVX2\n");
@@ -208,6 +214,8 @@ void DetectCPUFeatures()
 		LogDebug("* AVX512DQ\n");
 	if(g_hasAvx512VL)
 		LogDebug("* AVX512VL\n");
+	if(g_hasPCLMUL)
+		LogDebug("* PCLMULQDQ\n");
 	LogDebug("\n");
 #if defined(_WIN32) && defined(__GNUC__) // AVX2 is temporarily disabled on MingW64/GCC until this in resolved: https://gcc.gnu.org/bugzilla/show_bug.cgi?id=54412
 	if (g_hasAvx2 || g_hasAvx512F || g_hasAvx512DQ || g_hasAvx512VL)
@@ -217,6 +225,13 @@ void DetectCPUFeatures()
 	}
 #endif /* defined(_WIN32) && defined(__GNUC__) */
 #endif /* __x86_64__ */
+
+#ifdef __aarch64__
+	LogDebug("* NEON\n");
+	LogDebug("\n");
+#endif /* __aarch64__ */
+
+	InitializeSIMDKernels();
 }
 
 void ScopehalStaticCleanup()
@@ -250,6 +265,7 @@ void DriverStaticInit()
 	AddDriverClass(RSRTO6Oscilloscope);
 	AddDriverClass(LeCroyOscilloscope);
 	AddDriverClass(LeCroyFWPOscilloscope);
+	AddDriverClass(LoadGeneratorOscilloscope);
 	AddDriverClass(MagnovaOscilloscope);
 	AddDriverClass(SiglentSCPIOscilloscope);
 	AddDriverClass(TektronixOscilloscope);
@@ -340,8 +356,105 @@ uint64_t ConvertVectorSignalToScalar(const vector<bool>& bits)
 	return rval;
 }
 
+#ifndef _WIN32
+/**
+	@brief Identity of a file in the plugin search path, as of the last time it was probed
+
+	Files which failed to load or did not export PluginInit() are remembered in a manifest so that subsequent starts
+	don't have to dlopen() (and run the static initializers of) every unrelated library next to the binary.
+ */
+struct PluginManifestEntry
+{
+	int64_t m_mtime;
+	int64_t m_size;
+
+	bool operator==(const PluginManifestEntry& rhs) const
+	{ return (m_mtime == rhs.m_mtime) && (m_size == rhs.m_size); }
+
+	bool operator!=(const PluginManifestEntry& rhs) const
+	{ return !(*this == rhs); }
+};
+
+/**
+	@brief Gets the path of the plugin manifest cache, creating its parent directory if needed
+
+	@return Path to the manifest, or an empty string if the cache directory is not writable
+ */
+static string GetPluginManifestPath()
+{
+	try
+	{
+		CreateDirectory("~/.cache");
+		CreateDirectory("~/.cache/scopehal");
+	}
+	catch(const runtime_error& e)
+	{
+		LogDebug("Plugin manifest cache unavailable: %s\n", e.what());
+		return "";
+	}
+	return ExpandPath("~/.cache/scopehal/plugin-manifest.txt");
+}
+
+/**
+	@brief Loads the list of known non-plugin files from the manifest cache
+ */
+static map<string, PluginManifestEntry> LoadPluginManifest(const string& path)
+{
+	map<string, PluginManifestEntry> ret;
+	if(path.empty())
+		return ret;
+
+	FILE* fp = fopen(path.c_str(), "r");
+	if(!fp)
+		return ret;
+
+	char line[2048];
+	while(fgets(line, sizeof(line), fp))
+	{
+		long long mtime;
+		long long size;
+		int pathStart = 0;
+		if(2 != sscanf(line, "%lld %lld %n", &mtime, &size, &pathStart) || (pathStart == 0))
+			continue;
+
+		string fname = line + pathStart;
+		while(!fname.empty() && (fname.back() == '\n'))
+			fname.pop_back();
+		if(!fname.empty())
+			ret[fname] = { mtime, size };
+	}
+
+	fclose(fp);
+	return ret;
+}
+
+/**
+	@brief Writes the list of known non-plugin files back to the manifest cache
+ */
+static void SavePluginManifest(const string& path, const map<string, PluginManifestEntry>& manifest)
+{
+	if(path.empty())
+		return;
+
+	FILE* fp = fopen(path.c_str(), "w");
+	if(!fp)
+	{
+		LogDebug("Could not write plugin manifest %s\n", path.c_str());
+		return;
+	}
+
+	for(auto& it : manifest)
+		fprintf(fp, "%lld %lld %s\n", (long long)it.second.m_mtime, (long long)it.second.m_size, it.first.c_str());
+
+	fclose(fp);
+}
+#endif
+
 /**
 	@brief Initialize all plugins
+
+	On non-Windows platforms, files which were previously probed and found not to be plugins are skipped (without
+	being dlopen'd) as long as their size and modification time are unchanged.
  */
 void InitializePlugins()
 {
@@ -366,6 +479,10 @@ void InitializePlugins()
 	snprintf(tmp, sizeof(tmp), "%s/.scopehal/plugins", getenv("HOME"));
 	search_dirs.push_back(tmp);
 
+	auto manifestPath = GetPluginManifestPath();
+	auto oldManifest = LoadPluginManifest(manifestPath);
+	map<string, PluginManifestEntry> newManifest;
+
 	for(auto dir : search_dirs)
 	{
 		DIR* hdir = opendir(dir.c_str());
@@ -388,9 +505,25 @@ void InitializePlugins()
 			//Try loading it and see if it works.
 			//(for now, never unload the plugins)
 			string fname = dir + "/" + pent->d_name;
+
+			//Skip anything we already know isn't a plugin, unless it's changed since we last looked
+			struct stat st;
+			if(0 != stat(fname.c_str(), &st))
+				continue;
+			PluginManifestEntry entry = { st.st_mtim.tv_sec, st.st_size };
+			auto it = oldManifest.find(fname);
+			if( (it != oldManifest.end()) && (it->second == entry) )
+			{
+				newManifest[fname] = entry;
+				continue;
+			}
+
 			void* hlib = dlopen(fname.c_str(), RTLD_NOW);
 			if(hlib == nullptr)
+			{
+				newManifest[fname] = entry;
 				continue;
+			}
 			LogDebug("Checking %s\n", fname.c_str());
 			LogIndenter li2;
 
@@ -400,6 +533,8 @@ void InitializePlugins()
 			if(!init)
 			{
 				LogDebug("PluginInit not found, skipping\n");
+				newManifest[fname] = entry;
+				dlclose(hlib);
 				continue;
 			}
 
@@ -410,6 +545,9 @@ void InitializePlugins()
 
 		closedir(hdir);
 	}
+
+	if(newManifest != oldManifest)
+		SavePluginManifest(manifestPath, newManifest);
 #else
 	// Get path of process image
 	TCHAR binPath[MAX_PATH];
@@ -995,20 +1133,7 @@ void CreateDirectory(const string& path)
  */
 uint32_t CRC32(const uint8_t* bytes, size_t start, size_t end)
 {
-	uint32_t poly = 0xedb88320;
-
-	uint32_t crc = 0xffffffff;
-	for(size_t n=start; n <= end; n++)
-	{
-		uint8_t d = bytes[n];
-		for(int i=0; i<8; i++)
-		{
-			bool b = ( crc ^ (d >> i) ) & 1;
-			crc >>= 1;
-			if(b)
-				crc ^= poly;
-		}
-	}
+	uint32_t crc = g_simdKernels.crc32(0xffffffff, bytes + start, end - start + 1);
 
 	return ~(	((crc & 0x000000ff) << 24) |
 				((crc & 0x0000ff00) << 8) |
@@ -1021,6 +1146,126 @@ uint32_t CRC32(const vector<uint8_t>& bytes)
 	return CRC32(&bytes[0], 0, bytes.size()-1);
 }
 
+static const uint64_t g_xxPrime1 = 0x9e3779b185ebca87ULL;
+static const uint64_t g_xxPrime2 = 0xc2b2ae3d27d4eb4fULL;
+static const uint64_t g_xxPrime3 = 0x165667b19e3779f9ULL;
+static const uint64_t g_xxPrime4 = 0x85ebca77c2b2ae63ULL;
+static const uint64_t g_xxPrime5 = 0x27d4eb2f165667c5ULL;
+
+static inline uint64_t XXRotl(uint64_t x, int r)
+{ return (x << r) | (x >> (64 - r)); }
+
+static inline uint64_t XXRound(uint64_t acc, uint64_t input)
+{
+	acc += input * g_xxPrime2;
+	acc = XXRotl(acc, 31);
+	return acc * g_xxPrime1;
+}
+
+static inline uint64_t XXMergeRound(uint64_t acc, uint64_t val)
+{
+	acc ^= XXRound(0, val);
+	return acc * g_xxPrime1 + g_xxPrime4;
+}
+
+static inline uint64_t XXRead64(const uint8_t* p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint32_t XXRead32(const uint8_t* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+/**
+	@brief Single threaded XXH64 of a block of memory
+ */
+static uint64_t XXHash64(const uint8_t* p, size_t len, uint64_t seed)
+{
+	const uint8_t* end = p + len;
+	uint64_t h;
+
+	if(len >= 32)
+	{
+		uint64_t v1 = seed + g_xxPrime1 + g_xxPrime2;
+		uint64_t v2 = seed + g_xxPrime2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - g_xxPrime1;
+		const uint8_t* limit = end - 32;
+		do
+		{
+			v1 = XXRound(v1, XXRead64(p));
+			v2 = XXRound(v2, XXRead64(p + 8));
+			v3 = XXRound(v3, XXRead64(p + 16));
+			v4 = XXRound(v4, XXRead64(p + 24));
+			p += 32;
+		} while(p <= limit);
+
+		h = XXRotl(v1, 1) + XXRotl(v2, 7) + XXRotl(v3, 12) + XXRotl(v4, 18);
+		h = XXMergeRound(h, v1);
+		h = XXMergeRound(h, v2);
+		h = XXMergeRound(h, v3);
+		h = XXMergeRound(h, v4);
+	}
+	else
+		h = seed + g_xxPrime5;
+
+	h += len;
+
+	for(; p + 8 <= end; p += 8)
+		h = XXRotl(h ^ XXRound(0, XXRead64(p)), 27) * g_xxPrime1 + g_xxPrime4;
+	if(p + 4 <= end)
+	{
+		h = XXRotl(h ^ (XXRead32(p) * g_xxPrime1), 23) * g_xxPrime2 + g_xxPrime3;
+		p += 4;
+	}
+	for(; p < end; p++)
+		h = XXRotl(h ^ (*p * g_xxPrime5), 11) * g_xxPrime1;
+
+	h ^= h >> 33;
+	h *= g_xxPrime2;
+	h ^= h >> 29;
+	h *= g_xxPrime3;
+	h ^= h >> 32;
+	return h;
+}
+
+/**
+	@brief Calculates a fast 64-bit content hash (not cryptographically secure) of a block of memory
+
+	Used to detect waveforms whose content has not changed. Small blocks are hashed with XXH64. Large ones are split
+	into fixed size chunks which are hashed in parallel, and the hash is then the XXH64 of the chunk hashes, so the
+	result does not depend on the number of threads but is not the same as plain XXH64 of the whole block.
+
+	@param data	Start of the block
+	@param len	Length of the block, in bytes
+	@param seed	Seed value, e.g. the hash of a previous block to chain several blocks together
+ */
+uint64_t ContentHash64(const void* data, size_t len, uint64_t seed)
+{
+	const size_t chunkSize = 1024 * 1024;
+	auto p = reinterpret_cast<const uint8_t*>(data);
+	if(len <= chunkSize)
+		return XXHash64(p, len, seed);
+
+	size_t nchunks = (len + chunkSize - 1) / chunkSize;
+	vector<uint64_t> hashes(nchunks);
+	ParallelFor(0, nchunks, 1, [&](size_t first, size_t last)
+	{
+		for(size_t i=first; i<last; i++)
+		{
+			size_t start = i * chunkSize;
+			hashes[i] = XXHash64(p + start, min(chunkSize, len - start), seed);
+		}
+	});
+	return XXHash64(reinterpret_cast<const uint8_t*>(&hashes[0]), nchunks * sizeof(uint64_t), seed ^ len);
+}
+
 /**
 	@brief Returns the library version string (Semantic Version formatted)
  */
@@ -1051,7 +1296,10 @@ bool OnMemoryPressure(MemoryPressureLevel level, MemoryPressureType type, size_t
 		(type == MemoryPressureType::Host) ? "host" : "device",
 		Unit(Unit::UNIT_BYTES).PrettyPrint(requestedSize, 4).c_str());
 
-	bool moreFreed = false;
+	//Drop pooled waveforms before asking anyone else to give up memory that's actually in use
+	bool moreFreed = WaveformPool::OnMemoryPressure(level, type, requestedSize);
+	if(StagingBufferPool::OnMemoryPressure(level, type, requestedSize))
+		moreFreed = true;
 
 	for(auto handler : g_memoryPressureHandlers)
 	{
@@ -1059,5 +1307,18 @@ bool OnMemoryPressure(MemoryPressureLevel level, MemoryPressureType type, size_t
 			moreFreed = true;
 	}
 
+	//Anything freed above went back to the arenas, so hand empty blocks back to the driver
+	size_t arenaFreed = 0;
+	if(g_vkLocalMemoryArena)
+		arenaFreed += g_vkLocalMemoryArena->Defragment();
+	if(g_vkPinnedMemoryArena && (g_vkPinnedMemoryArena != g_vkLocalMemoryArena))
+		arenaFreed += g_vkPinnedMemoryArena->Defragment();
+	if(arenaFreed)
+	{
+		LogDebug("Released %s of empty device memory arena blocks\n",
+			Unit(Unit::UNIT_BYTES).PrettyPrint(arenaFreed, 4).c_str());
+		moreFreed = true;
+	}
+
 	return moreFreed;
 }
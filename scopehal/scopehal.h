@@ -50,6 +50,7 @@
 #include <stdint.h>
 #include <chrono>
 #include <thread>
+#include <future>
 #include <memory>
 #include <climits>
 #include <cinttypes>
@@ -70,6 +71,10 @@
 #include <nvtx3/nvtx3.hpp>
 #endif
 
+#ifdef HAVE_TRACY
+#include <tracy/Tracy.hpp>
+#endif
+
 //Vulkan is now a mandatory dependency, so no compile time enable flag
 //(disable some warnings in Vulkan headers that we can't do anything about)
 #pragma GCC diagnostic push
@@ -84,6 +89,7 @@ extern bool g_hasAvx512F;
 extern bool g_hasAvx512VL;
 extern bool g_hasAvx512DQ;
 extern bool g_hasAvx2;
+extern bool g_hasPCLMUL;
 #endif
 
 //Helper for absolute value of an int64_t
@@ -104,8 +110,10 @@ extern bool g_hasShaderAtomicFloat;
 extern bool g_hasDebugUtils;
 extern bool g_hasMemoryBudget;
 extern bool g_hasPushDescriptor;
+extern bool g_hasTimelineSemaphore;
 
 extern size_t g_maxComputeGroupCount[3];
+extern size_t g_vkStorageBufferOffsetAlignment;
 
 struct FIRFilterArgs
 {
@@ -115,22 +123,35 @@ struct FIRFilterArgs
 
 uint32_t GetComputeBlockCount(size_t numGlobal, size_t blockSize);
 
+#include "SIMDKernels.h"
+#include "CRC.h"
+
 #include "Unit.h"
 #include "Bijection.h"
 #include "IDTable.h"
 
+#include "PerformanceTrace.h"
+#include "NumaTopology.h"
+#include "ThreadPool.h"
+#include "ParallelStateMachine.h"
 #include "AcceleratorBuffer.h"
+#include "StagingBufferPool.h"
 #include "ComputePipeline.h"
 
 #include "SCPITransport.h"
 #include "SCPISocketTransport.h"
+#include "SharedMemoryRing.h"
 #include "SCPITwinLanTransport.h"
 #include "SCPILxiTransport.h"
+#include "SCPIHiSLIPTransport.h"
 #include "SCPINullTransport.h"
+#include "SCPIRecordingTransport.h"
+#include "SCPIReplayTransport.h"
 #include "SCPIUARTTransport.h"
 #include "SCPIHIDTransport.h"
 #include "VICPSocketTransport.h"
 #include "SCPIDevice.h"
+#include "SCPIConfigBatch.h"
 #ifdef __linux
 #include "SCPISocketCANTransport.h"
 #endif
@@ -164,6 +185,10 @@ uint32_t GetComputeBlockCount(size_t numGlobal, size_t blockSize);
 #include "Multimeter.h"
 #include "MultimeterChannel.h"
 #include "Oscilloscope.h"
+#include "StreamingSampleConverter.h"
+#include "RawSampleConverter.h"
+#include "RawSampleRing.h"
+#include "SegmentedCapture.h"
 #include "SParameterChannel.h"
 #include "PowerSupply.h"
 #include "PowerSupplyChannel.h"
@@ -187,12 +212,21 @@ uint32_t GetComputeBlockCount(size_t numGlobal, size_t blockSize);
 #include "SCPIVNA.h"
 #include "SwitchMatrix.h"
 
+#include "PhaseUnwrap.h"
 #include "SParameters.h"
 #include "TouchstoneParser.h"
 #include "IBISParser.h"
 
 #include "FilterParameter.h"
+#include "AnalogStatistics.h"
+#include "MinMaxPyramid.h"
+#include "EdgeSampler.h"
 #include "Filter.h"
+#include "DigitalEdgeList.h"
+#include "LevelCrossingList.h"
+#include "SoftwareTrigger.h"
+#include "MappedFile.h"
+#include "WaveformHistory.h"
 #include "ImportFilter.h"
 #include "PeakDetectionFilter.h"
 #include "SpectrumChannel.h"
@@ -200,6 +234,13 @@ uint32_t GetComputeBlockCount(size_t numGlobal, size_t blockSize);
 #include "SParameterFilter.h"
 
 #include "FilterGraphExecutor.h"
+#include "FilterGraphLoader.h"
+#include "FilterShard.h"
+#include "FilterBenchmark.h"
+#include "ProtocolBenchmark.h"
+#include "SIMDKernelBenchmark.h"
+#include "AcquisitionCoordinator.h"
+#include "InstrumentPollScheduler.h"
 
 #include "QueueManager.h"
 
@@ -224,6 +265,7 @@ void TransportStaticInit();
 void DriverStaticInit();
 
 bool VulkanInit(bool skipGLFW = false);
+std::shared_future<bool> VulkanInitAsync(bool skipGLFW = true);
 void InitializeSearchPaths();
 void InitializePlugins();
 void DetectCPUFeatures();
@@ -261,6 +303,7 @@ struct ConvertRawSamplesShaderArgs
 	uint32_t size;
 	float gain;
 	float offset;
+	uint32_t start;
 };
 
 //Vulkan global stuff
@@ -0,0 +1,89 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 430
+#pragma shader_stage(compute)
+
+layout(std430, binding=0) restrict readonly buffer buf_pin
+{
+	float pin[];
+};
+
+//Per thread min, max, sum, and sum of squares
+layout(std430, binding=1) restrict writeonly buffer buf_partials
+{
+	vec4 partials[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint size;
+	uint numThreads;
+};
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+void main()
+{
+	uint nthread = gl_GlobalInvocationID.x;
+	if(nthread >= numThreads)
+		return;
+
+	//Interleave samples across threads so neighboring threads read neighboring samples.
+	//Caller guarantees size >= numThreads, so every thread gets at least one sample.
+	float first = pin[nthread];
+	float fmin = first;
+	float fmax = first;
+
+	//Kahan summation for both sums since each thread may see a lot of samples.
+	//Must not be reassociated by the compiler
+	precise float sum = first;
+	precise float sumc = 0;
+	precise float sumsq = first * first;
+	precise float sumsqc = 0;
+
+	for(uint i=nthread + numThreads; i < size; i += numThreads)
+	{
+		float f = pin[i];
+		fmin = min(fmin, f);
+		fmax = max(fmax, f);
+
+		precise float y = f - sumc;
+		precise float t = sum + y;
+		sumc = (t - sum) - y;
+		sum = t;
+
+		y = f*f - sumsqc;
+		t = sumsq + y;
+		sumsqc = (t - sumsq) - y;
+		sumsq = t;
+	}
+
+	partials[nthread] = vec4(fmin, fmax, sum, sumsq);
+}
@@ -0,0 +1,119 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 430
+#pragma shader_stage(compute)
+
+layout(std430, binding=0) restrict readonly buffer buf_pin
+{
+	float pin[];
+};
+
+//Output of AnalogStatistics_FirstPass
+layout(std430, binding=1) restrict readonly buffer buf_partials
+{
+	vec4 partials[];
+};
+
+layout(std430, binding=2) restrict buffer buf_hist
+{
+	uint hist[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint size;
+	uint numThreads;
+	uint bins;
+};
+
+#define NUM_LOCAL 64
+#define MAX_BINS 256
+
+layout(local_size_x=NUM_LOCAL, local_size_y=1, local_size_z=1) in;
+
+shared float g_min[NUM_LOCAL];
+shared float g_max[NUM_LOCAL];
+shared uint g_bins[MAX_BINS];
+
+void main()
+{
+	uint lid = gl_LocalInvocationID.x;
+
+	//Every block finds the global min/max from the first pass results.
+	//This is much cheaper than another dispatch and a round trip to the CPU.
+	float fmin = partials[lid].x;
+	float fmax = partials[lid].y;
+	for(uint i=lid + NUM_LOCAL; i < numThreads; i += NUM_LOCAL)
+	{
+		fmin = min(fmin, partials[i].x);
+		fmax = max(fmax, partials[i].y);
+	}
+	g_min[lid] = fmin;
+	g_max[lid] = fmax;
+
+	for(uint i=lid; i < bins; i += NUM_LOCAL)
+		g_bins[i] = 0;
+	barrier();
+
+	for(uint stride = NUM_LOCAL/2; stride > 0; stride /= 2)
+	{
+		if(lid < stride)
+		{
+			g_min[lid] = min(g_min[lid], g_min[lid + stride]);
+			g_max[lid] = max(g_max[lid], g_max[lid + stride]);
+		}
+		barrier();
+	}
+	fmin = g_min[0];
+	float delta = g_max[0] - fmin;
+	float fbins = float(bins);
+
+	//Bin our share of the samples locally (same binning as Filter::MakeHistogram)
+	uint stride = gl_NumWorkGroups.x * NUM_LOCAL;
+	for(uint i=gl_GlobalInvocationID.x; i < size; i += stride)
+	{
+		uint bin = 0;
+		if(delta > 0)
+		{
+			float fbin = (pin[i] - fmin) / delta;
+			bin = min(uint(floor(fbin * fbins)), bins - 1);
+		}
+		atomicAdd(g_bins[bin], 1);
+	}
+	barrier();
+
+	//Merge into the global histogram
+	for(uint i=lid; i < bins; i += NUM_LOCAL)
+	{
+		uint count = g_bins[i];
+		if(count != 0)
+			atomicAdd(hist[i], count);
+	}
+}
@@ -0,0 +1,55 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+/**
+	@file
+	@brief Accessors for CompressedTimeline timestamps
+
+	This is an include file, not a standalone shader. The including shader binds CompressedTimeline::m_blockBases
+	as an int64_t array and m_deltas (and m_durations, if durations are not implied) as uint arrays.
+
+	GLSL cannot pass buffers to functions, so the accessors are macros taking the names of the arrays in the
+	including shader. Requires GL_EXT_shader_explicit_arithmetic_types_int64.
+ */
+
+#ifndef CompressedTimeline_glsl
+#define CompressedTimeline_glsl
+
+//log2 of CompressedTimeline::BLOCK_SIZE
+#define COMPRESSED_TIMELINE_BLOCK_SHIFT 10u
+
+//Offset of sample i, in timebase ticks
+#define COMPRESSED_TIMELINE_OFFSET(bases, deltas, i) \
+	(bases[(i) >> COMPRESSED_TIMELINE_BLOCK_SHIFT] + int64_t(deltas[i]))
+
+//Duration of sample i when durations are implied (len = sample count, last = duration of the final sample)
+#define COMPRESSED_TIMELINE_IMPLIED_DURATION(bases, deltas, i, len, last) \
+	( ((i) + 1u == (len)) ? (last) : \
+		(COMPRESSED_TIMELINE_OFFSET(bases, deltas, (i) + 1u) - COMPRESSED_TIMELINE_OFFSET(bases, deltas, i)) )
+
+#endif
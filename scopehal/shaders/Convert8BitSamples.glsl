@@ -46,6 +46,7 @@ layout(std430, push_constant) uniform constants
 	uint size;
 	float gain;
 	float offset;
+	uint start;
 };
 
 layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
@@ -56,5 +57,5 @@ void main()
 	if(nthread >= size)
 		return;
 
-	pout[nthread] = gain*float(int(pin[nthread])) - offset;
+	pout[nthread] = gain*float(int(pin[start + nthread])) - offset;
 }
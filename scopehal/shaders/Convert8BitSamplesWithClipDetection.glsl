@@ -51,6 +51,7 @@ layout(std430, push_constant) uniform constants
 	uint size;
 	float gain;
 	float offset;
+	uint start;
 };
 
 layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
@@ -61,7 +62,7 @@ void main()
 	if(nthread >= size)
 		return;
 
-	int rawsamp = int(pin[nthread]);
+	int rawsamp = int(pin[start + nthread]);
 	if( (rawsamp == -128) || (rawsamp == 127) )
 		atomicMax(pclip[0], 1);
 
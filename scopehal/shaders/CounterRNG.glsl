@@ -0,0 +1,83 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Counter based random number generator (Philox4x32-10)
+
+	This is an include file, not a standalone shader. It matches CounterRNG.h bit for bit: block b of a stream is a
+	pure function of (seed, stream, b), so threads can generate any part of a buffer in any order.
+ */
+
+#ifndef CounterRNG_glsl
+#define CounterRNG_glsl
+
+///@brief Generates the four 32-bit random words of block (blockLo, blockHi) for key (seed, stream)
+uvec4 CounterRNGBlock(uint blockLo, uint blockHi, uvec2 key)
+{
+	uvec4 c = uvec4(blockLo, blockHi, 0, 0);
+	uvec2 k = key;
+
+	for(int round=0; round<10; round++)
+	{
+		uint hi0;
+		uint lo0;
+		uint hi1;
+		uint lo1;
+		umulExtended(0xd2511f53u, c.x, hi0, lo0);
+		umulExtended(0xcd9e8d57u, c.z, hi1, lo1);
+
+		c = uvec4(hi1 ^ c.y ^ k.x, lo1, hi0 ^ c.w ^ k.y, lo0);
+		k += uvec2(0x9e3779b9u, 0xbb67ae85u);
+	}
+
+	return c;
+}
+
+///@brief Converts a random word to a float in the open interval (0, 1)
+float CounterRNGToUnitFloat(uint x)
+{
+	return float(x >> 8) * (1.0 / 16777216.0) + (0.5 / 16777216.0);
+}
+
+///@brief Generates four standard normal values for block b (samples 4b to 4b+3) using Box-Muller
+vec4 CounterRNGGaussian4(uint b, uvec2 key)
+{
+	uvec4 raw = CounterRNGBlock(b, 0, key);
+
+	const float twopi = 2 * 3.1415926535;
+	float mag0 = sqrt(-2 * log(CounterRNGToUnitFloat(raw.x)));
+	float theta0 = twopi * CounterRNGToUnitFloat(raw.y);
+	float mag1 = sqrt(-2 * log(CounterRNGToUnitFloat(raw.z)));
+	float theta1 = twopi * CounterRNGToUnitFloat(raw.w);
+
+	return vec4(mag0 * cos(theta0), mag0 * sin(theta0), mag1 * cos(theta1), mag1 * sin(theta1));
+}
+
+#endif
@@ -0,0 +1,150 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Samples an analog waveform on edges of a clock, one thread per output sample
+ */
+
+#version 430
+#pragma shader_stage(compute)
+#extension GL_ARB_gpu_shader_int64 : require
+
+//Clock toggle timestamps, in clock ticks
+layout(std430, binding=0) restrict readonly buffer buf_edges
+{
+	int64_t edges[];
+};
+
+//Data sample offsets, in data ticks (unused for uniform data)
+layout(std430, binding=1) restrict readonly buffer buf_doffsets
+{
+	int64_t doffsets[];
+};
+
+layout(std430, binding=2) restrict readonly buffer buf_dsamples
+{
+	float dsamples[];
+};
+
+layout(std430, binding=3) restrict writeonly buffer buf_offsets
+{
+	int64_t offsets[];
+};
+
+layout(std430, binding=4) restrict writeonly buffer buf_samples
+{
+	float samples[];
+};
+
+layout(std430, binding=5) restrict writeonly buffer buf_durations
+{
+	int64_t durations[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	int64_t clockTimescale;
+	int64_t clockTriggerPhase;
+	int64_t dataTimescale;
+	int64_t dataTriggerPhase;
+	uint firstEdge;
+	uint edgeStride;
+	uint outputCount;
+	uint dataLen;
+	uint sparseData;
+	uint interpolate;
+};
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+int64_t GetEdge(uint i)
+{
+	return edges[firstEdge + i*edgeStride] * clockTimescale + clockTriggerPhase;
+}
+
+int64_t GetDataOffset(uint i)
+{
+	if(sparseData != 0)
+		return doffsets[i] * dataTimescale + dataTriggerPhase;
+	return int64_t(i) * dataTimescale + dataTriggerPhase;
+}
+
+void main()
+{
+	uint i = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+	if(i >= outputCount)
+		return;
+
+	int64_t t = GetEdge(i);
+
+	//Count data samples strictly before the edge, we want the last of them (or the first sample if there are none)
+	uint count;
+	if(sparseData != 0)
+	{
+		uint lo = 0;
+		uint hi = dataLen;
+		while(lo < hi)
+		{
+			uint mid = lo + (hi - lo)/2;
+			if(GetDataOffset(mid) < t)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		count = lo;
+	}
+	else
+	{
+		int64_t delta = t - dataTriggerPhase;
+		if(delta <= 0)
+			count = 0;
+		else
+			count = uint(min( (delta + dataTimescale - 1) / dataTimescale, int64_t(dataLen) ));
+	}
+	uint idata = (count > 0) ? (count - 1) : 0;
+
+	float v = dsamples[idata];
+	if( (interpolate != 0) && (idata+1 < dataLen) )
+	{
+		float frac = float(t - GetDataOffset(idata)) / float(dataTimescale);
+		if(sparseData != 0)
+			frac /= float(doffsets[idata+1] - doffsets[idata]);
+		v += (dsamples[idata+1] - v) * frac;
+	}
+
+	offsets[i] = t;
+	samples[i] = v;
+
+	//Each sample lasts until the next one, last sample has constant duration
+	if(i+1 < outputCount)
+		durations[i] = GetEdge(i+1) - t;
+	else
+		durations[i] = 1;
+}
@@ -0,0 +1,156 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 430
+#pragma shader_stage(compute)
+
+//Evaluates a chain of elementwise ops (see FilterGraphExecutor::RunFusedChain()) in one pass.
+//Every waveform touched by the chain is bound to one of eight slots; slot 15 is the result of the previous op.
+//Up to two input slots may instead hold raw 8 or 16 bit ADC codes (see RawAnalogSamples), which are bound to
+//bindings 8 and 9 and scaled to volts as they're read.
+
+layout(std430, binding=0) buffer buf_s0 { float s0[]; };
+layout(std430, binding=1) buffer buf_s1 { float s1[]; };
+layout(std430, binding=2) buffer buf_s2 { float s2[]; };
+layout(std430, binding=3) buffer buf_s3 { float s3[]; };
+layout(std430, binding=4) buffer buf_s4 { float s4[]; };
+layout(std430, binding=5) buffer buf_s5 { float s5[]; };
+layout(std430, binding=6) buffer buf_s6 { float s6[]; };
+layout(std430, binding=7) buffer buf_s7 { float s7[]; };
+
+//Raw ADC codes, packed into 32-bit words
+layout(std430, binding=8) readonly buffer buf_c0 { uint c0[]; };
+layout(std430, binding=9) readonly buffer buf_c1 { uint c1[]; };
+
+#define MAX_OPS 8
+
+#define OP_ADD		0
+#define OP_SUBTRACT	1
+#define OP_MULTIPLY	2
+#define OP_NEGATE	3
+#define OP_MIN		4
+#define OP_MAX		5
+
+layout(std430, push_constant) uniform constants
+{
+	uint len;
+	uint nops;
+
+	//Bits 7:0 = opcode, 11:8 = slot of operand a, 15:12 = slot of operand b, 19:16 = output slot
+	uint ops[MAX_OPS];
+	float opConstants[MAX_OPS];
+
+	//Offset of the first sample read from each slot
+	uint offsets[8];
+
+	//For each raw code buffer r, bits 8r+3:8r = slot it stands in for (15 if unused), bit 8r+4 = 16-bit codes
+	uint rawFormats;
+	float rawGain[2];
+	float rawOffset[2];
+};
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+float LoadRaw(uint r, uint i)
+{
+	bool wide = ((rawFormats >> (8*r)) & 0x10) != 0;
+	uint byteIndex = wide ? (i * 2) : i;
+	uint word = (r == 0) ? c0[byteIndex >> 2] : c1[byteIndex >> 2];
+	int code = bitfieldExtract(int(word), int(byteIndex & 3) * 8, wide ? 16 : 8);
+	return float(code) * rawGain[r] + rawOffset[r];
+}
+
+float Load(uint slot, uint i, float prev)
+{
+	if(slot < 8)
+	{
+		for(uint r=0; r<2; r++)
+		{
+			if(((rawFormats >> (8*r)) & 0xf) == slot)
+				return LoadRaw(r, i + offsets[slot]);
+		}
+	}
+
+	switch(slot)
+	{
+		case 0: return s0[i + offsets[0]];
+		case 1: return s1[i + offsets[1]];
+		case 2: return s2[i + offsets[2]];
+		case 3: return s3[i + offsets[3]];
+		case 4: return s4[i + offsets[4]];
+		case 5: return s5[i + offsets[5]];
+		case 6: return s6[i + offsets[6]];
+		case 7: return s7[i + offsets[7]];
+		default: return prev;
+	}
+}
+
+void Store(uint slot, uint i, float value)
+{
+	switch(slot)
+	{
+		case 0: s0[i] = value; break;
+		case 1: s1[i] = value; break;
+		case 2: s2[i] = value; break;
+		case 3: s3[i] = value; break;
+		case 4: s4[i] = value; break;
+		case 5: s5[i] = value; break;
+		case 6: s6[i] = value; break;
+		case 7: s7[i] = value; break;
+		default: break;
+	}
+}
+
+void main()
+{
+	uint i = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+	if(i >= len)
+		return;
+
+	float value = 0;
+	for(uint k=0; k<nops; k++)
+	{
+		uint op = ops[k];
+		float a = Load((op >> 8) & 0xf, i, value);
+		float b = Load((op >> 12) & 0xf, i, value);
+
+		switch(op & 0xff)
+		{
+			case OP_ADD:		value = a + b; break;
+			case OP_SUBTRACT:	value = a - b; break;
+			case OP_MULTIPLY:	value = a * b; break;
+			case OP_NEGATE:		value = -a; break;
+			case OP_MIN:		value = min(a, opConstants[k]); break;
+			case OP_MAX:		value = max(a, opConstants[k]); break;
+			default: break;
+		}
+
+		Store((op >> 16) & 0xf, i, value);
+	}
+}
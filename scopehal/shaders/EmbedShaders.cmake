@@ -0,0 +1,45 @@
+#Generates a C++ source file linking a set of compiled SPIR-V shaders into a library (see ShaderBundle)
+#
+#Usage: cmake -DOUTPUT=bundle.cpp -DSPVFILES="a.spv|b.spv|..." -P EmbedShaders.cmake
+#
+#All of the shaders are concatenated into one array of words, followed by an index giving the file name, offset,
+#size and (truncated SHA-256) content hash of each one.
+
+string(REPLACE "|" ";" SPVFILES "${SPVFILES}")
+
+set(blob "")
+set(index "")
+set(offset 0)
+foreach(spv ${SPVFILES})
+	get_filename_component(name ${spv} NAME)
+
+	file(READ ${spv} hex HEX)
+	string(LENGTH "${hex}" hexlen)
+	math(EXPR words "${hexlen} / 8")
+
+	#SPIR-V is a stream of little endian 32-bit words
+	string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1," wordtext "${hex}")
+
+	file(SHA256 ${spv} hash)
+	string(SUBSTRING "${hash}" 0 16 hash)
+
+	string(APPEND blob "\t//${name}\n\t${wordtext}\n")
+	string(APPEND index "\t{ \"${name}\", ${offset}, ${words}, 0x${hash}ULL },\n")
+	math(EXPR offset "${offset} + ${words}")
+endforeach()
+
+file(WRITE ${OUTPUT}.tmp
+	"//Generated by EmbedShaders.cmake, do not edit\n"
+	"#include \"scopehal.h\"\n"
+	"#include \"ShaderBundle.h\"\n"
+	"\n"
+	"static const uint32_t g_spirvBlob[] =\n{\n${blob}};\n"
+	"\n"
+	"static const ShaderBundle::Entry g_spirvIndex[] =\n{\n${index}};\n"
+	"\n"
+	"static ShaderBundle::Registrar g_spirvRegistrar(\n"
+	"\tg_spirvIndex, sizeof(g_spirvIndex) / sizeof(g_spirvIndex[0]), g_spirvBlob);\n")
+
+#Only touch the output if it changed, so the library isn't relinked for nothing
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different ${OUTPUT}.tmp ${OUTPUT})
+file(REMOVE ${OUTPUT}.tmp)
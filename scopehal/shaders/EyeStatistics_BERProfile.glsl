@@ -0,0 +1,118 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+#version 430
+#pragma shader_stage(compute)
+
+#extension GL_ARB_gpu_shader_int64 : require
+
+//BER along one row or column of an eye, one thread per point (see EyeWaveform::GetBERAtPoint())
+
+layout(std430, binding=0) restrict readonly buffer buf_accumData
+{
+	int64_t accumData[];
+};
+
+layout(std430, binding=1) restrict writeonly buffer buf_ber
+{
+	float ber[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint	width;
+	uint	height;
+	int		xmid;
+	int		ymid;
+	uint	horizontal;
+	uint	index;
+	uint	first;
+	uint	count;
+	uint	isBER;
+};
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+void main()
+{
+	uint k = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+	if(k >= count)
+		return;
+
+	int pointx = int( (horizontal != 0) ? (first + k) : index );
+	int pointy = int( (horizontal != 0) ? index : (first + k) );
+
+	//BER eyes store the BER directly, scaled by 1e15
+	if(isBER != 0)
+	{
+		if( (pointx < 0) || (pointx >= int(width)) || (pointy < 0) || (pointy >= int(height)) )
+			ber[k] = 1;
+		else
+			ber[k] = float(accumData[pointy*width + pointx]) * 1e-15;
+		return;
+	}
+
+	//Unit vector from the point towards the center of the eye.
+	//BER at center of eye is zero by definition
+	float uvecx = pointx - xmid;
+	float uvecy = pointy - ymid;
+	float len = sqrt(uvecx * uvecx + uvecy * uvecy);
+	if(len < 0.5)
+	{
+		ber[k] = 0;
+		return;
+	}
+	uvecx /= len;
+	uvecy /= len;
+
+	//Integrate from the center out to the point
+	int64_t innerhits = 0;
+	for(uint i=0; i<len; i++)
+	{
+		int x = int(round(xmid + uvecx*i));
+		int y = int(round(ymid + uvecy*i));
+		innerhits += accumData[y*width + x];
+	}
+
+	//Continue along the path until we hit the edge of the eye
+	//(starts from the truncated length, like the CPU version)
+	int64_t totalhits = innerhits;
+	for(uint i=uint(len); ; i++)
+	{
+		int x = int(round(xmid + uvecx*i));
+		int y = int(round(ymid + uvecy*i));
+		if( (x < 0) || (y < 0) || (x >= int(width)) || (y >= int(height)) )
+			break;
+		totalhits += accumData[y*width + x];
+	}
+
+	//Fraction of the total hits between the center and the point
+	ber[k] = float(innerhits) / float(totalhits);
+}
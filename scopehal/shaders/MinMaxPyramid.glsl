@@ -0,0 +1,101 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 460
+#pragma shader_stage(compute)
+
+//Input: raw samples (inputStride = 1) or (min, max, mean) triplets of the level below (inputStride = 3)
+layout(std430, binding=0) restrict readonly buffer buf_din
+{
+	float din[];
+};
+
+//Output: (min, max, mean) triplets
+layout(std430, binding=1) restrict writeonly buffer buf_dout
+{
+	float dout[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint inputCount;
+	uint outputCount;
+	uint inputStride;
+	uint childSpan;
+	uint totalSamples;
+};
+
+#define DECIMATION 64
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+void main()
+{
+	uint nout = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+	if(nout >= outputCount)
+		return;
+
+	uint istart = nout * DECIMATION;
+	uint iend = min(istart + DECIMATION, inputCount);
+
+	float vmin = din[istart * inputStride];
+	float vmax = vmin;
+	float sum = 0;
+	uint count = 0;
+
+	if(inputStride == 1)
+	{
+		for(uint i=istart; i<iend; i++)
+		{
+			float f = din[i];
+			vmin = min(vmin, f);
+			vmax = max(vmax, f);
+			sum += f;
+		}
+		count = iend - istart;
+	}
+
+	//Weight each child's mean by the number of samples it covers (only the last one can be short)
+	else
+	{
+		vmax = din[istart*3 + 1];
+		for(uint i=istart; i<iend; i++)
+		{
+			uint n = min(childSpan, totalSamples - i*childSpan);
+			vmin = min(vmin, din[i*3]);
+			vmax = max(vmax, din[i*3 + 1]);
+			sum += din[i*3 + 2] * float(n);
+			count += n;
+		}
+	}
+
+	dout[nout*3] = vmin;
+	dout[nout*3 + 1] = vmax;
+	dout[nout*3 + 2] = sum / float(count);
+}
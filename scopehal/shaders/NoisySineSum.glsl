@@ -30,6 +30,8 @@
 #version 430
 #pragma shader_stage(compute)
 
+#include "CounterRNG.glsl"
+
 layout(std430, binding=0) restrict writeonly buffer buf_dout
 {
 	float dout[];
@@ -55,53 +57,23 @@ void main()
 	//Base thread ID
 	uint nthread = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
 
-	//Bounds for our generation
+	//Bounds for our generation (samplesPerThread is a multiple of 4, so every thread starts on an RNG block)
 	uint istart = nthread * samplesPerThread;
-	uint iend = istart + samplesPerThread;
-	if(iend >= numSamples)
-		iend = numSamples - 1;
-
-	const float twopi = 2 * 3.1415926535;
+	if(istart >= numSamples)
+		return;
+	uint iend = min(istart + samplesPerThread, numSamples);
 
-	//Create the output
-	uint lcgState = rngSeed + nthread;
-	for(uint i=istart; i <= iend; i += 2)
+	//Create the output, one block of four Gaussian values at a time
+	uvec2 key = uvec2(rngSeed, 0);
+	for(uint i=istart; i < iend; i += 4)
 	{
-		//Generate two pseudorandom uint32's with the first being nonzero
-		//Use glibc rand() parameters
-		uint rngOut[2] = {0, 0};
-		uint rngmax = 0xffffff;
-		for(uint j=0; j<2; j++)
-		{
-			while(rngOut[j] == 0)
-			{
-				lcgState = ( (lcgState * 1103515245) + 12345 ) & 0x7fffffff;
-				rngOut[j] = lcgState & rngmax;
-
-				if(j == 1)
-					break;
-			}
-		}
-
-		//Convert the random ints to floats in [0, 1]
-		float u1 = float(rngOut[0]) / float(rngmax);
-		float u2 = float(rngOut[1]) / float(rngmax);
-
-		//Convert to uniform distribution using Box-Muller
-		float mag = sigma * sqrt(-2 * log(u1));
-		float noise0 = mag * cos(twopi * u2);
-		float noise1 = mag * sin(twopi * u2);
-
-		//Generate the output (second sample needs separate bounds check)
-		dout[i] = scale *
-			(
-				sin(i * radiansPerSample1 + startPhase1) + sin(i * radiansPerSample2 + startPhase2)
-			) + noise0;
-		if(i+1 <= iend)
+		vec4 noise = sigma * CounterRNGGaussian4(i / 4, key);
+		for(uint j=0; (j < 4) && (i+j < iend); j++)
 		{
-			dout[i+1] = scale *
-				(sin((i+1) * radiansPerSample1 + startPhase1) + sin((i+1) * radiansPerSample2 + startPhase2)) +
-				noise1;
+			uint k = i + j;
+			dout[k] = scale *
+				(sin(k * radiansPerSample1 + startPhase1) + sin(k * radiansPerSample2 + startPhase2)) +
+				noise[j];
 		}
 	}
 }
@@ -0,0 +1,74 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Accessors for UniformPackedDigitalWaveform sample data
+
+	This is an include file, not a standalone shader. The packed buffer is viewed as an array of 32-bit words (two per
+	64-bit word on the CPU side, low half first), with sample i stored in bit (i & 31) of word (i >> 5).
+
+	GLSL cannot pass buffers to functions, so the accessors are macros taking the name of the array in the including
+	shader.
+ */
+
+#ifndef PackedDigital_glsl
+#define PackedDigital_glsl
+
+//Number of samples in one 32-bit word
+#define PACKED_DIGITAL_SAMPLES_PER_WORD 32u
+
+//Index of the word containing sample i
+#define PACKED_DIGITAL_WORD(i) ((i) >> 5)
+
+//Mask of sample i within its word
+#define PACKED_DIGITAL_MASK(i) (1u << ((i) & 31u))
+
+//Value of sample i of packed array buf, as a bool
+#define PACKED_DIGITAL_GET(buf, i) ((buf[PACKED_DIGITAL_WORD(i)] & PACKED_DIGITAL_MASK(i)) != 0u)
+
+/**
+	@brief Returns a mask of bits which differ from the bit below them (bit 0 compares against carry, the MSB of
+	the previous word)
+ */
+uint PackedDigitalToggles(uint word, uint prevWord)
+{
+	return word ^ ((word << 1) | (prevWord >> 31));
+}
+
+/**
+	@brief Returns the index within a word of the first bit at or above start with the given value, or -1 if none
+ */
+int PackedDigitalFindInWord(uint word, uint start, bool value)
+{
+	uint w = (value ? word : ~word) & (0xffffffffu << start);
+	return findLSB(w);
+}
+
+#endif
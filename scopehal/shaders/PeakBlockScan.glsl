@@ -0,0 +1,111 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 430
+#pragma shader_stage(compute)
+
+//First pass of PeakDetector: van Herk/Gil-Werman running max.
+//The input is padded with radius samples of -infinity at each end (and everything before minpeak is treated as
+//-infinity too), then cut into blocks of radius samples. For each block we record the max from the start of the
+//block to each sample (prefix) and from each sample to the end of the block (suffix). The max of any window of
+//exactly radius samples is then max(suffix[start], prefix[end]), whatever its alignment.
+
+layout(std430, binding=0) restrict readonly buffer buf_pin
+{
+	float pin[];
+};
+
+layout(std430, binding=1) restrict writeonly buffer buf_prefix
+{
+	float prefix[];
+};
+
+layout(std430, binding=2) restrict writeonly buffer buf_suffix
+{
+	float suffix[];
+};
+
+//Per-block min of the unpadded input, for the FWHM baseline
+layout(std430, binding=3) restrict writeonly buffer buf_blockMin
+{
+	float blockMin[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint size;
+	uint radius;
+	uint minpeak;
+	uint numBlocks;
+	uint capacity;
+	uint maxPeaks;
+	uint shift;
+	uint isDB;
+};
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+float PaddedSample(uint j)
+{
+	//Padded index j is input index j - radius
+	if( (j < radius + minpeak) || (j >= radius + size) )
+		return uintBitsToFloat(0xff800000);
+	return pin[j - radius];
+}
+
+void main()
+{
+	uint nblock = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+	if(nblock >= numBlocks)
+		return;
+
+	uint start = nblock * radius;
+	uint end = start + radius;
+
+	float fmax = uintBitsToFloat(0xff800000);
+	float fmin = uintBitsToFloat(0x7f800000);
+	for(uint j=start; j<end; j++)
+	{
+		float f = PaddedSample(j);
+		fmax = max(fmax, f);
+		prefix[j] = fmax;
+
+		//Baseline is over every real sample, including the ones left of minpeak
+		if( (j >= radius) && (j < radius + size) )
+			fmin = min(fmin, pin[j - radius]);
+	}
+	blockMin[nblock] = fmin;
+
+	fmax = uintBitsToFloat(0xff800000);
+	for(uint j=end; j>start; j--)
+	{
+		fmax = max(fmax, PaddedSample(j-1));
+		suffix[j-1] = fmax;
+	}
+}
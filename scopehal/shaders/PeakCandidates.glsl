@@ -0,0 +1,127 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 430
+#pragma shader_stage(compute)
+
+//Second pass of PeakDetector: a sample is a peak if it is strictly higher than everything within radius samples
+//on either side. Peaks are interpolated and appended to the candidate list, and the first radix select pass
+//histograms their magnitudes.
+
+layout(std430, binding=0) restrict readonly buffer buf_pin
+{
+	float pin[];
+};
+
+layout(std430, binding=1) restrict readonly buffer buf_prefix
+{
+	float prefix[];
+};
+
+layout(std430, binding=2) restrict readonly buffer buf_suffix
+{
+	float suffix[];
+};
+
+struct Candidate
+{
+	uint index;
+	float offset;
+	float mag;
+	uint key;
+};
+
+layout(std430, binding=3) restrict writeonly buffer buf_candidates
+{
+	Candidate candidates[];
+};
+
+//0 = candidate count, 8...263 = histogram (see PeakSelect)
+layout(std430, binding=4) restrict buffer buf_state
+{
+	uint state[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint size;
+	uint radius;
+	uint minpeak;
+	uint numBlocks;
+	uint capacity;
+	uint maxPeaks;
+	uint shift;
+	uint isDB;
+};
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+//Maps a float to a uint which sorts in the same order
+uint SortKey(float f)
+{
+	uint u = floatBitsToUint(f);
+	if( (u & 0x80000000) != 0)
+		return ~u;
+	return u | 0x80000000;
+}
+
+void main()
+{
+	uint i = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+	if( (i < minpeak) || (i >= size) )
+		return;
+
+	//Windows of radius samples either side of us, in padded coordinates
+	uint j = i + radius;
+	float leftMax = max(suffix[j - radius], prefix[j - 1]);
+	float rightMax = max(suffix[j + 1], prefix[j + radius]);
+
+	float beta = pin[i];
+	if( (beta <= leftMax) || (beta <= rightMax) )
+		return;
+
+	//Quadratic interpolate peak position and magnitude
+	//https://ccrma.stanford.edu/~jos/sasp/Quadratic_Interpolation_Spectral_Peaks.html
+	float alpha = pin[i-1];
+	float gamma = pin[min(i+1, size-1)];
+	float p = 0.5 * (alpha - gamma) / (alpha - 2*beta + gamma);
+	float lerpMag = beta - 0.25 * (alpha - gamma) * p;
+
+	uint slot = atomicAdd(state[0], 1);
+	if(slot >= capacity)
+		return;
+
+	uint key = SortKey(lerpMag);
+	candidates[slot].index = i;
+	candidates[slot].offset = p;
+	candidates[slot].mag = lerpMag;
+	candidates[slot].key = key;
+
+	atomicAdd(state[8 + (key >> 24)], 1);
+}
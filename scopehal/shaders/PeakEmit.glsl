@@ -0,0 +1,144 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 430
+#pragma shader_stage(compute)
+
+//Final pass of PeakDetector: writes out the selected candidates and measures their full width at half max.
+//Output order is arbitrary, the CPU sorts the (few) results.
+
+layout(std430, binding=0) restrict readonly buffer buf_pin
+{
+	float pin[];
+};
+
+struct Candidate
+{
+	uint index;
+	float offset;
+	float mag;
+	uint key;
+};
+
+layout(std430, binding=1) restrict readonly buffer buf_candidates
+{
+	Candidate candidates[];
+};
+
+//See PeakSelect for the layout
+layout(std430, binding=2) restrict buffer buf_state
+{
+	uint state[];
+};
+
+struct Result
+{
+	uint index;
+	float offset;
+	float mag;
+	uint hmleft;
+	uint hmright;
+};
+
+layout(std430, binding=3) restrict writeonly buffer buf_results
+{
+	Result results[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint size;
+	uint radius;
+	uint minpeak;
+	uint numBlocks;
+	uint capacity;
+	uint maxPeaks;
+	uint shift;
+	uint isDB;
+};
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+void main()
+{
+	uint n = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+	if(n >= state[0])
+		return;
+
+	//Everything above the threshold is selected, then ties at the threshold until we have maxPeaks
+	if(state[4] == 0)
+	{
+		uint key = candidates[n].key;
+		uint threshold = state[1];
+		if(key < threshold)
+			return;
+		if( (key == threshold) && (atomicAdd(state[6], 1) >= state[3]) )
+			return;
+	}
+
+	uint slot = atomicAdd(state[7], 1);
+	if(slot >= maxPeaks)
+		return;
+
+	//Move left and right from the peak until we get half magnitude
+	//If Y axis is dB, we want to be half *magnitude* not half dB
+	uint i = candidates[n].index;
+	float mag = candidates[n].mag;
+	float baseline = uintBitsToFloat(state[5]);
+	float hmtarget;
+	if(isDB != 0)
+		hmtarget = mag - 3;
+	else
+		hmtarget = (mag - baseline)/2 + baseline;
+
+	uint hmleft = i;
+	for(uint j=i+1; j > 0; j--)
+	{
+		if(pin[j-1] <= hmtarget)
+		{
+			hmleft = j-1;
+			break;
+		}
+	}
+	uint hmright = i;
+	for(uint j=i; j < size; j++)
+	{
+		if(pin[j] <= hmtarget)
+		{
+			hmright = j;
+			break;
+		}
+	}
+
+	results[slot].index = i;
+	results[slot].offset = candidates[n].offset;
+	results[slot].mag = mag;
+	results[slot].hmleft = hmleft;
+	results[slot].hmright = hmright;
+}
@@ -0,0 +1,130 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 430
+#pragma shader_stage(compute)
+
+//Radix select step of PeakDetector, run as a single workgroup after each histogram pass.
+//Walks the histogram of the current 8-bit digit from the top until it has seen maxPeaks candidates, fixes that
+//digit of the threshold key, and clears the histogram for the next pass.
+//
+//State layout:
+//	0	candidate count
+//	1	threshold key prefix found so far
+//	2	mask of the bits of the prefix which are valid
+//	3	number of candidates still to select which have exactly the prefix
+//	4	nonzero if every candidate is selected
+//	5	baseline (min of the input), as float bits
+//	6	tie counter, used by PeakEmit
+//	7	output count, used by PeakEmit
+//	8+	256 bin histogram
+
+layout(std430, binding=0) restrict readonly buffer buf_blockMin
+{
+	float blockMin[];
+};
+
+layout(std430, binding=1) restrict buffer buf_state
+{
+	uint state[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint size;
+	uint radius;
+	uint minpeak;
+	uint numBlocks;
+	uint capacity;
+	uint maxPeaks;
+	uint shift;
+	uint isDB;
+};
+
+#define NUM_LOCAL 64
+
+layout(local_size_x=NUM_LOCAL, local_size_y=1, local_size_z=1) in;
+
+shared float g_min[NUM_LOCAL];
+
+void main()
+{
+	uint lid = gl_LocalInvocationID.x;
+
+	//First pass: find the baseline too
+	if(shift == 24)
+	{
+		float fmin = uintBitsToFloat(0x7f800000);
+		for(uint i=lid; i<numBlocks; i += NUM_LOCAL)
+			fmin = min(fmin, blockMin[i]);
+		g_min[lid] = fmin;
+		barrier();
+
+		for(uint stride = NUM_LOCAL/2; stride > 0; stride /= 2)
+		{
+			if(lid < stride)
+				g_min[lid] = min(g_min[lid], g_min[lid + stride]);
+			barrier();
+		}
+
+		if(lid == 0)
+		{
+			uint count = min(state[0], capacity);
+			state[0] = count;
+			state[1] = 0;
+			state[2] = 0;
+			state[3] = maxPeaks;
+			state[4] = (count <= maxPeaks) ? 1 : 0;
+			state[5] = floatBitsToUint(g_min[0]);
+		}
+	}
+
+	if( (lid == 0) && (state[4] == 0) )
+	{
+		uint remaining = state[3];
+		uint cum = 0;
+		for(int bin=255; bin >= 0; bin--)
+		{
+			uint n = state[8 + bin];
+			if(cum + n >= remaining)
+			{
+				state[1] |= (uint(bin) << shift);
+				state[2] |= (0xff << shift);
+				state[3] = remaining - cum;
+				break;
+			}
+			cum += n;
+		}
+	}
+	memoryBarrierBuffer();
+	barrier();
+
+	for(uint i=lid; i<256; i += NUM_LOCAL)
+		state[8 + i] = 0;
+}
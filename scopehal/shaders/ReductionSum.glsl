@@ -69,13 +69,13 @@ void main()
 	if(nend > numSamples)
 		nend = numSamples;
 
-	//Kahan summation to improve numerical stability
-	float partialSum = 0;
-	float c = 0;
+	//Kahan summation to improve numerical stability, must not be reassociated by the compiler
+	precise float partialSum = 0;
+	precise float c = 0;
 	for(uint i=nstart; i<nend; i++)
 	{
-		float y = pin[i] - c;
-		float t = partialSum + y;
+		precise float y = pin[i] - c;
+		precise float t = partialSum + y;
 		c = (t - partialSum) - y;
 		partialSum = t;
 	}
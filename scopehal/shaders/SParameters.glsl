@@ -0,0 +1,134 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Interpolation helpers for SParameterVector data
+
+	This is an include file, not a standalone shader. Point data is laid out exactly like SParameterPoint on the CPU
+	(frequency in Hz, linear magnitude, phase in radians) and one buffer may hold several vectors back to back.
+
+	GLSL cannot pass buffers to functions, so this file declares the (read only) point buffer itself. The including
+	shader must #define SPARAM_POINTS_BINDING to the descriptor slot to use before including it.
+ */
+
+#ifndef SParameters_glsl
+#define SParameters_glsl
+
+#ifndef SPARAM_POINTS_BINDING
+#error SPARAM_POINTS_BINDING must be defined before including SParameters.glsl
+#endif
+
+struct SParameterPoint
+{
+	float frequency;	//Hz
+	float amplitude;	//magnitude
+	float phase;		//radians
+};
+
+layout(std430, binding=SPARAM_POINTS_BINDING) restrict readonly buffer buf_sparams
+{
+	SParameterPoint sparams[];
+};
+
+#define SPARAM_PI 3.14159265358979323846
+
+/**
+	@brief Interpolates a phase angle, wrapping appropriately (same as SParameterVector::InterpolatePhase)
+ */
+float SParameterInterpolatePhase(float phase_lo, float phase_hi, float frac)
+{
+	if(abs(phase_lo - phase_hi) > SPARAM_PI)
+	{
+		if(phase_lo < phase_hi)
+			phase_lo += 2*SPARAM_PI;
+		else
+			phase_hi += 2*SPARAM_PI;
+	}
+
+	float ret = phase_lo + (phase_hi - phase_lo)*frac;
+	if(ret > 2*SPARAM_PI)
+		ret -= 2*SPARAM_PI;
+	return ret;
+}
+
+/**
+	@brief Interpolates the vector of len points starting at base to the given frequency
+
+	Out of range behavior matches SParameterVector::InterpolatePoint().
+
+	@return Magnitude in x, phase in y
+ */
+vec2 SParameterInterpolate(uint base, uint len, float freq)
+{
+	if(len == 0)
+		return vec2(0, 0);
+
+	//Below the first point: use its insertion loss, but interpolate phase to zero at DC
+	SParameterPoint first = sparams[base];
+	if(freq < first.frequency)
+		return vec2(first.amplitude, SParameterInterpolatePhase(0, first.phase, freq / first.frequency));
+
+	//Above the last point: no response
+	if(freq > sparams[base + len - 1].frequency)
+		return vec2(0, 0);
+
+	//Binary search for the points straddling us
+	uint lo = 0;
+	uint hi = len - 1;
+	while( (hi - lo) > 1)
+	{
+		uint mid = lo + (hi - lo)/2;
+		if(sparams[base + mid].frequency > freq)
+			hi = mid;
+		else
+			lo = mid;
+	}
+
+	SParameterPoint plo = sparams[base + lo];
+	SParameterPoint phi = sparams[base + hi];
+	float dfreq = phi.frequency - plo.frequency;
+	float frac = 0;
+	if(dfreq > 1.192092896e-07)
+		frac = (freq - plo.frequency) / dfreq;
+
+	return vec2(
+		plo.amplitude + (phi.amplitude - plo.amplitude)*frac,
+		SParameterInterpolatePhase(plo.phase, phi.phase, frac));
+}
+
+/**
+	@brief Converts a magnitude/phase pair to a complex number
+ */
+vec2 SParameterToComplex(vec2 magPhase)
+{
+	return magPhase.x * vec2(cos(magPhase.y), sin(magPhase.y));
+}
+
+#endif
@@ -0,0 +1,106 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 430
+#pragma shader_stage(compute)
+
+//Raw frames, ringDepth frames of npoints each, in detector pixel order
+layout(std430, binding=0) restrict readonly buffer buf_frames
+{
+	float frames[];
+};
+
+//Dark frame, in display (output) order. Only read if hasDark is set
+layout(std430, binding=1) restrict readonly buffer buf_dark
+{
+	float dark[];
+};
+
+//Flatness calibration, in display order
+layout(std430, binding=2) restrict readonly buffer buf_flat
+{
+	float flatcal[];
+};
+
+//Irradiance calibration, in display order
+layout(std430, binding=3) restrict readonly buffer buf_irr
+{
+	float irrcal[];
+};
+
+layout(std430, binding=4) restrict writeonly buffer buf_rawOut
+{
+	float rawOut[];
+};
+
+layout(std430, binding=5) restrict writeonly buffer buf_flatOut
+{
+	float flatOut[];
+};
+
+layout(std430, binding=6) restrict writeonly buffer buf_irrOut
+{
+	float irrOut[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint npoints;
+	uint nframes;
+	uint reverse;
+	uint hasDark;
+	float exposureScale;
+	float irradianceScale;
+};
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+void main()
+{
+	uint i = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+
+	//If off end of array, stop
+	if(i >= npoints)
+		return;
+
+	//Average the raw frames
+	uint pixel = (reverse != 0) ? (npoints - 1 - i) : i;
+	float sum = 0;
+	for(uint k=0; k<nframes; k++)
+		sum += frames[k*npoints + pixel];
+	float raw = sum / float(nframes);
+	rawOut[i] = raw;
+
+	//Dark frame and flatness correction, then normalize to the exposure time
+	float d = (hasDark != 0) ? dark[i] : 0;
+	float flattened = ((raw - d) / flatcal[i]) * exposureScale;
+	flatOut[i] = flattened;
+
+	irrOut[i] = flattened * irrcal[i] * irradianceScale;
+}
@@ -0,0 +1,97 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 430
+#pragma shader_stage(compute)
+
+layout(std430, binding=0) restrict readonly buffer buf_din
+{
+	float din[];
+};
+
+//Not restrict: single output modes bind out0 here too (but never access it)
+layout(std430, binding=1) buffer buf_out0
+{
+	float out0[];
+};
+
+layout(std430, binding=2) buffer buf_out1
+{
+	float out1[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint len;
+	uint validLen;
+	uint mode;
+	float delta;
+	float coeff;
+};
+
+#define ACCUM_MAX			0
+#define ACCUM_MIN			1
+#define ACCUM_ENVELOPE		2
+#define ACCUM_EXPONENTIAL	3
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+void main()
+{
+	uint i = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+
+	//If off end of array, stop
+	if(i >= len)
+		return;
+
+	float v = din[i];
+	if( (delta != 0) && (i+1 < len) )
+		v += (din[i+1] - v) * delta;
+
+	//No existing state? Start it from the input
+	if(i >= validLen)
+	{
+		out0[i] = v;
+		if(mode == ACCUM_ENVELOPE)
+			out1[i] = v;
+		return;
+	}
+
+	if(mode == ACCUM_MAX)
+		out0[i] = max(out0[i], v);
+	else if(mode == ACCUM_MIN)
+		out0[i] = min(out0[i], v);
+	else if(mode == ACCUM_ENVELOPE)
+	{
+		out0[i] = max(out0[i], v);
+		out1[i] = min(out1[i], v);
+	}
+	else
+		out0[i] = out0[i]*coeff + v*(1-coeff);
+}
@@ -71,6 +71,12 @@ Filter::DataLocation ACCoupleFilter::GetInputLocation()
 	return LOC_DONTCARE;
 }
 
+bool ACCoupleFilter::ConsumesInputsOnGpu()
+{
+	//Input samples are only ever read by our shaders
+	return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
@@ -136,5 +142,5 @@ void ACCoupleFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHa
 		compute_block_count / 32768 + 1);
 
 	cmdBuf.end();
-	queue->SubmitAndBlock(cmdBuf);
+	queue->SubmitDeferred(cmdBuf);
 }
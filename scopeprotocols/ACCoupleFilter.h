@@ -52,6 +52,7 @@ public:
 
 	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
 	virtual DataLocation GetInputLocation() override;
+	virtual bool ConsumesInputsOnGpu() override;
 
 	static std::string GetProtocolName();
 
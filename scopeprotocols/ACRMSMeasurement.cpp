@@ -128,24 +128,14 @@ void ACRMSMeasurement::DoRefreshSparse(SparseAnalogWaveform* wfm)
 
 	//Calculate the global RMS value
 	//Sum the squares of all values after subtracting the DC value
-	//Kahan summation for improved accuracy
-	float temp = 0;
-	float c = 0;
-	for (size_t i = 0; i < length; i++)
-	{
-		float delta = wfm->m_samples[i] - average;
-		float deltaSquared = delta * delta;
-		float y = deltaSquared - c;
-		float t = temp + y;
-		c = (t - temp) - y;
-		temp = t;
-	}
+	//Compensated summation for improved accuracy
+	const float* samples = wfm->m_samples.GetCpuPointer();
+	double sum = g_simdKernels.sumSquares(samples, length, average);
 
 	//Divide by total number of samples and take the square root to get the final AC RMS
-	m_streams[1].m_value = sqrt(temp / length);
+	m_streams[1].m_value = sqrt(sum / length);
 
 	//Now we can do the cycle-by-cycle value
-	temp = 0;
 	vector<int64_t> edges;
 
 	//Auto-threshold analog signals at average of the full scale range
@@ -173,11 +163,10 @@ void ACRMSMeasurement::DoRefreshSparse(SparseAnalogWaveform* wfm)
 		//Measure from edge to 2 edges later, since we find all zero crossings regardless of polarity
 		int64_t start = edges[i] / wfm->m_timescale;
 		int64_t end = edges[i + 2] / wfm->m_timescale;
-		int64_t j = 0;
+		int64_t j = max(start, min(end + 1, (int64_t)length));
 
 		//Simply sum the squares of all values in a cycle after subtracting the DC value
-		for(j = start; (j <= end) && (j < (int64_t)length); j++)
-			temp += ((wfm->m_samples[j] - average) * (wfm->m_samples[j] - average));
+		sum = g_simdKernels.sumSquares(samples + start, j - start, average);
 
 		//Get the difference between the end and start of cycle. This would be the number of samples
 		//on which AC RMS calculation was performed
@@ -185,11 +174,8 @@ void ACRMSMeasurement::DoRefreshSparse(SparseAnalogWaveform* wfm)
 
 		if (delta != 0)
 		{
-			//Divide by total number of samples for one cycle
-			temp /= delta;
-
-			//Take square root to get the final AC RMS Value of one cycle
-			temp = sqrt(temp);
+			//Divide by total number of samples for one cycle, then take square root to get the RMS of one cycle
+			float temp = sqrt(sum / delta);
 
 			//Push values to the waveform
 			cap->m_offsets.push_back(start);
@@ -207,7 +193,8 @@ void ACRMSMeasurement::DoRefreshUniform(
 	vk::raii::CommandBuffer& cmdBuf,
 	shared_ptr<QueueHandle> queue)
 {
-	float average = m_averager.Average(wfm, cmdBuf, queue);
+	//Average comes from the shared waveform statistics, so other measurements on this channel reuse it
+	float average = AnalogStatistics::Get(wfm)->GetAverage();
 	auto length = wfm->size();
 
 	//This value experimentally gives the best speedup for an NVIDIA 2080 Ti vs an Intel Xeon Gold 6144
@@ -230,18 +217,16 @@ void ACRMSMeasurement::DoRefreshUniform(
 	queue->SubmitAndBlock(cmdBuf);
 
 	//Do the final summation of the temporary results
-	//These should all be roughly equal in value (famous last words) so don't both with Kahan here
 	m_temporaryResults.PrepareForCpuAccess();
-	float temp = 0;
-	for(uint64_t i=0; i<numThreads; i++)
-		temp += m_temporaryResults[i];
+	double sum = g_simdKernels.sum(m_temporaryResults.GetCpuPointer(), numThreads);
 
 	//Divide by total number of samples and take the square root to get the final AC RMS
-	m_streams[1].m_value = sqrt(temp / length);
+	m_streams[1].m_value = sqrt(sum / length);
 
 	//Auto-threshold analog signals at average of the full scale range
-	size_t elen = m_detector.FindZeroCrossings(wfm, average, cmdBuf, queue);
-	auto& edges = m_detector.GetResults();
+	auto crossings = LevelCrossingList::Get(wfm, average);
+	size_t elen = crossings->size();
+	auto& edges = crossings->m_crossings;
 
 	//We need at least one full cycle of the waveform to have a meaningful AC RMS Measurement
 	if(elen < 2)
@@ -291,31 +276,26 @@ void ACRMSMeasurement::DoRefreshUniform(
 	{
 		cap->PrepareForCpuAccess();
 		edges.PrepareForCpuAccess();
-		temp = 0;
+		const float* samples = wfm->m_samples.GetCpuPointer();
 		for(size_t i = 0; i < (elen - 2); i += 2)
 		{
 			//Measure from edge to 2 edges later, since we find all zero crossings regardless of polarity
 			int64_t start = edges[i] / wfm->m_timescale;
 			int64_t end = edges[i + 2] / wfm->m_timescale;
-			int64_t j = 0;
+			int64_t j = max(start, min(end + 1, (int64_t)length));
 
 			//Simply sum the squares of all values in a cycle after subtracting the DC value
-			temp = 0;
-			for(j = start; (j <= end) && (j < (int64_t)length); j++)
-				temp += ((wfm->m_samples[j] - average) * (wfm->m_samples[j] - average));
+			sum = g_simdKernels.sumSquares(samples + start, j - start, average);
 
 			//Get the difference between the end and start of cycle. This would be the number of samples
 			//on which AC RMS calculation was performed
 			int64_t delta = j - start - 1;
 
 			//Divide by total number of samples for one cycle (with divide-by-zero check for garbage input)
-			if (delta == 0)
-				temp = 0;
-			else
-				temp /= delta;
-
-			//Take square root to get the final AC RMS Value of one cycle
-			temp = sqrt(temp);
+			//then take square root to get the final AC RMS Value of one cycle
+			float temp = 0;
+			if (delta != 0)
+				temp = sqrt(sum / delta);
 
 			//Push values to the waveform
 			size_t nout = i/2;
@@ -36,7 +36,6 @@
 #define ACRMSMeasurement_h
 
 #include "../scopehal/Averager.h"
-#include "../scopehal/LevelCrossingDetector.h"
 
 struct __attribute__((packed)) ACRMSPushConstants
 {
@@ -73,9 +72,6 @@ protected:
 		vk::raii::CommandBuffer& cmdBuf,
 		std::shared_ptr<QueueHandle> queue);
 
-	Averager m_averager;
-	LevelCrossingDetector m_detector;
-
 	std::unique_ptr<ComputePipeline> m_rmsComputePipeline;
 	AcceleratorBuffer<float> m_temporaryResults;
 
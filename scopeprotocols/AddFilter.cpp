@@ -78,6 +78,8 @@ string AddFilter::GetProtocolName()
 
 void AddFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
+	ExpandRawInputs();
+
 	ClearErrors();
 
 	bool veca = GetInput(0).GetType() == Stream::STREAM_TYPE_ANALOG;
@@ -120,40 +122,8 @@ void AddFilter::DoRefreshScalarVector(size_t iScalar, size_t iVector)
 		SetData(nullptr, 0);
 		return;
 	}
-	din->PrepareForCpuAccess();
-	auto len = din->size();
-
-	auto sparse = dynamic_cast<SparseAnalogWaveform*>(din);
-	auto uniform = dynamic_cast<UniformAnalogWaveform*>(din);
-
-	if(sparse)
-	{
-		//Set up the output waveform
-		auto cap = SetupSparseOutputWaveform(sparse, 0, 0, 0);
-		cap->Resize(len);
-		cap->PrepareForCpuAccess();
-
-		float* fin = (float*)__builtin_assume_aligned(sparse->m_samples.GetCpuPointer(), 16);
-		float* fdst = (float*)__builtin_assume_aligned(cap->m_samples.GetCpuPointer(), 16);
-		for(size_t i=0; i<len; i++)
-			fdst[i] = fin[i] + scale;
-
-		cap->MarkModifiedFromCpu();
-	}
-	else
-	{
-		//Set up the output waveform
-		auto cap = SetupEmptyUniformAnalogOutputWaveform(uniform, 0);
-		cap->Resize(len);
-		cap->PrepareForCpuAccess();
-
-		float* fin = (float*)__builtin_assume_aligned(uniform->m_samples.GetCpuPointer(), 16);
-		float* fdst = (float*)__builtin_assume_aligned(cap->m_samples.GetCpuPointer(), 16);
-		for(size_t i=0; i<len; i++)
-			fdst[i] = fin[i] + scale;
-
-		cap->MarkModifiedFromCpu();
-	}
+	VisitWaveform<float>(din, [&](auto w)
+		{ ApplyPointwise(w, 0, [scale](float v) { return v + scale; }); });
 }
 
 void AddFilter::DoRefreshVectorVector(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue)
@@ -173,10 +143,10 @@ void AddFilter::DoRefreshVectorVector(vk::raii::CommandBuffer& cmdBuf, std::shar
 	//Get inputs
 	auto din_p = GetInputWaveform(0);
 	auto din_n = GetInputWaveform(1);
-	auto sdin_p = dynamic_cast<SparseAnalogWaveform*>(din_p);
-	auto sdin_n = dynamic_cast<SparseAnalogWaveform*>(din_n);
-	auto udin_p = dynamic_cast<UniformAnalogWaveform*>(din_p);
-	auto udin_n = dynamic_cast<UniformAnalogWaveform*>(din_n);
+	auto sdin_p = WaveformCast<SparseAnalogWaveform>(din_p);
+	auto sdin_n = WaveformCast<SparseAnalogWaveform>(din_n);
+	auto udin_p = WaveformCast<UniformAnalogWaveform>(din_p);
+	auto udin_n = WaveformCast<UniformAnalogWaveform>(din_n);
 
 	//Set up units and complain if they're inconsistent
 	m_xAxisUnit = m_inputs[0].m_channel->GetXAxisUnits();
@@ -189,81 +159,98 @@ void AddFilter::DoRefreshVectorVector(vk::raii::CommandBuffer& cmdBuf, std::shar
 		return;
 	}
 
-	//We need meaningful data
-	size_t len = min(din_p->size(), din_n->size());
-
-	//Setup output waveform
-	UniformAnalogWaveform* ucap = nullptr;
-	SparseAnalogWaveform* scap = nullptr;
-	if(sdin_p && sdin_n)
-		scap = SetupSparseOutputWaveform(sdin_p, 0, 0, 0);
-	else if(udin_p && udin_n)
-	{
-		ucap = SetupEmptyUniformAnalogOutputWaveform(udin_p, 0);
-		ucap->Resize(len);
-	}
-
-	//Mixed sparse/uniform not allowed
-	else
+	//Special case if input units are degrees: we want to do modular arithmetic
+	//TODO: vectorized version of this
+	if(GetYAxisUnits(0) == Unit::UNIT_DEGREES)
 	{
-		AddErrorMessage("Inconsistent types", "This block does not support mixing sparse and uniform waveforms");
-		SetData(nullptr, 0);
+		VisitWaveforms<float, float>(din_p, din_n, [&](auto a, auto b)
+			{ ApplyPointwise(a, b, 0, [](float va, float vb) { return WrapDegrees(va + vb); }); });
 		return;
 	}
 
-	//Special case if input units are degrees: we want to do modular arithmetic
-	//TODO: vectorized version of this
-	if(GetYAxisUnits(0) == Unit::UNIT_DEGREES)
+	//Mixed sparse/uniform inputs have to be lined up in time, which the shader doesn't do
+	if( !(sdin_p && sdin_n) && !(udin_p && udin_n) )
 	{
-		//Waveform data must be on CPU
-		din_p->PrepareForCpuAccess();
-		din_n->PrepareForCpuAccess();
-		if(scap)
-			scap->PrepareForCpuAccess();
-		else
-			ucap->PrepareForCpuAccess();
-
-		float* out = scap ? scap->m_samples.GetCpuPointer() : ucap->m_samples.GetCpuPointer();
-		float* a = sdin_p ? sdin_p->m_samples.GetCpuPointer() : udin_p->m_samples.GetCpuPointer();
-		float* b = sdin_n ? sdin_n->m_samples.GetCpuPointer() : udin_n->m_samples.GetCpuPointer();
-
-		for(size_t i=0; i<len; i++)
+		if(!VisitWaveforms<float, float>(din_p, din_n, [&](auto a, auto b)
+			{ ApplyPointwise(a, b, 0, [](float va, float vb) { return va + vb; }); }))
 		{
-			out[i] 		= a[i] + b[i];
-			if(out[i] < -180)
-				out[i] += 360;
-			if(out[i] > 180)
-				out[i] -= 360;
+			AddErrorMessage("Invalid input", "Inputs must be analog waveforms");
+			SetData(nullptr, 0);
 		}
-
-		if(scap)
-			scap->m_samples.MarkModifiedFromCpu();
-		else
-			ucap->m_samples.MarkModifiedFromCpu();
+		return;
 	}
 
+	//We need meaningful data
+	size_t len = min(din_p->size(), din_n->size());
+
+	//Setup output waveform
+	UniformAnalogWaveform* ucap = nullptr;
+	SparseAnalogWaveform* scap = nullptr;
+	if(sdin_p)
+		scap = SetupAnalogOutputWaveformLike(sdin_p, 0, len);
+	else
+		ucap = SetupAnalogOutputWaveformLike(udin_p, 0, len);
+
 	//Just regular addition, use the GPU filter
+	cmdBuf.begin({});
+
+	m_computePipeline.BindBufferNonblocking(0, sdin_p ? sdin_p->m_samples : udin_p->m_samples, cmdBuf);
+	m_computePipeline.BindBufferNonblocking(1, sdin_n ? sdin_n->m_samples : udin_n->m_samples, cmdBuf);
+	m_computePipeline.BindBufferNonblocking(2, scap ? scap->m_samples : ucap->m_samples, cmdBuf, true);
+	const uint32_t compute_block_count = GetComputeBlockCount(len, 64);
+	m_computePipeline.Dispatch(cmdBuf, (uint32_t)len,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
+
+	cmdBuf.end();
+	queue->SubmitAndBlock(cmdBuf);
+
+	if(scap)
+		scap->m_samples.MarkModifiedFromGpu();
 	else
+		ucap->m_samples.MarkModifiedFromGpu();
+}
+
+bool AddFilter::SetupElementwiseOp(ElementwiseOp& op)
+{
+	//Only plain addition of two uniform waveforms can be fused, DoRefreshVectorVector() deals with everything else
+	if( (GetInput(0).GetType() != Stream::STREAM_TYPE_ANALOG) || (GetInput(1).GetType() != Stream::STREAM_TYPE_ANALOG) )
+		return false;
+	if(!VerifyAllInputsOK())
+		return false;
+	auto a = WaveformCast<UniformAnalogWaveform>(GetInputWaveform(0));
+	auto b = WaveformCast<UniformAnalogWaveform>(GetInputWaveform(1));
+	if(!a || !b)
+		return false;
+
+	auto xunit = m_inputs[0].m_channel->GetXAxisUnits();
+	auto yunit = m_inputs[0].GetYAxisUnits();
+	if( (xunit != m_inputs[1].m_channel->GetXAxisUnits()) || (yunit != m_inputs[1].GetYAxisUnits()) ||
+		(yunit == Unit::UNIT_DEGREES) )
 	{
-		cmdBuf.begin({});
-
-		m_computePipeline.BindBufferNonblocking(0, sdin_p ? sdin_p->m_samples : udin_p->m_samples, cmdBuf);
-		m_computePipeline.BindBufferNonblocking(1, sdin_n ? sdin_n->m_samples : udin_n->m_samples, cmdBuf);
-		m_computePipeline.BindBufferNonblocking(2, scap ? scap->m_samples : ucap->m_samples, cmdBuf, true);
-		const uint32_t compute_block_count = GetComputeBlockCount(len, 64);
-		m_computePipeline.Dispatch(cmdBuf, (uint32_t)len,
-			min(compute_block_count, 32768u),
-			compute_block_count / 32768 + 1);
-
-		cmdBuf.end();
-		queue->SubmitAndBlock(cmdBuf);
-
-		if(scap)
-			scap->m_samples.MarkModifiedFromGpu();
-		else
-			ucap->m_samples.MarkModifiedFromGpu();
+		return false;
 	}
 
+	ClearErrors();
+	m_xAxisUnit = xunit;
+	SetYAxisUnits(yunit, 0);
+
+	size_t len = min(a->size(), b->size());
+	auto cap = SetupEmptyUniformAnalogOutputWaveform(a, 0);
+	cap->Resize(len);
+
+	op.m_type = ElementwiseOp::OP_ADD;
+	op.m_inputs[0] = a;
+	op.m_inputs[1] = b;
+	op.m_output = cap;
+	op.m_len = len;
+	return true;
+}
+
+bool AddFilter::AcceptsRawSamples(size_t /*i*/)
+{
+	//The fused elementwise kernel reads raw ADC codes in place; Refresh() converts them if we don't get fused
+	return true;
 }
 
 Filter::DataLocation AddFilter::GetInputLocation()
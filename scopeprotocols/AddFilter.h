@@ -44,6 +44,8 @@ public:
 	~AddFilter();
 
 	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
+	virtual bool SetupElementwiseOp(ElementwiseOp& op) override;
+	virtual bool AcceptsRawSamples(size_t i) override;
 	virtual DataLocation GetInputLocation() override;
 
 	static std::string GetProtocolName();
@@ -194,21 +194,27 @@ void AreaMeasurement::Refresh(
 			//Measure from edge to 2 edges later, since we find all zero crossings regardless of polarity
 			int64_t start = edges[i] / din->m_timescale;
 			int64_t end = edges[i + 2] / din->m_timescale;
-			int64_t j = 0;
+			int64_t j = max(start, min(end + 1, (int64_t)length));
 
-			KahanSummation sum;
+			double sum = 0;
 			if(uadin)
 			{
-				for(j = start; (j <= end) && (j < (int64_t)length); j++)
-					sum += ((area_type == TRUE_AREA) ? uadin->m_samples[j] : fabs(uadin->m_samples[j]));
+				//Uniform samples all have the same weight, so this is a plain sum
+				const float* samples = uadin->m_samples.GetCpuPointer() + start;
+				if(area_type == TRUE_AREA)
+					sum = g_simdKernels.sum(samples, j - start);
+				else
+					sum = g_simdKernels.sumAbs(samples, j - start);
 			}
 			else if(sadin)
 			{
-				for(j = start; (j <= end) && (j < (int64_t)length); j++)
+				KahanSummation ksum;
+				for(int64_t k = start; k < j; k++)
 				{
-					sum += ((((area_type == TRUE_AREA) ? sadin->m_samples[j] : fabs(sadin->m_samples[j]))
-						* sadin->m_durations[j]));
+					ksum += ((((area_type == TRUE_AREA) ? sadin->m_samples[k] : fabs(sadin->m_samples[k]))
+						* sadin->m_durations[k]));
 				}
+				sum = ksum.GetSum();
 			}
 
 			//Get the difference between the end and start of cycle. This would be the number of samples
@@ -220,7 +226,7 @@ void AreaMeasurement::Refresh(
 				//Push values to the waveform
 				cap->m_offsets.push_back(start);
 				cap->m_durations.push_back(delta);
-				cap->m_samples.push_back((sum.GetSum() * din->m_timescale) / FS_PER_SECOND);
+				cap->m_samples.push_back((sum * din->m_timescale) / FS_PER_SECOND);
 			}
 		}
 
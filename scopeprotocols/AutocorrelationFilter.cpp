@@ -71,9 +71,7 @@ string AutocorrelationFilter::GetProtocolName()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
-void AutocorrelationFilter::Refresh(
-	[[maybe_unused]] vk::raii::CommandBuffer& cmdBuf,
-	[[maybe_unused]] shared_ptr<QueueHandle> queue)
+void AutocorrelationFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
 	ClearErrors();
 	if(!VerifyAllInputsOKAndUniformAnalog())
@@ -106,10 +104,21 @@ void AutocorrelationFilter::Refresh(
 
 	//Set up the output waveform
 	auto cap = SetupEmptyUniformAnalogOutputWaveform(din, 0, true);
+	size_t end = len - range;
+
+	//Short ranges are cheaper to do directly, longer ones are O(N log N) via FFT
+	if(range >= 64)
+	{
+		m_correlator.Correlate(cmdBuf, queue, din->m_samples, end, WaveformCacheKey(), din->m_samples, len, 1, range,
+			cap->m_samples);
+		cap->MarkModifiedFromGpu();
+		SetData(cap, 0);
+		return;
+	}
+
 	cap->PrepareForCpuAccess();
 	din->PrepareForCpuAccess();
 
-	size_t end = len - range;
 	for(size_t delta=1; delta <= range; delta ++)
 	{
 		double total = 0;
@@ -35,6 +35,8 @@
 #ifndef AutocorrelationFilter_h
 #define AutocorrelationFilter_h
 
+#include "CrossCorrelator.h"
+
 class AutocorrelationFilter : public Filter
 {
 public:
@@ -50,6 +52,8 @@ public:
 
 protected:
 	std::string m_maxDeltaName;
+
+	CrossCorrelator m_correlator;
 };
 
 #endif
@@ -43,6 +43,15 @@ BusHeatmapFilter::BusHeatmapFilter(const string& color)
 	, m_maxAddress("Max Address")
 	, m_yBinSize("Y Bin Size")
 	, m_xBinSize("X Bin Size")
+	, m_countMax(0)
+	, m_binnedCount(0)
+	, m_binnedLastOffset(0)
+	, m_binnedTimestamp(0)
+	, m_binnedFemtoseconds(0)
+	, m_binnedTimescale(0)
+	, m_binnedXscale(0)
+	, m_binnedYscale(0)
+	, m_binnedYsize(0)
 {
 	AddStream(Unit(Unit::UNIT_HEXNUM), "data", Stream::STREAM_TYPE_SPECTROGRAM);
 
@@ -138,11 +147,72 @@ void BusHeatmapFilter::Refresh(
 	}
 	size_t ysize = (maxy + 1) / yscale;
 
-	auto nlast = din->m_offsets.size() - 1;
-	size_t nblocks = ( din->m_offsets[nlast] * din->m_timescale ) / xscale;
+	auto nin = din->m_offsets.size();
+	if(nin == 0)
+	{
+		SetData(nullptr, 0);
+		return;
+	}
+	size_t nblocks = ( din->m_offsets[nin-1] * din->m_timescale ) / xscale + 1;
+
+	//If the input is the same capture as last time with more packets appended (as when a streaming decode grows),
+	//keep our existing counts and only bin the new packets. Anything else means starting over.
+	bool appended =
+		(m_binnedCount > 0) &&
+		(nin >= m_binnedCount) &&
+		(din->m_startTimestamp == m_binnedTimestamp) &&
+		(din->m_startFemtoseconds == m_binnedFemtoseconds) &&
+		(din->m_timescale == m_binnedTimescale) &&
+		(xscale == m_binnedXscale) &&
+		(yscale == m_binnedYscale) &&
+		(ysize == m_binnedYsize) &&
+		(din->m_offsets[m_binnedCount-1] == m_binnedLastOffset);
+	if(!appended)
+	{
+		m_counts.clear();
+		m_countMax = 0;
+		m_binnedCount = 0;
+		m_binnedTimestamp = din->m_startTimestamp;
+		m_binnedFemtoseconds = din->m_startFemtoseconds;
+		m_binnedTimescale = din->m_timescale;
+		m_binnedXscale = xscale;
+		m_binnedYscale = yscale;
+		m_binnedYsize = ysize;
+	}
+
+	//Offsets are monotonic so the width only ever grows, and new columns are appended at the end
+	m_counts.resize(nblocks * ysize, 0);
+
+	//Integrate new packets, remembering which bins changed
+	uint32_t oldMax = m_countMax;
+	vector<size_t> touched;
+	for(size_t i=m_binnedCount; i<nin; i++)
+	{
+		//Only look at CAN ID packets, ignore anything else
+		auto& s = din->m_samples[i];
+		if(s.m_stype != CANSymbol::TYPE_ID)
+			continue;
+
+		//Get X/Y histogram bins
+		size_t xbin = din->m_offsets[i] * din->m_timescale / xscale;
+		size_t ybin = s.m_data / yscale;
+
+		//Discard any off scale pixels
+		if(ybin >= ysize)
+			continue;
+
+		//Increment the bin
+		size_t icount = xbin*ysize + ybin;
+		auto f = ++ m_counts[icount];
+		m_countMax = max(m_countMax, f);
+		touched.push_back(icount);
+	}
+	m_binnedCount = nin;
+	m_binnedLastOffset = din->m_offsets[nin-1];
 
 	//Create the output
 	SpectrogramWaveform* cap = dynamic_cast<SpectrogramWaveform*>(GetData(0));
+	bool reuse = false;
 	if(cap)
 	{
 		if( (cap->GetBinSize() == yscale) &&
@@ -150,6 +220,7 @@ void BusHeatmapFilter::Refresh(
 			(cap->GetHeight() == ysize) )
 		{
 			//same config, we can reuse it
+			reuse = true;
 		}
 
 		//no, ignore it
@@ -173,39 +244,31 @@ void BusHeatmapFilter::Refresh(
 	cap->PrepareForCpuAccess();
 	SetData(cap, 0);
 
-	//Fill the buffer with zeroes
-	size_t len = ysize * nblocks;
 	auto& buf = cap->GetOutData();
 	auto p = buf.GetCpuPointer();
-	memset(p, 0, len*sizeof(float));
+	float norm = (m_countMax == 0) ? 0 : (1.0f / m_countMax);
 
-	//Integrate packets
-	auto nin = din->m_offsets.size();
-	float nmax = 0;
-	for(size_t i=0; i<nin; i++)
+	//If the output already holds our previous result and the peak didn't move, only the touched bins need rewriting
+	if(appended && reuse && (oldMax == m_countMax))
 	{
-		//Only look at CAN ID packets, ignore anything else
-		auto s = din->m_samples[i];
-		if(s.m_stype != CANSymbol::TYPE_ID)
-			continue;
-
-		//Get X/Y histogram bins
-		auto xbin = din->m_offsets[i] * din->m_timescale / xscale;
-		size_t ybin = s.m_data / yscale;
-
-		//Discard any off scale pixels
-		if(ybin >= ysize)
-			continue;
-
-		//Increment the bin
-		auto f = p[ybin*nblocks + xbin] ++;
-		nmax = max(nmax, f);
+		for(auto icount : touched)
+		{
+			size_t xbin = icount / ysize;
+			size_t ybin = icount % ysize;
+			p[ybin*nblocks + xbin] = m_counts[icount] * norm;
+		}
 	}
 
-	//Normalize
-	float norm = 1.0 / nmax;
-	for(size_t i=0; i<len; i++)
-		p[i] *= norm;
+	//Otherwise renormalize the whole image
+	else
+	{
+		for(size_t xbin=0; xbin<nblocks; xbin++)
+		{
+			auto col = &m_counts[xbin*ysize];
+			for(size_t ybin=0; ybin<ysize; ybin++)
+				p[ybin*nblocks + xbin] = col[ybin] * norm;
+		}
+	}
 
 	//Done
 	cap->MarkModifiedFromCpu();
@@ -56,6 +56,28 @@ protected:
 	std::string m_maxAddress;
 	std::string m_yBinSize;
 	std::string m_xBinSize;
+
+	///@brief Packet counts, stored column-major (one column of ysize bins per X block) so the width can grow cheaply
+	std::vector<uint32_t> m_counts;
+
+	///@brief Largest value in m_counts
+	uint32_t m_countMax;
+
+	///@brief Number of input samples already binned into m_counts
+	size_t m_binnedCount;
+
+	///@brief Offset of the last input sample already binned, used to detect appended vs replaced input
+	int64_t m_binnedLastOffset;
+
+	///@brief Input timebase the counts were binned against
+	time_t m_binnedTimestamp;
+	int64_t m_binnedFemtoseconds;
+	int64_t m_binnedTimescale;
+
+	///@brief Bin configuration the counts were binned against
+	int64_t m_binnedXscale;
+	int64_t m_binnedYscale;
+	size_t m_binnedYsize;
 };
 
 #endif
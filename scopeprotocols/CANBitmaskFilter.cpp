@@ -114,13 +114,6 @@ void CANBitmaskFilter::Refresh(
 	auto cap = SetupEmptySparseDigitalOutputWaveform(din, 0);
 	cap->PrepareForCpuAccess();
 
-	enum
-	{
-		STATE_IDLE,
-		STATE_DLC,
-		STATE_DATA
-	} state = STATE_IDLE;
-
 	//Initial sample at time zero
 	cap->m_offsets.push_back(0);
 	cap->m_durations.push_back(0);
@@ -130,80 +123,34 @@ void CANBitmaskFilter::Refresh(
 	int64_t pattern = m_parameters[m_pattern].GetIntVal();
 	auto targetaddr = m_parameters[m_busAddress].GetIntVal() ;
 
-	//Process the CAN packet stream
+	//Jump straight to the frames with our ID
 	//TODO: support CAN-FD which can have longer frames (up to 64 bytes)?
-	int64_t framestart = 0;
-	int64_t payload = 0;
-	size_t bytesleft = 0;
-	for(size_t i=0; i<len; i++)
+	auto index = din->GetFrameIndex();
+	for(auto nframe : index->GetFramesWithID(targetaddr))
 	{
-		auto& s = din->m_samples[i];
-
-		switch(state)
-		{
-			//Look for a CAN ID (ignore anything else)
-			case STATE_IDLE:
-				if(s.m_stype == CANSymbol::TYPE_ID)
-				{
-					//ID match?
-					if(targetaddr == s.m_data)
-					{
-						framestart = din->m_offsets[i] * din->m_timescale;
-						payload = 0;
-						state = STATE_DLC;
-					}
-
-					//otherwise ignore the frame, not interesting
-				}
-				break;
-
-			//Look for the DLC so we know how many bytes to read
-			case STATE_DLC:
-				if(s.m_stype == CANSymbol::TYPE_DLC)
-				{
-					bytesleft = s.m_data;
-					state = STATE_DATA;
-				}
-
-				break;
-
-			//Read the actual data bytes, MSB first
-			case STATE_DATA:
-				if(s.m_stype == CANSymbol::TYPE_DATA)
-				{
-					//Grab the data byte
-					payload = (payload << 8) | s.m_data;
-
-					//Are we done with the frame?
-					bytesleft --;
-					if(bytesleft == 0)
-					{
-						//Extend the previous sample to the start of this frame
-						size_t nlast = cap->m_offsets.size() - 1;
-						cap->m_durations[nlast] = framestart - cap->m_offsets[nlast];
-
-						//Check the bitmask and add a new sample
-						cap->m_offsets.push_back(framestart);
-						cap->m_durations.push_back(0);
-
-						if( (payload & mask) == pattern )
-							cap->m_samples.push_back(true);
-						else
-							cap->m_samples.push_back(false);
-
-						state = STATE_IDLE;
-					}
-				}
-
-				//Discard anything else
-				else
-					state = STATE_IDLE;
-				break;
-		}
-
-		//If we see a SOF previous frame was truncated, reset
-		if(s.m_stype == CANSymbol::TYPE_SOF)
-			state = STATE_IDLE;
+		//Skip frames with no payload or truncated before the end of it
+		auto& frame = index->m_frames[nframe];
+		if( (frame.m_dlc == 0) || (frame.m_ndata < frame.m_dlc) )
+			continue;
+
+		//Read the actual data bytes, MSB first
+		int64_t framestart = din->m_offsets[frame.m_id] * din->m_timescale;
+		int64_t payload = 0;
+		for(size_t j=0; j<frame.m_dlc; j++)
+			payload = (payload << 8) | din->m_samples[frame.m_data + j].m_data;
+
+		//Extend the previous sample to the start of this frame
+		size_t nlast = cap->m_offsets.size() - 1;
+		cap->m_durations[nlast] = framestart - cap->m_offsets[nlast];
+
+		//Check the bitmask and add a new sample
+		cap->m_offsets.push_back(framestart);
+		cap->m_durations.push_back(0);
+
+		if( (payload & mask) == pattern )
+			cap->m_samples.push_back(true);
+		else
+			cap->m_samples.push_back(false);
 	}
 
 	//Extend the last sample to the end of the capture
@@ -49,6 +49,9 @@ CANDecoder::CANDecoder(const string& color)
 
 	m_parameters[m_baudrateName] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_BITRATE));
 	m_parameters[m_baudrateName].SetIntVal(250000);
+
+	//Searching by ID is the most common query
+	m_packetIndex.IndexColumn("ID");
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -30,6 +30,7 @@
 #include "../scopehal/scopehal.h"
 #include "CSVExportFilter.h"
 
+#include <charconv>
 #include <cinttypes>
 
 using namespace std;
@@ -108,61 +109,72 @@ void CSVExportFilter::Export()
 
 	//If file is not open, open it and write a header row
 	Unit xunit = GetInput(0).GetXAxisUnits();
+	auto mode = static_cast<ExportMode_t>(m_parameters[m_mode].GetIntVal());
+	bool append = (mode == MODE_CONTINUOUS_APPEND) || (mode == MODE_MANUAL_APPEND);
 	if(!m_fp)
 	{
-		auto mode = static_cast<ExportMode_t>(m_parameters[m_mode].GetIntVal());
+		//Make sure the previous export is completely on disk before we reopen (and maybe truncate) the file
+		FlushWrites();
 
-		bool append = (mode == MODE_CONTINUOUS_APPEND) || (mode == MODE_MANUAL_APPEND);
 		if(append)
 			m_fp = fopen(m_parameters[m_fname].GetFileName().c_str(), "ab");
 		else
 			m_fp = fopen(m_parameters[m_fname].GetFileName().c_str(), "wb");
+		if(!m_fp)
+		{
+			AddErrorMessage("Failed to open file", "Could not open the output file for writing");
+			return;
+		}
 
 		//See if file is empty. If so, write header
 		fseek(m_fp, 0, SEEK_END);
 		if(ftell(m_fp) == 0)
 		{
+			string header;
 			if(xunit == Unit(Unit::UNIT_FS))
-				fprintf(m_fp, "Time (s)");
+				header = "Time (s)";
 			else if(xunit == Unit(Unit::UNIT_HZ))
-				fprintf(m_fp, "Frequency (Hz)");
+				header = "Frequency (Hz)";
 			else
-				fprintf(m_fp, "X Unit");
+				header = "X Unit";
 
 			//Write other fields
 			for(size_t i=0; i<GetInputCount(); i++)
-			{
-				string colname = GetInput(i).GetName();
-				colname = str_replace(",", "_", colname);
-				fprintf(m_fp, ",%s", colname.c_str());
-			}
-			fprintf(m_fp, "\n");
+				header += "," + str_replace(",", "_", GetInput(i).GetName());
+			header += "\n";
+			QueueWrite(std::move(header));
 		}
 	}
 
 	//Pre-cast some waveforms so we don't have to do it a lot
-	std::vector<SparseWaveformBase*> sparse;
-	std::vector<UniformWaveformBase*> uniform;
-	std::vector<SparseAnalogWaveform*> sa;
-	std::vector<UniformAnalogWaveform*> ua;
-	std::vector<SparseDigitalWaveform*> sd;
-	std::vector<UniformDigitalWaveform*> ud;
-	std::vector<size_t> indexes;
-	std::vector<size_t> lens;
-	for(size_t i=0; i<GetInputCount(); i++)
+	size_t ninputs = GetInputCount();
+	ColumnSet cols;
+	vector<size_t> indexes;
+	bool hasProtocol = false;
+	for(size_t i=0; i<ninputs; i++)
 	{
 		auto data = GetInput(i).GetData();
-		sparse.push_back(dynamic_cast<SparseWaveformBase*>(data));
-		uniform.push_back(dynamic_cast<UniformWaveformBase*>(data));
-		sa.push_back(dynamic_cast<SparseAnalogWaveform*>(data));
-		ua.push_back(dynamic_cast<UniformAnalogWaveform*>(data));
-		sd.push_back(dynamic_cast<SparseDigitalWaveform*>(data));
-		ud.push_back(dynamic_cast<UniformDigitalWaveform*>(data));
+		cols.m_sparse.push_back(dynamic_cast<SparseWaveformBase*>(data));
+		cols.m_uniform.push_back(dynamic_cast<UniformWaveformBase*>(data));
+		cols.m_sa.push_back(dynamic_cast<SparseAnalogWaveform*>(data));
+		cols.m_ua.push_back(dynamic_cast<UniformAnalogWaveform*>(data));
+		cols.m_sd.push_back(dynamic_cast<SparseDigitalWaveform*>(data));
+		cols.m_ud.push_back(dynamic_cast<UniformDigitalWaveform*>(data));
+		cols.m_types.push_back(GetInput(i).GetType());
+		cols.m_lens.push_back(data->size());
 		indexes.push_back(0);
-		lens.push_back(data->size());
-	}
 
-	//Main export path
+		if(cols.m_types[i] == Stream::STREAM_TYPE_PROTOCOL)
+			hasProtocol = true;
+	}
+	cols.m_xunit = xunit;
+
+	//First pass: merge the input timelines to find out how many rows there are, saving the merge state at the
+	//start of every chunk so the rows can then be formatted out of order
+	const size_t chunkRows = 16384;
+	vector<int64_t> chunkTimestamps;
+	vector<size_t> chunkIndexes;
+	size_t nrows = 0;
 	int64_t timestamp = INT64_MIN;
 	bool first = true;
 	while(true)
@@ -171,9 +183,7 @@ void CSVExportFilter::Export()
 		//TODO: handle gaps between events
 
 		//Find next edge on any input
-		int64_t next = INT64_MAX;
-		for(size_t i=0; i<GetInputCount(); i++)
-			next = min(next, GetNextEventTimestampScaled(sparse[i], uniform[i], indexes[i], lens[i], timestamp));
+		int64_t next = NextRowTimestamp(cols, indexes, timestamp);
 
 		//If we can't advance any more, we're done
 		if( (next == INT64_MAX) || (next == timestamp) )
@@ -182,59 +192,142 @@ void CSVExportFilter::Export()
 		//First iteration is just indexing
 		if(!first)
 		{
-			//Write timestamp
-			if(xunit == Unit(Unit::UNIT_FS))
-				fprintf(m_fp, "%.10e", timestamp / FS_PER_SECOND);
-			else if(xunit == Unit(Unit::UNIT_HZ))
-				fprintf(m_fp, "%" PRId64 "", timestamp);
-			else
-				fprintf(m_fp, "%" PRId64 "", timestamp);
-
-			//Write values
-			for(size_t i=0; i<GetInputCount(); i++)
+			if( (nrows % chunkRows) == 0)
 			{
-				switch(GetInput(i).GetType())
-				{
-					case Stream::STREAM_TYPE_ANALOG:
-					fprintf(m_fp, ",%f", GetValue(sa[i], ua[i], indexes[i]));
-					break;
-
-					case Stream::STREAM_TYPE_DIGITAL:
-						fprintf(m_fp, ",%d", GetValue(sd[i], ud[i], indexes[i]));
-						break;
-
-					case Stream::STREAM_TYPE_PROTOCOL:
-						if(sparse[i])
-							fprintf(m_fp, ",%s", sparse[i]->GetText(indexes[i]).c_str());
-						else
-							fprintf(m_fp, ",%s", uniform[i]->GetText(indexes[i]).c_str());
-						break;
-
-					default:
-						fprintf(m_fp, ",%s", "[unimplemented]");
-						break;
-				}
+				chunkTimestamps.push_back(timestamp);
+				chunkIndexes.insert(chunkIndexes.end(), indexes.begin(), indexes.end());
 			}
-			fprintf(m_fp, "\n");
+			nrows ++;
 		}
 		first = false;
 
 		//All good, move on
 		timestamp = next;
-		for(size_t i=0; i<GetInputCount(); i++)
-			AdvanceToTimestampScaled(sparse[i], uniform[i], indexes[i], lens[i], timestamp);
+		for(size_t i=0; i<ninputs; i++)
+			AdvanceToTimestampScaled(cols.m_sparse[i], cols.m_uniform[i], indexes[i], cols.m_lens[i], timestamp);
+	}
+
+	//Second pass: format a batch of chunks in parallel, then hand them to the background writer in order while we
+	//start on the next batch. Protocol columns call into arbitrary GetText() implementations which may not be
+	//thread safe, so those are formatted on this thread only.
+	const size_t batchChunks = 32;
+	size_t nchunks = chunkTimestamps.size();
+	vector<string> blocks(batchChunks);
+	for(size_t batchStart=0; batchStart<nchunks; batchStart += batchChunks)
+	{
+		size_t batchEnd = min(nchunks, batchStart + batchChunks);
+
+		#pragma omp parallel for if(!hasProtocol)
+		for(size_t chunk=batchStart; chunk<batchEnd; chunk++)
+		{
+			size_t rowStart = chunk * chunkRows;
+			size_t rowEnd = min(nrows, rowStart + chunkRows);
+			vector<size_t> chunkIdx(
+				chunkIndexes.begin() + chunk*ninputs,
+				chunkIndexes.begin() + (chunk+1)*ninputs);
+			FormatRows(cols, chunkIdx, chunkTimestamps[chunk], rowEnd - rowStart, blocks[chunk - batchStart]);
+		}
+
+		for(size_t chunk=batchStart; chunk<batchEnd; chunk++)
+			QueueWrite(std::move(blocks[chunk - batchStart]));
+	}
+
+	//Append mode keeps the file open between exports so we never wait on the disk. Other modes rewrite the
+	//file from scratch next time, so close it (the writer finishes it off in the background).
+	if(!append)
+		QueueClose();
+}
+
+/**
+	@brief Finds the timestamp of the next row, i.e. the earliest event on any column after the given timestamp
+ */
+int64_t CSVExportFilter::NextRowTimestamp(const ColumnSet& cols, const vector<size_t>& indexes, int64_t timestamp)
+{
+	int64_t next = INT64_MAX;
+	for(size_t i=0; i<indexes.size(); i++)
+	{
+		next = min(next, GetNextEventTimestampScaled(
+			cols.m_sparse[i], cols.m_uniform[i], indexes[i], cols.m_lens[i], timestamp));
 	}
+	return next;
+}
+
+/**
+	@brief Formats a run of consecutive rows
+
+	@param cols			The columns being exported
+	@param indexes		Sample index of each column at the first row (modified)
+	@param timestamp	Timestamp of the first row
+	@param nrows		Number of rows to format
+	@param out			String to write the text to (any existing content is replaced)
+ */
+void CSVExportFilter::FormatRows(
+	const ColumnSet& cols,
+	vector<size_t>& indexes,
+	int64_t timestamp,
+	size_t nrows,
+	string& out)
+{
+	size_t ninputs = indexes.size();
 
-	fclose(m_fp);
-	m_fp = nullptr;
+	//Format into a scratch buffer and grow the output string in big steps, rather than appending field by field
+	out.clear();
+	out.reserve(nrows * (20 + 16*ninputs));
+	char buf[64];
+	char* bufend = buf + sizeof(buf);
+
+	for(size_t row=0; row<nrows; row++)
+	{
+		//Write timestamp
+		char* p;
+		if(cols.m_xunit == Unit(Unit::UNIT_FS))
+			p = to_chars(buf, bufend, timestamp / FS_PER_SECOND, chars_format::scientific, 10).ptr;
+		else
+			p = to_chars(buf, bufend, timestamp).ptr;
+		out.append(buf, p);
+
+		//Write values
+		for(size_t i=0; i<ninputs; i++)
+		{
+			switch(cols.m_types[i])
+			{
+				case Stream::STREAM_TYPE_ANALOG:
+					buf[0] = ',';
+					p = to_chars(buf+1, bufend, static_cast<double>(GetValue(cols.m_sa[i], cols.m_ua[i], indexes[i])),
+						chars_format::fixed, 6).ptr;
+					out.append(buf, p);
+					break;
+
+				case Stream::STREAM_TYPE_DIGITAL:
+					out += GetValue(cols.m_sd[i], cols.m_ud[i], indexes[i]) ? ",1" : ",0";
+					break;
+
+				case Stream::STREAM_TYPE_PROTOCOL:
+					out += ',';
+					if(cols.m_sparse[i])
+						out += cols.m_sparse[i]->GetText(indexes[i]);
+					else
+						out += cols.m_uniform[i]->GetText(indexes[i]);
+					break;
+
+				default:
+					out += ",[unimplemented]";
+					break;
+			}
+		}
+		out += '\n';
+
+		//Move on to the next row
+		timestamp = NextRowTimestamp(cols, indexes, timestamp);
+		for(size_t i=0; i<ninputs; i++)
+			AdvanceToTimestampScaled(cols.m_sparse[i], cols.m_uniform[i], indexes[i], cols.m_lens[i], timestamp);
+	}
 }
 
 void CSVExportFilter::OnColumnCountChanged()
 {
 	//Close the existing file
-	if(m_fp)
-		fclose(m_fp);
-	m_fp = nullptr;
+	CloseFile();
 
 	//Add new ports
 	size_t sizeNew = m_parameters[m_inputCount].GetIntVal();
@@ -51,6 +51,24 @@ public:
 protected:
 	virtual void Export() override;
 
+	///@brief The input waveforms, pre-cast to each type we might need
+	struct ColumnSet
+	{
+		std::vector<SparseWaveformBase*> m_sparse;
+		std::vector<UniformWaveformBase*> m_uniform;
+		std::vector<SparseAnalogWaveform*> m_sa;
+		std::vector<UniformAnalogWaveform*> m_ua;
+		std::vector<SparseDigitalWaveform*> m_sd;
+		std::vector<UniformDigitalWaveform*> m_ud;
+		std::vector<Stream::StreamType> m_types;
+		std::vector<size_t> m_lens;
+		Unit m_xunit;
+	};
+
+	static int64_t NextRowTimestamp(const ColumnSet& cols, const std::vector<size_t>& indexes, int64_t timestamp);
+	static void FormatRows(
+		const ColumnSet& cols, std::vector<size_t>& indexes, int64_t timestamp, size_t nrows, std::string& out);
+
 	void OnColumnCountChanged();
 
 	std::string m_inputCount;
@@ -30,6 +30,7 @@
 #include "../scopehal/scopehal.h"
 #include "CSVImportFilter.h"
 #include <charconv>
+#include <omp.h>
 
 using namespace std;
 
@@ -64,6 +65,188 @@ string CSVImportFilter::GetProtocolName()
 	return "CSV Import";
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parsing helpers
+
+/**
+	@brief Finds the end of the line starting at p
+
+	@param p		Start of the line
+	@param end		End of the buffer
+	@param lineEnd	Set to the end of the line content, excluding any trailing \r\n
+
+	@return Start of the next line
+ */
+const char* CSVImportFilter::NextLine(const char* p, const char* end, const char*& lineEnd)
+{
+	auto nl = reinterpret_cast<const char*>(memchr(p, '\n', end - p));
+	const char* next;
+	if(nl)
+	{
+		lineEnd = nl;
+		next = nl + 1;
+	}
+	else
+	{
+		lineEnd = end;
+		next = end;
+	}
+
+	if( (lineEnd > p) && (lineEnd[-1] == '\r') )
+		lineEnd --;
+	return next;
+}
+
+/**
+	@brief Skips leading whitespace and returns true if the line contains data (i.e. is not blank or a comment)
+ */
+bool CSVImportFilter::IsDataLine(const char*& p, const char* lineEnd)
+{
+	while( (p < lineEnd) && isspace(*p) )
+		p++;
+	return (p < lineEnd) && (*p != '#');
+}
+
+/**
+	@brief Trims whitespace and a leading + sign, which from_chars doesn't accept, off a field
+ */
+void CSVImportFilter::TrimField(const char*& p, const char*& e)
+{
+	while( (p < e) && isspace(*p) )
+		p++;
+	if( (p < e) && (*p == '+') )
+		p++;
+	while( (e > p) && isspace(e[-1]) )
+		e--;
+}
+
+/**
+	@brief Parses a floating point field (locale independent)
+ */
+float CSVImportFilter::ParseFloat(const char* p, const char* e)
+{
+	TrimField(p, e);
+
+	float tmp = 0;
+	#ifdef __APPLE__
+		//No floating point from_chars, and the field is not nul terminated
+		char buf[64] = {0};
+		memcpy(buf, p, min(sizeof(buf) - 1, static_cast<size_t>(e - p)));
+		tmp = strtof(buf, nullptr);
+	#else
+		from_chars(p, e, tmp, std::chars_format::general);
+	#endif
+	return tmp;
+}
+
+/**
+	@brief Parses the timestamp field of a row
+
+	@param p	Start of the field
+	@param e	End of the field
+	@param fs	If true, the field is in seconds and is converted to fs. Otherwise it's an integer in X axis units.
+ */
+int64_t CSVImportFilter::ParseTimestamp(const char* p, const char* e, bool fs)
+{
+	TrimField(p, e);
+
+	if(fs)
+	{
+		//Parse as double: float only has enough mantissa for a few thousand distinct fs-resolution timestamps
+		double tmp = 0;
+		#ifdef __APPLE__
+			char buf[64] = {0};
+			memcpy(buf, p, min(sizeof(buf) - 1, static_cast<size_t>(e - p)));
+			tmp = strtod(buf, nullptr);
+		#else
+			from_chars(p, e, tmp, std::chars_format::general);
+		#endif
+		return FS_PER_SECOND * tmp;
+	}
+
+	int64_t tmp = 0;
+	from_chars(p, e, tmp);
+	return tmp;
+}
+
+/**
+	@brief First pass over one partition: parse timestamps and validate the number of fields in each row
+ */
+void CSVImportFilter::ScanPartition(CSVPartition& part, size_t ncols, bool xUnitIsFs)
+{
+	const char* p = part.begin;
+	while(p < part.end)
+	{
+		const char* lineEnd;
+		const char* next = NextLine(p, part.end, lineEnd);
+		part.physicalLines ++;
+
+		if(IsDataLine(p, lineEnd))
+		{
+			auto comma = reinterpret_cast<const char*>(memchr(p, ',', lineEnd - p));
+			part.timestamps.push_back(ParseTimestamp(p, comma ? comma : lineEnd, xUnitIsFs));
+
+			size_t ncommas = count(p, lineEnd, ',');
+			if( (ncommas != ncols) && (part.badLine == SIZE_MAX) )
+			{
+				part.badLine = part.physicalLines - 1;
+				part.badFieldCount = ncommas;
+			}
+		}
+
+		p = next;
+	}
+}
+
+/**
+	@brief Second pass over one partition: parse sample values directly into the output waveforms
+
+	@param part		The partition to parse
+	@param analog	Output sample pointer for each column, or null if the column is digital
+	@param digital	Output sample pointer for each column, or null if the column is analog
+ */
+void CSVImportFilter::ParsePartition(const CSVPartition& part, const vector<float*>& analog, const vector<bool*>& digital)
+{
+	size_t ncols = analog.size();
+	size_t row = part.firstRow;
+
+	const char* p = part.begin;
+	while(p < part.end)
+	{
+		const char* lineEnd;
+		const char* next = NextLine(p, part.end, lineEnd);
+
+		if(IsDataLine(p, lineEnd))
+		{
+			//Skip the timestamp, we already have it
+			auto field = reinterpret_cast<const char*>(memchr(p, ',', lineEnd - p)) + 1;
+
+			for(size_t i=0; i<ncols; i++)
+			{
+				auto fieldEnd = reinterpret_cast<const char*>(memchr(field, ',', lineEnd - field));
+				if(!fieldEnd)
+					fieldEnd = lineEnd;
+
+				if(analog[i])
+					analog[i][row] = ParseFloat(field, fieldEnd);
+				else
+				{
+					const char* f = field;
+					while( (f < fieldEnd) && isspace(*f) )
+						f++;
+					digital[i][row] = (f < fieldEnd) && (*f == '1');
+				}
+
+				field = fieldEnd + 1;
+			}
+
+			row ++;
+		}
+
+		p = next;
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
@@ -94,83 +277,47 @@ void CSVImportFilter::OnFileNameChanged()
 
 	double start = GetTime();
 
-	//Read the entire file into a buffer
-	//Read it as binary because "read whole file" is problematic in text mode
-	//since length can change and we'll get less than we asked for
-	//(see https://github.com/ngscopeclient/scopehal/issues/1002)
-	FILE* fp = fopen(fname.c_str(), "rb");
-	if(!fp)
+	//Map the file rather than reading it. Nothing is modified in place, so this keeps memory usage bounded
+	//by the size of the output waveforms even for files larger than RAM.
+	MappedFile file;
+	if(!file.Open(fname))
 	{
 		AddErrorMessage("Bad file", string("Failed to open file ") + fname);
 		return;
 	}
-	fseek(fp, 0, SEEK_END);
-	size_t flen = ftell(fp);
-	fseek(fp, 0, SEEK_SET);
-	char* buf = new char[flen+1];
-	if(flen != fread(buf, 1, flen, fp))
-	{
-		AddErrorMessage("Bad file", string("Failed to read contents of file ") + fname);
-		return;
-	}
-	buf[flen] = '\0';	//guarantee null termination at end of file
-	fclose(fp);
+	auto buf = reinterpret_cast<const char*>(file.GetData());
+	auto pend = buf + file.GetSize();
 
 	ClearStreams();
 
-	//Read the file
-	//More natural implementation is lots of lines, but that's expensive. Columnar structure has less allocations
+	//Walk the preamble serially: comments (including metadata), blank lines, and the optional header row.
+	//Stop at the first data row.
 	vector<string> names;
-	vector< vector<char*> > vcolumns;
-	vector<int64_t> timestamps;
-	bool digilentFormat;
-	size_t nrow = 0;
-	size_t ncols = 0;
-	char* pbuf = buf;
-	char* pend = buf + flen;
+	bool digilentFormat = false;
 	bool xUnitIsFs = m_parameters[m_xunit].GetIntVal() == Unit::UNIT_FS;
-	while(true)
+	size_t preambleLines = 0;
+	const char* dataStart = pend;
+	const char* pbuf = buf;
+	while(pbuf < pend)
 	{
-		nrow ++;
+		const char* lineEnd;
+		const char* next = NextLine(pbuf, pend, lineEnd);
+		const char* pline = pbuf;
 
-		//Stop if at end of file
-		char* pline = pbuf;
-		if(pline >= pend)
-			break;
-
-		//Find first non-blank character in the current line
-		while(isspace(*pline))
-			pline ++;
-
-		//If it's a newline or nul, the line was blank - discard it
-		if( (*pline == '\0') || (*pline == '\n') || (*pline == '\r') )
+		//Blank line, discard it
+		IsDataLine(pline, lineEnd);
+		if(pline >= lineEnd)
 		{
-			pbuf ++;
+			preambleLines ++;
+			pbuf = next;
 			continue;
 		}
 
-		//Search until we find the end of the line, then trim the trailing newline if there is one
-		size_t slen = 0;
-		for(; (pline + slen) < pend; slen++)
-		{
-			if(pline[slen] == '\0')
-				break;
-			if( (pline[slen] == '\n') || (pline[slen] == '\r') )
-			{
-				pline[slen] = '\0';
-				break;
-			}
-		}
-		pbuf += slen;
-
-		//Skip blank lines (we hit this in files with \r\n line endings)
-		if(slen <= 1)
-			continue;
+		string s(pline, lineEnd);
 
 		//If the line starts with a #, it's a comment. Discard it, but save timestamp metadata if present
-		if(pline[0] == '#')
+		if(s[0] == '#')
 		{
-			string s = pline;
 			if(s == "#Digilent WaveForms Oscilloscope Acquisition")
 			{
 				digilentFormat = true;
@@ -217,174 +364,184 @@ void CSVImportFilter::OnFileNameChanged()
 					}
 				}
 			}
+
+			preambleLines ++;
+			pbuf = next;
 			continue;
 		}
 
-		//Parse into 2D vector of timestamps and strings
-		size_t fieldstart = 0;
-		bool foundTimestamp = false;
-		vector<string> headerfields;
-		bool headerRow = false;
-		size_t ncol = 0;
-		for(size_t i=0; i<=slen; i++)
+		//If the first non-comment row contains anything non-numeric, it's a header row
+		if(names.empty())
 		{
-			//End of field
-			if( (pline[i] == ',') || (pline[i] == '\n') || (pline[i] == '\r') || (pline[i] == '\0') )
+			bool headerRow = false;
+			for(auto c : s)
 			{
-				//If this is the first row, check if it's numeric
-				if(names.empty() && timestamps.empty())
-				{
-					//See if it's a header row
-					if(!headerRow)
-					{
-						for(size_t j=0; pline[j] != '\0'; j++)
-						{
-							auto c = pline[j];
-							if(	!isdigit(c) && !isspace(c) &&
-								(c != ',') && (c != '.') && (c != '-') && (c != 'e') && (c != '+'))
-							{
-								headerRow = true;
-								auto trimline = Trim(pline);
-								LogTrace("Found header row: %s\n", trimline.c_str());
-								break;
-							}
-						}
-					}
-
-					//Save the header values
-					if(headerRow)
-					{
-						string s(pline);
-						headerfields.push_back(s.substr(fieldstart, i-fieldstart));
-					}
-				}
-
-				//If this is a header row, don't also try to parse it as a timestamp
-				if(headerRow)
+				if(	!isdigit(c) && !isspace(c) &&
+					(c != ',') && (c != '.') && (c != '-') && (c != 'e') && (c != '+'))
 				{
-					//Start a new field
-					fieldstart = i+1;
-					continue;
+					headerRow = true;
+					break;
 				}
+			}
 
-				//Replace the delimiter with a nul
-				pline[i] = '\0';
+			if(headerRow)
+			{
+				LogTrace("Found header row: %s\n", Trim(s).c_str());
 
-				//Load timestamp
-				if(!foundTimestamp)
+				//Save the header values, except the name of the timestamp column
+				size_t fieldstart = 0;
+				bool first = true;
+				for(size_t i=0; i<=s.length(); i++)
 				{
-					foundTimestamp = true;
-
-					//Parse time to a float and convert to fs
-					if(xUnitIsFs)
+					if( (i == s.length()) || (s[i] == ',') )
 					{
-						//TODO: use fastfloat lib here
-						#ifdef __APPLE__
-							timestamps.push_back(FS_PER_SECOND * strtof(pline+i, nullptr));
-						#else
-							float tmp;
-							from_chars(pline+fieldstart, pline+i, tmp, std::chars_format::general);
-							timestamps.push_back(FS_PER_SECOND * tmp);
-						#endif
+						if(!first)
+							names.push_back(s.substr(fieldstart, i-fieldstart));
+						first = false;
+						fieldstart = i+1;
 					}
-
-					//other units are as-is
-					else
-						timestamps.push_back(strtoll(pline+fieldstart, nullptr, 10));
 				}
 
-				//Data field. Save it
-				else
-				{
-					if(vcolumns.size() <= ncol)
-						vcolumns.resize(ncol+1);
-					vcolumns[ncol].push_back(pline+fieldstart);
-
-					ncol ++;
-				}
-
-				//Start a new field
-				fieldstart = i+1;
+				preambleLines ++;
+				pbuf = next;
+				continue;
 			}
 		}
-		if(fieldstart < slen)
-		{
-			if(vcolumns.size() <= ncol)
-				vcolumns.resize(ncol+1);
-			vcolumns[ncol].push_back(pline+fieldstart);
 
-			ncol ++;
-		}
+		dataStart = pbuf;
+		break;
+	}
+
+	//The first data row sets the number of columns
+	if(dataStart >= pend)
+		return;
+	size_t ncols;
+	{
+		const char* lineEnd;
+		NextLine(dataStart, pend, lineEnd);
+		ncols = count(dataStart, lineEnd, ',');
+	}
+	if(ncols == 0)
+		return;
 
-		//Header row gets special treatment
-		if(headerRow)
+	//Split the data into newline-aligned partitions, a few per thread so uneven lines balance out
+	const size_t minPartitionSize = 1024 * 1024;
+	size_t datalen = pend - dataStart;
+	size_t npart = max(static_cast<size_t>(1), min(datalen / minPartitionSize, static_cast<size_t>(omp_get_max_threads() * 4)));
+	vector<CSVPartition> partitions(npart);
+	for(size_t i=0; i<npart; i++)
+	{
+		auto& part = partitions[i];
+		if(i == 0)
+			part.begin = dataStart;
+		else
 		{
-			//delete name of timestamp column
-			headerfields.erase(headerfields.begin());
-			names = headerfields;
-			continue;
+			part.begin = dataStart + (datalen * i) / npart;
+			auto nl = reinterpret_cast<const char*>(memchr(part.begin, '\n', pend - part.begin));
+			part.begin = nl ? (nl + 1) : pend;
+			part.begin = max(part.begin, partitions[i-1].begin);
 		}
+	}
+	for(size_t i=0; i<npart; i++)
+		partitions[i].end = (i+1 < npart) ? partitions[i+1].begin : pend;
 
-		//Sanity check field count
-		if(ncols == 0)
-			ncols = ncol;
-		else if(ncol != ncols)
+	//First pass: timestamps and field count validation
+	#pragma omp parallel for
+	for(size_t i=0; i<npart; i++)
+		ScanPartition(partitions[i], ncols, xUnitIsFs);
+
+	size_t nrows = 0;
+	size_t linesBefore = preambleLines;
+	for(auto& part : partitions)
+	{
+		if(part.badLine != SIZE_MAX)
 		{
 			AddErrorMessage("Malformed file",
-				string("Line ") + to_string(nrow) + " contains " + to_string(ncol) + " fields, but file started with " +
-				to_string(ncols) + " fields");
+				string("Line ") + to_string(linesBefore + part.badLine + 1) + " contains " +
+				to_string(part.badFieldCount) + " fields, but file started with " + to_string(ncols) + " fields");
 			return;
 		}
+
+		part.firstRow = nrows;
+		nrows += part.timestamps.size();
+		linesBefore += part.physicalLines;
 	}
 
-	if(ncols == 0)
-		return;
-	size_t nrows = min(vcolumns[0].size(), timestamps.size());
+	vector<int64_t> timestamps;
+	timestamps.reserve(nrows);
+	for(auto& part : partitions)
+	{
+		timestamps.insert(timestamps.end(), part.timestamps.begin(), part.timestamps.end());
+		part.timestamps.clear();
+		part.timestamps.shrink_to_fit();
+	}
 
 	//Assign default names to channels if there's no header row or not enough names
-	LogTrace("Initial parsing completed, %zu lines, %zu columns, %zu names, %zu timestamps\n",
-		nrows, ncols, names.size(), timestamps.size());
+	LogTrace("Initial parsing completed, %zu lines, %zu columns, %zu names, %zu partitions\n",
+		nrows, ncols, names.size(), npart);
 	for(size_t i=0; i<ncols; i++)
 	{
 		if(names.size() <= i)
 			names.push_back(string("Field") + to_string(i));
 	}
 
-	//Figure out if channels are analog or digital and create output streams/waveforms
-	vector<SparseDigitalWaveform*> digwaves;
-	vector<SparseAnalogWaveform*> anwaves;
-	for(size_t i=0; i<ncols; i++)
+	//Assume digital, then change to analog if we see anything other than a 0/1 in the first 10 lines
+	vector<bool> digital(ncols, true);
 	{
-		LogIndenter li2;
-
-		//Assume digital, then change to analog if we see anything other than a 0/1 in the first 10 lines
-		bool digital = true;
-		for(size_t j=0; j<nrows && j<10; j++)
+		const char* p = dataStart;
+		for(size_t nline=0; (nline < 10) && (p < pend); )
 		{
-			auto field = vcolumns[i][j];
-			if( (field[0] != '0' && field[0] != '1') || field[1] != '\0')
+			const char* lineEnd;
+			const char* next = NextLine(p, pend, lineEnd);
+			if(IsDataLine(p, lineEnd))
 			{
-				digital = false;
-				break;
+				auto field = reinterpret_cast<const char*>(memchr(p, ',', lineEnd - p)) + 1;
+				for(size_t i=0; i<ncols; i++)
+				{
+					auto fieldEnd = reinterpret_cast<const char*>(memchr(field, ',', lineEnd - field));
+					if(!fieldEnd)
+						fieldEnd = lineEnd;
+					if( (fieldEnd - field != 1) || ( (*field != '0') && (*field != '1') ) )
+						digital[i] = false;
+					field = fieldEnd + 1;
+				}
+				nline ++;
 			}
+			p = next;
 		}
+	}
+
+	//Check the timebase up front so we can create dense waveforms directly
+	int64_t interval = 0;
+	bool uniform = DetectUniformTimebase(timestamps, interval);
 
-		//Create the output stream
-		if(digital)
+	//Create output streams/waveforms
+	vector<WaveformBase*> waves;
+	vector<float*> analogPtrs(ncols, nullptr);
+	vector<bool*> digitalPtrs(ncols, nullptr);
+	for(size_t i=0; i<ncols; i++)
+	{
+		WaveformBase* wfm;
+		if(digital[i])
 		{
 			AddStream(Unit(Unit::UNIT_COUNTS), names[i], Stream::STREAM_TYPE_DIGITAL);
 
-			auto wfm = new SparseDigitalWaveform;
-			wfm->m_timescale = 1;
-			wfm->m_startTimestamp = timestamp;
-			wfm->m_startFemtoseconds = fs;
-			wfm->m_triggerPhase = 0;
-			wfm->Resize(nrows);
-			digwaves.push_back(wfm);
-
-			//no analog waveform
-			anwaves.push_back(nullptr);
-			SetData(wfm, i);
+			if(uniform)
+			{
+				auto uwfm = new UniformDigitalWaveform;
+				uwfm->Resize(nrows);
+				uwfm->PrepareForCpuAccess();
+				digitalPtrs[i] = uwfm->m_samples.GetCpuPointer();
+				wfm = uwfm;
+			}
+			else
+			{
+				auto swfm = new SparseDigitalWaveform;
+				swfm->Resize(nrows);
+				swfm->PrepareForCpuAccess();
+				digitalPtrs[i] = swfm->m_samples.GetCpuPointer();
+				wfm = swfm;
+			}
 		}
 		else
 		{
@@ -394,114 +551,72 @@ void CSVImportFilter::OnFileNameChanged()
 				names[i],
 				Stream::STREAM_TYPE_ANALOG);
 
-			auto wfm = new SparseAnalogWaveform;
-			wfm->m_timescale = 1;
-			wfm->m_startTimestamp = timestamp;
-			wfm->m_startFemtoseconds = fs;
-			wfm->m_triggerPhase = 0;
-			wfm->Resize(nrows);
-			anwaves.push_back(wfm);
-
-			//no digital waveform
-			digwaves.push_back(nullptr);
-			SetData(wfm, i);
-		}
-	}
-
-	m_outputsChangedSignal.emit();
-
-	//Process each actual waveform and figure out how to handle it
-	for(size_t i=0; i<ncols; i++)
-	{
-		if(digwaves[i])
-		{
-			auto wfm = digwaves[i];
-
-			//Read the sample data
-			for(size_t j=0; j<nrows; j++)
-			{
-				wfm->m_offsets[j] = timestamps[j];
-
-				//Last one? copy previous sample duration
-				if(j+1 == nrows)
-					wfm->m_durations[j] = wfm->m_durations[j-1];
-
-				//Set sample duration of previous sample
-				if(j > 0)
-					wfm->m_durations[j-1] = wfm->m_offsets[j] - wfm->m_offsets[j-1];
-
-				//Read waveform data
-				if(vcolumns[i][j][0] == '1')
-					wfm->m_samples[j] = true;
-				else
-					wfm->m_samples[j] = false;
-			}
-
-			if(TryNormalizeTimebase(wfm))
+			if(uniform)
 			{
-				auto dense = new UniformDigitalWaveform(*wfm);
-				dense->MarkModifiedFromCpu();
-				SetData(dense, i);
+				auto uwfm = new UniformAnalogWaveform;
+				uwfm->Resize(nrows);
+				uwfm->PrepareForCpuAccess();
+				analogPtrs[i] = uwfm->m_samples.GetCpuPointer();
+				wfm = uwfm;
 			}
 			else
 			{
-				wfm->MarkModifiedFromCpu();
-
-				//If we end up with zero length samples due to invalid configuration, nuke the channel
-				if(wfm->empty() || (wfm->m_durations[0] == 0) )
-					SetData(nullptr, i);
+				auto swfm = new SparseAnalogWaveform;
+				swfm->Resize(nrows);
+				swfm->PrepareForCpuAccess();
+				analogPtrs[i] = swfm->m_samples.GetCpuPointer();
+				wfm = swfm;
 			}
 		}
 
-		//Analog data
+		wfm->m_startTimestamp = timestamp;
+		wfm->m_startFemtoseconds = fs;
+		if(uniform)
+		{
+			//Use time zero as the trigger phase
+			wfm->m_timescale = interval;
+			wfm->m_triggerPhase = timestamps[0];
+		}
 		else
 		{
-			auto wfm = anwaves[i];
+			wfm->m_timescale = 1;
+			wfm->m_triggerPhase = 0;
 
-			//Read the sample data
+			auto swfm = dynamic_cast<SparseWaveformBase*>(wfm);
 			for(size_t j=0; j<nrows; j++)
 			{
-				wfm->m_offsets[j] = timestamps[j];
-
-				//Last one? copy previous sample duration
-				if(j+1 == nrows)
-					wfm->m_durations[j] = wfm->m_durations[j-1];
-
-				//Set sample duration of previous sample
+				swfm->m_offsets[j] = timestamps[j];
 				if(j > 0)
-					wfm->m_durations[j-1] = wfm->m_offsets[j] - wfm->m_offsets[j-1];
-
-				//Read waveform data
-				//TODO: faster to save length in vcolumns vs recomputing here?
-				float tmp;
-				const char* vline = vcolumns[i][j];
-				#ifdef __APPLE__
-					tmp = strtof(vline, nullptr);
-				#else
-					from_chars(vline, vline+strlen(vline), tmp, std::chars_format::general);
-				#endif
-				wfm->m_samples[j] = tmp;
+					swfm->m_durations[j-1] = timestamps[j] - timestamps[j-1];
 			}
 
-			if(TryNormalizeTimebase(wfm))
-			{
-				auto dense = new UniformAnalogWaveform(*wfm);
-				dense->MarkModifiedFromCpu();
-				SetData(dense, i);
-			}
-			else
-			{
-				wfm->MarkModifiedFromCpu();
-
-				//If we end up with zero length samples due to invalid configuration, nuke the channel
-				if(wfm->m_durations[0] == 0)
-					SetData(nullptr, i);
-			}
+			//Last one? copy previous sample duration
+			swfm->m_durations[nrows-1] = (nrows > 1) ? swfm->m_durations[nrows-2] : 0;
 		}
+
+		waves.push_back(wfm);
+		SetData(wfm, i);
+	}
+
+	m_outputsChangedSignal.emit();
+
+	//Second pass: sample values, written straight into the output waveforms
+	#pragma omp parallel for
+	for(size_t i=0; i<npart; i++)
+	{
+		ParsePartition(partitions[i], analogPtrs, digitalPtrs);
+		file.Release(partitions[i].begin - buf, partitions[i].end - partitions[i].begin);
+	}
+
+	for(size_t i=0; i<ncols; i++)
+	{
+		waves[i]->MarkModifiedFromCpu();
+
+		//If we end up with zero length samples due to invalid configuration, nuke the channel
+		if(!uniform && (dynamic_cast<SparseWaveformBase*>(waves[i])->m_durations[0] == 0) )
+			SetData(nullptr, i);
 	}
 
 	double dt = GetTime() - start;
 	LogTrace("CSV loading took %.3f sec\n", dt);
-
-	delete[] buf;
 }
@@ -47,6 +47,52 @@ public:
 protected:
 	void OnFileNameChanged();
 
+	///@brief One newline-aligned slice of the data section of a file, parsed independently of the others
+	class CSVPartition
+	{
+	public:
+		CSVPartition()
+		: begin(nullptr)
+		, end(nullptr)
+		, physicalLines(0)
+		, firstRow(0)
+		, badLine(SIZE_MAX)
+		, badFieldCount(0)
+		{}
+
+		///@brief Start of the first line in the partition
+		const char* begin;
+
+		///@brief End of the partition (start of the next one)
+		const char* end;
+
+		///@brief Number of lines in the partition, including blank lines and comments
+		size_t physicalLines;
+
+		///@brief Index of the first data row in the partition, within the whole file
+		size_t firstRow;
+
+		///@brief Timestamps of each data row (only valid between the two parsing passes)
+		std::vector<int64_t> timestamps;
+
+		///@brief Index (within the partition) of the first line with the wrong number of fields, or SIZE_MAX
+		size_t badLine;
+
+		///@brief Number of fields found on badLine
+		size_t badFieldCount;
+	};
+
+	static const char* NextLine(const char* p, const char* end, const char*& lineEnd);
+	static bool IsDataLine(const char*& p, const char* lineEnd);
+	static void TrimField(const char*& p, const char*& e);
+	static float ParseFloat(const char* p, const char* e);
+	static int64_t ParseTimestamp(const char* p, const char* e, bool fs);
+	static void ScanPartition(CSVPartition& part, size_t ncols, bool xUnitIsFs);
+	static void ParsePartition(
+		const CSVPartition& part,
+		const std::vector<float*>& analog,
+		const std::vector<bool*>& digital);
+
 	std::string m_xunit;
 	std::string m_yunit0;
 };
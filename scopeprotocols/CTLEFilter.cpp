@@ -85,10 +85,14 @@ int64_t CTLEFilter::GetGroupDelay()
 	return 0;
 }
 
-void CTLEFilter::InterpolateSparameters(float bin_hz, bool /*invert*/, size_t nouts)
+void CTLEFilter::InterpolateSparameters(
+	vk::raii::CommandBuffer& /*cmdBuf*/,
+	float bin_hz,
+	bool /*invert*/,
+	size_t nouts,
+	AcceleratorBuffer<float>& sines,
+	AcceleratorBuffer<float>& cosines)
 {
-	m_cachedBinSize = bin_hz;
-
 	typedef complex<float> fcpx;
 
 	fcpx p0(0, -FreqToPhase(m_cachedPole1Freq));
@@ -101,6 +105,10 @@ void CTLEFilter::InterpolateSparameters(float bin_hz, bool /*invert*/, size_t no
 	//Multiply by our gain (in dB, so we have to convert to V/V)
 	prescale *= pow(10, m_cachedDcGain/20);
 
+	sines.resize(nouts);
+	cosines.resize(nouts);
+	sines.PrepareForCpuAccess();
+	cosines.PrepareForCpuAccess();
 	for(size_t i=0; i<nouts; i++)
 	{
 		fcpx s(0, FreqToPhase(bin_hz * i));
@@ -109,9 +117,11 @@ void CTLEFilter::InterpolateSparameters(float bin_hz, bool /*invert*/, size_t no
 		//Phase correction seems unnecessary because this transfer function should be constant rotation?
 		//We get weird results when we do this, too.
 		float phase = 0;//arg(h);
-		m_resampledSparamSines.push_back(sin(phase) * abs(h));
-		m_resampledSparamCosines.push_back(cos(phase) * abs(h));
+		sines[i] = sin(phase) * abs(h);
+		cosines[i] = cos(phase) * abs(h);
 	}
+	sines.MarkModifiedFromCpu();
+	cosines.MarkModifiedFromCpu();
 }
 
 void CTLEFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
@@ -133,7 +143,7 @@ void CTLEFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle
 		(pole2 != m_cachedPole2Freq) )
 	{
 		//force re-interpolation of S-parameters
-		m_cachedBinSize = 0;
+		m_responseRevision ++;
 
 		m_cachedDcGain = dcgain_db;
 		m_cachedZeroFreq = zfreq;
@@ -50,7 +50,13 @@ public:
 
 protected:
 	virtual int64_t GetGroupDelay() override;
-	virtual void InterpolateSparameters(float bin_hz, bool invert, size_t nouts) override;
+	virtual void InterpolateSparameters(
+		vk::raii::CommandBuffer& cmdBuf,
+		float bin_hz,
+		bool invert,
+		size_t nouts,
+		AcceleratorBuffer<float>& sines,
+		AcceleratorBuffer<float>& cosines) override;
 
 	std::string m_dcGainName;
 	std::string m_zeroFreqName;
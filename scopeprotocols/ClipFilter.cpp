@@ -81,11 +81,19 @@ Filter::DataLocation ClipFilter::GetInputLocation()
 	return LOC_DONTCARE;
 }
 
+bool ClipFilter::ConsumesInputsOnGpu()
+{
+	//Input samples are only ever read by our shaders
+	return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
 void ClipFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
+	ExpandRawInputs();
+
 	//Make sure we've got valid inputs
 	ClearErrors();
 	if(!VerifyAllInputsOK())
@@ -142,5 +150,33 @@ void ClipFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle
 		compute_block_count / 32768 + 1);
 
 	cmdBuf.end();
-	queue->SubmitAndBlock(cmdBuf);
+	queue->SubmitDeferred(cmdBuf);
+}
+
+bool ClipFilter::SetupElementwiseOp(ElementwiseOp& op)
+{
+	if(!VerifyAllInputsOK())
+		return false;
+	auto udin = dynamic_cast<UniformAnalogWaveform*>(GetInputWaveform(0));
+	if(!udin)
+		return false;
+
+	ClearErrors();
+	size_t len = udin->size();
+	auto cap = SetupEmptyUniformAnalogOutputWaveform(udin, 0);
+	cap->Resize(len);
+
+	//Clipping above the level is min(x, level) and below is max(x, level)
+	op.m_type = (m_clipAbove.GetIntVal() == 1) ? ElementwiseOp::OP_MIN : ElementwiseOp::OP_MAX;
+	op.m_inputs[0] = udin;
+	op.m_constant = m_clipLevel.GetFloatVal();
+	op.m_output = cap;
+	op.m_len = len;
+	return true;
+}
+
+bool ClipFilter::AcceptsRawSamples(size_t /*i*/)
+{
+	//The fused elementwise kernel reads raw ADC codes in place; Refresh() converts them if we don't get fused
+	return true;
 }
@@ -49,7 +49,10 @@ public:
 	ClipFilter(const std::string& color);
 
 	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
+	virtual bool SetupElementwiseOp(ElementwiseOp& op) override;
+	virtual bool AcceptsRawSamples(size_t i) override;
 	virtual DataLocation GetInputLocation() override;
+	virtual bool ConsumesInputsOnGpu() override;
 
 	static std::string GetProtocolName();
 
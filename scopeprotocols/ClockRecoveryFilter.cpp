@@ -77,7 +77,7 @@ ClockRecoveryFilter::ClockRecoveryFilter(const string& color)
 			make_shared<ComputePipeline>("shaders/ClockRecoveryPLL_SecondPass.spv", 5, sizeof(ClockRecoveryConstants));
 
 		m_finalPassComputePipeline =
-			make_shared<ComputePipeline>("shaders/ClockRecoveryPLL_FinalPass.spv", 9, sizeof(ClockRecoveryConstants));
+			make_shared<ComputePipeline>("shaders/ClockRecoveryPLL_FinalPass.spv", 10, sizeof(ClockRecoveryConstants));
 
 		//Set up GPU temporary buffers
 		m_firstPassTimestamps.SetGpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
@@ -180,16 +180,18 @@ void ClockRecoveryFilter::Refresh(
 	size_t nedges = 0;
 	AcceleratorBuffer<int64_t> vedges;
 	float threshold = m_threshold.GetFloatVal();
-	if(uadin)
-		nedges = m_detector.FindZeroCrossings(uadin, threshold, cmdBuf, queue);
+	m_crossings = nullptr;
+	if(uadin || sadin)
+	{
+		m_crossings = LevelCrossingList::Get(din, threshold);
+		nedges = m_crossings->size();
+	}
 	else
 	{
 		din->PrepareForCpuAccess();
 
 		vector<int64_t> edges;
-		if(sadin)
-			FindZeroCrossings(sadin, threshold, edges);
-		else if(uddin)
+		if(uddin)
 			FindZeroCrossings(uddin, edges);
 		else if(sddin)
 			FindZeroCrossings(sddin, edges);
@@ -208,7 +210,7 @@ void ClockRecoveryFilter::Refresh(
 	}
 
 	//Edge array
-	auto& edges = uadin ? m_detector.GetResults() : vedges;
+	auto& edges = m_crossings ? m_crossings->m_crossings : vedges;
 
 	//Create the output waveform and copy our timescales
 	auto cap = SetupEmptySparseDigitalOutputWaveform(din, 0);
@@ -237,7 +239,8 @@ void ClockRecoveryFilter::Refresh(
 	}
 	else if(sadin)
 	{
-		sadin->PrepareForCpuAccess();
+		//Only the timestamps are needed, the sample data can stay on the GPU
+		sadin->m_offsets.PrepareForCpuAccess();
 		tend = GetOffsetScaled(sadin, din->size()-1);
 	}
 	else
@@ -263,17 +266,21 @@ void ClockRecoveryFilter::Refresh(
 		int64_t expectedNumEdges = (tend / initialPeriod);
 
 		//We need a fair number of edges in each thread block for the PLL to lock and not overlap too much
-		//For now we assume input is uniformly sampled and fall back if not
 		if(	g_hasShaderInt64 && g_hasShaderInt8 &&
 			(expectedNumEdges > 100000) && (m_mtMode.GetIntVal() == MT_GPU) &&
-			uadin)
+			(uadin || sadin) )
 		{
 			//First pass: run the PLL separately on each chunk of the waveform
 			//TODO: do we need to tune numThreads to lock well to short waveforms?
 			uint64_t numThreads = 4096;
 			const uint64_t blockSize = 64;
 			const uint64_t numBlocks = numThreads / blockSize;
-			const uint64_t maxEdges = din->size() / 2;
+
+			//Sparse input has no sample rate to bound the PLL output, so allow for a generous amount of slew
+			//around the nominal edge count instead
+			uint64_t maxEdges = din->size() / 2;
+			if(sadin)
+				maxEdges = max<uint64_t>(din->size(), 4*expectedNumEdges);
 
 			//We have no idea how many edges we might generate since the PLL can slew arbitrarily depending on input.
 			//The hard upper bound is Nyquist (one edge every 2 input samples) so allocate that much to start
@@ -299,6 +306,7 @@ void ClockRecoveryFilter::Refresh(
 			cfg.timescale = din->m_timescale;
 			cfg.triggerPhase = din->m_triggerPhase;
 			cfg.maxInputSamples = din->size();
+			cfg.sparseInput = (sadin != nullptr);
 
 			//Run the first pass
 			m_firstPassComputePipeline->BindBufferNonblocking(0, edges, cmdBuf);
@@ -332,8 +340,17 @@ void ClockRecoveryFilter::Refresh(
 			m_finalPassComputePipeline->BindBufferNonblocking(5, cap->m_samples, cmdBuf);
 			m_finalPassComputePipeline->BindBufferNonblocking(6, cap->m_durations, cmdBuf);
 			m_finalPassComputePipeline->BindBufferNonblocking(7, scap->m_samples, cmdBuf);
-			//this assumes input is uniformly sampled for now
-			m_finalPassComputePipeline->BindBufferNonblocking(8, uadin->m_samples, cmdBuf);
+			if(sadin)
+			{
+				m_finalPassComputePipeline->BindBufferNonblocking(8, sadin->m_samples, cmdBuf);
+				m_finalPassComputePipeline->BindBufferNonblocking(9, sadin->m_offsets, cmdBuf);
+			}
+			else
+			{
+				//Offsets aren't used for uniform input, but something has to be bound
+				m_finalPassComputePipeline->BindBufferNonblocking(8, uadin->m_samples, cmdBuf);
+				m_finalPassComputePipeline->BindBufferNonblocking(9, edges, cmdBuf);
+			}
 			m_finalPassComputePipeline->Dispatch(cmdBuf, cfg, 1, numBlocks);
 			m_finalPassComputePipeline->AddComputeMemoryBarrier(cmdBuf);
 
@@ -352,8 +369,8 @@ void ClockRecoveryFilter::Refresh(
 			cmdBuf.end();
 			queue->SubmitAndBlock(cmdBuf);
 
-			//Figure out how many edges we ended up with
-			//TODO: can we avoid this readback?
+			//Figure out how many edges we ended up with.
+			//This is the only readback: a few values per thread, the recovered clock itself stays on the GPU
 			uint64_t numSamples = m_firstPassState[0];
 			for(uint64_t i=0; i<numThreads; i++)
 				numSamples += m_secondPassState[i*3];
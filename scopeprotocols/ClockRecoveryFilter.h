@@ -35,8 +35,6 @@
 #ifndef ClockRecoveryFilter_h
 #define ClockRecoveryFilter_h
 
-#include "../scopehal/LevelCrossingDetector.h"
-
 class ClockRecoveryConstants
 {
 public:
@@ -48,6 +46,7 @@ public:
 	uint32_t	nedges;
 	uint32_t	maxOffsetsPerThread;
 	uint32_t	maxInputSamples;
+	uint32_t	sparseInput;
 };
 
 class ClockRecoveryFilter : public Filter
@@ -65,9 +64,9 @@ public:
 
 	PROTOCOL_DECODER_INITPROC(ClockRecoveryFilter)
 
-	///@brief Allow our zero crossings to be reused in downstream filters (e.g. TIE) if valid (input is uniform)
-	AcceleratorBuffer<int64_t>& GetZeroCrossings()
-	{ return m_detector.GetResults(); }
+	///@brief Allow our zero crossings to be reused in downstream filters (e.g. TIE), null unless input is analog
+	std::shared_ptr<LevelCrossingList> GetZeroCrossings()
+	{ return m_crossings; }
 
 	float GetThreshold()
 	{ return m_threshold.GetFloatVal(); }
@@ -122,7 +121,8 @@ protected:
 	 */
 	FilterParameter& m_mtMode;
 
-	LevelCrossingDetector m_detector;
+	///@brief Zero crossings of the most recent analog input
+	std::shared_ptr<LevelCrossingList> m_crossings;
 
 	///@brief Compute pipeline for filling output
 	std::shared_ptr<ComputePipeline> m_fillSquarewaveAndDurationsComputePipeline;
@@ -39,11 +39,17 @@ ComplexImportFilter::ComplexImportFilter(const string& color)
 	: ImportFilter(color)
 	, m_formatname("File Format")
 	, m_sratename("Sample Rate")
+	, m_playbackname("Playback Speed")
+	, m_format(FORMAT_FLOAT32)
+	, m_reloading(false)
+	, m_playbackPosition(0)
+	, m_lastPlaybackTime(0)
 {
+	//Raw IQ recordings have no standard extension (.complex, .cfile, .iq, .cu8, .sigmf-data...) so accept anything
 	m_fpname = "Complex File";
 	m_parameters[m_fpname] = FilterParameter(FilterParameter::TYPE_FILENAME, Unit(Unit::UNIT_COUNTS));
-	m_parameters[m_fpname].m_fileFilterMask = "*.complex";
-	m_parameters[m_fpname].m_fileFilterName = "Complex files (*.complex)";
+	m_parameters[m_fpname].m_fileFilterMask = "*";
+	m_parameters[m_fpname].m_fileFilterName = "I/Q recordings (*.complex, *.sigmf-data, ...)";
 	m_parameters[m_fpname].signal_changed().connect(sigc::mem_fun(*this, &ComplexImportFilter::Reload));
 
 	m_parameters[m_formatname] = FilterParameter(FilterParameter::TYPE_ENUM, Unit::UNIT_COUNTS);
@@ -59,6 +65,12 @@ ComplexImportFilter::ComplexImportFilter(const string& color)
 	m_parameters[m_sratename].SetIntVal(1e6);
 	m_parameters[m_sratename].signal_changed().connect(sigc::mem_fun(*this, &ComplexImportFilter::Reload));
 
+	AddPagingParameters();
+
+	//Zero means stopped, 1 is real time
+	m_parameters[m_playbackname] = FilterParameter(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_playbackname].SetFloatVal(0);
+
 	AddStream(Unit(Unit::UNIT_VOLTS), "I", Stream::STREAM_TYPE_ANALOG);
 	AddStream(Unit(Unit::UNIT_VOLTS), "Q", Stream::STREAM_TYPE_ANALOG);
 }
@@ -71,12 +83,167 @@ string ComplexImportFilter::GetProtocolName()
 	return "Complex Import";
 }
 
+/**
+	@brief Returns the size of one component (I or Q) of a sample, in bytes
+ */
+size_t ComplexImportFilter::GetComponentSize(Format fmt)
+{
+	switch(fmt)
+	{
+		case FORMAT_SIGNED_INT16:
+			return 2;
+
+		case FORMAT_FLOAT32:
+			return 4;
+
+		case FORMAT_FLOAT64:
+			return 8;
+
+		case FORMAT_UNSIGNED_INT8:
+		case FORMAT_SIGNED_INT8:
+		default:
+			return 1;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// SigMF metadata
+
+/**
+	@brief Maps a SigMF core:datatype string to one of our formats
+
+	Only complex, little endian types we have a format for are accepted.
+
+	@return False if the type is not supported
+ */
+bool ComplexImportFilter::ParseSigMFDatatype(const string& datatype, Format& fmt)
+{
+	if(datatype == "cu8")
+		fmt = FORMAT_UNSIGNED_INT8;
+	else if(datatype == "ci8")
+		fmt = FORMAT_SIGNED_INT8;
+	else if(datatype == "ci16_le")
+		fmt = FORMAT_SIGNED_INT16;
+	else if(datatype == "cf32_le")
+		fmt = FORMAT_FLOAT32;
+	else if(datatype == "cf64_le")
+		fmt = FORMAT_FLOAT64;
+	else
+		return false;
+	return true;
+}
+
+/**
+	@brief Reads the sample format and rate of a SigMF recording, and updates our parameters to match
+
+	@param metaPath		Path to the .sigmf-meta file
+	@param dataOffset	Set to the number of header bytes before the first sample, if the metadata specifies any
+
+	@return False (after adding an error message) if the metadata can't be used
+ */
+bool ComplexImportFilter::LoadSigMFMetadata(const string& metaPath, size_t& dataOffset)
+{
+	//SigMF metadata is JSON, which yaml-cpp parses fine
+	string datatype;
+	double samplerate = 0;
+	try
+	{
+		auto root = YAML::LoadFile(metaPath);
+		auto global = root["global"];
+		datatype = global["core:datatype"].as<string>();
+		if(global["core:sample_rate"])
+			samplerate = global["core:sample_rate"].as<double>();
+		if(global["core:num_channels"] && (global["core:num_channels"].as<int>() != 1))
+		{
+			AddErrorMessage("Unsupported file", "Multi-channel SigMF recordings are not supported");
+			return false;
+		}
+
+		auto captures = root["captures"];
+		if(captures.IsSequence() && (captures.size() > 0) && captures[0]["core:header_bytes"])
+			dataOffset = captures[0]["core:header_bytes"].as<size_t>();
+	}
+	catch(const YAML::Exception& ex)
+	{
+		AddErrorMessage("Invalid metadata", string("Failed to parse ") + metaPath + ": " + ex.what());
+		return false;
+	}
+
+	Format fmt;
+	if(!ParseSigMFDatatype(datatype, fmt))
+	{
+		AddErrorMessage("Unsupported file", string("SigMF datatype ") + datatype + " is not supported");
+		return false;
+	}
+	LogTrace("SigMF recording: %s at %s\n",
+		datatype.c_str(), Unit(Unit::UNIT_SAMPLERATE).PrettyPrint(samplerate).c_str());
+
+	m_parameters[m_formatname].SetIntVal(fmt);
+	if(samplerate > 0)
+		m_parameters[m_sratename].SetIntVal(round(samplerate));
+	return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
+/**
+	@brief Advances the loaded window if playback is running
+ */
+void ComplexImportFilter::Refresh()
+{
+	float speed = m_parameters[m_playbackname].GetFloatVal();
+	int64_t start;
+	int64_t end;
+	if( (speed <= 0) || !GetFullTimeRange(start, end) )
+	{
+		m_lastPlaybackTime = 0;
+		return;
+	}
+
+	//First refresh after starting playback doesn't move anything, just picks up from the current window
+	double now = GetTime();
+	if(m_lastPlaybackTime == 0)
+	{
+		m_playbackPosition = max(m_parameters[m_windowStartName].GetIntVal() - start, static_cast<int64_t>(0));
+		m_lastPlaybackTime = now;
+		return;
+	}
+	m_playbackPosition += (now - m_lastPlaybackTime) * speed * FS_PER_SECOND;
+	m_lastPlaybackTime = now;
+
+	//Loop back to the start when we run off the end of the recording
+	auto& ps = m_pagedStreams[0];
+	double pageLength = static_cast<double>(PAGE_SAMPLES) * ps.m_timescale;
+	if(m_playbackPosition >= (end - start))
+		m_playbackPosition = 0;
+
+	//Only request a new window when we cross into another page, since windows are loaded a page at a time
+	int64_t windowStart = start + static_cast<int64_t>(floor(m_playbackPosition / pageLength) * pageLength);
+	RequestTimeWindow(windowStart, m_parameters[m_windowLengthName].GetIntVal());
+}
+
+/**
+	@brief Reloads the file, unless we're already in the middle of loading it
+ */
 void ComplexImportFilter::Reload()
+{
+	if(m_reloading)
+		return;
+
+	m_reloading = true;
+	Load();
+	m_reloading = false;
+}
+
+void ComplexImportFilter::Load()
 {
 	ClearErrors();
+	m_pagedStreams.clear();
+	m_pagedFile = nullptr;
+	m_playbackPosition = 0;
+	m_lastPlaybackTime = 0;
+
 	auto fname = m_parameters[m_fpname].ToString();
 	if(fname.empty())
 	{
@@ -84,38 +251,46 @@ void ComplexImportFilter::Reload()
 		return;
 	}
 
+	//SigMF recordings keep samples and metadata in two files with the same base name, the user may pick either
+	size_t dataOffset = 0;
+	const string metaExt = ".sigmf-meta";
+	const string dataExt = ".sigmf-data";
+	auto ext = fname.rfind('.');
+	if(ext != string::npos)
+	{
+		string suffix = fname.substr(ext);
+		string base = fname.substr(0, ext);
+		if( (suffix == metaExt) || (suffix == dataExt) )
+		{
+			if(!LoadSigMFMetadata(base + metaExt, dataOffset))
+				return;
+			fname = base + dataExt;
+		}
+	}
+
 	//Set waveform timestamp to file timestamp
 	time_t timestamp = 0;
 	int64_t fs = 0;
 	GetTimestampOfFile(fname, timestamp, fs);
 
-	//Load the file
-	FILE* fp = fopen(fname.c_str(), "rb");
-	if(!fp)
+	//Map the file
+	MappedFile file;
+	if(!file.Open(fname))
 	{
 		AddErrorMessage("Missing inputs", string("File ") + fname + " could not be opened");
 		return;
 	}
-	fseek(fp, 0, SEEK_END);
-	size_t len_bytes = ftell(fp);
-	fseek(fp, 0, SEEK_SET);
-	uint8_t* buf = new uint8_t[len_bytes];
-	if(len_bytes != fread(buf, 1, len_bytes, fp))
+	if(dataOffset > file.GetSize())
 	{
-		AddErrorMessage("Read failure", "Failed to read complex data from file");
-		fclose(fp);
-		delete[] buf;
+		AddErrorMessage("Read failure", "Header is larger than the file");
 		return;
 	}
-	fclose(fp);
-	fp = NULL;
 
 	//Create new waveforms
 	int64_t samplerate = m_parameters[m_sratename].GetIntVal();
 	if(samplerate == 0)
 	{
 		AddErrorMessage("Invalid sample rate", "Sample rate is zero");
-		delete[] buf;
 		return;
 	}
 	int64_t interval = FS_PER_SECOND / samplerate;
@@ -125,108 +300,112 @@ void ComplexImportFilter::Reload()
 	iwfm->m_startTimestamp = timestamp;
 	iwfm->m_startFemtoseconds = fs;
 	iwfm->m_triggerPhase = 0;
-	iwfm->PrepareForCpuAccess();
 
 	auto qwfm = SetupEmptyWaveform<UniformAnalogWaveform>(nullptr, 1);
 	qwfm->m_timescale = interval;
 	qwfm->m_startTimestamp = timestamp;
 	qwfm->m_startFemtoseconds = fs;
 	qwfm->m_triggerPhase = 0;
-	qwfm->PrepareForCpuAccess();
 
-	//Figure out actual data element size
-	auto fmt = static_cast<Format>(m_parameters[m_formatname].GetIntVal());
-	int bytes_per_sample = 1;
-	switch(fmt)
+	//Each sample is an I/Q pair, so the stride is twice the component size
+	m_format = static_cast<Format>(m_parameters[m_formatname].GetIntVal());
+	size_t stride = GetComponentSize(m_format) * 2;
+	size_t nsamples = (file.GetSize() - dataOffset) / stride;
+
+	//Convert straight out of the mapped file (or just index it, if paged)
+	if( !LoadMappedSamples(0, iwfm, file, dataOffset, nsamples, stride, 1, 0) ||
+		!LoadMappedSamples(1, qwfm, file, dataOffset, nsamples, stride, 1, 0) )
 	{
-		case FORMAT_UNSIGNED_INT8:
-		case FORMAT_SIGNED_INT8:
-			bytes_per_sample = 1;
-			break;
+		AddErrorMessage("Read failure", "Failed to read complex data from file");
+		return;
+	}
+}
 
-		case FORMAT_SIGNED_INT16:
-			bytes_per_sample = 2;
-			break;
+/**
+	@brief Deinterleaves and converts one component of a block of I/Q samples
 
-		case FORMAT_FLOAT32:
-			bytes_per_sample = 4;
-			break;
+	Elements are read with memcpy() since the data isn't necessarily aligned within the file. The compiler turns this
+	into plain (unaligned) loads.
 
-		case FORMAT_FLOAT64:
-			bytes_per_sample = 8;
-			break;
+	@param pout		Output samples
+	@param pin		First raw element to convert
+	@param stride	Byte stride between consecutive raw elements
+	@param count	Number of samples to convert
+	@param scale	Scale factor applied after subtracting bias
+	@param bias		Code for zero
+ */
+template<class T>
+static void DeinterleaveComponent(float* pout, const uint8_t* pin, size_t stride, size_t count, float scale, float bias)
+{
+	for(size_t i=0; i<count; i++)
+	{
+		T v;
+		memcpy(&v, pin + i*stride, sizeof(T));
+		pout[i] = (static_cast<float>(v) - bias) * scale;
 	}
-	size_t nsamples = len_bytes / (bytes_per_sample * 2);
-	iwfm->Resize(nsamples);
-	qwfm->Resize(nsamples);
+}
 
-	//Actual output processing
-	//TODO: vectorize this?
-	switch(fmt)
+/**
+	@brief Converts the I (stream 0) or Q (stream 1) component of a range of samples
+
+	Works a chunk at a time with read-ahead, like ConvertMappedSamples(). Pages are only released after the Q pass,
+	since the I pass is immediately followed by a Q pass over the same bytes.
+ */
+bool ComplexImportFilter::ConvertMappedWindow(
+	size_t stream,
+	UniformAnalogWaveform* wfm,
+	MappedFile& file,
+	size_t dataOffset,
+	size_t count,
+	size_t bytesPerSample,
+	[[maybe_unused]] float gain,
+	[[maybe_unused]] float offset)
+{
+	auto raw = file.GetPointer(dataOffset, count * bytesPerSample);
+	if(!raw)
+		return false;
+	raw += stream * GetComponentSize(m_format);
+
+	const size_t chunkSamples = 1024 * 1024;
+	const size_t chunkBytes = chunkSamples * bytesPerSample;
+
+	wfm->PrepareForCpuAccess();
+	float* pout = wfm->m_samples.GetCpuPointer();
+
+	file.Prefetch(dataOffset, chunkBytes);
+	for(size_t i=0; i<count; i += chunkSamples)
 	{
-		case FORMAT_UNSIGNED_INT8:
-			{
-				float scale = 1.0f / 127.0f;
-				auto wfm = reinterpret_cast<uint8_t*>(buf);
-				for(size_t i=0; i<nsamples; i++)
-				{
-					iwfm->m_samples[i]	= (wfm[i*2] - 128) * scale;
-					qwfm->m_samples[i]	= (wfm[i*2 + 1] - 128) * scale;
-				}
-			}
-			break;
+		size_t n = min(chunkSamples, count - i);
+		file.Prefetch(dataOffset + (i + chunkSamples)*bytesPerSample, chunkBytes);
 
-		case FORMAT_SIGNED_INT8:
-			{
-				float scale = 1.0f / 127.0f;
-				auto wfm = reinterpret_cast<int8_t*>(buf);
-				for(size_t i=0; i<nsamples; i++)
-				{
-					iwfm->m_samples[i]	= wfm[i*2] * scale;
-					qwfm->m_samples[i]	= wfm[i*2 + 1] * scale;
-				}
-			}
-			break;
+		auto pchunk = raw + i*bytesPerSample;
+		switch(m_format)
+		{
+			case FORMAT_UNSIGNED_INT8:
+				DeinterleaveComponent<uint8_t>(pout + i, pchunk, bytesPerSample, n, 1.0f / 127, 128);
+				break;
 
-		case FORMAT_SIGNED_INT16:
-			{
-				float scale = 1.0f / 32767.0f;
-				auto wfm = reinterpret_cast<int16_t*>(buf);
-				for(size_t i=0; i<nsamples; i++)
-				{
-					iwfm->m_samples[i]	= wfm[i*2] * scale;
-					qwfm->m_samples[i]	= wfm[i*2 + 1] * scale;
-				}
-			}
-			break;
+			case FORMAT_SIGNED_INT8:
+				DeinterleaveComponent<int8_t>(pout + i, pchunk, bytesPerSample, n, 1.0f / 127, 0);
+				break;
 
-		case FORMAT_FLOAT32:
-			{
-				auto wfm = reinterpret_cast<float*>(buf);
-				for(size_t i=0; i<nsamples; i++)
-				{
-					iwfm->m_samples[i]	= wfm[i*2];
-					qwfm->m_samples[i]	= wfm[i*2 + 1];
-				}
-			}
-			break;
+			case FORMAT_SIGNED_INT16:
+				DeinterleaveComponent<int16_t>(pout + i, pchunk, bytesPerSample, n, 1.0f / 32767, 0);
+				break;
 
-		case FORMAT_FLOAT64:
-			{
-				auto wfm = reinterpret_cast<double*>(buf);
-				for(size_t i=0; i<nsamples; i++)
-				{
-					iwfm->m_samples[i]	= wfm[i*2];
-					qwfm->m_samples[i]	= wfm[i*2 + 1];
-				}
-			}
-			break;
+			case FORMAT_FLOAT32:
+				DeinterleaveComponent<float>(pout + i, pchunk, bytesPerSample, n, 1, 0);
+				break;
 
-	}
+			case FORMAT_FLOAT64:
+				DeinterleaveComponent<double>(pout + i, pchunk, bytesPerSample, n, 1, 0);
+				break;
+		}
 
-	iwfm->MarkModifiedFromCpu();
-	qwfm->MarkModifiedFromCpu();
+		if(stream == 1)
+			file.Release(dataOffset + i*bytesPerSample, n*bytesPerSample);
+	}
 
-	//Done, clean up
-	delete[] buf;
+	wfm->MarkModifiedFromCpu();
+	return true;
 }
@@ -35,11 +35,28 @@
 #ifndef ComplexImportFilter_h
 #define ComplexImportFilter_h
 
+/**
+	@brief Imports raw interleaved I/Q recordings, as produced by most SDR software
+
+	The file is memory mapped rather than read, and samples are converted straight out of the page cache. With paged
+	loading on, only the window being viewed is converted, so multi-GB recordings can be browsed on machines with
+	far less RAM.
+
+	SigMF recordings (a .sigmf-data file next to a .sigmf-meta file) are detected by extension, and the sample
+	format and rate are taken from the metadata rather than the parameters.
+
+	Setting a nonzero playback speed while paging turns the filter into a pseudo-instrument: every refresh of the
+	filter graph advances the window by the elapsed wall clock time multiplied by the speed, so downstream filters
+	(spectrograms, constellations) see the recording play back at real time or faster. The window only moves in
+	whole pages, since that is the granularity at which it is loaded.
+ */
 class ComplexImportFilter : public ImportFilter
 {
 public:
 	ComplexImportFilter(const std::string& color);
 
+	virtual void Refresh() override;
+
 	static std::string GetProtocolName();
 
 	PROTOCOL_DECODER_INITPROC(ComplexImportFilter)
@@ -53,11 +70,40 @@ public:
 		FORMAT_FLOAT64
 	};
 
+	static bool ParseSigMFDatatype(const std::string& datatype, Format& fmt);
+
 protected:
 	std::string m_formatname;
 	std::string m_sratename;
+	std::string m_playbackname;
 
 	void Reload();
+	void Load();
+	bool LoadSigMFMetadata(const std::string& metaPath, size_t& dataOffset);
+
+	virtual bool ConvertMappedWindow(
+		size_t stream,
+		UniformAnalogWaveform* wfm,
+		MappedFile& file,
+		size_t dataOffset,
+		size_t count,
+		size_t bytesPerSample,
+		float gain,
+		float offset) override;
+
+	static size_t GetComponentSize(Format fmt);
+
+	///@brief Sample format of the currently loaded file
+	Format m_format;
+
+	///@brief True while Reload() is running, so parameters it updates from metadata don't trigger another reload
+	bool m_reloading;
+
+	///@brief Playback position relative to the start of the recording, in X axis units
+	double m_playbackPosition;
+
+	///@brief GetTime() at the previous playback step, or zero if playback is stopped
+	double m_lastPlaybackTime;
 };
 
 #endif
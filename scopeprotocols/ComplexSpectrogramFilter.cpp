@@ -112,12 +112,12 @@ void ComplexSpectrogramFilter::ReallocateBuffers(size_t fftlen, size_t nblocks)
 	size_t nouts = fftlen;
 	if(m_vkPlan)
 	{
-		if(m_vkPlan->size() != fftlen)
+		if( (m_vkPlan->size() != fftlen) || (m_vkPlan->GetNumBatches() != nblocks) )
 			m_vkPlan = nullptr;
 	}
 	if(!m_vkPlan)
 	{
-		m_vkPlan = make_unique<VulkanFFTPlan>(
+		m_vkPlan = g_fftPlanCache->Acquire(
 			fftlen, nouts, VulkanFFTPlan::DIRECTION_FORWARD, nblocks, VulkanFFTPlan::TYPE_COMPLEX);
 	}
 
@@ -322,6 +322,8 @@ void ComplexSpectrogramFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_p
 	postargs.minscale = minscale;
 	postargs.irange = 1.0 / range;
 	postargs.ygrid = min(g_maxComputeGroupCount[2], nblocks);
+	postargs.width = nblocks;
+	postargs.colOffset = 0;
 	m_postprocessComputePipeline.AddComputeMemoryBarrier(cmdBuf);
 	m_postprocessComputePipeline.BindBufferNonblocking(0, m_rdoutbuf, cmdBuf);
 	m_postprocessComputePipeline.BindBufferNonblocking(1, cap->GetOutData(), cmdBuf, true);
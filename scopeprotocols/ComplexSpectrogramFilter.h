@@ -35,7 +35,7 @@
 #ifndef ComplexSpectrogramFilter_h
 #define ComplexSpectrogramFilter_h
 
-#include "VulkanFFTPlan.h"
+#include "VulkanFFTPlanCache.h"
 
 #include "../scopehal/DensityFunctionWaveform.h"
 #include "SpectrogramFilter.h"
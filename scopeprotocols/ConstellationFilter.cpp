@@ -29,6 +29,7 @@
 
 #include "../scopehal/scopehal.h"
 #include "ConstellationFilter.h"
+#include "../scopehal/EyeWaveform.h"
 #include <algorithm>
 #ifdef __x86_64__
 #include <immintrin.h>
@@ -50,10 +51,16 @@ ConstellationFilter::ConstellationFilter(const string& color)
 	, m_nomr("Range")
 	, m_evmSum(0)
 	, m_evmCount(0)
+	, m_errPowerSum(0)
+	, m_refPowerSum(0)
+	, m_nmaxBuf("ConstellationFilter.nmaxBuf")
+	, m_pointsBuf("ConstellationFilter.pointsBuf")
+	, m_statsBuf("ConstellationFilter.statsBuf")
 {
 	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_CONSTELLATION);
 	AddStream(Unit(Unit::UNIT_VOLTS), "EVM raw", Stream::STREAM_TYPE_ANALOG_SCALAR);
 	AddStream(Unit(Unit::UNIT_PERCENT), "EVM normalized", Stream::STREAM_TYPE_ANALOG_SCALAR);
+	AddStream(Unit(Unit::UNIT_DB), "MER", Stream::STREAM_TYPE_ANALOG_SCALAR);
 
 	m_xAxisUnit = Unit(Unit::UNIT_MICROVOLTS);
 
@@ -79,6 +86,25 @@ ConstellationFilter::ConstellationFilter(const string& color)
 
 	m_parameters[m_nomr] = FilterParameter(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_VOLTS));
 	m_parameters[m_nomr].SetFloatVal(0.5);
+
+	//GPU accumulation needs 64-bit atomics
+	if(g_hasShaderInt64 && g_hasShaderAtomicInt64)
+	{
+		m_accumulatePipeline = make_shared<ComputePipeline>(
+			"shaders/ConstellationFilter_Accumulate.spv", 6, sizeof(ConstellationAccumulateConstants));
+		m_normalizeScalePipeline = make_shared<ComputePipeline>(
+			"shaders/EyeNormalizeScale.spv", 3, sizeof(EyeNormalizeConstants));
+	}
+
+	m_nmaxBuf.SetCpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
+	m_nmaxBuf.SetGpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
+	m_nmaxBuf.resize(1);
+
+	m_pointsBuf.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_pointsBuf.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+
+	m_statsBuf.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_statsBuf.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -129,11 +155,11 @@ void ConstellationFilter::ClearSweeps()
 	SetData(nullptr, 0);
 	m_evmSum = 0;
 	m_evmCount = 0;
+	m_errPowerSum = 0;
+	m_refPowerSum = 0;
 }
 
-void ConstellationFilter::Refresh(
-	[[maybe_unused]] vk::raii::CommandBuffer& cmdBuf,
-	[[maybe_unused]] shared_ptr<QueueHandle> queue)
+void ConstellationFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
 	ClearErrors();
 	if(!VerifyAllInputsOK())
@@ -177,48 +203,131 @@ void ConstellationFilter::Refresh(
 	auto cap = dynamic_cast<ConstellationWaveform*>(GetData(0));
 	if(!cap)
 		cap = ReallocateWaveform();
-	cap->PrepareForCpuAccess();
 
 	//Recompute scales
 	float xscale = m_width / GetVoltageRange(0);
 	float xmid = m_width / 2;
 	float yscale = m_height / GetVoltageRange(0);
 	float ymid = m_height / 2;
+	float centerI = m_parameters[m_nomci].GetFloatVal();
+	float centerQ = m_parameters[m_nomcq].GetFloatVal();
 
-	//Actual integration loop
-	//TODO: vectorize, GPU, or both?
-	auto data = cap->GetAccumData();
-	for(size_t i=0; i<inlen; i++)
+	if(m_accumulatePipeline && (inlen > 0) )
 	{
-		float ival = samples_i.m_samples[i];
-		float qval = samples_q.m_samples[i];
+		//Upload the nominal points in volts
+		size_t npoints = m_points.size();
+		m_pointsBuf.resize(max(npoints, (size_t)1) * 2);
+		m_pointsBuf.PrepareForCpuAccess();
+		for(size_t i=0; i<npoints; i++)
+		{
+			m_pointsBuf[i*2] = m_points[i].m_xval * 1e-6;
+			m_pointsBuf[i*2 + 1] = m_points[i].m_yval;
+		}
+		m_pointsBuf.MarkModifiedFromCpu();
+
+		ConstellationAccumulateConstants cfg;
+		cfg.len = inlen;
+		cfg.width = m_width;
+		cfg.height = m_height;
+		cfg.numPoints = npoints;
+		cfg.xscale = xscale;
+		cfg.xmid = xmid;
+		cfg.yscale = yscale;
+		cfg.ymid = ymid;
+		cfg.centerI = centerI;
+		cfg.centerQ = centerQ;
+
+		const uint32_t threadsPerBlock = 64;
+		uint32_t numBlocks = min(GetComputeBlockCount(inlen, threadsPerBlock), 1024u);
+		m_statsBuf.resize(numBlocks * 4);
+
+		//Bin the symbols and measure error vectors in one pass, then normalize straight from the accumulator
+		cmdBuf.begin({});
+
+		m_accumulatePipeline->BindBufferNonblocking(0, samples_i.m_samples, cmdBuf);
+		m_accumulatePipeline->BindBufferNonblocking(1, samples_q.m_samples, cmdBuf);
+		m_accumulatePipeline->BindBufferNonblocking(2, cap->GetAccumBuffer(), cmdBuf);
+		m_accumulatePipeline->BindBufferNonblocking(3, m_nmaxBuf, cmdBuf);
+		m_accumulatePipeline->BindBufferNonblocking(4, m_pointsBuf, cmdBuf);
+		m_accumulatePipeline->BindBufferNonblocking(5, m_statsBuf, cmdBuf, true);
+		m_accumulatePipeline->Dispatch(cmdBuf, cfg, numBlocks);
+		m_accumulatePipeline->AddComputeMemoryBarrier(cmdBuf);
+
+		cap->GetAccumBuffer().MarkModifiedFromGpu();
+		m_nmaxBuf.MarkModifiedFromGpu();
+		m_statsBuf.MarkModifiedFromGpu();
+
+		cap->Normalize(cmdBuf, m_normalizeScalePipeline, m_nmaxBuf);
+
+		cmdBuf.end();
+		queue->SubmitAndBlock(cmdBuf);
+
+		//Sum the per-workgroup statistics
+		m_statsBuf.PrepareForCpuAccess();
+		for(size_t i=0; i<numBlocks; i++)
+		{
+			m_evmSum += m_statsBuf[i*4];
+			m_errPowerSum += m_statsBuf[i*4 + 1];
+			m_refPowerSum += m_statsBuf[i*4 + 2];
+			m_evmCount += static_cast<int64_t>(m_statsBuf[i*4 + 3]);
+		}
+	}
 
-		ssize_t x = static_cast<ssize_t>(round(xmid + xscale * ival));
-		ssize_t y = static_cast<ssize_t>(round(ymid + yscale * qval));
+	else
+	{
+		//Actual integration loop
+		auto data = cap->GetAccumData();
+		int64_t nmax = 0;
+		for(size_t i=0; i<inlen; i++)
+		{
+			float ival = samples_i.m_samples[i];
+			float qval = samples_q.m_samples[i];
 
-		//bounds check
-		if( (x < 0) || (x >= (ssize_t)m_width) || (y < 0) || (y >= (ssize_t)m_height) )
-			continue;
+			ssize_t x = static_cast<ssize_t>(round(xmid + xscale * ival));
+			ssize_t y = static_cast<ssize_t>(round(ymid + yscale * qval));
 
-		//fill
-		data[y*m_width + x] ++;
+			//bounds check
+			if( (x < 0) || (x >= (ssize_t)m_width) || (y < 0) || (y >= (ssize_t)m_height) )
+				continue;
 
-		//Compute error vector
-		if(m_points.size())
-		{
-			//TODO: this can definitely be made more efficient!!!
-			float minvec = FLT_MAX;
-			for(auto p : m_points)
+			//fill
+			nmax = max(nmax, ++data[y*m_width + x]);
+
+			//Compute error vector
+			if(m_points.size())
 			{
-				float dx = (p.m_xval * 1e-6) - ival;
-				float dy = p.m_yval - qval;
-				float dsq = dx*dx + dy*dy;
-				minvec = min(minvec, dsq);
-			}
+				float minvec = FLT_MAX;
+				size_t nearest = 0;
+				for(size_t j=0; j<m_points.size(); j++)
+				{
+					auto& p = m_points[j];
+					float dx = (p.m_xval * 1e-6) - ival;
+					float dy = p.m_yval - qval;
+					float dsq = dx*dx + dy*dy;
+					if(dsq < minvec)
+					{
+						minvec = dsq;
+						nearest = j;
+					}
+				}
+
+				float ri = (m_points[nearest].m_xval * 1e-6) - centerI;
+				float rq = m_points[nearest].m_yval - centerQ;
 
-			m_evmCount ++;
-			m_evmSum += sqrt(minvec);
+				m_evmCount ++;
+				m_evmSum += sqrt(minvec);
+				m_errPowerSum += minvec;
+				m_refPowerSum += ri*ri + rq*rq;
+			}
 		}
+		cap->GetAccumBuffer().MarkModifiedFromCpu();
+
+		//Keep the peak in sync in case a later refresh runs on the GPU
+		m_nmaxBuf.PrepareForCpuAccess();
+		m_nmaxBuf[0] = max(m_nmaxBuf[0], nmax);
+		m_nmaxBuf.MarkModifiedFromCpu();
+
+		cap->Normalize();
 	}
 
 	double evmRaw = m_evmSum / m_evmCount;
@@ -226,10 +335,11 @@ void ConstellationFilter::Refresh(
 
 	m_streams[1].m_value = evmRaw;
 	m_streams[2].m_value = evmNorm;
+	if(m_errPowerSum > 0)
+		m_streams[3].m_value = 10 * log10(m_refPowerSum / m_errPowerSum);
 
 	//Count total number of symbols we've integrated
 	cap->IntegrateSymbols(inlen);
-	cap->Normalize();
 }
 
 void ConstellationFilter::RecomputeNominalPoints()
@@ -363,6 +473,12 @@ ConstellationWaveform* ConstellationFilter::ReallocateWaveform()
 	auto cap = new ConstellationWaveform(m_width, m_height);
 	cap->m_timescale = 1;
 	SetData(cap, 0);
+
+	//New accumulator, so start the peak over
+	m_nmaxBuf.PrepareForCpuAccess();
+	m_nmaxBuf[0] = 0;
+	m_nmaxBuf.MarkModifiedFromCpu();
+
 	return cap;
 }
 
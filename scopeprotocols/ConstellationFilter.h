@@ -62,6 +62,21 @@ public:
 	float m_ynorm;
 };
 
+class ConstellationAccumulateConstants
+{
+public:
+	uint32_t	len;
+	uint32_t	width;
+	uint32_t	height;
+	uint32_t	numPoints;
+	float		xscale;
+	float		xmid;
+	float		yscale;
+	float		ymid;
+	float		centerI;
+	float		centerQ;
+};
+
 class ConstellationFilter
 	: public Filter
 	, public ActionProvider
@@ -156,6 +171,24 @@ protected:
 	double m_evmSum;
 	int64_t m_evmCount;
 
+	///@brief Sum of squared error vector magnitudes, for MER
+	double m_errPowerSum;
+
+	///@brief Sum of squared magnitudes of the nominal points symbols were matched to, for MER
+	double m_refPowerSum;
+
+	///@brief Peak accumulator value, updated by the accumulation kernel
+	AcceleratorBuffer<int64_t> m_nmaxBuf;
+
+	///@brief Nominal points (I and Q, in volts) for the accumulation kernel
+	AcceleratorBuffer<float> m_pointsBuf;
+
+	///@brief Error vector statistics from each workgroup of the accumulation kernel
+	AcceleratorBuffer<float> m_statsBuf;
+
+	std::shared_ptr<ComputePipeline> m_accumulatePipeline;
+	std::shared_ptr<ComputePipeline> m_normalizeScalePipeline;
+
 	///@brief Nominal locations of each constellation point
 	std::vector<ConstellationPoint> m_points;
 };
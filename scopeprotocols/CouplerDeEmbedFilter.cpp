@@ -226,11 +226,11 @@ void CouplerDeEmbedFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<Q
 
 	//Set up new FFT plans
 	if(!m_vkForwardPlan)
-		m_vkForwardPlan = make_unique<VulkanFFTPlan>(npoints, nouts, VulkanFFTPlan::DIRECTION_FORWARD);
+		m_vkForwardPlan = g_fftPlanCache->Acquire(npoints, nouts, VulkanFFTPlan::DIRECTION_FORWARD);
 	if(!m_vkForwardPlan2)
-		m_vkForwardPlan2 = make_unique<VulkanFFTPlan>(npoints, nouts, VulkanFFTPlan::DIRECTION_FORWARD);
+		m_vkForwardPlan2 = g_fftPlanCache->Acquire(npoints, nouts, VulkanFFTPlan::DIRECTION_FORWARD);
 	if(!m_vkReversePlan)
-		m_vkReversePlan = make_unique<VulkanFFTPlan>(npoints, nouts, VulkanFFTPlan::DIRECTION_REVERSE);
+		m_vkReversePlan = g_fftPlanCache->Acquire(npoints, nouts, VulkanFFTPlan::DIRECTION_REVERSE);
 
 	//Calculate size of each bin
 	double fs = dinFwd->m_timescale;
@@ -411,7 +411,7 @@ void CouplerDeEmbedFilter::GroupDelayCorrection(
  */
 void CouplerDeEmbedFilter::GenerateScalarOutput(
 	vk::raii::CommandBuffer& cmdBuf,
-	unique_ptr<VulkanFFTPlan>& plan,
+	VulkanFFTPlanHandle& plan,
 	size_t istart,
 	size_t iend,
 	WaveformBase* refin,
@@ -506,7 +506,7 @@ void CouplerDeEmbedFilter::ApplySParametersInPlace(
  */
 void CouplerDeEmbedFilter::ProcessScalarInput(
 	vk::raii::CommandBuffer& cmdBuf,
-	unique_ptr<VulkanFFTPlan>& plan,
+	VulkanFFTPlanHandle& plan,
 	AcceleratorBuffer<float>& samplesIn,
 	AcceleratorBuffer<float>& samplesOut,
 	size_t npointsPadded,
@@ -0,0 +1,246 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of CrossCorrelator
+ */
+#include "../scopehal/scopehal.h"
+#include "CrossCorrelator.h"
+
+using namespace std;
+
+CrossCorrelator::CrossCorrelator()
+	: m_npoints(0)
+	, m_refLen(0)
+	, m_refSpectrumValid(false)
+	, m_padComputePipeline("shaders/RectangularWindow.spv", 2, sizeof(WindowFunctionArgs))
+	, m_multiplyComputePipeline("shaders/CrossCorrelator_Multiply.spv", 2, sizeof(CrossCorrelatorMultiplyArgs))
+	, m_extractComputePipeline("shaders/CrossCorrelator_Extract.spv", 2, sizeof(CrossCorrelatorExtractArgs))
+{
+}
+
+/**
+	@brief Cross-correlates two signals
+
+	On return, dout[k] is the mean of ref[i] * sig[i + firstLag + k] over all i where both samples exist. Every
+	requested lag must leave at least one sample of overlap, i.e. -reflen < firstLag and firstLag + numLags <= siglen.
+
+	@param cmdBuf	Command buffer to record into (must not be in the recording state)
+	@param queue	Queue to submit to
+	@param ref		Reference signal
+	@param reflen	Number of reference samples to use (may be less than the size of ref)
+	@param refKey	Identifies the waveform ref came from, so its spectrum can be reused by later calls.
+					Pass an empty key if ref is not a waveform's sample buffer.
+	@param sig		Signal to correlate against the reference
+	@param siglen	Number of signal samples to use
+	@param firstLag	First lag to output
+	@param numLags	Number of lags to output
+	@param dout		Output buffer, resized to numLags
+ */
+void CrossCorrelator::Correlate(
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue,
+	AcceleratorBuffer<float>& ref,
+	size_t reflen,
+	WaveformCacheKey refKey,
+	AcceleratorBuffer<float>& sig,
+	size_t siglen,
+	int64_t firstLag,
+	size_t numLags,
+	AcceleratorBuffer<float>& dout)
+{
+	dout.resize(numLags);
+	if(numLags == 0)
+		return;
+
+	//The circular correlation at lag d also picks up the linear correlation at d +/- npoints. Those are all zero
+	//(no overlap) as long as npoints >= lastLag + reflen and npoints >= siglen - firstLag.
+	int64_t lastLag = firstLag + static_cast<int64_t>(numLags) - 1;
+	int64_t minlen = max(lastLag + static_cast<int64_t>(reflen), static_cast<int64_t>(siglen) - firstLag);
+	size_t npoints = next_pow2(max( { reflen, siglen, static_cast<size_t>(minlen) } ));
+	size_t nouts = npoints/2 + 1;
+
+	//Set up the FFT and allocate buffers if we change point count
+	if(m_npoints != npoints)
+	{
+		m_forwardPlan = g_fftPlanCache->Acquire(npoints, nouts, VulkanFFTPlan::DIRECTION_FORWARD);
+		m_reversePlan = g_fftPlanCache->Acquire(npoints, nouts, VulkanFFTPlan::DIRECTION_REVERSE);
+
+		m_refPadded.resize(npoints);
+		m_refSpectrum.resize(2 * nouts);
+		m_sigPadded.resize(npoints);
+		m_sigSpectrum.resize(2 * nouts);
+
+		m_npoints = npoints;
+		m_refSpectrumValid = false;
+	}
+
+	PrepareReference(cmdBuf, queue, ref, reflen, refKey);
+
+	cmdBuf.begin({});
+
+	//Zero pad the signal and transform it
+	WindowFunctionArgs args;
+	args.numActualSamples = siglen;
+	args.npoints = npoints;
+	args.scale = 0;
+	args.alpha0 = 0;
+	args.alpha1 = 0;
+	args.offsetIn = 0;
+	args.offsetOut = 0;
+	m_padComputePipeline.BindBufferNonblocking(0, sig, cmdBuf);
+	m_padComputePipeline.BindBufferNonblocking(1, m_sigPadded, cmdBuf, true);
+	uint32_t compute_block_count = GetComputeBlockCount(npoints, 64);
+	m_padComputePipeline.Dispatch(cmdBuf, args,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
+	m_padComputePipeline.AddComputeMemoryBarrier(cmdBuf);
+	m_sigPadded.MarkModifiedFromGpu();
+
+	m_forwardPlan->AppendForward(m_sigPadded, m_sigSpectrum, cmdBuf);
+
+	//Multiply by the conjugate of the reference spectrum
+	CrossCorrelatorMultiplyArgs margs;
+	margs.nouts = nouts;
+	m_multiplyComputePipeline.BindBufferNonblocking(0, m_sigSpectrum, cmdBuf);
+	m_multiplyComputePipeline.BindBufferNonblocking(1, m_refSpectrum, cmdBuf);
+	compute_block_count = GetComputeBlockCount(nouts, 64);
+	m_multiplyComputePipeline.Dispatch(cmdBuf, margs,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
+	m_multiplyComputePipeline.AddComputeMemoryBarrier(cmdBuf);
+	m_sigSpectrum.MarkModifiedFromGpu();
+
+	m_reversePlan->AppendReverse(m_sigSpectrum, m_sigPadded, cmdBuf);
+
+	//Pull out the lags we want and normalize by FFT length and overlap
+	CrossCorrelatorExtractArgs eargs;
+	eargs.numLags = numLags;
+	eargs.npoints = npoints;
+	eargs.firstLag = firstLag;
+	eargs.reflen = reflen;
+	eargs.siglen = siglen;
+	eargs.scale = 1.0f / npoints;
+	m_extractComputePipeline.BindBufferNonblocking(0, m_sigPadded, cmdBuf);
+	m_extractComputePipeline.BindBufferNonblocking(1, dout, cmdBuf, true);
+	compute_block_count = GetComputeBlockCount(numLags, 64);
+	m_extractComputePipeline.Dispatch(cmdBuf, eargs,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
+	m_extractComputePipeline.AddComputeMemoryBarrier(cmdBuf);
+
+	cmdBuf.end();
+	queue->SubmitAndBlock(cmdBuf);
+	dout.MarkModifiedFromGpu();
+}
+
+/**
+	@brief Zero pads and transforms the reference signal, unless the cached spectrum is still good
+ */
+void CrossCorrelator::PrepareReference(
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue,
+	AcceleratorBuffer<float>& ref,
+	size_t reflen,
+	WaveformCacheKey refKey)
+{
+	//An empty key means we have no way to tell if the data changed
+	if(m_refSpectrumValid && (refKey != WaveformCacheKey()) && (m_refKey == refKey) && (m_refLen == reflen) )
+		return;
+
+	cmdBuf.begin({});
+
+	WindowFunctionArgs args;
+	args.numActualSamples = reflen;
+	args.npoints = m_npoints;
+	args.scale = 0;
+	args.alpha0 = 0;
+	args.alpha1 = 0;
+	args.offsetIn = 0;
+	args.offsetOut = 0;
+	m_padComputePipeline.BindBufferNonblocking(0, ref, cmdBuf);
+	m_padComputePipeline.BindBufferNonblocking(1, m_refPadded, cmdBuf, true);
+	uint32_t compute_block_count = GetComputeBlockCount(m_npoints, 64);
+	m_padComputePipeline.Dispatch(cmdBuf, args,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
+	m_padComputePipeline.AddComputeMemoryBarrier(cmdBuf);
+	m_refPadded.MarkModifiedFromGpu();
+
+	m_forwardPlan->AppendForward(m_refPadded, m_refSpectrum, cmdBuf);
+
+	cmdBuf.end();
+	queue->SubmitAndBlock(cmdBuf);
+
+	m_refKey = refKey;
+	m_refLen = reflen;
+	m_refSpectrumValid = true;
+}
+
+/**
+	@brief Finds the location of the largest value in a correlation, to a fraction of a sample
+
+	The integer peak is refined by fitting a parabola through it and its two neighbors.
+
+	@param corr	Correlation output from Correlate()
+
+	@return Index of the peak
+ */
+float CrossCorrelator::FindPeak(AcceleratorBuffer<float>& corr)
+{
+	corr.PrepareForCpuAccess();
+	size_t len = corr.size();
+	if(len == 0)
+		return 0;
+
+	size_t ipeak = 0;
+	float vpeak = corr[0];
+	for(size_t i=1; i<len; i++)
+	{
+		if(corr[i] > vpeak)
+		{
+			vpeak = corr[i];
+			ipeak = i;
+		}
+	}
+
+	//Can't interpolate at the edges
+	if( (ipeak == 0) || (ipeak + 1 >= len) )
+		return ipeak;
+
+	float y0 = corr[ipeak-1];
+	float y1 = corr[ipeak];
+	float y2 = corr[ipeak+1];
+	float denom = y0 - 2*y1 + y2;
+	if(denom >= 0)
+		return ipeak;
+
+	return ipeak + 0.5f * (y0 - y2) / denom;
+}
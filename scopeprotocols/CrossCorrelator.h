@@ -0,0 +1,146 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of CrossCorrelator
+ */
+#ifndef CrossCorrelator_h
+#define CrossCorrelator_h
+
+/**
+	@brief Push constants for CrossCorrelator_Multiply.glsl
+ */
+struct CrossCorrelatorMultiplyArgs
+{
+	uint32_t nouts;
+};
+
+/**
+	@brief Push constants for CrossCorrelator_Extract.glsl
+ */
+struct CrossCorrelatorExtractArgs
+{
+	///@brief Number of lags to output
+	uint32_t numLags;
+
+	///@brief FFT length
+	uint32_t npoints;
+
+	///@brief Lag of the first output sample
+	int32_t firstLag;
+
+	///@brief Length of the reference signal
+	uint32_t reflen;
+
+	///@brief Length of the other signal
+	uint32_t siglen;
+
+	///@brief Normalization for the round trip through the FFT
+	float scale;
+};
+
+/**
+	@brief FFT based cross-correlation of two uniformly sampled signals
+
+	Computes r[d] = mean(ref[i] * sig[i+d]) over the indexes where both signals have samples, for a contiguous range
+	of lags d. Both signals are zero padded to a power of two long enough that no wanted lag is corrupted by circular
+	wraparound, then the correlation is conj(FFT(ref)) * FFT(sig) transformed back to the time domain. This is
+	O(N log N) regardless of how many lags are requested, vs O(N * lags) for the direct form.
+
+	The reference spectrum is only recomputed when the reference waveform, its length, or the FFT size changes, so
+	correlating a live channel against a fixed reference costs one forward and one inverse FFT per trigger.
+ */
+class CrossCorrelator
+{
+public:
+	CrossCorrelator();
+
+	void Correlate(
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue,
+		AcceleratorBuffer<float>& ref,
+		size_t reflen,
+		WaveformCacheKey refKey,
+		AcceleratorBuffer<float>& sig,
+		size_t siglen,
+		int64_t firstLag,
+		size_t numLags,
+		AcceleratorBuffer<float>& dout);
+
+	static float FindPeak(AcceleratorBuffer<float>& corr);
+
+	///@brief Returns the FFT length used by the last Correlate() call
+	size_t GetFFTLength() const
+	{ return m_npoints; }
+
+protected:
+	void PrepareReference(
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue,
+		AcceleratorBuffer<float>& ref,
+		size_t reflen,
+		WaveformCacheKey refKey);
+
+	///@brief FFT length
+	size_t m_npoints;
+
+	///@brief Length of the reference signal m_refSpectrum was computed from
+	size_t m_refLen;
+
+	///@brief Waveform m_refSpectrum was computed from
+	WaveformCacheKey m_refKey;
+
+	///@brief True if m_refSpectrum is up to date
+	bool m_refSpectrumValid;
+
+	///@brief Zero padded reference signal
+	AcceleratorBuffer<float> m_refPadded;
+
+	///@brief Spectrum of the reference signal
+	AcceleratorBuffer<float> m_refSpectrum;
+
+	///@brief Zero padded signal, then the correlation
+	AcceleratorBuffer<float> m_sigPadded;
+
+	///@brief Spectrum of the signal, then the cross spectrum
+	AcceleratorBuffer<float> m_sigSpectrum;
+
+	///@brief Forward FFT, of the reference and then (in a separate submission) the signal
+	VulkanFFTPlanHandle m_forwardPlan;
+
+	///@brief Inverse FFT of the cross spectrum
+	VulkanFFTPlanHandle m_reversePlan;
+
+	ComputePipeline m_padComputePipeline;
+	ComputePipeline m_multiplyComputePipeline;
+	ComputePipeline m_extractComputePipeline;
+};
+
+#endif
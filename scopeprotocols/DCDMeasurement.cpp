@@ -98,8 +98,14 @@ void DCDMeasurement::Refresh(
 
 	//Get the input data
 	auto ddj = dynamic_cast<DDJMeasurement*>(GetInput(0).m_channel);
-	float* table = ddj->GetDDJTable();
+	m_streams[0].m_value = CalculateDCD(ddj->GetDDJTable());
+}
 
+/**
+	@brief Calculates duty cycle distortion from a 256-entry DDJ table, as returned by DDJMeasurement::GetDDJTable()
+ */
+float DCDMeasurement::CalculateDCD(const float* table)
+{
 	//Check all of the bins and find total jitter for rising and falling edges.
 	//Note that the table has LSB most recent, so 10...... is a rising edge and 01...... is a falling edge.
 	//We check for zero in case the table is incomplete (this should not drag the mean down).
@@ -126,5 +132,5 @@ void DCDMeasurement::Refresh(
 
 	float rising_avg = rising_sum / rising_count;
 	float falling_avg = falling_sum / falling_count;
-	m_streams[0].m_value = fabs(rising_avg - falling_avg);
+	return fabs(rising_avg - falling_avg);
 }
@@ -47,6 +47,8 @@ public:
 
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
+	static float CalculateDCD(const float* table);
+
 	PROTOCOL_DECODER_INITPROC(DCDMeasurement)
 };
 
@@ -76,6 +76,29 @@ string DDR3Decoder::GetProtocolName()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
+/**
+	@brief DDR3 command for each combination of RAS#, CAS#, WE#, and A10 (indexed by SDRAMDecoderBase::CommandBits)
+ */
+static const SDRAMSymbol::stype g_ddr3Commands[SDRAMDecoderBase::COMMAND_TABLE_SIZE] =
+{
+	SDRAMSymbol::TYPE_MRS,		//RAS=0 CAS=0 WE=0 A10=0
+	SDRAMSymbol::TYPE_MRS,		//RAS=0 CAS=0 WE=0 A10=1
+	SDRAMSymbol::TYPE_REF,		//RAS=0 CAS=0 WE=1 A10=0
+	SDRAMSymbol::TYPE_REF,		//RAS=0 CAS=0 WE=1 A10=1
+	SDRAMSymbol::TYPE_PRE,		//RAS=0 CAS=1 WE=0 A10=0
+	SDRAMSymbol::TYPE_PREA,		//RAS=0 CAS=1 WE=0 A10=1
+	SDRAMSymbol::TYPE_ACT,		//RAS=0 CAS=1 WE=1 A10=0
+	SDRAMSymbol::TYPE_ACT,		//RAS=0 CAS=1 WE=1 A10=1
+	SDRAMSymbol::TYPE_WR,		//RAS=1 CAS=0 WE=0 A10=0
+	SDRAMSymbol::TYPE_WRA,		//RAS=1 CAS=0 WE=0 A10=1
+	SDRAMSymbol::TYPE_RD,		//RAS=1 CAS=0 WE=1 A10=0
+	SDRAMSymbol::TYPE_RDA,		//RAS=1 CAS=0 WE=1 A10=1
+	SDRAMSymbol::TYPE_ERROR,	//RAS=1 CAS=1 WE=0 A10=0 (ZQ calibration, not decoded)
+	SDRAMSymbol::TYPE_ERROR,	//RAS=1 CAS=1 WE=0 A10=1 (ZQ calibration, not decoded)
+	SDRAMSymbol::TYPE_ERROR,	//RAS=1 CAS=1 WE=1 A10=0 (NOP)
+	SDRAMSymbol::TYPE_ERROR		//RAS=1 CAS=1 WE=1 A10=1 (NOP)
+};
+
 void DDR3Decoder::Refresh()
 {
 	if(!VerifyAllInputsOK())
@@ -87,93 +110,18 @@ void DDR3Decoder::Refresh()
 	//Get the input data
 	WaveformBase* caps[7] = {0};
 	for(int i=0; i<7; i++)
-	{
 		caps[i] = GetInputWaveform(i);
-		caps[i]->PrepareForCpuAccess();
-	}
-
-	//Sample all of the inputs
-	auto cclk = caps[0];
-	SparseDigitalWaveform we;
-	SparseDigitalWaveform ras;
-	SparseDigitalWaveform cas;
-	SparseDigitalWaveform cs;
-	SparseDigitalWaveform a12;
-	SparseDigitalWaveform a10;
-	SampleOnRisingEdgesBase(caps[1], cclk, we);
-	SampleOnRisingEdgesBase(caps[2], cclk, ras);
-	SampleOnRisingEdgesBase(caps[3], cclk, cas);
-	SampleOnRisingEdgesBase(caps[4], cclk, cs);
-	SampleOnRisingEdgesBase(caps[5], cclk, a12);
-	SampleOnRisingEdgesBase(caps[6], cclk, a10);
 
 	//Create the capture
 	auto cap = new SDRAMWaveform;
 	cap->m_timescale = 1;
-	cap->m_startTimestamp = cclk->m_startTimestamp;
+	cap->m_startTimestamp = caps[0]->m_startTimestamp;
 	cap->m_startFemtoseconds = 0;
 	cap->PrepareForCpuAccess();
 
-	//Loop over the data and look for events on clock edges
-	size_t len = we.size();
-	len = min(len, ras.size());
-	len = min(len, cas.size());
-	len = min(len, cs.size());
-	len = min(len, a12.size());
-	len = min(len, a10.size());
-	for(size_t i=0; i<len; i++)
-	{
-		bool swe = we.m_samples[i];
-		bool sras = ras.m_samples[i];
-		bool scas = cas.m_samples[i];
-		bool scs = cs.m_samples[i];
-		bool sa12 = a12.m_samples[i];
-		bool sa10 = a10.m_samples[i];
-
-		if(!scs)
-		{
-			//NOP
-			if(sras && scas && swe)
-				continue;
-
-			SDRAMSymbol sym(SDRAMSymbol::TYPE_ERROR);
-
-			if(!sras && !scas && !swe)
-				sym.m_stype = SDRAMSymbol::TYPE_MRS;
-			else if(!sras && !scas && swe)
-				sym.m_stype = SDRAMSymbol::TYPE_REF;
-			else if(!sras && scas && !swe && !sa10)
-				sym.m_stype = SDRAMSymbol::TYPE_PRE;
-			else if(!sras && scas && !swe && sa10)
-				sym.m_stype = SDRAMSymbol::TYPE_PREA;
-			else if(!sras && scas && swe)
-				sym.m_stype = SDRAMSymbol::TYPE_ACT;
-			else if(sras && !scas && !swe)
-			{
-				if(!sa10)
-					sym.m_stype = SDRAMSymbol::TYPE_WR;
-				else
-					sym.m_stype = SDRAMSymbol::TYPE_WRA;
-			}
-			else if(sras && !scas && swe)
-			{
-				if(!sa10)
-					sym.m_stype = SDRAMSymbol::TYPE_RD;
-				else
-					sym.m_stype = SDRAMSymbol::TYPE_RDA;
-			}
-
-			//Unknown
-			//TODO: self refresh entry/exit (we don't have CKE in the current test data source so can't use it)
-			else
-				LogDebug("[%zu] Unknown command (RAS=%d, CAS=%d, WE=%d, A12=%d, A10=%d)\n", i, sras, scas, swe, sa12, sa10);
-
-			//Create the symbol
-			cap->m_offsets.push_back(we.m_offsets[i]);
-			cap->m_durations.push_back(we.m_durations[i]);
-			cap->m_samples.push_back(sym);
-		}
-	}
+	//Sample the command bus on clock edges and look for commands
+	DecodeCommands(caps[0], caps[4], caps[2], caps[3], caps[1], caps[6], g_ddr3Commands, cap);
+
 	SetData(cap, 0);
 	cap->MarkModifiedFromCpu();
 }
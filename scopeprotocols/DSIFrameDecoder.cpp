@@ -44,9 +44,15 @@ using namespace std;
 
 DSIFrameDecoder::DSIFrameDecoder(const string& color)
 	: PacketDecoder(color, CAT_SERIAL)
+	, m_outputMode(m_parameters["Output Mode"])
 {
 	AddProtocolStream("data");
 	CreateInput("DSI");
+
+	m_outputMode = FilterParameter(FilterParameter::TYPE_ENUM, Unit(Unit::UNIT_COUNTS));
+	m_outputMode.AddEnumValue("Pixels", OUTPUT_PIXELS);
+	m_outputMode.AddEnumValue("Frame buffer", OUTPUT_FRAMES);
+	m_outputMode.SetIntVal(OUTPUT_PIXELS);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -71,14 +77,17 @@ string DSIFrameDecoder::GetProtocolName()
 vector<string> DSIFrameDecoder::GetHeaders()
 {
 	vector<string> ret;
+	ret.push_back("Type");
 	ret.push_back("Width");
+	ret.push_back("Height");
 	ret.push_back("Checksum");
 	return ret;
 }
 
 bool DSIFrameDecoder::GetShowImageColumn()
 {
-	return true;
+	//Frame buffer mode doesn't keep a copy of each scan line in the packets
+	return m_outputMode.GetIntVal() == OUTPUT_PIXELS;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -117,6 +126,37 @@ void DSIFrameDecoder::Refresh()
 
 	VideoScanlinePacket* pack = NULL;
 
+	bool frames = (m_outputMode.GetIntVal() == OUTPUT_FRAMES);
+
+	//Frame buffer state: the scan line in progress, and the frame it goes into (null until the first VSYNC)
+	bool in_line = false;
+	int64_t line_start = 0;
+	int64_t line_end = 0;
+	size_t line_pixels = 0;
+	DVIFrame* current_frame = NULL;
+
+	//Ends the scan line in progress (frame buffer mode only)
+	auto endLine = [&]()
+	{
+		if(!in_line)
+			return;
+
+		cap->m_offsets.push_back(line_start);
+		cap->m_durations.push_back(line_end - line_start);
+		cap->m_samples.push_back(DSIFrameSymbol(DSIFrameSymbol::TYPE_SCANLINE));
+
+		if(current_frame)
+		{
+			//First line sets the frame width, pad or crop any others to match
+			if(current_frame->m_height == 0)
+				current_frame->m_width = line_pixels;
+			current_frame->m_height ++;
+			current_frame->m_pixels.resize(current_frame->m_width * current_frame->m_height * 3, 0);
+		}
+
+		in_line = false;
+	};
+
 	//Decode the actual data
 	size_t len = din->m_offsets.size();
 	int64_t tstart = 0;
@@ -148,6 +188,31 @@ void DSIFrameDecoder::Refresh()
 					switch(s.m_data)
 					{
 						case DSIPacketDecoder::TYPE_VSYNC_START:
+
+							//Start of VSYNC ends the previous frame and begins a new one
+							if(frames)
+							{
+								if(current_frame)
+								{
+									current_frame->m_len = tstart - current_frame->m_offset;
+
+									auto fpack = new Packet;
+									fpack->m_offset = current_frame->m_offset * cap->m_timescale;
+									fpack->m_len = current_frame->m_len * cap->m_timescale;
+									fpack->m_headers["Type"] = "Frame";
+									fpack->m_headers["Width"] = to_string(current_frame->m_width);
+									fpack->m_headers["Height"] = to_string(current_frame->m_height);
+									m_packets.push_back(fpack);
+								}
+
+								cap->m_frames.emplace_back();
+								current_frame = &cap->m_frames.back();
+								current_frame->m_offset = tstart;
+								current_frame->m_len = 0;
+								current_frame->m_width = 0;
+								current_frame->m_height = 0;
+							}
+
 							cap->m_offsets.push_back(tstart);
 							cap->m_durations.push_back(end - tstart);
 							cap->m_samples.push_back(DSIFrameSymbol(DSIFrameSymbol::TYPE_VSYNC));
@@ -200,10 +265,21 @@ void DSIFrameDecoder::Refresh()
 
 			//Decode video
 			case STATE_RGB888_START:
-				//Create packet
-				pack = new VideoScanlinePacket;
-				pack->m_offset = off * cap->m_timescale;
-				pack->m_headers["Checksum"] = "Not checked";
+				//Create packet, or start a scan line in the frame buffer
+				if(frames)
+				{
+					in_line = true;
+					line_start = off;
+					line_end = off;
+					line_pixels = 0;
+				}
+				else
+				{
+					pack = new VideoScanlinePacket;
+					pack->m_offset = off * cap->m_timescale;
+					pack->m_headers["Type"] = "Video";
+					pack->m_headers["Checksum"] = "Not checked";
+				}
 
 			//fall through
 			case STATE_RGB888_RED:
@@ -213,6 +289,8 @@ void DSIFrameDecoder::Refresh()
 					red = s.m_data;
 					state = STATE_RGB888_GREEN;
 				}
+				else if(!pack)
+				{}
 				else if(s.m_stype == DSISymbol::TYPE_CHECKSUM_OK)
 					pack->m_headers["Checksum"] = "OK";
 				else if(s.m_stype == DSISymbol::TYPE_CHECKSUM_BAD)
@@ -232,6 +310,22 @@ void DSIFrameDecoder::Refresh()
 				if(s.m_stype == DSISymbol::TYPE_DATA)
 				{
 					blue = s.m_data;
+					state = STATE_RGB888_RED;
+
+					//Frame buffer mode: write the pixel straight into the frame, cropping lines wider than the first
+					if(frames)
+					{
+						if( (current_frame != NULL) &&
+							( (current_frame->m_height == 0) || (line_pixels < current_frame->m_width) ) )
+						{
+							current_frame->m_pixels.push_back(red);
+							current_frame->m_pixels.push_back(green);
+							current_frame->m_pixels.push_back(blue);
+						}
+						line_pixels ++;
+						line_end = end;
+						break;
+					}
 
 					pack->m_data.push_back(red);
 					pack->m_data.push_back(green);
@@ -255,6 +349,7 @@ void DSIFrameDecoder::Refresh()
 		{
 			tstart = off;
 			state = STATE_ID;
+			endLine();
 
 			//End the current packet
 			if(pack)
@@ -278,6 +373,10 @@ void DSIFrameDecoder::Refresh()
 		pack = NULL;
 	}
 
+	//Drop the last frame, since the capture ended partway through it
+	if(current_frame)
+		cap->m_frames.pop_back();
+
 	SetData(cap, 0);
 
 	cap->MarkModifiedFromCpu();
@@ -292,6 +391,9 @@ string DSIFrameWaveform::GetColor(size_t i)
 		case DSIFrameSymbol::TYPE_VSYNC:
 			return StandardColors::colors[StandardColors::COLOR_CONTROL];
 
+		case DSIFrameSymbol::TYPE_SCANLINE:
+			return StandardColors::colors[StandardColors::COLOR_DATA];
+
 		case DSIFrameSymbol::TYPE_VIDEO:
 			{
 				char buf[10];
@@ -321,6 +423,9 @@ string DSIFrameWaveform::GetText(size_t i)
 			snprintf(tmp, sizeof(tmp), "#%02x%02x%02x", s.m_red, s.m_green, s.m_blue);
 			break;
 
+		case DSIFrameSymbol::TYPE_SCANLINE:
+			return "VIDEO";
+
 		case DSIFrameSymbol::TYPE_ERROR:
 		default:
 			return "ERROR";
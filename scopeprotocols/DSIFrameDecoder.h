@@ -46,6 +46,7 @@ public:
 		TYPE_HSYNC,
 		TYPE_VSYNC,
 		TYPE_VIDEO,
+		TYPE_SCANLINE,
 		TYPE_ERROR
 	};
 
@@ -77,6 +78,9 @@ public:
 	DSIFrameWaveform () : SparseWaveform<DSIFrameSymbol>() {};
 	virtual std::string GetText(size_t) override;
 	virtual std::string GetColor(size_t) override;
+
+	///@brief Decoded frames (frame buffer output mode only)
+	std::vector<DVIFrame> m_frames;
 };
 
 class DSIFrameDecoder : public PacketDecoder
@@ -94,9 +98,20 @@ public:
 
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
+	enum OutputMode
+	{
+		///@brief One sparse sample per pixel, and one packet per scan line with its pixels
+		OUTPUT_PIXELS,
+
+		///@brief One sparse sample per scan line, pixels packed into one DVIFrame per frame
+		OUTPUT_FRAMES
+	};
+
 	PROTOCOL_DECODER_INITPROC(DSIFrameDecoder)
 
 protected:
+	///@brief Output mode
+	FilterParameter& m_outputMode;
 };
 
 #endif
@@ -614,17 +614,9 @@ string DSIWaveform::GetText(size_t i)
 
 uint16_t DSIPacketDecoder::UpdateCRC(uint16_t crc, uint8_t data)
 {
-	//CRC16 with polynomial x^16 + x^12 + x^5 + x^0 (CRC-16-CCITT)
-	uint16_t poly = 0x8408;
-	for(int i=0; i<8; i++)
-	{
-		if( ((data >> i) ^ crc) & 1 )
-			crc = (crc >> 1) ^ poly;
-		else
-			crc >>= 1;
-	}
-
-	return crc;
+	//CRC16 with polynomial x^16 + x^12 + x^5 + x^0 (CRC-16-CCITT), LSB first
+	static const ReflectedCRCTable table(0x8408);
+	return table.Update(crc, data);
 }
 
 vector<string> DSIPacketDecoder::GetHeaders()
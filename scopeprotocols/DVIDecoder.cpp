@@ -50,11 +50,17 @@ VideoScanlinePacket::~VideoScanlinePacket()
 
 DVIDecoder::DVIDecoder(const string& color)
 	: PacketDecoder(color, CAT_SERIAL)
+	, m_outputMode(m_parameters["Output Mode"])
 {
 	//Set up channels
 	CreateInput("D0 (blue)");
 	CreateInput("D1 (green)");
 	CreateInput("D2 (red)");
+
+	m_outputMode = FilterParameter(FilterParameter::TYPE_ENUM, Unit(Unit::UNIT_COUNTS));
+	m_outputMode.AddEnumValue("Pixels", OUTPUT_PIXELS);
+	m_outputMode.AddEnumValue("Frame buffer", OUTPUT_FRAMES);
+	m_outputMode.SetIntVal(OUTPUT_PIXELS);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -81,12 +87,14 @@ vector<string> DVIDecoder::GetHeaders()
 	vector<string> ret;
 	ret.push_back("Type");
 	ret.push_back("Width");
+	ret.push_back("Height");
 	return ret;
 }
 
 bool DVIDecoder::GetShowImageColumn()
 {
-	return true;
+	//Frame buffer mode doesn't keep a copy of each scan line in the packets
+	return m_outputMode.GetIntVal() == OUTPUT_PIXELS;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -118,6 +126,8 @@ void DVIDecoder::Refresh()
 	cap->m_startFemtoseconds = dblue->m_startFemtoseconds;
 	cap->PrepareForCpuAccess();
 
+	bool frames = (m_outputMode.GetIntVal() == OUTPUT_FRAMES);
+
 	size_t iblue = 0;
 	size_t igreen = 0;
 	size_t ired = 0;
@@ -127,6 +137,12 @@ void DVIDecoder::Refresh()
 	VideoScanlinePacket* current_packet = NULL;
 	int current_pixels = 0;
 
+	//Frame buffer state: the scan line in progress, and the frame it goes into (null until the first VSYNC)
+	bool in_line = false;
+	int64_t line_start = 0;
+	DVIFrame* current_frame = NULL;
+	bool last_vsync = false;
+
 	//Decode the actual data
 	size_t bsize = dblue->m_offsets.size();
 	size_t wgsize = dgreen->m_offsets.size();
@@ -151,11 +167,57 @@ void DVIDecoder::Refresh()
 				current_packet = NULL;
 			}
 
+			//Same thing in frame buffer mode, but the pixels are already in the frame
+			if( (last_type == TMDSSymbol::TMDS_TYPE_DATA) && in_line)
+			{
+				cap->m_offsets.push_back(line_start);
+				cap->m_durations.push_back(dblue->m_offsets[iblue] - line_start);
+				cap->m_samples.push_back(DVISymbol(DVISymbol::DVI_TYPE_SCANLINE));
+
+				if(current_frame)
+				{
+					//First line sets the frame width, pad or crop any others to match
+					if(current_frame->m_height == 0)
+						current_frame->m_width = current_pixels;
+					current_frame->m_height ++;
+					current_frame->m_pixels.resize(current_frame->m_width * current_frame->m_height * 3, 0);
+				}
+
+				current_pixels = 0;
+				in_line = false;
+			}
+
 			//Extract synchronization signals from blue channel
 			//Red/green have status signals that aren't used in DVI.
 			bool hsync = (sblue.m_data & 1) ? true : false;
 			bool vsync = (sblue.m_data & 2) ? true : false;
 
+			//Start of VSYNC ends the previous frame and begins a new one
+			if(frames && vsync && !last_vsync)
+			{
+				int64_t vstart = dblue->m_offsets[iblue];
+				if(current_frame)
+				{
+					current_frame->m_len = vstart - current_frame->m_offset;
+
+					auto pack = new Packet;
+					pack->m_offset = current_frame->m_offset;
+					pack->m_len = current_frame->m_len;
+					pack->m_headers["Type"] = "Frame";
+					pack->m_headers["Width"] = to_string(current_frame->m_width);
+					pack->m_headers["Height"] = to_string(current_frame->m_height);
+					m_packets.push_back(pack);
+				}
+
+				cap->m_frames.emplace_back();
+				current_frame = &cap->m_frames.back();
+				current_frame->m_offset = vstart;
+				current_frame->m_len = 0;
+				current_frame->m_width = 0;
+				current_frame->m_height = 0;
+			}
+			last_vsync = vsync;
+
 			//If this symbol matches the previous one, just extend it
 			//rather than creating a new symbol
 			size_t last = cap->m_durations.size()-1;
@@ -232,32 +294,58 @@ void DVIDecoder::Refresh()
 					break;
 				}
 
-				//Start a new packet
-				current_packet = new VideoScanlinePacket;
-				current_packet->m_offset = dblue->m_offsets[iblue];
-				current_packet->m_headers["Type"] = "Video";
+				//Start a new packet or scan line
+				if(frames)
+				{
+					in_line = true;
+					line_start = dblue->m_offsets[iblue];
+				}
+				else
+				{
+					current_packet = new VideoScanlinePacket;
+					current_packet->m_offset = dblue->m_offsets[iblue];
+					current_packet->m_headers["Type"] = "Video";
+				}
 				current_pixels = 0;
 			}
 
 			auto sgreen = dgreen->m_samples[igreen];
 			auto sred = dred->m_samples[ired];
 
-			cap->m_offsets.push_back(dblue->m_offsets[iblue]);
-			cap->m_durations.push_back(dblue->m_durations[iblue]);
-			cap->m_samples.push_back(DVISymbol(DVISymbol::DVI_TYPE_VIDEO,
-				sred.m_data,
-				sgreen.m_data,
-				sblue.m_data));
-
-			//In-memory packet data is RGB order for compatibility with Gdk::Pixbuf
-			//may be null if waveform starts halfway through a scan line. Don't make a packet for that.
-			if(current_packet != NULL)
+			//Frame buffer mode: write the pixel straight into the frame, cropping lines wider than the first one
+			if(frames)
 			{
-				current_packet->m_data.push_back(sred.m_data);
-				current_packet->m_data.push_back(sgreen.m_data);
-				current_packet->m_data.push_back(sblue.m_data);
+				if( (current_frame != NULL) && in_line)
+				{
+					if( (current_frame->m_height == 0) || (current_pixels < (int)current_frame->m_width) )
+					{
+						current_frame->m_pixels.push_back(sred.m_data);
+						current_frame->m_pixels.push_back(sgreen.m_data);
+						current_frame->m_pixels.push_back(sblue.m_data);
+					}
+				}
 				current_pixels ++;
 			}
+
+			else
+			{
+				cap->m_offsets.push_back(dblue->m_offsets[iblue]);
+				cap->m_durations.push_back(dblue->m_durations[iblue]);
+				cap->m_samples.push_back(DVISymbol(DVISymbol::DVI_TYPE_VIDEO,
+					sred.m_data,
+					sgreen.m_data,
+					sblue.m_data));
+
+				//In-memory packet data is RGB order for compatibility with Gdk::Pixbuf
+				//may be null if waveform starts halfway through a scan line. Don't make a packet for that.
+				if(current_packet != NULL)
+				{
+					current_packet->m_data.push_back(sred.m_data);
+					current_packet->m_data.push_back(sgreen.m_data);
+					current_packet->m_data.push_back(sblue.m_data);
+					current_pixels ++;
+				}
+			}
 		}
 
 		//Save the previous type of sample
@@ -272,6 +360,10 @@ void DVIDecoder::Refresh()
 	if(current_packet)
 		delete current_packet;
 
+	//Drop the last frame, since the capture ended partway through it
+	if(current_frame)
+		cap->m_frames.pop_back();
+
 	SetData(cap, 0);
 
 	cap->MarkModifiedFromCpu();
@@ -289,6 +381,9 @@ std::string DVIWaveform::GetColor(size_t i)
 		case DVISymbol::DVI_TYPE_VSYNC:
 			return StandardColors::colors[StandardColors::COLOR_CONTROL];
 
+		case DVISymbol::DVI_TYPE_SCANLINE:
+			return StandardColors::colors[StandardColors::COLOR_DATA];
+
 		case DVISymbol::DVI_TYPE_VIDEO:
 			{
 				char buf[10];
@@ -317,6 +412,9 @@ string DVIWaveform::GetText(size_t i)
 		case DVISymbol::DVI_TYPE_VSYNC:
 			return "VSYNC";
 
+		case DVISymbol::DVI_TYPE_SCANLINE:
+			return "VIDEO";
+
 		case DVISymbol::DVI_TYPE_VIDEO:
 			snprintf(tmp, sizeof(tmp), "#%02x%02x%02x", s.m_red, s.m_green, s.m_blue);
 			break;
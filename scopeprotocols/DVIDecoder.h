@@ -47,6 +47,7 @@ public:
 		DVI_TYPE_HSYNC,
 		DVI_TYPE_VSYNC,
 		DVI_TYPE_VIDEO,
+		DVI_TYPE_SCANLINE,
 		DVI_TYPE_ERROR
 	};
 
@@ -78,12 +79,37 @@ public:
 	virtual ~VideoScanlinePacket();
 };
 
+/**
+	@brief One complete video frame, from one VSYNC to the next
+ */
+class DVIFrame
+{
+public:
+	///@brief Start of the frame (VSYNC assertion), in the waveform's timescale
+	int64_t m_offset;
+
+	///@brief Length of the frame, in the waveform's timescale
+	int64_t m_len;
+
+	///@brief Width of the frame in pixels (taken from the first scan line)
+	size_t m_width;
+
+	///@brief Height of the frame in scan lines
+	size_t m_height;
+
+	///@brief Packed RGB888 pixels, row major, in the same order as Gdk::Pixbuf
+	std::vector<uint8_t> m_pixels;
+};
+
 class DVIWaveform : public SparseWaveform<DVISymbol>
 {
 public:
 	DVIWaveform () : SparseWaveform<DVISymbol>() {};
 	virtual std::string GetText(size_t) override;
 	virtual std::string GetColor(size_t) override;
+
+	///@brief Decoded frames (frame buffer output mode only)
+	std::vector<DVIFrame> m_frames;
 };
 
 class DVIDecoder : public PacketDecoder
@@ -101,9 +127,20 @@ public:
 
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
+	enum OutputMode
+	{
+		///@brief One sparse sample per pixel, and one packet per scan line with its pixels
+		OUTPUT_PIXELS,
+
+		///@brief One sparse sample per scan line, pixels packed into one DVIFrame per frame
+		OUTPUT_FRAMES
+	};
+
 	PROTOCOL_DECODER_INITPROC(DVIDecoder)
 
 protected:
+	///@brief Output mode
+	FilterParameter& m_outputMode;
 };
 
 #endif
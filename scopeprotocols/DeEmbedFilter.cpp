@@ -40,6 +40,7 @@ DeEmbedFilter::DeEmbedFilter(const string& color)
 	, m_rectangularComputePipeline("shaders/RectangularWindow.spv", 2, sizeof(WindowFunctionArgs))
 	, m_deEmbedComputePipeline("shaders/DeEmbedFilter.spv", 3, sizeof(uint32_t))
 	, m_normalizeComputePipeline("shaders/DeEmbedNormalization.spv", 2, sizeof(DeEmbedNormalizationArgs))
+	, m_resampleComputePipeline("shaders/SParameterResample.spv", 3, sizeof(SParameterResampleArgs))
 {
 	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_ANALOG);
 	CreateInput("signal");
@@ -60,7 +61,9 @@ DeEmbedFilter::DeEmbedFilter(const string& color)
 	m_parameters[m_groupDelayTruncModeName].AddEnumValue("Manual", TRUNC_MANUAL);
 	m_parameters[m_groupDelayTruncModeName].SetIntVal(TRUNC_AUTO);
 
-	m_cachedBinSize = 0;
+	m_activeTransferFunction = &m_transferFunctions[0];
+	m_transferFunctionClock = 0;
+	m_responseRevision = 0;
 
 	m_cachedNumPoints = 0;
 	m_cachedMaxGain = 0;
@@ -77,6 +80,7 @@ DeEmbedFilter::DeEmbedFilter(const string& color)
 	m_reverseOutBuf.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
 	m_reverseOutBuf.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
 
+	m_cachedSparams.m_points.SetGpuAccessHint(AcceleratorBuffer<SParameterPoint>::HINT_LIKELY);
 }
 
 DeEmbedFilter::~DeEmbedFilter()
@@ -156,8 +160,12 @@ void DeEmbedFilter::DoRefresh(bool invert, vk::raii::CommandBuffer& cmdBuf, shar
 	}
 	const size_t npoints_raw = din->size();
 
-	//Zero pad to next power of two up
-	const size_t npoints = next_pow2(npoints_raw);
+	//Zero pad to next power of two up.
+	//If the input is only slightly shorter than last time, keep the previous (one step larger) size instead so
+	//trigger to trigger length jitter around a power of two doesn't bounce between two FFT sizes.
+	size_t npoints = next_pow2(npoints_raw);
+	if( (m_cachedNumPoints == 2*npoints) && (npoints_raw > (npoints * 7) / 8) )
+		npoints = m_cachedNumPoints;
 	//LogTrace("DeEmbedFilter: processing %zu raw points\n", npoints_raw);
 	//LogTrace("Rounded to %zu\n", npoints);
 
@@ -177,7 +185,6 @@ void DeEmbedFilter::DoRefresh(bool invert, vk::raii::CommandBuffer& cmdBuf, shar
 	}
 
 	//Set up the FFT and allocate buffers if we change point count
-	bool sizechange = false;
 	if(m_cachedNumPoints != npoints)
 	{
 		m_forwardInBuf.resize(npoints);
@@ -185,59 +192,31 @@ void DeEmbedFilter::DoRefresh(bool invert, vk::raii::CommandBuffer& cmdBuf, shar
 		m_reverseOutBuf.resize(npoints);
 
 		m_cachedNumPoints = npoints;
-		sizechange = true;
 	}
 
 	//Set up new FFT plans
 	if(!m_vkForwardPlan)
-		m_vkForwardPlan = make_unique<VulkanFFTPlan>(npoints, nouts, VulkanFFTPlan::DIRECTION_FORWARD);
+		m_vkForwardPlan = g_fftPlanCache->Acquire(npoints, nouts, VulkanFFTPlan::DIRECTION_FORWARD);
 	if(!m_vkReversePlan)
-		m_vkReversePlan = make_unique<VulkanFFTPlan>(npoints, nouts, VulkanFFTPlan::DIRECTION_REVERSE);
-
-	//Calculate size of each bin
-	double fs = din->m_timescale;
-	double sample_ghz = 1e6 / fs;
-	double bin_hz = round((0.5f * sample_ghz * 1e9f) / nouts);
+		m_vkReversePlan = g_fftPlanCache->Acquire(npoints, nouts, VulkanFFTPlan::DIRECTION_REVERSE);
 
 	//Did we change the max gain?
-	bool clipchange = false;
 	float maxgain = m_parameters[m_maxGainName].GetFloatVal();
 	if(maxgain != m_cachedMaxGain)
 	{
 		m_cachedMaxGain = maxgain;
-		clipchange = true;
 		ClearSweeps();
 	}
 
-	//Waveform object changed? Input parameters are no longer valid
-	//We need check for input count because CTLE filter generates S-params internally (and deletes the mag/angle inputs)
-	//TODO: would it be cleaner to generate filter response then channel-emulate it?
-	bool inchange = false;
-	if(GetInputCount() > 1)
-	{
-		auto dmag = GetInput(1).GetData();
-		auto dang = GetInput(2).GetData();
-		if( (m_magKey != dmag) ||
-			(m_angleKey != dang) )
-		{
-			inchange = true;
-
-			m_magKey = dmag;
-			m_angleKey = dang;
-		}
-	}
+	//Prepare to do all of our compute stuff in one dispatch call to reduce overhead
+	cmdBuf.begin({});
 
-	//Resample our parameter to our FFT bin size if needed.
-	//Cache trig function output because there's no AVX instructions for this.
-	if( (fabs(m_cachedBinSize - bin_hz) > FLT_EPSILON) || sizechange || clipchange || inchange)
-	{
-		m_resampledSparamCosines.clear();
-		m_resampledSparamSines.clear();
-		InterpolateSparameters(bin_hz, invert, nouts);
-	}
+	//Find (or compute) the channel response for this FFT configuration
+	auto& tf = GetTransferFunction(cmdBuf, invert, npoints, din->m_timescale, maxgain);
+	m_activeTransferFunction = &tf;
 
 	//Calculate maximum group delay for the first few S-parameter bins (approx propagation delay of the channel)
-	int64_t groupdelay_fs = GetGroupDelay();
+	int64_t groupdelay_fs = tf.m_groupDelay;
 	if(m_parameters[m_groupDelayTruncModeName].GetIntVal() == TRUNC_MANUAL)
 		groupdelay_fs = m_parameters[m_groupDelayTruncName].GetIntVal();
 
@@ -274,9 +253,6 @@ void DeEmbedFilter::DoRefresh(bool invert, vk::raii::CommandBuffer& cmdBuf, shar
 	m_cachedOutLen = outlen;
 	m_cachedNouts = nouts;
 
-	//Prepare to do all of our compute stuff in one dispatch call to reduce overhead
-	cmdBuf.begin({});
-
 	//Copy and zero-pad the input as needed
 	WindowFunctionArgs args;
 	args.numActualSamples = npoints_raw;
@@ -297,8 +273,8 @@ void DeEmbedFilter::DoRefresh(bool invert, vk::raii::CommandBuffer& cmdBuf, shar
 
 	//Apply the interpolated S-parameters
 	m_deEmbedComputePipeline.BindBufferNonblocking(0, m_forwardOutBuf, cmdBuf);
-	m_deEmbedComputePipeline.BindBufferNonblocking(1, m_resampledSparamSines, cmdBuf);
-	m_deEmbedComputePipeline.BindBufferNonblocking(2, m_resampledSparamCosines, cmdBuf);
+	m_deEmbedComputePipeline.BindBufferNonblocking(1, tf.m_sines, cmdBuf);
+	m_deEmbedComputePipeline.BindBufferNonblocking(2, tf.m_cosines, cmdBuf);
 	const uint32_t compute_block_count = GetComputeBlockCount(npoints, 64);
 	m_deEmbedComputePipeline.Dispatch(cmdBuf, (uint32_t)nouts,
 		min(compute_block_count, 32768u),
@@ -329,6 +305,78 @@ void DeEmbedFilter::DoRefresh(bool invert, vk::raii::CommandBuffer& cmdBuf, shar
 	cap->MarkModifiedFromGpu();
 }
 
+/**
+	@brief Returns the channel response for the given FFT configuration, computing it if it's not cached
+
+	The response depends only on the S-parameters (or, for derived classes which generate it internally,
+	m_responseRevision), the FFT length, sample rate, max gain, and direction, so the last few are kept around.
+	Any shaders needed to compute a new response are recorded into cmdBuf, which must be in the recording state.
+ */
+DeEmbedTransferFunction& DeEmbedFilter::GetTransferFunction(
+	vk::raii::CommandBuffer& cmdBuf,
+	bool invert,
+	size_t npoints,
+	int64_t timescale,
+	float maxgain)
+{
+	//We need check for input count because CTLE filter generates S-params internally (and deletes the mag/angle inputs)
+	//TODO: would it be cleaner to generate filter response then channel-emulate it?
+	WaveformCacheKey magKey;
+	WaveformCacheKey angleKey;
+	if(GetInputCount() > 1)
+	{
+		magKey = GetInput(1).GetData();
+		angleKey = GetInput(2).GetData();
+	}
+
+	m_transferFunctionClock ++;
+
+	//Look for a match, and note the least recently used entry while we're at it
+	DeEmbedTransferFunction* victim = &m_transferFunctions[0];
+	for(auto& tf : m_transferFunctions)
+	{
+		if(tf.m_valid &&
+			(tf.m_magKey == magKey) &&
+			(tf.m_angleKey == angleKey) &&
+			(tf.m_responseRevision == m_responseRevision) &&
+			(tf.m_npoints == npoints) &&
+			(tf.m_timescale == timescale) &&
+			(tf.m_maxGain == maxgain) &&
+			(tf.m_invert == invert) )
+		{
+			tf.m_lastUsed = m_transferFunctionClock;
+			return tf;
+		}
+
+		if(!tf.m_valid)
+			victim = &tf;
+		else if(victim->m_valid && (tf.m_lastUsed < victim->m_lastUsed) )
+			victim = &tf;
+	}
+
+	//Calculate size of each bin
+	size_t nouts = npoints/2 + 1;
+	double fs = timescale;
+	double sample_ghz = 1e6 / fs;
+	double bin_hz = round((0.5f * sample_ghz * 1e9f) / nouts);
+
+	//Not found, replace the victim
+	auto& tf = *victim;
+	tf.m_valid = true;
+	tf.m_magKey = magKey;
+	tf.m_angleKey = angleKey;
+	tf.m_responseRevision = m_responseRevision;
+	tf.m_npoints = npoints;
+	tf.m_timescale = timescale;
+	tf.m_maxGain = maxgain;
+	tf.m_invert = invert;
+	tf.m_lastUsed = m_transferFunctionClock;
+	InterpolateSparameters(cmdBuf, bin_hz, invert, nouts, tf.m_sines, tf.m_cosines);
+	tf.m_groupDelay = GetGroupDelay();
+
+	return tf;
+}
+
 /**
 	@brief Returns the max mid-band group delay of the channel
  */
@@ -350,26 +398,30 @@ int64_t DeEmbedFilter::GetGroupDelay()
 /**
 	@brief Recalculate the cached S-parameters (and clamp gain if requested)
 
-	Since there's no AVX sin/cos instructions, precompute sin(phase) and cos(phase)
+	The mag/angle inputs are converted on the CPU (since GetGroupDelay() needs them there anyway) then resampled to
+	the FFT bin grid, and converted to sin/cos form, by a shader recorded into cmdBuf.
+
+	@param cmdBuf	Command buffer to record into
+	@param bin_hz	Width of one FFT bin
+	@param invert	True to de-embed, false to emulate the channel
+	@param nouts	Number of FFT bins
+	@param sines	Output buffer for the imaginary part of the response
+	@param cosines	Output buffer for the real part of the response
  */
-void DeEmbedFilter::InterpolateSparameters(float bin_hz, bool invert, size_t nouts)
+void DeEmbedFilter::InterpolateSparameters(
+	vk::raii::CommandBuffer& cmdBuf,
+	float bin_hz,
+	bool invert,
+	size_t nouts,
+	AcceleratorBuffer<float>& sines,
+	AcceleratorBuffer<float>& cosines)
 {
-	m_cachedBinSize = bin_hz;
-
-	float maxGain = pow(10, m_parameters[m_maxGainName].GetFloatVal()/20);
-
 	//Extract the S-parameters
 	auto wmag = GetInputWaveform(1);
 	auto wang = GetInputWaveform(2);
 	wmag->PrepareForCpuAccess();
 	wang->PrepareForCpuAccess();
 
-	m_resampledSparamSines.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
-	m_resampledSparamSines.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
-
-	m_resampledSparamCosines.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
-	m_resampledSparamCosines.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
-
 	auto smag = dynamic_cast<SparseAnalogWaveform*>(wmag);
 	auto sang = dynamic_cast<SparseAnalogWaveform*>(wang);
 	auto umag = dynamic_cast<UniformAnalogWaveform*>(wmag);
@@ -380,44 +432,25 @@ void DeEmbedFilter::InterpolateSparameters(float bin_hz, bool invert, size_t nou
 	else
 		m_cachedSparams.ConvertFromWaveforms(umag, uang);
 
-	m_resampledSparamSines.resize(nouts);
-	m_resampledSparamCosines.resize(nouts);
-
-	//De-embedding
-	if(invert)
-	{
-		for(size_t i=0; i<nouts; i++)
-		{
-			float freq = bin_hz * i;
-			auto pt = m_cachedSparams.InterpolatePoint(freq);
-			float mag = pt.m_amplitude;
-			float ang = pt.m_phase;
-
-			float amp = 0;
-			if(fabs(mag) > FLT_EPSILON)
-				amp = 1.0f / mag;
-			amp = min(amp, maxGain);
-
-			m_resampledSparamSines[i] = sin(-ang) * amp;
-			m_resampledSparamCosines[i] = cos(-ang) * amp;
-		}
-	}
-
-	//Channel emulation
-	else
-	{
-		for(size_t i=0; i<nouts; i++)
-		{
-			float freq = bin_hz * i;
-			auto pt = m_cachedSparams.InterpolatePoint(freq);
-			float mag = pt.m_amplitude;
-			float ang = pt.m_phase;
-
-			m_resampledSparamSines[i] = sin(ang) * mag;
-			m_resampledSparamCosines[i] = cos(ang) * mag;
-		}
-	}
+	sines.resize(nouts);
+	cosines.resize(nouts);
+
+	SParameterResampleArgs args;
+	args.npoints = m_cachedSparams.size();
+	args.nouts = nouts;
+	args.binHz = bin_hz;
+	args.maxGain = pow(10, m_parameters[m_maxGainName].GetFloatVal()/20);
+	args.invert = invert;
+
+	m_resampleComputePipeline.BindBufferNonblocking(0, m_cachedSparams.m_points, cmdBuf);
+	m_resampleComputePipeline.BindBufferNonblocking(1, sines, cmdBuf, true);
+	m_resampleComputePipeline.BindBufferNonblocking(2, cosines, cmdBuf, true);
+	const uint32_t compute_block_count = GetComputeBlockCount(nouts, 64);
+	m_resampleComputePipeline.Dispatch(cmdBuf, args,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
+	m_resampleComputePipeline.AddComputeMemoryBarrier(cmdBuf);
 
-	m_resampledSparamSines.MarkModifiedFromCpu();
-	m_resampledSparamCosines.MarkModifiedFromCpu();
+	sines.MarkModifiedFromGpu();
+	cosines.MarkModifiedFromGpu();
 }
@@ -37,6 +37,78 @@
 
 #include "FFTFilter.h"
 
+/**
+	@brief Push constants for SParameterResample.glsl
+ */
+struct SParameterResampleArgs
+{
+	uint32_t npoints;
+	uint32_t nouts;
+	float binHz;
+	float maxGain;
+	uint32_t invert;
+};
+
+/**
+	@brief A channel response resampled to one particular FFT configuration, as used by DeEmbedFilter
+ */
+class DeEmbedTransferFunction
+{
+public:
+	DeEmbedTransferFunction()
+	: m_valid(false)
+	, m_responseRevision(0)
+	, m_npoints(0)
+	, m_timescale(0)
+	, m_maxGain(0)
+	, m_invert(false)
+	, m_groupDelay(0)
+	, m_lastUsed(0)
+	{
+		m_sines.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+		m_sines.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+
+		m_cosines.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+		m_cosines.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	}
+
+	///@brief True if this entry holds a response
+	bool m_valid;
+
+	///@brief Magnitude input the response was computed from (null if generated internally)
+	WaveformCacheKey m_magKey;
+
+	///@brief Angle input the response was computed from (null if generated internally)
+	WaveformCacheKey m_angleKey;
+
+	///@brief Value of DeEmbedFilter::m_responseRevision the response was computed for
+	uint64_t m_responseRevision;
+
+	///@brief FFT length
+	size_t m_npoints;
+
+	///@brief Sample period of the input, in fs
+	int64_t m_timescale;
+
+	///@brief Max gain setting, in dB
+	float m_maxGain;
+
+	///@brief True for de-embedding, false for channel emulation
+	bool m_invert;
+
+	///@brief Group delay of the channel, in fs
+	int64_t m_groupDelay;
+
+	///@brief Value of DeEmbedFilter::m_transferFunctionClock when this entry was last used
+	uint64_t m_lastUsed;
+
+	///@brief Imaginary part of the response for each FFT bin
+	AcceleratorBuffer<float> m_sines;
+
+	///@brief Real part of the response for each FFT bin
+	AcceleratorBuffer<float> m_cosines;
+};
+
 class DeEmbedFilter : public Filter
 {
 public:
@@ -67,10 +139,10 @@ public:
 	{ return m_forwardInBuf; }
 
 	AcceleratorBuffer<float>& test_GetResampledSines()
-	{ return m_resampledSparamSines; }
+	{ return m_activeTransferFunction->m_sines; }
 
 	AcceleratorBuffer<float>& test_GetResampledCosines()
-	{ return m_resampledSparamCosines; }
+	{ return m_activeTransferFunction->m_cosines; }
 
 	size_t test_GetIstart()
 	{ return m_cachedIstart; }
@@ -78,7 +150,19 @@ public:
 protected:
 	virtual int64_t GetGroupDelay();
 	void DoRefresh(bool invert, vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue);
-	virtual void InterpolateSparameters(float bin_hz, bool invert, size_t nouts);
+	DeEmbedTransferFunction& GetTransferFunction(
+		vk::raii::CommandBuffer& cmdBuf,
+		bool invert,
+		size_t npoints,
+		int64_t timescale,
+		float maxgain);
+	virtual void InterpolateSparameters(
+		vk::raii::CommandBuffer& cmdBuf,
+		float bin_hz,
+		bool invert,
+		size_t nouts,
+		AcceleratorBuffer<float>& sines,
+		AcceleratorBuffer<float>& cosines);
 
 	std::string m_maxGainName;
 	std::string m_groupDelayTruncModeName;
@@ -92,9 +176,30 @@ protected:
 
 	float m_cachedMaxGain;
 
-	double m_cachedBinSize;
-	AcceleratorBuffer<float> m_resampledSparamSines;
-	AcceleratorBuffer<float> m_resampledSparamCosines;
+	/**
+		@brief Number of transfer functions to keep around
+
+		Enough for a few FFT sizes, so inputs whose length wanders across a power of two don't recompute the response
+		every time.
+	 */
+	static const size_t TRANSFER_FUNCTION_CACHE_SIZE = 4;
+
+	///@brief Recently used channel responses
+	DeEmbedTransferFunction m_transferFunctions[TRANSFER_FUNCTION_CACHE_SIZE];
+
+	///@brief The response used by the most recent refresh
+	DeEmbedTransferFunction* m_activeTransferFunction;
+
+	///@brief Counter used to find the least recently used transfer function
+	uint64_t m_transferFunctionClock;
+
+	/**
+		@brief Revision of any internally generated response
+
+		Derived classes which compute the response from their own parameters (rather than from mag/angle inputs)
+		must increment this whenever those parameters change.
+	 */
+	uint64_t m_responseRevision;
 
 	size_t m_cachedNumPoints;
 	size_t m_cachedOutLen;
@@ -105,16 +210,14 @@ protected:
 	AcceleratorBuffer<float> m_forwardOutBuf;
 	AcceleratorBuffer<float> m_reverseOutBuf;
 
-	WaveformCacheKey m_magKey;
-	WaveformCacheKey m_angleKey;
-
 	SParameterVector m_cachedSparams;
 
 	ComputePipeline m_rectangularComputePipeline;
 	ComputePipeline m_deEmbedComputePipeline;
 	ComputePipeline m_normalizeComputePipeline;
-	std::unique_ptr<VulkanFFTPlan> m_vkForwardPlan;
-	std::unique_ptr<VulkanFFTPlan> m_vkReversePlan;
+	ComputePipeline m_resampleComputePipeline;
+	VulkanFFTPlanHandle m_vkForwardPlan;
+	VulkanFFTPlanHandle m_vkReversePlan;
 };
 
 #endif
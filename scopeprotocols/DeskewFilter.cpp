@@ -37,13 +37,27 @@ using namespace std;
 
 DeskewFilter::DeskewFilter(const string& color)
 	: Filter(color, CAT_MATH)
+	, m_skewname("Skew")
+	, m_modename("Mode")
+	, m_maxSkewName("Max skew")
+	, m_measuredSkew(0)
 {
 	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_ANALOG);
 	CreateInput("din");
+	CreateInput("ref");
 
-	m_skewname = "Skew";
 	m_parameters[m_skewname] = FilterParameter(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_FS));
 	m_parameters[m_skewname].SetFloatVal(0);
+
+	m_parameters[m_modename] = FilterParameter(FilterParameter::TYPE_ENUM, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_modename].AddEnumValue("Manual", MODE_MANUAL);
+	m_parameters[m_modename].AddEnumValue("Auto", MODE_AUTO);
+	m_parameters[m_modename].SetIntVal(MODE_MANUAL);
+
+	m_parameters[m_maxSkewName] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_FS));
+	m_parameters[m_maxSkewName].SetIntVal(10000000);
+
+	m_correlation.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -54,7 +68,7 @@ bool DeskewFilter::ValidateChannel(size_t i, StreamDescriptor stream)
 	if(stream.m_channel == NULL)
 		return false;
 
-	if( (i == 0) && (stream.GetType() == Stream::STREAM_TYPE_ANALOG) )
+	if( (i < 2) && (stream.GetType() == Stream::STREAM_TYPE_ANALOG) )
 		return true;
 
 	return false;
@@ -71,11 +85,19 @@ string DeskewFilter::GetProtocolName()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
-void DeskewFilter::Refresh()
+void DeskewFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
-	if(!VerifyAllInputsOK())
+	ClearErrors();
+
+	//The reference is only needed in auto mode
+	if(!VerifyInputOK(0))
 	{
-		SetData(NULL, 0);
+		if(!GetInput(0))
+			AddErrorMessage("Missing inputs", "No signal input connected");
+		else if(!GetInputWaveform(0))
+			AddErrorMessage("Missing inputs", "No waveform available at input");
+
+		SetData(nullptr, 0);
 		return;
 	}
 
@@ -87,6 +109,18 @@ void DeskewFilter::Refresh()
 	auto sdin = dynamic_cast<SparseAnalogWaveform*>(din);
 	auto udin = dynamic_cast<UniformAnalogWaveform*>(din);
 
+	//In auto mode, the manual skew is a trim on top of the measured value
+	if(m_parameters[m_modename].GetIntVal() == MODE_AUTO)
+	{
+		auto uref = dynamic_cast<UniformAnalogWaveform*>(GetInputWaveform(1));
+		if(!MeasureSkew(cmdBuf, queue, udin, uref))
+		{
+			SetData(nullptr, 0);
+			return;
+		}
+		offset += m_measuredSkew;
+	}
+
 	//Copy the data
 	if(sdin)
 	{
@@ -102,3 +136,62 @@ void DeskewFilter::Refresh()
 		cap->m_triggerPhase += offset;
 	}
 }
+
+/**
+	@brief Finds the skew which best lines the input up with the reference, by cross-correlation
+
+	Lags up to the "Max skew" setting either way are searched by a single FFT correlation, and the peak is refined to
+	a fraction of a sample. The reference spectrum is cached, so a reference which doesn't change from one trigger to
+	the next (e.g. a saved waveform) is only transformed once.
+
+	@return True on success, false (with an error message set) if the inputs can't be correlated
+ */
+bool DeskewFilter::MeasureSkew(
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue,
+	UniformAnalogWaveform* din,
+	UniformAnalogWaveform* ref)
+{
+	if(!din)
+	{
+		AddErrorMessage("Invalid input", "Automatic deskew requires a uniformly sampled input");
+		return false;
+	}
+	if(!VerifyInputOK(1) || !ref)
+	{
+		AddErrorMessage("Missing inputs", "Automatic deskew requires a uniformly sampled reference input");
+		return false;
+	}
+	if(din->m_timescale != ref->m_timescale)
+	{
+		AddErrorMessage("Sample rate mismatch", "Input and reference must have the same sample rate");
+		return false;
+	}
+
+	//Search window, in samples. Keep at least half of each waveform overlapping at every lag.
+	size_t len = min(din->size(), ref->size());
+	int64_t maxskew = m_parameters[m_maxSkewName].GetIntVal();
+	size_t maxlag = min(static_cast<size_t>(max(maxskew, (int64_t)0) / din->m_timescale), len / 2);
+	if(maxlag == 0)
+	{
+		AddErrorMessage("Waveform too small", "Search window must be at least one sample");
+		return false;
+	}
+
+	m_correlator.Correlate(
+		cmdBuf,
+		queue,
+		ref->m_samples,
+		len,
+		WaveformCacheKey(ref),
+		din->m_samples,
+		len,
+		-static_cast<int64_t>(maxlag),
+		2*maxlag + 1,
+		m_correlation);
+	float lag = CrossCorrelator::FindPeak(m_correlation) - maxlag;
+
+	//Input sample (i + lag) lines up with reference sample i, so shift the input back by that much
+	m_measuredSkew = (ref->m_triggerPhase - din->m_triggerPhase) - lag * din->m_timescale;
+	return true;
+}
@@ -35,21 +35,49 @@
 #ifndef DeskewFilter_h
 #define DeskewFilter_h
 
+#include "CrossCorrelator.h"
+
 class DeskewFilter : public Filter
 {
 public:
 	DeskewFilter(const std::string& color);
 
-	virtual void Refresh() override;
+	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
 
 	static std::string GetProtocolName();
 
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
+	///@brief Returns the skew found by the last automatic measurement
+	float GetMeasuredSkew() const
+	{ return m_measuredSkew; }
+
 	PROTOCOL_DECODER_INITPROC(DeskewFilter)
 
+	enum SkewMode
+	{
+		MODE_MANUAL,
+		MODE_AUTO
+	};
+
 protected:
+	bool MeasureSkew(
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue,
+		UniformAnalogWaveform* din,
+		UniformAnalogWaveform* ref);
+
 	std::string m_skewname;
+	std::string m_modename;
+	std::string m_maxSkewName;
+
+	///@brief Skew found by the last automatic measurement, in fs
+	float m_measuredSkew;
+
+	CrossCorrelator m_correlator;
+
+	///@brief Correlation of the input against the reference, over the search window
+	AcceleratorBuffer<float> m_correlation;
 };
 
 #endif
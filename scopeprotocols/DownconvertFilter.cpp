@@ -41,6 +41,7 @@ using namespace std;
 
 DownconvertFilter::DownconvertFilter(const string& color)
 	: Filter(color, CAT_RF)
+	, m_computePipeline("shaders/DownconvertFilter.spv", 3, sizeof(DownconvertFilterArgs))
 {
 	//Set up channels
 	CreateInput("RF");
@@ -53,6 +54,10 @@ DownconvertFilter::DownconvertFilter(const string& color)
 	m_freqname = "LO Frequency";
 	m_parameters[m_freqname] = FilterParameter(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_HZ));
 	m_parameters[m_freqname].SetFloatVal(1e9);
+
+	m_decimationname = "Decimation";
+	m_parameters[m_decimationname] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_decimationname].SetIntVal(1);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -79,10 +84,16 @@ string DownconvertFilter::GetProtocolName()
 	return "Downconvert";
 }
 
+Filter::DataLocation DownconvertFilter::GetInputLocation()
+{
+	//We explicitly manage our input memory and don't care where it is when Refresh() is called
+	return LOC_DONTCARE;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
-void DownconvertFilter::Refresh()
+void DownconvertFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
 	//Get the input data
 	auto din = dynamic_cast<UniformAnalogWaveform*>(GetInputWaveform(0));
@@ -92,7 +103,6 @@ void DownconvertFilter::Refresh()
 		SetData(NULL, 1);
 		return;
 	}
-	din->PrepareForCpuAccess();
 
 	//Get LO frequency
 	//(input channel overrides parameter)
@@ -104,28 +114,128 @@ void DownconvertFilter::Refresh()
 	//Calculate phase velocity
 	double sample_freq = FS_PER_SECOND / din->m_timescale;
 	double lo_cycles_per_sample = lo_freq / sample_freq;
-	double lo_rad_per_sample = lo_cycles_per_sample * 2 * M_PI;
-	double lo_rad_per_fs = lo_rad_per_sample / din->m_timescale;
-	double trigger_phase_rad = din->m_triggerPhase * lo_rad_per_fs;
+	double trigger_phase_cycles = din->m_triggerPhase * lo_freq / FS_PER_SECOND;
 
-	//Do the actual mixing
 	auto cap_i = SetupEmptyUniformAnalogOutputWaveform(din, 0);
 	auto cap_q = SetupEmptyUniformAnalogOutputWaveform(din, 1);
-	cap_i->PrepareForCpuAccess();
-	cap_q->PrepareForCpuAccess();
 	size_t len = din->size();
-	cap_i->Resize(len);
-	cap_q->Resize(len);
 
-	#ifdef __x86_64__
-	if(g_hasAvx2)
-		DoFilterKernelAVX2DensePacked(din, cap_i, cap_q, lo_rad_per_sample, trigger_phase_rad);
-	else
-	#endif
-		DoFilterKernelGeneric(din, cap_i, cap_q, lo_rad_per_sample, trigger_phase_rad);
+	//Pick CPU or GPU once for the whole refresh, so the mixed signal isn't shuffled between them
+	bool useGpu = IsGpuPreferred();
+
+	//No decimation? Mix straight into the outputs
+	int64_t decimation = m_parameters[m_decimationname].GetIntVal();
+	if(decimation <= 1)
+	{
+		cap_i->Resize(len);
+		cap_q->Resize(len);
+		Mix(cmdBuf, queue, din, cap_i, cap_q, lo_cycles_per_sample, trigger_phase_cycles, useGpu);
+		return;
+	}
+
+	//Mix at the full rate, then lowpass and decimate (filter only recomputed if the ratio changed)
+	m_resampler.SetWindowedSinc(1, decimation, 5);
+	size_t margin = m_resampler.GetTapCount() - 1;
+	if(len <= margin)
+	{
+		SetData(NULL, 0);
+		SetData(NULL, 1);
+		return;
+	}
+	m_mixedI.Resize(len);
+	m_mixedQ.Resize(len);
+	Mix(cmdBuf, queue, din, &m_mixedI, &m_mixedQ, lo_cycles_per_sample, trigger_phase_cycles, useGpu);
+
+	//Each output sample is centered half a kernel after its first input sample
+	size_t outlen = (len - margin) / decimation;
+	for(auto cap : {cap_i, cap_q})
+	{
+		cap->m_timescale = din->m_timescale * decimation;
+		cap->m_triggerPhase = din->m_triggerPhase + margin * din->m_timescale / 2;
+		cap->Resize(outlen);
+	}
+	m_resampler.Run(cmdBuf, queue, &m_mixedI, cap_i, useGpu);
+	m_resampler.Run(cmdBuf, queue, &m_mixedQ, cap_q, useGpu);
+}
+
+/**
+	@brief Mixes the input with the LO, on the GPU if requested
+
+	@param cmdBuf					Command buffer to use
+	@param queue					Queue to submit to
+	@param din						Input waveform
+	@param cap_i					In-phase output (already sized to match the input)
+	@param cap_q					Quadrature output (already sized to match the input)
+	@param lo_cycles_per_sample		LO frequency, in cycles per input sample
+	@param trigger_phase_cycles		LO phase at the first sample, in cycles
+	@param useGpu					True to run on the GPU, false for the CPU
+ */
+void DownconvertFilter::Mix(
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue,
+	UniformAnalogWaveform* din,
+	UniformAnalogWaveform* cap_i,
+	UniformAnalogWaveform* cap_q,
+	double lo_cycles_per_sample,
+	double trigger_phase_cycles,
+	bool useGpu)
+{
+	size_t len = din->size();
+	if(len == 0)
+		return;
+
+	if(!useGpu)
+	{
+		din->PrepareForCpuAccess();
+		cap_i->PrepareForCpuAccess();
+		cap_q->PrepareForCpuAccess();
+
+		float lo_rad_per_sample = lo_cycles_per_sample * 2 * M_PI;
+		float trigger_phase_rad = trigger_phase_cycles * 2 * M_PI;
+
+		#ifdef __x86_64__
+		if(g_hasAvx2)
+			DoFilterKernelAVX2DensePacked(din, cap_i, cap_q, lo_rad_per_sample, trigger_phase_rad);
+		else
+		#endif
+			DoFilterKernelGeneric(din, cap_i, cap_q, lo_rad_per_sample, trigger_phase_rad);
+
+		cap_i->MarkModifiedFromCpu();
+		cap_q->MarkModifiedFromCpu();
+		return;
+	}
+
+	//Only the fractional part of each phase matters, as a 0.64 fixed point number of cycles.
+	//Convert in two halves since a double can't hold all 64 bits.
+	auto toFixed = [](double cycles, uint32_t& hi, uint32_t& lo)
+	{
+		double frac = cycles - floor(cycles);
+		double fhi = floor(ldexp(frac, 32));
+		hi = static_cast<uint32_t>(static_cast<uint64_t>(fhi) & 0xffffffff);
+		lo = static_cast<uint32_t>(ldexp(ldexp(frac, 32) - fhi, 32));
+	};
+
+	DownconvertFilterArgs args;
+	args.len = len;
+	toFixed(trigger_phase_cycles, args.phaseHi, args.phaseLo);
+	toFixed(lo_cycles_per_sample, args.stepHi, args.stepLo);
+
+	cmdBuf.begin({});
+
+	m_computePipeline.BindBufferNonblocking(0, din->m_samples, cmdBuf);
+	m_computePipeline.BindBufferNonblocking(1, cap_i->m_samples, cmdBuf, true);
+	m_computePipeline.BindBufferNonblocking(2, cap_q->m_samples, cmdBuf, true);
+
+	const uint32_t compute_block_count = GetComputeBlockCount(len, 64);
+	m_computePipeline.Dispatch(cmdBuf, args,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
+
+	cmdBuf.end();
+	queue->SubmitAndBlock(cmdBuf);
 
-	cap_i->MarkModifiedFromCpu();
-	cap_q->MarkModifiedFromCpu();
+	cap_i->MarkModifiedFromGpu();
+	cap_q->MarkModifiedFromGpu();
 }
 
 void DownconvertFilter::DoFilterKernelGeneric(
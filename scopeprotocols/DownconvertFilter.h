@@ -35,15 +35,42 @@
 #ifndef DownconvertFilter_h
 #define DownconvertFilter_h
 
+#include "PolyphaseResampler.h"
+
+/**
+	@brief Push constants for DownconvertFilter.glsl
+ */
+struct DownconvertFilterArgs
+{
+	uint32_t len;
+
+	///@brief 64-bit LO phase at the first sample (fraction of a cycle), low half
+	uint32_t phaseLo;
+
+	///@brief 64-bit LO phase at the first sample, high half
+	uint32_t phaseHi;
+
+	///@brief 64-bit LO phase increment per sample, low half
+	uint32_t stepLo;
+
+	///@brief 64-bit LO phase increment per sample, high half
+	uint32_t stepHi;
+};
+
 /**
 	@brief Downconvert - generates a local oscillator in two phases and mixes it with a signal
+
+	On the GPU, the LO is a 64-bit phase accumulator evaluated directly at each sample index, so there is no
+	accumulated phase error no matter how long the record is. The mixer outputs can optionally be lowpass filtered
+	and decimated, so the whole front end of a DDC runs without the samples leaving the GPU.
  */
 class DownconvertFilter : public Filter
 {
 public:
 	DownconvertFilter(const std::string& color);
 
-	virtual void Refresh() override;
+	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
+	virtual DataLocation GetInputLocation() override;
 
 	static std::string GetProtocolName();
 
@@ -53,6 +80,17 @@ public:
 
 protected:
 	std::string m_freqname;
+	std::string m_decimationname;
+
+	void Mix(
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue,
+		UniformAnalogWaveform* din,
+		UniformAnalogWaveform* cap_i,
+		UniformAnalogWaveform* cap_q,
+		double lo_cycles_per_sample,
+		double trigger_phase_cycles,
+		bool useGpu);
 
 	void DoFilterKernelGeneric(
 		UniformAnalogWaveform* din,
@@ -69,6 +107,15 @@ protected:
 		float lo_rad_per_sample,
 		float trigger_phase_rad);
 #endif
+
+	ComputePipeline m_computePipeline;
+
+	///@brief Lowpass filter and decimator for the mixer outputs
+	PolyphaseResampler m_resampler;
+
+	///@brief Full rate mixer outputs, when decimating
+	UniformAnalogWaveform m_mixedI;
+	UniformAnalogWaveform m_mixedQ;
 };
 
 #endif
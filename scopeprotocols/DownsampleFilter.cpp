@@ -37,6 +37,8 @@ using namespace std;
 
 DownsampleFilter::DownsampleFilter(const string& color)
 	: Filter(color, CAT_MATH)
+	, m_cachedFactor(0)
+	, m_cachedAntialias(false)
 {
 	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_ANALOG);
 	CreateInput("RF");
@@ -72,10 +74,16 @@ string DownsampleFilter::GetProtocolName()
 	return "Downsample";
 }
 
+Filter::DataLocation DownsampleFilter::GetInputLocation()
+{
+	//We explicitly manage our input memory and don't care where it is when Refresh() is called
+	return LOC_DONTCARE;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
-void DownsampleFilter::Refresh()
+void DownsampleFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
 	if(!VerifyAllInputsOKAndUniformAnalog())
 	{
@@ -85,78 +93,66 @@ void DownsampleFilter::Refresh()
 
 	//Get the input data
 	auto din = dynamic_cast<UniformAnalogWaveform*>(GetInputWaveform(0));
-	size_t len = din->m_samples.size();
+	size_t len = din->size();
 
 	//Propagate units
 	m_streams[0].m_yAxisUnit = GetInput(0).GetYAxisUnits();
 
 	//Set up output waveform and get configuration
 	int64_t factor = m_parameters[m_factorname].GetIntVal();
-	if (factor == 0)
+	if (factor <= 0)
 	{
 		// Occurs momentarily while editing the value sometimes in glscopeclient
 		return;
 	}
 
-	size_t outlen = len / factor;
-	auto cap = SetupEmptyUniformAnalogOutputWaveform(din, 0);
-	cap->Resize(outlen);
-
-	cap->PrepareForCpuAccess();
-	din->PrepareForCpuAccess();
-
-	//Default path with antialiasing filter
-	if(m_parameters[m_aaname].GetBoolVal())
+	//Rebuild the kernel only if the configuration changed
+	bool antialias = m_parameters[m_aaname].GetBoolVal();
+	if( (factor != m_cachedFactor) || (antialias != m_cachedAntialias) )
 	{
-		//Cut off all frequencies shorter than our decimation factor
-		float cutoff_period = factor;
-		float sigma = cutoff_period / sqrt(2 * log(2));
-		int kernel_radius = ceil(3*sigma);
-
-		//Generate the actual Gaussian kernel
-		int kernel_size = kernel_radius*2 + 1;
-		vector<float> kernel;
-		kernel.resize(kernel_size);
-		float alpha = 1.0f / (sigma * sqrt(2*M_PI));
-		for(int x=0; x < kernel_size; x++)
-		{
-			int delta = (x - kernel_radius);
-			kernel[x] = alpha * exp(-delta*delta/(2*sigma));
-		}
-		float sum = 0;
-		for(auto k : kernel)
-			sum += k;
-		for(int i=0; i<kernel_size; i++)
-			kernel[i] /= sum;
-
-		//Do the actual downsampling.
-		for(size_t i=0; i<outlen; i++)
+		//Default path with antialiasing filter
+		if(antialias)
 		{
-			//Do the convolution
-			float conv = 0;
-			ssize_t base = i*factor;
-			for(ssize_t delta = -kernel_radius; delta <= kernel_radius; delta ++)
+			//Cut off all frequencies shorter than our decimation factor
+			float cutoff_period = factor;
+			float sigma = cutoff_period / sqrt(2 * log(2));
+			int kernel_radius = ceil(3*sigma);
+
+			//Generate the actual Gaussian kernel
+			int kernel_size = kernel_radius*2 + 1;
+			vector<float> kernel;
+			kernel.resize(kernel_size);
+			float alpha = 1.0f / (sigma * sqrt(2*M_PI));
+			for(int x=0; x < kernel_size; x++)
 			{
-				ssize_t pos = base + delta;
-				if( (pos < 0) || (pos >= (ssize_t)len) )
-					continue;
-
-				conv += din->m_samples[pos] * kernel[delta + kernel_radius];
+				int delta = (x - kernel_radius);
+				kernel[x] = alpha * exp(-delta*delta/(2*sigma));
 			}
-
-			//Do the actual decimation
-			cap->m_samples[i] 	= conv;
+			float sum = 0;
+			for(auto k : kernel)
+				sum += k;
+			for(int i=0; i<kernel_size; i++)
+				kernel[i] /= sum;
+
+			//Centered on each decimated sample
+			m_resampler.SetKernel(1, factor, kernel, -kernel_radius);
 		}
-	}
 
-	//Optimized path with no AA if the input is known to not contain any higher frequency content
-	else
-	{
-		for(size_t i=0; i<outlen; i++)
-			cap->m_samples[i]	= din->m_samples[i*factor];
+		//Optimized path with no AA if the input is known to not contain any higher frequency content
+		else
+			m_resampler.SetKernel(1, factor, vector<float>{1.0f}, 0);
+
+		m_cachedFactor = factor;
+		m_cachedAntialias = antialias;
 	}
 
+	size_t outlen = len / factor;
+	auto cap = SetupEmptyUniformAnalogOutputWaveform(din, 0);
+	cap->Resize(outlen);
+
+	//Do the convolution and decimation
+	m_resampler.Run(cmdBuf, queue, din, cap, IsGpuPreferred());
+
 	//Copy our time scales from the input
 	cap->m_timescale = din->m_timescale * factor;
-	cap->MarkModifiedFromCpu();
 }
@@ -35,6 +35,8 @@
 #ifndef DownsampleFilter_h
 #define DownsampleFilter_h
 
+#include "PolyphaseResampler.h"
+
 /**
 	@brief Downsample - low-pass filter and decimate a signal
  */
@@ -43,7 +45,8 @@ class DownsampleFilter : public Filter
 public:
 	DownsampleFilter(const std::string& color);
 
-	virtual void Refresh() override;
+	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
+	virtual DataLocation GetInputLocation() override;
 
 	static std::string GetProtocolName();
 
@@ -54,6 +57,14 @@ public:
 protected:
 	std::string m_factorname;
 	std::string m_aaname;
+
+	///@brief Decimation factor m_resampler was last set up for (zero if never)
+	int64_t m_cachedFactor;
+
+	///@brief Antialiasing setting m_resampler was last set up for
+	bool m_cachedAntialias;
+
+	PolyphaseResampler m_resampler;
 };
 
 #endif
@@ -1448,19 +1448,8 @@ void ESPIDecoder::Refresh()
 uint8_t ESPIDecoder::UpdateCRC8(uint8_t crc, uint8_t data)
 {
 	//CRC runs MSB first using polynomial x^8 + x^2 + x + 1
-	for(int i=7; i>=0; i--)
-	{
-		//Shift CRC left and save the high bit
-		uint8_t hi = crc >> 7;
-		crc = (crc << 1);
-
-		//Mix in the new data bit
-		hi ^= ( (data >> i) & 1);
-		if(hi)
-			crc ^= 0x7;
-	}
-
-	return crc;
+	static const ForwardCRCTable table(8, 0x07);
+	return table.Update(crc, data);
 }
 
 std::string ESPIWaveform::GetColor(size_t i)
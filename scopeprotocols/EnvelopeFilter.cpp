@@ -37,6 +37,7 @@ using namespace std;
 
 EnvelopeFilter::EnvelopeFilter(const string& color)
 	: Filter(color, CAT_MATH)
+	, m_accumulator(WaveformAccumulator::ACCUM_ENVELOPE)
 {
 	AddStream(Unit(Unit::UNIT_VOLTS), "min", Stream::STREAM_TYPE_ANALOG);
 	AddStream(Unit(Unit::UNIT_VOLTS), "max", Stream::STREAM_TYPE_ANALOG);
@@ -66,6 +67,12 @@ string EnvelopeFilter::GetProtocolName()
 	return "Envelope";
 }
 
+Filter::DataLocation EnvelopeFilter::GetInputLocation()
+{
+	//We explicitly manage our input memory and don't care where it is when Refresh() is called
+	return LOC_DONTCARE;
+}
+
 void EnvelopeFilter::ClearSweeps()
 {
 	SetData(nullptr, 0);
@@ -75,7 +82,7 @@ void EnvelopeFilter::ClearSweeps()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
-void EnvelopeFilter::Refresh()
+void EnvelopeFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
 	//Make sure we've got valid inputs
 	if(!VerifyAllInputsOK())
@@ -102,7 +109,6 @@ void EnvelopeFilter::Refresh()
 	else if(udata)
 	{
 		size_t len = udata->size();
-		udata->PrepareForCpuAccess();
 
 		//Find large (multiple sample) phase offset of the input
 		int64_t largeSampleShift = udata->m_triggerPhase - (udata->m_triggerPhase % udata->m_timescale);
@@ -140,25 +146,8 @@ void EnvelopeFilter::Refresh()
 		umax->Resize(len);
 		umin->Resize(len);
 
-		//Process overlap of old and new waveforms
-		size_t i = 0;
-		double delta = 1.0f * (umin->m_triggerPhase - udata->m_triggerPhase) / udata->m_timescale;
-		for(; i<oldlen; i++)
-		{
-			float uin = InterpolateValue(udata, i, delta);
-			umax->m_samples[i] = max(umax->m_samples[i], uin);
-			umin->m_samples[i] = min(umin->m_samples[i], uin);
-		}
-
-		//Copy input verbatim to new offsets
-		for(; i<len; i++)
-		{
-			float uin = InterpolateValue(udata, i, delta);
-			umax->m_samples[i] = uin;
-			umin->m_samples[i] = uin;
-		}
-
-		umax->MarkModifiedFromCpu();
-		umin->MarkModifiedFromCpu();
+		//Fold the new waveform into the overlap of old and new, copy it verbatim to new offsets
+		float delta = 1.0f * (umin->m_triggerPhase - udata->m_triggerPhase) / udata->m_timescale;
+		m_accumulator.Accumulate(cmdBuf, queue, udata->m_samples, len, oldlen, umax->m_samples, &umin->m_samples, delta);
 	}
 }
@@ -35,12 +35,15 @@
 #ifndef EnvelopeFilter_h
 #define EnvelopeFilter_h
 
+#include "../scopehal/WaveformAccumulator.h"
+
 class EnvelopeFilter : public Filter
 {
 public:
 	EnvelopeFilter(const std::string& color);
 
-	virtual void Refresh() override;
+	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
+	virtual DataLocation GetInputLocation() override;
 	virtual void ClearSweeps() override;
 
 	static std::string GetProtocolName();
@@ -50,6 +53,7 @@ public:
 	PROTOCOL_DECODER_INITPROC(EnvelopeFilter)
 
 protected:
+	WaveformAccumulator m_accumulator;
 };
 
 #endif
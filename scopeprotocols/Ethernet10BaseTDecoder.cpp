@@ -30,6 +30,7 @@
 #include "../scopehal/scopehal.h"
 #include "EthernetProtocolDecoder.h"
 #include "Ethernet10BaseTDecoder.h"
+#include "ManchesterRecovery.h"
 
 using namespace std;
 
@@ -68,7 +69,6 @@ void Ethernet10BaseTDecoder::Refresh()
 	}
 
 	auto din = dynamic_cast<UniformAnalogWaveform*>(GetInputWaveform(0));
-	size_t len = din->size();
 	din->PrepareForCpuAccess();
 
 	//Copy our time scales from the input
@@ -79,188 +79,58 @@ void Ethernet10BaseTDecoder::Refresh()
 	cap->PrepareForCpuAccess();
 
 	const int64_t ui_width 		= 100000 * 1000;
-	const int64_t ui_halfwidth 	= 50000 * 1000;
 	const int64_t jitter_tol 	= 10000 * 1000;
 
-	const int64_t eye_start = ui_halfwidth - jitter_tol;
-	const int64_t eye_end = ui_halfwidth + jitter_tol;
+	//Recover the Manchester bitstream. The line idles at 0V, inside the comparator's dead band, and the first edge of
+	//the preamble is a falling one. More than ten UIs without an edge ends a frame.
+	ManchesterRecovery rec(ui_width, jitter_tol, -1, 1, 10, false);
+	rec.Recover(din, true);
 
-	size_t i = 0;
-	bool done = false;
-	while(i < len)
-	{
-		if(done)
-			break;
+	//Set of recovered bytes and timestamps
+	vector<uint8_t> bytes;
+	vector<uint64_t> starts;
+	vector<uint64_t> ends;
 
-		//Look for a falling edge with at least -500 mV differential (falling edge of the first preamble bit)
-		if(!FindFallingEdge(i, din))
+	uint8_t current_byte = 0;
+	int bitcount = 0;
+	int64_t byte_start = 0;
+	for(auto& bit : rec.m_bits)
+	{
+		//Crunch the previous frame once we see the start of a new one
+		if(bit.m_flags & ManchesterBit::FLAG_FRAME_START)
 		{
-			LogTrace("Capture ended before finding another preamble\n");
-			break;
+			if(!bytes.empty())
+				BytesToFrames(bytes, starts, ends, cap);
+			bytes.clear();
+			starts.clear();
+			ends.clear();
+
+			current_byte = 0;
+			bitcount = 0;
 		}
-		LogTrace("Start of frame\n");
-
-		uint8_t current_byte = 0;
-		int bitcount = 0;
-
-		//Set of recovered bytes and timestamps
-		vector<uint8_t> bytes;
-		vector<uint64_t> starts;
-		vector<uint64_t> ends;
 
-		//Recover the Manchester bitstream
-		bool current_state = false;
-		int64_t ui_start = GetOffsetScaled(din, i);
-		int64_t byte_start = ui_start;
-		//LogDebug("[T = %.3f ns] Found initial falling edge\n", ui_start * 1e-6f);
-		while(i < len)
+		//Ethernet sends LSB first, and a rising edge in the middle of the bit is a 1
+		if(bitcount == 0)
+			byte_start = bit.m_start;
+		current_byte = (current_byte >> 1);
+		if(bit.m_value)
+			current_byte |= 0x80;
+		bitcount ++;
+		if(bitcount == 8)
 		{
-			//When we get here, i points to the start of our UI
-			//Expect an opposite polarity edge at the center of our bit
-			//LogDebug("Looking for %d -> %d edge\n", current_state, !current_state);
-			if(!FindEdge(i, din, !current_state))
-			{
-				LogTrace("Capture ended while looking for middle of this bit\n");
-				done = true;
-				break;
-			}
-
-			//If the edge came too soon or too late, possible sync error - restart from this edge
-			//If the delta was more than ten UIs, it's a new frame - end this one
-			int64_t edgepos = GetOffsetScaled(din, i);
-			int64_t delta = edgepos - ui_start;
-			/*LogDebug("[T = %.3f ns] Found edge! edgepos=%d ui_start = %d, Delta = %.3f ns (%.2f UI)\n",
-				edgepos * 1e-6f,
-				(int)edgepos,
-				(int)ui_start,
-				delta * 1e-6f,
-				delta * 1.0f / ui_width);*/
-			if(delta > 10 * ui_width)
-			{
-				LogTrace("Premature end of frame (middle of a bit)\n");
-				i++;
-				break;
-			}
-			if( (delta < eye_start) || (delta > eye_end) )
-			{
-				LogTrace("Edge was in the wrong place, skipping it and attempting resync\n");
-				i++;
-				ui_start = GetOffsetScaled(din, i);
-				current_state = !current_state;
-				continue;
-			}
-			int64_t i_middle = i;
-			int64_t ui_middle = GetOffsetScaled(din, i);
-
-			//Edge is in the right spot! Decode it. Ethernet sends LSB first.
-			//Ethernet says rising edge in the middle of the bit = 1
-			if(bitcount == 0)
-				byte_start = ui_start;
-			if(!current_state)
-				current_byte = (current_byte >> 1) | 0x80;
-			else
-				current_byte = (current_byte >> 1);
-			bitcount ++;
-			if(bitcount == 8)
-			{
-				//Save this byte
-				bytes.push_back(current_byte);
-				starts.push_back(byte_start);
-				ends.push_back(ui_start + ui_width);
-
-				current_byte = 0;
-				bitcount = 0;
-			}
-
-			//See if we have an edge at the end of this bit period
-			if(!FindEdge(i, din, current_state))
-			{
-				LogTrace("Capture ended while looking for end of this bit\n");
-				done = true;
-				break;
-			}
-			edgepos = GetOffsetScaled(din, i);
-			delta = edgepos - ui_middle;
+			//Save this byte
+			bytes.push_back(current_byte);
+			starts.push_back(byte_start);
+			ends.push_back(bit.m_start + bit.m_len);
 
-			//If the next edge is more than ten UIs after this one, declare the frame over
-			if(delta > 10*ui_width)
-			{
-				LogTrace("Normal end of frame\n");
-				i++;
-				break;
-			}
-
-			//Next edge is way after the end of this bit.
-			//It must be the middle of our next bit, deal with it later
-			if(delta > eye_end)
-			{
-				//LogDebug("Next edge is after our end (must be middle of subsequent bit\n");
-				current_state = !current_state;
-
-				//Move back until we're about half a UI after the center edge of this bit
-				i = i_middle;
-				int64_t target = ui_middle + ui_halfwidth;
-				while(i < len)
-				{
-					int64_t pos = GetOffsetScaled(din, i);
-					if(pos >= target)
-						break;
-					else
-						i++;
-				}
-			}
-
-			//Next edge is at the end of this bit.
-			//Move to the position of the edge and look for an opposite-polarity one
-			else
-			{
-				//LogDebug("Edge is at end of this bit\n");
-				//i already points to the edge, don't touch it
-			}
-
-			//Either way, i now points to the beginning of the next bit's UI
-			ui_start = GetOffsetScaled(din, i);
+			current_byte = 0;
+			bitcount = 0;
 		}
-
-		//Crunch the Manchester-coded data
-		BytesToFrames(bytes, starts, ends, cap);
 	}
+	if(!bytes.empty())
+		BytesToFrames(bytes, starts, ends, cap);
 
 	SetData(cap, 0);
 
 	cap->MarkModifiedFromCpu();
 }
-
-bool Ethernet10BaseTDecoder::FindFallingEdge(size_t& i, UniformAnalogWaveform* cap)
-{
-	size_t j = i;
-	size_t len = cap->m_samples.size();
-	while(j < len)
-	{
-		if(cap->m_samples[j] < -1)
-		{
-			i = j;
-			return true;
-		}
-		j++;
-	}
-
-	return false;	//not found
-}
-
-bool Ethernet10BaseTDecoder::FindRisingEdge(size_t& i, UniformAnalogWaveform* cap)
-{
-	size_t j = i;
-	size_t len = cap->m_samples.size();
-	while(j < len)
-	{
-		if(cap->m_samples[j] > 1)
-		{
-			i = j;
-			return true;
-		}
-		j++;
-	}
-
-	return false;	//not found
-}
@@ -45,18 +45,6 @@ public:
 	static std::string GetProtocolName();
 
 	PROTOCOL_DECODER_INITPROC(Ethernet10BaseTDecoder)
-
-protected:
-	bool FindFallingEdge(size_t& i, UniformAnalogWaveform* cap);
-	bool FindRisingEdge(size_t& i, UniformAnalogWaveform* cap);
-
-	bool FindEdge(size_t& i, UniformAnalogWaveform* cap, bool polarity)
-	{
-		if(polarity)
-			return FindRisingEdge(i, cap);
-		else
-			return FindFallingEdge(i, cap);
-	}
 };
 
 #endif
@@ -45,10 +45,34 @@ using namespace std;
 
 Ethernet64b66bDecoder::Ethernet64b66bDecoder(const string& color)
 	: Filter(color, CAT_SERIAL)
+	, m_syncErrors("Ethernet64b66bDecoder.m_syncErrors")
+	, m_headers("Ethernet64b66bDecoder.m_headers")
+	, m_codewords("Ethernet64b66bDecoder.m_codewords")
 {
 	AddProtocolStream("data");
 	CreateInput("data");
 	CreateInput("clk");
+
+	if(g_hasShaderInt8)
+	{
+		m_blockSyncComputePipeline = make_shared<ComputePipeline>(
+			"shaders/SyncHeaderSearch.spv",
+			2,
+			sizeof(Ethernet64b66bBlockSyncConstants));
+
+		m_syncErrors.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+
+		if(g_hasShaderInt64)
+		{
+			m_descrambleComputePipeline = make_shared<ComputePipeline>(
+				"shaders/Ethernet64b66b_Descrambler.spv",
+				7,
+				sizeof(Ethernet64b66bDescramblerConstants));
+
+			m_headers.SetGpuAccessHint(AcceleratorBuffer<uint8_t>::HINT_LIKELY);
+			m_codewords.SetGpuAccessHint(AcceleratorBuffer<uint64_t>::HINT_LIKELY);
+		}
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -73,8 +97,12 @@ string Ethernet64b66bDecoder::GetProtocolName()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
-void Ethernet64b66bDecoder::Refresh()
+void Ethernet64b66bDecoder::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
+	#ifdef HAVE_NVTX
+		nvtx3::scoped_range range("Ethernet64b66bDecoder::Refresh");
+	#endif
+
 	//Get the input data
 	if(!VerifyAllInputsOK())
 	{
@@ -86,6 +114,16 @@ void Ethernet64b66bDecoder::Refresh()
 	din->PrepareForCpuAccess();
 	clkin->PrepareForCpuAccess();
 
+	//Record the value of the data stream at each clock edge
+	SparseDigitalWaveform data;
+	SampleOnAnyEdgesBase(din, clkin, data);
+	data.MarkModifiedFromCpu();
+	if(data.size() <= 66)
+	{
+		SetData(NULL, 0);
+		return;
+	}
+
 	//Create the capture
 	auto cap = new Ethernet64b66bWaveform;
 	cap->m_timescale = 1;
@@ -93,31 +131,62 @@ void Ethernet64b66bDecoder::Refresh()
 	cap->m_startFemtoseconds = din->m_startFemtoseconds;
 	cap->PrepareForCpuAccess();
 
-	//Record the value of the data stream at each clock edge
-	SparseDigitalWaveform data;
-	SampleOnAnyEdgesBase(din, clkin, data);
-
 	//Look at each phase and figure out block alignment
 	size_t end = data.size() - 66;
-	size_t best_offset = 0;
-	size_t best_errors = end;
-	for(size_t offset=0; offset < 66; offset ++)
+	size_t best_offset = FindBlockAlignment(cmdBuf, queue, data, end);
+
+	//The descrambler is self-synchronizing, so we can do every block in parallel on the GPU
+	//(indexes are 32 bit in the shader)
+	if(m_descrambleComputePipeline && (data.size() < 0x80000000) )
 	{
-		size_t errors = 0;
-		for(size_t i=offset; i<end; i+= 66)
+		//The first block is only used to prime the descrambler
+		size_t nblocks = 0;
+		if(best_offset < end)
+			nblocks = (end - best_offset + 65) / 66;
+		if(nblocks > 1)
 		{
-			if(data.m_samples[i] == data.m_samples[i+1])
-				errors ++;
+			uint32_t count = nblocks - 1;
+			cap->Resize(count);
+			m_headers.resize(count);
+			m_codewords.resize(count);
+
+			cmdBuf.begin({});
+
+			Ethernet64b66bDescramblerConstants cfg;
+			cfg.count = count;
+			cfg.start = best_offset + 66;
+
+			m_descrambleComputePipeline->BindBufferNonblocking(0, data.m_samples, cmdBuf);
+			m_descrambleComputePipeline->BindBufferNonblocking(1, data.m_offsets, cmdBuf);
+			m_descrambleComputePipeline->BindBufferNonblocking(2, data.m_durations, cmdBuf);
+			m_descrambleComputePipeline->BindBufferNonblocking(3, m_headers, cmdBuf, true);
+			m_descrambleComputePipeline->BindBufferNonblocking(4, m_codewords, cmdBuf, true);
+			m_descrambleComputePipeline->BindBufferNonblocking(5, cap->m_offsets, cmdBuf, true);
+			m_descrambleComputePipeline->BindBufferNonblocking(6, cap->m_durations, cmdBuf, true);
+			const uint32_t compute_block_count = GetComputeBlockCount(count, 64);
+			m_descrambleComputePipeline->Dispatch(cmdBuf, cfg,
+				min(compute_block_count, 32768u),
+				compute_block_count / 32768 + 1);
+
+			m_headers.MarkModifiedFromGpu();
+			m_codewords.MarkModifiedFromGpu();
+			cap->MarkTimestampsModifiedFromGpu();
+
+			m_headers.PrepareForCpuAccessNonblocking(cmdBuf);
+			m_codewords.PrepareForCpuAccessNonblocking(cmdBuf);
+
+			cmdBuf.end();
+			queue->SubmitAndBlock(cmdBuf);
+
+			for(size_t i=0; i<count; i++)
+				cap->m_samples[i] = Ethernet64b66bSymbol(m_headers[i], m_codewords[i]);
+			cap->MarkSamplesModifiedFromCpu();
 		}
 
-		if(errors < best_errors)
-		{
-			best_offset = offset;
-			best_errors = errors;
-		}
+		SetData(cap, 0);
+		return;
 	}
 
-
 	//Decode the actual data
 	bool first		= true;
 	uint64_t lfsr	= 0;
@@ -182,6 +251,85 @@ void Ethernet64b66bDecoder::Refresh()
 	cap->MarkModifiedFromCpu();
 }
 
+/**
+	@brief Finds the block phase with the fewest invalid sync headers
+
+	@param cmdBuf	Command buffer to use for the GPU search
+	@param queue	Queue to submit to
+	@param data		Sampled serial data
+	@param end		Index of the first bit a block may not start at
+
+	@return Index of the first bit of the first block
+ */
+size_t Ethernet64b66bDecoder::FindBlockAlignment(
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue,
+	SparseDigitalWaveform& data,
+	size_t end)
+{
+	size_t best_offset = 0;
+	size_t best_errors = end;
+
+	if(m_blockSyncComputePipeline && (data.size() < 0x80000000) )
+	{
+		m_syncErrors.resize(66);
+		m_syncErrors.PrepareForCpuAccess();
+		for(size_t i=0; i<66; i++)
+			m_syncErrors[i] = 0;
+		m_syncErrors.MarkModifiedFromCpu();
+
+		cmdBuf.begin({});
+
+		Ethernet64b66bBlockSyncConstants cfg;
+		cfg.end = end;
+		cfg.blockLen = 66;
+
+		//One row of thread blocks per phase
+		const uint32_t maxBlocksPerPhase = 64;
+		m_blockSyncComputePipeline->BindBufferNonblocking(0, data.m_samples, cmdBuf);
+		m_blockSyncComputePipeline->BindBufferNonblocking(1, m_syncErrors, cmdBuf);
+		m_blockSyncComputePipeline->Dispatch(cmdBuf, cfg,
+			min(GetComputeBlockCount(end / 66 + 1, 64), maxBlocksPerPhase),
+			66);
+
+		m_syncErrors.MarkModifiedFromGpu();
+		m_syncErrors.PrepareForCpuAccessNonblocking(cmdBuf);
+
+		cmdBuf.end();
+		queue->SubmitAndBlock(cmdBuf);
+
+		for(size_t offset=0; offset < 66; offset ++)
+		{
+			if(m_syncErrors[offset] < best_errors)
+			{
+				best_offset = offset;
+				best_errors = m_syncErrors[offset];
+			}
+		}
+	}
+
+	else
+	{
+		for(size_t offset=0; offset < 66; offset ++)
+		{
+			size_t errors = 0;
+			for(size_t i=offset; i<end; i+= 66)
+			{
+				if(data.m_samples[i] == data.m_samples[i+1])
+					errors ++;
+			}
+
+			if(errors < best_errors)
+			{
+				best_offset = offset;
+				best_errors = errors;
+			}
+		}
+	}
+
+	return best_offset;
+}
+
 std::string Ethernet64b66bWaveform::GetColor(size_t i)
 {
 	const Ethernet64b66bSymbol& s = m_samples[i];
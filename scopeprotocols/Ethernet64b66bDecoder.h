@@ -64,12 +64,26 @@ public:
 	virtual std::string GetColor(size_t) override;
 };
 
+class Ethernet64b66bBlockSyncConstants
+{
+public:
+	uint32_t	end;
+	uint32_t	blockLen;
+};
+
+class Ethernet64b66bDescramblerConstants
+{
+public:
+	uint32_t	count;
+	uint32_t	start;
+};
+
 class Ethernet64b66bDecoder : public Filter
 {
 public:
 	Ethernet64b66bDecoder(const std::string& color);
 
-	virtual void Refresh() override;
+	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
 
 	static std::string GetProtocolName();
 
@@ -78,6 +92,26 @@ public:
 	PROTOCOL_DECODER_INITPROC(Ethernet64b66bDecoder)
 
 protected:
+	size_t FindBlockAlignment(
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue,
+		SparseDigitalWaveform& data,
+		size_t end);
+
+	///@brief Invalid sync header count at each block phase
+	AcceleratorBuffer<uint32_t> m_syncErrors;
+
+	///@brief Sync headers of each decoded block
+	AcceleratorBuffer<uint8_t> m_headers;
+
+	///@brief Descrambled payload of each decoded block
+	AcceleratorBuffer<uint64_t> m_codewords;
+
+	///@brief Compute pipeline for block sync search
+	std::shared_ptr<ComputePipeline> m_blockSyncComputePipeline;
+
+	///@brief Compute pipeline for descrambling
+	std::shared_ptr<ComputePipeline> m_descrambleComputePipeline;
 };
 
 #endif
@@ -0,0 +1,336 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of EthernetFlowTable
+ */
+
+#include "../scopehal/scopehal.h"
+#include "EthernetProtocolDecoder.h"
+#include "EthernetFlowTable.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Builds the table by walking the symbol stream once
+
+	@param wfm	The waveform to index (must be valid on the CPU)
+ */
+EthernetFlowTable::EthernetFlowTable(EthernetWaveform* wfm)
+{
+	size_t len = wfm->size();
+
+	//Index of the frame being built, if any
+	size_t nframe = SIZE_MAX;
+	bool inPayload = false;
+	bool payloadDone = false;
+
+	auto endFrame = [&]()
+	{
+		if(nframe != SIZE_MAX)
+			ParseHeaders(m_frames[nframe]);
+		nframe = SIZE_MAX;
+	};
+
+	auto startFrame = [&](size_t i)
+	{
+		endFrame();
+
+		EthernetDecodedFrame f;
+		f.m_firstSample = i;
+		f.m_payloadSample = 0;
+		f.m_bytesStart = m_bytes.size();
+		f.m_len = 0;
+		f.m_payloadStart = 0;
+		f.m_ethertype = 0;
+		f.m_vlan = -1;
+		f.m_fcsGood = false;
+		f.m_ipv4 = false;
+		f.m_tcp = false;
+		f.m_udp = false;
+		f.m_l4Start = 0;
+		f.m_l4Len = 0;
+		f.m_flow = SIZE_MAX;
+
+		nframe = m_frames.size();
+		m_frames.push_back(f);
+		inPayload = false;
+		payloadDone = false;
+	};
+
+	auto append = [&](const vector<uint8_t>& data)
+	{
+		m_bytes.insert(m_bytes.end(), data.begin(), data.end());
+		m_frames[nframe].m_len += data.size();
+	};
+
+	for(size_t i=0; i<len; i++)
+	{
+		auto& s = wfm->m_samples[i];
+		switch(s.m_type)
+		{
+			case EthernetFrameSegment::TYPE_SFD:
+				startFrame(i);
+				break;
+
+			//Frames from decoders which suppress the preamble start here
+			case EthernetFrameSegment::TYPE_DST_MAC:
+				if( (nframe == SIZE_MAX) || (m_frames[nframe].m_len != 0) )
+					startFrame(i);
+				append(s.m_data);
+				break;
+
+			case EthernetFrameSegment::TYPE_SRC_MAC:
+				if(nframe != SIZE_MAX)
+					append(s.m_data);
+				break;
+
+			case EthernetFrameSegment::TYPE_ETHERTYPE:
+				if( (nframe != SIZE_MAX) && (s.m_data.size() == 2) )
+				{
+					append(s.m_data);
+					m_frames[nframe].m_ethertype = (s.m_data[0] << 8) | s.m_data[1];
+				}
+				break;
+
+			case EthernetFrameSegment::TYPE_VLAN_TAG:
+				if( (nframe != SIZE_MAX) && (s.m_data.size() == 2) )
+				{
+					append(s.m_data);
+					m_frames[nframe].m_vlan = ( (s.m_data[0] << 8) | s.m_data[1] ) & 0xfff;
+				}
+				break;
+
+			//Payload bytes are one per sample, only keep the contiguous run right after the headers
+			case EthernetFrameSegment::TYPE_PAYLOAD:
+				if( (nframe != SIZE_MAX) && !payloadDone)
+				{
+					auto& f = m_frames[nframe];
+					if(!inPayload)
+					{
+						f.m_payloadSample = i;
+						f.m_payloadStart = f.m_len;
+						inPayload = true;
+					}
+					append(s.m_data);
+				}
+				break;
+
+			case EthernetFrameSegment::TYPE_FCS_GOOD:
+				if(nframe != SIZE_MAX)
+					m_frames[nframe].m_fcsGood = true;
+				endFrame();
+				break;
+
+			case EthernetFrameSegment::TYPE_FCS_BAD:
+				endFrame();
+				break;
+
+			//Anything else ends the payload, but not necessarily the frame
+			default:
+				if(inPayload)
+					payloadDone = true;
+				break;
+		}
+	}
+	endFrame();
+
+	//Group TCP and UDP frames into flows
+	for(size_t i=0; i<m_frames.size(); i++)
+	{
+		auto& f = m_frames[i];
+		if(!f.m_tcp && !f.m_udp)
+			continue;
+
+		EthernetFlowKey key;
+		key.m_source = f.m_ip.m_source;
+		key.m_dest = f.m_ip.m_dest;
+		key.m_sourcePort = f.m_l4.m_sourcePort;
+		key.m_destPort = f.m_l4.m_destPort;
+		key.m_protocol = f.m_ip.m_protocol;
+
+		auto it = m_flowsByKey.find(key);
+		if(it == m_flowsByKey.end())
+		{
+			it = m_flowsByKey.emplace(key, m_flows.size()).first;
+			m_flows.emplace_back();
+			m_flows.back().m_key = key;
+			m_flows.back().m_incomplete = false;
+		}
+
+		f.m_flow = it->second;
+		m_flows[f.m_flow].m_frames.push_back(i);
+	}
+
+	for(auto& flow : m_flows)
+	{
+		if(flow.m_key.m_protocol == 0x06)
+			Reassemble(flow);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Header parsing
+
+/**
+	@brief Parses the IPv4 and TCP/UDP headers of a frame, if present
+ */
+void EthernetFlowTable::ParseHeaders(EthernetDecodedFrame& frame)
+{
+	if(frame.m_ethertype != 0x0800)
+		return;
+
+	//Need the fixed part of the header, and IP version 4
+	const uint8_t* p = m_bytes.data() + frame.m_bytesStart + frame.m_payloadStart;
+	size_t avail = frame.m_len - frame.m_payloadStart;
+	if( (avail < 20) || ( (p[0] >> 4) != 4) )
+		return;
+
+	auto& ip = frame.m_ip;
+	ip.m_headerLen = p[0] & 0xf;
+	ip.m_diffserv = p[1];
+	ip.m_length = (p[2] << 8) | p[3];
+	ip.m_id = (p[4] << 8) | p[5];
+	ip.m_flags = p[6] >> 5;
+	ip.m_fragOffset = ( (p[6] & 0x1f) << 8) | p[7];
+	ip.m_ttl = p[8];
+	ip.m_protocol = p[9];
+	ip.m_checksum = (p[10] << 8) | p[11];
+	ip.m_source = (p[12] << 24) | (p[13] << 16) | (p[14] << 8) | p[15];
+	ip.m_dest = (p[16] << 24) | (p[17] << 16) | (p[18] << 8) | p[19];
+	frame.m_ipv4 = true;
+
+	//Only look for layer 4 headers in the first (or only) fragment
+	size_t iphlen = ip.m_headerLen * 4;
+	if( (iphlen < 20) || (ip.m_fragOffset != 0) )
+		return;
+
+	//Ignore anything past the end of the datagram (Ethernet padding)
+	size_t iplen = min(avail, static_cast<size_t>(ip.m_length));
+	if(iplen < iphlen)
+		return;
+	p += iphlen;
+	size_t l4avail = iplen - iphlen;
+
+	auto& l4 = frame.m_l4;
+	if( (ip.m_protocol == 0x06) && (l4avail >= 20) )
+	{
+		l4.m_sourcePort = (p[0] << 8) | p[1];
+		l4.m_destPort = (p[2] << 8) | p[3];
+		l4.m_seq = (p[4] << 24) | (p[5] << 16) | (p[6] << 8) | p[7];
+		l4.m_ack = (p[8] << 24) | (p[9] << 16) | (p[10] << 8) | p[11];
+		l4.m_dataOffset = p[12] >> 4;
+		l4.m_flags = ( (p[12] & 1) << 8) | p[13];
+		l4.m_window = (p[14] << 8) | p[15];
+		l4.m_checksum = (p[16] << 8) | p[17];
+		l4.m_urgent = (p[18] << 8) | p[19];
+
+		size_t tcphlen = l4.m_dataOffset * 4;
+		if( (tcphlen < 20) || (tcphlen > l4avail) )
+			return;
+
+		frame.m_tcp = true;
+		frame.m_l4Start = frame.m_payloadStart + iphlen + tcphlen;
+		frame.m_l4Len = l4avail - tcphlen;
+	}
+
+	else if( (ip.m_protocol == 0x11) && (l4avail >= 8) )
+	{
+		l4.m_sourcePort = (p[0] << 8) | p[1];
+		l4.m_destPort = (p[2] << 8) | p[3];
+
+		frame.m_udp = true;
+		frame.m_l4Start = frame.m_payloadStart + iphlen + 8;
+		frame.m_l4Len = l4avail - 8;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// TCP reassembly
+
+/**
+	@brief Puts the payload of a TCP flow back in sequence order
+ */
+void EthernetFlowTable::Reassemble(EthernetFlow& flow)
+{
+	//Segments we can't append yet, by position relative to the start of the stream
+	multimap<uint32_t, size_t> pending;
+
+	bool started = false;
+	uint32_t isn = 0;
+	for(auto i : flow.m_frames)
+	{
+		auto& f = m_frames[i];
+
+		//SYN consumes one sequence number, the stream starts right after it
+		if(f.m_l4.m_flags & 0x02)
+		{
+			isn = f.m_l4.m_seq + 1;
+			started = true;
+			continue;
+		}
+
+		//Joined partway through the conversation, start at the first segment we saw
+		if(!started)
+		{
+			isn = f.m_l4.m_seq;
+			started = true;
+		}
+
+		if(f.m_l4Len == 0)
+			continue;
+
+		//Retransmissions of data from before the start of the stream look like they're ~4 GB ahead, drop them
+		uint32_t pos = f.m_l4.m_seq - isn;
+		if(pos & 0x80000000)
+			continue;
+		pending.emplace(pos, i);
+
+		//Append everything that's now contiguous, skipping the parts we already have
+		while(!pending.empty() && (pending.begin()->first <= flow.m_stream.size()) )
+		{
+			auto& seg = m_frames[pending.begin()->second];
+			size_t skip = flow.m_stream.size() - pending.begin()->first;
+			if(skip < seg.m_l4Len)
+			{
+				auto start = m_bytes.begin() + seg.m_bytesStart + seg.m_l4Start;
+				flow.m_stream.insert(flow.m_stream.end(), start + skip, start + seg.m_l4Len);
+			}
+			pending.erase(pending.begin());
+		}
+	}
+
+	flow.m_incomplete = !pending.empty();
+}
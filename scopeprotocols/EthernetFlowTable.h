@@ -0,0 +1,236 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of EthernetFlowTable
+ */
+#ifndef EthernetFlowTable_h
+#define EthernetFlowTable_h
+
+#include <unordered_map>
+
+class EthernetWaveform;
+
+/**
+	@brief Fixed part of an IPv4 header
+ */
+class EthernetIPv4Header
+{
+public:
+	///@brief Header length, in 32-bit words
+	uint8_t m_headerLen;
+
+	uint8_t m_diffserv;
+
+	///@brief Total datagram length, including the header
+	uint16_t m_length;
+
+	uint16_t m_id;
+
+	///@brief Flags (3 bits)
+	uint8_t m_flags;
+
+	///@brief Fragment offset, in 8-byte units
+	uint16_t m_fragOffset;
+
+	uint8_t m_ttl;
+	uint8_t m_protocol;
+	uint16_t m_checksum;
+	uint32_t m_source;
+	uint32_t m_dest;
+};
+
+/**
+	@brief Fixed part of a TCP header (ports only are valid for UDP)
+ */
+class EthernetL4Header
+{
+public:
+	uint16_t m_sourcePort;
+	uint16_t m_destPort;
+	uint32_t m_seq;
+	uint32_t m_ack;
+
+	///@brief Header length, in 32-bit words
+	uint8_t m_dataOffset;
+
+	///@brief Flags (9 bits, NS in bit 8)
+	uint16_t m_flags;
+
+	uint16_t m_window;
+	uint16_t m_checksum;
+	uint16_t m_urgent;
+};
+
+/**
+	@brief One Ethernet frame with its headers parsed
+ */
+class EthernetDecodedFrame
+{
+public:
+	///@brief Sample index of the start of the frame (SFD, or destination MAC if the preamble was suppressed)
+	size_t m_firstSample;
+
+	///@brief Sample index of the first payload byte. Payload byte k is always sample m_payloadSample + k.
+	size_t m_payloadSample;
+
+	///@brief Start of the frame in EthernetFlowTable::m_bytes (destination MAC through end of payload, no FCS)
+	size_t m_bytesStart;
+
+	///@brief Number of frame bytes
+	size_t m_len;
+
+	///@brief Offset of the first payload byte within the frame bytes
+	size_t m_payloadStart;
+
+	///@brief Ethertype (the inner one, for 802.1q tagged frames)
+	uint16_t m_ethertype;
+
+	///@brief VLAN ID, or -1 if untagged
+	int m_vlan;
+
+	///@brief True if the frame ended with a good FCS
+	bool m_fcsGood;
+
+	///@brief True if the payload starts with a complete IPv4 header, and m_ip is valid
+	bool m_ipv4;
+	EthernetIPv4Header m_ip;
+
+	///@brief True if the IPv4 payload starts with a complete TCP header, and m_l4 is valid
+	bool m_tcp;
+
+	///@brief True if the IPv4 payload starts with a UDP header, and the ports in m_l4 are valid
+	bool m_udp;
+	EthernetL4Header m_l4;
+
+	///@brief Offset of the TCP/UDP payload within the frame bytes
+	size_t m_l4Start;
+
+	///@brief Length of the TCP/UDP payload, bounded by the IPv4 length and the bytes actually captured
+	size_t m_l4Len;
+
+	///@brief Index of the flow this frame belongs to in EthernetFlowTable::m_flows, or SIZE_MAX if not TCP/UDP
+	size_t m_flow;
+};
+
+/**
+	@brief Identifies one direction of a TCP or UDP conversation
+ */
+class EthernetFlowKey
+{
+public:
+	uint32_t m_source;
+	uint32_t m_dest;
+	uint16_t m_sourcePort;
+	uint16_t m_destPort;
+	uint8_t m_protocol;
+
+	bool operator==(const EthernetFlowKey& rhs) const
+	{
+		return (m_source == rhs.m_source) && (m_dest == rhs.m_dest) &&
+			(m_sourcePort == rhs.m_sourcePort) && (m_destPort == rhs.m_destPort) &&
+			(m_protocol == rhs.m_protocol);
+	}
+};
+
+class EthernetFlowKeyHash
+{
+public:
+	size_t operator()(const EthernetFlowKey& key) const
+	{
+		uint64_t a = (static_cast<uint64_t>(key.m_source) << 32) | key.m_dest;
+		uint64_t b = (static_cast<uint64_t>(key.m_sourcePort) << 24) | (key.m_destPort << 8) | key.m_protocol;
+		return std::hash<uint64_t>()(a ^ (b * 0x9e3779b97f4a7c15ULL));
+	}
+};
+
+/**
+	@brief All frames of one flow, plus the reassembled byte stream for TCP
+ */
+class EthernetFlow
+{
+public:
+	EthernetFlowKey m_key;
+
+	///@brief Indexes of the flow's frames in EthernetFlowTable::m_frames, in capture order
+	std::vector<size_t> m_frames;
+
+	///@brief TCP payload in sequence order, with retransmissions removed (stops at the first hole)
+	std::vector<uint8_t> m_stream;
+
+	///@brief True if segments were captured past a hole in the sequence space and are not in m_stream
+	bool m_incomplete;
+};
+
+/**
+	@brief Every frame in an EthernetWaveform with its Ethernet, IPv4 and TCP/UDP headers parsed, grouped into flows
+
+	Upper layer decoders read header fields from here instead of each re-parsing the bytes, and exporters can write
+	frames straight out of m_bytes. The table is built once per waveform revision by EthernetWaveform::GetFlowTable()
+	and shared by every consumer.
+ */
+class EthernetFlowTable
+{
+public:
+	EthernetFlowTable(EthernetWaveform* wfm);
+
+	///@brief All frames, in order
+	std::vector<EthernetDecodedFrame> m_frames;
+
+	///@brief Bytes of every frame, back to back
+	std::vector<uint8_t> m_bytes;
+
+	///@brief All TCP and UDP flows, in order of first appearance
+	std::vector<EthernetFlow> m_flows;
+
+	///@brief Returns a pointer to the bytes of a frame, starting at the destination MAC
+	const uint8_t* GetFrameBytes(size_t i) const
+	{ return m_bytes.data() + m_frames[i].m_bytesStart; }
+
+	///@brief Returns the flow with a given key, or nullptr if it never appears
+	const EthernetFlow* GetFlow(const EthernetFlowKey& key) const
+	{
+		auto it = m_flowsByKey.find(key);
+		if(it == m_flowsByKey.end())
+			return nullptr;
+		return &m_flows[it->second];
+	}
+
+protected:
+	void ParseHeaders(EthernetDecodedFrame& frame);
+	void Reassemble(EthernetFlow& flow);
+
+	///@brief Map of flow key to index in m_flows
+	std::unordered_map<EthernetFlowKey, size_t, EthernetFlowKeyHash> m_flowsByKey;
+};
+
+#endif
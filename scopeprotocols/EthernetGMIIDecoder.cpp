@@ -102,13 +102,13 @@ void EthernetGMIIDecoder::Refresh()
 	auto en = GetInputWaveform(2);
 	auto er = GetInputWaveform(3);
 
-	//Sample everything on the clock edges
-	SparseDigitalWaveform den;
-	SparseDigitalWaveform der;
-	SparseDigitalBusWaveform ddata;
-	SampleOnRisingEdgesBase(en, clk, den);
-	SampleOnRisingEdgesBase(er, clk, der);
-	SampleOnRisingEdgesBase(data, clk, ddata);
+	//Sample everything on the clock edges in one pass: data byte in the low 8 bits, then enable and error
+	SparseDigitalBusWaveform sampled;
+	DigitalEdgeList::SampleLanes(
+		clk,
+		EdgeSampler::EDGE_RISING,
+		{ {data, 0, 0xff}, {en, 8}, {er, 9} },
+		sampled);
 
 	//Create the output capture
 	auto cap = new EthernetWaveform;
@@ -117,12 +117,10 @@ void EthernetGMIIDecoder::Refresh()
 	cap->m_startFemtoseconds = data->m_startFemtoseconds;
 	cap->PrepareForCpuAccess();
 
-	size_t len = den.size();
-	len = min(len, der.size());
-	len = min(len, ddata.size());
+	size_t len = sampled.size();
 	for(size_t i=0; i < len; i++)
 	{
-		if(!den.m_samples[i])
+		if(!(sampled.m_samples[i] & 0x100))
 			continue;
 
 		//Set of recovered bytes and timestamps
@@ -131,19 +129,13 @@ void EthernetGMIIDecoder::Refresh()
 		vector<uint64_t> ends;
 
 		//TODO: handle error signal (ignored for now)
-		while( (i < len) && (den.m_samples[i]) )
+		while( (i < len) && (sampled.m_samples[i] & 0x100) )
 		{
-			//Convert bits to bytes
-			uint8_t dval = 0;
-			for(size_t j=0; j<8; j++)
-			{
-				if(ddata.m_samples[i][j])
-					dval |= (1 << j);
-			}
+			uint8_t dval = sampled.m_samples[i] & 0xff;
 
 			bytes.push_back(dval);
-			starts.push_back(ddata.m_offsets[i]);
-			ends.push_back(ddata.m_offsets[i] + ddata.m_durations[i]);
+			starts.push_back(sampled.m_offsets[i]);
+			ends.push_back(sampled.m_offsets[i] + sampled.m_durations[i]);
 			i++;
 		}
 
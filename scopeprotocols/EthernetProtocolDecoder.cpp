@@ -29,6 +29,7 @@
 
 #include "../scopehal/scopehal.h"
 #include "EthernetProtocolDecoder.h"
+#include "EthernetFlowTable.h"
 
 using namespace std;
 
@@ -445,6 +446,27 @@ void EthernetProtocolDecoder::BytesToFrames(
 	delete pack;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// EthernetWaveform
+
+///@brief Mutex protecting the flow table of every EthernetWaveform
+static mutex g_ethernetFlowTableMutex;
+
+/**
+	@brief Returns the flow table for this waveform, building it if it is missing or out of date
+ */
+shared_ptr<const EthernetFlowTable> EthernetWaveform::GetFlowTable()
+{
+	lock_guard<mutex> lock(g_ethernetFlowTableMutex);
+	if(!m_flowTable || (m_flowTableRevision != m_revision))
+	{
+		PrepareForCpuAccess();
+		m_flowTable = make_shared<EthernetFlowTable>(this);
+		m_flowTableRevision = m_revision;
+	}
+	return m_flowTable;
+}
+
 std::string EthernetWaveform::GetColor(size_t i)
 {
 	switch(m_samples[i].m_type)
@@ -78,14 +78,26 @@ public:
 	}
 };
 
+class EthernetFlowTable;
+
 class EthernetWaveform : public SparseWaveform<EthernetFrameSegment>
 {
 public:
 	EthernetWaveform ()
 		: SparseWaveform<EthernetFrameSegment>()
+		, m_flowTableRevision(0)
 	{};
 	virtual std::string GetText(size_t) override;
 	virtual std::string GetColor(size_t) override;
+
+	std::shared_ptr<const EthernetFlowTable> GetFlowTable();
+
+protected:
+	///@brief Flow table built by GetFlowTable(), if any
+	std::shared_ptr<const EthernetFlowTable> m_flowTable;
+
+	///@brief Revision m_flowTable was built from
+	uint64_t m_flowTableRevision;
 };
 
 class EthernetProtocolDecoder : public PacketDecoder
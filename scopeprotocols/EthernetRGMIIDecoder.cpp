@@ -99,18 +99,15 @@ void EthernetRGMIIDecoder::Refresh()
 	auto clk = GetInputWaveform(1);
 	auto ctl = GetInputWaveform(2);
 
-	//Sample everything on the clock edges
-	SparseDigitalWaveform dctl;
+	//Sample everything on both clock edges in one pass: data nibble in the low 4 bits, then ctl
 	SparseDigitalBusWaveform ddata;
-	SampleOnAnyEdgesBase(ctl, clk, dctl);
-	SampleOnAnyEdgesBase(data, clk, ddata);
-
-	dctl.PrepareForCpuAccess();
-	ddata.PrepareForCpuAccess();
+	DigitalEdgeList::SampleLanes(clk, EdgeSampler::EDGE_ANY, { {data, 0, 0xf}, {ctl, 4} }, ddata);
+	auto dctl = [&](size_t i)
+		{ return (ddata.m_samples[i] & 0x10) != 0; };
 
 	//Need a reasonable number of samples or there's no point in decoding.
 	//Cut off the last few samples because we might be either DDR or SDR and need to seek past our current position.
-	size_t len = min(dctl.size(), ddata.size());
+	size_t len = ddata.size();
 	if(len < 100)
 	{
 		SetData(NULL, 0);
@@ -129,15 +126,10 @@ void EthernetRGMIIDecoder::Refresh()
 	for(size_t i=2; i < len; i++)
 	{
 		//Not sending a frame. Decode in-band status
-		if(!dctl.m_samples[i])
+		if(!dctl(i))
 		{
 			//Extract in-band status
-			uint8_t status = 0;
-			for(size_t j=0; j<4; j++)
-			{
-				if(ddata.m_samples[i][j])
-					status |= (1 << j);
-			}
+			uint8_t status = ddata.m_samples[i] & 0xf;
 
 			//Same status? Merge samples
 			bool extend = false;
@@ -169,7 +161,7 @@ void EthernetRGMIIDecoder::Refresh()
 		//Figure out the clock period.
 		//Need to do this cycle-by-cycle in case the link speed changes during a deep capture
 		//TODO: alert if clock isn't close to one of the three legal frequencies
-		int64_t clkperiod = dctl.m_offsets[i] - dctl.m_offsets[i-2];
+		int64_t clkperiod = ddata.m_offsets[i] - ddata.m_offsets[i-2];
 		bool ddr = false;			//Default to 2.5/25 MHz SDR.
 		if(clkperiod < 10000000)	//Faster than 100 MHz? assume it's 125 MHz DDR.
 			ddr = true;
@@ -180,25 +172,15 @@ void EthernetRGMIIDecoder::Refresh()
 		vector<uint64_t> ends;
 
 		//TODO: handle error signal (ignored for now)
-		while( (i < len) && (dctl.m_samples[i]) )
+		while( (i < len) && dctl(i) )
 		{
 			//Start time
 			starts.push_back(ddata.m_offsets[i]);
 
 			if(ddr)
 			{
-				//Convert bits to bytes
-				uint8_t dval = 0;
-				for(size_t j=0; j<8; j++)
-				{
-					if(j < 4)
-					{
-						if(ddata.m_samples[i][j])
-							dval |= (1 << j);
-					}
-					else if(ddata.m_samples[i+1][j-4])
-						dval |= (1 << j);
-				}
+				//Low nibble first
+				uint8_t dval = (ddata.m_samples[i] & 0xf) | ( (ddata.m_samples[i+1] & 0xf) << 4);
 				bytes.push_back(dval);
 
 				ends.push_back(ddata.m_offsets[i+1] + ddata.m_durations[i+1]);
@@ -207,18 +189,8 @@ void EthernetRGMIIDecoder::Refresh()
 
 			else
 			{
-				//Convert bits to bytes
-				uint8_t dval = 0;
-				for(size_t j=0; j<8; j++)
-				{
-					if(j < 4)
-					{
-						if(ddata.m_samples[i][j])
-							dval |= (1 << j);
-					}
-					else if(ddata.m_samples[i+2][j-4])
-						dval |= (1 << j);
-				}
+				//Low nibble first
+				uint8_t dval = (ddata.m_samples[i] & 0xf) | ( (ddata.m_samples[i+2] & 0xf) << 4);
 				bytes.push_back(dval);
 
 				ends.push_back(ddata.m_offsets[i+3] + ddata.m_durations[i+3]);
@@ -93,17 +93,12 @@ void EthernetRMIIDecoder::Refresh()
 	auto d0 = GetInputWaveform(2);
 	auto d1 = GetInputWaveform(3);
 
-	//Sample everything on the clock edges
-	SparseDigitalWaveform dctl;
-	SparseDigitalWaveform dd0;
-	SparseDigitalWaveform dd1;
-	SampleOnRisingEdgesBase(ctl, clk, dctl);
-	SampleOnRisingEdgesBase(d0, clk, dd0);
-	SampleOnRisingEdgesBase(d1, clk, dd1);
+	//Sample everything on the clock edges in one pass: d0, d1, then ctl
+	SparseDigitalBusWaveform sampled;
+	DigitalEdgeList::SampleLanes(clk, EdgeSampler::EDGE_RISING, { {d0, 0}, {d1, 1}, {ctl, 2} }, sampled);
 
 	//Need a reasonable number of samples or there's no point in decoding.
-	size_t len = min(dctl.size(), dd0.size());
-	len = min(len, dd1.size());
+	size_t len = sampled.size();
 	if(len < 100)
 	{
 		SetData(NULL, 0);
@@ -122,11 +117,11 @@ void EthernetRMIIDecoder::Refresh()
 	for(size_t i=2; i < len; i++)
 	{
 		//If ctl is 0, nothing happening
-		if(!dctl.m_samples[i])
+		if(!(sampled.m_samples[i] & 4))
 			continue;
 
 		//No preamble (ctl high, d0 high, d1 low) yet
-		if(!dd0.m_samples[i])
+		if(!(sampled.m_samples[i] & 1))
 			continue;
 
 		//Set of recovered bytes and timestamps
@@ -136,23 +131,20 @@ void EthernetRMIIDecoder::Refresh()
 
 		//TODO: handle error signal (ignored for now)
 		bool err = false;
-		while( (i < len) && (dctl.m_samples[i]) )
+		while( (i < len) && (sampled.m_samples[i] & 4) )
 		{
 			//Timestamps
-			starts.push_back(dd0.m_offsets[i]);
-			ends.push_back(dd0.m_offsets[i+3] + dd0.m_durations[i+3]);
+			starts.push_back(sampled.m_offsets[i]);
+			ends.push_back(sampled.m_offsets[i+3] + sampled.m_durations[i+3]);
 
 			//Convert di-bits to bytes
 			//We send LSB first, MSB last
 			uint8_t dval = 0;
 			for(size_t j=0; j<4; j ++)
 			{
-				if(dd0.m_samples[i+j])
-					dval |= (1 << j*2);
-				if(dd1.m_samples[i+j])
-					dval |= (2 << j*2);
+				dval |= (sampled.m_samples[i+j] & 3) << j*2;
 
-				if(!dctl.m_samples[i+j])
+				if(!(sampled.m_samples[i+j] & 4))
 				{
 					LogDebug("ctl ended partway through a byte at i=%zu, j=%zu)\n", i, j);
 					err = true;
@@ -38,6 +38,7 @@ using namespace std;
 ExponentialMovingAverageFilter::ExponentialMovingAverageFilter(const string& color)
 	: Filter(color, CAT_MATH)
 	, m_halflife("Half-life")
+	, m_accumulator(WaveformAccumulator::ACCUM_EXPONENTIAL)
 {
 	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_ANALOG);
 	CreateInput("din");
@@ -83,7 +84,7 @@ void ExponentialMovingAverageFilter::ClearSweeps()
 	SetData(nullptr, 0);
 }
 
-void ExponentialMovingAverageFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/, shared_ptr<QueueHandle> /*queue*/)
+void ExponentialMovingAverageFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
 	//Make sure we've got valid inputs
 	if(!VerifyAllInputsOK())
@@ -102,41 +103,30 @@ void ExponentialMovingAverageFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/
 	float hl = m_parameters[m_halflife].GetIntVal();
 	float decay = 1 / pow(2, 1/hl);
 
-	din->PrepareForCpuAccess();
-
 	//Set up units
 	m_xAxisUnit = m_inputs[0].m_channel->GetXAxisUnits();
 	SetYAxisUnits(m_inputs[0].GetYAxisUnits(), 0);
 
-	//See if we already had valid output data
+	//See if we already had valid output data.
+	//Anything past the end of the old output (if any) is just copied.
 	auto cap = GetData(0);
 	auto scap = dynamic_cast<SparseAnalogWaveform*>(cap);
 	auto ucap = dynamic_cast<UniformAnalogWaveform*>(cap);
-	if(cap)
-		cap->PrepareForCpuAccess();
+	size_t validLen = 0;
 
 	//Sparse path
 	if(sdin)
 	{
-		//No data? Just copy
 		if(!scap)
 		{
 			scap = new SparseAnalogWaveform;
-			scap->Resize(din->size());
 			cap = scap;
-
-			scap->m_samples.CopyFrom(sdin->m_samples);
 		}
-
-		//Actual filter code path
 		else
-		{
-			auto pin = sdin->m_samples.GetCpuPointer();
-			auto pout = scap->m_samples.GetCpuPointer();
+			validLen = scap->size();
 
-			for(size_t i=0; i<len; i++)
-				pout[i] = pout[i]*decay + pin[i]*(1-decay);
-		}
+		scap->Resize(len);
+		m_accumulator.Accumulate(cmdBuf, queue, sdin->m_samples, len, validLen, scap->m_samples, nullptr, 0, decay);
 
 		//Either way we want to reuse the timestamps
 		scap->CopyTimestamps(sdin);
@@ -145,25 +135,16 @@ void ExponentialMovingAverageFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/
 	//Uniform path
 	else
 	{
-		//No data? Just copy
 		if(!ucap)
 		{
 			ucap = new UniformAnalogWaveform;
-			ucap->Resize(din->size());
 			cap = ucap;
-
-			ucap->m_samples.CopyFrom(udin->m_samples);
 		}
-
-		//Actual filter code path
 		else
-		{
-			auto pin = udin->m_samples.GetCpuPointer();
-			auto pout = ucap->m_samples.GetCpuPointer();
+			validLen = ucap->size();
 
-			for(size_t i=0; i<len; i++)
-				pout[i] = pout[i]*decay + pin[i]*(1-decay);
-		}
+		ucap->Resize(len);
+		m_accumulator.Accumulate(cmdBuf, queue, udin->m_samples, len, validLen, ucap->m_samples, nullptr, 0, decay);
 	}
 
 	//Update timestamps
@@ -175,7 +156,6 @@ void ExponentialMovingAverageFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/
 
 	//Done
 	SetData(cap, 0);
-	cap->MarkModifiedFromCpu();
 }
 
 Filter::DataLocation ExponentialMovingAverageFilter::GetInputLocation()
@@ -35,6 +35,8 @@
 #ifndef ExponentialMovingAverageFilter_h
 #define ExponentialMovingAverageFilter_h
 
+#include "../scopehal/WaveformAccumulator.h"
+
 class QueueHandle;
 
 class ExponentialMovingAverageFilter : public Filter
@@ -56,6 +58,8 @@ public:
 
 protected:
 	std::string m_halflife;
+
+	WaveformAccumulator m_accumulator;
 };
 
 #endif
@@ -40,6 +40,9 @@ ExportFilter::ExportFilter(const string& color)
 	, m_fname("File name")
 	, m_mode("Update mode")
 	, m_fp(nullptr)
+	, m_writeQueueBytes(0)
+	, m_writerBusy(false)
+	, m_writerTerminate(false)
 {
 	//No output stream
 
@@ -62,15 +65,26 @@ ExportFilter::ExportFilter(const string& color)
 	m_parameters[m_mode].AddEnumValue("Pipe (continuous)", MODE_CONTINUOUS_PIPE);
 	m_parameters[m_mode].AddEnumValue("Pipe (manual)", MODE_MANUAL_PIPE);
 
+	//Exporters may keep the file open between exports in append mode, so reopen it if the mode changes
+	m_parameters[m_mode].signal_changed().connect(sigc::mem_fun(*this, &ExportFilter::OnFileNameChanged));
+
 	//Default to manual trigger mode so we don't have the file grow huge before the user can react
 	m_parameters[m_mode].SetIntVal(MODE_MANUAL_OVERWRITE);
 }
 
 ExportFilter::~ExportFilter()
 {
-	if(m_fp)
-		fclose(m_fp);
-	m_fp = nullptr;
+	CloseFile();
+
+	if(m_writerThread.joinable())
+	{
+		{
+			lock_guard<mutex> lock(m_writeMutex);
+			m_writerTerminate = true;
+		}
+		m_writeQueuedCond.notify_one();
+		m_writerThread.join();
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -78,6 +92,14 @@ ExportFilter::~ExportFilter()
 
 void ExportFilter::Refresh()
 {
+	//Don't write snapshots of acquisitions still in progress (partial VNA sweeps etc), wait for the final data
+	for(size_t i=0; i<GetInputCount(); i++)
+	{
+		auto data = GetInputWaveform(i);
+		if(data && (data->m_flags & WaveformBase::WAVEFORM_PARTIAL))
+			return;
+	}
+
 	auto mode = static_cast<ExportMode_t>(m_parameters[m_mode].GetIntVal());
 	switch(mode)
 	{
@@ -87,7 +109,10 @@ void ExportFilter::Refresh()
 
 		case MODE_CONTINUOUS_APPEND:
 		case MODE_CONTINUOUS_PIPE:
-			Export();
+			{
+				SCOPEHAL_TRACE_SPAN("ExportFilter::Export", "export");
+				Export();
+			}
 
 		//Manual mode - don't do anything during Refresh()
 		case MODE_MANUAL_APPEND:
@@ -110,7 +135,10 @@ bool ExportFilter::PerformAction(const string& id)
 	if(id == "Clear")
 		Clear();
 	if(id == "Export")
+	{
+		SCOPEHAL_TRACE_SPAN("ExportFilter::Export", "export");
 		Export();
+	}
 
 	return false;
 }
@@ -122,9 +150,7 @@ bool ExportFilter::PerformAction(const string& id)
  */
 void ExportFilter::OnFileNameChanged()
 {
-	if(m_fp)
-		fclose(m_fp);
-	m_fp = nullptr;
+	CloseFile();
 }
 
 /**
@@ -133,12 +159,119 @@ void ExportFilter::OnFileNameChanged()
 void ExportFilter::Clear()
 {
 	//Close the file if it was open
-	if(m_fp)
-		fclose(m_fp);
-	m_fp = nullptr;
+	CloseFile();
 
 	//Open and truncate it, but do not keep open (so the next Export() treats the file as not open and writes headers)
 	FILE* ftmp = fopen(m_parameters[m_fname].GetFileName().c_str(), "wb");
 	if(ftmp)
 		fclose(ftmp);
 }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Background writer
+
+/**
+	@brief Queues a block of formatted output to be appended to m_fp by the background writer
+
+	Blocks only if more than WRITE_QUEUE_MAX_BYTES are already waiting, so a slow disk throttles the export rather
+	than letting the backlog grow without bound.
+ */
+void ExportFilter::QueueWrite(string&& block)
+{
+	if(!m_fp || block.empty())
+		return;
+
+	unique_lock<mutex> lock(m_writeMutex);
+
+	if(!m_writerThread.joinable())
+		m_writerThread = thread(&ExportFilter::WriterThread, this);
+
+	m_writeDoneCond.wait(lock, [&]{ return (m_writeQueueBytes == 0) ||
+		(m_writeQueueBytes + block.size() <= WRITE_QUEUE_MAX_BYTES); });
+
+	m_writeQueueBytes += block.size();
+	m_writeQueue.push_back(PendingWrite{m_fp, std::move(block), false});
+	lock.unlock();
+
+	m_writeQueuedCond.notify_one();
+}
+
+/**
+	@brief Hands m_fp over to the background writer, which closes it once everything queued before has been written
+
+	m_fp is null on return, so the next export reopens the file (call FlushWrites() before doing so).
+ */
+void ExportFilter::QueueClose()
+{
+	if(!m_fp)
+		return;
+
+	{
+		lock_guard<mutex> lock(m_writeMutex);
+
+		//Nothing in flight, no need to involve the writer
+		if(m_writeQueue.empty() && !m_writerBusy)
+			fclose(m_fp);
+		else
+			m_writeQueue.push_back(PendingWrite{m_fp, "", true});
+	}
+	m_writeQueuedCond.notify_one();
+
+	m_fp = nullptr;
+}
+
+/**
+	@brief Blocks until everything passed to QueueWrite() has been written out
+ */
+void ExportFilter::FlushWrites()
+{
+	unique_lock<mutex> lock(m_writeMutex);
+	m_writeDoneCond.wait(lock, [&]{ return m_writeQueue.empty() && !m_writerBusy; });
+}
+
+/**
+	@brief Finishes any pending writes and closes the output file, if open
+ */
+void ExportFilter::CloseFile()
+{
+	FlushWrites();
+
+	if(m_fp)
+		fclose(m_fp);
+	m_fp = nullptr;
+}
+
+/**
+	@brief Thread function: writes queued blocks in order, flushing the file whenever the queue runs dry
+ */
+void ExportFilter::WriterThread()
+{
+	#ifdef __linux__
+	pthread_setname_np(pthread_self(), "ExportWriter");
+	#endif
+
+	unique_lock<mutex> lock(m_writeMutex);
+	while(true)
+	{
+		m_writeQueuedCond.wait(lock, [&]{ return m_writerTerminate || !m_writeQueue.empty(); });
+		if(m_writeQueue.empty())
+			break;
+
+		auto block = std::move(m_writeQueue.front());
+		m_writeQueue.pop_front();
+		m_writerBusy = true;
+		lock.unlock();
+
+		if(block.m_close)
+			fclose(block.m_fp);
+		else if(fwrite(block.m_data.data(), 1, block.m_data.size(), block.m_fp) != block.m_data.size())
+			LogError("ExportFilter: failed to write %zu bytes to file\n", block.m_data.size());
+
+		lock.lock();
+		if(!block.m_close && m_writeQueue.empty())
+			fflush(block.m_fp);
+		m_writeQueueBytes -= block.m_data.size();
+		m_writerBusy = false;
+		m_writeDoneCond.notify_all();
+	}
+}
@@ -37,6 +37,9 @@
 
 #include "../scopehal/ActionProvider.h"
 
+#include <condition_variable>
+#include <mutex>
+
 /**
 	@brief Base class for filters providing file-export functionality
  */
@@ -81,6 +84,49 @@ protected:
 	FILE* m_fp;
 
 	void OnFileNameChanged();
+
+	void QueueWrite(std::string&& block);
+	void QueueClose();
+	void FlushWrites();
+	void CloseFile();
+
+	///@brief Maximum number of bytes waiting in the write queue before QueueWrite() blocks
+	static const size_t WRITE_QUEUE_MAX_BYTES = 64 * 1024 * 1024;
+
+private:
+	void WriterThread();
+
+	///@brief A block of formatted output waiting to be written
+	struct PendingWrite
+	{
+		FILE* m_fp;
+		std::string m_data;
+		bool m_close;
+	};
+
+	///@brief Background thread draining m_writeQueue to disk (started on first use)
+	std::thread m_writerThread;
+
+	///@brief Mutex protecting the write queue and writer state
+	std::mutex m_writeMutex;
+
+	///@brief Signaled when a block is queued or the writer should exit
+	std::condition_variable m_writeQueuedCond;
+
+	///@brief Signaled when the writer has finished with a block
+	std::condition_variable m_writeDoneCond;
+
+	///@brief Blocks waiting to be written, in order
+	std::deque<PendingWrite> m_writeQueue;
+
+	///@brief Total size of all blocks in m_writeQueue
+	size_t m_writeQueueBytes;
+
+	///@brief True while the writer is working on a block it has already dequeued
+	bool m_writerBusy;
+
+	///@brief True when the writer thread should exit
+	bool m_writerTerminate;
 };
 
 #endif
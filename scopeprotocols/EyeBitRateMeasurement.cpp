@@ -67,6 +67,12 @@ string EyeBitRateMeasurement::GetProtocolName()
 	return "Eye Bit Rate";
 }
 
+Filter::DataLocation EyeBitRateMeasurement::GetInputLocation()
+{
+	//We only look at metadata of the eye, never the pixels
+	return LOC_DONTCARE;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
@@ -80,7 +86,6 @@ void EyeBitRateMeasurement::Refresh()
 
 	//Get the input data
 	auto din = dynamic_cast<EyeWaveform*>(GetInputWaveform(0));
-	din->PrepareForCpuAccess();
 
 	//Do the actual bit rate calculation
 	m_streams[0].m_value = FS_PER_SECOND / din->m_uiWidth;
@@ -30,6 +30,7 @@
 #include "../scopehal/scopehal.h"
 #include "EyeHeightMeasurement.h"
 #include "EyePattern.h"
+#include "../scopehal/EyeStatistics.h"
 #include <algorithm>
 
 using namespace std;
@@ -91,7 +92,9 @@ Filter::DataLocation EyeHeightMeasurement::GetInputLocation()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
-void EyeHeightMeasurement::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
+void EyeHeightMeasurement::Refresh(
+	[[maybe_unused]] vk::raii::CommandBuffer& cmdBuf,
+	[[maybe_unused]] shared_ptr<QueueHandle> queue)
 {
 	if(!VerifyAllInputsOK(true))
 	{
@@ -105,11 +108,7 @@ void EyeHeightMeasurement::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<Q
 
 	//Create the output
 	auto cap = SetupEmptySparseAnalogOutputWaveform(din, 0);
-	cmdBuf.begin({});
-	din->GetOutData().PrepareForCpuAccessNonblocking(cmdBuf);
 	cap->PrepareForCpuAccess();
-	cmdBuf.end();
-	queue->SubmitAndBlock(cmdBuf);
 	cap->m_timescale = 1;
 
 	//Make sure times are in the right order
@@ -130,8 +129,8 @@ void EyeHeightMeasurement::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<Q
 	//Find start/end time bins
 	size_t start_bin = round((tstart + din->m_uiWidth) / fs_per_bin);
 	size_t end_bin = round((tend + din->m_uiWidth) / fs_per_bin);
-	start_bin = min(start_bin, din->GetWidth());
-	end_bin = min(end_bin, din->GetWidth());
+	start_bin = min(start_bin, din->GetWidth()-1);
+	end_bin = min(end_bin, din->GetWidth()-1);
 
 	//Approximate center of the eye opening
 	float vrange = m_inputs[0].GetVoltageRange();
@@ -142,26 +141,15 @@ void EyeHeightMeasurement::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<Q
 	size_t mid_bin = round( (vmid - volts_at_bottom) / volts_per_row);
 	mid_bin = min(mid_bin, din->GetHeight()-1);
 
-	float* data = din->GetData();
-	int64_t w = din->GetWidth();
-	float ber_max = FLT_EPSILON;
+	//Search the hit bitmap rather than reading back the whole eye
+	auto stats = EyeStatistics::Get(din);
 	float minheight = FLT_MAX;
 	for(size_t x = start_bin; x <= end_bin; x ++)
 	{
 		//Search up and down from the midpoint to find the edges of the eye opening
-		size_t top_bin = mid_bin;
-		for(; top_bin < height; top_bin ++)
-		{
-			if(data[top_bin*w + x] > ber_max)
-				break;
-		}
-
-		size_t bot_bin = mid_bin;
-		for(; bot_bin > 0; bot_bin --)
-		{
-			if(data[bot_bin*w + x] > ber_max)
-				break;
-		}
+		size_t top_bin;
+		size_t bot_bin;
+		stats->GetColumnOpening(x, mid_bin, bot_bin, top_bin);
 
 		//Convert from eye bins to volts
 		size_t height_bins = top_bin - bot_bin;
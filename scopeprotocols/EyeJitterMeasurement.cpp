@@ -30,6 +30,7 @@
 #include "../scopehal/scopehal.h"
 #include "EyeJitterMeasurement.h"
 #include "EyePattern.h"
+#include "../scopehal/EyeStatistics.h"
 #include <algorithm>
 
 using namespace std;
@@ -78,6 +79,12 @@ string EyeJitterMeasurement::GetProtocolName()
 	return "Eye P-P Jitter";
 }
 
+Filter::DataLocation EyeJitterMeasurement::GetInputLocation()
+{
+	//We explicitly manage our input memory and don't care where it is when Refresh() is called
+	return LOC_DONTCARE;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
@@ -95,7 +102,6 @@ void EyeJitterMeasurement::Refresh()
 
 	//Create the output
 	auto cap = SetupEmptySparseAnalogOutputWaveform(din, 0);
-	din->PrepareForCpuAccess();
 	cap->PrepareForCpuAccess();
 	cap->m_timescale = 1;
 
@@ -121,41 +127,20 @@ void EyeJitterMeasurement::Refresh()
 	float duration_mv = volts_per_row * 1000;
 	float base_mv = volts_at_bottom * 1000;
 
-	float* data = din->GetData();
+	//Search the hit bitmap rather than reading back the whole eye
+	auto stats = EyeStatistics::Get(din);
 	int64_t w = din->GetWidth();
-	int64_t xcenter = w / 2;
-	float ber_max = FLT_EPSILON;
 	double width_fs = 2 * din->m_uiWidth;
 	double fs_per_pixel = width_fs / w;
 	int64_t jitter_pp = 0;
 	for(size_t i=start_bin; i <= end_bin; i++)
 	{
-		float* row = data + i*w;
-
-		int64_t cleft = 0;		//left side of eye opening
-		int64_t cright = w-1;	//right side of eye opening
-		int64_t left = cright;	//left side of eye edge
-		int64_t right = cleft;	//right side of eye edge
-
 		//Find the edges of the eye in this scanline
-		for(int64_t dx = 0; dx < xcenter; dx ++)
-		{
-			//left of center
-			int64_t x = xcenter - dx;
-			if(row[x] > ber_max)
-			{
-				cleft = max(cleft, x);
-				left = min(left, x);
-			}
-
-			//right of center
-			x = xcenter + dx;
-			if(row[x] > ber_max)
-			{
-				cright = min(cright, x);
-				right = max(right, x);
-			}
-		}
+		int64_t cleft;		//left side of eye opening
+		int64_t cright;		//right side of eye opening
+		int64_t left;		//left side of eye edge
+		int64_t right;		//right side of eye edge
+		stats->GetRowEdges(i, cleft, cright, left, right);
 
 		int64_t jitter_left = cleft - left;
 		int64_t jitter_right = cright - right;
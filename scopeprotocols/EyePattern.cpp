@@ -62,6 +62,12 @@ EyePattern::EyePattern(const string& color)
 	, m_numLevelsName("Modulation Levels")
 	, m_clockEdges("EyePattern.clockEdges")
 	, m_indexBuffer("EyePattern.indexBuffer")
+	, m_privateAccum("EyePattern.privateAccum")
+	, m_maskHitsBuf("EyePattern.maskHitsBuf")
+	, m_maskFailingUIsBuf("EyePattern.maskFailingUIsBuf")
+	, m_maskHitsValid(false)
+	, m_maskHitsRevision(0)
+	, m_maskHitsUpdated(false)
 {
 	AddStream(Unit(Unit::UNIT_COUNTS), "data", Stream::STREAM_TYPE_EYE);
 	AddStream(Unit(Unit::UNIT_RATIO_SCI), "hitrate", Stream::STREAM_TYPE_ANALOG_SCALAR);
@@ -121,10 +127,25 @@ EyePattern::EyePattern(const string& color)
 			make_shared<ComputePipeline>("shaders/EyeNormalizeScale.spv", 3, sizeof(EyeNormalizeConstants));
 		m_eyeIndexSearchPipeline =
 			make_shared<ComputePipeline>("shaders/EyePattern_IndexSearch.spv", 2, sizeof(EyeIndexConstants));
+		m_eyeTiledComputePipeline =
+			make_shared<ComputePipeline>("shaders/EyePattern_Tiled.spv", 7, sizeof(EyeFilterConstants));
+		m_eyeMergeComputePipeline =
+			make_shared<ComputePipeline>("shaders/EyePattern_Merge.spv", 2, sizeof(EyeMergeConstants));
 	}
 
 	m_indexBuffer.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
 
+	m_privateAccum.SetCpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_UNLIKELY);
+	m_privateAccum.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+
+	m_maskHitsBuf.SetCpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
+	m_maskHitsBuf.SetGpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
+	m_maskHitsBuf.resize(1 + EyeMask::MAX_POLYGONS);
+
+	m_maskFailingUIsBuf.SetCpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+	m_maskFailingUIsBuf.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+	m_maskFailingUIsBuf.resize(1 + MAX_FAILING_UIS);
+
 	m_normalizeMaxBuf.SetGpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
 	m_normalizeMaxBuf.resize(1);
 
@@ -331,6 +352,13 @@ void EyePattern::Refresh(
 	//All of the eye creation logic assumes a center aligned clock.
 	if(clock_align == ALIGN_EDGE)
 	{
+		//Never shift a CDR's output in place, we don't own it
+		if(m_clockEdgesMuxed != &m_clockEdges)
+		{
+			m_clockEdges.CopyFrom(*m_clockEdgesMuxed);
+			m_clockEdgesMuxed = &m_clockEdges;
+		}
+
 		m_clockEdgesMuxed->PrepareForCpuAccess();
 		for(size_t i=0; i<m_clockEdgesMuxed->size(); i++)
 			(*m_clockEdgesMuxed)[i] += cap->m_uiWidth / 2;
@@ -348,6 +376,17 @@ void EyePattern::Refresh(
 	float yoff = -center*yscale + ymid;
 	float xtimescale = waveform->m_timescale * m_xscale;
 
+	//Render the mask at the current scale before integrating, so the GPU can count hits as it goes.
+	//Any change to the raster invalidates the running hit count.
+	bool hasMask = (m_mask.GetFileName() != "");
+	if(hasMask)
+	{
+		m_mask.Rasterize(cap, m_width, m_height, GetVoltageRange(0), m_xscale, m_xoff);
+		if(m_mask.GetRasterRevision() != m_maskHitsRevision)
+			m_maskHitsValid = false;
+	}
+	m_maskHitsUpdated = false;
+
 	//Process the eye
 	size_t cend = m_clockEdgesMuxed->size() - 1;
 	size_t wend = waveform->size()-1;
@@ -1054,26 +1093,117 @@ void EyePattern::DensePackedInnerLoopGPU(
 	cfg.xscale = m_xscale;
 	cfg.mwidth = m_width;
 
-	//Allocate and fill index buffer
-	EyeIndexConstants indexCfg;
-	indexCfg.timescale = waveform->m_timescale;
-	indexCfg.triggerPhase = waveform->m_triggerPhase;
-	indexCfg.len = m_clockEdgesMuxed->size();
-	indexCfg.numSamplesPerThread = numSamplesPerThread;
-
-	m_indexBuffer.resize(numThreads);
-	m_eyeIndexSearchPipeline->BindBufferNonblocking(0, *m_clockEdgesMuxed, cmdBuf);
-	m_eyeIndexSearchPipeline->BindBufferNonblocking(1, m_indexBuffer, cmdBuf);
-	m_eyeIndexSearchPipeline->Dispatch(cmdBuf, indexCfg, GetComputeBlockCount(numThreads, threadsPerBlock));
-	m_eyeIndexSearchPipeline->AddComputeMemoryBarrier(cmdBuf);
-	m_indexBuffer.MarkModifiedFromGpu();
-
-	//Run the main integration kernel
-	m_eyeComputePipeline->BindBufferNonblocking(0, *m_clockEdgesMuxed, cmdBuf);
-	m_eyeComputePipeline->BindBufferNonblocking(1, waveform->m_samples, cmdBuf);
-	m_eyeComputePipeline->BindBufferNonblocking(2, data, cmdBuf);
-	m_eyeComputePipeline->BindBufferNonblocking(3, m_indexBuffer, cmdBuf);
-	m_eyeComputePipeline->Dispatch(cmdBuf, cfg, GetComputeBlockCount(numThreads, threadsPerBlock));
+	//Allocate and fill index buffer, unless the clock edges and data timebase are the same as last time
+	EyeIndexCacheKey key;
+	key.m_clock = WaveformCacheKey(GetInputWaveform(1));
+	key.m_polarity = m_parameters[m_polarityName].GetIntVal();
+	key.m_align = m_lastClockAlign;
+	key.m_uiWidth = cap->m_uiWidth;
+	key.m_timescale = waveform->m_timescale;
+	key.m_triggerPhase = waveform->m_triggerPhase;
+	key.m_len = wend;
+	if( !(key == m_indexKey) || (m_indexBuffer.size() != numThreads) )
+	{
+		EyeIndexConstants indexCfg;
+		indexCfg.timescale = waveform->m_timescale;
+		indexCfg.triggerPhase = waveform->m_triggerPhase;
+		indexCfg.len = m_clockEdgesMuxed->size();
+		indexCfg.numSamplesPerThread = numSamplesPerThread;
+
+		m_indexBuffer.resize(numThreads);
+		m_eyeIndexSearchPipeline->BindBufferNonblocking(0, *m_clockEdgesMuxed, cmdBuf);
+		m_eyeIndexSearchPipeline->BindBufferNonblocking(1, m_indexBuffer, cmdBuf);
+		m_eyeIndexSearchPipeline->Dispatch(cmdBuf, indexCfg, GetComputeBlockCount(numThreads, threadsPerBlock));
+		m_eyeIndexSearchPipeline->AddComputeMemoryBarrier(cmdBuf);
+		m_indexBuffer.MarkModifiedFromGpu();
+		m_indexKey = key;
+	}
+
+	//Spread the integration across several 32-bit copies of the eye to cut down on atomic contention.
+	//Use fewer copies for very large eyes, and fall back to integrating straight into the 64-bit
+	//accumulator if a single copy could overflow.
+	uint32_t gridSize = m_width * m_height;
+	uint32_t numCopies = 8;
+	const size_t maxPrivateBytes = 64 * 1024 * 1024;
+	while( (numCopies > 1) && (numCopies * gridSize * sizeof(uint32_t) > maxPrivateBytes) )
+		numCopies /= 2;
+	uint64_t maxPerCopy = ( (wend + 1) / numCopies + numThreads) * EYE_ACCUM_SCALE;
+	bool tiled = (maxPerCopy < UINT32_MAX);
+
+	if(tiled)
+	{
+		//(Re)allocate the private copies if needed. The merge pass leaves them zeroed, so we only have to clear
+		//them when they're freshly allocated.
+		size_t privateSize = numCopies * gridSize;
+		if(m_privateAccum.size() != privateSize)
+		{
+			m_privateAccum.resize(privateSize);
+			m_privateAccum.PrepareForCpuAccess();
+			memset(m_privateAccum.GetCpuPointer(), 0, privateSize * sizeof(uint32_t));
+			m_privateAccum.MarkModifiedFromCpu();
+		}
+
+		//Count mask hits as we go, if the running total is in sync with the eye.
+		//If not, DoMaskTest() will recount on the CPU and reseed it.
+		//(the per-workgroup hit counter is 32 bits, so skip this for huge waveforms)
+		auto& weights = m_mask.GetWeightBuffer();
+		uint64_t maxHitsPerBlock = uint64_t(numSamplesPerThread + numThreads) * 2 * EYE_ACCUM_SCALE * threadsPerBlock;
+		bool maskEnabled = m_maskHitsValid && (weights.size() == gridSize) && (maxHitsPerBlock < UINT32_MAX);
+
+		cfg.gridSize = gridSize;
+		cfg.numCopies = numCopies;
+		cfg.maskEnabled = maskEnabled;
+		cfg.maxFailingUIs = MAX_FAILING_UIS;
+
+		//Failing UIs are only reported for this waveform, so start the list over
+		if(maskEnabled)
+		{
+			m_maskFailingUIsBuf.PrepareForCpuAccess();
+			m_maskFailingUIsBuf[0] = 0;
+			m_maskFailingUIsBuf.MarkModifiedFromCpu();
+		}
+
+		//Run the main integration kernel
+		//(bind the index buffer as a dummy weight buffer if we're not doing a mask test, it's never read)
+		m_eyeTiledComputePipeline->BindBufferNonblocking(0, *m_clockEdgesMuxed, cmdBuf);
+		m_eyeTiledComputePipeline->BindBufferNonblocking(1, waveform->m_samples, cmdBuf);
+		m_eyeTiledComputePipeline->BindBufferNonblocking(2, m_privateAccum, cmdBuf);
+		m_eyeTiledComputePipeline->BindBufferNonblocking(3, m_indexBuffer, cmdBuf);
+		if(maskEnabled)
+			m_eyeTiledComputePipeline->BindBufferNonblocking(4, weights, cmdBuf);
+		else
+			m_eyeTiledComputePipeline->BindBufferNonblocking(4, m_indexBuffer, cmdBuf);
+		m_eyeTiledComputePipeline->BindBufferNonblocking(5, m_maskHitsBuf, cmdBuf);
+		m_eyeTiledComputePipeline->BindBufferNonblocking(6, m_maskFailingUIsBuf, cmdBuf);
+		m_eyeTiledComputePipeline->Dispatch(cmdBuf, cfg, GetComputeBlockCount(numThreads, threadsPerBlock));
+		m_eyeTiledComputePipeline->AddComputeMemoryBarrier(cmdBuf);
+
+		//Merge the copies into the accumulator
+		EyeMergeConstants mergeCfg;
+		mergeCfg.gridSize = gridSize;
+		mergeCfg.numCopies = numCopies;
+
+		const uint32_t compute_block_count = GetComputeBlockCount(gridSize, threadsPerBlock);
+		m_eyeMergeComputePipeline->BindBufferNonblocking(0, m_privateAccum, cmdBuf);
+		m_eyeMergeComputePipeline->BindBufferNonblocking(1, data, cmdBuf);
+		m_eyeMergeComputePipeline->Dispatch(cmdBuf, mergeCfg,
+			min(compute_block_count, 32768u),
+			compute_block_count / 32768 + 1);
+
+		m_privateAccum.MarkModifiedFromGpu();
+		m_maskHitsBuf.MarkModifiedFromGpu();
+		m_maskFailingUIsBuf.MarkModifiedFromGpu();
+		m_maskHitsUpdated = maskEnabled;
+	}
+	else
+	{
+		//Run the main integration kernel
+		m_eyeComputePipeline->BindBufferNonblocking(0, *m_clockEdgesMuxed, cmdBuf);
+		m_eyeComputePipeline->BindBufferNonblocking(1, waveform->m_samples, cmdBuf);
+		m_eyeComputePipeline->BindBufferNonblocking(2, data, cmdBuf);
+		m_eyeComputePipeline->BindBufferNonblocking(3, m_indexBuffer, cmdBuf);
+		m_eyeComputePipeline->Dispatch(cmdBuf, cfg, GetComputeBlockCount(numThreads, threadsPerBlock));
+	}
 	cmdBuf.end();
 	queue->SubmitAndBlock(cmdBuf);
 
@@ -1245,6 +1375,7 @@ EyeWaveform* EyePattern::ReallocateWaveform()
 	auto cap = new EyeWaveform(m_width, m_height, m_parameters[m_centerName].GetFloatVal(), EyeWaveform::EYE_NORMAL);
 	cap->m_timescale = 1;
 	SetData(cap, 0);
+	m_maskHitsValid = false;
 	return cap;
 }
 
@@ -1289,13 +1420,47 @@ void EyePattern::RecalculateUIWidth(EyeWaveform* cap)
  */
 void EyePattern::DoMaskTest(EyeWaveform* cap)
 {
-	auto rate = m_mask.CalculateHitRate(
-		cap,
-		m_width,
-		m_height,
-		GetVoltageRange(0),
-		m_xscale,
-		m_xoff);
+	//If the integration kernel kept the running hit counts up to date, we just need to read them back
+	cap->m_maskFailingUIs.clear();
+	if(m_maskHitsUpdated)
+	{
+		m_maskHitsBuf.PrepareForCpuAccess();
+
+		//The kernel also logged which UIs hit the mask (possibly several times each, in no particular order)
+		m_maskFailingUIsBuf.PrepareForCpuAccess();
+		m_clockEdgesMuxed->PrepareForCpuAccess();
+		size_t nfail = min(m_maskFailingUIsBuf[0], static_cast<uint32_t>(MAX_FAILING_UIS));
+		for(size_t i=0; i<nfail; i++)
+			cap->m_maskFailingUIs.push_back((*m_clockEdgesMuxed)[m_maskFailingUIsBuf[i+1]]);
+		sort(cap->m_maskFailingUIs.begin(), cap->m_maskFailingUIs.end());
+		cap->m_maskFailingUIs.erase(
+			unique(cap->m_maskFailingUIs.begin(), cap->m_maskFailingUIs.end()),
+			cap->m_maskFailingUIs.end());
+	}
+
+	//Otherwise, count on the CPU and reseed the GPU totals so the next pass can count incrementally
+	else
+	{
+		m_mask.Rasterize(cap, m_width, m_height, GetVoltageRange(0), m_xscale, m_xoff);
+		vector<int64_t> polygonHits;
+		auto nhits = m_mask.CountHits(cap, &polygonHits);
+
+		m_maskHitsBuf.PrepareForCpuAccess();
+		m_maskHitsBuf[0] = nhits;
+		for(size_t i=0; i<EyeMask::MAX_POLYGONS; i++)
+			m_maskHitsBuf[i+1] = polygonHits[i];
+		m_maskHitsBuf.MarkModifiedFromCpu();
+		m_maskHitsValid = true;
+		m_maskHitsRevision = m_mask.GetRasterRevision();
+	}
+
+	double scale = 1.0 / (cap->GetTotalSamples() * EYE_ACCUM_SCALE);
+	float rate = m_maskHitsBuf[0] * scale;
+
+	size_t npoly = min(m_mask.GetPolygons().size(), static_cast<size_t>(EyeMask::MAX_POLYGONS));
+	cap->m_maskPolygonHitRates.resize(npoly);
+	for(size_t i=0; i<npoly; i++)
+		cap->m_maskPolygonHitRates[i] = m_maskHitsBuf[i+1] * scale;
 
 	m_streams[1].m_value = rate;
 	cap->SetMaskHitRate(rate);
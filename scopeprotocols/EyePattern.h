@@ -48,6 +48,59 @@ public:
 	uint32_t	numSamplesPerThread;
 };
 
+/**
+	@brief Everything the clock edge index buffer of an EyePattern depends on
+
+	The index search only looks at clock edge timestamps and the timebase of the data waveform, never at sample values,
+	so a new data waveform on the same timebase against the same clock reuses the previous result.
+ */
+class EyeIndexCacheKey
+{
+public:
+	EyeIndexCacheKey()
+	: m_polarity(0)
+	, m_align(0)
+	, m_uiWidth(0)
+	, m_timescale(0)
+	, m_triggerPhase(0)
+	, m_len(0)
+	{}
+
+	bool operator==(const EyeIndexCacheKey& rhs) const
+	{
+		return
+			(m_clock.m_wfm == rhs.m_clock.m_wfm) &&
+			(m_clock.m_rev == rhs.m_clock.m_rev) &&
+			(m_polarity == rhs.m_polarity) &&
+			(m_align == rhs.m_align) &&
+			(m_uiWidth == rhs.m_uiWidth) &&
+			(m_timescale == rhs.m_timescale) &&
+			(m_triggerPhase == rhs.m_triggerPhase) &&
+			(m_len == rhs.m_len);
+	}
+
+	///@brief The clock waveform edges were found in
+	WaveformCacheKey m_clock;
+
+	///@brief Clock edge polarity
+	int64_t m_polarity;
+
+	///@brief Clock alignment
+	int64_t m_align;
+
+	///@brief UI width edges were shifted by, if edge aligned
+	float m_uiWidth;
+
+	///@brief Timescale of the data waveform
+	int64_t m_timescale;
+
+	///@brief Trigger phase of the data waveform
+	int64_t m_triggerPhase;
+
+	///@brief Length of the data waveform
+	size_t m_len;
+};
+
 class EyeFilterConstants
 {
 public:
@@ -65,6 +118,19 @@ public:
 	float		yscale;
 	float		yoff;
 	float		xscale;
+
+	//only used by EyePattern_Tiled
+	uint32_t	gridSize;
+	uint32_t	numCopies;
+	uint32_t	maskEnabled;
+	uint32_t	maxFailingUIs;
+};
+
+class EyeMergeConstants
+{
+public:
+	uint32_t	gridSize;
+	uint32_t	numCopies;
 };
 
 class EyePattern : public Filter
@@ -250,13 +316,39 @@ protected:
 	AcceleratorBuffer<int64_t> m_clockEdges;
 	AcceleratorBuffer<uint32_t> m_indexBuffer;
 
+	///@brief Inputs m_indexBuffer was last computed from
+	EyeIndexCacheKey m_indexKey;
+
 	AcceleratorBuffer<int64_t>* m_clockEdgesMuxed;
 	AcceleratorBuffer<int64_t> m_normalizeMaxBuf;
 
+	///@brief Privatized 32-bit copies of the eye used by the tiled integration kernel (always zero between calls)
+	AcceleratorBuffer<uint32_t> m_privateAccum;
+
+	///@brief Running total of mask hits computed by the tiled integration kernel, then the total for each polygon
+	AcceleratorBuffer<int64_t> m_maskHitsBuf;
+
+	///@brief Number of UIs hitting the mask recorded per integration pass
+	static const uint32_t MAX_FAILING_UIS = 1024;
+
+	///@brief Count (first element) and clock edge indexes of UIs hitting the mask in the last integration pass
+	AcceleratorBuffer<uint32_t> m_maskFailingUIsBuf;
+
+	///@brief True if m_maskHitsBuf is in sync with the current eye and mask raster
+	bool m_maskHitsValid;
+
+	///@brief Raster revision of the mask m_maskHitsBuf was counted against
+	uint64_t m_maskHitsRevision;
+
+	///@brief True if the last integration pass updated m_maskHitsBuf
+	bool m_maskHitsUpdated;
+
 	std::shared_ptr<ComputePipeline> m_eyeComputePipeline;
 	std::shared_ptr<ComputePipeline> m_eyeNormalizeReduceComputePipeline;
 	std::shared_ptr<ComputePipeline> m_eyeNormalizeScaleComputePipeline;
 	std::shared_ptr<ComputePipeline> m_eyeIndexSearchPipeline;
+	std::shared_ptr<ComputePipeline> m_eyeTiledComputePipeline;
+	std::shared_ptr<ComputePipeline> m_eyeMergeComputePipeline;
 };
 
 #endif
@@ -41,6 +41,7 @@ public:
 	EyePeriodMeasurement(const std::string& color);
 
 	virtual void Refresh() override;
+	virtual DataLocation GetInputLocation() override;
 
 	static std::string GetProtocolName();
 
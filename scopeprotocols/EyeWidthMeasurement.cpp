@@ -30,6 +30,7 @@
 #include "../scopehal/scopehal.h"
 #include "EyeWidthMeasurement.h"
 #include "EyePattern.h"
+#include "../scopehal/EyeStatistics.h"
 #include <algorithm>
 
 using namespace std;
@@ -87,7 +88,9 @@ Filter::DataLocation EyeWidthMeasurement::GetInputLocation()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
-void EyeWidthMeasurement::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
+void EyeWidthMeasurement::Refresh(
+	[[maybe_unused]] vk::raii::CommandBuffer& cmdBuf,
+	[[maybe_unused]] shared_ptr<QueueHandle> queue)
 {
 	if(!VerifyAllInputsOK(true))
 	{
@@ -101,10 +104,7 @@ void EyeWidthMeasurement::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<Qu
 
 	//Create the output
 	auto cap = SetupEmptySparseAnalogOutputWaveform(din, 0);
-	cmdBuf.begin({});
-	din->GetAccumBuffer().PrepareForCpuAccessNonblocking(cmdBuf);
-	cmdBuf.end();
-	queue->SubmitAndBlock(cmdBuf);
+	cap->PrepareForCpuAccess();
 	cap->m_timescale = 1;
 
 	//Make sure voltages are in the right order
@@ -129,34 +129,21 @@ void EyeWidthMeasurement::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<Qu
 	float duration_mv = volts_per_row * 1000;
 	float base_mv = volts_at_bottom * 1000;
 
-	float* data = din->GetData();
+	//Search the hit bitmap rather than reading back the whole eye
+	auto stats = EyeStatistics::Get(din);
 	int64_t w = din->GetWidth();
-	int64_t xcenter = w / 2;
-	float ber_max = FLT_EPSILON;
 	double width_fs = 2 * din->m_uiWidth;
 	double fs_per_pixel = width_fs / w;
 	int64_t far_left = INT64_MAX;
 	int64_t far_right = INT64_MIN;
 	for(size_t i=start_bin; i <= end_bin; i++)
 	{
-		float* row = data + i*w;
-
-		int64_t cleft = 0;		//left side of eye opening
-		int64_t cright = w-1;	//right side of eye opening
-
 		//Find the edges of the eye in this scanline
-		for(int64_t dx = 0; dx < xcenter; dx ++)
-		{
-			//left of center
-			int64_t x = xcenter - dx;
-			if(row[x] > ber_max)
-				cleft = max(cleft, x);
-
-			//right of center
-			x = xcenter + dx;
-			if(row[x] > ber_max)
-				cright = min(cright, x);
-		}
+		int64_t cleft;		//left side of eye opening
+		int64_t cright;		//right side of eye opening
+		int64_t left;
+		int64_t right;
+		stats->GetRowEdges(i, cleft, cright, left, right);
 
 		far_left = min(far_left, cleft);
 		far_right = max(far_right, cright);
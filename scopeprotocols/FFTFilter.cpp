@@ -33,6 +33,9 @@
 
 using namespace std;
 
+///@brief Workgroup size of the fused window/magnitude shader
+static const uint32_t WINDOWED_MAGNITUDE_BLOCK_SIZE = 64;
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Construction / destruction
 
@@ -45,6 +48,23 @@ FFTFilter::FFTFilter(const string& color)
 	, m_complexToMagnitudeComputePipeline("shaders/ComplexToMagnitude.spv", 2, sizeof(ComplexToMagnitudeArgs))
 	, m_complexToLogMagnitudeComputePipeline("shaders/ComplexToLogMagnitude.spv", 2, sizeof(ComplexToMagnitudeArgs))
 {
+	//Specialize the fused window/magnitude shader for each window shape and output scale,
+	//so the unused window terms and output path are compiled out
+	const uint32_t cosineTerms[3] = {0, 1, 3};
+	for(size_t i=0; i<3; i++)
+	{
+		for(size_t j=0; j<2; j++)
+		{
+			m_windowedMagnitudeComputePipelines[i][j] = make_unique<ComputePipeline>(
+				"shaders/FFTWindowedMagnitude.spv",
+				2,
+				sizeof(FFTWindowedMagnitudeArgs),
+				0,
+				0,
+				vector<uint32_t>{cosineTerms[i], static_cast<uint32_t>(j), WINDOWED_MAGNITUDE_BLOCK_SIZE});
+		}
+	}
+
 	m_xAxisUnit = Unit(Unit::UNIT_MICROHZ);
 	AddStream(Unit(Unit::UNIT_DBM), "data", Stream::STREAM_TYPE_ANALOG);
 
@@ -129,20 +149,11 @@ void FFTFilter::ReallocateBuffers(size_t npoints_raw, size_t npoints, size_t nou
 	if(m_cachedNumPointsFFT != npoints)
 		m_cachedNumPointsFFT = npoints;
 
-	//Update our FFT plan if it's out of date
 	m_rdinbuf.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_NEVER);
 	m_rdinbuf.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
 	m_rdoutbuf.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_NEVER);
 	m_rdoutbuf.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
 
-	if(m_vkPlan)
-	{
-		if(m_vkPlan->size() != npoints)
-			m_vkPlan = nullptr;
-	}
-	if(!m_vkPlan)
-		m_vkPlan = make_unique<VulkanFFTPlan>(npoints, nouts, VulkanFFTPlan::DIRECTION_FORWARD);
-
 	m_rdinbuf.resize(npoints);
 	m_rdoutbuf.resize(2*nouts);
 }
@@ -253,57 +264,120 @@ void FFTFilter::DoRefresh(
 	}
 	args.alpha1 = 1 - args.alpha0;
 
-	//Prepare to do all of our compute stuff in one dispatch call to reduce overhead
-	cmdBuf.begin({});
+	//Borrow a plan from the shared cache for the duration of this refresh.
+	//Once we're done, other FFT filters of the same size can reuse it rather than making their own
+	auto plan = g_fftPlanCache->Acquire(npoints, nouts, VulkanFFTPlan::DIRECTION_FORWARD);
 
-	//Apply the window function
-	ComputePipeline* wpipe = nullptr;
-	switch(window)
+	//Output scaling for the magnitude pass
+	float magScale = scale;
+	if(log_output)
 	{
-		case WINDOW_BLACKMAN_HARRIS:
-			wpipe = &m_blackmanHarrisComputePipeline;
-			break;
+		const float impedance = 50;
+		magScale = scale * scale / impedance;
+	}
 
-		case WINDOW_HANN:
-		case WINDOW_HAMMING:
-			wpipe = &m_cosineSumComputePipeline;
-			break;
+	//Prepare to do all of our compute stuff in one dispatch call to reduce overhead
+	cmdBuf.begin({});
 
-		default:
-		case WINDOW_RECTANGULAR:
-			wpipe = &m_rectangularComputePipeline;
-			break;
-	}
-	wpipe->BindBufferNonblocking(0, data, cmdBuf);
-	wpipe->BindBufferNonblocking(1, m_rdinbuf, cmdBuf, true);
-	const uint32_t compute_block_count = GetComputeBlockCount(npoints, 64);
-	wpipe->Dispatch(cmdBuf, args,
-		min(compute_block_count, 32768u),
-		compute_block_count / 32768 + 1);
-	wpipe->AddComputeMemoryBarrier(cmdBuf);
-	m_rdinbuf.MarkModifiedFromGpu();
-
-	//Do the actual FFT operation
-	m_vkPlan->AppendForward(m_rdinbuf, m_rdoutbuf, cmdBuf);
-
-	//Convert complex to real
-	ComputePipeline& pipe = log_output ?
-		m_complexToLogMagnitudeComputePipeline : m_complexToMagnitudeComputePipeline;
-	ComplexToMagnitudeArgs cargs;
-	cargs.npoints = nouts;
-	if(log_output)
+	//If we're not zero padding, FFT the input in place and apply the window in the frequency domain as part of the
+	//magnitude pass. This saves a full read and write of the input compared to a separate window pass.
+	if(data.size() >= npoints)
 	{
-		const float impedance = 50;
-		cargs.scale = scale * scale / impedance;
+		plan->AppendForward(data, m_rdoutbuf, cmdBuf);
+
+		FFTWindowedMagnitudeArgs fargs;
+		fargs.nouts = nouts;
+		fargs.npoints = npoints;
+		fargs.scale = magScale;
+		fargs.harmonic1 = 1;
+		fargs.harmonic2 = 2;
+		fargs.harmonic3 = 6;
+		size_t shape = 0;
+		switch(window)
+		{
+			case WINDOW_BLACKMAN_HARRIS:
+				fargs.alpha0 = 0.35875;
+				fargs.alpha1 = -0.48829;
+				fargs.alpha2 = 0.14128;
+				fargs.alpha3 = -0.01168;
+				shape = 2;
+				break;
+
+			case WINDOW_HANN:
+			case WINDOW_HAMMING:
+				fargs.alpha0 = args.alpha0;
+				fargs.alpha1 = -args.alpha1;
+				fargs.alpha2 = 0;
+				fargs.alpha3 = 0;
+				shape = 1;
+				break;
+
+			default:
+			case WINDOW_RECTANGULAR:
+				fargs.alpha0 = 1;
+				fargs.alpha1 = 0;
+				fargs.alpha2 = 0;
+				fargs.alpha3 = 0;
+				shape = 0;
+				break;
+		}
+
+		auto& mpipe = m_windowedMagnitudeComputePipelines[shape][log_output ? 1 : 0];
+		const uint32_t compute_block_count = GetComputeBlockCount(nouts, WINDOWED_MAGNITUDE_BLOCK_SIZE);
+		mpipe->BindBufferNonblocking(0, m_rdoutbuf, cmdBuf);
+		mpipe->BindBufferNonblocking(1, cap->m_samples, cmdBuf, true);
+		mpipe->AddComputeMemoryBarrier(cmdBuf);
+		mpipe->Dispatch(cmdBuf, fargs,
+			min(compute_block_count, 32768u),
+			compute_block_count / 32768 + 1);
 	}
+
+	//Zero padding, so we have to window in the time domain
 	else
-		cargs.scale = scale;
-	pipe.BindBuffer(0, m_rdoutbuf);
-	pipe.BindBuffer(1, cap->m_samples);
-	pipe.AddComputeMemoryBarrier(cmdBuf);
-	pipe.Dispatch(cmdBuf, cargs,
-		min(compute_block_count, 32768u),
-		compute_block_count / 32768 + 1);
+	{
+		//Apply the window function
+		ComputePipeline* wpipe = nullptr;
+		switch(window)
+		{
+			case WINDOW_BLACKMAN_HARRIS:
+				wpipe = &m_blackmanHarrisComputePipeline;
+				break;
+
+			case WINDOW_HANN:
+			case WINDOW_HAMMING:
+				wpipe = &m_cosineSumComputePipeline;
+				break;
+
+			default:
+			case WINDOW_RECTANGULAR:
+				wpipe = &m_rectangularComputePipeline;
+				break;
+		}
+		wpipe->BindBufferNonblocking(0, data, cmdBuf);
+		wpipe->BindBufferNonblocking(1, m_rdinbuf, cmdBuf, true);
+		const uint32_t compute_block_count = GetComputeBlockCount(npoints, 64);
+		wpipe->Dispatch(cmdBuf, args,
+			min(compute_block_count, 32768u),
+			compute_block_count / 32768 + 1);
+		wpipe->AddComputeMemoryBarrier(cmdBuf);
+		m_rdinbuf.MarkModifiedFromGpu();
+
+		//Do the actual FFT operation
+		plan->AppendForward(m_rdinbuf, m_rdoutbuf, cmdBuf);
+
+		//Convert complex to real
+		ComputePipeline& pipe = log_output ?
+			m_complexToLogMagnitudeComputePipeline : m_complexToMagnitudeComputePipeline;
+		ComplexToMagnitudeArgs cargs;
+		cargs.npoints = nouts;
+		cargs.scale = magScale;
+		pipe.BindBuffer(0, m_rdoutbuf);
+		pipe.BindBuffer(1, cap->m_samples);
+		pipe.AddComputeMemoryBarrier(cmdBuf);
+		pipe.Dispatch(cmdBuf, cargs,
+			min(compute_block_count, 32768u),
+			compute_block_count / 32768 + 1);
+	}
 
 	//Done, block until the compute operations finish
 	cmdBuf.end();
@@ -311,6 +385,6 @@ void FFTFilter::DoRefresh(
 
 	cap->MarkModifiedFromGpu();
 
-	//Peak search (for now this runs on the CPU)
+	//Peak search (on the GPU, the spectrum is already there)
 	FindPeaks(cap, cmdBuf, queue);
 }
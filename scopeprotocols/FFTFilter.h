@@ -35,7 +35,7 @@
 #ifndef FFTFilter_h
 #define FFTFilter_h
 
-#include "VulkanFFTPlan.h"
+#include "VulkanFFTPlanCache.h"
 
 class QueueHandle;
 
@@ -45,6 +45,25 @@ struct ComplexToMagnitudeArgs
 	float scale;
 };
 
+/**
+	@brief Arguments to the fused frequency domain window and magnitude shader
+
+	The window is alpha0 + sum(alphaN * cos(2*pi*harmonicN*i / npoints))
+ */
+struct FFTWindowedMagnitudeArgs
+{
+	uint32_t nouts;
+	uint32_t npoints;
+	float scale;
+	float alpha0;
+	float alpha1;
+	float alpha2;
+	float alpha3;
+	int32_t harmonic1;
+	int32_t harmonic2;
+	int32_t harmonic3;
+};
+
 class FFTFilter : public PeakDetectionFilter
 {
 public:
@@ -110,13 +129,14 @@ protected:
 
 	std::string m_windowName;
 
-	std::unique_ptr<VulkanFFTPlan> m_vkPlan;
-
 	ComputePipeline m_blackmanHarrisComputePipeline;
 	ComputePipeline m_rectangularComputePipeline;
 	ComputePipeline m_cosineSumComputePipeline;
 	ComputePipeline m_complexToMagnitudeComputePipeline;
 	ComputePipeline m_complexToLogMagnitudeComputePipeline;
+
+	///@brief Fused window and magnitude pipelines, by window shape (rectangular, cosine, Blackman-Harris) and log output
+	std::unique_ptr<ComputePipeline> m_windowedMagnitudeComputePipelines[3][2];
 };
 
 #endif
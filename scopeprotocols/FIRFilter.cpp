@@ -35,6 +35,12 @@
 
 using namespace std;
 
+size_t FIRFilter::m_overlapSaveCrossover = 0;
+mutex FIRFilter::m_overlapSaveCrossoverMutex;
+
+///@brief Tap count returned by the benchmark if overlap-save never wins (larger than any filter we allow)
+#define FIR_OVERLAP_SAVE_NEVER 65536
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Construction / destruction
 
@@ -46,6 +52,18 @@ FIRFilter::FIRFilter(const string& color)
 	, m_freqLowName("Frequency Low")
 	, m_freqHighName("Frequency High")
 	, m_computePipeline("shaders/FIRFilter.spv", 3, sizeof(FIRFilterArgs))
+	, m_coefficientsChanged(true)
+	, m_cachedFreqLow(0)
+	, m_cachedFreqHigh(0)
+	, m_cachedAtten(0)
+	, m_cachedType(FILTER_TYPE_LOWPASS)
+	, m_rectangularComputePipeline("shaders/RectangularWindow.spv", 2, sizeof(WindowFunctionArgs))
+	, m_overlapSaveInputPipeline("shaders/FIRFilter_OverlapSaveInput.spv", 2, sizeof(FIROverlapSaveArgs))
+	, m_overlapSaveMultiplyPipeline("shaders/FIRFilter_OverlapSaveMultiply.spv", 2, sizeof(FIROverlapSaveMultiplyArgs))
+	, m_overlapSaveOutputPipeline("shaders/FIRFilter_OverlapSaveOutput.spv", 2, sizeof(FIROverlapSaveArgs))
+	, m_kernelSpectrumValid(false)
+	, m_overlapSaveFFTLength(0)
+	, m_overlapSaveBlocksPerPass(0)
 {
 	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_ANALOG);
 	CreateInput("in");
@@ -71,6 +89,11 @@ FIRFilter::FIRFilter(const string& color)
 
 	m_coefficients.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
 	m_coefficients.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+
+	m_paddedCoefficients.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_kernelSpectrum.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_blockTimeDomain.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_blockFreqDomain.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -200,9 +223,37 @@ void FIRFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle>
 		return;
 	}
 
-	//Create the filter coefficients (TODO: cache this)
-	m_coefficients.resize(filterlen);
-	CalculateFilterCoefficients(flo / nyquist, fhi / nyquist, atten, type);
+	//Need at least one full filter length of input
+	if(din->size() <= filterlen)
+	{
+		SetData(NULL, 0);
+		return;
+	}
+
+	//Figure out which convolution algorithm is fastest on this GPU, if we haven't already
+	if(g_gpuFilterEnabled)
+		GetOverlapSaveCrossover(cmdBuf, queue);
+
+	//Create the filter coefficients, if anything they depend on has changed
+	float fa = flo / nyquist;
+	float fb = fhi / nyquist;
+	if( m_coefficientsChanged ||
+		(m_coefficients.size() != filterlen) ||
+		(m_cachedFreqLow != fa) ||
+		(m_cachedFreqHigh != fb) ||
+		(m_cachedAtten != atten) ||
+		(m_cachedType != type) )
+	{
+		m_coefficients.resize(filterlen);
+		CalculateFilterCoefficients(fa, fb, atten, type);
+
+		m_cachedFreqLow = fa;
+		m_cachedFreqHigh = fb;
+		m_cachedAtten = atten;
+		m_cachedType = type;
+		m_coefficientsChanged = false;
+		m_kernelSpectrumValid = false;
+	}
 
 	//Set up output
 	m_xAxisUnit = m_inputs[0].m_channel->GetXAxisUnits();
@@ -224,24 +275,21 @@ void FIRFilter::DoFilterKernel(
 	UniformAnalogWaveform* din,
 	UniformAnalogWaveform* cap)
 {
-	if(g_gpuFilterEnabled)
+	if(IsGpuPreferred())
 	{
-		cmdBuf.begin({});
+		size_t outlen = din->size() - m_coefficients.size();
 
-		FIRFilterArgs args;
-		args.end = din->size() - m_coefficients.size();
-		args.filterlen = m_coefficients.size();
-
-		m_computePipeline.BindBufferNonblocking(0, din->m_samples, cmdBuf);
-		m_computePipeline.BindBufferNonblocking(1, m_coefficients, cmdBuf);
-		m_computePipeline.BindBufferNonblocking(2, cap->m_samples, cmdBuf, true);
-		const uint32_t compute_block_count = GetComputeBlockCount(args.end, 64);
-		m_computePipeline.Dispatch(cmdBuf, args,
-			min(compute_block_count, 32768u),
-			compute_block_count / 32768 + 1);
+		size_t crossover;
+		{
+			lock_guard<mutex> lock(m_overlapSaveCrossoverMutex);
+			crossover = m_overlapSaveCrossover;
+		}
 
-		cmdBuf.end();
-		queue->SubmitAndBlock(cmdBuf);
+		//Long filters are cheaper to do in the frequency domain
+		if( (crossover != 0) && (m_coefficients.size() >= crossover) )
+			DoFilterKernelOverlapSave(cmdBuf, queue, din->m_samples, cap->m_samples, outlen);
+		else
+			DoFilterKernelDirect(cmdBuf, queue, din->m_samples, cap->m_samples, outlen);
 
 		cap->m_samples.MarkModifiedFromGpu();
 	}
@@ -251,31 +299,301 @@ void FIRFilter::DoFilterKernel(
 		din->PrepareForCpuAccess();
 		cap->PrepareForCpuAccess();
 
-		DoFilterKernelGeneric(din, cap);
+		DoFilterKernelCPU(din, cap);
 
 		cap->MarkModifiedFromCpu();
 	}
 }
 
 /**
-	@brief Performs a FIR filter (does not assume symmetric)
+	@brief Performs a direct form FIR filter on the GPU
+
+	O(N * taps), but has no setup cost so is fastest for short filters.
  */
-void FIRFilter::DoFilterKernelGeneric(
-	UniformAnalogWaveform* din,
-	UniformAnalogWaveform* cap)
+void FIRFilter::DoFilterKernelDirect(
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue,
+	AcceleratorBuffer<float>& din,
+	AcceleratorBuffer<float>& dout,
+	size_t outlen)
 {
-	//Setup
-	size_t len = din->size();
+	cmdBuf.begin({});
+
+	FIRFilterArgs args;
+	args.end = outlen;
+	args.filterlen = m_coefficients.size();
+
+	m_computePipeline.BindBufferNonblocking(0, din, cmdBuf);
+	m_computePipeline.BindBufferNonblocking(1, m_coefficients, cmdBuf);
+	m_computePipeline.BindBufferNonblocking(2, dout, cmdBuf, true);
+	const uint32_t compute_block_count = GetComputeBlockCount(args.end, 64);
+	m_computePipeline.Dispatch(cmdBuf, args,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
+
+	cmdBuf.end();
+	queue->SubmitAndBlock(cmdBuf);
+}
+
+/**
+	@brief Allocates FFT plans and buffers for overlap-save convolution, and updates the frequency domain kernel
+	if the coefficients have changed
+
+	@param cmdBuf	Command buffer to use for calculating the kernel
+	@param queue	Queue to submit to
+	@param outlen	Number of output samples to be generated
+ */
+void FIRFilter::PrepareOverlapSave(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue, size_t outlen)
+{
+	//Use an FFT a few times longer than the filter so most of each block is valid output
 	size_t filterlen = m_coefficients.size();
-	size_t end = len - filterlen;
+	size_t fftlen = max(next_pow2(filterlen) * 4, (uint64_t)1024);
+	size_t step = fftlen - filterlen + 1;
+	size_t nouts = fftlen/2 + 1;
+
+	//Cap working buffers at 16M points per pass. Round up to a power of two so that small changes in
+	//record length don't force us to make new plans
+	size_t nblocks = (outlen + step - 1) / step;
+	size_t maxBlocks = max((size_t)1, (size_t)(16 * 1024 * 1024) / fftlen);
+	size_t blocksPerPass = min((size_t)next_pow2(nblocks), maxBlocks);
+
+	//New FFT size means new kernel
+	if(m_overlapSaveFFTLength != fftlen)
+	{
+		m_kernelPlan = g_fftPlanCache->Acquire(fftlen, nouts, VulkanFFTPlan::DIRECTION_FORWARD);
+		m_paddedCoefficients.resize(fftlen);
+		m_kernelSpectrum.resize(2 * nouts);
+		m_kernelSpectrumValid = false;
+	}
+
+	//New FFT size or batch size means new block plans
+	if( (m_overlapSaveFFTLength != fftlen) || (m_overlapSaveBlocksPerPass != blocksPerPass) )
+	{
+		m_blockForwardPlan = g_fftPlanCache->Acquire(
+			fftlen, nouts, VulkanFFTPlan::DIRECTION_FORWARD, blocksPerPass);
+		m_blockReversePlan = g_fftPlanCache->Acquire(
+			fftlen, nouts, VulkanFFTPlan::DIRECTION_REVERSE, blocksPerPass);
+		m_blockTimeDomain.resize(fftlen * blocksPerPass);
+		m_blockFreqDomain.resize(2 * nouts * blocksPerPass);
+	}
+
+	m_overlapSaveFFTLength = fftlen;
+	m_overlapSaveBlocksPerPass = blocksPerPass;
+
+	if(m_kernelSpectrumValid)
+		return;
+
+	//Zero pad the coefficients and transform them
+	cmdBuf.begin({});
+
+	WindowFunctionArgs args;
+	args.numActualSamples = filterlen;
+	args.npoints = fftlen;
+	args.scale = 0;
+	args.alpha0 = 0;
+	args.alpha1 = 0;
+	args.offsetIn = 0;
+	args.offsetOut = 0;
+	m_rectangularComputePipeline.BindBufferNonblocking(0, m_coefficients, cmdBuf);
+	m_rectangularComputePipeline.BindBufferNonblocking(1, m_paddedCoefficients, cmdBuf, true);
+	m_rectangularComputePipeline.Dispatch(cmdBuf, args, GetComputeBlockCount(fftlen, 64));
+	m_rectangularComputePipeline.AddComputeMemoryBarrier(cmdBuf);
+	m_paddedCoefficients.MarkModifiedFromGpu();
+
+	m_kernelPlan->AppendForward(m_paddedCoefficients, m_kernelSpectrum, cmdBuf);
+
+	cmdBuf.end();
+	queue->SubmitAndBlock(cmdBuf);
+
+	m_kernelSpectrumValid = true;
+}
+
+/**
+	@brief Performs a FIR filter on the GPU by overlap-save FFT convolution
+
+	O(N * log(taps)), so much faster than direct form for long filters.
+
+	The input is split into blocks of one FFT length, each overlapping the previous by (taps - 1) points. Each block
+	is multiplied by the frequency domain kernel, and the first (FFT length - taps + 1) points of each inverse
+	transform (the ones not corrupted by circular wraparound) are the output.
+ */
+void FIRFilter::DoFilterKernelOverlapSave(
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue,
+	AcceleratorBuffer<float>& din,
+	AcceleratorBuffer<float>& dout,
+	size_t outlen)
+{
+	if(outlen == 0)
+		return;
+	PrepareOverlapSave(cmdBuf, queue, outlen);
+
+	size_t fftlen = m_overlapSaveFFTLength;
+	size_t step = fftlen - m_coefficients.size() + 1;
+	size_t nouts = fftlen/2 + 1;
 
-	//Do the filter
-	for(size_t i=0; i<end; i++)
+	//Each pass does up to m_overlapSaveBlocksPerPass blocks, using each pipeline once
+	for(size_t start = 0; start < outlen; start += step * m_overlapSaveBlocksPerPass)
 	{
-		float v = 0;
-		for(size_t j=0; j<filterlen; j++)
-			v += din->m_samples[i + j] * m_coefficients[j];
+		size_t nblocks = min(m_overlapSaveBlocksPerPass, (outlen - start + step - 1) / step);
 
-		cap->m_samples[i]	= v;
+		cmdBuf.begin({});
+
+		//Split the input into overlapping blocks
+		FIROverlapSaveArgs args;
+		args.len = din.size();
+		args.fftlen = fftlen;
+		args.step = step;
+		args.offset = start;
+		args.nblocks = nblocks;
+		m_overlapSaveInputPipeline.BindBufferNonblocking(0, din, cmdBuf);
+		m_overlapSaveInputPipeline.BindBufferNonblocking(1, m_blockTimeDomain, cmdBuf, true);
+		uint32_t compute_block_count = GetComputeBlockCount(nblocks * fftlen, 64);
+		m_overlapSaveInputPipeline.Dispatch(cmdBuf, args,
+			min(compute_block_count, 32768u),
+			compute_block_count / 32768 + 1);
+		m_overlapSaveInputPipeline.AddComputeMemoryBarrier(cmdBuf);
+		m_blockTimeDomain.MarkModifiedFromGpu();
+
+		m_blockForwardPlan->AppendForward(m_blockTimeDomain, m_blockFreqDomain, cmdBuf);
+
+		//Apply the filter
+		FIROverlapSaveMultiplyArgs margs;
+		margs.nouts = nouts;
+		margs.nblocks = nblocks;
+		margs.scale = 1.0f / fftlen;
+		m_overlapSaveMultiplyPipeline.BindBufferNonblocking(0, m_blockFreqDomain, cmdBuf);
+		m_overlapSaveMultiplyPipeline.BindBufferNonblocking(1, m_kernelSpectrum, cmdBuf);
+		compute_block_count = GetComputeBlockCount(nblocks * nouts, 64);
+		m_overlapSaveMultiplyPipeline.Dispatch(cmdBuf, margs,
+			min(compute_block_count, 32768u),
+			compute_block_count / 32768 + 1);
+		m_overlapSaveMultiplyPipeline.AddComputeMemoryBarrier(cmdBuf);
+		m_blockFreqDomain.MarkModifiedFromGpu();
+
+		m_blockReversePlan->AppendReverse(m_blockFreqDomain, m_blockTimeDomain, cmdBuf);
+
+		//Keep the valid part of each block
+		args.len = outlen;
+		m_overlapSaveOutputPipeline.BindBufferNonblocking(0, m_blockTimeDomain, cmdBuf);
+		m_overlapSaveOutputPipeline.BindBufferNonblocking(1, dout, cmdBuf, true);
+		compute_block_count = GetComputeBlockCount(nblocks * step, 64);
+		m_overlapSaveOutputPipeline.Dispatch(cmdBuf, args,
+			min(compute_block_count, 32768u),
+			compute_block_count / 32768 + 1);
+		m_overlapSaveOutputPipeline.AddComputeMemoryBarrier(cmdBuf);
+
+		cmdBuf.end();
+		queue->SubmitAndBlock(cmdBuf);
+	}
+}
+
+/**
+	@brief Gets the smallest filter length at which overlap-save is faster than direct form on this GPU
+
+	Measured once, then saved in the pipeline cache (which is keyed to the device and driver version).
+ */
+size_t FIRFilter::GetOverlapSaveCrossover(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
+{
+	lock_guard<mutex> lock(m_overlapSaveCrossoverMutex);
+	if(m_overlapSaveCrossover != 0)
+		return m_overlapSaveCrossover;
+
+	const string key = "FIRFilter_OverlapSaveCrossover_V1";
+	auto blob = g_pipelineCacheMgr->LookupRaw(key);
+	if( (blob != nullptr) && (blob->size() == sizeof(uint64_t)) )
+	{
+		uint64_t crossover;
+		memcpy(&crossover, &(*blob)[0], sizeof(crossover));
+		m_overlapSaveCrossover = crossover;
+	}
+	else
+	{
+		m_overlapSaveCrossover = RunOverlapSaveBenchmark(cmdBuf, queue);
+
+		uint64_t crossover = m_overlapSaveCrossover;
+		auto vec = make_shared<vector<uint8_t> >();
+		vec->resize(sizeof(crossover));
+		memcpy(&(*vec)[0], &crossover, sizeof(crossover));
+		g_pipelineCacheMgr->StoreRaw(key, vec);
 	}
+
+	LogTrace("FIR filter overlap-save crossover is %zu taps\n", m_overlapSaveCrossover);
+	return m_overlapSaveCrossover;
+}
+
+/**
+	@brief Times direct form and overlap-save convolution at increasing filter lengths to find where the FFT wins
+
+	Clobbers m_coefficients, so they're flagged for recalculation afterwards.
+ */
+size_t FIRFilter::RunOverlapSaveBenchmark(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
+{
+	LogTrace("Benchmarking FIR filter algorithms\n");
+	LogIndenter li;
+
+	const size_t testlen = 1024 * 1024;
+	const size_t maxtaps = 4096;
+
+	AcceleratorBuffer<float> din;
+	AcceleratorBuffer<float> dout;
+	din.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	dout.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	din.resize(testlen + maxtaps);
+	dout.resize(testlen);
+	din.PrepareForCpuAccess();
+	for(size_t i=0; i<din.size(); i++)
+		din[i] = (i & 0xff) / 256.0f;
+	din.MarkModifiedFromCpu();
+
+	size_t crossover = FIR_OVERLAP_SAVE_NEVER;
+	for(size_t taps = 32; taps <= maxtaps; taps *= 2)
+	{
+		m_coefficients.resize(taps + 1);
+		m_coefficients.PrepareForCpuAccess();
+		for(size_t i=0; i<m_coefficients.size(); i++)
+			m_coefficients[i] = 1.0f / m_coefficients.size();
+		m_coefficients.MarkModifiedFromCpu();
+		m_kernelSpectrumValid = false;
+
+		//Run each once first so shader compilation and FFT planning aren't counted
+		DoFilterKernelDirect(cmdBuf, queue, din, dout, testlen);
+		DoFilterKernelOverlapSave(cmdBuf, queue, din, dout, testlen);
+
+		double start = GetTime();
+		DoFilterKernelDirect(cmdBuf, queue, din, dout, testlen);
+		double tdirect = GetTime() - start;
+
+		start = GetTime();
+		DoFilterKernelOverlapSave(cmdBuf, queue, din, dout, testlen);
+		double tfft = GetTime() - start;
+
+		LogTrace("%5zu taps: direct %.3f ms, overlap-save %.3f ms\n",
+			m_coefficients.size(), tdirect * 1e3, tfft * 1e3);
+
+		if(tfft < tdirect)
+		{
+			crossover = m_coefficients.size();
+			break;
+		}
+	}
+
+	m_coefficientsChanged = true;
+	m_kernelSpectrumValid = false;
+	return crossover;
+}
+
+/**
+	@brief Performs a FIR filter (does not assume symmetric)
+ */
+void FIRFilter::DoFilterKernelCPU(
+	UniformAnalogWaveform* din,
+	UniformAnalogWaveform* cap)
+{
+	g_simdKernels.firFilter(
+		din->m_samples.GetCpuPointer(),
+		cap->m_samples.GetCpuPointer(),
+		m_coefficients.GetCpuPointer(),
+		din->size() - m_coefficients.size(),
+		m_coefficients.size());
 }
@@ -35,6 +35,39 @@
 #ifndef FIRFilter_h
 #define FIRFilter_h
 
+#include "VulkanFFTPlanCache.h"
+
+/**
+	@brief Arguments to the overlap-save framing and output shaders
+ */
+struct FIROverlapSaveArgs
+{
+	///@brief Length of the input (for framing) or output (for output) buffer
+	uint32_t len;
+
+	///@brief Number of points in each FFT block
+	uint32_t fftlen;
+
+	///@brief Number of valid output points in each block
+	uint32_t step;
+
+	///@brief Offset of the first sample of this pass
+	uint32_t offset;
+
+	///@brief Number of blocks in this pass
+	uint32_t nblocks;
+};
+
+/**
+	@brief Arguments to the overlap-save frequency domain multiply shader
+ */
+struct FIROverlapSaveMultiplyArgs
+{
+	uint32_t nouts;
+	uint32_t nblocks;
+	float scale;
+};
+
 /**
 	@brief Performs an arbitrary FIR filter with tap delay equal to the sample rate
  */
@@ -76,10 +109,29 @@ protected:
 	void CalculateFilterCoefficients(float fa, float fb, float stopbandAtten, FIRFilterType type)
 	{ CalculateFIRCoefficients(fa, fb, stopbandAtten, type, m_coefficients); }
 
-	void DoFilterKernelGeneric(
+	void DoFilterKernelCPU(
 		UniformAnalogWaveform* din,
 		UniformAnalogWaveform* cap);
 
+	void DoFilterKernelDirect(
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue,
+		AcceleratorBuffer<float>& din,
+		AcceleratorBuffer<float>& dout,
+		size_t outlen);
+
+	void DoFilterKernelOverlapSave(
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue,
+		AcceleratorBuffer<float>& din,
+		AcceleratorBuffer<float>& dout,
+		size_t outlen);
+
+	void PrepareOverlapSave(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue, size_t outlen);
+
+	size_t GetOverlapSaveCrossover(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue);
+	size_t RunOverlapSaveBenchmark(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue);
+
 	std::string m_filterTypeName;
 	std::string m_filterLengthName;
 	std::string m_stopbandAttenName;
@@ -89,6 +141,49 @@ protected:
 	ComputePipeline m_computePipeline;
 
 	AcceleratorBuffer<float> m_coefficients;
+
+	///@brief Set when m_coefficients no longer matches the parameters they were calculated from
+	bool m_coefficientsChanged;
+
+	//Parameters m_coefficients was last calculated from
+	float m_cachedFreqLow;
+	float m_cachedFreqHigh;
+	float m_cachedAtten;
+	FIRFilterType m_cachedType;
+
+	//Overlap-save FFT convolution for long filters
+	ComputePipeline m_rectangularComputePipeline;
+	ComputePipeline m_overlapSaveInputPipeline;
+	ComputePipeline m_overlapSaveMultiplyPipeline;
+	ComputePipeline m_overlapSaveOutputPipeline;
+
+	VulkanFFTPlanHandle m_kernelPlan;
+	VulkanFFTPlanHandle m_blockForwardPlan;
+	VulkanFFTPlanHandle m_blockReversePlan;
+
+	///@brief Zero padded copy of m_coefficients
+	AcceleratorBuffer<float> m_paddedCoefficients;
+
+	///@brief Frequency domain filter kernel
+	AcceleratorBuffer<float> m_kernelSpectrum;
+
+	///@brief True if m_kernelSpectrum is up to date with m_coefficients
+	bool m_kernelSpectrumValid;
+
+	AcceleratorBuffer<float> m_blockTimeDomain;
+	AcceleratorBuffer<float> m_blockFreqDomain;
+
+	///@brief Number of points in each overlap-save FFT block
+	size_t m_overlapSaveFFTLength;
+
+	///@brief Number of FFT blocks processed per submission
+	size_t m_overlapSaveBlocksPerPass;
+
+	///@brief Smallest tap count at which overlap-save beats direct form on this device (0 = not measured yet)
+	static size_t m_overlapSaveCrossover;
+
+	///@brief Mutex guarding m_overlapSaveCrossover
+	static std::mutex m_overlapSaveCrossoverMutex;
 };
 
 #endif
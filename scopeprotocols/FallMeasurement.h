@@ -46,9 +46,15 @@ public:
 
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
+	virtual bool SupportsScalarBatch(size_t stream) override;
+
 	PROTOCOL_DECODER_INITPROC(FallMeasurement)
 
 protected:
+	virtual bool EvaluateScalarSegment(WaveformBase* din, size_t stream, float& value) override;
+
+	bool Measure(WaveformBase* din, SparseAnalogWaveform* cap, float& avg);
+
 	std::string m_startname;
 	std::string m_endname;
 };
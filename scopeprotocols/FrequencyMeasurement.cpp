@@ -87,23 +87,8 @@ void FrequencyMeasurement::Refresh()
 
 	auto din = GetInputWaveform(0);
 	din->PrepareForCpuAccess();
-	auto uadin = dynamic_cast<UniformAnalogWaveform*>(din);
-	auto sadin = dynamic_cast<SparseAnalogWaveform*>(din);
-	auto uddin = dynamic_cast<UniformDigitalWaveform*>(din);
-	auto sddin = dynamic_cast<SparseDigitalWaveform*>(din);
 	vector<int64_t> edges;
-
-	//Auto-threshold analog signals at 50% of full scale range
-	if(uadin)
-		FindZeroCrossings(uadin, GetAvgVoltage(uadin), edges);
-	else if(sadin)
-		FindZeroCrossings(sadin, GetAvgVoltage(sadin), edges);
-
-	//Just find edges in digital signals
-	else if(uddin)
-		FindZeroCrossings(uddin, edges);
-	else
-		FindZeroCrossings(sddin, edges);
+	FindEdges(din, edges);
 
 	//We need at least one full cycle of the waveform to have a meaningful frequency
 	if(edges.size() < 2)
@@ -136,10 +121,60 @@ void FrequencyMeasurement::Refresh()
 
 	cap->MarkModifiedFromCpu();
 
+	m_streams[1].m_value = GetAverage(edges);
+}
+
+/**
+	@brief Finds every zero crossing of a waveform
+
+	Analog signals are auto-thresholded at their average value; digital signals just use their edges.
+ */
+void FrequencyMeasurement::FindEdges(WaveformBase* din, vector<int64_t>& edges)
+{
+	auto uadin = dynamic_cast<UniformAnalogWaveform*>(din);
+	auto sadin = dynamic_cast<SparseAnalogWaveform*>(din);
+	auto uddin = dynamic_cast<UniformDigitalWaveform*>(din);
+	auto sddin = dynamic_cast<SparseDigitalWaveform*>(din);
+
+	//Auto-threshold analog signals at 50% of full scale range
+	if(uadin)
+		FindZeroCrossings(uadin, GetAvgVoltage(uadin), edges);
+	else if(sadin)
+		FindZeroCrossings(sadin, GetAvgVoltage(sadin), edges);
+
+	//Just find edges in digital signals
+	else if(uddin)
+		FindZeroCrossings(uddin, edges);
+	else if(sddin)
+		FindZeroCrossings(sddin, edges);
+}
+
+/**
+	@brief Computes the scalar average output from a list of at least two zero crossings
+ */
+double FrequencyMeasurement::GetAverage(const vector<int64_t>& edges)
+{
 	//For the scalar average output, find the total number of zero crossings and divide by the spacing
 	//(excluding partial cycles at start and end).
 	//This gives us twice our frequency (since we count both zero crossings) so divide by two again
+	size_t elen = edges.size();
 	double ncycles = elen - 1;
 	double interval = edges[elen-1] - edges[0];
-	m_streams[1].m_value = ncycles / (2 * interval * SECONDS_PER_FS);
+	return ncycles / (2 * interval * SECONDS_PER_FS);
+}
+
+bool FrequencyMeasurement::SupportsScalarBatch(size_t stream)
+{
+	return (stream == 1);
+}
+
+bool FrequencyMeasurement::EvaluateScalarSegment(WaveformBase* din, size_t /*stream*/, float& value)
+{
+	vector<int64_t> edges;
+	FindEdges(din, edges);
+	if(edges.size() < 2)
+		return false;
+
+	value = GetAverage(edges);
+	return true;
 }
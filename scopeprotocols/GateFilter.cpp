@@ -116,5 +116,9 @@ void GateFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/, std::shared_ptr<Qu
 	cap->m_triggerPhase = udin->m_triggerPhase;
 	cap->m_flags = udin->m_flags;
 	cap->m_revision ++;
-	cap->m_samples.CopyFrom(udin->m_samples);
+
+	//Share the input's buffer rather than copying it. In latch mode the input is only copied once it changes
+	//while we're still holding on to the old data
+	udin->ExpandRawSamples();
+	cap->m_samples.ShareFrom(udin->m_samples);
 }
@@ -29,6 +29,7 @@
 
 #include "../scopehal/scopehal.h"
 #include "GlitchRemovalFilter.h"
+#include <omp.h>
 
 using namespace std;
 
@@ -77,70 +78,103 @@ template<class T>
 void DoGlitchRemoval(T* din, SparseDigitalWaveform* cap, size_t minwidth)
 {
 	size_t len = din->m_samples.size();
-	cap->Resize(len);
 
 	cap->PrepareForCpuAccess();
 	din->PrepareForCpuAccess();
+	if(len == 0)
+	{
+		cap->Resize(0);
+		return;
+	}
+
+	//The filter only acts where the input changes value, so first find all of the runs of identical samples.
+	//This is the only part which has to look at every sample, so split it across threads.
+	size_t nblocks = omp_get_max_threads();
+	size_t blocksize = (len + nblocks - 1) / nblocks;
+	vector<vector<size_t>> blockStarts(nblocks);
+	#pragma omp parallel for
+	for(size_t block=0; block<nblocks; block++)
+	{
+		size_t first = max(block*blocksize, (size_t)1);
+		size_t last = min(len, (block+1)*blocksize);
+		for(size_t i=first; i<last; i++)
+		{
+			if(din->m_samples[i] != din->m_samples[i-1])
+				blockStarts[block].push_back(i);
+		}
+	}
+	vector<size_t> starts;
+	starts.push_back(0);
+	for(auto& v : blockStarts)
+		starts.insert(starts.end(), v.begin(), v.end());
+	size_t nruns = starts.size();
+
+	//Length of each run
+	vector<size_t> lengths(nruns);
+	#pragma omp parallel for
+	for(size_t j=0; j<nruns; j++)
+	{
+		size_t end = (j+1 < nruns) ? starts[j+1] : len;
+		if constexpr (std::is_same<T, UniformDigitalWaveform>::value)
+			lengths[j] = end - starts[j];
+		else
+		{
+			size_t total = 0;
+			for(size_t i=starts[j]; i<end; i++)
+				total += din->m_durations[i];
+			lengths[j] = total;
+		}
+	}
 
+	//Then walk the runs in order. Each output sample comes from at least one run (plus the initial transition)
+	cap->Resize(nruns + 1);
 	size_t k = 0;
 	bool last_sample = !din->m_samples[0];
 	size_t running_length = 0;
 
-	for (size_t i = 0; i < len; i++)
+	for(size_t j = 0; j < nruns; j++)
 	{
+		size_t i = starts[j];
 		bool this_sample = din->m_samples[i];
 		size_t this_offset;
-		size_t this_duration;
 
 		if constexpr (std::is_same<T, UniformDigitalWaveform>::value)
-		{
 			this_offset = i;
-			this_duration = 1;
-		}
 		else
-		{
 			this_offset = din->m_offsets[i];
-			this_duration = din->m_durations[i];
-		}
 
-		if (this_sample != last_sample)
+		bool coalesce = false;
+		if (k != 0)
 		{
-			bool coalesce = false;
-			if (k != 0)
+			if (last_sample == cap->m_samples[k-1])
 			{
-				if (last_sample == cap->m_samples[k-1])
-				{
-					// Don't create a new sample, just extend the last one
-					coalesce = true;
-				}
+				// Don't create a new sample, just extend the last one
+				coalesce = true;
 			}
+		}
 
-			if (running_length >= minwidth && !coalesce)
+		if (running_length >= minwidth && !coalesce)
+		{
+			// Install pulse
+			cap->m_offsets[k] = this_offset - running_length;
+			cap->m_samples[k] = last_sample;
+			cap->m_durations[k] = running_length;
+			k++;
+		}
+		else
+		{
+			if (k != 0)
 			{
-				// Install pulse
-				cap->m_offsets[k] = this_offset - running_length;
-				cap->m_samples[k] = last_sample;
-				cap->m_durations[k] = running_length;
-				k++;
+				// Extend last pulse
+				cap->m_durations[k-1] += running_length;
 			}
 			else
 			{
-				if (k != 0)
-				{
-					// Extend last pulse
-					cap->m_durations[k-1] += running_length;
-				}
-				else
-				{
-					// At the beginning and no long-enough pulses yet
-				}
+				// At the beginning and no long-enough pulses yet
 			}
-
-			running_length = 0;
 		}
 
-		running_length += this_duration;
-
+		running_length = lengths[j];
 		last_sample = this_sample;
 	}
 
@@ -102,33 +102,27 @@ void GroupDelayFilter::Refresh()
 	cap->Resize(len);
 	cap->m_timescale = 1;
 
-	//Main output loop
-	for(size_t i=0; i<len; i++)
+	//Main output loop. Every point only needs its own wrapped phase difference, so no serial unwrap is needed
+	ParallelFor(0, len, 65536, [&](size_t first, size_t last)
 	{
-		//Subtract phase angles, wrapping correctly around singularities
-		//(assume +/- 180 deg range)
-		float phase_hi = GetValue(sang, uang, i+1);
-		float phase_lo = GetValue(sang, uang, i);
-		if(fabs(phase_lo - phase_hi) > 180)
+		for(size_t i=first; i<last; i++)
 		{
-			if(phase_lo < phase_hi)
-				phase_lo += 360;
-			else
-				phase_hi += 360;
-		}
-		float dphase = phase_hi - phase_lo;
+			//Subtract phase angles, wrapping correctly around singularities
+			//(assume +/- 180 deg range)
+			float dphase = WrappedPhaseDelta(GetValue(sang, uang, i), GetValue(sang, uang, i+1), 360);
 
-		//convert frequency to degrees/sec since input channel angles are in degrees
-		float dfreq = (::GetOffset(sang, uang, i+1) - ::GetOffset(sang, uang, i)) * din->m_timescale;
-		dfreq *= 360;
+			//convert frequency to degrees/sec since input channel angles are in degrees
+			float dfreq = (::GetOffset(sang, uang, i+1) - ::GetOffset(sang, uang, i)) * din->m_timescale;
+			dfreq *= 360;
 
-		//Calculate final group delay
-		float delay = (-dphase / dfreq) * FS_PER_SECOND;
+			//Calculate final group delay
+			float delay = (-dphase / dfreq) * FS_PER_SECOND;
 
-		cap->m_offsets[i] = GetOffsetScaled(sang, uang, i);
-		cap->m_durations[i] = GetDurationScaled(sang, uang, i);
-		cap->m_samples[i] = delay;
-	}
+			cap->m_offsets[i] = GetOffsetScaled(sang, uang, i);
+			cap->m_durations[i] = GetDurationScaled(sang, uang, i);
+			cap->m_samples[i] = delay;
+		}
+	});
 
 	cap->MarkModifiedFromCpu();
 }
@@ -42,6 +42,9 @@ HistogramFilter::HistogramFilter(const string& color)
 	, m_maxName("Max Value")
 	, m_binSizeName("Bin Size")
 	, m_minmaxPipeline("shaders/MinMax.spv", 3, sizeof(uint32_t))
+	, m_histogramBuf("HistogramFilter.m_histogramBuf")
+	, m_peakBuf("HistogramFilter.m_peakBuf")
+	, m_peakPending(false)
 {
 	AddStream(Unit(Unit::UNIT_COUNTS_SCI), "data", Stream::STREAM_TYPE_ANALOG);
 
@@ -72,10 +75,18 @@ HistogramFilter::HistogramFilter(const string& color)
 
 	if(g_hasShaderInt64 && g_hasShaderAtomicInt64)
 	{
-		m_histogramPipeline =
-			make_shared<ComputePipeline>("shaders/Histogram.spv", 2, sizeof(HistogramConstants));
+		m_accumulatePipeline =
+			make_shared<ComputePipeline>("shaders/HistogramAccumulate.spv", 2, sizeof(HistogramConstants));
+		m_outputPipeline =
+			make_shared<ComputePipeline>("shaders/HistogramOutput.spv", 3, sizeof(uint32_t));
 
+		//Accumulated bins stay on the GPU
+		m_histogramBuf.SetCpuAccessHint(AcceleratorBuffer<uint64_t>::HINT_UNLIKELY);
 		m_histogramBuf.SetGpuAccessHint(AcceleratorBuffer<uint64_t>::HINT_LIKELY);
+
+		m_peakBuf.SetCpuAccessHint(AcceleratorBuffer<uint64_t>::HINT_LIKELY);
+		m_peakBuf.SetGpuAccessHint(AcceleratorBuffer<uint64_t>::HINT_LIKELY);
+		m_peakBuf.resize(1);
 	}
 }
 
@@ -119,24 +130,48 @@ Filter::DataLocation HistogramFilter::GetInputLocation()
 
 float HistogramFilter::GetVoltageRange(size_t /*stream*/)
 {
+	UpdateRange();
 	return m_range;
 }
 
 float HistogramFilter::GetOffset(size_t /*stream*/)
 {
+	UpdateRange();
 	return -m_midpoint;
 }
 
 void HistogramFilter::SetVoltageRange(float range, size_t /*stream*/)
 {
+	m_peakPending = false;
 	m_range = range;
 }
 
 void HistogramFilter::SetOffset(float offset, size_t /*stream*/)
 {
+	m_peakPending = false;
 	m_midpoint = -offset;
 }
 
+/**
+	@brief Autoscales the vertical axis to the tallest bin of the GPU histogram
+
+	This is the only place the accumulated histogram is read back to the CPU, and only one value at that, so we
+	don't stall on a readback every trigger unless someone is actually looking at the scale.
+ */
+void HistogramFilter::UpdateRange()
+{
+	if(!m_peakPending)
+		return;
+	m_peakPending = false;
+
+	m_peakBuf.PrepareForCpuAccess();
+	size_t vmax = m_peakBuf[0];
+
+	vmax *= 1.05;
+	m_range = vmax + 2;
+	m_midpoint = m_range/2;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
@@ -145,6 +180,7 @@ void HistogramFilter::ClearSweeps()
 	m_min = FLT_MAX;
 	m_max = -FLT_MAX;
 	m_histogram.clear();
+	m_peakPending = false;
 	SetData(NULL, 0);
 }
 
@@ -255,6 +291,8 @@ void HistogramFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueH
 	LogTrace("Final configuration: %zu bins of %s\n", bins, xunit.PrettyPrint(binsize).c_str());
 
 	//Reallocate the histogram if we changed configuration
+	if(cap && (cap->size() != bins))
+		reallocate = true;
 	if(reallocate)
 	{
 		//Reallocate our waveform
@@ -263,32 +301,69 @@ void HistogramFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueH
 		cap->m_triggerPhase = m_min * scale;
 		cap->m_flags = 0; // Updated at end
 		cap->Resize(bins);
-		cap->PrepareForCpuAccess();
 
 		m_histogram.clear();
 		for(size_t i=0; i<bins; i++)
 			m_histogram.push_back(0);
+
+		//Zero the accumulated bins. Only happens on a range change so no need for a GPU side fill
+		if(m_accumulatePipeline)
+		{
+			m_histogramBuf.resize(bins);
+			m_histogramBuf.PrepareForCpuAccess();
+			memset(m_histogramBuf.GetCpuPointer(), 0, bins*sizeof(uint64_t));
+			m_histogramBuf.MarkModifiedFromCpu();
+		}
 	}
 
-	//Calculate histogram for our incoming data
-	size_t vmax = 0;
-	if(g_hasShaderInt64 && g_hasShaderAtomicInt64)
+	cap->m_flags |= didClipRange ? WaveformBase::WAVEFORM_CLIPPING : 0;
+
+	//GPU side accumulation: the histogram never leaves the GPU
+	if(m_accumulatePipeline)
 	{
-		//GPU side histogram calculation
-		if(sdin)
-			MakeHistogram(cmdBuf, queue, *m_histogramPipeline, sdin, m_histogramBuf, m_min, m_max, bins);
-		else
-			MakeHistogram(cmdBuf, queue, *m_histogramPipeline, udin, m_histogramBuf, m_min, m_max, bins);
+		auto& samples = sdin ? sdin->m_samples : udin->m_samples;
 
-		m_histogramBuf.PrepareForCpuAccess();
+		HistogramConstants cfg;
+		cfg.size = samples.size();
+		cfg.bins = bins;
+		cfg.nmin = m_min;
+		cfg.nmax = m_max;
 
-		//Update histogram
-		for(size_t i=0; i<bins; i++)
-		{
-			m_histogram[i] += m_histogramBuf[i];
-			vmax = max(vmax, m_histogram[i]);
-		}
+		//Peak is recomputed from scratch every time
+		m_peakBuf[0] = 0;
+		m_peakBuf.MarkModifiedFromCpu();
+
+		cmdBuf.begin({});
+
+		//One pass per block of the input, prebinned in shared memory
+		m_accumulatePipeline->BindBufferNonblocking(0, samples, cmdBuf);
+		m_accumulatePipeline->BindBufferNonblocking(1, m_histogramBuf, cmdBuf);
+		m_accumulatePipeline->Dispatch(cmdBuf, cfg, min(GetComputeBlockCount(cfg.size, 256), 1024u));
+		m_accumulatePipeline->AddComputeMemoryBarrier(cmdBuf);
+
+		//Convert to float output and find the tallest bin
+		uint32_t nbins = bins;
+		m_outputPipeline->BindBufferNonblocking(0, m_histogramBuf, cmdBuf);
+		m_outputPipeline->BindBufferNonblocking(1, cap->m_samples, cmdBuf, true);
+		m_outputPipeline->BindBufferNonblocking(2, m_peakBuf, cmdBuf);
+		const uint32_t compute_block_count = GetComputeBlockCount(bins, 64);
+		m_outputPipeline->Dispatch(
+			cmdBuf, nbins,
+			min(compute_block_count, 32768u),
+			compute_block_count / 32768 + 1);
+
+		cmdBuf.end();
+		queue->SubmitAndBlock(cmdBuf);
+
+		m_histogramBuf.MarkModifiedFromGpu();
+		m_peakBuf.MarkModifiedFromGpu();
+		cap->MarkModifiedFromGpu();
+
+		//Defer the readback until somebody asks for our scale
+		m_peakPending = true;
 	}
+
+	//CPU side fallback
 	else
 	{
 		//CPU side fallback
@@ -303,22 +378,22 @@ void HistogramFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueH
 		auto data = MakeHistogram(sdin, udin, m_min, m_max, bins);
 
 		//Update histogram
+		size_t vmax = 0;
 		for(size_t i=0; i<bins; i++)
 		{
 			m_histogram[i] += data[i];
 			vmax = max(vmax, m_histogram[i]);
 		}
-	}
-
-	//Generate output
-	for(size_t i=0; i<bins; i++)
-		cap->m_samples[i] 	= m_histogram[i];
 
-	vmax *= 1.05;
-	m_range = vmax + 2;
-	m_midpoint = m_range/2;
+		//Generate output
+		cap->PrepareForCpuAccess();
+		for(size_t i=0; i<bins; i++)
+			cap->m_samples[i] 	= m_histogram[i];
 
-	cap->m_flags |= didClipRange ? WaveformBase::WAVEFORM_CLIPPING : 0;
+		vmax *= 1.05;
+		m_range = vmax + 2;
+		m_midpoint = m_range/2;
 
-	cap->MarkModifiedFromCpu();
+		cap->MarkModifiedFromCpu();
+	}
 }
@@ -59,6 +59,8 @@ public:
 	PROTOCOL_DECODER_INITPROC(HistogramFilter)
 
 protected:
+	void UpdateRange();
+
 	std::string m_autorangeName;
 	std::string m_minName;
 	std::string m_maxName;
@@ -70,6 +72,7 @@ protected:
 	float m_min;
 	float m_max;
 
+	///@brief Accumulated histogram (CPU fallback only)
 	std::vector<size_t> m_histogram;
 
 	//Minmax calculation for bounds
@@ -77,9 +80,20 @@ protected:
 	AcceleratorBuffer<float> m_minbuf;
 	AcceleratorBuffer<float> m_maxbuf;
 
-	//Histogram calculation
-	std::shared_ptr<ComputePipeline> m_histogramPipeline;
+	///@brief Adds each new waveform to the accumulated histogram
+	std::shared_ptr<ComputePipeline> m_accumulatePipeline;
+
+	///@brief Converts the accumulated histogram to the output waveform
+	std::shared_ptr<ComputePipeline> m_outputPipeline;
+
+	///@brief Accumulated histogram (GPU path); only read back by the CPU when autoscaling needs the peak
 	AcceleratorBuffer<uint64_t> m_histogramBuf;
+
+	///@brief Largest bin in m_histogramBuf, computed by m_outputPipeline
+	AcceleratorBuffer<uint64_t> m_peakBuf;
+
+	///@brief True if m_peakBuf has been updated since m_range was last computed from it
+	bool m_peakPending;
 };
 
 #endif
@@ -30,6 +30,7 @@
 #include "../scopehal/scopehal.h"
 #include "HorizontalBathtub.h"
 #include "EyePattern.h"
+#include "../scopehal/EyeStatistics.h"
 
 using namespace std;
 
@@ -38,6 +39,9 @@ using namespace std;
 
 HorizontalBathtub::HorizontalBathtub(const string& color)
 	: Filter(color, CAT_ANALYSIS)
+	, m_cachedInput(nullptr)
+	, m_cachedRevision(0)
+	, m_cachedThreshold(0)
 {
 	AddStream(Unit(Unit::UNIT_LOG_BER), "data", Stream::STREAM_TYPE_ANALOG);
 
@@ -80,7 +84,9 @@ Filter::DataLocation HorizontalBathtub::GetInputLocation()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
-void HorizontalBathtub::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
+void HorizontalBathtub::Refresh(
+	[[maybe_unused]] vk::raii::CommandBuffer& cmdBuf,
+	[[maybe_unused]] shared_ptr<QueueHandle> queue)
 {
 	#ifdef HAVE_NVTX
 		nvtx3::scoped_range range("HorizontalBathtub::Refresh");
@@ -93,12 +99,17 @@ void HorizontalBathtub::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<Queu
 	}
 
 	//Get the input data
+	//Nothing to do if neither the eye nor the threshold have changed since last time
 	auto din = dynamic_cast<EyeWaveform*>(GetInputWaveform(0));
-	cmdBuf.begin({});
-	din->GetAccumBuffer().PrepareForCpuAccessNonblocking(cmdBuf);
-	cmdBuf.end();
-	queue->SubmitAndBlock(cmdBuf);
 	float threshold = m_parameters[m_voltageName].GetFloatVal();
+	if( (din == m_cachedInput) && (din->m_revision == m_cachedRevision) && (threshold == m_cachedThreshold) &&
+		GetData(0) )
+	{
+		return;
+	}
+	m_cachedInput = din;
+	m_cachedRevision = din->m_revision;
+	m_cachedThreshold = threshold;
 
 	//Find the eye bin for this height
 	float yscale = din->GetHeight() / m_inputs[0].GetVoltageRange();
@@ -140,14 +151,16 @@ void HorizontalBathtub::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<Queu
 			break;
 	}
 
-	//Extract the single scanline we're interested in
+	//Extract the single scanline we're interested in (on the GPU, so only the scanline is read back)
 	size_t len = din->GetWidth();
 	auto halflen = len/2;
 	auto quartlen = halflen/2;
 	cap->Resize(halflen);
+	vector<float> bers;
+	EyeStatistics::GetBERProfile(din, true, ybin, quartlen, halflen, din->GetWidth()/2, eyemid, bers);
 	for(size_t i=0; i<halflen; i++)
 	{
-		auto ber = din->GetBERAtPoint(i + quartlen, ybin, din->GetWidth()/2, eyemid);
+		auto ber = bers[i];
 		if(ber < 1e-20)
 			cap->m_samples[i] = -20;
 		else
@@ -51,6 +51,15 @@ public:
 
 protected:
 	std::string m_voltageName;
+
+	///@brief Input waveform the current output was computed from
+	WaveformBase* m_cachedInput;
+
+	///@brief Revision of m_cachedInput the current output was computed from
+	uint64_t m_cachedRevision;
+
+	///@brief Threshold voltage the current output was computed for
+	float m_cachedThreshold;
 };
 
 #endif
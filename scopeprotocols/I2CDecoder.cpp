@@ -81,8 +81,13 @@ vector<string> I2CDecoder::GetHeaders()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
-template<class T, class U>
-void I2CDecoder::InnerLoop(T* sda, U* scl, I2CWaveform* cap)
+/**
+	@brief Runs the I2C state machine over every SDA or SCL edge
+
+	Working from the edge lists means the cost depends only on bus activity, not on how many samples were
+	captured while the bus sat idle.
+ */
+void I2CDecoder::InnerLoop(DigitalEdgeList* sda, DigitalEdgeList* scl, I2CWaveform* cap)
 {
 	Packet* pack = nullptr;
 
@@ -102,8 +107,8 @@ void I2CDecoder::InnerLoop(T* sda, U* scl, I2CWaveform* cap)
 
 	while(true)
 	{
-		bool cur_sda = sda->m_samples[isda];
-		bool cur_scl = scl->m_samples[iscl];
+		bool cur_sda = sda->GetValueAtScaled(timestamp, isda);
+		bool cur_scl = scl->GetValueAtScaled(timestamp, iscl);
 
 		//SDA falling with SCL high is beginning of a start condition
 		if(!cur_sda && last_sda && cur_scl)
@@ -266,15 +271,16 @@ void I2CDecoder::InnerLoop(T* sda, U* scl, I2CWaveform* cap)
 		last_sda = cur_sda;
 		last_scl = cur_scl;
 
-		//Move on
-		int64_t next_sda = Filter::GetNextEventTimestampScaled(sda, isda, sdalen, timestamp);
-		int64_t next_scl = Filter::GetNextEventTimestampScaled(scl, iscl, scllen, timestamp);
-		int64_t next_timestamp = min(next_sda, next_scl);
-		if(next_timestamp == timestamp)
+		//Move on to the next edge on either line
+		//(cursors are already past every edge at or before the current timestamp)
+		int64_t next_timestamp = INT64_MAX;
+		if(isda < sdalen)
+			next_timestamp = min(next_timestamp, sda->GetEdgeScaled(isda));
+		if(iscl < scllen)
+			next_timestamp = min(next_timestamp, scl->GetEdgeScaled(iscl));
+		if(next_timestamp == INT64_MAX)
 			break;
 		timestamp = next_timestamp;
-		Filter::AdvanceToTimestampScaled(sda, isda, sdalen, timestamp);
-		Filter::AdvanceToTimestampScaled(scl, iscl, scllen, timestamp);
 	}
 
 	if(pack)
@@ -294,14 +300,10 @@ void I2CDecoder::Refresh()
 	//Get the input data
 	auto sda = GetInputWaveform(0);
 	auto scl = GetInputWaveform(1);
-	sda->PrepareForCpuAccess();
-	scl->PrepareForCpuAccess();
-
-	auto usda = dynamic_cast<UniformDigitalWaveform*>(sda);
-	auto uscl = dynamic_cast<UniformDigitalWaveform*>(scl);
 
-	auto ssda = dynamic_cast<SparseDigitalWaveform*>(sda);
-	auto sscl = dynamic_cast<SparseDigitalWaveform*>(scl);
+	//We only care about edges, so work from the (shared, cached) edge lists
+	auto sdaEdges = DigitalEdgeList::Get(sda);
+	auto sclEdges = DigitalEdgeList::Get(scl);
 
 	//Create the capture
 	auto cap = new I2CWaveform;
@@ -311,14 +313,7 @@ void I2CDecoder::Refresh()
 	cap->m_triggerPhase = 0;
 	cap->PrepareForCpuAccess();
 
-	if(usda && uscl)
-		InnerLoop(usda, uscl, cap);
-	else if(usda && sscl)
-		InnerLoop(usda, sscl, cap);
-	else if(ssda && sscl)
-		InnerLoop(ssda, sscl, cap);
-	else /*if(ssda && uscl)*/
-		InnerLoop(ssda, uscl, cap);
+	InnerLoop(sdaEdges.get(), sclEdges.get(), cap);
 
 	SetData(cap, 0);
 	cap->MarkModifiedFromCpu();
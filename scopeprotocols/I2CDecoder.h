@@ -94,7 +94,7 @@ public:
 	PROTOCOL_DECODER_INITPROC(I2CDecoder)
 
 protected:
-	template<class T, class U> void InnerLoop(T* sda, U* scl, I2CWaveform* cap);
+	void InnerLoop(DigitalEdgeList* sda, DigitalEdgeList* scl, I2CWaveform* cap);
 };
 
 #endif
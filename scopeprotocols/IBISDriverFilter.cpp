@@ -143,6 +143,41 @@ void IBISDriverFilter::OnModelChanged()
 	}
 }
 
+/**
+	@brief Advances to the next edge if we're past the initial propagation delay of the upcoming edge
+
+	@param iedge			Index of the edge currently driving the output
+	@param tnow				Timestamp of the current output sample
+	@param edgeTimestamps	Nominal timestamp of each edge
+	@param edgeDirections	True for rising edges, false for falling
+	@param rising_delay		Buffer propagation delay for rising edges
+	@param falling_delay	Buffer propagation delay for falling edges
+
+	@return Index of the edge driving the output at tnow
+ */
+size_t IBISDriverFilter::NextEdge(
+	size_t iedge,
+	int64_t tnow,
+	const vector<int64_t>& edgeTimestamps,
+	const vector<bool>& edgeDirections,
+	int64_t rising_delay,
+	int64_t falling_delay)
+{
+	if( (iedge + 1) >= edgeTimestamps.size())
+		return iedge;
+
+	//Shift the nominal timestamp of the edge by the buffer delay
+	int64_t tdelayed = edgeTimestamps[iedge+1];
+	if(edgeDirections[iedge+1])
+		tdelayed += rising_delay;
+	else
+		tdelayed += falling_delay;
+
+	if(tnow >= tdelayed)
+		return iedge + 1;
+	return iedge;
+}
+
 void IBISDriverFilter::Refresh()
 {
 	//If we don't have a model, nothing to do
@@ -227,40 +262,43 @@ void IBISDriverFilter::Refresh()
 		return;
 	}
 
-	//Generate output samples at uniform intervals
+	//Find the edge each block of output samples starts in.
+	//This is a cheap serial pass; the interpolation itself is done in parallel below.
+	const size_t blocksize = 16384;
+	size_t nblocks = (caplen + blocksize - 1) / blocksize;
+	vector<size_t> blockEdges(nblocks);
 	size_t iedge = 0;
 	for(size_t i=0; i<caplen; i++)
 	{
-		//Timestamp of the current output sample
-		int64_t tnow = cap->m_timescale*i + cap->m_triggerPhase;
+		if( (i % blocksize) == 0)
+			blockEdges[i / blocksize] = iedge;
+		iedge = NextEdge(iedge, cap->m_timescale*i + cap->m_triggerPhase, edgeTimestamps, edgeDirections,
+			rising_delay, falling_delay);
+	}
 
-		//Find timestamp of the next edge (including buffer propagation delay)
-		if( (iedge + 1) < edgeTimestamps.size())
+	//Generate output samples at uniform intervals
+	auto& risingTable = rising.GetTable(corner);
+	auto& fallingTable = falling.GetTable(corner);
+	float* out = cap->m_samples.GetCpuPointer();
+	#pragma omp parallel for
+	for(size_t block=0; block<nblocks; block++)
+	{
+		size_t jedge = blockEdges[block];
+		size_t end = min(caplen, (block+1) * blocksize);
+		for(size_t i=block*blocksize; i<end; i++)
 		{
-			//Nominal timestamp of the edge
-			int64_t tnextedge = edgeTimestamps[iedge+1];
-
-			//Shift by the buffer delay
-			int64_t tdelayed = tnextedge;
-			if(edgeDirections[iedge+1])
-				tdelayed += rising_delay;
+			//Timestamp of the current output sample
+			int64_t tnow = cap->m_timescale*i + cap->m_triggerPhase;
+			jedge = NextEdge(jedge, tnow, edgeTimestamps, edgeDirections, rising_delay, falling_delay);
+
+			//Time since the edge started
+			int64_t relative_timestamp = tnow - edgeTimestamps[jedge];
+			float rel_sec = relative_timestamp * SECONDS_PER_FS;
+			if(edgeDirections[jedge])
+				out[i] = risingTable.Lookup(rel_sec);
 			else
-				tdelayed += falling_delay;
-
-			//Move to the next edge if we're past the initial propagation delay of the upcoming edge
-			if(tnow >= tdelayed)
-				iedge ++;
+				out[i] = fallingTable.Lookup(rel_sec);
 		}
-
-		//Time since the edge started
-		int64_t relative_timestamp = tnow - edgeTimestamps[iedge];
-		float rel_sec = relative_timestamp * SECONDS_PER_FS;
-		float v;
-		if(edgeDirections[iedge])
-			v = rising.InterpolateVoltage(corner, rel_sec);
-		else
-			v = falling.InterpolateVoltage(corner, rel_sec);
-		cap->m_samples[i] = v;
 	}
 
 	cap->MarkModifiedFromCpu();
@@ -54,6 +54,14 @@ protected:
 	void OnFnameChanged();
 	void OnModelChanged();
 
+	static size_t NextEdge(
+		size_t iedge,
+		int64_t tnow,
+		const std::vector<int64_t>& edgeTimestamps,
+		const std::vector<bool>& edgeDirections,
+		int64_t rising_delay,
+		int64_t falling_delay);
+
 	IBISParser m_parser;
 	IBISModel* m_model;
 
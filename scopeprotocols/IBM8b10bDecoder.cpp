@@ -85,6 +85,185 @@ string IBM8b10bDecoder::GetProtocolName()
 	return "8b/10b (IBM)";
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Code group lookup table
+
+/**
+	@brief Everything about a single 10-bit code group which can be determined without knowing the running disparity
+ */
+class IBM8b10bCodeInfo
+{
+public:
+	///@brief Decoded 8-bit value (3b in the high bits, 5b in the low bits)
+	uint8_t m_data;
+
+	///@brief Disparity of the code group (sum of the 6b and 4b sub-block disparities)
+	int8_t m_disparity;
+
+	///@brief True if this is a K (control) character
+	bool m_control;
+
+	///@brief True if the 6b sub-block is not a valid code
+	bool m_error5;
+
+	///@brief True if the 4b sub-block is not a valid code
+	bool m_error3;
+};
+
+/**
+	@brief Builds the combined 1024-entry decode table, indexed by the 10-bit code group (first bit in the MSB)
+
+	The 6b/4b sub-block tables are only used here, so the per-symbol decode in Refresh() is a single lookup.
+ */
+static vector<IBM8b10bCodeInfo> BuildIBM8b10bDecodeTable()
+{
+	vector<IBM8b10bCodeInfo> table(1024);
+
+	static const int code5_table[64] =
+	{
+		 0,  0,  0,  0,  0, 23,  8,  7,	//00-07
+		 0, 27,  4, 20, 24, 12, 28, 28, //08-0f
+		 0, 29,  2, 18, 31, 10, 26, 15, //10-17
+		 0,  6, 22, 16, 14,  1, 30,  0,	//18-1f
+		 0, 30, 1,  17, 16,  9, 25,  0,	//20-27
+		15,  5, 21, 31, 13,  2, 29,  0,	//28-2f
+		28,  3, 19, 24, 11,  4, 27,  0,	//30-37
+		 7,  8, 23,  0,  0,  0,  0,  0  //38-3f
+	};
+
+	static const int disp5_table[64] =
+	{
+		 0,  0,  0, 0,  0, -2, -2, 0,	//00-07
+		 0, -2, -2, 0, -2,  0,  0, 2,	//08-0f
+		 0, -2, -2, 0, -2,  0,  0, 2,	//10-17
+		-2,  0,  0, 2,  0,  2,  2, 0,	//18-1f
+		 0, -2, -2, 0, -2,  0,  0, 2,	//20-27
+		-2,  0,  0, 2,  0,  2,  2, 0,	//28-2f
+		-2,  0,  0, 2,  0,  2,  2, 0,	//30-37
+		 0,  2,  2, 0,  0,  0,  0, 0 	//38-3f
+	};
+
+	static const bool err5_table[64] =
+	{
+		 true,  true,  true,  true,  true, false, false, false,	//00-07
+		 true, false, false, false, false, false, false, false, //08-0f
+		 true, false, false, false, false, false, false, false, //10-17
+		false, false, false, false, false, false, false,  true,	//18-1f
+		 true, false, false, false, false, false, false, false,	//20-27
+		false, false, false, false, false, false, false,  true,	//28-2f
+		false, false, false, false, false, false, false,  true,	//30-37
+		false, false, false,  true,  true,  true,  true,  true  //38-3f
+	};
+
+	static const bool ctl5_table[64] =
+	{
+		false, false, false, false, false, false, false, false,	//00-07
+		false, false, false, false, false, false, false, true,  //08-0f
+		false, false, false, false, false, false, false, false, //10-17
+		false, false, false, false, false, false, false, false,	//18-1f
+		false, false, false, false, false, false, false, false,	//20-27
+		false, false, false, false, false, false, false, false,	//28-2f
+		true,  false, false, false, false, false, false, false,	//30-37
+		false, false, false, false, false, false, false, false  //38-3f
+	};
+
+	static const bool err3_ctl_table[16] =
+	{
+		 true,  true, false, false, false, false, false, false,
+		false, false, false, false, false, false,  true,  true
+	};
+
+	static const int code3_pos_ctl_table[16] =	//if disp5 positive
+	{
+		0, 0, 4, 3, 0, 2, 6, 7,
+		7, 1, 5, 0, 3, 4, 0, 0,
+	};
+
+	static const int code3_neg_ctl_table[16] =	//if disp5 negative
+	{
+		0, 0, 4, 3, 0, 5, 1, 7,
+		7, 6, 2, 0, 3, 4, 0, 0
+	};
+
+	static const bool err3_table[16] =
+	{
+		 true,  false, false, false, false, false, false, false,
+		false, false, false, false, false, false, false,  true
+	};
+
+	static const int code3_table[16] =
+	{
+		0, 7, 4, 3, 0, 2, 6, 7,
+		7, 1, 5, 0, 3, 4, 7, 0
+	};
+
+	static const int disp3_table[16] =
+	{
+		 0, -2, -2, 0, -2, 0, 0, 2,
+		-2, 0,  0, 2,  0, 2, 2, 0
+	};
+
+	//true only for Dx.A7
+	static const bool alt3_table[16] =
+	{
+		0, 0, 0, 0, 0, 0, 0, 1,
+		1, 0, 0, 0, 0, 0, 0, 0
+	};
+
+	for(unsigned int code10=0; code10<1024; code10++)
+	{
+		unsigned int code6 = code10 >> 4;
+		unsigned int code4 = code10 & 0xf;
+
+		//5b/6b decode
+		int code5 = code5_table[code6];
+		int disp5 = disp5_table[code6];
+		bool ctl5 = ctl5_table[code6];
+
+		//3b/4b decode
+		int code3;
+		bool err3;
+		if(ctl5)
+		{
+			if(disp5 >= 0)
+				code3 = code3_pos_ctl_table[code4];
+			else
+				code3 = code3_neg_ctl_table[code4];
+			err3 = err3_ctl_table[code4];
+		}
+		else
+		{
+			code3 = code3_table[code4];
+			err3 = err3_table[code4];
+		}
+
+		//Special processing for a few control codes that use the .A7 format
+		if(alt3_table[code4])
+		{
+			if( (code5 == 23) || (code5 == 27) || (code5 == 29) || (code5 == 30) )
+				ctl5 = true;
+		}
+
+		auto& info = table[code10];
+		info.m_data = (code3 << 5) | code5;
+		info.m_disparity = disp5 + disp3_table[code4];
+		info.m_control = ctl5;
+		info.m_error5 = err5_table[code6];
+		info.m_error3 = err3;
+	}
+
+	return table;
+}
+
+/**
+	@brief Gets the combined decode table (built on first use)
+ */
+static const IBM8b10bCodeInfo* GetIBM8b10bDecodeTable()
+{
+	static const vector<IBM8b10bCodeInfo> table = BuildIBM8b10bDecodeTable();
+	return table.data();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
@@ -122,6 +301,7 @@ void IBM8b10bDecoder::Refresh()
 	cap->Reserve(data.m_samples.size() / 10);
 
 	//Decode the actual data
+	auto table = GetIBM8b10bDecodeTable();
 	int last_disp = -1;
 	bool first = true;
 	size_t nsamples = data.m_samples.size();
@@ -151,139 +331,14 @@ void IBM8b10bDecoder::Refresh()
 			Align(data, i);
 		}
 
-		//5b/6b decode
-
-		uint8_t code6 =
-			(data.m_samples[i+0] ? 32 : 0) |
-			(data.m_samples[i+1] ? 16 : 0) |
-			(data.m_samples[i+2] ? 8 : 0) |
-			(data.m_samples[i+3] ? 4 : 0) |
-			(data.m_samples[i+4] ? 2 : 0) |
-			(data.m_samples[i+5] ? 1 : 0);
-
-		static const int code5_table[64] =
-		{
-			 0,  0,  0,  0,  0, 23,  8,  7,	//00-07
-			 0, 27,  4, 20, 24, 12, 28, 28, //08-0f
-			 0, 29,  2, 18, 31, 10, 26, 15, //10-17
-			 0,  6, 22, 16, 14,  1, 30,  0,	//18-1f
-			 0, 30, 1,  17, 16,  9, 25,  0,	//20-27
-			15,  5, 21, 31, 13,  2, 29,  0,	//28-2f
-			28,  3, 19, 24, 11,  4, 27,  0,	//30-37
-			 7,  8, 23,  0,  0,  0,  0,  0  //38-3f
-		};
-
-		static const int disp5_table[64] =
-		{
-			 0,  0,  0, 0,  0, -2, -2, 0,	//00-07
-			 0, -2, -2, 0, -2,  0,  0, 2,	//08-0f
-			 0, -2, -2, 0, -2,  0,  0, 2,	//10-17
-			-2,  0,  0, 2,  0,  2,  2, 0,	//18-1f
-			 0, -2, -2, 0, -2,  0,  0, 2,	//20-27
-			-2,  0,  0, 2,  0,  2,  2, 0,	//28-2f
-			-2,  0,  0, 2,  0,  2,  2, 0,	//30-37
-			 0,  2,  2, 0,  0,  0,  0, 0 	//38-3f
-		};
-
-		static const bool err5_table[64] =
-		{
-			 true,  true,  true,  true,  true, false, false, false,	//00-07
-			 true, false, false, false, false, false, false, false, //08-0f
-			 true, false, false, false, false, false, false, false, //10-17
-			false, false, false, false, false, false, false,  true,	//18-1f
-			 true, false, false, false, false, false, false, false,	//20-27
-			false, false, false, false, false, false, false,  true,	//28-2f
-			false, false, false, false, false, false, false,  true,	//30-37
-			false, false, false,  true,  true,  true,  true,  true  //38-3f
-		};
-
-		static const bool ctl5_table[64] =
-		{
-			false, false, false, false, false, false, false, false,	//00-07
-			false, false, false, false, false, false, false, true,  //08-0f
-			false, false, false, false, false, false, false, false, //10-17
-			false, false, false, false, false, false, false, false,	//18-1f
-			false, false, false, false, false, false, false, false,	//20-27
-			false, false, false, false, false, false, false, false,	//28-2f
-			true,  false, false, false, false, false, false, false,	//30-37
-			false, false, false, false, false, false, false, false  //38-3f
-		};
-
-		int code5 = code5_table[code6];
-		int disp5 = disp5_table[code6];
-		bool err5 = err5_table[code6];
-		bool ctl5 = ctl5_table[code6];
-
-		//3b/4b decode
-		uint8_t code4 =
-			(data.m_samples[i+6] ? 8 : 0) |
-			(data.m_samples[i+7] ? 4 : 0) |
-			(data.m_samples[i+8] ? 2 : 0) |
-			(data.m_samples[i+9] ? 1 : 0);
-
-		static const bool err3_ctl_table[16] =
-		{
-			 true,  true, false, false, false, false, false, false,
-			false, false, false, false, false, false,  true,  true
-		};
-
-		static const int code3_pos_ctl_table[16] =	//if disp5 positive
-		{
-			0, 0, 4, 3, 0, 2, 6, 7,
-			7, 1, 5, 0, 3, 4, 0, 0,
-		};
-
-		static const int code3_neg_ctl_table[16] =	//if disp5 negative
-		{
-			0, 0, 4, 3, 0, 5, 1, 7,
-			7, 6, 2, 0, 3, 4, 0, 0
-		};
-
-		static const bool err3_table[16] =
-		{
-			 true,  false, false, false, false, false, false, false,
-			false, false, false, false, false, false, false,  true
-		};
-
-		static const int code3_table[16] =
-		{
-			0, 7, 4, 3, 0, 2, 6, 7,
-			7, 1, 5, 0, 3, 4, 7, 0
-		};
-
-		static const int disp3_table[16] =
-		{
-			 0, -2, -2, 0, -2, 0, 0, 2,
-			-2, 0,  0, 2,  0, 2, 2, 0
-		};
-
-		//true only for Dx.A7
-		const bool alt3_table[16] =
-		{
-			0, 0, 0, 0, 0, 0, 0, 1,
-			1, 0, 0, 0, 0, 0, 0, 0
-		};
-
-		int code3 = false;
-		int disp3 = 0;
-		int err3 = false;
-		if(ctl5)
-		{
-			if(disp5 >= 0)
-				code3 = code3_pos_ctl_table[code4];
-			else
-				code3 = code3_neg_ctl_table[code4];
-			err3 = err3_ctl_table[code4];
-		}
-		else
-		{
-			code3 = code3_table[code4];
-			err3 = err3_table[code4];
-		}
-		disp3 = disp3_table[code4];
+		//Gather the code group (first bit in the MSB) and decode it
+		unsigned int code10 = 0;
+		for(size_t j=0; j<10; j++)
+			code10 = (code10 << 1) | (data.m_samples[i+j] ? 1 : 0);
+		auto& info = table[code10];
 
 		//Disparity tracking
-		int total_disp = disp3 + disp5;
+		int total_disp = info.m_disparity;
 		if(first)
 		{
 			if(total_disp < 0)
@@ -307,14 +362,6 @@ void IBM8b10bDecoder::Refresh()
 		else
 			last_disp += total_disp;
 
-		//Special processing for a few control codes that use the .A7 format
-		bool alt = alt3_table[code4];
-		if(alt)
-		{
-			if( (code5 == 23) || (code5 == 27) || (code5 == 29) || (code5 == 30) )
-				ctl5 = true;
-		}
-
 		//Horizontally shift the decoded symbol back by half a UI
 		//since the recovered clock edge is in the middle of the UI.
 		//We want the decoded signal boundaries to line up with the data edge, not the middle of the UI.
@@ -329,7 +376,7 @@ void IBM8b10bDecoder::Refresh()
 		{
 			cap->m_offsets.push_back(symbolStart);
 			cap->m_durations.push_back(lastSymbolLength);
-			cap->m_samples.push_back(IBM8b10bSymbol(ctl5, err5, err3, disperr, (code3 << 5) | code5, last_disp));
+			cap->m_samples.push_back(IBM8b10bSymbol(info.m_control, info.m_error5, info.m_error3, disperr, info.m_data, last_disp));
 		}
 
 		//If we're in the cool-down window after a resync, don't try to resync immediately
@@ -339,7 +386,7 @@ void IBM8b10bDecoder::Refresh()
 		//Monitor errors
 		else
 		{
-			if(err3 || err5 || disperr)
+			if(info.m_error3 || info.m_error5 || disperr)
 			{
 				numBadSymbols ++;
 				timeSinceBadSymbol = 0;
@@ -30,6 +30,7 @@
 #include "../scopehal/scopehal.h"
 #include "IPv4Decoder.h"
 #include "EthernetProtocolDecoder.h"
+#include "EthernetFlowTable.h"
 
 using namespace std;
 
@@ -76,324 +77,72 @@ void IPv4Decoder::Refresh()
 		return;
 	}
 
-	//Get the input data
+	//Get the input data, with all of the headers already parsed
 	auto din = dynamic_cast<EthernetWaveform*>(GetInputWaveform(0));
-	din->PrepareForCpuAccess();
-	size_t len = din->m_samples.size();
+	auto flows = din->GetFlowTable();
 
-	//Loop over the events and process stuff
 	auto cap = SetupEmptyWaveform<IPv4Waveform>(din, 0);
 	cap->PrepareForCpuAccess();
+	cap->m_flows = flows;
 
-	int state = 0;
-	int header_len = 0;
-	for(size_t i=0; i<len; i++)
+	for(size_t nframe=0; nframe<flows->m_frames.size(); nframe++)
 	{
-		auto s = din->m_samples[i];
-		int64_t halfdur = din->m_durations[i]/2;
-
-		switch(state)
+		auto& f = flows->m_frames[nframe];
+		if(!f.m_ipv4)
+			continue;
+		auto& ip = f.m_ip;
+		const uint8_t* p = flows->GetFrameBytes(nframe) + f.m_payloadStart;
+		size_t base = f.m_payloadSample;
+
+		//Adds a symbol spanning payload bytes [first, first+n)
+		auto add = [&](size_t first, size_t n, IPv4Symbol::SegmentType type, const vector<uint8_t>& data)
 		{
-			//Wait for SFD. Ignore any errors, preambles, etc before this
-			case 0:
-				if(s.m_type == EthernetFrameSegment::TYPE_SFD)
-					state = 1;
-				break;
-
-			//Next should be dest MAC. Ignore it
-			case 1:
-				if(s.m_type == EthernetFrameSegment::TYPE_DST_MAC)
-					state = 2;
-				else
-					state = 0;
-				break;
-
-			//Then source MAC
-			case 2:
-				if(s.m_type == EthernetFrameSegment::TYPE_SRC_MAC)
-					state = 3;
-				else
-					state = 0;
-				break;
-
-			//Next is ethertype. Could be 802.1q or IPv4.
-			case 3:
-				if(s.m_type == EthernetFrameSegment::TYPE_ETHERTYPE)
-				{
-					uint16_t ethertype = (s.m_data[0] << 8) | s.m_data[1];
-
-					//802.1q tag
-					if(ethertype == 0x8100)
-						state = 4;
-
-					//IPv4
-					else if(ethertype == 0x0800)
-						state = 5;
-
-					//Something else, discard the packet as uninteresting
-					else
-						state = 0;
-				}
-				else
-					state = 0;
-
-				break;
-
-			//802.1q frame? Expect a VLAN tag, then look for the real ethertyoe
-			case 4:
-				if(s.m_type == EthernetFrameSegment::TYPE_VLAN_TAG)
-					state = 3;
-				else
-					state = 0;
-				break;
-
-			//Should be IP version and header length
-			case 5:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					uint8_t data = s.m_data[0];
-
-					//Expect 0x4-something for IP version
-					if( (data >> 4) == 4)
-					{
-						cap->m_offsets.push_back(din->m_offsets[i]);
-						cap->m_durations.push_back(halfdur);
-						cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_VERSION, 4));
-					}
-					else
-					{
-						state = 0;
-						break;
-					}
-
-					//Header length
-					header_len = data & 0xf;
-
-					cap->m_offsets.push_back(din->m_offsets[i] + halfdur);
-					cap->m_durations.push_back(halfdur);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_HEADER_LEN, header_len));
-
-					state = 6;
-				}
-				else
-					state = 0;
-
-				break;
-
-			//Diffserv code point and ECN
-			case 6:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_DIFFSERV, s.m_data[0]));
-					state = 7;
-				}
-				else
-					state = 0;
-				break;
-
-			//Total length
-			case 7:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_LENGTH, s.m_data[0]));
-					state = 8;
-				}
-				else
-					state = 0;
-				break;
-			case 8:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					//Append to the previous sample
-					size_t n = cap->m_offsets.size() - 1;
-					cap->m_durations[n] = din->m_offsets[i] + din->m_durations[i] - cap->m_offsets[n];
-					cap->m_samples[n].m_data.push_back(s.m_data[0]);
-					state = 9;
-				}
-				else
-					state = 0;
-				break;
-
-			//Identification
-			case 9:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_ID, s.m_data[0]));
-					state = 10;
-				}
-				else
-					state = 0;
-				break;
-			case 10:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					//Append to the previous sample
-					size_t n = cap->m_offsets.size() - 1;
-					cap->m_durations[n] = din->m_offsets[i] + din->m_durations[i] - cap->m_offsets[n];
-					cap->m_samples[n].m_data.push_back(s.m_data[0]);
-					state = 11;
-				}
-				else
-					state = 0;
-				break;
-
-			//Flags, frag offset
-			case 11:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					//Flags
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(halfdur);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_FLAGS, s.m_data[0] >> 5));
-
-					//Frag offset, high 5 bits
-					cap->m_offsets.push_back(din->m_offsets[i] + halfdur);
-					cap->m_durations.push_back(halfdur);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_FRAG_OFFSET, s.m_data[0] & 0x1f));
-					state = 12;
-				}
-				else
-					state = 0;
-				break;
-			case 12:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					//Append to the previous sample
-					size_t n = cap->m_offsets.size() - 1;
-					cap->m_durations[n] = din->m_offsets[i] + din->m_durations[i] - cap->m_offsets[n];
-					cap->m_samples[n].m_data.push_back(s.m_data[0]);
-					state = 13;
-				}
-				else
-					state = 0;
-				break;
-
-			//TTL
-			case 13:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_TTL, s.m_data[0]));
-					state = 14;
-				}
-				else
-					state = 0;
-				break;
-
-			//Protocol
-			case 14:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_PROTOCOL, s.m_data[0]));
-					state = 15;
-				}
-				else
-					state = 0;
-				break;
-
-			//Header checksum
-			case 15:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_HEADER_CHECKSUM, s.m_data[0]));
-					state = 16;
-				}
-				else
-					state = 0;
-				break;
-			case 16:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					//Append to the previous sample
-					size_t n = cap->m_offsets.size() - 1;
-					cap->m_durations[n] = din->m_offsets[i] + din->m_durations[i] - cap->m_offsets[n];
-					cap->m_samples[n].m_data.push_back(s.m_data[0]);
-					state = 17;
-				}
-				else
-					state = 0;
-				break;
-
-			//Src IP
-			case 17:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_SOURCE_IP, s.m_data[0]));
-					state = 18;
-				}
-				else
-					state = 0;
-				break;
-			case 18:
-			case 19:
-			case 20:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					//Append to the previous sample
-					size_t n = cap->m_offsets.size() - 1;
-					cap->m_durations[n] = din->m_offsets[i] + din->m_durations[i] - cap->m_offsets[n];
-					cap->m_samples[n].m_data.push_back(s.m_data[0]);
-					state++;
-				}
-				else
-					state = 0;
-				break;
-
-			//Dst IP
-			case 21:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_DEST_IP, s.m_data[0]));
-					state = 22;
-				}
-				else
-					state = 0;
-				break;
-			case 22:
-			case 23:
-			case 24:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					//Append to the previous sample
-					size_t n = cap->m_offsets.size() - 1;
-					cap->m_durations[n] = din->m_offsets[i] + din->m_durations[i] - cap->m_offsets[n];
-					cap->m_samples[n].m_data.push_back(s.m_data[0]);
-					state++;
-				}
-				else
-					state = 0;
-				break;
-
-			//TODO: support header options
-			case 25:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_DATA, s.m_data[0]));
-				}
-
-				//terminate the packet on FCS or error
-				else
-					state = 0;
-				break;
-
-		}
+			size_t last = base + first + n - 1;
+			cap->m_offsets.push_back(din->m_offsets[base + first]);
+			cap->m_durations.push_back(din->m_offsets[last] + din->m_durations[last] - din->m_offsets[base + first]);
+			cap->m_samples.push_back(IPv4Symbol(type, 0));
+			cap->m_samples[cap->m_samples.size() - 1].m_data = data;
+		};
+
+		//Version and header length share the first byte, as do flags and the top of the fragment offset
+		int64_t off = din->m_offsets[base];
+		int64_t halfdur = din->m_durations[base] / 2;
+		cap->m_offsets.push_back(off);
+		cap->m_durations.push_back(halfdur);
+		cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_VERSION, 4));
+		cap->m_offsets.push_back(off + halfdur);
+		cap->m_durations.push_back(halfdur);
+		cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_HEADER_LEN, ip.m_headerLen));
+
+		add(1, 1, IPv4Symbol::TYPE_DIFFSERV, {ip.m_diffserv});
+		add(2, 2, IPv4Symbol::TYPE_LENGTH, {p[2], p[3]});
+		add(4, 2, IPv4Symbol::TYPE_ID, {p[4], p[5]});
+
+		off = din->m_offsets[base + 6];
+		halfdur = din->m_durations[base + 6] / 2;
+		cap->m_offsets.push_back(off);
+		cap->m_durations.push_back(halfdur);
+		cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_FLAGS, ip.m_flags));
+		cap->m_offsets.push_back(off + halfdur);
+		cap->m_durations.push_back(din->m_offsets[base + 7] + din->m_durations[base + 7] - (off + halfdur));
+		cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_FRAG_OFFSET, 0));
+		cap->m_samples[cap->m_samples.size() - 1].m_data = {static_cast<uint8_t>(p[6] & 0x1f), p[7]};
+
+		add(8, 1, IPv4Symbol::TYPE_TTL, {ip.m_ttl});
+		add(9, 1, IPv4Symbol::TYPE_PROTOCOL, {ip.m_protocol});
+		add(10, 2, IPv4Symbol::TYPE_HEADER_CHECKSUM, {p[10], p[11]});
+		add(12, 4, IPv4Symbol::TYPE_SOURCE_IP, {p[12], p[13], p[14], p[15]});
+		add(16, 4, IPv4Symbol::TYPE_DEST_IP, {p[16], p[17], p[18], p[19]});
+
+		//Options and data, stopping at the end of the datagram (rather than running into Ethernet padding)
+		size_t avail = min(f.m_len - f.m_payloadStart, static_cast<size_t>(ip.m_length));
+		size_t hlen = min(avail, max(static_cast<size_t>(ip.m_headerLen) * 4, static_cast<size_t>(20)));
+		for(size_t i=20; i<hlen; i++)
+			add(i, 1, IPv4Symbol::TYPE_OPTIONS, {p[i]});
+
+		cap->m_datagrams.push_back({nframe, cap->m_samples.size(), avail - hlen});
+		for(size_t i=hlen; i<avail; i++)
+			add(i, 1, IPv4Symbol::TYPE_DATA, {p[i]});
 	}
 
 	//TODO: packet decode too
@@ -73,12 +73,34 @@ public:
 	}
 };
 
+class EthernetFlowTable;
+
 class IPv4Waveform : public SparseWaveform<IPv4Symbol>
 {
 public:
 	IPv4Waveform () : SparseWaveform<IPv4Symbol>() {};
 	virtual std::string GetText(size_t) override;
 	virtual std::string GetColor(size_t) override;
+
+	///@brief Where one datagram's symbols are
+	class Datagram
+	{
+	public:
+		///@brief Index of the frame in m_flows->m_frames
+		size_t m_frame;
+
+		///@brief Index of the first TYPE_DATA symbol. Data byte k is always symbol m_dataSymbol + k.
+		size_t m_dataSymbol;
+
+		///@brief Number of TYPE_DATA symbols
+		size_t m_dataLen;
+	};
+
+	///@brief Flow table of the Ethernet waveform this was decoded from, with the parsed headers of each datagram
+	std::shared_ptr<const EthernetFlowTable> m_flows;
+
+	///@brief All datagrams, in order
+	std::vector<Datagram> m_datagrams;
 };
 
 class IPv4Decoder : public Filter
@@ -80,8 +80,14 @@ void ISIMeasurement::Refresh()
 
 	//Get the input data
 	auto ddj = dynamic_cast<DDJMeasurement*>(GetInput(0).m_channel);
-	float* table = ddj->GetDDJTable();
+	m_streams[0].m_value = CalculateISI(ddj->GetDDJTable());
+}
 
+/**
+	@brief Calculates ISI from a 256-entry DDJ table, as returned by DDJMeasurement::GetDDJTable()
+ */
+float ISIMeasurement::CalculateISI(const float* table)
+{
 	//Check all of the bins and find total jitter for rising and falling edges.
 	//Note that the table has LSB most recent, so 10...... is a rising edge and 01...... is a falling edge.
 	//We check for zero in case the table is incomplete (this should not drag the mean down).
@@ -109,5 +115,5 @@ void ISIMeasurement::Refresh()
 	float rising_pp = rising_max - falling_min;
 	float falling_pp = falling_max - falling_min;
 
-	m_streams[0].m_value = max(rising_pp, falling_pp);
+	return max(rising_pp, falling_pp);
 }
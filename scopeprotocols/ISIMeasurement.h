@@ -46,6 +46,8 @@ public:
 
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
+	static float CalculateISI(const float* table);
+
 	PROTOCOL_DECODER_INITPROC(ISIMeasurement)
 };
 
@@ -116,3 +116,22 @@ void InvertFilter::Refresh()
 		cap->MarkModifiedFromCpu();
 	}
 }
+
+bool InvertFilter::SetupElementwiseOp(ElementwiseOp& op)
+{
+	if(!VerifyAllInputsOK())
+		return false;
+	auto udin = dynamic_cast<UniformAnalogWaveform*>(GetInputWaveform(0));
+	if(!udin)
+		return false;
+
+	size_t len = udin->size();
+	auto cap = SetupEmptyUniformAnalogOutputWaveform(udin, 0);
+	cap->Resize(len);
+
+	op.m_type = ElementwiseOp::OP_NEGATE;
+	op.m_inputs[0] = udin;
+	op.m_output = cap;
+	op.m_len = len;
+	return true;
+}
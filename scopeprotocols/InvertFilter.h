@@ -41,6 +41,7 @@ public:
 	InvertFilter(const std::string& color);
 
 	virtual void Refresh() override;
+	virtual bool SetupElementwiseOp(ElementwiseOp& op) override;
 
 	static std::string GetProtocolName();
 	virtual void SetDefaultName() override;
@@ -105,12 +105,6 @@ void J1939BitmaskDecoder::Refresh()
 	auto cap = SetupEmptySparseDigitalOutputWaveform(din, 0);
 	cap->PrepareForCpuAccess();
 
-	enum
-	{
-		STATE_IDLE,
-		STATE_DATA,
-	} state = STATE_IDLE;
-
 	//Initial sample at time zero
 	cap->m_offsets.push_back(0);
 	cap->m_durations.push_back(0);
@@ -121,67 +115,37 @@ void J1939BitmaskDecoder::Refresh()
 	auto targetaddr = m_parameters[m_pgn].GetIntVal() ;
 
 	//TODO: support >8 byte packetds
-	int64_t framestart = 0;
-	int64_t payload = 0;
-	for(size_t i=0; i<len; i++)
+	auto index = din->GetFrameIndex();
+	for(auto nframe : index->GetFramesWithPGN(targetaddr))
 	{
-		auto& s = din->m_samples[i];
-
-		switch(state)
+		//Don't use the last PDU until the next one starts, it may not have all of its data bytes yet
+		auto& frame = index->m_frames[nframe];
+		if(!frame.m_complete)
+			continue;
+
+		//Read the actual data bytes, MSB first
+		int64_t payload = 0;
+		for(size_t i=frame.m_src+1; i<frame.m_end; i++)
 		{
-			//Look for a PGN (ignore anything else)
-			case STATE_IDLE:
-				if(s.m_stype == J1939PDUSymbol::TYPE_PGN)
-				{
-					//ID match?
-					if(targetaddr == s.m_data)
-					{
-						framestart = din->m_offsets[i] * din->m_timescale;
-						payload = 0;
-						state = STATE_DATA;
-					}
-
-					//otherwise ignore the frame, not interesting
-				}
-				break;
-
-			//Read the actual data bytes, MSB first
-			case STATE_DATA:
-				if(s.m_stype == J1939PDUSymbol::TYPE_DATA)
-				{
-					//Grab the data byte
-					payload = (payload << 8) | s.m_data;
-
-					//Extend the previous sample to the start of this frame
-					size_t nlast = cap->m_offsets.size() - 1;
-					cap->m_durations[nlast] = framestart - cap->m_offsets[nlast];
-				}
-
-				//Starting a new frame? This one is over, add the new sample
-				else if(s.m_stype == J1939PDUSymbol::TYPE_PRI)
-				{
-					//Check the bitmask and add a new sample
-					cap->m_offsets.push_back(framestart);
-					cap->m_durations.push_back(0);
-
-					if( (payload & mask) == pattern )
-						cap->m_samples.push_back(true);
-					else
-						cap->m_samples.push_back(false);
-
-					state = STATE_IDLE;
-				}
-
-				//Ignore anything else
-				break;
-
-			default:
-				break;
+			auto& s = din->m_samples[i];
+			if(s.m_stype == J1939PDUSymbol::TYPE_DATA)
+				payload = (payload << 8) | s.m_data;
 		}
 
-		//If we see a SOF previous frame was truncated, reset
-		if(s.m_stype == J1939PDUSymbol::TYPE_PRI)
-			state = STATE_IDLE;
+		//Extend the previous sample to the start of this frame
+		int64_t framestart = din->m_offsets[frame.m_pgn] * din->m_timescale;
+		size_t nlast = cap->m_offsets.size() - 1;
+		cap->m_durations[nlast] = framestart - cap->m_offsets[nlast];
+
+		//Add the new sample
+		cap->m_offsets.push_back(framestart);
+		cap->m_durations.push_back(0);
+
+		//Check the bitmask
+		if( (payload & mask) == pattern )
+			cap->m_samples.push_back(true);
+		else
+			cap->m_samples.push_back(false);
 	}
 
 	//Extend the last sample to the end of the capture
@@ -38,6 +38,9 @@ using namespace std;
 
 J1939PDUDecoder::J1939PDUDecoder(const string& color)
 	: PacketDecoder(color, CAT_BUS)
+	, m_state(STATE_IDLE)
+	, m_bytesleft(0)
+	, m_pack(nullptr)
 {
 	CreateInput("can");
 }
@@ -85,42 +88,55 @@ string J1939PDUDecoder::GetProtocolName()
 
 void J1939PDUDecoder::Refresh()
 {
-	ClearPackets();
-
 	if(!VerifyAllInputsOK())
 	{
+		ClearPackets();
 		SetData(nullptr, 0);
 		return;
 	}
 
 	auto din = dynamic_cast<CANWaveform*>(GetInputWaveform(0));
-	auto len = din->size();
 	if(!din)
 	{
+		ClearPackets();
 		SetData(nullptr, 0);
 		return;
 	}
+	auto len = din->size();
 
-	//Create the capture
-	auto cap = new J1939PDUWaveform;
-	cap->m_timescale = 1;
-	cap->m_startTimestamp = din->m_startTimestamp;
-	cap->m_startFemtoseconds = din->m_startFemtoseconds;
-	cap->m_triggerPhase = 0;
-	cap->PrepareForCpuAccess();
-	SetData(cap, 0);
+	//If the analyzer only appended to the waveform we saw last time, pick up where we left off
+	size_t istart = GetAppendStart(0, din);
+	J1939PDUWaveform* cap = nullptr;
+	if(istart != 0)
+	{
+		cap = dynamic_cast<J1939PDUWaveform*>(GetData(0));
+		cap->PrepareForCpuAccess();
+	}
 
-	enum
+	//Nope, start over with a new capture
+	else
 	{
-		STATE_IDLE,
-		STATE_DLC,
-		STATE_DATA
-	} state = STATE_IDLE;
+		ClearPackets();
+		m_state = STATE_IDLE;
+		m_bytesleft = 0;
+		m_pack = nullptr;
+
+		cap = new J1939PDUWaveform;
+		cap->m_timescale = 1;
+		cap->m_startTimestamp = din->m_startTimestamp;
+		cap->m_startFemtoseconds = din->m_startFemtoseconds;
+		cap->m_triggerPhase = 0;
+		cap->PrepareForCpuAccess();
+		SetData(cap, 0);
+	}
+
+	din->PrepareForCpuAccess();
 
 	//Process the CAN packet stream
-	size_t bytesleft = 0;
-	Packet* pack = nullptr;
-	for(size_t i=0; i<len; i++)
+	auto state = m_state;
+	size_t bytesleft = m_bytesleft;
+	Packet* pack = m_pack;
+	for(size_t i=istart; i<len; i++)
 	{
 		auto& s = din->m_samples[i];
 
@@ -231,6 +247,7 @@ void J1939PDUDecoder::Refresh()
 					{
 						state = STATE_IDLE;
 						pack->m_len = tend - pack->m_offset;
+						m_packetIndex.ExtendMaxLength(pack->m_len);
 					}
 				}
 
@@ -250,13 +267,85 @@ void J1939PDUDecoder::Refresh()
 			state = STATE_IDLE;
 	}
 
+	//Save state so the next update can resume from here
+	m_state = state;
+	m_bytesleft = bytesleft;
+	m_pack = pack;
+
 	//Done updating
+	if(istart != 0)
+		cap->m_revision ++;
 	cap->MarkModifiedFromCpu();
+	CommitAppend(din);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// J1939FrameIndex
+
+/**
+	@brief Builds the index by walking the symbol stream once
+
+	@param wfm	The waveform to index (must be valid on the CPU)
+ */
+J1939FrameIndex::J1939FrameIndex(J1939PDUWaveform* wfm)
+{
+	size_t len = wfm->size();
+
+	//Find the start of each PDU and check its headers are in order
+	Frame* frame = nullptr;
+	for(size_t i=0; i<len; i++)
+	{
+		auto& s = wfm->m_samples[i];
+		if(s.m_stype != J1939PDUSymbol::TYPE_PRI)
+			continue;
+
+		//Previous PDU ends here
+		if(frame)
+		{
+			frame->m_end = i;
+			frame->m_complete = true;
+			frame = nullptr;
+		}
+
+		size_t ipgn = i+1;
+		size_t isrc = ipgn+1;
+		while( (isrc < len) && (wfm->m_samples[isrc].m_stype == J1939PDUSymbol::TYPE_DEST) )
+			isrc ++;
+		if( (isrc >= len) ||
+			(wfm->m_samples[ipgn].m_stype != J1939PDUSymbol::TYPE_PGN) ||
+			(wfm->m_samples[isrc].m_stype != J1939PDUSymbol::TYPE_SRC) )
+		{
+			continue;
+		}
+
+		m_framesByPGN[wfm->m_samples[ipgn].m_data].push_back(m_frames.size());
+		m_framesBySource[wfm->m_samples[isrc].m_data].push_back(m_frames.size());
+		m_frames.push_back({i, ipgn, isrc, len, false});
+		frame = &m_frames.back();
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // J1939PDUWaveform
 
+///@brief Mutex protecting the frame index of every J1939PDUWaveform
+static mutex g_j1939FrameIndexMutex;
+
+/**
+	@brief Returns the frame index for this waveform, building it if the waveform changed since it was last built
+ */
+shared_ptr<const J1939FrameIndex> J1939PDUWaveform::GetFrameIndex()
+{
+	lock_guard<mutex> lock(g_j1939FrameIndexMutex);
+	if(!m_frameIndex || (m_frameIndexRevision != m_revision))
+	{
+		PrepareForCpuAccess();
+		m_frameIndex = make_shared<J1939FrameIndex>(this);
+		m_frameIndexRevision = m_revision;
+	}
+	return m_frameIndex;
+}
+
 string J1939PDUWaveform::GetColor(size_t i)
 {
 	const J1939PDUSymbol& s = m_samples[i];
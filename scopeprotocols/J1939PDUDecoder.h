@@ -67,12 +67,84 @@ public:
 	}
 };
 
+class J1939PDUWaveform;
+
+/**
+	@brief Locations of every PDU in a J1939PDUWaveform, grouped by PGN and by source address
+
+	Built once per waveform revision by J1939PDUWaveform::GetFrameIndex() and shared by every downstream decoder, so
+	per-signal decoders only touch the PDUs they care about.
+ */
+class J1939FrameIndex
+{
+public:
+	J1939FrameIndex(J1939PDUWaveform* wfm);
+
+	///@brief One PDU, from its priority symbol up to the start of the next one
+	class Frame
+	{
+	public:
+		///@brief Sample index of the priority symbol
+		size_t m_pri;
+
+		///@brief Sample index of the PGN symbol
+		size_t m_pgn;
+
+		///@brief Sample index of the source address symbol
+		size_t m_src;
+
+		///@brief Sample index one past the last symbol of the PDU
+		size_t m_end;
+
+		///@brief True if another PDU follows this one, so its data bytes are known to be complete
+		bool m_complete;
+	};
+
+	///@brief All well formed PDUs (PRI, PGN, optional DEST, SRC), in order
+	std::vector<Frame> m_frames;
+
+	///@brief Returns the indexes (into m_frames) of all PDUs with a given PGN, in order
+	const std::vector<size_t>& GetFramesWithPGN(uint32_t pgn) const
+	{ return Find(m_framesByPGN, pgn); }
+
+	///@brief Returns the indexes (into m_frames) of all PDUs from a given source address, in order
+	const std::vector<size_t>& GetFramesFromSource(uint32_t src) const
+	{ return Find(m_framesBySource, src); }
+
+protected:
+	const std::vector<size_t>& Find(const std::unordered_map<uint32_t, std::vector<size_t>>& map, uint32_t key) const
+	{
+		auto it = map.find(key);
+		if(it == map.end())
+			return m_noFrames;
+		return it->second;
+	}
+
+	///@brief Map of PGN to indexes of PDUs with that PGN
+	std::unordered_map<uint32_t, std::vector<size_t>> m_framesByPGN;
+
+	///@brief Map of source address to indexes of PDUs from that source
+	std::unordered_map<uint32_t, std::vector<size_t>> m_framesBySource;
+
+	///@brief Empty list returned for keys which never appear
+	std::vector<size_t> m_noFrames;
+};
+
 class J1939PDUWaveform : public SparseWaveform<J1939PDUSymbol>
 {
 public:
-	J1939PDUWaveform () : SparseWaveform<J1939PDUSymbol>() {};
+	J1939PDUWaveform () : SparseWaveform<J1939PDUSymbol>(), m_frameIndexRevision(0) {};
 	virtual std::string GetText(size_t) override;
 	virtual std::string GetColor(size_t) override;
+
+	std::shared_ptr<const J1939FrameIndex> GetFrameIndex();
+
+protected:
+	///@brief Frame index built by GetFrameIndex(), if any
+	std::shared_ptr<const J1939FrameIndex> m_frameIndex;
+
+	///@brief Revision m_frameIndex was built from
+	uint64_t m_frameIndexRevision;
 };
 
 class J1939PDUDecoder : public PacketDecoder
@@ -90,6 +162,20 @@ public:
 	PROTOCOL_DECODER_INITPROC(J1939PDUDecoder)
 
 protected:
+
+	///@brief Decoder state, kept between updates so we can resume decoding a streaming input
+	enum
+	{
+		STATE_IDLE,
+		STATE_DLC,
+		STATE_DATA
+	} m_state;
+
+	///@brief Number of data bytes remaining in the current frame
+	size_t m_bytesleft;
+
+	///@brief The packet currently being decoded, if any
+	Packet* m_pack;
 };
 
 #endif
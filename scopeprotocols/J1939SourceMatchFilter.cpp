@@ -97,7 +97,6 @@ void J1939SourceMatchFilter::Refresh()
 	}
 
 	auto din = dynamic_cast<J1939PDUWaveform*>(GetInputWaveform(0));
-	auto len = din->size();
 	if(!din)
 	{
 		SetData(nullptr, 0);
@@ -113,15 +112,6 @@ void J1939SourceMatchFilter::Refresh()
 	cap->PrepareForCpuAccess();
 	SetData(cap, 0);
 
-	enum
-	{
-		STATE_IDLE,
-		STATE_PGN,
-		STATE_SOURCE,
-		STATE_DATA,
-		STATE_GARBAGE
-	} state = STATE_IDLE;
-
 	//Find the target
 	auto target = m_parameters[m_sourceAddr].GetIntVal();
 	auto starget = to_string(target);
@@ -138,95 +128,17 @@ void J1939SourceMatchFilter::Refresh()
 		}
 	}
 
-	//Process the J1939 packet stream
-	size_t nstart = 0;
-	for(size_t i=0; i<len; i++)
+	//Copy every PDU from our source to the output, skipping everything else
+	auto index = din->GetFrameIndex();
+	for(auto nframe : index->GetFramesFromSource(target))
 	{
-		auto& s = din->m_samples[i];
-
-		switch(state)
-		{
-			case STATE_IDLE:
-				break;
-
-			//Expect a PGN, if we get anything else drop the packet
-			case STATE_PGN:
-				if(s.m_stype == J1939PDUSymbol::TYPE_PGN)
-				{
-					//Copy the sample to the output
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(din->m_samples[i]);
-
-					//Wait for the addresses
-					state = STATE_SOURCE;
-				}
-				else
-				{
-					cap->m_offsets.resize(nstart);
-					cap->m_durations.resize(nstart);
-					cap->m_samples.resize(nstart);
-					state = STATE_GARBAGE;
-				}
-				break;
-
-			case STATE_SOURCE:
-				if(s.m_stype == J1939PDUSymbol::TYPE_DEST)
-				{
-					//Copy the sample to the output
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(din->m_samples[i]);
-
-					//Still waiting for source address
-				}
-				else if( (s.m_stype == J1939PDUSymbol::TYPE_SRC) && (s.m_data == target) )
-				{
-					//Copy the sample to the output
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(din->m_samples[i]);
-
-					//Process data
-					state = STATE_DATA;
-				}
-				else
-				{
-					cap->m_offsets.resize(nstart);
-					cap->m_durations.resize(nstart);
-					cap->m_samples.resize(nstart);
-					state = STATE_GARBAGE;
-				}
-				break;
-
-			case STATE_DATA:
-
-				if(s.m_stype == J1939PDUSymbol::TYPE_DATA)
-				{
-					//Copy the sample to the output
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(din->m_samples[i]);
-				}
-				break;
-
-			default:
-				break;
-		}
-
-		//When we see a PRI start a new packet and save the info from it
-		if(s.m_stype == J1939PDUSymbol::TYPE_PRI)
+		auto& frame = index->m_frames[nframe];
+		for(size_t i=frame.m_pri; i<frame.m_end; i++)
 		{
-			//Copy the sample to the output
-			nstart = cap->m_samples.size();
 			cap->m_offsets.push_back(din->m_offsets[i]);
 			cap->m_durations.push_back(din->m_durations[i]);
 			cap->m_samples.push_back(din->m_samples[i]);
-
-			//Wait for the PGN
-			state = STATE_PGN;
 		}
-
 	}
 
 	//Done updating
@@ -0,0 +1,283 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#include "../scopehal/scopehal.h"
+#include "JitterAnalysisFilter.h"
+#include "DDJMeasurement.h"
+#include "DCDMeasurement.h"
+#include "ISIMeasurement.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+JitterAnalysisFilter::JitterAnalysisFilter(const string& color)
+	: TIEMeasurement(color)
+	, m_numTable("JitterAnalysisFilter.numTable")
+	, m_sumTable("JitterAnalysisFilter.sumTable")
+{
+	m_category = CAT_ANALYSIS;
+
+	//Stream 0 (TIE) and the clock / golden inputs come from TIEMeasurement
+	m_streams[STREAM_TIE].m_name = "TIE";
+	AddStream(Unit(Unit::UNIT_FS), "RjBUj", Stream::STREAM_TYPE_ANALOG);
+	AddStream(Unit(Unit::UNIT_FS), "DDJ", Stream::STREAM_TYPE_ANALOG_SCALAR);
+	AddStream(Unit(Unit::UNIT_FS), "DCD", Stream::STREAM_TYPE_ANALOG_SCALAR);
+	AddStream(Unit(Unit::UNIT_FS), "ISI", Stream::STREAM_TYPE_ANALOG_SCALAR);
+
+	CreateInput("sampledThreshold");
+
+	for(int i=0; i<256; i++)
+		m_table[i] = 0;
+
+	m_numTable.SetGpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
+	m_sumTable.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+
+	if(g_hasShaderInt64 && g_hasShaderAtomicInt64 && g_hasShaderAtomicFloat && g_hasShaderInt8)
+	{
+		m_ddjComputePipeline =
+			make_shared<ComputePipeline>("shaders/DDJMeasurement.spv", 7, sizeof(DDJConstants));
+		m_uncorrelatedComputePipeline =
+			make_shared<ComputePipeline>("shaders/JitterAnalysis_Uncorrelated.spv", 8, sizeof(DDJConstants));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Factory methods
+
+bool JitterAnalysisFilter::ValidateChannel(size_t i, StreamDescriptor stream)
+{
+	if(stream.m_channel == nullptr)
+		return false;
+
+	if(i < 2)
+		return TIEMeasurement::ValidateChannel(i, stream);
+	if( (i == 2) && (stream.GetType() == Stream::STREAM_TYPE_DIGITAL) )
+		return true;
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+string JitterAnalysisFilter::GetProtocolName()
+{
+	return "Jitter Analysis";
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Actual decoder logic
+
+void JitterAnalysisFilter::ClearOutputs()
+{
+	SetData(nullptr, STREAM_TIE);
+	SetData(nullptr, STREAM_UNCORRELATED);
+	m_streams[STREAM_DDJ].m_value = NAN;
+	m_streams[STREAM_DCD].m_value = NAN;
+	m_streams[STREAM_ISI].m_value = NAN;
+}
+
+void JitterAnalysisFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
+{
+	#ifdef HAVE_NVTX
+		nvtx3::scoped_range range("JitterAnalysisFilter::Refresh");
+	#endif
+
+	ClearErrors();
+	if(!VerifyAllInputsOK())
+	{
+		ClearOutputs();
+		return;
+	}
+
+	auto sampledData = dynamic_cast<SparseDigitalWaveform*>(GetInputWaveform(2));
+	if(!sampledData)
+	{
+		AddErrorMessage("Missing inputs", "Sampled data input must be a sparse digital waveform");
+		ClearOutputs();
+		return;
+	}
+
+	//Compute TIE into stream 0. Everything else is derived from it in place.
+	TIEMeasurement::Refresh(cmdBuf, queue);
+	auto tie = dynamic_cast<SparseAnalogWaveform*>(GetData(STREAM_TIE));
+	if(!tie || tie->empty() || sampledData->empty())
+	{
+		ClearOutputs();
+		return;
+	}
+
+	size_t tielen = tie->size();
+	size_t samplen = sampledData->size();
+
+	auto uj = SetupEmptySparseAnalogOutputWaveform(tie, STREAM_UNCORRELATED);
+	uj->Resize(tielen);
+
+	//Table of jitter indexed by history
+	size_t num_bins = 256;
+	m_numTable.resize(num_bins);
+	m_sumTable.resize(num_bins);
+	m_numTable.PrepareForCpuAccessIgnoringGpuData();
+	m_sumTable.PrepareForCpuAccessIgnoringGpuData();
+	for(size_t i=0; i<num_bins; i++)
+	{
+		m_numTable[i] = 0;
+		m_sumTable[i] = 0;
+	}
+	m_numTable.MarkModifiedFromCpu();
+	m_sumTable.MarkModifiedFromCpu();
+
+	if(m_ddjComputePipeline)
+	{
+		cmdBuf.begin({});
+
+		DDJConstants cfg;
+		cfg.numDataSamples = samplen;
+		cfg.numTieSamples = tielen;
+
+		//First pass: bin TIE by data history (same kernel as DDJMeasurement)
+		const uint64_t numThreads = 4096;
+		const uint64_t blockSize = 64;
+		m_ddjComputePipeline->BindBufferNonblocking(0, tie->m_offsets, cmdBuf);
+		m_ddjComputePipeline->BindBufferNonblocking(1, tie->m_samples, cmdBuf);
+		m_ddjComputePipeline->BindBufferNonblocking(2, sampledData->m_offsets, cmdBuf);
+		m_ddjComputePipeline->BindBufferNonblocking(3, sampledData->m_durations, cmdBuf);
+		m_ddjComputePipeline->BindBufferNonblocking(4, sampledData->m_samples, cmdBuf);
+		m_ddjComputePipeline->BindBufferNonblocking(5, m_numTable, cmdBuf);
+		m_ddjComputePipeline->BindBufferNonblocking(6, m_sumTable, cmdBuf);
+		m_ddjComputePipeline->Dispatch(cmdBuf, cfg, numThreads / blockSize);
+		m_ddjComputePipeline->AddComputeMemoryBarrier(cmdBuf);
+		m_numTable.MarkModifiedFromGpu();
+		m_sumTable.MarkModifiedFromGpu();
+
+		//Second pass: subtract the averaged DDJ from each TIE sample
+		const uint32_t compute_block_count = GetComputeBlockCount(tielen, blockSize);
+		m_uncorrelatedComputePipeline->BindBufferNonblocking(0, tie->m_offsets, cmdBuf);
+		m_uncorrelatedComputePipeline->BindBufferNonblocking(1, tie->m_samples, cmdBuf);
+		m_uncorrelatedComputePipeline->BindBufferNonblocking(2, sampledData->m_offsets, cmdBuf);
+		m_uncorrelatedComputePipeline->BindBufferNonblocking(3, sampledData->m_durations, cmdBuf);
+		m_uncorrelatedComputePipeline->BindBufferNonblocking(4, sampledData->m_samples, cmdBuf);
+		m_uncorrelatedComputePipeline->BindBufferNonblocking(5, m_numTable, cmdBuf);
+		m_uncorrelatedComputePipeline->BindBufferNonblocking(6, m_sumTable, cmdBuf);
+		m_uncorrelatedComputePipeline->BindBufferNonblocking(7, uj->m_samples, cmdBuf, true);
+		m_uncorrelatedComputePipeline->Dispatch(cmdBuf, cfg,
+			min(compute_block_count, 32768u),
+			compute_block_count / 32768 + 1);
+		uj->m_samples.MarkModifiedFromGpu();
+
+		//Timestamps are the same as the TIE
+		uj->m_offsets.CopyFromNonblocking(cmdBuf, tie->m_offsets);
+		uj->m_durations.CopyFromNonblocking(cmdBuf, tie->m_durations);
+
+		//Only the tables come back to the CPU
+		m_numTable.PrepareForCpuAccessNonblocking(cmdBuf);
+		m_sumTable.PrepareForCpuAccessNonblocking(cmdBuf);
+
+		cmdBuf.end();
+		queue->SubmitAndBlock(cmdBuf);
+	}
+	else
+	{
+		tie->PrepareForCpuAccess();
+		sampledData->PrepareForCpuAccess();
+		uj->PrepareForCpuAccess();
+
+		//Bin TIE by data history, remembering which history each TIE sample was assigned to
+		vector<pair<size_t, uint8_t> > assigned;
+		uint8_t window = 0;
+		size_t nbits = 0;
+		int64_t tfirst = tie->m_offsets[0];
+		size_t itie = 0;
+		size_t tielast = tielen - 1;
+		for(size_t idata=0; idata < samplen; idata ++)
+		{
+			//Sample the next bit in the thresholded waveform
+			window = (window >> 1);
+			if(sampledData->m_samples[idata])
+				window |= 0x80;
+			nbits ++;
+
+			//need 8 in last_window, plus one more for the current bit
+			if(nbits < 9)
+				continue;
+
+			//If we're still before the first TIE sample, nothing to do
+			int64_t tstart = sampledData->m_offsets[idata];
+			if(tstart < tfirst)
+				continue;
+
+			//Advance TIE samples if needed
+			int64_t target = tie->m_offsets[itie];
+			while( (target < tstart) && (itie < tielast) )
+			{
+				itie ++;
+				target = tie->m_offsets[itie];
+			}
+
+			//If the TIE sample is not in this bit, don't do anything.
+			int64_t tend = tstart + sampledData->m_durations[idata];
+			if( (target < tstart) || (target > tend) )
+				continue;
+
+			m_numTable[window] ++;
+			m_sumTable[window] += tie->m_samples[itie];
+			assigned.push_back(pair<size_t, uint8_t>(itie, window));
+		}
+
+		//Subtract the averaged DDJ to get the uncorrelated jitter
+		memcpy(uj->m_offsets.GetCpuPointer(), tie->m_offsets.GetCpuPointer(), tielen * sizeof(int64_t));
+		memcpy(uj->m_durations.GetCpuPointer(), tie->m_durations.GetCpuPointer(), tielen * sizeof(int64_t));
+		memcpy(uj->m_samples.GetCpuPointer(), tie->m_samples.GetCpuPointer(), tielen * sizeof(float));
+		for(auto it : assigned)
+			uj->m_samples[it.first] = tie->m_samples[it.first] - m_sumTable[it.second] / m_numTable[it.second];
+		uj->MarkModifiedFromCpu();
+	}
+
+	//Calculate DDJ, DCD and ISI from the table
+	float ddjmin = FLT_MAX;
+	float ddjmax = 0;
+	for(size_t i=0; i<num_bins; i++)
+	{
+		if(m_numTable[i] != 0)
+		{
+			float jitter = m_sumTable[i] * 1.0 / m_numTable[i];
+			m_table[i] = jitter;
+			ddjmin = min(ddjmin, jitter);
+			ddjmax = max(ddjmax, jitter);
+		}
+		else
+			m_table[i] = 0;
+	}
+
+	m_streams[STREAM_DDJ].m_value = ddjmax - ddjmin;
+	m_streams[STREAM_DCD].m_value = DCDMeasurement::CalculateDCD(m_table);
+	m_streams[STREAM_ISI].m_value = ISIMeasurement::CalculateISI(m_table);
+}
@@ -0,0 +1,86 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of JitterAnalysisFilter
+ */
+#ifndef JitterAnalysisFilter_h
+#define JitterAnalysisFilter_h
+
+#include "TIEMeasurement.h"
+
+/**
+	@brief Combined TIE and jitter decomposition
+
+	Computes TIE once, then derives DDJ, DCD, ISI and the uncorrelated (Rj + BUj) jitter from it in the same pass, without
+	building intermediate waveforms for separate DDJ / Rj+BUj / DCD filters to re-read and re-index.
+ */
+class JitterAnalysisFilter : public TIEMeasurement
+{
+public:
+	JitterAnalysisFilter(const std::string& color);
+
+	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
+
+	static std::string GetProtocolName();
+
+	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
+
+	PROTOCOL_DECODER_INITPROC(JitterAnalysisFilter)
+
+	float* GetDDJTable()
+	{ return m_table; }
+
+	enum StreamIndexes
+	{
+		STREAM_TIE,
+		STREAM_UNCORRELATED,
+		STREAM_DDJ,
+		STREAM_DCD,
+		STREAM_ISI
+	};
+
+protected:
+	void ClearOutputs();
+
+	float m_table[256];
+
+	AcceleratorBuffer<int64_t> m_numTable;
+	AcceleratorBuffer<float> m_sumTable;
+
+	///@brief DDJ table accumulation (shared with DDJMeasurement)
+	std::shared_ptr<ComputePipeline> m_ddjComputePipeline;
+
+	///@brief Rj + BUj extraction
+	std::shared_ptr<ComputePipeline> m_uncorrelatedComputePipeline;
+};
+
+#endif
@@ -29,7 +29,7 @@
 
 #include "../scopehal/scopehal.h"
 #include "JitterFilter.h"
-#include <random>
+#include "../scopehal/CounterRNG.h"
 
 using namespace std;
 
@@ -101,8 +101,7 @@ void JitterFilter::Refresh()
 	float stdev = m_parameters[m_stdevname].GetFloatVal();
 	float pjamp = m_parameters[m_pjamplitudename].GetFloatVal();
 
-	minstd_rand rng(rand());
-	normal_distribution<> noise(0, stdev);
+	CounterRNG rng(rand());
 
 	//Copy the initial configuration over
 	auto cap = SetupEmptySparseDigitalOutputWaveform(din, 0);
@@ -118,25 +117,22 @@ void JitterFilter::Refresh()
 	float startPhase = fmodf(rand(), M_PI);
 	float radians_per_fs = 2 * M_PI * pjfreq / FS_PER_SECOND;
 
-	//Add the noise
-	//gcc 8.x / 9.x have false positive here (https://gcc.gnu.org/bugzilla/show_bug.cgi?id=99536)
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+	//Add the noise. Every sample's jitter depends only on its index, so the edges can be processed in parallel
+	#pragma omp parallel for
 	for(size_t i=0; i<len; i++)
 	{
-		size_t tstart = GetOffsetScaled(sdin, udin, i);
+		int64_t tstart = GetOffsetScaled(sdin, udin, i);
 
-		size_t rj = noise(rng);
-		size_t pj = sin(tstart * radians_per_fs + startPhase) * pjamp;
-		size_t tj = rj + pj;
+		int64_t rj = rng.Gaussian(i) * stdev;
+		int64_t pj = sin(tstart * radians_per_fs + startPhase) * pjamp;
 
 		//Add jitter to the start time
-		cap->m_offsets[i] = tstart + tj;
-		cap->m_durations[i] = GetDurationScaled(sdin, udin, i);
-
-		//Update duration of previous sample
-		if(i > 0)
-			cap->m_durations[i-1] = cap->m_offsets[i] - cap->m_offsets[i-1];
+		cap->m_offsets[i] = tstart + rj + pj;
 	}
-#pragma GCC diagnostic pop
+
+	//Update durations to run up to the (jittered) start of the next sample
+	for(size_t i=0; i+1<len; i++)
+		cap->m_durations[i] = cap->m_offsets[i+1] - cap->m_offsets[i];
+	if(len > 0)
+		cap->m_durations[len-1] = GetDurationScaled(sdin, udin, len-1);
 }
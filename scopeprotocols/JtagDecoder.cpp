@@ -152,81 +152,122 @@ void JtagDecoder::Refresh()
 	cap->m_startFemtoseconds = tck->m_startFemtoseconds;
 	cap->PrepareForCpuAccess();
 
-	//Table for state transitions
-	JtagSymbol::JtagState state_if_tms_high[] =
-	{
-		JtagSymbol::TEST_LOGIC_RESET,	//from TEST_LOGIC_RESET
-		JtagSymbol::SELECT_DR_SCAN,		//from RUN_TEST_IDLE
-		JtagSymbol::SELECT_IR_SCAN,		//from SELECT_DR_SCAN
-		JtagSymbol::TEST_LOGIC_RESET,	//from SELECT_IR_SCAN
-		JtagSymbol::EXIT2_DR,			//from CAPTURE_DR
-		JtagSymbol::EXIT2_IR,			//from CAPTURE_IR
-		JtagSymbol::EXIT1_DR,			//from SHIFT_DR
-		JtagSymbol::EXIT1_IR,			//from SHIFT_IR
-		JtagSymbol::UPDATE_DR,			//from EXIT1_DR
-		JtagSymbol::UPDATE_IR,			//from EXIT1_IR
-		JtagSymbol::EXIT2_DR,			//from PAUSE_DR
-		JtagSymbol::EXIT2_IR,			//from PAUSE_IR
-		JtagSymbol::UPDATE_DR,			//from EXIT2_DR
-		JtagSymbol::UPDATE_IR,			//from EXIT2_IR
-		JtagSymbol::SELECT_DR_SCAN,		//from UPDATE_DR
-		JtagSymbol::SELECT_DR_SCAN,		//from UPDATE_IR
+	size_t len = dtms.size();
+	len = min(len, dtdi.size());
+	len = min(len, dtdo.size());
 
-		JtagSymbol::UNKNOWN_1,			//from UNKNOWN_0
-		JtagSymbol::UNKNOWN_2,			//from UNKNOWN_1
-		JtagSymbol::UNKNOWN_3,			//from UNKNOWN_2
-		JtagSymbol::UNKNOWN_4,			//from UNKNOWN_3
-		JtagSymbol::TEST_LOGIC_RESET	//from UNKNOWN_4
+	//Find the TAP state at the start of each chunk of the capture.
+	//Assume we're in RTI before we get any TMS edges
+	const size_t chunkSize = 65536;
+	auto step = [&](size_t i, uint8_t s)
+	{
+		return static_cast<uint8_t>(NextState(static_cast<JtagSymbol::JtagState>(s), dtms.m_samples[i]));
 	};
+	auto chunkStates = ParallelStateMachine<JtagSymbol::UNKNOWN_4 + 1>::FindChunkStates(
+		len, chunkSize, JtagSymbol::RUN_TEST_IDLE, step);
+
+	//Split each chunk at its first state transition, so every segment starts with no symbol or packet in flight
+	size_t nchunks = chunkStates.size();
+	vector<Segment> splits(nchunks);
+	vector<uint8_t> found(nchunks, 0);
+	ParallelFor(1, nchunks, 1, [&](size_t first, size_t last)
+	{
+		for(size_t k=first; k<last; k++)
+		{
+			auto state = static_cast<JtagSymbol::JtagState>(chunkStates[k]);
+			size_t end = min(len, (k+1)*chunkSize);
+			for(size_t i=k*chunkSize; i<end; i++)
+			{
+				auto next_state = NextState(state, dtms.m_samples[i]);
+				if(next_state != state)
+				{
+					splits[k].m_firstCycle = i+1;
+					splits[k].m_startIndex = i;
+					splits[k].m_startState = next_state;
+					found[k] = 1;
+					break;
+				}
+			}
+		}
+	});
 
-	JtagSymbol::JtagState state_if_tms_low[] =
+	vector<Segment> segs(1);
+	for(size_t k=1; k<nchunks; k++)
 	{
-		JtagSymbol::RUN_TEST_IDLE,		//from TEST_LOGIC_RESET
-		JtagSymbol::RUN_TEST_IDLE,		//from RUN_TEST_IDLE
-		JtagSymbol::CAPTURE_DR,			//from SELECT_DR_SCAN
-		JtagSymbol::CAPTURE_IR,			//from SELECT_IR_SCAN
-		JtagSymbol::SHIFT_DR,			//from CAPTURE_DR
-		JtagSymbol::SHIFT_IR,			//from CAPTURE_IR
-		JtagSymbol::SHIFT_DR,			//from SHIFT_DR
-		JtagSymbol::SHIFT_IR,			//from SHIFT_IR
-		JtagSymbol::PAUSE_DR,			//from EXIT1_DR
-		JtagSymbol::PAUSE_IR,			//from EXIT1_IR
-		JtagSymbol::PAUSE_DR,			//from PAUSE_DR
-		JtagSymbol::PAUSE_IR,			//from PAUSE_IR
-		JtagSymbol::CAPTURE_DR,			//from EXIT2_DR
-		JtagSymbol::CAPTURE_IR,			//from EXIT2_IR
-		JtagSymbol::RUN_TEST_IDLE,		//from UPDATE_DR
-		JtagSymbol::RUN_TEST_IDLE,		//from UPDATE_IR
+		if(found[k])
+		{
+			segs.back().m_lastCycle = splits[k].m_firstCycle;
+			segs.push_back(splits[k]);
+		}
+	}
+	segs.back().m_lastCycle = len;
 
-		JtagSymbol::UNKNOWN_0,			//from UNKNOWN_0
-		JtagSymbol::UNKNOWN_0,			//from UNKNOWN_1
-		JtagSymbol::UNKNOWN_0,			//from UNKNOWN_2
-		JtagSymbol::UNKNOWN_0,			//from UNKNOWN_3
-		JtagSymbol::UNKNOWN_0			//from UNKNOWN_4
-	};
+	//Decode the segments in parallel
+	ParallelFor(0, segs.size(), 1, [&](size_t first, size_t last)
+	{
+		for(size_t k=first; k<last; k++)
+			DecodeSegment(dtms, dtdi, dtdo, segs[k]);
+	});
+
+	//Stitch them back together, filling in the IR value each segment started with
+	size_t nsymbols = 0;
+	size_t npackets = 0;
+	for(auto& seg : segs)
+	{
+		nsymbols += seg.m_samples.size();
+		npackets += seg.m_packets.size();
+	}
+	cap->m_offsets.reserve(nsymbols);
+	cap->m_durations.reserve(nsymbols);
+	cap->m_samples.reserve(nsymbols);
+	m_packets.reserve(npackets);
 
-	//Main decode loop
-	//Assume we're in RTI before we get any TMS edges
-	JtagSymbol::JtagState state = JtagSymbol::RUN_TEST_IDLE;
-	size_t istart = 0;
-	size_t packstart = 0;
+	string irval = "??";
+	for(auto& seg : segs)
+	{
+		for(size_t j=0; j<seg.m_inheritedPackets; j++)
+			seg.m_packets[j]->m_headers["IR"] = irval;
+		if(!seg.m_lastIR.empty())
+			irval = seg.m_lastIR;
+
+		cap->m_offsets.insert(cap->m_offsets.end(), seg.m_offsets.begin(), seg.m_offsets.end());
+		cap->m_durations.insert(cap->m_durations.end(), seg.m_durations.begin(), seg.m_durations.end());
+		cap->m_samples.insert(cap->m_samples.end(), seg.m_samples.begin(), seg.m_samples.end());
+		m_packets.insert(m_packets.end(), seg.m_packets.begin(), seg.m_packets.end());
+	}
+
+	//LogDebug("%zu packets\n", m_packets.size());
+
+	SetData(cap, 0);
+	cap->MarkModifiedFromCpu();
+}
+
+/**
+	@brief Decodes one segment of the capture
+
+	Packets decoded before the first IR write in the segment are tagged with a placeholder IR value, which Refresh()
+	replaces once the IR value at the start of the segment is known.
+ */
+void JtagDecoder::DecodeSegment(
+	const SparseDigitalWaveform& dtms,
+	const SparseDigitalWaveform& dtdi,
+	const SparseDigitalWaveform& dtdo,
+	Segment& seg)
+{
+	JtagSymbol::JtagState state = seg.m_startState;
+	size_t istart = seg.m_startIndex;
+	size_t packstart = seg.m_startIndex;
 	size_t nbits = 0;
 	uint8_t idata = 0;
 	uint8_t odata = 0;
 	vector<uint8_t> ibytes;
 	vector<uint8_t> obytes;
 	string irval = "??";
-	size_t len = dtms.size();
-	len = min(len, dtdi.size());
-	len = min(len, dtdo.size());
-	for(size_t i=0; i<len; i++)
+	bool irKnown = false;
+	for(size_t i=seg.m_firstCycle; i<seg.m_lastCycle; i++)
 	{
 		//Update the state
-		JtagSymbol::JtagState next_state;
-		if(dtms.m_samples[i])
-			next_state = state_if_tms_high[state];
-		else
-			next_state = state_if_tms_low[state];
+		auto next_state = NextState(state, dtms.m_samples[i]);
 
 		if( (state == JtagSymbol::SHIFT_IR) || (state == JtagSymbol::SHIFT_DR) )
 		{
@@ -242,9 +283,9 @@ void JtagDecoder::Refresh()
 		if(next_state != state)
 		{
 			//Add a sample for the previous state
-			cap->m_offsets.push_back(dtms.m_offsets[istart]);
-			cap->m_durations.push_back(dtms.m_offsets[i] - dtms.m_offsets[istart]);
-			cap->m_samples.push_back(JtagSymbol(state, idata, odata, nbits));
+			seg.m_offsets.push_back(dtms.m_offsets[istart]);
+			seg.m_durations.push_back(dtms.m_offsets[i] - dtms.m_offsets[istart]);
+			seg.m_samples.push_back(JtagSymbol(state, idata, odata, nbits));
 
 			//Add packets for the IR/DR change
 			char tmp[128];
@@ -268,7 +309,7 @@ void JtagDecoder::Refresh()
 				pack->m_headers["Bits"] = tmp;
 				pack->m_data = ibytes;
 				pack->m_len = dtms.m_offsets[i] - pack->m_offset;
-				m_packets.push_back(pack);
+				seg.m_packets.push_back(pack);
 
 				//Read side
 				pack = new Packet;
@@ -282,11 +323,17 @@ void JtagDecoder::Refresh()
 				pack->m_headers["Bits"] = tmp;
 				pack->m_data = obytes;
 				pack->m_len = dtms.m_offsets[i] - pack->m_offset;
-				m_packets.push_back(pack);
+				seg.m_packets.push_back(pack);
 
 				//Update current IR
 				if(state == JtagSymbol::SHIFT_IR)
 				{
+					if(!irKnown)
+					{
+						seg.m_inheritedPackets = seg.m_packets.size();
+						irKnown = true;
+					}
+
 					irval = "";
 					for(auto b : ibytes)
 					{
@@ -305,6 +352,8 @@ void JtagDecoder::Refresh()
 			{
 				packstart = i;
 				nbits = 0;
+				idata = 0;
+				odata = 0;
 			}
 
 			state = next_state;
@@ -314,9 +363,9 @@ void JtagDecoder::Refresh()
 		{
 			if(nbits == 8)
 			{
-				cap->m_offsets.push_back(dtms.m_offsets[istart]);
-				cap->m_durations.push_back(dtms.m_offsets[i] - dtms.m_offsets[istart]);
-				cap->m_samples.push_back(JtagSymbol(state, idata, odata, 8));
+				seg.m_offsets.push_back(dtms.m_offsets[istart]);
+				seg.m_durations.push_back(dtms.m_offsets[i] - dtms.m_offsets[istart]);
+				seg.m_samples.push_back(JtagSymbol(state, idata, odata, 8));
 
 				ibytes.push_back(idata);
 				obytes.push_back(odata);
@@ -327,10 +376,74 @@ void JtagDecoder::Refresh()
 		}
 	}
 
-	//LogDebug("%zu packets\n", m_packets.size());
+	if(irKnown)
+		seg.m_lastIR = irval;
+	else
+		seg.m_inheritedPackets = seg.m_packets.size();
+}
 
-	SetData(cap, 0);
-	cap->MarkModifiedFromCpu();
+/**
+	@brief Returns the TAP state after one TCK cycle
+ */
+JtagSymbol::JtagState JtagDecoder::NextState(JtagSymbol::JtagState state, bool tms)
+{
+	//Table for state transitions
+	static const JtagSymbol::JtagState state_if_tms_high[] =
+	{
+		JtagSymbol::TEST_LOGIC_RESET,	//from TEST_LOGIC_RESET
+		JtagSymbol::SELECT_DR_SCAN,		//from RUN_TEST_IDLE
+		JtagSymbol::SELECT_IR_SCAN,		//from SELECT_DR_SCAN
+		JtagSymbol::TEST_LOGIC_RESET,	//from SELECT_IR_SCAN
+		JtagSymbol::EXIT2_DR,			//from CAPTURE_DR
+		JtagSymbol::EXIT2_IR,			//from CAPTURE_IR
+		JtagSymbol::EXIT1_DR,			//from SHIFT_DR
+		JtagSymbol::EXIT1_IR,			//from SHIFT_IR
+		JtagSymbol::UPDATE_DR,			//from EXIT1_DR
+		JtagSymbol::UPDATE_IR,			//from EXIT1_IR
+		JtagSymbol::EXIT2_DR,			//from PAUSE_DR
+		JtagSymbol::EXIT2_IR,			//from PAUSE_IR
+		JtagSymbol::UPDATE_DR,			//from EXIT2_DR
+		JtagSymbol::UPDATE_IR,			//from EXIT2_IR
+		JtagSymbol::SELECT_DR_SCAN,		//from UPDATE_DR
+		JtagSymbol::SELECT_DR_SCAN,		//from UPDATE_IR
+
+		JtagSymbol::UNKNOWN_1,			//from UNKNOWN_0
+		JtagSymbol::UNKNOWN_2,			//from UNKNOWN_1
+		JtagSymbol::UNKNOWN_3,			//from UNKNOWN_2
+		JtagSymbol::UNKNOWN_4,			//from UNKNOWN_3
+		JtagSymbol::TEST_LOGIC_RESET	//from UNKNOWN_4
+	};
+
+	static const JtagSymbol::JtagState state_if_tms_low[] =
+	{
+		JtagSymbol::RUN_TEST_IDLE,		//from TEST_LOGIC_RESET
+		JtagSymbol::RUN_TEST_IDLE,		//from RUN_TEST_IDLE
+		JtagSymbol::CAPTURE_DR,			//from SELECT_DR_SCAN
+		JtagSymbol::CAPTURE_IR,			//from SELECT_IR_SCAN
+		JtagSymbol::SHIFT_DR,			//from CAPTURE_DR
+		JtagSymbol::SHIFT_IR,			//from CAPTURE_IR
+		JtagSymbol::SHIFT_DR,			//from SHIFT_DR
+		JtagSymbol::SHIFT_IR,			//from SHIFT_IR
+		JtagSymbol::PAUSE_DR,			//from EXIT1_DR
+		JtagSymbol::PAUSE_IR,			//from EXIT1_IR
+		JtagSymbol::PAUSE_DR,			//from PAUSE_DR
+		JtagSymbol::PAUSE_IR,			//from PAUSE_IR
+		JtagSymbol::CAPTURE_DR,			//from EXIT2_DR
+		JtagSymbol::CAPTURE_IR,			//from EXIT2_IR
+		JtagSymbol::RUN_TEST_IDLE,		//from UPDATE_DR
+		JtagSymbol::RUN_TEST_IDLE,		//from UPDATE_IR
+
+		JtagSymbol::UNKNOWN_0,			//from UNKNOWN_0
+		JtagSymbol::UNKNOWN_0,			//from UNKNOWN_1
+		JtagSymbol::UNKNOWN_0,			//from UNKNOWN_2
+		JtagSymbol::UNKNOWN_0,			//from UNKNOWN_3
+		JtagSymbol::UNKNOWN_0			//from UNKNOWN_4
+	};
+
+	if(tms)
+		return state_if_tms_high[state];
+	else
+		return state_if_tms_low[state];
 }
 
 std::string JtagWaveform::GetColor(size_t i)
@@ -118,6 +118,52 @@ public:
 	PROTOCOL_DECODER_INITPROC(JtagDecoder)
 
 protected:
+
+	/**
+		@brief Output of decoding one run of TCK cycles which starts on a TAP state transition
+	 */
+	class Segment
+	{
+	public:
+		Segment()
+		: m_firstCycle(0)
+		, m_lastCycle(0)
+		, m_startState(JtagSymbol::RUN_TEST_IDLE)
+		, m_startIndex(0)
+		, m_inheritedPackets(0)
+		{}
+
+		///@brief First TCK cycle to decode
+		size_t m_firstCycle;
+
+		///@brief One past the last TCK cycle to decode
+		size_t m_lastCycle;
+
+		///@brief TAP state at the start of the segment
+		JtagSymbol::JtagState m_startState;
+
+		///@brief TCK cycle the first symbol of the segment starts at
+		size_t m_startIndex;
+
+		std::vector<int64_t> m_offsets;
+		std::vector<int64_t> m_durations;
+		std::vector<JtagSymbol> m_samples;
+		std::vector<Packet*> m_packets;
+
+		///@brief Number of packets at the start of the segment which were decoded before any IR write in it
+		size_t m_inheritedPackets;
+
+		///@brief Value of IR at the end of the segment, or empty if the segment contains no IR write
+		std::string m_lastIR;
+	};
+
+	void DecodeSegment(
+		const SparseDigitalWaveform& dtms,
+		const SparseDigitalWaveform& dtdi,
+		const SparseDigitalWaveform& dtdo,
+		Segment& seg);
+
+	static JtagSymbol::JtagState NextState(JtagSymbol::JtagState state, bool tms);
 };
 
 #endif
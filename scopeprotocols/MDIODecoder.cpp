@@ -130,9 +130,9 @@ void MDIODecoder::Refresh()
 	};
 
 
-	//Sample the data stream at each clock edge
+	//Sample the data stream at each clock edge, using the edge lists so idle time costs nothing
 	SparseDigitalWaveform dmdio;
-	SampleOnRisingEdgesBase(mdio, mdc, dmdio);
+	DigitalEdgeList::SampleOnRisingEdges(mdio, mdc, dmdio);
 	size_t dlen = dmdio.m_samples.size();
 	for(size_t i=0; i<dlen; i++)
 	{
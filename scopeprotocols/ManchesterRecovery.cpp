@@ -0,0 +1,331 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of ManchesterRecovery
+ */
+
+#include "../scopehal/scopehal.h"
+#include "ManchesterRecovery.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Initializes the recovery engine
+
+	@param uiWidth			Nominal width of one UI, in fs
+	@param jitterTolerance	Maximum deviation of an edge from its nominal position, in fs
+	@param lowThreshold		The line is considered low once it falls below this level
+	@param highThreshold	The line is considered high once it rises above this level
+	@param frameGapUIs		Idle time, in UIs, after which the next edge starts a new frame
+	@param detectSync		Report 1.5 UI half-pulses at bit boundaries as sync pulses (MIL-STD-1553)
+ */
+ManchesterRecovery::ManchesterRecovery(
+	int64_t uiWidth,
+	int64_t jitterTolerance,
+	float lowThreshold,
+	float highThreshold,
+	int64_t frameGapUIs,
+	bool detectSync)
+	: m_uiWidth(uiWidth)
+	, m_jitterTolerance(jitterTolerance)
+	, m_lowThreshold(lowThreshold)
+	, m_highThreshold(highThreshold)
+	, m_frameGapUIs(frameGapUIs)
+	, m_detectSync(detectSync)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Decoding
+
+/**
+	@brief Recovers the bit stream from a waveform
+
+	@param wfm			Input waveform, which must be valid on the CPU
+	@param initialLevel	Level the line is assumed to be at before the first sample
+ */
+void ManchesterRecovery::Recover(UniformAnalogWaveform* wfm, bool initialLevel)
+{
+	FindEdges(wfm, initialLevel);
+	ClassifyIntervals();
+	RecoverBits();
+}
+
+/**
+	@brief Recovers the bit stream from a waveform
+
+	@param wfm			Input waveform, which must be valid on the CPU
+	@param initialLevel	Level the line is assumed to be at before the first sample
+ */
+void ManchesterRecovery::Recover(SparseAnalogWaveform* wfm, bool initialLevel)
+{
+	FindEdges(wfm, initialLevel);
+	ClassifyIntervals();
+	RecoverBits();
+}
+
+/**
+	@brief Runs the hysteresis comparator over the waveform and records every transition
+ */
+template<class T>
+void ManchesterRecovery::FindEdges(T* wfm, bool initialLevel)
+{
+	m_edgeTimes.clear();
+	m_edgeRising.clear();
+
+	size_t len = wfm->size();
+	const size_t chunkSize = 1024 * 1024;
+	size_t nchunks = (len + chunkSize - 1) / chunkSize;
+
+	//Edges within each chunk, starting from the first sample outside the hysteresis band. Until that sample we don't
+	//know which level the chunk starts on, so whether it is itself an edge is decided when stitching.
+	//A line which comes back out of the band after idling in it for longer than the frame gap (e.g. 10baseT, which
+	//idles at 0V) has an edge there even if it returns to the level it left at.
+	struct ChunkEdges
+	{
+		ChunkEdges()
+		: firstDecisive(SIZE_MAX)
+		, lastDecisive(SIZE_MAX)
+		, firstLevel(false)
+		, lastLevel(false)
+		{}
+
+		size_t firstDecisive;
+		size_t lastDecisive;
+		bool firstLevel;
+		bool lastLevel;
+		vector<size_t> edges;
+	};
+	vector<ChunkEdges> chunks(nchunks);
+
+	auto samples = wfm->m_samples.GetCpuPointer();
+	float low = m_lowThreshold;
+	float high = m_highThreshold;
+	int64_t gap = m_frameGapUIs * m_uiWidth;
+	ParallelFor(0, nchunks, 1, [&](size_t first, size_t last)
+	{
+		for(size_t k=first; k<last; k++)
+		{
+			auto& chunk = chunks[k];
+			size_t end = min(len, (k+1)*chunkSize);
+			bool level = false;
+			for(size_t i=k*chunkSize; i<end; i++)
+			{
+				float v = samples[i];
+				bool nextLevel;
+				if(v > high)
+					nextLevel = true;
+				else if(v < low)
+					nextLevel = false;
+				else
+					continue;
+
+				if(chunk.firstDecisive == SIZE_MAX)
+				{
+					chunk.firstDecisive = i;
+					chunk.firstLevel = nextLevel;
+				}
+				else if(nextLevel != level)
+					chunk.edges.push_back(i);
+				else if( (i != chunk.lastDecisive + 1) &&
+					(GetOffsetScaled(wfm, i) - GetOffsetScaled(wfm, chunk.lastDecisive) > gap) )
+				{
+					chunk.edges.push_back(i);
+				}
+				level = nextLevel;
+				chunk.lastDecisive = i;
+			}
+			chunk.lastLevel = level;
+		}
+	});
+
+	//Stitch the chunks together
+	size_t nedges = 0;
+	for(auto& chunk : chunks)
+		nedges += chunk.edges.size() + 1;
+	m_edgeTimes.reserve(nedges);
+	m_edgeRising.reserve(nedges);
+
+	bool level = initialLevel;
+	size_t lastDecisive = SIZE_MAX;
+	for(auto& chunk : chunks)
+	{
+		if(chunk.firstDecisive == SIZE_MAX)
+			continue;
+
+		bool idle = (lastDecisive != SIZE_MAX) &&
+			(GetOffsetScaled(wfm, chunk.firstDecisive) - GetOffsetScaled(wfm, lastDecisive) > gap);
+		if( (chunk.firstLevel != level) || idle)
+		{
+			m_edgeTimes.push_back(GetOffsetScaled(wfm, chunk.firstDecisive));
+			m_edgeRising.push_back(chunk.firstLevel);
+		}
+		level = chunk.firstLevel;
+
+		for(auto i : chunk.edges)
+		{
+			m_edgeTimes.push_back(GetOffsetScaled(wfm, i));
+			level = (samples[i] > high);
+			m_edgeRising.push_back(level);
+		}
+		lastDecisive = chunk.lastDecisive;
+	}
+}
+
+/**
+	@brief Rounds the time between each pair of edges to a whole number of half UIs
+ */
+void ManchesterRecovery::ClassifyIntervals()
+{
+	size_t nedges = m_edgeTimes.size();
+	m_intervals.resize(nedges);
+	if(nedges == 0)
+		return;
+
+	int64_t halfui = m_uiWidth / 2;
+	int64_t gap = m_frameGapUIs * m_uiWidth;
+	int64_t tol = m_jitterTolerance;
+
+	m_intervals[0] = INTERVAL_GAP;
+	ParallelFor(1, nedges, 65536, [&](size_t first, size_t last)
+	{
+		for(size_t i=first; i<last; i++)
+		{
+			int64_t delta = m_edgeTimes[i] - m_edgeTimes[i-1];
+			if(delta > gap)
+			{
+				m_intervals[i] = INTERVAL_GAP;
+				continue;
+			}
+
+			//Longest interval in the code is 2 UI (between sync and the middle of the next bit)
+			int64_t n = (delta + halfui/2) / halfui;
+			if( (n < 1) || (n > 4) || (llabs(delta - n*halfui) > tol) )
+				m_intervals[i] = INTERVAL_BAD;
+			else
+				m_intervals[i] = n;
+		}
+	});
+}
+
+/**
+	@brief Walks the classified edges and emits a bit for every mid-bit edge
+ */
+void ManchesterRecovery::RecoverBits()
+{
+	m_bits.clear();
+	m_bits.reserve(m_edgeTimes.size() / 2 + 1);
+
+	enum
+	{
+		PHASE_BOUNDARY,		//last edge was at the boundary between two bits
+		PHASE_MID,			//last edge was in the middle of a bit
+		PHASE_SYNC			//last edge was in the middle of a sync pulse
+	} phase = PHASE_BOUNDARY;
+
+	int64_t halfui = m_uiWidth / 2;
+	uint8_t flags = 0;
+	for(size_t i=0; i<m_edgeTimes.size(); i++)
+	{
+		uint8_t n = m_intervals[i];
+
+		//After an idle gap, the first edge is a bit boundary (or the start of a sync pulse)
+		if(n == INTERVAL_GAP)
+		{
+			flags = ManchesterBit::FLAG_FRAME_START;
+			phase = PHASE_BOUNDARY;
+			continue;
+		}
+
+		bool mid = false;
+		bool sync = false;
+		switch(phase)
+		{
+			case PHASE_BOUNDARY:
+				if(n == 1)
+					mid = true;
+				else if( (n == 3) && m_detectSync)
+					sync = true;
+				break;
+
+			case PHASE_MID:
+				if(n == 1)
+				{
+					phase = PHASE_BOUNDARY;
+					continue;
+				}
+				else if(n == 2)
+					mid = true;
+
+				//Sync pulse starting at the end of this bit without an edge there
+				else if( (n == 4) && m_detectSync)
+					sync = true;
+				break;
+
+			case PHASE_SYNC:
+				if(n == 3)
+				{
+					phase = PHASE_BOUNDARY;
+					continue;
+				}
+
+				//First bit after the sync starts without an edge
+				else if(n == 4)
+					mid = true;
+				break;
+		}
+
+		if(mid)
+		{
+			m_bits.push_back({m_edgeTimes[i] - halfui, m_uiWidth, m_edgeRising[i], flags});
+			phase = PHASE_MID;
+			flags = 0;
+		}
+		else if(sync)
+		{
+			m_bits.push_back(
+				{m_edgeTimes[i] - 3*halfui, 3*m_uiWidth, !m_edgeRising[i], (uint8_t)(flags | ManchesterBit::FLAG_SYNC)});
+			phase = PHASE_SYNC;
+			flags = 0;
+		}
+
+		//Timing doesn't fit, drop whatever we were doing and resynchronize with this edge as a bit boundary
+		else
+		{
+			flags |= ManchesterBit::FLAG_RESYNC;
+			phase = PHASE_BOUNDARY;
+		}
+	}
+}
@@ -0,0 +1,142 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of ManchesterRecovery
+ */
+#ifndef ManchesterRecovery_h
+#define ManchesterRecovery_h
+
+/**
+	@brief One bit (or sync pulse) recovered from a Manchester coded line
+ */
+class ManchesterBit
+{
+public:
+	enum Flags
+	{
+		///@brief First bit after the line was idle for longer than the frame gap
+		FLAG_FRAME_START	= 0x01,
+
+		///@brief An edge with unexpected timing was dropped just before this bit and the clock resynchronized on it
+		FLAG_RESYNC			= 0x02,
+
+		///@brief Not a data bit, but a 3 UI sync pulse. m_value is the level of the first half of the pulse.
+		FLAG_SYNC			= 0x04
+	};
+
+	///@brief Start of the bit, in fs
+	int64_t m_start;
+
+	///@brief Length of the bit, in fs
+	int64_t m_len;
+
+	///@brief Bit value: 1 for a rising edge in the middle of the bit (IEEE 802.3 convention)
+	uint8_t m_value;
+
+	///@brief Any of the Flags values
+	uint8_t m_flags;
+};
+
+/**
+	@brief Manchester / biphase clock and data recovery shared by line-level decoders
+
+	Decodes in three passes, the first two of which run on all cores:
+	* Edge extraction: a hysteresis comparator finds every transition of the line. Each chunk of the waveform is
+	  scanned independently and the chunks are stitched together by comparing the level each one ends on with the
+	  first decisive level of the next.
+	* Interval classification: the time between each pair of edges is rounded to a whole number of half UIs, or
+	  flagged as a timing error or an idle gap.
+	* Clock recovery: a small state machine walks the classified edges (not the samples, so this is cheap) tracking
+	  whether each edge is at a bit boundary or in the middle of a bit, and emits a bit for every mid-bit edge.
+
+	If sync detection is enabled, a 1.5 UI half-pulse at a bit boundary is reported as a MIL-STD-1553 style sync
+	pulse rather than an error.
+ */
+class ManchesterRecovery
+{
+public:
+	ManchesterRecovery(
+		int64_t uiWidth,
+		int64_t jitterTolerance,
+		float lowThreshold,
+		float highThreshold,
+		int64_t frameGapUIs,
+		bool detectSync);
+
+	void Recover(UniformAnalogWaveform* wfm, bool initialLevel);
+	void Recover(SparseAnalogWaveform* wfm, bool initialLevel);
+
+	///@brief Recovered bits, in order
+	std::vector<ManchesterBit> m_bits;
+
+	///@brief Timestamp of each edge, in fs
+	std::vector<int64_t> m_edgeTimes;
+
+	///@brief True for each edge which is a rising edge
+	std::vector<uint8_t> m_edgeRising;
+
+protected:
+	template<class T>
+	void FindEdges(T* wfm, bool initialLevel);
+
+	void ClassifyIntervals();
+	void RecoverBits();
+
+	///@brief Interval class of an edge which follows an idle gap (or is the first edge)
+	static const uint8_t INTERVAL_GAP = 0xff;
+
+	///@brief Interval class of an edge whose timing doesn't fit the line code
+	static const uint8_t INTERVAL_BAD = 0;
+
+	///@brief Time since the previous edge, in half UIs, or one of the INTERVAL_* constants
+	std::vector<uint8_t> m_intervals;
+
+	///@brief Width of one UI, in fs
+	int64_t m_uiWidth;
+
+	///@brief Maximum deviation of an edge from its nominal position, in fs
+	int64_t m_jitterTolerance;
+
+	///@brief Lower comparator threshold
+	float m_lowThreshold;
+
+	///@brief Upper comparator threshold
+	float m_highThreshold;
+
+	///@brief Idle time, in UIs, after which the next edge starts a new frame
+	int64_t m_frameGapUIs;
+
+	///@brief Report 1.5 UI half-pulses at bit boundaries as sync pulses
+	bool m_detectSync;
+};
+
+#endif
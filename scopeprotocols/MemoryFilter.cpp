@@ -71,6 +71,12 @@ bool MemoryFilter::ShouldPersistWaveform()
 	return true;
 }
 
+bool MemoryFilter::IsOutputContentHashed()
+{
+	//Pressing "Update" on a signal which hasn't changed shouldn't recompute everything downstream
+	return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
@@ -114,18 +120,25 @@ void MemoryFilter::Update()
 	auto sdata = dynamic_cast<SparseAnalogWaveform*>(data);
 	auto udata = dynamic_cast<UniformAnalogWaveform*>(data);
 
+	//Snapshot the input by sharing its buffers rather than copying them. Nothing is copied unless the input is
+	//later overwritten in place while we still hold the snapshot
 	if(sdata)
 	{
-		auto cap = SetupSparseOutputWaveform(sdata, 0, 0, 0);
-		cap->m_offsets.CopyFrom(sdata->m_offsets);
-		cap->m_durations.CopyFrom(sdata->m_durations);
-		cap->m_samples.CopyFrom(sdata->m_samples);
+		auto cap = SetupEmptySparseAnalogOutputWaveform(sdata, 0);
+		if(sdata->AreTimestampsCompressed())
+			cap->CopyTimestamps(sdata);
+		else
+		{
+			cap->m_offsets.ShareFrom(sdata->m_offsets);
+			cap->m_durations.ShareFrom(sdata->m_durations);
+		}
+		cap->m_samples.ShareFrom(sdata->m_samples);
 	}
 
 	else if(udata)
 	{
 		auto cap = SetupEmptyUniformAnalogOutputWaveform(udata, 0);
-		cap->m_samples.CopyFrom(udata->m_samples);
+		cap->m_samples.ShareFrom(udata->m_samples);
 	}
 
 	//TODO: digital path
@@ -54,6 +54,7 @@ public:
 	virtual bool PerformAction(const std::string& id) override;
 
 	virtual bool ShouldPersistWaveform() override;
+	virtual bool IsOutputContentHashed() override;
 
 	PROTOCOL_DECODER_INITPROC(MemoryFilter)
 
@@ -29,6 +29,7 @@
 
 #include "../scopehal/scopehal.h"
 #include "MovingAverageFilter.h"
+#include "../scopehal/KahanSummation.h"
 
 using namespace std;
 
@@ -37,6 +38,7 @@ using namespace std;
 
 MovingAverageFilter::MovingAverageFilter(const string& color)
 	: Filter(color, CAT_MATH)
+	, m_computePipeline("shaders/MovingAverageFilter.spv", 2, sizeof(MovingAverageFilterConstants))
 {
 	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_ANALOG);
 	CreateInput("din");
@@ -68,25 +70,62 @@ string MovingAverageFilter::GetProtocolName()
 	return "Moving average";
 }
 
+Filter::DataLocation MovingAverageFilter::GetInputLocation()
+{
+	//We explicitly manage our input memory and don't care where it is when Refresh() is called
+	return LOC_DONTCARE;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
-void MovingAverageFilter::Refresh()
+/**
+	@brief Averages a window of depth samples starting at each input sample, sliding the window along a running sum
+
+	Each chunk of outputs is seeded with a fresh sum over its first window. The sum is then updated by adding the
+	sample entering the window and subtracting the one leaving it, with Kahan summation to keep the error from
+	accumulating. Chunks are at least depth samples long so seeding never costs more than the sliding itself.
+ */
+static void MovingAverageOnCpu(const float* pin, float* pout, size_t nsamples, size_t depth)
+{
+	const size_t chunkSize = max(depth, (size_t)16384);
+	const size_t nchunks = (nsamples + chunkSize - 1) / chunkSize;
+
+	#pragma omp parallel for
+	for(size_t n=0; n<nchunks; n++)
+	{
+		size_t istart = n * chunkSize;
+		size_t iend = min(istart + chunkSize, nsamples);
+
+		KahanSummation sum;
+		for(size_t j=0; j<depth; j++)
+			sum += pin[istart + j];
+		pout[istart] = sum.GetSum() / depth;
+
+		for(size_t i=istart+1; i<iend; i++)
+		{
+			sum += pin[i + depth - 1];
+			sum += -pin[i - 1];
+			pout[i] = sum.GetSum() / depth;
+		}
+	}
+}
+
+void MovingAverageFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
 	if(!VerifyAllInputsOK())
 	{
-		SetData(NULL, 0);
+		SetData(nullptr, 0);
 		return;
 	}
 
 	//Get the input data
 	auto din = GetInputWaveform(0);
-	din->PrepareForCpuAccess();
 	size_t len = din->size();
 	size_t depth = m_parameters[m_depthname].GetIntVal();
-	if(len < depth)
+	if( (depth == 0) || (len < depth) )
 	{
-		SetData(NULL, 0);
+		SetData(nullptr, 0);
 		return;
 	}
 
@@ -99,46 +138,43 @@ void MovingAverageFilter::Refresh()
 	auto sdin = dynamic_cast<SparseAnalogWaveform*>(din);
 	auto udin = dynamic_cast<UniformAnalogWaveform*>(din);
 
+	//Sparse inputs are averaged on the CPU, since the timestamps have to be copied there anyway
 	if(sdin)
 	{
-		//Do the average
+		sdin->PrepareForCpuAccess();
 		auto cap = SetupSparseOutputWaveform(sdin, 0, off, off);
 		cap->PrepareForCpuAccess();
 
-		//#pragma omp parallel for
-		for(size_t i=0; i<nsamples; i++)
-		{
-			float v = 0;
-			for(size_t j=0; j<depth; j++)
-				v += sdin->m_samples[i+j];
-			v /= depth;
-
-			cap->m_offsets[i] = sdin->m_offsets[i+off];
-			cap->m_durations[i] = sdin->m_durations[i+off];
-			cap->m_samples[i] = v;
-		}
+		MovingAverageOnCpu(sdin->m_samples.GetCpuPointer(), cap->m_samples.GetCpuPointer(), nsamples, depth);
 		SetData(cap, 0);
 
 		cap->MarkModifiedFromCpu();
 	}
+
+	//Uniform inputs are averaged on the GPU, one thread per chunk of outputs
 	else
 	{
-		//Do the average
 		auto cap = SetupEmptyUniformAnalogOutputWaveform(udin, 0);
-		cap->PrepareForCpuAccess();
 		cap->Resize(nsamples);
-		//#pragma omp parallel for
-		for(size_t i=0; i<nsamples; i++)
-		{
-			float v = 0;
-			for(size_t j=0; j<depth; j++)
-				v += udin->m_samples[i+j];
-			v /= depth;
 
-			cap->m_samples[i] = v;
-		}
-		SetData(cap, 0);
+		MovingAverageFilterConstants cfg;
+		cfg.len = nsamples;
+		cfg.depth = depth;
+		cfg.chunkSize = max(depth, (size_t)256);
+		size_t nchunks = (nsamples + cfg.chunkSize - 1) / cfg.chunkSize;
 
-		cap->MarkModifiedFromCpu();
+		cmdBuf.begin({});
+
+		m_computePipeline.BindBufferNonblocking(0, udin->m_samples, cmdBuf);
+		m_computePipeline.BindBufferNonblocking(1, cap->m_samples, cmdBuf, true);
+		cap->MarkSamplesModifiedFromGpu();
+
+		const uint32_t compute_block_count = GetComputeBlockCount(nchunks, 64);
+		m_computePipeline.Dispatch(cmdBuf, cfg,
+			min(compute_block_count, 32768u),
+			compute_block_count / 32768 + 1);
+
+		cmdBuf.end();
+		queue->SubmitDeferred(cmdBuf);
 	}
 }
@@ -35,12 +35,21 @@
 #ifndef MovingAverageFilter_h
 #define MovingAverageFilter_h
 
+class MovingAverageFilterConstants
+{
+public:
+	uint32_t	len;
+	uint32_t	depth;
+	uint32_t	chunkSize;
+};
+
 class MovingAverageFilter : public Filter
 {
 public:
 	MovingAverageFilter(const std::string& color);
 
-	virtual void Refresh() override;
+	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
+	virtual DataLocation GetInputLocation() override;
 
 	static std::string GetProtocolName();
 
@@ -50,6 +59,8 @@ public:
 
 protected:
 	std::string m_depthname;
+
+	ComputePipeline m_computePipeline;
 };
 
 #endif
@@ -90,6 +90,33 @@ void MultiplyFilter::Refresh()
 		RefreshScalarVector(0, 1);
 }
 
+bool MultiplyFilter::SetupElementwiseOp(ElementwiseOp& op)
+{
+	//Only multiplication of two uniform waveforms can be fused, Refresh() deals with everything else
+	if( (GetInput(0).GetType() != Stream::STREAM_TYPE_ANALOG) || (GetInput(1).GetType() != Stream::STREAM_TYPE_ANALOG) )
+		return false;
+	if(!VerifyAllInputsOK())
+		return false;
+	auto a = WaveformCast<UniformAnalogWaveform>(GetInputWaveform(0));
+	auto b = WaveformCast<UniformAnalogWaveform>(GetInputWaveform(1));
+	if(!a || !b)
+		return false;
+
+	SetYAxisUnits(m_inputs[0].GetYAxisUnits() * m_inputs[1].GetYAxisUnits(), 0);
+	m_streams[0].m_stype = Stream::STREAM_TYPE_ANALOG;
+
+	size_t len = min(a->size(), b->size());
+	auto cap = SetupEmptyUniformAnalogOutputWaveform(a, 0);
+	cap->Resize(len);
+
+	op.m_type = ElementwiseOp::OP_MULTIPLY;
+	op.m_inputs[0] = a;
+	op.m_inputs[1] = b;
+	op.m_output = cap;
+	op.m_len = len;
+	return true;
+}
+
 void MultiplyFilter::RefreshScalarScalar()
 {
 	m_streams[0].m_stype = Stream::STREAM_TYPE_ANALOG_SCALAR;
@@ -104,46 +131,10 @@ void MultiplyFilter::RefreshScalarVector(size_t iScalar, size_t iVector)
 	m_streams[0].m_stype = Stream::STREAM_TYPE_ANALOG;
 
 	float scale = GetInput(iScalar).GetScalarValue();
-	auto din = GetInputWaveform(iVector);
-	if(!din)
-	{
+	bool ok = VisitWaveform<float>(GetInputWaveform(iVector), [&](auto din)
+		{ ApplyPointwise(din, 0, [scale](float v) { return v * scale; }); });
+	if(!ok)
 		SetData(nullptr, 0);
-		return;
-	}
-	din->PrepareForCpuAccess();
-	auto len = din->size();
-
-	auto sparse = dynamic_cast<SparseAnalogWaveform*>(din);
-	auto uniform = dynamic_cast<UniformAnalogWaveform*>(din);
-
-	if(sparse)
-	{
-		//Set up the output waveform
-		auto cap = SetupSparseOutputWaveform(sparse, 0, 0, 0);
-		cap->Resize(len);
-		cap->PrepareForCpuAccess();
-
-		float* fin = (float*)__builtin_assume_aligned(sparse->m_samples.GetCpuPointer(), 16);
-		float* fdst = (float*)__builtin_assume_aligned(cap->m_samples.GetCpuPointer(), 16);
-		for(size_t i=0; i<len; i++)
-			fdst[i] = fin[i] * scale;
-
-		cap->MarkModifiedFromCpu();
-	}
-	else
-	{
-		//Set up the output waveform
-		auto cap = SetupEmptyUniformAnalogOutputWaveform(uniform, 0);
-		cap->Resize(len);
-		cap->PrepareForCpuAccess();
-
-		float* fin = (float*)__builtin_assume_aligned(uniform->m_samples.GetCpuPointer(), 16);
-		float* fdst = (float*)__builtin_assume_aligned(cap->m_samples.GetCpuPointer(), 16);
-		for(size_t i=0; i<len; i++)
-			fdst[i] = fin[i] * scale;
-
-		cap->MarkModifiedFromCpu();
-	}
 }
 
 void MultiplyFilter::RefreshVectorVector()
@@ -157,47 +148,9 @@ void MultiplyFilter::RefreshVectorVector()
 		return;
 	}
 
-	//Get the input data
-	auto a = GetInputWaveform(0);
-	auto b = GetInputWaveform(1);
-	auto len = min(a->size(), b->size());
-	a->PrepareForCpuAccess();
-	b->PrepareForCpuAccess();
-
-	//Type conversion
-	auto sa = dynamic_cast<SparseAnalogWaveform*>(a);
-	auto sb = dynamic_cast<SparseAnalogWaveform*>(b);
-	auto ua = dynamic_cast<UniformAnalogWaveform*>(a);
-	auto ub = dynamic_cast<UniformAnalogWaveform*>(b);
-
-	if(sa && sb)
-	{
-		//Set up the output waveform
-		auto cap = SetupSparseOutputWaveform(sa, 0, 0, 0);
-		cap->Resize(len);
-		cap->PrepareForCpuAccess();
-
-		float* fa = (float*)__builtin_assume_aligned(sa->m_samples.GetCpuPointer(), 16);
-		float* fb = (float*)__builtin_assume_aligned(sb->m_samples.GetCpuPointer(), 16);
-		float* fdst = (float*)__builtin_assume_aligned(cap->m_samples.GetCpuPointer(), 16);
-		for(size_t i=0; i<len; i++)
-			fdst[i] = fa[i] * fb[i];
-
-		cap->MarkModifiedFromCpu();
-	}
-	else if(ua && ub)
-	{
-		//Set up the output waveform
-		auto cap = SetupEmptyUniformAnalogOutputWaveform(ua, 0);
-		cap->Resize(len);
-		cap->PrepareForCpuAccess();
-
-		float* fa = (float*)__builtin_assume_aligned(ua->m_samples.GetCpuPointer(), 16);
-		float* fb = (float*)__builtin_assume_aligned(ub->m_samples.GetCpuPointer(), 16);
-		float* fdst = (float*)__builtin_assume_aligned(cap->m_samples.GetCpuPointer(), 16);
-		for(size_t i=0; i<len; i++)
-			fdst[i] = fa[i] * fb[i];
-
-		cap->MarkModifiedFromCpu();
-	}
+	//Any mix of sparse and uniform inputs is fine
+	bool ok = VisitWaveforms<float, float>(GetInputWaveform(0), GetInputWaveform(1), [&](auto a, auto b)
+		{ ApplyPointwise(a, b, 0, [](float va, float vb) { return va * vb; }); });
+	if(!ok)
+		SetData(nullptr, 0);
 }
@@ -37,12 +37,21 @@
 
 #include <random>
 
+class NoiseFilterConstants
+{
+public:
+	uint32_t	len;
+	uint32_t	rngSeed;
+	float		sigma;
+};
+
 class NoiseFilter : public Filter
 {
 public:
 	NoiseFilter(const std::string& color);
 
-	virtual void Refresh() override;
+	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
+	virtual DataLocation GetInputLocation() override;
 
 	static std::string GetProtocolName();
 
@@ -51,14 +60,12 @@ public:
 	PROTOCOL_DECODER_INITPROC(NoiseFilter)
 
 protected:
-#ifdef __x86_64__
-	void CopyWithAwgnAVX2(float* dest, float* src, size_t len, float sigma);
-#endif
-	void CopyWithAwgnNative(float* dest, float* src, size_t len, float sigma);
-
 	std::string m_stdevname;
 
+	///@brief Source of per-waveform seeds for the counter based RNG
 	std::mt19937 m_twister;
+
+	ComputePipeline m_computePipeline;
 };
 
 #endif
@@ -82,23 +82,67 @@ void OvershootMeasurement::Refresh()
 	//Get the input data
 	auto din = GetInputWaveform(0);
 	din->PrepareForCpuAccess();
-	size_t len = din->size();
 
+	//Create the output
+	auto cap = SetupEmptySparseAnalogOutputWaveform(din, 0);
+	cap->PrepareForCpuAccess();
+
+	float avg;
+	float globalmax;
+	Measure(din, cap, avg, globalmax);
+	SetData(cap, 0);
+
+	m_streams[1].m_value = avg;
+	m_streams[2].m_value = globalmax;
+
+	cap->MarkModifiedFromCpu();
+}
+
+bool OvershootMeasurement::SupportsScalarBatch(size_t stream)
+{
+	return (stream == 1) || (stream == 2);
+}
+
+bool OvershootMeasurement::EvaluateScalarSegment(WaveformBase* din, size_t stream, float& value)
+{
+	float avg;
+	float globalmax;
+	if(!Measure(din, nullptr, avg, globalmax))
+		return false;
+
+	if(stream == 1)
+		value = avg;
+	else
+		value = globalmax;
+	return true;
+}
+
+/**
+	@brief Measures the overshoot of every cycle in a waveform
+
+	@param din			Input waveform, already prepared for CPU access
+	@param cap			Output for the per-cycle overshoot (may be null if only the scalars are wanted)
+	@param avg			Average overshoot
+	@param globalmax	Highest overshoot
+
+	@return True if at least one cycle was measured
+ */
+bool OvershootMeasurement::Measure(WaveformBase* din, SparseAnalogWaveform* cap, float& avg, float& globalmax)
+{
 	auto sdin = dynamic_cast<SparseAnalogWaveform*>(din);
 	auto udin = dynamic_cast<UniformAnalogWaveform*>(din);
+	if(!sdin && !udin)
+		return false;
+	size_t len = din->size();
 
 	//Figure out the nominal top of the waveform
 	float top = GetTopVoltage(sdin, udin);
 	float base = GetBaseVoltage(sdin, udin);
 	float midpoint = (top+base)/2;
 
-	//Create the output
-	auto cap = SetupEmptySparseAnalogOutputWaveform(din, 0);
-	cap->PrepareForCpuAccess();
-
 	int64_t		tmax = 0;
 	float		vmax = 0;
-	float		globalmax = -FLT_MAX;
+	globalmax = -FLT_MAX;
 
 	//For each cycle, find how far we got above the top
 	KahanSummation sum;
@@ -112,16 +156,19 @@ void OvershootMeasurement::Refresh()
 			//Add a sample for the current value (if any)
 			if(tmax > 0)
 			{
-				//Update duration of the previous sample
-				size_t off = cap->size();
-				if(off > 0)
-					cap->m_durations[off-1] = tmax - cap->m_offsets[off-1];
-
-				//Add the new sample
 				float overshoot = vmax - top;
-				cap->m_offsets.push_back(tmax);
-				cap->m_durations.push_back(0);
-				cap->m_samples.push_back(overshoot);
+				if(cap)
+				{
+					//Update duration of the previous sample
+					size_t off = cap->size();
+					if(off > 0)
+						cap->m_durations[off-1] = tmax - cap->m_offsets[off-1];
+
+					//Add the new sample
+					cap->m_offsets.push_back(tmax);
+					cap->m_durations.push_back(0);
+					cap->m_samples.push_back(overshoot);
+				}
 
 				nedges ++;
 				globalmax = max(overshoot, globalmax);
@@ -143,10 +190,7 @@ void OvershootMeasurement::Refresh()
 			}
 		}
 	}
-	SetData(cap, 0);
-
-	m_streams[1].m_value = sum.GetSum() / nedges;
-	m_streams[2].m_value = globalmax;
 
-	cap->MarkModifiedFromCpu();
+	avg = sum.GetSum() / nedges;
+	return (nedges > 0);
 }
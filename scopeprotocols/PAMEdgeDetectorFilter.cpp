@@ -41,6 +41,7 @@ PAMEdgeDetectorFilter::PAMEdgeDetectorFilter(const string& color)
 	, m_baud(m_parameters["Symbol rate"])
 {
 	AddDigitalStream("data");
+	AddStream(Unit(Unit::UNIT_COUNTS), "symbols", Stream::STREAM_TYPE_ANALOG);
 
 	CreateInput("din");
 
@@ -70,6 +71,24 @@ PAMEdgeDetectorFilter::PAMEdgeDetectorFilter(const string& color)
 
 		m_secondPassComputePipeline =
 			make_shared<ComputePipeline>("shaders/PAMEdgeDetector_MergeCrossings.spv", 7, sizeof(PAMEdgeDetectorConstants));
+
+		//Merging, interpolation and output need int64 timestamps
+		if(g_hasShaderInt64)
+		{
+			m_levels.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+			m_edgeTimes.SetGpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
+			m_edgeFlags.SetGpuAccessHint(AcceleratorBuffer<uint8_t>::HINT_LIKELY);
+			m_blockCounts.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+			m_outputCount.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+			m_outputCount.resize(1);
+
+			m_interpolateComputePipeline =
+				make_shared<ComputePipeline>(
+					"shaders/PAMEdgeDetector_Interpolate.spv", 8, sizeof(PAMEdgeInterpolateConstants));
+			m_outputComputePipeline =
+				make_shared<ComputePipeline>(
+					"shaders/PAMEdgeDetector_Output.spv", 11, sizeof(PAMEdgeOutputConstants));
+		}
 	}
 }
 
@@ -121,6 +140,7 @@ void PAMEdgeDetectorFilter::Refresh(
 			AddErrorMessage("Missing inputs", "No waveform available at input");
 
 		SetData(nullptr, 0);
+		SetData(nullptr, 1);
 		return;
 	}
 
@@ -130,11 +150,17 @@ void PAMEdgeDetectorFilter::Refresh(
 	{
 		AddErrorMessage("Missing inputs", "No uniform analog waveform available at input");
 		SetData(nullptr, 0);
+		SetData(nullptr, 1);
 		return;
 	}
-	din->PrepareForCpuAccess();
 	auto len = din->size();
 
+	//If we can do the whole thing on the GPU, the input never has to come back to the CPU
+	bool gpuCrossings = g_hasShaderInt8;
+	bool gpuEdges = gpuCrossings && (m_interpolateComputePipeline != nullptr);
+	if(!gpuEdges)
+		din->PrepareForCpuAccess();
+
 	int64_t ui = round(FS_PER_SECOND / m_baud.GetIntVal());
 	size_t order = m_order.GetIntVal();
 
@@ -145,7 +171,10 @@ void PAMEdgeDetectorFilter::Refresh(
 		//If no threshold available, autofit
 		auto pname = string("Level ") + to_string(i);
 		if(m_parameters.find(pname) == m_parameters.end())
+		{
+			din->PrepareForCpuAccess();
 			AutoLevel(din);
+		}
 
 		//Extract the level
 		levels.push_back(m_parameters[pname].GetFloatVal());
@@ -162,20 +191,17 @@ void PAMEdgeDetectorFilter::Refresh(
 		sthresholds[i] = (from + to) / 2;
 	}
 
-	//Output waveform is sparse since we interpolate edge positions
+	//Output waveforms are sparse since we interpolate edge positions.
+	//Symbols are the level the signal settles at after each edge.
 	auto cap = SetupEmptySparseDigitalOutputWaveform(din, 0);
-	cap->PrepareForCpuAccess();
 	cap->m_timescale = 1;
-
-	//Add initial dummy sample at time zero
-	cap->m_offsets.push_back(0);
-	cap->m_durations.push_back(1);
-	cap->m_samples.push_back(0);
+	auto scap = SetupEmptySparseAnalogOutputWaveform(din, 1);
+	scap->m_timescale = 1;
 
 	//Find *all* level crossings
 	//This will double-count some edges (e.g. a +1 to -1 edge will show up as +1 to 0 and 0 to -1)
 	//TODO: does this actually depend on int64??
-	if(g_hasShaderInt8)
+	if(gpuCrossings)
 	{
 		//Prepare thresholds for GPU
 		//TODO: only if changed
@@ -238,10 +264,13 @@ void PAMEdgeDetectorFilter::Refresh(
 
 		m_edgeCount.PrepareForCpuAccessNonblocking(cmdBuf);
 
-		//Until we get the rest of the stuff processed on GPU - pull these  too
-		m_edgeIndexes.PrepareForCpuAccessNonblocking(cmdBuf);
-		m_edgeStates.PrepareForCpuAccessNonblocking(cmdBuf);
-		m_edgeRising.PrepareForCpuAccessNonblocking(cmdBuf);
+		//If we can't merge and interpolate on the GPU, pull the crossings too
+		if(!gpuEdges)
+		{
+			m_edgeIndexes.PrepareForCpuAccessNonblocking(cmdBuf);
+			m_edgeStates.PrepareForCpuAccessNonblocking(cmdBuf);
+			m_edgeRising.PrepareForCpuAccessNonblocking(cmdBuf);
+		}
 
 		cmdBuf.end();
 		queue->SubmitAndBlock(cmdBuf);
@@ -306,12 +335,103 @@ void PAMEdgeDetectorFilter::Refresh(
 
 	LogTrace("First pass: Found %zu level crossings\n", m_edgeIndexes.size());
 
+	int64_t halfui = ui / 2;
+	if(gpuEdges && !m_edgeIndexes.empty())
+	{
+		size_t count = m_edgeIndexes.size();
+
+		m_levels.resize(order);
+		m_levels.PrepareForCpuAccess();
+		for(size_t i=0; i<order; i++)
+			m_levels[i] = levels[i];
+		m_levels.MarkModifiedFromCpu();
+
+		const uint32_t numThreads = 4096;
+		const uint32_t blockSize = 64;
+		const uint32_t numBlocks = numThreads / blockSize;
+
+		m_edgeTimes.resize(count);
+		m_edgeFlags.resize(count);
+		m_blockCounts.resize(numThreads);
+
+		//At most one output edge per crossing, plus the dummy sample at time zero
+		cap->Resize(count + 1);
+		scap->Resize(count + 1);
+
+		cmdBuf.begin({});
+
+		//Merge crossings into edges and interpolate them
+		PAMEdgeInterpolateConstants icfg;
+		icfg.timescale = din->m_timescale;
+		icfg.halfui = halfui;
+		icfg.count = count;
+		icfg.order = order;
+		icfg.edgesPerThread = GetComputeBlockCount(count, numThreads);
+
+		m_interpolateComputePipeline->BindBufferNonblocking(0, din->m_samples, cmdBuf);
+		m_interpolateComputePipeline->BindBufferNonblocking(1, m_levels, cmdBuf);
+		m_interpolateComputePipeline->BindBufferNonblocking(2, m_edgeIndexes, cmdBuf);
+		m_interpolateComputePipeline->BindBufferNonblocking(3, m_edgeStates, cmdBuf);
+		m_interpolateComputePipeline->BindBufferNonblocking(4, m_edgeRising, cmdBuf);
+		m_interpolateComputePipeline->BindBufferNonblocking(5, m_edgeTimes, cmdBuf, true);
+		m_interpolateComputePipeline->BindBufferNonblocking(6, m_edgeFlags, cmdBuf, true);
+		m_interpolateComputePipeline->BindBufferNonblocking(7, m_blockCounts, cmdBuf, true);
+		m_interpolateComputePipeline->Dispatch(cmdBuf, icfg, numBlocks);
+		m_interpolateComputePipeline->AddComputeMemoryBarrier(cmdBuf);
+
+		m_edgeTimes.MarkModifiedFromGpu();
+		m_edgeFlags.MarkModifiedFromGpu();
+		m_blockCounts.MarkModifiedFromGpu();
+
+		//Write the edge and symbol waveforms
+		PAMEdgeOutputConstants ocfg;
+		ocfg.count = count;
+		ocfg.edgesPerThread = icfg.edgesPerThread;
+
+		m_outputComputePipeline->BindBufferNonblocking(0, m_edgeTimes, cmdBuf);
+		m_outputComputePipeline->BindBufferNonblocking(1, m_edgeFlags, cmdBuf);
+		m_outputComputePipeline->BindBufferNonblocking(2, m_edgeStates, cmdBuf);
+		m_outputComputePipeline->BindBufferNonblocking(3, m_blockCounts, cmdBuf);
+		m_outputComputePipeline->BindBufferNonblocking(4, cap->m_offsets, cmdBuf, true);
+		m_outputComputePipeline->BindBufferNonblocking(5, cap->m_durations, cmdBuf, true);
+		m_outputComputePipeline->BindBufferNonblocking(6, cap->m_samples, cmdBuf, true);
+		m_outputComputePipeline->BindBufferNonblocking(7, scap->m_offsets, cmdBuf, true);
+		m_outputComputePipeline->BindBufferNonblocking(8, scap->m_durations, cmdBuf, true);
+		m_outputComputePipeline->BindBufferNonblocking(9, scap->m_samples, cmdBuf, true);
+		m_outputComputePipeline->BindBufferNonblocking(10, m_outputCount, cmdBuf, true);
+		m_outputComputePipeline->Dispatch(cmdBuf, ocfg, numBlocks);
+
+		cap->MarkModifiedFromGpu();
+		scap->MarkModifiedFromGpu();
+		m_outputCount.MarkModifiedFromGpu();
+
+		m_outputCount.PrepareForCpuAccessNonblocking(cmdBuf);
+
+		cmdBuf.end();
+		queue->SubmitAndBlock(cmdBuf);
+
+		cap->Resize(m_outputCount[0]);
+		scap->Resize(m_outputCount[0]);
+		return;
+	}
+
 	m_edgeIndexes.PrepareForCpuAccess();
 	m_edgeStates.PrepareForCpuAccess();
 	m_edgeRising.PrepareForCpuAccess();
+	cap->PrepareForCpuAccess();
+	scap->PrepareForCpuAccess();
+
+	//Add initial dummy sample at time zero
+	cap->clear();
+	scap->clear();
+	cap->m_offsets.push_back(0);
+	cap->m_durations.push_back(1);
+	cap->m_samples.push_back(0);
+	scap->m_offsets.push_back(0);
+	scap->m_durations.push_back(1);
+	scap->m_samples.push_back(0);
 
 	//Loop over level crossings and figure out what they are
-	int64_t halfui = ui / 2;
 	bool nextValue = true;
 	for(size_t i=0; i<m_edgeIndexes.size(); i++)
 	{
@@ -375,10 +495,17 @@ void PAMEdgeDetectorFilter::Refresh(
 			cap->m_durations.push_back(1);
 			cap->m_samples.push_back(nextValue);
 
+			scap->m_offsets.push_back(tlerp);
+			scap->m_durations.push_back(1);
+			scap->m_samples.push_back(symend);
+
 			//Extend previous sample, if any
 			size_t outlen = cap->m_offsets.size();
-			if(outlen)
-				cap->m_durations[outlen-1] = tlerp - cap->m_offsets[outlen-1];
+			if(outlen > 1)
+			{
+				cap->m_durations[outlen-2] = tlerp - cap->m_offsets[outlen-2];
+				scap->m_durations[outlen-2] = cap->m_durations[outlen-2];
+			}
 
 			nextValue = !nextValue;
 		}
@@ -388,14 +515,20 @@ void PAMEdgeDetectorFilter::Refresh(
 		{
 			size_t outlen = cap->m_offsets.size();
 			cap->m_offsets[outlen-1] = tlerp;
+			scap->m_offsets[outlen-1] = tlerp;
+			scap->m_samples[outlen-1] = symend;
 
 			//Update duration of previous sample
 			if(outlen > 1)
+			{
 				cap->m_durations[outlen-2] = tlerp - cap->m_offsets[outlen-2];
+				scap->m_durations[outlen-2] = cap->m_durations[outlen-2];
+			}
 		}
 	}
 
 	cap->MarkModifiedFromCpu();
+	scap->MarkModifiedFromCpu();
 }
 
 vector<string> PAMEdgeDetectorFilter::EnumActions()
@@ -47,6 +47,23 @@ public:
 	uint32_t outputPerThread;
 };
 
+class PAMEdgeInterpolateConstants
+{
+public:
+	int64_t timescale;
+	int64_t halfui;
+	uint32_t count;
+	uint32_t order;
+	uint32_t edgesPerThread;
+};
+
+class PAMEdgeOutputConstants
+{
+public:
+	uint32_t count;
+	uint32_t edgesPerThread;
+};
+
 class PAMEdgeDetectorFilter
 	: public Filter
 	, public ActionProvider
@@ -83,12 +100,24 @@ protected:
 	AcceleratorBuffer<uint8_t> m_edgeRisingScratch;
 
 	AcceleratorBuffer<float> m_thresholds;
+	AcceleratorBuffer<float> m_levels;
+
+	AcceleratorBuffer<int64_t> m_edgeTimes;
+	AcceleratorBuffer<uint8_t> m_edgeFlags;
+	AcceleratorBuffer<uint32_t> m_blockCounts;
+	AcceleratorBuffer<uint32_t> m_outputCount;
 
 	///@brief Compute pipeline for first edge detection pass
 	std::shared_ptr<ComputePipeline> m_firstPassComputePipeline;
 
 	///@brief Compute pipeline for second (merge) edge detection pass
 	std::shared_ptr<ComputePipeline> m_secondPassComputePipeline;
+
+	///@brief Compute pipeline for merging and interpolating edges
+	std::shared_ptr<ComputePipeline> m_interpolateComputePipeline;
+
+	///@brief Compute pipeline for writing the final edge and symbol waveforms
+	std::shared_ptr<ComputePipeline> m_outputComputePipeline;
 };
 
 #endif
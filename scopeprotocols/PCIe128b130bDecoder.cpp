@@ -43,10 +43,30 @@ using namespace std;
 
 PCIe128b130bDecoder::PCIe128b130bDecoder(const string& color)
 	: Filter(color, CAT_SERIAL)
+	, m_syncErrors("PCIe128b130bDecoder.m_syncErrors")
+	, m_seeds("PCIe128b130bDecoder.m_seeds")
+	, m_descrambled("PCIe128b130bDecoder.m_descrambled")
 {
 	AddProtocolStream("data");
 	CreateInput("data");
 	CreateInput("clk");
+
+	if(g_hasShaderInt8)
+	{
+		m_blockSyncComputePipeline = make_shared<ComputePipeline>(
+			"shaders/SyncHeaderSearch.spv",
+			2,
+			sizeof(PCIe128b130bBlockSyncConstants));
+
+		m_descrambleComputePipeline = make_shared<ComputePipeline>(
+			"shaders/PCIe128b130b_Descrambler.spv",
+			3,
+			sizeof(PCIe128b130bDescramblerConstants));
+
+		m_syncErrors.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+		m_seeds.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+		m_descrambled.SetGpuAccessHint(AcceleratorBuffer<uint8_t>::HINT_LIKELY);
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -71,8 +91,12 @@ string PCIe128b130bDecoder::GetProtocolName()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
-void PCIe128b130bDecoder::Refresh()
+void PCIe128b130bDecoder::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
+	#ifdef HAVE_NVTX
+		nvtx3::scoped_range range("PCIe128b130bDecoder::Refresh");
+	#endif
+
 	//Get the input data
 	if(!VerifyAllInputsOK())
 	{
@@ -84,6 +108,16 @@ void PCIe128b130bDecoder::Refresh()
 	din->PrepareForCpuAccess();
 	clkin->PrepareForCpuAccess();
 
+	//Record the value of the data stream at each clock edge
+	SparseDigitalWaveform data;
+	SampleOnAnyEdgesBase(din, clkin, data);
+	data.MarkModifiedFromCpu();
+	if(data.size() <= 130)
+	{
+		SetData(NULL, 0);
+		return;
+	}
+
 	//Create the capture
 	auto cap = new PCIe128b130bWaveform;
 	cap->m_timescale = 1;
@@ -91,134 +125,305 @@ void PCIe128b130bDecoder::Refresh()
 	cap->m_startFemtoseconds = din->m_startFemtoseconds;
 	cap->PrepareForCpuAccess();
 
-	//Record the value of the data stream at each clock edge
-	SparseDigitalWaveform data;
-	SampleOnAnyEdgesBase(din, clkin, data);
-
 	//Look at each phase and figure out block alignment
 	size_t end = data.size() - 130;
-	size_t best_offset = 0;
-	size_t best_errors = end;
-	for(size_t offset=0; offset < 130; offset ++)
-	{
-		size_t errors = 0;
-		for(size_t i=offset; i<end; i+= 130)
-		{
-			if(data.m_samples[i] == data.m_samples[i+1])
-				errors ++;
-		}
-
-		if(errors < best_errors)
-		{
-			best_offset = offset;
-			best_errors = errors;
-		}
-	}
+	size_t best_offset = FindBlockAlignment(cmdBuf, queue, data, end);
 
 	//Decode the actual data
 	uint8_t symbols[32] = {0};
 	bool scrambler_locked = false;
 	uint32_t scrambler = 0;
-	for(size_t i=best_offset; i<end; i += 130)
+
+	//The scrambler is additive, so figure out its state at the start of each block on the CPU (this only needs the
+	//headers and ordered sets, and jumps a whole block at a time), then run the keystreams in parallel on the GPU
+	//(indexes are 32 bit in the shader)
+	if(m_descrambleComputePipeline && (data.size() < 0x80000000) )
 	{
-		//Extract the header bits
-		uint8_t header =
-			(data.m_samples[i] ? 2 : 0) |
-			(data.m_samples[i+1] ? 1 : 0);
-
-		//Figure out type
-		PCIe128b130bSymbol::type_t type;
-		if( (header == 0) || (header == 3) )
-			type = PCIe128b130bSymbol::TYPE_ERROR;
-		else if(header == 1)
+		size_t nblocks = 0;
+		if(best_offset < end)
+			nblocks = (end - best_offset + 129) / 130;
+
+		vector<PCIe128b130bSymbol::type_t> types(nblocks);
+		m_seeds.resize(nblocks);
+		m_seeds.PrepareForCpuAccess();
+		m_descrambled.resize(nblocks * 16);
+		for(size_t nblock=0; nblock<nblocks; nblock++)
 		{
-			if(scrambler_locked)
-				type = PCIe128b130bSymbol::TYPE_DATA;
-			else
-				type = PCIe128b130bSymbol::TYPE_SCRAMBLER_DESYNCED;
+			size_t i = best_offset + nblock*130;
+			auto type = GetBlockType(data, i, scrambler_locked);
+			types[nblock] = type;
+
+			//Skip ordered sets reseed the scrambler and are not scrambled themselves
+			if(type == PCIe128b130bSymbol::TYPE_ORDERED_SET)
+			{
+				ExtractBlock(data, i, symbols);
+				if(ParseSkipOrderedSet(symbols, scrambler))
+				{
+					scrambler_locked = true;
+					m_seeds[nblock] = 0;
+					continue;
+				}
+			}
+
+			//Everything else advances the scrambler, but only non-ordered-sets are descrambled
+			m_seeds[nblock] = scrambler & 0x7fffff;
+			if(type != PCIe128b130bSymbol::TYPE_ORDERED_SET)
+				m_seeds[nblock] |= 0x80000000;
+			scrambler = JumpScrambler(scrambler);
 		}
-		else
-			type = PCIe128b130bSymbol::TYPE_ORDERED_SET;
+		m_seeds.MarkModifiedFromCpu();
 
-		//Extract the data bytes, but don't descramble yet
-		size_t len = 16;
-		for(size_t j=0; j<16; j++)
+		if(nblocks > 0)
 		{
-			uint8_t tmp = 0;
-			for(size_t k=0; k<8; k++)
-				tmp |= (data.m_samples[i + j*8 + k + 2] << ( /* 7- */ k) );
-			symbols[j] = tmp;
-		}
+			cmdBuf.begin({});
 
-		//TODO: If this is a skip ordered set (SOS) it can vary in length if bridging is used
+			PCIe128b130bDescramblerConstants cfg;
+			cfg.count = nblocks;
+			cfg.start = best_offset;
 
-		bool is_sos = false;
+			m_descrambleComputePipeline->BindBufferNonblocking(0, data.m_samples, cmdBuf);
+			m_descrambleComputePipeline->BindBufferNonblocking(1, m_seeds, cmdBuf);
+			m_descrambleComputePipeline->BindBufferNonblocking(2, m_descrambled, cmdBuf, true);
+			const uint32_t compute_block_count = GetComputeBlockCount(nblocks, 64);
+			m_descrambleComputePipeline->Dispatch(cmdBuf, cfg,
+				min(compute_block_count, 32768u),
+				compute_block_count / 32768 + 1);
 
-		//SOS starts with 0xAA
-		//Last 3 symbols are LFSR content
-		if(type == PCIe128b130bSymbol::TYPE_ORDERED_SET)
+			m_descrambled.MarkModifiedFromGpu();
+			m_descrambled.PrepareForCpuAccessNonblocking(cmdBuf);
+
+			cmdBuf.end();
+			queue->SubmitAndBlock(cmdBuf);
+		}
+
+		for(size_t nblock=0; nblock<nblocks; nblock++)
 		{
-			if(symbols[0] == 0xaa)
+			memcpy(symbols, &m_descrambled[nblock*16], 16);
+			AppendSymbol(cap, data, best_offset + nblock*130, types[nblock], symbols);
+		}
+	}
+
+	else
+	{
+		for(size_t i=best_offset; i<end; i += 130)
+		{
+			auto type = GetBlockType(data, i, scrambler_locked);
+
+			//Extract the data bytes, but don't descramble yet
+			size_t len = 16;
+			ExtractBlock(data, i, symbols);
+
+			//TODO: If this is a skip ordered set (SOS) it can vary in length if bridging is used
+
+			bool is_sos = false;
+			if(type == PCIe128b130bSymbol::TYPE_ORDERED_SET)
 			{
-				is_sos = true;
+				is_sos = ParseSkipOrderedSet(symbols, scrambler);
+				if(is_sos)
+					scrambler_locked = true;
+			}
 
-				for(size_t j=1; j<len; j++)
+			//Iterate scrambler for everything but SOS
+			if(!is_sos)
+			{
+				//Throw away scrambler output for ordered sets
+				if(type == PCIe128b130bSymbol::TYPE_ORDERED_SET)
 				{
-					if(symbols[j] == 0xe1)
-					{
-						scrambler = (symbols[j+1] << 16) | (symbols[j+2] << 8) | (symbols[j+3]);
-						break;
-					}
+					for(size_t j=0; j<len; j++)
+						RunScrambler(scrambler);
 				}
 
-				scrambler_locked = true;
+				//Descramble data
+				else
+				{
+					for(size_t j=0; j<len; j++)
+						symbols[j] ^= RunScrambler(scrambler);
+				}
 			}
+
+			AppendSymbol(cap, data, i, type, symbols);
 		}
+	}
+
+	SetData(cap, 0);
+	cap->MarkModifiedFromCpu();
+}
+
+/**
+	@brief Finds the block phase with the fewest invalid sync headers
+
+	@param cmdBuf	Command buffer to use for the GPU search
+	@param queue	Queue to submit to
+	@param data		Sampled serial data
+	@param end		Index of the first bit a block may not start at
+
+	@return Index of the first bit of the first block
+ */
+size_t PCIe128b130bDecoder::FindBlockAlignment(
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue,
+	SparseDigitalWaveform& data,
+	size_t end)
+{
+	size_t best_offset = 0;
+	size_t best_errors = end;
+
+	if(m_blockSyncComputePipeline && (data.size() < 0x80000000) )
+	{
+		m_syncErrors.resize(130);
+		m_syncErrors.PrepareForCpuAccess();
+		for(size_t i=0; i<130; i++)
+			m_syncErrors[i] = 0;
+		m_syncErrors.MarkModifiedFromCpu();
+
+		cmdBuf.begin({});
+
+		PCIe128b130bBlockSyncConstants cfg;
+		cfg.end = end;
+		cfg.blockLen = 130;
+
+		//One row of thread blocks per phase
+		const uint32_t maxBlocksPerPhase = 64;
+		m_blockSyncComputePipeline->BindBufferNonblocking(0, data.m_samples, cmdBuf);
+		m_blockSyncComputePipeline->BindBufferNonblocking(1, m_syncErrors, cmdBuf);
+		m_blockSyncComputePipeline->Dispatch(cmdBuf, cfg,
+			min(GetComputeBlockCount(end / 130 + 1, 64), maxBlocksPerPhase),
+			130);
 
-		//Iterate scrambler for everything but SOS
-		if(!is_sos)
+		m_syncErrors.MarkModifiedFromGpu();
+		m_syncErrors.PrepareForCpuAccessNonblocking(cmdBuf);
+
+		cmdBuf.end();
+		queue->SubmitAndBlock(cmdBuf);
+
+		for(size_t offset=0; offset < 130; offset ++)
 		{
-			//Throw away scrambler output for ordered sets
-			if(type == PCIe128b130bSymbol::TYPE_ORDERED_SET)
+			if(m_syncErrors[offset] < best_errors)
+			{
+				best_offset = offset;
+				best_errors = m_syncErrors[offset];
+			}
+		}
+	}
+
+	else
+	{
+		for(size_t offset=0; offset < 130; offset ++)
+		{
+			size_t errors = 0;
+			for(size_t i=offset; i<end; i+= 130)
 			{
-				for(size_t j=0; j<len; j++)
-					RunScrambler(scrambler);
+				if(data.m_samples[i] == data.m_samples[i+1])
+					errors ++;
 			}
 
-			//Descramble data
-			else
+			if(errors < best_errors)
 			{
-				for(size_t j=0; j<len; j++)
-					symbols[j] ^= RunScrambler(scrambler);
+				best_offset = offset;
+				best_errors = errors;
 			}
 		}
+	}
+
+	return best_offset;
+}
+
+/**
+	@brief Figures out the type of the block starting at bit i from its sync header
+ */
+PCIe128b130bSymbol::type_t PCIe128b130bDecoder::GetBlockType(
+	SparseDigitalWaveform& data,
+	size_t i,
+	bool scrambler_locked)
+{
+	//Extract the header bits
+	uint8_t header =
+		(data.m_samples[i] ? 2 : 0) |
+		(data.m_samples[i+1] ? 1 : 0);
+
+	if( (header == 0) || (header == 3) )
+		return PCIe128b130bSymbol::TYPE_ERROR;
+	else if(header == 1)
+	{
+		if(scrambler_locked)
+			return PCIe128b130bSymbol::TYPE_DATA;
+		else
+			return PCIe128b130bSymbol::TYPE_SCRAMBLER_DESYNCED;
+	}
+	else
+		return PCIe128b130bSymbol::TYPE_ORDERED_SET;
+}
+
+/**
+	@brief Extracts the 16 raw (still scrambled) payload bytes of the block starting at bit i
+ */
+void PCIe128b130bDecoder::ExtractBlock(SparseDigitalWaveform& data, size_t i, uint8_t* symbols)
+{
+	for(size_t j=0; j<16; j++)
+	{
+		uint8_t tmp = 0;
+		for(size_t k=0; k<8; k++)
+			tmp |= (data.m_samples[i + j*8 + k + 2] << ( /* 7- */ k) );
+		symbols[j] = tmp;
+	}
+}
+
+/**
+	@brief Checks if an ordered set is a skip ordered set, and if so reseeds the scrambler from it
+
+	@return True if this is a SOS
+ */
+bool PCIe128b130bDecoder::ParseSkipOrderedSet(uint8_t* symbols, uint32_t& scrambler)
+{
+	//SOS starts with 0xAA
+	if(symbols[0] != 0xaa)
+		return false;
+
+	//Last 3 symbols are LFSR content
+	for(size_t j=1; j<16; j++)
+	{
+		if(symbols[j] == 0xe1)
+		{
+			scrambler = (symbols[j+1] << 16) | (symbols[j+2] << 8) | (symbols[j+3]);
+			break;
+		}
+	}
 
-		int64_t tstart = data.m_offsets[i] - data.m_durations[i]/2;
-		int64_t tend = data.m_offsets[i+130];
+	return true;
+}
+
+/**
+	@brief Adds a decoded block to the output, merging consecutive "scrambler desynced" blocks
+ */
+void PCIe128b130bDecoder::AppendSymbol(
+	PCIe128b130bWaveform* cap,
+	SparseDigitalWaveform& data,
+	size_t i,
+	PCIe128b130bSymbol::type_t type,
+	uint8_t* symbols)
+{
+	int64_t tstart = data.m_offsets[i] - data.m_durations[i]/2;
+	int64_t tend = data.m_offsets[i+130];
 
-		//Scrambler not locked? Prefer to extend existing symbol
-		if(type == PCIe128b130bSymbol::TYPE_SCRAMBLER_DESYNCED)
+	//Scrambler not locked? Prefer to extend existing symbol
+	if(type == PCIe128b130bSymbol::TYPE_SCRAMBLER_DESYNCED)
+	{
+		size_t sz = cap->m_offsets.size();
+		if(sz > 0)
 		{
-			size_t sz = cap->m_offsets.size();
-			if(sz > 0)
+			if(cap->m_samples[sz-1].m_type == PCIe128b130bSymbol::TYPE_SCRAMBLER_DESYNCED)
 			{
-				if(cap->m_samples[sz-1].m_type == PCIe128b130bSymbol::TYPE_SCRAMBLER_DESYNCED)
-				{
-					tstart = cap->m_offsets[sz-1];
-					cap->m_durations[sz-1] = (tend - tstart);
-					continue;
-				}
+				tstart = cap->m_offsets[sz-1];
+				cap->m_durations[sz-1] = (tend - tstart);
+				return;
 			}
 		}
-
-		//No, add a new symbol
-		cap->m_offsets.push_back(tstart);
-		cap->m_durations.push_back(tend - data.m_offsets[i]);
-		cap->m_samples.push_back(PCIe128b130bSymbol(type, symbols, len));
 	}
 
-	SetData(cap, 0);
-	cap->MarkModifiedFromCpu();
+	//No, add a new symbol
+	cap->m_offsets.push_back(tstart);
+	cap->m_durations.push_back(tend - data.m_offsets[i]);
+	cap->m_samples.push_back(PCIe128b130bSymbol(type, symbols, 16));
 }
 
 std::string PCIe128b130bWaveform::GetColor(size_t i)
@@ -280,3 +485,40 @@ uint8_t PCIe128b130bDecoder::RunScrambler(uint32_t& state)
 
 	return ret;
 }
+
+/**
+	@brief Advances the scrambler by one whole block (16 bytes) without generating any output
+
+	The scrambler is linear, so 128 steps are a fixed 23x23 matrix over GF(2). Bits above 22 never feed back into
+	the low bits (RunScrambler() leaves garbage there) so they're dropped.
+ */
+uint32_t PCIe128b130bDecoder::JumpScrambler(uint32_t state)
+{
+	static const vector<uint32_t> table = BuildScramblerJumpTable();
+
+	uint32_t ret = 0;
+	for(size_t j=0; j<23; j++)
+	{
+		if(state & (1 << j))
+			ret ^= table[j];
+	}
+	return ret;
+}
+
+/**
+	@brief Builds the table used by JumpScrambler()
+
+	Entry j is the effect of one block on LFSR state bit j.
+ */
+vector<uint32_t> PCIe128b130bDecoder::BuildScramblerJumpTable()
+{
+	vector<uint32_t> ret(23);
+	for(size_t j=0; j<23; j++)
+	{
+		uint32_t state = (1 << j);
+		for(size_t k=0; k<16; k++)
+			RunScrambler(state);
+		ret[j] = state & 0x7fffff;
+	}
+	return ret;
+}
@@ -76,12 +76,26 @@ public:
 	virtual std::string GetColor(size_t) override;
 };
 
+class PCIe128b130bBlockSyncConstants
+{
+public:
+	uint32_t	end;
+	uint32_t	blockLen;
+};
+
+class PCIe128b130bDescramblerConstants
+{
+public:
+	uint32_t	count;
+	uint32_t	start;
+};
+
 class PCIe128b130bDecoder : public Filter
 {
 public:
 	PCIe128b130bDecoder(const std::string& color);
 
-	virtual void Refresh() override;
+	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
 
 	static std::string GetProtocolName();
 
@@ -90,7 +104,41 @@ public:
 	PROTOCOL_DECODER_INITPROC(PCIe128b130bDecoder)
 
 protected:
-	uint8_t RunScrambler(uint32_t& state);
+	size_t FindBlockAlignment(
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue,
+		SparseDigitalWaveform& data,
+		size_t end);
+
+	PCIe128b130bSymbol::type_t GetBlockType(SparseDigitalWaveform& data, size_t i, bool scrambler_locked);
+	void ExtractBlock(SparseDigitalWaveform& data, size_t i, uint8_t* symbols);
+	bool ParseSkipOrderedSet(uint8_t* symbols, uint32_t& scrambler);
+
+	void AppendSymbol(
+		PCIe128b130bWaveform* cap,
+		SparseDigitalWaveform& data,
+		size_t i,
+		PCIe128b130bSymbol::type_t type,
+		uint8_t* symbols);
+
+	static uint8_t RunScrambler(uint32_t& state);
+	static uint32_t JumpScrambler(uint32_t state);
+	static std::vector<uint32_t> BuildScramblerJumpTable();
+
+	///@brief Invalid sync header count at each block phase
+	AcceleratorBuffer<uint32_t> m_syncErrors;
+
+	///@brief Scrambler state at the start of each block, plus a flag saying whether to descramble it
+	AcceleratorBuffer<uint32_t> m_seeds;
+
+	///@brief Descrambled payload of each block
+	AcceleratorBuffer<uint8_t> m_descrambled;
+
+	///@brief Compute pipeline for block sync search
+	std::shared_ptr<ComputePipeline> m_blockSyncComputePipeline;
+
+	///@brief Compute pipeline for descrambling
+	std::shared_ptr<ComputePipeline> m_descrambleComputePipeline;
 };
 
 #endif
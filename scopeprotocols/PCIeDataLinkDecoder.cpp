@@ -637,22 +637,9 @@ void PCIeDataLinkDecoder::Refresh()
  */
 uint16_t PCIeDataLinkDecoder::CalculateDllpCRC(uint8_t type, uint8_t* data)
 {
+	static const ReflectedCRCTable table(0xd008);
 	uint8_t crc_in[4] = { type, data[0], data[1], data[2] };
-
-	uint16_t poly = 0xd008;
-	uint16_t crc = 0xffff;
-
-	for(int n=0; n<4; n++)
-	{
-		uint8_t d = crc_in[n];
-		for(int i=0; i<8; i++)
-		{
-			bool b = ( crc ^ (d >> i) ) & 1;
-			crc >>= 1;
-			if(b)
-				crc ^= poly;
-		}
-	}
+	uint16_t crc = table.Update(0xffff, crc_in, 4);
 
 	return ~( (crc << 8) | ( (crc >> 8) & 0xff) );
 }
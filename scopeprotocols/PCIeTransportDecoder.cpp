@@ -46,8 +46,18 @@ using namespace std;
 PCIeTransportDecoder::PCIeTransportDecoder(const string& color)
 	: PacketDecoder(color, CAT_BUS)
 {
+	//Request to completion latency of each matched non-posted request
+	AddStream(Unit(Unit::UNIT_FS), "latency", Stream::STREAM_TYPE_ANALOG);
+
 	//Set up channels
 	CreateInput("link");
+
+	//Index the fields most searches filter on.
+	//Addr is fixed width hex, so a PREFIX query on it selects an aligned address range
+	m_packetIndex.IndexColumn("Type");
+	m_packetIndex.IndexColumn("Addr");
+	m_packetIndex.IndexColumn("Requester");
+	m_packetIndex.IndexColumn("Completer");
 }
 
 PCIeTransportDecoder::~PCIeTransportDecoder()
@@ -84,6 +94,7 @@ void PCIeTransportDecoder::Refresh()
 	if(!VerifyAllInputsOK())
 	{
 		SetData(NULL, 0);
+		SetData(NULL, 1);
 		return;
 	}
 	auto data = dynamic_cast<PCIeDataLinkWaveform*>(GetInputWaveform(0));
@@ -97,6 +108,14 @@ void PCIeTransportDecoder::Refresh()
 	cap->PrepareForCpuAccess();
 	SetData(cap, 0);
 
+	//Latency output is in absolute femtoseconds, one sample at each matched completion
+	auto latency = SetupEmptySparseAnalogOutputWaveform(data, 1, true);
+	latency->PrepareForCpuAccess();
+	latency->m_timescale = 1;
+
+	//Non-posted requests still waiting on a completion, keyed by requester ID and tag
+	unordered_map<uint32_t, OutstandingRequest> outstanding;
+
 	enum
 	{
 		STATE_IDLE,
@@ -1030,6 +1049,9 @@ void PCIeTransportDecoder::Refresh()
 					//TODO: verify length wasn't truncated
 					//TODO: verify TLP end to end CRC if present
 					state = STATE_IDLE;
+
+					MatchTransaction(outstanding, latency, pack, type, requester_id, tag, completion_status,
+						byte_count);
 				}
 
 				else if(sym.m_type != PCIeDataLinkSymbol::TYPE_TLP_DATA)
@@ -1056,6 +1078,7 @@ void PCIeTransportDecoder::Refresh()
 	}
 
 	cap->MarkModifiedFromCpu();
+	latency->MarkModifiedFromCpu();
 }
 
 std::string PCIeTransportWaveform::GetColor(size_t i)
@@ -1232,6 +1255,86 @@ string PCIeTransportWaveform::GetText(size_t i)
 	}
 }
 
+/**
+	@brief Pairs non-posted requests with their completions as each TLP finishes decoding
+
+	Requests are remembered by requester ID and tag until the completion carrying the last of their data (or an
+	error status) arrives, so matching is a hash lookup per TLP rather than a search of the packet list. The first
+	completion for each request gets a "Latency" header and a sample on the latency stream.
+
+	@param outstanding		Requests still waiting on a completion
+	@param latency			Latency output waveform
+	@param pack				The TLP which just finished
+	@param type				TLP type
+	@param requester_id		Requester ID of the TLP
+	@param tag				Tag of the TLP
+	@param status			Completion status (completions only)
+	@param byte_count		Remaining byte count (completions only)
+ */
+void PCIeTransportDecoder::MatchTransaction(
+	unordered_map<uint32_t, OutstandingRequest>& outstanding,
+	SparseAnalogWaveform* latency,
+	Packet* pack,
+	PCIeTransportSymbol::TlpType type,
+	uint16_t requester_id,
+	uint8_t tag,
+	uint8_t status,
+	uint16_t byte_count)
+{
+	uint32_t key = TransactionKey(requester_id, tag);
+
+	switch(type)
+	{
+		//Non-posted requests expect a completion. A reused tag means the old one was never answered (or the
+		//completion was outside the capture), so just replace it
+		case PCIeTransportSymbol::TYPE_MEM_RD:
+		case PCIeTransportSymbol::TYPE_MEM_RD_LK:
+		case PCIeTransportSymbol::TYPE_IO_RD:
+		case PCIeTransportSymbol::TYPE_IO_WR:
+		case PCIeTransportSymbol::TYPE_CFG_RD_0:
+		case PCIeTransportSymbol::TYPE_CFG_WR_0:
+		case PCIeTransportSymbol::TYPE_CFG_RD_1:
+		case PCIeTransportSymbol::TYPE_CFG_WR_1:
+			outstanding[key] = { pack->m_offset, false };
+			break;
+
+		case PCIeTransportSymbol::TYPE_COMPLETION:
+		case PCIeTransportSymbol::TYPE_COMPLETION_DATA:
+		case PCIeTransportSymbol::TYPE_COMPLETION_LOCKED_ERROR:
+		case PCIeTransportSymbol::TYPE_COMPLETION_LOCKED_DATA:
+			{
+				auto it = outstanding.find(key);
+				if(it == outstanding.end())
+					break;
+
+				int64_t delta = pack->m_offset - it->second.m_start;
+				pack->m_headers["Latency"] = Unit(Unit::UNIT_FS).PrettyPrint(delta);
+
+				//Only the first completion of a split read goes on the latency stream
+				if(!it->second.m_completed)
+				{
+					size_t n = latency->m_samples.size();
+					if(n)
+						latency->m_durations[n-1] = pack->m_offset - latency->m_offsets[n-1];
+					latency->m_offsets.push_back(pack->m_offset);
+					latency->m_durations.push_back(1);
+					latency->m_samples.push_back(delta);
+					it->second.m_completed = true;
+				}
+
+				//Byte count is what's left including this TLP (zero means 4096), so we're done once the payload covers
+				//it. Completions without data, or with an error status, always end the transaction.
+				size_t remaining = byte_count ? byte_count : 4096;
+				if( (status != 0) || pack->m_data.empty() || (pack->m_data.size() >= remaining) )
+					outstanding.erase(it);
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
 vector<string> PCIeTransportDecoder::GetHeaders()
 {
 	vector<string> ret;
@@ -1247,6 +1350,7 @@ vector<string> PCIeTransportDecoder::GetHeaders()
 	ret.push_back("Last");
 	ret.push_back("Status");
 	ret.push_back("Count");
+	ret.push_back("Latency");
 
 	ret.push_back("Length");
 	return ret;
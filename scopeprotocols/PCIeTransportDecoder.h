@@ -37,6 +37,7 @@
 #define PCIeTransportDecoder_h
 
 #include "../scopehal/PacketDecoder.h"
+#include <unordered_map>
 
 class PCIeTransportSymbol
 {
@@ -139,6 +140,32 @@ public:
 	PROTOCOL_DECODER_INITPROC(PCIeTransportDecoder)
 
 	static std::string FormatID(uint16_t id);
+
+	///@brief Key for matching a completion to its request: requester ID in the high bits, tag in the low
+	static uint32_t TransactionKey(uint16_t requester, uint8_t tag)
+	{ return (static_cast<uint32_t>(requester) << 8) | tag; }
+
+protected:
+
+	///@brief A non-posted request which has not yet been fully completed
+	struct OutstandingRequest
+	{
+		///@brief Start time of the request TLP
+		int64_t m_start;
+
+		///@brief True once the first completion has been seen
+		bool m_completed;
+	};
+
+	void MatchTransaction(
+		std::unordered_map<uint32_t, OutstandingRequest>& outstanding,
+		SparseAnalogWaveform* latency,
+		Packet* pack,
+		PCIeTransportSymbol::TlpType type,
+		uint16_t requester_id,
+		uint8_t tag,
+		uint8_t status,
+		uint16_t byte_count);
 };
 
 #endif
@@ -166,14 +166,27 @@ void PRBSCheckerFilter::Refresh()
 		dout->m_samples[i] = 0;
 	}
 
-	//Start checking actual data bits
-	for(size_t i=statesize; i<len; i++)
+	//Start checking actual data bits.
+	//Each block jumps the reference LFSR ahead to where it starts, so they can be checked in parallel.
+	const size_t blocksize = PRBSGeneratorFilter::PRBS_BLOCK_SIZE;
+	size_t nblocks = (len - statesize + blocksize - 1) / blocksize;
+	#pragma omp parallel for
+	for(size_t block=0; block<nblocks; block++)
 	{
-		dout->m_offsets[i] = data.m_offsets[i];
-		dout->m_durations[i] = data.m_durations[i];
-
-		bool value = PRBSGeneratorFilter::RunPRBS(prbs, poly);
-		dout->m_samples[i] = (value != data.m_samples[i]);
+		size_t start = statesize + block*blocksize;
+		size_t count = min(blocksize, len - start);
+
+		bool expected[blocksize];
+		PRBSGeneratorFilter::GeneratePRBS(
+			PRBSGeneratorFilter::JumpPRBS(prbs, poly, start - statesize), poly, expected, count);
+
+		for(size_t j=0; j<count; j++)
+		{
+			size_t i = start + j;
+			dout->m_offsets[i] = data.m_offsets[i];
+			dout->m_durations[i] = data.m_durations[i];
+			dout->m_samples[i] = (expected[j] != data.m_samples[i]);
+		}
 	}
 
 	dout->MarkModifiedFromCpu();
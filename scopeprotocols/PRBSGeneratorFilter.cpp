@@ -151,6 +151,137 @@ bool PRBSGeneratorFilter::RunPRBS(uint32_t& state, Polynomials poly)
 	return (bool)next;
 }
 
+/**
+	@brief Gets the feedback taps of a polynomial
+
+	Every supported polynomial has two taps, so the output sequence obeys s[i] = s[i-n] ^ s[i-m] with n > m.
+ */
+void PRBSGeneratorFilter::GetPRBSTaps(Polynomials poly, size_t& n, size_t& m)
+{
+	switch(poly)
+	{
+		case POLY_PRBS7:
+			n = 7;
+			m = 6;
+			break;
+
+		case POLY_PRBS9:
+			n = 9;
+			m = 5;
+			break;
+
+		case POLY_PRBS11:
+			n = 11;
+			m = 9;
+			break;
+
+		case POLY_PRBS15:
+			n = 15;
+			m = 14;
+			break;
+
+		case POLY_PRBS23:
+			n = 23;
+			m = 18;
+			break;
+
+		case POLY_PRBS31:
+		default:
+			n = 31;
+			m = 28;
+			break;
+	}
+}
+
+/**
+	@brief Returns the state RunPRBS() would leave behind after nbits calls, in O(log nbits) time
+
+	One step of the LFSR is a linear map over GF(2), so nbits steps are the nbits'th power of its matrix, found by
+	repeated squaring. Only the low bits the polynomial actually uses are meaningful (and returned).
+
+	@param state	Initial state
+	@param poly		Polynomial
+	@param nbits	Number of bits to skip
+ */
+uint32_t PRBSGeneratorFilter::JumpPRBS(uint32_t state, Polynomials poly, uint64_t nbits)
+{
+	size_t n;
+	size_t m;
+	GetPRBSTaps(poly, n, m);
+	state &= (1u << n) - 1;
+
+	//Column c is the image of state bit c after one step: it shifts up, and the taps feed back into bit 0
+	uint32_t matrix[32];
+	for(size_t c=0; c<n; c++)
+	{
+		matrix[c] = (c+1 < n) ? (1u << (c+1)) : 0;
+		if( (c == n-1) || (c == m-1) )
+			matrix[c] |= 1;
+	}
+
+	auto apply = [&](const uint32_t* mat, uint32_t v)
+	{
+		uint32_t ret = 0;
+		for(size_t b=0; b<n; b++)
+		{
+			if(v & (1u << b))
+				ret ^= mat[b];
+		}
+		return ret;
+	};
+
+	while(nbits)
+	{
+		if(nbits & 1)
+			state = apply(matrix, state);
+		nbits >>= 1;
+
+		if(nbits)
+		{
+			uint32_t squared[32];
+			for(size_t c=0; c<n; c++)
+				squared[c] = apply(matrix, matrix[c]);
+			memcpy(matrix, squared, n * sizeof(uint32_t));
+		}
+	}
+
+	return state;
+}
+
+/**
+	@brief Generates len bits of PRBS output, equivalent to calling RunPRBS() len times
+
+	Since s[i] = s[i-n] ^ s[i-m], the next m bits only depend on bits already in the state, so are computed in one
+	step with a couple of shifts rather than one bit at a time.
+
+	@param state	Initial state
+	@param poly		Polynomial
+	@param out		Output buffer
+	@param len		Number of bits to generate
+ */
+void PRBSGeneratorFilter::GeneratePRBS(uint32_t state, Polynomials poly, bool* out, size_t len)
+{
+	size_t n;
+	size_t m;
+	GetPRBSTaps(poly, n, m);
+
+	//New bit j of the block is at bit (k-1-j), matching the order RunPRBS() shifts them in
+	size_t k = m;
+	uint32_t mask = (1u << k) - 1;
+	size_t i = 0;
+	for(; i+k <= len; i += k)
+	{
+		uint32_t w = ( (state >> (n-k)) ^ (state >> (m-k)) ) & mask;
+		state = (state << k) | w;
+
+		for(size_t j=0; j<k; j++)
+			out[i+j] = (w >> (k-1-j)) & 1;
+	}
+
+	for(; i<len; i++)
+		out[i] = RunPRBS(state, poly);
+}
+
 void PRBSGeneratorFilter::Refresh()
 {
 	size_t depth = m_parameters[m_depthname].GetIntVal();
@@ -188,14 +319,20 @@ void PRBSGeneratorFilter::Refresh()
 	clk->m_startFemtoseconds = fs;
 	clk->Resize(depth);
 
-	bool lastclk = false;
-	uint32_t prbs = rand();
+	//Clock toggles every UI, starting low
+	#pragma omp parallel for
 	for(size_t i=0; i<depth; i++)
-	{
-		clk->m_samples[i] = lastclk;
-		lastclk = !lastclk;
+		clk->m_samples[i] = (i & 1);
 
-		dat->m_samples[i] = RunPRBS(prbs, poly);
+	//Jump each block of data ahead to its starting state so they can be generated in parallel
+	uint32_t prbs = rand();
+	auto pdat = dat->m_samples.GetCpuPointer();
+	size_t nblocks = (depth + PRBS_BLOCK_SIZE - 1) / PRBS_BLOCK_SIZE;
+	#pragma omp parallel for
+	for(size_t block=0; block<nblocks; block++)
+	{
+		size_t start = block * PRBS_BLOCK_SIZE;
+		GeneratePRBS(JumpPRBS(prbs, poly, start), poly, pdat + start, min(depth - start, (size_t)PRBS_BLOCK_SIZE));
 	}
 
 	clk->MarkModifiedFromCpu();
@@ -60,8 +60,15 @@ public:
 	};
 
 	static bool RunPRBS(uint32_t& state, Polynomials poly);
+	static uint32_t JumpPRBS(uint32_t state, Polynomials poly, uint64_t nbits);
+	static void GeneratePRBS(uint32_t state, Polynomials poly, bool* out, size_t len);
+
+	///@brief Number of bits generated by each thread
+	static constexpr size_t PRBS_BLOCK_SIZE = 16384;
 
 protected:
+	static void GetPRBSTaps(Polynomials poly, size_t& n, size_t& m);
+
 	std::string m_baudname;
 	std::string m_polyname;
 	std::string m_depthname;
@@ -83,48 +83,80 @@ void ParallelBus::Refresh()
 	//Figure out how wide our input is
 	int width = m_parameters[m_widthname].GetIntVal();
 
-	//Make sure we have an input for each channel in use
-	vector<SparseDigitalWaveform*> inputs;
+	//Bit packed inputs can be merged an edge at a time rather than a sample at a time
+	vector<UniformPackedDigitalWaveform*> packedInputs;
 	for(int i=0; i<width; i++)
 	{
-		auto din = dynamic_cast<SparseDigitalWaveform*>(GetInputWaveform(i));
-		if(din == NULL)
-		{
-			SetData(NULL, 0);
-			return;
-		}
+		auto din = dynamic_cast<UniformPackedDigitalWaveform*>(GetInputWaveform(i));
+		if(din == nullptr)
+			break;
 		din->PrepareForCpuAccess();
-		inputs.push_back(din);
+		packedInputs.push_back(din);
 	}
-	if(inputs.empty())
+
+	SparseDigitalBusWaveform* cap = nullptr;
+	WaveformBase* first = nullptr;
+	if( (width > 0) && (packedInputs.size() == static_cast<size_t>(width)) )
 	{
-		SetData(NULL, 0);
-		return;
+		cap = MergePacked(packedInputs);
+		first = packedInputs[0];
 	}
 
-	//Figure out length of the output
-	size_t len = inputs[0]->m_samples.size();
-	for(int j=1; j<width; j++)
-		len = min(len, inputs[j]->m_samples.size());
-
-	//Merge all of our samples
-	//TODO: handle variable sample rates etc
-	auto cap = new SparseDigitalBusWaveform;
-	cap->PrepareForCpuAccess();
-	cap->Resize(len);
-	cap->CopyTimestamps(inputs[0]);
-	#pragma omp parallel for
-	for(size_t i=0; i<len; i++)
+	else
 	{
-		for(int j=0; j<width; j++)
-			cap->m_samples[i].push_back(inputs[j]->m_samples[i]);
+		//Make sure we have an input for each channel in use
+		vector<SparseDigitalWaveform*> inputs;
+		for(int i=0; i<width; i++)
+		{
+			auto din = dynamic_cast<SparseDigitalWaveform*>(GetInputWaveform(i));
+			if(din == NULL)
+			{
+				SetData(NULL, 0);
+				return;
+			}
+			din->PrepareForCpuAccess();
+			inputs.push_back(din);
+		}
+
+		if(inputs.empty())
+		{
+			SetData(NULL, 0);
+			return;
+		}
+
+		//Figure out length of the output
+		size_t len = inputs[0]->m_samples.size();
+		for(int j=1; j<width; j++)
+			len = min(len, inputs[j]->m_samples.size());
+
+		//Merge all of our samples
+		//TODO: handle variable sample rates etc
+		cap = GetOutputWaveform<SparseDigitalBusWaveform>(0);
+		cap->PrepareForCpuAccess();
+		cap->Resize(len);
+		cap->CopyTimestamps(inputs[0]);
+		vector<const bool*> bits;
+		for(auto p : inputs)
+			bits.push_back(p->m_samples.GetCpuPointer());
+		auto pout = cap->m_samples.GetCpuPointer();
+		#pragma omp parallel for
+		for(size_t i=0; i<len; i++)
+		{
+			uint64_t value = 0;
+			for(int j=0; j<width; j++)
+				value |= static_cast<uint64_t>(bits[j][i]) << j;
+			pout[i] = value;
+		}
+		first = inputs[0];
 	}
+
+	cap->m_width = width;
 	SetData(cap, 0);
 
 	//Copy our time scales from the input
-	cap->m_timescale = inputs[0]->m_timescale;
-	cap->m_startTimestamp = inputs[0]->m_startTimestamp;
-	cap->m_startFemtoseconds = inputs[0]->m_startFemtoseconds;
+	cap->m_timescale = first->m_timescale;
+	cap->m_startTimestamp = first->m_startTimestamp;
+	cap->m_startFemtoseconds = first->m_startFemtoseconds;
 
 	//Set all unused channels to NULL
 	for(size_t i=width; i < 16; i++)
@@ -141,3 +173,39 @@ void ParallelBus::Refresh()
 
 	cap->MarkModifiedFromCpu();
 }
+
+/**
+	@brief Merges bit packed inputs into a run-length encoded bus waveform
+
+	A new output sample is only emitted when at least one input toggles, so long stretches of idle bus cost nothing.
+ */
+SparseDigitalBusWaveform* ParallelBus::MergePacked(const vector<UniformPackedDigitalWaveform*>& inputs)
+{
+	size_t len = inputs[0]->size();
+	for(auto p : inputs)
+		len = min(len, p->size());
+
+	auto cap = GetOutputWaveform<SparseDigitalBusWaveform>(0);
+	cap->PrepareForCpuAccess();
+	cap->clear();
+
+	size_t i = 0;
+	while(i < len)
+	{
+		//Current value of the bus, and the next time any input changes
+		uint64_t value = 0;
+		size_t next = len;
+		for(size_t j=0; j<inputs.size(); j++)
+		{
+			value |= static_cast<uint64_t>(inputs[j]->GetSample(i)) << j;
+			next = min(next, inputs[j]->FindNextEdge(i));
+		}
+
+		cap->m_offsets.push_back(i);
+		cap->m_durations.push_back(next - i);
+		cap->m_samples.push_back(value);
+		i = next;
+	}
+
+	return cap;
+}
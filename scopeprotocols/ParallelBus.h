@@ -49,6 +49,8 @@ public:
 	PROTOCOL_DECODER_INITPROC(ParallelBus)
 
 protected:
+	SparseDigitalBusWaveform* MergePacked(const std::vector<UniformPackedDigitalWaveform*>& inputs);
+
 	std::string m_widthname;
 };
 
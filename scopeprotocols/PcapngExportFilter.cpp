@@ -36,6 +36,7 @@
 
 #include "../scopehal/scopehal.h"
 #include "PcapngExportFilter.h"
+#include "EthernetFlowTable.h"
 
 #include <cinttypes>
 
@@ -46,10 +47,21 @@ using namespace std;
 
 PcapngExportFilter::PcapngExportFilter(const string& color)
 	: ExportFilter(color)
+	, m_rotateSize("Rotate after size")
+	, m_rotateInterval("Rotate after time")
+	, m_fileBytes(0)
+	, m_fileOpenTime(0)
+	, m_rotateIndex(0)
 {
 	m_parameters[m_fname].m_fileFilterMask = "*.pcapng";
 	m_parameters[m_fname].m_fileFilterName = "PcapNG files (*.pcapng)";
 
+	//Zero disables rotation
+	m_parameters[m_rotateSize] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_BYTES));
+	m_parameters[m_rotateSize].SetIntVal(0);
+	m_parameters[m_rotateInterval] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_FS));
+	m_parameters[m_rotateInterval].SetIntVal(0);
+
 	CreateInput("packets");
 }
 
@@ -83,6 +95,135 @@ string PcapngExportFilter::GetProtocolName()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
+/**
+	@brief Opens the output file (or the next one, when rotating), writing the section header if it's new
+
+	@return True on success
+ */
+bool PcapngExportFilter::OpenFile()
+{
+	auto mode = static_cast<ExportMode_t>(m_parameters[m_mode].GetIntVal());
+	bool append = (mode == MODE_CONTINUOUS_APPEND) || (mode == MODE_MANUAL_APPEND);
+	bool pipe = (mode == MODE_CONTINUOUS_PIPE) || (mode == MODE_MANUAL_PIPE);
+
+	//Rotated files are numbered, e.g. capture_00003.pcapng
+	auto fname = m_parameters[m_fname].GetFileName();
+	bool rotating = (m_parameters[m_rotateSize].GetIntVal() > 0) || (m_parameters[m_rotateInterval].GetIntVal() > 0);
+	if(rotating && !pipe)
+	{
+		char suffix[32];
+		snprintf(suffix, sizeof(suffix), "_%05zu", m_rotateIndex);
+		auto dot = fname.rfind('.');
+		auto slash = fname.find_last_of("/\\");
+		if( (dot == string::npos) || ( (slash != string::npos) && (dot < slash) ) )
+			fname += suffix;
+		else
+			fname.insert(dot, suffix);
+	}
+
+	if(append)
+		m_fp = fopen(fname.c_str(), "ab");
+	else
+		m_fp = fopen(fname.c_str(), "wb");
+	if(!m_fp)
+	{
+		LogError("Failed to open file %s for writing\n", fname.c_str());
+		return false;
+	}
+
+	m_fileBytes = 0;
+	m_fileOpenTime = GetTime();
+
+	//See if file is empty or a pipe. If so, write header
+	if(!pipe)
+		fseek(m_fp, 0, SEEK_END);
+	if(pipe || (ftell(m_fp) == 0) )
+	{
+		LogTrace("File was empty, writing SHB\n");
+
+		string header;
+		WriteHeaders(header);
+		m_fileBytes += header.size();
+		QueueWrite(std::move(header));
+	}
+	else
+		m_fileBytes = ftell(m_fp);
+
+	return true;
+}
+
+/**
+	@brief Checks if the current file has reached the size or age at which we start a new one
+ */
+bool PcapngExportFilter::IsRotationDue()
+{
+	auto mode = static_cast<ExportMode_t>(m_parameters[m_mode].GetIntVal());
+	if( (mode == MODE_CONTINUOUS_PIPE) || (mode == MODE_MANUAL_PIPE) )
+		return false;
+
+	auto maxSize = m_parameters[m_rotateSize].GetIntVal();
+	if( (maxSize > 0) && (m_fileBytes >= static_cast<size_t>(maxSize)) )
+		return true;
+
+	auto maxAge = m_parameters[m_rotateInterval].GetIntVal();
+	if( (maxAge > 0) && ( (GetTime() - m_fileOpenTime) * FS_PER_SECOND >= maxAge) )
+		return true;
+
+	return false;
+}
+
+/**
+	@brief Writes the section header block and interface description block
+ */
+void PcapngExportFilter::WriteHeaders(string& out)
+{
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// SHB
+
+	shb_t shb;
+	shb.block_type = 0x0a0d0d0a;
+	shb.block_total_length = 28;
+	shb.byte_order_magic = 0x1a2b3c4d;
+	shb.major_version = 1;
+	shb.minor_version = 0;
+	shb.section_length = -1;	//unspecified, live streaming
+	out.append(reinterpret_cast<const char*>(&shb), sizeof(shb));
+	out.append(reinterpret_cast<const char*>(&shb.block_total_length), sizeof(shb.block_total_length));
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// IDB
+
+	idb_t idb;
+	idb.block_type = 0x1;
+	idb.block_total_length = 40;
+	idb.link_type = 1;
+	idb.reserved = 0;
+	idb.snap_len = 0;
+	out.append(reinterpret_cast<const char*>(&idb), sizeof(idb));
+
+	//Option if_name (total 8 bytes)
+	optionhdr_t opt;
+	opt.id = 2;
+	opt.len = 4;
+	out.append(reinterpret_cast<const char*>(&opt), sizeof(opt));
+	out.append("eth0", 4);
+
+	//Option it_tsresol (total 8 bytes)
+	opt.id = 9;
+	opt.len = 1;
+	out.append(reinterpret_cast<const char*>(&opt), sizeof(opt));
+	uint8_t tsresol[4] = {9, 0, 0, 0};	//nanosecond resolution
+	out.append(reinterpret_cast<const char*>(tsresol), sizeof(tsresol));
+
+	//Option endofopt (total 4 bytes)
+	opt.id = 0;
+	opt.len = 0;
+	out.append(reinterpret_cast<const char*>(&opt), sizeof(opt));
+
+	//Write the IDB length again
+	out.append(reinterpret_cast<const char*>(&idb.block_total_length), sizeof(idb.block_total_length));
+}
+
 void PcapngExportFilter::Export()
 {
 	LogTrace("Exporting\n");
@@ -91,204 +232,84 @@ void PcapngExportFilter::Export()
 	if(!VerifyAllInputsOK())
 		return;
 
-	//If file is not open, open it and write a section header block if necessary
-	if(!m_fp)
+	//Start a new file if this one is full. The old one is closed once everything queued for it has been written.
+	if(m_fp && IsRotationDue())
 	{
-		LogTrace("File wasn't open, opening it\n");
-
-		auto mode = static_cast<ExportMode_t>(m_parameters[m_mode].GetIntVal());
-
-		auto fname = m_parameters[m_fname].GetFileName();
-		bool append = (mode == MODE_CONTINUOUS_APPEND) || (mode == MODE_MANUAL_APPEND);
-		bool pipe = (mode == MODE_CONTINUOUS_PIPE) || (mode == MODE_MANUAL_PIPE);
-		if(append)
-			m_fp = fopen(fname.c_str(), "ab");
-		else
-			m_fp = fopen(fname.c_str(), "wb");
-
-		if(!m_fp)
-		{
-			LogError("Failed to open file %s for writing\n", fname.c_str());
-			return;
-		}
-
-		//See if file is empty or a pipe. If so, write header
-		if(!pipe)
-			fseek(m_fp, 0, SEEK_END);
-		if(pipe || (ftell(m_fp) == 0) )
-		{
-			LogTrace("File was empty, writing SHB\n");
-
-			////////////////////////////////////////////////////////////////////////////////////////////////////////////
-			// Write the SHB
-
-			shb_t shb;
-			shb.block_type = 0x0a0d0d0a;
-			shb.block_total_length = 28;
-			shb.byte_order_magic = 0x1a2b3c4d;
-			shb.major_version = 1;
-			shb.minor_version = 0;
-			shb.section_length = -1;	//unspecified, live streaming
-			if(!fwrite(&shb, sizeof(shb), 1, m_fp))
-				LogError("file write failure\n");
-			if(!fwrite(&shb.block_total_length, sizeof(shb.block_total_length), 1, m_fp))
-				LogError("file write failure\n");
-
-			////////////////////////////////////////////////////////////////////////////////////////////////////////////
-			// Write the IDB
-
-			idb_t idb;
-			idb.block_type = 0x1;
-			idb.block_total_length = 40;
-			idb.link_type = 1;
-			idb.reserved = 0;
-			idb.snap_len = 0;
-			if(!fwrite(&idb, sizeof(idb), 1, m_fp))
-				LogError("file write failure\n");
-
-			//Option if_name (total 8 bytes)
-			optionhdr_t opt;
-			opt.id = 2;
-			opt.len = 4;
-			if(!fwrite(&opt, sizeof(opt), 1, m_fp))
-				LogError("file write failure\n");
-			const char* ifname = "eth0";
-			if(!fwrite(ifname, strlen(ifname), 1, m_fp))
-				LogError("file write failure\n");
-
-			//Option it_tsresol (total 8 bytes)
-			opt.id = 9;
-			opt.len = 1;
-			if(!fwrite(&opt, sizeof(opt), 1, m_fp))
-				LogError("file write failure\n");
-			uint8_t tsresol[4] = {9, 0, 0, 0};	//nanosecond resolution
-			if(!fwrite(tsresol, sizeof(tsresol), 1, m_fp))
-				LogError("file write failure\n");
-
-			//Option endofopt (total 4 bytes)
-			opt.id = 0;
-			opt.len = 0;
-			if(!fwrite(&opt, sizeof(opt), 1, m_fp))
-				LogError("file write failure\n");
-
-			//Write the IDB length again
-			if(!fwrite(&idb.block_total_length, sizeof(idb.block_total_length), 1, m_fp))
-				LogError("file write failure\n");
-		}
+		QueueClose();
+		m_rotateIndex ++;
 	}
 
+	//If file is not open, open it and write a section header block if necessary
+	if(!m_fp && !OpenFile())
+		return;
+
+	//Assemble all of the blocks in memory and hand them to the background writer in one go
+	string blocks;
 	auto stream = GetInput(0);
 	auto wfm = dynamic_cast<EthernetWaveform*>(stream.m_channel->GetData(0));
 	if(wfm)
-		ExportEthernet(wfm);
+		ExportEthernet(wfm, blocks);
 
-	fflush(m_fp);
+	m_fileBytes += blocks.size();
+	QueueWrite(std::move(blocks));
 }
 
 /**
 	@brief Export Ethernet frames to a PCAPNG file
+
+	Frames are copied straight out of the flow table's byte store into the output buffer.
  */
-void PcapngExportFilter::ExportEthernet(EthernetWaveform* wfm)
+void PcapngExportFilter::ExportEthernet(EthernetWaveform* wfm, string& out)
 {
-	vector<uint8_t> bytes;
-	int64_t offset = 0;
-	for(size_t i=0; i<wfm->m_samples.size(); i++)
+	auto flows = wfm->GetFlowTable();
+
+	size_t total = 0;
+	for(auto& f : flows->m_frames)
+		total += f.m_len + 40;
+	out.reserve(out.size() + total);
+
+	for(size_t i=0; i<flows->m_frames.size(); i++)
 	{
-		auto& samp = wfm->m_samples[i];
-		switch(samp.m_type)
-		{
-			//Start a new frame, clear out anything else
-			case EthernetFrameSegment::TYPE_SFD:
-				bytes.clear();
-				offset = wfm->m_offsets[i] * wfm->m_timescale + wfm->m_triggerPhase;
-				break;
-
-			//Frame data
-			case EthernetFrameSegment::TYPE_DST_MAC:
-			case EthernetFrameSegment::TYPE_SRC_MAC:
-			case EthernetFrameSegment::TYPE_ETHERTYPE:
-			case EthernetFrameSegment::TYPE_VLAN_TAG:
-			case EthernetFrameSegment::TYPE_PAYLOAD:
-				{
-					for(size_t j=0; j<samp.m_data.size(); j++)
-						bytes.push_back(samp.m_data[j]);
-				}
-				break;
-
-			//Good checksum, save the packet to the file
-			case EthernetFrameSegment::TYPE_FCS_GOOD:
-				ExportPacket(bytes, wfm->m_startTimestamp, wfm->m_startFemtoseconds + offset);
-				bytes.clear();
-				break;
-
-			//bad checksum, drop the packet
-			case EthernetFrameSegment::TYPE_FCS_BAD:
-				bytes.clear();
-				break;
-
-			//ignore anything else
-			default:
-				break;
-		}
+		//Drop anything without a good checksum
+		auto& f = flows->m_frames[i];
+		if(!f.m_fcsGood)
+			continue;
+
+		int64_t offset = wfm->m_offsets[f.m_firstSample] * wfm->m_timescale + wfm->m_triggerPhase;
+		ExportPacket(out, flows->GetFrameBytes(i), f.m_len, wfm->m_startTimestamp, wfm->m_startFemtoseconds + offset);
 	}
 }
 
-void PcapngExportFilter::ExportPacket(vector<uint8_t>& packet, time_t timestamp, int64_t fs)
+/**
+	@brief Appends an enhanced packet block
+ */
+void PcapngExportFilter::ExportPacket(string& out, const uint8_t* packet, size_t len, time_t timestamp, int64_t fs)
 {
 	//Canonicalize the timestamp to a single 64-bit nanosecond resolution quantity
 	int64_t ns = (1e9 * timestamp) + (fs * 1e-6);
 
-	//Block type
-	uint32_t blocktype = 6;
-	if(!fwrite(&blocktype, sizeof(blocktype), 1, m_fp))
-		LogError("file write failure\n");
-
 	//Block length (padded up to next 32 bit boundary)
-	uint32_t blocklen = 36 + packet.size();
-	uint32_t paddinglen = 4 - (blocklen % 4);
-	if(paddinglen == 4)
-		paddinglen = 0;
-	blocklen += paddinglen;
-	if(!fwrite(&blocklen, sizeof(blocklen), 1, m_fp))
-		LogError("file write failure\n");
-
-	//Interface ID
-	uint32_t iface = 0;
-	if(!fwrite(&iface, sizeof(iface), 1, m_fp))
-		LogError("file write failure\n");
-
-	//Timestamp
-	uint32_t tshi = (ns >> 32);
-	uint32_t tslo = (ns & 0xffffffff);
-	if(!fwrite(&tshi, sizeof(tshi), 1, m_fp))
-		LogError("file write failure\n");
-	if(!fwrite(&tslo, sizeof(tslo), 1, m_fp))
-		LogError("file write failure\n");
-
-	//Packet length repeated twice (original + captured, both always equal for us)
-	uint32_t packetlen = packet.size();
-	if(!fwrite(&packetlen, sizeof(packetlen), 1, m_fp))
-		LogError("file write failure\n");
-	if(!fwrite(&packetlen, sizeof(packetlen), 1, m_fp))
-		LogError("file write failure\n");
-
-	//Packet data
-	if(!fwrite(&packet[0], packet.size(), 1, m_fp))
-		LogError("file write failure\n");
-
-	//Pad out to 32 bit boundary
-	uint8_t padbuf[4] = {0};
-	if(!fwrite(&padbuf[0], paddinglen, 1, m_fp))
-		LogError("file write failure\n");
+	uint32_t blocklen = 36 + ( (len + 3) & ~static_cast<size_t>(3) );
 
-	//Option endofopt (total 4 bytes)
-	uint16_t pad = 0;
-	if(!fwrite(&pad, sizeof(pad), 1, m_fp))
-		LogError("file write failure\n");
-	if(!fwrite(&pad, sizeof(pad), 1, m_fp))
-		LogError("file write failure\n");
+	//Padding and the endofopt option are zero, so come for free with the resize
+	size_t base = out.size();
+	out.resize(base + blocklen);
+	auto p = reinterpret_cast<uint8_t*>(&out[base]);
+
+	//Block type, block length, interface ID, timestamp, packet length twice (original + captured, always equal for us)
+	uint32_t fields[7] =
+	{
+		6,
+		blocklen,
+		0,
+		static_cast<uint32_t>(ns >> 32),
+		static_cast<uint32_t>(ns & 0xffffffff),
+		static_cast<uint32_t>(len),
+		static_cast<uint32_t>(len)
+	};
+	memcpy(p, fields, sizeof(fields));
+	memcpy(p + sizeof(fields), packet, len);
 
 	//Repeat block length
-	if(!fwrite(&blocklen, sizeof(blocklen), 1, m_fp))
-		LogError("file write failure\n");
+	memcpy(p + blocklen - sizeof(blocklen), &blocklen, sizeof(blocklen));
 }
@@ -78,8 +78,24 @@ public:
 protected:
 	virtual void Export() override;
 
-	void ExportEthernet(EthernetWaveform* wfm);
-	void ExportPacket(std::vector<uint8_t>& packet, time_t timestamp, int64_t fs);
+	bool OpenFile();
+	bool IsRotationDue();
+	static void WriteHeaders(std::string& out);
+
+	void ExportEthernet(EthernetWaveform* wfm, std::string& out);
+	static void ExportPacket(std::string& out, const uint8_t* packet, size_t len, time_t timestamp, int64_t fs);
+
+	std::string m_rotateSize;
+	std::string m_rotateInterval;
+
+	///@brief Number of bytes queued for the current file since we opened it
+	size_t m_fileBytes;
+
+	///@brief Time the current file was opened (from GetTime())
+	double m_fileOpenTime;
+
+	///@brief Index of the current file when rotating
+	size_t m_rotateIndex;
 };
 
 #endif
@@ -104,45 +104,45 @@ void PcapngImportFilter::OnFileNameChanged()
 	//Open the input file
 	LogTrace("Loading PcapNG file %s\n", fname.c_str());
 	LogIndenter li;
-	FILE* fp = fopen(fname.c_str(), "r");
-	if(!fp)
+	MappedFile file;
+	if(!file.Open(fname))
 	{
 		LogError("Couldn't open PcapNG file \"%s\"\n", fname.c_str());
 		return;
 	}
 
 	//Section Header Block
-	if(!ValidateSHB(fp))
+	if(!ValidateSHB(file))
 		return;
 
 	//Read trailing block length (and discard for now)
 	//TODO: verify it's correct
 	uint32_t blocklen;
-	if(1 != fread(&blocklen, sizeof(blocklen), 1, fp))
+	if(1 != file.Read(&blocklen, sizeof(blocklen), 1))
 		return;
 
 	//Read and process packet blocks
 	bool gotEPB = false;
-	long blockstart;
-	while(!feof(fp))
+	size_t blockstart = 0;
+	while(file.Tell() < file.GetSize())
 	{
-		blockstart = ftell(fp);
+		blockstart = file.Tell();
 
 		uint32_t blocktype;
-		if(1 != fread(&blocktype, sizeof(blocktype), 1, fp))
+		if(1 != file.Read(&blocktype, sizeof(blocktype), 1))
 			return;
-		if(1 != fread(&blocklen, sizeof(blocklen), 1, fp))
+		if(1 != file.Read(&blocklen, sizeof(blocklen), 1))
 			return;
 		LogTrace("blocktype %d blocklen %d\n", blocktype, blocklen);
 
 		//Interface Definition Block
 		if(blocktype == 1)
 		{
-			if(!ReadIDB(fp))
+			if(!ReadIDB(file))
 				return;
 
 			//read and discard trailing block size
-			if(1 != fread(&blocklen, sizeof(blocklen), 1, fp))
+			if(1 != file.Read(&blocklen, sizeof(blocklen), 1))
 				return;
 		}
 
@@ -166,31 +166,200 @@ void PcapngImportFilter::OnFileNameChanged()
 		return;
 	}
 
-	//Move back to the start of the EPB
+	//Find all of the packets, using the saved index from a previous load if it's still valid
 	LogTrace("Ready to start reading frame data\n");
-	fseek(fp, blockstart, SEEK_SET);
+	vector<PcapngBlockIndexEntry> index;
+	if(!LoadBlockIndex(fname, file, blockstart, index))
+	{
+		BuildBlockIndex(file, blockstart, index);
+		SaveBlockIndex(fname, file, blockstart, index);
+	}
+	LogTrace("%zu packets\n", index.size());
+	if(index.empty())
+		return;
+	m_packets.reserve(index.size());
 
 	switch(m_linkType)
 	{
 		case LINK_TYPE_SOCKETCAN:
-			LoadSocketCAN(fp);
+			LoadSocketCAN(file, index);
 			break;
 
 		case LINK_TYPE_LINUX_COOKED:
 			//Linux cooked encapsulation is special: we don't know the output data format initially
 			//and there can be a mix of several which we don't currently implement!
-			LoadLinuxCooked(fp);
+			LoadLinuxCooked(file, index);
 			break;
 
 		default:
 			break;
 	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Block index
+
+/**
+	@brief Walks every block after the interface definitions and records where each Enhanced Packet Block is
+
+	@param file			The capture
+	@param firstBlock	Offset of the first EPB
+	@param index		Output index
+ */
+void PcapngImportFilter::BuildBlockIndex(MappedFile& file, size_t firstBlock, vector<PcapngBlockIndexEntry>& index)
+{
+	index.clear();
+
+	size_t pos = firstBlock;
+	size_t len = file.GetSize();
+	while(pos + 8 <= len)
+	{
+		auto phdr = file.GetPointer(pos, 8);
+		uint32_t blocktype;
+		uint32_t blocklen;
+		memcpy(&blocktype, phdr, sizeof(blocktype));
+		memcpy(&blocklen, phdr + 4, sizeof(blocklen));
+
+		//Blocks are at least a header and trailing length, and always 32-bit aligned
+		if( (blocklen < 12) || (blocklen & 3) )
+		{
+			LogWarning("Invalid block length %u at offset %zu, ignoring rest of file\n", blocklen, pos);
+			break;
+		}
+
+		//EPB: interface ID and timestamp follow the header
+		if(blocktype == 6)
+		{
+			auto pepb = file.GetPointer(pos + 8, 12);
+			if(!pepb)
+				break;
+
+			uint32_t tstamp[2];
+			PcapngBlockIndexEntry entry;
+			entry.m_offset = pos;
+			memcpy(&entry.m_interface, pepb, sizeof(entry.m_interface));
+			memcpy(tstamp, pepb + 4, sizeof(tstamp));
+			entry.m_timestamp = (static_cast<int64_t>(tstamp[0]) << 32) | tstamp[1];
+			entry.m_reserved = 0;
+			index.push_back(entry);
+		}
+
+		pos += blocklen;
+	}
+}
+
+/**
+	@brief Gets the path of the saved block index for a capture
+ */
+string PcapngImportFilter::GetBlockIndexPath(const string& fname)
+{
+	return fname + ".scopehal-index";
+}
+
+/**
+	@brief Loads a block index saved by a previous load of the same file
+
+	The index is only used if it was made from a file of the same size and modification time.
+
+	@return True if a valid index was loaded
+ */
+bool PcapngImportFilter::LoadBlockIndex(
+	const string& fname,
+	MappedFile& file,
+	size_t firstBlock,
+	vector<PcapngBlockIndexEntry>& index)
+{
+	MappedFile ifile;
+	if(!ifile.Open(GetBlockIndexPath(fname)))
+		return false;
+
+	PcapngBlockIndexHeader header;
+	if(1 != ifile.Read(&header, sizeof(header), 1))
+		return false;
+
+	time_t timestamp = 0;
+	int64_t fs = 0;
+	GetTimestampOfFile(fname, timestamp, fs);
+
+	if( (memcmp(header.m_magic, PCAPNG_INDEX_MAGIC, sizeof(header.m_magic)) != 0) ||
+		(header.m_version != PCAPNG_INDEX_VERSION) ||
+		(header.m_fileSize != file.GetSize()) ||
+		(header.m_fileTimestamp != static_cast<int64_t>(timestamp)) ||
+		(header.m_fileTimestampFs != fs) ||
+		(header.m_firstBlock != firstBlock) )
+	{
+		LogTrace("Saved block index is stale, rebuilding\n");
+		return false;
+	}
+
+	if(header.m_count > (ifile.GetSize() - sizeof(header)) / sizeof(PcapngBlockIndexEntry))
+		return false;
+
+	index.resize(header.m_count);
+	if(header.m_count != ifile.Read(index.data(), sizeof(PcapngBlockIndexEntry), header.m_count))
+	{
+		index.clear();
+		return false;
+	}
 
+	LogTrace("Loaded saved block index\n");
+	return true;
+}
+
+/**
+	@brief Saves the block index next to the capture so the next load can skip the walk
+
+	Failure (e.g. read-only directory) is not an error, the index will just be rebuilt next time.
+ */
+void PcapngImportFilter::SaveBlockIndex(
+	const string& fname,
+	MappedFile& file,
+	size_t firstBlock,
+	const vector<PcapngBlockIndexEntry>& index)
+{
+	time_t timestamp = 0;
+	int64_t fs = 0;
+	GetTimestampOfFile(fname, timestamp, fs);
+
+	PcapngBlockIndexHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.m_magic, PCAPNG_INDEX_MAGIC, sizeof(header.m_magic));
+	header.m_version = PCAPNG_INDEX_VERSION;
+	header.m_fileSize = file.GetSize();
+	header.m_fileTimestamp = timestamp;
+	header.m_fileTimestampFs = fs;
+	header.m_firstBlock = firstBlock;
+	header.m_count = index.size();
+
+	//Write to a temporary file then rename, so a concurrent load never sees a partial index
+	auto path = GetBlockIndexPath(fname);
+	auto tmppath = path + ".tmp";
+	FILE* fp = fopen(tmppath.c_str(), "wb");
+	if(!fp)
+		return;
+	bool ok =
+		(1 == fwrite(&header, sizeof(header), 1, fp)) &&
+		(index.size() == fwrite(index.data(), sizeof(PcapngBlockIndexEntry), index.size(), fp));
 	fclose(fp);
+
+	if(!ok)
+	{
+		remove(tmppath.c_str());
+		return;
+	}
+
+#ifdef _WIN32
+	remove(path.c_str());
+#endif
+	if(0 != rename(tmppath.c_str(), path.c_str()))
+		remove(tmppath.c_str());
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Packet decoding
+
 //TODO: this shares a lot in common with LoadCANLinuxCooked, how can we share more?
-bool PcapngImportFilter::LoadSocketCAN(FILE* fp)
+bool PcapngImportFilter::LoadSocketCAN(MappedFile& file, const vector<PcapngBlockIndexEntry>& index)
 {
 	LogTrace("Loading SocketCAN packets\n");
 	LogIndenter li;
@@ -209,55 +378,19 @@ bool PcapngImportFilter::LoadSocketCAN(FILE* fp)
 	int64_t baud = m_parameters[m_datarate].GetIntVal();
 	int64_t ui = FS_PER_SECOND / baud;
 
-	uint32_t blocktype;
-	uint32_t blocklen;
 	int64_t tend = 0;
-	while(!feof(fp))
+	for(auto& entry : index)
 	{
-		auto blockstart = ftell(fp);
-
-		if(1 != fread(&blocktype, sizeof(blocktype), 1, fp))
-			return false;
-		if(1 != fread(&blocklen, sizeof(blocklen), 1, fp))
-			return false;
-
-		//Should be an EPB, ignore anything else
-		switch(blocktype)
-		{
-			case 5:
-				LogTrace("Found Block Statistics (%d bytes)\n", blocklen);
-				fseek(fp, blockstart + blocklen, SEEK_SET);
-				continue;
-
-			case 6:
-				//LogTrace("Found EPB (%d bytes)\n", blocklen);
-				break;
-
-			default:
-				//unknown type, wut?
-				LogWarning("unknown block type %d\n", blocktype);
-				fseek(fp, blockstart + blocklen, SEEK_SET);
-				continue;
-		}
 		LogIndenter li2;
 
 		////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		// PCAPNG EPB headers
 
-		//For now, ignore interface number since we don't support mixed captures or multiple output streams yet
-		uint32_t ifacenum;
-		if(1 != fread(&ifacenum, sizeof(ifacenum), 1, fp))
-			return false;
-		//LogTrace("Interface %u\n", ifacenum);
-
-		//Timestamp
-		uint32_t tstamp[2];
-		if(2 != fread(tstamp, sizeof(uint32_t), 2, fp))
+		//For now, ignore interface number since we don't support mixed captures or multiple output streams yet.
+		//Interface and timestamp were already read when building the index, so skip straight past them
+		if(!file.Seek(entry.m_offset + 20))
 			return false;
-
-		//Convert from packed format in native units to a single 64-bit integer
-		int64_t stamp = tstamp[0];
-		stamp = (stamp << 32) | tstamp[1];
+		int64_t stamp = entry.m_timestamp;
 
 		//If this is the FIRST packet in the capture, it's the base timestamp and we measure offsets from that
 		if(first)
@@ -281,18 +414,17 @@ bool PcapngImportFilter::LoadSocketCAN(FILE* fp)
 
 		//Actual as-captured packet length
 		uint32_t packlen;
-		if(1 != fread(&packlen, sizeof(packlen), 1, fp))
+		if(1 != file.Read(&packlen, sizeof(packlen), 1))
 			return false;
 		if(packlen < 16)
 		{
 			LogWarning("Invalid packet length %d (should be >= 16 to allow room for cooked headers)\n", packlen);
-			fseek(fp, blockstart + blocklen, SEEK_SET);
 			continue;
 		}
 
 		//Original packet length (might have been truncated, but ignore this)
 		uint32_t origlen;
-		if(1 != fread(&origlen, sizeof(origlen), 1, fp))
+		if(1 != file.Read(&origlen, sizeof(origlen), 1))
 			return false;
 
 		//Timestamps sometimes have some jitter due to USB dongles combining several into one transaction,
@@ -303,27 +435,26 @@ bool PcapngImportFilter::LoadSocketCAN(FILE* fp)
 
 		//Read CAN ID (32 bit on wire)
 		uint32_t id;
-		if(1 != fread(&id, sizeof(id), 1, fp))
+		if(1 != file.Read(&id, sizeof(id), 1))
 			return false;
 		id = ntohl(id);
 
 		//Read frame length
 		uint8_t nbytes;
-		if(1 != fread(&nbytes, sizeof(nbytes), 1, fp))
+		if(1 != file.Read(&nbytes, sizeof(nbytes), 1))
 			return false;
 		if(nbytes > 8)
 		{
 			LogWarning("Invalid DLC %d (should be <= 8)\n", nbytes);
-			fseek(fp, blockstart + blocklen, SEEK_SET);
 			continue;
 		}
 
 		//Skip 3 bytes of FD flags / reserved before the payload
-		fseek(fp, 3, SEEK_CUR);
+		file.Skip(3);
 
 		//Read payload
 		uint8_t data[8];
-		if(nbytes != fread(data, 1, nbytes, fp))
+		if(nbytes != file.Read(data, 1, nbytes))
 			return false;
 
 		//Extract header bits (packed in with ID)
@@ -395,14 +526,12 @@ bool PcapngImportFilter::LoadSocketCAN(FILE* fp)
 		pack->m_len = 128 * ui;
 		m_packets.push_back(pack);
 
-		//End of the EPB, skip any unread contents
-		fseek(fp, blockstart + blocklen, SEEK_SET);
 	}
 
 	return true;
 }
 
-bool PcapngImportFilter::LoadLinuxCooked(FILE* fp)
+bool PcapngImportFilter::LoadLinuxCooked(MappedFile& file, const vector<PcapngBlockIndexEntry>& index)
 {
 	LogTrace("Loading Linux cooked format packets\n");
 	LogIndenter li;
@@ -427,22 +556,18 @@ bool PcapngImportFilter::LoadLinuxCooked(FILE* fp)
 	//So we need to skip ahead 30 bytes and sneak a peek at the AHPHRD_type field to know
 	//what kind of waveform we're dealing with.
 	//TODO: support multiple interfaces and multiple encapsulations in a single packet stream
-	auto orig = ftell(fp);
-	fseek(fp, 30, SEEK_CUR);
-
-	uint16_t arphrd;
-	if(1 != fread(&arphrd, sizeof(arphrd), 1, fp))
+	auto parphrd = file.GetPointer(index[0].m_offset + 30, sizeof(uint16_t));
+	if(!parphrd)
 		return false;
+	uint16_t arphrd;
+	memcpy(&arphrd, parphrd, sizeof(arphrd));
 	arphrd = ntohs(arphrd);
 
-	//Ok, back to where we started
-	fseek(fp, orig, SEEK_SET);
-
 	//So what is it?
 	switch(arphrd)
 	{
 		case 280:
-			return LoadCANLinuxCooked(fp);
+			return LoadCANLinuxCooked(file, index);
 
 		default:
 			LogError("Unknown inner format %d in Linux cooked encapsulation\n", arphrd);
@@ -452,7 +577,7 @@ bool PcapngImportFilter::LoadLinuxCooked(FILE* fp)
 	return true;
 }
 
-bool PcapngImportFilter::LoadCANLinuxCooked(FILE* fp)
+bool PcapngImportFilter::LoadCANLinuxCooked(MappedFile& file, const vector<PcapngBlockIndexEntry>& index)
 {
 	LogTrace("Loading CAN frames with Linux cooked encapsulation\n");
 	LogIndenter li;
@@ -471,55 +596,19 @@ bool PcapngImportFilter::LoadCANLinuxCooked(FILE* fp)
 	int64_t baud = m_parameters[m_datarate].GetIntVal();
 	int64_t ui = FS_PER_SECOND / baud;
 
-	uint32_t blocktype;
-	uint32_t blocklen;
 	int64_t tend = 0;
-	while(!feof(fp))
+	for(auto& entry : index)
 	{
-		auto blockstart = ftell(fp);
-
-		if(1 != fread(&blocktype, sizeof(blocktype), 1, fp))
-			return false;
-		if(1 != fread(&blocklen, sizeof(blocklen), 1, fp))
-			return false;
-
-		//Should be an EPB, ignore anything else
-		switch(blocktype)
-		{
-			case 5:
-				LogTrace("Found Block Statistics (%d bytes)\n", blocklen);
-				fseek(fp, blockstart + blocklen, SEEK_SET);
-				continue;
-
-			case 6:
-				//LogTrace("Found EPB (%d bytes)\n", blocklen);
-				break;
-
-			default:
-				//unknown type, wut?
-				LogWarning("unknown block type %d\n", blocktype);
-				fseek(fp, blockstart + blocklen, SEEK_SET);
-				continue;
-		}
 		LogIndenter li2;
 
 		////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		// PCAPNG EPB headers
 
-		//For now, ignore interface number since we don't support mixed captures or multiple output streams yet
-		uint32_t ifacenum;
-		if(1 != fread(&ifacenum, sizeof(ifacenum), 1, fp))
-			return false;
-		//LogTrace("Interface %u\n", ifacenum);
-
-		//Timestamp
-		uint32_t tstamp[2];
-		if(2 != fread(tstamp, sizeof(uint32_t), 2, fp))
+		//For now, ignore interface number since we don't support mixed captures or multiple output streams yet.
+		//Interface and timestamp were already read when building the index, so skip straight past them
+		if(!file.Seek(entry.m_offset + 20))
 			return false;
-
-		//Convert from packed format in native units to a single 64-bit integer
-		int64_t stamp = tstamp[0];
-		stamp = (stamp << 32) | tstamp[1];
+		int64_t stamp = entry.m_timestamp;
 
 		//If this is the FIRST packet in the capture, it's the base timestamp and we measure offsets from that
 		if(first)
@@ -543,18 +632,17 @@ bool PcapngImportFilter::LoadCANLinuxCooked(FILE* fp)
 
 		//Actual as-captured packet length
 		uint32_t packlen;
-		if(1 != fread(&packlen, sizeof(packlen), 1, fp))
+		if(1 != file.Read(&packlen, sizeof(packlen), 1))
 			return false;
 		if(packlen < 16)
 		{
 			LogWarning("Invalid packet length %d (should be >= 16 to allow room for cooked headers)\n", packlen);
-			fseek(fp, blockstart + blocklen, SEEK_SET);
 			continue;
 		}
 
 		//Original packet length (might have been truncated, but ignore this)
 		uint32_t origlen;
-		if(1 != fread(&origlen, sizeof(origlen), 1, fp))
+		if(1 != file.Read(&origlen, sizeof(origlen), 1))
 			return false;
 
 		////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -562,48 +650,45 @@ bool PcapngImportFilter::LoadCANLinuxCooked(FILE* fp)
 
 		//Packet type (typically always be 0x01 broadcast, or 0x04 sent by us, for CAN)
 		uint16_t packtype;
-		if(1 != fread(&packtype, sizeof(packtype), 1, fp))
+		if(1 != file.Read(&packtype, sizeof(packtype), 1))
 			return false;
 
 		//ARPHRD type (should always be 280, CAN, if we get to this point)
 		uint16_t arphrd;
-		if(1 != fread(&arphrd, sizeof(arphrd), 1, fp))
+		if(1 != file.Read(&arphrd, sizeof(arphrd), 1))
 			return false;
 		arphrd = ntohs(arphrd);
 		if(arphrd != 280)
 		{
 			LogWarning("Unknown ARPHRD type %d in what we expected to be a CAN capture inside Linux cooked headers\n",
 				arphrd);
-			fseek(fp, blockstart + blocklen, SEEK_SET);
 			continue;
 		}
 
 		//Link layer address length (should always be 0 for CAN bus)
 		uint16_t linklen;
-		if(1 != fread(&linklen, sizeof(linklen), 1, fp))
+		if(1 != file.Read(&linklen, sizeof(linklen), 1))
 			return false;
 		linklen = ntohs(linklen);
 		if(linklen != 0)
 		{
 			LogWarning("Invalid link layer address length %d (should be 0 for CAN)\n", linklen);
-			fseek(fp, blockstart + blocklen, SEEK_SET);
 			continue;
 		}
 
 		//8 bytes of padding (where link layer address would be if we had one)
 		uint64_t padding;
-		if(1 != fread(&padding, sizeof(padding), 1, fp))
+		if(1 != file.Read(&padding, sizeof(padding), 1))
 			return false;
 
 		//Protocol type (should be 0x0C, CAN bus or 0x0d (CAN-FD))
 		uint16_t proto;
-		if(1 != fread(&proto, sizeof(proto), 1, fp))
+		if(1 != file.Read(&proto, sizeof(proto), 1))
 			return false;
 		proto = ntohs(proto);
 		if( (proto != 0x0c) && (proto != 0x0d) )
 		{
 			LogWarning("Invalid protocol type 0x%02x (should be 0x0c for CAN or 0x0d for CAN-FD)\n", proto);
-			fseek(fp, blockstart + blocklen, SEEK_SET);
 			continue;
 		}
 
@@ -618,23 +703,22 @@ bool PcapngImportFilter::LoadCANLinuxCooked(FILE* fp)
 
 		//Read CAN ID (32 bit on wire)
 		uint32_t id;
-		if(1 != fread(&id, sizeof(id), 1, fp))
+		if(1 != file.Read(&id, sizeof(id), 1))
 			return false;
 
 		//Read frame length
 		uint32_t nbytes;
-		if(1 != fread(&nbytes, sizeof(nbytes), 1, fp))
+		if(1 != file.Read(&nbytes, sizeof(nbytes), 1))
 			return false;
 		if(nbytes > 8)
 		{
 			LogWarning("Invalid DLC %d (should be <= 8)\n", nbytes);
-			fseek(fp, blockstart + blocklen, SEEK_SET);
 			continue;
 		}
 
 		//Read payload
 		uint8_t data[8];
-		if(nbytes != fread(data, 1, nbytes, fp))
+		if(nbytes != file.Read(data, 1, nbytes))
 			return false;
 
 		//Extract header bits (packed in with ID)
@@ -701,8 +785,6 @@ bool PcapngImportFilter::LoadCANLinuxCooked(FILE* fp)
 		pack->m_len = 128 * ui;
 		m_packets.push_back(pack);
 
-		//End of the EPB, skip any unread contents
-		fseek(fp, blockstart + blocklen, SEEK_SET);
 	}
 
 	return true;
@@ -711,14 +793,14 @@ bool PcapngImportFilter::LoadCANLinuxCooked(FILE* fp)
 /**
 	@brief Read Interface Definition Block
  */
-bool PcapngImportFilter::ReadIDB(FILE* fp)
+bool PcapngImportFilter::ReadIDB(MappedFile& file)
 {
 	LogTrace("Reading interface definition block\n");
 	LogIndenter li;
 
 	//Read link type
 	uint16_t linktype;
-	if(1 != fread(&linktype, sizeof(linktype), 1, fp))
+	if(1 != file.Read(&linktype, sizeof(linktype), 1))
 		return false;
 
 	switch(linktype)
@@ -756,17 +838,16 @@ bool PcapngImportFilter::ReadIDB(FILE* fp)
 
 	//Read and discard two reserved bytes
 	uint16_t reserved;
-	if(1 != fread(&reserved, sizeof(reserved), 1, fp))
+	if(1 != file.Read(&reserved, sizeof(reserved), 1))
 		return false;
 
 	//Read snap length (for now, ignore it)
 	uint32_t snaplen;
-	if(1 != fread(&snaplen, sizeof(snaplen), 1, fp))
+	if(1 != file.Read(&snaplen, sizeof(snaplen), 1))
 		return false;
 	LogTrace("Snap length is %d bytes\n", snaplen);
 
 	//Read IDB options
-	uint8_t tmp;
 	bool done = false;
 	string str;
 	uint16_t t16;
@@ -774,12 +855,12 @@ bool PcapngImportFilter::ReadIDB(FILE* fp)
 	{
 		//Read the option
 		uint16_t optid;
-		if(1 != fread(&optid, sizeof(optid), 1, fp))
+		if(1 != file.Read(&optid, sizeof(optid), 1))
 			return false;
 
 		//Read option length
 		uint16_t optlen;
-		if(1 != fread(&optlen, sizeof(optlen), 1, fp))
+		if(1 != file.Read(&optlen, sizeof(optlen), 1))
 			return false;
 
 		switch(optid)
@@ -791,19 +872,19 @@ bool PcapngImportFilter::ReadIDB(FILE* fp)
 
 			//if_name
 			case 2:
-				str = ReadFixedLengthString(optlen, fp);
+				str = ReadFixedLengthString(optlen, file);
 				LogTrace("if_name = %s\n", str.c_str());
 				break;
 
 			//if_description
 			case 3:
-				str = ReadFixedLengthString(optlen, fp);
+				str = ReadFixedLengthString(optlen, file);
 				LogTrace("if_description = %s\n", str.c_str());
 				break;
 
 			//if_tresol
 			case 9:
-				if(1 != fread(&t16, sizeof(t16), 1, fp))
+				if(1 != file.Read(&t16, sizeof(t16), 1))
 					return false;
 
 				//Nanosecond resolution
@@ -815,26 +896,24 @@ bool PcapngImportFilter::ReadIDB(FILE* fp)
 
 			//if_filter
 			case 11:
-				str = ReadFixedLengthString(optlen, fp);
+				str = ReadFixedLengthString(optlen, file);
 				LogTrace("if_filter = %s\n", str.c_str());
 				break;
 
 			//if_os
 			case 12:
-				str = ReadFixedLengthString(optlen, fp);
+				str = ReadFixedLengthString(optlen, file);
 				LogTrace("if_os = %s\n", str.c_str());
 				break;
 
 			//unknown, discard it
 			default:
 				LogWarning("Unknown IDB option %d\n", optid);
-				for(size_t i=0; i<optlen; i++)
-					fread(&tmp, 1, 1, fp);
+				file.Skip(optlen);
 		}
 
 		//Read and discard padding until 32-bit aligned
-		while(ftell(fp) & 3)
-			fread(&tmp, 1, 1, fp);
+		file.Skip( (4 - (file.Tell() & 3)) & 3 );
 	}
 
 	return true;
@@ -843,14 +922,14 @@ bool PcapngImportFilter::ReadIDB(FILE* fp)
 /**
 	@brief Read Section Header Block
  */
-bool PcapngImportFilter::ValidateSHB(FILE* fp)
+bool PcapngImportFilter::ValidateSHB(MappedFile& file)
 {
 	LogTrace("Loading SHB\n");
 	LogIndenter li;
 
 	//Magic number
 	uint32_t blocktype;
-	if(1 != fread(&blocktype, sizeof(blocktype), 1, fp))
+	if(1 != file.Read(&blocktype, sizeof(blocktype), 1))
 		return false;
 	if(blocktype != 0x0a0d0d0a)
 	{
@@ -860,13 +939,13 @@ bool PcapngImportFilter::ValidateSHB(FILE* fp)
 
 	//Block length
 	uint32_t blocklen;
-	if(1 != fread(&blocklen, sizeof(blocklen), 1, fp))
+	if(1 != file.Read(&blocklen, sizeof(blocklen), 1))
 		return false;
 	LogTrace("SHB is %d bytes long\n", blocklen);
 
 	//Byte order (for now, only implement little endian)
 	uint32_t bom;
-	if(1 != fread(&bom, sizeof(bom), 1, fp))
+	if(1 != file.Read(&bom, sizeof(bom), 1))
 		return false;
 	if(bom != 0x1a2b3c4d)
 	{
@@ -876,29 +955,28 @@ bool PcapngImportFilter::ValidateSHB(FILE* fp)
 
 	//Major and minor version numbers
 	uint16_t versions[2];
-	if(2 != fread(versions, sizeof(uint16_t), 2, fp))
+	if(2 != file.Read(versions, sizeof(uint16_t), 2))
 		return false;
 	LogTrace("PcapNG file format %d.%d\n", versions[0], versions[1]);
 
 	//Read and discard section length (can't have any content)
 	uint64_t ignoredLen;
-	if(1 != fread(&ignoredLen, sizeof(ignoredLen), 1, fp))
+	if(1 != file.Read(&ignoredLen, sizeof(ignoredLen), 1))
 		return false;
 
 	//Read options
-	uint8_t tmp;
 	bool done = false;
 	string str;
 	while(!done)
 	{
 		//Read the option
 		uint16_t optid;
-		if(1 != fread(&optid, sizeof(optid), 1, fp))
+		if(1 != file.Read(&optid, sizeof(optid), 1))
 			return false;
 
 		//Read option length
 		uint16_t optlen;
-		if(1 != fread(&optlen, sizeof(optlen), 1, fp))
+		if(1 != file.Read(&optlen, sizeof(optlen), 1))
 			return false;
 
 		switch(optid)
@@ -910,47 +988,39 @@ bool PcapngImportFilter::ValidateSHB(FILE* fp)
 
 			//shb_hardware
 			case 2:
-				str = ReadFixedLengthString(optlen, fp);
+				str = ReadFixedLengthString(optlen, file);
 				LogTrace("shb_hardware = %s\n", str.c_str());
 				break;
 
 			//shb_os
 			case 3:
-				str = ReadFixedLengthString(optlen, fp);
+				str = ReadFixedLengthString(optlen, file);
 				LogTrace("shb_os = %s\n", str.c_str());
 				break;
 
 			//shb_userappl
 			case 4:
-				str = ReadFixedLengthString(optlen, fp);
+				str = ReadFixedLengthString(optlen, file);
 				LogTrace("shb_userappl = %s\n", str.c_str());
 				break;
 
 			//unknown, discard it
 			default:
 				LogWarning("Unknown SHB option %d\n", optid);
-				for(size_t i=0; i<optlen; i++)
-					fread(&tmp, 1, 1, fp);
+				file.Skip(optlen);
 		}
 
 		//Read and discard padding until 32-bit aligned
-		while(ftell(fp) & 3)
-			fread(&tmp, 1, 1, fp);
+		file.Skip( (4 - (file.Tell() & 3)) & 3 );
 	}
 
 	return true;
 }
 
-string PcapngImportFilter::ReadFixedLengthString(uint16_t len, FILE* fp)
+string PcapngImportFilter::ReadFixedLengthString(uint16_t len, MappedFile& file)
 {
-	//TODO: make this more efficient
-	string ret;
-	char tmp;
-	for(size_t i=0; i<len; i++)
-	{
-		fread(&tmp, 1, 1, fp);
-		ret += tmp;
-	}
+	string ret(len, '\0');
+	ret.resize(file.Read(&ret[0], 1, len));
 	return ret;
 }
 
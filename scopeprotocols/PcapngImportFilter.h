@@ -55,13 +55,63 @@ protected:
 
 	void OnFileNameChanged();
 
-	bool ValidateSHB(FILE* fp);
-	bool ReadIDB(FILE* fp);
-	std::string ReadFixedLengthString(uint16_t len, FILE* fp);
+	/**
+		@brief Location of one Enhanced Packet Block within the capture
 
-	bool LoadLinuxCooked(FILE* fp);
-	bool LoadCANLinuxCooked(FILE* fp);
-	bool LoadSocketCAN(FILE* fp);
+		Saved to disk verbatim as part of the block index, so layout must not change without bumping
+		PCAPNG_INDEX_VERSION.
+	 */
+	struct PcapngBlockIndexEntry
+	{
+		///@brief Offset of the start of the block from the start of the file
+		uint64_t m_offset;
+
+		///@brief Timestamp of the packet, in native units of the interface
+		int64_t m_timestamp;
+
+		///@brief Interface ID the packet was captured on
+		uint32_t m_interface;
+
+		///@brief Padding, always zero
+		uint32_t m_reserved;
+	};
+
+	///@brief Header of a saved block index file
+	struct PcapngBlockIndexHeader
+	{
+		char m_magic[8];
+		uint32_t m_version;
+		uint32_t m_reserved;
+		uint64_t m_fileSize;
+		int64_t m_fileTimestamp;
+		int64_t m_fileTimestampFs;
+		uint64_t m_firstBlock;
+		uint64_t m_count;
+	};
+
+	static constexpr const char* PCAPNG_INDEX_MAGIC = "PCAPNGIX";
+	static constexpr uint32_t PCAPNG_INDEX_VERSION = 1;
+
+	bool ValidateSHB(MappedFile& file);
+	bool ReadIDB(MappedFile& file);
+	std::string ReadFixedLengthString(uint16_t len, MappedFile& file);
+
+	static std::string GetBlockIndexPath(const std::string& fname);
+	void BuildBlockIndex(MappedFile& file, size_t firstBlock, std::vector<PcapngBlockIndexEntry>& index);
+	bool LoadBlockIndex(
+		const std::string& fname,
+		MappedFile& file,
+		size_t firstBlock,
+		std::vector<PcapngBlockIndexEntry>& index);
+	void SaveBlockIndex(
+		const std::string& fname,
+		MappedFile& file,
+		size_t firstBlock,
+		const std::vector<PcapngBlockIndexEntry>& index);
+
+	bool LoadLinuxCooked(MappedFile& file, const std::vector<PcapngBlockIndexEntry>& index);
+	bool LoadCANLinuxCooked(MappedFile& file, const std::vector<PcapngBlockIndexEntry>& index);
+	bool LoadSocketCAN(MappedFile& file, const std::vector<PcapngBlockIndexEntry>& index);
 
 	enum LinkType
 	{
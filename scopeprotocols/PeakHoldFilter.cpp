@@ -37,6 +37,7 @@ using namespace std;
 
 PeakHoldFilter::PeakHoldFilter(const string& color)
 	: PeakDetectionFilter(color, CAT_MATH)
+	, m_accumulator(WaveformAccumulator::ACCUM_MAX)
 {
 	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_ANALOG);
 	CreateInput("din");
@@ -66,6 +67,12 @@ string PeakHoldFilter::GetProtocolName()
 	return "Peak Hold";
 }
 
+Filter::DataLocation PeakHoldFilter::GetInputLocation()
+{
+	//We explicitly manage our input memory and don't care where it is when Refresh() is called
+	return LOC_DONTCARE;
+}
+
 void PeakHoldFilter::ClearSweeps()
 {
 	SetData(NULL, 0);
@@ -122,19 +129,8 @@ void PeakHoldFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHa
 		//Copy timestamps from the input
 		cap->CopyTimestamps(sdin);
 
-		//First waveform just copies the input
-		if(first)
-		{
-			for(size_t i=0; i<len; i++)
-				cap->m_samples[i] = sdin->m_samples[i];
-		}
-
-		//otherwise actually do peak holding
-		else
-		{
-			for(size_t i=0; i<len; i++)
-				cap->m_samples[i] = max((float)cap->m_samples[i], (float)sdin->m_samples[i]);
-		}
+		//First waveform just copies the input, otherwise actually do peak holding
+		m_accumulator.Accumulate(cmdBuf, queue, sdin->m_samples, len, first ? 0 : len, cap->m_samples);
 
 		FindPeaks(cap, cmdBuf, queue);
 	}
@@ -161,19 +157,8 @@ void PeakHoldFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHa
 		cap->m_startTimestamp = din->m_startTimestamp;
 		cap->m_startFemtoseconds = din->m_startFemtoseconds;
 
-		//First waveform just copies the input
-		if(first)
-		{
-			for(size_t i=0; i<len; i++)
-				cap->m_samples[i] = udin->m_samples[i];
-		}
-
-		//otherwise actually do peak holding
-		else
-		{
-			for(size_t i=0; i<len; i++)
-				cap->m_samples[i] = max((float)cap->m_samples[i], (float)udin->m_samples[i]);
-		}
+		//First waveform just copies the input, otherwise actually do peak holding
+		m_accumulator.Accumulate(cmdBuf, queue, udin->m_samples, len, first ? 0 : len, cap->m_samples);
 
 		FindPeaks(cap, cmdBuf, queue);
 	}
@@ -35,12 +35,15 @@
 #ifndef PeakHoldFilter_h
 #define PeakHoldFilter_h
 
+#include "../scopehal/WaveformAccumulator.h"
+
 class PeakHoldFilter : public PeakDetectionFilter
 {
 public:
 	PeakHoldFilter(const std::string& color);
 
 	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
+	virtual DataLocation GetInputLocation() override;
 
 	static std::string GetProtocolName();
 
@@ -51,6 +54,7 @@ public:
 	PROTOCOL_DECODER_INITPROC(PeakHoldFilter)
 
 protected:
+	WaveformAccumulator m_accumulator;
 };
 
 #endif
@@ -46,7 +46,15 @@ public:
 
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
+	virtual bool SupportsScalarBatch(size_t stream) override;
+
 	PROTOCOL_DECODER_INITPROC(PeriodMeasurement)
+
+protected:
+	virtual bool EvaluateScalarSegment(WaveformBase* din, size_t stream, float& value) override;
+
+	static void FindEdges(WaveformBase* din, std::vector<int64_t>& edges);
+	static double GetAverage(const std::vector<int64_t>& edges);
 };
 
 #endif
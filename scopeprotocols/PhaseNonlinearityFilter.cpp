@@ -112,12 +112,16 @@ void PhaseNonlinearityFilter::Refresh()
 	cap->Resize(len);
 	cap->m_timescale = 1;
 
+	//Unwrap the phase into the output buffer first (assume +/- 180 deg range at input).
+	//Output sample i is the unwrapped phase after step i
+	auto pin = uang ? uang->m_samples.GetCpuPointer() : sang->m_samples.GetCpuPointer();
+	auto phases = cap->m_samples.GetCpuPointer();
+	UnwrapPhase(pin, len+1, phases, 1);
+
 	//Calculate the average group delay (ΔPhase / ΔFreq) between our reference frequencies
-	//We need to do a linear search here because we have to unwrap phases as we go.
 	//Note that the value calculated here is in units of degrees per Hz, not cycles per Hz (seconds).
 	//We don't need to convert to time units since we're about to integrate it wrt dFreq to compute the nominal phase.
 	float initialPhase = GetValue(sang, uang, 0);
-	float phase = initialPhase;
 	float phaseLow = 0;
 	float phaseHigh = 0;
 	int64_t freqLow = m_parameters[m_refLowName].GetIntVal();
@@ -125,19 +129,7 @@ void PhaseNonlinearityFilter::Refresh()
 	bool foundFreqLow = false;
 	for(size_t i=0; i<len; i++)
 	{
-		//Compute unwrapped phase
-		float phase_hi = GetValue(sang, uang, i+1);
-		float phase_lo = GetValue(sang, uang, i);
-		if(fabs(phase_lo - phase_hi) > 180)
-		{
-			if(phase_lo < phase_hi)
-				phase_lo += 360;
-			else
-				phase_hi += 360;
-		}
-		float dphase = phase_hi - phase_lo;
-		phase += dphase;
-
+		float phase = phases[i];
 		int64_t freq = GetOffsetScaled(sang, uang, i);
 
 		//Find first point above lower ref freq
@@ -160,31 +152,19 @@ void PhaseNonlinearityFilter::Refresh()
 
 	//Main output loop
 	int64_t initialFreq = GetOffsetScaled(sang, uang, 0);
-	phase = initialPhase;
-	for(size_t i=0; i<len; i++)
+	ParallelFor(0, len, 65536, [&](size_t first, size_t last)
 	{
-		//Subtract phase angles, wrapping correctly around singularities
-		//(assume +/- 180 deg range at input)
-		float phase_hi = GetValue(sang, uang, i+1);
-		float phase_lo = GetValue(sang, uang, i);
-		if(fabs(phase_lo - phase_hi) > 180)
+		for(size_t i=first; i<last; i++)
 		{
-			if(phase_lo < phase_hi)
-				phase_lo += 360;
-			else
-				phase_hi += 360;
-		}
-		float dphase = phase_hi - phase_lo;
-		phase += dphase;
-
-		//Calculate nominal phase for a linear network
-		int64_t freq = GetOffsetScaled(sang, uang, i);
-		float nominalPhase = groupDelay * (freq - initialFreq) + initialPhase;
+			//Calculate nominal phase for a linear network
+			int64_t freq = GetOffsetScaled(sang, uang, i);
+			float nominalPhase = groupDelay * (freq - initialFreq) + initialPhase;
 
-		cap->m_offsets[i] = freq;
-		cap->m_durations[i] = GetDurationScaled(sang, uang, i);
-		cap->m_samples[i] = phase - nominalPhase;
-	}
+			cap->m_offsets[i] = freq;
+			cap->m_durations[i] = GetDurationScaled(sang, uang, i);
+			phases[i] -= nominalPhase;
+		}
+	});
 
 	cap->MarkModifiedFromCpu();
 }
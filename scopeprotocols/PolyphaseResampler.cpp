@@ -0,0 +1,237 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of PolyphaseResampler
+ */
+#ifdef _WIN32
+#include <cmath>
+#endif
+
+#include "../scopehal/scopehal.h"
+#include "PolyphaseResampler.h"
+
+using namespace std;
+
+float sinc(float x, float width);
+float blackman(float x, float width);
+
+float sinc(float x, float width)
+{
+	float xi = x - width/2;
+
+	if(fabs(xi) < 1e-7)
+		return 1.0f;
+	else
+	{
+		float px = M_PI*xi;
+		return sin(px) / px;
+	}
+}
+
+float blackman(float x, float width)
+{
+	if(x > width)
+		return 0;
+	return 0.42 - 0.5*cos(2*M_PI * x / width) + 0.08 * cos(4*M_PI*x/width);
+}
+
+PolyphaseResampler::PolyphaseResampler()
+	: m_upsample(1)
+	, m_downsample(1)
+	, m_taps(0)
+	, m_inputOffset(0)
+	, m_window(0)
+	, m_computePipeline("shaders/PolyphaseResampler.spv", 3, sizeof(PolyphaseResamplerArgs))
+{
+	//Use pinned memory for filter kernel
+	m_table.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_table.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+}
+
+/**
+	@brief Sets up a Blackman windowed sinc interpolator, unless it's already set up with the same parameters
+
+	When decimating by more than we upsample, the cutoff is lowered to the output Nyquist limit and the window
+	stretched to match, so the result doesn't alias.
+
+	@param upsample		Upsampling factor P
+	@param downsample	Decimation factor Q
+	@param window		Kernel width, in input samples, at unity net ratio
+ */
+void PolyphaseResampler::SetWindowedSinc(size_t upsample, size_t downsample, size_t window)
+{
+	if( (m_window == window) && (m_upsample == upsample) && (m_downsample == downsample) )
+		return;
+	size_t requestedWindow = window;
+
+	float scale = 1;
+	if(downsample > upsample)
+	{
+		scale = upsample * 1.0f / downsample;
+		window = window * ( (downsample + upsample - 1) / upsample );
+	}
+
+	//Logically, we upsample by inserting zeroes, then convolve with the sinc filter
+	size_t kernel = window*upsample;
+	vector<float> filter(kernel);
+	for(size_t i=0; i<kernel; i++)
+	{
+		float frac = i*1.0f / upsample;
+		filter[i] = scale * sinc(frac*scale, window*scale) * blackman(frac, window);
+	}
+
+	//Optimization: don't actually waste time multiplying by zero.
+	//Phase j uses taps j' = m*upsample - j of the full kernel, against input samples i+m
+	size_t taps = window + 1;
+	vector<float> table(upsample * taps, 0.0f);
+	for(size_t j=0; j<upsample; j++)
+	{
+		for(size_t m=0; m<taps; m++)
+		{
+			ssize_t k = (ssize_t)(m*upsample) - (ssize_t)j;
+			if( (k >= 0) && (k < (ssize_t)kernel) )
+				table[j*taps + m] = filter[k];
+		}
+	}
+
+	SetKernel(upsample, downsample, table, 0);
+	m_window = requestedWindow;
+}
+
+/**
+	@brief Sets an arbitrary polyphase table
+
+	@param upsample		Upsampling factor P (number of rows in the table)
+	@param downsample	Decimation factor Q
+	@param table		Polyphase table, P rows of equal length
+	@param inputOffset	Offset from each output's input sample to the input sample under the first tap of its row
+ */
+void PolyphaseResampler::SetKernel(size_t upsample, size_t downsample, const vector<float>& table, int inputOffset)
+{
+	m_upsample = upsample;
+	m_downsample = downsample;
+	m_taps = table.size() / upsample;
+	m_inputOffset = inputOffset;
+	m_window = 0;
+
+	m_table.resize(table.size());
+	m_table.PrepareForCpuAccess();
+	if(!table.empty())
+		memcpy(m_table.GetCpuPointer(), &table[0], table.size() * sizeof(float));
+	m_table.MarkModifiedFromCpu();
+}
+
+/**
+	@brief Resamples a waveform
+
+	@param cmdBuf	Command buffer to record into (must not be in the recording state)
+	@param queue	Queue to submit on
+	@param din		Input waveform
+	@param dout		Output waveform, already resized to the number of output samples wanted
+	@param useGpu	False to run on the CPU even if GPU filters are enabled (e.g. if the owning filter's
+					Filter::IsGpuPreferred() said so)
+ */
+void PolyphaseResampler::Run(
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue,
+	UniformAnalogWaveform* din,
+	UniformAnalogWaveform* dout,
+	bool useGpu)
+{
+	size_t outlen = dout->size();
+	if( (outlen == 0) || (m_taps == 0) )
+		return;
+
+	if(!g_gpuFilterEnabled || !useGpu)
+	{
+		RunOnCpu(din, dout);
+		return;
+	}
+
+	cmdBuf.begin({});
+
+	m_computePipeline.BindBufferNonblocking(0, din->m_samples, cmdBuf);
+	m_computePipeline.BindBufferNonblocking(1, m_table, cmdBuf);
+	m_computePipeline.BindBufferNonblocking(2, dout->m_samples, cmdBuf, true);
+
+	PolyphaseResamplerArgs args;
+	args.outlen = outlen;
+	args.inlen = din->size();
+	args.upsample = m_upsample;
+	args.downsample = m_downsample;
+	args.taps = m_taps;
+	args.inputOffset = m_inputOffset;
+
+	const uint32_t compute_block_count = GetComputeBlockCount(outlen, 64);
+	m_computePipeline.Dispatch(cmdBuf, args,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
+
+	//Done, submit to the queue and wait
+	cmdBuf.end();
+	queue->SubmitAndBlock(cmdBuf);
+	dout->MarkModifiedFromGpu();
+}
+
+/**
+	@brief CPU implementation of Run()
+ */
+void PolyphaseResampler::RunOnCpu(UniformAnalogWaveform* din, UniformAnalogWaveform* dout)
+{
+	din->PrepareForCpuAccess();
+	dout->PrepareForCpuAccess();
+
+	size_t outlen = dout->size();
+	ssize_t inlen = din->size();
+	float* pin = din->m_samples.GetCpuPointer();
+	float* pout = dout->m_samples.GetCpuPointer();
+	float* ptable = m_table.GetCpuPointer();
+
+	#pragma omp parallel for
+	for(size_t n=0; n<outlen; n++)
+	{
+		//Position on the upsampled grid is n*m_downsample
+		size_t bq = (n % m_upsample) * m_downsample;
+		ssize_t base = (n / m_upsample) * m_downsample + bq / m_upsample + m_inputOffset;
+		float* row = ptable + (bq % m_upsample) * m_taps;
+
+		float f = 0;
+		for(size_t m=0; m<m_taps; m++)
+		{
+			ssize_t idx = base + m;
+			if( (idx >= 0) && (idx < inlen) )
+				f += row[m] * pin[idx];
+		}
+		pout[n] = f;
+	}
+
+	dout->MarkModifiedFromCpu();
+}
@@ -0,0 +1,111 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of PolyphaseResampler
+ */
+#ifndef PolyphaseResampler_h
+#define PolyphaseResampler_h
+
+/**
+	@brief Push constants for PolyphaseResampler.glsl
+ */
+struct PolyphaseResamplerArgs
+{
+	uint32_t outlen;
+	uint32_t inlen;
+	uint32_t upsample;
+	uint32_t downsample;
+	uint32_t taps;
+	int32_t inputOffset;
+};
+
+/**
+	@brief Rational P/Q resampler for uniform analog waveforms, shared by UpsampleFilter and DownsampleFilter
+
+	Logically the input is upsampled by P (inserting zeroes), convolved with a FIR filter, and decimated by Q. Only
+	the products which are actually needed are computed: output sample n sits at position n*Q on the upsampled grid,
+	which is input sample i = (n*Q) / P at phase j = (n*Q) % P, and is the dot product of row j of the polyphase
+	table with input samples i + inputOffset onwards. Input samples off either end of the waveform count as zero.
+
+	The table is only rebuilt (and uploaded) when the parameters change, not on every refresh.
+ */
+class PolyphaseResampler
+{
+public:
+	PolyphaseResampler();
+
+	void SetWindowedSinc(size_t upsample, size_t downsample, size_t window);
+	void SetKernel(size_t upsample, size_t downsample, const std::vector<float>& table, int inputOffset);
+
+	void Run(
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue,
+		UniformAnalogWaveform* din,
+		UniformAnalogWaveform* dout,
+		bool useGpu = true);
+
+	///@brief Returns the upsampling factor P
+	size_t GetUpsampleFactor() const
+	{ return m_upsample; }
+
+	///@brief Returns the decimation factor Q
+	size_t GetDownsampleFactor() const
+	{ return m_downsample; }
+
+	///@brief Returns the number of taps per phase
+	size_t GetTapCount() const
+	{ return m_taps; }
+
+protected:
+	void RunOnCpu(UniformAnalogWaveform* din, UniformAnalogWaveform* dout);
+
+	///@brief Polyphase table, m_upsample rows of m_taps coefficients
+	AcceleratorBuffer<float> m_table;
+
+	///@brief Upsampling factor P
+	size_t m_upsample;
+
+	///@brief Decimation factor Q
+	size_t m_downsample;
+
+	///@brief Number of taps per phase
+	size_t m_taps;
+
+	///@brief Offset from the input sample of each output to the first input sample under the kernel
+	int m_inputOffset;
+
+	///@brief Window size (in input samples) m_table was built for by SetWindowedSinc(), or zero if set directly
+	size_t m_window;
+
+	ComputePipeline m_computePipeline;
+};
+
+#endif
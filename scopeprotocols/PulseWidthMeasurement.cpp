@@ -127,8 +127,10 @@ void PulseWidthMeasurement::Refresh()
 	cap->m_timescale = 1;
 	cap->PrepareForCpuAccess();
 
-	//Create the output for amplitude waveform for analog inputs only
-	auto cap1 = (uadin || sadin) ? SetupEmptySparseAnalogOutputWaveform(din, 1, true) : NULL;
+	//Create the output for amplitude waveform for analog inputs only.
+	//Finding the peak of each pulse means scanning every input sample, so skip it if nobody is looking.
+	bool analog = (uadin || sadin);
+	auto cap1 = (analog && IsStreamDemanded(1)) ? SetupEmptySparseAnalogOutputWaveform(din, 1, true) : NULL;
 	if(cap1)
 	{
 		cap1->m_timescale = 1;
@@ -151,8 +153,14 @@ void PulseWidthMeasurement::Refresh()
 		cap->m_durations.push_back(delta);
 		cap->m_samples.push_back(delta);
 
+		if(analog)
+		{
+			nedges ++;
+			sum += delta;
+		}
+
 		// Find amplitude information for the pulses
-		if(uadin)
+		if(cap1 && uadin)
 		{
 			int64_t start_index = (start - din->m_triggerPhase) / din->m_timescale;
 			int64_t end_index = (end - din->m_triggerPhase) / din->m_timescale;
@@ -169,11 +177,8 @@ void PulseWidthMeasurement::Refresh()
 			cap1->m_offsets.push_back(start);
 			cap1->m_durations.push_back(delta);
 			cap1->m_samples.push_back(max_value);
-
-			nedges ++;
-			sum += delta;
 		}
-		else if (sadin)
+		else if(cap1 && sadin)
 		{
 			int64_t start_offs = (start - din->m_triggerPhase) / din->m_timescale;
 			int64_t end_offs = (end - din->m_triggerPhase) / din->m_timescale;
@@ -201,9 +206,6 @@ void PulseWidthMeasurement::Refresh()
 			cap1->m_offsets.push_back(start);
 			cap1->m_durations.push_back(delta);
 			cap1->m_samples.push_back(max_value);
-
-			nedges ++;
-			sum += delta;
 		}
 	}
 
@@ -212,7 +214,7 @@ void PulseWidthMeasurement::Refresh()
 
 	m_streams[2].m_value = sum.GetSum() / nedges;
 
-	if(sadin || uadin)
+	if(cap1)
 	{
 		//Set amplitude output waveform
 		SetData(cap1, 1);
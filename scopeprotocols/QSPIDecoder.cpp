@@ -124,6 +124,11 @@ void QSPIDecoder::Refresh()
 	cap->m_startFemtoseconds = clk->m_startFemtoseconds;
 	cap->m_triggerPhase = 0;
 
+	//Each byte takes four clock edges, so a sparse clock tells us about how big the output will get.
+	//Reserve up front to avoid repeatedly regrowing the buffers during long flash reads.
+	if(sclk)
+		cap->Reserve(sclk->size() / 4 + 2);
+
 	//TODO: packets based on CS# pulses
 
 	//Loop over the data and look for transactions
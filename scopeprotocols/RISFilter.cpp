@@ -38,12 +38,24 @@ using namespace std;
 RISFilter::RISFilter(const string& color)
 	: Filter(color, CAT_MATH)
 	, m_upsampleFactor(m_parameters["Upsample Factor"])
+	, m_gridLength(0)
+	, m_gridTimescale(0)
+	, m_gridUpsample(0)
+	, m_gridPhase(0)
+	, m_accumulatePipeline("shaders/RISFilter_Accumulate.spv", 3, sizeof(RISAccumulateConstants))
+	, m_outputPipeline("shaders/RISFilter_Output.spv", 3, sizeof(RISOutputConstants))
 {
 	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_ANALOG);
 	CreateInput("din");
 
 	m_upsampleFactor = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS));
 	m_upsampleFactor.SetIntVal(16);
+
+	//The grid stays on the GPU, the CPU only touches it to clear it
+	m_mean.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_UNLIKELY);
+	m_mean.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_count.SetCpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_UNLIKELY);
+	m_count.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
 }
 
 RISFilter::~RISFilter()
@@ -80,104 +92,126 @@ string RISFilter::GetProtocolName()
 
 void RISFilter::ClearSweeps()
 {
+	//Forget the grid, the next trigger starts a new one
+	m_gridLength = 0;
 	SetData(nullptr, 0);
 }
 
-void RISFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/, shared_ptr<QueueHandle> /*queue*/)
+void RISFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
-	/*
+	#ifdef HAVE_NVTX
+		nvtx3::scoped_range nrange("RISFilter::Refresh");
+	#endif
+
 	//Make sure we've got valid inputs
+	ClearErrors();
 	if(!VerifyAllInputsOK())
 	{
+		if(!GetInput(0))
+			AddErrorMessage("Missing inputs", "No signal input connected");
+		else if(!GetInputWaveform(0))
+			AddErrorMessage("Missing inputs", "No waveform available at input");
+
+		SetData(nullptr, 0);
+		return;
+	}
+	auto din = dynamic_cast<UniformAnalogWaveform*>(GetInputWaveform(0));
+	if(!din)
+	{
+		AddErrorMessage("Invalid input", "RIS requires uniformly sampled input");
 		SetData(nullptr, 0);
 		return;
 	}
 
-	//Get inputs
-	auto din = GetInputWaveform(0);
-	auto sdin = dynamic_cast<SparseAnalogWaveform*>(din);
-	auto udin = dynamic_cast<UniformAnalogWaveform*>(din);
-	size_t len = din->size();
-
-	//Convert half life to decay coefficient
-	float hl = m_parameters[m_halflife].GetIntVal();
-	float decay = 1 / pow(2, 1/hl);
-
-	din->PrepareForCpuAccess();
+	int64_t upsample = m_upsampleFactor.GetIntVal();
+	int64_t outTimescale = (upsample > 0) ? (din->m_timescale / upsample) : 0;
+	if(outTimescale <= 0)
+	{
+		AddErrorMessage("Bad upsample factor", "Upsample factor must be between 1 and the input sample period in fs");
+		SetData(nullptr, 0);
+		return;
+	}
 
-	//Set up units
 	m_xAxisUnit = m_inputs[0].m_channel->GetXAxisUnits();
 	SetYAxisUnits(m_inputs[0].GetYAxisUnits(), 0);
 
-	//See if we already had valid output data
-	auto cap = GetData(0);
-	auto scap = dynamic_cast<SparseAnalogWaveform*>(cap);
-	auto ucap = dynamic_cast<UniformAnalogWaveform*>(cap);
-	if(cap)
-		cap->PrepareForCpuAccess();
-
-	//Sparse path
-	if(sdin)
-	{
-		//No data? Just copy
-		if(!scap)
-		{
-			scap = new SparseAnalogWaveform;
-			scap->Resize(din->size());
-			cap = scap;
-
-			scap->m_samples.CopyFrom(sdin->m_samples);
-		}
-
-		//Actual filter code path
-		else
-		{
-			auto pin = sdin->m_samples.GetCpuPointer();
-			auto pout = scap->m_samples.GetCpuPointer();
-
-			for(size_t i=0; i<len; i++)
-				pout[i] = pout[i]*decay + pin[i]*(1-decay);
-		}
-
-		//Either way we want to reuse the timestamps
-		scap->CopyTimestamps(sdin);
-	}
-
-	//Uniform path
-	else
+	//Start a new grid if this is the first trigger or the acquisition setup changed.
+	//Bin 0 is aligned to the first trigger, later triggers land offset by their phase difference.
+	size_t len = din->size();
+	size_t nbins = len * upsample;
+	auto cap = dynamic_cast<UniformAnalogWaveform*>(GetData(0));
+	bool reset =
+		!cap ||
+		(m_gridLength != len) ||
+		(m_gridTimescale != din->m_timescale) ||
+		(m_gridUpsample != upsample);
+	if(reset)
 	{
-		//No data? Just copy
-		if(!ucap)
-		{
-			ucap = new UniformAnalogWaveform;
-			ucap->Resize(din->size());
-			cap = ucap;
-
-			ucap->m_samples.CopyFrom(udin->m_samples);
-		}
-
-		//Actual filter code path
-		else
-		{
-			auto pin = udin->m_samples.GetCpuPointer();
-			auto pout = ucap->m_samples.GetCpuPointer();
-
-			for(size_t i=0; i<len; i++)
-				pout[i] = pout[i]*decay + pin[i]*(1-decay);
-		}
+		m_gridLength = len;
+		m_gridTimescale = din->m_timescale;
+		m_gridUpsample = upsample;
+		m_gridPhase = din->m_triggerPhase;
+
+		m_mean.resize(nbins);
+		m_count.resize(nbins);
+
+		//Only happens on a setup change so no need for a GPU side fill
+		m_mean.PrepareForCpuAccess();
+		m_count.PrepareForCpuAccess();
+		memset(m_mean.GetCpuPointer(), 0, nbins*sizeof(float));
+		memset(m_count.GetCpuPointer(), 0, nbins*sizeof(uint32_t));
+		m_mean.MarkModifiedFromCpu();
+		m_count.MarkModifiedFromCpu();
+
+		cap = new UniformAnalogWaveform;
+		SetData(cap, 0);
 	}
 
-	//Update timestamps
-	cap->m_startTimestamp 		= din->m_startTimestamp;
-	cap->m_startFemtoseconds	= din->m_startFemtoseconds;
-	cap->m_triggerPhase			= din->m_triggerPhase;
-	cap->m_timescale			= din->m_timescale;
+	cap->m_startTimestamp = din->m_startTimestamp;
+	cap->m_startFemtoseconds = din->m_startFemtoseconds;
+	cap->m_triggerPhase = m_gridPhase;
+	cap->m_timescale = outTimescale;
 	cap->m_revision ++;
-
-	//Done
-	SetData(cap, 0);
-	cap->MarkModifiedFromCpu();
-	*/
+	cap->Resize(nbins);
+
+	//Bin shift of this trigger relative to the grid
+	double shift = round(static_cast<double>(din->m_triggerPhase - m_gridPhase) / outTimescale);
+
+	RISAccumulateConstants acfg;
+	acfg.len = len;
+	acfg.nbins = nbins;
+	acfg.upsample = upsample;
+	acfg.phaseOffset = static_cast<int32_t>(shift);
+
+	RISOutputConstants ocfg;
+	ocfg.nbins = nbins;
+	ocfg.upsample = upsample;
+
+	cmdBuf.begin({});
+
+	m_accumulatePipeline.BindBufferNonblocking(0, din->m_samples, cmdBuf);
+	m_accumulatePipeline.BindBufferNonblocking(1, m_mean, cmdBuf);
+	m_accumulatePipeline.BindBufferNonblocking(2, m_count, cmdBuf);
+	const uint32_t accumulate_block_count = GetComputeBlockCount(len, 64);
+	m_accumulatePipeline.Dispatch(cmdBuf, acfg,
+		min(accumulate_block_count, 32768u),
+		accumulate_block_count / 32768 + 1);
+	m_accumulatePipeline.AddComputeMemoryBarrier(cmdBuf);
+
+	m_outputPipeline.BindBufferNonblocking(0, m_mean, cmdBuf);
+	m_outputPipeline.BindBufferNonblocking(1, m_count, cmdBuf);
+	m_outputPipeline.BindBufferNonblocking(2, cap->m_samples, cmdBuf, true);
+	const uint32_t output_block_count = GetComputeBlockCount(nbins, 64);
+	m_outputPipeline.Dispatch(cmdBuf, ocfg,
+		min(output_block_count, 32768u),
+		output_block_count / 32768 + 1);
+
+	cmdBuf.end();
+	queue->SubmitAndBlock(cmdBuf);
+
+	m_mean.MarkModifiedFromGpu();
+	m_count.MarkModifiedFromGpu();
+	cap->MarkModifiedFromGpu();
 }
 
 Filter::DataLocation RISFilter::GetInputLocation()
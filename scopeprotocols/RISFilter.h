@@ -37,6 +37,28 @@
 
 class QueueHandle;
 
+class RISAccumulateConstants
+{
+public:
+	uint32_t	len;
+	uint32_t	nbins;
+	uint32_t	upsample;
+	int32_t		phaseOffset;
+};
+
+class RISOutputConstants
+{
+public:
+	uint32_t	nbins;
+	uint32_t	upsample;
+};
+
+/**
+	@brief Random interleaved sampling: builds an equivalent-time waveform from many triggers with random phase
+
+	Each trigger is binned into a fixed grid upsample times finer than the input, keeping a running mean per bin. The
+	cost of a trigger depends only on its own length, not on how many triggers have already been merged.
+ */
 class RISFilter : public Filter
 {
 public:
@@ -56,6 +78,30 @@ public:
 
 protected:
 	FilterParameter& m_upsampleFactor;
+
+	///@brief Running mean of every sample that landed in each bin
+	AcceleratorBuffer<float> m_mean;
+
+	///@brief Number of samples that landed in each bin
+	AcceleratorBuffer<uint32_t> m_count;
+
+	///@brief Input length the grid was set up for
+	size_t m_gridLength;
+
+	///@brief Input timescale the grid was set up for
+	int64_t m_gridTimescale;
+
+	///@brief Upsampling factor the grid was set up for
+	int64_t m_gridUpsample;
+
+	///@brief Trigger phase of the first trigger, which bin 0 is aligned to
+	int64_t m_gridPhase;
+
+	///@brief Adds one trigger to m_mean and m_count
+	ComputePipeline m_accumulatePipeline;
+
+	///@brief Converts the grid to the output waveform, filling bins no trigger has hit yet
+	ComputePipeline m_outputPipeline;
 };
 
 #endif
@@ -93,30 +93,16 @@ void RMSMeasurement::Refresh()
 	SetYAxisUnits(m_inputs[0].GetYAxisUnits(), 1);
 	auto length = din->size();
 
-	//Calculate the global RMS value
-	//Sum the squares of all values after subtracting the DC value
-	float temp = 0;
-	if(uadin)
-	{
-		for (size_t i = 0; i < length; i++)
-			temp += uadin->m_samples[i] * uadin->m_samples[i];
-	}
-	else if(sadin)
-	{
-		for (size_t i = 0; i < length; i++)
-			temp += sadin->m_samples[i] * sadin->m_samples[i];
-	}
-
-	//Divide by total number of samples and take the square root to get the final AC RMS
-	m_streams[1].m_value = sqrt(temp / length);
+	//Calculate the global RMS value (shared with any other measurements on this waveform)
+	auto stats = AnalogStatistics::Get(din);
+	m_streams[1].m_value = stats->GetRMS();
 
 	//Now we can do the cycle-by-cycle value
-	temp = 0;
 	vector<int64_t> edges;
 
 	//Auto-threshold analog signals at average value
 	//TODO: make threshold configurable?
-	float threshold = GetAvgVoltage(sadin, uadin);
+	float threshold = stats->GetAverage();
 	if(uadin)
 		FindZeroCrossings(uadin, threshold, edges);
 	else if(sadin)
@@ -134,25 +120,17 @@ void RMSMeasurement::Refresh()
 	cap->PrepareForCpuAccess();
 
 	size_t elen = edges.size();
+	const float* samples = uadin ? uadin->m_samples.GetCpuPointer() : sadin->m_samples.GetCpuPointer();
 
 	for(size_t i = 0; i < (elen - 2); i += 2)
 	{
 		//Measure from edge to 2 edges later, since we find all zero crossings regardless of polarity
 		int64_t start = edges[i] / din->m_timescale;
 		int64_t end = edges[i + 2] / din->m_timescale;
-		int64_t j = 0;
+		int64_t j = max(start, min(end + 1, (int64_t)length));
 
-		//Simply sum the squares of all values in a cycle after subtracting the DC value
-		if(uadin)
-		{
-			for(j = start; (j <= end) && (j < (int64_t)length); j++)
-				temp += uadin->m_samples[j] * uadin->m_samples[j];
-		}
-		else if(sadin)
-		{
-			for(j = start; (j <= end) && (j < (int64_t)length); j++)
-				temp += sadin->m_samples[j] * sadin->m_samples[j];
-		}
+		//Simply sum the squares of all values in a cycle
+		double sum = g_simdKernels.sumSquares(samples + start, j - start, 0);
 
 		//Get the difference between the end and start of cycle. This would be the number of samples
 		//on which AC RMS calculation was performed
@@ -160,11 +138,8 @@ void RMSMeasurement::Refresh()
 
 		if (delta != 0)
 		{
-			//Divide by total number of samples for one cycle
-			temp /= delta;
-
-			//Take square root to get the final AC RMS Value of one cycle
-			temp = sqrt(temp);
+			//Divide by total number of samples for one cycle, then take square root to get the RMS of one cycle
+			float temp = sqrt(sum / delta);
 
 			//Push values to the waveform
 			cap->m_offsets.push_back(start);
@@ -100,10 +100,48 @@ void RiseMeasurement::Refresh()
 
 	//Get the input data
 	auto din = GetInputWaveform(0);
-	size_t len = din->size();
 	din->PrepareForCpuAccess();
+
+	//Create the output
+	auto cap = SetupEmptySparseAnalogOutputWaveform(din, 0);
+	cap->m_timescale = 1;
+	cap->PrepareForCpuAccess();
+
+	float avg;
+	Measure(din, cap, avg);
+
+	SetData(cap, 0);
+	cap->MarkModifiedFromCpu();
+
+	m_streams[1].m_value = avg;
+}
+
+bool RiseMeasurement::SupportsScalarBatch(size_t stream)
+{
+	return (stream == 1);
+}
+
+bool RiseMeasurement::EvaluateScalarSegment(WaveformBase* din, size_t /*stream*/, float& value)
+{
+	return Measure(din, nullptr, value);
+}
+
+/**
+	@brief Measures every rise time in a waveform
+
+	@param din	Input waveform, already prepared for CPU access
+	@param cap	Output for the individual measurements (may be null if only the average is wanted)
+	@param avg	Average of all measurements
+
+	@return True if at least one edge was measured
+ */
+bool RiseMeasurement::Measure(WaveformBase* din, SparseAnalogWaveform* cap, float& avg)
+{
 	auto sdin = dynamic_cast<SparseAnalogWaveform*>(din);
 	auto udin = dynamic_cast<UniformAnalogWaveform*>(din);
+	if(!sdin && !udin)
+		return false;
+	size_t len = din->size();
 
 	//Get the base/top (we use these for calculating percentages)
 	float base = GetBaseVoltage(sdin, udin);
@@ -114,18 +152,12 @@ void RiseMeasurement::Refresh()
 	float vstart = base + m_parameters[m_startname].GetFloatVal()*delta;
 	float vend = base + m_parameters[m_endname].GetFloatVal()*delta;
 
-	//Create the output
-	auto cap = SetupEmptySparseAnalogOutputWaveform(din, 0);
-	cap->m_timescale = 1;
-	cap->PrepareForCpuAccess();
-
 	float last = 1e20;
 	double tedge = 0;
 
 	int state = 0;
 	int64_t tlast = 0;
 
-	//LogDebug("vstart = %.3f, vend = %.3f\n", vstart, vend);
 	double sum = 0;
 	int64_t num = 0;
 	for(size_t i=0; i < len; i++)
@@ -150,9 +182,12 @@ void RiseMeasurement::Refresh()
 			{
 				double dt = InterpolateTime(sdin, udin, i-1, vend)*din->m_timescale + tnow - din->m_timescale - tedge;
 
-				cap->m_offsets.push_back(tlast);
-				cap->m_durations.push_back(tnow-tlast);
-				cap->m_samples.push_back(dt);
+				if(cap)
+				{
+					cap->m_offsets.push_back(tlast);
+					cap->m_durations.push_back(tnow - tlast);
+					cap->m_samples.push_back(dt);
+				}
 				tlast = tnow;
 
 				sum += dt;
@@ -165,8 +200,6 @@ void RiseMeasurement::Refresh()
 		last = cur;
 	}
 
-	SetData(cap, 0);
-	cap->MarkModifiedFromCpu();
-
-	m_streams[1].m_value = sum / num;
+	avg = sum / num;
+	return (num > 0);
 }
@@ -46,6 +46,100 @@ SDRAMDecoderBase::~SDRAMDecoderBase()
 {
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Command decoding
+
+/**
+	@brief Samples the command bus on each rising clock edge and emits a symbol for every command other than NOP
+
+	All of the lines are read from their cached edge lists with one cursor each, so the cost is O(clock edges +
+	command line edges) regardless of the capture's sample rate, and the per-sample scans (done on the GPU for big
+	uniform captures) are shared with any other filter looking at the same signals.
+
+	@param clk		Command clock
+	@param cs		Chip select (active low)
+	@param ras		Row address strobe (active low)
+	@param cas		Column address strobe (active low)
+	@param we		Write enable (active low)
+	@param a10		Address bit 10 (auto precharge / precharge all)
+	@param table	Command for each combination of RAS/CAS/WE/A10, indexed by CommandBits. Combinations with RAS,
+					CAS, and WE all high are NOPs and never looked up.
+	@param cap		Output waveform
+ */
+void SDRAMDecoderBase::DecodeCommands(
+	WaveformBase* clk,
+	WaveformBase* cs,
+	WaveformBase* ras,
+	WaveformBase* cas,
+	WaveformBase* we,
+	WaveformBase* a10,
+	const SDRAMSymbol::stype* table,
+	SDRAMWaveform* cap)
+{
+	if( (cs->size() == 0) || (ras->size() == 0) || (cas->size() == 0) || (we->size() == 0) || (a10->size() == 0) )
+		return;
+
+	auto clkEdges = DigitalEdgeList::Get(clk);
+	auto csEdges = DigitalEdgeList::Get(cs);
+	auto rasEdges = DigitalEdgeList::Get(ras);
+	auto casEdges = DigitalEdgeList::Get(cas);
+	auto weEdges = DigitalEdgeList::Get(we);
+	auto a10Edges = DigitalEdgeList::Get(a10);
+
+	size_t ics = 0;
+	size_t iras = 0;
+	size_t icas = 0;
+	size_t iwe = 0;
+	size_t ia10 = 0;
+
+	size_t nclk = clkEdges->size();
+	for(size_t i=clkEdges->GetFirstRisingEdge(); i<nclk; i+=2)
+	{
+		int64_t t = clkEdges->GetEdgeScaled(i);
+
+		//Deselected, nothing to do
+		if(csEdges->GetValueBeforeScaled(t, ics))
+			continue;
+
+		unsigned int bits = 0;
+		if(rasEdges->GetValueBeforeScaled(t, iras))
+			bits |= CMD_BIT_RAS;
+		if(casEdges->GetValueBeforeScaled(t, icas))
+			bits |= CMD_BIT_CAS;
+		if(weEdges->GetValueBeforeScaled(t, iwe))
+			bits |= CMD_BIT_WE;
+		if(a10Edges->GetValueBeforeScaled(t, ia10))
+			bits |= CMD_BIT_A10;
+
+		//NOP
+		const unsigned int nop = CMD_BIT_RAS | CMD_BIT_CAS | CMD_BIT_WE;
+		if( (bits & nop) == nop)
+			continue;
+
+		//Unknown
+		//TODO: self refresh entry/exit (we don't have CKE in the current test data source so can't use it)
+		auto type = table[bits];
+		if(type == SDRAMSymbol::TYPE_ERROR)
+		{
+			LogDebug("[%zu] Unknown command (RAS=%d, CAS=%d, WE=%d, A10=%d)\n",
+				i,
+				(bits & CMD_BIT_RAS) ? 1 : 0,
+				(bits & CMD_BIT_CAS) ? 1 : 0,
+				(bits & CMD_BIT_WE) ? 1 : 0,
+				(bits & CMD_BIT_A10) ? 1 : 0);
+		}
+
+		//Symbol lasts until the next clock edge
+		int64_t dur = 1;
+		if(i+2 < nclk)
+			dur = clkEdges->GetEdgeScaled(i+2) - t;
+
+		cap->m_offsets.push_back(t);
+		cap->m_durations.push_back(dur);
+		cap->m_samples.push_back(SDRAMSymbol(type));
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Pretty printing
 
@@ -84,6 +84,31 @@ class SDRAMDecoderBase : public Filter
 public:
 	SDRAMDecoderBase(const std::string& color);
 	virtual ~SDRAMDecoderBase();
+
+	/**
+		@brief Bit positions of the command lines in a command decode table index
+	 */
+	enum CommandBits
+	{
+		CMD_BIT_A10	= 1,
+		CMD_BIT_WE	= 2,
+		CMD_BIT_CAS	= 4,
+		CMD_BIT_RAS	= 8
+	};
+
+	///@brief Number of entries in a command decode table
+	static const size_t COMMAND_TABLE_SIZE = 16;
+
+protected:
+	void DecodeCommands(
+		WaveformBase* clk,
+		WaveformBase* cs,
+		WaveformBase* ras,
+		WaveformBase* cas,
+		WaveformBase* we,
+		WaveformBase* a10,
+		const SDRAMSymbol::stype* table,
+		SDRAMWaveform* cap);
 };
 
 #endif
@@ -93,16 +93,10 @@ void SPIDecoder::Refresh()
 	auto csn = GetInputWaveform(1);
 	auto data = GetInputWaveform(2);
 
-	clk->PrepareForCpuAccess();
-	csn->PrepareForCpuAccess();
-	data->PrepareForCpuAccess();
-
-	auto sclk = dynamic_cast<SparseDigitalWaveform*>(clk);
-	auto uclk = dynamic_cast<UniformDigitalWaveform*>(clk);
-	auto scsn = dynamic_cast<SparseDigitalWaveform*>(csn);
-	auto ucsn = dynamic_cast<UniformDigitalWaveform*>(csn);
-	auto sdata = dynamic_cast<SparseDigitalWaveform*>(data);
-	auto udata = dynamic_cast<UniformDigitalWaveform*>(data);
+	//We only care about edges, so work from the (shared, cached) edge lists
+	auto clkEdges = DigitalEdgeList::Get(clk);
+	auto csnEdges = DigitalEdgeList::Get(csn);
+	auto dataEdges = DigitalEdgeList::Get(data);
 
 	//Create the capture
 	auto cap = new SPIWaveform;
@@ -136,10 +130,6 @@ void SPIDecoder::Refresh()
 
 	int64_t timestamp	= 0;
 
-	size_t clklen = clk->size();
-	size_t cslen = csn->size();
-	size_t datalen = data->size();
-
 	//Get SPI clock polarity
 	auto cpol = m_parameters[m_cpol].GetIntVal();
 
@@ -152,9 +142,9 @@ void SPIDecoder::Refresh()
 	while(true)
 	{
 		//Get the current samples
-		bool cur_cs = GetValue(scsn, ucsn, ics);
-		bool cur_clk = GetValue(sclk, uclk, iclk);
-		bool cur_data = GetValue(sdata, udata, idata);
+		bool cur_cs = csnEdges->GetValueAtScaled(timestamp, ics);
+		bool cur_clk = clkEdges->GetValueAtScaled(timestamp, iclk);
+		bool cur_data = dataEdges->GetValueAtScaled(timestamp, idata);
 
 		switch(state)
 		{
@@ -256,20 +246,20 @@ void SPIDecoder::Refresh()
 				break;
 		}
 
-		//Get timestamps of next event on each channel
-		int64_t next_cs = GetNextEventTimestampScaled(scsn, ucsn, ics, cslen, timestamp);
-		int64_t next_clk = GetNextEventTimestampScaled(sclk, uclk, iclk, clklen, timestamp);
+		//Get timestamp of the next edge on CS# or clock
+		//(cursors are already past every edge at or before the current timestamp)
+		int64_t next_timestamp = INT64_MAX;
+		if(ics < csnEdges->size())
+			next_timestamp = min(next_timestamp, csnEdges->GetEdgeScaled(ics));
+		if(iclk < clkEdges->size())
+			next_timestamp = min(next_timestamp, clkEdges->GetEdgeScaled(iclk));
 
 		//If we can't move forward, stop (don't bother looking for glitches on data)
-		int64_t next_timestamp = min(next_clk, next_cs);
-		if(next_timestamp == timestamp)
+		if(next_timestamp == INT64_MAX)
 			break;
 
 		//All good, move on
 		timestamp = next_timestamp;
-		AdvanceToTimestampScaled(scsn, ucsn, ics, cslen, timestamp);
-		AdvanceToTimestampScaled(sclk, uclk, iclk, clklen, timestamp);
-		AdvanceToTimestampScaled(sdata, udata, idata, datalen, timestamp);
 	}
 
 	SetData(cap, 0);
@@ -877,6 +877,8 @@ void SPIFlashDecoder::Refresh()
 							pack->m_headers["Info"] = cap->GetText(cap->m_samples.size()-1);
 					}
 
+					UpdateLengthHeader(pack);
+
 					//Only write to the output for actual flash data!
 					//We don't want to save descriptors.
 					if(current_cmd != SPIFlashSymbol::CMD_READ_SFDP)
@@ -911,9 +913,6 @@ void SPIFlashDecoder::Refresh()
 					pack->m_data.push_back(dout->m_samples[iin].m_data);
 					pack->m_len = (dout->m_offsets[iin] + dout->m_durations[iin])*dout->m_timescale +
 						dout->m_triggerPhase - pack->m_offset;
-					char tmp[128];
-					snprintf(tmp, sizeof(tmp), "%zu", pack->m_data.size());
-					pack->m_headers["Len"] = tmp;
 
 					//If reading multibyte special value (vendor ID etc), handle that
 					switch(data_type)
@@ -958,28 +957,34 @@ void SPIFlashDecoder::Refresh()
 					iquad ++;
 				}
 
-				//Read quad samples until we get to a deselect event
-				while(iquad < quadlen)
+				//Find the run of quad data samples up to the deselect event, then copy it in bulk
+				//rather than growing the waveform and packet one byte at a time
 				{
-					auto squad = dquad->m_samples[iquad];
-					if(squad.m_stype != SPISymbol::TYPE_DATA)
-						break;
-
-					//Copy the data
-					cap->m_offsets.push_back(dquad->m_offsets[iquad]);
-					cap->m_durations.push_back(dquad->m_durations[iquad]);
-					cap->m_samples.push_back(SPIFlashSymbol(
-						data_type, SPIFlashSymbol::CMD_UNKNOWN, dquad->m_samples[iquad].m_data));
+					size_t qstart = iquad;
+					while( (iquad < quadlen) && (dquad->m_samples[iquad].m_stype == SPISymbol::TYPE_DATA) )
+						iquad ++;
+					size_t nbytes = iquad - qstart;
 
-					//Extend the packet
-					pack->m_data.push_back(dquad->m_samples[iquad].m_data);
-					pack->m_len = (dquad->m_offsets[iquad] + dquad->m_durations[iquad])*dquad->m_timescale +
-						dquad->m_triggerPhase - pack->m_offset;
-					char tmp[128];
-					snprintf(tmp, sizeof(tmp), "%zu", pack->m_data.size());
-					pack->m_headers["Len"] = tmp;
+					size_t base = cap->m_samples.size();
+					cap->Resize(base + nbytes);
+					size_t dbase = pack->m_data.size();
+					pack->m_data.resize(dbase + nbytes);
+					for(size_t j=0; j<nbytes; j++)
+					{
+						auto& squad = dquad->m_samples[qstart + j];
+						cap->m_offsets[base + j] = dquad->m_offsets[qstart + j];
+						cap->m_durations[base + j] = dquad->m_durations[qstart + j];
+						cap->m_samples[base + j] = SPIFlashSymbol(data_type, SPIFlashSymbol::CMD_UNKNOWN, squad.m_data);
+						pack->m_data[dbase + j] = squad.m_data;
+					}
 
-					iquad ++;
+					if(nbytes)
+					{
+						size_t last = iquad - 1;
+						pack->m_len = (dquad->m_offsets[last] + dquad->m_durations[last])*dquad->m_timescale +
+							dquad->m_triggerPhase - pack->m_offset;
+					}
+					UpdateLengthHeader(pack);
 				}
 
 				//Realign the x1 sample stream to where we left off
@@ -1003,6 +1008,7 @@ void SPIFlashDecoder::Refresh()
 				if(s.m_stype != SPISymbol::TYPE_DATA)
 				{
 					state = STATE_IDLE;
+					UpdateLengthHeader(pack);
 
 					//At the end of a write command, crack status registers if needed
 					if(data_type != SPIFlashSymbol::TYPE_DATA)
@@ -1019,17 +1025,34 @@ void SPIFlashDecoder::Refresh()
 					pack->m_data.push_back(din->m_samples[iin].m_data);
 					pack->m_len = (din->m_offsets[iin] + din->m_durations[iin]) * din->m_timescale +
 						din->m_triggerPhase - pack->m_offset;
-					char tmp[128];
-					snprintf(tmp, sizeof(tmp), "%zu", pack->m_data.size());
-					pack->m_headers["Len"] = tmp;
 				}
 				break;
 		}
 	}
 
+	//Capture ended partway through the data phase of a command
+	if( pack && ( (state == STATE_READ_DATA) || (state == STATE_WRITE_DATA) ) )
+		UpdateLengthHeader(pack);
+
 	cap->MarkModifiedFromCpu();
 }
 
+/**
+	@brief Sets the "Len" column of a packet to its current data length
+
+	Only done once per command, when the data phase ends, since formatting it for every byte is expensive on long
+	reads.
+ */
+void SPIFlashDecoder::UpdateLengthHeader(Packet* pack)
+{
+	if(pack->m_data.empty())
+		return;
+
+	char tmp[32];
+	snprintf(tmp, sizeof(tmp), "%zu", pack->m_data.size());
+	pack->m_headers["Len"] = tmp;
+}
+
 std::string SPIFlashWaveform::GetColor(size_t i)
 {
 	const SPIFlashSymbol& s = m_samples[i];
@@ -157,6 +157,8 @@ public:
 	static std::string GetPartID(SPIFlashWaveform* cap, const SPIFlashSymbol& s, int i);
 
 protected:
+	static void UpdateLengthHeader(Packet* pack);
+
 	std::string m_typename;
 	std::string m_outfile;
 
@@ -124,7 +124,7 @@ bool SParameterCascadeFilter::ValidateChannel(size_t i, StreamDescriptor stream)
 }
 
 
-void SParameterCascadeFilter::Refresh()
+void SParameterCascadeFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
 	//Make sure we've got valid inputs
 	if(!VerifyAllInputsOK())
@@ -150,71 +150,18 @@ void SParameterCascadeFilter::Refresh()
 	SParameterVector s21b(GetInputWaveform(12), GetInputWaveform(13));
 	SParameterVector s22b(GetInputWaveform(14), GetInputWaveform(15));
 
-	//Vectors for output
-	size_t npoints = s11a.size();
-	SParameterVector s11o;
-	SParameterVector s12o;
-	SParameterVector s21o;
-	SParameterVector s22o;
-	s11o.resize(npoints);
-	s12o.resize(npoints);
-	s21o.resize(npoints);
-	s22o.resize(npoints);
-
-	//Concatenate the S-parameters
-	//(equation 2.18, page 118 of Dunsmore 2nd edition)
-	for(size_t i=0; i<npoints;i++)
+	SParameterVector* inputs[8] =
 	{
-		float freq = s11a.m_points[i].m_frequency;
-
-		//Interpolate all inputs to our current frequency bin
-		//and convert from our default mag/angle representation to real/imaginary
-		auto p11a = s11a.InterpolatePoint(freq).ToComplex();
-		auto p12a = s12a.InterpolatePoint(freq).ToComplex();
-		auto p21a = s21a.InterpolatePoint(freq).ToComplex();
-		auto p22a = s22a.InterpolatePoint(freq).ToComplex();
-
-		auto p11b = s11b.InterpolatePoint(freq).ToComplex();
-		auto p12b = s12b.InterpolatePoint(freq).ToComplex();
-		auto p21b = s21b.InterpolatePoint(freq).ToComplex();
-		auto p22b = s22b.InterpolatePoint(freq).ToComplex();
-
-		//Do the actual math
-		auto one = complex<float>(1, 0);
-		auto p11 = p11a + (p11b * p21a * p12a) / (one - p22a*p11b);
-		auto p12 = (p12a*p12b) / (one - p22a*p11b);
-		auto p21 = (p21a*p21b) / (one - p22a*p11b);
-		auto p22 = p22b + (p22a * p21b * p12b) / (one - p22a*p11b);
-
-		//Convert back to mag/angle
-		s11o.m_points[i] = SParameterPoint(freq, p11);
-		s12o.m_points[i] = SParameterPoint(freq, p12);
-		s21o.m_points[i] = SParameterPoint(freq, p21);
-		s22o.m_points[i] = SParameterPoint(freq, p22);
-	}
+		&s11a, &s12a, &s21a, &s22a,
+		&s11b, &s12b, &s21b, &s22b
+	};
 
 	//Waveforms for output
-	auto s11o_mag = SetupEmptySparseAnalogOutputWaveform(base, 0);
-	auto s11o_ang = SetupEmptySparseAnalogOutputWaveform(base, 1);
-	auto s12o_mag = SetupEmptySparseAnalogOutputWaveform(base, 2);
-	auto s12o_ang = SetupEmptySparseAnalogOutputWaveform(base, 3);
-	auto s21o_mag = SetupEmptySparseAnalogOutputWaveform(base, 4);
-	auto s21o_ang = SetupEmptySparseAnalogOutputWaveform(base, 5);
-	auto s22o_mag = SetupEmptySparseAnalogOutputWaveform(base, 6);
-	auto s22o_ang = SetupEmptySparseAnalogOutputWaveform(base, 7);
-
-	//Copy the output
-	s11o.ConvertToWaveforms(s11o_mag, s11o_ang);
-	s12o.ConvertToWaveforms(s12o_mag, s12o_ang);
-	s21o.ConvertToWaveforms(s21o_mag, s21o_ang);
-	s22o.ConvertToWaveforms(s22o_mag, s22o_ang);
-
-	s11o_mag->MarkModifiedFromCpu();
-	s11o_ang->MarkModifiedFromCpu();
-	s12o_mag->MarkModifiedFromCpu();
-	s12o_ang->MarkModifiedFromCpu();
-	s21o_mag->MarkModifiedFromCpu();
-	s21o_ang->MarkModifiedFromCpu();
-	s22o_mag->MarkModifiedFromCpu();
-	s22o_ang->MarkModifiedFromCpu();
+	SparseAnalogWaveform* outputs[8];
+	for(size_t i=0; i<8; i++)
+		outputs[i] = SetupEmptySparseAnalogOutputWaveform(base, i);
+
+	//Concatenate the S-parameters
+	//(equation 2.18, page 118 of Dunsmore 2nd edition)
+	m_kernel.Run(cmdBuf, queue, SParameterTwoPortKernel::MODE_CASCADE, inputs, outputs);
 }
@@ -35,6 +35,8 @@
 #ifndef SParameterCascadeFilter_h
 #define SParameterCascadeFilter_h
 
+#include "SParameterTwoPortKernel.h"
+
 class SParameterCascadeFilter : public SParameterFilter
 {
 public:
@@ -45,12 +47,14 @@ public:
 
 	static std::string GetProtocolName();
 
-	virtual void Refresh() override;
+	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
 
 	PROTOCOL_DECODER_INITPROC(SParameterCascadeFilter)
 
 protected:
 	virtual void RefreshPorts() override;
+
+	SParameterTwoPortKernel m_kernel;
 };
 
 #endif
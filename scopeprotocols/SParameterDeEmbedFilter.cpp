@@ -130,7 +130,7 @@ bool SParameterDeEmbedFilter::ValidateChannel(size_t i, StreamDescriptor stream)
 }
 
 
-void SParameterDeEmbedFilter::Refresh()
+void SParameterDeEmbedFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
 	//Make sure we've got valid inputs
 	if(!VerifyAllInputsOK())
@@ -139,7 +139,7 @@ void SParameterDeEmbedFilter::Refresh()
 		return;
 	}
 
-	//Use S11a magnitude as timebase reference for our output
+	//Use S11c magnitude as timebase reference for our output
 	auto base = GetInputWaveform(0);
 
 	for(size_t i=0; i<16; i++)
@@ -157,90 +157,19 @@ void SParameterDeEmbedFilter::Refresh()
 	SParameterVector s21k(GetInputWaveform(12), GetInputWaveform(13));
 	SParameterVector s22k(GetInputWaveform(14), GetInputWaveform(15));
 
-	//Vectors for output
-	size_t npoints = s11c.size();
-	SParameterVector s11o;
-	SParameterVector s12o;
-	SParameterVector s21o;
-	SParameterVector s22o;
-	s11o.resize(npoints);
-	s12o.resize(npoints);
-	s21o.resize(npoints);
-	s22o.resize(npoints);
-
-	//Figure out which network is known
-	bool knownIsA = (m_parameters[m_knownSide].GetIntVal() == SIDE_LEFT);
-
-	//Do the actual de-embed
-	for(size_t i=0; i<npoints;i++)
+	SParameterVector* inputs[8] =
 	{
-		float freq = s11c.m_points[i].m_frequency;
-
-		//Interpolate all inputs to our current frequency bin
-		//and convert from our default mag/angle representation to real/imaginary
-		auto p11c = s11c.InterpolatePoint(freq).ToComplex();
-		auto p12c = s12c.InterpolatePoint(freq).ToComplex();
-		auto p21c = s21c.InterpolatePoint(freq).ToComplex();
-		auto p22c = s22c.InterpolatePoint(freq).ToComplex();
-
-		auto p11k = s11k.InterpolatePoint(freq).ToComplex();
-		auto p12k = s12k.InterpolatePoint(freq).ToComplex();
-		auto p21k = s21k.InterpolatePoint(freq).ToComplex();
-		auto p22k = s22k.InterpolatePoint(freq).ToComplex();
-
-		complex<float> p11;
-		complex<float> p12;
-		complex<float> p21;
-		complex<float> p22;
-		complex<float> one = complex<float>(1, 0);
-
-		//Solve for B network given A
-		if(knownIsA)
-		{
-			p11 = (p11c - p11k) / (p21k*p12k + p22k*p11c - p22k*p11k);
-			p12 = (p12c - p12c*p11*p22k) / p12k;
-			p21 = (p21c - p21c*p22k*p11) / p21k;
-			p22 = p22c - (p22k * p21 * p12) / (one - p22k*p11);
-		}
-
-		//Solve for A network given B
-		else
-		{
-			p22 = (p22c - p22k) / (p21k*p12k + p22c*p11k - p22k*p11k);
-			p12 = (p12c - p12c*p11k*p22) / p12k;
-			p21 = (p21c - p21c*p22*p11k) / p21k;
-			p11 = p11c - (p11k * p21 * p12) / (one - p22*p11k);
-		}
-
-		//Convert back to mag/angle
-		s11o.m_points[i] = SParameterPoint(freq, p11);
-		s12o.m_points[i] = SParameterPoint(freq, p12);
-		s21o.m_points[i] = SParameterPoint(freq, p21);
-		s22o.m_points[i] = SParameterPoint(freq, p22);
-	}
+		&s11c, &s12c, &s21c, &s22c,
+		&s11k, &s12k, &s21k, &s22k
+	};
 
 	//Waveforms for output
-	auto s11o_mag = SetupEmptySparseAnalogOutputWaveform(base, 0);
-	auto s11o_ang = SetupEmptySparseAnalogOutputWaveform(base, 1);
-	auto s12o_mag = SetupEmptySparseAnalogOutputWaveform(base, 2);
-	auto s12o_ang = SetupEmptySparseAnalogOutputWaveform(base, 3);
-	auto s21o_mag = SetupEmptySparseAnalogOutputWaveform(base, 4);
-	auto s21o_ang = SetupEmptySparseAnalogOutputWaveform(base, 5);
-	auto s22o_mag = SetupEmptySparseAnalogOutputWaveform(base, 6);
-	auto s22o_ang = SetupEmptySparseAnalogOutputWaveform(base, 7);
-
-	//Copy the output
-	s11o.ConvertToWaveforms(s11o_mag, s11o_ang);
-	s12o.ConvertToWaveforms(s12o_mag, s12o_ang);
-	s21o.ConvertToWaveforms(s21o_mag, s21o_ang);
-	s22o.ConvertToWaveforms(s22o_mag, s22o_ang);
-
-	s11o_mag->MarkModifiedFromCpu();
-	s11o_ang->MarkModifiedFromCpu();
-	s12o_mag->MarkModifiedFromCpu();
-	s12o_ang->MarkModifiedFromCpu();
-	s21o_mag->MarkModifiedFromCpu();
-	s21o_ang->MarkModifiedFromCpu();
-	s22o_mag->MarkModifiedFromCpu();
-	s22o_ang->MarkModifiedFromCpu();
+	SparseAnalogWaveform* outputs[8];
+	for(size_t i=0; i<8; i++)
+		outputs[i] = SetupEmptySparseAnalogOutputWaveform(base, i);
+
+	//Figure out which network is known, then do the actual de-embed
+	auto mode = (m_parameters[m_knownSide].GetIntVal() == SIDE_LEFT) ?
+		SParameterTwoPortKernel::MODE_DEEMBED_KNOWN_LEFT : SParameterTwoPortKernel::MODE_DEEMBED_KNOWN_RIGHT;
+	m_kernel.Run(cmdBuf, queue, mode, inputs, outputs);
 }
@@ -35,6 +35,8 @@
 #ifndef SParameterDeEmbedFilter_h
 #define SParameterDeEmbedFilter_h
 
+#include "SParameterTwoPortKernel.h"
+
 /**
 	@brief De-embeds a known
  */
@@ -48,13 +50,15 @@ public:
 
 	static std::string GetProtocolName();
 
-	virtual void Refresh() override;
+	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
 
 	PROTOCOL_DECODER_INITPROC(SParameterDeEmbedFilter)
 
 protected:
 	virtual void RefreshPorts() override;
 
+	SParameterTwoPortKernel m_kernel;
+
 	enum Side
 	{
 		SIDE_LEFT,
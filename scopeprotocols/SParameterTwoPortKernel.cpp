@@ -0,0 +1,134 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of SParameterTwoPortKernel
+ */
+#include "../scopehal/scopehal.h"
+#include "SParameterTwoPortKernel.h"
+
+using namespace std;
+
+SParameterTwoPortKernel::SParameterTwoPortKernel()
+	: m_computePipeline("shaders/SParameterTwoPort.spv", 9, sizeof(SParameterTwoPortArgs))
+{
+	m_points.SetCpuAccessHint(AcceleratorBuffer<SParameterPoint>::HINT_LIKELY);
+	m_points.SetGpuAccessHint(AcceleratorBuffer<SParameterPoint>::HINT_LIKELY);
+}
+
+/**
+	@brief Computes the output network
+
+	@param cmdBuf	Command buffer to record into (must not be in the recording state)
+	@param queue	Queue to submit on
+	@param mode		Operation to perform
+	@param inputs	S11, S12, S21, S22 of network A followed by those of network B
+	@param outputs	Magnitude and angle of S11, S12, S21, S22 of the resulting network
+ */
+void SParameterTwoPortKernel::Run(
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue,
+	Mode mode,
+	SParameterVector* const* inputs,
+	SparseAnalogWaveform* const* outputs)
+{
+	//Pack all of the inputs into one buffer
+	SParameterTwoPortArgs args;
+	args.npoints = inputs[0]->size();
+	args.mode = mode;
+	size_t total = 0;
+	for(size_t i=0; i<8; i++)
+	{
+		args.offsets[i] = total;
+		args.lengths[i] = inputs[i]->size();
+		total += inputs[i]->size();
+	}
+	m_points.resize(total);
+	m_points.PrepareForCpuAccess();
+	for(size_t i=0; i<8; i++)
+	{
+		auto& v = inputs[i]->m_points;
+		v.PrepareForCpuAccess();
+		if(v.size())
+			memcpy(&m_points[args.offsets[i]], &v[0], v.size() * sizeof(SParameterPoint));
+	}
+	m_points.MarkModifiedFromCpu();
+
+	//Timestamps are the same for every output, so generate them once on the CPU
+	size_t len = args.npoints;
+	auto& freqs = inputs[0]->m_points;
+	auto wbase = outputs[0];
+	wbase->Resize(len);
+	wbase->m_offsets.PrepareForCpuAccess();
+	wbase->m_durations.PrepareForCpuAccess();
+	for(size_t i=0; i<len; i++)
+	{
+		auto freq = freqs[i].m_frequency;
+		wbase->m_offsets[i] = freq;
+		if(i+1 == len)
+			wbase->m_durations[i] = 1;
+		else
+			wbase->m_durations[i] = freqs[i+1].m_frequency - freq;
+	}
+	wbase->MarkTimestampsModifiedFromCpu();
+
+	for(size_t i=0; i<8; i++)
+	{
+		auto w = outputs[i];
+		w->m_triggerPhase = 0;
+		w->m_timescale = 1;
+		if(i > 0)
+		{
+			w->Resize(len);
+			w->CopyTimestamps(wbase);
+		}
+	}
+
+	if(len == 0)
+		return;
+
+	//Do the math
+	cmdBuf.begin({});
+
+	m_computePipeline.BindBufferNonblocking(0, m_points, cmdBuf);
+	for(size_t i=0; i<8; i++)
+		m_computePipeline.BindBufferNonblocking(i+1, outputs[i]->m_samples, cmdBuf, true);
+
+	const uint32_t compute_block_count = GetComputeBlockCount(len, 64);
+	m_computePipeline.Dispatch(cmdBuf, args,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
+
+	cmdBuf.end();
+	queue->SubmitAndBlock(cmdBuf);
+
+	for(size_t i=0; i<8; i++)
+		outputs[i]->MarkSamplesModifiedFromGpu();
+}
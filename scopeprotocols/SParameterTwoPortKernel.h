@@ -0,0 +1,87 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of SParameterTwoPortKernel
+ */
+#ifndef SParameterTwoPortKernel_h
+#define SParameterTwoPortKernel_h
+
+/**
+	@brief Push constants for SParameterTwoPort.glsl
+ */
+struct SParameterTwoPortArgs
+{
+	uint32_t npoints;
+	uint32_t mode;
+	uint32_t offsets[8];
+	uint32_t lengths[8];
+};
+
+/**
+	@brief GPU implementation of the two-port network math shared by SParameterCascadeFilter and
+	SParameterDeEmbedFilter
+
+	Takes two networks as eight SParameterVectors in S11, S12, S21, S22 order (network A, or the combined network,
+	first) and writes the resulting network, in dB / degree form, sampled at the frequencies of the first input.
+ */
+class SParameterTwoPortKernel
+{
+public:
+	SParameterTwoPortKernel();
+
+	enum Mode
+	{
+		///@brief A and B are cascaded
+		MODE_CASCADE,
+
+		///@brief A is the combined network, B is the known left half. Solve for the right half
+		MODE_DEEMBED_KNOWN_LEFT,
+
+		///@brief A is the combined network, B is the known right half. Solve for the left half
+		MODE_DEEMBED_KNOWN_RIGHT
+	};
+
+	void Run(
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue,
+		Mode mode,
+		SParameterVector* const* inputs,
+		SparseAnalogWaveform* const* outputs);
+
+protected:
+
+	///@brief All eight input vectors, back to back
+	AcceleratorBuffer<SParameterPoint> m_points;
+
+	ComputePipeline m_computePipeline;
+};
+
+#endif
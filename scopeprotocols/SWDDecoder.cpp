@@ -110,7 +110,7 @@ void SWDDecoder::Refresh()
 	//Sample SWDIO on SWCLK edges
 	SparseDigitalWaveform samples;
 	samples.PrepareForCpuAccess();
-	SampleOnRisingEdgesBase(data, clk, samples);
+	DigitalEdgeList::SampleOnRisingEdges(data, clk, samples);
 
 	//Loop over the data and look for transactions
 	enum
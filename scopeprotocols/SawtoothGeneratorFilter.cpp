@@ -94,6 +94,12 @@ string SawtoothGeneratorFilter::GetProtocolName()
 	return "Sawtooth";
 }
 
+bool SawtoothGeneratorFilter::IsOutputContentHashed()
+{
+	//We regenerate identical samples every refresh unless a parameter changes
+	return true;
+}
+
 void SawtoothGeneratorFilter::OnUnitChanged()
 {
 	Unit unit(static_cast<Unit::UnitType>(m_parameters[m_unitname].GetIntVal()));
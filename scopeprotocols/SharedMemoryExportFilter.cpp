@@ -0,0 +1,340 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of SharedMemoryExportFilter
+ */
+
+#include "../scopehal/scopehal.h"
+#include "SharedMemoryExportFilter.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+SharedMemoryExportFilter::SharedMemoryExportFilter(const string& color)
+	: ExportFilter(color)
+	, m_inputCount("Columns")
+	, m_slotCount("Slots")
+	, m_mapping(nullptr)
+	, m_mappingSize(0)
+{
+	m_parameters[m_fname].m_fileFilterMask = "*.shm";
+	m_parameters[m_fname].m_fileFilterName = "Shared memory files (*.shm)";
+	m_parameters[m_fname].signal_changed().connect(sigc::mem_fun(*this, &SharedMemoryExportFilter::Unmap));
+
+	//Readers want every waveform, not just the ones somebody remembered to export
+	m_parameters[m_mode].SetIntVal(MODE_CONTINUOUS_APPEND);
+
+	m_parameters[m_slotCount] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_slotCount].SetIntVal(4);
+	m_parameters[m_slotCount].signal_changed().connect(sigc::mem_fun(*this, &SharedMemoryExportFilter::Unmap));
+
+	m_parameters[m_inputCount] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_inputCount].signal_changed().connect(
+		sigc::mem_fun(*this, &SharedMemoryExportFilter::OnColumnCountChanged));
+	m_parameters[m_inputCount].SetIntVal(1);
+}
+
+SharedMemoryExportFilter::~SharedMemoryExportFilter()
+{
+	Unmap();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Factory methods
+
+bool SharedMemoryExportFilter::ValidateChannel(size_t i, StreamDescriptor stream)
+{
+	if(stream.m_channel == nullptr)
+		return false;
+
+	//Reject invalid port indexes
+	if(i >= (size_t)m_parameters[m_inputCount].GetIntVal())
+		return false;
+
+	switch(stream.GetType())
+	{
+		case Stream::STREAM_TYPE_ANALOG:
+		case Stream::STREAM_TYPE_DIGITAL:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+string SharedMemoryExportFilter::GetProtocolName()
+{
+	return "Shared Memory Export";
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Region management
+
+/**
+	@brief Creates the region, replacing any existing file of the same name
+
+	@param slotSize	Size of each slot, in bytes
+
+	@return True on success
+ */
+bool SharedMemoryExportFilter::Map(size_t slotSize)
+{
+#ifdef _WIN32
+	(void)slotSize;
+	AddErrorMessage("Unsupported platform", "Shared memory export is not supported on Windows");
+	return false;
+#else
+	Unmap();
+
+	size_t nslots = max(m_parameters[m_slotCount].GetIntVal(), (int64_t)1);
+	size_t slotOffset = Align(sizeof(SharedMemoryExportHeader));
+	size_t size = slotOffset + nslots*slotSize;
+
+	//Unlink rather than truncate, so readers still mapping the old file don't fault
+	auto fname = m_parameters[m_fname].GetFileName();
+	unlink(fname.c_str());
+	int fd = open(fname.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if(fd < 0)
+	{
+		AddErrorMessage("Failed to open file", "Could not create the shared memory file");
+		return false;
+	}
+	if(ftruncate(fd, size) != 0)
+	{
+		AddErrorMessage("Failed to open file", "Could not allocate space for the shared memory file");
+		close(fd);
+		unlink(fname.c_str());
+		return false;
+	}
+	void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(p == MAP_FAILED)
+	{
+		AddErrorMessage("Failed to open file", "Could not map the shared memory file");
+		unlink(fname.c_str());
+		return false;
+	}
+	m_mapping = static_cast<uint8_t*>(p);
+	m_mappingSize = size;
+
+	//The file starts out zeroed, so every slot sequence number is already zero (never written)
+	auto header = new(m_mapping) SharedMemoryExportHeader;
+	header->m_magic = MAGIC;
+	header->m_version = VERSION;
+	header->m_slotCount = nslots;
+	header->m_columnCount = GetInputCount();
+	header->m_slotSize = slotSize;
+	header->m_slotOffset = slotOffset;
+	header->m_closed.store(0, memory_order_relaxed);
+	header->m_published.store(0, memory_order_release);
+	return true;
+#endif
+}
+
+/**
+	@brief Abandons the region, if we have one, telling readers to reopen it
+ */
+void SharedMemoryExportFilter::Unmap()
+{
+#ifndef _WIN32
+	if(!m_mapping)
+		return;
+
+	reinterpret_cast<SharedMemoryExportHeader*>(m_mapping)->m_closed.store(1, memory_order_release);
+	munmap(m_mapping, m_mappingSize);
+	m_mapping = nullptr;
+	m_mappingSize = 0;
+#endif
+}
+
+/**
+	@brief Nothing to clear: old exports are overwritten as the ring wraps around
+
+	This also means the append and overwrite modes behave the same.
+ */
+void SharedMemoryExportFilter::Clear()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Actual decoder logic
+
+void SharedMemoryExportFilter::Export()
+{
+	ClearErrors();
+	if(!VerifyAllInputsOK())
+	{
+		AddErrorMessage("Missing inputs", "One or more input ports are not connected");
+		return;
+	}
+
+	//Lay out the slot: header, column table, then each column's arrays
+	size_t ncols = GetInputCount();
+	vector<SharedMemoryExportColumn> columns(ncols);
+	vector<WaveformBase*> wfms(ncols);
+	size_t size = Align(sizeof(SharedMemoryExportSlot) + ncols*sizeof(SharedMemoryExportColumn));
+	for(size_t i=0; i<ncols; i++)
+	{
+		auto in = GetInput(i);
+		auto data = in.GetData();
+		auto& col = columns[i];
+		memset(&col, 0, sizeof(col));
+		strncpy(col.m_name, in.GetName().c_str(), sizeof(col.m_name) - 1);
+		strncpy(col.m_yunit, in.GetYAxisUnits().ToString().c_str(), sizeof(col.m_yunit) - 1);
+
+		col.m_type = SharedWaveformBuffer::GetType(data);
+		if(col.m_type == SharedWaveformBuffer::TYPE_NONE)
+		{
+			if(data)
+			{
+				AddErrorMessage(
+					"Unsupported input", string("Don't know how to export the waveform type of ") + in.GetName());
+				return;
+			}
+			continue;
+		}
+
+		data->PrepareForCpuAccess();
+		wfms[i] = data;
+
+		col.m_flags = data->m_flags;
+		col.m_length = data->size();
+		col.m_timescale = data->m_timescale;
+		col.m_triggerPhase = data->m_triggerPhase;
+		col.m_startTimestamp = data->m_startTimestamp;
+		col.m_startFemtoseconds = data->m_startFemtoseconds;
+
+		if(dynamic_cast<SparseWaveformBase*>(data))
+		{
+			col.m_offsetsOffset = size;
+			size += Align(col.m_length * sizeof(int64_t));
+			col.m_durationsOffset = size;
+			size += Align(col.m_length * sizeof(int64_t));
+		}
+		col.m_samplesOffset = size;
+		bool analog =
+			(col.m_type == SharedWaveformBuffer::TYPE_UNIFORM_ANALOG) ||
+			(col.m_type == SharedWaveformBuffer::TYPE_SPARSE_ANALOG);
+		size += Align(col.m_length * (analog ? sizeof(float) : sizeof(bool)));
+	}
+
+	//Make a bigger region if this doesn't fit, with headroom so slowly growing waveforms don't do this every time
+	auto header = reinterpret_cast<SharedMemoryExportHeader*>(m_mapping);
+	if(!m_mapping || (size > header->m_slotSize) || (header->m_columnCount != ncols) )
+	{
+		size_t slotSize = (size + size/2 + 4095) & ~static_cast<size_t>(4095);
+		if(!Map(slotSize))
+			return;
+		header = reinterpret_cast<SharedMemoryExportHeader*>(m_mapping);
+	}
+
+	uint64_t number = header->m_published.load(memory_order_relaxed);
+	auto base = m_mapping + header->m_slotOffset + (number % header->m_slotCount) * header->m_slotSize;
+	auto slot = reinterpret_cast<SharedMemoryExportSlot*>(base);
+
+	//Mark the slot as being written before touching anything else in it
+	slot->m_sequence.store(2*number + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	slot->m_number = number;
+	memcpy(base + sizeof(SharedMemoryExportSlot), columns.data(), ncols*sizeof(SharedMemoryExportColumn));
+	for(size_t i=0; i<ncols; i++)
+	{
+		auto& col = columns[i];
+		auto data = wfms[i];
+		if(!data)
+			continue;
+
+		auto swfm = dynamic_cast<SparseWaveformBase*>(data);
+		if(swfm)
+		{
+			memcpy(base + col.m_offsetsOffset, swfm->m_offsets.GetCpuPointer(), col.m_length * sizeof(int64_t));
+			memcpy(base + col.m_durationsOffset, swfm->m_durations.GetCpuPointer(), col.m_length * sizeof(int64_t));
+		}
+
+		const void* samples = nullptr;
+		size_t samplesize = sizeof(float);
+		switch(col.m_type)
+		{
+			case SharedWaveformBuffer::TYPE_UNIFORM_ANALOG:
+				samples = static_cast<UniformAnalogWaveform*>(data)->m_samples.GetCpuPointer();
+				break;
+			case SharedWaveformBuffer::TYPE_SPARSE_ANALOG:
+				samples = static_cast<SparseAnalogWaveform*>(data)->m_samples.GetCpuPointer();
+				break;
+			case SharedWaveformBuffer::TYPE_UNIFORM_DIGITAL:
+				samples = static_cast<UniformDigitalWaveform*>(data)->m_samples.GetCpuPointer();
+				samplesize = sizeof(bool);
+				break;
+			case SharedWaveformBuffer::TYPE_SPARSE_DIGITAL:
+				samples = static_cast<SparseDigitalWaveform*>(data)->m_samples.GetCpuPointer();
+				samplesize = sizeof(bool);
+				break;
+			default:
+				break;
+		}
+		memcpy(base + col.m_samplesOffset, samples, col.m_length * samplesize);
+	}
+
+	//Publish it
+	slot->m_sequence.store(2*number + 2, memory_order_release);
+	header->m_published.store(number + 1, memory_order_release);
+}
+
+void SharedMemoryExportFilter::OnColumnCountChanged()
+{
+	//Readers have to see the new column count from the start of a region
+	Unmap();
+
+	//Add new ports
+	size_t sizeNew = m_parameters[m_inputCount].GetIntVal();
+	size_t sizeOld = m_inputs.size();
+	for(size_t i=sizeOld; i<sizeNew; i++)
+		CreateInput(string("column") + to_string(i+1));
+
+	//Remove extra ports, if any
+	m_inputs.resize(sizeNew);
+	m_signalNames.resize(sizeNew);
+
+	//Inputs changed
+	signal_inputsChanged().emit();
+}
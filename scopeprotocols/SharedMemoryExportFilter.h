@@ -0,0 +1,188 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of SharedMemoryExportFilter
+ */
+#ifndef SharedMemoryExportFilter_h
+#define SharedMemoryExportFilter_h
+
+#include "ExportFilter.h"
+
+#include <atomic>
+
+/**
+	@brief Header at the start of a shared memory export region
+
+	The layout is the interface to external readers, so all fields are fixed size and naturally aligned. The header is
+	followed (at m_slotOffset) by m_slotCount slots of m_slotSize bytes each.
+ */
+struct SharedMemoryExportHeader
+{
+	///@brief Must be SharedMemoryExportFilter::MAGIC
+	uint32_t m_magic;
+
+	///@brief Must be SharedMemoryExportFilter::VERSION
+	uint32_t m_version;
+
+	///@brief Number of slots in the ring
+	uint32_t m_slotCount;
+
+	///@brief Number of columns in every slot
+	uint32_t m_columnCount;
+
+	///@brief Size of each slot, in bytes
+	uint64_t m_slotSize;
+
+	///@brief Offset of the first slot from the start of the region, in bytes
+	uint64_t m_slotOffset;
+
+	///@brief Number of exports published so far. The newest is in slot (m_published - 1) % m_slotCount.
+	alignas(64) std::atomic<uint64_t> m_published;
+
+	/**
+		@brief Set when the region has been abandoned (the file name changed, or waveforms outgrew the slots)
+
+		Readers should unmap it and open the file again.
+	 */
+	std::atomic<uint32_t> m_closed;
+};
+
+/**
+	@brief Header at the start of each slot
+
+	Works as a seqlock: m_sequence is odd while the slot is being written. Export number n is complete once
+	m_sequence is 2n+2, and was not overwritten while a reader used it if m_sequence still reads the same afterwards.
+	The slot header is followed by m_columnCount SharedMemoryExportColumn entries.
+ */
+struct SharedMemoryExportSlot
+{
+	alignas(64) std::atomic<uint64_t> m_sequence;
+
+	///@brief Number of this export, counting from zero
+	uint64_t m_number;
+};
+
+/**
+	@brief Description of one column (input waveform) in a slot
+
+	Offsets of the arrays are relative to the start of the slot and are multiples of 64 bytes, or zero if the array
+	is absent (including for a column whose input had no waveform).
+ */
+struct SharedMemoryExportColumn
+{
+	///@brief Waveform type (SharedWaveformBuffer::WaveformType: 1/2 uniform/sparse analog, 3/4 uniform/sparse digital)
+	uint32_t m_type;
+
+	///@brief Waveform flags (WaveformBase::m_flags)
+	uint32_t m_flags;
+
+	///@brief Number of samples
+	uint64_t m_length;
+
+	int64_t m_timescale;
+	int64_t m_triggerPhase;
+	int64_t m_startTimestamp;
+	int64_t m_startFemtoseconds;
+
+	///@brief Offset of the samples: float32 for analog waveforms, one byte (0 or 1) per sample for digital
+	uint64_t m_samplesOffset;
+
+	///@brief Offset of the int64 sample offsets, for sparse waveforms
+	uint64_t m_offsetsOffset;
+
+	///@brief Offset of the int64 sample durations, for sparse waveforms
+	uint64_t m_durationsOffset;
+
+	///@brief Name of the input, null terminated
+	char m_name[64];
+
+	///@brief Y axis unit, as Unit::ToString(), null terminated
+	char m_yunit[32];
+};
+
+/**
+	@brief Publishes waveforms into a ring of slots in a memory mapped file, for other processes to map directly
+
+	Meant for test automation and external analysis: a Python client can wrap the sample arrays of the newest slot in
+	NumPy arrays (np.frombuffer on an mmap) without copying or parsing anything, at the full trigger rate. Put the
+	file on a tmpfs such as /dev/shm so it never touches a disk.
+
+	Readers never lock anything: they read m_published, look at the newest slot, and check its sequence number before
+	and after using it (see SharedMemoryExportSlot). With the default of four slots a reader has three more exports'
+	time to finish with a slot before it's reused.
+
+	Slots are sized for the largest export so far. When a waveform outgrows them the region is abandoned (m_closed
+	is set) and a bigger one created under the same name, so readers must check m_closed and reopen. The file is
+	always unlinked and recreated, never truncated, so existing readers' mappings stay valid.
+
+	Only analog and digital waveforms can be exported.
+ */
+class SharedMemoryExportFilter : public ExportFilter
+{
+public:
+	SharedMemoryExportFilter(const std::string& color);
+	virtual ~SharedMemoryExportFilter();
+
+	static std::string GetProtocolName();
+
+	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
+
+	PROTOCOL_DECODER_INITPROC(SharedMemoryExportFilter)
+
+	///@brief Magic number identifying the region ("SHWX")
+	static constexpr uint32_t MAGIC = 0x58574853;
+
+	///@brief Layout version
+	static constexpr uint32_t VERSION = 1;
+
+protected:
+	virtual void Export() override;
+	virtual void Clear() override;
+
+	void OnColumnCountChanged();
+
+	bool Map(size_t slotSize);
+	void Unmap();
+
+	static size_t Align(size_t n)
+	{ return (n + 63) & ~static_cast<size_t>(63); }
+
+	std::string m_inputCount;
+	std::string m_slotCount;
+
+	///@brief The region (null if not mapped)
+	uint8_t* m_mapping;
+
+	///@brief Size of the region
+	size_t m_mappingSize;
+};
+
+#endif
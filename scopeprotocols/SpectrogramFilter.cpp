@@ -41,6 +41,7 @@ SpectrogramWaveform::SpectrogramWaveform(size_t width, size_t height, double bin
 	: DensityFunctionWaveform(width, height)
 	, m_binsize(binsize)
 	, m_bottomEdgeFrequency(bottomEdgeFrequency)
+	, m_headColumn(0)
 {
 
 }
@@ -59,6 +60,8 @@ SpectrogramFilter::SpectrogramFilter(const string& color)
 	, m_fftLengthName("FFT length")
 	, m_rangeMinName("Range Min")
 	, m_rangeMaxName("Range Max")
+	, m_modeName("Mode")
+	, m_historyDepthName("History Depth")
 	, m_blackmanHarrisComputePipeline("shaders/BlackmanHarrisWindow.spv", 2, sizeof(WindowFunctionArgs))
 	, m_rectangularComputePipeline("shaders/RectangularWindow.spv", 2, sizeof(WindowFunctionArgs))
 	, m_cosineSumComputePipeline("shaders/CosineSumWindow.spv", 2, sizeof(WindowFunctionArgs))
@@ -74,6 +77,7 @@ SpectrogramFilter::SpectrogramFilter(const string& color)
 	m_offset = -5e8;
 	m_cachedFFTLength = 0;
 	m_cachedFFTNumBlocks = 0;
+	m_pendingCount = 0;
 
 	m_parameters[m_windowName] = FilterParameter(FilterParameter::TYPE_ENUM, Unit(Unit::UNIT_COUNTS));
 	m_parameters[m_windowName].AddEnumValue("Blackman-Harris", FFTFilter::FFTFilter::WINDOW_BLACKMAN_HARRIS);
@@ -100,6 +104,19 @@ SpectrogramFilter::SpectrogramFilter(const string& color)
 
 	m_parameters[m_rangeMinName] = FilterParameter(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_DBM));
 	m_parameters[m_rangeMinName].SetFloatVal(-50);
+
+	m_parameters[m_modeName] = FilterParameter(FilterParameter::TYPE_ENUM, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_modeName].AddEnumValue("Block", MODE_BLOCK);
+	m_parameters[m_modeName].AddEnumValue("Streaming", MODE_STREAMING);
+	m_parameters[m_modeName].SetIntVal(MODE_BLOCK);
+
+	m_parameters[m_historyDepthName] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_historyDepthName].SetIntVal(1024);
+
+	m_streamBuf.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_NEVER);
+	m_streamBuf.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_pendingSamples.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_NEVER);
+	m_pendingSamples.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
 }
 
 SpectrogramFilter::~SpectrogramFilter()
@@ -159,11 +176,11 @@ void SpectrogramFilter::ReallocateBuffers(size_t fftlen, size_t nblocks)
 	size_t nouts = fftlen/2 + 1;
 	if(m_vkPlan)
 	{
-		if(m_vkPlan->size() != fftlen)
+		if( (m_vkPlan->size() != fftlen) || (m_vkPlan->GetNumBatches() != nblocks) )
 			m_vkPlan = nullptr;
 	}
 	if(!m_vkPlan)
-		m_vkPlan = make_unique<VulkanFFTPlan>(fftlen, nouts, VulkanFFTPlan::DIRECTION_FORWARD, nblocks);
+		m_vkPlan = g_fftPlanCache->Acquire(fftlen, nouts, VulkanFFTPlan::DIRECTION_FORWARD, nblocks);
 
 	m_rdinbuf.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_NEVER);
 	m_rdinbuf.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
@@ -171,6 +188,13 @@ void SpectrogramFilter::ReallocateBuffers(size_t fftlen, size_t nblocks)
 	m_rdoutbuf.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
 }
 
+void SpectrogramFilter::ClearSweeps()
+{
+	//Discard streaming history
+	m_pendingCount = 0;
+	SetData(nullptr, 0);
+}
+
 FlowGraphNode::DataLocation SpectrogramFilter::GetInputLocation()
 {
 	return LOC_DONTCARE;
@@ -186,49 +210,85 @@ void SpectrogramFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<Queu
 	}
 	auto din = dynamic_cast<UniformAnalogWaveform*>(GetInputWaveform(0));
 
-	//Figure out how many FFTs to do
-	//For now, consecutive blocks and not a sliding window
+	//Figure out range of the FFTs
 	size_t inlen = din->size();
 	size_t fftlen = m_parameters[m_fftLengthName].GetIntVal();
-	size_t nblocks = floor(inlen * 1.0 / fftlen);
-
-	if( (fftlen != m_cachedFFTLength) || (nblocks != m_cachedFFTNumBlocks) )
-		ReallocateBuffers(fftlen, nblocks);
-
-	//Figure out range of the FFTs
 	double fs_per_sample = din->m_timescale;
 	float scale = 2.0 / fftlen;
 	double sample_ghz = 1e6 / fs_per_sample;
 	double bin_hz = round((sample_ghz * 1e9f) / fftlen);
 	double fmax = bin_hz * fftlen;
-
-	Unit hz(Unit::UNIT_HZ);
-	LogTrace("SpectrogramFilter: %zu input points, %zu %zu-point FFTs\n", inlen, nblocks, fftlen);
-	LogIndenter li;
-	LogTrace("FFT range is DC to %s\n", hz.PrettyPrint(fmax).c_str());
-	LogTrace("%s per bin\n", hz.PrettyPrint(bin_hz).c_str());
-
-	//Create the output
-	//Reuse existing buffer if available and same size
 	size_t nouts = fftlen/2 + 1;
+
+	//Reuse existing output if available and same size
+	bool streaming = (m_parameters[m_modeName].GetIntVal() == MODE_STREAMING);
 	SpectrogramWaveform* cap = dynamic_cast<SpectrogramWaveform*>(GetData(0));
 	if(cap)
 	{
-		if( (cap->GetBinSize() == bin_hz) &&
-			(cap->GetWidth() == nblocks) &&
-			(cap->GetHeight() == nouts) )
+		if( (cap->GetBinSize() != bin_hz) || (cap->GetHeight() != nouts) )
+			cap = nullptr;
+	}
+
+	//In block mode, each input is split into consecutive FFT blocks, one column each.
+	//In streaming mode, the input is appended to whatever was left over from the last waveform, and only the new
+	//blocks are transformed. They're written into a circular history so existing columns never move.
+	size_t width;
+	size_t nblocks;
+	size_t firstBlock = 0;
+	AcceleratorBuffer<float>* src = &din->m_samples;
+	size_t total = inlen;
+	if(streaming)
+	{
+		width = max((int64_t)1, m_parameters[m_historyDepthName].GetIntVal());
+		if( cap && (cap->GetWidth() != width) )
+			cap = nullptr;
+
+		//Old history and leftovers are meaningless if the configuration changed
+		if(!cap || (m_pendingSamples.size() != fftlen) )
 		{
-			//same config, we can reuse it
+			cap = nullptr;
+			m_pendingCount = 0;
+			m_pendingSamples.resize(fftlen);
 		}
 
-		//no, ignore it
-		else
+		total = m_pendingCount + inlen;
+		nblocks = total / fftlen;
+
+		//If there's more new data than history, only transform what's going to be kept
+		if(nblocks > width)
+		{
+			firstBlock = nblocks - width;
+			nblocks = width;
+		}
+
+		if(m_pendingCount)
+		{
+			m_streamBuf.resize(total);
+			src = &m_streamBuf;
+		}
+	}
+	else
+	{
+		nblocks = floor(inlen * 1.0 / fftlen);
+		width = nblocks;
+		if(cap && (cap->GetWidth() != width) )
 			cap = nullptr;
 	}
+
+	Unit hz(Unit::UNIT_HZ);
+	LogTrace("SpectrogramFilter: %zu input points, %zu %zu-point FFTs\n", inlen, nblocks, fftlen);
+	LogIndenter li;
+	LogTrace("FFT range is DC to %s\n", hz.PrettyPrint(fmax).c_str());
+	LogTrace("%s per bin\n", hz.PrettyPrint(bin_hz).c_str());
+
+	if(nblocks && ( (fftlen != m_cachedFFTLength) || (nblocks != m_cachedFFTNumBlocks) ) )
+		ReallocateBuffers(fftlen, nblocks);
+
+	//Create the output
 	if(!cap)
 	{
 		cap = new SpectrogramWaveform(
-			nblocks,
+			width,
 			nouts,
 			bin_hz,
 			0
@@ -236,8 +296,15 @@ void SpectrogramFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<Queu
 	}
 	cap->m_startTimestamp = din->m_startTimestamp;
 	cap->m_startFemtoseconds = din->m_startFemtoseconds;
-	cap->m_triggerPhase = din->m_triggerPhase;
 	cap->m_timescale = fs_per_sample * fftlen;
+	if(streaming)
+	{
+		//Line up the end of the newest column with the end of the data consumed from this waveform
+		int64_t consumedFromInput = (int64_t)((firstBlock + nblocks) * fftlen) - (int64_t)m_pendingCount;
+		cap->m_triggerPhase = din->m_triggerPhase + consumedFromInput * fs_per_sample - width * cap->m_timescale;
+	}
+	else
+		cap->m_triggerPhase = din->m_triggerPhase;
 	cap->PrepareForGpuAccess();
 	SetData(cap, 0);
 
@@ -303,6 +370,100 @@ void SpectrogramFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<Queu
 			break;
 	}
 
+	//Prepare to do all of our compute stuff in one dispatch call to reduce overhead
+	cmdBuf.begin({});
+
+	//Prepend the leftovers from the last waveform to the new data
+	din->m_samples.PrepareForGpuAccess();
+	if(src == &m_streamBuf)
+	{
+		m_pendingSamples.PrepareForGpuAccess();
+		m_streamBuf.PrepareForGpuAccess();
+
+		vk::BufferCopy pendingRegion(0, 0, m_pendingCount * sizeof(float));
+		cmdBuf.copyBuffer(m_pendingSamples.GetBuffer(), m_streamBuf.GetBuffer(), {pendingRegion});
+		if(inlen)
+		{
+			vk::BufferCopy inputRegion(0, m_pendingCount * sizeof(float), inlen * sizeof(float));
+			cmdBuf.copyBuffer(din->m_samples.GetBuffer(), m_streamBuf.GetBuffer(), {inputRegion});
+		}
+
+		cmdBuf.pipelineBarrier(
+			vk::PipelineStageFlagBits::eTransfer,
+			vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+			{},
+			vk::MemoryBarrier(
+				vk::AccessFlagBits::eTransferWrite,
+				vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferRead),
+			{},
+			{});
+		m_streamBuf.MarkModifiedFromGpu();
+	}
+
+	if(nblocks)
+		DoSpectrogram(cmdBuf, *src, firstBlock, nblocks, fftlen, nouts, cap, wpipe, args, scale);
+
+	//Save whatever didn't make up a whole block for next time
+	if(streaming)
+	{
+		size_t consumed = (firstBlock + nblocks) * fftlen;
+		size_t leftover = total - consumed;
+
+		//Leftovers are either all from the new input, or (if the input was shorter than a block) everything
+		if(leftover)
+		{
+			cmdBuf.pipelineBarrier(
+				vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader,
+				vk::PipelineStageFlagBits::eTransfer,
+				{},
+				vk::MemoryBarrier(
+					vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderRead,
+					vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eTransferRead),
+				{},
+				{});
+
+			vk::BufferCopy region(consumed * sizeof(float), 0, leftover * sizeof(float));
+			cmdBuf.copyBuffer(src->GetBuffer(), m_pendingSamples.GetBuffer(), {region});
+			m_pendingSamples.MarkModifiedFromGpu();
+		}
+		m_pendingCount = leftover;
+
+		cap->SetHeadColumn( (cap->GetHeadColumn() + nblocks) % width );
+	}
+
+	//Done, block until the compute operations finish
+	cmdBuf.end();
+	queue->SubmitAndBlock(cmdBuf);
+
+	cap->MarkModifiedFromGpu();
+}
+
+/**
+	@brief Windows and transforms a run of FFT blocks and writes them into the output columns
+
+	@param cmdBuf		Command buffer to record into
+	@param src			Time domain input
+	@param firstBlock	Index of the first block within src to transform
+	@param nblocks		Number of blocks to transform
+	@param fftlen		FFT length
+	@param nouts		Number of frequency bins per block
+	@param cap			Output waveform. Blocks are written starting at its head column
+	@param wpipe		Window function pipeline
+	@param args			Window function arguments
+	@param scale		Amplitude scale factor including window gain
+ */
+void SpectrogramFilter::DoSpectrogram(
+	vk::raii::CommandBuffer& cmdBuf,
+	AcceleratorBuffer<float>& src,
+	size_t firstBlock,
+	size_t nblocks,
+	size_t fftlen,
+	size_t nouts,
+	SpectrogramWaveform* cap,
+	ComputePipeline* wpipe,
+	WindowFunctionArgs& args,
+	float scale)
+{
 	//Make sure our temporary buffers are big enough
 	m_rdinbuf.resize(nblocks * fftlen);
 	m_rdoutbuf.resize(nblocks * (nouts * 2) );
@@ -312,15 +473,12 @@ void SpectrogramFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<Queu
 	float fullscale = m_parameters[m_rangeMaxName].GetFloatVal();
 	float range = fullscale - minscale;
 
-	//Prepare to do all of our compute stuff in one dispatch call to reduce overhead
-	cmdBuf.begin({});
-
 	//Grab the input and apply the window function
-	wpipe->BindBufferNonblocking(0, din->m_samples, cmdBuf);
+	wpipe->BindBufferNonblocking(0, src, cmdBuf);
 	wpipe->BindBufferNonblocking(1, m_rdinbuf, cmdBuf, true);
 	for(size_t block=0; block<nblocks; block++)
 	{
-		args.offsetIn = block*fftlen;
+		args.offsetIn = (firstBlock + block)*fftlen;
 		args.offsetOut = block*fftlen;
 
 		if(block == 0)
@@ -346,6 +504,8 @@ void SpectrogramFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<Queu
 	postargs.minscale = minscale;
 	postargs.irange = 1.0 / range;
 	postargs.ygrid = min(g_maxComputeGroupCount[2], nblocks);
+	postargs.width = cap->GetWidth();
+	postargs.colOffset = cap->GetHeadColumn();
 	m_postprocessComputePipeline.AddComputeMemoryBarrier(cmdBuf);
 	m_postprocessComputePipeline.BindBufferNonblocking(0, m_rdoutbuf, cmdBuf);
 	m_postprocessComputePipeline.BindBufferNonblocking(1, cap->GetOutData(), cmdBuf, true);
@@ -356,10 +516,5 @@ void SpectrogramFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<Queu
 		ceil(nblocks * 1.0 / postargs.ygrid),
 		postargs.ygrid
 		);
-
-	//Done, block until the compute operations finish
-	cmdBuf.end();
-	queue->SubmitAndBlock(cmdBuf);
-
-	cap->MarkModifiedFromGpu();
+	m_postprocessComputePipeline.AddComputeMemoryBarrier(cmdBuf);
 }
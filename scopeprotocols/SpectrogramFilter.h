@@ -36,7 +36,7 @@
 #ifndef SpectrogramFilter_h
 #define SpectrogramFilter_h
 
-#include "VulkanFFTPlan.h"
+#include "VulkanFFTPlanCache.h"
 
 #include "../scopehal/DensityFunctionWaveform.h"
 
@@ -53,6 +53,12 @@ struct SpectrogramPostprocessArgs
 	float impscale;
 	float minscale;
 	float irange;
+
+	///@brief Width of the output bitmap, in columns
+	uint32_t width;
+
+	///@brief Column to write the first block to (wraps around at width)
+	uint32_t colOffset;
 };
 
 /**
@@ -75,6 +81,19 @@ public:
 	double GetBottomEdgeFrequency()
 	{ return m_bottomEdgeFrequency; }
 
+	/**
+		@brief Gets the physical column holding the oldest data
+
+		Streaming spectrograms are circular buffers: logical column i is stored in physical column
+		(i + GetHeadColumn()) % GetWidth(). Always zero for normal block mode spectrograms.
+	 */
+	size_t GetHeadColumn()
+	{ return m_headColumn; }
+
+	///@brief Sets the physical column holding the oldest data
+	void SetHeadColumn(size_t col)
+	{ m_headColumn = col; }
+
 	virtual void FreeGpuMemory() override
 	{}
 
@@ -84,6 +103,9 @@ public:
 protected:
 	double m_binsize;
 	double m_bottomEdgeFrequency;
+
+	///@brief Physical column holding the oldest data
+	size_t m_headColumn;
 };
 
 /**
@@ -107,12 +129,34 @@ public:
 
 	virtual void SetVoltageRange(float range, size_t stream) override;
 	virtual void SetOffset(float offset, size_t stream) override;
+	virtual void ClearSweeps() override;
 
 	PROTOCOL_DECODER_INITPROC(SpectrogramFilter)
 
+	enum Mode
+	{
+		///@brief Each input waveform is transformed into a complete spectrogram
+		MODE_BLOCK,
+
+		///@brief Each input waveform appends columns to a circular history
+		MODE_STREAMING
+	};
+
 protected:
 	virtual void ReallocateBuffers(size_t fftlen, size_t nblocks);
 
+	void DoSpectrogram(
+		vk::raii::CommandBuffer& cmdBuf,
+		AcceleratorBuffer<float>& src,
+		size_t firstBlock,
+		size_t nblocks,
+		size_t fftlen,
+		size_t nouts,
+		SpectrogramWaveform* cap,
+		ComputePipeline* wpipe,
+		WindowFunctionArgs& args,
+		float scale);
+
 	AcceleratorBuffer<float> m_rdinbuf;
 	AcceleratorBuffer<float> m_rdoutbuf;
 
@@ -126,8 +170,19 @@ protected:
 	std::string m_fftLengthName;
 	std::string m_rangeMinName;
 	std::string m_rangeMaxName;
+	std::string m_modeName;
+	std::string m_historyDepthName;
+
+	///@brief Leftover input from the previous waveform, followed by the new input (streaming mode only)
+	AcceleratorBuffer<float> m_streamBuf;
+
+	///@brief Samples from the end of the last waveform that didn't fill a whole FFT block (streaming mode only)
+	AcceleratorBuffer<float> m_pendingSamples;
+
+	///@brief Number of valid samples in m_pendingSamples
+	size_t m_pendingCount;
 
-	std::unique_ptr<VulkanFFTPlan> m_vkPlan;
+	VulkanFFTPlanHandle m_vkPlan;
 
 	ComputePipeline m_blackmanHarrisComputePipeline;
 	ComputePipeline m_rectangularComputePipeline;
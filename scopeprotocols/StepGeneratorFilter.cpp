@@ -78,6 +78,12 @@ string StepGeneratorFilter::GetProtocolName()
 	return "Step";
 }
 
+bool StepGeneratorFilter::IsOutputContentHashed()
+{
+	//We regenerate identical samples every refresh unless a parameter changes
+	return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
@@ -44,6 +44,8 @@ public:
 
 	static std::string GetProtocolName();
 
+	virtual bool IsOutputContentHashed() override;
+
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
 	PROTOCOL_DECODER_INITPROC(StepGeneratorFilter)
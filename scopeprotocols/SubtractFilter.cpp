@@ -82,6 +82,8 @@ void SubtractFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHa
 		nvtx3::scoped_range range("SubtractFilter::Refresh");
 	#endif
 
+	ExpandRawInputs();
+
 	//Set units as early as possible so we can spawn in the same plot as our parent signal when creating a filter
 	if(GetInput(0))
 	{
@@ -125,10 +127,10 @@ void SubtractFilter::DoRefreshVectorVector(vk::raii::CommandBuffer& cmdBuf, std:
 	//Get inputs
 	auto din_p = GetInputWaveform(0);
 	auto din_n = GetInputWaveform(1);
-	auto sdin_p = dynamic_cast<SparseAnalogWaveform*>(din_p);
-	auto sdin_n = dynamic_cast<SparseAnalogWaveform*>(din_n);
-	auto udin_p = dynamic_cast<UniformAnalogWaveform*>(din_p);
-	auto udin_n = dynamic_cast<UniformAnalogWaveform*>(din_n);
+	auto sdin_p = WaveformCast<SparseAnalogWaveform>(din_p);
+	auto sdin_n = WaveformCast<SparseAnalogWaveform>(din_n);
+	auto udin_p = WaveformCast<UniformAnalogWaveform>(din_p);
+	auto udin_n = WaveformCast<UniformAnalogWaveform>(din_n);
 
 	//Set up units and complain if they're inconsistent
 	if( (m_xAxisUnit != m_inputs[1].m_channel->GetXAxisUnits()) ||
@@ -138,6 +140,22 @@ void SubtractFilter::DoRefreshVectorVector(vk::raii::CommandBuffer& cmdBuf, std:
 		return;
 	}
 
+	//Mixed sparse/uniform inputs are lined up by timestamp on the CPU, so trigger phase is taken care of there
+	if( !(sdin_p && sdin_n) && !(udin_p && udin_n) )
+	{
+		bool degrees = (GetYAxisUnits(0) == Unit::UNIT_DEGREES);
+		bool ok = VisitWaveforms<float, float>(din_p, din_n, [&](auto p, auto n)
+			{
+				if(degrees)
+					ApplyPointwise(p, n, 0, [](float vp, float vn) { return WrapDegrees(vp - vn); });
+				else
+					ApplyPointwise(p, n, 0, [](float vp, float vn) { return vp - vn; });
+			});
+		if(!ok)
+			SetData(nullptr, 0);
+		return;
+	}
+
 	//Waveforms must be equal sample *rate* to make things work as expected.
 	//But if they don't have the same trigger phase, we can easily correct for that..
 	Unit fs(Unit::UNIT_FS);
@@ -168,18 +186,10 @@ void SubtractFilter::DoRefreshVectorVector(vk::raii::CommandBuffer& cmdBuf, std:
 		scap = SetupSparseOutputWaveform(sdin_p, 0, 0, 0);
 		scap->m_triggerPhase = max(din_p->m_triggerPhase, din_n->m_triggerPhase);
 	}
-	else if(udin_p && udin_n)
-	{
-		ucap = SetupEmptyUniformAnalogOutputWaveform(udin_p, 0);
-		ucap->m_triggerPhase = max(din_p->m_triggerPhase, din_n->m_triggerPhase);
-		ucap->Resize(len);
-	}
-
-	//Mixed sparse/uniform not allowed
 	else
 	{
-		SetData(NULL, 0);
-		return;
+		ucap = SetupAnalogOutputWaveformLike(udin_p, 0, len);
+		ucap->m_triggerPhase = max(din_p->m_triggerPhase, din_n->m_triggerPhase);
 	}
 
 	//Special case if input units are degrees: we want to do modular arithmetic
@@ -199,13 +209,7 @@ void SubtractFilter::DoRefreshVectorVector(vk::raii::CommandBuffer& cmdBuf, std:
 		float* b = sdin_n ? sdin_n->m_samples.GetCpuPointer() : udin_n->m_samples.GetCpuPointer();
 
 		for(size_t i=0; i<len; i++)
-		{
-			out[i] 		= a[i + offsetP] - b[i + offsetN];
-			if(out[i] < -180)
-				out[i] += 360;
-			if(out[i] > 180)
-				out[i] -= 360;
-		}
+			out[i] = WrapDegrees(a[i + offsetP] - b[i + offsetN]);
 
 		if(scap)
 			scap->m_samples.MarkModifiedFromCpu();
@@ -252,57 +256,70 @@ void SubtractFilter::DoRefreshScalarVector(size_t iScalar, size_t iVector)
 		SetData(nullptr, 0);
 		return;
 	}
-	din->PrepareForCpuAccess();
-	auto len = din->size();
-
-	auto sparse = dynamic_cast<SparseAnalogWaveform*>(din);
-	auto uniform = dynamic_cast<UniformAnalogWaveform*>(din);
 
-	if(sparse)
-	{
-		//Set up the output waveform
-		auto cap = SetupSparseOutputWaveform(sparse, 0, 0, 0);
-		cap->Resize(len);
-		cap->PrepareForCpuAccess();
-
-		//subtract is slightly more complex than adding because we have to keep the order right
-		float* fin = (float*)__builtin_assume_aligned(sparse->m_samples.GetCpuPointer(), 16);
-		float* fdst = (float*)__builtin_assume_aligned(cap->m_samples.GetCpuPointer(), 16);
-		if(iScalar == 1)
-		{
-			for(size_t i=0; i<len; i++)
-				fdst[i] = fin[i] - scale;
-		}
-		else
+	//Subtraction isn't commutative, so keep the order right
+	VisitWaveform<float>(din, [&](auto w)
 		{
-			for(size_t i=0; i<len; i++)
-				fdst[i] = scale - fin[i];
-		}
+			if(iScalar == 1)
+				ApplyPointwise(w, 0, [scale](float v) { return v - scale; });
+			else
+				ApplyPointwise(w, 0, [scale](float v) { return scale - v; });
+		});
+}
 
-		cap->MarkModifiedFromCpu();
+bool SubtractFilter::SetupElementwiseOp(ElementwiseOp& op)
+{
+	//Only plain subtraction of two uniform waveforms can be fused, DoRefreshVectorVector() deals with everything else
+	if( (GetInput(0).GetType() != Stream::STREAM_TYPE_ANALOG) || (GetInput(1).GetType() != Stream::STREAM_TYPE_ANALOG) )
+		return false;
+	if(!VerifyAllInputsOK())
+		return false;
+	auto din_p = WaveformCast<UniformAnalogWaveform>(GetInputWaveform(0));
+	auto din_n = WaveformCast<UniformAnalogWaveform>(GetInputWaveform(1));
+	if(!din_p || !din_n)
+		return false;
+
+	auto xunit = m_inputs[0].m_channel->GetXAxisUnits();
+	auto yunit = m_inputs[0].GetYAxisUnits();
+	if( (xunit != m_inputs[1].m_channel->GetXAxisUnits()) || (yunit != m_inputs[1].GetYAxisUnits()) ||
+		(yunit == Unit::UNIT_DEGREES) )
+	{
+		return false;
 	}
+
+	//Same trigger phase correction as DoRefreshVectorVector()
+	int64_t skew = llabs(din_p->m_triggerPhase - din_n->m_triggerPhase);
+	size_t offsetP = 0;
+	size_t offsetN = 0;
+	if(din_p->m_triggerPhase > din_n->m_triggerPhase)
+		offsetN = skew / din_n->m_timescale;
 	else
-	{
-		//Set up the output waveform
-		auto cap = SetupEmptyUniformAnalogOutputWaveform(uniform, 0);
-		cap->Resize(len);
-		cap->PrepareForCpuAccess();
-
-		float* fin = (float*)__builtin_assume_aligned(uniform->m_samples.GetCpuPointer(), 16);
-		float* fdst = (float*)__builtin_assume_aligned(cap->m_samples.GetCpuPointer(), 16);
-		if(iScalar == 1)
-		{
-			for(size_t i=0; i<len; i++)
-				fdst[i] = fin[i] - scale;
-		}
-		else
-		{
-			for(size_t i=0; i<len; i++)
-				fdst[i] = scale - fin[i];
-		}
+		offsetP = skew / din_p->m_timescale;
+	if( (offsetP > din_p->size()) || (offsetN > din_n->size()) )
+		return false;
+	size_t len = min( (din_p->size() - offsetP), (din_n->size() - offsetN) );
 
-		cap->MarkModifiedFromCpu();
-	}
+	m_xAxisUnit = xunit;
+	SetYAxisUnits(yunit, 0);
+
+	auto cap = SetupEmptyUniformAnalogOutputWaveform(din_p, 0);
+	cap->m_triggerPhase = max(din_p->m_triggerPhase, din_n->m_triggerPhase);
+	cap->Resize(len);
+
+	op.m_type = ElementwiseOp::OP_SUBTRACT;
+	op.m_inputs[0] = din_p;
+	op.m_inputs[1] = din_n;
+	op.m_offsets[0] = offsetP;
+	op.m_offsets[1] = offsetN;
+	op.m_output = cap;
+	op.m_len = len;
+	return true;
+}
+
+bool SubtractFilter::AcceptsRawSamples(size_t /*i*/)
+{
+	//The fused elementwise kernel reads raw ADC codes in place; Refresh() converts them if we don't get fused
+	return true;
 }
 
 Filter::DataLocation SubtractFilter::GetInputLocation()
@@ -30,6 +30,7 @@
 #include "../scopehal/scopehal.h"
 #include "TCPDecoder.h"
 #include "EthernetProtocolDecoder.h"
+#include "EthernetFlowTable.h"
 
 using namespace std;
 
@@ -81,7 +82,6 @@ void TCPDecoder::Refresh()
 	//Get the input data (TODO: support IPv6 too)
 	auto din = dynamic_cast<IPv4Waveform*>(GetInputWaveform(0));
 	din->PrepareForCpuAccess();
-	size_t len = din->m_samples.size();
 
 	//Loop over the events and process stuff
 	auto cap = new TCPWaveform;
@@ -92,303 +92,57 @@ void TCPDecoder::Refresh()
 	cap->PrepareForCpuAccess();
 	SetData(cap, 0);
 
-	int state = 0;
-	int option_len = 0;
-	for(size_t i=0; i<len; i++)
+	//Headers were already parsed when the flow table was built, so just lay out the symbols
+	auto flows = din->m_flows;
+	if(!flows)
 	{
-		auto s = din->m_samples[i];
-		size_t caplen = cap->m_samples.size();
-		int64_t off = din->m_offsets[i];
-		int64_t dur = din->m_durations[i];
-		int64_t end = off + dur;
-		int64_t halfdur = dur/2;
-
-		uint8_t bin = 0;
-		if(din->m_samples[i].m_data.size())
-			bin = din->m_samples[i].m_data[0];
-
-		switch(state)
+		cap->MarkModifiedFromCpu();
+		return;
+	}
+	for(auto& dgram : din->m_datagrams)
+	{
+		auto& f = flows->m_frames[dgram.m_frame];
+		if(!f.m_tcp)
+			continue;
+		auto& tcp = f.m_l4;
+		const uint8_t* p = flows->GetFrameBytes(dgram.m_frame) + f.m_l4Start - tcp.m_dataOffset*4;
+		size_t base = dgram.m_dataSymbol;
+
+		//Adds a symbol spanning TCP bytes [first, first+n)
+		auto add = [&](size_t first, size_t n, TCPSymbol::SegmentType type, const vector<uint8_t>& data)
 		{
-			//Wait for IP header version. Ignore any errors, preambles, etc before this
-			case 0:
-				break;
-
-			//If we see a protocol other than TCP, discard and go back to beginning
-			//TODO: add filtering to only show streams from/to specific hosts?
-			case 1:
-				if(s.m_type == IPv4Symbol::TYPE_PROTOCOL)
-				{
-					if(bin != 0x06)
-						state = 0;
-					else
-						state = 2;
-				}
-				break;
-
-			//Ignore all headers until we get to the start of the data field
-			case 2:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					state = 3;
-
-					cap->m_offsets.push_back(off);
-					cap->m_durations.push_back(0);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_SOURCE_PORT, bin));
-				}
-				break;
-
-			//Read second half of source port
-			case 3:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_samples[caplen-1].m_data.push_back(bin);
-					cap->m_durations[caplen-1] = end - cap->m_offsets[caplen-1];
-					state = 4;
-				}
-				else
-					state = 0;
-				break;
-
-			//First half of dest port
-			case 4:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					state = 5;
-
-					cap->m_offsets.push_back(off);
-					cap->m_durations.push_back(0);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_DEST_PORT, bin));
-				}
-				else
-					state = 0;
-				break;
-
-			//Second half of dest port
-			case 5:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_samples[caplen-1].m_data.push_back(bin);
-					cap->m_durations[caplen-1] = end - cap->m_offsets[caplen-1];
-					state = 6;
-				}
-				else
-					state = 0;
-				break;
-
-			//First byte of sequence number
-			case 6:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					state = 7;
-
-					cap->m_offsets.push_back(off);
-					cap->m_durations.push_back(0);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_SEQ, bin));
-				}
-				else
-					state = 0;
-				break;
-
-			//Remainder of sequence number
-			case 7:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_samples[caplen-1].m_data.push_back(bin);
-
-					if(cap->m_samples[caplen-1].m_data.size() == 4)
-					{
-						cap->m_durations[caplen-1] = end - cap->m_offsets[caplen-1];
-						state = 8;
-					}
-				}
-				else
-					state = 0;
-				break;
-
-			//First byte of ACK number
-			case 8:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					state = 9;
-
-					cap->m_offsets.push_back(off);
-					cap->m_durations.push_back(0);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_ACK, bin));
-				}
-				else
-					state = 0;
-				break;
-
-			//Remainder of sequence number
-			case 9:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_samples[caplen-1].m_data.push_back(bin);
-
-					if(cap->m_samples[caplen-1].m_data.size() == 4)
-					{
-						cap->m_durations[caplen-1] = end - cap->m_offsets[caplen-1];
-						state = 10;
-					}
-				}
-				else
-					state = 0;
-				break;
-
-			//Data offset
-			case 10:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					state = 11;
-
-					cap->m_offsets.push_back(off);
-					cap->m_durations.push_back(halfdur);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_DATA_OFFSET, bin >> 4));
-
-					option_len = ( (bin >> 4) * 4) - 20;
-
-					//Also push the NS bit of the flags
-					cap->m_offsets.push_back(off + halfdur);
-					cap->m_durations.push_back(0);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_FLAGS, bin & 0xf));
-				}
-				else
-					state = 0;
-				break;
-
-			//Rest of flags
-			case 11:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_samples[caplen-1].m_data.push_back(bin);
-					cap->m_durations[caplen-1] = end - cap->m_offsets[caplen-1];
-					state = 12;
-				}
-				else
-					state = 0;
-				break;
-
-			//First half of window size
-			case 12:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					state = 13;
-
-					cap->m_offsets.push_back(off);
-					cap->m_durations.push_back(0);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_WINDOW, bin));
-				}
-				else
-					state = 0;
-				break;
-
-			//Second half of window size
-			case 13:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_samples[caplen-1].m_data.push_back(bin);
-					cap->m_durations[caplen-1] = end - cap->m_offsets[caplen-1];
-					state = 14;
-				}
-				else
-					state = 0;
-				break;
-
-			//First half of checksum
-			case 14:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					state = 15;
-
-					cap->m_offsets.push_back(off);
-					cap->m_durations.push_back(0);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_CHECKSUM, bin));
-				}
-				else
-					state = 0;
-				break;
-
-			//Second half of checksum
-			case 15:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_samples[caplen-1].m_data.push_back(bin);
-					cap->m_durations[caplen-1] = end - cap->m_offsets[caplen-1];
-					state = 16;
-				}
-				else
-					state = 0;
-				break;
-
-			//First half of urgent pointer
-			case 16:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					state = 17;
-
-					cap->m_offsets.push_back(off);
-					cap->m_durations.push_back(0);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_URGENT, bin));
-				}
-				else
-					state = 0;
-				break;
-
-			//Second half of urgent pointer
-			case 17:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_samples[caplen-1].m_data.push_back(bin);
-					cap->m_durations[caplen-1] = end - cap->m_offsets[caplen-1];
-					state = 18;
-				}
-				else
-					state = 0;
-				break;
-
-			//First byte of options or data
-			case 18:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					//No more options left? It's our first data byte
-					if(option_len == 0)
-					{
-						cap->m_offsets.push_back(din->m_offsets[i]);
-						cap->m_durations.push_back(din->m_durations[i]);
-						cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_DATA, bin));
-
-						state = 19;
-					}
-
-					//Nope, it's an option byte
-					else
-					{
-						cap->m_offsets.push_back(din->m_offsets[i]);
-						cap->m_durations.push_back(din->m_durations[i]);
-						cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_OPTIONS, bin));
-
-						option_len --;
-					}
-				}
-				else
-					state = 0;
-				break;
-
-			case 19:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_DATA, bin));
-				}
-				else
-					state = 0;
-				break;
-		}
-
-		//Reset when we see a new IP header starting
-		if(s.m_type == IPv4Symbol::TYPE_VERSION)
-			state = 1;
+			size_t last = base + first + n - 1;
+			cap->m_offsets.push_back(din->m_offsets[base + first]);
+			cap->m_durations.push_back(din->m_offsets[last] + din->m_durations[last] - din->m_offsets[base + first]);
+			cap->m_samples.push_back(TCPSymbol(type, 0));
+			cap->m_samples[cap->m_samples.size() - 1].m_data = data;
+		};
+
+		add(0, 2, TCPSymbol::TYPE_SOURCE_PORT, {p[0], p[1]});
+		add(2, 2, TCPSymbol::TYPE_DEST_PORT, {p[2], p[3]});
+		add(4, 4, TCPSymbol::TYPE_SEQ, {p[4], p[5], p[6], p[7]});
+		add(8, 4, TCPSymbol::TYPE_ACK, {p[8], p[9], p[10], p[11]});
+
+		//Data offset shares a byte with the NS flag
+		int64_t off = din->m_offsets[base + 12];
+		int64_t halfdur = din->m_durations[base + 12] / 2;
+		cap->m_offsets.push_back(off);
+		cap->m_durations.push_back(halfdur);
+		cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_DATA_OFFSET, tcp.m_dataOffset));
+		cap->m_offsets.push_back(off + halfdur);
+		cap->m_durations.push_back(din->m_offsets[base + 13] + din->m_durations[base + 13] - (off + halfdur));
+		cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_FLAGS, 0));
+		cap->m_samples[cap->m_samples.size() - 1].m_data = {static_cast<uint8_t>(p[12] & 0xf), p[13]};
+
+		add(14, 2, TCPSymbol::TYPE_WINDOW, {p[14], p[15]});
+		add(16, 2, TCPSymbol::TYPE_CHECKSUM, {p[16], p[17]});
+		add(18, 2, TCPSymbol::TYPE_URGENT, {p[18], p[19]});
+
+		size_t hlen = tcp.m_dataOffset * 4;
+		for(size_t i=20; i<hlen; i++)
+			add(i, 1, TCPSymbol::TYPE_OPTIONS, {p[i]});
+		for(size_t i=0; i<f.m_l4Len; i++)
+			add(hlen + i, 1, TCPSymbol::TYPE_DATA, {p[hlen + i]});
 	}
 
 	//TODO: packet decode too
@@ -37,6 +37,7 @@ using namespace std;
 
 TDRFilter::TDRFilter(const string& color)
 	: Filter(color, CAT_ANALYSIS)
+	, m_computePipeline("shaders/TDRFilter.spv", 2, sizeof(TDRFilterConstants))
 {
 	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_ANALOG);
 	CreateInput("voltage");
@@ -99,7 +100,19 @@ void TDRFilter::SetDefaultName()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
-void TDRFilter::Refresh()
+Filter::DataLocation TDRFilter::GetInputLocation()
+{
+	//We explicitly manage our input memory and don't care where it is when Refresh() is called
+	return LOC_DONTCARE;
+}
+
+bool TDRFilter::ConsumesInputsOnGpu()
+{
+	//Input samples are only ever read by our shader
+	return true;
+}
+
+void TDRFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
 	//Make sure we've got valid inputs
 	if(!VerifyAllInputsOKAndUniformAnalog())
@@ -127,21 +140,28 @@ void TDRFilter::Refresh()
 	//Set up the output waveform
 	auto cap = SetupEmptyUniformAnalogOutputWaveform(din, 0);
 	cap->Resize(len);
-	cap->PrepareForCpuAccess();
 
-	float pulseScale = 1.0 / pulseAmplitude;
-	for(size_t i=0; i<len; i++)
-	{
-		//Reflection coefficient is trivial
-		float rho = (din->m_samples[i] - vhi) * pulseScale;
+	//Convert to reflection coefficient or impedance on the GPU, so a VNA/TDR chain never leaves the device
+	TDRFilterConstants cfg;
+	cfg.len = len;
+	cfg.impedance = (mode == MODE_IMPEDANCE);
+	cfg.z0 = z0;
+	cfg.vhi = vhi;
+	cfg.pulseScale = 1.0 / pulseAmplitude;
 
-		//Impedance takes a bit more work to calculate
-		if(mode == MODE_IMPEDANCE)
-			cap->m_samples[i] = z0 * (1 + rho)/(1 - rho);
+	cmdBuf.begin({});
 
-		else
-			cap->m_samples[i] = rho;
-	}
+	m_computePipeline.BindBufferNonblocking(0, din->m_samples, cmdBuf);
+	m_computePipeline.BindBufferNonblocking(1, cap->m_samples, cmdBuf, true);
+
+	const uint32_t compute_block_count = GetComputeBlockCount(len, 64);
+	m_computePipeline.Dispatch(cmdBuf, cfg,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
+
+	cmdBuf.end();
+	queue->SubmitDeferred(cmdBuf);
+	cap->MarkModifiedFromGpu();
 
 	//Reset gain/offset if output mode was changed
 	if(mode != m_oldMode)
@@ -149,6 +169,4 @@ void TDRFilter::Refresh()
 		AutoscaleVertical(0);
 		m_oldMode = mode;
 	}
-
-	cap->MarkModifiedFromCpu();
 }
@@ -35,12 +35,24 @@
 #ifndef TDRFilter_h
 #define TDRFilter_h
 
+class TDRFilterConstants
+{
+public:
+	uint32_t	len;
+	uint32_t	impedance;
+	float		z0;
+	float		vhi;
+	float		pulseScale;
+};
+
 class TDRFilter : public Filter
 {
 public:
 	TDRFilter(const std::string& color);
 
-	virtual void Refresh() override;
+	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
+	virtual DataLocation GetInputLocation() override;
+	virtual bool ConsumesInputsOnGpu() override;
 
 	static std::string GetProtocolName();
 	virtual void SetDefaultName() override;
@@ -62,6 +74,8 @@ protected:
 	std::string m_portImpedanceName;
 	std::string m_stepStartVoltageName;
 	std::string m_stepEndVoltageName;
+
+	ComputePipeline m_computePipeline;
 };
 
 #endif
@@ -41,7 +41,6 @@ TIEMeasurement::TIEMeasurement(const string& color)
 	, m_threshold(m_parameters["Threshold"])
 	, m_skipStart(m_parameters["Skip Start"])
 	, m_firstPassOutput("TIEMeasurement.firstPassOutput")
-	, m_secondPassOutput("TIEMeasurement.secondPassOutput")
 {
 	AddStream(Unit(Unit::UNIT_FS), "data", Stream::STREAM_TYPE_ANALOG);
 
@@ -65,7 +64,6 @@ TIEMeasurement::TIEMeasurement(const string& color)
 			make_shared<ComputePipeline>("shaders/TIEMeasurement_SecondPass.spv", 5, sizeof(TIEConstants));
 
 		m_firstPassOutput.SetGpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
-		m_secondPassOutput.resize(1);
 	}
 }
 
@@ -136,25 +134,26 @@ void TIEMeasurement::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHa
 	//it's already been edge detected. Use those edges instead!
 	float threshold = m_threshold.GetFloatVal();
 	auto pcdr = dynamic_cast<ClockRecoveryFilter*>(GetInput(1).m_channel);
-	if(pcdr && (fabs(pcdr->GetThreshold() - threshold) < 0.01) && (pcdr->GetInput(0) == GetInput(0)) && uaclk)
-		m_clockEdgesMuxed = &pcdr->GetZeroCrossings();
-
-	//Normal fast path: GPU edge detection on uniform input
-	else if(uaclk)
+	m_clockCrossings = nullptr;
+	if(	pcdr && (fabs(pcdr->GetThreshold() - threshold) < 0.01) && (pcdr->GetInput(0) == GetInput(0)) &&
+		(uaclk || saclk) )
 	{
-		m_detector.FindZeroCrossings(uaclk, threshold, cmdBuf, queue);
-		m_clockEdgesMuxed = &m_detector.GetResults();
+		m_clockCrossings = pcdr->GetZeroCrossings();
 	}
 
+	//Normal fast path: shared (GPU accelerated if large) edge detection on analog input
+	if(!m_clockCrossings && (uaclk || saclk))
+		m_clockCrossings = LevelCrossingList::Get(clk, threshold);
+
+	if(m_clockCrossings)
+		m_clockEdgesMuxed = &m_clockCrossings->m_crossings;
+
 	//Slow path: look for edges on the CPU
 	else
 	{
 		clk->PrepareForCpuAccess();
 		vector<int64_t> clock_edges;
-		if(sdclk || udclk)
-			FindZeroCrossings(sdclk, udclk, clock_edges);
-		else
-			FindZeroCrossings(saclk, uaclk, threshold, clock_edges);
+		FindZeroCrossings(sdclk, udclk, clock_edges);
 		m_clockEdges.CopyFrom(clock_edges);
 		m_clockEdgesMuxed = &m_clockEdges;
 	}
@@ -199,22 +198,21 @@ void TIEMeasurement::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHa
 		m_firstPassOutput.MarkModifiedFromGpu();
 
 		//Second pass: merge the outputs of the first pass and calculate durations
+		auto length = DeviceLength::Acquire(m_outputLengths, "TIEMeasurement.outputLength");
 		m_secondPassComputePipeline->BindBufferNonblocking(0, m_firstPassOutput, cmdBuf);
 		m_secondPassComputePipeline->BindBufferNonblocking(1, cap->m_offsets, cmdBuf);
 		m_secondPassComputePipeline->BindBufferNonblocking(2, cap->m_durations, cmdBuf);
 		m_secondPassComputePipeline->BindBufferNonblocking(3, cap->m_samples, cmdBuf);
-		m_secondPassComputePipeline->BindBufferNonblocking(4, m_secondPassOutput, cmdBuf);
+		m_secondPassComputePipeline->BindBufferNonblocking(4, length->GetBuffer(), cmdBuf);
 		m_secondPassComputePipeline->Dispatch(cmdBuf, cfg, numBlocks);
-		m_secondPassOutput.MarkModifiedFromGpu();
 		cap->MarkModifiedFromGpu();
 
-		m_secondPassOutput.PrepareForCpuAccessNonblocking(cmdBuf);
-
 		cmdBuf.end();
-		queue->SubmitAndBlock(cmdBuf);
+		queue->SubmitDeferred(cmdBuf);
 
-		//Update final sample count
-		cap->Resize(m_secondPassOutput[0]);
+		//The final sample count stays on the GPU until something looks at the waveform from the CPU
+		length->MarkWritten();
+		cap->SetDeviceLength(length);
 	}
 	else if(pcdr && sgolden)
 	{
@@ -35,7 +35,6 @@
 #ifndef TIEMeasurement_h
 #define TIEMeasurement_h
 
-#include "../scopehal/LevelCrossingDetector.h"
 
 class TIEConstants
 {
@@ -70,9 +69,12 @@ protected:
 	AcceleratorBuffer<int64_t>* m_clockEdgesMuxed;
 
 	AcceleratorBuffer<int64_t> m_firstPassOutput;
-	AcceleratorBuffer<int64_t> m_secondPassOutput;
 
-	LevelCrossingDetector m_detector;
+	///@brief Sample counts written by the fast path, for output waveforms whose length hasn't been read back yet
+	std::vector<std::shared_ptr<DeviceLength>> m_outputLengths;
+
+	///@brief Zero crossings of the analog clock input
+	std::shared_ptr<LevelCrossingList> m_clockCrossings;
 
 	///@brief Compute pipeline for accelerated fast path
 	std::shared_ptr<ComputePipeline> m_firstPassComputePipeline;
@@ -43,6 +43,7 @@ using namespace std;
 
 TMDSDecoder::TMDSDecoder(const string& color)
 	: Filter(color, CAT_SERIAL)
+	, m_codes("TMDSDecoder.m_codes")
 {
 	AddProtocolStream("data");
 	CreateInput("data");
@@ -51,6 +52,16 @@ TMDSDecoder::TMDSDecoder(const string& color)
 	m_lanename = "Lane number";
 	m_parameters[m_lanename] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS));
 	m_parameters[m_lanename].SetIntVal(0);
+
+	if(g_hasShaderInt8 && g_hasShaderInt64)
+	{
+		m_decodeComputePipeline =
+			make_shared<ComputePipeline>("shaders/TMDSDecoder.spv", 5, sizeof(TMDSDecoderConstants));
+
+		m_sampledData.m_samples.SetGpuAccessHint(AcceleratorBuffer<bool>::HINT_LIKELY);
+		m_sampledData.m_offsets.SetGpuAccessHint(AcceleratorBuffer<int64_t>::HINT_LIKELY);
+		m_codes.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -75,7 +86,7 @@ string TMDSDecoder::GetProtocolName()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
-void TMDSDecoder::Refresh()
+void TMDSDecoder::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
 	if(!VerifyAllInputsOK())
 	{
@@ -94,11 +105,18 @@ void TMDSDecoder::Refresh()
 	cap->m_timescale = 1;
 	cap->m_startTimestamp = din->m_startTimestamp;
 	cap->m_startFemtoseconds = din->m_startFemtoseconds;
-	cap->PrepareForCpuAccess();
 
 	//Record the value of the data stream at each clock edge
-	SparseDigitalWaveform sampdata;
+	auto& sampdata = m_sampledData;
 	SampleOnAnyEdgesBase(din, clkin, sampdata);
+	sampdata.MarkModifiedFromCpu();
+	size_t nsamples = sampdata.m_samples.size();
+	if(nsamples < 32)
+	{
+		SetData(cap, 0);
+		cap->MarkModifiedFromCpu();
+		return;
+	}
 
 	/*
 		Look for preamble data. We need this to synchronize. (HDMI 1.4 spec section 5.4.2)
@@ -119,7 +137,7 @@ void TMDSDecoder::Refresh()
 	for(size_t offset=0; offset < 10; offset ++)
 	{
 		size_t num_preambles[4] = {0};
-		for(size_t i=0; i<sampdata.m_samples.size() - 20; i += 10)
+		for(size_t i=0; i<nsamples - 20; i += 10)
 		{
 			//Look for control code "j" at phase "offset", position "i" within the data stream
 			for(size_t j=0; j<4; j++)
@@ -149,106 +167,128 @@ void TMDSDecoder::Refresh()
 	}
 
 	int lane = m_parameters[m_lanename].GetIntVal();
+	if( (lane < 0) || (lane > 2) )
+		lane = 0;
 
-	//HDMI Video guard band (HDMI 1.4 spec 5.2.2.1)
-	static const bool video_guard[3][10] =
-	{
-		{ 0, 0, 1, 1, 0, 0, 1, 1, 0, 1 },
-		{ 1, 1, 0, 0, 1, 1, 0, 0, 1, 0 },		//also used for data guard band, 5.2.3.3
-		{ 0, 0, 1, 1, 0, 0, 1, 1, 0, 1 },
-	};
+	//HDMI Video guard band (HDMI 1.4 spec 5.2.2.1), packed LSB first
+	//Lane 1 is also used for data guard band, 5.2.3.3
+	static const uint32_t video_guard[3] = { 0x2cc, 0x133, 0x2cc };
 
 	//TODO: TERC4 (5.4.3)
 
-	enum
-	{
-		TYPE_DATA,
-		TYPE_PREAMBLE,
-		TYPE_GUARD
-	} last_symbol_type = TYPE_DATA;
-
-	//Decode the actual data
-	size_t sampmax = sampdata.m_samples.size()-11;
-	for(size_t i=max_offset; i<sampmax; i+= 10)
-	{
-		bool match = true;
+	//Every 10 UIs from the alignment point is one symbol, as long as there's one more sample after it for the duration
+	size_t sampmax = nsamples - 11;
+	size_t nsymbols = 0;
+	if(sampmax > max_offset)
+		nsymbols = (sampmax - max_offset + 9) / 10;
 
-		//Check for control codes at any point in the sequence
-		for(size_t j=0; j<4; j++)
-		{
-			match = true;
-			for(size_t k=0; k<10; k++)
-			{
-				if(sampdata.m_samples[i+k] != control_codes[j][k])
-					match = false;
-			}
+	cap->Resize(nsymbols);
+	m_codes.resize(nsymbols);
 
-			if(match)
-			{
-				cap->m_offsets.push_back(sampdata.m_offsets[i]);
-				cap->m_durations.push_back(sampdata.m_offsets[i+10] - sampdata.m_offsets[i]);
-				cap->m_samples.push_back(TMDSSymbol(TMDSSymbol::TMDS_TYPE_CONTROL, j));
+	//Deserialize and decode every symbol in parallel
+	if(m_decodeComputePipeline)
+	{
+		cmdBuf.begin({});
+
+		TMDSDecoderConstants cfg;
+		cfg.len = nsymbols;
+		cfg.startOffset = max_offset;
+		cfg.guardCode = video_guard[lane];
+
+		m_decodeComputePipeline->BindBufferNonblocking(0, sampdata.m_samples, cmdBuf);
+		m_decodeComputePipeline->BindBufferNonblocking(1, sampdata.m_offsets, cmdBuf);
+		m_decodeComputePipeline->BindBufferNonblocking(2, m_codes, cmdBuf, true);
+		m_decodeComputePipeline->BindBufferNonblocking(3, cap->m_offsets, cmdBuf, true);
+		m_decodeComputePipeline->BindBufferNonblocking(4, cap->m_durations, cmdBuf, true);
+
+		const uint32_t compute_block_count = GetComputeBlockCount(nsymbols, 64);
+		m_decodeComputePipeline->Dispatch(cmdBuf, cfg,
+			min(compute_block_count, 32768u),
+			compute_block_count / 32768 + 1);
+
+		m_codes.MarkModifiedFromGpu();
+		cap->m_offsets.MarkModifiedFromGpu();
+		cap->m_durations.MarkModifiedFromGpu();
+		m_codes.PrepareForCpuAccessNonblocking(cmdBuf);
+
+		cmdBuf.end();
+		queue->SubmitAndBlock(cmdBuf);
+	}
 
-				last_symbol_type = TYPE_PREAMBLE;
-				break;
-			}
-		}
+	//Same thing on the CPU if we don't have int8/int64 shader support
+	else
+	{
+		cap->PrepareForCpuAccess();
+		m_codes.PrepareForCpuAccess();
 
-		if(match)
-			continue;
+		static const uint32_t control_words[4] = { 0x354, 0x0ab, 0x154, 0x2ab };
+		uint32_t guard = video_guard[lane];
 
-		//Check for HDMI video/control leading guard band
-		if( (last_symbol_type == TYPE_PREAMBLE) || (last_symbol_type == TYPE_GUARD) )
+		for(size_t n=0; n<nsymbols; n++)
 		{
-			match = true;
+			size_t i = max_offset + n*10;
+
+			cap->m_offsets[n] = sampdata.m_offsets[i];
+			cap->m_durations[n] = sampdata.m_offsets[i+10] - sampdata.m_offsets[i];
+
+			uint32_t word = 0;
 			for(size_t k=0; k<10; k++)
-			{
-				if(sampdata.m_samples[i+k] != video_guard[lane][k])
-					match = false;
-			}
+				word |= (uint32_t)sampdata.m_samples[i+k] << k;
 
-			if(match)
+			bool control = false;
+			for(uint32_t j=0; j<4; j++)
 			{
-				cap->m_offsets.push_back(sampdata.m_offsets[i]);
-				cap->m_durations.push_back(sampdata.m_offsets[i+10] - sampdata.m_offsets[i]);
-				cap->m_samples.push_back(TMDSSymbol(TMDSSymbol::TMDS_TYPE_GUARD, 0));
-				//last_symbol_type = TYPE_GUARD;
-				break;
+				if(word == control_words[j])
+				{
+					m_codes[n] = CODE_CONTROL | j;
+					control = true;
+					break;
+				}
 			}
+			if(control)
+				continue;
+
+			uint32_t d = word & 0xff;
+			if(word & 0x200)
+				d ^= 0xff;
+			if(word & 0x100)
+				d ^= (d << 1);
+			else
+				d ^= (d << 1) ^ 0xfe;
+			d &= 0xff;
+
+			if(word == guard)
+				d |= CODE_GUARD;
+			m_codes[n] = d;
 		}
 
-		if(match)
-			continue;
-
-		//Whatever is left is assumed to be video data
-		bool d9 = sampdata.m_samples[i+9];
-		bool d8 = sampdata.m_samples[i+8];
-
-		uint8_t d = sampdata.m_samples[i+0] |
-					(sampdata.m_samples[i+1] << 1) |
-					(sampdata.m_samples[i+2] << 2) |
-					(sampdata.m_samples[i+3] << 3) |
-					(sampdata.m_samples[i+4] << 4) |
-					(sampdata.m_samples[i+5] << 5) |
-					(sampdata.m_samples[i+6] << 6) |
-					(sampdata.m_samples[i+7] << 7);
-
-		if(d9)
-			d ^= 0xff;
+		cap->m_offsets.MarkModifiedFromCpu();
+		cap->m_durations.MarkModifiedFromCpu();
+	}
 
-		if(d8)
-			d ^= (d << 1);
+	//Resolve guard bands, which are only valid after a preamble (or another guard band).
+	//This is the only serial dependency in the decode so it's a single cheap pass over the codes.
+	cap->m_samples.PrepareForCpuAccess();
+	bool after_preamble = false;
+	for(size_t n=0; n<nsymbols; n++)
+	{
+		uint32_t code = m_codes[n];
+		if(code & CODE_CONTROL)
+		{
+			cap->m_samples[n] = TMDSSymbol(TMDSSymbol::TMDS_TYPE_CONTROL, code & 0xff);
+			after_preamble = true;
+		}
+		else if( (code & CODE_GUARD) && after_preamble)
+			cap->m_samples[n] = TMDSSymbol(TMDSSymbol::TMDS_TYPE_GUARD, 0);
 		else
-			d ^= (d << 1) ^ 0xfe;
-
-		cap->m_offsets.push_back(sampdata.m_offsets[i]);
-		cap->m_durations.push_back(sampdata.m_offsets[i+10] - sampdata.m_offsets[i]);
-		cap->m_samples.push_back(TMDSSymbol(TMDSSymbol::TMDS_TYPE_DATA, d));
-		last_symbol_type = TYPE_DATA;
+		{
+			cap->m_samples[n] = TMDSSymbol(TMDSSymbol::TMDS_TYPE_DATA, code & 0xff);
+			after_preamble = false;
+		}
 	}
+	cap->m_samples.MarkModifiedFromCpu();
 
 	SetData(cap, 0);
-	cap->MarkModifiedFromCpu();
 }
 
 std::string TMDSWaveform::GetColor(size_t i)
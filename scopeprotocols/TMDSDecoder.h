@@ -73,12 +73,20 @@ public:
 	virtual std::string GetColor(size_t) override;
 };
 
+class TMDSDecoderConstants
+{
+public:
+	uint32_t len;
+	uint32_t startOffset;
+	uint32_t guardCode;
+};
+
 class TMDSDecoder : public Filter
 {
 public:
 	TMDSDecoder(const std::string& color);
 
-	virtual void Refresh() override;
+	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
 
 	static std::string GetProtocolName();
 
@@ -88,6 +96,26 @@ public:
 
 protected:
 	std::string m_lanename;
+
+	/**
+		@brief Flags in m_codes (must match TMDSDecoder.glsl)
+
+		The low 8 bits are the decoded data byte, or the control code index for control symbols.
+	 */
+	enum
+	{
+		CODE_CONTROL	= 0x100,
+		CODE_GUARD		= 0x200
+	};
+
+	///@brief Input data sampled on each clock edge
+	SparseDigitalWaveform m_sampledData;
+
+	///@brief Raw decode output for each symbol, before guard bands are resolved
+	AcceleratorBuffer<uint32_t> m_codes;
+
+	///@brief Compute pipeline for symbol decoding
+	std::shared_ptr<ComputePipeline> m_decodeComputePipeline;
 };
 
 #endif
@@ -45,33 +45,11 @@ TRCImportFilter::TRCImportFilter(const string& color)
 	m_parameters[m_fpname].m_fileFilterName = "Teledyne LeCroy waveform files (*.trc)";
 	m_parameters[m_fpname].signal_changed().connect(sigc::mem_fun(*this, &TRCImportFilter::OnFileNameChanged));
 
-	if(g_hasShaderInt16)
-	{
-		m_computePipeline16Bit = make_unique<ComputePipeline>(
-			"shaders/Convert16BitSamples.spv", 2, sizeof(ConvertRawSamplesShaderArgs) );
-	}
-
-	if(g_hasShaderInt8)
-	{
-		m_computePipeline8Bit = make_unique<ComputePipeline>(
-			"shaders/Convert8BitSamples.spv", 2, sizeof(ConvertRawSamplesShaderArgs) );
-	}
-
-	//Make a command buffer for our accelerated stuff
-	//TODO: Should this really be using the global transfer queue?
-	vk::CommandPoolCreateInfo poolInfo(
-		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-		g_vkTransferQueue->m_family );
-	m_commandPool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo);
-	vk::CommandBufferAllocateInfo bufinfo(**m_commandPool, vk::CommandBufferLevel::ePrimary, 1);
-	m_commandBuffer = make_unique<vk::raii::CommandBuffer>(
-		std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+	AddPagingParameters();
 }
 
 TRCImportFilter::~TRCImportFilter()
 {
-	m_commandBuffer = nullptr;
-	m_commandPool = nullptr;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -94,8 +72,8 @@ void TRCImportFilter::OnFileNameChanged()
 	LogTrace("Loading TRC waveform %s\n", fname.c_str());
 	LogIndenter li;
 
-	FILE* fp = fopen(fname.c_str(), "rb");
-	if(!fp)
+	MappedFile file;
+	if(!file.Open(fname))
 	{
 		LogError("Couldn't open TRC file \"%s\"\n", fname.c_str());
 		return;
@@ -104,10 +82,9 @@ void TRCImportFilter::OnFileNameChanged()
 	//Read the SCPI file length header
 	//Expect #9 followed by 9 digit ASCII length
 	char header[13] = {0};
-	if(11 != fread(header, 1, 11, fp))
+	if(11 != file.Read(header, 1, 11))
 	{
 		LogError("Failed to read file length header\n");
-		fclose(fp);
 		return;
 	}
 	if((header[0] != '#') || (header[1] != '9') )
@@ -115,10 +92,9 @@ void TRCImportFilter::OnFileNameChanged()
 		//Really long files are #A followed by 10 digit length
 		if( (header[0] == '#') && (header[1] == 'A') )
 		{
-			if(1 != fread(&header[11], 1, 1, fp))
+			if(1 != file.Read(&header[11], 1, 1))
 			{
 				LogError("Failed to read file length header\n");
-				fclose(fp);
 				return;
 			}
 		}
@@ -126,7 +102,6 @@ void TRCImportFilter::OnFileNameChanged()
 		else
 		{
 			LogError("Invalid file length header\n");
-			fclose(fp);
 			return;
 		}
 	}
@@ -136,16 +111,15 @@ void TRCImportFilter::OnFileNameChanged()
 	if(len < wavedescSize)
 	{
 		LogError("Invalid file length in header (too small for WAVEDESC)\n");
-		fclose(fp);
 		return;
 	}
 
-	//Read the WAVEDESC
-	uint8_t wavedesc[wavedescSize];
-	if(wavedescSize != fread(wavedesc, 1, wavedescSize, fp))
+	//Parse the WAVEDESC in place
+	size_t wavedescOffset = file.Tell();
+	auto wavedesc = const_cast<uint8_t*>(file.GetPointer(wavedescOffset, wavedescSize));
+	if(!wavedesc)
 	{
 		LogError("Failed to read WAVEDESC\n");
-		fclose(fp);
 		return;
 	}
 
@@ -153,7 +127,6 @@ void TRCImportFilter::OnFileNameChanged()
 	if(0 != memcmp(wavedesc, "WAVEDESC", 8))
 	{
 		LogError("Malformed WAVEDESC (magic number is wrong)\n");
-		fclose(fp);
 		return;
 	}
 
@@ -219,126 +192,12 @@ void TRCImportFilter::OnFileNameChanged()
 	LogTrace("Sample interval: %s\n", Unit(Unit::UNIT_FS).PrettyPrint(wfm->m_timescale).c_str());
 	LogTrace("Trigger phase: %s\n", Unit(Unit::UNIT_FS).PrettyPrint(wfm->m_triggerPhase).c_str());
 
-	wfm->Resize(num_per_segment);
-
-	//16 bit sample path
-	if(hdMode)
+	//Convert straight out of the mapped file (or just index it, if paged)
+	size_t dataOffset = wavedescOffset + wavedescSize;
+	if(!LoadMappedSamples(0, wfm, file, dataOffset, num_per_segment, hdMode ? 2 : 1, v_gain, v_off))
 	{
-		AcceleratorBuffer<int16_t> buf;
-		buf.resize(num_per_segment);
-		buf.PrepareForCpuAccess();
-
-		if(num_per_segment != fread(&buf[0], sizeof(int16_t), num_per_segment, fp))
-		{
-			LogError("Failed to read sample data\n");
-			fclose(fp);
-			return;
-		}
-		buf.MarkModifiedFromCpu();
-
-		//The accelerated filter needs int16 support
-		if(g_hasShaderInt16)
-		{
-			m_commandBuffer->begin({});
-
-			//Update our descriptor sets with current buffers
-			m_computePipeline16Bit->BindBufferNonblocking(0, wfm->m_samples, *m_commandBuffer, true);
-			m_computePipeline16Bit->BindBufferNonblocking(1, buf, *m_commandBuffer);
-
-			ConvertRawSamplesShaderArgs args;
-			args.size = num_per_segment;
-			args.gain = v_gain;
-			args.offset = v_off;
-
-			//Dispatch the compute operation and block until it completes
-			//We are in an event handler, so use the global transfer queue here
-			const uint32_t compute_block_count = GetComputeBlockCount(len, 64);
-			m_computePipeline16Bit->Dispatch(
-				*m_commandBuffer,
-				args,
-				min(compute_block_count, 32768u),
-				compute_block_count / 32768 + 1);
-			m_commandBuffer->end();
-
-			g_vkTransferQueue->SubmitAndBlock(*m_commandBuffer);
-
-			wfm->MarkModifiedFromGpu();
-		}
-
-		//Software fallback
-		else
-		{
-			wfm->PrepareForCpuAccess();
-
-			Oscilloscope::Convert16BitSamples(
-				(float*)&wfm->m_samples[0],
-				&buf[0],
-				v_gain,
-				v_off,
-				num_per_segment);
-
-			wfm->MarkModifiedFromCpu();
-		}
-	}
-
-	//8 bit sample path
-	else
-	{
-		AcceleratorBuffer<int8_t> buf;
-		buf.resize(num_per_segment);
-		buf.PrepareForCpuAccess();
-
-		if(num_per_segment != fread(&buf[0], sizeof(int8_t), num_per_segment, fp))
-		{
-			LogError("Failed to read sample data\n");
-			fclose(fp);
-			return;
-		}
-		buf.MarkModifiedFromCpu();
-
-		//The accelerated filter needs int8 support
-		if(g_hasShaderInt8)
-		{
-			m_commandBuffer->begin({});
-
-			//Update our descriptor sets with current buffers
-			m_computePipeline8Bit->BindBufferNonblocking(0, wfm->m_samples, *m_commandBuffer, true);
-			m_computePipeline8Bit->BindBufferNonblocking(1, buf, *m_commandBuffer);
-
-			ConvertRawSamplesShaderArgs args;
-			args.size = num_per_segment;
-			args.gain = v_gain;
-			args.offset = v_off;
-
-			//Dispatch the compute operation and block until it completes
-			//We are in an event handler, so use the global transfer queue here
-			const uint32_t compute_block_count = GetComputeBlockCount(len, 64);
-			m_computePipeline8Bit->Dispatch(
-				*m_commandBuffer,
-				args,
-				min(compute_block_count, 32768u),
-				compute_block_count / 32768 + 1);
-			m_commandBuffer->end();
-
-			g_vkTransferQueue->SubmitAndBlock(*m_commandBuffer);
-
-			wfm->MarkModifiedFromGpu();
-		}
-
-		//Software fallback
-		else
-		{
-			wfm->PrepareForCpuAccess();
-
-			Oscilloscope::Convert8BitSamples(
-				(float*)&wfm->m_samples[0],
-				&buf[0],
-				v_gain,
-				v_off,
-				num_per_segment);
-
-			wfm->MarkModifiedFromCpu();
-		}
+		LogError("Failed to read sample data\n");
+		return;
 	}
 
 	LogTrace("Loaded %zu samples\n", wfm->size());
@@ -47,12 +47,6 @@ public:
 
 protected:
 	void OnFileNameChanged();
-
-	std::unique_ptr<ComputePipeline> m_computePipeline8Bit;
-	std::unique_ptr<ComputePipeline> m_computePipeline16Bit;
-
-	std::unique_ptr<vk::raii::CommandPool> m_commandPool;
-	std::unique_ptr<vk::raii::CommandBuffer> m_commandBuffer;
 };
 
 #endif
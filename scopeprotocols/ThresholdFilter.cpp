@@ -49,6 +49,13 @@ ThresholdFilter::ThresholdFilter(const string& color)
 	m_parameters[m_hysname] = FilterParameter(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_VOLTS));
 	m_parameters[m_hysname].SetFloatVal(0);
 
+	//Packed output is 8x smaller, but only some filters can consume it
+	m_formatname = "Output Format";
+	m_parameters[m_formatname] = FilterParameter(FilterParameter::TYPE_ENUM, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_formatname].AddEnumValue("Byte per sample", FORMAT_BYTE);
+	m_parameters[m_formatname].AddEnumValue("Bit packed", FORMAT_PACKED);
+	m_parameters[m_formatname].SetIntVal(FORMAT_BYTE);
+
 	if(g_hasShaderInt8)
 	{
 		m_computePipeline = make_unique<ComputePipeline>(
@@ -56,6 +63,35 @@ ThresholdFilter::ThresholdFilter(const string& color)
 			2,
 			sizeof(ThresholdPushConstants));
 	}
+
+	m_packedComputePipeline = make_unique<ComputePipeline>(
+		"shaders/ThresholdPacked.spv",
+		2,
+		sizeof(ThresholdPushConstants));
+
+	m_hysClassifyComputePipeline = make_unique<ComputePipeline>(
+		"shaders/ThresholdHysteresis_Classify.spv",
+		2,
+		sizeof(ThresholdHysteresisPushConstants));
+	m_hysScanComputePipeline = make_unique<ComputePipeline>(
+		"shaders/ThresholdHysteresis_Scan.spv",
+		2,
+		sizeof(ThresholdHysteresisScanPushConstants));
+	if(g_hasShaderInt8)
+	{
+		m_hysComputePipeline = make_unique<ComputePipeline>(
+			"shaders/ThresholdHysteresis.spv",
+			3,
+			sizeof(ThresholdHysteresisPushConstants));
+	}
+	m_hysPackedComputePipeline = make_unique<ComputePipeline>(
+		"shaders/ThresholdHysteresisPacked.spv",
+		3,
+		sizeof(ThresholdHysteresisPushConstants));
+
+	//Only ever touched by the GPU
+	m_hysBlockStates.SetCpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_NEVER);
+	m_hysBlockStates.SetGpuAccessHint(AcceleratorBuffer<uint32_t>::HINT_LIKELY);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -89,6 +125,12 @@ Filter::DataLocation ThresholdFilter::GetInputLocation()
 	return LOC_DONTCARE;
 }
 
+bool ThresholdFilter::AcceptsRawSamples(size_t /*i*/)
+{
+	//Thresholding raw ADC codes directly saves converting the whole waveform to float first
+	return true;
+}
+
 void ThresholdFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue)
 {
 	#ifdef HAVE_NVTX
@@ -112,6 +154,19 @@ void ThresholdFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<Q
 	auto sdin = dynamic_cast<SparseAnalogWaveform*>(din);
 	auto udin = dynamic_cast<UniformAnalogWaveform*>(din);
 
+	if(udin && udin->HasRawSamples())
+	{
+		RefreshRaw(udin, midpoint, hys, m_parameters[m_formatname].GetIntVal() == FORMAT_PACKED);
+		return;
+	}
+
+	//Packed output is only supported for uniform input
+	if(udin && (m_parameters[m_formatname].GetIntVal() == FORMAT_PACKED))
+	{
+		RefreshPacked(cmdBuf, queue, udin, midpoint, hys);
+		return;
+	}
+
 	if(sdin)
 	{
 		auto cap = SetupSparseDigitalOutputWaveform(sdin, 0, 0, 0);
@@ -146,13 +201,22 @@ void ThresholdFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<Q
 				din->PrepareForCpuAccess();
 				cap->PrepareForCpuAccess();
 
-				#pragma omp parallel for
-				for(size_t i=0; i<len; i++)
-					cap->m_samples[i] = sdin->m_samples[i] > midpoint;
+				ParallelFor(0, len, 65536, [&](size_t first, size_t last)
+				{
+					for(size_t i=first; i<last; i++)
+						cap->m_samples[i] = sdin->m_samples[i] > midpoint;
+				});
 
 				cap->MarkModifiedFromCpu();
 			}
 		}
+		//Hysteresis carries state from sample to sample, but each sample's state only depends on the last one
+		//outside the hysteresis band, so it can be resolved in parallel (see AppendHysteresisPrepass)
+		else if(g_hasShaderInt8 && (hys > 0) )
+		{
+			RefreshHysteresisGpu(cmdBuf, queue, sdin->m_samples, cap->m_samples, midpoint, hys);
+			cap->MarkSamplesModifiedFromGpu();
+		}
 		else
 		{
 			din->PrepareForCpuAccess();
@@ -210,13 +274,22 @@ void ThresholdFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<Q
 				din->PrepareForCpuAccess();
 				cap->PrepareForCpuAccess();
 
-				#pragma omp parallel for
-				for(size_t i=0; i<len; i++)
-					cap->m_samples[i] = udin->m_samples[i] > midpoint;
+				ParallelFor(0, len, 65536, [&](size_t first, size_t last)
+				{
+					for(size_t i=first; i<last; i++)
+						cap->m_samples[i] = udin->m_samples[i] > midpoint;
+				});
 
 				cap->MarkModifiedFromCpu();
 			}
 		}
+		//Hysteresis carries state from sample to sample, but each sample's state only depends on the last one
+		//outside the hysteresis band, so it can be resolved in parallel (see AppendHysteresisPrepass)
+		else if(g_hasShaderInt8 && (hys > 0) )
+		{
+			RefreshHysteresisGpu(cmdBuf, queue, udin->m_samples, cap->m_samples, midpoint, hys);
+			cap->MarkSamplesModifiedFromGpu();
+		}
 		else
 		{
 			din->PrepareForCpuAccess();
@@ -240,3 +313,252 @@ void ThresholdFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<Q
 		}
 	}
 }
+
+/**
+	@brief Thresholds a uniform analog waveform into a UniformPackedDigitalWaveform
+ */
+void ThresholdFilter::RefreshPacked(
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue,
+	UniformAnalogWaveform* din,
+	float midpoint,
+	float hys)
+{
+	auto len = din->size();
+	auto cap = SetupEmptyWaveform<UniformPackedDigitalWaveform>(din, 0);
+	cap->Resize(len);
+
+	//No hysteresis? Each GPU thread packs 32 samples
+	if(hys == 0)
+	{
+		cmdBuf.begin({});
+
+		ThresholdPushConstants tpush;
+		tpush.numSamples	= len;
+		tpush.threshold		= midpoint;
+
+		m_packedComputePipeline->BindBufferNonblocking(0, cap->m_words, cmdBuf, true);
+		m_packedComputePipeline->BindBufferNonblocking(1, din->m_samples, cmdBuf);
+
+		const uint32_t compute_block_count = GetComputeBlockCount(GetComputeBlockCount(len, 32), 64);
+		m_packedComputePipeline->Dispatch(cmdBuf, tpush,
+			min(compute_block_count, 32768u),
+			compute_block_count / 32768 + 1);
+
+		cmdBuf.end();
+		queue->SubmitAndBlock(cmdBuf);
+
+		cap->MarkModifiedFromGpu();
+	}
+
+	//With hysteresis, resolve the state entering each block of samples first, then each thread packs one block
+	else if(hys > 0)
+	{
+		cmdBuf.begin({});
+
+		auto push = AppendHysteresisPrepass(cmdBuf, din->m_samples, len, midpoint, hys);
+
+		m_hysPackedComputePipeline->BindBufferNonblocking(0, cap->m_words, cmdBuf, true);
+		m_hysPackedComputePipeline->BindBufferNonblocking(1, din->m_samples, cmdBuf);
+		m_hysPackedComputePipeline->BindBufferNonblocking(2, m_hysBlockStates, cmdBuf);
+
+		const uint32_t compute_block_count = GetComputeBlockCount(m_hysBlockStates.size(), 64);
+		m_hysPackedComputePipeline->Dispatch(cmdBuf, push,
+			min(compute_block_count, 32768u),
+			compute_block_count / 32768 + 1);
+
+		cmdBuf.end();
+		queue->SubmitAndBlock(cmdBuf);
+
+		cap->MarkModifiedFromGpu();
+	}
+
+	//Negative hysteresis toggles on every sample in the overlap band so is truly serial, do it on the CPU
+	else
+	{
+		din->PrepareForCpuAccess();
+		cap->PrepareForCpuAccess();
+
+		bool cur = din->m_samples[0] > midpoint;
+		float thresh_rising = midpoint + hys/2;
+		float thresh_falling = midpoint - hys/2;
+
+		size_t nwords = UniformPackedDigitalWaveform::GetWordCount(len);
+		for(size_t iword=0; iword<nwords; iword++)
+		{
+			size_t base = iword * UniformPackedDigitalWaveform::SAMPLES_PER_WORD;
+			size_t end = min(len, base + UniformPackedDigitalWaveform::SAMPLES_PER_WORD);
+
+			uint64_t w = 0;
+			for(size_t i=base; i<end; i++)
+			{
+				float f = din->m_samples[i];
+				if(cur && (f < thresh_falling))
+					cur = false;
+				else if(!cur && (f > thresh_rising))
+					cur = true;
+				if(cur)
+					w |= 1ULL << (i - base);
+			}
+			cap->m_words[iword] = w;
+		}
+
+		cap->MarkModifiedFromCpu();
+	}
+}
+
+/**
+	@brief Records the first two passes of parallel hysteresis thresholding into cmdBuf
+
+	With positive hysteresis, a sample above the rising threshold always sets the output high and one below the
+	falling threshold always sets it low, regardless of the previous state. Samples in between keep the previous
+	state. So the state at any sample is just that of the last sample outside the band, and the serial loop can be
+	turned into a segmented scan:
+
+	1. Each thread finds the last decisive state (low, high, or none) in its block of HYSTERESIS_BLOCK_SIZE samples
+	2. A single workgroup scans the block results, replacing each with the state entering that block
+	   (the initial state is input > midpoint, to match the serial version)
+
+	The caller then dispatches one thread per block to walk it again from the known starting state.
+
+	@return Push constants for the final pass
+ */
+ThresholdHysteresisPushConstants ThresholdFilter::AppendHysteresisPrepass(
+	vk::raii::CommandBuffer& cmdBuf,
+	AcceleratorBuffer<float>& din,
+	size_t len,
+	float midpoint,
+	float hys)
+{
+	size_t nblocks = (len + HYSTERESIS_BLOCK_SIZE - 1) / HYSTERESIS_BLOCK_SIZE;
+	m_hysBlockStates.resize(nblocks);
+
+	ThresholdHysteresisPushConstants push;
+	push.numSamples = len;
+	push.blockSize = HYSTERESIS_BLOCK_SIZE;
+	push.threshRising = midpoint + hys/2;
+	push.threshFalling = midpoint - hys/2;
+
+	m_hysClassifyComputePipeline->BindBufferNonblocking(0, din, cmdBuf);
+	m_hysClassifyComputePipeline->BindBufferNonblocking(1, m_hysBlockStates, cmdBuf, true);
+	const uint32_t compute_block_count = GetComputeBlockCount(nblocks, 64);
+	m_hysClassifyComputePipeline->Dispatch(cmdBuf, push,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
+	m_hysClassifyComputePipeline->AddComputeMemoryBarrier(cmdBuf);
+
+	ThresholdHysteresisScanPushConstants spush;
+	spush.numBlocks = nblocks;
+	spush.midpoint = midpoint;
+	m_hysScanComputePipeline->BindBufferNonblocking(0, m_hysBlockStates, cmdBuf);
+	m_hysScanComputePipeline->BindBufferNonblocking(1, din, cmdBuf);
+	m_hysScanComputePipeline->Dispatch(cmdBuf, spush, 1);
+	m_hysScanComputePipeline->AddComputeMemoryBarrier(cmdBuf);
+
+	m_hysBlockStates.MarkModifiedFromGpu();
+	return push;
+}
+
+/**
+	@brief Thresholds with positive hysteresis on the GPU, producing one byte per sample
+ */
+void ThresholdFilter::RefreshHysteresisGpu(
+	vk::raii::CommandBuffer& cmdBuf,
+	shared_ptr<QueueHandle> queue,
+	AcceleratorBuffer<float>& din,
+	AcceleratorBuffer<uint8_t>& dout,
+	float midpoint,
+	float hys)
+{
+	cmdBuf.begin({});
+
+	auto push = AppendHysteresisPrepass(cmdBuf, din, din.size(), midpoint, hys);
+
+	m_hysComputePipeline->BindBufferNonblocking(0, dout, cmdBuf, true);
+	m_hysComputePipeline->BindBufferNonblocking(1, din, cmdBuf);
+	m_hysComputePipeline->BindBufferNonblocking(2, m_hysBlockStates, cmdBuf);
+
+	const uint32_t compute_block_count = GetComputeBlockCount(m_hysBlockStates.size(), 64);
+	m_hysComputePipeline->Dispatch(cmdBuf, push,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
+
+	cmdBuf.end();
+	queue->SubmitAndBlock(cmdBuf);
+
+	dout.MarkModifiedFromGpu();
+}
+
+/**
+	@brief Thresholds a uniform analog waveform still holding raw ADC codes, without converting it to float
+ */
+void ThresholdFilter::RefreshRaw(UniformAnalogWaveform* din, float midpoint, float hys, bool packed)
+{
+	auto len = din->size();
+	auto raw = din->m_rawSamples.get();
+	raw->PrepareForCpuAccess();
+
+	float thresh_rising = midpoint + hys/2;
+	float thresh_falling = midpoint - hys/2;
+
+	if(packed)
+	{
+		auto cap = SetupEmptyWaveform<UniformPackedDigitalWaveform>(din, 0);
+		cap->Resize(len);
+		cap->PrepareForCpuAccess();
+
+		bool cur = (len > 0) && (raw->GetSample(0) > midpoint);
+		size_t nwords = UniformPackedDigitalWaveform::GetWordCount(len);
+		for(size_t iword=0; iword<nwords; iword++)
+		{
+			size_t base = iword * UniformPackedDigitalWaveform::SAMPLES_PER_WORD;
+			size_t end = min(len, base + UniformPackedDigitalWaveform::SAMPLES_PER_WORD);
+
+			uint64_t w = 0;
+			for(size_t i=base; i<end; i++)
+			{
+				float f = raw->GetSample(i);
+				if(cur && (f < thresh_falling))
+					cur = false;
+				else if(!cur && (f > thresh_rising))
+					cur = true;
+				if(cur)
+					w |= 1ULL << (i - base);
+			}
+			cap->m_words[iword] = w;
+		}
+
+		cap->MarkModifiedFromCpu();
+	}
+
+	else
+	{
+		auto cap = SetupEmptyUniformDigitalOutputWaveform(din, 0);
+		cap->Resize(len);
+		cap->PrepareForCpuAccess();
+
+		if(hys == 0)
+		{
+			ParallelFor(0, len, 65536, [&](size_t first, size_t last)
+			{
+				for(size_t i=first; i<last; i++)
+					cap->m_samples[i] = raw->GetSample(i) > midpoint;
+			});
+		}
+		else if(len > 0)
+		{
+			bool cur = raw->GetSample(0) > midpoint;
+			for(size_t i=0; i<len; i++)
+			{
+				float f = raw->GetSample(i);
+				if(cur && (f < thresh_falling))
+					cur = false;
+				else if(!cur && (f > thresh_rising))
+					cur = true;
+				cap->m_samples[i] = cur;
+			}
+		}
+
+		cap->MarkModifiedFromCpu();
+	}
+}
@@ -41,6 +41,20 @@ struct __attribute__((packed)) ThresholdPushConstants
 	float threshold;
 };
 
+struct __attribute__((packed)) ThresholdHysteresisPushConstants
+{
+	uint32_t numSamples;
+	uint32_t blockSize;
+	float threshRising;
+	float threshFalling;
+};
+
+struct __attribute__((packed)) ThresholdHysteresisScanPushConstants
+{
+	uint32_t numBlocks;
+	float midpoint;
+};
+
 class ThresholdFilter : public Filter
 {
 public:
@@ -48,6 +62,7 @@ public:
 
 	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
 	virtual DataLocation GetInputLocation() override;
+	virtual bool AcceptsRawSamples(size_t i) override;
 
 	static std::string GetProtocolName();
 
@@ -58,8 +73,52 @@ public:
 protected:
 	std::string m_threshname;
 	std::string m_hysname;
+	std::string m_formatname;
+
+	///@brief Values for the output format parameter
+	enum OutputFormat
+	{
+		FORMAT_BYTE,
+		FORMAT_PACKED
+	};
 
 	std::unique_ptr<ComputePipeline> m_computePipeline;
+	std::unique_ptr<ComputePipeline> m_packedComputePipeline;
+
+	std::unique_ptr<ComputePipeline> m_hysClassifyComputePipeline;
+	std::unique_ptr<ComputePipeline> m_hysScanComputePipeline;
+	std::unique_ptr<ComputePipeline> m_hysComputePipeline;
+	std::unique_ptr<ComputePipeline> m_hysPackedComputePipeline;
+
+	///@brief Per block hysteresis state: last decisive state within each block, then the state entering it
+	AcceleratorBuffer<uint32_t> m_hysBlockStates;
+
+	///@brief Number of input samples handled by each thread when thresholding with hysteresis
+	static constexpr size_t HYSTERESIS_BLOCK_SIZE = 1024;
+
+	ThresholdHysteresisPushConstants AppendHysteresisPrepass(
+		vk::raii::CommandBuffer& cmdBuf,
+		AcceleratorBuffer<float>& din,
+		size_t len,
+		float midpoint,
+		float hys);
+
+	void RefreshHysteresisGpu(
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue,
+		AcceleratorBuffer<float>& din,
+		AcceleratorBuffer<uint8_t>& dout,
+		float midpoint,
+		float hys);
+
+	void RefreshPacked(
+		vk::raii::CommandBuffer& cmdBuf,
+		std::shared_ptr<QueueHandle> queue,
+		UniformAnalogWaveform* din,
+		float midpoint,
+		float hys);
+
+	void RefreshRaw(UniformAnalogWaveform* din, float midpoint, float hys, bool packed);
 };
 
 #endif
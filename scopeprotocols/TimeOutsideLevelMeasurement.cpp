@@ -98,15 +98,15 @@ void TimeOutsideLevelMeasurement::Refresh()
 	auto din = GetInputWaveform(0);
 	din->PrepareForCpuAccess();
 
-	auto uadin = dynamic_cast<UniformAnalogWaveform*>(din);
-	auto sadin = dynamic_cast<SparseAnalogWaveform*>(din);
+	auto uadin = WaveformCast<UniformAnalogWaveform>(din);
+	auto sadin = WaveformCast<SparseAnalogWaveform>(din);
 
 	float highlevel = m_parameters[m_highlevel].GetFloatVal();
 	float lowlevel = m_parameters[m_lowlevel].GetFloatVal();
 
 	int64_t hightime = 0;
 	int64_t lowtime = 0;
-	size_t length = uadin->m_samples.size();
+	size_t length = din->size();
 
 	MeasurementType measurement_type = (MeasurementType)m_parameters[m_measurement_typename].GetIntVal();
 
@@ -115,12 +115,12 @@ void TimeOutsideLevelMeasurement::Refresh()
 
 	if (uadin)
 	{
-		#pragma omp parallel
-		#pragma omp single nowait
+		//The high and low passes are independent, so run them side by side
+		ParallelFor(0, 2, 1, [&](size_t first, size_t last)
 		{
-			if (processhigh == true)
+			for(size_t pass=first; pass<last; pass++)
 			{
-				#pragma omp task
+				if( (pass == 0) && processhigh)
 				{
 					size_t i = 0;
 					int64_t temp1 = 0;
@@ -148,11 +148,8 @@ void TimeOutsideLevelMeasurement::Refresh()
 						i++;
 					}
 				}
-			}
 
-			if (processlow == true)
-			{
-				#pragma omp task
+				if( (pass == 1) && processlow)
 				{
 					size_t i = 0;
 					int64_t temp1 = 0;
@@ -181,25 +178,36 @@ void TimeOutsideLevelMeasurement::Refresh()
 					}
 				}
 			}
-		}
+		});
 	}
 	else if (sadin)
 	{
-		#pragma omp parallel for
-		for(size_t i = 0; i < length; i++)
+		//Sum each chunk separately, then combine
+		atomic<int64_t> sparseHigh(0);
+		atomic<int64_t> sparseLow(0);
+		ParallelFor(0, length, 65536, [&](size_t first, size_t last)
 		{
-			//Simply sum durations of all samples with value greater than the high threshold
-			if ((processhigh == true) && (sadin->m_samples[i] > highlevel))
+			int64_t chunkHigh = 0;
+			int64_t chunkLow = 0;
+			for(size_t i = first; i < last; i++)
 			{
-				hightime += sadin->m_durations[i];
-			}
+				//Simply sum durations of all samples with value greater than the high threshold
+				if ((processhigh == true) && (sadin->m_samples[i] > highlevel))
+				{
+					chunkHigh += sadin->m_durations[i];
+				}
 
-			//Simply sum durations of all samples with value less than the low threshold
-			if ((processlow == true) && (sadin->m_samples[i] < lowlevel))
-			{
-				lowtime += sadin->m_durations[i];
+				//Simply sum durations of all samples with value less than the low threshold
+				if ((processlow == true) && (sadin->m_samples[i] < lowlevel))
+				{
+					chunkLow += sadin->m_durations[i];
+				}
 			}
-		}
+			sparseHigh += chunkHigh;
+			sparseLow += chunkLow;
+		});
+		hightime = sparseHigh;
+		lowtime = sparseLow;
 	}
 
 	//Calculate total time
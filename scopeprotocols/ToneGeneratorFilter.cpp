@@ -87,6 +87,12 @@ string ToneGeneratorFilter::GetProtocolName()
 	return "Sine";
 }
 
+bool ToneGeneratorFilter::IsOutputContentHashed()
+{
+	//We regenerate identical samples every refresh unless a parameter changes
+	return true;
+}
+
 void ToneGeneratorFilter::OnUnitChanged()
 {
 	Unit unit(static_cast<Unit::UnitType>(m_parameters[m_unitname].GetIntVal()));
@@ -37,7 +37,7 @@ using namespace std;
 
 TrendFilter::TrendFilter(const string& color)
 	: PausableFilter(color, CAT_MATH)
-	, m_tlast(0)
+	, m_tbase(0)
 	, m_depthname("Buffer length")
 {
 	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_ANALOG);
@@ -86,6 +86,34 @@ void TrendFilter::ClearSweeps()
 	SetData(nullptr, 0);
 }
 
+/**
+	@brief Removes the oldest samples once the waveform has grown well past the requested depth
+
+	Samples are dropped in batches of 1/16 of the depth, so each append costs a constant amount of copying on average
+	rather than a move of the whole buffer. Offsets are then rebased on the oldest remaining sample so they stay small
+	no matter how long the trend has been running.
+
+	@param wfm		The output waveform
+	@param depth	Number of samples to keep
+ */
+void TrendFilter::Trim(SparseAnalogWaveform* wfm, size_t depth)
+{
+	size_t len = wfm->m_samples.size();
+	size_t slack = max(depth / 16, (size_t)1);
+	if(len <= depth + slack)
+		return;
+
+	size_t count = len - depth;
+	wfm->m_samples.pop_front(count);
+	wfm->m_durations.pop_front(count);
+	wfm->m_offsets.pop_front(count);
+
+	int64_t base = wfm->m_offsets[0];
+	for(auto& off : wfm->m_offsets)
+		off -= base;
+	m_tbase += base / FS_PER_SECOND;
+}
+
 void TrendFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/, std::shared_ptr<QueueHandle> /*queue*/)
 {
 	if(!ShouldRefresh())
@@ -100,25 +128,24 @@ void TrendFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/, std::shared_ptr<Q
 	//See if we have output already
 	double now = GetTime();
 	auto wfm = dynamic_cast<SparseAnalogWaveform*>(GetData(0));
-	if(wfm)
-	{
-		//Remove old samples
-		size_t nmax = m_parameters[m_depthname].GetIntVal();
-		while(wfm->m_samples.size() > nmax)
-		{
-			wfm->m_samples.pop_front();
-			wfm->m_durations.pop_front();
-			wfm->m_offsets.pop_front();
-		}
-	}
-	else
+	if(!wfm)
 	{
 		wfm = new SparseAnalogWaveform;
 		SetData(wfm, 0);
 
 		wfm->m_triggerPhase = 0;
 		wfm->m_timescale = 1;
-		m_tlast = now;
+		m_tbase = now;
+	}
+
+	//Waveform loaded from a saved session? Pretend the newest sample was just taken
+	else if(m_tbase == 0)
+	{
+		wfm->PrepareForCpuAccess();
+		if(wfm->m_offsets.empty())
+			m_tbase = now;
+		else
+			m_tbase = now - wfm->m_offsets[wfm->m_offsets.size() - 1] / FS_PER_SECOND;
 	}
 	wfm->PrepareForCpuAccess();
 	wfm->m_revision ++;
@@ -127,26 +154,28 @@ void TrendFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/, std::shared_ptr<Q
 	wfm->m_startTimestamp = floor(now);
 	wfm->m_startFemtoseconds = (now - wfm->m_startTimestamp) * FS_PER_SECOND;
 
+	//Offsets are relative to m_tbase and never move once written
+	int64_t offset = (now - m_tbase) * FS_PER_SECOND;
+
 	//Update duration of previous sample
 	size_t len = wfm->m_samples.size();
-	double dt = (now - m_tlast) * FS_PER_SECOND;
+	int64_t dt = 0;
 	if(len > 0)
+	{
+		dt = offset - wfm->m_offsets[len-1];
 		wfm->m_durations[len-1] = dt;
+	}
 
 	//Add the new sample
 	wfm->m_samples.push_back(GetInput(0).GetScalarValue());
 	wfm->m_durations.push_back(dt);
-	if(wfm->m_offsets.empty())
-		wfm->m_offsets.push_back(0);
-	else
-		wfm->m_offsets.push_back(dt + wfm->m_offsets[len-1]);
+	wfm->m_offsets.push_back(offset);
 
-	//Update offsets of old samples
-	len = wfm->m_samples.size();
-	for(size_t i=0; i<len; i++)
-		wfm->m_offsets[i] -= dt;
+	//Remove old samples
+	Trim(wfm, m_parameters[m_depthname].GetIntVal());
 
-	wfm->MarkModifiedFromCpu();
+	//Shift the whole waveform left with the trigger phase so the newest sample is at zero
+	wfm->m_triggerPhase = -wfm->m_offsets[wfm->m_offsets.size() - 1];
 
-	m_tlast = now;
+	wfm->MarkModifiedFromCpu();
 }
@@ -54,7 +54,10 @@ public:
 	PROTOCOL_DECODER_INITPROC(TrendFilter)
 
 protected:
-	double m_tlast;
+	void Trim(SparseAnalogWaveform* wfm, size_t depth);
+
+	///@brief Wall clock time corresponding to an offset of zero in the output waveform
+	double m_tbase;
 
 	std::string m_depthname;
 };
@@ -37,6 +37,7 @@ using namespace std;
 
 TwoPortShuntThroughFilter::TwoPortShuntThroughFilter(const string& color)
 	: Filter(color, CAT_RF)
+	, m_computePipeline("shaders/TwoPortShuntThroughFilter.spv", 2, sizeof(TwoPortShuntThroughConstants))
 {
 	AddStream(Unit(Unit::UNIT_OHMS), "data", Stream::STREAM_TYPE_ANALOG);
 	CreateInput("S21Mag");
@@ -69,10 +70,22 @@ string TwoPortShuntThroughFilter::GetProtocolName()
 	return "2-Port Shunt Through";
 }
 
+Filter::DataLocation TwoPortShuntThroughFilter::GetInputLocation()
+{
+	//We explicitly manage our input memory and don't care where it is when Refresh() is called
+	return LOC_DONTCARE;
+}
+
+bool TwoPortShuntThroughFilter::ConsumesInputsOnGpu()
+{
+	//Samples are only read by our shader, but timestamps of a sparse input are read on the CPU
+	return false;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
-void TwoPortShuntThroughFilter::Refresh()
+void TwoPortShuntThroughFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
 	//Make sure we've got valid inputs
 	if(!VerifyAllInputsOK())
@@ -84,7 +97,6 @@ void TwoPortShuntThroughFilter::Refresh()
 	auto din = GetInputWaveform(0);
 	auto umag = dynamic_cast<UniformAnalogWaveform*>(din);
 	auto smag = dynamic_cast<SparseAnalogWaveform*>(din);
-	din->PrepareForCpuAccess();
 
 	//We need meaningful data
 	size_t len = din->size();
@@ -98,23 +110,41 @@ void TwoPortShuntThroughFilter::Refresh()
 
 	//Create the output and copy timestamps
 	auto cap = SetupEmptySparseAnalogOutputWaveform(din, 0, true);
-	cap->PrepareForCpuAccess();
 	cap->Resize(len);
 	cap->m_timescale = 1;
-
-	//Main output loop
+	if(smag)
+	{
+		smag->m_offsets.PrepareForCpuAccess();
+		smag->m_durations.PrepareForCpuAccess();
+	}
+	cap->m_offsets.PrepareForCpuAccess();
+	cap->m_durations.PrepareForCpuAccess();
 	for(size_t i=0; i<len; i++)
 	{
-		auto s21_log = GetValue(smag, umag, i);
-		float s21_mag = pow(10, s21_log / 20);
-
-		//TODO: make this a parameter for VNA config?
-		const float z0 = 50;
-
 		cap->m_offsets[i] = GetOffsetScaled(smag, umag, i);
 		cap->m_durations[i] = GetDurationScaled(smag, umag, i);
-		cap->m_samples[i] = ((0.5 * z0) * s21_mag) / (1 - s21_mag);
 	}
+	cap->MarkTimestampsModifiedFromCpu();
+
+	//Convert S21 to impedance on the GPU
+	TwoPortShuntThroughConstants cfg;
+	cfg.len = len;
+	cfg.z0 = 50;	//TODO: make this a parameter for VNA config?
+
+	cmdBuf.begin({});
+
+	if(smag)
+		m_computePipeline.BindBufferNonblocking(0, smag->m_samples, cmdBuf);
+	else
+		m_computePipeline.BindBufferNonblocking(0, umag->m_samples, cmdBuf);
+	m_computePipeline.BindBufferNonblocking(1, cap->m_samples, cmdBuf, true);
+
+	const uint32_t compute_block_count = GetComputeBlockCount(len, 64);
+	m_computePipeline.Dispatch(cmdBuf, cfg,
+		min(compute_block_count, 32768u),
+		compute_block_count / 32768 + 1);
 
-	cap->MarkModifiedFromCpu();
+	cmdBuf.end();
+	queue->SubmitDeferred(cmdBuf);
+	cap->MarkSamplesModifiedFromGpu();
 }
@@ -35,18 +35,30 @@
 #ifndef TwoPortShuntThroughFilter_h
 #define TwoPortShuntThroughFilter_h
 
+class TwoPortShuntThroughConstants
+{
+public:
+	uint32_t	len;
+	float		z0;
+};
+
 class TwoPortShuntThroughFilter : public Filter
 {
 public:
 	TwoPortShuntThroughFilter(const std::string& color);
 
-	virtual void Refresh() override;
+	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
+	virtual DataLocation GetInputLocation() override;
+	virtual bool ConsumesInputsOnGpu() override;
 
 	static std::string GetProtocolName();
 
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
 	PROTOCOL_DECODER_INITPROC(TwoPortShuntThroughFilter)
+
+protected:
+	ComputePipeline m_computePipeline;
 };
 
 #endif
@@ -50,6 +50,8 @@ UARTDecoder::UARTDecoder(const string& color)
 	m_baudname = "Baud rate";
 	m_parameters[m_baudname] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_BITRATE));
 	m_parameters[m_baudname].SetIntVal(115200);
+
+	m_scaledBitPeriod = 0;
 }
 
 UARTDecoder::~UARTDecoder()
@@ -95,16 +97,14 @@ void UARTDecoder::Refresh()
 		return;
 	}
 
-	//Get the input data
+	//Get the input data. We only care about edges, so work from the (shared, cached) edge list
 	auto din = GetInputWaveform(0);
-	din->PrepareForCpuAccess();
-	auto sdin = dynamic_cast<SparseDigitalWaveform*>(din);
-	auto udin = dynamic_cast<UniformDigitalWaveform*>(din);
+	m_edges = DigitalEdgeList::Get(din);
 
 	//Get the bit period
 	float bit_period = FS_PER_SECOND / m_parameters[m_baudname].GetFloatVal();
 	int64_t ibitper = bit_period;
-	int64_t scaledbitper = ibitper / din->m_timescale;
+	m_scaledBitPeriod = ibitper / din->m_timescale;
 
 	//UART processing
 	auto cap = new ByteWaveform(m_displaycolor);
@@ -114,28 +114,86 @@ void UARTDecoder::Refresh()
 	cap->m_startFemtoseconds = din->m_startFemtoseconds;
 	cap->m_triggerPhase = din->m_triggerPhase;
 
-	//Time-domain processing to reflect potentially variable sampling rate for RLE captures
+	//Decode long captures in parallel, splitting on idle periods
+	ParallelDecode(cap);
+	m_edges = nullptr;
+
+	SetData(cap, 0);
+}
+
+/**
+	@brief Splits the capture at falling edges preceded by at least 32 bit times of idle (high) line
+
+	A byte lasts less than ten bit times, so no matter how a sequential decode had aligned itself before the gap it is
+	guaranteed to be idle by the time the edge arrives and will take it as a start bit. The gap is also longer than
+	the 30 bit times which end a packet, so packets never span a restart point either.
+
+	Restart points are edge indexes.
+ */
+bool UARTDecoder::FindRestartPoints(size_t maxChunks, vector<int64_t>& points)
+{
+	//Don't bother splitting small captures, the overhead isn't worth it
+	size_t nedges = m_edges->size();
+	size_t minChunkEdges = max((size_t)16384, nedges / maxChunks);
+
+	points.push_back(0);
+	int64_t mingap = 32 * m_scaledBitPeriod;
+	for(size_t i=minChunkEdges; i < nedges; i++)
+	{
+		if( (m_edges->m_edges[i] - m_edges->m_edges[i-1]) <= mingap)
+			continue;
+		if(!m_edges->GetLevelAfterEdge(i-1))
+			continue;
+
+		points.push_back(i);
+		i += minChunkEdges;
+	}
+	points.push_back(nedges);
+
+	return true;
+}
+
+void UARTDecoder::DecodeChunk(int64_t start, int64_t end, SparseWaveformBase* wfm, vector<Packet*>& packets)
+{
+	auto cap = dynamic_cast<SparseWaveform<char>*>(wfm);
+	auto edges = m_edges.get();
+	size_t nedges = edges->size();
+	int64_t scaledbitper = m_scaledBitPeriod;
+
+	//Time-domain processing, skipping directly from one edge to the next.
+	//Restart points are always just after the line went idle, so start from the last edge before the chunk.
 	int64_t next_value = 0;
-	size_t isample = 0;
+	int64_t t = edges->m_start;
+	size_t iedge = start;
+	if(start > 0)
+		t = edges->m_edges[start - 1];
 	int64_t tlast = 0;
 	Packet* pack = NULL;
-	size_t len = din->size();
-	while(isample < len)
+	bool endOfChunk = false;
+	while(t < edges->m_end)
 	{
 		//Wait for signal to go high (idle state)
-		while( (isample < len) && !GetValue(sdin, udin, isample))
-			isample ++;
-		if(isample >= len)
+		if(!edges->GetValueAt(t, iedge))
+		{
+			if(iedge >= nedges)
+				break;
+			t = edges->m_edges[iedge];
+			iedge ++;
+		}
+
+		//Wait for a falling edge (start bit). The line is now high, so the next edge is falling.
+		if(iedge >= nedges)
 			break;
 
-		//Wait for a falling edge (start bit)
-		while( (isample < len) && GetValue(sdin, udin, isample))
-			isample ++;
-		if(isample >= len)
+		//Anything past the end of the chunk belongs to the next one
+		if(iedge >= (size_t)end)
+		{
+			endOfChunk = true;
 			break;
+		}
 
 		//Time of the start bit
-		int64_t tstart = ::GetOffset(sdin, udin, isample);
+		int64_t tstart = edges->m_edges[iedge];
 
 		//The next data bit should be measured 1.5 bit periods after the falling edge
 		next_value = tstart + scaledbitper + scaledbitper/2;
@@ -144,28 +202,22 @@ void UARTDecoder::Refresh()
 		unsigned char dval = 0;
 		for(int ibit=0; ibit<8; ibit++)
 		{
-			//Find the sample of interest
-			while( (isample < len) && ((::GetOffset(sdin, udin, isample) + GetDuration(sdin, udin, isample)) < next_value))
-				isample ++;
-			if(isample >= len)
+			if(next_value > edges->m_end)
 				break;
 
 			//Got the sample
-			dval = (dval >> 1) | (GetValue(sdin, udin, isample) ? 0x80 : 0);
+			dval = (dval >> 1) | (edges->GetValueAt(next_value, iedge) ? 0x80 : 0);
 
 			//Go on to the next bit
 			next_value += scaledbitper;
 		}
 
-		//If we ran out of space before we hit the end of the buffer, abort
-		if(isample >= len)
+		//If we ran out of space before we hit the end of the buffer (including the stop bit), abort
+		if(next_value > edges->m_end)
 			break;
 
-		//All good, read the stop bit
-		while( (isample < len) && ((::GetOffset(sdin, udin, isample) + GetDuration(sdin, udin, isample)) < next_value))
-			isample ++;
-		if(isample >= len)
-			break;
+		//All good, resume the idle search from the stop bit
+		t = next_value;
 
 		//Save the sample
 		int64_t tend = next_value + (scaledbitper/2);
@@ -179,8 +231,8 @@ void UARTDecoder::Refresh()
 			int64_t delta = tstart - tlast;
 			if(delta > 30 * scaledbitper)
 			{
-				pack->m_len = (tend * din->m_timescale) - pack->m_offset;
-				FinishPacket(pack);
+				pack->m_len = (tend * edges->m_timescale) - pack->m_offset;
+				FinishPacket(pack, packets);
 				pack = NULL;
 			}
 		}
@@ -189,7 +241,7 @@ void UARTDecoder::Refresh()
 		if(pack == NULL)
 		{
 			pack = new Packet;
-			pack->m_offset = tstart * din->m_timescale + din->m_triggerPhase;
+			pack->m_offset = tstart * edges->m_timescale + edges->m_triggerPhase;
 		}
 
 		//Append to the existing packet
@@ -200,14 +252,32 @@ void UARTDecoder::Refresh()
 	//If we have a packet in progress, add it
 	if(pack)
 	{
-		pack->m_len = ::GetOffsetScaled(sdin, udin, len-1) - pack->m_offset;
-		FinishPacket(pack);
-	}
+		//Last chunk: the packet runs to the end of the capture
+		if(!endOfChunk)
+			pack->m_len = edges->ToScaled(edges->m_end) - pack->m_offset;
 
-	SetData(cap, 0);
+		//Otherwise it was ended by the first byte of the next chunk, so end it wherever that byte does
+		else
+		{
+			next_value = edges->m_edges[end] + scaledbitper + scaledbitper/2;
+			for(int ibit=0; ibit<8; ibit++)
+			{
+				if(next_value > edges->m_end)
+					break;
+				next_value += scaledbitper;
+			}
+
+			if(next_value > edges->m_end)
+				pack->m_len = edges->ToScaled(edges->m_end) - pack->m_offset;
+			else
+				pack->m_len = ( (next_value + scaledbitper/2) * edges->m_timescale) - pack->m_offset;
+		}
+
+		FinishPacket(pack, packets);
+	}
 }
 
-void UARTDecoder::FinishPacket(Packet* pack)
+void UARTDecoder::FinishPacket(Packet* pack, vector<Packet*>& packets)
 {
 	//length header
 	char tmp[128];
@@ -225,7 +295,7 @@ void UARTDecoder::FinishPacket(Packet* pack)
 	}
 	pack->m_headers["ASCII"] = s;
 
-	m_packets.push_back(pack);
+	packets.push_back(pack);
 }
 
 std::string ByteWaveform::GetColor(size_t /*i*/)
@@ -66,8 +66,21 @@ public:
 	PROTOCOL_DECODER_INITPROC(UARTDecoder)
 
 protected:
-	void FinishPacket(Packet* pack);
+	virtual bool FindRestartPoints(size_t maxChunks, std::vector<int64_t>& points) override;
+	virtual void DecodeChunk(
+		int64_t start,
+		int64_t end,
+		SparseWaveformBase* wfm,
+		std::vector<Packet*>& packets) override;
+
+	void FinishPacket(Packet* pack, std::vector<Packet*>& packets);
 	std::string m_baudname;
+
+	///@brief Edges of the input being decoded (only valid during Refresh)
+	std::shared_ptr<DigitalEdgeList> m_edges;
+
+	///@brief Bit period of the input being decoded, in input timebase units
+	int64_t m_scaledBitPeriod;
 };
 
 #endif
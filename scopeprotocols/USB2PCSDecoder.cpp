@@ -37,11 +37,21 @@ using namespace std;
 
 USB2PCSDecoder::USB2PCSDecoder(const string& color)
 	: Filter(color, CAT_SERIAL)
+	, m_fusedSource(nullptr)
 {
 	AddProtocolStream("data");
 	CreateInput("PMA");
 }
 
+USB2PCSDecoder::~USB2PCSDecoder()
+{
+	if(m_fusedSource)
+	{
+		m_fusedSource->RemoveFusedConsumer();
+		m_fusedSource->Release();
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Factory methods
 
@@ -67,6 +77,29 @@ string USB2PCSDecoder::GetProtocolName()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
+void USB2PCSDecoder::OnInputChanged(size_t i)
+{
+	if(i != 0)
+		return;
+
+	//Register as a fused consumer of our PMA decoder so it can skip storing line states nobody else reads.
+	//Hold our own reference while registered, so the old decoder is still around to unregister from.
+	auto pma = dynamic_cast<USB2PMADecoder*>(m_inputs[0].m_channel);
+	if(pma == m_fusedSource)
+		return;
+	if(m_fusedSource)
+	{
+		m_fusedSource->RemoveFusedConsumer();
+		m_fusedSource->Release();
+	}
+	m_fusedSource = pma;
+	if(m_fusedSource)
+	{
+		m_fusedSource->AddRef();
+		m_fusedSource->AddFusedConsumer();
+	}
+}
+
 void USB2PCSDecoder::Refresh()
 {
 	//Make sure we've got valid inputs
@@ -79,7 +112,7 @@ void USB2PCSDecoder::Refresh()
 	//Get the input data
 	auto din = dynamic_cast<USB2PMAWaveform*>(GetInputWaveform(0));
 	din->PrepareForCpuAccess();
-	size_t len = din->size();
+	int64_t timescale = din->m_timescale;
 
 	//Make the capture and copy our time scales from the input
 	auto cap = new USB2PCSWaveform;
@@ -99,32 +132,44 @@ void USB2PCSDecoder::Refresh()
 	size_t count = 0;
 	uint8_t data = 0;
 	bool first = true;
-	for(size_t i=0; i<len; i++)
+	USB2PMASegment last = {0, 0, USB2PMASymbol()};
+	auto decode = [&](const USB2PMASegment& seg)
 	{
 		switch(state)
 		{
 			case STATE_IDLE:
-				RefreshIterationIdle(i, state, speed, ui_width, cap, din, count, offset);
+				RefreshIterationIdle(seg, state, speed, ui_width, cap, timescale, count, offset);
 				break;
 
 			case STATE_SYNC:
-				RefreshIterationSync(i, state, speed, ui_width, cap, din, count, offset, data, first);
+				RefreshIterationSync(seg, state, speed, ui_width, cap, timescale, count, offset, data, first);
 				break;
 
 			case STATE_DATA:
 				RefreshIterationData(
-					i,
-					i-1,
+					seg,
+					last,
 					state,
 					speed,
 					ui_width,
 					cap,
-					din,
+					timescale,
 					count,
 					offset,
 					data);
 				break;
 		}
+		last = seg;
+	};
+
+	//If the PMA decoder didn't store its line states, get them straight from it as they're sliced
+	if(din->m_deferred && m_fusedSource)
+		m_fusedSource->SliceLineStates(decode);
+	else
+	{
+		size_t len = din->size();
+		for(size_t i=0; i<len; i++)
+			decode({din->m_offsets[i], din->m_durations[i], din->m_samples[i]});
 	}
 
 	//Done
@@ -133,12 +178,12 @@ void USB2PCSDecoder::Refresh()
 }
 
 void USB2PCSDecoder::RefreshIterationIdle(
-	size_t nin,
+	const USB2PMASegment& seg,
 	DecodeState& state,
 	BusSpeed& speed,
 	size_t& ui_width,
 	USB2PCSWaveform* cap,
-	USB2PMAWaveform* din,
+	int64_t timescale,
 	size_t& count,
 	int64_t& offset
 	)
@@ -147,8 +192,8 @@ void USB2PCSDecoder::RefreshIterationIdle(
 	const size_t ui_width_12 = 83333000;
 	const size_t ui_width_1 = 666666000;
 
-	size_t sample_fs = din->m_durations[nin] * din->m_timescale;
-	auto sin = din->m_samples[nin];
+	size_t sample_fs = seg.m_duration * timescale;
+	auto sin = seg.m_symbol;
 
 	switch(sin.m_type)
 	{
@@ -160,7 +205,7 @@ void USB2PCSDecoder::RefreshIterationIdle(
 		case USB2PMASymbol::TYPE_K:
 
 			//Begin the sync
-			offset = din->m_offsets[nin];
+			offset = seg.m_offset;
 
 			//The length of the K indicates our clock speed
 			if(sample_fs < (2 * ui_width_480) )
@@ -191,31 +236,31 @@ void USB2PCSDecoder::RefreshIterationIdle(
 		case USB2PMASymbol::TYPE_SE1:
 
 			//Add the error symbol
-			cap->m_offsets.push_back(din->m_offsets[nin]);
-			cap->m_durations.push_back(din->m_durations[nin]);
+			cap->m_offsets.push_back(seg.m_offset);
+			cap->m_durations.push_back(seg.m_duration);
 			cap->m_samples.push_back(USB2PCSSymbol(USB2PCSSymbol::TYPE_ERROR, 0));
 			break;
 	}
 }
 
 void USB2PCSDecoder::RefreshIterationSync(
-	size_t nin,
+	const USB2PMASegment& seg,
 	DecodeState& state,
 	BusSpeed speed,
 	size_t& ui_width,
 	USB2PCSWaveform* cap,
-	USB2PMAWaveform* din,
+	int64_t timescale,
 	size_t& count,
 	int64_t& offset,
 	uint8_t& data,
 	bool& first)
 {
-	size_t sample_fs = din->m_durations[nin] * din->m_timescale;
+	size_t sample_fs = seg.m_duration * timescale;
 	float sample_width_ui = sample_fs * 1.0f / ui_width;
 
 	//Keep track of our position in the sync sequence
 	count ++;
-	auto sin = din->m_samples[nin];
+	auto sin = seg.m_symbol;
 
 
 	bool sync_odd, sync_even;
@@ -251,12 +296,12 @@ void USB2PCSDecoder::RefreshIterationSync(
 			{
 				//Sync until the error happened
 				cap->m_offsets.push_back(offset);
-				cap->m_durations.push_back(din->m_offsets[nin] - offset);
+				cap->m_durations.push_back(seg.m_offset - offset);
 				cap->m_samples.push_back(USB2PCSSymbol(USB2PCSSymbol::TYPE_SYNC, 0));
 
 				//Then error symbol for this K
-				cap->m_offsets.push_back(din->m_offsets[nin]);
-				cap->m_durations.push_back(din->m_durations[nin]);
+				cap->m_offsets.push_back(seg.m_offset);
+				cap->m_durations.push_back(seg.m_duration);
 				cap->m_samples.push_back(USB2PCSSymbol(USB2PCSSymbol::TYPE_ERROR, 0));
 			}
 
@@ -285,12 +330,12 @@ void USB2PCSDecoder::RefreshIterationSync(
 			{
 				//Sync until the error happened
 				cap->m_offsets.push_back(offset);
-				cap->m_durations.push_back(din->m_offsets[nin] - offset);
+				cap->m_durations.push_back(seg.m_offset - offset);
 				cap->m_samples.push_back(USB2PCSSymbol(USB2PCSSymbol::TYPE_SYNC, 0));
 
 				//Then error symbol for this J
-				cap->m_offsets.push_back(din->m_offsets[nin]);
-				cap->m_durations.push_back(din->m_durations[nin]);
+				cap->m_offsets.push_back(seg.m_offset);
+				cap->m_durations.push_back(seg.m_duration);
 				cap->m_samples.push_back(USB2PCSSymbol(USB2PCSSymbol::TYPE_ERROR, 0));
 			}
 
@@ -318,12 +363,12 @@ void USB2PCSDecoder::RefreshIterationSync(
 			{
 				//Sync until the error happened
 				cap->m_offsets.push_back(offset);
-				cap->m_durations.push_back(din->m_offsets[nin] - offset);
+				cap->m_durations.push_back(seg.m_offset - offset);
 				cap->m_samples.push_back(USB2PCSSymbol(USB2PCSSymbol::TYPE_SYNC, 0));
 
 				//Then error symbol for this J
-				cap->m_offsets.push_back(din->m_offsets[nin]);
-				cap->m_durations.push_back(din->m_durations[nin]);
+				cap->m_offsets.push_back(seg.m_offset);
+				cap->m_durations.push_back(seg.m_duration);
 				cap->m_samples.push_back(USB2PCSSymbol(USB2PCSSymbol::TYPE_ERROR, 0));
 			}
 
@@ -340,11 +385,11 @@ void USB2PCSDecoder::RefreshIterationSync(
 
 			//Save the sync symbol
 			cap->m_offsets.push_back(offset);
-			cap->m_durations.push_back(din->m_offsets[nin] + din->m_durations[nin] - offset);
+			cap->m_durations.push_back(seg.m_offset + seg.m_duration - offset);
 			cap->m_samples.push_back(USB2PCSSymbol(USB2PCSSymbol::TYPE_SYNC, 0));
 
 			//New sample starts right after us and contains no data so far
-			offset = din->m_offsets[nin] + din->m_durations[nin];
+			offset = seg.m_offset + seg.m_duration;
 			count = 0;
 			data = 0;
 		}
@@ -354,20 +399,20 @@ void USB2PCSDecoder::RefreshIterationSync(
 		else
 		{
 			//Save the sync symbol
-			int64_t pdelta = 2*ui_width / din->m_timescale;
-			int64_t pstart = din->m_offsets[nin] + pdelta;
+			int64_t pdelta = 2*ui_width / timescale;
+			int64_t pstart = seg.m_offset + pdelta;
 			cap->m_offsets.push_back(offset);
 			cap->m_durations.push_back(pstart - offset);
 			cap->m_samples.push_back(USB2PCSSymbol(USB2PCSSymbol::TYPE_SYNC, 0));
 
 			//Start the new sample and add the 1 bit(s)
 			size_t num_ones = round(sample_width_ui) - 2;
-			size_t old_width = 2 * ui_width / din->m_timescale;
+			size_t old_width = 2 * ui_width / timescale;
 			offset = pstart + old_width;
 			if(num_ones >= 7)	//bitstuff error
 			{
 				cap->m_offsets.push_back(pstart);
-				cap->m_durations.push_back(din->m_durations[nin] - pdelta);
+				cap->m_durations.push_back(seg.m_duration - pdelta);
 				cap->m_samples.push_back(USB2PCSSymbol(USB2PCSSymbol::TYPE_ERROR, 0));
 
 				count = 0;
@@ -391,32 +436,32 @@ void USB2PCSDecoder::RefreshIterationSync(
 }
 
 void USB2PCSDecoder::RefreshIterationData(
-	size_t nin,
-	size_t nlast,
+	const USB2PMASegment& seg,
+	const USB2PMASegment& last,
 	DecodeState& state,
 	BusSpeed speed,
 	size_t& ui_width,
 	USB2PCSWaveform* cap,
-	USB2PMAWaveform* din,
+	int64_t timescale,
 	size_t& count,
 	int64_t& offset,
 	uint8_t& data)
 {
-	size_t sample_fs = din->m_durations[nin] * din->m_timescale;
-	size_t last_sample_fs = din->m_durations[nlast] * din->m_timescale;
+	size_t sample_fs = seg.m_duration * timescale;
+	size_t last_sample_fs = last.m_duration * timescale;
 	float sample_width_ui = sample_fs * 1.0f / ui_width;
 	float last_sample_width_ui = last_sample_fs * 1.0f / ui_width;
 
 	//If this is a SE0, we're done
-	auto sin = din->m_samples[nin];
+	auto sin = seg.m_symbol;
 	if(sin.m_type == USB2PMASymbol::TYPE_SE0)
 	{
 		//If we're not two UIs long, we have a problem
 		//TODO: handle reset
 		if(sample_width_ui < 1.2)
 		{
-			cap->m_offsets.push_back(din->m_offsets[nin]);
-			cap->m_durations.push_back(din->m_durations[nin]);
+			cap->m_offsets.push_back(seg.m_offset);
+			cap->m_durations.push_back(seg.m_duration);
 			cap->m_samples.push_back(USB2PCSSymbol(USB2PCSSymbol::TYPE_ERROR, 0));
 		}
 
@@ -424,8 +469,8 @@ void USB2PCSDecoder::RefreshIterationData(
 		else
 		{
 			//Add the end symbol
-			cap->m_offsets.push_back(din->m_offsets[nin]);
-			cap->m_durations.push_back(din->m_durations[nin] + ui_width/din->m_timescale);
+			cap->m_offsets.push_back(seg.m_offset);
+			cap->m_durations.push_back(seg.m_duration + ui_width/timescale);
 			cap->m_samples.push_back(USB2PCSSymbol(USB2PCSSymbol::TYPE_EOP, 0));
 		}
 		state = STATE_IDLE;
@@ -437,8 +482,8 @@ void USB2PCSDecoder::RefreshIterationData(
 	else if(sin.m_type == USB2PMASymbol::TYPE_SE1)
 	{
 		//Add the error symbol
-		cap->m_offsets.push_back(din->m_offsets[nin]);
-		cap->m_durations.push_back(din->m_durations[nin] + ui_width/din->m_timescale);
+		cap->m_offsets.push_back(seg.m_offset);
+		cap->m_durations.push_back(seg.m_duration + ui_width/timescale);
 		cap->m_samples.push_back(USB2PCSSymbol(USB2PCSSymbol::TYPE_ERROR, 0));
 
 		state = STATE_IDLE;
@@ -452,8 +497,8 @@ void USB2PCSDecoder::RefreshIterationData(
 
 	//For high speed, bitstuff errors should be interpreted as EOP.
 	if(speed == SPEED_480M && num_bits > 7) {
-		cap->m_offsets.push_back(din->m_offsets[nin]);
-		cap->m_durations.push_back(din->m_durations[nin]);
+		cap->m_offsets.push_back(seg.m_offset);
+		cap->m_durations.push_back(seg.m_duration);
 		cap->m_samples.push_back(USB2PCSSymbol(USB2PCSSymbol::TYPE_EOP, 0));
 
 		state = STATE_IDLE;
@@ -485,13 +530,13 @@ void USB2PCSDecoder::RefreshIterationData(
 		if(count == 8)
 		{
 			//Align our end so it looks nice
-			size_t duration = din->m_offsets[nin] - offset;
+			size_t duration = seg.m_offset - offset;
 			if(i+1 == num_bits)
-				duration += din->m_durations[nin];
+				duration += seg.m_duration;
 
 			//No, just move a few UIs over
 			else
-				duration += (i+1)*ui_width / din->m_timescale;
+				duration += (i+1)*ui_width / timescale;
 
 			cap->m_offsets.push_back(offset);
 			cap->m_durations.push_back(duration);
@@ -82,6 +82,7 @@ class USB2PCSDecoder : public Filter
 {
 public:
 	USB2PCSDecoder(const std::string& color);
+	virtual ~USB2PCSDecoder();
 
 	virtual void Refresh() override;
 
@@ -92,6 +93,9 @@ public:
 	PROTOCOL_DECODER_INITPROC(USB2PCSDecoder)
 
 protected:
+	virtual void OnInputChanged(size_t i) override;
+
+
 	enum BusSpeed
 	{
 		SPEED_1M,
@@ -107,23 +111,23 @@ protected:
 	};
 
 	void RefreshIterationIdle(
-		size_t nin,
+		const USB2PMASegment& seg,
 		DecodeState& state,
 		BusSpeed& speed,
 		size_t& ui_width,
 		USB2PCSWaveform* cap,
-		USB2PMAWaveform* din,
+		int64_t timescale,
 		size_t& count,
 		int64_t& offset
 		);
 
 	void RefreshIterationSync(
-		size_t nin,
+		const USB2PMASegment& seg,
 		DecodeState& state,
 		BusSpeed speed,
 		size_t& ui_width,
 		USB2PCSWaveform* cap,
-		USB2PMAWaveform* din,
+		int64_t timescale,
 		size_t& count,
 		int64_t& offset,
 		uint8_t& data,
@@ -131,16 +135,19 @@ protected:
 		);
 
 	void RefreshIterationData(
-		size_t nin,
-		size_t nlast,
+		const USB2PMASegment& seg,
+		const USB2PMASegment& last,
 		DecodeState& state,
 		BusSpeed speed,
 		size_t& ui_width,
 		USB2PCSWaveform* cap,
-		USB2PMAWaveform* din,
+		int64_t timescale,
 		size_t& count,
 		int64_t& offset,
 		uint8_t& data);
+
+	///@brief PMA decoder we are registered with as a fused consumer, if any
+	USB2PMADecoder* m_fusedSource;
 };
 
 #endif
@@ -38,6 +38,7 @@ using namespace std;
 
 USB2PMADecoder::USB2PMADecoder(const string& color)
 	: Filter(color, CAT_SERIAL)
+	, m_fusedConsumers(0)
 {
 	AddProtocolStream("data");
 	CreateInput("D+");
@@ -86,6 +87,45 @@ void USB2PMADecoder::Refresh()
 		return;
 	}
 
+	auto din_p = GetInputWaveform(0);
+
+	//Copy our time scales from the input
+	//Use the first trace's timestamp as our start time if they differ
+	auto cap = new USB2PMAWaveform;
+	cap->m_timescale = din_p->m_timescale;
+	cap->m_startTimestamp = din_p->m_startTimestamp;
+	cap->m_startFemtoseconds = din_p->m_startFemtoseconds;
+	cap->m_triggerPhase = din_p->m_triggerPhase;
+	cap->PrepareForCpuAccess();
+
+	//If the only things reading us decode the line states on the fly, don't bother storing them
+	if( (m_fusedConsumers > 0) && (GetRefCount() == 2*m_fusedConsumers) )
+		cap->m_deferred = true;
+
+	else
+	{
+		SliceLineStates([cap](const USB2PMASegment& seg)
+		{
+			cap->m_offsets.push_back(seg.m_offset);
+			cap->m_durations.push_back(seg.m_duration);
+			cap->m_samples.push_back(seg.m_symbol);
+		});
+	}
+
+	SetData(cap, 0);
+	cap->MarkModifiedFromCpu();
+}
+
+/**
+	@brief Finds the line state of the bus, merging consecutive samples with the same state into one segment
+
+	Segments are passed to the sink one at a time, in order, so consumers can decode them without storing them all.
+	The inputs must already have been checked with VerifyAllInputsOK().
+
+	@param sink	Called once per segment
+ */
+void USB2PMADecoder::SliceLineStates(const function<void(const USB2PMASegment&)>& sink)
+{
 	//Get the input data
 	auto din_p = GetInputWaveform(0);
 	auto din_n = GetInputWaveform(1);
@@ -121,9 +161,10 @@ void USB2PMADecoder::Refresh()
 		break;
 	}
 
-	//Figure out the line state for each input (no clock recovery yet)
-	auto cap = new USB2PMAWaveform;
-	cap->PrepareForCpuAccess();
+	//Figure out the line state for each input (no clock recovery yet).
+	//The segment being built is only passed on once a different state starts, since it may still be extended.
+	USB2PMASegment seg;
+	bool havePending = false;
 	for(size_t i=0; i<len; i++)
 	{
 		auto vp = GetValue(sdin_p, udin_p, i);
@@ -156,49 +197,43 @@ void USB2PMADecoder::Refresh()
 			type = USB2PMASymbol::TYPE_SE0;
 
 		//First sample goes as-is
-		if(cap->m_samples.empty())
+		if(!havePending)
 		{
-			cap->m_offsets.push_back(::GetOffset(sdin_p, udin_p, i));
-			cap->m_durations.push_back(GetDuration(sdin_p, udin_p, i));
-			cap->m_samples.push_back(type);
+			seg.m_offset = ::GetOffset(sdin_p, udin_p, i);
+			seg.m_duration = GetDuration(sdin_p, udin_p, i);
+			seg.m_symbol = type;
+			havePending = true;
 			continue;
 		}
 
 		//Type match? Extend the existing sample
-		size_t iold = cap->size()-1;
-		auto oldtype = cap->m_samples[iold];
+		auto oldtype = seg.m_symbol.m_type;
 		if(oldtype == type)
 		{
-			cap->m_durations[iold] += GetDuration(sdin_p, udin_p, i);
+			seg.m_duration += GetDuration(sdin_p, udin_p, i);
 			continue;
 		}
 
 		//Ignore SE0/SE1 states during transitions.
-		int64_t last_fs = cap->m_durations[iold] * din_p->m_timescale;
+		int64_t last_fs = seg.m_duration * din_p->m_timescale;
 		if(
 			( (oldtype == USB2PMASymbol::TYPE_SE0) || (oldtype == USB2PMASymbol::TYPE_SE1) ) &&
 			(last_fs < transition_time))
 		{
-			cap->m_samples[iold].m_type = type;
-			cap->m_durations[iold] += GetDuration(sdin_p, udin_p, i);
+			seg.m_symbol.m_type = type;
+			seg.m_duration += GetDuration(sdin_p, udin_p, i);
 			continue;
 		}
 
-		//Not a match. Add a new sample.
-		cap->m_offsets.push_back(::GetOffset(sdin_p, udin_p, i));
-		cap->m_durations.push_back(GetDuration(sdin_p, udin_p, i));
-		cap->m_samples.push_back(type);
+		//Not a match. Finish the old segment and start a new one.
+		sink(seg);
+		seg.m_offset = ::GetOffset(sdin_p, udin_p, i);
+		seg.m_duration = GetDuration(sdin_p, udin_p, i);
+		seg.m_symbol = type;
 	}
 
-	SetData(cap, 0);
-
-	//Copy our time scales from the input
-	//Use the first trace's timestamp as our start time if they differ
-	cap->m_timescale = din_p->m_timescale;
-	cap->m_startTimestamp = din_p->m_startTimestamp;
-	cap->m_startFemtoseconds = din_p->m_startFemtoseconds;
-	cap->m_triggerPhase = din_p->m_triggerPhase;
-	cap->MarkModifiedFromCpu();
+	if(havePending)
+		sink(seg);
 }
 
 std::string USB2PMAWaveform::GetColor(size_t i)
@@ -63,12 +63,35 @@ public:
 	}
 };
 
+/**
+	@brief One run of constant line state
+ */
+class USB2PMASegment
+{
+public:
+	///@brief Start of the run, in the input's timescale
+	int64_t m_offset;
+
+	///@brief Length of the run, in the input's timescale
+	int64_t m_duration;
+
+	///@brief Line state
+	USB2PMASymbol m_symbol;
+};
+
 class USB2PMAWaveform : public SparseWaveform<USB2PMASymbol>
 {
 public:
-	USB2PMAWaveform () : SparseWaveform<USB2PMASymbol>() {};
+	USB2PMAWaveform () : SparseWaveform<USB2PMASymbol>(), m_deferred(false) {};
 	virtual std::string GetText(size_t) override;
 	virtual std::string GetColor(size_t) override;
+
+	/**
+		@brief True if the decoder skipped filling in this waveform because only fused consumers are reading it
+
+		Only the timebase is valid. Consumers get the line states from USB2PMADecoder::SliceLineStates() instead.
+	 */
+	bool m_deferred;
 };
 
 class USB2PMADecoder : public Filter
@@ -92,10 +115,32 @@ public:
 	void SetSpeed(Speed s)
 	{ m_parameters[m_speedname].SetIntVal(s); }
 
+	/**
+		@brief Slices the current input into runs of constant line state, calling sink once per run in time order
+	 */
+	void SliceLineStates(const std::function<void(const USB2PMASegment&)>& sink);
+
+	/**
+		@brief Registers a consumer which can read line states straight from SliceLineStates()
+
+		Each fused consumer must also hold one extra reference to us (on top of its input connection) for as long as
+		it is registered. If every reference is from a fused consumer, nobody needs the symbols themselves, and
+		Refresh() outputs an empty waveform with m_deferred set rather than materializing one symbol per run.
+	 */
+	void AddFusedConsumer()
+	{ m_fusedConsumers ++; }
+
+	///@brief Unregisters a consumer added by AddFusedConsumer()
+	void RemoveFusedConsumer()
+	{ m_fusedConsumers --; }
+
 	PROTOCOL_DECODER_INITPROC(USB2PMADecoder)
 
 protected:
 	std::string m_speedname;
+
+	///@brief Number of consumers registered with AddFusedConsumer()
+	size_t m_fusedConsumers;
 };
 
 #endif
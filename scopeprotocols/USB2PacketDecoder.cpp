@@ -352,21 +352,8 @@ void USB2PacketDecoder::Refresh()
  */
 uint16_t USB2PacketDecoder::CalculateCRC16(const std::vector<uint8_t>& data)
 {
-	uint16_t poly = 0xa001;
-	uint16_t crc = 0xffff;
-
-	for(size_t n=0; n<data.size(); n++)
-	{
-		uint8_t d = data[n];
-
-		for(int i=0; i<8; i++)
-		{
-			bool b = ( crc ^ (d >> i) ) & 1;
-			crc >>= 1;
-			if(b)
-				crc ^= poly;
-		}
-	}
+	static const ReflectedCRCTable table(0xa001);
+	uint16_t crc = table.Update(0xffff, data.data(), data.size());
 
 	return ~( (crc << 8) | ( (crc >> 8) & 0xff) );
 }
@@ -102,28 +102,14 @@ void UnwrappedPhaseFilter::Refresh()
 	cap->Resize(len);
 	cap->m_timescale = 1;
 
-	//Main output loop
-	float phase = GetValue(sang, uang, 0);
+	//Unwrap (assume +/- 180 deg range at input). Output sample i is the unwrapped phase after step i
+	auto pin = uang ? uang->m_samples.GetCpuPointer() : sang->m_samples.GetCpuPointer();
+	UnwrapPhase(pin, len+1, cap->m_samples.GetCpuPointer(), 1);
+
 	for(size_t i=0; i<len; i++)
 	{
-		//Subtract phase angles, wrapping correctly around singularities
-		//(assume +/- 180 deg range at input)
-		float phase_hi = GetValue(sang, uang, i+1);
-		float phase_lo = GetValue(sang, uang, i);
-		if(fabs(phase_lo - phase_hi) > 180)
-		{
-			if(phase_lo < phase_hi)
-				phase_lo += 360;
-			else
-				phase_hi += 360;
-		}
-		float dphase = phase_hi - phase_lo;
-
-		phase += dphase;
-
 		cap->m_offsets[i] = GetOffsetScaled(sang, uang, i);
 		cap->m_durations[i] = GetDurationScaled(sang, uang, i);
-		cap->m_samples[i] = phase;
 	}
 
 	cap->MarkModifiedFromCpu();
@@ -27,44 +27,16 @@
 *                                                                                                                      *
 ***********************************************************************************************************************/
 
-#ifdef _WIN32
-#include <cmath>
-#endif
-
 #include "../scopehal/scopehal.h"
 #include "UpsampleFilter.h"
 
 using namespace std;
 
-float sinc(float x, float width);
-float blackman(float x, float width);
-
-float sinc(float x, float width)
-{
-	float xi = x - width/2;
-
-	if(fabs(xi) < 1e-7)
-		return 1.0f;
-	else
-	{
-		float px = M_PI*xi;
-		return sin(px) / px;
-	}
-}
-
-float blackman(float x, float width)
-{
-	if(x > width)
-		return 0;
-	return 0.42 - 0.5*cos(2*M_PI * x / width) + 0.08 * cos(4*M_PI*x/width);
-}
-
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Construction / destruction
 
 UpsampleFilter::UpsampleFilter(const string& color)
 	: Filter(color, CAT_MATH)
-	, m_computePipeline("shaders/UpsampleFilter.spv", 3, sizeof(UpsampleFilterArgs))
 {
 	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_ANALOG);
 	CreateInput("din");
@@ -73,9 +45,9 @@ UpsampleFilter::UpsampleFilter(const string& color)
 	m_parameters[m_factorname] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_SAMPLEDEPTH));
 	m_parameters[m_factorname].SetIntVal(10);
 
-	//Use pinned memory for filter kernel
-	m_filter.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
-	m_filter.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
+	m_downfactorname = "Downsample factor";
+	m_parameters[m_downfactorname] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_SAMPLEDEPTH));
+	m_parameters[m_downfactorname].SetIntVal(1);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -115,93 +87,35 @@ void UpsampleFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHa
 	}
 
 	//Configuration parameters (TODO: allow window to be user specified)
-	size_t upsample_factor = m_parameters[m_factorname].GetIntVal();
+	int64_t upsample_factor = m_parameters[m_factorname].GetIntVal();
+	int64_t downsample_factor = m_parameters[m_downfactorname].GetIntVal();
 	size_t window = 5;
-	size_t kernel = window*upsample_factor;
-	if(upsample_factor <= 0)
+	if( (upsample_factor <= 0) || (downsample_factor <= 0) )
 	{
 		SetData(NULL, 0);
 		return;
 	}
 
-	//Create the interpolation filter
-	//TODO: if upsampling factor and window size have not changed, keep the same filter coefficients
-	//(no need to push every time)
-	float frac_kernel = kernel * 1.0f / upsample_factor;
-	m_filter.resize(kernel);
-	m_filter.PrepareForCpuAccess();
-	for(size_t i=0; i<kernel; i++)
+	//Create the interpolation filter (only recomputed if the ratio changed)
+	m_resampler.SetWindowedSinc(upsample_factor, downsample_factor, window);
+
+	//The kernel reads taps-1 samples past each output's input sample
+	size_t len = din->size();
+	size_t margin = m_resampler.GetTapCount() - 1;
+	if(len <= margin)
 	{
-		float frac = i*1.0f / upsample_factor;
-		m_filter[i] = sinc(frac, frac_kernel) * blackman(frac, frac_kernel);
+		SetData(NULL, 0);
+		return;
 	}
-	m_filter.MarkModifiedFromCpu();
+	size_t imax = len - margin;
+	size_t outlen = (imax*upsample_factor) / downsample_factor;
 
 	//Create the output and configure it
 	auto cap = SetupEmptyUniformAnalogOutputWaveform(din, 0);
-	cap->m_timescale = din->m_timescale / upsample_factor;
-	size_t len = din->size();
-	size_t imax = len - window;
-	size_t outlen = imax*upsample_factor;
+	cap->m_timescale = din->m_timescale * downsample_factor / upsample_factor;
 	cap->Resize(outlen);
 
-	if(g_gpuFilterEnabled)
-	{
-		cmdBuf.begin({});
-
-		//Update our descriptor sets with current buffers
-		m_computePipeline.BindBufferNonblocking(0, din->m_samples, cmdBuf);
-		m_computePipeline.BindBufferNonblocking(1, m_filter, cmdBuf);
-		m_computePipeline.BindBufferNonblocking(2, cap->m_samples, cmdBuf, true);
-
-		UpsampleFilterArgs args;
-		args.imax = imax;
-		args.upsample_factor = upsample_factor;
-		args.kernel = kernel;
-
-		const uint32_t compute_block_count = GetComputeBlockCount(len, 64);
-		m_computePipeline.Dispatch(cmdBuf, args,
-			min(compute_block_count, 32768u),
-			compute_block_count / 32768 + 1,
-			GetComputeBlockCount(upsample_factor, 1));
-
-		//Done, submit to the queue and wait
-		cmdBuf.end();
-		queue->SubmitAndBlock(cmdBuf);
-		cap->MarkModifiedFromGpu();
-	}
-
-	else
-	{
-		din->PrepareForCpuAccess();
-		cap->PrepareForCpuAccess();
-
-		//Logically, we upsample by inserting zeroes, then convolve with the sinc filter.
-		//Optimization: don't actually waste time multiplying by zero
-		#pragma omp parallel for
-		for(size_t i=0; i < imax; i++)
-		{
-			size_t offset = i * upsample_factor;
-			for(size_t j=0; j<upsample_factor; j++)
-			{
-				size_t start = 0;
-				size_t sstart = 0;
-				if(j > 0)
-				{
-					sstart = 1;
-					start = upsample_factor - j;
-				}
-
-				float f = 0;
-				for(size_t k = start; k<kernel; k += upsample_factor, sstart ++)
-					f += m_filter[k] * din->m_samples[i + sstart];
-
-				cap->m_samples[offset + j] = f;
-			}
-		}
-
-		cap->MarkModifiedFromCpu();
-	}
+	m_resampler.Run(cmdBuf, queue, din, cap, IsGpuPreferred());
 }
 
 Filter::DataLocation UpsampleFilter::GetInputLocation()
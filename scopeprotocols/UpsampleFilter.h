@@ -35,15 +35,13 @@
 #ifndef UpsampleFilter_h
 #define UpsampleFilter_h
 
-class QueueHandle;
+#include "PolyphaseResampler.h"
 
-struct UpsampleFilterArgs
-{
-	uint32_t imax;
-	uint32_t upsample_factor;
-	uint32_t kernel;
-};
+class QueueHandle;
 
+/**
+	@brief Resamples a uniform analog waveform by a rational factor, upsampling by P then decimating by Q
+ */
 class UpsampleFilter : public Filter
 {
 public:
@@ -60,10 +58,9 @@ public:
 
 protected:
 	std::string m_factorname;
+	std::string m_downfactorname;
 
-	AcceleratorBuffer<float> m_filter;
-
-	ComputePipeline m_computePipeline;
+	PolyphaseResampler m_resampler;
 };
 
 #endif
@@ -29,6 +29,7 @@
 
 #include "../scopehal/scopehal.h"
 #include "VCDImportFilter.h"
+#include <omp.h>
 
 using namespace std;
 
@@ -43,6 +44,13 @@ VCDImportFilter::VCDImportFilter(const string& color)
 	m_parameters[m_fpname].m_fileFilterMask = "*.vcd";
 	m_parameters[m_fpname].m_fileFilterName = "Value Change Dump files (*.vcd)";
 	m_parameters[m_fpname].signal_changed().connect(sigc::mem_fun(*this, &VCDImportFilter::OnFileNameChanged));
+
+	//Comma separated list of name fragments to import, or empty for everything
+	m_signalsname = "Signals";
+	m_parameters[m_signalsname] = FilterParameter(FilterParameter::TYPE_STRING, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_signalsname].SetStringVal("");
+	m_parameters[m_signalsname].signal_changed().connect(
+		sigc::mem_fun(*this, &VCDImportFilter::OnFileNameChanged));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -53,29 +61,257 @@ string VCDImportFilter::GetProtocolName()
 	return "VCD Import";
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Symbol table
+
+/**
+	@brief Packs an identifier of up to 8 characters into an integer
+
+	VCD identifiers are printable ASCII and never contain a NUL, so this is unique for any given length.
+ */
+uint64_t VCDImportFilter::VCDSymbolTable::Pack(const char* p, size_t len)
+{
+	uint64_t ret = 0;
+	for(size_t i=0; i<len; i++)
+		ret = (ret << 8) | static_cast<uint8_t>(p[i]);
+	return ret;
+}
+
+void VCDImportFilter::VCDSymbolTable::Add(const char* p, size_t len, int index)
+{
+	if(len <= 8)
+		m_short[Pack(p, len)] = index;
+	else
+		m_long[string(p, len)] = index;
+}
+
+/**
+	@brief Looks up an identifier
+
+	@return Signal index, SYMBOL_SKIPPED, or SYMBOL_UNKNOWN
+ */
+int VCDImportFilter::VCDSymbolTable::Find(const char* p, size_t len) const
+{
+	if(len <= 8)
+	{
+		auto it = m_short.find(Pack(p, len));
+		return (it == m_short.end()) ? SYMBOL_UNKNOWN : it->second;
+	}
+
+	auto it = m_long.find(string(p, len));
+	return (it == m_long.end()) ? SYMBOL_UNKNOWN : it->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Value change parsing
+
+/**
+	@brief Tokenizes one partition of the value change section, calling onValue for every value change
+
+	onValue(signal, timestamp, value, valueLen) gets the signal index, the current timestamp, and the value with
+	any leading 'b' stripped (so "1" for a scalar, or the MSB-first bit string of a vector).
+
+	Both passes go through here, so they always agree on which value changes exist.
+ */
+template<class F>
+void VCDImportFilter::WalkPartition(
+	VCDPartition& part,
+	const VCDSymbolTable& symbols,
+	const vector<VCDSignal>& signals,
+	F onValue)
+{
+	int64_t current_time = 0;
+	const char* p = part.begin;
+	const char* end = part.end;
+
+	//Contents of $comment, $dumpall and $dumpoff are skipped
+	bool skipBlock = false;
+
+	while(true)
+	{
+		//Find the next whitespace separated token
+		while( (p < end) && isspace(*p) )
+			p++;
+		if(p >= end)
+			break;
+		const char* tok = p;
+		while( (p < end) && !isspace(*p) )
+			p++;
+		size_t len = p - tok;
+
+		//Keywords
+		if(tok[0] == '$')
+		{
+			if( (len == 4) && !memcmp(tok, "$end", 4) )
+				skipBlock = false;
+			else if( (len == 8) && !memcmp(tok, "$comment", 8) )
+				skipBlock = true;
+			else if( (len == 8) && !memcmp(tok, "$dumpall", 8) )
+				skipBlock = true;
+			else if( (len == 8) && !memcmp(tok, "$dumpoff", 8) )
+				skipBlock = true;
+
+			//$dumpvars and $dumpon contain value changes, parse them like any others
+			continue;
+		}
+		if(skipBlock)
+			continue;
+
+		//Changing time
+		if(tok[0] == '#')
+		{
+			current_time = 0;
+			for(size_t i=1; i<len; i++)
+				current_time = (current_time * 10) + (tok[i] - '0');
+			continue;
+		}
+
+		//Vector and real values are followed by a separate identifier token
+		const char* value = tok;
+		size_t vlen = 1;
+		const char* id = tok + 1;
+		size_t idlen = len - 1;
+		bool isVector = (tok[0] == 'b') || (tok[0] == 'B');
+		bool isReal = (tok[0] == 'r') || (tok[0] == 'R');
+		if(isVector || isReal)
+		{
+			value = tok + 1;
+			vlen = len - 1;
+
+			while( (p < end) && isspace(*p) )
+				p++;
+			id = p;
+			while( (p < end) && !isspace(*p) )
+				p++;
+			idlen = p - id;
+		}
+		if(idlen == 0)
+			continue;
+
+		int sig = symbols.Find(id, idlen);
+		if(sig == SYMBOL_SKIPPED)
+			continue;
+		if(sig == SYMBOL_UNKNOWN)
+		{
+			part.unknownSymbols ++;
+			continue;
+		}
+
+		//Real values aren't supported, and scalars can't go on buses.
+		//Vectors on single bit signals are fine though, some tools dump them that way.
+		if(isReal || (vlen == 0) || (!isVector && (signals[sig].width != 1)) )
+		{
+			part.mismatchedValues ++;
+			continue;
+		}
+		if(signals[sig].width == 1)
+		{
+			value = value + vlen - 1;
+			vlen = 1;
+		}
+
+		onValue(sig, current_time, value, vlen);
+	}
+}
+
+/**
+	@brief First pass: counts value changes per signal, so waveforms can be allocated at exactly the right size
+ */
+void VCDImportFilter::ScanPartition(VCDPartition& part, const VCDSymbolTable& symbols, vector<VCDSignal>& signals)
+{
+	part.counts.assign(signals.size(), 0);
+	WalkPartition(part, symbols, signals,
+		[&part](int sig, int64_t /*timestamp*/, const char* /*value*/, size_t /*vlen*/)
+		{ part.counts[sig] ++; });
+}
+
+/**
+	@brief Second pass: writes value changes into the waveforms, starting at the indexes in part.counts
+ */
+void VCDImportFilter::ParsePartition(VCDPartition& part, const VCDSymbolTable& symbols, vector<VCDSignal>& signals)
+{
+	//The first pass already tallied these
+	part.unknownSymbols = 0;
+	part.mismatchedValues = 0;
+
+	WalkPartition(part, symbols, signals,
+		[&part, &signals](int sig, int64_t timestamp, const char* value, size_t vlen)
+		{
+			auto& s = signals[sig];
+			size_t i = part.counts[sig] ++;
+
+			if(s.bit)
+			{
+				s.bit->m_offsets[i] = timestamp;
+				s.bit->m_samples[i] = (value[0] == '1');
+			}
+			else
+			{
+				s.bus->m_offsets[i] = timestamp;
+
+				//Bits are MSB first and may be truncated, in which case the rest are zero (x and z read as zero)
+				uint64_t sample = 0;
+				for(size_t j=0; (j < vlen) && (j < s.width); j++)
+					sample |= static_cast<uint64_t>(value[vlen - 1 - j] == '1') << j;
+				s.bus->m_samples[i] = sample;
+			}
+		});
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
+/**
+	@brief Checks if a signal matches the "Signals" parameter
+
+	@param name		Full hierarchical name of the signal
+	@param patterns	Comma separated fragments from the parameter. Empty to import everything.
+ */
+bool VCDImportFilter::IsSignalSelected(const string& name, const vector<string>& patterns)
+{
+	if(patterns.empty())
+		return true;
+	for(auto& p : patterns)
+	{
+		if(name.find(p) != string::npos)
+			return true;
+	}
+	return false;
+}
+
 void VCDImportFilter::OnFileNameChanged()
 {
 	auto fname = m_parameters[m_fpname].ToString();
 	if(fname.empty())
 		return;
 
+	double start = GetTime();
+
 	//Set waveform timestamp to file timestamp
 	time_t timestamp = 0;
 	int64_t fs = 0;
 	GetTimestampOfFile(fname, timestamp, fs);
 
-	FILE* fp = fopen(fname.c_str(), "r");
-	if(!fp)
+	//Map the file rather than reading it line by line. Simulator dumps can be many GB.
+	MappedFile file;
+	if(!file.Open(fname))
 	{
 		LogError("Couldn't open VCD file \"%s\"\n", fname.c_str());
 		return;
 	}
+	auto buf = reinterpret_cast<const char*>(file.GetData());
+	auto pend = buf + file.GetSize();
 
 	ClearStreams();
 
+	vector<string> patterns;
+	for(auto p : explode(m_parameters[m_signalsname].ToString(), ','))
+	{
+		p = Trim(p);
+		if(!p.empty())
+			patterns.push_back(p);
+	}
+
 	enum
 	{
 		STATE_IDLE,
@@ -83,35 +319,37 @@ void VCDImportFilter::OnFileNameChanged()
 		STATE_VERSION,
 		STATE_TIMESCALE,
 		STATE_VARS,
-		STATE_INITIAL,
-		STATE_DUMP,
-		STATE_DUMPALL,
 		STATE_COMMENT
 	} state = STATE_IDLE;
 
 	int64_t timescale = 1;
 
-	int64_t current_time = 0;
-
 	//Current scope prefix for signals
 	vector<string> scope;
 
-	//Map of signal IDs to signals
-	map<string, WaveformBase*> waveforms;
-	map<string, size_t> widths;
+	//Declared signals, and the identifiers they're dumped under
+	vector<VCDSignal> signals;
+	vector<string> signalNames;
+	VCDSymbolTable symbols;
 
-	//VCD is a line based format, so process everything in lines
-	char buf[2048];
-	while(NULL != fgets(buf, sizeof(buf), fp))
+	//The header is line based, so process it in lines, up to the end of the definitions
+	const char* dataStart = pend;
+	const char* pbuf = buf;
+	while(pbuf < pend)
 	{
-		string s = Trim(buf);
+		auto nl = reinterpret_cast<const char*>(memchr(pbuf, '\n', pend - pbuf));
+		const char* next = nl ? (nl + 1) : pend;
+		string line(pbuf, nl ? nl : pend);
+		pbuf = next;
 
-		//Changing time is always legal, even before we get to the main variable dumping section.
-		//(Xilinx Vivado-generated VCDs include a #0 before the $dumpvars section.)
-		if(s[0] == '#')
-		{
-			current_time = stoll(buf+1);
+		string s = Trim(line);
+		if(s.empty())
 			continue;
+
+		if(s.find("$enddefinitions") != string::npos)
+		{
+			dataStart = next;
+			break;
 		}
 
 		//Scope is a bit special since it can nest. Handle that separately.
@@ -119,7 +357,7 @@ void VCDImportFilter::OnFileNameChanged()
 		{
 			//Get the actual scope
 			char name[128];
-			if(1 == sscanf(buf, "$scope module %127s", name))
+			if(1 == sscanf(line.c_str(), " $scope module %127s", name))
 				scope.push_back(name);
 			state = STATE_VARS;
 			continue;
@@ -135,16 +373,22 @@ void VCDImportFilter::OnFileNameChanged()
 					state = STATE_VERSION;
 				else if(s == "$timescale")
 					state = STATE_TIMESCALE;
-				else if(s == "$dumpvars")
-					state = STATE_INITIAL;
-				else if(s == "$dumpall")
-					state = STATE_DUMPALL;
 				else if(s.find("$comment") == 0)
 				{
 					if(s.find("$end") == string::npos)
 						state = STATE_COMMENT;
 					//else one-line comment, ignore but stay in idle state
 				}
+				else if(s.find("$timescale") == 0)
+				{
+					//One-line timescale, e.g. "$timescale 1ps $end"
+					auto body = Trim(s.substr(10));
+					auto iend = body.find("$end");
+					if(iend != string::npos)
+						body = Trim(body.substr(0, iend));
+					Unit ufs(Unit::UNIT_FS);
+					timescale = ufs.ParseString(body);
+				}
 				else
 					LogWarning("Don't know what to do with line %s\n", s.c_str());
 				break;	//end STATE_IDLE
@@ -164,7 +408,7 @@ void VCDImportFilter::OnFileNameChanged()
 					char dow[16];
 					char month[16];
 					if(7 == sscanf(
-						buf,
+						s.c_str(),
 						"%3s %3s %d %d:%d:%d %d",
 						dow, month, &stamp.tm_mday, &stamp.tm_hour, &stamp.tm_min, &stamp.tm_sec, &stamp.tm_year))
 					{
@@ -208,6 +452,7 @@ void VCDImportFilter::OnFileNameChanged()
 				break;	//end STATE_DATE;
 
 			case STATE_VERSION:
+			case STATE_COMMENT:
 				//ignore
 				break;	//end STATE_VERSION
 
@@ -217,7 +462,7 @@ void VCDImportFilter::OnFileNameChanged()
 					Unit ufs(Unit::UNIT_FS);
 					timescale = ufs.ParseString(s);
 				}
-				break;	//end STATE_VERSION
+				break;	//end STATE_TIMESCALE
 
 			case STATE_VARS:
 				if(s.find("$upscope") != string::npos)
@@ -225,8 +470,6 @@ void VCDImportFilter::OnFileNameChanged()
 					if(!scope.empty())
 						scope.pop_back();
 				}
-				else if(s.find("$enddefinitions") != string::npos)
-					state = STATE_IDLE;
 				else
 				{
 					//Format the current scope
@@ -239,130 +482,159 @@ void VCDImportFilter::OnFileNameChanged()
 					int width;
 					char symbol[16];
 					char name[128];
-					if(4 != sscanf(buf, " $var %15[^ ] %d %15[^ ] %127[^ ]", vtype, &width, symbol, name))
+					if(4 != sscanf(line.c_str(), " $var %15[^ ] %d %15[^ ] %127[^ ]", vtype, &width, symbol, name))
 						continue;
+					size_t symlen = strlen(symbol);
 
 					//If the symbol is already in use, skip it.
 					//We don't support one symbol with more than one name for now
-					if(waveforms.find(symbol) != waveforms.end())
+					if(symbols.Find(symbol, symlen) != SYMBOL_UNKNOWN)
 						continue;
 
-					//Create the stream
-					AddDigitalStream(sscope + name);
-
-					//Create the waveform
-					WaveformBase* wfm;
-					if(width == 1)
-						wfm = new SparseDigitalWaveform;
-					else
-						wfm = new SparseDigitalBusWaveform;
-					wfm->PrepareForCpuAccess();
-
-					wfm->m_timescale = timescale;
-					wfm->m_startTimestamp = timestamp;
-					wfm->m_startFemtoseconds = fs;
-					wfm->m_triggerPhase = 0;
-					waveforms[symbol] = wfm;
-					widths[symbol] = width;
-					SetData(wfm, m_streams.size() - 1);
-				}
-				break;	//end STATE_VARS
-
-			case STATE_INITIAL:
-			case STATE_DUMP:
-
-				//Parse the current line
-				if(s[0] != '$')
-				{
-					//Vector: first char is 'b', then data, space, symbol name
-					if(s[0] == 'b')
+					//Signals we aren't importing are still entered, so their value changes are skipped quietly
+					string fullname = sscope + name;
+					if( (width < 1) || !IsSignalSelected(fullname, patterns) )
 					{
-						auto ispace = s.find(' ');
-						auto symbol = s.substr(ispace + 1);
-						auto wfm = dynamic_cast<SparseDigitalBusWaveform*>(waveforms[symbol]);
-						if(wfm)
-						{
-							//Parse the sample data (skipping the leading 'b')
-							vector<bool> sample;
-							for(size_t i = ispace-1; i > 0; i--)
-							{
-								if(s[i] == '1')
-									sample.push_back(true);
-								else
-									sample.push_back(false);
-							}
-
-							//Zero-pad the sample out to full width
-							auto width = widths[symbol];
-							while(sample.size() < width)
-								sample.push_back(false);
-
-							//Extend the previous sample, if there is one
-							auto len = wfm->size();
-							if(len)
-							{
-								auto last = len-1;
-								wfm->m_durations[last] = current_time - wfm->m_offsets[last];
-							}
-
-							//Add the new sample
-							wfm->m_offsets.push_back(current_time);
-							wfm->m_durations.push_back(1);
-							wfm->m_samples.push_back(sample);
-							wfm->MarkModifiedFromCpu();
-						}
-						else
-							LogError("Symbol \"%s\" is not a valid digital bus waveform\n", symbol.c_str());
+						symbols.Add(symbol, symlen, SYMBOL_SKIPPED);
+						continue;
 					}
 
-					//Scalar: first char is boolean value, rest is symbol name
-					else
+					//Bus samples are packed into 64-bit words
+					if(width > 64)
 					{
-						auto symbol = s.substr(1);
-						auto wfm = dynamic_cast<SparseDigitalWaveform*>(waveforms[symbol]);
-						if(wfm)
-						{
-							//Extend the previous sample, if there is one
-							auto len = wfm->size();
-							if(len)
-							{
-								auto last = len-1;
-								wfm->m_durations[last] = current_time - wfm->m_offsets[last];
-							}
-
-							//Add the new sample
-							wfm->m_offsets.push_back(current_time);
-							wfm->m_durations.push_back(1);
-							wfm->m_samples.push_back(s[0] == '1');
-							wfm->MarkModifiedFromCpu();
-						}
-						else
-							LogError("Symbol \"%s\" is not a valid digital waveform\n", symbol.c_str());
+						LogWarning("%s is %d bits wide, only the low 64 bits will be imported\n", fullname.c_str(), width);
+						width = 64;
 					}
+
+					VCDSignal sig;
+					sig.width = width;
+					sig.count = 0;
+					sig.bit = nullptr;
+					sig.bus = nullptr;
+					symbols.Add(symbol, symlen, signals.size());
+					signals.push_back(sig);
+					signalNames.push_back(fullname);
+				}
+				break;	//end STATE_VARS
+		}
+
+		//Reset at the end of a block
+		if( (s.find("$end") != string::npos) && (state != STATE_VARS) )
+			state = STATE_IDLE;
+	}
+
+	//Nothing to do if we didn't get any channels
+	if(signals.empty())
+		return;
+
+	//Split the value changes into partitions starting at timestamps, a few per thread so uneven density balances out
+	const size_t minPartitionSize = 1024 * 1024;
+	size_t datalen = pend - dataStart;
+	size_t npart = max(static_cast<size_t>(1), min(datalen / minPartitionSize, static_cast<size_t>(omp_get_max_threads() * 4)));
+	vector<VCDPartition> partitions(npart);
+	for(size_t i=0; i<npart; i++)
+	{
+		auto& part = partitions[i];
+		if(i == 0)
+			part.begin = dataStart;
+		else
+		{
+			//Move forward to the start of the next line beginning with a timestamp
+			const char* p = dataStart + (datalen * i) / npart;
+			p = max(p, partitions[i-1].begin);
+			while(p < pend)
+			{
+				auto nl = reinterpret_cast<const char*>(memchr(p, '\n', pend - p));
+				if(!nl)
+				{
+					p = pend;
+					break;
 				}
+				p = nl + 1;
+				if( (p < pend) && (*p == '#') )
+					break;
+			}
+			part.begin = p;
+		}
+	}
+	for(size_t i=0; i<npart; i++)
+		partitions[i].end = (i+1 < npart) ? partitions[i+1].begin : pend;
 
-				break;	//end STATE_INITIAL / STATE_DUMP
+	//First pass: count value changes for each signal
+	#pragma omp parallel for
+	for(size_t i=0; i<npart; i++)
+		ScanPartition(partitions[i], symbols, signals);
 
-			case STATE_COMMENT:
-			case STATE_DUMPALL:
-				//nothing to do, ignore them
-				break;
+	size_t unknownSymbols = 0;
+	size_t mismatchedValues = 0;
+	for(auto& part : partitions)
+	{
+		for(size_t i=0; i<signals.size(); i++)
+		{
+			//Turn the per-partition counts into the index of each partition's first value change
+			size_t n = part.counts[i];
+			part.counts[i] = signals[i].count;
+			signals[i].count += n;
 		}
+		unknownSymbols += part.unknownSymbols;
+		mismatchedValues += part.mismatchedValues;
+	}
+	if(unknownSymbols)
+		LogWarning("%zu value changes were for undeclared symbols\n", unknownSymbols);
+	if(mismatchedValues)
+		LogWarning("%zu value changes were real values, or scalars on buses, and were ignored\n", mismatchedValues);
 
-		//Reset at the end of a block
-		if(s.find("$end") != string::npos)
+	//Create the streams and waveforms, at their final size
+	for(size_t i=0; i<signals.size(); i++)
+	{
+		auto& sig = signals[i];
+		AddDigitalStream(signalNames[i]);
+
+		WaveformBase* wfm;
+		if(sig.width == 1)
+		{
+			sig.bit = new SparseDigitalWaveform;
+			wfm = sig.bit;
+		}
+		else
 		{
-			if(state == STATE_INITIAL)
-				state = STATE_DUMP;
-			else if(state != STATE_VARS)
-				state = STATE_IDLE;
+			sig.bus = new SparseDigitalBusWaveform(sig.width);
+			wfm = sig.bus;
 		}
+		wfm->Resize(sig.count);
+		wfm->PrepareForCpuAccess();
+
+		wfm->m_timescale = timescale;
+		wfm->m_startTimestamp = timestamp;
+		wfm->m_startFemtoseconds = fs;
+		wfm->m_triggerPhase = 0;
+		SetData(wfm, m_streams.size() - 1);
 	}
-	fclose(fp);
 
-	//Nothing to do if we didn't get any channels
-	if(m_streams.empty())
-		return;
+	//Second pass: value changes, written straight into the waveforms
+	#pragma omp parallel for
+	for(size_t i=0; i<npart; i++)
+	{
+		ParsePartition(partitions[i], symbols, signals);
+		file.Release(partitions[i].begin - buf, partitions[i].end - partitions[i].begin);
+	}
+
+	//Each sample lasts until the next one (the last one is one tick long)
+	#pragma omp parallel for
+	for(size_t i=0; i<signals.size(); i++)
+	{
+		auto& sig = signals[i];
+		SparseWaveformBase* wfm = sig.bit;
+		if(!wfm)
+			wfm = sig.bus;
+
+		size_t len = sig.count;
+		for(size_t j=0; j+1 < len; j++)
+			wfm->m_durations[j] = wfm->m_offsets[j+1] - wfm->m_offsets[j];
+		if(len)
+			wfm->m_durations[len-1] = 1;
+		wfm->MarkModifiedFromCpu();
+	}
 
 	//Find the longest common prefix from all signal names
 	auto prefix = m_streams[0].m_name;
@@ -383,4 +655,6 @@ void VCDImportFilter::OnFileNameChanged()
 		m_streams[i].m_name = m_streams[i].m_name.substr(prefix.length());
 
 	m_outputsChangedSignal.emit();
+
+	LogTrace("VCD loading took %.3f sec (%zu signals, %zu partitions)\n", GetTime() - start, signals.size(), npart);
 }
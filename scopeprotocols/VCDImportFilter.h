@@ -35,6 +35,8 @@
 #ifndef VCDImportFilter_h
 #define VCDImportFilter_h
 
+#include <unordered_map>
+
 class VCDImportFilter : public ImportFilter
 {
 public:
@@ -46,6 +48,92 @@ public:
 
 protected:
 	void OnFileNameChanged();
+
+	///@brief Symbol table entry for a value not in the table
+	static const int SYMBOL_UNKNOWN = -2;
+
+	///@brief Symbol table entry for a declared signal which isn't being imported
+	static const int SYMBOL_SKIPPED = -1;
+
+	/**
+		@brief Maps VCD identifier codes to signal indexes (or SYMBOL_SKIPPED)
+
+		Identifiers of up to 8 characters (almost all of them) are packed into an integer key, so the
+		per-value-change lookup doesn't have to build a string.
+	 */
+	class VCDSymbolTable
+	{
+	public:
+		void Add(const char* p, size_t len, int index);
+		int Find(const char* p, size_t len) const;
+
+	protected:
+		static uint64_t Pack(const char* p, size_t len);
+
+		///@brief Identifiers of 8 characters or less
+		std::unordered_map<uint64_t, int> m_short;
+
+		///@brief Longer identifiers
+		std::unordered_map<std::string, int> m_long;
+	};
+
+	///@brief One declared signal
+	class VCDSignal
+	{
+	public:
+		///@brief Number of bits
+		size_t width;
+
+		///@brief Total number of value changes in the file
+		size_t count;
+
+		///@brief Output waveform, if width is 1
+		SparseDigitalWaveform* bit;
+
+		///@brief Output waveform, if width is more than 1
+		SparseDigitalBusWaveform* bus;
+	};
+
+	///@brief One slice of the value change section of a file, starting at a timestamp, parsed independently
+	class VCDPartition
+	{
+	public:
+		VCDPartition()
+		: begin(nullptr)
+		, end(nullptr)
+		, unknownSymbols(0)
+		, mismatchedValues(0)
+		{}
+
+		///@brief Start of the partition (a "#" timestamp, except for the first partition)
+		const char* begin;
+
+		///@brief End of the partition (start of the next one)
+		const char* end;
+
+		///@brief Number of value changes for each signal in this partition (first pass), then the index of the
+		///first of them in the signal's waveform (second pass)
+		std::vector<size_t> counts;
+
+		///@brief Number of value changes for identifiers which were never declared
+		size_t unknownSymbols;
+
+		///@brief Number of value changes which don't fit their signal (e.g. a vector value for a bus)
+		size_t mismatchedValues;
+	};
+
+	template<class F>
+	static void WalkPartition(
+		VCDPartition& part,
+		const VCDSymbolTable& symbols,
+		const std::vector<VCDSignal>& signals,
+		F onValue);
+	static void ScanPartition(VCDPartition& part, const VCDSymbolTable& symbols, std::vector<VCDSignal>& signals);
+	static void ParsePartition(VCDPartition& part, const VCDSymbolTable& symbols, std::vector<VCDSignal>& signals);
+
+	bool IsSignalSelected(const std::string& name, const std::vector<std::string>& patterns);
+
+	std::string m_signalsname;
 };
 
 #endif
@@ -94,9 +94,13 @@ void VectorPhaseFilter::Refresh()
 
 	float* fa = (float*)&a->m_samples[0];
 	float* fb = (float*)&b->m_samples[0];
+	float* fout = cap->m_samples.GetCpuPointer();
 	float scale = 180 / M_PI;
-	for(size_t i=0; i<len; i++)
-		cap->m_samples[i] = atan2(fa[i], fb[i]) * scale;
+	ParallelFor(0, len, 65536, [&](size_t first, size_t last)
+	{
+		for(size_t i=first; i<last; i++)
+			fout[i] = atan2(fa[i], fb[i]) * scale;
+	});
 
 	cap->MarkModifiedFromCpu();
 }
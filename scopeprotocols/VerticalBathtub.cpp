@@ -29,6 +29,7 @@
 
 #include "../scopehal/scopehal.h"
 #include "EyePattern.h"
+#include "../scopehal/EyeStatistics.h"
 #include "VerticalBathtub.h"
 
 using namespace std;
@@ -38,6 +39,9 @@ using namespace std;
 
 VerticalBathtub::VerticalBathtub(const string& color)
 	: Filter(color, CAT_ANALYSIS)
+	, m_cachedInput(nullptr)
+	, m_cachedRevision(0)
+	, m_cachedTime(0)
 {
 	m_xAxisUnit = Unit(Unit::UNIT_MILLIVOLTS);
 	AddStream(Unit(Unit::UNIT_LOG_BER), "data", Stream::STREAM_TYPE_ANALOG);
@@ -72,6 +76,12 @@ string VerticalBathtub::GetProtocolName()
 	return "Vert Bathtub";
 }
 
+Filter::DataLocation VerticalBathtub::GetInputLocation()
+{
+	//We explicitly manage our input memory and don't care where it is when Refresh() is called
+	return LOC_DONTCARE;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
@@ -84,9 +94,14 @@ void VerticalBathtub::Refresh()
 	}
 
 	//Get the input data
+	//Nothing to do if neither the eye nor the time have changed since last time
 	auto eye = dynamic_cast<EyeWaveform*>(GetInputWaveform(0));
-	eye->PrepareForCpuAccess();
 	int64_t timestamp = m_parameters[m_timeName].GetIntVal();
+	if( (eye == m_cachedInput) && (eye->m_revision == m_cachedRevision) && (timestamp == m_cachedTime) && GetData(0) )
+		return;
+	m_cachedInput = eye;
+	m_cachedRevision = eye->m_revision;
+	m_cachedTime = timestamp;
 
 	//Find the eye bin for this column
 	double fs_per_width = 2*eye->m_uiWidth;
@@ -113,9 +128,11 @@ void VerticalBathtub::Refresh()
 	//TODO: support non-NRZ waveforms
 	size_t len = eye->GetHeight();
 	cap->Resize(len);
+	vector<float> bers;
+	EyeStatistics::GetBERProfile(eye, false, xbin, 0, len, eye->GetWidth()/2, eye->GetHeight()/2, bers);
 	for(size_t i=0; i<len; i++)
 	{
-		auto ber = log10(eye->GetBERAtPoint(xbin, i, eye->GetWidth()/2, eye->GetHeight()/2));
+		auto ber = bers[i];
 		if(ber < 1e-20)
 			cap->m_samples[i] = -20;
 		else
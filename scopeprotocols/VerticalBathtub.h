@@ -41,6 +41,7 @@ public:
 	VerticalBathtub(const std::string& color);
 
 	virtual void Refresh() override;
+	virtual DataLocation GetInputLocation() override;
 
 	static std::string GetProtocolName();
 
@@ -50,6 +51,15 @@ public:
 
 protected:
 	std::string m_timeName;
+
+	///@brief Input waveform the current output was computed from
+	WaveformBase* m_cachedInput;
+
+	///@brief Revision of m_cachedInput the current output was computed from
+	uint64_t m_cachedRevision;
+
+	///@brief Sampling time the current output was computed for
+	int64_t m_cachedTime;
 };
 
 #endif
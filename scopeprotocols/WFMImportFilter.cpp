@@ -43,6 +43,8 @@ WFMImportFilter::WFMImportFilter(const string& color)
 	m_parameters[m_fpname].m_fileFilterMask = "*.wfm";
 	m_parameters[m_fpname].m_fileFilterName = "Tektronix WFM files (*.wfm)";
 	m_parameters[m_fpname].signal_changed().connect(sigc::mem_fun(*this, &WFMImportFilter::OnFileNameChanged));
+
+	AddPagingParameters();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -70,8 +72,8 @@ void WFMImportFilter::OnFileNameChanged()
 	int64_t fs = 0;
 	GetTimestampOfFile(fname, timestamp, fs);
 
-	FILE* fp = fopen(fname.c_str(), "rb");
-	if(!fp)
+	MappedFile file;
+	if(!file.Open(fname))
 	{
 		LogError("Couldn't open WFM file \"%s\"\n", fname.c_str());
 		return;
@@ -79,82 +81,72 @@ void WFMImportFilter::OnFileNameChanged()
 
 	//Byte order check (expect 0x0f0f)
 	uint16_t byteswap;
-	if(1 != fread(&byteswap, sizeof(byteswap), 1, fp))
+	if(1 != file.Read(&byteswap, sizeof(byteswap), 1))
 	{
 		LogError("Fail to read byte order mark\n");
-		fclose(fp);
 		return;
 	}
 	if(byteswap == 0xf0f0)
 	{
 		LogError("Byteswapped files not supported\n");
-		fclose(fp);
 		return;
 	}
 	if(byteswap != 0x0f0f)
 	{
 		LogError("Invalid magic number\n");
-		fclose(fp);
 		return;
 	}
 
 	//Version number (expect ":WFM#003" file format version for now)
 	char version[9] = {0};
-	if(8 != fread(version, 1, 8, fp))
+	if(8 != file.Read(version, 1, 8))
 	{
 		LogError("Fail to read version number\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Waveform version:     \"%s\"\n", version);
 	if(strcmp(version, ":WFM#003") != 0)
 	{
 		LogError("Don't know what to do with file format \"%s\", expected version 3\n", version);
-		fclose(fp);
 		return;
 	}
 
 	//Number of digits in ascii byte counts? not entirely sure what this is for
 	uint8_t ndigits;
-	if(1 != fread(&ndigits, 1, 1, fp))
+	if(1 != file.Read(&ndigits, 1, 1))
 	{
 		LogError("Fail to read digit count\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Digit count:          %d\n", ndigits);
 
 	//Get file size (from this point)
 	uint32_t filesize;
-	if(1 != fread(&filesize, sizeof(filesize), 1, fp))
+	if(1 != file.Read(&filesize, sizeof(filesize), 1))
 	{
 		LogError("Fail to read file size\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("File size:            %d bytes\n", filesize);
 
 	uint8_t bytesperpoint;
-	if(1 != fread(&bytesperpoint, 1, 1, fp))
+	if(1 != file.Read(&bytesperpoint, 1, 1))
 	{
 		LogError("Fail to read bytes per point\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Bytes per point:      %d\n", bytesperpoint);
 	if( (bytesperpoint != 1) && (bytesperpoint != 2) )
 	{
 		LogError("Only 1 or 2 bytes per point supported for now\n");
-		fclose(fp);
 		return;
 	}
 
 	//Offset to start of curve buffer (from start of file)
 	uint32_t curveoffset;
-	if(1 != fread(&curveoffset, sizeof(curveoffset), 1, fp))
+	if(1 != file.Read(&curveoffset, sizeof(curveoffset), 1))
 	{
 		LogError("Fail to read curve offset\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Curve data offset:    %d bytes\n", curveoffset);
@@ -164,51 +156,46 @@ void WFMImportFilter::OnFileNameChanged()
 	//float32		Horizontal zoom position
 	//float64		Vertical zoom scale
 	//float32		Vertical zoom position
-	fseek(fp, 20, SEEK_CUR);
+	file.Skip(20);
 
 	//Waveform label (may be blank)
 	char wfmLabel[33] = {0};
-	if(32 != fread(wfmLabel, 1, 32, fp))
+	if(32 != file.Read(wfmLabel, 1, 32))
 	{
 		LogError("Fail to read waveform label\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Waveform label:       %s\n", wfmLabel);
 
 	//Number of curve objects
 	int32_t numFrames;
-	if(1 != fread(&numFrames, sizeof(numFrames), 1, fp))
+	if(1 != file.Read(&numFrames, sizeof(numFrames), 1))
 	{
 		LogError("Fail to read num frames\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Curve objects:        %d\n", numFrames);
 
 	//Size of waveform header
 	int16_t wfmHeaderSize;
-	if(1 != fread(&wfmHeaderSize, sizeof(wfmHeaderSize), 1, fp))
+	if(1 != file.Read(&wfmHeaderSize, sizeof(wfmHeaderSize), 1))
 	{
 		LogError("Fail to read waveform header size\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Waveform header size: %d\n", wfmHeaderSize);
 
 	//Waveform dataset type
 	int32_t datasetType;
-	if(1 != fread(&datasetType, sizeof(datasetType), 1, fp))
+	if(1 != file.Read(&datasetType, sizeof(datasetType), 1))
 	{
 		LogError("Fail to read waveform header size\n");
-		fclose(fp);
 		return;
 	}
 	if(datasetType == 1)
 	{
 		LogDebug("Dataset type:         FastFrame\n");
 		LogError("FastFrame dataset type not supported\n");
-		fclose(fp);
 		return;
 	}
 	else if(datasetType == 0)
@@ -216,16 +203,14 @@ void WFMImportFilter::OnFileNameChanged()
 	else
 	{
 		LogError("Unrecognized dataset type %d\n", datasetType);
-		fclose(fp);
 		return;
 	}
 
 	//Number of waveforms in the dataset
 	int32_t wfmCnt;
-	if(1 != fread(&wfmCnt, sizeof(wfmCnt), 1, fp))
+	if(1 != file.Read(&wfmCnt, sizeof(wfmCnt), 1))
 	{
 		LogError("Fail to read waveform count\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Waveform count:       %d\n", wfmCnt);
@@ -235,56 +220,50 @@ void WFMImportFilter::OnFileNameChanged()
 	//int64		transactionCount
 	//int32		SlotID
 	//int32		StaticFlag
-	fseek(fp, 24, SEEK_CUR);
+	file.Skip(24);
 
 	//Update spec count
 	int32_t updateSpecCount;
-	if(1 != fread(&updateSpecCount, sizeof(updateSpecCount), 1, fp))
+	if(1 != file.Read(&updateSpecCount, sizeof(updateSpecCount), 1))
 	{
 		LogError("Fail to read update spec count\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Update spec count:    %d\n", updateSpecCount);
 
 	//Implicit dimension count
 	int32_t implicitDimensionCount;
-	if(1 != fread(&implicitDimensionCount, sizeof(implicitDimensionCount), 1, fp))
+	if(1 != file.Read(&implicitDimensionCount, sizeof(implicitDimensionCount), 1))
 	{
 		LogError("Fail to read implicit dimension count\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Implicit dim count:   %d\n", implicitDimensionCount);
 	if(implicitDimensionCount != 1)
 	{
 		LogError("Expected 1 implicit dimension (for waveform dataset\n");
-		fclose(fp);
 		return;
 	}
 
 	//Explicit dimension count
 	int32_t explicitDimensionCount;
-	if(1 != fread(&explicitDimensionCount, sizeof(explicitDimensionCount), 1, fp))
+	if(1 != file.Read(&explicitDimensionCount, sizeof(explicitDimensionCount), 1))
 	{
 		LogError("Fail to read explicit dimension count\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Explicit dim count:   %d\n", explicitDimensionCount);
 	if(explicitDimensionCount != 1)
 	{
 		LogError("Expected 1 explicit dimension (for waveform dataset\n");
-		fclose(fp);
 		return;
 	}
 
 	//Waveform data type
 	int32_t dataType;
-	if(1 != fread(&dataType, sizeof(dataType), 1, fp))
+	if(1 != file.Read(&dataType, sizeof(dataType), 1))
 	{
 		LogError("Fail to read data type\n");
-		fclose(fp);
 		return;
 	}
 	if(dataType == 2)
@@ -292,7 +271,6 @@ void WFMImportFilter::OnFileNameChanged()
 	else
 	{
 		LogError("Unknown waveform data type %d\n", dataType);
-		fclose(fp);
 		return;
 	}
 
@@ -300,20 +278,18 @@ void WFMImportFilter::OnFileNameChanged()
 	//int64		counter
 	//int32		accumcount
 	//int32		targetcount
-	fseek(fp, 16, SEEK_CUR);
+	file.Skip(16);
 
 	//Number of curve objects
 	int32_t curveCount;
-	if(1 != fread(&curveCount, sizeof(curveCount), 1, fp))
+	if(1 != file.Read(&curveCount, sizeof(curveCount), 1))
 	{
 		LogError("Fail to read curve count\n");
-		fclose(fp);
 		return;
 	}
 	if(curveCount != 1)
 	{
 		LogError("Invalid curve count %d\n", curveCount);
-		fclose(fp);
 		return;
 	}
 
@@ -323,39 +299,35 @@ void WFMImportFilter::OnFileNameChanged()
 	//int16		summary
 	//int32		pixmapFormat
 	//int64		pixmapMax
-	fseek(fp, 22, SEEK_CUR);
+	file.Skip(22);
 
 	//Explicit dimensions
 	//(assume only one is present for now)
 	double yscale;
-	if(1 != fread(&yscale, sizeof(yscale), 1, fp))
+	if(1 != file.Read(&yscale, sizeof(yscale), 1))
 	{
 		LogError("Fail to read Y axis scale\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Y axis scale:         %f\n", yscale);
 	double yoff;
-	if(1 != fread(&yoff, sizeof(yscale), 1, fp))
+	if(1 != file.Read(&yoff, sizeof(yscale), 1))
 	{
 		LogError("Fail to read Y axis scale\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Y axis offset:        %f\n", yoff);
 	int32_t yDataRange;
-	if(1 != fread(&yDataRange, sizeof(yDataRange), 1, fp))
+	if(1 != file.Read(&yDataRange, sizeof(yDataRange), 1))
 	{
 		LogError("Fail to read Y axis range\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Y axis range:         %d\n", yDataRange);
 	char yunits[21] = {0};
-	if(20 != fread(yunits, 1, 20, fp))
+	if(20 != file.Read(yunits, 1, 20))
 	{
 		LogError("Fail to read Y axis units\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Y axis units:         %s\n", yunits);
@@ -365,14 +337,13 @@ void WFMImportFilter::OnFileNameChanged()
 	//float64	maxPossibleValue
 	//float64	resolution
 	//float64	refPoint
-	fseek(fp, 32, SEEK_CUR);
+	file.Skip(32);
 
 	//Format
 	int32_t format;
-	if(1 != fread(&format, sizeof(format), 1, fp))
+	if(1 != file.Read(&format, sizeof(format), 1))
 	{
 		LogError("Fail to read data format\n");
-		fclose(fp);
 		return;
 	}
 	if(format == 0)
@@ -381,7 +352,6 @@ void WFMImportFilter::OnFileNameChanged()
 		if(bytesperpoint != 2)
 		{
 			LogError("data format int16_t is only valid with 2 bytes per point\n");
-			fclose(fp);
 			return;
 		}
 	}
@@ -392,23 +362,20 @@ void WFMImportFilter::OnFileNameChanged()
 		if(bytesperpoint != 1)
 		{
 			LogError("data format int8_t is only valid with 1 byte per point\n");
-			fclose(fp);
 			return;
 		}
 	}
 	else
 	{
 		LogError("Data format:          %d (unimplemented)\n", format);
-		fclose(fp);
 		return;
 	}
 
 	//Data layout
 	int32_t layout;
-	if(1 != fread(&layout, sizeof(layout), 1, fp))
+	if(1 != file.Read(&layout, sizeof(layout), 1))
 	{
 		LogError("Fail to read data layout\n");
-		fclose(fp);
 		return;
 	}
 	if(layout == 0)
@@ -416,7 +383,6 @@ void WFMImportFilter::OnFileNameChanged()
 	else
 	{
 		LogError("Data layout:          %d (unimplemented)\n", layout);
-		fclose(fp);
 		return;
 	}
 
@@ -432,43 +398,39 @@ void WFMImportFilter::OnFileNameChanged()
 	//float64	pointDensity
 	//float64	triggerPositionPercent
 	//float64	triggerDelay
-	fseek(fp, 80, SEEK_CUR);
+	file.Skip(80);
 
 	//Skip over the second explicit dimension
 	//(space is reserved in the file format even if the dimension is not present)
-	fseek(fp, 160, SEEK_CUR);
+	file.Skip(160);
 
 	//Implicit dimensions
 	//(assume only one is present for now)
 	double xscale;
-	if(1 != fread(&xscale, sizeof(xscale), 1, fp))
+	if(1 != file.Read(&xscale, sizeof(xscale), 1))
 	{
 		LogError("Fail to read X axis scale\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("X axis scale:         %e\n", xscale);
 	double xoff;
-	if(1 != fread(&xoff, sizeof(xscale), 1, fp))
+	if(1 != file.Read(&xoff, sizeof(xscale), 1))
 	{
 		LogError("Fail to read X axis scale\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("X axis offset:        %f\n", xoff);
 	int32_t numPoints;
-	if(1 != fread(&numPoints, sizeof(numPoints), 1, fp))
+	if(1 != file.Read(&numPoints, sizeof(numPoints), 1))
 	{
 		LogError("Fail to read record length\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Record length:        %d points\n", numPoints);
 	char xunits[21] = {0};
-	if(20 != fread(xunits, 1, 20, fp))
+	if(20 != file.Read(xunits, 1, 20))
 	{
 		LogError("Fail to read X axis units\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("X axis units:         %s\n", xunits);
@@ -478,13 +440,12 @@ void WFMImportFilter::OnFileNameChanged()
 	//float64	extent max
 	//float64	resolution
 	//float64	refpoint
-	fseek(fp, 32, SEEK_CUR);
+	file.Skip(32);
 
 	int32_t spacing;
-	if(1 != fread(&spacing, sizeof(spacing), 1, fp))
+	if(1 != file.Read(&spacing, sizeof(spacing), 1))
 	{
 		LogError("Fail to read sample spacing\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("X axis spacing:       %d\n", spacing);
@@ -496,75 +457,68 @@ void WFMImportFilter::OnFileNameChanged()
 	//float64	point density
 	//float64	href
 	//float64	trigdelay
-	fseek(fp, 60, SEEK_CUR);
+	file.Skip(60);
 
 	//Skip over the second implicit dimension
 	//(space is reserved in the file format even if the dimension is not present)
-	fseek(fp, 136, SEEK_CUR);
+	file.Skip(136);
 
 	//Timebase information
 	int32_t realSpacing;
-	if(1 != fread(&realSpacing, sizeof(realSpacing), 1, fp))
+	if(1 != file.Read(&realSpacing, sizeof(realSpacing), 1))
 	{
 		LogError("Fail to read real spacing\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Real point spacing:   %d\n", realSpacing);
 
 	int32_t acqType;
-	if(1 != fread(&acqType, sizeof(acqType), 1, fp))
+	if(1 != file.Read(&acqType, sizeof(acqType), 1))
 	{
 		LogError("Fail to read acquisition type\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Acq type:             %d\n", acqType);
 
 	int32_t baseType;
-	if(1 != fread(&baseType, sizeof(baseType), 1, fp))
+	if(1 != file.Read(&baseType, sizeof(baseType), 1))
 	{
 		LogError("Fail to read timebase type\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Timebase type:        %d\n", baseType);
 
 	//Skip second timebase type
-	fseek(fp, 12, SEEK_CUR);
+	file.Skip(12);
 
 	//Waveform update spec
 	//TODO: there can be more than one so we need to loop
 	int32_t realPointOffset;
-	if(1 != fread(&realPointOffset, sizeof(realPointOffset), 1, fp))
+	if(1 != file.Read(&realPointOffset, sizeof(realPointOffset), 1))
 	{
 		LogError("Fail to read real point offset\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Real point offset:    %d\n", realPointOffset);
 
 	double triggerPhase;
-	if(1 != fread(&triggerPhase, sizeof(triggerPhase), 1, fp))
+	if(1 != file.Read(&triggerPhase, sizeof(triggerPhase), 1))
 	{
 		LogError("Fail to read trigger phase\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Trigger phase:        %f\n", triggerPhase);
 
 	double fracSec;
-	if(1 != fread(&fracSec, sizeof(fracSec), 1, fp))
+	if(1 != file.Read(&fracSec, sizeof(fracSec), 1))
 	{
 		LogError("Fail to read fractional seconds\n");
-		fclose(fp);
 		return;
 	}
 	uint32_t gmtSec;
-	if(1 != fread(&gmtSec, sizeof(gmtSec), 1, fp))
+	if(1 != file.Read(&gmtSec, sizeof(gmtSec), 1))
 	{
 		LogError("Fail to read GMT seconds\n");
-		fclose(fp);
 		return;
 	}
 
@@ -573,46 +527,42 @@ void WFMImportFilter::OnFileNameChanged()
 	//int32 stateFlags
 	//int32 checksumType
 	//int16 curveChecksum
-	fseek(fp, 10, SEEK_CUR);
+	file.Skip(10);
 
 	uint32_t prechargeStart;
-	if(1 != fread(&prechargeStart, sizeof(prechargeStart), 1, fp))
+	if(1 != file.Read(&prechargeStart, sizeof(prechargeStart), 1))
 	{
 		LogError("Fail to read precharge start\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Precharge start:      %d\n", prechargeStart);
 
 	uint32_t dataStart;
-	if(1 != fread(&dataStart, sizeof(dataStart), 1, fp))
+	if(1 != file.Read(&dataStart, sizeof(dataStart), 1))
 	{
 		LogError("Fail to read data start\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Data start:           %d\n", dataStart);
 
 	uint32_t postchargeStart;
-	if(1 != fread(&postchargeStart, sizeof(postchargeStart), 1, fp))
+	if(1 != file.Read(&postchargeStart, sizeof(postchargeStart), 1))
 	{
 		LogError("Fail to read postcharge start\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Postcharge start:     %d\n", postchargeStart);
 
 	uint32_t postchargeStop;
-	if(1 != fread(&postchargeStop, sizeof(postchargeStop), 1, fp))
+	if(1 != file.Read(&postchargeStop, sizeof(postchargeStop), 1))
 	{
 		LogError("Fail to read postcharge stop\n");
-		fclose(fp);
 		return;
 	}
 	LogDebug("Postcharge stop:      %d\n", postchargeStop);
 
 	//Skip roll mode data
-	fseek(fp, 4, SEEK_CUR);
+	file.Skip(4);
 
 	//Calculate actual sample data size
 	size_t numBytes = (postchargeStop - prechargeStart);
@@ -636,54 +586,19 @@ void WFMImportFilter::OnFileNameChanged()
 	AddStream(yunit, "data", Stream::STREAM_TYPE_ANALOG);
 	auto wfm = new UniformAnalogWaveform;
 	wfm->m_timescale = FS_PER_SECOND * (spacing+1) * xscale;
-	wfm->Resize(numRealSamples);
 	wfm->m_startTimestamp = gmtSec;
 	wfm->m_startFemtoseconds = fracSec * FS_PER_SECOND;
 	wfm->m_triggerPhase = triggerPhase * wfm->m_timescale;
 	wfm->PrepareForCpuAccess();
 	SetData(wfm, 0);
 
-	if(bytesperpoint == 2)
-	{
-		//Read sample data
-		int16_t* rawdata = new int16_t[numRealSamples];
-		fseek(fp, curveoffset, SEEK_SET);
-		if(numRealSamples != fread(rawdata, sizeof(int16_t), numRealSamples, fp))
-		{
-			LogError("Fail to read waveform data\n");
-			delete[] rawdata;
-			return;
-		}
-
-		//Convert (TODO vectorize)
-		for(size_t i=0; i<numRealSamples; i++)
-			wfm->m_samples[i] = (rawdata[i] * yscale) + yoff;
-
-		delete[] rawdata;
-	}
-	else //if(bytesperpoint == 1)
+	//Convert straight out of the mapped file (or just index it, if paged)
+	if(!LoadMappedSamples(0, wfm, file, curveoffset, numRealSamples, bytesperpoint, yscale, -yoff))
 	{
-		//Read sample data
-		int8_t* rawdata = new int8_t[numRealSamples];
-		fseek(fp, curveoffset, SEEK_SET);
-		if(numRealSamples != fread(rawdata, sizeof(int8_t), numRealSamples, fp))
-		{
-			LogError("Fail to read waveform data\n");
-			delete[] rawdata;
-			return;
-		}
-
-		//Convert (TODO vectorize)
-		for(size_t i=0; i<numRealSamples; i++)
-			wfm->m_samples[i] = (rawdata[i] * yscale) + yoff;
-
-		delete[] rawdata;
+		LogError("Fail to read waveform data\n");
+		return;
 	}
 
 	//Done, set scale
-	wfm->MarkModifiedFromCpu();
 	AutoscaleVertical(0);
-
-	//Clean up
-	fclose(fp);
 }
@@ -36,15 +36,19 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Construction / destruction
 
-WaterfallWaveform::WaterfallWaveform(size_t width, size_t height)
+WaterfallWaveform::WaterfallWaveform(size_t width, size_t height, bool ring)
 	: DensityFunctionWaveform(width, height)
 	, m_tempBuf("WaterfallWaveform.m_tempBuf")
+	, m_headRow(0)
+	, m_ring(ring)
 {
 	//Temporary buffer is GPU-only
 	m_tempBuf.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_NEVER);
 	m_tempBuf.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
 
-	m_tempBuf.resize(width*height);
+	//Ring buffers are updated in place and don't need it at all
+	if(!ring)
+		m_tempBuf.resize(width*height);
 }
 
 WaterfallWaveform::~WaterfallWaveform()
@@ -59,7 +63,9 @@ Waterfall::Waterfall(const string& color)
 	, m_width(1)
 	, m_height(1)
 	, m_maxwidth("Max width")
+	, m_historyMode("History Mode")
 	, m_computePipeline("shaders/WaterfallFilter.spv", 3, sizeof(WaterfallFilterArgs))
+	, m_ringComputePipeline("shaders/WaterfallFilter_Ring.spv", 2, sizeof(WaterfallFilterArgs))
 {
 	AddStream(Unit(Unit::UNIT_DBM), "data", Stream::STREAM_TYPE_WATERFALL);
 	m_xAxisUnit = Unit(Unit::UNIT_MICROHZ);
@@ -67,6 +73,11 @@ Waterfall::Waterfall(const string& color)
 	m_parameters[m_maxwidth] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_SAMPLEDEPTH));
 	m_parameters[m_maxwidth].SetIntVal(131072);
 
+	m_parameters[m_historyMode] = FilterParameter(FilterParameter::TYPE_ENUM, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_historyMode].AddEnumValue("Scroll", HISTORY_SCROLL);
+	m_parameters[m_historyMode].AddEnumValue("Ring Buffer", HISTORY_RING);
+	m_parameters[m_historyMode].SetIntVal(HISTORY_SCROLL);
+
 	//Set up channels
 	CreateInput("Spectrum");
 }
@@ -137,10 +148,12 @@ void Waterfall::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle>
 	size_t capwidth = min(maxwidth, inlen);
 
 	//Reallocate if input size changed, or we don't have an input capture at all
+	bool ring = (m_parameters[m_historyMode].GetIntVal() == HISTORY_RING);
 	auto cap = dynamic_cast<WaterfallWaveform*>(GetData(0));
-	if( (cap == nullptr) || (m_width != capwidth) || (m_width != cap->GetWidth()) || (m_height != cap->GetHeight()) )
+	if( (cap == nullptr) || (m_width != capwidth) || (m_width != cap->GetWidth()) || (m_height != cap->GetHeight()) ||
+		(cap->IsRingBuffer() != ring) )
 	{
-		cap = new WaterfallWaveform(capwidth, m_height);
+		cap = new WaterfallWaveform(capwidth, m_height, ring);
 		m_width = capwidth;
 		SetData(cap, 0);
 	}
@@ -167,6 +180,31 @@ void Waterfall::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle>
 	//Make sure input is ready
 	din->PrepareForGpuAccess();
 	cap->PrepareForGpuAccess();
+
+	//Ring buffer: just write the new line in place
+	if(ring)
+	{
+		args.height = cap->GetHeadRow();
+
+		cmdBuf.begin({});
+
+		m_ringComputePipeline.BindBufferNonblocking(0, din->m_samples, cmdBuf);
+		m_ringComputePipeline.BindBufferNonblocking(1, cap->GetOutData(), cmdBuf, true);
+		const uint32_t compute_block_count = GetComputeBlockCount(args.width, 64);
+		m_ringComputePipeline.Dispatch(
+			cmdBuf, args,
+			min(compute_block_count, 32768u),
+			compute_block_count / 32768 + 1);
+
+		cmdBuf.end();
+		queue->SubmitAndBlock(cmdBuf);
+
+		cap->AdvanceHead();
+		cap->GetOutData().MarkModifiedFromGpu();
+		return;
+	}
+
+	//Scrolling: shift every line down one, then copy back
 	cap->m_tempBuf.PrepareForGpuAccess();
 
 	cmdBuf.begin({});
@@ -40,6 +40,8 @@
 struct WaterfallFilterArgs
 {
 	uint32_t width;
+
+	///@brief Bitmap height for scrolling mode, or row to write for ring buffer mode
 	uint32_t height;
 	uint32_t inlen;
 	float vrange;
@@ -50,7 +52,7 @@ struct WaterfallFilterArgs
 class WaterfallWaveform : public DensityFunctionWaveform
 {
 public:
-	WaterfallWaveform(size_t width, size_t height);
+	WaterfallWaveform(size_t width, size_t height, bool ring = false);
 	virtual ~WaterfallWaveform();
 
 	//not copyable or assignable
@@ -63,7 +65,33 @@ public:
 	virtual bool HasGpuBuffer() override
 	{ return false; }
 
+	/**
+		@brief Gets the physical row holding the oldest line
+
+		In ring buffer mode, logical row i is stored in physical row (i + GetHeadRow()) % GetHeight(), so the newest
+		line is just before the head. Always zero in scrolling mode.
+	 */
+	size_t GetHeadRow()
+	{ return m_headRow; }
+
+	///@brief Returns true if the history is a ring buffer rather than scrolling
+	bool IsRingBuffer()
+	{ return m_ring; }
+
+	///@brief Advances the head after a new line has been written at the current head
+	void AdvanceHead()
+	{ m_headRow = (m_headRow + 1) % GetHeight(); }
+
+	///@brief Scratch buffer for scrolling mode (empty in ring buffer mode)
 	AcceleratorBuffer<float> m_tempBuf;
+
+protected:
+
+	///@brief Physical row holding the oldest line
+	size_t m_headRow;
+
+	///@brief True if the history is a ring buffer
+	bool m_ring;
 };
 
 class Waterfall : public Filter
@@ -98,6 +126,15 @@ public:
 
 	PROTOCOL_DECODER_INITPROC(Waterfall)
 
+	enum HistoryMode
+	{
+		///@brief Every row moves down one line on each update
+		HISTORY_SCROLL,
+
+		///@brief Only the new row is written, at a moving head index
+		HISTORY_RING
+	};
+
 protected:
 	double m_offsetHz;
 
@@ -105,8 +142,10 @@ protected:
 	size_t m_height;
 
 	std::string m_maxwidth;
+	std::string m_historyMode;
 
 	ComputePipeline m_computePipeline;
+	ComputePipeline m_ringComputePipeline;
 };
 
 #endif
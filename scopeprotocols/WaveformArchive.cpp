@@ -0,0 +1,305 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of the waveform archive file format
+ */
+
+#include "../scopehal/scopehal.h"
+#include "WaveformArchive.h"
+
+using namespace std;
+
+namespace WaveformArchive
+{
+
+const char FILE_MAGIC[8] = {'S', 'C', 'O', 'P', 'E', 'W', 'A', '1'};
+const char SEGMENT_MAGIC[8] = {'S', 'W', 'A', 'S', 'E', 'G', '0', '1'};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sample codecs
+
+/**
+	@brief Encodes a series of timestamps as zigzag varint deltas from the previous value (the first one from zero)
+ */
+void EncodeDeltas(Writer& w, const int64_t* values, size_t count)
+{
+	int64_t last = 0;
+	for(size_t i=0; i<count; i++)
+	{
+		w.PutSignedVarint(values[i] - last);
+		last = values[i];
+	}
+}
+
+/**
+	@brief Decodes timestamps written by EncodeDeltas()
+ */
+bool DecodeDeltas(Reader& r, int64_t* values, size_t count)
+{
+	int64_t last = 0;
+	for(size_t i=0; i<count; i++)
+	{
+		last += r.GetSignedVarint();
+		values[i] = last;
+	}
+	return r.IsOK();
+}
+
+/**
+	@brief Encodes analog samples, using whichever codec gives the smaller result
+
+	@return The codec used
+ */
+Codec EncodeFloats(Writer& w, const float* values, size_t count)
+{
+	//Try XOR coding into a scratch buffer first
+	string tmp;
+	tmp.reserve(count * 2);
+	Writer wx(tmp);
+	uint32_t last = 0;
+	for(size_t i=0; i<count; i++)
+	{
+		uint32_t v;
+		memcpy(&v, &values[i], sizeof(v));
+		wx.PutVarint(v ^ last);
+		last = v;
+
+		//Give up as soon as it's clear we won't win
+		if(tmp.size() >= count * sizeof(float))
+		{
+			w.PutBytes(values, count * sizeof(float));
+			return CODEC_RAW;
+		}
+	}
+
+	w.PutBytes(tmp.data(), tmp.size());
+	return CODEC_XOR_VARINT;
+}
+
+/**
+	@brief Decodes analog samples written by EncodeFloats()
+ */
+bool DecodeFloats(Reader& r, Codec codec, float* values, size_t count)
+{
+	switch(codec)
+	{
+		case CODEC_RAW:
+			{
+				auto p = r.GetBytes(count * sizeof(float));
+				if(!p)
+					return false;
+				memcpy(values, p, count * sizeof(float));
+			}
+			return true;
+
+		case CODEC_XOR_VARINT:
+			{
+				uint32_t last = 0;
+				for(size_t i=0; i<count; i++)
+				{
+					last ^= static_cast<uint32_t>(r.GetVarint());
+					memcpy(&values[i], &last, sizeof(last));
+				}
+			}
+			return r.IsOK();
+
+		default:
+			return false;
+	}
+}
+
+/**
+	@brief Encodes digital samples, eight per byte, LSB first
+ */
+void EncodeBits(Writer& w, const bool* values, size_t count)
+{
+	for(size_t i=0; i<count; i += 8)
+	{
+		uint8_t b = 0;
+		size_t n = min(count - i, (size_t)8);
+		for(size_t j=0; j<n; j++)
+		{
+			if(values[i+j])
+				b |= (1 << j);
+		}
+		w.PutU8(b);
+	}
+}
+
+/**
+	@brief Decodes digital samples written by EncodeBits()
+ */
+bool DecodeBits(Reader& r, bool* values, size_t count)
+{
+	auto p = r.GetBytes((count + 7) / 8);
+	if(!p)
+		return false;
+
+	for(size_t i=0; i<count; i++)
+		values[i] = (p[i / 8] >> (i % 8)) & 1;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Segment metadata
+
+/**
+	@brief Serializes a segment footer
+
+	@param buf					Buffer to append the footer to
+	@param prevTrailerOffset	File offset of the previous segment's trailer, or zero if this is the first segment
+	@param columns				Columns in the segment
+ */
+void WriteFooter(string& buf, uint64_t prevTrailerOffset, const vector<ColumnInfo>& columns)
+{
+	Writer w(buf);
+	w.PutU64(prevTrailerOffset);
+	w.PutVarint(columns.size());
+	for(auto& col : columns)
+	{
+		w.PutString(col.m_name);
+		w.PutU8(col.m_type);
+		w.PutU8(col.m_uniform);
+		w.PutString(col.m_xunit);
+		w.PutString(col.m_yunit);
+		w.PutI64(col.m_timescale);
+		w.PutI64(col.m_startTimestamp);
+		w.PutI64(col.m_startFemtoseconds);
+		w.PutI64(col.m_triggerPhase);
+		w.PutU8(col.m_flags);
+		w.PutVarint(col.m_count);
+
+		w.PutVarint(col.m_colors.size());
+		for(auto& c : col.m_colors)
+			w.PutString(c);
+
+		w.PutVarint(col.m_chunks.size());
+		for(auto& chunk : col.m_chunks)
+		{
+			w.PutU64(chunk.m_offset);
+			w.PutVarint(chunk.m_length);
+			w.PutVarint(chunk.m_firstSample);
+			w.PutVarint(chunk.m_count);
+			w.PutI64(chunk.m_startTime);
+			w.PutI64(chunk.m_endTime);
+			w.PutU8(chunk.m_codec);
+		}
+	}
+}
+
+/**
+	@brief Parses a segment footer written by WriteFooter()
+
+	@return False if the footer is truncated or malformed
+ */
+bool ReadFooter(const uint8_t* p, size_t len, uint64_t& prevTrailerOffset, vector<ColumnInfo>& columns)
+{
+	Reader r(p, len);
+	prevTrailerOffset = r.GetU64();
+
+	//Sanity check counts against the remaining size before allocating anything
+	size_t ncols = r.GetVarint();
+	if(!r.IsOK() || (ncols > len))
+		return false;
+
+	columns.resize(ncols);
+	for(auto& col : columns)
+	{
+		col.m_name = r.GetString();
+		col.m_type = static_cast<ColumnType>(r.GetU8());
+		col.m_uniform = r.GetU8() != 0;
+		col.m_xunit = r.GetString();
+		col.m_yunit = r.GetString();
+		col.m_timescale = r.GetI64();
+		col.m_startTimestamp = r.GetI64();
+		col.m_startFemtoseconds = r.GetI64();
+		col.m_triggerPhase = r.GetI64();
+		col.m_flags = r.GetU8();
+		col.m_count = r.GetVarint();
+
+		size_t ncolors = r.GetVarint();
+		if(!r.IsOK() || (ncolors > len))
+			return false;
+		col.m_colors.resize(ncolors);
+		for(auto& c : col.m_colors)
+			c = r.GetString();
+
+		size_t nchunks = r.GetVarint();
+		if(!r.IsOK() || (nchunks > len))
+			return false;
+		col.m_chunks.resize(nchunks);
+		for(auto& chunk : col.m_chunks)
+		{
+			chunk.m_offset = r.GetU64();
+			chunk.m_length = r.GetVarint();
+			chunk.m_firstSample = r.GetVarint();
+			chunk.m_count = r.GetVarint();
+			chunk.m_startTime = r.GetI64();
+			chunk.m_endTime = r.GetI64();
+			chunk.m_codec = static_cast<Codec>(r.GetU8());
+		}
+
+		if(col.m_type > COLUMN_PROTOCOL)
+			return false;
+	}
+
+	return r.IsOK();
+}
+
+/**
+	@brief Serializes a segment trailer (always TRAILER_SIZE bytes)
+ */
+void WriteTrailer(string& buf, uint64_t footerOffset, uint64_t footerLength)
+{
+	Writer w(buf);
+	w.PutU64(footerOffset);
+	w.PutU64(footerLength);
+	w.PutBytes(SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+}
+
+/**
+	@brief Parses a segment trailer
+
+	@param p				Start of the trailer, at least TRAILER_SIZE bytes long
+	@param footerOffset		File offset of the segment footer
+	@param footerLength		Size of the segment footer
+
+	@return False if the magic number doesn't match
+ */
+bool ReadTrailer(const uint8_t* p, uint64_t& footerOffset, uint64_t& footerLength)
+{
+	Reader r(p, TRAILER_SIZE);
+	footerOffset = r.GetU64();
+	footerLength = r.GetU64();
+	return memcmp(r.GetBytes(sizeof(SEGMENT_MAGIC)), SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) == 0;
+}
+
+}
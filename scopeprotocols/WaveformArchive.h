@@ -0,0 +1,294 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of the waveform archive file format
+ */
+#ifndef WaveformArchive_h
+#define WaveformArchive_h
+
+/**
+	@brief Chunked, columnar binary waveform file format (*.swa) and its encoders/decoders
+
+	Written by WaveformArchiveExportFilter and read by WaveformArchiveImportFilter. A file is:
+	- The 8 byte FILE_MAGIC
+	- One or more segments, each holding one export (a single acquisition of every column). Each segment is:
+		- Chunk payloads for every column, in column order
+		- A footer describing the columns and indexing their chunks (see WriteFooter())
+		- A trailer: uint64 footer offset, uint64 footer length, then the 8 byte SEGMENT_MAGIC
+
+	Each footer holds the offset of the previous segment's trailer, so a reader can find every segment starting from
+	the end of the file without touching any chunk data. Appending a segment never rewrites existing data.
+
+	Each chunk holds up to CHUNK_SAMPLES consecutive samples of one column, plus the time range they cover, so a reader
+	can decode just the chunks overlapping the time range it cares about, and decode them in parallel. Within a chunk:
+	- Sparse columns store offsets and durations as zigzag varint coded deltas. Uniformly spaced samples take one
+	  byte per value.
+	- Analog samples are XORed with the previous sample and varint coded (CODEC_XOR_VARINT), which collapses runs of
+	  repeated ADC codes. Chunks that would not get smaller this way are stored as raw floats (CODEC_RAW).
+	- Digital samples are bit packed.
+	- Protocol samples are a varint index into the column's color table, followed by the sample's text.
+
+	All multi-byte values are little endian.
+ */
+namespace WaveformArchive
+{
+	///@brief Magic number at the start of every file
+	extern const char FILE_MAGIC[8];
+
+	///@brief Magic number at the end of every segment trailer
+	extern const char SEGMENT_MAGIC[8];
+
+	///@brief Size of a segment trailer
+	const size_t TRAILER_SIZE = 24;
+
+	///@brief Maximum number of samples in one chunk
+	const size_t CHUNK_SAMPLES = 65536;
+
+	///@brief Kind of data stored in a column
+	enum ColumnType : uint8_t
+	{
+		COLUMN_ANALOG,
+		COLUMN_DIGITAL,
+		COLUMN_PROTOCOL
+	};
+
+	///@brief Encoding of the sample values in one chunk
+	enum Codec : uint8_t
+	{
+		CODEC_RAW,
+		CODEC_XOR_VARINT
+	};
+
+	/**
+		@brief Location and time range of one chunk of a column
+	 */
+	class ChunkInfo
+	{
+	public:
+		///@brief Byte offset of the chunk payload within the file
+		uint64_t m_offset;
+
+		///@brief Size of the chunk payload, in bytes
+		uint64_t m_length;
+
+		///@brief Index of the first sample in the chunk, within the column
+		uint64_t m_firstSample;
+
+		///@brief Number of samples in the chunk
+		uint64_t m_count;
+
+		///@brief Start time of the first sample, in X axis units relative to the trigger
+		int64_t m_startTime;
+
+		///@brief End time of the last sample, in X axis units relative to the trigger
+		int64_t m_endTime;
+
+		///@brief Encoding of the sample values
+		Codec m_codec;
+	};
+
+	/**
+		@brief Everything about one column except the sample data
+	 */
+	class ColumnInfo
+	{
+	public:
+		std::string m_name;
+		ColumnType m_type;
+
+		///@brief True for uniformly sampled columns (no offsets/durations stored)
+		bool m_uniform;
+
+		std::string m_xunit;
+		std::string m_yunit;
+
+		//Waveform metadata
+		int64_t m_timescale;
+		int64_t m_startTimestamp;
+		int64_t m_startFemtoseconds;
+		int64_t m_triggerPhase;
+		uint8_t m_flags;
+
+		///@brief Total number of samples
+		uint64_t m_count;
+
+		///@brief Distinct sample colors used by a protocol column
+		std::vector<std::string> m_colors;
+
+		std::vector<ChunkInfo> m_chunks;
+	};
+
+	/**
+		@brief Appends binary values to a string
+	 */
+	class Writer
+	{
+	public:
+		Writer(std::string& buf)
+		: m_buf(buf)
+		{}
+
+		void PutBytes(const void* p, size_t len)
+		{ m_buf.append(reinterpret_cast<const char*>(p), len); }
+
+		void PutU8(uint8_t v)
+		{ m_buf += static_cast<char>(v); }
+
+		void PutU64(uint64_t v)
+		{ PutBytes(&v, sizeof(v)); }
+
+		void PutI64(int64_t v)
+		{ PutBytes(&v, sizeof(v)); }
+
+		void PutVarint(uint64_t v)
+		{
+			while(v >= 0x80)
+			{
+				m_buf += static_cast<char>( (v & 0x7f) | 0x80 );
+				v >>= 7;
+			}
+			m_buf += static_cast<char>(v);
+		}
+
+		void PutSignedVarint(int64_t v)
+		{ PutVarint( (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63) ); }
+
+		void PutString(const std::string& s)
+		{
+			PutVarint(s.size());
+			m_buf += s;
+		}
+
+	protected:
+		std::string& m_buf;
+	};
+
+	/**
+		@brief Reads binary values from a buffer, with bounds checking
+
+		Reading past the end of the buffer returns zeroes and clears the OK flag rather than crashing, so a truncated
+		or corrupted file can be detected with a single check at the end.
+	 */
+	class Reader
+	{
+	public:
+		Reader(const uint8_t* p, size_t len)
+		: m_p(p)
+		, m_end(p + len)
+		, m_ok(true)
+		{}
+
+		bool IsOK() const
+		{ return m_ok; }
+
+		bool AtEnd() const
+		{ return m_p >= m_end; }
+
+		const uint8_t* GetBytes(size_t len)
+		{
+			if(static_cast<size_t>(m_end - m_p) < len)
+			{
+				m_ok = false;
+				m_p = m_end;
+				return nullptr;
+			}
+			auto ret = m_p;
+			m_p += len;
+			return ret;
+		}
+
+		uint8_t GetU8()
+		{
+			auto p = GetBytes(1);
+			return p ? *p : 0;
+		}
+
+		uint64_t GetU64()
+		{
+			uint64_t v = 0;
+			auto p = GetBytes(sizeof(v));
+			if(p)
+				memcpy(&v, p, sizeof(v));
+			return v;
+		}
+
+		int64_t GetI64()
+		{ return static_cast<int64_t>(GetU64()); }
+
+		uint64_t GetVarint()
+		{
+			uint64_t v = 0;
+			for(int shift=0; (shift < 64) && (m_p < m_end); shift += 7)
+			{
+				uint8_t b = *m_p++;
+				v |= static_cast<uint64_t>(b & 0x7f) << shift;
+				if(!(b & 0x80))
+					return v;
+			}
+			m_ok = false;
+			return 0;
+		}
+
+		int64_t GetSignedVarint()
+		{
+			uint64_t v = GetVarint();
+			return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+		}
+
+		std::string GetString()
+		{
+			size_t len = GetVarint();
+			auto p = GetBytes(len);
+			return p ? std::string(reinterpret_cast<const char*>(p), len) : std::string();
+		}
+
+	protected:
+		const uint8_t* m_p;
+		const uint8_t* m_end;
+		bool m_ok;
+	};
+
+	void EncodeDeltas(Writer& w, const int64_t* values, size_t count);
+	bool DecodeDeltas(Reader& r, int64_t* values, size_t count);
+
+	Codec EncodeFloats(Writer& w, const float* values, size_t count);
+	bool DecodeFloats(Reader& r, Codec codec, float* values, size_t count);
+
+	void EncodeBits(Writer& w, const bool* values, size_t count);
+	bool DecodeBits(Reader& r, bool* values, size_t count);
+
+	void WriteFooter(std::string& buf, uint64_t prevTrailerOffset, const std::vector<ColumnInfo>& columns);
+	bool ReadFooter(const uint8_t* p, size_t len, uint64_t& prevTrailerOffset, std::vector<ColumnInfo>& columns);
+	void WriteTrailer(std::string& buf, uint64_t footerOffset, uint64_t footerLength);
+	bool ReadTrailer(const uint8_t* p, uint64_t& footerOffset, uint64_t& footerLength);
+}
+
+#endif
@@ -0,0 +1,367 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of WaveformArchiveExportFilter
+ */
+
+#include "../scopehal/scopehal.h"
+#include "WaveformArchiveExportFilter.h"
+
+using namespace std;
+using namespace WaveformArchive;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+WaveformArchiveExportFilter::WaveformArchiveExportFilter(const string& color)
+	: ExportFilter(color)
+	, m_inputCount("Columns")
+	, m_writeOffset(0)
+	, m_lastTrailerOffset(0)
+{
+	m_parameters[m_fname].m_fileFilterMask = "*.swa";
+	m_parameters[m_fname].m_fileFilterName = "Waveform archive files (*.swa)";
+
+	m_parameters[m_inputCount] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_inputCount].signal_changed().connect(
+		sigc::mem_fun(*this, &WaveformArchiveExportFilter::OnColumnCountChanged));
+	m_parameters[m_inputCount].SetIntVal(1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Factory methods
+
+bool WaveformArchiveExportFilter::ValidateChannel(size_t i, StreamDescriptor stream)
+{
+	if(stream.m_channel == nullptr)
+		return false;
+
+	//Reject invalid port indexes
+	if(i >= (size_t)m_parameters[m_inputCount].GetIntVal())
+		return false;
+
+	switch(stream.GetType())
+	{
+		case Stream::STREAM_TYPE_ANALOG:
+		case Stream::STREAM_TYPE_DIGITAL:
+		case Stream::STREAM_TYPE_PROTOCOL:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+string WaveformArchiveExportFilter::GetProtocolName()
+{
+	return "Waveform Archive Export";
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Actual decoder logic
+
+/**
+	@brief Opens the output file, writing the file header if it's new or finding the last segment if appending
+
+	@return True on success
+ */
+bool WaveformArchiveExportFilter::OpenFile()
+{
+	//Make sure the previous export is completely on disk before we reopen (and maybe truncate) the file
+	FlushWrites();
+
+	auto fname = m_parameters[m_fname].GetFileName();
+	auto mode = static_cast<ExportMode_t>(m_parameters[m_mode].GetIntVal());
+	bool append = (mode == MODE_CONTINUOUS_APPEND) || (mode == MODE_MANUAL_APPEND);
+
+	//When appending to an existing file, make sure it really is an archive and find the last segment to link to
+	m_writeOffset = 0;
+	m_lastTrailerOffset = 0;
+	if(append)
+	{
+		FILE* fin = fopen(fname.c_str(), "rb");
+		if(fin)
+		{
+			fseek(fin, 0, SEEK_END);
+			long size = ftell(fin);
+
+			char magic[sizeof(FILE_MAGIC)];
+			uint8_t trailer[TRAILER_SIZE];
+			uint64_t footerOffset;
+			uint64_t footerLength;
+			bool ok = true;
+			if(size != 0)
+			{
+				ok =
+					(size >= (long)(sizeof(FILE_MAGIC) + TRAILER_SIZE)) &&
+					(fseek(fin, 0, SEEK_SET) == 0) &&
+					(fread(magic, 1, sizeof(magic), fin) == sizeof(magic)) &&
+					(memcmp(magic, FILE_MAGIC, sizeof(magic)) == 0) &&
+					(fseek(fin, size - TRAILER_SIZE, SEEK_SET) == 0) &&
+					(fread(trailer, 1, TRAILER_SIZE, fin) == TRAILER_SIZE) &&
+					ReadTrailer(trailer, footerOffset, footerLength);
+			}
+			fclose(fin);
+
+			if(!ok)
+			{
+				AddErrorMessage(
+					"Invalid file",
+					"The output file exists but is not a complete waveform archive, refusing to append to it");
+				return false;
+			}
+
+			m_writeOffset = size;
+			if(size != 0)
+				m_lastTrailerOffset = size - TRAILER_SIZE;
+		}
+	}
+
+	m_fp = fopen(fname.c_str(), append ? "ab" : "wb");
+	if(!m_fp)
+	{
+		AddErrorMessage("Failed to open file", "Could not open the output file for writing");
+		return false;
+	}
+
+	if(m_writeOffset == 0)
+	{
+		QueueWrite(string(FILE_MAGIC, sizeof(FILE_MAGIC)));
+		m_writeOffset = sizeof(FILE_MAGIC);
+	}
+	return true;
+}
+
+void WaveformArchiveExportFilter::Export()
+{
+	ClearErrors();
+	if(!VerifyAllInputsOK())
+	{
+		AddErrorMessage("Missing inputs", "One or more input ports are not connected");
+		return;
+	}
+
+	//Describe each column and make sure we know how to store it
+	size_t ncols = GetInputCount();
+	vector<ColumnInfo> columns(ncols);
+	vector<WaveformBase*> wfms(ncols);
+	for(size_t i=0; i<ncols; i++)
+	{
+		auto in = GetInput(i);
+		auto data = in.GetData();
+		auto& col = columns[i];
+
+		bool supported = false;
+		switch(in.GetType())
+		{
+			case Stream::STREAM_TYPE_ANALOG:
+				col.m_type = COLUMN_ANALOG;
+				supported = dynamic_cast<UniformAnalogWaveform*>(data) || dynamic_cast<SparseAnalogWaveform*>(data);
+				break;
+
+			case Stream::STREAM_TYPE_DIGITAL:
+				col.m_type = COLUMN_DIGITAL;
+				supported = dynamic_cast<UniformDigitalWaveform*>(data) || dynamic_cast<SparseDigitalWaveform*>(data);
+				break;
+
+			default:
+				col.m_type = COLUMN_PROTOCOL;
+				supported = dynamic_cast<UniformWaveformBase*>(data) || dynamic_cast<SparseWaveformBase*>(data);
+				break;
+		}
+		if(!supported)
+		{
+			AddErrorMessage(
+				"Unsupported input", string("Don't know how to store the waveform type of ") + in.GetName());
+			return;
+		}
+
+		data->PrepareForCpuAccess();
+		wfms[i] = data;
+
+		col.m_name = in.GetName();
+		col.m_uniform = dynamic_cast<UniformWaveformBase*>(data) != nullptr;
+		col.m_xunit = in.GetXAxisUnits().ToString();
+		col.m_yunit = in.GetYAxisUnits().ToString();
+		col.m_timescale = data->m_timescale;
+		col.m_startTimestamp = data->m_startTimestamp;
+		col.m_startFemtoseconds = data->m_startFemtoseconds;
+		col.m_triggerPhase = data->m_triggerPhase;
+		col.m_flags = data->m_flags;
+		col.m_count = data->size();
+
+		col.m_chunks.resize( (col.m_count + CHUNK_SAMPLES - 1) / CHUNK_SAMPLES);
+		for(size_t j=0; j<col.m_chunks.size(); j++)
+		{
+			col.m_chunks[j].m_firstSample = j * CHUNK_SAMPLES;
+			col.m_chunks[j].m_count = min((uint64_t)CHUNK_SAMPLES, col.m_count - j*CHUNK_SAMPLES);
+		}
+	}
+
+	if(!m_fp && !OpenFile())
+		return;
+
+	//Encode and queue each column in turn.
+	//Protocol columns call into arbitrary GetText() / GetColor() implementations which may not be thread safe, and
+	//share a color table across chunks, so those are encoded on this thread only.
+	for(size_t i=0; i<ncols; i++)
+	{
+		auto& col = columns[i];
+		size_t nchunks = col.m_chunks.size();
+
+		vector<string> payloads(nchunks);
+		map<string, size_t> colorIndexes;
+		#pragma omp parallel for if(col.m_type != COLUMN_PROTOCOL)
+		for(size_t j=0; j<nchunks; j++)
+			EncodeChunk(wfms[i], col, col.m_chunks[j], payloads[j], colorIndexes);
+
+		for(size_t j=0; j<nchunks; j++)
+		{
+			col.m_chunks[j].m_offset = m_writeOffset;
+			col.m_chunks[j].m_length = payloads[j].size();
+			m_writeOffset += payloads[j].size();
+			QueueWrite(std::move(payloads[j]));
+		}
+	}
+
+	//Finish the segment
+	string footer;
+	WriteFooter(footer, m_lastTrailerOffset, columns);
+	string trailer;
+	WriteTrailer(trailer, m_writeOffset, footer.size());
+	m_writeOffset += footer.size();
+	m_lastTrailerOffset = m_writeOffset;
+	m_writeOffset += TRAILER_SIZE;
+	QueueWrite(std::move(footer));
+	QueueWrite(std::move(trailer));
+
+	//Append mode keeps the file open between exports. Other modes rewrite the file from scratch next time.
+	auto mode = static_cast<ExportMode_t>(m_parameters[m_mode].GetIntVal());
+	if( (mode != MODE_CONTINUOUS_APPEND) && (mode != MODE_MANUAL_APPEND) )
+		QueueClose();
+}
+
+/**
+	@brief Encodes one chunk of a column
+
+	@param wfm			The waveform being exported
+	@param col			The column being exported (the color table is updated for protocol columns)
+	@param chunk		The chunk to encode (time range and codec are filled in)
+	@param out			Buffer for the chunk payload
+	@param colorIndexes	Map of colors to indexes in the color table, for protocol columns
+ */
+void WaveformArchiveExportFilter::EncodeChunk(
+	WaveformBase* wfm,
+	ColumnInfo& col,
+	ChunkInfo& chunk,
+	string& out,
+	map<string, size_t>& colorIndexes)
+{
+	size_t first = chunk.m_firstSample;
+	size_t n = chunk.m_count;
+	size_t last = first + n - 1;
+	Writer w(out);
+
+	//Timestamps
+	auto swfm = dynamic_cast<SparseWaveformBase*>(wfm);
+	if(swfm)
+	{
+		EncodeDeltas(w, swfm->m_offsets.GetCpuPointer() + first, n);
+		EncodeDeltas(w, swfm->m_durations.GetCpuPointer() + first, n);
+		chunk.m_startTime = swfm->m_offsets[first] * wfm->m_timescale + wfm->m_triggerPhase;
+		chunk.m_endTime = (swfm->m_offsets[last] + swfm->m_durations[last]) * wfm->m_timescale + wfm->m_triggerPhase;
+	}
+	else
+	{
+		chunk.m_startTime = static_cast<int64_t>(first) * wfm->m_timescale + wfm->m_triggerPhase;
+		chunk.m_endTime = static_cast<int64_t>(last + 1) * wfm->m_timescale + wfm->m_triggerPhase;
+	}
+
+	//Sample values
+	chunk.m_codec = CODEC_RAW;
+	switch(col.m_type)
+	{
+		case COLUMN_ANALOG:
+			{
+				auto ua = dynamic_cast<UniformAnalogWaveform*>(wfm);
+				auto sa = dynamic_cast<SparseAnalogWaveform*>(wfm);
+				const float* p = ua ? ua->m_samples.GetCpuPointer() : sa->m_samples.GetCpuPointer();
+				chunk.m_codec = EncodeFloats(w, p + first, n);
+			}
+			break;
+
+		case COLUMN_DIGITAL:
+			{
+				auto ud = dynamic_cast<UniformDigitalWaveform*>(wfm);
+				auto sd = dynamic_cast<SparseDigitalWaveform*>(wfm);
+				const bool* p = ud ? ud->m_samples.GetCpuPointer() : sd->m_samples.GetCpuPointer();
+				EncodeBits(w, p + first, n);
+			}
+			break;
+
+		case COLUMN_PROTOCOL:
+			for(size_t i=first; i<=last; i++)
+			{
+				auto color = wfm->GetColor(i);
+				auto it = colorIndexes.find(color);
+				if(it == colorIndexes.end())
+				{
+					it = colorIndexes.emplace(color, col.m_colors.size()).first;
+					col.m_colors.push_back(color);
+				}
+				w.PutVarint(it->second);
+				w.PutString(wfm->GetText(i));
+			}
+			break;
+	}
+}
+
+void WaveformArchiveExportFilter::OnColumnCountChanged()
+{
+	//Close the existing file
+	CloseFile();
+
+	//Add new ports
+	size_t sizeNew = m_parameters[m_inputCount].GetIntVal();
+	size_t sizeOld = m_inputs.size();
+	for(size_t i=sizeOld; i<sizeNew; i++)
+		CreateInput(string("column") + to_string(i+1));
+
+	//Remove extra ports, if any
+	m_inputs.resize(sizeNew);
+	m_signalNames.resize(sizeNew);
+
+	//Inputs changed
+	signal_inputsChanged().emit();
+}
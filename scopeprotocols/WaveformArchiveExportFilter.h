@@ -0,0 +1,80 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of WaveformArchiveExportFilter
+ */
+#ifndef WaveformArchiveExportFilter_h
+#define WaveformArchiveExportFilter_h
+
+#include "ExportFilter.h"
+#include "WaveformArchive.h"
+
+/**
+	@brief Exports waveforms to the chunked, columnar waveform archive format (see WaveformArchive)
+
+	Unlike CSV, every column keeps its own timebase, so uniform and sparse waveforms of any sample rate can be mixed
+	in one file and read back exactly. Each export writes one segment; append modes add a new segment per export.
+ */
+class WaveformArchiveExportFilter : public ExportFilter
+{
+public:
+	WaveformArchiveExportFilter(const std::string& color);
+
+	static std::string GetProtocolName();
+
+	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
+
+	PROTOCOL_DECODER_INITPROC(WaveformArchiveExportFilter)
+
+protected:
+	virtual void Export() override;
+
+	void OnColumnCountChanged();
+
+	bool OpenFile();
+
+	static void EncodeChunk(
+		WaveformBase* wfm,
+		WaveformArchive::ColumnInfo& col,
+		WaveformArchive::ChunkInfo& chunk,
+		std::string& out,
+		std::map<std::string, size_t>& colorIndexes);
+
+	std::string m_inputCount;
+
+	///@brief Offset in the file at which the next byte we queue will land
+	uint64_t m_writeOffset;
+
+	///@brief Offset of the most recent segment trailer in the file, or zero if there are none
+	uint64_t m_lastTrailerOffset;
+};
+
+#endif
@@ -0,0 +1,388 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of WaveformArchiveImportFilter
+ */
+
+#include "../scopehal/scopehal.h"
+#include "WaveformArchiveImportFilter.h"
+
+using namespace std;
+using namespace WaveformArchive;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+WaveformArchiveImportFilter::WaveformArchiveImportFilter(const string& color)
+	: ImportFilter(color)
+	, m_segment("Segment")
+	, m_limitRange("Limit time range")
+	, m_rangeStart("Range start")
+	, m_rangeEnd("Range end")
+{
+	m_fpname = "Waveform Archive";
+	m_parameters[m_fpname] = FilterParameter(FilterParameter::TYPE_FILENAME, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_fpname].m_fileFilterMask = "*.swa";
+	m_parameters[m_fpname].m_fileFilterName = "Waveform archive files (*.swa)";
+	m_parameters[m_fpname].signal_changed().connect(
+		sigc::mem_fun(*this, &WaveformArchiveImportFilter::OnFileNameChanged));
+
+	m_parameters[m_segment] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_segment].SetIntVal(0);
+	m_parameters[m_segment].signal_changed().connect(
+		sigc::mem_fun(*this, &WaveformArchiveImportFilter::OnFileNameChanged));
+
+	m_parameters[m_limitRange] = FilterParameter(FilterParameter::TYPE_BOOL, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_limitRange].SetBoolVal(false);
+	m_parameters[m_limitRange].signal_changed().connect(
+		sigc::mem_fun(*this, &WaveformArchiveImportFilter::OnFileNameChanged));
+
+	m_parameters[m_rangeStart] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_FS));
+	m_parameters[m_rangeStart].SetIntVal(0);
+	m_parameters[m_rangeStart].signal_changed().connect(
+		sigc::mem_fun(*this, &WaveformArchiveImportFilter::OnFileNameChanged));
+
+	m_parameters[m_rangeEnd] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_FS));
+	m_parameters[m_rangeEnd].SetIntVal(0);
+	m_parameters[m_rangeEnd].signal_changed().connect(
+		sigc::mem_fun(*this, &WaveformArchiveImportFilter::OnFileNameChanged));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+string WaveformArchiveImportFilter::GetProtocolName()
+{
+	return "Waveform Archive Import";
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Actual decoder logic
+
+void WaveformArchiveImportFilter::OnFileNameChanged()
+{
+	ClearErrors();
+
+	auto fname = m_parameters[m_fpname].ToString();
+	if(fname.empty())
+	{
+		AddErrorMessage("Missing inputs", "No file name specified");
+		return;
+	}
+
+	double start = GetTime();
+
+	MappedFile file;
+	if(!file.Open(fname))
+	{
+		AddErrorMessage("Bad file", string("Failed to open file ") + fname);
+		return;
+	}
+
+	ClearStreams();
+
+	vector<uint64_t> trailers;
+	if(!FindSegments(file, trailers))
+		return;
+
+	auto segment = m_parameters[m_segment].GetIntVal();
+	if( (segment < 0) || (segment >= (int64_t)trailers.size()) )
+	{
+		AddErrorMessage(
+			"Bad segment",
+			string("Segment ") + to_string(segment) + " requested but the file only has " +
+				to_string(trailers.size()));
+		return;
+	}
+
+	//FindSegments() already checked the trailer and that the footer is within the file
+	uint64_t footerOffset;
+	uint64_t footerLength;
+	ReadTrailer(file.GetPointer(trailers[segment], TRAILER_SIZE), footerOffset, footerLength);
+	uint64_t prevTrailerOffset;
+	vector<ColumnInfo> columns;
+	if(!ReadFooter(file.GetPointer(footerOffset, footerLength), footerLength, prevTrailerOffset, columns))
+	{
+		AddErrorMessage("Bad file", "Segment footer is corrupted");
+		return;
+	}
+
+	if(!columns.empty())
+		SetXAxisUnits(Unit(columns[0].m_xunit));
+
+	for(size_t i=0; i<columns.size(); i++)
+	{
+		auto& col = columns[i];
+
+		Stream::StreamType stype;
+		switch(col.m_type)
+		{
+			case COLUMN_ANALOG:
+				stype = Stream::STREAM_TYPE_ANALOG;
+				break;
+
+			case COLUMN_DIGITAL:
+				stype = Stream::STREAM_TYPE_DIGITAL;
+				break;
+
+			case COLUMN_PROTOCOL:
+			default:
+				stype = Stream::STREAM_TYPE_PROTOCOL;
+				break;
+		}
+		AddStream(Unit(col.m_yunit), col.m_name, stype);
+
+		auto wfm = LoadColumn(file, col);
+		if(!wfm)
+			AddErrorMessage("Bad file", string("Sample data for column ") + col.m_name + " is corrupted");
+		SetData(wfm, i);
+	}
+
+	m_outputsChangedSignal.emit();
+
+	double dt = GetTime() - start;
+	LogTrace("Waveform archive loading took %.3f sec\n", dt);
+}
+
+/**
+	@brief Finds the trailers of every segment in the file, by following the back links from the end of the file
+
+	@param file		The file
+	@param trailers	File offset of each segment's trailer, in file order
+
+	@return True on success
+ */
+bool WaveformArchiveImportFilter::FindSegments(MappedFile& file, vector<uint64_t>& trailers)
+{
+	auto magic = file.GetPointer(0, sizeof(FILE_MAGIC));
+	if(!magic || memcmp(magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+	{
+		AddErrorMessage("Bad file", "Not a waveform archive");
+		return false;
+	}
+
+	if(file.GetSize() < sizeof(FILE_MAGIC) + TRAILER_SIZE)
+	{
+		AddErrorMessage("Bad file", "File contains no waveforms");
+		return false;
+	}
+
+	uint64_t trailer = file.GetSize() - TRAILER_SIZE;
+	while(true)
+	{
+		uint64_t footerOffset;
+		uint64_t footerLength;
+		auto ptrailer = file.GetPointer(trailer, TRAILER_SIZE);
+		auto pfooter = ptrailer && ReadTrailer(ptrailer, footerOffset, footerLength) ?
+			file.GetPointer(footerOffset, footerLength) : nullptr;
+		if(!pfooter || (footerLength < sizeof(uint64_t)) )
+		{
+			AddErrorMessage("Bad file", "Segment trailer is corrupted (was the file truncated?)");
+			return false;
+		}
+		trailers.push_back(trailer);
+
+		//The footer starts with the offset of the previous trailer, which must be earlier in the file
+		uint64_t prev;
+		memcpy(&prev, pfooter, sizeof(prev));
+		if(prev == 0)
+			break;
+		if(prev >= trailer)
+		{
+			AddErrorMessage("Bad file", "Segment trailer is corrupted");
+			return false;
+		}
+		trailer = prev;
+	}
+
+	reverse(trailers.begin(), trailers.end());
+	return true;
+}
+
+/**
+	@brief Creates a waveform containing the chunks of a column which overlap the requested time range
+
+	The range is rounded out to whole chunks. Chunks outside it are never read from the file.
+
+	@param file		The file
+	@param col		The column to load
+
+	@return The new waveform, or nullptr if the file is corrupted
+ */
+WaveformBase* WaveformArchiveImportFilter::LoadColumn(MappedFile& file, const ColumnInfo& col)
+{
+	//Pick the chunks to load, and where each one goes in the output
+	bool limit = m_parameters[m_limitRange].GetBoolVal();
+	int64_t rangeStart = m_parameters[m_rangeStart].GetIntVal();
+	int64_t rangeEnd = m_parameters[m_rangeEnd].GetIntVal();
+	vector<const ChunkInfo*> chunks;
+	vector<size_t> bases;
+	size_t total = 0;
+	for(auto& chunk : col.m_chunks)
+	{
+		if(limit && ( (chunk.m_endTime < rangeStart) || (chunk.m_startTime > rangeEnd) ) )
+			continue;
+		if(chunk.m_count > CHUNK_SAMPLES)
+			return nullptr;
+
+		chunks.push_back(&chunk);
+		bases.push_back(total);
+		total += chunk.m_count;
+	}
+	size_t firstSample = chunks.empty() ? 0 : chunks[0]->m_firstSample;
+
+	//Make the waveform. Uniform protocol columns are loaded as sparse, with one sample per timebase tick.
+	WaveformBase* wfm;
+	float* analog = nullptr;
+	bool* digital = nullptr;
+	WaveformArchiveProtocolWaveform* protocol = nullptr;
+	switch(col.m_type)
+	{
+		case COLUMN_ANALOG:
+			if(col.m_uniform)
+			{
+				auto uwfm = new UniformAnalogWaveform;
+				uwfm->Resize(total);
+				uwfm->PrepareForCpuAccess();
+				analog = uwfm->m_samples.GetCpuPointer();
+				wfm = uwfm;
+			}
+			else
+			{
+				auto swfm = new SparseAnalogWaveform;
+				swfm->Resize(total);
+				swfm->PrepareForCpuAccess();
+				analog = swfm->m_samples.GetCpuPointer();
+				wfm = swfm;
+			}
+			break;
+
+		case COLUMN_DIGITAL:
+			if(col.m_uniform)
+			{
+				auto uwfm = new UniformDigitalWaveform;
+				uwfm->Resize(total);
+				uwfm->PrepareForCpuAccess();
+				digital = uwfm->m_samples.GetCpuPointer();
+				wfm = uwfm;
+			}
+			else
+			{
+				auto swfm = new SparseDigitalWaveform;
+				swfm->Resize(total);
+				swfm->PrepareForCpuAccess();
+				digital = swfm->m_samples.GetCpuPointer();
+				wfm = swfm;
+			}
+			break;
+
+		case COLUMN_PROTOCOL:
+		default:
+			protocol = new WaveformArchiveProtocolWaveform;
+			protocol->Resize(total);
+			protocol->PrepareForCpuAccess();
+			protocol->m_text.resize(total);
+			protocol->m_colors = col.m_colors;
+			wfm = protocol;
+			break;
+	}
+
+	wfm->m_timescale = col.m_timescale;
+	wfm->m_startTimestamp = col.m_startTimestamp;
+	wfm->m_startFemtoseconds = col.m_startFemtoseconds;
+	wfm->m_triggerPhase = col.m_triggerPhase;
+	wfm->m_flags = col.m_flags;
+
+	//Uniform waveforms start at sample zero, so shift the trigger phase to where the first chunk we loaded begins
+	auto swfm = dynamic_cast<SparseWaveformBase*>(wfm);
+	if(!swfm)
+		wfm->m_triggerPhase += static_cast<int64_t>(firstSample) * col.m_timescale;
+
+	//Decode the chunks
+	size_t nchunks = chunks.size();
+	vector<uint8_t> ok(nchunks, 0);
+	#pragma omp parallel for
+	for(size_t j=0; j<nchunks; j++)
+	{
+		auto& chunk = *chunks[j];
+		size_t base = bases[j];
+		size_t count = chunk.m_count;
+
+		auto p = file.GetPointer(chunk.m_offset, chunk.m_length);
+		if(!p)
+			continue;
+		Reader r(p, chunk.m_length);
+
+		//Timestamps
+		if(!col.m_uniform)
+		{
+			DecodeDeltas(r, swfm->m_offsets.GetCpuPointer() + base, count);
+			DecodeDeltas(r, swfm->m_durations.GetCpuPointer() + base, count);
+		}
+		else if(swfm)
+		{
+			for(size_t k=0; k<count; k++)
+			{
+				swfm->m_offsets[base + k] = chunk.m_firstSample + k;
+				swfm->m_durations[base + k] = 1;
+			}
+		}
+
+		//Sample values
+		bool good = r.IsOK();
+		if(analog)
+			good &= DecodeFloats(r, chunk.m_codec, analog + base, count);
+		else if(digital)
+			good &= DecodeBits(r, digital + base, count);
+		else
+		{
+			for(size_t k=0; k<count; k++)
+			{
+				protocol->m_samples[base + k] = r.GetVarint();
+				protocol->m_text[base + k] = r.GetString();
+			}
+			good &= r.IsOK();
+		}
+		ok[j] = good;
+	}
+
+	for(auto b : ok)
+	{
+		if(!b)
+		{
+			delete wfm;
+			return nullptr;
+		}
+	}
+
+	wfm->MarkModifiedFromCpu();
+	return wfm;
+}
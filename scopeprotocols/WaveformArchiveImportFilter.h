@@ -0,0 +1,88 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of WaveformArchiveImportFilter
+ */
+#ifndef WaveformArchiveImportFilter_h
+#define WaveformArchiveImportFilter_h
+
+#include "WaveformArchive.h"
+
+/**
+	@brief A protocol waveform read back from a waveform archive: the text and color of each sample, as exported
+
+	Each sample value is an index into m_colors.
+ */
+class WaveformArchiveProtocolWaveform : public SparseWaveform<uint32_t>
+{
+public:
+	virtual std::string GetText(size_t i) override
+	{ return m_text[i]; }
+
+	virtual std::string GetColor(size_t i) override
+	{ return (m_samples[i] < m_colors.size()) ? m_colors[m_samples[i]] : SparseWaveform<uint32_t>::GetColor(i); }
+
+	///@brief Text of each sample
+	std::vector<std::string> m_text;
+
+	///@brief Color table
+	std::vector<std::string> m_colors;
+};
+
+/**
+	@brief Imports waveforms from the chunked, columnar waveform archive format (see WaveformArchive)
+
+	Loads one segment (i.e. one export) of the file, optionally only the part of it overlapping a time range. Only the
+	chunks overlapping the range are read from disk, and chunks are decoded in parallel.
+ */
+class WaveformArchiveImportFilter : public ImportFilter
+{
+public:
+	WaveformArchiveImportFilter(const std::string& color);
+
+	static std::string GetProtocolName();
+
+	PROTOCOL_DECODER_INITPROC(WaveformArchiveImportFilter)
+
+protected:
+	void OnFileNameChanged();
+
+	bool FindSegments(MappedFile& file, std::vector<uint64_t>& trailers);
+
+	WaveformBase* LoadColumn(MappedFile& file, const WaveformArchive::ColumnInfo& col);
+
+	std::string m_segment;
+	std::string m_limitRange;
+	std::string m_rangeStart;
+	std::string m_rangeEnd;
+};
+
+#endif
@@ -77,20 +77,6 @@ string WindowFilter::GetProtocolName()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
-template<class T>
-void DoCopy(T* w_in, T* w_out, size_t start_sample, size_t end_sample)
-{
-	w_out->Resize(end_sample - start_sample);
-
-	memcpy(__builtin_assume_aligned(&w_out->m_samples[0], 16),
-		(uint8_t*)__builtin_assume_aligned(&w_in->m_samples[0], 16) + (start_sample*sizeof(w_in->m_samples[0])),
-		(end_sample - start_sample) * sizeof(w_in->m_samples[0]));
-
-	w_out->m_triggerPhase = GetOffsetScaled(w_in, start_sample);
-
-	w_out->MarkModifiedFromCpu();
-}
-
 void WindowFilter::Refresh()
 {
 	//Make sure we've got valid inputs
@@ -115,25 +101,28 @@ void WindowFilter::Refresh()
 	if (end_sample >= in->size())
 		end_sample = in->size() - 1;
 
+	//The output is a view into the input's buffers, so no samples are copied
+	size_t count = (end_sample > start_sample) ? (end_sample - start_sample) : 0;
+
 	if(auto uaw = dynamic_cast<UniformAnalogWaveform*>(in))
 	{
 		m_streams[0].m_stype = Stream::STREAM_TYPE_ANALOG; // TODO: I think this races with WaveformArea::MapAllBuffers
-		DoCopy(uaw, SetupEmptyUniformAnalogOutputWaveform(uaw, 0), start_sample, end_sample);
+		SetupEmptyUniformAnalogOutputWaveform(uaw, 0)->ShareRangeFrom(uaw, start_sample, count);
 	}
 	else if (auto saw = dynamic_cast<SparseAnalogWaveform*>(in))
 	{
 		m_streams[0].m_stype = Stream::STREAM_TYPE_ANALOG; // TODO: I think this races with WaveformArea::MapAllBuffers
-		DoCopy(saw, SetupSparseOutputWaveform(saw, 0, start_sample, saw->size() - end_sample), start_sample, end_sample);
+		SetupEmptySparseAnalogOutputWaveform(saw, 0)->ShareRangeFrom(saw, start_sample, count);
 	}
 	else if(auto udw = dynamic_cast<UniformDigitalWaveform*>(in))
 	{
 		m_streams[0].m_stype = Stream::STREAM_TYPE_DIGITAL; // TODO: I think this races with WaveformArea::MapAllBuffers
-		DoCopy(udw, SetupEmptyUniformDigitalOutputWaveform(udw, 0), start_sample, end_sample);
+		SetupEmptyUniformDigitalOutputWaveform(udw, 0)->ShareRangeFrom(udw, start_sample, count);
 	}
 	else if (auto sdw = dynamic_cast<SparseDigitalWaveform*>(in))
 	{
 		m_streams[0].m_stype = Stream::STREAM_TYPE_DIGITAL; // TODO: I think this races with WaveformArea::MapAllBuffers
-		DoCopy(sdw, SetupSparseDigitalOutputWaveform(sdw, 0, start_sample, sdw->size() - end_sample), start_sample, end_sample);
+		SetupEmptySparseDigitalOutputWaveform(sdw, 0)->ShareRangeFrom(sdw, start_sample, count);
 	}
 	else
 	{
@@ -144,6 +144,7 @@ void ScopeProtocolStaticInit()
 	AddDecoderClass(J1939SourceMatchFilter);
 	AddDecoderClass(J1939TransportDecoder);
 	AddDecoderClass(ISIMeasurement);
+	AddDecoderClass(JitterAnalysisFilter);
 	AddDecoderClass(JitterFilter);
 	AddDecoderClass(JitterSpectrumFilter);
 	AddDecoderClass(JtagDecoder);
@@ -195,6 +196,7 @@ void ScopeProtocolStaticInit()
 	AddDecoderClass(SDCmdDecoder);
 	AddDecoderClass(SDDataDecoder);
 	AddDecoderClass(SetupHoldMeasurement);
+	AddDecoderClass(SharedMemoryExportFilter);
 	AddDecoderClass(SNRFilter);
 	AddDecoderClass(SParameterCascadeFilter);
 	AddDecoderClass(SParameterDeEmbedFilter);
@@ -237,6 +239,8 @@ void ScopeProtocolStaticInit()
 	AddDecoderClass(VerticalBathtub);
 	AddDecoderClass(VICPDecoder);
 	AddDecoderClass(Waterfall);
+	AddDecoderClass(WaveformArchiveExportFilter);
+	AddDecoderClass(WaveformArchiveImportFilter);
 	AddDecoderClass(WAVImportFilter);
 	AddDecoderClass(WFMImportFilter);
 	AddDecoderClass(WindowedAutocorrelationFilter);
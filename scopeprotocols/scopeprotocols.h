@@ -96,6 +96,7 @@
 #include "EnvelopeFilter.h"
 #include "ESPIDecoder.h"
 #include "EthernetProtocolDecoder.h"		//must be before all other ethernet decodes
+#include "EthernetFlowTable.h"
 #include "EthernetAutonegotiationDecoder.h"
 #include "EthernetAutonegotiationPageDecoder.h"
 #include "EthernetBaseXAutonegotiationDecoder.h"
@@ -144,6 +145,7 @@
 #include "J1939PDUDecoder.h"
 #include "J1939SourceMatchFilter.h"
 #include "J1939TransportDecoder.h"
+#include "JitterAnalysisFilter.h"
 #include "JitterFilter.h"
 #include "JitterSpectrumFilter.h"
 #include "JtagDecoder.h"
@@ -195,6 +197,7 @@
 #include "SDCmdDecoder.h"
 #include "SDDataDecoder.h"
 #include "SetupHoldMeasurement.h"
+#include "SharedMemoryExportFilter.h"
 #include "SNRFilter.h"
 #include "SParameterCascadeFilter.h"
 #include "SParameterDeEmbedFilter.h"
@@ -237,6 +240,8 @@
 #include "VerticalBathtub.h"
 #include "VICPDecoder.h"
 #include "Waterfall.h"
+#include "WaveformArchiveExportFilter.h"
+#include "WaveformArchiveImportFilter.h"
 #include "WAVImportFilter.h"
 #include "WFMImportFilter.h"
 #include "WindowedAutocorrelationFilter.h"
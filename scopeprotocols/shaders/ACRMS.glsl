@@ -67,15 +67,15 @@ void main()
 	if(nend > numSamples)
 		nend = numSamples;
 
-	//Kahan summation to improve numerical stability
-	float temp = 0;
-	float c = 0;
+	//Kahan summation to improve numerical stability, must not be reassociated by the compiler
+	precise float temp = 0;
+	precise float c = 0;
 	for(uint i=nstart; i<nend; i++)
 	{
 		float delta = pin[i] - dcBias;
 		float deltaSquared = delta * delta;
-		float y = deltaSquared - c;
-		float t = temp + y;
+		precise float y = deltaSquared - c;
+		precise float t = temp + y;
 		c = (t - temp) - y;
 		temp = t;
 	}
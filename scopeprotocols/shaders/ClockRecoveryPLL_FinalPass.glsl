@@ -78,6 +78,12 @@ layout(std430, binding=8) restrict readonly buffer buf_din
 	float isamples[];
 };
 
+//Timestamps of the input samples, only used if sparseInput is set
+layout(std430, binding=9) restrict readonly buffer buf_dinOffsets
+{
+	int64_t ioffsets[];
+};
+
 layout(std430, push_constant) uniform constants
 {
 	int64_t	initialPeriod;
@@ -88,6 +94,7 @@ layout(std430, push_constant) uniform constants
 	uint	nedges;
 	uint	maxOffsetsPerThread;
 	uint	maxInputSamples;
+	uint	sparseInput;
 };
 
 #define X_SIZE 8
@@ -97,6 +104,30 @@ layout(local_size_x=X_SIZE, local_size_y=Y_SIZE, local_size_z=1) in;
 
 shared int64_t prefetchBlock[Y_SIZE][X_SIZE + 1];
 
+/**
+	@brief Finds the index of the input sample at a given timestamp
+ */
+uint GetInputIndex(int64_t t)
+{
+	//Uniform input: the index is just the time
+	if(sparseInput == 0)
+		return min(uint((t - triggerPhase) / timescale), maxInputSamples-1);
+
+	//Sparse input: binary search for the last sample starting at or before t
+	int64_t ticks = (t - triggerPhase) / timescale;
+	uint lo = 0;
+	uint hi = maxInputSamples;
+	while( (hi - lo) > 1)
+	{
+		uint mid = (lo + hi) / 2;
+		if(ioffsets[mid] <= ticks)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
 void main()
 {
 	//If this is the first thread, special case since we copy from the first block
@@ -127,7 +158,7 @@ void main()
 				squarewave[iout] = uint8_t(iout & 1);
 
 				//Generate the squarewave output
-				uint nsample = min(uint((lastOffset - triggerPhase) / timescale), maxInputSamples-1);
+				uint nsample = GetInputIndex(lastOffset);
 				float sampledData = isamples[nsample];
 				offsets[iout] = lastOffset;
 				durations[iout] = nextOffset - lastOffset;
@@ -150,7 +181,7 @@ void main()
 		durations[iout] = lastPeriod;
 
 		//Generate sampled data output
-		uint nsample = min(uint((tout - triggerPhase) / timescale), maxInputSamples-1);
+		uint nsample = GetInputIndex(tout);
 		ssamples[iout] = isamples[nsample];
 	}
 
@@ -188,7 +219,7 @@ void main()
 				squarewave[iout] = uint8_t(iout & 1);
 
 				//Generate the squarewave output
-				uint nsample = min(uint((lastOffset - triggerPhase) / timescale), maxInputSamples-1);
+				uint nsample = GetInputIndex(lastOffset);
 				float sampledData = isamples[nsample];
 				offsets[iout] = lastOffset;
 				durations[iout] = nextOffset - lastOffset;
@@ -211,7 +242,7 @@ void main()
 		durations[iout] = lastPeriod;
 
 		//Generate sampled data output
-		uint nsample = min(uint((tout - triggerPhase) / timescale), maxInputSamples-1);
+		uint nsample = GetInputIndex(tout);
 		ssamples[iout] = isamples[nsample];
 	}
 }
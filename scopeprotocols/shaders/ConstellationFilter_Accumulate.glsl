@@ -0,0 +1,155 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 460
+#pragma shader_stage(compute)
+
+#extension GL_ARB_gpu_shader_int64 : require
+#extension GL_EXT_shader_atomic_int64 : require
+
+layout(std430, binding=0) restrict readonly buffer buf_samplesI
+{
+	float samplesI[];
+};
+
+layout(std430, binding=1) restrict readonly buffer buf_samplesQ
+{
+	float samplesQ[];
+};
+
+layout(std430, binding=2) buffer buf_accum
+{
+	int64_t accum[];
+};
+
+//Largest accumulator value, kept up to date for normalization
+layout(std430, binding=3) buffer buf_nmax
+{
+	int64_t nmax;
+};
+
+//Nominal constellation points, in volts
+layout(std430, binding=4) restrict readonly buffer buf_points
+{
+	vec2 points[];
+};
+
+//Error vector statistics of each workgroup: sum of |error|, sum of |error|^2, sum of |reference|^2, symbol count
+layout(std430, binding=5) restrict writeonly buffer buf_stats
+{
+	vec4 stats[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint	len;
+	uint	width;
+	uint	height;
+	uint	numPoints;
+	float	xscale;
+	float	xmid;
+	float	yscale;
+	float	ymid;
+	float	centerI;
+	float	centerQ;
+};
+
+#define NUM_THREADS 64
+layout(local_size_x=NUM_THREADS, local_size_y=1, local_size_z=1) in;
+
+shared vec4 g_stats[NUM_THREADS];
+shared int64_t g_nmax[NUM_THREADS];
+
+/**
+	@brief Bins sampled I/Q symbols into the constellation, and measures their error vectors in the same pass
+
+	Each workgroup writes its own error vector statistics, which are summed on the CPU.
+ */
+void main()
+{
+	vec4 local = vec4(0);
+	int64_t localMax = 0;
+	uint stride = gl_NumWorkGroups.x * NUM_THREADS;
+	for(uint i=gl_GlobalInvocationID.x; i<len; i += stride)
+	{
+		float ival = samplesI[i];
+		float qval = samplesQ[i];
+
+		int x = int(round(xmid + xscale * ival));
+		int y = int(round(ymid + yscale * qval));
+
+		//bounds check
+		if( (x < 0) || (x >= int(width)) || (y < 0) || (y >= int(height)) )
+			continue;
+
+		//fill, and track the new peak
+		localMax = max(localMax, atomicAdd(accum[y*width + x], int64_t(1)) + 1);
+
+		//Compute error vector against the nearest nominal point
+		if(numPoints == 0)
+			continue;
+		float minvec = 1e30;
+		vec2 nearest = points[0];
+		for(uint j=0; j<numPoints; j++)
+		{
+			vec2 d = points[j] - vec2(ival, qval);
+			float dsq = dot(d, d);
+			if(dsq < minvec)
+			{
+				minvec = dsq;
+				nearest = points[j];
+			}
+		}
+
+		vec2 ref = nearest - vec2(centerI, centerQ);
+		local += vec4(sqrt(minvec), minvec, dot(ref, ref), 1);
+	}
+
+	//Reduce across the workgroup
+	uint t = gl_LocalInvocationID.x;
+	g_stats[t] = local;
+	g_nmax[t] = localMax;
+	barrier();
+	for(uint n=NUM_THREADS/2; n>0; n >>= 1)
+	{
+		if(t < n)
+		{
+			g_stats[t] += g_stats[t + n];
+			g_nmax[t] = max(g_nmax[t], g_nmax[t + n]);
+		}
+		barrier();
+	}
+
+	if(t == 0)
+	{
+		stats[gl_WorkGroupID.x] = g_stats[0];
+		if(g_nmax[0] != 0)
+			atomicMax(nmax, g_nmax[0]);
+	}
+}
@@ -0,0 +1,125 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Descrambles and decodes aligned 64b/66b blocks, one block per thread
+
+	The x^58 + x^39 + 1 descrambler is self-synchronizing: each output bit depends only on the scrambled input 39
+	and 58 payload bits earlier. So every block can be descrambled independently from its own bits and the payload of
+	the block before it, with no LFSR state carried between threads.
+ */
+
+#version 430
+#pragma shader_stage(compute)
+
+#extension GL_EXT_shader_8bit_storage : require
+#extension GL_ARB_gpu_shader_int64 : require
+
+layout(std430, binding=0) restrict readonly buffer buf_din
+{
+	uint8_t din[];
+};
+
+layout(std430, binding=1) restrict readonly buffer buf_offsetIn
+{
+	int64_t offsetIn[];
+};
+
+layout(std430, binding=2) restrict readonly buffer buf_durationIn
+{
+	int64_t durationIn[];
+};
+
+layout(std430, binding=3) restrict writeonly buffer buf_headerOut
+{
+	uint8_t headerOut[];
+};
+
+layout(std430, binding=4) restrict writeonly buffer buf_codewordOut
+{
+	uint64_t codewordOut[];
+};
+
+layout(std430, binding=5) restrict writeonly buffer buf_offsetOut
+{
+	int64_t offsetOut[];
+};
+
+layout(std430, binding=6) restrict writeonly buffer buf_durationOut
+{
+	int64_t durationOut[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint count;			//number of blocks to decode
+	uint start;			//index of the first bit of the first block to decode (must not be the first in the stream)
+};
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+void main()
+{
+	uint nblock = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+	if(nblock >= count)
+		return;
+
+	uint i = start + nblock*66;
+	uint prev = i - 66;
+
+	//Descramble the payload, swapping byte order as we go
+	uint64_t codeword = 0;
+	for(uint j=0; j<64; j++)
+	{
+		uint b = uint(din[i + 2 + j]);
+
+		uint tap39;
+		if(j >= 39)
+			tap39 = uint(din[i + 2 + j - 39]);
+		else
+			tap39 = uint(din[prev + 2 + 64 + j - 39]);
+
+		uint tap58;
+		if(j >= 58)
+			tap58 = uint(din[i + 2 + j - 58]);
+		else
+			tap58 = uint(din[prev + 2 + 64 + j - 58]);
+
+		if( (b ^ tap39 ^ tap58) != 0)
+			codeword |= uint64_t(1) << ( (7 - (j >> 3))*8 + (j & 7) );
+	}
+
+	headerOut[nblock] = uint8_t( (uint(din[i]) << 1) | uint(din[i+1]) );
+	codewordOut[nblock] = codeword;
+
+	//Shift back by half a UI since the sampling clock is centered in the UI
+	offsetOut[nblock] = offsetIn[i] - durationIn[i]/2;
+	durationOut[nblock] = offsetIn[i+66] - offsetIn[i];
+}
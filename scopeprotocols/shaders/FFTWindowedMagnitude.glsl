@@ -0,0 +1,107 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 430
+#pragma shader_stage(compute)
+
+layout(std430, binding=0) restrict readonly buffer buf_din
+{
+	float din[];
+};
+
+layout(std430, binding=1) restrict writeonly buffer buf_dout
+{
+	float dout[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint nouts;
+	uint npoints;
+	float scale;
+
+	//Window is alpha0 + sum(alphaN * cos(2*pi*harmonicN*i / npoints))
+	float alpha0;
+	float alpha1;
+	float alpha2;
+	float alpha3;
+	int harmonic1;
+	int harmonic2;
+	int harmonic3;
+};
+
+//Number of cosine terms in the window (0 = rectangular, 1 = Hann/Hamming, 3 = Blackman-Harris)
+layout(constant_id=0) const uint NUM_COSINE_TERMS = 3;
+
+//Output dBm rather than linear magnitude
+layout(constant_id=1) const bool LOG_OUTPUT = false;
+
+layout(local_size_x_id=2, local_size_y=1, local_size_z=1) in;
+
+/**
+	@brief Gets bin k of the full spectrum of a real signal, given only the non-negative half
+ */
+vec2 GetBin(int k)
+{
+	int n = int(npoints);
+	k = ((k % n) + n) % n;
+	if(k > n/2)
+	{
+		k = n - k;
+		return vec2(din[k*2], -din[k*2 + 1]);
+	}
+	return vec2(din[k*2], din[k*2 + 1]);
+}
+
+void main()
+{
+	uint i = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+
+	//If off end of array, stop
+	if(i >= nouts)
+		return;
+
+	//Multiplying by a cosine-sum window in the time domain is the same as convolving the spectrum with a few
+	//impulses in the frequency domain, so apply the window here rather than in a separate pass before the FFT
+	//The term count is a specialization constant, so unused terms are compiled out entirely
+	int m = int(i);
+	vec2 v = alpha0 * GetBin(m);
+	if(NUM_COSINE_TERMS >= 1)
+		v += (0.5 * alpha1) * (GetBin(m - harmonic1) + GetBin(m + harmonic1));
+	if(NUM_COSINE_TERMS >= 2)
+		v += (0.5 * alpha2) * (GetBin(m - harmonic2) + GetBin(m + harmonic2));
+	if(NUM_COSINE_TERMS >= 3)
+		v += (0.5 * alpha3) * (GetBin(m - harmonic3) + GetBin(m + harmonic3));
+
+	float power = dot(v, v);
+	if(LOG_OUTPUT)
+		dout[i] = (10 * log(power * scale) / log(10)) + 30;
+	else
+		dout[i] = sqrt(power) * scale;
+}
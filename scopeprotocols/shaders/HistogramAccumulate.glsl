@@ -0,0 +1,105 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 430
+#pragma shader_stage(compute)
+
+#extension GL_ARB_gpu_shader_int64 : require
+#extension GL_EXT_shader_atomic_int64 : require
+
+layout(std430, binding=0) restrict readonly buffer buf_pin
+{
+	float pin[];
+};
+
+layout(std430, binding=1) restrict buffer buf_pout
+{
+	uint64_t pout[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint	size;
+	uint	bins;
+	float	nmin;
+	float	nmax;
+};
+
+//Largest histogram we can prebin in shared memory (16 kB, the minimum Vulkan guarantees)
+#define MAX_LOCAL_BINS 4096
+
+#define NUM_THREADS 256
+layout(local_size_x=NUM_THREADS, local_size_y=1, local_size_z=1) in;
+
+shared uint g_localBins[MAX_LOCAL_BINS];
+
+uint GetBin(float v, float delta, float fbins)
+{
+	float fbin = (v - nmin) / delta;
+
+	uint bin = uint(floor(fbin * fbins));
+	if(fbin < 0)
+		bin = 0;
+	else
+		bin = min(bin, bins - 1);
+	return bin;
+}
+
+void main()
+{
+	float delta = nmax - nmin;
+	float fbins = float(bins);
+	uint stride = gl_NumWorkGroups.x * NUM_THREADS;
+
+	//Too many bins for shared memory, go straight to the global histogram
+	if(bins > MAX_LOCAL_BINS)
+	{
+		for(uint i=gl_GlobalInvocationID.x; i < size; i += stride)
+			atomicAdd(pout[GetBin(pin[i], delta, fbins)], 1);
+		return;
+	}
+
+	//Clear our local bins
+	for(uint i=gl_LocalInvocationID.x; i < bins; i += NUM_THREADS)
+		g_localBins[i] = 0;
+	barrier();
+
+	//Prebin this block's share of the input in shared memory
+	for(uint i=gl_GlobalInvocationID.x; i < size; i += stride)
+		atomicAdd(g_localBins[GetBin(pin[i], delta, fbins)], 1);
+	barrier();
+
+	//Then add the nonzero bins to the running totals
+	for(uint i=gl_LocalInvocationID.x; i < bins; i += NUM_THREADS)
+	{
+		uint count = g_localBins[i];
+		if(count != 0)
+			atomicAdd(pout[i], uint64_t(count));
+	}
+}
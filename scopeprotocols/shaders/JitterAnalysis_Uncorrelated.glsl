@@ -0,0 +1,138 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 460
+#pragma shader_stage(compute)
+
+#extension GL_ARB_gpu_shader_int64 : require
+#extension GL_EXT_shader_8bit_storage : require
+
+layout(std430, binding=0) restrict readonly buffer buf_tieOffsets
+{
+	int64_t tieOffsets[];
+};
+
+layout(std430, binding=1) restrict readonly buffer buf_tieSamples
+{
+	float tieSamples[];
+};
+
+layout(std430, binding=2) restrict readonly buffer buf_dataOffsets
+{
+	int64_t dataOffsets[];
+};
+
+layout(std430, binding=3) restrict readonly buffer buf_dataDurations
+{
+	int64_t dataDurations[];
+};
+
+layout(std430, binding=4) restrict readonly buffer buf_dataValues
+{
+	uint8_t dataValues[];
+};
+
+layout(std430, binding=5) restrict readonly buffer buf_numTable
+{
+	int64_t numTable[];
+};
+
+layout(std430, binding=6) restrict readonly buffer buf_sumTable
+{
+	float sumTable[];
+};
+
+layout(std430, binding=7) restrict writeonly buffer buf_ujSamples
+{
+	float ujSamples[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint numDataSamples;
+	uint numTieSamples;
+};
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+/**
+	@brief Subtracts the averaged DDJ from each TIE sample, leaving the uncorrelated (Rj + BUj) jitter
+
+	One thread per TIE sample. A TIE sample is assigned to the data bit it falls in if it's the first TIE sample in
+	that bit, exactly as DDJMeasurement.glsl does when building the table. Samples with no bit assigned are passed
+	through unchanged.
+ */
+void main()
+{
+	uint itie = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+	if(itie >= numTieSamples)
+		return;
+
+	int64_t t = tieOffsets[itie];
+	float tie = tieSamples[itie];
+	ujSamples[itie] = tie;
+
+	//Binary search for the last data bit starting at or before this TIE sample
+	if( (numDataSamples == 0) || (dataOffsets[0] > t) )
+		return;
+	uint lo = 0;
+	uint hi = numDataSamples;
+	while( (hi - lo) > 1)
+	{
+		uint mid = lo + (hi - lo)/2;
+		if(dataOffsets[mid] > t)
+			hi = mid;
+		else
+			lo = mid;
+	}
+	uint idata = lo;
+
+	//Need 8 bits of history plus the current bit
+	if(idata < 8)
+		return;
+
+	//Must be inside the bit, and the first TIE sample in it
+	int64_t tstart = dataOffsets[idata];
+	if(t > (tstart + dataDurations[idata]) )
+		return;
+	if( (itie > 0) && (tieOffsets[itie - 1] >= tstart) )
+		return;
+
+	//Build the history window (most recent bit in the MSB)
+	uint window = 0;
+	for(uint i=0; i<8; i++)
+	{
+		if(uint(dataValues[idata - i]) != 0)
+			window |= (0x80 >> i);
+	}
+
+	int64_t num = numTable[window];
+	if(num != 0)
+		ujSamples[itie] = tie - sumTable[window] / float(num);
+}
@@ -0,0 +1,184 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 460
+#pragma shader_stage(compute)
+
+#extension GL_ARB_gpu_shader_int64 : require
+#extension GL_EXT_shader_8bit_storage : require
+
+layout(std430, binding=0) restrict readonly buffer buf_pin
+{
+	float samples[];
+};
+
+layout(std430, binding=1) restrict readonly buffer buf_levels
+{
+	float levels[];
+};
+
+layout(std430, binding=2) restrict readonly buffer buf_indexes
+{
+	uint idx[];
+};
+
+layout(std430, binding=3) restrict readonly buffer buf_states
+{
+	uint8_t states[];
+};
+
+layout(std430, binding=4) restrict readonly buffer buf_rising
+{
+	uint8_t rising[];
+};
+
+layout(std430, binding=5) restrict writeonly buffer buf_tlerp
+{
+	int64_t tlerp[];
+};
+
+layout(std430, binding=6) restrict writeonly buffer buf_flags
+{
+	uint8_t flags[];
+};
+
+layout(std430, binding=7) restrict writeonly buffer buf_blockCounts
+{
+	uint blockCounts[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	int64_t timescale;
+	int64_t halfui;
+	uint count;
+	uint order;
+	uint edgesPerThread;
+};
+
+//Values for flags[]
+#define FLAG_START	1
+#define FLAG_SKIP	2
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+/**
+	@brief Third-pass edge detection: merge adjacent level crossings into symbol edges and interpolate them
+
+	Each thread processes a block of edgesPerThread crossings from the output of the merge pass. A crossing either
+	starts a new output edge, or is merged into the previous one (e.g. the 0-1 and 1-2 crossings of a 0-2 transition).
+	Merging only looks back order-2 crossings, so every crossing can be processed independently.
+ */
+void main()
+{
+	uint istart = gl_GlobalInvocationID.x * edgesPerThread;
+	uint iend = min(istart + edgesPerThread, count);
+
+	uint numStarts = 0;
+	for(uint i=istart; i<iend; i++)
+	{
+		uint sstart = idx[i] - 1;
+		uint send = idx[i] + 1;
+		uint symend = uint(states[i]);
+		bool isRising = (uint(rising[i]) != 0);
+
+		//If our first sample occurs too early in the waveform, we can't interpolate. Skip it.
+		if(sstart == 0)
+		{
+			flags[i] = uint8_t(FLAG_SKIP);
+			continue;
+		}
+
+		uint symstart;
+		if(isRising)
+			symstart = symend - 1;
+		else
+			symstart = symend + 1;
+
+		//If the previous edge is close to this one (< 0.5 UI)
+		//and they're both rising or falling, merge them
+		bool merging = false;
+		for(uint lookback = 1; lookback < order-1; lookback ++)
+		{
+			if(i <= lookback)
+				break;
+
+			int64_t delta = int64_t(idx[i] - idx[i-lookback]) * timescale;
+			if( ( (uint(rising[i-lookback]) != 0) == isRising) && (delta < halfui) )
+			{
+				merging = true;
+				sstart = idx[i-lookback] - 1;
+
+				if(isRising)
+					symstart = symend - (lookback+1);
+				else
+					symstart = symend + (lookback+1);
+			}
+			else
+				break;
+		}
+
+		//Don't run off the end of the level table if merging got confused by noise
+		symstart = min(symstart, order-1);
+
+		//Find the midpoint (for now, fixed threshold still)
+		float target = (levels[symstart] + levels[symend]) / 2;
+		int64_t t = 0;
+		for(uint j=max(sstart, 1); j<send; j++)
+		{
+			float prev = samples[j-1];
+			float cur = samples[j];
+
+			if(	( (prev <= target) && (cur > target) ) ||
+				( (prev >= target) && (cur < target) ) )
+			{
+				//Same interpolation as Filter::InterpolateTime(), between j and j+1
+				float fa = cur;
+				float fb = samples[j+1];
+				float frac = 0;
+				if( (fa > target) != (fb > target) )
+					frac = (target - fa) / (fb - fa);
+
+				t = int64_t(j)*timescale + int64_t(frac * float(timescale));
+				break;
+			}
+		}
+
+		tlerp[i] = t;
+		if(merging)
+			flags[i] = uint8_t(0);
+		else
+		{
+			flags[i] = uint8_t(FLAG_START);
+			numStarts ++;
+		}
+	}
+
+	blockCounts[gl_GlobalInvocationID.x] = numStarts;
+}
@@ -0,0 +1,207 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 460
+#pragma shader_stage(compute)
+
+#extension GL_ARB_gpu_shader_int64 : require
+#extension GL_EXT_shader_8bit_storage : require
+
+layout(std430, binding=0) restrict readonly buffer buf_tlerp
+{
+	int64_t tlerp[];
+};
+
+layout(std430, binding=1) restrict readonly buffer buf_flags
+{
+	uint8_t flags[];
+};
+
+layout(std430, binding=2) restrict readonly buffer buf_states
+{
+	uint8_t states[];
+};
+
+layout(std430, binding=3) restrict readonly buffer buf_blockCounts
+{
+	uint blockCounts[];
+};
+
+layout(std430, binding=4) restrict writeonly buffer buf_offsets
+{
+	int64_t offsets[];
+};
+
+layout(std430, binding=5) restrict writeonly buffer buf_durations
+{
+	int64_t durations[];
+};
+
+layout(std430, binding=6) restrict writeonly buffer buf_samples
+{
+	uint8_t outSamples[];
+};
+
+layout(std430, binding=7) restrict writeonly buffer buf_symOffsets
+{
+	int64_t symOffsets[];
+};
+
+layout(std430, binding=8) restrict writeonly buffer buf_symDurations
+{
+	int64_t symDurations[];
+};
+
+layout(std430, binding=9) restrict writeonly buffer buf_symSamples
+{
+	float symSamples[];
+};
+
+layout(std430, binding=10) restrict writeonly buffer buf_outputCount
+{
+	uint outputCount;
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint count;
+	uint edgesPerThread;
+};
+
+//Values for flags[]
+#define FLAG_START	1
+#define FLAG_SKIP	2
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+/**
+	@brief Returns true if crossing i is the last one merged into its output edge
+ */
+bool IsLastInGroup(uint i)
+{
+	if( (uint(flags[i]) & FLAG_SKIP) != 0)
+		return false;
+	if(i+1 >= count)
+		return true;
+	return (uint(flags[i+1]) & FLAG_START) != 0;
+}
+
+/**
+	@brief Finds the timestamp of the output edge after the one ending at crossing i
+ */
+bool NextEdgeTime(uint i, out int64_t t)
+{
+	if(i+1 >= count)
+		return false;
+	uint j = i+1;
+	while( (j+1 < count) && ( (uint(flags[j+1]) & FLAG_START) == 0) )
+		j++;
+	t = tlerp[j];
+	return true;
+}
+
+/**
+	@brief Writes one output sample (edge timestamp, toggling digital value, and sliced symbol)
+ */
+void WriteSample(uint o, int64_t offset, bool hasNext, int64_t tnext, uint symbol, bool dummy)
+{
+	offsets[o] = offset;
+	symOffsets[o] = offset;
+
+	int64_t dur = 1;
+	if(hasNext)
+		dur = tnext - offset;
+	durations[o] = dur;
+	symDurations[o] = dur;
+
+	//Sample 0 is a dummy placeholder at time zero, then the output toggles on every edge
+	if(dummy)
+		outSamples[o] = uint8_t(0);
+	else
+		outSamples[o] = uint8_t(o & 1);
+	symSamples[o] = float(symbol);
+}
+
+/**
+	@brief Final edge detection pass: compact the merged edges into the output waveforms
+
+	The output has one dummy sample at time zero, then one sample per edge. Each edge is written by the thread owning
+	the last crossing merged into it, so there are no write conflicts.
+ */
+void main()
+{
+	uint numThreads = gl_NumWorkGroups.x * gl_WorkGroupSize.x;
+	uint istart = gl_GlobalInvocationID.x * edgesPerThread;
+	uint iend = min(istart + edgesPerThread, count);
+
+	//Find starting output index
+	uint base = 0;
+	for(uint i=0; i<gl_GlobalInvocationID.x; i++)
+		base += blockCounts[i];
+
+	//Dummy sample, unless a crossing before the first edge gets merged into it
+	//(the very first crossing may have been skipped since it's too close to the start of the waveform)
+	if(gl_GlobalInvocationID.x == 0)
+	{
+		uint j = 0;
+		if( (count > 0) && ( (uint(flags[0]) & FLAG_SKIP) != 0) )
+			j = 1;
+
+		if( (j >= count) || ( (uint(flags[j]) & FLAG_START) != 0) )
+		{
+			bool hasNext = (j < count);
+			int64_t tnext = 0;
+			if(hasNext)
+			{
+				while( (j+1 < count) && ( (uint(flags[j+1]) & FLAG_START) == 0) )
+					j++;
+				tnext = tlerp[j];
+			}
+			WriteSample(0, 0, hasNext, tnext, 0, true);
+		}
+	}
+
+	uint o = base;
+	for(uint i=istart; i<iend; i++)
+	{
+		uint f = uint(flags[i]);
+		if( (f & FLAG_START) != 0)
+			o ++;
+
+		if(!IsLastInGroup(i))
+			continue;
+
+		int64_t tnext;
+		bool hasNext = NextEdgeTime(i, tnext);
+		WriteSample(o, tlerp[i], hasNext, tnext, uint(states[i]), (o == 0));
+	}
+
+	if(gl_GlobalInvocationID.x == (numThreads - 1) )
+		outputCount = base + blockCounts[gl_GlobalInvocationID.x] + 1;
+}
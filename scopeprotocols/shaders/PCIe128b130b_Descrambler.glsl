@@ -0,0 +1,103 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Extracts and descrambles aligned 128b/130b blocks, one block per thread
+
+	The PCIe gen3 scrambler is additive, so the CPU works out the LFSR state at the start of each block (jumping
+	ahead 128 bits per block) and each thread only has to run its own block's keystream.
+ */
+
+#version 430
+#pragma shader_stage(compute)
+
+#extension GL_EXT_shader_8bit_storage : require
+
+layout(std430, binding=0) restrict readonly buffer buf_din
+{
+	uint8_t din[];
+};
+
+layout(std430, binding=1) restrict readonly buffer buf_seeds
+{
+	uint seeds[];
+};
+
+layout(std430, binding=2) restrict writeonly buffer buf_dout
+{
+	uint8_t dout[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint count;			//number of blocks to decode
+	uint start;			//index of the first bit of the first block
+};
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+//Set in a block's seed if the payload is to be descrambled (the low 23 bits are the LFSR state)
+#define SEED_DESCRAMBLE 0x80000000
+
+void main()
+{
+	uint nblock = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+	if(nblock >= count)
+		return;
+
+	uint i = start + nblock*130 + 2;
+	uint seed = seeds[nblock];
+	bool descramble = (seed & SEED_DESCRAMBLE) != 0;
+	uint state = seed & 0x7fffff;
+
+	for(uint j=0; j<16; j++)
+	{
+		//Bytes are sent LSB first
+		uint tmp = 0;
+		for(uint k=0; k<8; k++)
+			tmp |= uint(din[i + j*8 + k]) << k;
+
+		if(descramble)
+		{
+			for(uint k=0; k<8; k++)
+			{
+				bool b22 = (state & 0x400000) != 0;
+				state = (state << 1) & 0x7fffff;
+				if(b22)
+				{
+					state ^= 0x210125;
+					tmp ^= (1 << k);
+				}
+			}
+		}
+
+		dout[nblock*16 + j] = uint8_t(tmp);
+	}
+}
@@ -35,9 +35,9 @@ layout(std430, binding=0) restrict readonly buffer buf_din
 	float din[];
 };
 
-layout(std430, binding=1) restrict readonly buffer buf_fkernel
+layout(std430, binding=1) restrict readonly buffer buf_table
 {
-	float fkernel[];
+	float table[];
 };
 
 layout(std430, binding=2) restrict writeonly buffer buf_dout
@@ -47,33 +47,35 @@ layout(std430, binding=2) restrict writeonly buffer buf_dout
 
 layout(std430, push_constant) uniform constants
 {
-	uint imax;
-	uint upsample_factor;
-	uint kernel;
+	uint outlen;
+	uint inlen;
+	uint upsample;
+	uint downsample;
+	uint taps;
+	int inputOffset;
 };
 
 layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
 
 void main()
 {
-	uint i = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
-
-	if(i >= imax)
-		return;
-	if(gl_GlobalInvocationID.z >= upsample_factor)
+	uint n = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+	if(n >= outlen)
 		return;
 
-	uint start = 0;
-	uint sstart = 0;
-	if(gl_GlobalInvocationID.z > 0)
-	{
-		sstart = 1;
-		start = upsample_factor - gl_GlobalInvocationID.z;
-	}
+	//Position on the upsampled grid is n*downsample, split up so it can't overflow
+	uint a = n / upsample;
+	uint bq = (n % upsample) * downsample;
+	int base = int(a*downsample + bq/upsample) + inputOffset;
+	uint row = (bq % upsample) * taps;
 
 	float f = 0;
-	for(uint k = start; k<kernel; k += upsample_factor, sstart ++)
-		f += fkernel[k] * din[gl_GlobalInvocationID.x + sstart];
+	for(uint m=0; m<taps; m++)
+	{
+		int idx = base + int(m);
+		if( (idx >= 0) && (idx < int(inlen)) )
+			f += table[row + m] * din[idx];
+	}
 
-	dout[i*upsample_factor + gl_GlobalInvocationID.z] = f;
+	dout[n] = f;
 }
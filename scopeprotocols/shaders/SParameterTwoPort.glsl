@@ -0,0 +1,157 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 430
+#pragma shader_stage(compute)
+
+/*
+	Combines or separates a pair of two-port networks, one frequency point per thread.
+
+	All eight input vectors live back to back in the point buffer and are interpolated onto the frequency grid of the
+	first one (S11 of network A / the combined network).
+ */
+
+#define SPARAM_POINTS_BINDING 0
+#include "SParameters.glsl"
+
+layout(std430, binding=1) restrict writeonly buffer buf_s11mag { float s11mag[]; };
+layout(std430, binding=2) restrict writeonly buffer buf_s11ang { float s11ang[]; };
+layout(std430, binding=3) restrict writeonly buffer buf_s12mag { float s12mag[]; };
+layout(std430, binding=4) restrict writeonly buffer buf_s12ang { float s12ang[]; };
+layout(std430, binding=5) restrict writeonly buffer buf_s21mag { float s21mag[]; };
+layout(std430, binding=6) restrict writeonly buffer buf_s21ang { float s21ang[]; };
+layout(std430, binding=7) restrict writeonly buffer buf_s22mag { float s22mag[]; };
+layout(std430, binding=8) restrict writeonly buffer buf_s22ang { float s22ang[]; };
+
+//Must match SParameterTwoPortKernel::Mode
+#define MODE_CASCADE		0
+#define MODE_DEEMBED_LEFT	1
+#define MODE_DEEMBED_RIGHT	2
+
+layout(std430, push_constant) uniform constants
+{
+	uint npoints;			//Number of output points
+	uint mode;				//Operation to perform
+	uint offsets[8];		//Start of each input vector in the point buffer (S11, S12, S21, S22 of A then B)
+	uint lengths[8];		//Number of points in each input vector
+};
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+vec2 cmul(vec2 a, vec2 b)
+{
+	return vec2(a.x*b.x - a.y*b.y, a.x*b.y + a.y*b.x);
+}
+
+vec2 cdiv(vec2 a, vec2 b)
+{
+	return vec2(a.x*b.x + a.y*b.y, a.y*b.x - a.x*b.y) / dot(b, b);
+}
+
+vec2 Lookup(uint i, float freq)
+{
+	return SParameterToComplex(SParameterInterpolate(offsets[i], lengths[i], freq));
+}
+
+//Converts back to dB / degrees
+vec2 ToMagAngle(vec2 c)
+{
+	float ang = 0;
+	if( (c.x != 0) || (c.y != 0) )
+		ang = atan(c.y, c.x);
+	return vec2(20 * log(length(c)) / log(10.0), ang * 180 / SPARAM_PI);
+}
+
+void main()
+{
+	//If off end of array, stop
+	uint nthread = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+	if(nthread >= npoints)
+		return;
+
+	float freq = sparams[offsets[0] + nthread].frequency;
+
+	vec2 p11a = Lookup(0, freq);
+	vec2 p12a = Lookup(1, freq);
+	vec2 p21a = Lookup(2, freq);
+	vec2 p22a = Lookup(3, freq);
+
+	vec2 p11b = Lookup(4, freq);
+	vec2 p12b = Lookup(5, freq);
+	vec2 p21b = Lookup(6, freq);
+	vec2 p22b = Lookup(7, freq);
+
+	vec2 one = vec2(1, 0);
+	vec2 p11;
+	vec2 p12;
+	vec2 p21;
+	vec2 p22;
+
+	//(equation 2.18, page 118 of Dunsmore 2nd edition)
+	if(mode == MODE_CASCADE)
+	{
+		vec2 denom = one - cmul(p22a, p11b);
+		p11 = p11a + cdiv(cmul(cmul(p11b, p21a), p12a), denom);
+		p12 = cdiv(cmul(p12a, p12b), denom);
+		p21 = cdiv(cmul(p21a, p21b), denom);
+		p22 = p22b + cdiv(cmul(cmul(p22a, p21b), p12b), denom);
+	}
+
+	//A is the combined network, B is known and on the left: solve for the right side
+	else if(mode == MODE_DEEMBED_LEFT)
+	{
+		p11 = cdiv(p11a - p11b, cmul(p21b, p12b) + cmul(p22b, p11a) - cmul(p22b, p11b));
+		p12 = cdiv(p12a - cmul(cmul(p12a, p11), p22b), p12b);
+		p21 = cdiv(p21a - cmul(cmul(p21a, p22b), p11), p21b);
+		p22 = p22a - cdiv(cmul(cmul(p22b, p21), p12), one - cmul(p22b, p11));
+	}
+
+	//B is known and on the right: solve for the left side
+	else
+	{
+		p22 = cdiv(p22a - p22b, cmul(p21b, p12b) + cmul(p22a, p11b) - cmul(p22b, p11b));
+		p12 = cdiv(p12a - cmul(cmul(p12a, p11b), p22), p12b);
+		p21 = cdiv(p21a - cmul(cmul(p21a, p22), p11b), p21b);
+		p11 = p11a - cdiv(cmul(cmul(p11b, p21), p12), one - cmul(p22, p11b));
+	}
+
+	vec2 o11 = ToMagAngle(p11);
+	vec2 o12 = ToMagAngle(p12);
+	vec2 o21 = ToMagAngle(p21);
+	vec2 o22 = ToMagAngle(p22);
+
+	s11mag[nthread] = o11.x;
+	s11ang[nthread] = o11.y;
+	s12mag[nthread] = o12.x;
+	s12ang[nthread] = o12.y;
+	s21mag[nthread] = o21.x;
+	s21ang[nthread] = o21.y;
+	s22mag[nthread] = o22.x;
+	s22ang[nthread] = o22.y;
+}
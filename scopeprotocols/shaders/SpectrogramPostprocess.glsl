@@ -49,6 +49,8 @@ layout(std430, push_constant) uniform constants
 	float impscale;
 	float minscale;
 	float irange;
+	uint width;
+	uint colOffset;
 };
 
 layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
@@ -68,7 +70,8 @@ void main()
 		return;
 
 	uint nin = (nouts*realy + gl_GlobalInvocationID.x)*2;
-	uint nout = gl_GlobalInvocationID.x*nblocks + realy;
+	//Output columns are a circular buffer (offset is always zero and width is nblocks, except in streaming mode)
+	uint nout = gl_GlobalInvocationID.x*width + ((colOffset + realy) % width);
 
 	float real = din[nin];
 	float imag = din[nin + 1];
@@ -0,0 +1,89 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Block sync search for 64b/66b and 128b/130b line codes
+
+	Counts invalid (00 or 11) sync headers at every candidate block phase. One row of thread blocks per phase.
+ */
+
+#version 430
+#pragma shader_stage(compute)
+
+#extension GL_EXT_shader_8bit_storage : require
+
+layout(std430, binding=0) restrict readonly buffer buf_din
+{
+	uint8_t din[];
+};
+
+layout(std430, binding=1) buffer buf_errors
+{
+	uint errors[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint end;			//index of the first bit a block may not start at
+	uint blockLen;		//length of one block, including the sync header
+};
+
+#define NUM_THREADS 64
+
+layout(local_size_x=NUM_THREADS, local_size_y=1, local_size_z=1) in;
+
+shared uint g_errors[NUM_THREADS];
+
+void main()
+{
+	uint phase = gl_WorkGroupID.y;
+	uint stride = gl_NumWorkGroups.x * NUM_THREADS * blockLen;
+
+	//Check every stride'th block at this phase
+	uint count = 0;
+	for(uint i = phase + gl_GlobalInvocationID.x*blockLen; i < end; i += stride)
+	{
+		if(uint(din[i]) == uint(din[i+1]))
+			count ++;
+	}
+	g_errors[gl_LocalInvocationID.x] = count;
+
+	//Sum within the thread block
+	for(uint n = NUM_THREADS/2; n > 0; n >>= 1)
+	{
+		barrier();
+		memoryBarrierShared();
+		if(gl_LocalInvocationID.x < n)
+			g_errors[gl_LocalInvocationID.x] += g_errors[gl_LocalInvocationID.x + n];
+	}
+
+	if(gl_LocalInvocationID.x == 0)
+		atomicAdd(errors[phase], g_errors[0]);
+}
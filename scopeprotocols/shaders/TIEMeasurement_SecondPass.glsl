@@ -52,9 +52,10 @@ layout(std430, binding=3) restrict writeonly buffer buf_samples
 	float samples[];
 };
 
+//Length of the output (see DeviceLength)
 layout(std430, binding=4) restrict writeonly buffer buf_summary
 {
-	int64_t nsamplesOut;
+	uint nsamplesOut;
 };
 
 layout(std430, push_constant) uniform constants
@@ -134,5 +135,5 @@ void main()
 
 	//If we're the last thread, save the final sample count
 	if(gl_GlobalInvocationID.x == (numThreads - 1) )
-		nsamplesOut = int64_t(iout);
+		nsamplesOut = iout;
 }
@@ -0,0 +1,116 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 460
+#pragma shader_stage(compute)
+
+#extension GL_EXT_shader_8bit_storage : require
+#extension GL_ARB_gpu_shader_int64 : require
+
+layout(std430, binding=0) restrict readonly buffer buf_din
+{
+	uint8_t din[];
+};
+
+layout(std430, binding=1) restrict readonly buffer buf_offsetIn
+{
+	int64_t offsetIn[];
+};
+
+layout(std430, binding=2) restrict writeonly buffer buf_codes
+{
+	uint codes[];
+};
+
+layout(std430, binding=3) restrict writeonly buffer buf_offsetOut
+{
+	int64_t offsetOut[];
+};
+
+layout(std430, binding=4) restrict writeonly buffer buf_durationOut
+{
+	int64_t durationOut[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint len;
+	uint startOffset;
+	uint guardCode;
+};
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+//Control period codes (HDMI 1.4 spec section 5.4.2), packed with the first bit on the wire as the LSB
+const uint controlCodes[4] = { 0x354, 0x0ab, 0x154, 0x2ab };
+
+//Must match TMDSDecoder::CODE_* in TMDSDecoder.h
+#define CODE_CONTROL 0x100
+#define CODE_GUARD 0x200
+
+void main()
+{
+	uint i = (gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+	if(i >= len)
+		return;
+
+	//Deserialize the symbol, LSB first
+	uint base = i*10 + startOffset;
+	uint word = 0;
+	for(uint k=0; k<10; k++)
+		word |= uint(din[base + k]) << k;
+
+	offsetOut[i] = offsetIn[base];
+	durationOut[i] = offsetIn[base + 10] - offsetIn[base];
+
+	//Control codes take priority over everything else
+	for(uint j=0; j<4; j++)
+	{
+		if(word == controlCodes[j])
+		{
+			codes[i] = CODE_CONTROL | j;
+			return;
+		}
+	}
+
+	//Decode as video data. Guard bands are flagged but whether they count as one depends on the previous symbols,
+	//so that gets resolved on the CPU.
+	uint d = word & 0xff;
+	if( (word & 0x200) != 0)
+		d ^= 0xff;
+	if( (word & 0x100) != 0)
+		d ^= (d << 1);
+	else
+		d ^= (d << 1) ^ 0xfe;
+	d &= 0xff;
+
+	if(word == guardCode)
+		d |= CODE_GUARD;
+	codes[i] = d;
+}
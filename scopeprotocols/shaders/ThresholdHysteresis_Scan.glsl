@@ -0,0 +1,93 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2026 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#version 430
+#pragma shader_stage(compute)
+
+layout(std430, binding=0) restrict buffer buf_blockStates
+{
+	uint blockStates[];
+};
+
+layout(std430, binding=1) restrict readonly buffer buf_pin
+{
+	float pin[];
+};
+
+layout(std430, push_constant) uniform constants
+{
+	uint nblocks;
+	float midpoint;
+};
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+shared uint chunkStates[64];
+
+void main()
+{
+	//Run as a single workgroup, each thread handling a contiguous chunk of blocks
+	uint t = gl_LocalInvocationID.x;
+	uint chunk = (nblocks + 63) / 64;
+	uint first = min(nblocks, t * chunk);
+	uint last = min(nblocks, first + chunk);
+
+	//Last decisive state in this thread's chunk
+	uint state = 2;
+	for(uint i=first; i<last; i++)
+	{
+		if(blockStates[i] != 2)
+			state = blockStates[i];
+	}
+	chunkStates[t] = state;
+
+	memoryBarrierShared();
+	barrier();
+
+	//State entering this chunk is the last decisive state of any previous chunk.
+	//If there is none, the serial version starts from whether the first sample is above the midpoint
+	uint carry = (pin[0] > midpoint) ? 1 : 0;
+	for(int j=int(t)-1; j>=0; j--)
+	{
+		if(chunkStates[j] != 2)
+		{
+			carry = chunkStates[j];
+			break;
+		}
+	}
+
+	//Replace each block's result with the state entering it
+	for(uint i=first; i<last; i++)
+	{
+		uint b = blockStates[i];
+		blockStates[i] = carry;
+		if(b != 2)
+			carry = b;
+	}
+}